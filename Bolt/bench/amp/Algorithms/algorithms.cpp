@@ -0,0 +1,404 @@
+/***************************************************************************                                                                                     
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/                                                                                     
+
+//	Benchmark matrix of the Bolt AMP algorithms and the parallel STL of include/experimental,
+//	against a CPU baseline (TBB when Bolt is built with it, serial otherwise), for each
+//	algorithm, element type and length.  The throughput of the input is reported in GB/s
+//	and elements/s, to see from which length dispatching to the GPU pays off.
+
+#include "stdafx.h"
+
+#include <bolt/amp/control.h>
+#include <bolt/amp/functional.h>
+#include <bolt/amp/reduce.h>
+#include <bolt/amp/reduce_by_key.h>
+#include <bolt/amp/scan.h>
+#include <bolt/amp/sort.h>
+#include <bolt/amp/stablesort.h>
+#include <bolt/amp/transform.h>
+#include <bolt/unicode.h>
+#include <bolt/countof.h>
+#include <bolt/statisticalTimer.h>
+
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#include <functional>
+#include <new>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+const std::streamsize colWidth = 16;
+
+//	16 byte element, ordered and summed by its first member
+struct Pair16
+{
+	double key;
+	double value;
+
+	Pair16( ) restrict(cpu,amp) : key( 0 ), value( 0 ) { }
+	Pair16( int x ) restrict(cpu,amp) : key( x ), value( x ) { }
+
+	bool operator<( const Pair16& rhs ) const restrict(cpu,amp) { return key < rhs.key; }
+	bool operator>( const Pair16& rhs ) const restrict(cpu,amp) { return key > rhs.key; }
+	bool operator==( const Pair16& rhs ) const restrict(cpu,amp) { return key == rhs.key && value == rhs.value; }
+	Pair16 operator+( const Pair16& rhs ) const restrict(cpu,amp)
+	{
+		Pair16 r;
+		r.key = key + rhs.key;
+		r.value = value + rhs.value;
+		return r;
+	}
+};
+
+template< typename T >
+struct Twice
+{
+	T operator( )( const T& x ) const restrict(cpu,amp) { return x + x; }
+};
+
+template< typename T >
+struct AboveHalf
+{
+	T half;
+	bool operator( )( const T& x ) const restrict(cpu,amp) { return half < x; }
+};
+
+template< typename T > const TCHAR* typeName( );
+template< > const TCHAR* typeName< int >( ) { return _T( "int" ); }
+template< > const TCHAR* typeName< float >( ) { return _T( "float" ); }
+template< > const TCHAR* typeName< double >( ) { return _T( "double" ); }
+template< > const TCHAR* typeName< Pair16 >( ) { return _T( "pair16" ); }
+
+enum Library { cpuLibrary, boltLibrary, stlLibrary };
+
+//	Name of the CPU baseline, depending on how Bolt was built
+#if defined( ENABLE_TBB )
+const TCHAR* cpuName = _T( "tbb" );
+const bolt::amp::control::e_RunMode cpuRunMode = bolt::amp::control::MultiCoreCpu;
+#else
+const TCHAR* cpuName = _T( "serial" );
+const bolt::amp::control::e_RunMode cpuRunMode = bolt::amp::control::SerialCpu;
+#endif
+
+//	Input and output of one run of an algorithm, the input is copied into
+//	work before each run, so sorting doesn't get an already sorted input
+template< typename T >
+struct Data
+{
+	std::vector< T > input;
+	std::vector< T > work;
+	std::vector< T > output;
+	std::vector< int > keys;
+	std::vector< int > keysOutput;
+	T half;
+
+	Data( size_t length ) : input( length ), work( length ), output( length ), keys( length ), keysOutput( length )
+	{
+		std::mt19937 engine( 1 );
+		std::uniform_int_distribution< int > distribution( 0, 1 << 20 );
+		for( size_t i = 0; i < length; ++i )
+		{
+			input[ i ] = T( distribution( engine ) );
+			//	runs of 64 equal keys
+			keys[ i ] = static_cast< int >( i / 64 );
+		}
+		half = T( 1 << 19 );
+	}
+};
+
+//	Run an algorithm once on a library, return false if the library doesn't have it
+template< typename T >
+bool runOnce( const std::string& algorithm, Library library, bolt::amp::control& ctl, Data< T >& d )
+{
+	namespace stl = std::experimental::parallel;
+	using std::experimental::parallel::par;
+
+	if( algorithm == "sort" )
+	{
+		if( library == stlLibrary )
+			stl::sort( par, d.work.begin( ), d.work.end( ) );
+		else
+			bolt::amp::sort( ctl, d.work.begin( ), d.work.end( ) );
+	}
+	else if( algorithm == "stable_sort" )
+	{
+		if( library == stlLibrary )
+			stl::stable_sort( par, d.work.begin( ), d.work.end( ) );
+		else
+			bolt::amp::stable_sort( ctl, d.work.begin( ), d.work.end( ) );
+	}
+	else if( algorithm == "scan" )
+	{
+		if( library == stlLibrary )
+			stl::inclusive_scan( par, d.work.begin( ), d.work.end( ), d.output.begin( ) );
+		else
+			bolt::amp::inclusive_scan( ctl, d.work.begin( ), d.work.end( ), d.output.begin( ) );
+	}
+	else if( algorithm == "reduce" )
+	{
+		T result;
+		if( library == stlLibrary )
+			result = stl::reduce( par, d.work.begin( ), d.work.end( ), T( 0 ) );
+		else
+			result = bolt::amp::reduce( ctl, d.work.begin( ), d.work.end( ), T( 0 ), bolt::amp::plus< T >( ) );
+		d.output[ 0 ] = result;
+	}
+	else if( algorithm == "reduce_by_key" )
+	{
+		//	the parallel STL has no reduce_by_key
+		if( library == stlLibrary )
+			return false;
+		bolt::amp::reduce_by_key( ctl, d.keys.begin( ), d.keys.end( ), d.work.begin( ), d.keysOutput.begin( ), d.output.begin( ) );
+	}
+	else if( algorithm == "copy_if" )
+	{
+		AboveHalf< T > pred = { d.half };
+		//	Bolt AMP has no copy_if, the std one is the baseline
+		if( library == stlLibrary )
+			stl::copy_if( par, d.work.begin( ), d.work.end( ), d.output.begin( ), pred );
+		else if( library == cpuLibrary )
+			std::copy_if( d.work.begin( ), d.work.end( ), d.output.begin( ), pred );
+		else
+			return false;
+	}
+	else if( algorithm == "transform" )
+	{
+		if( library == stlLibrary )
+			stl::transform( par, d.work.begin( ), d.work.end( ), d.output.begin( ), Twice< T >( ) );
+		else
+			bolt::amp::transform( ctl, d.work.begin( ), d.work.end( ), d.output.begin( ), Twice< T >( ) );
+	}
+	else
+	{
+		throw std::invalid_argument( "unknown algorithm " + algorithm );
+	}
+	return true;
+}
+
+struct Sample
+{
+	bool run;
+	size_t samples;
+	double time;
+};
+
+//	Time numLoops runs of an algorithm on a library, after a first untimed run
+//	which builds and loads the kernels
+template< typename T >
+Sample profile( const std::string& algorithm, Library library, Data< T >& d, size_t numLoops )
+{
+	Sample s = { false, 0, 0.0 };
+
+	bolt::amp::control ctl = bolt::amp::control::getDefault( );
+	if( library == cpuLibrary )
+		ctl.setForceRunMode( cpuRunMode );
+	else if( library == boltLibrary )
+		ctl.setForceRunMode( bolt::amp::control::Gpu );
+
+	d.work = d.input;
+	if( !runOnce( algorithm, library, ctl, d ) )
+		return s;
+
+	bolt::statTimer& myTimer = bolt::statTimer::getInstance( );
+	myTimer.Reset( );
+	myTimer.Reserve( 1, numLoops );
+	size_t testId = myTimer.getUniqueID( _T( "algorithm" ), 0 );
+
+	for( size_t i = 0; i < numLoops; ++i )
+	{
+		d.work = d.input;
+
+		myTimer.Start( testId );
+		runOnce( algorithm, library, ctl, d );
+		myTimer.Stop( testId );
+	}
+
+	//	Remove all timings that are outside of 2 stddev (keep 65% of samples); we ignore outliers to get a more consistent result
+	size_t pruned = myTimer.pruneOutliers( 1.0 );
+	s.run = true;
+	s.samples = numLoops - pruned;
+	s.time = myTimer.getAverageTime( testId );
+	return s;
+}
+
+void printHeader( )
+{
+	bolt::tout << std::left;
+	bolt::tout << std::setw( colWidth ) << _T( "Algorithm" )
+		<< std::setw( colWidth ) << _T( "Type" )
+		<< std::setw( colWidth ) << _T( "Length" )
+		<< std::setw( colWidth ) << _T( "Library" )
+		<< std::setw( colWidth ) << _T( "Samples" )
+		<< std::setw( colWidth ) << _T( "Time (s)" )
+		<< std::setw( colWidth ) << _T( "Speed (GB/s)" )
+		<< std::setw( colWidth ) << _T( "Elements/s" )
+		<< std::setw( colWidth ) << _T( "vs CPU" ) << std::endl;
+}
+
+template< typename T >
+void benchmark( const std::string& algorithm, size_t length, size_t numLoops, const std::vector< Library >& libraries )
+{
+	//	the largest lengths may not fit in the memory of the host
+	Data< T >* d = NULL;
+	try
+	{
+		d = new Data< T >( length );
+	}
+	catch( std::bad_alloc& )
+	{
+		bolt::tout << std::setw( colWidth ) << algorithm.c_str( ) << std::setw( colWidth ) << typeName< T >( )
+			<< std::setw( colWidth ) << length << _T( "skipped, out of host memory" ) << std::endl;
+		return;
+	}
+
+	const TCHAR* names[ ] = { cpuName, _T( "bolt" ), _T( "stl" ) };
+	double gigabytes = ( length * sizeof( T ) ) / ( 1024.0 * 1024.0 * 1024.0 );
+
+	Sample baseline = profile( algorithm, cpuLibrary, *d, numLoops );
+	for( size_t i = 0; i < libraries.size( ); ++i )
+	{
+		Library library = libraries[ i ];
+		Sample s = ( library == cpuLibrary ) ? baseline : profile( algorithm, library, *d, numLoops );
+
+		bolt::tout << std::setw( colWidth ) << algorithm.c_str( )
+			<< std::setw( colWidth ) << typeName< T >( )
+			<< std::setw( colWidth ) << length
+			<< std::setw( colWidth ) << names[ library ];
+		if( !s.run )
+		{
+			bolt::tout << _T( "n/a" ) << std::endl;
+			continue;
+		}
+		bolt::tout << std::setw( colWidth ) << s.samples
+			<< std::setw( colWidth ) << s.time
+			<< std::setw( colWidth ) << gigabytes / s.time
+			<< std::setw( colWidth ) << length / s.time;
+		if( baseline.run )
+			bolt::tout << std::setw( colWidth ) << baseline.time / s.time;
+		bolt::tout << std::endl;
+	}
+
+	delete d;
+}
+
+//	Split a comma separated list
+std::vector< std::string > split( const std::string& list )
+{
+	std::vector< std::string > items;
+	std::stringstream ss( list );
+	std::string item;
+	while( std::getline( ss, item, ',' ) )
+		items.push_back( item );
+	return items;
+}
+
+int _tmain( int argc, _TCHAR* argv[] )
+{
+	size_t minLength = 0;
+	size_t maxLength = 0;
+	size_t numLoops = 0;
+	std::string algorithms;
+	std::string types;
+	std::string libraryList;
+
+	try
+	{
+		// Declare the supported options.
+		po::options_description desc( "AMP algorithms benchmark command line options" );
+		desc.add_options()
+			( "help,h",			"produces this help message" )
+			( "algorithms,a",	po::value< std::string >( &algorithms )->default_value( "sort,stable_sort,scan,reduce,reduce_by_key,copy_if,transform" ), "Comma separated algorithms to benchmark" )
+			( "types,t",		po::value< std::string >( &types )->default_value( "int,float,double,pair16" ), "Comma separated element types: int, float, double, pair16 (16 byte struct)" )
+			( "libraries,b",	po::value< std::string >( &libraryList )->default_value( "cpu,bolt,stl" ), "Comma separated libraries: cpu (TBB if built with it), bolt, stl" )
+			( "minLength,m",	po::value< size_t >( &minLength )->default_value( 1 << 10 ), "Smallest number of elements" )
+			( "maxLength,l",	po::value< size_t >( &maxLength )->default_value( 1 << 30 ), "Largest number of elements, lengths grow by 4 times" )
+			( "profile,p",		po::value< size_t >( &numLoops )->default_value( 10 ), "Number of timed runs of each configuration" )
+			;
+
+		po::variables_map vm;
+		po::store( po::parse_command_line( argc, argv, desc ), vm );
+		po::notify( vm );
+
+		if( vm.count( "help" ) )
+		{
+			//	This needs to be 'cout' as program-options does not support wcout yet
+			std::cout << desc << std::endl;
+			return 0;
+		}
+	}
+	catch( std::exception& e )
+	{
+		bolt::terr << _T( "Bolt AMP error reported:" ) << std::endl << e.what() << std::endl;
+		return 1;
+	}
+
+	std::vector< Library > libraries;
+	std::vector< std::string > libraryNames = split( libraryList );
+	for( size_t i = 0; i < libraryNames.size( ); ++i )
+	{
+		if( libraryNames[ i ] == "cpu" )
+			libraries.push_back( cpuLibrary );
+		else if( libraryNames[ i ] == "bolt" )
+			libraries.push_back( boltLibrary );
+		else if( libraryNames[ i ] == "stl" )
+			libraries.push_back( stlLibrary );
+		else
+		{
+			bolt::terr << _T( "Unknown library: " ) << libraryNames[ i ].c_str( ) << std::endl;
+			return 1;
+		}
+	}
+
+	std::vector< std::string > algorithmNames = split( algorithms );
+	std::vector< std::string > typeNames = split( types );
+
+	printHeader( );
+	try
+	{
+		for( size_t a = 0; a < algorithmNames.size( ); ++a )
+		{
+			for( size_t t = 0; t < typeNames.size( ); ++t )
+			{
+				for( size_t length = minLength; length <= maxLength; length *= 4 )
+				{
+					const std::string& type = typeNames[ t ];
+					if( type == "int" )
+						benchmark< int >( algorithmNames[ a ], length, numLoops, libraries );
+					else if( type == "float" )
+						benchmark< float >( algorithmNames[ a ], length, numLoops, libraries );
+					else if( type == "double" )
+						benchmark< double >( algorithmNames[ a ], length, numLoops, libraries );
+					else if( type == "pair16" )
+						benchmark< Pair16 >( algorithmNames[ a ], length, numLoops, libraries );
+					else
+						throw std::invalid_argument( "unknown type " + type );
+				}
+			}
+		}
+	}
+	catch( std::exception& e )
+	{
+		bolt::terr << _T( "Bolt AMP error reported:" ) << std::endl << e.what() << std::endl;
+		return 1;
+	}
+
+	return 0;
+}
@@ -43,7 +43,9 @@ char *AsyncProfiler::attributeNames[] = {
     "flops",
     "flops_s",
     "start",
-    "stop"};
+    "stop",
+    "device_time",
+    "host_overhead"};
 
 char *AsyncProfiler::trialAttributeNames[] = {
     "id",
@@ -54,7 +56,9 @@ char *AsyncProfiler::trialAttributeNames[] = {
     "flops",
     "flops_s",
     "start",
-    "stop"
+    "stop",
+    "device_time",
+    "host_overhead"
 };
 
 AsyncProfiler::Step::Step( )
@@ -141,6 +145,11 @@ void AsyncProfiler::Step::computeDerived()
     // bandwidth [bytes / sec]
     if (attributeValues[bandwidth] == 0)
     attributeValues[bandwidth] = static_cast<size_t>(1000000000.0 * attributeValues[memory] / attributeValues[time]);
+
+    // host overhead [ns], the host time of the step which isn't device execution
+    if (attributeValues[hostOverhead] == 0 && attributeValues[deviceTime] > 0
+        && attributeValues[time] > attributeValues[deviceTime])
+    attributeValues[hostOverhead] = attributeValues[time] - attributeValues[deviceTime];
 }
 
 
@@ -452,6 +461,18 @@ void AsyncProfiler::set( size_t trialIndex, size_t stepIndex, size_t attributeIn
     }
 }
 
+// device time [ns] of current step of current trial, from timestamps of the
+// asynchronous operation it waited for; false if it has none (not profiled)
+bool AsyncProfiler::setDeviceTime( size_t beginTick, size_t endTick, size_t tickFrequency )
+{
+    if (tickFrequency == 0 || beginTick == 0 || endTick < beginTick)
+        return false;
+
+    double ns = (endTick - beginTick) * 1000000000.0 / tickFrequency;
+    set( deviceTime, static_cast<size_t>(ns) );
+    return true;
+}
+
 size_t AsyncProfiler::getTrialNum() const
 {
     return currentTrialIndex;
@@ -576,6 +597,40 @@ void AsyncProfiler::calculateAverage()
             }
         }
     }
+
+    // average device time of steps, rejecting the samples outside of 1 stddev
+    // of their mean, as statTimer::pruneOutliers( 1.0 ) does
+    for (size_t s = 0; s < total.size(); s++)
+    {
+        std::vector<double> samples;
+        for (size_t t = firstTrial; t < trials.size(); t++)
+        {
+            if (s < trials[t].size() && get(t, s, deviceTime) > 0)
+                samples.push_back( static_cast<double>(get(t, s, deviceTime)) );
+        }
+        if (samples.empty()) continue;
+
+        double mean = 0;
+        for (size_t i = 0; i < samples.size(); i++) mean += samples[i];
+        mean /= samples.size();
+        double variance = 0;
+        for (size_t i = 0; i < samples.size(); i++) variance += (samples[i] - mean) * (samples[i] - mean);
+        double stddev = sqrt(variance / samples.size());
+
+        double kept = 0;
+        size_t numKept = 0;
+        for (size_t i = 0; i < samples.size(); i++)
+        {
+            if (samples[i] >= mean - stddev && samples[i] <= mean + stddev)
+            {
+                kept += samples[i];
+                numKept++;
+            }
+        }
+        average.set(s, deviceTime, static_cast<size_t>(kept / numKept));
+        average[s].stdDev[deviceTime] = static_cast<size_t>(stddev);
+    }
+
     //std::cout << "########################################################################" << std::endl;
     //std::cout << "Calculating Derived" << std::endl;
     average.computeStepsDerived();
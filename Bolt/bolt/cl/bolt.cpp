@@ -19,8 +19,14 @@
 #include <iostream>
 #include <fstream>
 #include <streambuf>
+#include <sstream>
+#include <cstdio>
+#include <cstdlib>
 #if defined( _WIN32 )
 #include <direct.h>  //windows CWD for error message
+#include <process.h>
+#else
+#include <unistd.h>
 #endif
 #include <bolt/unicode.h>
 #include <algorithm>
@@ -404,6 +410,32 @@ namespace bolt {
         cl_int * err = NULL);
 
 
+    /**********************************************************************
+        * Program binary cache
+        * programs are saved to and loaded from the directory named by the
+        * BOLT_CL_CACHE_DIR environment variable, if it is set, so the
+        * kernels are built once per device, driver and source across
+        * processes.
+        * Called from acquireProgram.
+        **********************************************************************/
+    ::std::string programCachePath(
+        const ::cl::Device&  device,
+        const ::std::string& deviceStr,
+        const ::std::string& compileOptions,
+        const ::std::string& completeKernelSource );
+
+    bool loadProgramBinary(
+        const ::cl::Context& context,
+        const ::cl::Device&  device,
+        const ::std::string& compileOptions,
+        const ::std::string& path,
+        ::cl::Program& program );
+
+    void saveProgramBinary(
+        const ::cl::Program& program,
+        const ::std::string& path );
+
+
     void wait(const bolt::cl::control &ctl, ::cl::Event &e)
     {
         const bolt::cl::control::e_WaitMode waitMode = ctl.getWaitMode();
@@ -577,11 +609,17 @@ namespace bolt {
         ProgramMap::iterator iter = programMap.find( key );
         ::cl::Program program;
 
-        // map does not yet contain desired program
+        // map does not yet contain desired program; look for it in the binary cache before compiling
         if( iter == programMap.end( ) )
         {
-            program = ::bolt::cl::compileProgram(context, device, options, source, &l_err);
-            V_OPENCL( l_err, "bolt::cl::compileProgram() failed" );
+            std::string cachePath = programCachePath( device, deviceStr, options, source );
+            if( cachePath.empty( ) || !loadProgramBinary( context, device, options, cachePath, program ) )
+            {
+                program = ::bolt::cl::compileProgram(context, device, options, source, &l_err);
+                V_OPENCL( l_err, "bolt::cl::compileProgram() failed" );
+                if( !cachePath.empty( ) )
+                    saveProgramBinary( program, cachePath );
+            }
             ProgramMapValue value = { program };
             programMap.insert( std::make_pair( key, value ) );
         }
@@ -640,6 +678,123 @@ namespace bolt {
     } // compileProgram
 
 
+    /**************************************************************************
+    * programCachePath
+    * - returns the file of the program in the binary cache, empty if the
+    *   cache is disabled. The name hashes the device, its driver version,
+    *   the compile options and the source.
+    **************************************************************************/
+    ::std::string programCachePath(
+        const ::cl::Device&  device,
+        const ::std::string& deviceStr,
+        const ::std::string& options,
+        const ::std::string& source )
+    {
+        const char* cacheDir = ::getenv( "BOLT_CL_CACHE_DIR" );
+        if( cacheDir == NULL || *cacheDir == '\0' )
+            return std::string( );
+
+        std::string keyStr = deviceStr;
+        keyStr += "; " + device.getInfo< CL_DRIVER_VERSION >( );
+        keyStr += "; " + options;
+        keyStr += "; " + source;
+
+        // 64-bit FNV-1a
+        unsigned long long hash = 14695981039346656037ULL;
+        for( std::string::const_iterator c = keyStr.begin( ); c != keyStr.end( ); ++c )
+        {
+            hash ^= static_cast< unsigned char >( *c );
+            hash *= 1099511628211ULL;
+        }
+
+        std::ostringstream path;
+        path << cacheDir << "/bolt_" << std::hex << hash << "_" << std::dec << source.size( ) << ".bin";
+        return path.str( );
+    }
+
+    /**************************************************************************
+    * loadProgramBinary
+    * - builds the program from its binary in the cache, returns false if
+    *   there is none or the device does not take it
+    **************************************************************************/
+    bool loadProgramBinary(
+        const ::cl::Context& context,
+        const ::cl::Device&  device,
+        const ::std::string& options,
+        const ::std::string& path,
+        ::cl::Program& program )
+    {
+        std::ifstream infile( path.c_str( ), std::ios::in | std::ios::binary );
+        if( infile.fail( ) )
+            return false;
+        std::vector< char > binary( ( std::istreambuf_iterator< char >( infile ) ),
+                                    std::istreambuf_iterator< char >( ) );
+        if( binary.empty( ) )
+            return false;
+
+        try
+        {
+            std::vector< ::cl::Device > devices;
+            devices.push_back( device );
+            ::cl::Program::Binaries binaries( 1, std::make_pair( static_cast< const void* >( &binary[ 0 ] ),
+                                                                 binary.size( ) ) );
+            ::cl::Program cached( context, devices, binaries );
+            cached.build( devices, options.c_str( ) );
+            program = cached;
+            return true;
+        }
+        catch( const ::cl::Error& )
+        {
+            // stale or foreign binary, the program is compiled from source and the entry replaced
+            return false;
+        }
+    }
+
+    /**************************************************************************
+    * saveProgramBinary
+    * - writes the binary of a built program to the cache; a temporary file is
+    *   renamed into place so that processes never read a partial entry
+    **************************************************************************/
+    void saveProgramBinary(
+        const ::cl::Program& program,
+        const ::std::string& path )
+    {
+        size_t size = 0;
+        if( ::clGetProgramInfo( program( ), CL_PROGRAM_BINARY_SIZES, sizeof( size ), &size, NULL ) != CL_SUCCESS ||
+            size == 0 )
+            return;
+        std::vector< char > binary( size );
+        char* binaryPtr = &binary[ 0 ];
+        if( ::clGetProgramInfo( program( ), CL_PROGRAM_BINARIES, sizeof( binaryPtr ), &binaryPtr, NULL ) != CL_SUCCESS )
+            return;
+
+        std::ostringstream tmpPath;
+#if defined( _WIN32 )
+        tmpPath << path << "." << ::_getpid( ) << ".tmp";
+#else
+        tmpPath << path << "." << ::getpid( ) << ".tmp";
+#endif
+        {
+            std::ofstream outfile( tmpPath.str( ).c_str( ), std::ios::out | std::ios::binary | std::ios::trunc );
+            if( outfile.fail( ) )
+                return;
+            outfile.write( &binary[ 0 ], binary.size( ) );
+            if( outfile.fail( ) )
+            {
+                outfile.close( );
+                std::remove( tmpPath.str( ).c_str( ) );
+                return;
+            }
+        }
+#if defined( _WIN32 )
+        // rename does not replace an existing file on windows
+        std::remove( path.c_str( ) );
+#endif
+        if( std::rename( tmpPath.str( ).c_str( ), path.c_str( ) ) != 0 )
+            std::remove( tmpPath.str( ).c_str( ) );
+    }
+
+
         // externed in bolt.h
         boost::mutex programMapMutex;
         ProgramMap programMap;
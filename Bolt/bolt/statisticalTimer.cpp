@@ -116,6 +116,7 @@ statTimer::Clear( )
 	labelID.clear( );
 	clkStart.clear( );
 	clkTicks.clear( );
+	devTicks.clear( );
 }
 
 void
@@ -126,13 +127,16 @@ statTimer::Reset( )
 
 	clkStart.clear( );
 	clkTicks.clear( );
+	devTicks.clear( );
 
 	clkStart.resize( nEvents );
 	clkTicks.resize( nEvents );
+	devTicks.resize( nEvents );
 
 	for( statTimer::uint	i = 0; i < nEvents; ++i )
 	{
 		clkTicks.at( i ).reserve( nSamples );
+		devTicks.at( i ).reserve( nSamples );
 	}
 
 	return;
@@ -153,10 +157,12 @@ statTimer::Reserve( size_t nEvents, size_t nSamples )
 
 	clkStart.resize( nEvents );
 	clkTicks.resize( nEvents );
+	devTicks.resize( nEvents );
 
 	for( statTimer::uint i = 0; i < nEvents; ++i )
 	{
 		clkTicks.at( i ).reserve( nSamples );
+		devTicks.at( i ).reserve( nSamples );
 	}
 }
 
@@ -209,6 +215,18 @@ statTimer::AddSample( const size_t id, const statTimer::ulong n )
 	clkTicks.at( id ).push_back( n );
 }
 
+bool
+statTimer::AddDeviceSample( size_t id, statTimer::ulong beginTick, statTimer::ulong endTick, statTimer::ulong tickFrequency )
+{
+	//	An operation which wasn't profiled has no timestamps
+	if( tickFrequency == 0 || beginTick == 0 || endTick < beginTick )
+		return false;
+
+	double ns = static_cast< double >( endTick - beginTick ) * 1000000000.0 / tickFrequency;
+	devTicks.at( id ).push_back( static_cast< statTimer::ulong >( ns ) );
+	return true;
+}
+
 //	This function's purpose is to provide a mapping from a 'friendly' human readable text string
 //	to an index into internal data structures.
 size_t
@@ -231,6 +249,56 @@ statTimer::getUniqueID( const tstring& label, statTimer::uint groupID )
 
 }
 
+double
+statTimer::mean( const clkVector& clks )
+{
+	if( clks.empty( ) )
+		return	0;
+
+	double	sum	= 0;
+	for( clkVector::const_iterator iter = clks.begin( ); iter != clks.end( ); ++iter )
+		sum	+= static_cast< double >( *iter );
+
+	return	sum / clks.size( );
+}
+
+double
+statTimer::stdDev( const clkVector& clks )
+{
+	if( clks.empty( ) )
+		return	0;
+
+	double	m	= mean( clks );
+	double	sum	= 0;
+	for( clkVector::const_iterator iter = clks.begin( ); iter != clks.end( ); ++iter )
+	{
+		double	diff	= *iter - m;
+		sum		+= diff * diff;
+	}
+
+	return	sqrt( sum / clks.size( ) );
+}
+
+size_t
+statTimer::prune( clkVector& clks, double multiple )
+{
+	if( clks.empty( ) )
+		return	0;
+
+	//	Look on p. 379, "The C++ Standard Library"
+	//	std::remove_if does not actually erase, it only copies elements, it returns new 'logical' end
+	clkVector::iterator	newEnd	= std::remove_if( clks.begin( ), clks.end( ), PruneRange< double, statTimer::ulong >( mean( clks ), multiple*stdDev( clks ) ) );
+
+	size_t dist = std::distance( newEnd, clks.end( ) );
+
+	if( dist != 0 )
+		clks.erase( newEnd, clks.end( ) );
+
+	assert( dist < std::numeric_limits< statTimer::uint >::max( ) );
+
+	return dist;
+}
+
 double
 statTimer::getMean( size_t id ) const
 {
@@ -315,23 +383,63 @@ statTimer::pruneOutliers( size_t id , double multiple )
 	if( clkTicks.empty( ) )
 		return	0;
 
-	double	mean	= getMean( id );
-	double	stdDev	= getStdDev( id );
+	//	Device samples are pruned on their own distribution; the count returned is of host samples
+	if( !devTicks.empty( ) )
+		prune( devTicks.at( id ), multiple );
 
-	clkVector&	clks = clkTicks.at( id );
+	return prune( clkTicks.at( id ), multiple );
+}
 
-	//	Look on p. 379, "The C++ Standard Library"
-	//	std::remove_if does not actually erase, it only copies elements, it returns new 'logical' end
-	clkVector::iterator	newEnd	= std::remove_if( clks.begin( ), clks.end( ), PruneRange< double, statTimer::ulong >( mean, multiple*stdDev ) );
+size_t
+statTimer::getDeviceSampleCount( size_t id ) const
+{
+	if( devTicks.empty( ) )
+		return	0;
 
-	size_t dist = std::distance( newEnd, clks.end( ) );
+	return devTicks.at( id ).size( );
+}
 
-	if( dist != 0 )
-		clks.erase( newEnd, clks.end( ) );
+double
+statTimer::getAverageDeviceTime( size_t id ) const
+{
+	if( devTicks.empty( ) )
+		return	0;
 
-	assert( dist < std::numeric_limits< statTimer::uint >::max( ) );
+	if( normalize )
+		return mean( devTicks.at( id ) ) / 1000000000.0;
+	else
+		return mean( devTicks.at( id ) );
+}
 
-	return dist;
+double
+statTimer::getMinimumDeviceTime( size_t id ) const
+{
+	if( devTicks.empty( ) )
+		return	0;
+
+	clkVector::const_iterator iter	= std::min_element( devTicks.at( id ).begin( ), devTicks.at( id ).end( ) );
+
+	if( iter != devTicks.at( id ).end( ) )
+	{
+		if( normalize )
+			return static_cast<double>( *iter ) / 1000000000.0;
+		else
+			return static_cast<double>( *iter );
+	}
+	else
+		return	0;
+}
+
+double
+statTimer::getAverageHostOverhead( size_t id ) const
+{
+	if( getDeviceSampleCount( id ) == 0 )
+		return	0;
+
+	double	hostTime	= getMean( id ) / clkFrequency;
+	double	deviceTime	= mean( devTicks.at( id ) ) / 1000000000.0;
+
+	return	std::max( 0.0, hostTime - deviceTime );
 }
 
 size_t
@@ -374,6 +482,13 @@ operator<<( tstream& os, const statTimer& st )
 		os << _T( "StdDev: " ) << st.getStdDev( l ) << std::endl;
 		os << _T( "AvgTime: " ) << st.getAverageTime( l ) << std::endl;
 		os << _T( "MinTime: " ) << st.getMinimumTime( l ) << std::endl;
+		if( st.getDeviceSampleCount( l ) > 0 )
+		{
+			os << _T( "DeviceSamples: " ) << st.getDeviceSampleCount( l ) << std::endl;
+			os << _T( "AvgDeviceTime: " ) << st.getAverageDeviceTime( l ) << std::endl;
+			os << _T( "MinDeviceTime: " ) << st.getMinimumDeviceTime( l ) << std::endl;
+			os << _T( "AvgHostOverhead: " ) << st.getAverageHostOverhead( l ) << std::endl;
+		}
 
 		//for( cl_uint	t = 0; t < st.clkTicks[l].size( ); ++t )
 		//{
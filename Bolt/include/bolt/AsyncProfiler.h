@@ -34,6 +34,7 @@ public:
 
     static enum attributeTypes {
         /*native*/  id, device, time, memory, bandwidth, flops, flops_s, startTime, stopTime,
+        /*device*/  deviceTime, hostOverhead,
         /*total*/   NUM_ATTRIBUTES};
     static char *attributeNames[];// = {"ID", "StartTime", "StopTime", "Memory", "Device", "Flops"};
     static char *trialAttributeNames[];
@@ -146,6 +147,17 @@ public:
     void set( size_t attributeIndex, size_t attributeValue);
     void set( size_t stepIndex, size_t attributeIndex, size_t attributeValue);
     void set( size_t trialIndex, size_t stepIndex, size_t attributeIndex, size_t attributeValue);
+    bool setDeviceTime( size_t beginTick, size_t endTick, size_t tickFrequency );
+
+    // device time of the current step from a completed hc::completion_future,
+    // a template so this header doesn't depend on hc.hpp
+    template< typename Future >
+    bool setDeviceTime( Future& future )
+    {
+        return setDeviceTime( static_cast<size_t>( future.get_begin_tick() ),
+                              static_cast<size_t>( future.get_end_tick() ),
+                              static_cast<size_t>( future.get_tick_frequency() ) );
+    }
     size_t get( size_t attributeIndex) const;
     size_t get( size_t stepIndex, size_t attributeIndex) const;
     size_t get( size_t trialIndex, size_t stepIndex, size_t attributeIndex) const;
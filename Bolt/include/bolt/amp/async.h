@@ -0,0 +1,197 @@
+/***************************************************************************
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+/*! \file bolt/amp/async.h
+    \brief Asynchronous variants of the Bolt algorithms, returning a std::future of their result.
+*/
+
+#if !defined( BOLT_AMP_ASYNC_H )
+#define BOLT_AMP_ASYNC_H
+#pragma once
+
+#include <future>
+#include "bolt/amp/reduce.h"
+#include "bolt/amp/transform.h"
+#include "bolt/amp/scan.h"
+#include "bolt/amp/sort.h"
+
+namespace bolt {
+    namespace amp {
+
+        /*! \addtogroup algorithms
+         */
+
+        /*! \addtogroup AMP-async
+        *   \ingroup algorithms
+        *   Asynchronous variants of the algorithms. Each one returns as soon as the algorithm is started and
+        *   gives a std::future which is ready once it completed, so that the host can do other work or start
+        *   other algorithms in the meantime. The results on device_vectors stay on the device.
+        *
+        *   \details The algorithm runs on a host thread of its own, with the kernels it launches on the
+        *   accelerator of \p ctl. \p ctl, the input and output ranges and the objects they point to must
+        *   outlive the future. Algorithms started asynchronously are not ordered with one another: an
+        *   algorithm which reads the output of another one must be started once the future of the first
+        *   one is ready.
+        *
+        *   \code
+        *   #include <bolt/amp/async.h>
+        *
+        *   bolt::amp::control ctl;
+        *   bolt::amp::device_vector< int > a( 1 << 20, 1 ), b( 1 << 20, 2 );
+        *
+        *   std::future< int > sumA = bolt::amp::reduce_async( ctl, a.begin( ), a.end( ), 0 );
+        *   std::future< void > sortB = bolt::amp::sort_async( ctl, b.begin( ), b.end( ) );
+        *   // ... host work ...
+        *   sortB.wait( );
+        *   int sum = sumA.get( );
+        *   \endcode
+        *   \{
+        */
+
+        /*! \brief Starts bolt::amp::reduce on [first, last) with the plus operator.
+        *   \return A future of the result of the reduction.
+        */
+        template<typename InputIterator, typename T>
+        std::future< T > reduce_async(control &ctl,
+            InputIterator first,
+            InputIterator last,
+            T init)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last, init ]( )
+            {
+                return bolt::amp::reduce( ctl, first, last, init );
+            } );
+        }
+
+        /*! \brief Starts bolt::amp::reduce on [first, last) with binary_op.
+        *   \return A future of the result of the reduction.
+        */
+        template<typename InputIterator, typename T, typename BinaryFunction>
+        std::future< T > reduce_async(control &ctl,
+            InputIterator first,
+            InputIterator last,
+            T init,
+            BinaryFunction binary_op)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last, init, binary_op ]( )
+            {
+                return bolt::amp::reduce( ctl, first, last, init, binary_op );
+            } );
+        }
+
+        /*! \brief Starts the unary bolt::amp::transform of [first, last) into result.
+        *   \return A future which is ready once result is written.
+        */
+        template<typename InputIterator, typename OutputIterator, typename UnaryFunction>
+        std::future< void > transform_async(control &ctl,
+            InputIterator first,
+            InputIterator last,
+            OutputIterator result,
+            UnaryFunction f)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last, result, f ]( )
+            {
+                bolt::amp::transform( ctl, first, last, result, f );
+            } );
+        }
+
+        /*! \brief Starts the binary bolt::amp::transform of [first1, last1) and first2 into result.
+        *   \return A future which is ready once result is written.
+        */
+        template<typename InputIterator1, typename InputIterator2, typename OutputIterator,
+                 typename BinaryFunction>
+        std::future< void > transform_async(control &ctl,
+            InputIterator1 first1,
+            InputIterator1 last1,
+            InputIterator2 first2,
+            OutputIterator result,
+            BinaryFunction f)
+        {
+            return std::async( std::launch::async, [ &ctl, first1, last1, first2, result, f ]( )
+            {
+                bolt::amp::transform( ctl, first1, last1, first2, result, f );
+            } );
+        }
+
+        /*! \brief Starts bolt::amp::inclusive_scan of [first, last) into result with binary_op.
+        *   \return A future of the end of the output range.
+        */
+        template< typename InputIterator, typename OutputIterator, typename BinaryFunction >
+        std::future< OutputIterator > inclusive_scan_async(control &ctl,
+            InputIterator first,
+            InputIterator last,
+            OutputIterator result,
+            BinaryFunction binary_op)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last, result, binary_op ]( )
+            {
+                return bolt::amp::inclusive_scan( ctl, first, last, result, binary_op );
+            } );
+        }
+
+        /*! \brief Starts bolt::amp::exclusive_scan of [first, last) into result with init and binary_op.
+        *   \return A future of the end of the output range.
+        */
+        template< typename InputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+        std::future< OutputIterator > exclusive_scan_async(control &ctl,
+            InputIterator first,
+            InputIterator last,
+            OutputIterator result,
+            T init,
+            BinaryFunction binary_op)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last, result, init, binary_op ]( )
+            {
+                return bolt::amp::exclusive_scan( ctl, first, last, result, init, binary_op );
+            } );
+        }
+
+        /*! \brief Starts bolt::amp::sort of [first, last) in ascending order.
+        *   \return A future which is ready once the range is sorted.
+        */
+        template<typename RandomAccessIterator>
+        std::future< void > sort_async(control &ctl,
+            RandomAccessIterator first,
+            RandomAccessIterator last)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last ]( )
+            {
+                bolt::amp::sort( ctl, first, last );
+            } );
+        }
+
+        /*! \brief Starts bolt::amp::sort of [first, last) with comp.
+        *   \return A future which is ready once the range is sorted.
+        */
+        template<typename RandomAccessIterator, typename StrictWeakOrdering>
+        std::future< void > sort_async(control &ctl,
+            RandomAccessIterator first,
+            RandomAccessIterator last,
+            StrictWeakOrdering comp)
+        {
+            return std::async( std::launch::async, [ &ctl, first, last, comp ]( )
+            {
+                bolt::amp::sort( ctl, first, last, comp );
+            } );
+        }
+
+        /*!   \}  */
+
+    };
+};
+
+#endif
@@ -0,0 +1,237 @@
+/***************************************************************************
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+/*! \file bolt/amp/autotune.h
+    \brief Autotuning of the device and the work shape of Bolt algorithms run in Automatic mode.
+*/
+#if !defined( BOLT_AMP_AUTOTUNE_H )
+#define BOLT_AMP_AUTOTUNE_H
+
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+#include "bolt/amp/control.h"
+
+namespace bolt
+{
+namespace amp
+{
+namespace detail
+{
+
+/*! Decisions of the autotuner: calls of an algorithm with control::Automatic are grouped by the algorithm,
+ * the element type, the accelerator and the size of the input rounded down to a power of 2. The first calls of
+ * each group run on each candidate plan in turn and are timed, a plan being a run mode, and a number of
+ * work-groups per compute unit for the Gpu runs of the algorithms using it. Once each plan ran
+ * SAMPLES times the fastest one is kept for the group.
+ *
+ * Run modes are candidates with control::AutoTuneDevice, Gpu and the CPU mode built (MultiCoreCpu with TBB,
+ * SerialCpu otherwise), and work shapes with control::AutoTuneWorkShape. The plan of a group which isn't tuned
+ * is the default run mode and the work-groups per compute unit of the control.
+ */
+class autotuner
+{
+public:
+    // timed calls of each candidate plan of a group
+    static const int SAMPLES = 2;
+
+    struct plan
+    {
+        control::e_RunMode runMode;
+        int wgPerComputeUnit;
+    };
+
+    static autotuner& get( )
+    {
+        static autotuner tuner;
+        return tuner;
+    }
+
+    // plan of the next call of a group, and the candidate it is, -1 when the group is tuned
+    plan pick( const control& ctl, const std::string& key, bool workShape, int& candidate )
+    {
+        std::lock_guard< std::mutex > l( m_lock );
+        group& g = m_groups[ key ];
+        if( g.plans.empty( ) )
+        {
+            g.plans = candidates( ctl, workShape );
+            g.counts.assign( g.plans.size( ), 0 );
+            g.times.assign( g.plans.size( ), 0.0 );
+        }
+
+        candidate = -1;
+        if( g.chosen >= 0 )
+            return g.plans[ g.chosen ];
+        for( size_t i = 0; i < g.plans.size( ); ++i )
+        {
+            if( g.counts[ i ] < SAMPLES )
+            {
+                candidate = static_cast< int >( i );
+                return g.plans[ i ];
+            }
+        }
+        return g.plans[ choose( ctl, key, g ) ];
+    }
+
+    // record the time of a call of a group on a candidate plan
+    void record( const std::string& key, int candidate, double ns )
+    {
+        std::lock_guard< std::mutex > l( m_lock );
+        group& g = m_groups[ key ];
+        g.counts[ candidate ]++;
+        g.times[ candidate ] += ns;
+    }
+
+    // forget the decisions made, the next calls are tuned again
+    void reset( )
+    {
+        std::lock_guard< std::mutex > l( m_lock );
+        m_groups.clear( );
+    }
+
+private:
+    struct group
+    {
+        std::vector< plan > plans;
+        std::vector< int > counts;
+        std::vector< double > times;
+        int chosen;
+        group( ) : chosen( -1 ) {}
+    };
+
+    std::mutex m_lock;
+    std::map< std::string, group > m_groups;
+
+    autotuner( ) {}
+
+    static std::vector< plan > candidates( const control& ctl, bool workShape )
+    {
+        std::vector< control::e_RunMode > modes;
+        bool onCpu = ctl.getAccelerator( ).get_device_path( ) == L"cpu";
+        if( ( ctl.getAutoTuneMode( ) & control::AutoTuneDevice ) && !onCpu )
+        {
+            modes.push_back( control::Gpu );
+#ifdef ENABLE_TBB
+            modes.push_back( control::MultiCoreCpu );
+#else
+            modes.push_back( control::SerialCpu );
+#endif
+        }
+        else
+        {
+            modes.push_back( ctl.getDefaultPathToRun( ) );
+        }
+
+        std::vector< int > shapes;
+        if( workShape && ( ctl.getAutoTuneMode( ) & control::AutoTuneWorkShape ) )
+        {
+            static const int wgPerComputeUnit[ ] = { 8, 16, 32, 64 };
+            shapes.assign( wgPerComputeUnit, wgPerComputeUnit + 4 );
+        }
+        else
+        {
+            shapes.push_back( ctl.getWGPerComputeUnit( ) );
+        }
+
+        std::vector< plan > plans;
+        for( size_t m = 0; m < modes.size( ); ++m )
+        {
+            // the work shape only matters on the device
+            size_t n = ( modes[ m ] == control::Gpu ) ? shapes.size( ) : 1;
+            for( size_t s = 0; s < n; ++s )
+            {
+                plan p = { modes[ m ], shapes[ s ] };
+                plans.push_back( p );
+            }
+        }
+        return plans;
+    }
+
+    int choose( const control& ctl, const std::string& key, group& g )
+    {
+        int best = 0;
+        for( size_t i = 1; i < g.plans.size( ); ++i )
+        {
+            if( g.times[ i ] < g.times[ best ] )
+                best = static_cast< int >( i );
+        }
+        g.chosen = best;
+        if( ctl.getDebug( ) & control::debug::AutoTune )
+        {
+            std::cout << "Bolt autotune " << key << ": run mode " << g.plans[ best ].runMode
+                      << ", " << g.plans[ best ].wgPerComputeUnit << " work-groups per compute unit" << std::endl;
+        }
+        return best;
+    }
+};
+
+// key of the group of a call
+inline std::string autotune_key( const control& ctl, const char* algorithm, const std::type_info& type, int n )
+{
+    int bucket = 0;
+    while( ( n >> ( bucket + 1 ) ) > 0 )
+        ++bucket;
+    std::wstring path = ctl.getAccelerator( ).get_device_path( );
+    return std::string( algorithm ) + "\t" + type.name( ) + "\t" +
+           std::string( path.begin( ), path.end( ) ) + "\t" + std::to_string( bucket );
+}
+
+/*! Run an algorithm called with ctl: when its run mode is control::Automatic and autotuning is on, run(tuned)
+ * runs it with a control whose run mode and work-groups per compute unit are the plan of the autotuner,
+ * and the call is timed while the plans are tuned. workShape tells whether the algorithm uses the
+ * work-groups per compute unit.
+ */
+template< typename Run >
+auto autotune( control& ctl, const char* algorithm, const std::type_info& type, int n, bool workShape,
+               Run run ) -> decltype( run( ctl ) )
+{
+    control tuned( ctl );
+    if( ctl.getAutoTuneMode( ) == control::NoAutoTune )
+    {
+        tuned.setForceRunMode( ctl.getDefaultPathToRun( ) );
+        return run( tuned );
+    }
+
+    std::string key = autotune_key( ctl, algorithm, type, n );
+    int candidate;
+    autotuner::plan p = autotuner::get( ).pick( ctl, key, workShape, candidate );
+    tuned.setForceRunMode( p.runMode );
+    tuned.setWGPerComputeUnit( p.wgPerComputeUnit );
+    if( candidate < 0 )
+        return run( tuned );
+
+    // the result outlives the timing of the call
+    auto start = std::chrono::steady_clock::now( );
+    auto result = run( tuned );
+    auto end = std::chrono::steady_clock::now( );
+    autotuner::get( ).record( key, candidate,
+                              std::chrono::duration< double, std::nano >( end - start ).count( ) );
+    return result;
+}
+
+}
+}
+}
+
+#endif
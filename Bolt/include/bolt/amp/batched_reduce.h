@@ -0,0 +1,107 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+/*! \file bolt/amp/batched_reduce.h
+    \brief Reduces each segment of a batch of small ranges, in a single launch sequence for the whole batch.
+*/
+
+#if !defined( BOLT_AMP_BATCHED_REDUCE_H )
+#define BOLT_AMP_BATCHED_REDUCE_H
+#pragma once
+
+#include <amp.h>
+#include <numeric>
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/functional.h"
+#include "bolt/amp/device_vector.h"
+
+namespace bolt {
+    namespace amp {
+
+        /*! \addtogroup algorithms
+         */
+
+        /*! \addtogroup reductions
+        *   \ingroup algorithms
+        */
+
+        /*! \addtogroup AMP-batched_reduce
+        *   \ingroup reductions
+        *   \{
+        */
+
+        /*! \brief batched_reduce reduces each segment of a batch with binary_op, as many calls of reduce would, but
+        * with the same few kernels for the whole batch: the per-call overhead is paid once for thousands of small
+        * segments.
+        *
+        * \details Segment \p s is the range [first + offsets[ s ], first + offsets[ s + 1 ]), and its reduction,
+        * starting from \p init, is written to result[ s ]; empty segments give \p init. The segments are split in
+        * chunks reduced in the local memory of one tile each, so small segments take one tile and large ones are
+        * reduced cooperatively by several. As for reduce, \p binary_op must be commutative and associative.
+        *
+        * \param ctl \b Optional Control structure to control accelerator, debug, tuning, etc.  See bolt::amp::control.
+        * \param first The beginning of the elements of the batch.
+        * \param offsets_first The beginning of the offsets of the segments, one more than the number of segments.
+        * \param offsets_last The end of the offsets of the segments.
+        * \param result The beginning of the reductions of the segments.
+        * \param init The initial value of each reduction.
+        * \param binary_op The binary operation used to combine two values.
+        * \tparam InputIterator An iterator that can be dereferenced for an object, and can be incremented to get to
+        * the next element in a sequence.
+        * \tparam OffsetIterator An iterator over int offsets.
+        * \tparam OutputIterator An iterator to which the reductions can be written.
+        * \tparam T The type of the reductions.
+        * \tparam BinaryFunction A function object that combines two values of type T.
+        *
+        * \code
+        * #include <bolt/amp/batched_reduce.h>
+        *
+        * int a[ 8 ] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+        * int offsets[ 4 ] = { 0, 3, 3, 8 };
+        * int sums[ 3 ];
+        *
+        * bolt::amp::batched_reduce( a, offsets, offsets + 4, sums, 0, bolt::amp::plus< int >( ) );
+        * // sums = { 6, 0, 30 }
+        * \endcode
+        *
+        * \sa reduce
+        */
+        template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+                  typename BinaryFunction >
+        void batched_reduce( control &ctl,
+                             InputIterator first,
+                             OffsetIterator offsets_first,
+                             OffsetIterator offsets_last,
+                             OutputIterator result,
+                             T init,
+                             BinaryFunction binary_op );
+
+        template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+                  typename BinaryFunction >
+        void batched_reduce( InputIterator first,
+                             OffsetIterator offsets_first,
+                             OffsetIterator offsets_last,
+                             OutputIterator result,
+                             T init,
+                             BinaryFunction binary_op );
+
+        /*!   \}  */
+    };
+};
+
+#include <bolt/amp/detail/batched_reduce.inl>
+#endif
@@ -0,0 +1,143 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+/*! \file bolt/amp/batched_scan.h
+    \brief Scans each segment of a batch of small ranges, in a single launch sequence for the whole batch.
+*/
+
+#if !defined( BOLT_AMP_BATCHED_SCAN_H )
+#define BOLT_AMP_BATCHED_SCAN_H
+#pragma once
+
+#include <amp.h>
+#include <numeric>
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/functional.h"
+#include "bolt/amp/device_vector.h"
+
+namespace bolt {
+    namespace amp {
+
+        /*! \addtogroup algorithms
+         */
+
+        /*! \addtogroup PrefixSums Prefix Sums
+        *   \ingroup algorithms
+        */
+
+        /*! \addtogroup AMP-batched_scan
+        *   \ingroup PrefixSums
+        *   \{
+        */
+
+        /*! \brief batched_inclusive_scan computes the inclusive prefix sum of each segment of a batch, as many calls of
+        * inclusive_scan would, but with the same few kernels for the whole batch.
+        *
+        * \details Segment \p s is the range [first + offsets[ s ], first + offsets[ s + 1 ]), and its scan is written
+        * at the same offsets of \p result, which may be \p first. The segments are split in chunks scanned in the
+        * local memory of one tile each; the segments of a single chunk are done in that one kernel, the chunks of
+        * larger segments are then combined cooperatively by two more kernels. \p binary_op must be associative.
+        *
+        * \param ctl \b Optional Control structure to control accelerator, debug, tuning, etc.  See bolt::amp::control.
+        * \param first The beginning of the elements of the batch.
+        * \param offsets_first The beginning of the offsets of the segments, one more than the number of segments.
+        * \param offsets_last The end of the offsets of the segments.
+        * \param result The beginning of the output, the scans of the segments.
+        * \param binary_op The binary operation used to combine two values.
+        * \tparam InputIterator An iterator that can be dereferenced for an object, and can be incremented to get to
+        * the next element in a sequence.
+        * \tparam OffsetIterator An iterator over int offsets.
+        * \tparam OutputIterator An iterator to which the scans can be written.
+        * \tparam BinaryFunction A function object that combines two values of the type of the output.
+        *
+        * \code
+        * #include <bolt/amp/batched_scan.h>
+        *
+        * int a[ 6 ] = { 1, 2, 3, 4, 5, 6 };
+        * int offsets[ 3 ] = { 0, 2, 6 };
+        *
+        * bolt::amp::batched_inclusive_scan( a, offsets, offsets + 3, a, bolt::amp::plus< int >( ) );
+        * // a = { 1, 3, 3, 7, 12, 18 }
+        * \endcode
+        *
+        * \sa inclusive_scan
+        */
+        template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename BinaryFunction >
+        void batched_inclusive_scan( control &ctl,
+                                     InputIterator first,
+                                     OffsetIterator offsets_first,
+                                     OffsetIterator offsets_last,
+                                     OutputIterator result,
+                                     BinaryFunction binary_op );
+
+        template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename BinaryFunction >
+        void batched_inclusive_scan( InputIterator first,
+                                     OffsetIterator offsets_first,
+                                     OffsetIterator offsets_last,
+                                     OutputIterator result,
+                                     BinaryFunction binary_op );
+
+        /*! \brief batched_exclusive_scan computes the exclusive prefix sum of each segment of a batch, starting from
+        * \p init, as many calls of exclusive_scan would, but with the same few kernels for the whole batch.
+        *
+        * \details See batched_inclusive_scan.
+        *
+        * \param ctl \b Optional Control structure to control accelerator, debug, tuning, etc.  See bolt::amp::control.
+        * \param first The beginning of the elements of the batch.
+        * \param offsets_first The beginning of the offsets of the segments, one more than the number of segments.
+        * \param offsets_last The end of the offsets of the segments.
+        * \param result The beginning of the output, the scans of the segments.
+        * \param init The first value of the scan of each segment.
+        * \param binary_op The binary operation used to combine two values.
+        *
+        * \code
+        * #include <bolt/amp/batched_scan.h>
+        *
+        * int a[ 6 ] = { 1, 2, 3, 4, 5, 6 };
+        * int offsets[ 3 ] = { 0, 2, 6 };
+        *
+        * bolt::amp::batched_exclusive_scan( a, offsets, offsets + 3, a, 0, bolt::amp::plus< int >( ) );
+        * // a = { 0, 1, 0, 3, 7, 12 }
+        * \endcode
+        *
+        * \sa exclusive_scan
+        */
+        template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+                  typename BinaryFunction >
+        void batched_exclusive_scan( control &ctl,
+                                     InputIterator first,
+                                     OffsetIterator offsets_first,
+                                     OffsetIterator offsets_last,
+                                     OutputIterator result,
+                                     T init,
+                                     BinaryFunction binary_op );
+
+        template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+                  typename BinaryFunction >
+        void batched_exclusive_scan( InputIterator first,
+                                     OffsetIterator offsets_first,
+                                     OffsetIterator offsets_last,
+                                     OutputIterator result,
+                                     T init,
+                                     BinaryFunction binary_op );
+
+        /*!   \}  */
+    };
+};
+
+#include <bolt/amp/detail/batched_scan.inl>
+#endif
@@ -0,0 +1,100 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+/*! \file bolt/amp/batched_sort.h
+    \brief Sorts each segment of a batch of small ranges, in a single launch sequence for the whole batch.
+*/
+
+#if !defined( BOLT_AMP_BATCHED_SORT_H )
+#define BOLT_AMP_BATCHED_SORT_H
+#pragma once
+
+#include <amp.h>
+#include <algorithm>
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/functional.h"
+#include "bolt/amp/device_vector.h"
+
+namespace bolt {
+    namespace amp {
+
+        /*! \addtogroup algorithms
+         */
+
+        /*! \addtogroup sorting
+        *   \ingroup algorithms
+        */
+
+        /*! \addtogroup AMP-batched_sort
+        *   \ingroup sorting
+        *   \{
+        */
+
+        /*! \brief batched_sort sorts each segment of a batch in place, as many calls of sort would, but with the same
+        * few kernels for the whole batch: the per-call overhead is paid once for thousands of small segments.
+        *
+        * \details Segment \p s is the range [first + offsets[ s ], first + offsets[ s + 1 ]). The segments are split
+        * in blocks of BATCHED_SORT_BLOCK_SIZE elements, each sorted in the local memory of one tile: segments of a
+        * single block are done in that one kernel. The blocks of larger segments are then merged cooperatively, by
+        * a kernel per doubling of the length of the sorted runs in which each work-item places one element. The sort
+        * isn't stable.
+        *
+        * \param ctl \b Optional Control structure to control accelerator, debug, tuning, etc.  See bolt::amp::control.
+        * \param first The beginning of the elements of the batch.
+        * \param offsets_first The beginning of the offsets of the segments, one more than the number of segments.
+        * \param offsets_last The end of the offsets of the segments.
+        * \param comp The comparison operation used to order the elements, less by default.
+        * \tparam RandomAccessIterator A mutable random access iterator, on the host or of a device_vector.
+        * \tparam OffsetIterator An iterator over int offsets.
+        * \tparam StrictWeakOrdering A function object that defines a strict weak ordering of the elements.
+        *
+        * \code
+        * #include <bolt/amp/batched_sort.h>
+        *
+        * int a[ 8 ] = { 2, 9, 3, 7, 5, 6, 3, 8 };
+        * int offsets[ 3 ] = { 0, 3, 8 };
+        *
+        * bolt::amp::batched_sort( a, offsets, offsets + 3 );
+        * // a = { 2, 3, 9, 3, 5, 6, 7, 8 }
+        * \endcode
+        *
+        * \sa sort
+        */
+        template< typename RandomAccessIterator, typename OffsetIterator, typename StrictWeakOrdering >
+        void batched_sort( control &ctl,
+                           RandomAccessIterator first,
+                           OffsetIterator offsets_first,
+                           OffsetIterator offsets_last,
+                           StrictWeakOrdering comp );
+
+        template< typename RandomAccessIterator, typename OffsetIterator, typename StrictWeakOrdering >
+        void batched_sort( RandomAccessIterator first,
+                           OffsetIterator offsets_first,
+                           OffsetIterator offsets_last,
+                           StrictWeakOrdering comp );
+
+        template< typename RandomAccessIterator, typename OffsetIterator >
+        void batched_sort( RandomAccessIterator first,
+                           OffsetIterator offsets_first,
+                           OffsetIterator offsets_last );
+
+        /*!   \}  */
+    };
+};
+
+#include <bolt/amp/detail/batched_sort.inl>
+#endif
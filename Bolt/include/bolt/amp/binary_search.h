@@ -23,7 +23,8 @@
 #include <string>
 
 /*! \file bolt/amp/binary_search.h
-    \brief Returns true if the search element is found in the given input range and false otherwise.
+    \brief Returns true if the search element is found in the given input range and false otherwise, and the
+    vectorized lower_bound and upper_bound of a range of values.
 */
 
 namespace bolt {
@@ -130,8 +131,145 @@ namespace bolt {
             const T & value,
             StrictWeakOrdering comp);
 
+        /*! \brief This version of \p lower_bound searches each of a range of values in a sorted input range, and writes
+        * the index of the first position each value could be inserted at without violating the ordering.
+        *
+        * \details This is the vectorized \p lower_bound of Thrust. A work-item searches each value: the top levels of
+        * the searches are done in samples of the sorted range cached in tile_static memory, BOUNDS_CACHE_SIZE of them,
+        * so each search only reads global memory in the range between the two samples around its value.
+        *
+        * \param ctl \b Optional Control structure to control accelerator, debug, tuning, etc.See bolt::amp::control.
+        * \param first The first position in the sorted sequence to search.
+        * \param last  The last position in the sorted sequence to search.
+        * \param values_first The first of the values to search.
+        * \param values_last  The last of the values to search.
+        * \param result The beginning of the indices of the values, relative to first.
+        * \param comp  The comparison operation the sequence is sorted with.
+        * \param sort_values Searches the values in sorted order, so that neighbouring work-items read the same parts
+        *                    of the sequence. It pays off for large unordered batches of values against a large
+        *                    sequence; the indices are still written in the order of the values.
+        * \tparam ForwardIterator An iterator that can be dereferenced for an object, and can be incremented to get to
+        *                         the next element in a sequence.
+        * \tparam InputIterator An iterator over the values to search.
+        * \tparam OutputIterator An iterator over an integral type.
+        * \return The end of the indices written.
+        *
+        * \details The following code example shows the use of \p lower_bound.
+        * \code
+        * #include <bolt/amp/binary_search.h>
+        *
+        * int a[8] = {2, 3, 3, 5, 6, 7, 8, 9};
+        * int v[3] = {3, 4, 10};
+        * int r[3];
+        *
+        * bolt::amp::lower_bound( a, a+8, v, v+3, r );
+        * // r is {1, 3, 8}
+        *
+        * \endcode
+        * \sa http://thrust.github.io/doc/group__vectorized__binary__search.html
+        */
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator>
+        OutputIterator lower_bound(bolt::amp::control &ctl,
+            ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result);
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator>
+        OutputIterator lower_bound(ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result);
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering>
+        OutputIterator lower_bound(bolt::amp::control &ctl,
+            ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result,
+            StrictWeakOrdering comp,
+            bool sort_values = false);
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering>
+        OutputIterator lower_bound(ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result,
+            StrictWeakOrdering comp,
+            bool sort_values = false);
+
+        /*! \brief This version of \p upper_bound searches each of a range of values in a sorted input range, and writes
+        * the index of the last position each value could be inserted at without violating the ordering.
+        *
+        * \details The searches are done as in the vectorized \p lower_bound.
+        *
+        * \param ctl \b Optional Control structure to control accelerator, debug, tuning, etc.See bolt::amp::control.
+        * \param first The first position in the sorted sequence to search.
+        * \param last  The last position in the sorted sequence to search.
+        * \param values_first The first of the values to search.
+        * \param values_last  The last of the values to search.
+        * \param result The beginning of the indices of the values, relative to first.
+        * \param comp  The comparison operation the sequence is sorted with.
+        * \param sort_values Searches the values in sorted order, see \p lower_bound.
+        * \return The end of the indices written.
+        *
+        * \details The following code example shows the use of \p upper_bound.
+        * \code
+        * #include <bolt/amp/binary_search.h>
+        *
+        * int a[8] = {2, 3, 3, 5, 6, 7, 8, 9};
+        * int v[3] = {3, 4, 10};
+        * int r[3];
+        *
+        * bolt::amp::upper_bound( a, a+8, v, v+3, r );
+        * // r is {3, 3, 8}
+        *
+        * \endcode
+        * \sa http://thrust.github.io/doc/group__vectorized__binary__search.html
+        */
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator>
+        OutputIterator upper_bound(bolt::amp::control &ctl,
+            ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result);
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator>
+        OutputIterator upper_bound(ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result);
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering>
+        OutputIterator upper_bound(bolt::amp::control &ctl,
+            ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result,
+            StrictWeakOrdering comp,
+            bool sort_values = false);
+
+        template<typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering>
+        OutputIterator upper_bound(ForwardIterator first,
+            ForwardIterator last,
+            InputIterator values_first,
+            InputIterator values_last,
+            OutputIterator result,
+            StrictWeakOrdering comp,
+            bool sort_values = false);
+
     }// end of bolt::amp namespace
 }// end of bolt namespace
 
 #include <bolt/amp/detail/binary_search.inl>
+#include <bolt/amp/detail/bounds.inl>
 #endif
\ No newline at end of file
@@ -91,7 +91,7 @@ public:
     enum e_AutoTuneMode{NoAutoTune=0x0,
                         AutoTuneDevice=0x1,
                         AutoTuneWorkShape=0x2,
-                        AutoTuneAll=0x3}; // FIXME, experimental
+                        AutoTuneAll=0x3};
     struct debug {
         static const unsigned None=0;
         static const unsigned Compile = 0x1;
@@ -102,7 +102,7 @@ public:
     };
 
     enum e_WaitMode {
-        BalancedWait,	// Balance of Busy and Nice: tries to use Busy for short-running kernels.  \todo: Balanced currently maps to nice.
+        BalancedWait,	// Balance of Busy and Nice: uses Busy for the algorithms whose recent runs were short, and Nice for the long ones.
         NiceWait,		// Use an OS semaphore to detect completion status.
         BusyWait,		// Busy a CPU core continuously monitoring results.  Lowest-latency, but requires a dedicated core.
         ClFinish,      // Call clFinish on the queue.
@@ -174,7 +174,15 @@ public:
         the optimal point for a given algorithm and device; typically 8-12 will deliver good results */
     void setWGPerComputeUnit(int wgPerComputeUnit) { m_wgPerComputeUnit = wgPerComputeUnit; };
 
-    /*! Set the method used to detect completion at the end of a Bolt routine. */
+    /*! Set which choices Bolt algorithms run in Automatic mode tune: the device they run on, Gpu or the CPU,
+        and the work-groups per compute unit they launch on the Gpu. The first calls of an algorithm for each
+        element type and size of the input are timed on each candidate, and the fastest one is used for the
+        next calls.  Calls whose run mode is forced aren't tuned. */
+    void setAutoTuneMode(e_AutoTuneMode autoTune) { m_autoTune = autoTune; };
+
+    /*! Set the method used to detect completion at the end of a Bolt routine.  It's the wait mode of the default
+        view of the accelerator while a reduction (reduce, transform_reduce, inner_product, count, min_element
+        and max_element) runs on the Gpu. */
     void setWaitMode(e_WaitMode waitMode) { m_waitMode = waitMode; };
 
     /*! unroll assignment */
@@ -187,6 +195,7 @@ public:
     e_UseHostMode getUseHost() const { return m_useHost; };
     e_RunMode getForceRunMode() const { return m_forceRunMode; };
 	e_RunMode getDefaultPathToRun() const { return m_defaultRunMode; };
+    e_AutoTuneMode getAutoTuneMode() const { return m_autoTune; };
     unsigned getDebug() const { return m_debug;};
     int const getWGPerComputeUnit() const { return m_wgPerComputeUnit; };
     e_WaitMode getWaitMode() const { return m_waitMode; };
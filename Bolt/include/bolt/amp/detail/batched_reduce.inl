@@ -0,0 +1,247 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_BATCHED_REDUCE_INL )
+#define BOLT_AMP_BATCHED_REDUCE_INL
+#define BATCHED_REDUCE_WAVEFRONT_SIZE 256
+// Number of elements a tile reduces, larger segments are split across tiles
+#define BATCHED_REDUCE_CHUNK_SIZE ( BATCHED_REDUCE_WAVEFRONT_SIZE * 16 )
+
+#include <iterator>
+#include <type_traits>
+#include "bolt/amp/iterator/iterator_traits.h"
+#include "bolt/amp/detail/batched_segments.inl"
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    template< typename DVInputIterator, typename DVOutputIterator, typename T, typename BinaryFunction >
+    void batched_reduce_enqueue( bolt::amp::control &ctl,
+                                 const DVInputIterator& first,
+                                 const batched_segments& segments,
+                                 const DVOutputIterator& result,
+                                 const T& init,
+                                 const BinaryFunction& binary_op )
+    {
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+        const int numSegments = segments.numSegments;
+        const int numChunks = segments.numChunks( );
+
+        // chunk reduction, one tile per chunk
+        concurrency::array< T, 1 > partial( std::max( numChunks, 1 ), av );
+        if( numChunks > 0 )
+        {
+            concurrency::array< int, 1 > offsets( numSegments + 1, segments.offsets.begin( ), segments.offsets.end( ), av );
+            concurrency::array< int, 1 > chunkStart( numChunks, segments.chunkStart.begin( ), segments.chunkStart.end( ), av );
+            concurrency::array< int, 1 > chunkSegment( numChunks, segments.chunkSegment.begin( ), segments.chunkSegment.end( ), av );
+            concurrency::extent< 1 > chunkExtent( numChunks * BATCHED_REDUCE_WAVEFRONT_SIZE );
+            try
+            {
+                concurrency::parallel_for_each( av, chunkExtent.tile< BATCHED_REDUCE_WAVEFRONT_SIZE >( ),
+                                                [ =, &offsets, &chunkStart, &chunkSegment, &partial ]
+                                                ( concurrency::tiled_index< BATCHED_REDUCE_WAVEFRONT_SIZE > t_idx ) restrict(amp)
+                {
+                    tile_static T scratch[ BATCHED_REDUCE_WAVEFRONT_SIZE ];
+                    int chunk = t_idx.tile[ 0 ];
+                    int tileIndex = t_idx.local[ 0 ];
+                    int start = chunkStart[ chunk ];
+                    int end = offsets[ chunkSegment[ chunk ] + 1 ];
+                    if( end - start > BATCHED_REDUCE_CHUNK_SIZE )
+                        end = start + BATCHED_REDUCE_CHUNK_SIZE;
+
+                    int gx = start + tileIndex;
+                    T accumulator;
+                    if( gx < end )
+                    {
+                        accumulator = first[ gx ];
+                        for( gx += BATCHED_REDUCE_WAVEFRONT_SIZE; gx < end; gx += BATCHED_REDUCE_WAVEFRONT_SIZE )
+                            accumulator = binary_op( accumulator, first[ gx ] );
+                    }
+                    scratch[ tileIndex ] = accumulator;
+                    t_idx.barrier.wait( );
+
+                    // only the lanes below the length of the chunk hold a value
+                    int length = end - start;
+                    for( int w = BATCHED_REDUCE_WAVEFRONT_SIZE / 2; w > 0; w >>= 1 )
+                    {
+                        if( tileIndex < w && tileIndex + w < length )
+                            scratch[ tileIndex ] = binary_op( scratch[ tileIndex ], scratch[ tileIndex + w ] );
+                        t_idx.barrier.wait( );
+                    }
+                    if( tileIndex == 0 )
+                        partial[ chunk ] = scratch[ 0 ];
+                } );
+            }
+            catch( std::exception &e )
+            {
+                std::cout << "Exception while calling bolt::amp::batched_reduce parallel_for_each " << e.what( ) << std::endl;
+                throw;
+            }
+        }
+
+        // segment reduction of the partial reductions of its chunks
+        concurrency::array< int, 1 > segmentChunk( numSegments + 1, segments.segmentChunk.begin( ), segments.segmentChunk.end( ), av );
+        const int leng = numSegments + BATCHED_REDUCE_WAVEFRONT_SIZE - ( numSegments % BATCHED_REDUCE_WAVEFRONT_SIZE );
+        concurrency::extent< 1 > segmentExtent( leng );
+        try
+        {
+            concurrency::parallel_for_each( av, segmentExtent, [ =, &segmentChunk, &partial ]
+                                            ( concurrency::index< 1 > idx ) restrict(amp)
+            {
+                int s = idx[ 0 ];
+                if( s >= numSegments )
+                    return;
+                T accumulator = init;
+                for( int c = segmentChunk[ s ]; c < segmentChunk[ s + 1 ]; ++c )
+                    accumulator = binary_op( accumulator, partial[ c ] );
+                result[ s ] = accumulator;
+            } );
+        }
+        catch( std::exception &e )
+        {
+            std::cout << "Exception while calling bolt::amp::batched_reduce parallel_for_each " << e.what( ) << std::endl;
+            throw;
+        }
+    }
+
+    template< typename DVInputIterator, typename DVOutputIterator, typename T, typename BinaryFunction >
+    void batched_reduce_pick_output( bolt::amp::control &ctl,
+                                     const DVInputIterator& first,
+                                     const batched_segments& segments,
+                                     const DVOutputIterator& result,
+                                     const T& init,
+                                     const BinaryFunction& binary_op,
+                                     bolt::amp::device_vector_tag )
+    {
+        batched_reduce_enqueue( ctl, first, segments, result, init, binary_op );
+    }
+
+    template< typename DVInputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+    void batched_reduce_pick_output( bolt::amp::control &ctl,
+                                     const DVInputIterator& first,
+                                     const batched_segments& segments,
+                                     const OutputIterator& result,
+                                     const T& init,
+                                     const BinaryFunction& binary_op,
+                                     std::random_access_iterator_tag )
+    {
+        typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+        device_vector< oType, concurrency::array_view > dvResult( result, segments.numSegments, true, ctl );
+        batched_reduce_enqueue( ctl, first, segments, dvResult.begin( ), init, binary_op );
+        // This should immediately map/unmap the buffer
+        dvResult.data( );
+    }
+
+    // device_vector and fancy iterators are read in place
+    template< typename DVInputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+    void batched_reduce_pick_iterator( bolt::amp::control &ctl,
+                                       const DVInputIterator& first,
+                                       const batched_segments& segments,
+                                       const OutputIterator& result,
+                                       const T& init,
+                                       const BinaryFunction& binary_op,
+                                       std::true_type )
+    {
+        batched_reduce_pick_output( ctl, first, segments, result, init, binary_op,
+                                    typename std::iterator_traits< OutputIterator >::iterator_category( ) );
+    }
+
+    template< typename InputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+    void batched_reduce_pick_iterator( bolt::amp::control &ctl,
+                                       const InputIterator& first,
+                                       const batched_segments& segments,
+                                       const OutputIterator& result,
+                                       const T& init,
+                                       const BinaryFunction& binary_op,
+                                       std::false_type )
+    {
+        typedef typename std::iterator_traits< InputIterator >::value_type iType;
+        device_vector< iType, concurrency::array_view > dvInput( first, segments.offsets.back( ), false, ctl );
+        batched_reduce_pick_output( ctl, dvInput.begin( ), segments, result, init, binary_op,
+                                    typename std::iterator_traits< OutputIterator >::iterator_category( ) );
+    }
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+              typename BinaryFunction >
+    void batched_reduce( bolt::amp::control &ctl,
+                         const InputIterator& first,
+                         const OffsetIterator& offsets_first,
+                         const OffsetIterator& offsets_last,
+                         const OutputIterator& result,
+                         const T& init,
+                         const BinaryFunction& binary_op )
+    {
+        typedef typename std::iterator_traits< InputIterator >::iterator_category iTag;
+        batched_segments segments( offsets_first, offsets_last, BATCHED_REDUCE_CHUNK_SIZE );
+        if( segments.numSegments == 0 )
+            return;
+
+        bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode( );
+        if( runMode == bolt::amp::control::Automatic )
+        {
+            runMode = ctl.getDefaultPathToRun( );
+        }
+        if( runMode == bolt::amp::control::SerialCpu || runMode == bolt::amp::control::MultiCoreCpu )
+        {
+            batched_for_each_segment( runMode, segments.numSegments, [&]( int s )
+            {
+                *( result + s ) = std::accumulate( first + segments.offsets[ s ], first + segments.offsets[ s + 1 ],
+                                                   init, binary_op );
+            } );
+        }
+        else
+        {
+            batched_reduce_pick_iterator( ctl, first, segments, result, init, binary_op,
+                                          typename std::integral_constant< bool,
+                                              std::is_base_of< bolt::amp::device_vector_tag, iTag >::value ||
+                                              std::is_base_of< bolt::amp::fancy_iterator_tag, iTag >::value >::type( ) );
+        }
+    }
+
+} //End of detail namespace
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+              typename BinaryFunction >
+    void batched_reduce( control &ctl,
+                         InputIterator first,
+                         OffsetIterator offsets_first,
+                         OffsetIterator offsets_last,
+                         OutputIterator result,
+                         T init,
+                         BinaryFunction binary_op )
+    {
+        detail::batched_reduce( ctl, first, offsets_first, offsets_last, result, init, binary_op );
+    }
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+              typename BinaryFunction >
+    void batched_reduce( InputIterator first,
+                         OffsetIterator offsets_first,
+                         OffsetIterator offsets_last,
+                         OutputIterator result,
+                         T init,
+                         BinaryFunction binary_op )
+    {
+        detail::batched_reduce( control::getDefault( ), first, offsets_first, offsets_last, result, init, binary_op );
+    }
+
+} //End of amp namespace
+} //End of bolt namespace
+
+#endif
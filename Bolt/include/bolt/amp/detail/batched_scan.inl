@@ -0,0 +1,338 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_BATCHED_SCAN_INL )
+#define BOLT_AMP_BATCHED_SCAN_INL
+#define BATCHED_SCAN_WAVEFRONT_SIZE 256
+// Number of elements a tile scans, larger segments are split across tiles
+#define BATCHED_SCAN_CHUNK_SIZE ( BATCHED_SCAN_WAVEFRONT_SIZE * 16 )
+
+#include <iterator>
+#include <type_traits>
+#include "bolt/amp/iterator/iterator_traits.h"
+#include "bolt/amp/detail/batched_segments.inl"
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    template< typename DVInputIterator, typename DVOutputIterator, typename T, typename BinaryFunction >
+    void batched_scan_enqueue( bolt::amp::control &ctl,
+                               const DVInputIterator& first,
+                               const batched_segments& segments,
+                               const DVOutputIterator& result,
+                               const T& init,
+                               const bool& inclusive,
+                               const BinaryFunction& binary_op )
+    {
+        typedef typename std::iterator_traits< DVOutputIterator >::value_type oType;
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+        const int numSegments = segments.numSegments;
+        const int numChunks = segments.numChunks( );
+        if( numChunks == 0 )
+            return;
+        const bool exclusive = !inclusive;
+        const oType initValue = init;
+
+        concurrency::array< int, 1 > offsets( numSegments + 1, segments.offsets.begin( ), segments.offsets.end( ), av );
+        concurrency::array< int, 1 > chunkStart( numChunks, segments.chunkStart.begin( ), segments.chunkStart.end( ), av );
+        concurrency::array< int, 1 > chunkSegment( numChunks, segments.chunkSegment.begin( ), segments.chunkSegment.end( ), av );
+        concurrency::array< oType, 1 > total( numChunks, av );
+        concurrency::extent< 1 > chunkExtent( numChunks * BATCHED_SCAN_WAVEFRONT_SIZE );
+
+        // scan of each chunk in local memory, in rounds of a wavefront of elements
+        try
+        {
+            concurrency::parallel_for_each( av, chunkExtent.tile< BATCHED_SCAN_WAVEFRONT_SIZE >( ),
+                                            [ =, &offsets, &chunkStart, &chunkSegment, &total ]
+                                            ( concurrency::tiled_index< BATCHED_SCAN_WAVEFRONT_SIZE > t_idx ) restrict(amp)
+            {
+                tile_static oType lds[ BATCHED_SCAN_WAVEFRONT_SIZE ];
+                int chunk = t_idx.tile[ 0 ];
+                int tileIndex = t_idx.local[ 0 ];
+                int start = chunkStart[ chunk ];
+                int end = offsets[ chunkSegment[ chunk ] + 1 ];
+                if( end - start > BATCHED_SCAN_CHUNK_SIZE )
+                    end = start + BATCHED_SCAN_CHUNK_SIZE;
+
+                // the first chunk of a segment starts from init when exclusive, the others get the carry of the
+                // chunks before them in the last kernel
+                bool hasCarry = exclusive && start == offsets[ chunkSegment[ chunk ] ];
+                oType carry = initValue;
+                for( int base = start; base < end; base += BATCHED_SCAN_WAVEFRONT_SIZE )
+                {
+                    int count = end - base;
+                    if( count > BATCHED_SCAN_WAVEFRONT_SIZE )
+                        count = BATCHED_SCAN_WAVEFRONT_SIZE;
+                    int gx = base + tileIndex;
+                    if( tileIndex < count )
+                        lds[ tileIndex ] = first[ gx ];
+                    t_idx.barrier.wait( );
+
+                    for( int offset = 1; offset < BATCHED_SCAN_WAVEFRONT_SIZE; offset <<= 1 )
+                    {
+                        oType y = lds[ tileIndex ];
+                        if( tileIndex >= offset && tileIndex < count )
+                            y = binary_op( lds[ tileIndex - offset ], y );
+                        t_idx.barrier.wait( );
+                        lds[ tileIndex ] = y;
+                        t_idx.barrier.wait( );
+                    }
+
+                    if( tileIndex < count )
+                    {
+                        if( !exclusive )
+                            result[ gx ] = hasCarry ? binary_op( carry, lds[ tileIndex ] ) : lds[ tileIndex ];
+                        else if( tileIndex > 0 )
+                            result[ gx ] = hasCarry ? binary_op( carry, lds[ tileIndex - 1 ] ) : lds[ tileIndex - 1 ];
+                        else if( hasCarry )
+                            result[ gx ] = carry;
+                    }
+                    carry = hasCarry ? binary_op( carry, lds[ count - 1 ] ) : lds[ count - 1 ];
+                    hasCarry = true;
+                    t_idx.barrier.wait( );
+                }
+                if( tileIndex == 0 )
+                    total[ chunk ] = carry;
+            } );
+        }
+        catch( std::exception &e )
+        {
+            std::cout << "Exception while calling bolt::amp::batched_scan parallel_for_each " << e.what( ) << std::endl;
+            throw;
+        }
+
+        // segments of a single chunk are done
+        if( segments.maxSegment <= BATCHED_SCAN_CHUNK_SIZE )
+            return;
+
+        // carry of each chunk, the combination of the chunks before it in its segment
+        concurrency::array< int, 1 > segmentChunk( numSegments + 1, segments.segmentChunk.begin( ), segments.segmentChunk.end( ), av );
+        concurrency::array< oType, 1 > chunkCarry( numChunks, av );
+        const int leng = numSegments + BATCHED_SCAN_WAVEFRONT_SIZE - ( numSegments % BATCHED_SCAN_WAVEFRONT_SIZE );
+        concurrency::extent< 1 > segmentExtent( leng );
+        try
+        {
+            concurrency::parallel_for_each( av, segmentExtent, [ =, &segmentChunk, &total, &chunkCarry ]
+                                            ( concurrency::index< 1 > idx ) restrict(amp)
+            {
+                int s = idx[ 0 ];
+                if( s >= numSegments || segmentChunk[ s ] == segmentChunk[ s + 1 ] )
+                    return;
+                oType running = total[ segmentChunk[ s ] ];
+                for( int c = segmentChunk[ s ] + 1; c < segmentChunk[ s + 1 ]; ++c )
+                {
+                    chunkCarry[ c ] = running;
+                    running = binary_op( running, total[ c ] );
+                }
+            } );
+
+            concurrency::parallel_for_each( av, chunkExtent.tile< BATCHED_SCAN_WAVEFRONT_SIZE >( ),
+                                            [ =, &offsets, &chunkStart, &chunkSegment, &chunkCarry ]
+                                            ( concurrency::tiled_index< BATCHED_SCAN_WAVEFRONT_SIZE > t_idx ) restrict(amp)
+            {
+                int chunk = t_idx.tile[ 0 ];
+                int start = chunkStart[ chunk ];
+                if( start == offsets[ chunkSegment[ chunk ] ] )
+                    return;
+                int end = offsets[ chunkSegment[ chunk ] + 1 ];
+                if( end - start > BATCHED_SCAN_CHUNK_SIZE )
+                    end = start + BATCHED_SCAN_CHUNK_SIZE;
+                oType carry = chunkCarry[ chunk ];
+                for( int gx = start + t_idx.local[ 0 ]; gx < end; gx += BATCHED_SCAN_WAVEFRONT_SIZE )
+                {
+                    if( exclusive && gx == start )
+                        result[ gx ] = carry;
+                    else
+                        result[ gx ] = binary_op( carry, result[ gx ] );
+                }
+            } );
+        }
+        catch( std::exception &e )
+        {
+            std::cout << "Exception while calling bolt::amp::batched_scan parallel_for_each " << e.what( ) << std::endl;
+            throw;
+        }
+    }
+
+    template< typename DVInputIterator, typename DVOutputIterator, typename T, typename BinaryFunction >
+    void batched_scan_pick_output( bolt::amp::control &ctl,
+                                   const DVInputIterator& first,
+                                   const batched_segments& segments,
+                                   const DVOutputIterator& result,
+                                   const T& init,
+                                   const bool& inclusive,
+                                   const BinaryFunction& binary_op,
+                                   bolt::amp::device_vector_tag )
+    {
+        batched_scan_enqueue( ctl, first, segments, result, init, inclusive, binary_op );
+    }
+
+    template< typename DVInputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+    void batched_scan_pick_output( bolt::amp::control &ctl,
+                                   const DVInputIterator& first,
+                                   const batched_segments& segments,
+                                   const OutputIterator& result,
+                                   const T& init,
+                                   const bool& inclusive,
+                                   const BinaryFunction& binary_op,
+                                   std::random_access_iterator_tag )
+    {
+        typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+        device_vector< oType, concurrency::array_view > dvResult( result, segments.offsets.back( ), false, ctl );
+        batched_scan_enqueue( ctl, first, segments, dvResult.begin( ), init, inclusive, binary_op );
+        // This should immediately map/unmap the buffer
+        dvResult.data( );
+    }
+
+    // device_vector and fancy iterators are read in place
+    template< typename DVInputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+    void batched_scan_pick_iterator( bolt::amp::control &ctl,
+                                     const DVInputIterator& first,
+                                     const batched_segments& segments,
+                                     const OutputIterator& result,
+                                     const T& init,
+                                     const bool& inclusive,
+                                     const BinaryFunction& binary_op,
+                                     std::true_type )
+    {
+        batched_scan_pick_output( ctl, first, segments, result, init, inclusive, binary_op,
+                                  typename std::iterator_traits< OutputIterator >::iterator_category( ) );
+    }
+
+    template< typename InputIterator, typename OutputIterator, typename T, typename BinaryFunction >
+    void batched_scan_pick_iterator( bolt::amp::control &ctl,
+                                     const InputIterator& first,
+                                     const batched_segments& segments,
+                                     const OutputIterator& result,
+                                     const T& init,
+                                     const bool& inclusive,
+                                     const BinaryFunction& binary_op,
+                                     std::false_type )
+    {
+        typedef typename std::iterator_traits< InputIterator >::value_type iType;
+        device_vector< iType, concurrency::array_view > dvInput( first, segments.offsets.back( ), false, ctl );
+        batched_scan_pick_output( ctl, dvInput.begin( ), segments, result, init, inclusive, binary_op,
+                                  typename std::iterator_traits< OutputIterator >::iterator_category( ) );
+    }
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+              typename BinaryFunction >
+    void batched_scan( bolt::amp::control &ctl,
+                       const InputIterator& first,
+                       const OffsetIterator& offsets_first,
+                       const OffsetIterator& offsets_last,
+                       const OutputIterator& result,
+                       const T& init,
+                       const bool& inclusive,
+                       const BinaryFunction& binary_op )
+    {
+        typedef typename std::iterator_traits< InputIterator >::iterator_category iTag;
+        typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+        batched_segments segments( offsets_first, offsets_last, BATCHED_SCAN_CHUNK_SIZE );
+        if( segments.numElements == 0 )
+            return;
+
+        bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode( );
+        if( runMode == bolt::amp::control::Automatic )
+        {
+            runMode = ctl.getDefaultPathToRun( );
+        }
+        if( runMode == bolt::amp::control::SerialCpu || runMode == bolt::amp::control::MultiCoreCpu )
+        {
+            batched_for_each_segment( runMode, segments.numSegments, [&]( int s )
+            {
+                if( segments.offsets[ s ] == segments.offsets[ s + 1 ] )
+                    return;
+                oType sum = init;
+                for( int i = segments.offsets[ s ]; i < segments.offsets[ s + 1 ]; ++i )
+                {
+                    oType value = *( first + i );
+                    if( inclusive )
+                        sum = ( i == segments.offsets[ s ] ) ? value : binary_op( sum, value );
+                    *( result + i ) = sum;
+                    if( !inclusive )
+                        sum = binary_op( sum, value );
+                }
+            } );
+        }
+        else
+        {
+            batched_scan_pick_iterator( ctl, first, segments, result, init, inclusive, binary_op,
+                                        typename std::integral_constant< bool,
+                                            std::is_base_of< bolt::amp::device_vector_tag, iTag >::value ||
+                                            std::is_base_of< bolt::amp::fancy_iterator_tag, iTag >::value >::type( ) );
+        }
+    }
+
+} //End of detail namespace
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename BinaryFunction >
+    void batched_inclusive_scan( control &ctl,
+                                 InputIterator first,
+                                 OffsetIterator offsets_first,
+                                 OffsetIterator offsets_last,
+                                 OutputIterator result,
+                                 BinaryFunction binary_op )
+    {
+        typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+        detail::batched_scan( ctl, first, offsets_first, offsets_last, result, oType( ), true, binary_op );
+    }
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename BinaryFunction >
+    void batched_inclusive_scan( InputIterator first,
+                                 OffsetIterator offsets_first,
+                                 OffsetIterator offsets_last,
+                                 OutputIterator result,
+                                 BinaryFunction binary_op )
+    {
+        typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+        detail::batched_scan( control::getDefault( ), first, offsets_first, offsets_last, result, oType( ), true,
+                              binary_op );
+    }
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+              typename BinaryFunction >
+    void batched_exclusive_scan( control &ctl,
+                                 InputIterator first,
+                                 OffsetIterator offsets_first,
+                                 OffsetIterator offsets_last,
+                                 OutputIterator result,
+                                 T init,
+                                 BinaryFunction binary_op )
+    {
+        detail::batched_scan( ctl, first, offsets_first, offsets_last, result, init, false, binary_op );
+    }
+
+    template< typename InputIterator, typename OffsetIterator, typename OutputIterator, typename T,
+              typename BinaryFunction >
+    void batched_exclusive_scan( InputIterator first,
+                                 OffsetIterator offsets_first,
+                                 OffsetIterator offsets_last,
+                                 OutputIterator result,
+                                 T init,
+                                 BinaryFunction binary_op )
+    {
+        detail::batched_scan( control::getDefault( ), first, offsets_first, offsets_last, result, init, false,
+                              binary_op );
+    }
+
+} //End of amp namespace
+} //End of bolt namespace
+
+#endif
@@ -0,0 +1,108 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_BATCHED_SEGMENTS_INL )
+#define BOLT_AMP_BATCHED_SEGMENTS_INL
+
+#include <algorithm>
+#include <vector>
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/device_vector.h"
+
+#ifdef ENABLE_TBB
+    #include "tbb/blocked_range.h"
+    #include "tbb/parallel_for.h"
+#endif
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    /*! The segments of a batch, given by offsets[ s ] to offsets[ s + 1 ], split into chunks of at most chunkSize
+     *  elements that each tile processes; the chunks of a segment are consecutive. Built on the host, since the
+     *  offsets are read to plan the launches.
+     */
+    struct batched_segments
+    {
+        template< typename OffsetIterator >
+        batched_segments( const OffsetIterator& offsets_first, const OffsetIterator& offsets_last, int chunkSize )
+            : offsets( offsets_first, offsets_last ), numSegments( 0 ), numElements( 0 ), maxSegment( 0 )
+        {
+            numSegments = offsets.size( ) > 1 ? static_cast< int >( offsets.size( ) ) - 1 : 0;
+            if( numSegments == 0 )
+                offsets.assign( 1, 0 );
+            numElements = offsets[ numSegments ] - offsets[ 0 ];
+            segmentChunk.resize( numSegments + 1 );
+            for( int s = 0; s < numSegments; ++s )
+            {
+                segmentChunk[ s ] = static_cast< int >( chunkStart.size( ) );
+                maxSegment = std::max( maxSegment, offsets[ s + 1 ] - offsets[ s ] );
+                for( int start = offsets[ s ]; start < offsets[ s + 1 ]; start += chunkSize )
+                {
+                    chunkStart.push_back( start );
+                    chunkSegment.push_back( s );
+                }
+            }
+            segmentChunk[ numSegments ] = static_cast< int >( chunkStart.size( ) );
+        }
+
+        int numChunks( ) const
+        {
+            return static_cast< int >( chunkStart.size( ) );
+        }
+
+        // offsets[ s ] is the first element of segment s, offsets[ numSegments ] the end of the last one
+        std::vector< int > offsets;
+        // first element and segment of each chunk
+        std::vector< int > chunkStart;
+        std::vector< int > chunkSegment;
+        // first chunk of each segment, segmentChunk[ numSegments ] is the number of chunks
+        std::vector< int > segmentChunk;
+        int numSegments;
+        int numElements;
+        int maxSegment;
+    };
+
+    // Calls f( s ) for each segment of the batch, on several cores with MultiCoreCpu
+    template< typename Function >
+    void batched_for_each_segment( bolt::amp::control::e_RunMode runMode, int numSegments, const Function& f )
+    {
+        if( runMode == bolt::amp::control::MultiCoreCpu )
+        {
+#if defined( ENABLE_TBB )
+            tbb::parallel_for( tbb::blocked_range< int >( 0, numSegments ), [&]( const tbb::blocked_range< int >& r )
+            {
+                for( int s = r.begin( ); s != r.end( ); ++s )
+                    f( s );
+            } );
+#else
+            throw std::runtime_error( "The MultiCoreCpu version of the batched algorithms is not enabled to be built! \n" );
+#endif
+        }
+        else
+        {
+            for( int s = 0; s < numSegments; ++s )
+                f( s );
+        }
+    }
+
+} //End of detail namespace
+} //End of amp namespace
+} //End of bolt namespace
+
+#endif
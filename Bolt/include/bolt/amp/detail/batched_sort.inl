@@ -0,0 +1,311 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_BATCHED_SORT_INL )
+#define BOLT_AMP_BATCHED_SORT_INL
+#define BATCHED_SORT_WAVEFRONT_SIZE 256
+// Number of elements a tile sorts in local memory, larger segments are merged across tiles
+#ifndef BATCHED_SORT_BLOCK_SIZE
+#define BATCHED_SORT_BLOCK_SIZE 2048
+#endif
+
+#include <iterator>
+#include <type_traits>
+#include "bolt/amp/iterator/iterator_traits.h"
+#include "bolt/amp/detail/batched_segments.inl"
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    // Merges the pairs of sorted runs of "width" elements of each segment from src to dst
+    template< typename T, typename StrictWeakOrdering >
+    void batched_sort_merge( concurrency::accelerator_view& av,
+                             const concurrency::array_view< T, 1 >& src,
+                             const concurrency::array_view< T, 1 >& dst,
+                             concurrency::array< int, 1 >& offsets,
+                             const batched_segments& segments,
+                             int width,
+                             const StrictWeakOrdering& comp )
+    {
+        const int numSegments = segments.numSegments;
+        const int firstElement = segments.offsets.front( );
+        const int szElements = segments.numElements;
+        const int leng = szElements + BATCHED_SORT_WAVEFRONT_SIZE - ( szElements % BATCHED_SORT_WAVEFRONT_SIZE );
+        concurrency::extent< 1 > inputExtent( leng );
+        concurrency::parallel_for_each( av, inputExtent, [ =, &offsets ]( concurrency::index< 1 > idx ) restrict(amp)
+        {
+            if( idx[ 0 ] >= szElements )
+                return;
+            int g = firstElement + idx[ 0 ];
+
+            // the segment of g, the last one starting at or before it
+            int lo = 0;
+            int hi = numSegments;
+            while( hi - lo > 1 )
+            {
+                int mid = ( lo + hi ) / 2;
+                if( offsets[ mid ] <= g )
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+            int segStart = offsets[ lo ];
+            int segEnd = offsets[ lo + 1 ];
+
+            int pairStart = segStart + ( ( g - segStart ) / ( 2 * width ) ) * 2 * width;
+            int middle = pairStart + width < segEnd ? pairStart + width : segEnd;
+            int pairEnd = pairStart + 2 * width < segEnd ? pairStart + 2 * width : segEnd;
+            T value = src[ g ];
+            int rank;
+            if( g < middle )
+            {
+                // the elements of the second run that are less than value come before it
+                int first = middle;
+                int last = pairEnd;
+                while( first < last )
+                {
+                    int mid = ( first + last ) / 2;
+                    if( comp( src[ mid ], value ) )
+                        first = mid + 1;
+                    else
+                        last = mid;
+                }
+                rank = ( g - pairStart ) + ( first - middle );
+            }
+            else
+            {
+                // the elements of the first run that are not greater than value come before it
+                int first = pairStart;
+                int last = middle;
+                while( first < last )
+                {
+                    int mid = ( first + last ) / 2;
+                    if( !comp( value, src[ mid ] ) )
+                        first = mid + 1;
+                    else
+                        last = mid;
+                }
+                rank = ( g - middle ) + ( first - pairStart );
+            }
+            dst[ pairStart + rank ] = value;
+        } );
+    }
+
+    template< typename T, typename StrictWeakOrdering >
+    void batched_sort_enqueue( bolt::amp::control &ctl,
+                               const concurrency::array_view< T, 1 >& data,
+                               const batched_segments& blocks,
+                               const StrictWeakOrdering& comp )
+    {
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+        const int numSegments = blocks.numSegments;
+        const int numBlocks = blocks.numChunks( );
+        if( numBlocks == 0 )
+            return;
+
+        concurrency::array< int, 1 > offsets( numSegments + 1, blocks.offsets.begin( ), blocks.offsets.end( ), av );
+        concurrency::array< int, 1 > blockStart( numBlocks, blocks.chunkStart.begin( ), blocks.chunkStart.end( ), av );
+        concurrency::array< int, 1 > blockSegment( numBlocks, blocks.chunkSegment.begin( ), blocks.chunkSegment.end( ), av );
+        concurrency::extent< 1 > blockExtent( numBlocks * BATCHED_SORT_WAVEFRONT_SIZE );
+
+        try
+        {
+            // bitonic sort of each block in local memory, padded to a power of two with elements greater than all
+            concurrency::parallel_for_each( av, blockExtent.tile< BATCHED_SORT_WAVEFRONT_SIZE >( ),
+                                            [ =, &offsets, &blockStart, &blockSegment ]
+                                            ( concurrency::tiled_index< BATCHED_SORT_WAVEFRONT_SIZE > t_idx ) restrict(amp)
+            {
+                tile_static T keys[ BATCHED_SORT_BLOCK_SIZE ];
+                tile_static int live[ BATCHED_SORT_BLOCK_SIZE ];
+                int block = t_idx.tile[ 0 ];
+                int tileIndex = t_idx.local[ 0 ];
+                int start = blockStart[ block ];
+                int length = offsets[ blockSegment[ block ] + 1 ] - start;
+                if( length > BATCHED_SORT_BLOCK_SIZE )
+                    length = BATCHED_SORT_BLOCK_SIZE;
+                int size = 2;
+                while( size < length )
+                    size <<= 1;
+
+                for( int i = tileIndex; i < size; i += BATCHED_SORT_WAVEFRONT_SIZE )
+                {
+                    live[ i ] = i < length;
+                    if( i < length )
+                        keys[ i ] = data[ start + i ];
+                }
+                t_idx.barrier.wait( );
+
+                for( int k = 2; k <= size; k <<= 1 )
+                {
+                    for( int j = k >> 1; j > 0; j >>= 1 )
+                    {
+                        for( int i = tileIndex; i < size; i += BATCHED_SORT_WAVEFRONT_SIZE )
+                        {
+                            int p = i ^ j;
+                            if( p > i )
+                            {
+                                // whether the element at i orders after the one at p and conversely, padding last
+                                bool iAfter = live[ i ] ? ( live[ p ] && comp( keys[ p ], keys[ i ] ) ) : live[ p ] != 0;
+                                bool pAfter = live[ p ] ? ( live[ i ] && comp( keys[ i ], keys[ p ] ) ) : live[ i ] != 0;
+                                if( ( i & k ) == 0 ? iAfter : pAfter )
+                                {
+                                    T key = keys[ i ];
+                                    keys[ i ] = keys[ p ];
+                                    keys[ p ] = key;
+                                    int l = live[ i ];
+                                    live[ i ] = live[ p ];
+                                    live[ p ] = l;
+                                }
+                            }
+                        }
+                        t_idx.barrier.wait( );
+                    }
+                }
+
+                for( int i = tileIndex; i < length; i += BATCHED_SORT_WAVEFRONT_SIZE )
+                    data[ start + i ] = keys[ i ];
+            } );
+
+            // merge of the sorted blocks of the larger segments, alternating between data and a temporary
+            if( blocks.maxSegment > BATCHED_SORT_BLOCK_SIZE )
+            {
+                concurrency::array< T, 1 > temp( data.get_extent( ), av );
+                concurrency::array_view< T, 1 > tempView( temp );
+                bool inData = true;
+                for( int width = BATCHED_SORT_BLOCK_SIZE; width < blocks.maxSegment; width *= 2 )
+                {
+                    if( inData )
+                        batched_sort_merge( av, data, tempView, offsets, blocks, width, comp );
+                    else
+                        batched_sort_merge( av, tempView, data, offsets, blocks, width, comp );
+                    inData = !inData;
+                }
+                if( !inData )
+                {
+                    const int firstElement = blocks.offsets.front( );
+                    tempView.section( firstElement, blocks.numElements ).copy_to( data.section( firstElement, blocks.numElements ) );
+                }
+            }
+        }
+        catch( std::exception &e )
+        {
+            std::cout << "Exception while calling bolt::amp::batched_sort parallel_for_each " << e.what( ) << std::endl;
+            throw;
+        }
+    }
+
+    template< typename DVRandomAccessIterator, typename StrictWeakOrdering >
+    void batched_sort_pick_iterator( bolt::amp::control &ctl,
+                                     const DVRandomAccessIterator& first,
+                                     const batched_segments& blocks,
+                                     const StrictWeakOrdering& comp,
+                                     bolt::amp::device_vector_tag )
+    {
+        batched_sort_enqueue( ctl, first.getContainer( ).getBuffer( first, blocks.offsets.back( ) ), blocks, comp );
+    }
+
+    template< typename RandomAccessIterator, typename StrictWeakOrdering >
+    void batched_sort_pick_iterator( bolt::amp::control &ctl,
+                                     const RandomAccessIterator& first,
+                                     const batched_segments& blocks,
+                                     const StrictWeakOrdering& comp,
+                                     std::random_access_iterator_tag )
+    {
+        typedef typename std::iterator_traits< RandomAccessIterator >::value_type T;
+        device_vector< T, concurrency::array_view > dvInput( first, blocks.offsets.back( ), false, ctl );
+        batched_sort_enqueue( ctl, dvInput.begin( ).getContainer( ).getBuffer( ), blocks, comp );
+        // This should immediately map/unmap the buffer
+        dvInput.data( );
+    }
+
+    template< typename RandomAccessIterator, typename StrictWeakOrdering >
+    void batched_sort_pick_iterator( bolt::amp::control &ctl,
+                                     const RandomAccessIterator& first,
+                                     const batched_segments& blocks,
+                                     const StrictWeakOrdering& comp,
+                                     bolt::amp::fancy_iterator_tag )
+    {
+        static_assert( std::is_same< RandomAccessIterator, bolt::amp::fancy_iterator_tag >::value,
+                       "It is not possible to sort fancy iterators. They are not mutable" );
+    }
+
+    template< typename RandomAccessIterator, typename OffsetIterator, typename StrictWeakOrdering >
+    void batched_sort( bolt::amp::control &ctl,
+                       const RandomAccessIterator& first,
+                       const OffsetIterator& offsets_first,
+                       const OffsetIterator& offsets_last,
+                       const StrictWeakOrdering& comp )
+    {
+        batched_segments blocks( offsets_first, offsets_last, BATCHED_SORT_BLOCK_SIZE );
+        if( blocks.numElements == 0 )
+            return;
+
+        bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode( );
+        if( runMode == bolt::amp::control::Automatic )
+        {
+            runMode = ctl.getDefaultPathToRun( );
+        }
+        if( runMode == bolt::amp::control::SerialCpu || runMode == bolt::amp::control::MultiCoreCpu )
+        {
+            batched_for_each_segment( runMode, blocks.numSegments, [&]( int s )
+            {
+                std::sort( first + blocks.offsets[ s ], first + blocks.offsets[ s + 1 ], comp );
+            } );
+        }
+        else
+        {
+            batched_sort_pick_iterator( ctl, first, blocks, comp,
+                                        typename std::iterator_traits< RandomAccessIterator >::iterator_category( ) );
+        }
+    }
+
+} //End of detail namespace
+
+    template< typename RandomAccessIterator, typename OffsetIterator, typename StrictWeakOrdering >
+    void batched_sort( control &ctl,
+                       RandomAccessIterator first,
+                       OffsetIterator offsets_first,
+                       OffsetIterator offsets_last,
+                       StrictWeakOrdering comp )
+    {
+        detail::batched_sort( ctl, first, offsets_first, offsets_last, comp );
+    }
+
+    template< typename RandomAccessIterator, typename OffsetIterator, typename StrictWeakOrdering >
+    void batched_sort( RandomAccessIterator first,
+                       OffsetIterator offsets_first,
+                       OffsetIterator offsets_last,
+                       StrictWeakOrdering comp )
+    {
+        detail::batched_sort( control::getDefault( ), first, offsets_first, offsets_last, comp );
+    }
+
+    template< typename RandomAccessIterator, typename OffsetIterator >
+    void batched_sort( RandomAccessIterator first,
+                       OffsetIterator offsets_first,
+                       OffsetIterator offsets_last )
+    {
+        typedef typename std::iterator_traits< RandomAccessIterator >::value_type T;
+        detail::batched_sort( control::getDefault( ), first, offsets_first, offsets_last, bolt::amp::less< T >( ) );
+    }
+
+} //End of amp namespace
+} //End of bolt namespace
+
+#endif
@@ -0,0 +1,443 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_BOUNDS_INL )
+#define BOLT_AMP_BOUNDS_INL
+#define BOUNDS_WAVEFRONT_SIZE 256
+// Number of elements of the sorted range sampled into local memory, the top levels of every search
+#ifndef BOUNDS_CACHE_SIZE
+#define BOUNDS_CACHE_SIZE 1024
+#endif
+
+#include <algorithm>
+#include <iterator>
+#include <numeric>
+#include <type_traits>
+#include "bolt/amp/copy.h"
+#include "bolt/amp/scatter.h"
+#include "bolt/amp/sort_by_key.h"
+#include "bolt/amp/iterator/iterator_traits.h"
+#if defined( ENABLE_TBB )
+    #include "tbb/blocked_range.h"
+    #include "tbb/parallel_for.h"
+#endif
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    /*****************************************************************************
+     * Bounds Enqueue
+     ****************************************************************************/
+
+    // Searches each value in the cache of samples of the range, then in the range between the samples around it.
+    // A value is after an element if comp( element, value ) for lower_bound, if !comp( value, element ) for upper_bound.
+    template< typename DVForwardIterator, typename DVInputIterator, typename DVOutputIterator, typename StrictWeakOrdering >
+    void bounds_search( concurrency::accelerator_view& av,
+                        const DVForwardIterator& first,
+                        int szElements,
+                        const DVInputIterator& values,
+                        int szValues,
+                        const DVOutputIterator& result,
+                        const StrictWeakOrdering& comp,
+                        bool upper )
+    {
+        typedef typename std::iterator_traits< DVForwardIterator >::value_type iType;
+        typedef typename std::iterator_traits< DVInputIterator >::value_type vType;
+
+        // the samples are the last elements of szCache equal steps of the range
+        const int szCache = std::min( szElements, BOUNDS_CACHE_SIZE );
+        const int step = szElements / szCache;
+        concurrency::array< iType, 1 > cache( szCache, av );
+
+        try
+        {
+            concurrency::extent< 1 > cacheExtent( szCache );
+            concurrency::parallel_for_each( av, cacheExtent, [ =, &cache ]( concurrency::index< 1 > idx ) restrict(amp)
+            {
+                cache[ idx ] = first[ ( idx[ 0 ] + 1 ) * step - 1 ];
+            } );
+
+            const int leng = szValues + BOUNDS_WAVEFRONT_SIZE - ( szValues % BOUNDS_WAVEFRONT_SIZE );
+            concurrency::extent< 1 > inputExtent( leng );
+            concurrency::parallel_for_each( av, inputExtent.tile< BOUNDS_WAVEFRONT_SIZE >( ), [ =, &cache ]
+                                            ( concurrency::tiled_index< BOUNDS_WAVEFRONT_SIZE > t_idx ) restrict(amp)
+            {
+                tile_static iType samples[ BOUNDS_CACHE_SIZE ];
+                for( int i = t_idx.local[ 0 ]; i < szCache; i += BOUNDS_WAVEFRONT_SIZE )
+                    samples[ i ] = cache[ i ];
+                t_idx.barrier.wait( );
+
+                int gx = t_idx.global[ 0 ];
+                if( gx >= szValues )
+                    return;
+                vType value = values[ gx ];
+
+                int low = 0;
+                int high = szCache;
+                while( low < high )
+                {
+                    int mid = ( low + high ) / 2;
+                    if( upper ? !comp( value, samples[ mid ] ) : comp( samples[ mid ], value ) )
+                        low = mid + 1;
+                    else
+                        high = mid;
+                }
+
+                // the value is after the sample before low, and not after the one at low
+                high = low < szCache ? ( low + 1 ) * step - 1 : szElements;
+                low = low * step;
+                while( low < high )
+                {
+                    int mid = ( low + high ) / 2;
+                    if( upper ? !comp( value, first[ mid ] ) : comp( first[ mid ], value ) )
+                        low = mid + 1;
+                    else
+                        high = mid;
+                }
+                result[ gx ] = low;
+            } );
+        }
+        catch( std::exception &e )
+        {
+            std::cout << "Exception while calling bolt::amp::" << ( upper ? "upper_bound" : "lower_bound" )
+                      << " parallel_for_each " << e.what( ) << std::endl;
+            throw;
+        }
+    }
+
+    template< typename DVForwardIterator, typename DVInputIterator, typename DVOutputIterator, typename StrictWeakOrdering >
+    void bounds_enqueue( bolt::amp::control &ctl,
+                         const DVForwardIterator& first,
+                         int szElements,
+                         const DVInputIterator& values,
+                         int szValues,
+                         const DVOutputIterator& result,
+                         const StrictWeakOrdering& comp,
+                         bool upper,
+                         bool sortValues )
+    {
+        typedef typename std::iterator_traits< DVInputIterator >::value_type vType;
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+
+        if( !sortValues )
+        {
+            bounds_search( av, first, szElements, values, szValues, result, comp, upper );
+            return;
+        }
+
+        // the values are searched in order, so that neighbouring work-items walk the same paths of the range,
+        // and the positions are scattered back to the order of the values
+        device_vector< vType > sortedValues( szValues, vType( ), false, ctl );
+        bolt::amp::copy( ctl, values, values + szValues, sortedValues.begin( ) );
+        std::vector< int > order( szValues );
+        std::iota( order.begin( ), order.end( ), 0 );
+        device_vector< int > dvOrder( order.begin( ), order.end( ), false, ctl );
+        bolt::amp::sort_by_key( ctl, sortedValues.begin( ), sortedValues.end( ), dvOrder.begin( ), comp );
+
+        device_vector< int > positions( szValues, 0, false, ctl );
+        bounds_search( av, first, szElements, sortedValues.begin( ), szValues, positions.begin( ), comp, upper );
+        bolt::amp::scatter( ctl, positions.begin( ), positions.end( ), dvOrder.begin( ), result );
+    }
+
+    /*****************************************************************************
+     * Pick Iterator
+     ****************************************************************************/
+
+    template< typename DVForwardIterator, typename DVInputIterator, typename DVOutputIterator, typename StrictWeakOrdering >
+    void bounds_pick_output( bolt::amp::control &ctl,
+                             const DVForwardIterator& first,
+                             int szElements,
+                             const DVInputIterator& values,
+                             int szValues,
+                             const DVOutputIterator& result,
+                             const StrictWeakOrdering& comp,
+                             bool upper,
+                             bool sortValues,
+                             bolt::amp::device_vector_tag )
+    {
+        bounds_enqueue( ctl, first, szElements, values, szValues, result, comp, upper, sortValues );
+    }
+
+    template< typename DVForwardIterator, typename DVInputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    void bounds_pick_output( bolt::amp::control &ctl,
+                             const DVForwardIterator& first,
+                             int szElements,
+                             const DVInputIterator& values,
+                             int szValues,
+                             const OutputIterator& result,
+                             const StrictWeakOrdering& comp,
+                             bool upper,
+                             bool sortValues,
+                             std::random_access_iterator_tag )
+    {
+        typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+        device_vector< oType, concurrency::array_view > dvResult( result, szValues, true, ctl );
+        bounds_enqueue( ctl, first, szElements, values, szValues, dvResult.begin( ), comp, upper, sortValues );
+        // This should immediately map/unmap the buffer
+        dvResult.data( );
+    }
+
+    // device_vector and fancy iterators are read in place
+    template< typename DVForwardIterator, typename DVInputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    void bounds_pick_values( bolt::amp::control &ctl,
+                             const DVForwardIterator& first,
+                             int szElements,
+                             const DVInputIterator& values,
+                             int szValues,
+                             const OutputIterator& result,
+                             const StrictWeakOrdering& comp,
+                             bool upper,
+                             bool sortValues,
+                             std::true_type )
+    {
+        bounds_pick_output( ctl, first, szElements, values, szValues, result, comp, upper, sortValues,
+                            typename std::iterator_traits< OutputIterator >::iterator_category( ) );
+    }
+
+    template< typename DVForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    void bounds_pick_values( bolt::amp::control &ctl,
+                             const DVForwardIterator& first,
+                             int szElements,
+                             const InputIterator& values,
+                             int szValues,
+                             const OutputIterator& result,
+                             const StrictWeakOrdering& comp,
+                             bool upper,
+                             bool sortValues,
+                             std::false_type )
+    {
+        typedef typename std::iterator_traits< InputIterator >::value_type vType;
+        device_vector< vType, concurrency::array_view > dvValues( values, szValues, false, ctl );
+        bounds_pick_output( ctl, first, szElements, dvValues.begin( ), szValues, result, comp, upper, sortValues,
+                            typename std::iterator_traits< OutputIterator >::iterator_category( ) );
+    }
+
+    template< typename DVForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    void bounds_pick_iterator( bolt::amp::control &ctl,
+                               const DVForwardIterator& first,
+                               int szElements,
+                               const InputIterator& values,
+                               int szValues,
+                               const OutputIterator& result,
+                               const StrictWeakOrdering& comp,
+                               bool upper,
+                               bool sortValues,
+                               std::true_type )
+    {
+        typedef typename std::iterator_traits< InputIterator >::iterator_category vTag;
+        bounds_pick_values( ctl, first, szElements, values, szValues, result, comp, upper, sortValues,
+                            typename std::integral_constant< bool,
+                                std::is_base_of< bolt::amp::device_vector_tag, vTag >::value ||
+                                std::is_base_of< bolt::amp::fancy_iterator_tag, vTag >::value >::type( ) );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    void bounds_pick_iterator( bolt::amp::control &ctl,
+                               const ForwardIterator& first,
+                               int szElements,
+                               const InputIterator& values,
+                               int szValues,
+                               const OutputIterator& result,
+                               const StrictWeakOrdering& comp,
+                               bool upper,
+                               bool sortValues,
+                               std::false_type )
+    {
+        typedef typename std::iterator_traits< ForwardIterator >::value_type iType;
+        typedef typename std::iterator_traits< InputIterator >::iterator_category vTag;
+        // Use host pointers memory since the range is only read - no benefit to copying.
+        device_vector< iType, concurrency::array_view > dvRange( first, szElements, false, ctl );
+        bounds_pick_values( ctl, dvRange.begin( ), szElements, values, szValues, result, comp, upper, sortValues,
+                            typename std::integral_constant< bool,
+                                std::is_base_of< bolt::amp::device_vector_tag, vTag >::value ||
+                                std::is_base_of< bolt::amp::fancy_iterator_tag, vTag >::value >::type( ) );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    OutputIterator bounds( bolt::amp::control &ctl,
+                           const ForwardIterator& first,
+                           const ForwardIterator& last,
+                           const InputIterator& values_first,
+                           const InputIterator& values_last,
+                           const OutputIterator& result,
+                           const StrictWeakOrdering& comp,
+                           bool upper,
+                           bool sortValues )
+    {
+        typedef typename std::iterator_traits< ForwardIterator >::iterator_category iTag;
+        const int szElements = static_cast< int >( std::distance( first, last ) );
+        const int szValues = static_cast< int >( std::distance( values_first, values_last ) );
+        if( szValues == 0 )
+            return result;
+        if( szElements == 0 )
+        {
+            for( int i = 0; i < szValues; i++ )
+                *( result + i ) = 0;
+            return result + szValues;
+        }
+
+        bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode( ); // could be dynamic choice some day.
+        if( runMode == bolt::amp::control::Automatic )
+        {
+            runMode = ctl.getDefaultPathToRun( );
+        }
+
+        if( runMode == bolt::amp::control::SerialCpu || runMode == bolt::amp::control::MultiCoreCpu )
+        {
+            auto search = [&]( int i )
+            {
+                *( result + i ) = static_cast< int >( upper ? std::upper_bound( first, last, *( values_first + i ), comp ) - first
+                                                            : std::lower_bound( first, last, *( values_first + i ), comp ) - first );
+            };
+            if( runMode == bolt::amp::control::SerialCpu )
+            {
+                for( int i = 0; i < szValues; i++ )
+                    search( i );
+            }
+            else
+            {
+                #if defined( ENABLE_TBB )
+                    tbb::parallel_for( tbb::blocked_range< int >( 0, szValues ), [&]( const tbb::blocked_range< int >& r )
+                    {
+                        for( int i = r.begin( ); i != r.end( ); ++i )
+                            search( i );
+                    } );
+                #else
+                    throw std::runtime_error( "MultiCoreCPU Version of lower_bound and upper_bound not Enabled! \n" );
+                #endif
+            }
+        }
+        else
+        {
+            bounds_pick_iterator( ctl, first, szElements, values_first, szValues, result, comp, upper, sortValues,
+                                  typename std::integral_constant< bool,
+                                      std::is_base_of< bolt::amp::device_vector_tag, iTag >::value ||
+                                      std::is_base_of< bolt::amp::fancy_iterator_tag, iTag >::value >::type( ) );
+        }
+        return result + szValues;
+    }
+
+} //End of detail namespace
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator >
+    OutputIterator lower_bound( bolt::amp::control &ctl,
+                                ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result )
+    {
+        typedef typename std::iterator_traits< ForwardIterator >::value_type iType;
+        return detail::bounds( ctl, first, last, values_first, values_last, result, bolt::amp::less< iType >( ),
+                               false, false );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator >
+    OutputIterator lower_bound( ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result )
+    {
+        typedef typename std::iterator_traits< ForwardIterator >::value_type iType;
+        return detail::bounds( bolt::amp::control::getDefault( ), first, last, values_first, values_last, result,
+                               bolt::amp::less< iType >( ), false, false );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    OutputIterator lower_bound( bolt::amp::control &ctl,
+                                ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result,
+                                StrictWeakOrdering comp,
+                                bool sort_values )
+    {
+        return detail::bounds( ctl, first, last, values_first, values_last, result, comp, false, sort_values );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    OutputIterator lower_bound( ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result,
+                                StrictWeakOrdering comp,
+                                bool sort_values )
+    {
+        return detail::bounds( bolt::amp::control::getDefault( ), first, last, values_first, values_last, result,
+                               comp, false, sort_values );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator >
+    OutputIterator upper_bound( bolt::amp::control &ctl,
+                                ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result )
+    {
+        typedef typename std::iterator_traits< ForwardIterator >::value_type iType;
+        return detail::bounds( ctl, first, last, values_first, values_last, result, bolt::amp::less< iType >( ),
+                               true, false );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator >
+    OutputIterator upper_bound( ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result )
+    {
+        typedef typename std::iterator_traits< ForwardIterator >::value_type iType;
+        return detail::bounds( bolt::amp::control::getDefault( ), first, last, values_first, values_last, result,
+                               bolt::amp::less< iType >( ), true, false );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    OutputIterator upper_bound( bolt::amp::control &ctl,
+                                ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result,
+                                StrictWeakOrdering comp,
+                                bool sort_values )
+    {
+        return detail::bounds( ctl, first, last, values_first, values_last, result, comp, true, sort_values );
+    }
+
+    template< typename ForwardIterator, typename InputIterator, typename OutputIterator, typename StrictWeakOrdering >
+    OutputIterator upper_bound( ForwardIterator first,
+                                ForwardIterator last,
+                                InputIterator values_first,
+                                InputIterator values_last,
+                                OutputIterator result,
+                                StrictWeakOrdering comp,
+                                bool sort_values )
+    {
+        return detail::bounds( bolt::amp::control::getDefault( ), first, last, values_first, values_last, result,
+                               comp, true, sort_values );
+    }
+
+} //End of amp namespace
+} //End of bolt namespace
+
+#endif
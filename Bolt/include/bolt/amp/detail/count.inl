@@ -26,6 +26,7 @@
 #include "bolt/amp/functional.h"
 #include "bolt/amp/device_vector.h"
 #include "bolt/amp/iterator/iterator_traits.h"
+#include "bolt/amp/wait.h"
 #ifdef ENABLE_TBB
 //TBB Includes
 #include "bolt/btbb/count.h"
@@ -54,6 +55,7 @@ namespace bolt {
             {
 				typedef typename std::iterator_traits< DVInputIterator >::value_type iType;				
 				const int szElements = static_cast< int >(std::distance(first, last));
+				scoped_wait_mode wait( ctl, "count", szElements );
 
 				int max_ComputeUnits = 32;
 				int numTiles = max_ComputeUnits*32;	/* Max no. of WG for Tahiti(32 compute Units) and 32 is the tuning factor that gives good performance*/
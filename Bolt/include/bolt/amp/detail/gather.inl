@@ -1075,6 +1075,31 @@ void gather( InputIterator1 map_first,
 }
 
 
+////////////////////////////////////////////////////////////////////
+// Gather with a permutation plan APIs
+////////////////////////////////////////////////////////////////////
+template< typename InputIterator,
+          typename OutputIterator >
+void gather( bolt::amp::control& ctl,
+             const permutation_plan& plan,
+             InputIterator input,
+             OutputIterator result )
+{
+    if( plan.getKind( ) != permutation_plan::Gather )
+        throw std::runtime_error( "bolt::amp::gather requires a permutation_plan of kind Gather \n" );
+    detail::permute( ctl, plan, input, result );
+}
+
+template< typename InputIterator,
+          typename OutputIterator >
+void gather( const permutation_plan& plan,
+             InputIterator input,
+             OutputIterator result )
+{
+    gather( control::getDefault( ), plan, input, result );
+}
+
+
 ////////////////////////////////////////////////////////////////////
 // GatherIf APIs
 ////////////////////////////////////////////////////////////////////
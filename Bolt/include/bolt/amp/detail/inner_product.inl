@@ -17,8 +17,7 @@
 
 /*
 TODO:
-1. Optimize the code. In this version transform and reduce are called directly which performs better.
-2. Found a caveat in Multi-GPU scenario (Evergreen+Tahiti). Which basically applies to most of the routines.
+1. Found a caveat in Multi-GPU scenario (Evergreen+Tahiti). Which basically applies to most of the routines.
 */
 
 #if !defined( BOLT_AMP_INNERPRODUCT_INL )
@@ -31,8 +30,11 @@ TODO:
 #include <type_traits>
 #include <bolt/amp/detail/reduce.inl>
 #include <bolt/amp/detail/transform.inl>
+#include <bolt/amp/detail/tile_reduce.inl>
+#include "bolt/amp/pool_alloc.h"
 #include "bolt/amp/device_vector.h"
 #include "bolt/amp/bolt.h"
+#include "bolt/amp/wait.h"
 
 //TBB Includes
 #ifdef ENABLE_TBB
@@ -83,12 +85,54 @@ namespace detail {
 
                 if( distVec == 0 )
                     return init;
+                scoped_wait_mode wait( ctl, "inner_product", distVec );
+
+                concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+
+                int max_ComputeUnits = 32;
+                int numTiles = max_ComputeUnits*ctl.getWGPerComputeUnit();
+                int length = (REDUCE_WAVEFRONT_SIZE*numTiles);
+                length = distVec < length ? distVec : length;
+                unsigned int residual = length % REDUCE_WAVEFRONT_SIZE;
+                length = residual ? (length + REDUCE_WAVEFRONT_SIZE - residual): length ;
+                numTiles = length / REDUCE_WAVEFRONT_SIZE;
+
+                // the products are reduced as they are computed, and the partials of the tiles on the device
+                bolt::PooledArray< OutputType > partialsPool( av, numTiles );
+                concurrency::array< OutputType, 1 >& partials = partialsPool.array();
+                unsigned int noneDone = 0;
+                concurrency::array< unsigned int, 1 > done( 1, &noneDone, av );
+                concurrency::array< OutputType, 1 > result( 1, av );
+                concurrency::extent< 1 > inputExtent( length );
+
+                concurrency::parallel_for_each( av, inputExtent.tile< REDUCE_WAVEFRONT_SIZE >(),
+                    [ first1, first2, distVec, length, numTiles, init, f1, f2, &partials, &done, &result ]
+                    ( concurrency::tiled_index< REDUCE_WAVEFRONT_SIZE > t_idx ) restrict(amp)
+                {
+                    int gx = t_idx.global[ 0 ];
+                    tile_static OutputType scratch[ REDUCE_WAVEFRONT_SIZE ];
+                    tile_static unsigned int isLast;
 
-                device_vector< iType> tempDV( distVec, iType(), false, ctl);
+                    OutputType accumulator;
+                    if( gx < distVec )
+                    {
+                        accumulator = f2( first1[ gx ], first2[ gx ] );
+                        gx += length;
+                    }
+                    while( gx < distVec )
+                    {
+                        accumulator = f1( accumulator, f2( first1[ gx ], first2[ gx ] ) );
+                        gx += length;
+                    }
 
-                detail::transform_enqueue( ctl, first1, last1, first2, tempDV.begin() ,f2);
-                return detail::reduce_enqueue( ctl, tempDV.begin(), tempDV.end(), init, f1);
+                    int tail = distVec - ( t_idx.tile[ 0 ] * REDUCE_WAVEFRONT_SIZE );
+                    tile_reduce_and_finish< REDUCE_WAVEFRONT_SIZE >( t_idx.barrier, t_idx.local[ 0 ], t_idx.tile[ 0 ],
+                        scratch, isLast, accumulator, tail, init, f1, numTiles, partials, done, result );
+                } );
 
+                OutputType acc;
+                concurrency::copy( result, &acc );
+                return acc;
             };
 
 
@@ -28,19 +28,19 @@ namespace bolt
     {
         //Empty
         template <typename T1, typename T2>
-        pair<T1,T2>::pair(void):first(),second()
+        pair<T1,T2>::pair(void) restrict(cpu,amp):first(),second()
         {
         } // end pair::pair()
 
         template <typename T1, typename T2>
-        pair<T1,T2>::pair(const T1 &x, const T2 &y):first(x),second(y)
+        pair<T1,T2>::pair(const T1 &x, const T2 &y) restrict(cpu,amp):first(x),second(y)
         {
         } // end pair::pair()
 
 
         template <typename T1, typename T2>
         template <typename U1, typename U2>
-        pair<T1,T2>::pair(const pair<U1,U2> &p):first(p.first),second(p.second)
+        pair<T1,T2>::pair(const pair<U1,U2> &p) restrict(cpu,amp):first(p.first),second(p.second)
         {
         } // end pair::pair()
 
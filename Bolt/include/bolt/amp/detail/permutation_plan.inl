@@ -0,0 +1,195 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_PERMUTATION_PLAN_INL )
+#define BOLT_AMP_PERMUTATION_PLAN_INL
+#define PERMUTATION_PLAN_WAVEFRNT_SIZE 64
+
+#include <type_traits>
+#include "bolt/amp/iterator/iterator_traits.h"
+
+#ifdef ENABLE_TBB
+    #include "tbb/blocked_range.h"
+    #include "tbb/parallel_for.h"
+#endif
+
+namespace bolt {
+namespace amp {
+
+namespace detail {
+
+////////////////////////////////////////////////////////////////////
+// Permute enqueue
+////////////////////////////////////////////////////////////////////
+
+    // result[ destination[ k ] ] = input[ source[ k ] ] for each pair k of the plan, in plan order
+    template< typename DVInputIterator,
+              typename DVOutputIterator >
+    void permute_enqueue( bolt::amp::control &ctl,
+                          const permutation_plan& plan,
+                          const DVInputIterator& input,
+                          const DVOutputIterator& result )
+    {
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+        const int szElements = plan.getSize( );
+        const unsigned int leng = szElements + PERMUTATION_PLAN_WAVEFRNT_SIZE - (szElements % PERMUTATION_PLAN_WAVEFRNT_SIZE);
+        concurrency::extent< 1 > inputExtent(leng);
+        concurrency::array< int, 1 >& sources = plan.getDeviceSources( );
+        concurrency::array< int, 1 >& destinations = plan.getDeviceDestinations( );
+        try
+        {
+            concurrency::parallel_for_each(av, inputExtent, [=, &sources, &destinations](concurrency::index<1> idx) restrict(amp)
+            {
+                int globalId = idx[ 0 ];
+
+                if( globalId >= szElements)
+                    return;
+                result[ destinations[ globalId ] ] = input[ sources[ globalId ] ];
+            });
+        }
+        catch(std::exception &e)
+        {
+            std::cout << "Exception while calling bolt::amp::permutation_plan parallel_for_each"<<e.what()<<std::endl;
+            return;
+        }
+    };
+
+////////////////////////////////////////////////////////////////////
+// Permute pick iterator
+////////////////////////////////////////////////////////////////////
+
+    // Both on the device, or a fancy input
+    template< typename DVInputIterator,
+              typename DVOutputIterator >
+    void permute_pick_iterator( bolt::amp::control &ctl,
+                                const permutation_plan& plan,
+                                const DVInputIterator& input,
+                                const DVOutputIterator& result,
+                                std::true_type,
+                                std::true_type )
+    {
+        permute_enqueue( ctl, plan, input, result );
+    };
+
+    // Host input
+    template< typename InputIterator,
+              typename DVOutputIterator >
+    void permute_pick_iterator( bolt::amp::control &ctl,
+                                const permutation_plan& plan,
+                                const InputIterator& input,
+                                const DVOutputIterator& result,
+                                std::false_type,
+                                std::true_type )
+    {
+        typedef typename std::iterator_traits<InputIterator>::value_type iType;
+        device_vector< iType, concurrency::array_view> dvInput( input, plan.getSourceExtent( ), false, ctl );
+        permute_enqueue( ctl, plan, dvInput.begin( ), result );
+    };
+
+    // Host result, whose elements not in the plan are kept
+    template< typename DVInputIterator,
+              typename OutputIterator >
+    void permute_pick_iterator( bolt::amp::control &ctl,
+                                const permutation_plan& plan,
+                                const DVInputIterator& input,
+                                const OutputIterator& result,
+                                std::true_type,
+                                std::false_type )
+    {
+        typedef typename std::iterator_traits<OutputIterator>::value_type oType;
+        device_vector< oType, concurrency::array_view> dvResult( result, plan.getDestinationExtent( ), false, ctl );
+        permute_enqueue( ctl, plan, input, dvResult.begin( ) );
+        // This should immediately map/unmap the buffer
+        dvResult.data( );
+    };
+
+    template< typename InputIterator,
+              typename OutputIterator >
+    void permute_pick_iterator( bolt::amp::control &ctl,
+                                const permutation_plan& plan,
+                                const InputIterator& input,
+                                const OutputIterator& result,
+                                std::false_type,
+                                std::false_type )
+    {
+        typedef typename std::iterator_traits<InputIterator>::value_type iType;
+        typedef typename std::iterator_traits<OutputIterator>::value_type oType;
+        device_vector< iType, concurrency::array_view> dvInput( input, plan.getSourceExtent( ), false, ctl );
+        device_vector< oType, concurrency::array_view> dvResult( result, plan.getDestinationExtent( ), false, ctl );
+        permute_enqueue( ctl, plan, dvInput.begin( ), dvResult.begin( ) );
+        // This should immediately map/unmap the buffer
+        dvResult.data( );
+    };
+
+    // result[ destination[ k ] ] = input[ source[ k ] ] for each pair k of the plan
+    template< typename InputIterator,
+              typename OutputIterator >
+    void permute( bolt::amp::control &ctl,
+                  const permutation_plan& plan,
+                  const InputIterator& input,
+                  const OutputIterator& result )
+    {
+        typedef typename std::iterator_traits<InputIterator>::iterator_category iTag;
+        typedef typename std::iterator_traits<OutputIterator>::iterator_category oTag;
+        const int sz = plan.getSize( );
+        if( sz == 0 )
+            return;
+
+        bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode();  // could be dynamic choice some day.
+        if(runMode == bolt::amp::control::Automatic)
+        {
+             runMode = ctl.getDefaultPathToRun();
+        }
+        if( runMode == bolt::amp::control::SerialCpu )
+        {
+            const std::vector< int >& sources = plan.getSources( );
+            const std::vector< int >& destinations = plan.getDestinations( );
+            for( int iter = 0; iter < sz; iter++ )
+                result[ destinations[ iter ] ] = input[ sources[ iter ] ];
+        }
+        else if( runMode == bolt::amp::control::MultiCoreCpu )
+        {
+#if defined( ENABLE_TBB )
+            const std::vector< int >& sources = plan.getSources( );
+            const std::vector< int >& destinations = plan.getDestinations( );
+            tbb::parallel_for( tbb::blocked_range< int >( 0, sz ), [&]( const tbb::blocked_range< int >& r )
+            {
+                for( int iter = r.begin( ); iter != r.end( ); iter++ )
+                    result[ destinations[ iter ] ] = input[ sources[ iter ] ];
+            } );
+#else
+            throw std::runtime_error( "The MultiCoreCpu version of permutation_plan is not enabled to be built! \n" );
+#endif
+        }
+        else
+        {
+            // device_vector and fancy iterators are read in place, other iterators are copied
+            permute_pick_iterator( ctl, plan, input, result,
+                                   typename std::integral_constant< bool,
+                                       std::is_base_of< bolt::amp::device_vector_tag, iTag >::value ||
+                                       std::is_base_of< bolt::amp::fancy_iterator_tag, iTag >::value >::type( ),
+                                   typename std::is_base_of< bolt::amp::device_vector_tag, oTag >::type( ) );
+        }
+    };
+
+} //End of detail namespace
+
+} //End of amp namespace
+} //End of bolt namespace
+
+#endif
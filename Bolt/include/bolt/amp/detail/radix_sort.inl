@@ -0,0 +1,364 @@
+/***************************************************************************
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+/***************************************************************************
+* LSD radix sort of 32-bit integer keys, shared by sort and sort_by_key. Keys
+* are sorted by 8-bit digits, with one kernel counting the digits of all the
+* passes up front, and one kernel per pass which ranks the keys of each tile
+* by the digit in tile_static memory and scatters them, in the manner of
+* Onesweep:
+*  "Onesweep: A Faster Least Significant Digit Radix Sort for GPUs"
+*     Andy Adinets and Duane Merrill
+*    https://arxiv.org/abs/2206.01784
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_RADIX_SORT_INL )
+#define BOLT_AMP_RADIX_SORT_INL
+
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#include <amp.h>
+#include "bolt/amp/pool_alloc.h"
+
+// bits of the digit each pass sorts by
+#define BOLT_RADIX_BITS         8
+#define BOLT_RADIX_BUCKETS      (1<<BOLT_RADIX_BITS)
+// work-items of a tile, one per bucket
+#define BOLT_RADIX_WG_SIZE      BOLT_RADIX_BUCKETS
+// keys each work-item of a pass ranks
+#define BOLT_RADIX_ITEMS        8
+#define BOLT_RADIX_TILE         (BOLT_RADIX_WG_SIZE*BOLT_RADIX_ITEMS)
+#define BOLT_RADIX_PASSES       (32/BOLT_RADIX_BITS)
+// states of the count of a bucket of a tile, in the upper 2 bits of its status word, the lower bits
+// hold the count of the keys of the tile in the bucket, or the count of all the tiles up to it
+#define BOLT_RADIX_AGGREGATE    1u
+#define BOLT_RADIX_PREFIX       2u
+#define BOLT_RADIX_COUNT_BITS   30
+#define BOLT_RADIX_COUNT_MASK   ((1u<<BOLT_RADIX_COUNT_BITS)-1)
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    // Exclusive prefix sum of val across the work-items of a tile, totalSum gets the sum of all of them.
+    static unsigned int radixScanTile( unsigned int val, unsigned int &totalSum, unsigned int* lmem,
+                                       concurrency::tiled_index< BOLT_RADIX_WG_SIZE > t_idx ) restrict(amp)
+    {
+        int lIdx = t_idx.local[ 0 ];
+        lmem[lIdx] = val;
+        t_idx.barrier.wait();
+        for (int offset = 1; offset < BOLT_RADIX_WG_SIZE; offset *= 2)
+        {
+            unsigned int other = (lIdx >= offset) ? lmem[lIdx - offset] : 0;
+            t_idx.barrier.wait();
+            lmem[lIdx] += other;
+            t_idx.barrier.wait();
+        }
+        unsigned int inclusive = lmem[lIdx];
+        totalSum = lmem[BOLT_RADIX_WG_SIZE - 1];
+        t_idx.barrier.wait();
+        return inclusive - val;
+    }
+
+    // Encode the keys into dvKeys, copy the values into dvValues, and count the keys of each bucket of every
+    // pass into histogram, BOLT_RADIX_PASSES rows of BOLT_RADIX_BUCKETS counts which are 0.
+    template<bool HasValues, typename DVKeys, typename DVValues, typename Values>
+    void radix_sort_histogram( bolt::amp::control &ctl, const DVKeys &keys_first, const DVValues &values_first,
+                               concurrency::array_view< unsigned int > dvKeys,
+                               concurrency::array_view< Values > dvValues,
+                               concurrency::array_view< unsigned int > histogram,
+                               int szElements, unsigned int flip )
+    {
+        int numTiles = (szElements + BOLT_RADIX_WG_SIZE - 1)/BOLT_RADIX_WG_SIZE;
+        numTiles = std::min( numTiles, 32*ctl.getWGPerComputeUnit() ); // 32 is no of compute units for Tahiti
+        const int length = numTiles*BOLT_RADIX_WG_SIZE;
+
+        concurrency::extent< 1 > inputExtent( length );
+        concurrency::tiled_extent< BOLT_RADIX_WG_SIZE > tileK0 = inputExtent.tile< BOLT_RADIX_WG_SIZE >();
+        concurrency::parallel_for_each( ctl.getAccelerator().get_default_view(), tileK0,
+                [
+                    keys_first,
+                    values_first,
+                    dvKeys,
+                    dvValues,
+                    histogram,
+                    szElements,
+                    length,
+                    flip
+                ] ( concurrency::tiled_index< BOLT_RADIX_WG_SIZE > t_idx ) restrict(amp)
+        {
+            tile_static unsigned int lmem[BOLT_RADIX_PASSES*BOLT_RADIX_BUCKETS];
+            int lIdx = t_idx.local[ 0 ];
+            for (int i = lIdx; i < BOLT_RADIX_PASSES*BOLT_RADIX_BUCKETS; i += BOLT_RADIX_WG_SIZE)
+                lmem[i] = 0;
+            t_idx.barrier.wait();
+
+            for (int gIdx = t_idx.global[ 0 ]; gIdx < szElements; gIdx += length)
+            {
+                unsigned int key = static_cast< unsigned int >( keys_first[gIdx] ) ^ flip;
+                dvKeys[gIdx] = key;
+                if (HasValues)
+                    dvValues[gIdx] = values_first[gIdx];
+                for (int p = 0; p < BOLT_RADIX_PASSES; p++)
+                    concurrency::atomic_fetch_add( &lmem[p*BOLT_RADIX_BUCKETS + ((key >> (p*BOLT_RADIX_BITS)) & (BOLT_RADIX_BUCKETS - 1))], 1u );
+            }
+            t_idx.barrier.wait();
+
+            for (int i = lIdx; i < BOLT_RADIX_PASSES*BOLT_RADIX_BUCKETS; i += BOLT_RADIX_WG_SIZE)
+            {
+                if (lmem[i] != 0)
+                    concurrency::atomic_fetch_add( &histogram[i], lmem[i] );
+            }
+        });
+    }
+
+    // One pass of the radix sort, by the digit at shift, in a single kernel whose tiles get their id in the
+    // order they start. A tile sorts its keys by the digit in tile_static memory with stable 1-bit splits,
+    // and keeps where each key came from to move its value. The work-item of each bucket then publishes the
+    // count of the tile in its status word, and walks back the status words of the bucket of the tiles before
+    // it until one has the count of all the tiles up to it, so each key goes to the offset of its bucket, plus
+    // the keys of the bucket in the tiles before, plus its rank in the tile. status holds numTiles rows of
+    // BOLT_RADIX_BUCKETS words, then the counter of the tile ids, which are all 0.
+    template<bool HasValues, typename OutKey, typename KeysOut, typename ValuesIn, typename ValuesOut>
+    void radix_sort_pass( bolt::amp::control &ctl, concurrency::array_view< unsigned int > keysIn,
+                          const ValuesIn &valuesIn, const KeysOut &keysOut, const ValuesOut &valuesOut,
+                          concurrency::array_view< unsigned int > offsets,
+                          concurrency::array_view< unsigned int > status,
+                          int szElements, int shift, unsigned int flip )
+    {
+        const int numTiles = (szElements + BOLT_RADIX_TILE - 1)/BOLT_RADIX_TILE;
+
+        concurrency::extent< 1 > inputExtent( numTiles*BOLT_RADIX_WG_SIZE );
+        concurrency::tiled_extent< BOLT_RADIX_WG_SIZE > tileK0 = inputExtent.tile< BOLT_RADIX_WG_SIZE >();
+        concurrency::parallel_for_each( ctl.getAccelerator().get_default_view(), tileK0,
+                [
+                    keysIn,
+                    valuesIn,
+                    keysOut,
+                    valuesOut,
+                    offsets,
+                    status,
+                    szElements,
+                    numTiles,
+                    shift,
+                    flip
+                ] ( concurrency::tiled_index< BOLT_RADIX_WG_SIZE > t_idx ) restrict(amp)
+        {
+            tile_static unsigned int ldsKeys[BOLT_RADIX_TILE];
+            tile_static unsigned int ldsFrom[BOLT_RADIX_TILE];
+            tile_static unsigned int ldsScan[BOLT_RADIX_WG_SIZE];
+            tile_static unsigned int ldsCount[BOLT_RADIX_BUCKETS];
+            tile_static unsigned int ldsOffset[BOLT_RADIX_BUCKETS];
+            tile_static int ldsTileId;
+            int lIdx = t_idx.local[ 0 ];
+
+            if (lIdx == 0)
+                ldsTileId = static_cast< int >( concurrency::atomic_fetch_add( &status[numTiles*BOLT_RADIX_BUCKETS], 1u ) );
+            ldsCount[lIdx] = 0;
+            t_idx.barrier.wait();
+            const int tileId = ldsTileId;
+            const int base = tileId*BOLT_RADIX_TILE;
+            const int valid = (szElements - base < BOLT_RADIX_TILE) ? szElements - base : BOLT_RADIX_TILE;
+
+            // keys past the end sort after all the others, and aren't stored
+            for (int k = 0; k < BOLT_RADIX_ITEMS; k++)
+            {
+                int i = k*BOLT_RADIX_WG_SIZE + lIdx;
+                ldsKeys[i] = (i < valid) ? keysIn[base + i] : 0xffffffff;
+            }
+            t_idx.barrier.wait();
+
+            unsigned int keys[BOLT_RADIX_ITEMS];
+            unsigned int from[BOLT_RADIX_ITEMS];
+            for (int k = 0; k < BOLT_RADIX_ITEMS; k++)
+            {
+                int i = lIdx*BOLT_RADIX_ITEMS + k;
+                keys[k] = ldsKeys[i];
+                from[k] = i;
+                if (i < valid)
+                    concurrency::atomic_fetch_add( &ldsCount[(keys[k] >> shift) & (BOLT_RADIX_BUCKETS - 1)], 1u );
+            }
+
+            for (int bit = shift; bit < shift + BOLT_RADIX_BITS; bit++)
+            {
+                unsigned int zeros = 0;
+                for (int k = 0; k < BOLT_RADIX_ITEMS; k++)
+                    zeros += ((keys[k] >> bit) & 1) ? 0 : 1;
+                unsigned int totalZeros;
+                unsigned int zerosBefore = radixScanTile( zeros, totalZeros, ldsScan, t_idx );
+                for (int k = 0; k < BOLT_RADIX_ITEMS; k++)
+                {
+                    unsigned int i = lIdx*BOLT_RADIX_ITEMS + k;
+                    unsigned int pos = ((keys[k] >> bit) & 1) ? totalZeros + (i - zerosBefore) : zerosBefore++;
+                    ldsKeys[pos] = keys[k];
+                    ldsFrom[pos] = from[k];
+                }
+                t_idx.barrier.wait();
+                for (int k = 0; k < BOLT_RADIX_ITEMS; k++)
+                {
+                    int i = lIdx*BOLT_RADIX_ITEMS + k;
+                    keys[k] = ldsKeys[i];
+                    from[k] = ldsFrom[i];
+                }
+            }
+
+            // decoupled look-back of the bucket of the work-item
+            unsigned int count = ldsCount[lIdx];
+            unsigned int total;
+            unsigned int localStart = radixScanTile( count, total, ldsScan, t_idx );
+            unsigned int index = tileId*BOLT_RADIX_BUCKETS + lIdx;
+            unsigned int exclusive = 0;
+            if (tileId == 0)
+            {
+                concurrency::atomic_exchange( &status[index], (BOLT_RADIX_PREFIX << BOLT_RADIX_COUNT_BITS) | count );
+            }
+            else
+            {
+                concurrency::atomic_exchange( &status[index], (BOLT_RADIX_AGGREGATE << BOLT_RADIX_COUNT_BITS) | count );
+                int j = tileId - 1;
+                while (true)
+                {
+                    unsigned int word = concurrency::atomic_fetch_add( &status[j*BOLT_RADIX_BUCKETS + lIdx], 0u );
+                    unsigned int state = word >> BOLT_RADIX_COUNT_BITS;
+                    if (state == 0)
+                        continue;
+                    exclusive += word & BOLT_RADIX_COUNT_MASK;
+                    if (state == BOLT_RADIX_PREFIX)
+                        break;
+                    j--;
+                }
+                concurrency::atomic_exchange( &status[index], (BOLT_RADIX_PREFIX << BOLT_RADIX_COUNT_BITS) | (exclusive + count) );
+            }
+            ldsOffset[lIdx] = offsets[lIdx] + exclusive - localStart;
+            t_idx.barrier.wait();
+
+            for (int k = 0; k < BOLT_RADIX_ITEMS; k++)
+            {
+                int i = k*BOLT_RADIX_WG_SIZE + lIdx;
+                if (i < valid)
+                {
+                    unsigned int key = ldsKeys[i];
+                    unsigned int dst = ldsOffset[(key >> shift) & (BOLT_RADIX_BUCKETS - 1)] + i;
+                    keysOut[dst] = static_cast< OutKey >( key ^ flip );
+                    if (HasValues)
+                        valuesOut[dst] = valuesIn[base + ldsFrom[i]];
+                }
+            }
+        });
+    }
+
+    // type of the values sorted along with the keys, a placeholder when there are none
+    template<bool HasValues, typename DVValues>
+    struct radix_sort_values
+    {
+        typedef typename std::iterator_traits< DVValues >::value_type type;
+    };
+
+    template<typename DVValues>
+    struct radix_sort_values< false, DVValues >
+    {
+        typedef int type;
+    };
+
+    /*! LSD radix sort of the szElements int or unsigned int keys from keys_first, and of the values from
+     *  values_first along with them when HasValues, ascending when comp orders 2 before 3 and descending
+     *  otherwise. Signed keys have their sign bit flipped, and descending keys all their bits, so they are
+     *  sorted as unsigned integers. The passes of the digits which all the keys share are skipped. The sort
+     *  is stable. szElements must be less than 2^30.
+     */
+    template<bool HasValues, typename DVKeys, typename DVValues, typename StrictWeakOrdering>
+    void radix_sort_enqueue( bolt::amp::control &ctl, const DVKeys &keys_first, const DVKeys &keys_last,
+                             const DVValues &values_first, const StrictWeakOrdering &comp )
+    {
+        typedef typename std::iterator_traits< DVKeys >::value_type Keys;
+        typedef typename radix_sort_values< HasValues, DVValues >::type Values;
+
+        const int szElements = static_cast< int >( std::distance( keys_first, keys_last ) );
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+
+        unsigned int flip = std::is_signed< Keys >::value ? 0x80000000 : 0;
+        if (!comp(2,3))
+            flip = ~flip;
+
+        bolt::PooledArray< unsigned int > keysA( av, szElements ), keysB( av, szElements );
+        bolt::PooledArray< Values > valuesA( av, HasValues ? szElements : 1 ), valuesB( av, HasValues ? szElements : 1 );
+        concurrency::array_view< unsigned int > dvKeysA( keysA.array() ), dvKeysB( keysB.array() );
+        concurrency::array_view< Values > dvValuesA( valuesA.array() ), dvValuesB( valuesB.array() );
+
+        std::vector< unsigned int > counts( BOLT_RADIX_PASSES*BOLT_RADIX_BUCKETS, 0 );
+        concurrency::array_view< unsigned int > histogram( static_cast< int >( counts.size() ), counts );
+        radix_sort_histogram< HasValues >( ctl, keys_first, values_first, dvKeysA, dvValuesA, histogram,
+                                           szElements, flip );
+        histogram.synchronize();
+
+        // offsets of the buckets of the passes which reorder the keys
+        std::vector< int > shifts;
+        std::vector< unsigned int > o;
+        for (int p = 0; p < BOLT_RADIX_PASSES; p++)
+        {
+            const unsigned int *count = counts.data() + p*BOLT_RADIX_BUCKETS;
+            if (std::find( count, count + BOLT_RADIX_BUCKETS, static_cast< unsigned int >( szElements ) ) != count + BOLT_RADIX_BUCKETS)
+                continue;
+            shifts.push_back( p*BOLT_RADIX_BITS );
+            unsigned int sum = 0;
+            for (int b = 0; b < BOLT_RADIX_BUCKETS; b++)
+            {
+                o.push_back( sum );
+                sum += count[b];
+            }
+        }
+        if (shifts.empty())
+            return;
+
+        const int numTiles = (szElements + BOLT_RADIX_TILE - 1)/BOLT_RADIX_TILE;
+        bolt::PooledArray< unsigned int > statusArray( av, numTiles*BOLT_RADIX_BUCKETS + 1 );
+        concurrency::array_view< unsigned int > status( statusArray.array() );
+        for (size_t p = 0; p < shifts.size(); p++)
+        {
+            concurrency::parallel_for_each( av, status.get_extent(), [ status ]
+                    ( concurrency::index< 1 > idx ) restrict(amp)
+            {
+                status[idx] = 0;
+            });
+            concurrency::array_view< unsigned int > offsets( BOLT_RADIX_BUCKETS, o.data() + p*BOLT_RADIX_BUCKETS );
+            if (p + 1 < shifts.size())
+            {
+                radix_sort_pass< HasValues, unsigned int >( ctl, dvKeysA, dvValuesA, dvKeysB, dvValuesB, offsets, status,
+                                                            szElements, shifts[p], 0 );
+                std::swap( dvKeysA, dvKeysB );
+                std::swap( dvValuesA, dvValuesB );
+            }
+            else
+            {
+                radix_sort_pass< HasValues, Keys >( ctl, dvKeysA, dvValuesA, keys_first, values_first, offsets, status,
+                                                    szElements, shifts[p], flip );
+            }
+        }
+        dvKeysA.discard_data();
+        dvKeysB.discard_data();
+        dvValuesA.discard_data();
+        dvValuesB.discard_data();
+        status.discard_data();
+    }
+
+}
+}
+}
+
+#endif
@@ -46,6 +46,8 @@ if ((_IDX < _W) && ((_IDX + _W) < _LENGTH)) {\
 #include <algorithm>
 #include <type_traits>
 #include "bolt/amp/bolt.h"
+#include "bolt/amp/autotune.h"
+#include "bolt/amp/wait.h"
 #include "bolt/amp/device_vector.h"
 #include "bolt/amp/iterator/iterator_traits.h"
 #include "bolt/amp/functional.h"
@@ -70,9 +72,10 @@ namespace bolt
                 typedef typename std::iterator_traits< DVInputIterator >::value_type iType;
 
                 const int szElements = static_cast< int >( std::distance( first, last ) );
+                scoped_wait_mode wait( ctl, "reduce", szElements );
 
 				int max_ComputeUnits = 32;
-				int numTiles = max_ComputeUnits*32;			/* Max no. of WG for Tahiti(32 compute Units) and 32 is the tuning factor that gives good performance*/
+				int numTiles = max_ComputeUnits*ctl.getWGPerComputeUnit();	/* Max no. of WG for Tahiti(32 compute Units) */
 				int length = (REDUCE_WAVEFRONT_SIZE*numTiles);	
 				length = szElements < length ? szElements : length;
 				unsigned int residual = length % REDUCE_WAVEFRONT_SIZE;
@@ -187,13 +190,19 @@ namespace bolt
                 int szElements = static_cast< int >(last - first);
                 if (szElements == 0)
                     return init;
-                /*TODO - probably the forceRunMode should be replaced by getRunMode and setRunMode*/
-                // Its a dynamic choice. See the reduce Test Code
-                // What should we do if the run mode is automatic. Currently it goes to the last else statement
                 //How many threads we should spawn?
                 //Need to look at how to control the number of threads spawned.
 
 
+                // with Automatic the run mode and the work shape are tuned
+                if (ctl.getForceRunMode() == bolt::amp::control::Automatic)
+                {
+                    return autotune(ctl, "reduce", typeid(iType), szElements, true,
+                                    [&](bolt::amp::control& tuned) {
+                                        return reduce_pick_iterator(tuned, first, last, init, binary_op, std::random_access_iterator_tag());
+                                    });
+                }
+
                 bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode();
                 if (runMode == bolt::amp::control::Automatic)
                 {
@@ -236,7 +245,16 @@ namespace bolt
                 if (szElements == 0)
                     return init;
 
-                 bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode();
+                // with Automatic the run mode and the work shape are tuned
+                if (ctl.getForceRunMode() == bolt::amp::control::Automatic)
+                {
+                    return autotune(ctl, "reduce", typeid(iType), szElements, true,
+                                    [&](bolt::amp::control& tuned) {
+                                        return reduce_pick_iterator(tuned, first, last, init, binary_op, bolt::amp::device_vector_tag());
+                                    });
+                }
+
+                bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode();
                 if (runMode == bolt::amp::control::Automatic)
                 {
                     runMode = ctl.getDefaultPathToRun();
@@ -280,13 +298,19 @@ namespace bolt
                 int szElements = static_cast< int >(last - first);
                 if (szElements == 0)
                     return init;
-                /*TODO - probably the forceRunMode should be replaced by getRunMode and setRunMode*/
-                // Its a dynamic choice. See the reduce Test Code
-                // What should we do if the run mode is automatic. Currently it goes to the last else statement
                 //How many threads we should spawn?
                 //Need to look at how to control the number of threads spawned.
 
 
+                // with Automatic the run mode and the work shape are tuned
+                if (ctl.getForceRunMode() == bolt::amp::control::Automatic)
+                {
+                    return autotune(ctl, "reduce", typeid(iType), szElements, true,
+                                    [&](bolt::amp::control& tuned) {
+                                        return reduce_pick_iterator(tuned, first, last, init, binary_op, bolt::amp::fancy_iterator_tag());
+                                    });
+                }
+
                 bolt::amp::control::e_RunMode runMode = ctl.getForceRunMode();
                 if (runMode == bolt::amp::control::Automatic)
                 {
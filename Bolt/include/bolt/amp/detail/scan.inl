@@ -65,6 +65,7 @@
 #include <type_traits>
 #include "bolt/amp/bolt.h"
 #include "bolt/amp/device_vector.h"
+#include "bolt/amp/pool_alloc.h"
 #include "bolt/amp/iterator/iterator_traits.h"
 #include <amp.h>
 #include "bolt/amp/functional.h"
@@ -157,9 +158,11 @@ unsigned int k0_stepNum, k1_stepNum, k2_stepNum;
 	#endif
     }
 
-    concurrency::array< iType >  preSumArray( sizeScanBuff, av );
+    bolt::PooledArray< iType >  preSum( av, sizeScanBuff );
+    concurrency::array< iType > &preSumArray = preSum.array();
     #ifdef _WIN32
-    concurrency::array< iType >  preSumArray1( sizeScanBuff, av );
+    bolt::PooledArray< iType >  preSum1( av, sizeScanBuff );
+    concurrency::array< iType > &preSumArray1 = preSum1.array();
     #endif
 
     /**********************************************************************************
@@ -17,11 +17,8 @@
 #if !defined( BOLT_AMP_SCAN_BY_KEY_INL )
 #define BOLT_AMP_SCAN_BY_KEY_INL
 
-#define SCANBYKEY_KERNELWAVES 4
-#define SCANBYKEY_WAVESIZE 64
-#define SCANBYKEY_TILE_MAX 65535
-
 #include "bolt/amp/iterator/iterator_traits.h"
+#include "bolt/amp/detail/segmented_scan.inl"
 #ifdef ENABLE_TBB
 //TBB Includes
 #include "bolt/btbb/scan_by_key.h"
@@ -172,471 +169,10 @@ scan_by_key_enqueue(
     const std::string& user_code,
     const bool& inclusive )
 {
-    concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
-
-    /**********************************************************************************
-     * Type Names - used in KernelTemplateSpecializer
-     *********************************************************************************/
-    typedef typename std::iterator_traits< DVInputIterator1 >::value_type kType;
-    typedef typename std::iterator_traits< DVInputIterator2 >::value_type vType;
-  	typedef typename std::iterator_traits< DVOutputIterator >::value_type oType;
-
-    int exclusive = inclusive ? 0 : 1;
-
     int numElements = static_cast< int >( std::distance( firstKey, lastKey ) );
-    const unsigned int kernel0_WgSize = SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES;
-    const unsigned int kernel1_WgSize = SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES;
-    const unsigned int kernel2_WgSize = SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES;
-
-    //  Ceiling function to bump the size of input to the next whole wavefront size
-    unsigned int sizeInputBuff = numElements;
-    unsigned int modWgSize = (sizeInputBuff & ((kernel0_WgSize*2)-1));
-    if( modWgSize )
-    {
-        sizeInputBuff &= ~modWgSize;
-        sizeInputBuff += (kernel0_WgSize*2);
-    }
-    int numWorkGroupsK0 = static_cast< int >( sizeInputBuff / (kernel0_WgSize*2) );
-    //  Ceiling function to bump the size of the sum array to the next whole wavefront size
-    unsigned int sizeScanBuff = numWorkGroupsK0;
-    modWgSize = (sizeScanBuff & ((kernel0_WgSize*2)-1));
-    if( modWgSize )
-    {
-        sizeScanBuff &= ~modWgSize;
-        sizeScanBuff += (kernel0_WgSize*2);
-    }
-
-  	concurrency::array< kType >  keySumArray( sizeScanBuff, av );
-    concurrency::array< vType >  preSumArray( sizeScanBuff, av );
-    concurrency::array< vType >  preSumArray1( sizeScanBuff, av );
-
-
-    /**********************************************************************************
-     *  Kernel 0
-     *********************************************************************************/
-  //	Loop to calculate the inclusive scan of each individual tile, and output the block sums of every tile
-  //	This loop is inherently parallel; every tile is independant with potentially many wavefronts
-
-	const unsigned int tile_limit = SCANBYKEY_TILE_MAX;
-	const unsigned int max_ext = (tile_limit*kernel0_WgSize);
-	unsigned int	   tempBuffsize = (sizeInputBuff/2); 
-	unsigned int	   iteration = (tempBuffsize-1)/max_ext; 
-
-    for(unsigned int i=0; i<=iteration; i++)
-	{
-	    unsigned int extent_sz =  (tempBuffsize > max_ext) ? max_ext : tempBuffsize; 
-		concurrency::extent< 1 > inputExtent( extent_sz );
-		concurrency::tiled_extent< kernel0_WgSize > tileK0 = inputExtent.tile< kernel0_WgSize >();
-		unsigned int index = i*(tile_limit*kernel0_WgSize);
-		unsigned int tile_index = i*tile_limit;
-
-			concurrency::parallel_for_each( av, tileK0,
-			[
-				firstKey,
-				firstValue,
-				init,
-				numElements,
-				&keySumArray,
-				&preSumArray,
-				&preSumArray1,
-		      	binary_pred,
-				exclusive,
-				index,
-				tile_index,
-		      	binary_funct,
-				kernel0_WgSize
-			] ( concurrency::tiled_index< kernel0_WgSize > t_idx ) restrict(amp)
-			  {
-
-				int gloId = t_idx.global[ 0 ] + index;
-				unsigned int groId = t_idx.tile[ 0 ] + tile_index;
-				unsigned int locId = t_idx.local[ 0 ];
-				int wgSize = kernel0_WgSize;
-
-				tile_static vType ldsVals[ SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES*2 ];
-				tile_static kType ldsKeys[ SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES*2 ];
-   				wgSize *=2;
-
-  				unsigned int  offset = 1;
-				// load input into shared memory
-				int input_offset = (groId*wgSize)+locId;
-
-				if (exclusive)
-				{
-				   if (gloId > 0 && input_offset < numElements)
-				   {
-					  kType key1 = firstKey[ input_offset ];
-					  kType key2 = firstKey[ input_offset-1 ];
-					  if( binary_pred( key1, key2 )  )
-					  {
-						 ldsVals[locId] = firstValue[ input_offset ];
-					  }
-					  else 
-					  {
-						 vType start_val = firstValue[ input_offset ]; 
-						 ldsVals[locId] = binary_funct(init, start_val);
-					  }
-					  ldsKeys[locId] = firstKey[ input_offset ];
-				   }
-				   else{ 
-					  vType start_val = firstValue[0];
-					  ldsVals[locId] = binary_funct(init, start_val);
-					  ldsKeys[locId] = firstKey[0];
-				   }
-				   if(input_offset + (wgSize/2) < numElements)
-				   {
-					  kType key1 = firstKey[ input_offset + (wgSize/2)];
-					  kType key2 = firstKey[ input_offset + (wgSize/2) -1];
-					  if( binary_pred( key1, key2 )  )
-					  {
-						 ldsVals[locId+(wgSize/2)] = firstValue[ input_offset + (wgSize/2)];
-					  }
-					  else 
-					  {
-						 vType start_val = firstValue[ input_offset + (wgSize/2)]; 
-						 ldsVals[locId+(wgSize/2)] = binary_funct(init, start_val);
-					  } 
-					  ldsKeys[locId+(wgSize/2)] = firstKey[ input_offset + (wgSize/2)];
-				   }
-				}
-				else
-				{
-				   if(input_offset < numElements)
-				   {
-					   ldsVals[locId] = firstValue[input_offset];
-					   ldsKeys[locId] = firstKey[input_offset];
-				   }
-				   if(input_offset + (wgSize/2) < numElements)
-				   {
-					   ldsVals[locId+(wgSize/2)] = firstValue[ input_offset + (wgSize/2)];
-					   ldsKeys[locId+(wgSize/2)] = firstKey[ input_offset + (wgSize/2)];
-				   }
-				}
-				for (unsigned int start = wgSize>>1; start > 0; start >>= 1) 
-				{
-				   t_idx.barrier.wait();
-				   if (locId < start)
-				   {
-					  unsigned int temp1 = offset*(2*locId+1)-1;
-					  unsigned int temp2 = offset*(2*locId+2)-1;
-       
-					  kType key = ldsKeys[temp2]; 
-					  kType key1 = ldsKeys[temp1];
-					  if(binary_pred( key, key1 )) 
-					  {
-						 oType y = ldsVals[temp2];
-						 oType y1 =ldsVals[temp1];
-						 ldsVals[temp2] = binary_funct(y, y1);
-					  }
-
-				   }
-				   offset *= 2;
-				}
-				t_idx.barrier.wait();
-				if (locId == 0)
-				{
-					keySumArray[ groId ] = ldsKeys[ wgSize-1 ];
-					preSumArray[ groId ] = ldsVals[wgSize -1];
-					preSumArray1[ groId ] = ldsVals[wgSize/2 -1];
-				}
-
-		 } );
-	     tempBuffsize = tempBuffsize - max_ext;
-	}
-
-	PEEK_AT( output )
-
-   /**********************************************************************************
-     *  Kernel 1
-     *********************************************************************************/
-    int workPerThread = static_cast< int >( sizeScanBuff / kernel1_WgSize );
-    workPerThread = workPerThread ? workPerThread : 1;
-
-	concurrency::extent< 1 > globalSizeK1( kernel1_WgSize );
-    concurrency::tiled_extent< kernel1_WgSize > tileK1 = globalSizeK1.tile< kernel1_WgSize >();
-
-    //std::cout << "Kernel 1 Launching w/" << sizeScanBuff << " threads for " << numWorkGroupsK0 << " elements. " << std::endl;
-    concurrency::parallel_for_each( av, tileK1,
-        [
-	      	&keySumArray, 
-            &preSumArray,
-            numWorkGroupsK0,
-            workPerThread,
-	        binary_pred,
-		    numElements,
-            binary_funct,
-		    kernel1_WgSize
-        ] ( concurrency::tiled_index< kernel1_WgSize > t_idx ) restrict(amp)
-  {
-
-	unsigned int gloId = t_idx.global[ 0 ];
-    unsigned int groId = t_idx.tile[ 0 ];
-    int locId = t_idx.local[ 0 ];
-    int wgSize = kernel1_WgSize;
-    int mapId  = gloId * workPerThread;
-
-    tile_static kType ldsKeys[ SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES];
-	tile_static vType ldsVals[ SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES ];
-
-	// do offset of zero manually
-    int offset;
-    kType key;
-    vType workSum;
-    if (mapId < numWorkGroupsK0)
-    {
-        kType prevKey;
-
-        // accumulate zeroth value manually
-        offset = 0;
-        key = keySumArray[ mapId+offset ];
-        workSum = preSumArray[ mapId+offset ];
-        //  Serial accumulation
-        for( offset = offset+1; offset < workPerThread; offset += 1 )
-        {
-            prevKey = key;
-            key = keySumArray[ mapId+offset ];
-            if (mapId+offset<numWorkGroupsK0 )
-            {
-                vType y = preSumArray[ mapId+offset ];
-                if ( binary_pred(key, prevKey ) )
-                {
-                    workSum = binary_funct( workSum, y );
-                }
-                else
-                {
-                    workSum = y;
-                }
-                preSumArray[ mapId+offset ] = workSum;
-            }
-        }
-    }
-    t_idx.barrier.wait();
-    vType scanSum = workSum;
-    offset = 1;
-    // load LDS with register sums
-    ldsVals[ locId ] = workSum;
-    ldsKeys[ locId ] = key;
-    // scan in lds
-
-    for( offset = offset*1; offset < wgSize; offset *= 2 )
-    {
-        t_idx.barrier.wait();
-        if (mapId < numWorkGroupsK0)
-        {
-            if (locId >= offset  )
-            {
-                vType y = ldsVals[ locId - offset ];
-                kType key1 = ldsKeys[ locId ];
-                kType key2 = ldsKeys[ locId-offset ];
-                if ( binary_pred( key1, key2 ) )
-                {
-                    scanSum = binary_funct( scanSum, y );
-                }
-                else
-                    scanSum = ldsVals[ locId ];
-            }
-      
-        }
-        t_idx.barrier.wait();
-        ldsVals[ locId ] = scanSum;
-    } // for offset
-    t_idx.barrier.wait();
 
-    // write final scan from pre-scan and lds scan
-    for( offset = 0; offset < workPerThread; offset += 1 )
-    {
-        t_idx.barrier.wait_with_global_memory_fence();
-
-        if (mapId+offset < numWorkGroupsK0 && locId > 0)
-        {
-            vType y = preSumArray[ mapId+offset ];
-            kType key1 = keySumArray[ mapId+offset ]; // change me
-            kType key2 = ldsKeys[ locId-1 ];
-            if ( binary_pred( key1, key2 ) )
-            {
-                vType y2 = ldsVals[locId-1];
-                y = binary_funct( y, y2 );
-            }
-            preSumArray[ mapId+offset ] = y;
-        } // thread in bounds
-    } // for 
-
-  });
-
-   PEEK_AT( postSumArray )
-
- /**********************************************************************************
-     *  Kernel 2
- *********************************************************************************/
- 	tempBuffsize = (sizeInputBuff); 
-	iteration = (tempBuffsize-1)/max_ext; 
-
-    for(unsigned int a=0; a<=iteration ; a++)
-	{
-	    unsigned int extent_sz =  (tempBuffsize > max_ext) ? max_ext : tempBuffsize; 
-		concurrency::extent< 1 > inputExtent( extent_sz );
-		concurrency::tiled_extent< kernel2_WgSize > tileK2 = inputExtent.tile< kernel2_WgSize >();
-		unsigned int index = a*(tile_limit*kernel2_WgSize);
-		unsigned int tile_index = a*tile_limit;
-
-			concurrency::parallel_for_each( av, tileK2,
-				[
-	      			firstKey,
-					firstValue,
-					result,
-					&preSumArray,
-					&preSumArray1,
-					binary_pred,
-					exclusive,
-					index,
-					tile_index,
-					numElements,
-					init,
-					binary_funct,
-					kernel2_WgSize
-				] ( concurrency::tiled_index< kernel2_WgSize > t_idx ) restrict(amp)
-		  {
-
-			int gloId = t_idx.global[ 0 ] + index;
-			unsigned int groId = t_idx.tile[ 0 ] + tile_index;
-			unsigned int locId = t_idx.local[ 0 ];
-			unsigned int wgSize = kernel2_WgSize;
-
-			tile_static kType ldsKeys[ SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES ];
-			tile_static vType ldsVals[ SCANBYKEY_WAVESIZE*SCANBYKEY_KERNELWAVES ];
-	
-				 // if exclusive, load gloId=0 w/ init, and all others shifted-1
-			kType key;
-			oType val;
-			if (gloId < numElements){
-			   if (exclusive)
-			   {
-				  if (gloId > 0)
-				  { // thread>0
-					  key = firstKey[ gloId];
-					  kType key1 = firstKey[ gloId];
-					  kType key2 = firstKey[ gloId-1];
-					  if( binary_pred( key1, key2 )  )
-						  val = firstValue[ gloId-1 ];
-					  else 
-						  val = init;
-					  ldsKeys[ locId ] = key;
-					  ldsVals[ locId ] = val;
-				  }
-				  else
-				  { // thread=0
-					  val = init;
-					  ldsVals[ locId ] = val;
-					  ldsKeys[ locId ] = firstKey[gloId];
-					// key stays null, this thread should never try to compare it's key
-					// nor should any thread compare it's key to ldsKey[ 0 ]
-					// I could put another key into lds just for whatevs
-					// for now ignore this
-				  }
-			   }
-			   else
-			   {
-				  key = firstKey[ gloId ];
-				  val = firstValue[ gloId ];
-				  ldsKeys[ locId ] = key;
-				  ldsVals[ locId ] = val;
-			   }
-			 }
-	
-			 // Each work item writes out its calculated scan result, relative to the beginning
-			// of each work group
-			vType scanResult = ldsVals[ locId ];
-			vType postBlockSum, newResult;
-			vType y, y1, sum;
-			kType key1, key2, key3, key4;
-	
-			if(locId == 0 && gloId < numElements)
-			{
-				if(groId > 0)
-				{
-				   key1 = firstKey[gloId];
-				   key2 = firstKey[groId*wgSize -1 ];
-
-				   if(groId % 2 == 0)
-				   {
-					  postBlockSum = preSumArray[ groId/2 -1 ];
-				   }
-				   else if(groId == 1)
-				   {
-					  postBlockSum = preSumArray1[0];
-				   }
-				   else
-				   {
-					  key3 = firstKey[groId*wgSize -1 ];
-					  key4 = firstKey[(groId-1)*wgSize -1];
-					  if(binary_pred(key3 ,key4))
-					  {
-						 y = preSumArray[ groId/2 -1 ];
-						 y1 = preSumArray1[groId/2];
-						 postBlockSum = binary_funct(y, y1);
-					  }
-					  else
-					  {
-						 postBlockSum = preSumArray1[groId/2];
-					  }
-				   }
-				   if (!exclusive)
-				   {
-					  if(binary_pred( key1, key2))
-					  {
-						 newResult = binary_funct( scanResult, postBlockSum );
-					  }
-					  else
-					  {
-						 newResult = scanResult;
-					  }
-				   }
-				   else
-				   {
-					  if(binary_pred( key1, key2)) 
-						 newResult = postBlockSum;
-					  else
-						 newResult = init;  
-				   }
-				}
-				else
-				{
-					 newResult = scanResult;
-				}
-				ldsVals[ locId ] = newResult;
-			}
-			
-			// Computes a scan within a workgroup
-			// updates vals in lds but not keys
-			sum = ldsVals[ locId ];
-			for( unsigned int offset = 1; offset < wgSize; offset *= 2 )
-			{
-				t_idx.barrier.wait();
-				if (locId >= offset )
-				{
-					kType key2 = ldsKeys[ locId - offset];
-					if( binary_pred( key, key2 )  )
-					{
-						oType y = ldsVals[ locId - offset];
-						sum = binary_funct( sum, y );
-					}
-					else
-						sum = ldsVals[ locId];
-					
-				}
-				t_idx.barrier.wait();
-				ldsVals[ locId ] = sum;
-			}
-			 t_idx.barrier.wait(); // needed for large data types
-			//  Abort threads that are passed the end of the input vector
-			if (gloId >= numElements) return; 
-			result[ gloId ] = sum;
-	
-	
-		  } );
-		  tempBuffsize = tempBuffsize - max_ext;
-	}
-    PEEK_AT( output )
+    segmented_scan_enqueue< false >( ctl, firstKey, numElements, firstValue, firstKey, result, init, binary_pred,
+                                     binary_funct, inclusive );
 }   //end of scan_by_key_enqueue( )
 
 
@@ -1111,6 +1111,31 @@ void scatter( InputIterator1 first1,
 }
 
 
+////////////////////////////////////////////////////////////////////
+// Scatter with a permutation plan APIs
+////////////////////////////////////////////////////////////////////
+template< typename InputIterator,
+          typename OutputIterator >
+void scatter( bolt::amp::control& ctl,
+              const permutation_plan& plan,
+              InputIterator input,
+              OutputIterator result )
+{
+    if( plan.getKind( ) != permutation_plan::Scatter )
+        throw std::runtime_error( "bolt::amp::scatter requires a permutation_plan of kind Scatter \n" );
+    detail::permute( ctl, plan, input, result );
+}
+
+template< typename InputIterator,
+          typename OutputIterator >
+void scatter( const permutation_plan& plan,
+             InputIterator input,
+             OutputIterator result )
+{
+    scatter( control::getDefault( ), plan, input, result );
+}
+
+
 ////////////////////////////////////////////////////////////////////
 // ScatterIf APIs
 ////////////////////////////////////////////////////////////////////
@@ -0,0 +1,382 @@
+/***************************************************************************
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+/***************************************************************************
+* Single-pass segmented scan shared by scan_by_key and reduce_by_key. Each
+* tile reads its keys and values once, scans them in tile_static memory, and
+* gets the carry of the segment it starts in from the tiles before it by
+* decoupled look-back:
+*  "Single-pass Parallel Prefix Scan with Decoupled Look-back"
+*     Duane Merrill and Michael Garland
+*    https://research.nvidia.com/publication/single-pass-parallel-prefix-scan-decoupled-look-back
+* scan_by_key writes the scan of every element, reduce_by_key writes the last
+* scanned value of each segment straight to its compacted position, which the
+* tiles count alongside the carries.
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_SEGMENTED_SCAN_INL )
+#define BOLT_AMP_SEGMENTED_SCAN_INL
+
+#include <algorithm>
+#include <amp.h>
+#include "bolt/amp/pool_alloc.h"
+
+#define BOLT_SEGSCAN_WG_SIZE    256
+// consecutive elements scanned by each work-item
+#define BOLT_SEGSCAN_ITEMS      4
+#define BOLT_SEGSCAN_TILE       (BOLT_SEGSCAN_WG_SIZE*BOLT_SEGSCAN_ITEMS)
+// tiles of a launch, the remaining ones are scanned by the next launches
+#define BOLT_SEGSCAN_TILE_LIMIT 65535
+// status of a tile: its aggregate or its inclusive prefix is published, and whether it starts a segment
+#define BOLT_SEGSCAN_AGGREGATE  1u
+#define BOLT_SEGSCAN_PREFIX     2u
+#define BOLT_SEGSCAN_HEAD       4u
+
+namespace bolt {
+namespace amp {
+namespace detail {
+
+    // Writes the key of a segment, only reduce_by_key has keys to write.
+    template< bool Reduce >
+    struct segmented_scan_keys
+    {
+        template< typename DVOutputIterator, typename kType >
+        static void store( const DVOutputIterator& keys_output, unsigned int index, const kType& key ) restrict(amp)
+        {
+            keys_output[ index ] = key;
+        }
+    };
+
+    template< >
+    struct segmented_scan_keys< false >
+    {
+        template< typename DVOutputIterator, typename kType >
+        static void store( const DVOutputIterator&, unsigned int, const kType& ) restrict(amp)
+        {
+        }
+    };
+
+    /*! Segmented scan of numElements values, the segments being the runs of keys for which binary_pred holds
+     * between consecutive keys. With Reduce, the last scanned value and key of each segment are written to
+     * values_output and keys_output at the index of the segment, and the number of segments is returned.
+     * Otherwise the inclusive or exclusive scan of every value is written to values_output, init starting
+     * each segment of an exclusive scan, and keys_output is unused.
+     */
+    template<
+        bool Reduce,
+        typename DVInputIterator1,
+        typename DVInputIterator2,
+        typename DVOutputIterator1,
+        typename DVOutputIterator2,
+        typename T,
+        typename BinaryPredicate,
+        typename BinaryFunction >
+    unsigned int segmented_scan_enqueue( control& ctl,
+                                         const DVInputIterator1& keys_first,
+                                         int numElements,
+                                         const DVInputIterator2& values_first,
+                                         const DVOutputIterator1& keys_output,
+                                         const DVOutputIterator2& values_output,
+                                         const T& init,
+                                         const BinaryPredicate& binary_pred,
+                                         const BinaryFunction& binary_funct,
+                                         bool inclusive )
+    {
+        typedef typename std::iterator_traits< DVInputIterator1 >::value_type kType;
+        typedef typename std::iterator_traits< DVOutputIterator2 >::value_type oType;
+
+        concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+
+        const int numTiles = ( numElements + BOLT_SEGSCAN_TILE - 1 ) / BOLT_SEGSCAN_TILE;
+
+        // status of every tile, and the next tile to scan
+        bolt::PooledArray< unsigned int > statusPool( av, numTiles + 1 );
+        concurrency::array< unsigned int >& status = statusPool.array();
+        bolt::PooledArray< oType > aggValsPool( av, numTiles );
+        concurrency::array< oType >& aggVals = aggValsPool.array();
+        bolt::PooledArray< oType > prefValsPool( av, numTiles );
+        concurrency::array< oType >& prefVals = prefValsPool.array();
+        bolt::PooledArray< unsigned int > aggHeadsPool( av, numTiles );
+        concurrency::array< unsigned int >& aggHeads = aggHeadsPool.array();
+        bolt::PooledArray< unsigned int > prefHeadsPool( av, numTiles );
+        concurrency::array< unsigned int >& prefHeads = prefHeadsPool.array();
+
+        concurrency::parallel_for_each( av, concurrency::extent< 1 >( numTiles + 1 ),
+            [ &status ]( concurrency::index< 1 > idx ) restrict(amp)
+        {
+            status[ idx ] = 0;
+        } );
+
+        for( int launched = 0; launched < numTiles; launched += BOLT_SEGSCAN_TILE_LIMIT )
+        {
+            int launchTiles = std::min( numTiles - launched, BOLT_SEGSCAN_TILE_LIMIT );
+            concurrency::extent< 1 > launchExtent( launchTiles*BOLT_SEGSCAN_WG_SIZE );
+            concurrency::parallel_for_each( av, launchExtent.tile< BOLT_SEGSCAN_WG_SIZE >( ),
+                [
+                    keys_first,
+                    values_first,
+                    keys_output,
+                    values_output,
+                    init,
+                    binary_pred,
+                    binary_funct,
+                    numElements,
+                    numTiles,
+                    inclusive,
+                    &status,
+                    &aggVals,
+                    &prefVals,
+                    &aggHeads,
+                    &prefHeads
+                ] ( concurrency::tiled_index< BOLT_SEGSCAN_WG_SIZE > t_idx ) restrict(amp)
+            {
+                tile_static kType ldsKeys[ BOLT_SEGSCAN_TILE ];
+                tile_static oType ldsVals[ BOLT_SEGSCAN_TILE ];
+                tile_static oType ldsScanVals[ BOLT_SEGSCAN_WG_SIZE ];
+                // bit 0: the work-item has elements, bit 1: a segment starts in them
+                tile_static unsigned int ldsScanFlags[ BOLT_SEGSCAN_WG_SIZE ];
+                tile_static unsigned int ldsScanHeads[ BOLT_SEGSCAN_WG_SIZE ];
+                tile_static oType ldsPrefixVal;
+                tile_static unsigned int ldsPrefixHeads;
+                tile_static int ldsTileId;
+                int lIdx = t_idx.local[ 0 ];
+
+                // tiles are numbered in the order they start, so the look-back only waits on running tiles
+                if( lIdx == 0 )
+                    ldsTileId = static_cast< int >( concurrency::atomic_fetch_add( &status[ numTiles ], 1u ) );
+                t_idx.barrier.wait( );
+                const int tileId = ldsTileId;
+                const int base = tileId*BOLT_SEGSCAN_TILE;
+                const int valid = ( numElements - base < BOLT_SEGSCAN_TILE ) ? numElements - base : BOLT_SEGSCAN_TILE;
+
+                for( int k = 0; k < BOLT_SEGSCAN_ITEMS; k++ )
+                {
+                    int i = k*BOLT_SEGSCAN_WG_SIZE + lIdx;
+                    if( i < valid )
+                    {
+                        ldsKeys[ i ] = keys_first[ base + i ];
+                        ldsVals[ i ] = values_first[ base + i ];
+                    }
+                }
+                t_idx.barrier.wait( );
+
+                // scan of the consecutive elements of the work-item, an exclusive scan starting each segment
+                // with init
+                const int first = lIdx*BOLT_SEGSCAN_ITEMS;
+                oType vals[ BOLT_SEGSCAN_ITEMS ];
+                unsigned int heads = 0;
+                unsigned int headCount = 0;
+                unsigned int flags = 0;
+                oType agg;
+                for( int k = 0; k < BOLT_SEGSCAN_ITEMS; k++ )
+                {
+                    int i = first + k;
+                    if( i < valid )
+                    {
+                        bool head;
+                        if( i > 0 )
+                            head = !binary_pred( ldsKeys[ i ], ldsKeys[ i - 1 ] );
+                        else
+                            head = ( base == 0 ) || !binary_pred( ldsKeys[ 0 ], keys_first[ base - 1 ] );
+                        oType v = ldsVals[ i ];
+                        if( head )
+                        {
+                            if( !inclusive )
+                                v = binary_funct( init, v );
+                            heads |= 1u << k;
+                            ++headCount;
+                            flags |= 2;
+                            agg = v;
+                        }
+                        else
+                        {
+                            agg = ( flags & 1 ) ? binary_funct( agg, v ) : v;
+                        }
+                        flags |= 1;
+                        vals[ k ] = v;
+                    }
+                }
+
+                // inclusive segmented scan of the work-items of the tile
+                ldsScanVals[ lIdx ] = agg;
+                ldsScanFlags[ lIdx ] = flags;
+                ldsScanHeads[ lIdx ] = headCount;
+                t_idx.barrier.wait( );
+                for( int offset = 1; offset < BOLT_SEGSCAN_WG_SIZE; offset *= 2 )
+                {
+                    unsigned int f = ldsScanFlags[ lIdx ];
+                    oType v = ldsScanVals[ lIdx ];
+                    unsigned int h = ldsScanHeads[ lIdx ];
+                    if( lIdx >= offset )
+                    {
+                        unsigned int ef = ldsScanFlags[ lIdx - offset ];
+                        h += ldsScanHeads[ lIdx - offset ];
+                        if( !( f & 1 ) )
+                        {
+                            f = ef;
+                            v = ldsScanVals[ lIdx - offset ];
+                        }
+                        else if( ef & 1 )
+                        {
+                            if( !( f & 2 ) )
+                                v = binary_funct( ldsScanVals[ lIdx - offset ], v );
+                            f |= ef;
+                        }
+                    }
+                    t_idx.barrier.wait( );
+                    ldsScanFlags[ lIdx ] = f;
+                    ldsScanVals[ lIdx ] = v;
+                    ldsScanHeads[ lIdx ] = h;
+                    t_idx.barrier.wait( );
+                }
+
+                // decoupled look-back of the carry and the heads of the tiles before this one
+                if( lIdx == 0 )
+                {
+                    unsigned int tileFlags = ldsScanFlags[ BOLT_SEGSCAN_WG_SIZE - 1 ];
+                    oType tileVal = ldsScanVals[ BOLT_SEGSCAN_WG_SIZE - 1 ];
+                    unsigned int tileHeads = ldsScanHeads[ BOLT_SEGSCAN_WG_SIZE - 1 ];
+                    unsigned int head = ( tileFlags & 2 ) ? BOLT_SEGSCAN_HEAD : 0;
+                    if( tileId == 0 )
+                    {
+                        prefVals[ 0 ] = tileVal;
+                        prefHeads[ 0 ] = tileHeads;
+                        concurrency::atomic_exchange( &status[ 0 ], BOLT_SEGSCAN_PREFIX | head );
+                    }
+                    else
+                    {
+                        aggVals[ tileId ] = tileVal;
+                        aggHeads[ tileId ] = tileHeads;
+                        concurrency::atomic_exchange( &status[ tileId ], BOLT_SEGSCAN_AGGREGATE | head );
+
+                        oType prefix;
+                        unsigned int prefixHeads = 0;
+                        bool prefixHas = false;
+                        bool prefixDone = false;
+                        int j = tileId - 1;
+                        while( true )
+                        {
+                            unsigned int s = concurrency::atomic_fetch_add( &status[ j ], 0u );
+                            if( s == 0 )
+                                continue;
+                            bool isPrefix = ( s & BOLT_SEGSCAN_PREFIX ) != 0;
+                            prefixHeads += isPrefix ? prefHeads[ j ] : aggHeads[ j ];
+                            if( !prefixDone )
+                            {
+                                oType v = isPrefix ? prefVals[ j ] : aggVals[ j ];
+                                prefix = prefixHas ? binary_funct( v, prefix ) : v;
+                                prefixHas = true;
+                                // the carry starts in the last segment which starts before this tile
+                                prefixDone = ( s & BOLT_SEGSCAN_HEAD ) != 0;
+                            }
+                            if( isPrefix )
+                                break;
+                            j--;
+                        }
+                        prefVals[ tileId ] = head ? tileVal : binary_funct( prefix, tileVal );
+                        prefHeads[ tileId ] = prefixHeads + tileHeads;
+                        concurrency::atomic_exchange( &status[ tileId ], BOLT_SEGSCAN_PREFIX | head );
+                        ldsPrefixVal = prefix;
+                        ldsPrefixHeads = prefixHeads;
+                    }
+                    if( tileId == 0 )
+                        ldsPrefixHeads = 0;
+                }
+                t_idx.barrier.wait( );
+
+                // carry into the first element of the work-item
+                oType run;
+                unsigned int h = ldsPrefixHeads;
+                if( lIdx > 0 && ( ldsScanFlags[ lIdx - 1 ] & 1 ) )
+                {
+                    run = ldsScanVals[ lIdx - 1 ];
+                    if( !( ldsScanFlags[ lIdx - 1 ] & 2 ) && tileId > 0 )
+                        run = binary_funct( ldsPrefixVal, run );
+                    h += ldsScanHeads[ lIdx - 1 ];
+                }
+                else if( tileId > 0 )
+                {
+                    run = ldsPrefixVal;
+                }
+
+                for( int k = 0; k < BOLT_SEGSCAN_ITEMS; k++ )
+                {
+                    int i = first + k;
+                    if( i < valid )
+                    {
+                        oType out;
+                        if( ( heads >> k ) & 1 )
+                        {
+                            ++h;
+                            if( !inclusive )
+                                out = init;
+                            run = vals[ k ];
+                        }
+                        else
+                        {
+                            if( !inclusive )
+                                out = run;
+                            run = binary_funct( run, vals[ k ] );
+                        }
+                        if( inclusive )
+                            out = run;
+
+                        if( Reduce )
+                        {
+                            // the last element of a segment writes it
+                            bool last;
+                            if( i + 1 < valid )
+                                last = !binary_pred( ldsKeys[ i + 1 ], ldsKeys[ i ] );
+                            else
+                                last = ( base + i + 1 == numElements ) ||
+                                       !binary_pred( keys_first[ base + i + 1 ], ldsKeys[ i ] );
+                            if( last )
+                            {
+                                segmented_scan_keys< Reduce >::store( keys_output, h - 1, ldsKeys[ i ] );
+                                values_output[ h - 1 ] = out;
+                            }
+                        }
+                        else
+                            ldsVals[ i ] = out;
+                    }
+                }
+
+                if( !Reduce )
+                {
+                    t_idx.barrier.wait( );
+                    for( int k = 0; k < BOLT_SEGSCAN_ITEMS; k++ )
+                    {
+                        int i = k*BOLT_SEGSCAN_WG_SIZE + lIdx;
+                        if( i < valid )
+                            values_output[ base + i ] = ldsVals[ i ];
+                    }
+                }
+            } );
+        }
+
+        if( !Reduce )
+            return numElements;
+        concurrency::array_view< unsigned int > segments( prefHeads );
+        return segments.section( numTiles - 1, 1 )[ 0 ];
+    }
+
+}
+}
+}
+
+#endif
@@ -0,0 +1,192 @@
+/***************************************************************************
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+///////////////////////////////////////////////////////////////////////////////
+// AMP tile reduction, reduces the values of a tile and the partials of all
+// the tiles of a dispatch on the device.
+//
+// Within a wavefront the values are combined through cross-lane shuffles when
+// the HCC AMDGPU backend builds the kernel and the type fits a register, else
+// through the tile_static tree with a barrier per step. The last tile to be
+// done reduces the partials of all the tiles, so a reduction is one dispatch
+// and the host only reads back its result.
+//////////////////////////////////////////////////////////////////////////////
+
+#if !defined( BOLT_AMP_TILE_REDUCE_INL )
+#define BOLT_AMP_TILE_REDUCE_INL
+#pragma once
+
+#include <type_traits>
+#include <amp.h>
+
+#if defined( __hcc_backend__ ) && ( __hcc_backend__ == HCC_BACKEND_AMDGPU )
+#include <hc.hpp>
+#define BOLT_AMP_TILE_REDUCE_SHFL 1
+#else
+#define BOLT_AMP_TILE_REDUCE_SHFL 0
+#endif
+
+// lanes of a wavefront which the shuffles exchange values in
+#define BOLT_AMP_WAVEFRONT_SIZE 64
+
+namespace bolt
+{
+namespace amp
+{
+namespace detail
+{
+
+    // Whether values of T are reduced with shuffles: the types hc::__shfl_xor exchanges.
+    template< typename T >
+    struct tile_reduce_shfl : std::integral_constant< bool, BOLT_AMP_TILE_REDUCE_SHFL &&
+        ( std::is_same< T, int >::value || std::is_same< T, unsigned int >::value ||
+          std::is_same< T, float >::value ) >
+    {
+    };
+
+#if BOLT_AMP_TILE_REDUCE_SHFL
+    inline int tile_reduce_xor( int value, int laneMask ) restrict(amp)
+    {
+        return hc::__shfl_xor( value, laneMask );
+    }
+
+    inline unsigned int tile_reduce_xor( unsigned int value, int laneMask ) restrict(amp)
+    {
+        return static_cast< unsigned int >( hc::__shfl_xor( static_cast< int >( value ), laneMask ) );
+    }
+
+    inline float tile_reduce_xor( float value, int laneMask ) restrict(amp)
+    {
+        return hc::__shfl_xor( value, laneMask );
+    }
+
+    // Reduces the values of the first count lanes of each wavefront through shuffles, in lane order.
+    // Only the first lane of a wavefront has its result, each step a lane takes the one laneMask above it.
+    template< int TileSize, typename T, typename BinaryFunction >
+    T tile_reduce( const concurrency::tile_barrier& barrier,
+                   int lIdx,
+                   T* scratch,
+                   T value,
+                   int count,
+                   const BinaryFunction& op,
+                   std::true_type ) restrict(amp)
+    {
+        const int lane = lIdx % BOLT_AMP_WAVEFRONT_SIZE;
+        const int wave = lIdx / BOLT_AMP_WAVEFRONT_SIZE;
+        const int waveBase = wave*BOLT_AMP_WAVEFRONT_SIZE;
+        const int waveCount = count - waveBase;
+
+        for( int laneMask = BOLT_AMP_WAVEFRONT_SIZE/2; laneMask > 0; laneMask /= 2 )
+        {
+            // every lane takes part in the shuffle, only the ones below laneMask keep the result
+            T other = tile_reduce_xor( value, laneMask );
+            if( ( lane & laneMask ) == 0 && ( lane | laneMask ) < waveCount )
+                value = op( value, other );
+        }
+
+        if( lane == 0 )
+            scratch[ wave ] = value;
+        barrier.wait( );
+
+        if( lIdx == 0 )
+        {
+            const int numWaves = ( count + BOLT_AMP_WAVEFRONT_SIZE - 1 ) / BOLT_AMP_WAVEFRONT_SIZE;
+            for( int w = 1; w < numWaves; w++ )
+                value = op( value, scratch[ w ] );
+        }
+        return value;
+    }
+#endif
+
+    // Reduces the values of the first count lanes of the tile through the tile_static tree, in lane order.
+    // Only the first lane of the tile has its result.
+    template< int TileSize, typename T, typename BinaryFunction >
+    T tile_reduce( const concurrency::tile_barrier& barrier,
+                   int lIdx,
+                   T* scratch,
+                   T value,
+                   int count,
+                   const BinaryFunction& op,
+                   std::false_type ) restrict(amp)
+    {
+        scratch[ lIdx ] = value;
+        barrier.wait( );
+
+        for( int offset = TileSize/2; offset > 0; offset /= 2 )
+        {
+            if( lIdx < offset && lIdx + offset < count )
+                scratch[ lIdx ] = op( scratch[ lIdx ], scratch[ lIdx + offset ] );
+            barrier.wait( );
+        }
+        return scratch[ 0 ];
+    }
+
+    // Reduces the values of the first count lanes of tile tileId, lIdx being the flat local index of the
+    // lane, and writes the result of the tile in partials. The last tile to be done reduces the partials
+    // of the numTiles tiles with init into result[ 0 ]. done[ 0 ] must be 0 at dispatch; the last tile
+    // sets it back to 0. scratch holds TileSize values, every lane of the tile must call it.
+    template< int TileSize, typename T, typename BinaryFunction >
+    void tile_reduce_and_finish( const concurrency::tile_barrier& barrier,
+                                 int lIdx,
+                                 int tileId,
+                                 T* scratch,
+                                 unsigned int& isLast,
+                                 T value,
+                                 int count,
+                                 const T& init,
+                                 const BinaryFunction& op,
+                                 int numTiles,
+                                 concurrency::array< T, 1 >& partials,
+                                 concurrency::array< unsigned int, 1 >& done,
+                                 concurrency::array< T, 1 >& result ) restrict(amp)
+    {
+        T tileValue = tile_reduce< TileSize >( barrier, lIdx, scratch, value, count, op, tile_reduce_shfl< T >( ) );
+
+        // the atomic orders the partial before the count, so the last tile sees all of them;
+        // the barrier also ends the reads of scratch by the first reduction
+        if( lIdx == 0 )
+        {
+            partials[ tileId ] = tileValue;
+            unsigned int finished = concurrency::atomic_fetch_add( &done[ 0 ], 1u );
+            isLast = ( finished == static_cast< unsigned int >( numTiles - 1 ) ) ? 1u : 0u;
+        }
+        barrier.wait( );
+        if( !isLast )
+            return;
+
+        const int finalCount = numTiles < TileSize ? numTiles : TileSize;
+        T accumulator = init;
+        if( lIdx < finalCount )
+        {
+            accumulator = partials[ lIdx ];
+            for( int i = lIdx + TileSize; i < numTiles; i += TileSize )
+                accumulator = op( accumulator, partials[ i ] );
+        }
+        T total = tile_reduce< TileSize >( barrier, lIdx, scratch, accumulator, finalCount, op, tile_reduce_shfl< T >( ) );
+
+        if( lIdx == 0 )
+        {
+            result[ 0 ] = op( init, total );
+            done[ 0 ] = 0;
+        }
+    }
+
+} // end of namespace detail
+} // end of namespace amp
+} // end of namespace bolt
+
+#endif // BOLT_AMP_TILE_REDUCE_INL
@@ -29,17 +29,13 @@
 #endif
 
 #include "bolt/amp/iterator/iterator_traits.h"
+#include "bolt/amp/autotune.h"
+#include "bolt/amp/wait.h"
+#include "bolt/amp/pool_alloc.h"
+#include "bolt/amp/detail/tile_reduce.inl"
 
 #define _T_REDUCE_WAVEFRONT_SIZE 256 
 
-#define _T_REDUCE_STEP(_LENGTH, _IDX, _W) \
-    if ((_IDX < _W) && ((_IDX + _W) < _LENGTH)) {\
-      oType mine = scratch[_IDX];\
-      oType other = scratch[_IDX + _W];\
-      scratch[_IDX] = binary_op(mine, other); \
-    }\
-    t_idx.barrier.wait();
-
 namespace bolt {
 
   namespace amp {
@@ -56,12 +52,12 @@ namespace bolt {
         {
                 typedef typename std::iterator_traits< DVInputIterator >::value_type iType;
                 const int szElements = static_cast< int >( std::distance( first, last ) );
-
+                scoped_wait_mode wait( ctl, "transform_reduce", szElements );
 
 
 
 				int max_ComputeUnits = 32;
-				int numTiles = max_ComputeUnits*32;	/* Max no. of WG for Tahiti(32 compute Units) and 32 is the tuning factor that gives good performance*/
+				int numTiles = max_ComputeUnits*ctl.getWGPerComputeUnit();	/* Max no. of WG for Tahiti(32 compute Units) */
 				int length = (_T_REDUCE_WAVEFRONT_SIZE * numTiles);
 				length = szElements < length ? szElements : length;
 				unsigned int residual = length % _T_REDUCE_WAVEFRONT_SIZE;
@@ -69,7 +65,13 @@ namespace bolt {
 				numTiles = static_cast< int >((szElements/_T_REDUCE_WAVEFRONT_SIZE)>= numTiles?(numTiles):
 									(std::ceil( static_cast< float >( szElements ) / _T_REDUCE_WAVEFRONT_SIZE) ));
 				
-				concurrency::array<oType, 1> result(numTiles);
+				concurrency::accelerator_view av = ctl.getAccelerator().get_default_view();
+				// the partials of the tiles, the tiles done and the result are reduced on the device
+				bolt::PooledArray< oType > partialsPool( av, numTiles );
+				concurrency::array< oType, 1 >& partials = partialsPool.array();
+				unsigned int noneDone = 0;
+				concurrency::array< unsigned int, 1 > done( 1, &noneDone, av );
+				concurrency::array< oType, 1 > result( 1, av );
 				concurrency::extent< 1 > inputExtent(length);
 				concurrency::tiled_extent< _T_REDUCE_WAVEFRONT_SIZE > tiledExtentReduce = inputExtent.tile< _T_REDUCE_WAVEFRONT_SIZE >();
 
@@ -78,12 +80,16 @@ namespace bolt {
 
                 try
                 {
-                    concurrency::parallel_for_each(ctl.getAccelerator().get_default_view(),
+                    concurrency::parallel_for_each(av,
                                                    tiledExtentReduce,
                                                     [ first,
                                                     szElements,
                                                     length,
+                                                    numTiles,
                                                     transform_op,
+                                                    init,
+                                                    &partials,
+                                                    &done,
                                                     &result,
                                                     binary_op ]
                                                    ( concurrency::tiled_index<_T_REDUCE_WAVEFRONT_SIZE> t_idx ) restrict(amp)
@@ -91,8 +97,7 @@ namespace bolt {
 						int gx = t_idx.global[0];
 						int gloId = gx;
 						tile_static oType scratch[_T_REDUCE_WAVEFRONT_SIZE];
-						//  Initialize local data store
-						unsigned int tileIndex = t_idx.local[0];
+						tile_static unsigned int isLast;
 
 						oType accumulator;
 						if (gloId < szElements)
@@ -110,43 +115,15 @@ namespace bolt {
 							accumulator = binary_op(accumulator, element);
 							gx += length;
 						}
-                        
-						scratch[tileIndex] = accumulator;
-						t_idx.barrier.wait();
-
-						unsigned int tail = szElements - (t_idx.tile[0] * _T_REDUCE_WAVEFRONT_SIZE);
-
-						_T_REDUCE_STEP(tail, tileIndex, 128);
-						_T_REDUCE_STEP(tail, tileIndex, 64);
-						_T_REDUCE_STEP(tail, tileIndex, 32);
-						_T_REDUCE_STEP(tail, tileIndex, 16);
-						_T_REDUCE_STEP(tail, tileIndex, 8);
-						_T_REDUCE_STEP(tail, tileIndex, 4);
-						_T_REDUCE_STEP(tail, tileIndex, 2);
-						_T_REDUCE_STEP(tail, tileIndex, 1);
-
-
-						//  Abort threads that are passed the end of the input vector
-						if (gloId >= szElements)
-							return;
-
-                      //  Write only the single reduced value for the entire workgroup
-                      if (tileIndex == 0)
-                      {
-                          result[t_idx.tile[ 0 ]] = scratch[0];
-                      }
 
+						int tail = szElements - (t_idx.tile[0] * _T_REDUCE_WAVEFRONT_SIZE);
+						tile_reduce_and_finish< _T_REDUCE_WAVEFRONT_SIZE >( t_idx.barrier, t_idx.local[ 0 ], t_idx.tile[ 0 ],
+						    scratch, isLast, accumulator, tail, static_cast< oType >( init ), binary_op,
+						    numTiles, partials, done, result );
                     });
-                     
-					oType acc = static_cast<oType>(init);
-					std::vector<oType> *cpuPointerReduce = new std::vector<oType>(numTiles);
-					concurrency::copy(result, (*cpuPointerReduce).begin());
-					for(int i = 0; i < numTiles; ++i)
-					{
-						acc = binary_op(acc, (*cpuPointerReduce)[i]);
-					}
-					delete cpuPointerReduce;
 
+					oType acc;
+					concurrency::copy(result, &acc);
 					return acc;
                 }
                 catch(std::exception &e)
@@ -181,7 +158,17 @@ namespace bolt {
             if (szElements == 0)
                     return init;
 
-            bolt::amp::control::e_RunMode runMode = c.getForceRunMode();  // could be dynamic choice some day.
+            // with Automatic the run mode and the work shape are tuned
+            if (c.getForceRunMode() == bolt::amp::control::Automatic)
+            {
+                return autotune(c, "transform_reduce", typeid(iType), szElements, true,
+                                [&](bolt::amp::control& tuned) {
+                                    return transform_reduce_pick_iterator(tuned, first, last, transform_op, init,
+                                                                          reduce_op, std::random_access_iterator_tag());
+                                });
+            }
+
+            bolt::amp::control::e_RunMode runMode = c.getForceRunMode();
 			if (runMode == bolt::amp::control::Automatic)
 			{
 				runMode = c.getDefaultPathToRun();
@@ -236,7 +223,17 @@ namespace bolt {
             if (szElements == 0)
                     return init;
 
-            bolt::amp::control::e_RunMode runMode = c.getForceRunMode();  // could be dynamic choice some day.
+            // with Automatic the run mode and the work shape are tuned
+            if (c.getForceRunMode() == bolt::amp::control::Automatic)
+            {
+                return autotune(c, "transform_reduce", typeid(iType), szElements, true,
+                                [&](bolt::amp::control& tuned) {
+                                    return transform_reduce_pick_iterator(tuned, first, last, transform_op, init,
+                                                                          reduce_op, bolt::amp::device_vector_tag());
+                                });
+            }
+
+            bolt::amp::control::e_RunMode runMode = c.getForceRunMode();
 			if (runMode == bolt::amp::control::Automatic)
 			{
 				runMode = c.getDefaultPathToRun();
@@ -296,7 +293,17 @@ namespace bolt {
             if (szElements == 0)
                     return init;
 
-            bolt::amp::control::e_RunMode runMode = c.getForceRunMode();  // could be dynamic choice some day.
+            // with Automatic the run mode and the work shape are tuned
+            if (c.getForceRunMode() == bolt::amp::control::Automatic)
+            {
+                return autotune(c, "transform_reduce", typeid(iType), szElements, true,
+                                [&](bolt::amp::control& tuned) {
+                                    return transform_reduce_pick_iterator(tuned, first, last, transform_op, init,
+                                                                          reduce_op, bolt::amp::fancy_iterator_tag());
+                                });
+            }
+
+            bolt::amp::control::e_RunMode runMode = c.getForceRunMode();
 			if (runMode == bolt::amp::control::Automatic)
 			{
 				runMode = c.getDefaultPathToRun();
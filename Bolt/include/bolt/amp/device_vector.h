@@ -828,21 +828,10 @@ private:
 
     void reserve( size_type reqSize )
     {
-       if( reqSize <= capacity( ) )
-           return;
-
-		concurrency::array<value_type> tmp =  array_type( static_cast< int >( reqSize ) );
-		arrayview_type l_tmpBuffer = arrayview_type( tmp );
-		if( m_Size > 0 )
-        {
-			if( capacity() != 0 )
-			{
-				arrayview_type l_tmpBuffer = arrayview_type( tmp );
-				m_devMemory.copy_to(l_tmpBuffer.section(0, m_devMemory.get_extent().size()));
-			}
-		}
-		m_devMemory = l_tmpBuffer;
+        if( reqSize <= capacity( ) )
+            return;
 
+        reallocate( reqSize );
     }
 
     /*! \brief Return the maximum possible number of elements without reallocation.
@@ -862,17 +851,17 @@ private:
     *   \warning if the device_vector must reallocate, all previous iterators, references, and pointers are invalidated.
     */
     void shrink_to_fit( )
-    {   
+    {
         if( m_Size == capacity( ) )
              return;
 
-        array_type l_tmpArray = array_type( static_cast< int >( size( ) ) );
-        arrayview_type l_tmpBuffer = arrayview_type(l_tmpArray);
-        arrayview_type l_devMemoryAV = m_devMemory.section( 0,(int)size() );
-        arrayview_type l_tmpBufferAV = l_tmpBuffer.section( 0,(int)size() );
+        if( m_Size == 0 )
+        {
+            clear( );
+            return;
+        }
 
-        l_devMemoryAV.copy_to( l_tmpBufferAV );
-        m_devMemory = l_tmpBuffer;
+        reallocate( m_Size );
     }
 
     /*! \brief Retrieves the value stored at index n.
@@ -1048,7 +1037,6 @@ private:
 
              return NULL;
         }
-        synchronize( *this );
         arrayview_type av( m_devMemory );
         return av.data( );
     }
@@ -1059,7 +1047,6 @@ private:
         {
              return NULL;
         }
-		synchronize( *this );
         arrayview_type av( m_devMemory );
         return av.data( );
     }
@@ -1091,14 +1078,10 @@ private:
 
         //  Need to grow the vector to push new value.
         //  Vectors double their capacity on push_back if the array is not big enough.
-        if( m_Size == capacity( ) )
-        {
-            m_Size ? reserve( m_Size * 2 ) : reserve( 1 );
-        }
+        grow( m_Size + 1 );
 
-        arrayview_type av( m_devMemory );
-        //insert(end(),value);
-        av[static_cast<int>( m_Size )] = value;
+        //  Only the new element is written to the device, the rest of the vector stays where it is
+        concurrency::copy( &value, &value + 1, m_devMemory.section( static_cast< int >( m_Size ), 1 ) );
         ++m_Size;
     }
 
@@ -1202,12 +1185,7 @@ private:
         }
 
         //  Need to grow the vector to insert a new value.
-        //  TODO:  What is an appropriate growth strategy for GPU memory allocation?  Exponential growth does not seem
-        //  right at first blush.
-        if( m_Size == capacity( ) )
-        {
-            m_Size ? reserve( m_Size * 2 ) : reserve( 1 );
-        }
+        grow( m_Size + 1 );
 
         size_type sizeMap = (m_Size - index.m_Index) + 1;
 
@@ -1238,12 +1216,15 @@ private:
         if( index.m_Index > m_Size )
             throw Concurrency::runtime_exception(  "Iterator is pointing past the end of this container" , 0);
 
-        //  Need to grow the vector to insert n new values
-        if( ( m_Size + n ) > capacity( ) )
+        if( index.m_Index == m_Size )
         {
-            reserve( m_Size + n );
+            append( n, value );
+            return;
         }
 
+        //  Need to grow the vector to insert n new values
+        grow( m_Size + n );
+
         size_type sizeMap = (m_Size - index.m_Index) + n;
 
         arrayview_type av( m_devMemory );
@@ -1268,12 +1249,15 @@ private:
         if( index.m_Index > m_Size )
             throw Concurrency::runtime_exception(  "Iterator is pointing past the end of this container", 0);
 
-        //  Need to grow the vector to insert the range of new values
-        size_type n = static_cast<int>(std::distance( begin, end ));
-        if( ( m_Size + n ) > capacity( ) )
+        if( index.m_Index == m_Size )
         {
-            reserve( m_Size + n );
+            append( begin, end );
+            return;
         }
+
+        //  Need to grow the vector to insert the range of new values
+        size_type n = static_cast<int>(std::distance( begin, end ));
+        grow( m_Size + n );
         size_type sizeMap = (m_Size - index.m_Index) + n;
 
         arrayview_type av( m_devMemory );
@@ -1291,6 +1275,49 @@ private:
         m_Size += static_cast<int>(n);
     }
 
+    /*! \brief Appends n copies of the value to the container.
+     *  \param n The number of copies of element.
+     *  \param value The element to append.
+     *  \note The new elements are filled on the device, the capacity grows like with push_back.
+     */
+    void append( size_type n, const value_type& value )
+    {
+        if( n == 0 )
+            return;
+
+        grow( m_Size + n );
+
+        arrayview_type l_appendAV = m_devMemory.section( static_cast< int >( m_Size ), static_cast< int >( n ) );
+        Concurrency::parallel_for_each( l_appendAV.get_extent(), [=](Concurrency::index<1> idx) restrict(amp)
+        {
+            l_appendAV[idx] = value;
+        });
+        m_Size += n;
+    }
+
+    /*! \brief Appends a range of values to the container.
+     *  \param begin The iterator position signifiying the beginning of the range.
+     *  \param end The iterator position signifying the end of the range (exclusive).
+     *  \note The range is written to the device in one transfer, the capacity grows like with push_back.
+     */
+    template< typename InputIterator >
+#ifdef _WIN32
+    typename std::enable_if< std::_Is_iterator<InputIterator>::value, void>::type
+#else
+    typename std::enable_if< is_iterator<InputIterator>::value, void>::type
+#endif
+    append( InputIterator begin, InputIterator end )
+    {
+        size_type n = static_cast<int>(std::distance( begin, end ));
+        if( n == 0 )
+            return;
+
+        grow( m_Size + n );
+
+        concurrency::copy( begin, end, m_devMemory.section( static_cast< int >( m_Size ), static_cast< int >( n ) ) );
+        m_Size += n;
+    }
+
     /*! \brief Assigns newSize copies of element value.
      *  \param newSize The new size of the device_vector.
      *  \param value The value of the element that is replicated newSize times.
@@ -1344,6 +1371,37 @@ private:
 
 private:
 
+    //  Moves the elements to a new buffer of reqSize elements.  The elements are copied by a kernel on the
+    //  device, so they never round-trip through the host, and only the size( ) elements are copied, not the
+    //  whole capacity( ).
+    void reallocate( size_type reqSize )
+    {
+        array_type l_tmpArray = array_type( static_cast< int >( reqSize ) );
+        arrayview_type l_tmpBuffer = arrayview_type( l_tmpArray );
+        if( m_Size > 0 )
+        {
+            arrayview_type l_devMemoryAV = m_devMemory.section( 0, static_cast< int >( m_Size ) );
+            arrayview_type l_tmpBufferAV = l_tmpBuffer.section( 0, static_cast< int >( m_Size ) );
+            Concurrency::parallel_for_each( l_tmpBufferAV.get_extent(), [=](Concurrency::index<1> idx) restrict(amp)
+            {
+                l_tmpBufferAV[idx] = l_devMemoryAV[idx];
+            });
+        }
+        m_devMemory = l_tmpBuffer;
+    }
+
+    //  Grows the capacity( ) to hold at least reqSize elements, at least doubling it so that a sequence of
+    //  push_back, insert and append reallocates a logarithmic number of times.
+    void grow( size_type reqSize )
+    {
+        size_type cap = capacity( );
+        if( reqSize <= cap )
+            return;
+
+        size_type newCap = cap * 2;
+        reallocate( newCap > reqSize ? newCap : reqSize );
+    }
+
     //  These private routines make sure that the data that resides in the concurrency::array* object are
     //  reflected back in the host memory.  However, the complication is that the concurrency::array object
     //  does not expose a synchronize method, whereas the concurrency::array_view does.  These routines
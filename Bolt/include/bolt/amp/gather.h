@@ -20,6 +20,7 @@
 #pragma once
 
 #include "bolt/amp/device_vector.h"
+#include "bolt/amp/permutation_plan.h"
 
 /*! \file bolt/amp/gather.h
     \brief gathers elements from a source array to a destination range.
@@ -90,6 +91,46 @@ namespace bolt {
                      InputIterator2 input_first,
                      OutputIterator result );
 
+       /*! \brief This version of \p gather copies elements from a source array to a destination range according to
+         * the map a permutation_plan was built from, for maps gathered several times. The work-items copy the
+         * elements in the order of the plan, so that they read and write contiguous memory.
+         *
+         * \param ctl \b Optional Control structure to control command-queue, debug, tuning, etc.See bolt::amp::control.
+         * \param plan A permutation_plan of kind permutation_plan::Gather.
+         * \param input The beginning of the source sequence.
+         * \param result The beginning of the output sequence.
+         *  \tparam InputIterator is a model of InputIterator
+         *  \tparam OutputIterator is a model of OutputIterator
+         *
+         *  \details The following code snippet demonstrates how to use \p gather with a plan
+         *
+         *  \code
+         *  #include <bolt/amp/gather.h>
+         *
+         *  int map[10] = {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+         *  int input[10] = {0, 11, 22, 33, 44, 55, 66, 77, 88, 99};
+         *  int output[10];
+         *  bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Gather, map, map + 10 );
+         *  bolt::amp::gather(plan, input, output);
+         *
+         *  // output is now {99, 88, 77, 66, 55, 44, 33, 22, 11, 0};
+         *  \endcode
+         *
+         */
+
+        template< typename InputIterator,
+                  typename OutputIterator >
+        void gather( ::bolt::amp::control &ctl,
+                     const permutation_plan& plan,
+                     InputIterator input_first,
+                     OutputIterator result );
+
+        template< typename InputIterator,
+                  typename OutputIterator >
+        void gather( const permutation_plan& plan,
+                     InputIterator input_first,
+                     OutputIterator result );
+
 
        /*! \brief This version of \p gather_if copies elements from a source array to a destination range according to a
          * specified map. For each \p i in \p InputIterator1 in the range \p [map_first, map_last), gather_if copies
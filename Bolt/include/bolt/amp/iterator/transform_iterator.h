@@ -0,0 +1,255 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_TRANSFORM_ITERATOR_H )
+#define BOLT_AMP_TRANSFORM_ITERATOR_H
+#include <type_traits>
+#include <utility>
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/iterator/iterator_traits.h"
+
+/*! \file bolt/amp/iterator/transform_iterator.h
+    \brief Return the value of a functor applied to the underlying iterator on dereferencing.
+*/
+
+
+namespace bolt {
+namespace amp {
+
+  struct transform_iterator_tag
+      : public fancy_iterator_tag
+      {   // identifying tag for random-access iterators
+      };
+
+      /*! \addtogroup fancy_iterators
+       */
+
+      /*! \addtogroup AMP-TransformIterator
+      *   \ingroup fancy_iterators
+      *   \{
+      */
+
+      /*! transform_iterator applies a unary functor to the values of a range as they are read.
+       *
+       *  The functor is called where the iterator is dereferenced, in the kernels of the
+       *  algorithms too, so it fuses into them: no temporary range of the transformed values
+       *  is created. The underlying iterator must be dereferenceable on the accelerator, a
+       *  device_vector iterator or another fancy iterator, and the functor must be callable
+       *  with restrict(cpu,amp). transform_iterator is read-only.
+       *
+       *  \details The following example demonstrates how to use a \p transform_iterator.
+       *
+       *  \code
+       *  #include <bolt/amp/iterator/transform_iterator.h>
+       *  #include <bolt/amp/reduce.h>
+       *
+       *  ...
+       *
+       *  bolt::amp::device_vector< int > values( 5 );
+       *  values[ 0 ] = 1 ; values[ 1 ] = 2 ; values[ 2 ] = 3 ;
+       *  values[ 3 ] = 4 ; values[ 4 ] = 5 ;
+       *
+       *  bolt::amp::control ctrl = control::getDefault( );
+       *  ...
+       *  int sum = bolt::amp::reduce( ctrl,
+       *                               bolt::amp::make_transform_iterator( values.begin( ), bolt::amp::square< int >( ) ),
+       *                               bolt::amp::make_transform_iterator( values.end( ), bolt::amp::square< int >( ) ),
+       *                               0,
+       *                               bolt::amp::plus< int >( ) );
+       *
+       *  // Output:
+       *  // sum = 55
+       *
+       *  \endcode
+       *
+       */
+      template< typename UnaryFunction, typename Iterator >
+      class transform_iterator: public std::iterator< transform_iterator_tag,
+          typename std::decay< decltype( std::declval< UnaryFunction >( )(
+              std::declval< typename iterator_traits< Iterator >::value_type >( ) ) ) >::type, int>
+      {
+        public:
+         typedef typename std::iterator< transform_iterator_tag,
+             typename std::decay< decltype( std::declval< UnaryFunction >( )(
+                 std::declval< typename iterator_traits< Iterator >::value_type >( ) ) ) >::type, int>::difference_type
+         difference_type;
+
+         typedef transform_iterator< UnaryFunction, Iterator > trans_iterator;
+         typedef typename std::decay< decltype( std::declval< UnaryFunction >( )(
+             std::declval< typename iterator_traits< Iterator >::value_type >( ) ) ) >::type value_type;
+         typedef Iterator base_type;
+         typedef UnaryFunction functor_type;
+
+        // Default constructor
+        transform_iterator( ): m_Index( 0 ), m_Base( ), m_Functor( ) { }
+
+        //  Basic constructor requires the underlying iterator and the functor applied to its values
+        transform_iterator( Iterator base, UnaryFunction f = UnaryFunction( ) ):
+        m_Index( static_cast< difference_type >( base.getIndex( ) ) ), m_Base( base ), m_Functor( f ) { }
+
+        transform_iterator< UnaryFunction, Iterator >& operator= ( const transform_iterator< UnaryFunction, Iterator >& rhs )
+        {
+            if( this == &rhs )
+                return *this;
+
+            m_Base = rhs.m_Base;
+            m_Functor = rhs.m_Functor;
+            m_Index = rhs.m_Index;
+            return *this;
+        }
+
+        transform_iterator< UnaryFunction, Iterator >& operator+= ( const difference_type & n )
+        {
+            advance( n );
+            return *this;
+        }
+
+        const transform_iterator< UnaryFunction, Iterator > operator+ ( const difference_type & n ) const
+        {
+            transform_iterator< UnaryFunction, Iterator > result( *this );
+            result.advance( n );
+            return result;
+        }
+
+        const transform_iterator< UnaryFunction, Iterator > operator- ( const difference_type & n ) const
+        {
+            transform_iterator< UnaryFunction, Iterator > result( *this );
+            result.advance( -n );
+            return result;
+        }
+
+        const transform_iterator< UnaryFunction, Iterator > & getContainer( ) const
+        {
+            return *this;
+        }
+
+        difference_type operator- ( const transform_iterator< UnaryFunction, Iterator >& rhs ) const
+        {
+            return m_Index - rhs.m_Index;
+        }
+
+        //  Public member variables
+        difference_type m_Index;
+
+        //  Used for templatized copy constructor and the templatized equal operator
+        template < typename, typename > friend class transform_iterator;
+
+        void advance( difference_type n )
+        {
+            m_Index += n;
+            m_Base += n;
+        }
+
+        // Pre-increment
+        transform_iterator< UnaryFunction, Iterator >& operator++ ( )
+        {
+            advance( 1 );
+            return *this;
+        }
+
+        // Post-increment
+        transform_iterator< UnaryFunction, Iterator > operator++ ( int )
+        {
+            transform_iterator< UnaryFunction, Iterator > result( *this );
+            advance( 1 );
+            return result;
+        }
+
+        // Pre-decrement
+        transform_iterator< UnaryFunction, Iterator >& operator--( )
+        {
+            advance( -1 );
+            return *this;
+        }
+
+        // Post-decrement
+        transform_iterator< UnaryFunction, Iterator > operator--( int )
+        {
+            transform_iterator< UnaryFunction, Iterator > result( *this );
+            advance( -1 );
+            return result;
+        }
+
+        difference_type getIndex() const
+        {
+            return m_Index;
+        }
+
+        const Iterator& base( ) const
+        {
+            return m_Base;
+        }
+
+        const UnaryFunction& functor( ) const
+        {
+            return m_Functor;
+        }
+
+        template< typename OtherFunction, typename OtherIterator >
+        bool operator== ( const transform_iterator< OtherFunction, OtherIterator >& rhs ) const
+        {
+          return rhs.m_Index == m_Index;
+        }
+
+        template< typename OtherFunction, typename OtherIterator >
+        bool operator!= ( const transform_iterator< OtherFunction, OtherIterator >& rhs ) const
+        {
+          return rhs.m_Index != m_Index;
+        }
+
+        template< typename OtherFunction, typename OtherIterator >
+        bool operator< ( const transform_iterator< OtherFunction, OtherIterator >& rhs ) const
+        {
+          return m_Index < rhs.m_Index;
+        }
+
+        // Dereference operators, the functor is applied to the value read
+        value_type operator*() const restrict(cpu,amp)
+        {
+          return m_Functor( *m_Base );
+        }
+
+        value_type operator[](int x) const restrict(cpu,amp)
+        {
+          return m_Functor( m_Base[x] );
+        }
+
+        Iterator m_Base;
+        UnaryFunction m_Functor;
+      };
+
+  template< typename Iterator, typename UnaryFunction >
+  transform_iterator< UnaryFunction, Iterator > make_transform_iterator( Iterator base, UnaryFunction f )
+  {
+      transform_iterator< UnaryFunction, Iterator > tmp( base, f );
+      return tmp;
+  }
+
+  // Version which allows explicit specification of the UnaryFunction type
+  template< typename UnaryFunction, typename Iterator >
+  transform_iterator< UnaryFunction, Iterator > make_transform_iterator( Iterator base )
+  {
+      transform_iterator< UnaryFunction, Iterator > tmp( base, UnaryFunction( ) );
+      return tmp;
+  }
+
+}
+}
+
+
+#endif
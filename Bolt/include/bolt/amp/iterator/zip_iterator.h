@@ -0,0 +1,248 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#pragma once
+#if !defined( BOLT_AMP_ZIP_ITERATOR_H )
+#define BOLT_AMP_ZIP_ITERATOR_H
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/pair.h"
+#include "bolt/amp/iterator/iterator_traits.h"
+
+/*! \file bolt/amp/iterator/zip_iterator.h
+    \brief Return the pair of the values of two iterators on dereferencing.
+*/
+
+
+namespace bolt {
+namespace amp {
+
+  struct zip_iterator_tag
+      : public fancy_iterator_tag
+      {   // identifying tag for random-access iterators
+      };
+
+      /*! \addtogroup fancy_iterators
+       */
+
+      /*! \addtogroup AMP-ZipIterator
+      *   \ingroup fancy_iterators
+      *   \{
+      */
+
+      /*! zip_iterator iterates two ranges in lockstep, and reads the values at the same position
+       *  of both as a bolt::amp::pair.
+       *
+       *  The ranges are read where the iterator is dereferenced, in the kernels of the
+       *  algorithms too, so functors taking several values fuse into them with no temporary
+       *  range of pairs. Both iterators must be dereferenceable on the accelerator:
+       *  device_vector iterators or other fancy iterators. zip_iterator is read-only.
+       *
+       *  \details The following example demonstrates how to use a \p zip_iterator.
+       *
+       *  \code
+       *  #include <bolt/amp/iterator/zip_iterator.h>
+       *  #include <bolt/amp/iterator/transform_iterator.h>
+       *  #include <bolt/amp/reduce.h>
+       *
+       *  ...
+       *
+       *  struct multiply_pair
+       *  {
+       *      int operator( )( const bolt::amp::pair< int, int >& p ) const restrict(cpu,amp)
+       *      {
+       *          return p.first * p.second;
+       *      }
+       *  };
+       *
+       *  bolt::amp::device_vector< int > x( 5, 2 );
+       *  bolt::amp::device_vector< int > y( 5, 3 );
+       *
+       *  bolt::amp::control ctrl = control::getDefault( );
+       *  ...
+       *  // dot product of x and y in a single reduction
+       *  int dot = bolt::amp::reduce( ctrl,
+       *                               bolt::amp::make_transform_iterator( bolt::amp::make_zip_iterator( x.begin( ), y.begin( ) ),
+       *                                                                   multiply_pair( ) ),
+       *                               bolt::amp::make_transform_iterator( bolt::amp::make_zip_iterator( x.end( ), y.end( ) ),
+       *                                                                   multiply_pair( ) ),
+       *                               0,
+       *                               bolt::amp::plus< int >( ) );
+       *
+       *  // Output:
+       *  // dot = 30
+       *
+       *  \endcode
+       *
+       */
+      template< typename FirstIterator, typename SecondIterator >
+      class zip_iterator: public std::iterator< zip_iterator_tag,
+          bolt::amp::pair< typename iterator_traits< FirstIterator >::value_type,
+                           typename iterator_traits< SecondIterator >::value_type >, int>
+      {
+        public:
+         typedef typename std::iterator< zip_iterator_tag,
+             bolt::amp::pair< typename iterator_traits< FirstIterator >::value_type,
+                              typename iterator_traits< SecondIterator >::value_type >, int>::difference_type
+         difference_type;
+
+         typedef zip_iterator< FirstIterator, SecondIterator > zipped_iterator;
+         typedef typename iterator_traits< FirstIterator >::value_type first_value_type;
+         typedef typename iterator_traits< SecondIterator >::value_type second_value_type;
+         typedef bolt::amp::pair< first_value_type, second_value_type > value_type;
+
+        // Default constructor
+        zip_iterator( ): m_Index( 0 ), m_First( ), m_Second( ) { }
+
+        //  Basic constructor requires the two iterators at the same position of their ranges
+        zip_iterator( FirstIterator first, SecondIterator second ):
+        m_Index( static_cast< difference_type >( first.getIndex( ) ) ), m_First( first ), m_Second( second ) { }
+
+        zip_iterator< FirstIterator, SecondIterator >& operator= ( const zip_iterator< FirstIterator, SecondIterator >& rhs )
+        {
+            if( this == &rhs )
+                return *this;
+
+            m_First = rhs.m_First;
+            m_Second = rhs.m_Second;
+            m_Index = rhs.m_Index;
+            return *this;
+        }
+
+        zip_iterator< FirstIterator, SecondIterator >& operator+= ( const difference_type & n )
+        {
+            advance( n );
+            return *this;
+        }
+
+        const zip_iterator< FirstIterator, SecondIterator > operator+ ( const difference_type & n ) const
+        {
+            zip_iterator< FirstIterator, SecondIterator > result( *this );
+            result.advance( n );
+            return result;
+        }
+
+        const zip_iterator< FirstIterator, SecondIterator > operator- ( const difference_type & n ) const
+        {
+            zip_iterator< FirstIterator, SecondIterator > result( *this );
+            result.advance( -n );
+            return result;
+        }
+
+        const zip_iterator< FirstIterator, SecondIterator > & getContainer( ) const
+        {
+            return *this;
+        }
+
+        difference_type operator- ( const zip_iterator< FirstIterator, SecondIterator >& rhs ) const
+        {
+            return m_Index - rhs.m_Index;
+        }
+
+        //  Public member variables
+        difference_type m_Index;
+
+        //  Used for templatized copy constructor and the templatized equal operator
+        template < typename, typename > friend class zip_iterator;
+
+        void advance( difference_type n )
+        {
+            m_Index += n;
+            m_First += n;
+            m_Second += n;
+        }
+
+        // Pre-increment
+        zip_iterator< FirstIterator, SecondIterator >& operator++ ( )
+        {
+            advance( 1 );
+            return *this;
+        }
+
+        // Post-increment
+        zip_iterator< FirstIterator, SecondIterator > operator++ ( int )
+        {
+            zip_iterator< FirstIterator, SecondIterator > result( *this );
+            advance( 1 );
+            return result;
+        }
+
+        // Pre-decrement
+        zip_iterator< FirstIterator, SecondIterator >& operator--( )
+        {
+            advance( -1 );
+            return *this;
+        }
+
+        // Post-decrement
+        zip_iterator< FirstIterator, SecondIterator > operator--( int )
+        {
+            zip_iterator< FirstIterator, SecondIterator > result( *this );
+            advance( -1 );
+            return result;
+        }
+
+        difference_type getIndex() const
+        {
+            return m_Index;
+        }
+
+        template< typename OtherFirst, typename OtherSecond >
+        bool operator== ( const zip_iterator< OtherFirst, OtherSecond >& rhs ) const
+        {
+          return rhs.m_Index == m_Index;
+        }
+
+        template< typename OtherFirst, typename OtherSecond >
+        bool operator!= ( const zip_iterator< OtherFirst, OtherSecond >& rhs ) const
+        {
+          return rhs.m_Index != m_Index;
+        }
+
+        template< typename OtherFirst, typename OtherSecond >
+        bool operator< ( const zip_iterator< OtherFirst, OtherSecond >& rhs ) const
+        {
+          return m_Index < rhs.m_Index;
+        }
+
+        // Dereference operators, the pair is read by value
+        value_type operator*() const restrict(cpu,amp)
+        {
+          return value_type( *m_First, *m_Second );
+        }
+
+        value_type operator[](int x) const restrict(cpu,amp)
+        {
+          return value_type( m_First[x], m_Second[x] );
+        }
+
+        FirstIterator m_First;
+        SecondIterator m_Second;
+      };
+
+
+  template< typename FirstIterator, typename SecondIterator >
+  zip_iterator< FirstIterator, SecondIterator > make_zip_iterator( FirstIterator first, SecondIterator second )
+  {
+      zip_iterator< FirstIterator, SecondIterator > tmp( first, second );
+      return tmp;
+  }
+
+}
+}
+
+
+#endif
@@ -76,14 +76,14 @@ template <typename T1, typename T2>
    *  and \p second using \c first_type & \c second_type's
    *  default constructors, respectively.
    */
-  pair(void);
+  pair(void) restrict(cpu,amp);
 
   /*! This constructor accepts two objects to copy into this \p pair.
    *
    *  \param x The object to copy into \p first.
    *  \param y The object to copy into \p second.
    */
-  pair(const T1 &x, const T2 &y);
+  pair(const T1 &x, const T2 &y) restrict(cpu,amp);
 
   /*! This copy constructor copies from a \p pair whose types are
    *  convertible to this \p pair's \c first_type and \c second_type,
@@ -95,7 +95,7 @@ template <typename T1, typename T2>
    *  \tparam U2 is convertible to \c second_type.
    */
   template <typename U1, typename U2>
-  pair(const pair<U1,U2> &p);
+  pair(const pair<U1,U2> &p) restrict(cpu,amp);
 
   /*! This copy constructor copies from a <tt>std::pair</tt> whose types are
    *  convertible to this \p pair's \c first_type and \c second_type,
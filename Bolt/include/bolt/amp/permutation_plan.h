@@ -0,0 +1,203 @@
+/***************************************************************************       
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.                                     
+*                                                                                    
+*   Licensed under the Apache License, Version 2.0 (the "License");   
+*   you may not use this file except in compliance with the License.                 
+*   You may obtain a copy of the License at                                          
+*                                                                                    
+*       http://www.apache.org/licenses/LICENSE-2.0                      
+*                                                                                    
+*   Unless required by applicable law or agreed to in writing, software              
+*   distributed under the License is distributed on an "AS IS" BASIS,              
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.         
+*   See the License for the specific language governing permissions and              
+*   limitations under the License.                                                   
+
+***************************************************************************/
+
+#if !defined( BOLT_AMP_PERMUTATION_PLAN_H )
+#define BOLT_AMP_PERMUTATION_PLAN_H
+#pragma once
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+#include "bolt/amp/bolt.h"
+#include "bolt/amp/device_vector.h"
+
+/*! \file bolt/amp/permutation_plan.h
+    \brief A map of gather or scatter reordered for contiguous accesses, reusable across calls.
+*/
+
+/*! Default number of destination elements the entries of a permutation_plan are bucketed by */
+#ifndef PERMUTATION_PLAN_SEGMENT_SIZE
+#define PERMUTATION_PLAN_SEGMENT_SIZE 256
+#endif
+
+namespace bolt {
+    namespace amp {
+
+        /*! \addtogroup algorithms
+         */
+
+        /*! \addtogroup AMP-gather
+        *   \ingroup copying
+        *   \{
+        */
+
+        /*! \brief A permutation_plan is the map of a gather or a scatter, reordered once so that the work-items
+         *  executing it access contiguous memory, and kept on the accelerator to be reused by later calls with the
+         *  same map.
+         *
+         *  \details With a random map, the work-items of gather read their input, and those of scatter write their
+         *  result, in random order: neighbouring work-items touch different cache lines. The plan pairs each source
+         *  index with its destination index, buckets the pairs by segments of \p segment destination elements, and
+         *  sorts the pairs of each segment by source. The work-items of a wavefront then write within a segment of
+         *  the destination, and read the source in increasing order. Building the plan sorts the map on the host, so
+         *  it pays off when the same map is gathered or scattered several times, as in iterative sparse solvers.
+         *
+         *  \code
+         *  #include <bolt/amp/gather.h>
+         *
+         *  std::vector< int > map( ... ), input( ... ), result( map.size( ) );
+         *  bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Gather, map.begin( ), map.end( ) );
+         *  for( int iter = 0; iter < iterations; ++iter )
+         *  {
+         *      // same as bolt::amp::gather( map.begin( ), map.end( ), input.begin( ), result.begin( ) )
+         *      bolt::amp::gather( plan, input.begin( ), result.begin( ) );
+         *      ...
+         *  }
+         *  \endcode
+         */
+        class permutation_plan
+        {
+        public:
+            /*! \brief Whether the map is the one of gather or of scatter. */
+            enum e_PlanKind { Gather, Scatter };
+
+            /*! \brief Builds the plan of the map [map_first, map_last).
+             *
+             *  \param kind Gather if result[ i ] = input[ map[ i ] ], Scatter if result[ map[ i ] ] = input[ i ].
+             *  \param map_first The beginning of the map sequence.
+             *  \param map_last The end of the map sequence.
+             *  \param segment The number of destination elements the pairs are bucketed by.
+             *  \param ctl \b Optional Control structure, the plan is kept on its accelerator.
+             */
+            template< typename MapIterator >
+            permutation_plan( e_PlanKind kind,
+                              MapIterator map_first,
+                              MapIterator map_last,
+                              int segment = PERMUTATION_PLAN_SEGMENT_SIZE,
+                              control& ctl = control::getDefault( ) )
+                : m_Kind( kind ), m_Segment( segment > 0 ? segment : 1 ), m_SourceExtent( 0 ), m_DestinationExtent( 0 )
+            {
+                std::vector< int > map( map_first, map_last );
+                const int szElements = static_cast< int >( map.size( ) );
+
+                // ( destination, source ) pairs
+                std::vector< std::pair< int, int > > entries( szElements );
+                for( int i = 0; i < szElements; ++i )
+                    entries[ i ] = ( kind == Gather ) ? std::make_pair( i, map[ i ] ) : std::make_pair( map[ i ], i );
+
+                const int seg = m_Segment;
+                std::sort( entries.begin( ), entries.end( ),
+                           [ seg ]( const std::pair< int, int >& a, const std::pair< int, int >& b )
+                           {
+                               if( a.first / seg != b.first / seg )
+                                   return a.first / seg < b.first / seg;
+                               if( a.second != b.second )
+                                   return a.second < b.second;
+                               return a.first < b.first;
+                           } );
+
+                m_Sources.resize( szElements );
+                m_Destinations.resize( szElements );
+                for( int i = 0; i < szElements; ++i )
+                {
+                    m_Destinations[ i ] = entries[ i ].first;
+                    m_Sources[ i ] = entries[ i ].second;
+                    m_DestinationExtent = std::max( m_DestinationExtent, entries[ i ].first + 1 );
+                    m_SourceExtent = std::max( m_SourceExtent, entries[ i ].second + 1 );
+                }
+
+                if( szElements > 0 )
+                {
+                    concurrency::accelerator_view av = ctl.getAccelerator( ).get_default_view( );
+                    concurrency::extent< 1 > ext( szElements );
+                    m_DeviceSources.reset( new concurrency::array< int, 1 >( ext, m_Sources.begin( ), m_Sources.end( ), av ) );
+                    m_DeviceDestinations.reset( new concurrency::array< int, 1 >( ext, m_Destinations.begin( ), m_Destinations.end( ), av ) );
+                }
+            }
+
+            /*! \brief Whether the plan is the one of a gather or of a scatter map. */
+            e_PlanKind getKind( ) const
+            {
+                return m_Kind;
+            }
+
+            /*! \brief The number of elements of the map. */
+            int getSize( ) const
+            {
+                return static_cast< int >( m_Sources.size( ) );
+            }
+
+            /*! \brief The number of destination elements the pairs are bucketed by. */
+            int getSegment( ) const
+            {
+                return m_Segment;
+            }
+
+            /*! \brief The number of source elements read, one past the largest source index. */
+            int getSourceExtent( ) const
+            {
+                return m_SourceExtent;
+            }
+
+            /*! \brief The number of destination elements written, one past the largest destination index. */
+            int getDestinationExtent( ) const
+            {
+                return m_DestinationExtent;
+            }
+
+            /*! \brief The source index of each pair on the host, in the order they are copied. */
+            const std::vector< int >& getSources( ) const
+            {
+                return m_Sources;
+            }
+
+            /*! \brief The destination index of each pair on the host, in the order they are copied. */
+            const std::vector< int >& getDestinations( ) const
+            {
+                return m_Destinations;
+            }
+
+            /*! \brief The source indices on the accelerator, the plan must not be empty. */
+            concurrency::array< int, 1 >& getDeviceSources( ) const
+            {
+                return *m_DeviceSources;
+            }
+
+            /*! \brief The destination indices on the accelerator, the plan must not be empty. */
+            concurrency::array< int, 1 >& getDeviceDestinations( ) const
+            {
+                return *m_DeviceDestinations;
+            }
+
+        private:
+            e_PlanKind m_Kind;
+            int m_Segment;
+            int m_SourceExtent;
+            int m_DestinationExtent;
+            std::vector< int > m_Sources;
+            std::vector< int > m_Destinations;
+            std::unique_ptr< concurrency::array< int, 1 > > m_DeviceSources;
+            std::unique_ptr< concurrency::array< int, 1 > > m_DeviceDestinations;
+        };
+
+        /*!   \}  */
+    };
+};
+
+#include <bolt/amp/detail/permutation_plan.inl>
+#endif
@@ -23,72 +23,148 @@
 
 
 #include <amp.h>
+#include <cassert>
+#include <list>
+#include <mutex>
 #pragma once
 
+// elements of the smallest size class of the arrays of a pool, size classes are powers of 2
+#define BOLT_POOL_MIN_ELEMENTS 64
+// bytes of free arrays kept by the pool of each type, the arrays freed over it are deleted
+#define BOLT_POOL_FREE_LIMIT (64 * 1024 * 1024)
+
 namespace bolt {
 
-	// FIXME - this bool should be independent of type, should just allocate raw bytes.
+	/*! Pool of the device arrays, and their staging arrays on the cpu accelerator, of a type: alloc reserves
+	 *  a free entry of the accelerator_view and size class of the request, or creates one, and free gives it
+	 *  back for the next requests. Size classes are powers of 2, so the arrays of an entry are at least as
+	 *  large as requested. Entries are reserved and freed under a lock, so threads can share a pool.
+	 */
 	template<typename T>
 	class ArrayPool {
 	public:
 		struct PoolEntry {
 			enum State {e_New, e_Created, e_Reserved};
-			PoolEntry() : _state(e_New), _dBuffer(NULL), _stagingBuffer(NULL) {};
+			PoolEntry(concurrency::accelerator_view av, int size)
+				: _state(e_New), _dBuffer(NULL), _stagingBuffer(NULL), _av(av), _size(size) {};
 
 			State _state;
 			concurrency::array<T> *_dBuffer;	// storage on accelerator
 			concurrency::array<T> *_stagingBuffer;
+			concurrency::accelerator_view _av;
+			int _size;	// elements of the arrays, a size class
+		};
+
+		ArrayPool() : _freeBytes(0) {};
+
+		~ArrayPool()
+		{
+			for (typename std::list<PoolEntry>::iterator it = pool.begin(); it != pool.end(); ++it)
+				destroy(*it);
+		};
+
+		// pool of the type shared by the Bolt algorithms, never destroyed as the runtime may be gone at exit
+		static ArrayPool &get()
+		{
+			static ArrayPool *_pool = new ArrayPool();
+			return *_pool;
 		};
 
-		PoolEntry &alloc(concurrency::accelerator_view av,  int size)
+		// an entry of at least size elements on av, with a staging array unless only the device array is used
+		PoolEntry &alloc(concurrency::accelerator_view av, int size, bool staging = true)
 		{
 			using namespace concurrency;
-			// FIXME - need atomic acccess here to make this thread-safe
-			if (pool[0]._state == PoolEntry::e_New) {
-				pool[0]._state =  PoolEntry::e_Reserved;
+			int sizeClass = BOLT_POOL_MIN_ELEMENTS;
+			while (sizeClass < size)
+				sizeClass *= 2;
+
+			{
+				std::lock_guard<std::mutex> l(_lock);
+				for (typename std::list<PoolEntry>::iterator it = pool.begin(); it != pool.end(); ++it) {
+					if (it->_state == PoolEntry::e_Created && it->_size == sizeClass && it->_av == av &&
+						(!staging || it->_stagingBuffer != NULL)) {
+						it->_state = PoolEntry::e_Reserved;
+						_freeBytes -= bytes(*it);
+						return *it;
+					}
+				}
+			}
+
+			// the arrays are created out of the lock, the entry is not in the pool yet
+			PoolEntry entry(av, sizeClass);
+			if (staging) {
 				accelerator cpuAccelerator = accelerator(accelerator::cpu_accelerator);
-				pool[0]._stagingBuffer =  new  array<T,1>(size, cpuAccelerator.default_view, av);  // cpu memory
-				pool[0]._dBuffer =  new  concurrency::array<T,1>(size, av);
-			} else if ( pool[0]._state == PoolEntry::e_Reserved) {
-				throw("OclBufferpool[0] full!");
+				entry._stagingBuffer = new array<T,1>(sizeClass, cpuAccelerator.get_default_view(), av);  // cpu memory
 			}
+			entry._dBuffer = new array<T,1>(sizeClass, av);
+			entry._state = PoolEntry::e_Reserved;
 
-			pool[0]._state = PoolEntry::e_Reserved;
-			return pool[0];
+			std::lock_guard<std::mutex> l(_lock);
+			pool.push_back(entry);
+			return pool.back();
 		};
 
-#if 0
-		concurrency::array<T,1> &alloc(int size)
+		void free(PoolEntry &poolEntry)
 		{
-			// FIXME - need atomic acccess here to make this thread-safe
-			if (pool[0]._state == PoolEntry::e_New) {
-				pool[0]._state =  PoolEntry::e_Reserved;
-				pool[0]._dBuffer =  new  concurrency::array<T,1>(size);
-			} else if ( pool[0]._state == PoolEntry::e_Reserved) {
-				throw("OclBufferpool[0] full!");
-			}
+			std::lock_guard<std::mutex> l(_lock);
+			assert (poolEntry._state == PoolEntry::e_Reserved);
+			poolEntry._state = PoolEntry::e_Created;
+			_freeBytes += bytes(poolEntry);
 
-			pool[0]._state = PoolEntry::e_Reserved;
-			return *(pool[0]._dBuffer);
+			// delete the largest free entries while too much memory is kept
+			while (_freeBytes > BOLT_POOL_FREE_LIMIT) {
+				typename std::list<PoolEntry>::iterator largest = pool.end();
+				for (typename std::list<PoolEntry>::iterator it = pool.begin(); it != pool.end(); ++it) {
+					if (it->_state == PoolEntry::e_Created && (largest == pool.end() || bytes(*it) > bytes(*largest)))
+						largest = it;
+				}
+				_freeBytes -= bytes(*largest);
+				destroy(*largest);
+				pool.erase(largest);
+			}
 		};
 
-		void free(/*cl::Buffer m*/)
+	private:
+		std::mutex _lock;
+		std::list<PoolEntry> pool;	// entries are never moved, so the references alloc returns stay valid
+		size_t _freeBytes;
+
+		static size_t bytes(const PoolEntry &poolEntry)
 		{
-			// FIXME , need to find the entry, etc.
-			assert (pool[0]._state == PoolEntry::e_Reserved);
-			pool[0]._state = PoolEntry::e_Created;
+			size_t arrays = (poolEntry._stagingBuffer != NULL) ? 2 : 1;
+			return arrays * poolEntry._size * sizeof(T);
 		};
-#endif
 
-		void free(PoolEntry &poolEntry)
+		static void destroy(PoolEntry &poolEntry)
 		{
-			// FIXME , need to find the entry, etc.
-			assert (poolEntry._state == PoolEntry::e_Reserved);
-			poolEntry._state = PoolEntry::e_Created;
+			delete poolEntry._dBuffer;
+			delete poolEntry._stagingBuffer;
+			poolEntry._dBuffer = NULL;
+			poolEntry._stagingBuffer = NULL;
 		};
 
+		ArrayPool(const ArrayPool &);
+		ArrayPool &operator=(const ArrayPool &);
+	};
+
+	/*! Temporary device array of a Bolt algorithm, drawn from the pool of its type and given back to it when
+	 *  it's destroyed, so kernels using it have to be done by then. The array may be larger than requested.
+	 */
+	template<typename T>
+	class PooledArray {
+	public:
+		PooledArray(concurrency::accelerator_view av, int size)
+			: _entry(ArrayPool<T>::get().alloc(av, size, false)) {};
+
+		~PooledArray() { ArrayPool<T>::get().free(_entry); };
+
+		concurrency::array<T> &array() { return *_entry._dBuffer; };
+
 	private:
-		PoolEntry pool[1];
+		typename ArrayPool<T>::PoolEntry &_entry;
+
+		PooledArray(const PooledArray &);
+		PooledArray &operator=(const PooledArray &);
 	};
 };
 
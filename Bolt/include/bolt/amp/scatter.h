@@ -20,6 +20,7 @@
 #pragma once
 
 #include "bolt/amp/device_vector.h"
+#include "bolt/amp/permutation_plan.h"
 
 
 /*! \file bolt/amp/scatter.h
@@ -90,6 +91,47 @@ namespace bolt {
                       InputIterator2 map,
                       OutputIterator result );
 
+       /*! \brief This version of \p scatter copies elements from a source range to a destination array according to
+         * the map a permutation_plan was built from, for maps scattered several times. The work-items copy the
+         * elements in the order of the plan, so that they read and write contiguous memory. The source range has
+         * as many elements as the map.
+         *
+         * \param ctl \b Optional Control structure to control command-queue, debug, tuning, etc.See bolt::amp::control.
+         * \param plan A permutation_plan of kind permutation_plan::Scatter.
+         * \param first The beginning of input sequence.
+         * \param result The beginning of the output sequence.
+         *  \tparam InputIterator is a model of InputIterator
+         *  \tparam OutputIterator is a model of OutputIterator
+         *
+         *  \details The following code snippet demonstrates how to use \p scatter with a plan
+         *
+         *  \code
+         *  #include <bolt/amp/scatter.h>
+         *
+         *  int input[10] = {5, 7, 2, 3, 12, 6, 9, 8, 1, 4};
+         *  int map[10] = {8, 2, 3, 9, 0, 5, 1, 7, 6, 4};
+         *  int output[10];
+         *  bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Scatter, map, map + 10 );
+         *  bolt::amp::scatter(plan, input, output);
+         *
+         *  // output is now {12, 9, 7, 2, 4, 6, 1, 8, 5, 3};
+         *  \endcode
+         *
+         */
+
+        template< typename InputIterator,
+                  typename OutputIterator >
+        void scatter( ::bolt::amp::control &ctl,
+                      const permutation_plan& plan,
+                      InputIterator first,
+                      OutputIterator result );
+
+        template< typename InputIterator,
+                  typename OutputIterator >
+        void scatter( const permutation_plan& plan,
+                      InputIterator first,
+                      OutputIterator result );
+
        /*! \brief This version of \p scatter_if copies elements from a source range to a destination array according to a
          * specified map. For each \p i in \p InputIterator1 in the range \p [first, last), scatter_if copies
          * the corresponding \p input_first to result[ map [ i ] ] if stencil[ i - first ] is
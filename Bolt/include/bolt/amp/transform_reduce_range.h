@@ -27,21 +27,13 @@
 #include <bolt/transform_reduce.h>
 
 
-#ifdef BOLT_POOL_ALLOC
-#include <bolt/pool_alloc.h>
-// hacky global var, move to bolt.cpp?
-bolt::ArrayPool<HessianState> arrayPool;
-#endif
+#include <bolt/amp/pool_alloc.h>
+#include <bolt/amp/detail/tile_reduce.inl>
 
 namespace bolt {
 	namespace amp {
 
 #define VW 1
-#define BARRIER(W)  // FIXME - placeholder for future barrier insertions
-
-#define REDUCE_STEP(_IDX, _W) \
-	if (_IDX < _W) tiled_data[_IDX] = reduce_op(tiled_data[_IDX], tiled_data[_IDX+_W]); \
-	BARRIER(_W)
 
 
 	//=======================
@@ -51,6 +43,7 @@ namespace bolt {
 	// May avoid copies on some compilers and deliver higher performance than the cleaner transform_reduce function,
 	// where transform op only takes a single index point.
 	// Useful for indexing over all points in an image or array
+	// The results of the tiles are reduced on the device by the last tile to be done, in the same dispatch.
 	template<typename outputT, int Rank, typename UnaryFunction, typename BinaryFunction>
 	outputT transform_reduce_range(concurrency::accelerator_view av,
 		concurrency::index<Rank> origin, concurrency::extent<Rank> ext,
@@ -61,7 +54,6 @@ namespace bolt {
 
 		int wgPerComputeUnit = p_wgPerComputeUnit; // remove me.
 		int computeUnits     = p_computeUnits;
-		int resultCnt = computeUnits * wgPerComputeUnit;
 
 		// FIXME: implement a more clever algorithm for setting the shape of the calculation.
 		int globalH = wgPerComputeUnit * localH;
@@ -72,75 +64,36 @@ namespace bolt {
 
 
 		extent<2> launchExt(globalH, globalW);
-#ifdef BOLT_POOL_ALLOC
-		bolt::ArrayPool<outputT>::PoolEntry &entry = arrayPool.alloc(av, resultCnt);
-		array<outputT,1> &results1 = *(entry._dBuffer);
-#else
-		array<outputT,1> results1(resultCnt, av);  // Output after reducing through LDS.
-#endif
+		int tilesW = globalW / localW;
+		int resultCnt = (globalH / localH) * tilesW;
+		bolt::PooledArray<outputT> partialsPool(av, resultCnt);
+		array<outputT,1> &partials = partialsPool.array();  // Output after reducing through LDS.
+		unsigned int noneDone = 0;
+		array<unsigned int,1> done(1, &noneDone, av);
+		array<outputT,1> result(1, av);
 		index<2> bottomRight(origin[0]+ext[0], origin[1]+ext[1]);
 
-		// FIXME - support actual BARRIER operations.
 		// FIXME - support checks on local memory usage
 		// FIXME - reduce size of work for small problems.
-		concurrency::parallel_for_each(av,  launchExt.tile<localH, localW>(), [=,&results1](concurrency::tiled_index<localH, localW> idx) mutable restrict(amp)
+		concurrency::parallel_for_each(av,  launchExt.tile<localH, localW>(), [=,&partials,&done,&result](concurrency::tiled_index<localH, localW> idx) mutable restrict(amp)
 		{
 			tile_static outputT tiled_data[waveSize];
+			tile_static unsigned int isLast;
 
-#if 1
-			init = reduce_op(init, transform_op(index<Rank>(origin[0]+idx.global[0], origin[1]+idx.global[1]),  //top/left
+			outputT value = reduce_op(init, transform_op(index<Rank>(origin[0]+idx.global[0], origin[1]+idx.global[1]),  //top/left
 				bottomRight,  // bottomRight
 				launchExt));  //stride
-#endif
-
-#if 0
-			for (int y=origin[0]+idx.global[0]; y<origin[0]+ext[0]; y+=launchExt[0]) {
-				for (int x=origin[1]+idx.global[1]*VW; x<origin[1]+ext[1]; x+=launchExt[1]*VW) {
-					init = reduce_op(init, transform_op(concurrency::index<Rank>(y,x)));
-				};
-			};
-#endif
 
 			//---
-			// Reduce through LDS across wavefront:
+			// Reduce the tile through shuffles or LDS, then the results of all the tiles
 			int lx = localW * idx.local[0] + idx.local[1];
-			tiled_data[lx] = init;
-			BARRIER(waveSize);
-
-			REDUCE_STEP(lx, 32);
-			REDUCE_STEP(lx, 16);
-			REDUCE_STEP(lx, 8);
-			REDUCE_STEP(lx, 4);
-			REDUCE_STEP(lx, 2);
-			REDUCE_STEP(lx, 1);
-
-			//---
-			// Save result of this tile to global mem
-			if (lx== 0) {
-				results1[idx.tile[0]*computeUnits + idx.tile[1]] = tiled_data[0];
-			};
+			detail::tile_reduce_and_finish< waveSize >( idx.barrier, lx, idx.tile[0]*tilesW + idx.tile[1],
+				tiled_data, isLast, value, waveSize, init, reduce_op, resultCnt, partials, done, result );
 
 		} );  //end parallel_for_each
-		// results1[] now contains intermediate results which need to be combined together.
-
-		//---
-		//Copy partial array back to host
-		// FIXME - we'd really like to use ZC memory for this final step
-		//std::vector<outputT> h_data(resultCnt);
-		//h_data = results1;
-		concurrency::copy(*entry._dBuffer, *entry._stagingBuffer);
-
-
-
-		outputT finalReduction = init;
-		for (int i=0; i<results1.extent[0]; i++) {
-			finalReduction = reduce_op(finalReduction, (*entry._stagingBuffer)[i]);
-		};
-
-#ifdef BOLT_POOL_ALLOC
-		arrayPool.free(entry);
-#endif
 
+		outputT finalReduction;
+		concurrency::copy(result, &finalReduction);
 		return finalReduction;
 
 	};
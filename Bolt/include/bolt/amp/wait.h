@@ -0,0 +1,148 @@
+/***************************************************************************
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+/*! \file bolt/amp/wait.h
+    \brief Wait mode of the kernels and copies of Bolt algorithms run on the Gpu.
+*/
+#if !defined( BOLT_AMP_WAIT_H )
+#define BOLT_AMP_WAIT_H
+
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "bolt/amp/control.h"
+
+// operations whose recent duration is below it are waited on by spinning with BalancedWait, in microseconds
+#define BOLT_BALANCED_WAIT_SPIN_US 200
+// weight of the last duration in the estimate of the duration of an algorithm, out of 8
+#define BOLT_BALANCED_WAIT_WEIGHT 2
+
+namespace bolt
+{
+namespace amp
+{
+namespace detail
+{
+
+/*! Recent durations of the Gpu runs of the algorithms waited on with control::BalancedWait, grouped by the
+ * algorithm, the accelerator and the size of the input rounded down to a power of 2. Each estimate is a
+ * moving average of the durations of the last runs of a group.
+ */
+class wait_estimates
+{
+public:
+    static wait_estimates& get( )
+    {
+        static wait_estimates estimates;
+        return estimates;
+    }
+
+    // estimate of the duration of a group in microseconds, false when it never ran
+    bool estimate( const std::string& key, double& us )
+    {
+        std::lock_guard< std::mutex > l( m_lock );
+        std::map< std::string, double >::const_iterator it = m_us.find( key );
+        if( it == m_us.end( ) )
+            return false;
+        us = it->second;
+        return true;
+    }
+
+    void update( const std::string& key, double us )
+    {
+        std::lock_guard< std::mutex > l( m_lock );
+        std::map< std::string, double >::iterator it = m_us.find( key );
+        if( it == m_us.end( ) )
+            m_us[ key ] = us;
+        else
+            it->second = ( it->second * ( 8 - BOLT_BALANCED_WAIT_WEIGHT ) + us * BOLT_BALANCED_WAIT_WEIGHT ) / 8;
+    }
+
+private:
+    std::mutex m_lock;
+    std::map< std::string, double > m_us;
+
+    wait_estimates( ) {}
+};
+
+/*! Wait mode of the default view of the accelerator of a control while a Bolt algorithm runs on it, restored
+ * once it's done. NiceWait and ClFinish block on the completion of the kernels and copies, BusyWait spins
+ * on it, and BalancedWait spins on the algorithms whose recent runs took less than BOLT_BALANCED_WAIT_SPIN_US
+ * and blocks on the longer ones, the first run of an algorithm spinning for a short while before it blocks.
+ */
+class scoped_wait_mode
+{
+public:
+    scoped_wait_mode( control& ctl, const char* algorithm, int n )
+        : m_view( ctl.getAccelerator( ).get_default_view( ) ),
+          m_saved( m_view.get_wait_mode( ) ),
+          m_balanced( ctl.getWaitMode( ) == control::BalancedWait )
+    {
+        Concurrency::hcWaitMode mode = Concurrency::hcWaitModeBlocked;
+        if( ctl.getWaitMode( ) == control::BusyWait )
+        {
+            mode = Concurrency::hcWaitModeActive;
+        }
+        else if( m_balanced )
+        {
+            int bucket = 0;
+            while( ( n >> ( bucket + 1 ) ) > 0 )
+                ++bucket;
+            std::wstring path = ctl.getAccelerator( ).get_device_path( );
+            m_key = std::string( algorithm ) + "\t" + std::string( path.begin( ), path.end( ) ) + "\t" +
+                    std::to_string( bucket );
+
+            double us;
+            if( !wait_estimates::get( ).estimate( m_key, us ) )
+                mode = Concurrency::hcWaitModeAdaptive;
+            else if( us < BOLT_BALANCED_WAIT_SPIN_US )
+                mode = Concurrency::hcWaitModeActive;
+            m_start = std::chrono::steady_clock::now( );
+        }
+        m_view.set_wait_mode( mode );
+    }
+
+    ~scoped_wait_mode( )
+    {
+        if( m_balanced )
+        {
+            std::chrono::duration< double, std::micro > us = std::chrono::steady_clock::now( ) - m_start;
+            wait_estimates::get( ).update( m_key, us.count( ) );
+        }
+        m_view.set_wait_mode( m_saved );
+    }
+
+private:
+    Concurrency::accelerator_view m_view;
+    Concurrency::hcWaitMode m_saved;
+    bool m_balanced;
+    std::string m_key;
+    std::chrono::steady_clock::time_point m_start;
+
+    scoped_wait_mode( const scoped_wait_mode& );
+    scoped_wait_mode& operator=( const scoped_wait_mode& );
+};
+
+}
+}
+}
+
+#endif
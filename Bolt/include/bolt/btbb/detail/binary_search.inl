@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
 #include <iterator>
@@ -118,7 +119,7 @@ namespace bolt{
             {
 
                //This allows TBB to choose the number of threads to spawn.
-               tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+               tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
                int n = (int)std::distance(first, last);
 
@@ -133,7 +134,7 @@ namespace bolt{
             {
 
                //This allows TBB to choose the number of threads to spawn.
-               tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+               tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
                int n = (int)std::distance(first, last);
 
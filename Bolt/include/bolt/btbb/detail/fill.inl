@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
 //#include <thread>
@@ -58,7 +59,7 @@ namespace bolt{
              //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
 
              //This allows TBB to choose the number of threads to spawn.
-             tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+             tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
              //Explicitly setting the number of threads to spawn
              //tbb::task_scheduler_init((int) concurentThreadsSupported);
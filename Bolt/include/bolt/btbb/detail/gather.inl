@@ -23,31 +23,41 @@
 #define BOLT_BTBB_GATHER_INL
 #pragma once
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
+#include "bolt/btbb/detail/grain.inl"
 
 namespace bolt 
 {
     namespace btbb
     {
 
+// The map and the result are streamed in chunks sized to the L2, and the input element each map entry
+// reads is prefetched BOLT_TBB_PREFETCH_DISTANCE entries ahead to hide the latency of the irregular reads.
 template<typename InputIterator1,
-         typename InputIterator2, 
+         typename InputIterator2,
          typename OutputIterator>
 
-void gather(InputIterator1 mapfirst, 
+void gather(InputIterator1 mapfirst,
              InputIterator1 maplast,
-             InputIterator2 input, 
+             InputIterator2 input,
              OutputIterator result)
-             { 
-                // std::cout<<"TBB code path...\n";
-                 size_t numElements = static_cast< unsigned int >( std::distance( mapfirst, maplast ) );
-                //This allows TBB to choose the number of threads to spawn.               
-                 tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);       
-                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements),[&](const tbb::blocked_range<size_t>& r)
+             {
+                 typedef typename std::iterator_traits< InputIterator1 >::value_type mType;
+                 typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+                 size_t numElements = static_cast< size_t >( std::distance( mapfirst, maplast ) );
+                 size_t grain = detail::l2_grain( sizeof( mType ) + sizeof( oType ) );
+                //This allows TBB to choose the number of threads to spawn.
+                 tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements,grain),[&](const tbb::blocked_range<size_t>& r)
                   {
                     for(size_t iter = r.begin(); iter!=r.end(); iter++)
-                        *(result + (int)iter) = * (input + (int)mapfirst[(int)iter]); 
+                    {
+                        if(iter + BOLT_TBB_PREFETCH_DISTANCE < r.end())
+                            detail::prefetch( input + mapfirst[iter + BOLT_TBB_PREFETCH_DISTANCE] );
+                        result[iter] = input[mapfirst[iter]];
+                    }
                   });
              }
 
@@ -62,17 +72,21 @@ template<typename InputIterator1,
                   InputIterator3 input,
                   OutputIterator result)
         {
-                 //std::cout<<"TBB code path...\n";
-                 size_t numElements = static_cast< unsigned int >( std::distance( mapfirst, maplast ) );
-                 //This allows TBB to choose the number of threads to spawn.               
-                 tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
-                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements),[&](const tbb::blocked_range<size_t>& r)
+                 typedef typename std::iterator_traits< InputIterator1 >::value_type mType;
+                 typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+                 size_t numElements = static_cast< size_t >( std::distance( mapfirst, maplast ) );
+                 size_t grain = detail::l2_grain( sizeof( mType ) + sizeof( oType ) );
+                 //This allows TBB to choose the number of threads to spawn.
+                 tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements,grain),[&](const tbb::blocked_range<size_t>& r)
                  {
                     for(size_t iter = r.begin(); iter!=r.end(); iter++)
                     {
-                         if(stencil[(int)iter]== 1)	   
-                                 result[(int)iter] = input[mapfirst[(int)iter]];       
-                    }					
+                         if(iter + BOLT_TBB_PREFETCH_DISTANCE < r.end())
+                             detail::prefetch( input + mapfirst[iter + BOLT_TBB_PREFETCH_DISTANCE] );
+                         if(stencil[iter]== 1)
+                                 result[iter] = input[mapfirst[iter]];
+                    }
                 });
         }
 
@@ -90,17 +104,21 @@ template<typename InputIterator1,
                   OutputIterator result,
                   BinaryPredicate pred)
         {
-                 //std::cout<<"TBB code path...\n";
-                 size_t numElements = static_cast< unsigned int >( std::distance( mapfirst, maplast) );
-                 //This allows TBB to choose the number of threads to spawn.               
-                 tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
-                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements),[&](const tbb::blocked_range<size_t>& r)
+                 typedef typename std::iterator_traits< InputIterator1 >::value_type mType;
+                 typedef typename std::iterator_traits< OutputIterator >::value_type oType;
+                 size_t numElements = static_cast< size_t >( std::distance( mapfirst, maplast) );
+                 size_t grain = detail::l2_grain( sizeof( mType ) + sizeof( oType ) );
+                 //This allows TBB to choose the number of threads to spawn.
+                 tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements,grain),[&](const tbb::blocked_range<size_t>& r)
                  {
                     for(size_t iter = r.begin(); iter!=r.end(); iter++)
                     {
-                         if(pred(stencil[(int)iter]))   
-                                  result[(int)iter] = input[mapfirst[(int)iter]]; 						            
-                    }					
+                         if(iter + BOLT_TBB_PREFETCH_DISTANCE < r.end())
+                             detail::prefetch( input + mapfirst[iter + BOLT_TBB_PREFETCH_DISTANCE] );
+                         if(pred(stencil[iter]))
+                                  result[iter] = input[mapfirst[iter]];
+                    }
                 });
         }
 
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
 
@@ -52,7 +53,7 @@ namespace bolt{
             void generate( ForwardIterator first, ForwardIterator last, Generator gen)
             {
                //This allows TBB to choose the number of threads to spawn.
-               tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+               tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
                Generate <ForwardIterator, Generator> generate_obj(gen);
                generate_obj(first, last, gen);
             }       
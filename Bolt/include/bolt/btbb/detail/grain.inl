@@ -0,0 +1,70 @@
+/***************************************************************************
+*   Copyright 2012 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+#if !defined( BOLT_BTBB_GRAIN_INL )
+#define BOLT_BTBB_GRAIN_INL
+#pragma once
+
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#if defined( _MSC_VER )
+#include <xmmintrin.h>
+#endif
+
+// L2 cache of a core, the working set of a TBB task is sized to half of it
+#if !defined( BOLT_TBB_L2_BYTES )
+#define BOLT_TBB_L2_BYTES (256*1024)
+#endif
+// elements ahead an irregular access of gather and scatter is prefetched
+#define BOLT_TBB_PREFETCH_DISTANCE 16
+
+namespace bolt
+{
+    namespace btbb
+    {
+        namespace detail
+        {
+            // Elements of bytesPerElement bytes a task processes so that they fit in half the L2.
+            inline size_t l2_grain( size_t bytesPerElement )
+            {
+                size_t grain = ( BOLT_TBB_L2_BYTES / 2 ) / ( bytesPerElement ? bytesPerElement : 1 );
+                return grain ? grain : 1;
+            }
+
+            // Prefetches the element an iterator points at, if it refers to memory.
+            template< typename Iterator >
+            typename std::enable_if< std::is_reference< typename std::iterator_traits< Iterator >::reference >::value >::type
+            prefetch( const Iterator& it )
+            {
+#if defined( _MSC_VER )
+                _mm_prefetch( reinterpret_cast< const char* >( &*it ), _MM_HINT_T0 );
+#else
+                __builtin_prefetch( &*it );
+#endif
+            }
+
+            template< typename Iterator >
+            typename std::enable_if< !std::is_reference< typename std::iterator_traits< Iterator >::reference >::value >::type
+            prefetch( const Iterator& )
+            {
+            }
+        }
+    }
+}
+
+#endif // BOLT_BTBB_GRAIN_INL
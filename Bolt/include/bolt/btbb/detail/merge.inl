@@ -20,9 +20,12 @@
 #pragma once
 
 
+#include <algorithm>
 #include "tbb/parallel_for.h"
-#include "tbb/parallel_invoke.h"
+#include "tbb/blocked_range.h"
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
+#include "bolt/btbb/detail/grain.inl"
 
 namespace bolt{
     namespace btbb {
@@ -34,83 +37,57 @@ namespace bolt{
 			bool operator()(const T1 &lhs, const T2 &rhs) const  {return (lhs < rhs) ? true:false;}
 		};
 
-            using namespace tbb;
-
-            template<typename InputIterator1 , typename InputIterator2 , typename OutputIterator,
-            typename StrictWeakCompare>
-            struct ParallelMerge {
-                static size_t grainsize;
-                InputIterator1 begin1, end1; // [begin1,end1) is 1st sequence to be merged
-                InputIterator2 begin2, end2; // [begin2,end2) is 2nd sequence to be merged
-                OutputIterator out;               // where to put merged sequence   
-                StrictWeakCompare comp;
-
-                bool empty()   const {return (end1-begin1)+(end2-begin2)==0;}
-                
-                bool is_divisible() const 
-                {
-			
-		  size_t min;
- 		   min = end1-begin1 < end2-begin2?end1-begin1:end2-begin2;
-                    return  min > grainsize;
-                }
-
-
-                ParallelMerge( ParallelMerge& r, split ) 
-                {
-                    if( r.end1-r.begin1 < r.end2-r.begin2 ) {
-                        std::swap(r.begin1,r.begin2);
-                        std::swap(r.end1,r.end2);
-                    }
-                    begin1 = r.begin1 + (r.end1-r.begin1)/2;
-                    begin2 = std::lower_bound( r.begin2, r.end2, *begin1,comp );
-                    end1 = r.end1;
-                    end2 = r.end2;
-                    r.end1 = begin1;
-                    r.end2 = begin2;
-
-                    out = r.out + ( r.end1-r.begin1) + ( r.end2-r.begin2);
-                }
-                ParallelMerge( InputIterator1 begin1_, InputIterator1 end1_, 
-                                    InputIterator2 begin2_, InputIterator2 end2_, 
-                                    OutputIterator out_,StrictWeakCompare _comp ) :
-                    begin1(begin1_), end1(end1_), 
-                    begin2(begin2_), end2(end2_), out(out_),comp(comp)
-                {}
-            };
-
-            template<typename InputIterator1 , typename InputIterator2 , typename OutputIterator,
-            typename StrictWeakCompare>
-            size_t ParallelMerge<InputIterator1,InputIterator2,OutputIterator,
-            StrictWeakCompare>::grainsize = 1000;
-
-            template<typename InputIterator1 , typename InputIterator2 , typename OutputIterator,
-            typename StrictWeakCompare>
-            struct ParallelMergeCode {
-                void operator()( ParallelMerge<InputIterator1,InputIterator2,OutputIterator,
-            StrictWeakCompare> & r ) const {
-                    std::merge( r.begin1, r.end1, r.begin2, r.end2, r.out,r.comp );
-                }
-            };
+        // Number of elements of [begin1, end1) among the first diag elements of their merge with
+        // [begin2, end2), found by a binary search along the diagonal of the merge path, ties
+        // going to the first range like with std::merge.
+        template<typename InputIterator1 , typename InputIterator2 , typename StrictWeakCompare>
+        size_t MergePath( InputIterator1 begin1, size_t n1, InputIterator2 begin2, size_t n2, size_t diag,
+                          StrictWeakCompare comp )
+        {
+            size_t lo = diag > n2 ? diag - n2 : 0;
+            size_t hi = diag < n1 ? diag : n1;
+            while( lo < hi )
+            {
+                size_t mid = ( lo + hi ) / 2;
+                if( !comp( *(begin2 + (diag - 1 - mid)), *(begin1 + mid) ) )
+                    lo = mid + 1;
+                else
+                    hi = mid;
+            }
+            return lo;
+        }
 
+        // Splits the output in chunks which fit in the L2, each chunk merging the part of both ranges
+        // which the merge path says lands in it, so every task gets the same work however the
+        // ranges interleave.
         template<typename InputIterator1 , typename InputIterator2 , typename OutputIterator,
             typename StrictWeakCompare>
-            void PMerge( InputIterator1 begin1, InputIterator1 end1, InputIterator2 begin2, 
-            InputIterator2 end2, OutputIterator out,StrictWeakCompare comp ) 
+            void PMerge( InputIterator1 begin1, InputIterator1 end1, InputIterator2 begin2,
+            InputIterator2 end2, OutputIterator out,StrictWeakCompare comp )
         {
+            typedef typename std::iterator_traits< OutputIterator >::value_type oType;
 
-            tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+            tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
-                parallel_for(     
-                   btbb::ParallelMerge<InputIterator1,InputIterator2,OutputIterator,
-            StrictWeakCompare>(begin1,end1,begin2,end2,out,comp),
-                   btbb::ParallelMergeCode<InputIterator1,InputIterator2,OutputIterator,
-            StrictWeakCompare> (),
-                   simple_partitioner() 
-                );
-
-            }
+            size_t n1 = static_cast< size_t >( end1 - begin1 );
+            size_t n2 = static_cast< size_t >( end2 - begin2 );
+            size_t total = n1 + n2;
+            size_t grain = detail::l2_grain( 2 * sizeof( oType ) );
+            size_t chunks = ( total + grain - 1 ) / grain;
 
+            tbb::parallel_for( tbb::blocked_range< size_t >( 0, chunks ), [&]( const tbb::blocked_range< size_t >& r )
+            {
+                for( size_t c = r.begin( ); c != r.end( ); c++ )
+                {
+                    size_t diag0 = c * grain;
+                    size_t diag1 = ( diag0 + grain < total ) ? diag0 + grain : total;
+                    size_t i0 = MergePath( begin1, n1, begin2, n2, diag0, comp );
+                    size_t i1 = MergePath( begin1, n1, begin2, n2, diag1, comp );
+                    std::merge( begin1 + i0, begin1 + i1, begin2 + (diag0 - i0), begin2 + (diag1 - i1),
+                                out + diag0, comp );
+                }
+            } );
+        }
 
 
 
@@ -131,7 +108,9 @@ namespace bolt{
         InputIterator2 last2, OutputIterator result)
         {
 
-			return merge(first1,last1,first2,last2,result,CompareOp<InputIterator1,InputIterator2>());
+			typedef typename std::iterator_traits< InputIterator1 >::value_type iType1;
+			typedef typename std::iterator_traits< InputIterator2 >::value_type iType2;
+			return btbb::merge(first1,last1,first2,last2,result,CompareOp<iType1,iType2>());
 
 		}
 
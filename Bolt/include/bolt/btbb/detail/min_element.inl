@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
 #include <iterator>
@@ -96,7 +97,7 @@ namespace bolt{
             ForwardIterator min_element(ForwardIterator first, ForwardIterator last, BinaryPredicate binary_op)
             {
 
-               tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+               tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
                Min_Element_comp<ForwardIterator, BinaryPredicate> min_element_op(first, binary_op);
                tbb::parallel_reduce( tbb::blocked_range<ForwardIterator>( first, last), min_element_op );
                return min_element_op.value;
@@ -107,7 +108,7 @@ namespace bolt{
             ForwardIterator max_element(ForwardIterator first, ForwardIterator last, BinaryPredicate binary_op)
             {
 
-              tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+              tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
               Max_Element_comp<ForwardIterator, BinaryPredicate> max_element_op(first, binary_op);
               tbb::parallel_reduce( tbb::blocked_range<ForwardIterator>( first, last), max_element_op );
               return max_element_op.value;  
@@ -70,7 +70,7 @@ namespace bolt{
             BinaryFunction binary_op)
         {
             typedef typename std::iterator_traits<InputIterator>::value_type iType;
-            //tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+            //tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
 			//Gets the number of concurrent threads supported by the underlying platform
             //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include <iterator>
 #include "tbb/blocked_range.h"
 #include "tbb/parallel_for.h"
@@ -194,7 +195,7 @@ template<
 		unsigned int numElements = static_cast< unsigned int >( std::distance( keys_first, keys_last ) );
 		typedef typename std::iterator_traits< InputIterator2 >::value_type vType;
 
-		//tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+		//tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
 		//Gets the number of concurrent threads supported by the underlying platform
         //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
@@ -106,7 +106,7 @@ inclusive_scan(
 
                unsigned int numElements = static_cast< unsigned int >( std::distance( first, last ) );
                typedef typename std::iterator_traits< InputIterator >::value_type iType;
-               //tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+               //tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
 			   //Gets the number of concurrent threads supported by the underlying platform
                //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
@@ -141,7 +141,7 @@ OutputIterator
 
                unsigned int numElements = static_cast< unsigned int >( std::distance( first, last ) );
                typedef typename std::iterator_traits< InputIterator >::value_type iType;
-               //tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+               //tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
 			   //Gets the number of concurrent threads supported by the underlying platform
                //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
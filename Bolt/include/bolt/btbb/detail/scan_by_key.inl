@@ -19,8 +19,10 @@
 #define BOLT_BTBB_SCAN_BY_KEY_INL
 #pragma once
 
-//#include <thread>
-#include "tbb/partitioner.h"
+#include <vector>
+#include "tbb/parallel_for.h"
+#include "tbb/blocked_range.h"
+#include "bolt/btbb/detail/grain.inl"
 
 namespace bolt
 {
@@ -28,103 +30,105 @@ namespace bolt
 	{
 
 
+	  /*! Scan by key in two levels: the range is cut in blocks sized to the L2, the blocks are reduced
+	   * in parallel to the carry of their last segment, the carries are chained serially across the
+	   * blocks, and the blocks are scanned in parallel again starting from the carry of the block
+	   * before them. init starts every segment of an exclusive scan.
+	   */
 	  template <typename InputIterator1, typename InputIterator2, typename OutputIterator,
-				 typename BinaryFunction, typename BinaryPredicate,typename T>
-	  struct ScanKey_tbb{
+				 typename BinaryFunction, typename BinaryPredicate, typename T>
+	  void scan_by_key_two_level( InputIterator1 first_key,
+			InputIterator2 first_value,
+			OutputIterator result,
+		    size_t numElements,
+			const BinaryFunction &binary_op,
+			const BinaryPredicate &binary_pred,
+			bool inclusive,
+			const T &init )
+	  {
+		  typedef typename std::iterator_traits< InputIterator1 >::value_type kType;
 		  typedef typename std::iterator_traits< OutputIterator >::value_type oType;
-		  oType sum;
-		  oType start;
-		  InputIterator1& first_key;
-		  InputIterator2& first_value;
-		  OutputIterator& result;
-		  unsigned int numElements, strt_indx, end_indx;
-		  const BinaryFunction binary_op;
-		  const BinaryPredicate binary_pred;
-		  const bool inclusive;
-		  bool flag, pre_flag, next_flag;
-		  public:
-		  ScanKey_tbb() : sum(0) {}
-		  ScanKey_tbb( InputIterator1&  _first,
-			InputIterator2& first_val,
-			OutputIterator& _result,
-		    unsigned int _numElements,
-			const BinaryFunction &_opr,
-			const BinaryPredicate &_pred,
-			const bool& _incl,
-			const oType &init) : first_key(_first), first_value(first_val), result(_result), numElements(_numElements), binary_op(_opr), binary_pred(_pred),
-							 inclusive(_incl), start(init), flag(false), pre_flag(true),next_flag(false){}
-		  oType get_sum() const {return sum;}
-		  template<typename Tag>
-		  void operator()( const tbb::blocked_range<unsigned int>& r, Tag ) {
-			  oType temp = sum, temp1;
-			  next_flag = flag = false;
-              unsigned int i;
-			  strt_indx = r.begin();
-              end_indx = r.end();
-			  unsigned int rend = r.end();
-			  for( i=r.begin(); i<rend; ++i ) {
-				 if( Tag::is_final_scan() ) {
-					 if(!inclusive){
-						  if( i==0){
-							 temp1 = *(first_value + i);
-							 *(result + i) = start;
-							 temp = binary_op(start, temp1);
-						  }
-						  else if(binary_pred(*(first_key+i), *(first_key +i- 1))){
-							 temp1 = *(first_value + i);
-							 *(result + i) = temp;
-							 temp = binary_op(temp, temp1);
+
+		  if( numElements == 0 )
+			  return;
+
+		  size_t grain = detail::l2_grain( sizeof( kType ) + 2 * sizeof( oType ) );
+		  size_t numBlocks = ( numElements + grain - 1 ) / grain;
+		  std::vector< oType > carries( numBlocks );
+		  std::vector< char > heads( numBlocks, 0 );
+
+		  // value of the last segment of each block, and whether a segment starts in the block
+		  tbb::parallel_for( tbb::blocked_range< size_t >( 0, numBlocks ), [&]( const tbb::blocked_range< size_t >& r )
+		  {
+			  for( size_t b = r.begin( ); b != r.end( ); b++ )
+			  {
+				  size_t first = b * grain;
+				  size_t last = ( first + grain < numElements ) ? first + grain : numElements;
+				  oType sum = *( first_value + first );
+				  bool head = ( first == 0 ) || !binary_pred( *( first_key + first ), *( first_key + ( first - 1 ) ) );
+				  if( head && !inclusive )
+					  sum = binary_op( init, sum );
+				  for( size_t i = first + 1; i < last; i++ )
+				  {
+					  if( binary_pred( *( first_key + i ), *( first_key + ( i - 1 ) ) ) )
+						  sum = binary_op( sum, *( first_value + i ) );
+					  else
+					  {
+						  sum = *( first_value + i );
+						  if( !inclusive )
+							  sum = binary_op( init, sum );
+						  head = true;
+					  }
+				  }
+				  carries[ b ] = sum;
+				  heads[ b ] = head;
+			  }
+		  } );
+
+		  // carry into each block, from the blocks before it back to the last segment start
+		  for( size_t b = 1; b + 1 < numBlocks; b++ )
+		  {
+			  if( !heads[ b ] )
+				  carries[ b ] = binary_op( carries[ b - 1 ], carries[ b ] );
+		  }
+
+		  tbb::parallel_for( tbb::blocked_range< size_t >( 0, numBlocks ), [&]( const tbb::blocked_range< size_t >& r )
+		  {
+			  for( size_t b = r.begin( ); b != r.end( ); b++ )
+			  {
+				  size_t first = b * grain;
+				  size_t last = ( first + grain < numElements ) ? first + grain : numElements;
+				  oType sum = ( b > 0 ) ? carries[ b - 1 ] : oType( );
+				  for( size_t i = first; i < last; i++ )
+				  {
+					  oType value = *( first_value + i );
+					  if( i == 0 || !binary_pred( *( first_key + i ), *( first_key + ( i - 1 ) ) ) )
+					  {
+						  if( inclusive )
+						  {
+							  sum = value;
+							  *( result + i ) = sum;
 						  }
-						  else{
-							 temp1 = *(first_value + i);
-							 *(result + i) = start;
-							 temp = binary_op(start, temp1);
-							 flag = true; 
+						  else
+						  {
+							  *( result + i ) = init;
+							  sum = binary_op( init, value );
 						  }
-						  continue;
-					 }
-					 else if(i == 0 ){
-						temp = *(first_value+i);
-					 }
-					 else if(binary_pred(*(first_key+i), *(first_key +i- 1))) {
-						temp = binary_op(temp, *(first_value+i));
-					 }
-					 else{
-						temp = *(first_value+i);
-						flag = true; 
-					 }
-					 *(result + i) = temp;
-				 }
-				 else if(pre_flag){
-					 temp = *(first_value+i);
-					 pre_flag = false;
-				 }
-				 else if(binary_pred(*(first_key+i), *(first_key +i - 1)))
-					 temp = binary_op(temp, *(first_value+i));
-				 else if (!inclusive){
-					 temp = binary_op(start, *(first_value+i));
-					 flag = true; 
-				 }
-				 else {
-					 temp = *(first_value+i);
-					 flag = true; 
-				 }
-			 }
-			 if(i<numElements && !binary_pred(*(first_key+i-1), *(first_key +i ))){
-				next_flag = true;     // this will check the key change at boundaries
-			 }
-			 sum = temp;
-		  }
-		  ScanKey_tbb( ScanKey_tbb& b, tbb::split):first_key(b.first_key),result(b.result),
-first_value(b.first_value),numElements(b.numElements),inclusive(b.inclusive),start(b.start),pre_flag(true),binary_op(b.binary_op), binary_pred(b.binary_pred){}
-		  void reverse_join( ScanKey_tbb& a ) {
-			if(!a.next_flag && !flag && binary_pred(*(a.first_key +  a.end_indx),*(first_key+strt_indx))) 
-                  sum = binary_op(a.sum,sum);
-		  }
-		  void assign( ScanKey_tbb& b ) {
-			 sum = b.sum;
-		  }
-   };
+					  }
+					  else if( inclusive )
+					  {
+						  sum = binary_op( sum, value );
+						  *( result + i ) = sum;
+					  }
+					  else
+					  {
+						  *( result + i ) = sum;
+						  sum = binary_op( sum, value );
+					  }
+				  }
+			  }
+		  } );
+	  }
 
 template<typename T>
 struct equal_to
@@ -159,17 +163,8 @@ inclusive_scan_by_key(
 		unsigned int numElements = static_cast< unsigned int >( std::distance( first1, last1 ) );
 		typedef typename std::iterator_traits< InputIterator2 >::value_type vType;
 
-		//tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
-
-		//Gets the number of concurrent threads supported by the underlying platform
-        //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
-		unsigned int concurentThreadsSupported = tbb::task_scheduler_init::default_num_threads();
-	    //Explicitly setting the number of threads to spawn
-        tbb::task_scheduler_init((int) concurentThreadsSupported);
-
-		ScanKey_tbb<InputIterator1, InputIterator2, OutputIterator, BinaryFunction, BinaryPredicate,vType> tbbkey_scan((InputIterator1 &)first1,
-			(InputIterator2&) first2,(OutputIterator &)result, numElements, binary_funct, binary_pred, true, vType());
-		tbb::parallel_scan( tbb::blocked_range<unsigned int>(  0, static_cast< unsigned int >( std::distance( first1, last1 )), 6250), tbbkey_scan, tbb::simple_partitioner());
+		tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+		scan_by_key_two_level( first1, first2, result, numElements, binary_funct, binary_pred, true, vType( ) );
 
 		return result + numElements;
 
@@ -191,7 +186,7 @@ inclusive_scan_by_key(
 	BinaryPredicate binary_pred)
 	{
 		typedef typename std::iterator_traits<OutputIterator>::value_type oType;
-		inclusive_scan_by_key(first1,last1,first2,result,binary_pred,plus<oType>());
+		return inclusive_scan_by_key(first1,last1,first2,result,binary_pred,plus<oType>());
 	}
 
 
@@ -208,7 +203,7 @@ inclusive_scan_by_key(
 	OutputIterator  result)
 	{
 		typedef typename std::iterator_traits<InputIterator1>::value_type kType;
-		inclusive_scan_by_key(first1,last1,first2,result,equal_to<kType>());
+		return inclusive_scan_by_key(first1,last1,first2,result,equal_to<kType>());
 	}
 
 
@@ -231,17 +226,8 @@ exclusive_scan_by_key(
 	{
 		unsigned int numElements = static_cast< unsigned int >( std::distance( first1, last1 ) );
 
-		//tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
-
-		//Gets the number of concurrent threads supported by the underlying platform
-        //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
-		unsigned int concurentThreadsSupported = tbb::task_scheduler_init::default_num_threads();
-	    //Explicitly setting the number of threads to spawn
-        tbb::task_scheduler_init((int) concurentThreadsSupported);
-
-		ScanKey_tbb<InputIterator1, InputIterator2, OutputIterator, BinaryFunction, BinaryPredicate,T> tbbkey_scan((InputIterator1 &)first1,
-			(InputIterator2&) first2,(OutputIterator &)result, numElements, binary_funct, binary_pred, false, init);
-		tbb::parallel_scan( tbb::blocked_range<unsigned int>(  0, static_cast< unsigned int >( std::distance( first1, last1 )), 6250), tbbkey_scan, tbb::simple_partitioner());
+		tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+		scan_by_key_two_level( first1, first2, result, numElements, binary_funct, binary_pred, false, init );
 		return result + numElements;
 
 	}
@@ -263,7 +249,7 @@ exclusive_scan_by_key(
 	{
 
 		typedef typename std::iterator_traits<OutputIterator>::value_type oType;		
-		exclusive_scan_by_key(first1,last1, first2, result, init,binary_pred, plus<oType>());
+		return exclusive_scan_by_key(first1,last1, first2, result, init,binary_pred, plus<oType>());
 	}
 
 
@@ -282,7 +268,7 @@ exclusive_scan_by_key(
 	{
 
 		typedef typename std::iterator_traits<InputIterator1>::value_type kType;
-		exclusive_scan_by_key(first1,last1, first2, result, init,equal_to<kType>());
+		return exclusive_scan_by_key(first1,last1, first2, result, init,equal_to<kType>());
 	}
 
 
@@ -299,7 +285,7 @@ exclusive_scan_by_key(
 	{
 
 		typedef typename std::iterator_traits< InputIterator2 >::value_type vType;
-		exclusive_scan_by_key(first1,last1, first2, result, vType());
+		return exclusive_scan_by_key(first1,last1, first2, result, vType());
 
 
 	}
@@ -24,29 +24,40 @@
 
 #pragma once
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_for.h"
 #include "tbb/blocked_range.h"
+#include "bolt/btbb/detail/grain.inl"
 namespace bolt 
 {
     namespace btbb
     {
 
+// The input and the map are streamed in chunks sized to the L2, and the result element each map entry
+// writes is prefetched BOLT_TBB_PREFETCH_DISTANCE entries ahead to hide the latency of the irregular writes.
 template<typename InputIterator1,
-         typename InputIterator2, 
+         typename InputIterator2,
          typename OutputIterator>
 
-void scatter(InputIterator1 first1, 
+void scatter(InputIterator1 first1,
              InputIterator1 last1,
-             InputIterator2 map, 
+             InputIterator2 map,
              OutputIterator result)
-             { 
-                 int numElements = static_cast< int >( std::distance( first1, last1 ) );
-                 //This allows TBB to choose the number of threads to spawn.               
-                 tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);  
-                 tbb::parallel_for (tbb::blocked_range<int>(0,numElements),[&](const tbb::blocked_range<int>& r)
+             {
+                 typedef typename std::iterator_traits< InputIterator1 >::value_type iType;
+                 typedef typename std::iterator_traits< InputIterator2 >::value_type mType;
+                 size_t numElements = static_cast< size_t >( std::distance( first1, last1 ) );
+                 size_t grain = detail::l2_grain( sizeof( iType ) + sizeof( mType ) );
+                 //This allows TBB to choose the number of threads to spawn.
+                 tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements,grain),[&](const tbb::blocked_range<size_t>& r)
                  {
-                    for(int iter = r.begin(); iter!=r.end(); iter++)
-                             result[*(map+(int)iter)] = first1[(int)iter];
+                    for(size_t iter = r.begin(); iter!=r.end(); iter++)
+                    {
+                        if(iter + BOLT_TBB_PREFETCH_DISTANCE < r.end())
+                            detail::prefetch( result + map[iter + BOLT_TBB_PREFETCH_DISTANCE] );
+                        result[map[iter]] = first1[iter];
+                    }
                  });
              }
 
@@ -61,16 +72,21 @@ template<typename InputIterator1,
                   InputIterator3 stencil,
                   OutputIterator result)
             {
-                 int numElements = static_cast< int >( std::distance( first1, last1 ) );
-                //This allows TBB to choose the number of threads to spawn.               
-                 tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);  
-                 tbb::parallel_for (tbb::blocked_range<int>(0,numElements),[&](const tbb::blocked_range<int>& r)
+                 typedef typename std::iterator_traits< InputIterator1 >::value_type iType;
+                 typedef typename std::iterator_traits< InputIterator2 >::value_type mType;
+                 size_t numElements = static_cast< size_t >( std::distance( first1, last1 ) );
+                 size_t grain = detail::l2_grain( sizeof( iType ) + sizeof( mType ) );
+                //This allows TBB to choose the number of threads to spawn.
+                 tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements,grain),[&](const tbb::blocked_range<size_t>& r)
                  {
-                    for(int iter = r.begin(); iter!=r.end(); iter++)
+                    for(size_t iter = r.begin(); iter!=r.end(); iter++)
                     {
+                        if(iter + BOLT_TBB_PREFETCH_DISTANCE < r.end())
+                            detail::prefetch( result + map[iter + BOLT_TBB_PREFETCH_DISTANCE] );
                         if(stencil[iter] == 1)
-                            result[*(map+(int)iter)] = first1[(int)iter];
-                    }                            
+                            result[map[iter]] = first1[iter];
+                    }
                  });
            }
 
@@ -88,16 +104,21 @@ template<typename InputIterator1,
                   OutputIterator result,
                   BinaryPredicate pred)
            {
-			     int numElements = static_cast< int >( std::distance( first1, last1 ) );
-                //This allows TBB to choose the number of threads to spawn.               
-                 tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);  
-                 tbb::parallel_for (tbb::blocked_range<int>(0,numElements),[&](const tbb::blocked_range<int>& r)
+                 typedef typename std::iterator_traits< InputIterator1 >::value_type iType;
+                 typedef typename std::iterator_traits< InputIterator2 >::value_type mType;
+                 size_t numElements = static_cast< size_t >( std::distance( first1, last1 ) );
+                 size_t grain = detail::l2_grain( sizeof( iType ) + sizeof( mType ) );
+                //This allows TBB to choose the number of threads to spawn.
+                 tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
+                 tbb::parallel_for (tbb::blocked_range<size_t>(0,numElements,grain),[&](const tbb::blocked_range<size_t>& r)
                  {
-                    for(int iter = r.begin(); iter!=r.end(); iter++)
+                    for(size_t iter = r.begin(); iter!=r.end(); iter++)
                     {
-                       if(pred(stencil[(int)iter]))
-                            result[*(map+((int)iter))] = first1[(int)iter];
-                    }                            
+                        if(iter + BOLT_TBB_PREFETCH_DISTANCE < r.end())
+                            detail::prefetch( result + map[iter + BOLT_TBB_PREFETCH_DISTANCE] );
+                        if(pred(stencil[iter]))
+                            result[map[iter]] = first1[iter];
+                    }
                  });
             }
 
@@ -29,7 +29,7 @@ namespace bolt {
             RandomAccessIterator last)
         {
 
-        tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+        tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
         tbb::parallel_sort(first,last);
         }
 
@@ -39,7 +39,7 @@ namespace bolt {
             StrictWeakOrdering comp)
         {
 
-        tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+        tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
         tbb::parallel_sort(first,last, comp);
 
         }
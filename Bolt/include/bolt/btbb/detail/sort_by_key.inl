@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 //#include <thread>
 #include <iterator>
 
@@ -186,7 +187,7 @@ namespace bolt{
                 //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
 
                 //This allows TBB to choose the number of threads to spawn.
-                tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+                tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
                 //Explicitly setting the number of threads to spawn
                 //tbb::task_scheduler_init((int) concurentThreadsSupported);
@@ -203,7 +204,7 @@ namespace bolt{
                 //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
 
                 //This allows TBB to choose the number of threads to spawn.
-                tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+                tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
                 //Explicitly setting the number of threads to spawn
                 //tbb::task_scheduler_init((int) concurentThreadsSupported);
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_invoke.h"
 #include <iterator>
 
@@ -106,7 +107,7 @@ namespace bolt{
            void stable_sort(RandomAccessIterator first, RandomAccessIterator last)
            {
                 //This allows TBB to choose the number of threads to spawn.
-                tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+                tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
                 StableSort <RandomAccessIterator > stable_sort_op;
                 stable_sort_op(first, last);
            }
@@ -115,7 +116,7 @@ namespace bolt{
            void stable_sort(RandomAccessIterator first, RandomAccessIterator last, StrictWeakOrdering comp)
            {
                //This allows TBB to choose the number of threads to spawn.
-                tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic); 			   
+                tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( )); 			   
                 StableSort_comp <RandomAccessIterator, StrictWeakOrdering > stable_sort_op;
                 stable_sort_op(first, last, comp);
            }
@@ -20,6 +20,7 @@
 #pragma once
 
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 #include "tbb/parallel_invoke.h"
 //#include <thread>
 #include <iterator>
@@ -189,7 +190,7 @@ namespace bolt{
                 //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
 
                 //This allows TBB to choose the number of threads to spawn.
-                tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+                tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
                 //Explicitly setting the number of threads to spawn
                 //tbb::task_scheduler_init((int) concurentThreadsSupported);
@@ -206,7 +207,7 @@ namespace bolt{
                 //unsigned int concurentThreadsSupported = std::thread::hardware_concurrency();
 
                 //This allows TBB to choose the number of threads to spawn.
-                tbb::task_scheduler_init initialize(tbb::task_scheduler_init::automatic);
+                tbb::task_scheduler_init initialize(bolt::btbb::detail::thread_count( ));
 
                 //Explicitly setting the number of threads to spawn
                 //tbb::task_scheduler_init((int) concurentThreadsSupported);
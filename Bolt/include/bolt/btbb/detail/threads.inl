@@ -0,0 +1,59 @@
+/***************************************************************************
+*   Copyright 2012 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+#if !defined( BOLT_BTBB_THREADS_INL )
+#define BOLT_BTBB_THREADS_INL
+#pragma once
+
+#include <cstdlib>
+#include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
+
+#if !defined( _MSC_VER )
+// The CPU thread pool of the hcc runtime, when the process is linked with it
+extern "C" unsigned int hcc_cpu_thread_count( ) __attribute__(( weak ));
+#endif
+
+namespace bolt
+{
+    namespace btbb
+    {
+        namespace detail
+        {
+            // Threads the TBB algorithms run on: as many as the CPU kernels of the hcc runtime, which follows the
+            // limits of OpenMP, else BOLT_TBB_THREADS or the OMP_NUM_THREADS of OpenMP, else TBB's choice.
+            inline int thread_count( )
+            {
+#if !defined( _MSC_VER )
+                if( hcc_cpu_thread_count )
+                    return static_cast< int >( hcc_cpu_thread_count( ) );
+#endif
+                const char* names[ ] = { "BOLT_TBB_THREADS", "OMP_NUM_THREADS" };
+                for( int i = 0; i < 2; i++ )
+                {
+                    const char* env = getenv( names[ i ] );
+                    int count = env ? atoi( env ) : 0;
+                    if( count > 0 )
+                        return count;
+                }
+                return bolt::btbb::detail::thread_count( );
+            }
+        }
+    }
+}
+
+#endif // BOLT_BTBB_THREADS_INL
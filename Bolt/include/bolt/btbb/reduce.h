@@ -26,6 +26,7 @@
 #include "tbb/parallel_reduce.h"
 #include "tbb/blocked_range.h"
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 
 
 
@@ -26,6 +26,7 @@
 #include "tbb/parallel_scan.h"
 #include "tbb/blocked_range.h"
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 
 /*! \file bolt/cl/scan.h
     \brief Scan calculates a running sum over a range of values, inclusive or exclusive
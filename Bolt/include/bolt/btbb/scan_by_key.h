@@ -22,6 +22,7 @@
 #include "tbb/parallel_scan.h"
 #include "tbb/blocked_range.h"
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 
 /*! \file bolt/btbb/scan_by_key.h
 	\brief Performs, on a sequence, scan of each sub-sequence as defined by equivalent keys inclusive or exclusive.
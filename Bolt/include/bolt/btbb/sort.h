@@ -21,6 +21,7 @@
 
 #include "tbb/parallel_sort.h"
 #include "tbb/task_scheduler_init.h"
+#include "bolt/btbb/detail/threads.inl"
 
 
 
@@ -199,6 +199,10 @@ namespace bolt {
          * Program Map - so each kernel is only compiled once
          *****************************************************************/
         /*! \brief This structure ensures that a kernel is compiled only once for specified devices.
+        *   \details The map is shared by all the control objects of a process. If the BOLT_CL_CACHE_DIR
+        *   environment variable names a directory, the binaries of the programs are also saved there, keyed
+        *   by the device, its driver version, the compile options and the source, and loaded by the next
+        *   processes instead of compiling the source again.
         */
         struct ProgramMapKey
         {
@@ -54,6 +54,10 @@ class statTimer
 	clkVector	clkStart;
 	std::vector< clkVector >	clkTicks;
 
+	//	Device execution time of the samples, in nanoseconds, taken from the begin and end
+	//	timestamps of the asynchronous operations; kept apart from clkTicks, which is host time.
+	std::vector< clkVector >	devTicks;
+
 	//	How many clockticks in a second.
 	ulong	clkFrequency;
 
@@ -103,6 +107,11 @@ class statTimer
 	 */
 	void AddSample( const size_t id, const ulong n );
 
+	//	Mean and std. dev. of the samples of an event, and the pruning of its outliers
+	static double mean( const clkVector& clks );
+	static double stdDev( const clkVector& clks );
+	static size_t prune( clkVector& clks, double multiple );
+
 public:
 	/**
 	 * \fn getInstance()
@@ -125,6 +134,28 @@ public:
 	 */
 	void Stop( size_t id );
 
+	/**
+	 * \fn bool AddDeviceSample( size_t id, ulong beginTick, ulong endTick, ulong tickFrequency )
+	 * \brief Add the device execution time of an asynchronous operation, from its begin and end
+	 *	timestamps in ticks of tickFrequency Hz.  The host time of the same sample is still taken
+	 *	with Start() and Stop().
+	 * \return false if the operation has no timestamps, e.g. it was not profiled
+	 */
+	bool AddDeviceSample( size_t id, ulong beginTick, ulong endTick, ulong tickFrequency );
+
+	/**
+	 * \fn bool AddDeviceSample( size_t id, Future& future )
+	 * \brief Add the device execution time of a completed hc::completion_future.  Only the kernel
+	 *	dispatches of accelerator views with a profiling period have timestamps, see
+	 *	hc::accelerator_view::set_profiling_period().
+	 *	This is a template so this header doesn't depend on hc.hpp.
+	 */
+	template< typename Future >
+	bool AddDeviceSample( size_t id, Future& future )
+	{
+		return AddDeviceSample( id, future.get_begin_tick( ), future.get_end_tick( ), future.get_tick_frequency( ) );
+	}
+
 	/**
 	 * \fn void Reset(void)
 	 * \brief Reset the timer to 0
@@ -171,8 +202,36 @@ public:
 	//	Using the stdDev of the entire population (of an id), eliminate those samples that fall
 	//	outside some specified multiple of the stdDev.  This assumes that the population
 	//	form a Gaussian curve.
+	//	The device samples are pruned too, on their own mean and stdDev.
 	size_t pruneOutliers( double multiple );
 	size_t pruneOutliers( size_t id , double multiple );
+
+	/**
+	 * \fn size_t getDeviceSampleCount(size_t id) const
+	 * \return Return the number of device samples that have been saved.
+	 */
+	size_t getDeviceSampleCount( size_t id ) const;
+
+	/**
+	 * \fn double getAverageDeviceTime(size_t id) const
+	 * \return Return the arithmetic mean of the device samples that have been saved, in seconds,
+	 *	or nanoseconds if convert2seconds( false ).
+	 */
+	double getAverageDeviceTime( size_t id ) const;
+
+	/**
+	 * \fn double getMinimumDeviceTime(size_t id) const
+	 * \return Return the arithmetic min of the device samples that have been saved, in seconds,
+	 *	or nanoseconds if convert2seconds( false ).
+	 */
+	double getMinimumDeviceTime( size_t id ) const;
+
+	/**
+	 * \fn double getAverageHostOverhead(size_t id) const
+	 * \return Return the average host time which is not device execution time, in seconds: the
+	 *	cost of dispatching, copying and waiting.  0 if there are no device samples.
+	 */
+	double getAverageHostOverhead( size_t id ) const;
 };
 
 }
@@ -0,0 +1,224 @@
+/***************************************************************************
+
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+#include "common/stdafx.h"
+
+#include "bolt/amp/batched_reduce.h"
+#include "bolt/amp/batched_scan.h"
+#include "bolt/amp/batched_sort.h"
+
+#include "bolt/unicode.h"
+#include "bolt/miniDump.h"
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <numeric>
+#include "bolt/amp/functional.h"
+#include "common/test_common.h"
+
+// segments of sizes 0, 1, a few and more than a chunk or block, so both the in-tile and cooperative paths run
+static std::vector< int > makeOffsets( )
+{
+    const int sizes[ ] = { 5, 0, 1, 300, 17, 9000, 256, 2048, 4097, 3 };
+    std::vector< int > offsets( 1, 0 );
+    for( int i = 0; i < sizeof( sizes ) / sizeof( sizes[ 0 ] ); i++ )
+        offsets.push_back( offsets.back( ) + sizes[ i ] );
+    return offsets;
+}
+
+static std::vector< int > makeInput( int size )
+{
+    std::vector< int > input( size );
+    for( int i = 0; i < size; i++ )
+        input[ i ] = ( i * 7919 ) % 1013 - 500;
+    return input;
+}
+
+TEST(BatchedReduce, DeviceMemory)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    bolt::amp::device_vector< int > dinput( input.begin( ), input.end( ) );
+    bolt::amp::device_vector< int > doutput( numSegments, 0 );
+
+    bolt::amp::batched_reduce( dinput.begin( ), offsets.begin( ), offsets.end( ), doutput.begin( ), 10,
+                               bolt::amp::plus< int >( ) );
+
+    for( int s = 0; s < numSegments; s++ )
+    {
+        int stdOut = std::accumulate( input.begin( ) + offsets[ s ], input.begin( ) + offsets[ s + 1 ], 10 );
+        EXPECT_EQ( stdOut, doutput[ s ] );
+    }
+}
+
+TEST(BatchedReduce, HostMemory)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    std::vector< int > output( numSegments, 0 );
+
+    bolt::amp::batched_reduce( input.begin( ), offsets.begin( ), offsets.end( ), output.begin( ), 0,
+                               bolt::amp::maximum< int >( ) );
+
+    for( int s = 0; s < numSegments; s++ )
+    {
+        int stdOut = 0;
+        for( int i = offsets[ s ]; i < offsets[ s + 1 ]; i++ )
+            stdOut = std::max( stdOut, input[ i ] );
+        EXPECT_EQ( stdOut, output[ s ] );
+    }
+}
+
+TEST(BatchedScan, Inclusive)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    bolt::amp::device_vector< int > dinput( input.begin( ), input.end( ) );
+    bolt::amp::device_vector< int > doutput( input.size( ), 0 );
+
+    bolt::amp::batched_inclusive_scan( dinput.begin( ), offsets.begin( ), offsets.end( ), doutput.begin( ),
+                                       bolt::amp::plus< int >( ) );
+
+    std::vector< int > stdOut( input.size( ) );
+    for( int s = 0; s < numSegments; s++ )
+        std::partial_sum( input.begin( ) + offsets[ s ], input.begin( ) + offsets[ s + 1 ],
+                          stdOut.begin( ) + offsets[ s ] );
+    for( size_t i = 0; i < input.size( ); i++ )
+        EXPECT_EQ( stdOut[ i ], doutput[ i ] );
+}
+
+TEST(BatchedScan, Exclusive_InPlace)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    std::vector< int > boltInput( input );
+
+    bolt::amp::batched_exclusive_scan( boltInput.begin( ), offsets.begin( ), offsets.end( ), boltInput.begin( ), 3,
+                                       bolt::amp::plus< int >( ) );
+
+    for( int s = 0; s < numSegments; s++ )
+    {
+        int sum = 3;
+        for( int i = offsets[ s ]; i < offsets[ s + 1 ]; i++ )
+        {
+            EXPECT_EQ( sum, boltInput[ i ] );
+            sum += input[ i ];
+        }
+    }
+}
+
+TEST(BatchedSort, DeviceMemory)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    bolt::amp::device_vector< int > dinput( input.begin( ), input.end( ) );
+
+    bolt::amp::batched_sort( dinput.begin( ), offsets.begin( ), offsets.end( ) );
+
+    for( int s = 0; s < numSegments; s++ )
+        std::sort( input.begin( ) + offsets[ s ], input.begin( ) + offsets[ s + 1 ] );
+    for( size_t i = 0; i < input.size( ); i++ )
+        EXPECT_EQ( input[ i ], dinput[ i ] );
+}
+
+TEST(BatchedSort, HostMemory_Greater)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    std::vector< int > boltInput( input );
+
+    bolt::amp::batched_sort( boltInput.begin( ), offsets.begin( ), offsets.end( ), bolt::amp::greater< int >( ) );
+
+    for( int s = 0; s < numSegments; s++ )
+        std::sort( input.begin( ) + offsets[ s ], input.begin( ) + offsets[ s + 1 ], std::greater< int >( ) );
+    cmpArrays( input, boltInput );
+}
+
+TEST(BatchedSort, Serial)
+{
+    std::vector< int > offsets = makeOffsets( );
+    const int numSegments = static_cast< int >( offsets.size( ) ) - 1;
+    std::vector< int > input = makeInput( offsets.back( ) );
+    std::vector< int > boltInput( input );
+
+    bolt::amp::control ctl = bolt::amp::control::getDefault( );
+    ctl.setForceRunMode( bolt::amp::control::SerialCpu );
+    bolt::amp::batched_sort( ctl, boltInput.begin( ), offsets.begin( ), offsets.end( ), bolt::amp::less< int >( ) );
+
+    for( int s = 0; s < numSegments; s++ )
+        std::sort( input.begin( ) + offsets[ s ], input.begin( ) + offsets[ s + 1 ] );
+    cmpArrays( input, boltInput );
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, &argv[ 0 ] );
+
+    //    Set the standard OpenCL wait behavior to help debugging
+    bolt::amp::control& myControl = bolt::amp::control::getDefault( );
+    myControl.setWaitMode( bolt::amp::control::NiceWait );
+    myControl.setForceRunMode( bolt::amp::control::Automatic );  // choose tbb
+
+
+    int retVal = RUN_ALL_TESTS( );
+
+#ifdef BUILD_TBB
+
+    bolt::amp::control& myControl = bolt::amp::control::getDefault( );
+    myControl.setWaitMode( bolt::amp::control::NiceWait );
+    myControl.setForceRunMode( bolt::amp::control::MultiCoreCpu );  // choose tbb
+
+
+    int retVal = RUN_ALL_TESTS( );
+
+#endif
+
+    //  Reflection code to inspect how many tests failed in gTest
+    ::testing::UnitTest& unitTest = *::testing::UnitTest::GetInstance( );
+
+    unsigned int failedTests = 0;
+    for( int i = 0; i < unitTest.total_test_case_count( ); ++i )
+    {
+        const ::testing::TestCase& testCase = *unitTest.GetTestCase( i );
+        for( int j = 0; j < testCase.total_test_count( ); ++j )
+        {
+            const ::testing::TestInfo& testInfo = *testCase.GetTestInfo( j );
+            if( testInfo.result( )->Failed( ) )
+                ++failedTests;
+        }
+    }
+
+    //  Print helpful message at termination if we detect errors, to help users figure out what to do next
+    if( failedTests )
+    {
+        bolt::tout << _T( "\nFailed tests detected in test pass; please run test again with:" ) << std::endl;
+        bolt::tout << _T( "\t--gtest_filter=<XXX> to select a specific failing test of interest" ) << std::endl;
+        bolt::tout << _T( "\t--gtest_catch_exceptions=0 to generate minidump of failing test, or" ) << std::endl;
+        bolt::tout << _T( "\t--gtest_break_on_failure to debug interactively with debugger" ) << std::endl;
+        bolt::tout << _T( "\t    (only on googletest assertion failures, not SEH exceptions)" ) << std::endl;
+    }
+
+    return retVal;
+
+
+}
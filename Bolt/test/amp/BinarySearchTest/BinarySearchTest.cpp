@@ -2123,6 +2123,80 @@ TEST( Kalyantest, SerialNormal1 )
 }
 
 
+// sorted ranges longer and shorter than the cache of samples, with repeated elements
+TEST( VectorizedBounds, DeviceLowerUpperBound )
+{
+    const int sizes[ ] = { 1, 100, 1024, 5000, 1 << 17 };
+    for( int s = 0; s < 5; s++ )
+    {
+        const int length = sizes[ s ];
+        std::vector< int > stdInput( length );
+        for( int i = 0; i < length; i++ )
+            stdInput[ i ] = ( i / 3 ) * 2;
+        std::vector< int > values( 4096 );
+        for( size_t i = 0; i < values.size( ); i++ )
+            values[ i ] = rand( ) % ( length + 10 ) - 5;
+        bolt::amp::device_vector< int > boltInput( stdInput.begin( ), stdInput.end( ) );
+        bolt::amp::device_vector< int > boltValues( values.begin( ), values.end( ) );
+        bolt::amp::device_vector< int > lower( values.size( ), 0 );
+        bolt::amp::device_vector< int > upper( values.size( ), 0 );
+
+        bolt::amp::lower_bound( boltInput.begin( ), boltInput.end( ), boltValues.begin( ), boltValues.end( ), lower.begin( ) );
+        bolt::amp::upper_bound( boltInput.begin( ), boltInput.end( ), boltValues.begin( ), boltValues.end( ), upper.begin( ) );
+
+        for( size_t i = 0; i < values.size( ); i++ )
+        {
+            EXPECT_EQ( std::lower_bound( stdInput.begin( ), stdInput.end( ), values[ i ] ) - stdInput.begin( ), lower[ i ] );
+            EXPECT_EQ( std::upper_bound( stdInput.begin( ), stdInput.end( ), values[ i ] ) - stdInput.begin( ), upper[ i ] );
+        }
+    }
+}
+
+TEST( VectorizedBounds, HostSortedValuesGreater )
+{
+    const int length = 100000;
+    std::vector< float > stdInput( length );
+    for( int i = 0; i < length; i++ )
+        stdInput[ i ] = (float)( rand( ) % 20000 );
+    std::sort( stdInput.begin( ), stdInput.end( ), std::greater< float >( ) );
+    std::vector< float > values( 10000 );
+    for( size_t i = 0; i < values.size( ); i++ )
+        values[ i ] = (float)( rand( ) % 21000 ) - 500.0f;
+    std::vector< int > lower( values.size( ) ), upper( values.size( ) );
+
+    bolt::amp::lower_bound( stdInput.begin( ), stdInput.end( ), values.begin( ), values.end( ), lower.begin( ),
+                            bolt::amp::greater< float >( ), true );
+    bolt::amp::upper_bound( stdInput.begin( ), stdInput.end( ), values.begin( ), values.end( ), upper.begin( ),
+                            bolt::amp::greater< float >( ), true );
+
+    for( size_t i = 0; i < values.size( ); i++ )
+    {
+        EXPECT_EQ( std::lower_bound( stdInput.begin( ), stdInput.end( ), values[ i ], std::greater< float >( ) )
+                   - stdInput.begin( ), lower[ i ] );
+        EXPECT_EQ( std::upper_bound( stdInput.begin( ), stdInput.end( ), values[ i ], std::greater< float >( ) )
+                   - stdInput.begin( ), upper[ i ] );
+    }
+}
+
+TEST( SerialCPU, SerialLowerBound )
+{
+    const int length = 1025;
+    std::vector< int > stdInput( length );
+    for( int i = 0; i < length; i++ )
+        stdInput[ i ] = i / 2;
+    std::vector< int > values( 300 );
+    for( size_t i = 0; i < values.size( ); i++ )
+        values[ i ] = rand( ) % 600;
+    std::vector< int > lower( values.size( ) );
+
+    bolt::amp::control ctl = bolt::amp::control::getDefault( );
+    ctl.setForceRunMode( bolt::amp::control::SerialCpu );
+    bolt::amp::lower_bound( ctl, stdInput.begin( ), stdInput.end( ), values.begin( ), values.end( ), lower.begin( ) );
+
+    for( size_t i = 0; i < values.size( ); i++ )
+        EXPECT_EQ( std::lower_bound( stdInput.begin( ), stdInput.end( ), values[ i ] ) - stdInput.begin( ), lower[ i ] );
+}
+
 int main(int argc, char* argv[])
 {
     ::testing::InitGoogleTest( &argc, &argv[ 0 ] );
@@ -3682,6 +3682,74 @@ INSTANTIATE_TEST_CASE_P(GatherUDDLimit, HostMemory_UDDTestInt2, ::testing::Range
 INSTANTIATE_TEST_CASE_P(GatherUDDLimit, HostMemory_UDDTestIntFloat, ::testing::Range(10, 2400, 230)); 
 
 
+TEST( HostMemory_int, GatherPlan )
+{
+    const int size = 4096;
+    std::vector<int> map( size );
+    std::vector<int> input( size );
+    for( int i = 0; i < size; i++ )
+    {
+        map[ i ] = ( i * 1237 ) % size;
+        input[ i ] = 3 * i + 1;
+    }
+    std::vector<int> exp_result( size );
+    for( int i = 0; i < size; i++ )
+        exp_result[ i ] = input[ map[ i ] ];
+
+    bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Gather, map.begin( ), map.end( ) );
+    EXPECT_EQ( size, plan.getSize( ) );
+
+    // the plan is reused by each gather
+    for( int iter = 0; iter < 3; iter++ )
+    {
+        std::vector<int> result( size, -1 );
+        bolt::amp::gather( plan, input.begin( ), result.begin( ) );
+        EXPECT_EQ( exp_result, result );
+    }
+}
+
+TEST( DeviceMemory_int, GatherPlan )
+{
+    const int size = 4096;
+    std::vector<int> map( size );
+    std::vector<int> input( size );
+    for( int i = 0; i < size; i++ )
+    {
+        map[ i ] = ( i * 1237 ) % size;
+        input[ i ] = 3 * i + 1;
+    }
+    std::vector<int> exp_result( size );
+    for( int i = 0; i < size; i++ )
+        exp_result[ i ] = input[ map[ i ] ];
+
+    bolt::amp::device_vector<int> dmap( map.begin( ), map.end( ) );
+    bolt::amp::device_vector<int> dinput( input.begin( ), input.end( ) );
+    bolt::amp::device_vector<int> dresult( size, -1 );
+    bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Gather, dmap.begin( ), dmap.end( ) );
+    bolt::amp::gather( plan, dinput.begin( ), dresult.begin( ) );
+
+    cmpArrays( exp_result, dresult );
+}
+
+TEST( HostMemory_int, SerialGatherPlan )
+{
+    int n_map[10]     =  {9, 8, 7, 6, 5, 4, 3, 2, 1, 0};
+    int n_input[10]   =  {0, 11, 22, 33, 44, 55, 66, 77, 88, 99};
+    int n_result[10]  =  {99, 88, 77, 66, 55, 44, 33, 22, 11, 0};
+
+    std::vector<int> exp_result( n_result, n_result + 10 );
+    std::vector<int> result( 10, 0 );
+    std::vector<int> input( n_input, n_input + 10 );
+
+    bolt::amp::control ctl = bolt::amp::control::getDefault( );
+    ctl.setForceRunMode( bolt::amp::control::SerialCpu );
+
+    bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Gather, n_map, n_map + 10, 4, ctl );
+    bolt::amp::gather( ctl, plan, input.begin( ), result.begin( ) );
+
+    EXPECT_EQ( exp_result, result );
+}
+
 int main(int argc, char* argv[])
 {
     //  Register our minidump generating logic
@@ -551,6 +551,48 @@ TEST_P (ReduceByKeyTest, DifferentKeyReduceByKeyTestFloatDevice)
 }
 
 
+TEST (ReduceByKeySinglePass, SegmentsAcrossTiles)
+{
+    // segments both shorter and longer than a tile, so carries chain through several tiles
+    int length = 1 << 20;
+    std::vector< int > keys( length );
+    std::vector< int > input( length );
+    int key = 0, segmentLength = 1, segmentIndex = 0;
+    for (int i = 0; i < length; i++)
+    {
+        if (segmentIndex == segmentLength)
+        {
+            key++;
+            segmentIndex = 0;
+            segmentLength = 1 + std::rand()%3000;
+        }
+        segmentIndex++;
+        keys[i] = key;
+        input[i] = std::rand()%16;
+    }
+
+    bolt::amp::device_vector< int > dKeys( keys.begin(), keys.end() );
+    bolt::amp::device_vector< int > dInput( input.begin(), input.end() );
+    bolt::amp::device_vector< int > koutput( length );
+    bolt::amp::device_vector< int > voutput( length );
+    std::vector< int > krefOutput( length, 0 );
+    std::vector< int > vrefOutput( length, 0 );
+
+    auto p = bolt::amp::reduce_by_key( dKeys.begin(), dKeys.end(), dInput.begin(), koutput.begin(), voutput.begin(),
+                                      bolt::amp::equal_to<int>(), bolt::amp::plus<int>());
+    auto refPair = gold_reduce_by_key( keys.begin(), keys.end(), input.begin(), krefOutput.begin(), vrefOutput.begin(),
+                                       std::plus<int>());
+
+    int segments = static_cast< int >( refPair.first - krefOutput.begin() );
+    EXPECT_EQ( segments, static_cast< int >( p.first - koutput.begin() ) );
+    for (int i = 0; i < segments; i++)
+    {
+        EXPECT_EQ( krefOutput[i], koutput[i] );
+        EXPECT_EQ( vrefOutput[i], voutput[i] );
+    }
+}
+
+
 
 
 #if(TEST_DOUBLE==1)
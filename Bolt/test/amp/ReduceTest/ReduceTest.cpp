@@ -18,6 +18,7 @@
 #include "common/stdafx.h"
 
 #include "bolt/amp/reduce.h"
+#include "bolt/amp/async.h"
 #include "bolt/amp/functional.h"
 #include "bolt/amp/iterator/iterator_traits.h"
 #include "bolt/amp/iterator/counting_iterator.h"
@@ -642,6 +643,73 @@ TEST( ReduceStdVectWithInit, OffsetTestSerialCpu)
     EXPECT_EQ( stlTransformReduce, boltTransformReduce );
 }
 
+TEST( ReduceStdVectWithInit, OffsetTestAutoTune)
+{
+    int length = 1 << 16;
+    std::vector<int> stdInput( length );
+    for (int i = 0; i < length; ++i)
+    {
+        stdInput[i] = i % 1000;
+    }
+
+    bolt::amp::control ctl;
+    ctl.setForceRunMode(bolt::amp::control::Automatic);
+    ctl.setAutoTuneMode(bolt::amp::control::AutoTuneAll);
+
+    //  Calling the actual functions under test, while each plan is tried and once one is chosen
+    int init = 0, offset = 100;
+    int stlTransformReduce = std::accumulate(stdInput.begin( ) + offset, stdInput.end( ), init, bolt::amp::plus<int>( ) );
+    for (int i = 0; i < 32; ++i)
+    {
+        int boltTransformReduce= bolt::amp::reduce( ctl, stdInput.begin( ) + offset, stdInput.end( ), init, bolt::amp::plus<int>( ) );
+        EXPECT_EQ( stlTransformReduce, boltTransformReduce );
+    }
+}
+
+TEST( ReduceStdVectWithInit, OffsetTestBalancedWait)
+{
+    int length = 1 << 16;
+    std::vector<int> stdInput( length );
+    for (int i = 0; i < length; ++i)
+    {
+        stdInput[i] = i % 1000;
+    }
+
+    bolt::amp::control ctl;
+    ctl.setWaitMode(bolt::amp::control::BalancedWait);
+
+    //  Calling the actual functions under test, the first call estimates how long the next ones wait
+    int init = 0, offset = 100;
+    int stlTransformReduce = std::accumulate(stdInput.begin( ) + offset, stdInput.end( ), init, bolt::amp::plus<int>( ) );
+    for (int i = 0; i < 8; ++i)
+    {
+        int boltTransformReduce= bolt::amp::reduce( ctl, stdInput.begin( ) + offset, stdInput.end( ), init, bolt::amp::plus<int>( ) );
+        EXPECT_EQ( stlTransformReduce, boltTransformReduce );
+    }
+}
+
+TEST( ReduceStdVectWithInit, AsyncDeviceVector)
+{
+    int length = 1 << 16;
+    std::vector<int> stdInput( length );
+    for (int i = 0; i < length; ++i)
+    {
+        stdInput[i] = i % 1000;
+    }
+
+    bolt::amp::device_vector<int> dVectorA( stdInput.begin(), stdInput.end() );
+    bolt::amp::device_vector<int> dVectorB( stdInput.begin(), stdInput.end() );
+    bolt::amp::control ctl;
+
+    //  Both reductions run at the same time as the std one
+    std::future<int> boltA = bolt::amp::reduce_async( ctl, dVectorA.begin( ), dVectorA.end( ), 0 );
+    std::future<int> boltB = bolt::amp::reduce_async( ctl, dVectorB.begin( ), dVectorB.end( ), 7, bolt::amp::plus<int>( ) );
+    int stlReduce = std::accumulate( stdInput.begin( ), stdInput.end( ), 0 );
+
+    EXPECT_EQ( stlReduce, boltA.get( ) );
+    EXPECT_EQ( stlReduce + 7, boltB.get( ) );
+}
+
 TEST( ReduceStdVectWithInit, OffsetTestDeviceVector)
 {
     int length = 1024;
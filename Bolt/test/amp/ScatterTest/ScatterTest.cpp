@@ -5252,6 +5252,48 @@ INSTANTIATE_TEST_CASE_P(ScatterIntLimit, DeviceMemory_IntBoltdVector, ::testing:
 INSTANTIATE_TEST_CASE_P(ScatterUDDLimit, HostMemory_UDDTestInt2, ::testing::Range(1, 32768, 3276 ) ); // 1 to 2^15
 INSTANTIATE_TEST_CASE_P(ScatterUDDLimit, HostMemory_UDDTestIntFloat, ::testing::Range(1, 32768, 3276 ) ); // 1 to 2^15
 
+TEST( HostMemory_Int, ScatterPlan )
+{
+    const int size = 4096;
+    std::vector<int> map( size );
+    std::vector<int> input( size );
+    for( int i = 0; i < size; i++ )
+    {
+        map[ i ] = ( i * 1237 ) % size;
+        input[ i ] = 3 * i + 1;
+    }
+    std::vector<int> exp_result( size );
+    for( int i = 0; i < size; i++ )
+        exp_result[ map[ i ] ] = input[ i ];
+
+    bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Scatter, map.begin( ), map.end( ) );
+    EXPECT_EQ( size, plan.getDestinationExtent( ) );
+
+    // the plan is reused by each scatter
+    for( int iter = 0; iter < 3; iter++ )
+    {
+        std::vector<int> result( size, -1 );
+        bolt::amp::scatter( plan, input.begin( ), result.begin( ) );
+        EXPECT_EQ( exp_result, result );
+    }
+}
+
+TEST( DeviceMemory_Int, ScatterPlan )
+{
+    int n_input[10]   =  {5, 7, 2, 3, 12, 6, 9, 8, 1, 4};
+    int n_map[10]     =  {8, 2, 3, 9, 0, 5, 1, 7, 6, 4};
+    int n_result[10]  =  {12, 9, 7, 2, 4, 6, 1, 8, 5, 3};
+
+    std::vector<int> exp_result( n_result, n_result + 10 );
+    bolt::amp::device_vector<int> input( n_input, n_input + 10 );
+    bolt::amp::device_vector<int> result( 10, 0 );
+
+    bolt::amp::permutation_plan plan( bolt::amp::permutation_plan::Scatter, n_map, n_map + 10, 4 );
+    bolt::amp::scatter( plan, input.begin( ), result.begin( ) );
+
+    cmpArrays( exp_result, result );
+}
+
 int main(int argc, char* argv[])
 {
     //  Register our minidump generating logic
@@ -883,6 +883,32 @@ TEST_P(SortByKeyCountingIterator, DVwithCountingIterator)
 
 } */
 
+TEST( SortbyKeyIntegerRadix, DescendingStable )
+{
+    // keys of both signs with many duplicates, over several tiles of a radix pass,
+    // whose values tell whether the order of equal keys is kept
+    int length = (1<<16) + 123;
+    std::vector< std::pair< int, int > > stdPairs( length );
+    std::vector< int > boltKeys( length ), boltValues( length );
+    for (int i = 0; i < length; i++)
+    {
+        boltKeys[i] = ((i * 7919) % 2003) - 1001;
+        boltValues[i] = i;
+        stdPairs[i] = std::make_pair( boltKeys[i], i );
+    }
+
+    //  Calling the actual functions under test
+    std::stable_sort( stdPairs.begin( ), stdPairs.end( ),
+                      [] ( const std::pair< int, int > &a, const std::pair< int, int > &b ) { return a.first > b.first; } );
+    bolt::amp::sort_by_key( boltKeys.begin( ), boltKeys.end( ), boltValues.begin( ), bolt::amp::greater< int >( ) );
+
+    for (int i = 0; i < length; i++)
+    {
+        EXPECT_EQ( stdPairs[i].first, boltKeys[i] );
+        EXPECT_EQ( stdPairs[i].second, boltValues[i] );
+    }
+}
+
 //#if 0
 #if (TEST_DOUBLE == 1)
 TEST( SortbyUDDKeyVectorTest, Normal )
@@ -0,0 +1,269 @@
+/***************************************************************************
+
+*   Copyright 2012 - 2013 Advanced Micro Devices, Inc.
+*
+*   Licensed under the Apache License, Version 2.0 (the "License");
+*   you may not use this file except in compliance with the License.
+*   You may obtain a copy of the License at
+*
+*       http://www.apache.org/licenses/LICENSE-2.0
+*
+*   Unless required by applicable law or agreed to in writing, software
+*   distributed under the License is distributed on an "AS IS" BASIS,
+*   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+*   See the License for the specific language governing permissions and
+*   limitations under the License.
+
+***************************************************************************/
+
+#include "common/stdafx.h"
+
+#include "bolt/amp/reduce.h"
+#include "bolt/amp/scan.h"
+#include "bolt/amp/transform.h"
+#include "bolt/amp/transform_reduce.h"
+
+#include "bolt/unicode.h"
+#include "bolt/miniDump.h"
+#include <gtest/gtest.h>
+#include <numeric>
+#include "bolt/amp/functional.h"
+#include "common/test_common.h"
+#include "bolt/amp/iterator/counting_iterator.h"
+#include "bolt/amp/iterator/transform_iterator.h"
+#include "bolt/amp/iterator/zip_iterator.h"
+
+struct multiply_pair
+{
+    int operator( )( const bolt::amp::pair< int, int >& p ) const restrict(cpu,amp)
+    {
+        return p.first * p.second;
+    }
+};
+
+struct add_one
+{
+    int operator( )( const int& x ) const restrict(cpu,amp)
+    {
+        return x + 1;
+    }
+};
+
+TEST(TransformIterator, Dereference)
+{
+    const int size = 1024;
+    std::vector<int> input(size);
+    for(int i = 0; i < size; i++)
+        input[i] = i;
+    bolt::amp::device_vector<int> dinput(input.begin(), input.end());
+
+    auto first = bolt::amp::make_transform_iterator(dinput.begin(), bolt::amp::square<int>());
+    auto last = bolt::amp::make_transform_iterator(dinput.end(), bolt::amp::square<int>());
+    EXPECT_EQ(size, last - first);
+    EXPECT_EQ(9, *(first + 3));
+    EXPECT_EQ(16, (first + 2)[2]);
+    first += 5;
+    EXPECT_EQ(25, *first);
+}
+
+TEST(TransformIterator, Reduce)
+{
+    const int size = 1 << 16;
+    std::vector<int> input(size);
+    for(int i = 0; i < size; i++)
+        input[i] = i % 97;
+    bolt::amp::device_vector<int> dinput(input.begin(), input.end());
+
+    int stdOut = 0;
+    for(int i = 0; i < size; i++)
+        stdOut += input[i] * input[i];
+
+    int boltOut = bolt::amp::reduce(bolt::amp::make_transform_iterator(dinput.begin(), bolt::amp::square<int>()),
+                                    bolt::amp::make_transform_iterator(dinput.end(), bolt::amp::square<int>()),
+                                    0, bolt::amp::plus<int>());
+    EXPECT_EQ(stdOut, boltOut);
+}
+
+TEST(TransformIterator, Serial_Reduce)
+{
+    const int size = 1024;
+    std::vector<int> input(size);
+    for(int i = 0; i < size; i++)
+        input[i] = i % 31;
+    bolt::amp::device_vector<int> dinput(input.begin(), input.end());
+
+    int stdOut = 0;
+    for(int i = 0; i < size; i++)
+        stdOut += input[i] * input[i];
+
+    bolt::amp::control ctl = bolt::amp::control::getDefault( );
+    ctl.setForceRunMode(bolt::amp::control::SerialCpu);
+
+    int boltOut = bolt::amp::reduce(ctl, bolt::amp::make_transform_iterator(dinput.begin(), bolt::amp::square<int>()),
+                                    bolt::amp::make_transform_iterator(dinput.end(), bolt::amp::square<int>()),
+                                    0, bolt::amp::plus<int>());
+    EXPECT_EQ(stdOut, boltOut);
+}
+
+TEST(TransformIterator, InclusiveScan)
+{
+    const int size = 4096;
+    std::vector<int> input(size);
+    for(int i = 0; i < size; i++)
+        input[i] = i % 13;
+    bolt::amp::device_vector<int> dinput(input.begin(), input.end());
+    bolt::amp::device_vector<int> doutput(size, 0);
+
+    std::vector<int> stdOutput(size);
+    std::transform(input.begin(), input.end(), stdOutput.begin(), add_one());
+    std::partial_sum(stdOutput.begin(), stdOutput.end(), stdOutput.begin());
+
+    bolt::amp::inclusive_scan(bolt::amp::make_transform_iterator(dinput.begin(), add_one()),
+                              bolt::amp::make_transform_iterator(dinput.end(), add_one()),
+                              doutput.begin(), bolt::amp::plus<int>());
+
+    std::vector<int> boltOutput(doutput.begin(), doutput.end());
+    cmpArrays(stdOutput, boltOutput, size);
+}
+
+TEST(TransformIterator, Transform)
+{
+    const int size = 1024;
+    std::vector<int> input(size);
+    for(int i = 0; i < size; i++)
+        input[i] = i;
+    bolt::amp::device_vector<int> dinput(input.begin(), input.end());
+    bolt::amp::device_vector<int> doutput(size, 0);
+
+    std::vector<int> stdOutput(size);
+    for(int i = 0; i < size; i++)
+        stdOutput[i] = -(i + 1);
+
+    bolt::amp::transform(bolt::amp::make_transform_iterator(dinput.begin(), add_one()),
+                         bolt::amp::make_transform_iterator(dinput.end(), add_one()),
+                         doutput.begin(), bolt::amp::negate<int>());
+
+    std::vector<int> boltOutput(doutput.begin(), doutput.end());
+    cmpArrays(stdOutput, boltOutput, size);
+}
+
+TEST(ZipIterator, Dereference)
+{
+    const int size = 256;
+    std::vector<int> x(size), y(size);
+    for(int i = 0; i < size; i++)
+    {
+        x[i] = i;
+        y[i] = 2 * i;
+    }
+    bolt::amp::device_vector<int> dx(x.begin(), x.end());
+    bolt::amp::device_vector<int> dy(y.begin(), y.end());
+
+    auto first = bolt::amp::make_zip_iterator(dx.begin(), dy.begin());
+    auto last = bolt::amp::make_zip_iterator(dx.end(), dy.end());
+    EXPECT_EQ(size, last - first);
+    bolt::amp::pair<int, int> p = *(first + 7);
+    EXPECT_EQ(7, p.first);
+    EXPECT_EQ(14, p.second);
+    p = (first + 1)[2];
+    EXPECT_EQ(3, p.first);
+    EXPECT_EQ(6, p.second);
+}
+
+TEST(ZipIterator, DotProduct)
+{
+    const int size = 1 << 16;
+    std::vector<int> x(size), y(size);
+    for(int i = 0; i < size; i++)
+    {
+        x[i] = i % 7;
+        y[i] = i % 11;
+    }
+    bolt::amp::device_vector<int> dx(x.begin(), x.end());
+    bolt::amp::device_vector<int> dy(y.begin(), y.end());
+
+    int stdOut = std::inner_product(x.begin(), x.end(), y.begin(), 0);
+
+    int boltOut = bolt::amp::reduce(
+        bolt::amp::make_transform_iterator(bolt::amp::make_zip_iterator(dx.begin(), dy.begin()), multiply_pair()),
+        bolt::amp::make_transform_iterator(bolt::amp::make_zip_iterator(dx.end(), dy.end()), multiply_pair()),
+        0, bolt::amp::plus<int>());
+    EXPECT_EQ(stdOut, boltOut);
+}
+
+TEST(ZipIterator, Serial_DotProduct)
+{
+    const int size = 1024;
+    std::vector<int> x(size), y(size);
+    for(int i = 0; i < size; i++)
+    {
+        x[i] = i % 5;
+        y[i] = i % 3;
+    }
+    bolt::amp::device_vector<int> dx(x.begin(), x.end());
+    bolt::amp::device_vector<int> dy(y.begin(), y.end());
+
+    int stdOut = std::inner_product(x.begin(), x.end(), y.begin(), 0);
+
+    bolt::amp::control ctl = bolt::amp::control::getDefault( );
+    ctl.setForceRunMode(bolt::amp::control::SerialCpu);
+
+    int boltOut = bolt::amp::reduce(ctl,
+        bolt::amp::make_transform_iterator(bolt::amp::make_zip_iterator(dx.begin(), dy.begin()), multiply_pair()),
+        bolt::amp::make_transform_iterator(bolt::amp::make_zip_iterator(dx.end(), dy.end()), multiply_pair()),
+        0, bolt::amp::plus<int>());
+    EXPECT_EQ(stdOut, boltOut);
+}
+
+int main(int argc, char* argv[])
+{
+    ::testing::InitGoogleTest( &argc, &argv[ 0 ] );
+
+    //    Set the standard OpenCL wait behavior to help debugging
+    bolt::amp::control& myControl = bolt::amp::control::getDefault( );
+    myControl.setWaitMode( bolt::amp::control::NiceWait );
+    myControl.setForceRunMode( bolt::amp::control::Automatic );  // choose tbb
+
+
+    int retVal = RUN_ALL_TESTS( );
+
+#ifdef BUILD_TBB
+
+    bolt::amp::control& myControl = bolt::amp::control::getDefault( );
+    myControl.setWaitMode( bolt::amp::control::NiceWait );
+    myControl.setForceRunMode( bolt::amp::control::MultiCoreCpu );  // choose tbb
+
+
+    int retVal = RUN_ALL_TESTS( );
+
+#endif
+
+    //  Reflection code to inspect how many tests failed in gTest
+    ::testing::UnitTest& unitTest = *::testing::UnitTest::GetInstance( );
+
+    unsigned int failedTests = 0;
+    for( int i = 0; i < unitTest.total_test_case_count( ); ++i )
+    {
+        const ::testing::TestCase& testCase = *unitTest.GetTestCase( i );
+        for( int j = 0; j < testCase.total_test_count( ); ++j )
+        {
+            const ::testing::TestInfo& testInfo = *testCase.GetTestInfo( j );
+            if( testInfo.result( )->Failed( ) )
+                ++failedTests;
+        }
+    }
+
+    //  Print helpful message at termination if we detect errors, to help users figure out what to do next
+    if( failedTests )
+    {
+        bolt::tout << _T( "\nFailed tests detected in test pass; please run test again with:" ) << std::endl;
+        bolt::tout << _T( "\t--gtest_filter=<XXX> to select a specific failing test of interest" ) << std::endl;
+        bolt::tout << _T( "\t--gtest_catch_exceptions=0 to generate minidump of failing test, or" ) << std::endl;
+        bolt::tout << _T( "\t--gtest_break_on_failure to debug interactively with debugger" ) << std::endl;
+        bolt::tout << _T( "\t    (only on googletest assertion failures, not SEH exceptions)" ) << std::endl;
+    }
+
+    return retVal;
+
+
+}
@@ -2756,6 +2756,38 @@ TEST(TransformReduce, MulticoreDeviceVectorFloat)
 } 
 #endif
 
+TEST(TransformReduce, DeviceFinishPartialTiles)
+{
+    // the partials of all the tiles are reduced on the device, for full and partly full tiles
+    int length = (1<<20) + 77;
+
+    std::vector< int > refInput( length );
+    for (int i = 0; i < length; i++)
+        refInput[i] = (i % 13) - 6;
+    bolt::amp::device_vector< int > input( refInput.begin(), refInput.end() );
+
+    bolt::amp::control ctl = bolt::amp::control::getDefault( );
+    ctl.setForceRunMode(bolt::amp::control::Gpu);
+    bolt::amp::negate<int> neg;
+    bolt::amp::plus<int> add;
+
+    int stdReduce = 5;
+    for (int i = 0; i < length; i++)
+        stdReduce += -refInput[i];
+
+    for (int run = 0; run < 3; run++)
+    {
+        int boltReduce = bolt::amp::transform_reduce(ctl, input.begin(), input.end(), neg, 5, add);
+        EXPECT_EQ( stdReduce, boltReduce );
+    }
+
+    int smallReduce = bolt::amp::transform_reduce(ctl, input.begin(), input.begin() + 300, neg, 0, add);
+    int stdSmallReduce = 0;
+    for (int i = 0; i < 300; i++)
+        stdSmallReduce += -refInput[i];
+    EXPECT_EQ( stdSmallReduce, smallReduce );
+}
+
 #if(TEST_DOUBLE == 1	)
 TEST(TransformReduce, DeviceVectorUDD)
 {
@@ -744,6 +744,41 @@ TEST( Vector, wdSpecifyingSize )
     EXPECT_EQ (mySize, DevSize);
 }
 
+#if AMP_TESTS
+// append is an extension of the amp device_vector
+TEST( Vector, AppendAndPushBackGrowth )
+{
+    std::vector< int > ref;
+    bolt::BCKND::device_vector< int > dV;
+
+    for( int i = 0; i < 1000; ++i )
+    {
+        dV.push_back( i );
+        ref.push_back( i );
+    }
+    EXPECT_GE( dV.capacity( ), dV.size( ) );
+    EXPECT_LT( dV.capacity( ), 2 * static_cast< int >( dV.size( ) ) );
+
+    std::vector< int > range( 777 );
+    for( size_t i = 0; i < range.size( ); ++i )
+        range[ i ] = -static_cast< int >( i );
+    dV.append( range.begin( ), range.end( ) );
+    ref.insert( ref.end( ), range.begin( ), range.end( ) );
+
+    dV.append( 33, 7 );
+    ref.insert( ref.end( ), 33, 7 );
+
+    EXPECT_EQ( ref.size( ), dV.size( ) );
+    for( size_t i = 0; i < ref.size( ); ++i )
+        EXPECT_EQ( ref[ i ], dV[ i ] );
+
+    dV.shrink_to_fit( );
+    EXPECT_EQ( dV.size( ), dV.capacity( ) );
+    for( size_t i = 0; i < ref.size( ); ++i )
+        EXPECT_EQ( ref[ i ], dV[ i ] );
+}
+#endif
+
 TEST( Vector, InsertFloatRangeEmpty )
 {
     bolt::BCKND::device_vector< float > dV;
@@ -0,0 +1,263 @@
+//===- DevicePipeline.cpp - In-process lowering of kernel modules ---------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file implements the device pipeline of clamp-device in one process.
+// The passes run in the order and with the options of the clamp-device
+// script, so both produce the same kernels.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DevicePipeline.h"
+
+#include "llvm/AsmParser/Parser.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/InitializePasses.h"
+#include "llvm/Linker/Linker.h"
+#include "llvm/Pass.h"
+#include "llvm/PassManager.h"
+#include "llvm/PassRegistry.h"
+#include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace llvm;
+
+namespace DevicePipeline {
+
+Options::Options()
+  : tileCheck(true), removeSpecialSection(false), divPrecise(false),
+    tileStaticBanks(false), verbose(false) {}
+
+static std::string diagnostic(const SMDiagnostic& diag) {
+  std::string str;
+  raw_string_ostream os(str);
+  diag.print("clamp-device-pipeline", os);
+  return os.str();
+}
+
+bool loadPasses(const Options& opts, std::string& err) {
+  static std::once_flag initialized;
+  std::call_once(initialized, [] {
+    PassRegistry& registry = *PassRegistry::getPassRegistry();
+    initializeCore(registry);
+    initializeScalarOpts(registry);
+    initializeIPO(registry);
+    initializeAnalysis(registry);
+    initializeIPA(registry);
+    initializeTransformUtils(registry);
+  });
+
+  const char* plugins[] = { "LLVMPromote", "LLVMEraseNonkernel", "LLVMTileUniform",
+                            "LLVMRemoveSpecialSection", "LLVMDivisionPrecision" };
+  for (const char* plugin : plugins) {
+    std::string path = opts.libDir + "/" + plugin + CLAMP_SHLIB_EXT;
+    // the optional plugins may not be built
+    if (!sys::fs::exists(path))
+      continue;
+    if (sys::DynamicLibrary::LoadLibraryPermanently(path.c_str(), &err))
+      return false;
+  }
+  return true;
+}
+
+// Adds the passes named as on the opt command line.
+static bool addPasses(PassManager& PM, const std::vector<const char*>& names, std::string& err) {
+  PassRegistry& registry = *PassRegistry::getPassRegistry();
+  for (const char* name : names) {
+    const PassInfo* PI = registry.getPassInfo(name);
+    if (!PI || !PI->getNormalCtor()) {
+      err = std::string("pass -") + name + " is not available";
+      return false;
+    }
+    PM.add(PI->createPass());
+  }
+  return true;
+}
+
+static bool runPasses(Module& M, const std::vector<const char*>& names, std::string& err) {
+  PassManager PM;
+  if (M.getDataLayout())
+    PM.add(new DataLayoutPass(&M));
+  if (!addPasses(PM, names, err))
+    return false;
+  PM.run(M);
+  return true;
+}
+
+static void replaceAll(std::string& str, const std::string& from, const std::string& to) {
+  for (size_t pos = str.find(from); pos != std::string::npos; pos = str.find(from, pos + to.size()))
+    str.replace(pos, from.size(), to);
+}
+
+// The HSAIL backend wants spir_func calls and no addrspacecast. The script rewrites
+// the textual IR with sed; the same rewrite is done on a string and parsed back,
+// through the patched assembly parser, since the verifier would reject such casts.
+static Module* spirFuncCalls(Module* M, std::string& err) {
+  std::string text;
+  {
+    raw_string_ostream os(text);
+    M->print(os, nullptr);
+  }
+  LLVMContext& context = M->getContext();
+  delete M;
+
+  replaceAll(text, "call ", "call spir_func ");
+  replaceAll(text, "addrspacecast ", "bitcast ");
+
+  SMDiagnostic diag;
+  Module* fixed = ParseAssemblyString(text.c_str(), nullptr, diag, context);
+  if (!fixed)
+    err = diagnostic(diag);
+  return fixed;
+}
+
+static bool linkLibrary(Module* M, const std::string& path, std::string& err) {
+  SMDiagnostic diag;
+  Module* lib = parseIRFile(path, diag, M->getContext());
+  if (!lib) {
+    err = diagnostic(diag);
+    return false;
+  }
+  bool failed = Linker::LinkModules(M, lib, Linker::DestroySource, &err);
+  delete lib;
+  return !failed;
+}
+
+static bool writeBitcode(const Module& M, const std::string& path, std::string& err) {
+  std::string errorInfo;
+  raw_fd_ostream out(path.c_str(), errorInfo, sys::fs::F_None);
+  if (!errorInfo.empty()) {
+    err = errorInfo;
+    return false;
+  }
+  WriteBitcodeToFile(&M, out);
+  return true;
+}
+
+Module* linkInputs(LLVMContext& context, const std::vector<std::string>& inputs,
+                   bool inlineAll, std::string& err) {
+  std::unique_ptr<Module> linked;
+  for (const std::string& input : inputs) {
+    SMDiagnostic diag;
+    Module* M = parseIRFile(input, diag, context);
+    if (!M) {
+      err = diagnostic(diag);
+      return nullptr;
+    }
+    if (!linked) {
+      linked.reset(M);
+      continue;
+    }
+    bool failed = Linker::LinkModules(linked.get(), M, Linker::DestroySource, &err);
+    delete M;
+    if (failed)
+      return nullptr;
+  }
+  if (!linked) {
+    err = "no input";
+    return nullptr;
+  }
+  if (inlineAll && !runPasses(*linked, { "always-inline" }, err))
+    return nullptr;
+  return linked.release();
+}
+
+bool lower(Module* M, const Job& job, const Options& opts, std::string& err) {
+  std::vector<const char*> passes;
+  if (job.lowering == LowerHSA)
+    passes.push_back("kernel-attributes");
+  passes.push_back("promote-globals");
+  if (job.lowering == LowerHSA)
+    passes.push_back("promote-privates");
+  passes.push_back("erase-nonkernels");
+  if (opts.tileCheck)
+    passes.push_back("tile-uniform");
+  if (job.lowering == LowerHSA) {
+    passes.push_back("malloc-select");
+    passes.push_back("infer-address-spaces");
+    if (opts.tileStaticBanks)
+      passes.push_back("tile-static-banks");
+  }
+  passes.push_back("dce");
+  passes.push_back("globaldce");
+  if (job.lowering == LowerHSA && opts.removeSpecialSection)
+    passes.push_back("remove-special-section");
+  if (job.lowering == LowerSPIR && opts.divPrecise)
+    passes.push_back("divprecise");
+
+  std::unique_ptr<Module> owned(M);
+  if (!runPasses(*owned, passes, err))
+    return false;
+
+  std::string mathLib;
+  if (job.lowering == LowerHSA) {
+    owned.reset(spirFuncCalls(owned.release(), err));
+    if (!owned)
+      return false;
+    mathLib = opts.mathLibDir + "/hsa_math.bc";
+  } else {
+    mathLib = opts.mathLibDir + "/opencl_math.bc";
+  }
+  if (opts.verbose)
+    errs() << (job.lowering == LowerHSA ? "Generating HSA Brig kernel\n"
+                                        : "Generating OpenCL SPIR kernel\n");
+
+  if (!linkLibrary(owned.get(), mathLib, err))
+    return false;
+  // only the kernels are entry points, the builtins they don't call are dropped
+  if (!runPasses(*owned, { "internalize-nonkernels", "globaldce" }, err))
+    return false;
+  return writeBitcode(*owned, job.output, err);
+}
+
+bool lowerParallel(const Module& M, const std::vector<Job>& jobs, const Options& opts,
+                   std::vector<std::string>& errors) {
+  // an LLVMContext is not shared by threads, every job reads the module in one of its own
+  std::string bitcode;
+  {
+    raw_string_ostream os(bitcode);
+    WriteBitcodeToFile(&M, os);
+  }
+
+  errors.assign(jobs.size(), std::string());
+  std::vector<char> failed(jobs.size(), 0);
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < jobs.size(); ++i) {
+    threads.push_back(std::thread([&, i] {
+      LLVMContext context;
+      std::unique_ptr<MemoryBuffer> buffer(MemoryBuffer::getMemBuffer(bitcode, "", false));
+      ErrorOr<Module*> parsed = parseBitcodeFile(buffer.get(), context);
+      if (!parsed) {
+        errors[i] = parsed.getError().message();
+        failed[i] = 1;
+        return;
+      }
+      failed[i] = !lower(parsed.get(), jobs[i], opts, errors[i]);
+    }));
+  }
+  for (std::thread& t : threads)
+    t.join();
+
+  for (char f : failed)
+    if (f)
+      return false;
+  return true;
+}
+
+} // namespace DevicePipeline
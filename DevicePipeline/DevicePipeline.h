@@ -0,0 +1,77 @@
+//===- DevicePipeline.h - In-process lowering of kernel modules -----------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// This file declares the device pipeline of clamp-device run in one process:
+// the pass plugins are loaded once, and a kernel module is promoted, fixed up
+// and linked with the math library in memory.
+//
+//===----------------------------------------------------------------------===//
+
+#ifndef CLAMP_DEVICE_PIPELINE_H
+#define CLAMP_DEVICE_PIPELINE_H
+
+#include <string>
+#include <vector>
+
+namespace llvm {
+  class LLVMContext;
+  class Module;
+}
+
+namespace DevicePipeline {
+
+  // Targets a kernel module is lowered to, as the --hsa and --spir modes of clamp-device.
+  enum Lowering {
+    LowerHSA,
+    LowerSPIR
+  };
+
+  struct Options {
+    // runs the tile-uniform check, unless CLAMP_NOTILECHECK is ON; options of the
+    // plugins, such as -always-malloc, are parsed from the command line of the tool
+    bool tileCheck;
+    // removes the special sections the AMDGPU backend does not take, as KM_USE_AMDGPU
+    bool removeSpecialSection;
+    // turns fdiv into precise builtin calls on SPIR, as HCC_DIVPRECISE_PATCH=ON
+    bool divPrecise;
+    // reports the LDS bank conflicts of tile_static arrays on HSA, as
+    // HCC_TILE_STATIC_BANKS=ON, and pads them with -tile-static-pad
+    bool tileStaticBanks;
+    // directory of the pass plugins and of the math libraries
+    std::string libDir;
+    std::string mathLibDir;
+    bool verbose;
+
+    Options();
+  };
+
+  struct Job {
+    Lowering lowering;
+    std::string output;
+  };
+
+  // Loads the pass plugins into the process, once. Returns false and sets err on failure.
+  bool loadPasses(const Options& opts, std::string& err);
+
+  // Links the modules of the inputs into one, inlining the always_inline functions if
+  // inlineAll; as llvm-link followed by opt -always-inline. Returns NULL and sets err on failure.
+  llvm::Module* linkInputs(llvm::LLVMContext& context, const std::vector<std::string>& inputs,
+                           bool inlineAll, std::string& err);
+
+  // Lowers M for job and writes the bitcode to job.output. M is consumed.
+  bool lower(llvm::Module* M, const Job& job, const Options& opts, std::string& err);
+
+  // Lowers the module for each job, every job in a thread and an LLVMContext of its own.
+  // Returns false if any job failed; errs holds the error of each failed job.
+  bool lowerParallel(const llvm::Module& M, const std::vector<Job>& jobs, const Options& opts,
+                     std::vector<std::string>& errs);
+
+} // namespace DevicePipeline
+
+#endif // CLAMP_DEVICE_PIPELINE_H
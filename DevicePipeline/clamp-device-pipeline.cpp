@@ -0,0 +1,147 @@
+//===- clamp-device-pipeline.cpp - In-process clamp-device ----------------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Links kernel bitcode files and lowers the result for HSA and SPIR in one
+// process, in place of the opt, llvm-as and llvm-link stages of clamp-link
+// and clamp-device. The outputs are lowered in parallel.
+//
+//   clamp-device-pipeline [-always-inline] [-o kernel.bc] [-hsa=kernel.hsa.bc]
+//                         [-spir=kernel.spir] inputs...
+//
+// The -hsa output is the bitcode clamp-hsatools takes.
+//
+//===----------------------------------------------------------------------===//
+
+#include "DevicePipeline.h"
+
+#include "llvm/Bitcode/ReaderWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/ManagedStatic.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/PrettyStackTrace.h"
+#include "llvm/Support/Signals.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+using namespace llvm;
+
+static cl::list<std::string>
+InputFilenames(cl::Positional, cl::OneOrMore, cl::desc("<input bitcode files>"));
+
+static cl::opt<std::string>
+LinkedFilename("o", cl::desc("Write the linked module, before lowering"), cl::value_desc("filename"));
+
+static cl::opt<std::string>
+HSAFilename("hsa", cl::desc("Lower for HSA, as clamp-device --hsa before clamp-hsatools"),
+            cl::value_desc("filename"));
+
+static cl::opt<std::string>
+SPIRFilename("spir", cl::desc("Lower for SPIR, as clamp-device --spir"), cl::value_desc("filename"));
+
+static cl::opt<bool>
+AlwaysInline("always-inline", cl::desc("Inline the always_inline functions of the linked module"));
+
+static cl::opt<bool>
+Verbose("verbose", cl::desc("Print the lowerings as they run"));
+
+static bool envIsOn(const char* name) {
+  const char* value = ::getenv(name);
+  return value && !strcmp(value, "ON");
+}
+
+int main(int argc, char** argv) {
+  sys::PrintStackTraceOnErrorSignal();
+  PrettyStackTraceProgram X(argc, argv);
+  llvm_shutdown_obj Y;
+
+  // the plugins are next to the tool as for opt -load $BINDIR/../lib, the math libraries in $BINDIR/../../lib
+  std::string exe = sys::fs::getMainExecutable(argv[0], (void*)(intptr_t)main);
+  SmallString<256> binDir(sys::path::parent_path(exe));
+  DevicePipeline::Options opts;
+  opts.libDir = (binDir + "/../lib").str();
+  opts.mathLibDir = (binDir + "/../../lib").str();
+  opts.tileCheck = !envIsOn("CLAMP_NOTILECHECK");
+  opts.divPrecise = envIsOn("HCC_DIVPRECISE_PATCH");
+  opts.removeSpecialSection = ::getenv("KM_USE_AMDGPU") != NULL;
+  opts.tileStaticBanks = envIsOn("HCC_TILE_STATIC_BANKS") || envIsOn("HCC_TILE_STATIC_PAD");
+  // -always-malloc and -tile-static-pad are options of the passes, registered once their plugin is loaded
+  static const char alwaysMalloc[] = "-always-malloc";
+  static const char tileStaticPad[] = "-tile-static-pad";
+  std::vector<const char*> passOptions;
+  if (envIsOn("ALWAYS_MALLOC"))
+    passOptions.push_back(alwaysMalloc);
+  if (envIsOn("HCC_TILE_STATIC_PAD"))
+    passOptions.push_back(tileStaticPad);
+  if (!passOptions.empty()) {
+    char** args = new char*[argc + passOptions.size()];
+    std::copy(argv, argv + argc, args);
+    for (const char* option : passOptions)
+      args[argc++] = const_cast<char*>(option);
+    argv = args;
+  }
+
+  // load the plugins before parsing, so that their options are known
+  std::string err;
+  if (!DevicePipeline::loadPasses(opts, err)) {
+    errs() << argv[0] << ": " << err << "\n";
+    return 1;
+  }
+  cl::ParseCommandLineOptions(argc, argv, "clamp device pipeline\n");
+  opts.verbose = Verbose;
+
+  LLVMContext context;
+  std::vector<std::string> inputs(InputFilenames.begin(), InputFilenames.end());
+  std::unique_ptr<Module> linked(DevicePipeline::linkInputs(context, inputs, AlwaysInline, err));
+  if (!linked) {
+    errs() << argv[0] << ": " << err << "\n";
+    return 1;
+  }
+
+  if (!LinkedFilename.empty()) {
+    std::string errorInfo;
+    raw_fd_ostream out(LinkedFilename.c_str(), errorInfo, sys::fs::F_None);
+    if (!errorInfo.empty()) {
+      errs() << argv[0] << ": " << errorInfo << "\n";
+      return 1;
+    }
+    WriteBitcodeToFile(linked.get(), out);
+  }
+
+  std::vector<DevicePipeline::Job> jobs;
+  if (!HSAFilename.empty()) {
+    DevicePipeline::Job job = { DevicePipeline::LowerHSA, HSAFilename };
+    jobs.push_back(job);
+  }
+  if (!SPIRFilename.empty()) {
+    DevicePipeline::Job job = { DevicePipeline::LowerSPIR, SPIRFilename };
+    jobs.push_back(job);
+  }
+  if (jobs.empty())
+    return 0;
+
+  bool ok;
+  std::vector<std::string> errors(1);
+  if (jobs.size() == 1)
+    ok = DevicePipeline::lower(linked.release(), jobs[0], opts, errors[0]);
+  else
+    ok = DevicePipeline::lowerParallel(*linked, jobs, opts, errors);
+
+  for (size_t i = 0; i < errors.size(); ++i)
+    if (!errors[i].empty())
+      errs() << argv[0] << ": " << jobs[i].output << ": " << errors[i] << "\n";
+  return ok ? 0 : 1;
+}
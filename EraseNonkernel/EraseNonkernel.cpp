@@ -7,7 +7,8 @@
 //
 //===----------------------------------------------------------------------===//
 //
-// This file implements a pass which removes non-GPU codes from LLVM IR.
+// This file implements a pass which removes non-GPU codes from LLVM IR, and
+// one which internalizes the functions which are not kernels.
 //
 //===----------------------------------------------------------------------===//
 
@@ -23,6 +24,8 @@
 #include "llvm/Support/Debug.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/IR/CallingConv.h"
+
+#include <algorithm>
 using namespace llvm;
 
 
@@ -248,3 +251,39 @@ bool EraseNonkernels::runOnModule(Module &M)
 char EraseNonkernels::ID = 0;
 static RegisterPass<EraseNonkernels>
 Y("erase-nonkernels", "Erase body of all functions not marked kernel in metadata.");
+
+namespace {
+/* Once the math library is linked in, only the kernels are entry points of
+   a device module. Internalizing all the other functions lets -globaldce
+   remove the builtins no kernel calls. Variables stay external, since the
+   runtime looks program scope symbols up by name. */
+class InternalizeNonkernels : public ModulePass {
+        public:
+        static char ID;
+        InternalizeNonkernels() : ModulePass(ID) {}
+        bool runOnModule(Module& M);
+};
+} // ::<unnamed> namespace
+
+bool InternalizeNonkernels::runOnModule(Module &M)
+{
+    FunctionVect kernels;
+    if (!findKernels(M, kernels))
+        return false;
+
+    bool changed = false;
+    for (Module::iterator F = M.begin(), Fend = M.end(); F != Fend; ++F) {
+        if (F->isDeclaration() || F->hasLocalLinkage())
+            continue;
+        if (F->getCallingConv() == CallingConv::SPIR_KERNEL ||
+            std::find(kernels.begin(), kernels.end(), &*F) != kernels.end())
+            continue;
+        F->setLinkage(GlobalValue::InternalLinkage);
+        changed = true;
+    }
+    return changed;
+}
+
+char InternalizeNonkernels::ID = 0;
+static RegisterPass<InternalizeNonkernels>
+Z("internalize-nonkernels", "Internalize all functions not marked kernel in metadata.");
@@ -510,7 +510,6 @@ struct StringFinder
           out << "_lp.group_dim.z = x_lp.group_dim.z;\n";
           out << "_lp.dynamic_group_mem_bytes = x_lp.dynamic_group_mem_bytes;\n";
 #if CHECK_LP_ARGS
-          out << "assert(x_lp.barrier_bit   ==  barrier_bit_queue_default);\n";  // remove when barrier-bit supported
           out << "assert(x_lp.launch_fence  == -1);\n";  // remove when launch_fence supported
 #endif
           out << "}\n";
@@ -534,11 +533,13 @@ struct StringFinder
           out << "  static accelerator_view av = accelerator().get_default_view();\n";
           out << "  _lp.av = &av;\n";
           out << "}\n\n";
-          out << "completion_future cf = parallel_for_each(*(_lp.av),extent<3>(_lp.grid_dim.z*_lp.group_dim.z,_lp.grid_dim.y*_lp.group_dim.y,_lp.grid_dim.x*_lp.group_dim.x).tile_with_dynamic(_lp.group_dim.z, _lp.group_dim.y, _lp.group_dim.x, _lp.dynamic_group_mem_bytes), \n"
+          // the launches of the same shape reuse the dispatch captured by the cache
+          out << "static grid_launch_cache cache;\n";
+          out << "completion_future cf = cache.launch(*(_lp.av),extent<3>(_lp.grid_dim.z*_lp.group_dim.z,_lp.grid_dim.y*_lp.group_dim.y,_lp.grid_dim.x*_lp.group_dim.x).tile_with_dynamic(_lp.group_dim.z, _lp.group_dim.y, _lp.group_dim.x, _lp.dynamic_group_mem_bytes), \n"
               << func->getFunctorName()
               << "(";
           func->printArgsAsArguments(out);
-          out << "));\n\n"
+          out << "), _lp.barrier_bit);\n\n"
               << "if(_lp.cf)\n"
               << "  *(_lp.cf) = cf;\n"
               << "}\n";
@@ -0,0 +1,297 @@
+//===- InferAddressSpace.cpp - Infer address spaces of flat pointers ------===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// Promote gives the kernel arguments and the tile_static variables their address
+// spaces, but a pointer cast back to address space 0, such as the dynamic group
+// segment base, is accessed as flat through all the GEPs, phis, selects and calls
+// it goes through. This pass infers the address space such pointers point into,
+// across the functions of the module, and rewrites their loads, stores and
+// atomics to that address space.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "InferAddressSpaces"
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SetVector.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+namespace {
+
+enum {
+  // pointers Promote leaves in address space 0 are accessed as flat
+  FlatAddressSpace = 0,
+  // no address space inferred yet, as for null and undef
+  UninitializedAddressSpace = ~0u
+};
+
+/// InferAddressSpaces Class - Rewrites the accesses through flat pointers
+/// of a known address space to that address space.
+///
+/// The address space of a flat pointer is the meet of the ones of its sources:
+/// the operand of an addrspacecast, the pointer of a GEP or bitcast, the
+/// incoming values of a phi or select, the arguments at all the call sites
+/// of an internal function and the values it returns. Anything else, such as
+/// a pointer loaded from memory, is flat.
+///
+class InferAddressSpaces : public ModulePass {
+public:
+  static char ID;
+  InferAddressSpaces() : ModulePass(ID) {}
+  virtual ~InferAddressSpaces() {}
+  bool runOnModule(Module &M);
+
+private:
+  SmallPtrSet<const Function *, 16> Internal;
+  DenseMap<const Value *, unsigned> Spaces;
+  DenseMap<Value *, Value *> Rewritten;
+
+  bool isInternal(const Function &F) const;
+  bool isTracked(const Value *V) const;
+  unsigned spaceOf(Value *V) const;
+  unsigned infer(Value *V) const;
+  void pushUsers(Value *V, SetVector<Value *> &Worklist) const;
+  Value *rewrite(Value *V, unsigned AS);
+};
+
+} // ::<unnamed> namespace
+
+static bool isFlatPointer(const Value *V) {
+  return V->getType()->isPointerTy() &&
+         V->getType()->getPointerAddressSpace() == FlatAddressSpace;
+}
+
+static unsigned meet(unsigned A, unsigned B) {
+  if (A == UninitializedAddressSpace)
+    return B;
+  if (B == UninitializedAddressSpace || A == B)
+    return A;
+  return FlatAddressSpace;
+}
+
+// An internal function is only called directly, so all the values its arguments
+// take are known.
+bool InferAddressSpaces::isInternal(const Function &F) const {
+  if (F.isDeclaration() || !F.hasLocalLinkage())
+    return false;
+  for (Value::const_use_iterator U = F.use_begin(), Ue = F.use_end(); U != Ue; ++U) {
+    const CallInst *CI = dyn_cast<CallInst>(U->getUser());
+    if (!CI || CI->getCalledFunction() != &F || U->getOperandNo() != CI->getNumArgOperands())
+      return false;
+  }
+  return true;
+}
+
+bool InferAddressSpaces::isTracked(const Value *V) const {
+  if (!isFlatPointer(V))
+    return false;
+  if (isa<AddrSpaceCastInst>(V) || isa<GetElementPtrInst>(V) ||
+      isa<BitCastInst>(V) || isa<PHINode>(V) || isa<SelectInst>(V))
+    return true;
+  if (const Argument *A = dyn_cast<Argument>(V))
+    return Internal.count(A->getParent());
+  if (const CallInst *CI = dyn_cast<CallInst>(V))
+    return CI->getCalledFunction() && Internal.count(CI->getCalledFunction());
+  return false;
+}
+
+// The address space inferred so far for V.
+unsigned InferAddressSpaces::spaceOf(Value *V) const {
+  if (!isFlatPointer(V))
+    return V->getType()->getPointerAddressSpace();
+  if (isa<UndefValue>(V) || isa<ConstantPointerNull>(V))
+    return UninitializedAddressSpace;
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+    if (CE->getOpcode() == Instruction::AddrSpaceCast)
+      return CE->getOperand(0)->getType()->getPointerAddressSpace();
+    return FlatAddressSpace;
+  }
+  if (!isTracked(V))
+    return FlatAddressSpace;
+  DenseMap<const Value *, unsigned>::const_iterator It = Spaces.find(V);
+  return It == Spaces.end() ? UninitializedAddressSpace : It->second;
+}
+
+// The address space of V from the ones of its sources.
+unsigned InferAddressSpaces::infer(Value *V) const {
+  if (isa<AddrSpaceCastInst>(V) || isa<BitCastInst>(V))
+    return spaceOf(cast<Instruction>(V)->getOperand(0));
+  if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(V))
+    return spaceOf(GEP->getPointerOperand());
+  if (SelectInst *SI = dyn_cast<SelectInst>(V))
+    return meet(spaceOf(SI->getTrueValue()), spaceOf(SI->getFalseValue()));
+
+  unsigned AS = UninitializedAddressSpace;
+  if (PHINode *PHI = dyn_cast<PHINode>(V)) {
+    for (unsigned i = 0, e = PHI->getNumIncomingValues(); i != e; ++i)
+      AS = meet(AS, spaceOf(PHI->getIncomingValue(i)));
+  } else if (Argument *A = dyn_cast<Argument>(V)) {
+    Function *F = A->getParent();
+    for (Value::user_iterator U = F->user_begin(), Ue = F->user_end(); U != Ue; ++U)
+      AS = meet(AS, spaceOf(cast<CallInst>(*U)->getArgOperand(A->getArgNo())));
+  } else if (CallInst *CI = dyn_cast<CallInst>(V)) {
+    Function *F = CI->getCalledFunction();
+    for (Function::iterator B = F->begin(), Be = F->end(); B != Be; ++B)
+      if (ReturnInst *RI = dyn_cast<ReturnInst>(B->getTerminator()))
+        AS = meet(AS, spaceOf(RI->getReturnValue()));
+  }
+  return AS;
+}
+
+// Queues the values whose address space depends on the one of V.
+void InferAddressSpaces::pushUsers(Value *V, SetVector<Value *> &Worklist) const {
+  for (Value::user_iterator U = V->user_begin(), Ue = V->user_end(); U != Ue; ++U) {
+    if (isTracked(*U)) {
+      Worklist.insert(*U);
+    } else if (CallInst *CI = dyn_cast<CallInst>(*U)) {
+      Function *F = CI->getCalledFunction();
+      if (!F || !Internal.count(F))
+        continue;
+      Function::arg_iterator A = F->arg_begin();
+      for (unsigned i = 0, e = CI->getNumArgOperands(); i != e; ++i, ++A)
+        if (CI->getArgOperand(i) == V)
+          Worklist.insert(A);
+    } else if (ReturnInst *RI = dyn_cast<ReturnInst>(*U)) {
+      Function *F = RI->getParent()->getParent();
+      if (!Internal.count(F))
+        continue;
+      for (Value::user_iterator C = F->user_begin(), Ce = F->user_end(); C != Ce; ++C)
+        Worklist.insert(*C);
+    }
+  }
+}
+
+// Returns V as a pointer into address space AS, cloning the GEPs, bitcasts,
+// phis and selects it is computed by. Arguments and call results, the values
+// the rewrite cannot reach the source of, are cast where they are defined.
+Value *InferAddressSpaces::rewrite(Value *V, unsigned AS) {
+  PointerType *NewTy = PointerType::get(V->getType()->getPointerElementType(), AS);
+  if (V->getType() == NewTy)
+    return V;
+  DenseMap<Value *, Value *>::iterator It = Rewritten.find(V);
+  if (It != Rewritten.end())
+    return It->second;
+
+  Value *NewV = 0;
+  if (isa<UndefValue>(V)) {
+    NewV = UndefValue::get(NewTy);
+  } else if (isa<ConstantPointerNull>(V)) {
+    NewV = ConstantPointerNull::get(NewTy);
+  } else if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+    NewV = ConstantExpr::getPointerCast(CE->getOperand(0), NewTy);
+  } else if (AddrSpaceCastInst *ASC = dyn_cast<AddrSpaceCastInst>(V)) {
+    NewV = ASC->getOperand(0);
+    if (NewV->getType() != NewTy)
+      NewV = new BitCastInst(NewV, NewTy, ASC->getName(), ASC);
+  } else if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(V)) {
+    std::vector<Value *> Indices(GEP->idx_begin(), GEP->idx_end());
+    GetElementPtrInst *NewGEP =
+        GetElementPtrInst::Create(rewrite(GEP->getPointerOperand(), AS),
+                                  ArrayRef<Value *>(Indices), GEP->getName(), GEP);
+    NewGEP->setIsInBounds(GEP->isInBounds());
+    NewV = NewGEP;
+  } else if (BitCastInst *BCI = dyn_cast<BitCastInst>(V)) {
+    NewV = new BitCastInst(rewrite(BCI->getOperand(0), AS), NewTy, BCI->getName(), BCI);
+  } else if (SelectInst *SI = dyn_cast<SelectInst>(V)) {
+    NewV = SelectInst::Create(SI->getCondition(), rewrite(SI->getTrueValue(), AS),
+                              rewrite(SI->getFalseValue(), AS), SI->getName(), SI);
+  } else if (PHINode *PHI = dyn_cast<PHINode>(V)) {
+    // the phi is recorded first, the incoming values may depend on it
+    PHINode *NewPHI = PHINode::Create(NewTy, PHI->getNumIncomingValues(),
+                                      PHI->getName(), PHI);
+    Rewritten[V] = NewPHI;
+    for (unsigned i = 0, e = PHI->getNumIncomingValues(); i != e; ++i)
+      NewPHI->addIncoming(rewrite(PHI->getIncomingValue(i), AS), PHI->getIncomingBlock(i));
+    return NewPHI;
+  } else if (Argument *A = dyn_cast<Argument>(V)) {
+    BasicBlock &Entry = A->getParent()->getEntryBlock();
+    NewV = new AddrSpaceCastInst(A, NewTy, A->getName(), Entry.getFirstInsertionPt());
+  } else {
+    Instruction *I = cast<Instruction>(V);
+    BasicBlock::iterator Next = I;
+    ++Next;
+    NewV = new AddrSpaceCastInst(I, NewTy, I->getName(), Next);
+  }
+  Rewritten[V] = NewV;
+  return NewV;
+}
+
+bool InferAddressSpaces::runOnModule(Module &M) {
+  Internal.clear();
+  Spaces.clear();
+  Rewritten.clear();
+
+  for (Module::iterator F = M.begin(), Fe = M.end(); F != Fe; ++F)
+    if (isInternal(*F))
+      Internal.insert(F);
+
+  SetVector<Value *> Worklist;
+  for (Module::iterator F = M.begin(), Fe = M.end(); F != Fe; ++F) {
+    for (Function::arg_iterator A = F->arg_begin(), Ae = F->arg_end(); A != Ae; ++A)
+      if (isTracked(A))
+        Worklist.insert(A);
+    for (Function::iterator B = F->begin(), Be = F->end(); B != Be; ++B)
+      for (BasicBlock::iterator I = B->begin(), Ie = B->end(); I != Ie; ++I)
+        if (isTracked(I))
+          Worklist.insert(I);
+  }
+
+  // the address spaces only go down from uninitialized to flat, so every value
+  // is updated at most twice
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    unsigned AS = infer(V);
+    if (AS == spaceOf(V))
+      continue;
+    Spaces[V] = AS;
+    pushUsers(V, Worklist);
+  }
+
+  std::vector<std::pair<Instruction *, unsigned> > Accesses;
+  for (Module::iterator F = M.begin(), Fe = M.end(); F != Fe; ++F) {
+    for (Function::iterator B = F->begin(), Be = F->end(); B != Be; ++B) {
+      for (BasicBlock::iterator I = B->begin(), Ie = B->end(); I != Ie; ++I) {
+        if (isa<LoadInst>(I))
+          Accesses.push_back(std::make_pair(&*I, LoadInst::getPointerOperandIndex()));
+        else if (isa<StoreInst>(I))
+          Accesses.push_back(std::make_pair(&*I, StoreInst::getPointerOperandIndex()));
+        else if (isa<AtomicRMWInst>(I) || isa<AtomicCmpXchgInst>(I))
+          Accesses.push_back(std::make_pair(&*I, 0u));
+      }
+    }
+  }
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Accesses.size(); i != e; ++i) {
+    Instruction *I = Accesses[i].first;
+    Value *Ptr = I->getOperand(Accesses[i].second);
+    if (!isFlatPointer(Ptr))
+      continue;
+    unsigned AS = spaceOf(Ptr);
+    if (AS == FlatAddressSpace || AS == UninitializedAddressSpace)
+      continue;
+    DEBUG(llvm::errs() << "Accessing addrspace(" << AS << "): " << *I << "\n";);
+    I->setOperand(Accesses[i].second, rewrite(Ptr, AS));
+    Changed = true;
+  }
+  // the flat pointers left without users are erased by -dce
+  return Changed;
+}
+
+char InferAddressSpaces::ID = 0;
+static RegisterPass<InferAddressSpaces>
+Y("infer-address-spaces", "Infer the address spaces of flat pointers.");
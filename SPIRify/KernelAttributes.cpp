@@ -0,0 +1,284 @@
+//===- KernelAttributes.cpp - Launch bounds of kernels from annotations ---===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The hc_max_workgroup_dim(x,y,z) and hc_waves_per_eu(n) macros of hc_defines.h
+// annotate the call operator of a kernel functor or lambda. This pass turns the
+// annotations into attributes of the kernels of the module, before
+// -erase-nonkernels drops llvm.global.annotations: the "hc-max-workgroup-dim"
+// and "hc-waves-per-eu" attributes the kernel properties are written from, and
+// the ones the AMDGPU backend takes its register budget from.
+//
+// With -kernel-profile, the pass also reads the kernel profile the runtime
+// writes with HCC_KERNEL_PROFILE. The kernels taking at least
+// -kernel-profile-hot percent of the profiled time get the largest workgroup
+// they were dispatched with as launch bounds, unless they are annotated, and
+// the functions they call are inlined into them.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "KernelAttributes"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/CallSite.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cxxabi.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace llvm;
+
+static cl::opt<std::string>
+KernelProfile("kernel-profile", cl::init(""), cl::Hidden,
+  cl::desc("optimize the kernels which take the most time in a kernel profile written with HCC_KERNEL_PROFILE"));
+
+static cl::opt<unsigned>
+KernelProfileHot("kernel-profile-hot", cl::init(10), cl::Hidden,
+  cl::desc("percent of the time of the kernel profile from which a kernel is optimized"));
+
+namespace {
+
+struct LaunchBounds {
+  unsigned MaxWorkgroupDim[3];
+  unsigned WavesPerEU;
+  LaunchBounds() : WavesPerEU(0) {
+    MaxWorkgroupDim[0] = MaxWorkgroupDim[1] = MaxWorkgroupDim[2] = 0;
+  }
+};
+
+/// KernelAttributes Class - Attributes the kernels with the launch bounds
+/// annotated on them, or on the call operator of the functor they launch.
+///
+/// The kernel of a functor is its __cxxamp_trampoline, which the call operator
+/// is inlined into, so an annotated call operator applies to the kernels of
+/// the class it's a member of. A grid_launch function is a kernel itself.
+///
+class KernelAttributes : public ModulePass {
+public:
+  static char ID;
+  KernelAttributes() : ModulePass(ID) {}
+  virtual ~KernelAttributes() {}
+  bool runOnModule(Module &M);
+};
+
+} // ::<unnamed> namespace
+
+// Whether Text is an hc launch bound, which are added to Bounds.
+static bool parseAnnotation(StringRef Text, LaunchBounds &Bounds) {
+  std::string S = Text.str();
+  unsigned X = 0, Y = 0, Z = 0, N = 0;
+  char End = 0;
+  if (std::sscanf(S.c_str(), "hc_max_workgroup_dim(%u,%u,%u%c", &X, &Y, &Z, &End) == 4 && End == ')') {
+    if (!X || !Y || !Z) {
+      errs() << "ignoring " << Text << ": the dimensions of a workgroup are at least 1\n";
+      return false;
+    }
+    Bounds.MaxWorkgroupDim[0] = X;
+    Bounds.MaxWorkgroupDim[1] = Y;
+    Bounds.MaxWorkgroupDim[2] = Z;
+    return true;
+  }
+  if (std::sscanf(S.c_str(), "hc_waves_per_eu(%u%c", &N, &End) == 2 && End == ')') {
+    if (!N) {
+      errs() << "ignoring " << Text << ": a kernel has at least 1 wave per EU\n";
+      return false;
+    }
+    Bounds.WavesPerEU = N;
+    return true;
+  }
+  return false;
+}
+
+// The demangled name of F up to Member, as "Foo" of "Foo::operator()(...)",
+// or an empty string if F isn't such a member.
+static std::string scopeOf(const Function &F, const char *Member) {
+  int Status = 0;
+  char *Demangled = abi::__cxa_demangle(F.getName().str().c_str(), 0, 0, &Status);
+  if (Status != 0 || !Demangled)
+    return std::string();
+  std::string Name(Demangled);
+  std::free(Demangled);
+  size_t Pos = Name.find(Member);
+  return Pos == std::string::npos ? std::string() : Name.substr(0, Pos);
+}
+
+static void addAttributes(Function *Kernel, const LaunchBounds &Bounds) {
+  DEBUG(llvm::errs() << "Launch bounds of " << Kernel->getName() << "\n";);
+  if (Bounds.MaxWorkgroupDim[0]) {
+    unsigned Size = Bounds.MaxWorkgroupDim[0] * Bounds.MaxWorkgroupDim[1] * Bounds.MaxWorkgroupDim[2];
+    std::string Dims, FlatSize;
+    raw_string_ostream(Dims) << Bounds.MaxWorkgroupDim[0] << "," << Bounds.MaxWorkgroupDim[1]
+                             << "," << Bounds.MaxWorkgroupDim[2];
+    raw_string_ostream(FlatSize) << "1," << Size;
+    Kernel->addFnAttr("hc-max-workgroup-dim", Dims);
+    Kernel->addFnAttr("amdgpu-flat-work-group-size", FlatSize);
+  }
+  if (Bounds.WavesPerEU) {
+    std::string Waves;
+    raw_string_ostream(Waves) << Bounds.WavesPerEU;
+    Kernel->addFnAttr("hc-waves-per-eu", Waves);
+    Kernel->addFnAttr("amdgpu-waves-per-eu", Waves);
+  }
+}
+
+struct ProfileEntry {
+  uint64_t Dispatches;
+  uint64_t Time;
+  unsigned Workgroup[3];
+};
+
+// The lines "<kernel> <dispatches> <time> <x>,<y>,<z>" of the kernel profile
+// at Path, and their total time.
+static bool readProfile(const std::string &Path, std::map<std::string, ProfileEntry> &Profile,
+                        uint64_t &Total) {
+  std::ifstream In(Path.c_str());
+  if (!In) {
+    errs() << "can't read the kernel profile " << Path << "\n";
+    return false;
+  }
+  Total = 0;
+  std::string Line;
+  while (std::getline(In, Line)) {
+    std::istringstream Fields(Line);
+    std::string Name;
+    ProfileEntry E;
+    char Comma;
+    if (Fields >> Name >> E.Dispatches >> E.Time >> E.Workgroup[0] >> Comma >> E.Workgroup[1]
+               >> Comma >> E.Workgroup[2]) {
+      Profile[Name] = E;
+      Total += E.Time;
+    }
+  }
+  return true;
+}
+
+// Marks the functions Kernel calls, directly or not, always_inline, unless
+// they are noinline.
+static void inlineCallees(Function *Kernel) {
+  SmallVector<Function *, 16> Worklist;
+  Worklist.push_back(Kernel);
+  while (!Worklist.empty()) {
+    Function *F = Worklist.pop_back_val();
+    for (Function::iterator BB = F->begin(), BE = F->end(); BB != BE; ++BB)
+      for (BasicBlock::iterator I = BB->begin(), IE = BB->end(); I != IE; ++I) {
+        CallSite CS(&*I);
+        Function *Callee = CS ? CS.getCalledFunction() : 0;
+        if (!Callee || Callee == Kernel || Callee->isDeclaration() ||
+            Callee->hasFnAttribute(Attribute::NoInline) ||
+            Callee->hasFnAttribute(Attribute::AlwaysInline))
+          continue;
+        Callee->addFnAttr(Attribute::AlwaysInline);
+        Worklist.push_back(Callee);
+      }
+  }
+}
+
+// Optimizes the kernels which take the most time in the kernel profile.
+static bool applyProfile(ArrayRef<Function *> Kernels) {
+  std::map<std::string, ProfileEntry> Profile;
+  uint64_t Total = 0;
+  if (!readProfile(KernelProfile, Profile, Total) || Total == 0)
+    return false;
+
+  bool Changed = false;
+  for (unsigned k = 0, ke = Kernels.size(); k != ke; ++k) {
+    Function *Kernel = Kernels[k];
+    std::map<std::string, ProfileEntry>::const_iterator Entry = Profile.find(Kernel->getName().str());
+    if (Entry == Profile.end() || Entry->second.Time * 100 < Total * KernelProfileHot)
+      continue;
+    DEBUG(llvm::errs() << "Hot kernel " << Kernel->getName() << ": " << Entry->second.Time << " of "
+                       << Total << "ns\n";);
+
+    // the register budget of the largest workgroup dispatched, annotated
+    // launch bounds apply as they are
+    if (!Kernel->hasFnAttribute("hc-max-workgroup-dim")) {
+      LaunchBounds Bounds;
+      for (int i = 0; i < 3; ++i)
+        Bounds.MaxWorkgroupDim[i] = std::max(Entry->second.Workgroup[i], 1u);
+      addAttributes(Kernel, Bounds);
+    }
+    inlineCallees(Kernel);
+    Changed = true;
+  }
+  return Changed;
+}
+
+// The launch bounds of the annotations of the module.
+static bool applyAnnotations(Module &M, ArrayRef<Function *> Kernels) {
+  GlobalVariable *Annotations = M.getGlobalVariable("llvm.global.annotations");
+  if (!Annotations || !Annotations->hasInitializer())
+    return false;
+  ConstantArray *Entries = dyn_cast<ConstantArray>(Annotations->getInitializer());
+  if (!Entries)
+    return false;
+
+  bool Changed = false;
+  for (unsigned i = 0, e = Entries->getNumOperands(); i != e; ++i) {
+    // { i8* annotated, i8* annotation, i8* file, i32 line }
+    ConstantStruct *Entry = dyn_cast<ConstantStruct>(Entries->getOperand(i));
+    if (!Entry || Entry->getNumOperands() < 2)
+      continue;
+    Function *Annotated = dyn_cast<Function>(Entry->getOperand(0)->stripPointerCasts());
+    GlobalVariable *Str = dyn_cast<GlobalVariable>(Entry->getOperand(1)->stripPointerCasts());
+    if (!Annotated || !Str || !Str->hasInitializer())
+      continue;
+    ConstantDataSequential *Data = dyn_cast<ConstantDataSequential>(Str->getInitializer());
+    if (!Data || !Data->isCString())
+      continue;
+    LaunchBounds Bounds;
+    if (!parseAnnotation(Data->getAsCString(), Bounds))
+      continue;
+
+    std::string Scope = scopeOf(*Annotated, "::operator()");
+    for (unsigned k = 0, ke = Kernels.size(); k != ke; ++k) {
+      Function *Kernel = Kernels[k];
+      if (Kernel != Annotated &&
+          (Scope.empty() || scopeOf(*Kernel, "::__cxxamp_trampoline(") != Scope))
+        continue;
+      addAttributes(Kernel, Bounds);
+      Changed = true;
+    }
+  }
+  return Changed;
+}
+
+bool KernelAttributes::runOnModule(Module &M) {
+  NamedMDNode *KernelList = M.getNamedMetadata("opencl.kernels");
+  if (!KernelList)
+    return false;
+
+  SmallVector<Function *, 8> Kernels;
+  for (unsigned i = 0, e = KernelList->getNumOperands(); i != e; ++i) {
+    MDNode *N = KernelList->getOperand(i);
+    if (Function *F = N->getNumOperands() ? dyn_cast_or_null<Function>(N->getOperand(0)) : 0)
+      Kernels.push_back(F);
+  }
+
+  bool Changed = applyAnnotations(M, Kernels);
+  if (!KernelProfile.empty())
+    Changed |= applyProfile(Kernels);
+  return Changed;
+}
+
+char KernelAttributes::ID = 0;
+static RegisterPass<KernelAttributes>
+Y("kernel-attributes", "Attribute kernels with their annotated launch bounds.");
@@ -12,6 +12,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/PostOrderIterator.h"
+#include "llvm/IR/CFG.h"
 #include "llvm/IR/InstVisitor.h"
 #include "llvm/Analysis/PostDominators.h"
 //#include "llvm/Assembly/Writer.h"
@@ -48,19 +51,30 @@ public:
   virtual bool runOnFunction(Function &F);
 };
 
-/// NewedMemoryAnalyzer Class - Used to compute if an instruction will use operand from new/delete
+/// NewedMemoryAnalyzer Class - Used to compute which instructions use operands from new/delete
 ///
-class NewedMemoryAnalyzer : public InstVisitor<NewedMemoryAnalyzer> {
+/// A value is newed if it is a call to new, or a bitcast, a getelementptr or a private load of
+/// a newed value. The values are computed once per function, in reverse post-order so that the
+/// operands are known before their users; phis and values of unreachable blocks are not newed.
+class NewedMemoryAnalyzer : public InstVisitor<NewedMemoryAnalyzer, bool> {
 protected:
   Function *NewScalar;
   Function *NewArray;
 
   Function *Memset;
-  //SmallPtrSet<Instruction *, 8> Visited;
-  bool IsNewed;
+  DenseMap<const Value *, bool> Newed;
+
+  bool isNewedOperand(Value *V) {
+    DenseMap<const Value *, bool>::iterator It = Newed.find(V);
+    return It != Newed.end() && It->second;
+  }
+
+  static bool isPrivate(unsigned AS) {
+    return !(AS == 1 || AS == 2 || AS == 3);
+  }
 
 public:
-  NewedMemoryAnalyzer(Function &F) : IsNewed(false) {
+  NewedMemoryAnalyzer(Function &F) {
     Module *M = F.getParent();
     NewScalar = M->getFunction(/*"_Znwj"*/ "_Znwm");
     NewArray = M->getFunction(/*"_Znaj"*/ "_Znam");
@@ -68,80 +82,52 @@ public:
     Memset = M->getFunction("llvm.memset.p0i8.i64");
   }
 
-  bool isNewed() { return IsNewed; }
-
-  bool NotMemIntrinsic(Instruction &I) {
-    if (CallInst *CI = dyn_cast<CallInst>(&I)) {
-      Function *Callee = CI->getCalledFunction();
-      if (Memset && Callee == Memset) 
-        return false;
+  /// Entry point of analysis, collects the loads, stores and memsets which access newed memory
+  void analyze(Function &F, std::vector<Instruction*> &NeedPromoted) {
+    ReversePostOrderTraversal<Function*> RPOT(&F);
+    for (ReversePostOrderTraversal<Function*>::rpo_iterator BB = RPOT.begin(), BE = RPOT.end(); BB != BE; ++BB) {
+      for (BasicBlock::iterator I = (*BB)->begin(), E = (*BB)->end(); I != E; ++I) {
+        if (visit(*I)) {
+          Newed[&*I] = true;
+          if (isa<LoadInst>(I))
+            NeedPromoted.push_back(&*I);
+        }
+        if (accessesNewed(*I))
+          NeedPromoted.push_back(&*I);
+      }
     }
-    return true;
   }
 
-  /// Entry point of analysis
-  void analyze(Instruction &I) { 
-    if (!isa<StoreInst>(&I) && !isa<LoadInst>(&I) && NotMemIntrinsic(I)) {
-    //if (!I.mayReadOrWriteMemory()) {
-      IsNewed = false;
-      return;
-    }
-    visit(I); 
+  /// Stores and memsets to newed memory; loads are newed values of their own
+  bool accessesNewed(Instruction &I) {
+    if (StoreInst *SI = dyn_cast<StoreInst>(&I))
+      return isPrivate(SI->getPointerAddressSpace()) && isNewedOperand(SI->getPointerOperand());
+    if (CallInst *CI = dyn_cast<CallInst>(&I))
+      return Memset && CI->getCalledFunction() == Memset && isNewedOperand(CI->getArgOperand(0));
+    return false;
   }
 
-  /// Opcode Implementations
-  void visitLoadInst(LoadInst &I) {
-    unsigned AS = I.getPointerAddressSpace();
-    if (AS == 1 || AS == 2 || AS == 3) {
-      IsNewed = false;
-      return;
-    }
-    if (Instruction *Operand = dyn_cast<Instruction>(I.getPointerOperand()))
-      visit(*Operand);
-  }
-  
-  void visitStoreInst(StoreInst &I) {
-    unsigned AS = I.getPointerAddressSpace();
-    if (AS == 1 || AS == 2 || AS == 3) {
-      IsNewed = false;
-      return;
-    }
-    if (Instruction *Operand = dyn_cast<Instruction>(I.getPointerOperand()))
-      visit(*Operand);
+  /// Opcode Implementations, whether the value of the instruction is newed
+  bool visitLoadInst(LoadInst &I) {
+    return isPrivate(I.getPointerAddressSpace()) && isNewedOperand(I.getPointerOperand());
   }
 
-  void visitBitCastInst(BitCastInst &I) {
-    if (Instruction *Operand = dyn_cast<Instruction>(I.getOperand(0)))
-      visit(*Operand);
+  bool visitBitCastInst(BitCastInst &I) {
+    return isNewedOperand(I.getOperand(0));
   }
 
-  void visitGetElementPtrInst(GetElementPtrInst  &I) {
-    if (Instruction *Operand = dyn_cast<Instruction>(I.getPointerOperand()))
-      visit(*Operand);
+  bool visitGetElementPtrInst(GetElementPtrInst &I) {
+    return isNewedOperand(I.getPointerOperand());
   }
 
-  void visitCallInst(CallInst &I) {
+  bool visitCallInst(CallInst &I) {
     Function *Callee = I.getCalledFunction();
-
-    if ((NewScalar && Callee == NewScalar) || (NewArray && Callee == NewArray)) {
-      IsNewed =true;
-      return;
-    }
-
-    if (Memset && Callee == Memset) {
-      if (Instruction *Operand = dyn_cast<Instruction>(I.getArgOperand(0)))
-      {
-        //llvm::errs() << "I: " << I << "\n";
-        //llvm::errs() << "Operand" << *Operand << "\n";
-        visit(*Operand);
-      }
-    }
+    return (NewScalar && Callee == NewScalar) || (NewArray && Callee == NewArray);
   }
 
-#if 0
-  void visitInstruction(Instruction &I);
-#endif
-
+  bool visitInstruction(Instruction &I) {
+    return false;
+  }
 };
 
 } // ::<unnamed> namespace
@@ -162,13 +148,8 @@ bool PromotePrivates::runOnFunction(Function &F) {
   LLVMContext& C = F.getContext();
   std::vector<Instruction*> NeedPromoted;
 
-  for (inst_iterator I = inst_begin(&F), E = inst_end(&F); I != E; ++I) {
-    NewedMemoryAnalyzer NMA(F);
-    NMA.analyze(*I);
-    
-    if (NMA.isNewed())
-      NeedPromoted.push_back(&*I);
-  }
+  NewedMemoryAnalyzer NMA(F);
+  NMA.analyze(F, NeedPromoted);
 
 #if 0
   for (unsigned i = 0; i < NeedPromoted.size(); i++)
@@ -0,0 +1,467 @@
+//===- TileStaticBanks.cpp - LDS bank conflicts of tile_static arrays -----===//
+//
+//                     The LLVM Compiler Infrastructure
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+//
+// The LDS is split into banks of 4 bytes, and the work-items of a wavefront
+// accessing words of the same bank are served one word at a time. A column of
+// a tile_static tile, as read by a transpose, is a stride of a whole row, a
+// multiple of the banks when the rows are a power of two long, so all the
+// work-items hit the same bank. This pass finds the accesses to the
+// tile_static arrays whose index is an affine function of the work-item id of
+// the first dimension, the one consecutive work-items of a wavefront differ in,
+// and reports the arrays accessed with bank conflicts.
+//
+// With -tile-static-pad, the rows of the multidimensional arrays are padded
+// with the fewest elements which remove the conflicts, provided all the users
+// of an array address whole elements of it, which are only loaded, stored or
+// atomically updated, so nothing relies on its layout. The conflicts it can't
+// remove are still reported.
+//
+//===----------------------------------------------------------------------===//
+
+#define DEBUG_TYPE "TileStaticBanks"
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SmallPtrSet.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Operator.h"
+#include "llvm/Pass.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Debug.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+using namespace llvm;
+
+static cl::opt<bool>
+TileStaticPad("tile-static-pad", cl::init(false), cl::Hidden,
+  cl::desc("pad the rows of tile_static arrays to remove their LDS bank conflicts"));
+
+static cl::opt<unsigned>
+TileStaticBankCount("tile-static-bank-count", cl::init(32), cl::Hidden,
+  cl::desc("number of 4-byte banks of the LDS"));
+
+namespace {
+
+enum {
+  LocalAddressSpace = 3
+};
+
+// the work-item id builtins, of which dimension 0 differs between the
+// work-items of a wavefront
+const char *const LaneIdFunctions[] = {
+  "amp_get_local_id", "amp_get_global_id", "hc_get_workitem_id",
+  "hc_get_workitem_absolute_id", "get_local_id", "get_global_id"
+};
+
+// An access to a tile_static array by the work-items of a wavefront.
+struct Access {
+  Instruction *I;
+  // how many elements each index into the dimensions of the array steps by
+  // from a work-item to the next
+  std::vector<int64_t> Coefs;
+  // bytes accessed
+  uint64_t Size;
+};
+
+struct TileStatic {
+  GlobalVariable *G;
+  std::vector<uint64_t> Dims;
+  uint64_t ElementSize;
+  std::vector<Access> Accesses;
+};
+
+/// TileStaticBanks Class - Reports the LDS bank conflicts of tile_static
+/// arrays, and pads the rows of the arrays it can to remove them.
+///
+class TileStaticBanks : public ModulePass {
+public:
+  static char ID;
+  TileStaticBanks() : ModulePass(ID) {}
+  virtual ~TileStaticBanks() {}
+  bool runOnModule(Module &M);
+
+private:
+  SmallPtrSet<const Value *, 32> Dependent;
+
+  void findDependent(Module &M);
+  bool laneCoefficient(Value *V, int64_t &Coef, unsigned Depth) const;
+  bool analyze(Instruction *I, Value *Ptr, Type *Ty, const DataLayout &DL,
+               std::vector<TileStatic> &Arrays,
+               DenseMap<const GlobalVariable *, unsigned> &Index) const;
+  unsigned ways(const TileStatic &A, uint64_t Pad, Function **Worst) const;
+  void pad(TileStatic &A, uint64_t Pad);
+};
+
+} // ::<unnamed> namespace
+
+static bool isLaneId(const Value *V) {
+  const CallInst *CI = dyn_cast<CallInst>(V);
+  if (!CI || !CI->getCalledFunction() || CI->getNumArgOperands() != 1)
+    return false;
+  StringRef Name = CI->getCalledFunction()->getName();
+  if (std::find(std::begin(LaneIdFunctions), std::end(LaneIdFunctions), Name) ==
+      std::end(LaneIdFunctions))
+    return false;
+  const ConstantInt *Dim = dyn_cast<ConstantInt>(CI->getArgOperand(0));
+  return Dim && Dim->isZero();
+}
+
+// Strips the casts between pointers, which keep the address.
+static Value *stripCasts(Value *V) {
+  while (Operator::getOpcode(V) == Instruction::BitCast ||
+         Operator::getOpcode(V) == Instruction::AddrSpaceCast)
+    V = cast<Operator>(V)->getOperand(0);
+  return V;
+}
+
+// Returns the type of the elements of the array of arrays Ty, with the sizes
+// of its dimensions.
+static Type *getDims(Type *Ty, std::vector<uint64_t> &Dims) {
+  while (ArrayType *AT = dyn_cast<ArrayType>(Ty)) {
+    Dims.push_back(AT->getNumElements());
+    Ty = AT->getElementType();
+  }
+  return Ty;
+}
+
+// The type of the array of arrays Ty with its rows lengthened by Pad elements.
+static Type *padType(Type *Ty, uint64_t Pad) {
+  ArrayType *AT = cast<ArrayType>(Ty);
+  Type *Elt = AT->getElementType();
+  if (!isa<ArrayType>(Elt))
+    return ArrayType::get(Elt, AT->getNumElements() + Pad);
+  return ArrayType::get(padType(Elt, Pad), AT->getNumElements());
+}
+
+// How many distinct words of the busiest bank the work-items of a wavefront
+// access, Size bytes each at addresses Stride bytes apart, within the work-items
+// served at once.
+static unsigned conflictWays(int64_t Stride, uint64_t Size) {
+  const int64_t Banks = TileStaticBankCount;
+  uint64_t Words = std::max<uint64_t>(1, (Size + 3) / 4);
+  uint64_t Lanes = std::max<uint64_t>(1, Banks / Words);
+  std::map<int64_t, std::set<int64_t> > Accessed;
+  unsigned Ways = 1;
+  for (uint64_t L = 0; L < Lanes; ++L) {
+    int64_t Address = static_cast<int64_t>(L) * Stride;
+    int64_t First = Address >= 0 ? Address / 4 : -((3 - Address) / 4);
+    for (uint64_t W = 0; W < Words; ++W) {
+      int64_t Word = First + W;
+      std::set<int64_t> &InBank = Accessed[((Word % Banks) + Banks) % Banks];
+      InBank.insert(Word);
+      Ways = std::max<unsigned>(Ways, InBank.size());
+    }
+  }
+  return Ways;
+}
+
+// The element accesses of a tile_static array don't rely on its layout.
+static bool isElementAccess(const Value *Ptr, const User *U) {
+  if (isa<LoadInst>(U))
+    return true;
+  if (const StoreInst *SI = dyn_cast<StoreInst>(U))
+    return SI->getPointerOperand() == Ptr;
+  if (const AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(U))
+    return RMW->getPointerOperand() == Ptr;
+  if (const AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(U))
+    return CX->getPointerOperand() == Ptr;
+  if (isa<AddrSpaceCastInst>(U)) {
+    for (Value::const_user_iterator C = U->user_begin(), Ce = U->user_end(); C != Ce; ++C)
+      if (!isElementAccess(U, *C))
+        return false;
+    return true;
+  }
+  return false;
+}
+
+// Returns the first user relying on the layout of the tile_static array G,
+// or null if all its users address whole elements of it.
+static const User *layoutUser(const GlobalVariable *G, unsigned Depth) {
+  for (Value::const_user_iterator U = G->user_begin(), Ue = G->user_end(); U != Ue; ++U) {
+    const GEPOperator *GEP = dyn_cast<GEPOperator>(*U);
+    if (!GEP || GEP->getPointerOperand() != G || GEP->getNumIndices() < Depth + 1)
+      return *U;
+    const ConstantInt *First = dyn_cast<ConstantInt>(GEP->idx_begin()->get());
+    if (!First || !First->isZero())
+      return *U;
+    for (Value::const_user_iterator C = GEP->user_begin(), Ce = GEP->user_end(); C != Ce; ++C)
+      if (!isElementAccess(GEP, *C))
+        return *C;
+  }
+  return 0;
+}
+
+// Finds the values which differ between the work-items of a wavefront, the
+// ones computed from the work-item id of dimension 0.
+void TileStaticBanks::findDependent(Module &M) {
+  SmallVector<Value *, 16> Worklist;
+  for (Module::iterator F = M.begin(), Fe = M.end(); F != Fe; ++F)
+    for (Function::iterator B = F->begin(), Be = F->end(); B != Be; ++B)
+      for (BasicBlock::iterator I = B->begin(), Ie = B->end(); I != Ie; ++I)
+        if (isLaneId(I) && !Dependent.count(I)) {
+          Dependent.insert(I);
+          Worklist.push_back(I);
+        }
+  while (!Worklist.empty()) {
+    Value *V = Worklist.pop_back_val();
+    for (Value::user_iterator U = V->user_begin(), Ue = V->user_end(); U != Ue; ++U)
+      if (isa<Instruction>(*U) && !Dependent.count(*U)) {
+        Dependent.insert(*U);
+        Worklist.push_back(*U);
+      }
+  }
+}
+
+// Computes Coef, how much V steps by from a work-item of a wavefront to the
+// next, if V is an affine function of the work-item id.
+bool TileStaticBanks::laneCoefficient(Value *V, int64_t &Coef, unsigned Depth) const {
+  if (!Dependent.count(V)) {
+    Coef = 0;
+    return true;
+  }
+  if (isLaneId(V)) {
+    Coef = 1;
+    return true;
+  }
+  if (Depth == 0)
+    return false;
+  if (isa<TruncInst>(V) || isa<ZExtInst>(V) || isa<SExtInst>(V))
+    return laneCoefficient(cast<CastInst>(V)->getOperand(0), Coef, Depth - 1);
+  BinaryOperator *BO = dyn_cast<BinaryOperator>(V);
+  int64_t A = 0, B = 0;
+  if (!BO || !laneCoefficient(BO->getOperand(0), A, Depth - 1) ||
+      !laneCoefficient(BO->getOperand(1), B, Depth - 1))
+    return false;
+  ConstantInt *C0 = dyn_cast<ConstantInt>(BO->getOperand(0));
+  ConstantInt *C1 = dyn_cast<ConstantInt>(BO->getOperand(1));
+  switch (BO->getOpcode()) {
+  case Instruction::Add:
+    Coef = A + B;
+    return true;
+  case Instruction::Sub:
+    Coef = A - B;
+    return true;
+  case Instruction::Mul:
+    if (C1) {
+      Coef = A * C1->getSExtValue();
+      return true;
+    }
+    if (C0) {
+      Coef = B * C0->getSExtValue();
+      return true;
+    }
+    return false;
+  case Instruction::Shl:
+    if (C1 && C1->getZExtValue() < 32) {
+      Coef = A * (static_cast<int64_t>(1) << C1->getZExtValue());
+      return true;
+    }
+    return false;
+  default:
+    return false;
+  }
+}
+
+// Records the access I of Ty through Ptr, if it is into a tile_static array
+// with indices affine in the work-item id.
+bool TileStaticBanks::analyze(Instruction *I, Value *Ptr, Type *Ty, const DataLayout &DL,
+                              std::vector<TileStatic> &Arrays,
+                              DenseMap<const GlobalVariable *, unsigned> &Index) const {
+  GEPOperator *GEP = dyn_cast<GEPOperator>(stripCasts(Ptr));
+  if (!GEP)
+    return false;
+  GlobalVariable *G = dyn_cast<GlobalVariable>(stripCasts(GEP->getPointerOperand()));
+  if (!G || G->getType()->getAddressSpace() != LocalAddressSpace ||
+      !isa<ArrayType>(G->getType()->getElementType()))
+    return false;
+  ConstantInt *First = dyn_cast<ConstantInt>(GEP->idx_begin()->get());
+  if (!First || !First->isZero())
+    return false;
+
+  DenseMap<const GlobalVariable *, unsigned>::iterator It = Index.find(G);
+  if (It == Index.end()) {
+    TileStatic A;
+    A.G = G;
+    A.ElementSize = DL.getTypeAllocSize(getDims(G->getType()->getElementType(), A.Dims));
+    It = Index.insert(std::make_pair(G, Arrays.size())).first;
+    Arrays.push_back(A);
+  }
+  TileStatic &A = Arrays[It->second];
+
+  Access Acc;
+  Acc.I = I;
+  Acc.Size = DL.getTypeStoreSize(Ty);
+  for (User::op_iterator Idx = GEP->idx_begin() + 1, Ie = GEP->idx_end(); Idx != Ie; ++Idx) {
+    int64_t Coef = 0;
+    if (!laneCoefficient(*Idx, Coef, 8))
+      return false;
+    // the indices into an element are constant
+    if (Acc.Coefs.size() >= A.Dims.size() && Coef != 0)
+      return false;
+    if (Acc.Coefs.size() < A.Dims.size())
+      Acc.Coefs.push_back(Coef);
+  }
+  A.Accesses.push_back(Acc);
+  return true;
+}
+
+// The worst conflict of the accesses to A with its rows padded by Pad
+// elements, and the function of the access it is in.
+unsigned TileStaticBanks::ways(const TileStatic &A, uint64_t Pad, Function **Worst) const {
+  // bytes each index into a dimension steps by
+  std::vector<int64_t> Strides(A.Dims.size());
+  int64_t Stride = A.ElementSize;
+  for (size_t k = A.Dims.size(); k-- > 0; ) {
+    Strides[k] = Stride;
+    Stride *= A.Dims[k] + (k + 1 == A.Dims.size() ? Pad : 0);
+  }
+
+  unsigned Max = 1;
+  for (size_t i = 0; i < A.Accesses.size(); ++i) {
+    const Access &Acc = A.Accesses[i];
+    int64_t Step = 0;
+    for (size_t k = 0; k < Acc.Coefs.size(); ++k)
+      Step += Acc.Coefs[k] * Strides[k];
+    unsigned Ways = conflictWays(Step, Acc.Size);
+    if (Ways > Max) {
+      Max = Ways;
+      if (Worst)
+        *Worst = Acc.I->getParent()->getParent();
+    }
+  }
+  return Max;
+}
+
+// Replaces the array of A by one with its rows padded by Pad elements.
+void TileStaticBanks::pad(TileStatic &A, uint64_t Pad) {
+  GlobalVariable *G = A.G;
+  Type *Ty = padType(G->getType()->getElementType(), Pad);
+  Constant *Init = isa<UndefValue>(G->getInitializer()) ? UndefValue::get(Ty)
+                                                        : Constant::getNullValue(Ty);
+  GlobalVariable *NewG = new GlobalVariable(*G->getParent(), Ty, G->isConstant(), G->getLinkage(),
+                                            Init, "", G, G->getThreadLocalMode(), LocalAddressSpace);
+  NewG->copyAttributesFrom(G);
+  NewG->takeName(G);
+
+  // the indices of the elements are the same, so are the types of the GEPs
+  std::vector<User *> Users(G->user_begin(), G->user_end());
+  for (size_t i = 0; i < Users.size(); ++i) {
+    if (GetElementPtrInst *GEP = dyn_cast<GetElementPtrInst>(Users[i])) {
+      std::vector<Value *> Indices(GEP->idx_begin(), GEP->idx_end());
+      GetElementPtrInst *NewGEP =
+          GetElementPtrInst::Create(NewG, ArrayRef<Value *>(Indices), "", GEP);
+      NewGEP->setIsInBounds(GEP->isInBounds());
+      NewGEP->takeName(GEP);
+      GEP->replaceAllUsesWith(NewGEP);
+      GEP->eraseFromParent();
+    } else {
+      ConstantExpr *CE = cast<ConstantExpr>(Users[i]);
+      std::vector<Constant *> Indices;
+      for (User::op_iterator Idx = CE->op_begin() + 1, Ie = CE->op_end(); Idx != Ie; ++Idx)
+        Indices.push_back(cast<Constant>(*Idx));
+      Constant *NewCE = ConstantExpr::getGetElementPtr(NewG, Indices,
+                                                       cast<GEPOperator>(CE)->isInBounds());
+      CE->replaceAllUsesWith(NewCE);
+      CE->destroyConstant();
+    }
+  }
+  G->eraseFromParent();
+  A.G = NewG;
+  A.Dims.back() += Pad;
+}
+
+bool TileStaticBanks::runOnModule(Module &M) {
+  DataLayout DL(&M);
+  Dependent.clear();
+  findDependent(M);
+
+  std::vector<TileStatic> Arrays;
+  DenseMap<const GlobalVariable *, unsigned> Index;
+  for (Module::iterator F = M.begin(), Fe = M.end(); F != Fe; ++F) {
+    for (Function::iterator B = F->begin(), Be = F->end(); B != Be; ++B) {
+      for (BasicBlock::iterator I = B->begin(), Ie = B->end(); I != Ie; ++I) {
+        if (LoadInst *LI = dyn_cast<LoadInst>(I))
+          analyze(LI, LI->getPointerOperand(), LI->getType(), DL, Arrays, Index);
+        else if (StoreInst *SI = dyn_cast<StoreInst>(I))
+          analyze(SI, SI->getPointerOperand(), SI->getValueOperand()->getType(), DL, Arrays, Index);
+        else if (AtomicRMWInst *RMW = dyn_cast<AtomicRMWInst>(I))
+          analyze(RMW, RMW->getPointerOperand(), RMW->getValOperand()->getType(), DL, Arrays, Index);
+        else if (AtomicCmpXchgInst *CX = dyn_cast<AtomicCmpXchgInst>(I))
+          analyze(CX, CX->getPointerOperand(), CX->getNewValOperand()->getType(), DL, Arrays, Index);
+      }
+    }
+  }
+
+  bool Changed = false;
+  for (size_t i = 0; i < Arrays.size(); ++i) {
+    TileStatic &A = Arrays[i];
+    Function *F = 0;
+    unsigned Ways = ways(A, 0, &F);
+    if (Ways == 1)
+      continue;
+
+    // the fewest elements of padding which remove the most conflicts
+    uint64_t Pad = 0;
+    unsigned Padded = Ways;
+    for (uint64_t P = 1; P <= TileStaticBankCount && Padded > 1; ++P) {
+      unsigned W = ways(A, P, 0);
+      if (W < Padded) {
+        Pad = P;
+        Padded = W;
+      }
+    }
+
+    std::string Reason;
+    raw_string_ostream OS(Reason);
+    const User *U = 0;
+    if (A.Dims.size() < 2) {
+      OS << "cannot pad: it has a single dimension";
+    } else if (!A.G->hasLocalLinkage() || !A.G->hasInitializer() ||
+               !(isa<UndefValue>(A.G->getInitializer()) || A.G->getInitializer()->isNullValue())) {
+      OS << "cannot pad: it is defined outside the module or initialized";
+    } else if ((U = layoutUser(A.G, A.Dims.size()))) {
+      OS << "cannot pad: its layout is relied upon by" << *U;
+    } else if (Pad == 0) {
+      OS << "cannot pad: no padding of its rows removes them";
+    } else if (!TileStaticPad) {
+      OS << "lengthening its rows by " << Pad << " (-tile-static-pad) ";
+      if (Padded > 1)
+        OS << "reduces them to " << Padded << "-way";
+      else
+        OS << "removes them";
+    } else {
+      DEBUG(llvm::errs() << "Padding " << A.G->getName() << " by " << Pad << "\n";);
+      pad(A, Pad);
+      Changed = true;
+      if (Padded > 1)
+        OS << "still " << Padded << "-way after lengthening its rows by " << Pad;
+    }
+    OS.flush();
+    if (!Reason.empty())
+      errs() << "warning: tile_static " << A.G->getName() << ": " << Ways
+             << "-way LDS bank conflicts in " << F->getName() << ", " << Reason << "\n";
+  }
+  return Changed;
+}
+
+char TileStaticBanks::ID = 0;
+static RegisterPass<TileStaticBanks>
+Y("tile-static-banks", "Report, and pad, the LDS bank conflicts of tile_static arrays.");
@@ -13,15 +13,24 @@
 //===----------------------------------------------------------------------===//
 
 #include "llvm/IR/InstVisitor.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/IntrinsicInst.h"
+#include "llvm/IR/Module.h"
 #include "llvm/Analysis/PostDominators.h"
 //#include "llvm/Assembly/Writer.h"
+#include "llvm/Support/CommandLine.h"
 #include "llvm/Support/Debug.h"
+#include "llvm/Support/FileSystem.h"
 
 #include <map>
 #include <set>
 
 using namespace llvm;
 
+static cl::opt<std::string>
+KernelProperties("kernel-properties", cl::init(""), cl::Hidden,
+  cl::desc("write whether each kernel has barriers and uses the group segment to a file"));
+
 namespace {
 
 #define HANDLE_LOAD_PRIVATE 0
@@ -106,6 +115,9 @@ public:
   }
 
   virtual bool runOnModule(Module& M);
+
+private:
+  void writeKernelProperties(Module& M);
 };
 
 } // ::<unnamed> namespace
@@ -255,8 +267,10 @@ void ThreadDependencyAnalyzer::visitInstruction(Instruction &I) {
 ///
 bool TileUniform::runOnModule(Module &M) {
   // FIXME: TileUniform should be implement as a FunctionPass
-  if(!(barrier = M.getFunction("amp_barrier")))
+  if(!(barrier = M.getFunction("amp_barrier"))) {
+    writeKernelProperties(M);
     return false;
+  }
 
   for (Value::user_iterator UI = barrier->user_begin(), UE = barrier->user_end();
         UI != UE; ++UI) {
@@ -303,9 +317,139 @@ bool TileUniform::runOnModule(Module &M) {
       delete CtrlDeps;
     }
   }
+
+  // a barrier which is not tile uniform is fatal, so all the ones left are
+  writeKernelProperties(M);
   return false;
 }
 
+// Whether V is, or is a constant expression of, a variable of the group segment.
+static bool refersToGroupSegment(Value *V) {
+  if (GlobalVariable *GV = dyn_cast<GlobalVariable>(V))
+    return GV->getType()->getAddressSpace() == 3;
+  if (ConstantExpr *CE = dyn_cast<ConstantExpr>(V)) {
+    for (User::op_iterator oi = CE->op_begin(), e = CE->op_end(); oi != e; ++oi)
+      if (refersToGroupSegment(*oi))
+        return true;
+  }
+  return false;
+}
+
+/// Walks the functions F calls, and sets whether any of them calls barrier,
+/// and whether any uses a tile_static variable or a group segment pointer.
+static void collectKernelProperties(Function *F, Function *barrier,
+                                    std::set<Function*> &Visited,
+                                    bool &hasBarriers, bool &usesGroupSegment) {
+  if (!Visited.insert(F).second)
+    return;
+  for (Function::iterator B = F->begin(), Be = F->end(); B != Be; ++B) {
+    for (BasicBlock::iterator I = B->begin(), Ie = B->end(); I != Ie; ++I) {
+      for (User::op_iterator oi = I->op_begin(), e = I->op_end(); oi != e; ++oi)
+        usesGroupSegment |= refersToGroupSegment(*oi);
+
+      CallInst *CI = dyn_cast<CallInst>(I);
+      if (!CI || !CI->getCalledFunction())
+        continue;
+      Function *callee = CI->getCalledFunction();
+      if (callee == barrier) {
+        hasBarriers = true;
+      } else if (callee->isDeclaration()) {
+        // such as get_dynamic_group_segment_base_pointer
+        PointerType *PT = dyn_cast<PointerType>(callee->getReturnType());
+        usesGroupSegment |= PT && PT->getAddressSpace() == 3;
+      } else {
+        collectKernelProperties(callee, barrier, Visited, hasBarriers, usesGroupSegment);
+      }
+    }
+  }
+}
+
+/// Returns whether memory is only read through pointer V: it's loaded from,
+/// compared, or passed on to pointers of the same kind, including the
+/// arguments of the functions defined in the module. Stores through it, or
+/// of it, atomics, and calls of declarations count as writes.
+static bool isReadOnlyPointer(Value *V, std::set<Value*> &Visited) {
+  if (!Visited.insert(V).second)
+    return true;
+  for (Value::use_iterator ui = V->use_begin(), e = V->use_end(); ui != e; ++ui) {
+    User *U = *ui;
+    if (LoadInst *LI = dyn_cast<LoadInst>(U)) {
+      if (LI->getPointerOperand() != V)
+        return false;
+    } else if (isa<GetElementPtrInst>(U) || isa<BitCastInst>(U) ||
+               isa<AddrSpaceCastInst>(U) || isa<PHINode>(U) || isa<SelectInst>(U)) {
+      if (!isReadOnlyPointer(U, Visited))
+        return false;
+    } else if (isa<ICmpInst>(U) || isa<DbgInfoIntrinsic>(U)) {
+      continue;
+    } else if (CallInst *CI = dyn_cast<CallInst>(U)) {
+      Function *callee = CI->getCalledFunction();
+      if (!callee || callee->isDeclaration() || callee->isVarArg())
+        return false;
+      Function::arg_iterator A = callee->arg_begin();
+      for (unsigned i = 0, n = CI->getNumArgOperands(); i != n; ++i, ++A)
+        if (CI->getArgOperand(i) == V && !isReadOnlyPointer(A, Visited))
+          return false;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Writes a line "<kernel> barriers=<none|uniform> group_segment=<0|1>" for
+/// each kernel to the -kernel-properties file, which clamp-link embeds next to
+/// the kernels for the runtime. Kernels with launch bounds have them appended,
+/// as "max_workgroup_dim=<x>,<y>,<z>" and "waves_per_eu=<n>", and kernels
+/// only reading memory through some of their pointer arguments have the
+/// indices of those appended as "readonly_args=<i>,<j>,...".
+void TileUniform::writeKernelProperties(Module &M) {
+  if (KernelProperties.empty())
+    return;
+
+  std::string ErrorInfo;
+  raw_fd_ostream OS(KernelProperties.c_str(), ErrorInfo, sys::fs::F_Text);
+  if (!ErrorInfo.empty()) {
+    errs() << "cannot write kernel properties: " << ErrorInfo << "\n";
+    return;
+  }
+
+  OS << "HCC kernel properties 1\n";
+  NamedMDNode *Kernels = M.getNamedMetadata("opencl.kernels");
+  if (!Kernels)
+    return;
+  for (unsigned i = 0, e = Kernels->getNumOperands(); i != e; ++i) {
+    MDNode *N = Kernels->getOperand(i);
+    Function *F = N->getNumOperands() ? dyn_cast_or_null<Function>(N->getOperand(0)) : 0;
+    if (!F || F->isDeclaration())
+      continue;
+
+    std::set<Function*> Visited;
+    bool hasBarriers = false, usesGroupSegment = false;
+    collectKernelProperties(F, barrier, Visited, hasBarriers, usesGroupSegment);
+    OS << F->getName() << " barriers=" << (hasBarriers ? "uniform" : "none")
+       << " group_segment=" << (usesGroupSegment ? 1 : 0);
+    // the launch bounds -kernel-attributes found annotated on the kernel
+    if (F->hasFnAttribute("hc-max-workgroup-dim"))
+      OS << " max_workgroup_dim=" << F->getAttributes().getAttribute(
+              AttributeSet::FunctionIndex, "hc-max-workgroup-dim").getValueAsString();
+    if (F->hasFnAttribute("hc-waves-per-eu"))
+      OS << " waves_per_eu=" << F->getAttributes().getAttribute(
+              AttributeSet::FunctionIndex, "hc-waves-per-eu").getValueAsString();
+    // buffers the runtime needn't mark modified after the kernel
+    const char *sep = " readonly_args=";
+    unsigned index = 0;
+    for (Function::arg_iterator A = F->arg_begin(), Ae = F->arg_end(); A != Ae; ++A, ++index) {
+      std::set<Value*> VisitedPointers;
+      if (A->getType()->isPointerTy() && isReadOnlyPointer(A, VisitedPointers)) {
+        OS << sep << index;
+        sep = ",";
+      }
+    }
+    OS << "\n";
+  }
+}
+
 char TileUniform::ID = 0;
 static RegisterPass<TileUniform>
 Y("tile-uniform", "Ensure tile uniform.");
@@ -0,0 +1,438 @@
+////////////////////////////////////////////////////////////////////////////////
+// Crude 2D Lattice Boltzmann Demo program
+// HC version, without display, timed as a benchmark
+//
+// This is the 9 velocity set method of 2dLB_C.c:
+// Distribution functions are stored as "f" arrays
+// Think of these as the number of particles moving in these directions:
+//
+//      f6  f2   f5
+//        \  |  /
+//         \ | /
+//          \|/
+//      f3---|--- f1
+//          /|\
+//         / | \       and f0 for the rest (zero) velocity
+//        /  |  \
+//      f7  f4   f8
+//
+// Each step of the C version (stream, boundary conditions, collide) is done
+// by one kernel here. The distributions are stored as structures of arrays,
+// f0 to f8 one after another in an hc::array, and each step reads one array
+// and writes the other one, so the steps are enqueued back to back without
+// the host waiting for any of them. Each tile of work-items loads the
+// distributions of its nodes and of the nodes around them into tile_static
+// memory once, and streams them from there.
+//
+// Usage: 2dLB_hc [ni nj [nsteps]] [--cpu] [--c-mlups X] [--cuda-mlups X]
+//
+// The steps are also run by a port of the C version on the host for a few
+// steps, to check the results of the kernels and to report the MLUPS
+// (million lattice nodes updated per second) of the C version. 2dLB_C and
+// 2dLB_cuda report the frames per second of their display instead, their
+// MLUPS on a machine can be given with --c-mlups and --cuda-mlups to be
+// compared with.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <hc.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#define TILE_I 16
+#define TILE_J 8
+#define I2D(ni,i,j) (((ni)*(j)) + i)
+
+// steps of the check against the C version
+#define CHECK_STEPS 100
+
+////////////////////////////////////////////////////////////////////////////////
+
+// the parameters of the flow, as hard coded in 2dLB_C.c
+struct lattice {
+    int ni, nj;
+    float vxin, roout, tau;
+    float faceq1, faceq2, faceq3;
+};
+
+// clamps i to the nodes 0 to n - 1
+inline int clamp_index(int i, int n) [[hc, cpu]] {
+    return i < 0 ? 0 : (i >= n ? n - 1 : i);
+}
+
+// the directions of the distributions
+inline int dir_x(int k) [[hc, cpu]] {
+    return (k == 1 || k == 5 || k == 8) - (k == 3 || k == 6 || k == 7);
+}
+
+inline int dir_y(int k) [[hc, cpu]] {
+    return (k == 2 || k == 5 || k == 6) - (k == 4 || k == 7 || k == 8);
+}
+
+// the direction opposite to k, bounced back to by solid nodes
+inline int opposite(int k) [[hc, cpu]] {
+    return k == 0 ? 0 : (k <= 4 ? (k + 1) % 4 + 1 : (k - 3) % 4 + 5);
+}
+
+// reads the distributions of the last step from global memory
+struct global_source {
+    hc::array_view<const float, 1> f;
+    int ni, n;
+
+    float operator()(int k, int i, int j) const [[hc]] {
+        return f[k * n + I2D(ni, i, j)];
+    }
+};
+
+// reads the distributions of the last step from the halo loaded by a tile,
+// only for the nodes of the tile and the ones next to them
+struct tile_source {
+    float (*halo)[TILE_J + 2][TILE_I + 2];
+    global_source global;
+    int oi, oj;
+
+    float operator()(int k, int i, int j) const [[hc]] {
+        return k == 0 ? global(0, i, j) : halo[k - 1][j - oj][i - oi];
+    }
+};
+
+// The value of the distribution k at the node (i, j) after it's been
+// streamed, as stream() of 2dLB_C.c does: the distributions of the first
+// column aren't streamed and the rows at the top and bottom of the domain
+// stream from themselves
+template <typename Source>
+inline float streamed(const Source& src, const lattice& lb, int k, int i, int j) [[hc]] {
+    if (k == 0 || i == 0)
+        return src(k, i, j);
+    return src(k, clamp_index(i - dir_x(k), lb.ni), clamp_index(j - dir_y(k), lb.nj));
+}
+
+// after per_BC(): the distributions leaving the bottom of the domain enter
+// at the top, and vice-versa
+template <typename Source>
+inline float periodic(const Source& src, const lattice& lb, int k, int i, int j) [[hc]] {
+    if (j == 0 && (k == 2 || k == 5 || k == 6))
+        return streamed(src, lb, k, i, lb.nj - 1);
+    if (j == lb.nj - 1 && (k == 4 || k == 7 || k == 8))
+        return streamed(src, lb, k, i, 0);
+    return streamed(src, lb, k, i, j);
+}
+
+// after solid_BC(): the distributions of solid nodes are bounced back
+template <typename Source>
+inline float bounced(const Source& src, const lattice& lb, hc::array_view<const int, 1> solid,
+                     int k, int i, int j) [[hc]] {
+    if (solid[I2D(lb.ni, i, j)] == 0)
+        return periodic(src, lb, opposite(k), i, j);
+    return periodic(src, lb, k, i, j);
+}
+
+// after in_BC() and ex_BC_crude(): the distributions entering at the inlet
+// are at equilibrium, the ones entering at the exit are those of the nodes
+// next to it
+template <typename Source>
+inline float boundary(const Source& src, const lattice& lb, hc::array_view<const int, 1> solid,
+                      int k, int i, int j) [[hc]] {
+    if (i == 0 && (k == 1 || k == 5 || k == 8)) {
+        float vx_term = 1.f + 3.f*lb.vxin + 3.f*lb.vxin*lb.vxin;
+        return lb.roout * (k == 1 ? lb.faceq2 : lb.faceq3) * vx_term;
+    }
+    if (i == lb.ni - 1 && (k == 3 || k == 6 || k == 7))
+        return bounced(src, lb, solid, k, i - 1, j);
+    return bounced(src, lb, solid, k, i, j);
+}
+
+// collide() of 2dLB_C.c for one node, returns the velocity magnitude
+inline float collide_node(float* f, const lattice& lb) [[hc, cpu]] {
+    float rtau = 1.f/lb.tau;
+    float rtau1 = 1.f - rtau;
+
+    float ro = f[0] + f[1] + f[2] + f[3] + f[4] + f[5] + f[6] + f[7] + f[8];
+    float rovx = f[1] - f[3] + f[5] - f[6] - f[7] + f[8];
+    float rovy = f[2] - f[4] + f[5] + f[6] - f[7] - f[8];
+    float vx = rovx/ro;
+    float vy = rovy/ro;
+    float v_sq_term = 1.5f*(vx*vx + vy*vy);
+
+    float feq[9];
+    feq[0] = ro * lb.faceq1 * (1.f - v_sq_term);
+    feq[1] = ro * lb.faceq2 * (1.f + 3.f*vx + 4.5f*vx*vx - v_sq_term);
+    feq[2] = ro * lb.faceq2 * (1.f + 3.f*vy + 4.5f*vy*vy - v_sq_term);
+    feq[3] = ro * lb.faceq2 * (1.f - 3.f*vx + 4.5f*vx*vx - v_sq_term);
+    feq[4] = ro * lb.faceq2 * (1.f - 3.f*vy + 4.5f*vy*vy - v_sq_term);
+    feq[5] = ro * lb.faceq3 * (1.f + 3.f*(vx + vy) + 4.5f*(vx + vy)*(vx + vy) - v_sq_term);
+    feq[6] = ro * lb.faceq3 * (1.f + 3.f*(-vx + vy) + 4.5f*(-vx + vy)*(-vx + vy) - v_sq_term);
+    feq[7] = ro * lb.faceq3 * (1.f + 3.f*(-vx - vy) + 4.5f*(-vx - vy)*(-vx - vy) - v_sq_term);
+    feq[8] = ro * lb.faceq3 * (1.f + 3.f*(vx - vy) + 4.5f*(vx - vy)*(vx - vy) - v_sq_term);
+
+    for (int k = 0; k < 9; k++)
+        f[k] = rtau1 * f[k] + rtau * feq[k];
+    return hc::precise_math::sqrtf(vx*vx + vy*vy);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// enqueues one step reading fin and writing fout and the velocity magnitude
+// to plot, without waiting for it
+void step(hc::accelerator_view& av, const lattice& lb,
+          hc::array_view<const float, 1> fin, hc::array_view<float, 1> fout,
+          hc::array_view<const int, 1> solid, hc::array_view<float, 1> plot)
+{
+    int ni = lb.ni, nj = lb.nj, n = ni * nj;
+    // the tiles cover the domain, the work-items beyond it only load halos
+    int ti = (ni + TILE_I - 1) / TILE_I * TILE_I;
+    int tj = (nj + TILE_J - 1) / TILE_J * TILE_J;
+
+    hc::parallel_for_each(av, hc::extent<2>(tj, ti).tile(TILE_J, TILE_I), [=](hc::tiled_index<2> tidx) [[hc]] {
+        tile_static float halo[8][TILE_J + 2][TILE_I + 2];
+        int oj = tidx.tile_origin[0] - 1;
+        int oi = tidx.tile_origin[1] - 1;
+        global_source global = { fin, ni, n };
+
+        // the distributions of the tile and of the nodes around it
+        for (int c = tidx.local[0] * TILE_I + tidx.local[1];
+             c < (TILE_J + 2) * (TILE_I + 2); c += TILE_I * TILE_J) {
+            int hj = c / (TILE_I + 2);
+            int hi = c % (TILE_I + 2);
+            for (int k = 1; k < 9; k++)
+                halo[k - 1][hj][hi] = global(k, clamp_index(oi + hi, ni), clamp_index(oj + hj, nj));
+        }
+        tidx.barrier.wait();
+
+        int j = tidx.global[0];
+        int i = tidx.global[1];
+        if (i >= ni || j >= nj)
+            return;
+
+        float f[9];
+        if (i > 0 && i < ni - 2 && j > 0 && j < nj - 1) {
+            tile_source src = { halo, global, oi, oj };
+            for (int k = 0; k < 9; k++)
+                f[k] = boundary(src, lb, solid, k, i, j);
+        } else {
+            // the boundary conditions read beyond the halo
+            for (int k = 0; k < 9; k++)
+                f[k] = boundary(global, lb, solid, k, i, j);
+        }
+
+        int i0 = I2D(ni, i, j);
+        plot[i0] = collide_node(f, lb);
+        for (int k = 0; k < 9; k++)
+            fout[k * n + i0] = f[k];
+    });
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+// one step of 2dLB_C.c on the host: stream, BC, collide
+void step_host(const lattice& lb, std::vector<float>& f, std::vector<float>& tmp,
+               const std::vector<int>& solid, std::vector<float>& plot)
+{
+    int ni = lb.ni, nj = lb.nj, n = ni * nj;
+    int i, j, k, i0;
+
+    // stream
+    tmp = f;
+    for (j=0; j<nj; j++) {
+        for (i=1; i<ni; i++) {
+            i0 = I2D(ni,i,j);
+            for (k=1; k<9; k++) {
+                int si = clamp_index(i - dir_x(k), ni);
+                int sj = clamp_index(j - dir_y(k), nj);
+                tmp[k*n + i0] = f[k*n + I2D(ni,si,sj)];
+            }
+        }
+    }
+    f.swap(tmp);
+
+    // per_BC
+    for (i=0; i<ni; i++) {
+        int b = I2D(ni,i,0);
+        int t = I2D(ni,i,nj-1);
+        f[2*n + b] = f[2*n + t];
+        f[5*n + b] = f[5*n + t];
+        f[6*n + b] = f[6*n + t];
+        f[4*n + t] = f[4*n + b];
+        f[7*n + t] = f[7*n + b];
+        f[8*n + t] = f[8*n + b];
+    }
+
+    // solid_BC
+    for (i0=0; i0<n; i0++) {
+        if (solid[i0] == 0) {
+            float old[9];
+            for (k=1; k<9; k++)
+                old[k] = f[k*n + i0];
+            for (k=1; k<9; k++)
+                f[k*n + i0] = old[opposite(k)];
+        }
+    }
+
+    // in_BC
+    float vx_term = 1.f + 3.f*lb.vxin + 3.f*lb.vxin*lb.vxin;
+    for (j=0; j<nj; j++) {
+        i0 = I2D(ni,0,j);
+        f[1*n + i0] = lb.roout * lb.faceq2 * vx_term;
+        f[5*n + i0] = lb.roout * lb.faceq3 * vx_term;
+        f[8*n + i0] = lb.roout * lb.faceq3 * vx_term;
+    }
+
+    // ex_BC_crude
+    for (j=0; j<nj; j++) {
+        i0 = I2D(ni,ni-1,j);
+        f[3*n + i0] = f[3*n + i0 - 1];
+        f[6*n + i0] = f[6*n + i0 - 1];
+        f[7*n + i0] = f[7*n + i0 - 1];
+    }
+
+    // collide
+    for (i0=0; i0<n; i0++) {
+        float node[9];
+        for (k=0; k<9; k++)
+            node[k] = f[k*n + i0];
+        plot[i0] = collide_node(node, lb);
+        for (k=0; k<9; k++)
+            f[k*n + i0] = node[k];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+double seconds_since(std::chrono::high_resolution_clock::time_point start)
+{
+    return std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+}
+
+int main(int argc, char **argv)
+{
+    lattice lb;
+    int nsteps = 1000;
+    bool use_cpu = false;
+    double c_mlups = 0.0, cuda_mlups = 0.0;
+
+    // the flow of 2dLB_C.c, on a larger domain
+    lb.ni = 1024;
+    lb.nj = 512;
+    lb.vxin = 0.04f;
+    lb.roout = 1.0f;
+    lb.tau = 0.51f;
+    lb.faceq1 = 4.f/9.f;
+    lb.faceq2 = 1.f/9.f;
+    lb.faceq3 = 1.f/36.f;
+
+    int positional = 0;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--cpu") == 0) {
+            use_cpu = true;
+        } else if (strcmp(argv[a], "--c-mlups") == 0 && a + 1 < argc) {
+            c_mlups = atof(argv[++a]);
+        } else if (strcmp(argv[a], "--cuda-mlups") == 0 && a + 1 < argc) {
+            cuda_mlups = atof(argv[++a]);
+        } else if (positional == 0) {
+            lb.ni = atoi(argv[a]); positional++;
+        } else if (positional == 1) {
+            lb.nj = atoi(argv[a]); positional++;
+        } else {
+            nsteps = atoi(argv[a]);
+        }
+    }
+    if (lb.ni < 4 || lb.nj < 2 || nsteps < 1) {
+        printf("Usage: %s [ni nj [nsteps]] [--cpu] [--c-mlups X] [--cuda-mlups X]\n", argv[0]);
+        return 1;
+    }
+
+    int ni = lb.ni, nj = lb.nj, n = ni * nj;
+    printf ("ni = %d\n", ni);
+    printf ("nj = %d\n", nj);
+    printf ("nsteps = %d\n", nsteps);
+
+    //
+    // Initialise f's by setting them to the f_equilibirum values assuming
+    // that the whole domain is at velocity vx=vxin vy=0 and density ro=roout,
+    // with a solid cylinder in the flow
+    //
+    float vxin = lb.vxin, roout = lb.roout;
+    std::vector<float> f(9 * n);
+    std::vector<int> solid(n);
+    float feq[9] = {
+        lb.faceq1 * roout * (1.f                             - 1.5f*vxin*vxin),
+        lb.faceq2 * roout * (1.f + 3.f*vxin + 4.5f*vxin*vxin - 1.5f*vxin*vxin),
+        lb.faceq2 * roout * (1.f                             - 1.5f*vxin*vxin),
+        lb.faceq2 * roout * (1.f - 3.f*vxin + 4.5f*vxin*vxin - 1.5f*vxin*vxin),
+        lb.faceq2 * roout * (1.f                             - 1.5f*vxin*vxin),
+        lb.faceq3 * roout * (1.f + 3.f*vxin + 4.5f*vxin*vxin - 1.5f*vxin*vxin),
+        lb.faceq3 * roout * (1.f - 3.f*vxin + 4.5f*vxin*vxin - 1.5f*vxin*vxin),
+        lb.faceq3 * roout * (1.f - 3.f*vxin + 4.5f*vxin*vxin - 1.5f*vxin*vxin),
+        lb.faceq3 * roout * (1.f + 3.f*vxin + 4.5f*vxin*vxin - 1.5f*vxin*vxin)
+    };
+    int radius = std::max(nj / 10, 1);
+    for (int j = 0; j < nj; j++) {
+        for (int i = 0; i < ni; i++) {
+            int i0 = I2D(ni,i,j);
+            for (int k = 0; k < 9; k++)
+                f[k*n + i0] = feq[k];
+            int di = i - ni / 4, dj = j - nj / 2;
+            solid[i0] = (di*di + dj*dj <= radius*radius) ? 0 : 1;
+        }
+    }
+
+    hc::accelerator acc = use_cpu ? hc::accelerator(L"cpu") : hc::accelerator();
+    hc::accelerator_view av = acc.get_default_view();
+    printf("accelerator = %ls\n", acc.get_description().c_str());
+
+    // ping-pong distributions, kept on the accelerator between the steps
+    hc::array<float, 1> fa(9 * n, f.begin(), f.end(), av);
+    hc::array<float, 1> fb(9 * n, av);
+    hc::array<int, 1> solid_data(n, solid.begin(), solid.end(), av);
+    hc::array<float, 1> plot_data(n, av);
+    hc::array_view<float, 1> fviews[2] = { fa, fb };
+    hc::array_view<const int, 1> solid_view(solid_data);
+    hc::array_view<float, 1> plot_view(plot_data);
+
+    //
+    // Check a few steps against the C version, which are also the warm up
+    //
+    int check_steps = std::min(nsteps, CHECK_STEPS);
+    std::vector<float> tmp(9 * n), plot(n);
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < check_steps; s++)
+        step_host(lb, f, tmp, solid, plot);
+    double host_time = seconds_since(start);
+    double host_mlups = double(n) * check_steps / host_time / 1e6;
+
+    for (int s = 0; s < check_steps; s++)
+        step(av, lb, fviews[s % 2], fviews[(s + 1) % 2], solid_view, plot_view);
+    std::vector<float> result(9 * n);
+    hc::copy(fviews[check_steps % 2], result.begin());
+    float max_error = 0.f;
+    for (int i0 = 0; i0 < 9 * n; i0++)
+        max_error = std::max(max_error, std::fabs(result[i0] - f[i0]));
+    printf("max error after %d steps = %g\n", check_steps, max_error);
+
+    //
+    // Time the steps, the host only waits for the last one
+    //
+    start = std::chrono::high_resolution_clock::now();
+    for (int s = 0; s < nsteps; s++)
+        step(av, lb, fviews[s % 2], fviews[(s + 1) % 2], solid_view, plot_view);
+    av.wait();
+    double time = seconds_since(start);
+    double mlups = double(n) * nsteps / time / 1e6;
+
+    printf("C version (host port): %.2f MLUPS\n", host_mlups);
+    printf("HC version: %.2f MLUPS, %.3f s for %d steps, %.2fx the C version\n",
+           mlups, time, nsteps, mlups / host_mlups);
+    if (c_mlups > 0.0)
+        printf("2dLB_C: %.2f MLUPS, HC version is %.2fx\n", c_mlups, mlups / c_mlups);
+    if (cuda_mlups > 0.0)
+        printf("2dLB_cuda: %.2f MLUPS, HC version is %.2fx\n", cuda_mlups, mlups / cuda_mlups);
+
+    // the kernels are expected to match the C version to rounding
+    return max_error < 1e-4f ? 0 : 1;
+}
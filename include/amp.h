@@ -150,6 +150,19 @@ public:
      */
     void wait() { pQueue->wait(); }
 
+    /**
+     * Sets the wait mode used by the commands submitted to this accelerator
+     * view afterwards, such as the waits of parallel_for_each and copy. By
+     * default it would be hcWaitModeBlocked. This is an HCC extension.
+     */
+    void set_wait_mode(hcWaitMode waitMode) { pQueue->set_wait_mode(waitMode); }
+
+    /**
+     * Returns the wait mode of this accelerator view. This is an HCC
+     * extension.
+     */
+    hcWaitMode get_wait_mode() const { return pQueue->get_wait_mode(); }
+
     /**
      * Sends the queued up commands in the accelerator_view to the device for
      * execution.
@@ -1426,7 +1439,7 @@ private:
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
     template<typename K, int D1_, int D2_, int D3_> friend
-        void partitioned_task_tile(K const&, tiled_extent<D1_, D2_, D3_> const&, int);
+        void partitioned_task_tile(K const&, tiled_extent<D1_, D2_, D3_> const&, int, int);
 #endif
 };
 
@@ -1560,7 +1573,7 @@ private:
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
     template<typename K, int D> friend
-        void partitioned_task_tile(K const&, tiled_extent<D> const&, int);
+        void partitioned_task_tile(K const&, tiled_extent<D> const&, int, int);
 #endif
 };
 
@@ -1697,7 +1710,7 @@ private:
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
     template<typename K, int D1_, int D2_> friend
-        void partitioned_task_tile(K const&, tiled_extent<D1_, D2_> const&, int);
+        void partitioned_task_tile(K const&, tiled_extent<D1_, D2_> const&, int, int);
 #endif
 };
 
@@ -2055,20 +2068,36 @@ struct cpu_helper<K, Kernel, K>
 };
 
 template <typename Kernel, int N>
-void partitioned_task(const Kernel& ker, const extent<N>& ext, int part) {
+void partitioned_task(const Kernel& ker, const extent<N>& ext, int start, int end) {
+    // tasks are the indices of ext in row-major order, so that a range of
+    // tasks walks along the innermost dimension. Each run along it is a loop
+    // whose iterations don't depend on each other, which the host compiler
+    // may vectorize across work-items
     index<N> idx;
-    int start = ext[0] * part / Kalmar::NTHREAD;
-    int end = ext[0] * (part + 1) / Kalmar::NTHREAD;
-    for (int i = start; i < end; i++) {
-        idx[0] = i;
-        cpu_helper<1, Kernel, N>::call(ker, idx, ext);
+    int rest = start;
+    for (int d = N - 1; d >= 0; --d) {
+        idx[d] = rest % ext[d];
+        rest /= ext[d];
+    }
+    for (int i = start; i < end; ) {
+        int first = idx[N - 1];
+        int last = std::min(first + (end - i), ext[N - 1]);
+#pragma clang loop vectorize(enable) interleave(enable)
+        for (int x = first; x < last; x++) {
+            index<N> item(idx);
+            item[N - 1] = x;
+            cpu_helper<N, Kernel, N>::call(ker, item, ext);
+        }
+        i += last - first;
+        idx[N - 1] = 0;
+        for (int d = N - 2; d >= 0 && ++idx[d] == ext[d]; --d) {
+            idx[d] = 0;
+        }
     }
 }
 
 template <typename Kernel, int D0>
-void partitioned_task_tile(Kernel const& f, tiled_extent<D0> const& ext, int part) {
-    int start = (ext[0] / D0) * part / Kalmar::NTHREAD;
-    int end = (ext[0] / D0) * (part + 1) / Kalmar::NTHREAD;
+void partitioned_task_tile(Kernel const& f, tiled_extent<D0> const& ext, int start, int end) {
     int stride = end - start;
     if (stride == 0)
         return;
@@ -2096,9 +2125,7 @@ void partitioned_task_tile(Kernel const& f, tiled_extent<D0> const& ext, int par
     delete [] tidx;
 }
 template <typename Kernel, int D0, int D1>
-void partitioned_task_tile(Kernel const& f, tiled_extent<D0, D1> const& ext, int part) {
-    int start = (ext[0] / D0) * part / Kalmar::NTHREAD;
-    int end = (ext[0] / D0) * (part + 1) / Kalmar::NTHREAD;
+void partitioned_task_tile(Kernel const& f, tiled_extent<D0, D1> const& ext, int start, int end) {
     int stride = end - start;
     if (stride == 0)
         return;
@@ -2107,32 +2134,33 @@ void partitioned_task_tile(Kernel const& f, tiled_extent<D0, D1> const& ext, int
     tile_barrier::pb_t amp_bar = std::make_shared<barrier_t>(D0 * D1);
     tile_barrier tbar(amp_bar);
 
-    for (int tx = 0; tx < ext[1] / D1; tx++)
-        for (int ty = start; ty < end; ty++) {
-            int id = 0;
-            char *sp = stk;
-            tiled_index<D0, D1> *tip = tidx;
-            for (int x = 0; x < D1; x++)
-                for (int y = 0; y < D0; y++) {
-                    new (tip) tiled_index<D0, D1>(D1 * tx + x, D0 * ty + y, x, y, tx, ty, tbar);
-                    amp_bar->setctx(++id, sp, f, tip, SSIZE);
-                    ++tip;
-                    sp += SSIZE;
-                }
-            amp_bar->idx = 0;
-            while (amp_bar->idx == 0) {
-                amp_bar->idx = id;
-                amp_bar->swap(0, id);
+    // tasks are the tiles in row-major order
+    int tiles1 = ext[1] / D1;
+    for (int t = start; t < end; t++) {
+        int ty = t / tiles1;
+        int tx = t % tiles1;
+        int id = 0;
+        char *sp = stk;
+        tiled_index<D0, D1> *tip = tidx;
+        for (int x = 0; x < D1; x++)
+            for (int y = 0; y < D0; y++) {
+                new (tip) tiled_index<D0, D1>(D1 * tx + x, D0 * ty + y, x, y, tx, ty, tbar);
+                amp_bar->setctx(++id, sp, f, tip, SSIZE);
+                ++tip;
+                sp += SSIZE;
             }
+        amp_bar->idx = 0;
+        while (amp_bar->idx == 0) {
+            amp_bar->idx = id;
+            amp_bar->swap(0, id);
         }
+    }
     delete [] stk;
     delete [] tidx;
 }
 
 template <typename Kernel, int D0, int D1, int D2>
-void partitioned_task_tile(Kernel const& f, tiled_extent<D0, D1, D2> const& ext, int part) {
-    int start = (ext[0] / D0) * part / Kalmar::NTHREAD;
-    int end = (ext[0] / D0) * (part + 1) / Kalmar::NTHREAD;
+void partitioned_task_tile(Kernel const& f, tiled_extent<D0, D1, D2> const& ext, int start, int end) {
     int stride = end - start;
     if (stride == 0)
         return;
@@ -2141,29 +2169,33 @@ void partitioned_task_tile(Kernel const& f, tiled_extent<D0, D1, D2> const& ext,
     tile_barrier::pb_t amp_bar = std::make_shared<barrier_t>(D0 * D1 * D2);
     tile_barrier tbar(amp_bar);
 
-    for (int i = 0; i < ext[2] / D2; i++)
-        for (int j = 0; j < ext[1] / D1; j++)
-            for(int k = start; k < end; k++) {
-                int id = 0;
-                char *sp = stk;
-                tiled_index<D0, D1, D2> *tip = tidx;
-                for (int x = 0; x < D2; x++)
-                    for (int y = 0; y < D1; y++)
-                        for (int z = 0; z < D0; z++) {
-                            new (tip) tiled_index<D0, D1, D2>(D2 * i + x,
-                                                              D1 * j + y,
-                                                              D0 * k + z,
-                                                              x, y, z, i, j, k, tbar);
-                            amp_bar->setctx(++id, sp, f, tip, SSIZE);
-                            ++tip;
-                            sp += SSIZE;
-                        }
-                amp_bar->idx = 0;
-                while (amp_bar->idx == 0) {
-                    amp_bar->idx = id;
-                    amp_bar->swap(0, id);
+    // tasks are the tiles in row-major order
+    int tiles1 = ext[1] / D1;
+    int tiles2 = ext[2] / D2;
+    for (int t = start; t < end; t++) {
+        int k = t / (tiles1 * tiles2);
+        int j = (t / tiles2) % tiles1;
+        int i = t % tiles2;
+        int id = 0;
+        char *sp = stk;
+        tiled_index<D0, D1, D2> *tip = tidx;
+        for (int x = 0; x < D2; x++)
+            for (int y = 0; y < D1; y++)
+                for (int z = 0; z < D0; z++) {
+                    new (tip) tiled_index<D0, D1, D2>(D2 * i + x,
+                                                      D1 * j + y,
+                                                      D0 * k + z,
+                                                      x, y, z, i, j, k, tbar);
+                    amp_bar->setctx(++id, sp, f, tip, SSIZE);
+                    ++tip;
+                    sp += SSIZE;
                 }
-            }
+        amp_bar->idx = 0;
+        while (amp_bar->idx == 0) {
+            amp_bar->idx = id;
+            amp_bar->swap(0, id);
+        }
+    }
     delete [] stk;
     delete [] tidx;
 }
@@ -2172,39 +2204,46 @@ template <typename Kernel, int N>
 void launch_cpu_task(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      extent<N> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task<Kernel, N>, std::cref(f), std::cref(compute_domain), i);
+    Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain](const Kernel& k) {
+        Kalmar::run_cpu_tasks(compute_domain.size(), [&](size_t start, size_t end) {
+            partitioned_task<Kernel, N>(k, compute_domain, start, end);
+        });
+    })->blockingWait();
 }
 
 template <typename Kernel, int D0>
 void launch_cpu_task(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      tiled_extent<D0> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task_tile<Kernel, D0>,
-                             std::cref(f), std::cref(compute_domain), i);
+    Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain](const Kernel& k) {
+        Kalmar::run_cpu_tasks(compute_domain[0] / D0, [&](size_t start, size_t end) {
+            partitioned_task_tile<Kernel, D0>(k, compute_domain, start, end);
+        });
+    })->blockingWait();
 }
 
 template <typename Kernel, int D0, int D1>
 void launch_cpu_task(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      tiled_extent<D0, D1> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task_tile<Kernel, D0, D1>,
-                             std::cref(f), std::cref(compute_domain), i);
+    int tiles = (compute_domain[0] / D0) * (compute_domain[1] / D1);
+    Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain, tiles](const Kernel& k) {
+        Kalmar::run_cpu_tasks(tiles, [&](size_t start, size_t end) {
+            partitioned_task_tile<Kernel, D0, D1>(k, compute_domain, start, end);
+        });
+    })->blockingWait();
 }
 
 template <typename Kernel, int D0, int D1, int D2>
 void launch_cpu_task(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      tiled_extent<D0, D1, D2> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task_tile<Kernel, D0, D1, D2>,
-                             std::cref(f), std::cref(compute_domain), i);
+    int tiles = (compute_domain[0] / D0) * (compute_domain[1] / D1) * (compute_domain[2] / D2);
+    Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain, tiles](const Kernel& k) {
+        Kalmar::run_cpu_tasks(tiles, [&](size_t start, size_t end) {
+            partitioned_task_tile<Kernel, D0, D1, D2>(k, compute_domain, start, end);
+        });
+    })->blockingWait();
 }
 
 #endif
@@ -5856,7 +5895,7 @@ void parallel_for_each(const accelerator_view& av, extent<N> compute_domain,
         return;
     }
 #endif
-    if (av.get_accelerator().get_device_path() == L"cpu") {
+    if (av.pQueue->getDev()->is_cpu()) {
       throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
     }
     const pfe_wrapper<N, Kernel> _pf(compute_domain, f);
@@ -5891,7 +5930,7 @@ __attribute__((noinline,used)) void parallel_for_each(const accelerator_view& av
   }
 #endif
   size_t ext = compute_domain[0];
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   Kalmar::mcw_cxxamp_launch_kernel<Kernel, 1>(av.pQueue, &ext, NULL, f);
@@ -5924,7 +5963,7 @@ __attribute__((noinline,used)) void parallel_for_each(const accelerator_view& av
 #endif
   size_t ext[2] = {static_cast<size_t>(compute_domain[1]),
       static_cast<size_t>(compute_domain[0])};
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   Kalmar::mcw_cxxamp_launch_kernel<Kernel, 2>(av.pQueue, ext, NULL, f);
@@ -5964,7 +6003,7 @@ __attribute__((noinline,used)) void parallel_for_each(const accelerator_view& av
   size_t ext[3] = {static_cast<size_t>(compute_domain[2]),
       static_cast<size_t>(compute_domain[1]),
       static_cast<size_t>(compute_domain[0])};
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   Kalmar::mcw_cxxamp_launch_kernel<Kernel, 3>(av.pQueue, ext, NULL, f);
@@ -6000,7 +6039,7 @@ __attribute__((noinline,used)) void parallel_for_each(const accelerator_view& av
       launch_cpu_task(av.pQueue, f, compute_domain);
   } else
 #endif
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   Kalmar::mcw_cxxamp_launch_kernel<Kernel, 1>(av.pQueue, &ext, &tile, f);
@@ -6039,7 +6078,7 @@ __attribute__((noinline,used)) void parallel_for_each(const accelerator_view& av
       launch_cpu_task(av.pQueue, f, compute_domain);
   } else
 #endif
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   Kalmar::mcw_cxxamp_launch_kernel<Kernel, 2>(av.pQueue, ext, tile, f);
@@ -6086,7 +6125,7 @@ __attribute__((noinline,used)) void parallel_for_each(const accelerator_view& av
       launch_cpu_task(av.pQueue, f, compute_domain);
   } else
 #endif
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   Kalmar::mcw_cxxamp_launch_kernel<Kernel, 3>(av.pQueue, ext, tile, f);
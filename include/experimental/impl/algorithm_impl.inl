@@ -9,6 +9,17 @@
 
 #include <algorithm>
 #include <numeric>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <tuple>
+#include <typeinfo>
+
+#include <sys/stat.h>
 
 namespace std {
 namespace experimental {
@@ -16,12 +27,21 @@ namespace parallel {
 inline namespace v1 {
 
 #include "type_utils.inl"
+#include "device_iterator.inl"
+#include "fancy_iterator.inl"
 #include "kernel_launch.inl"
+#include "scratch.inl"
+#include "threshold.inl"
 #include "reduce.inl"
+#include "scan.inl"
 #include "transform.inl"
 #include "transform_reduce.inl"
+#include "radix_sort.inl"
 #include "sort.inl"
+#include "merge.inl"
 #include "stablesort.inl"
+#include "compact.inl"
+#include "find.inl"
 
 namespace details {
 
@@ -40,7 +60,8 @@ void generate_impl(ForwardIterator first, ForwardIterator last,
                    Generator g,
                    std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("generate", typeid(typename std::iterator_traits<ForwardIterator>::value_type), N);
+  if (backend.host()) {
     generate_impl(first, last, g, std::input_iterator_tag{});
     return;
   }
@@ -71,7 +92,8 @@ void for_each_impl(InputIterator first, InputIterator last,
                    Function f,
                    std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("for_each", typeid(typename std::iterator_traits<InputIterator>::value_type), N);
+  if (backend.host()) {
     for_each_impl(first, last, f, std::input_iterator_tag{});
     return;
   }
@@ -99,7 +121,8 @@ void replace_if_impl(ForwardIterator first, ForwardIterator last,
                      Function f, const T& new_value,
                      std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("replace_if", typeid(typename std::iterator_traits<ForwardIterator>::value_type), N);
+  if (backend.host()) {
     replace_if_impl(first, last, f, new_value, std::input_iterator_tag{});
     return;
   }
@@ -132,7 +155,8 @@ OutputIterator replace_copy_if_impl(InputIterator first, InputIterator last,
                                     Function f, const T& new_value,
                                     std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("replace_copy_if", typeid(typename std::iterator_traits<InputIterator>::value_type), N);
+  if (backend.host()) {
     return replace_copy_if_impl(first, last, d_first, f, new_value,
              std::input_iterator_tag{});
   }
@@ -170,7 +194,8 @@ OutputIterator adjacent_difference_impl(InputIterator first, InputIterator last,
                                         Function f,
                                         std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("adjacent_difference", typeid(typename std::iterator_traits<InputIterator>::value_type), N);
+  if (backend.host()) {
     return adjacent_difference_impl(first, last, d_first, f,
              std::input_iterator_tag{});
   }
@@ -205,7 +230,8 @@ OutputIterator swap_ranges_impl(InputIterator first, InputIterator last,
                                 OutputIterator d_first,
                                 std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("swap_ranges", typeid(typename std::iterator_traits<InputIterator>::value_type), N);
+  if (backend.host()) {
     return swap_ranges_impl(first, last, d_first, std::input_iterator_tag{});
   }
 
@@ -270,7 +296,8 @@ bool lexicographical_compare_impl(InputIt1 first1, InputIt1 last1,
   }
 
   // call to std::lexicographical_compare when small data size
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("lexicographical_compare", typeid(typename std::iterator_traits<InputIt1>::value_type), N);
+  if (backend.host()) {
     return lexicographical_compare_impl(first1, last1, first2, last2, comp,
              std::input_iterator_tag{});
   }
@@ -305,7 +332,8 @@ bool equal_impl(InputIt1 first1, InputIt1 last1,
                 BinaryPredicate p,
                 std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first1, last1));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("equal", typeid(typename std::iterator_traits<InputIt1>::value_type), N);
+  if (backend.host()) {
     return equal_impl(first1, last1, first2, p, std::input_iterator_tag{});
   }
 
@@ -46,48 +46,6 @@ mismatch(ExecutionPolicy&& exec,
 /**@}*/
 
 
-/**
- * Parallel version of std::find in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename T>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, InputIt>::type
-find(ExecutionPolicy&& exec,
-     InputIt first, InputIt last,
-     const T& value) {
-    return std::find(first, last, value);
-}
-
-
-/**
- * Parallel version of std::find_if in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, InputIt>::type
-find_if(ExecutionPolicy&& exec,
-        InputIt first, InputIt last,
-        UnaryPredicate p) {
-    return std::find_if(first, last, p);
-}
-
-
-/**
- * Parallel version of std::find_if_not in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, InputIt>::type
-find_if_not(ExecutionPolicy&& exec,
-            InputIt first, InputIt last,
-            UnaryPredicate p) {
-    return std::find_if_not(first, last, p);
-}
-
-
 /**
  * Parallel version of std::find_end in <algorithm>
  *
@@ -210,21 +168,6 @@ search_n(ExecutionPolicy&& exec,
 /**@}*/
 
 
-/**
- * Parallel version of std::copy_if in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename OutputIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-copy_if(ExecutionPolicy&& exec,
-        InputIt first, InputIt last,
-        OutputIt d_first,
-        UnaryPredicate pred) {
-    return std::copy_if(first, last, d_first, pred);
-}
-
-
 /**
  * Parallel version of std::move in <algorithm>
  *
@@ -239,64 +182,6 @@ move(ExecutionPolicy&& exec,
 }
 
 
-/**
- * Parallel version of std::remove in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename ForwardIt, typename T>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, ForwardIt>::type
-remove(ExecutionPolicy&& exec,
-       ForwardIt first, ForwardIt last,
-       const T& value) {
-    return std::remove(first, last, value);
-}
-
-
-/**
- * Parallel version of std::remove_if in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, ForwardIt>::type
-remove_if(ExecutionPolicy&& exec,
-          ForwardIt first, ForwardIt last,
-          UnaryPredicate p) {
-    return std::remove_if(first, last, p);
-}
-
-
-/**
- * Parallel version of std::remove_copy in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename OutputIt, typename T>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-remove_copy(ExecutionPolicy&& exec,
-            InputIt first, InputIt last,
-            OutputIt d_first,
-            const T& value) {
-    return std::remove_copy(first, last, d_first, value);
-}
-
-
-/**
- * Parallel version of std::remove_copy_if in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename OutputIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-remove_copy_if(ExecutionPolicy&& exec,
-               InputIt first, InputIt last,
-               OutputIt d_first,
-               UnaryPredicate p) {
-    return std::remove_copy_if(first, last, d_first, p);
-}
-
-
 /**
  * Parallel version of std::reverse in <algorithm>
  *
@@ -351,54 +236,6 @@ rotate_copy(ExecutionPolicy&& exec,
 }
 
 
-/**
- * Parallel version of std::unique in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- * @{
- */
-template <typename ExecutionPolicy, typename ForwardIt>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, ForwardIt>::type
-unique(ExecutionPolicy&& exec,
-       ForwardIt first, ForwardIt last) {
-    return std::unique(first, last);
-}
-
-template <typename ExecutionPolicy, typename ForwardIt, typename BinaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, ForwardIt>::type
-unique(ExecutionPolicy&& exec,
-       ForwardIt first, ForwardIt last,
-       BinaryPredicate p) {
-    return std::unique(first, last, p);
-}
-/**@}*/
-
-
-/**
- * Parallel version of std::unique_copy in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- * @{
- */
-template <typename ExecutionPolicy, typename InputIt, typename OutputIt>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-unique_copy(ExecutionPolicy&&,
-            InputIt first, InputIt last,
-            OutputIt d_first) {
-    return std::unique_copy(first, last, d_first);
-}
-
-template <typename ExecutionPolicy, typename InputIt, typename OutputIt, typename BinaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-unique_copy(ExecutionPolicy&& exec,
-            InputIt first, InputIt last,
-            OutputIt d_first,
-            BinaryPredicate p) {
-    return std::unique_copy(first, last, d_first, p);
-}
-/**@}*/
-
-
 /**
  * Parallel version of std::unique_copy in <algorithm>
  *
@@ -413,51 +250,6 @@ is_partitioned(ExecutionPolicy&& exec,
 }
 
 
-/**
- * Parallel version of std::partition in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename ForwardIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, ForwardIt>::type
-partition(ExecutionPolicy&& exec,
-          ForwardIt first, ForwardIt last,
-          UnaryPredicate p) {
-    return std::partition(first, last, p);
-}
-
-
-/**
- * Parallel version of std::partition_copy in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename InputIt, typename OutputIt1, typename OutputIt2, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, std::pair<OutputIt1, OutputIt2>>::type
-partition_copy(ExecutionPolicy&& exec,
-               InputIt first, InputIt last,
-               OutputIt1 d_first_true,
-               OutputIt2 d_first_false,
-               UnaryPredicate p) {
-    return std::partition_copy(first, last, d_first_true, d_first_false, p);
-}
-
-
-/**
- * Parallel version of std::stable_partition in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- */
-template <typename ExecutionPolicy, typename BidirIt, typename UnaryPredicate>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, BidirIt>::type
-stable_partition(ExecutionPolicy&& exec,
-                 BidirIt first, BidirIt last,
-                 UnaryPredicate p) {
-    return std::stable_partition(first, last, p);
-}
-
-
-
 /**
  * Parallel version of std::is_sorted in <algorithm>
  *
@@ -576,33 +368,6 @@ nth_element(ExecutionPolicy&& exec,
 /**@}*/
 
 
-/**
- * Parallel version of std::merge in <algorithm>
- *
- * FIXME: this algorithm is implemented sequentially currently
- * @{
- */
-template <typename ExecutionPolicy, typename InputIt1, typename InputIt2, typename OutputIt>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-merge(ExecutionPolicy&& exec,
-      InputIt1 first1, InputIt1 last1,
-      InputIt2 first2, InputIt2 last2,
-      OutputIt d_first) {
-    return std::merge(first1, last1, first2, last2, d_first);
-}
-
-template <typename ExecutionPolicy, typename InputIt1, typename InputIt2, typename OutputIt, typename Compare>
-typename std::enable_if<is_execution_policy<typename std::decay<ExecutionPolicy>::type>::value, OutputIt>::type
-merge(ExecutionPolicy&& exec,
-      InputIt1 first1, InputIt1 last1,
-      InputIt2 first2, InputIt2 last2,
-      OutputIt d_first, Compare comp) {
-    return std::merge(first1, last1, first2, last2, d_first, comp);
-}
-/**@}*/
-
-
-
 /**
  * Parallel version of std::inplace_merge in <algorithm>
  *
@@ -0,0 +1,345 @@
+#pragma once
+
+namespace details {
+
+/**
+ * Stream compaction: the elements of an input an algorithm keeps are marked
+ * by flags of 1, whose inclusive scan, in a single pass, gives each kept
+ * element its position in the output, plus 1, and the number of them in its
+ * last element. A scatter kernel then writes each kept element to its
+ * position, so the elements kept stay in order.
+ *
+ * Flags are views computing them from the input as they are read, and are
+ * read twice, by the scan and by the scatter.
+ */
+
+// flags of the elements for which pred is keep
+template<typename View, typename UnaryPredicate>
+struct predicate_flags {
+    typedef int value_type;
+    View first_;
+    UnaryPredicate pred;
+    bool keep;
+    int operator[](int i) const __CPU__ __HC__ {
+        return (static_cast<bool>(pred(first_[i])) == keep) ? 1 : 0;
+    }
+};
+
+// flags of the first elements of the groups of consecutive equivalent ones
+template<typename View, typename BinaryPredicate>
+struct unique_flags {
+    typedef int value_type;
+    View first_;
+    BinaryPredicate p;
+    int operator[](int i) const __CPU__ __HC__ {
+        return (i == 0 || !p(first_[i - 1], first_[i])) ? 1 : 0;
+    }
+};
+
+template<typename View, typename UnaryPredicate>
+inline predicate_flags<View, UnaryPredicate>
+make_predicate_flags(const View& first_, const UnaryPredicate& pred, bool keep) {
+    return predicate_flags<View, UnaryPredicate>{ first_, pred, keep };
+}
+
+template<typename View, typename BinaryPredicate>
+inline unique_flags<View, BinaryPredicate>
+make_unique_flags(const View& first_, const BinaryPredicate& p) {
+    return unique_flags<View, BinaryPredicate>{ first_, p };
+}
+
+// scan of the N flags to pos, returns the number of flags set
+template<typename FlagView>
+int compact_scan(const FlagView& flags, int N, const hc::array_view<int>& pos) {
+    chained_scan_impl(flags, pos, N, identity_load<int>(), 0, std::plus<int>(),
+                      true, std::true_type());
+    // only the count goes back to the host
+    hc::array_view<int> count((hc::extent<1>(1)));
+    kernel_launch(1, [ pos, count, N ](hc::index<1>) [[hc]] {
+        count[0] = pos[N - 1];
+    });
+    return count[0];
+}
+
+// write the elements of first_ whose flags are set to out, in order
+template<typename InView, typename FlagView, typename OutView>
+void compact_scatter(const InView& first_, const FlagView& flags,
+                     const hc::array_view<int>& pos, int N, const OutView& out) {
+    kernel_launch(N, [ first_, flags, pos, out ](hc::index<1> idx) [[hc]] {
+        int i = idx[0];
+        if (flags[i])
+            out[pos[i] - 1] = first_[i];
+    });
+}
+
+// write the elements of first_ whose flags are set to outTrue, and the
+// others to outFalse, both in order
+template<typename InView, typename FlagView, typename OutView1, typename OutView2>
+void partition_scatter(const InView& first_, const FlagView& flags,
+                       const hc::array_view<int>& pos, int N,
+                       const OutView1& outTrue, const OutView2& outFalse) {
+    kernel_launch(N, [ first_, flags, pos, outTrue, outFalse ](hc::index<1> idx) [[hc]] {
+        int i = idx[0];
+        if (flags[i])
+            outTrue[pos[i] - 1] = first_[i];
+        else
+            outFalse[i - pos[i]] = first_[i];
+    });
+}
+
+// copy the elements of first_ whose flags are set to d_first
+template<typename InView, typename FlagView, typename OutputIt>
+OutputIt compact_copy(const InView& first_, const FlagView& flags, int N,
+                      OutputIt d_first) {
+    typedef typename std::iterator_traits<OutputIt>::value_type _To;
+    scratch_buffer<int> posBuffer(N);
+    hc::array_view<int> pos = posBuffer.view();
+    int count = compact_scan(flags, N, pos);
+    if (count == 0)
+        return d_first;
+
+    // the output spans the elements kept, and nothing after them
+    hc::array_view<_To> d_first_ = utils::make_view<_To>(d_first, count);
+    if (!utils::isDeviceIt<OutputIt>::value)
+        d_first_.discard_data();
+    compact_scatter(first_, flags, pos, N, d_first_);
+    return d_first + count;
+}
+
+// move the elements of the view first_ of an input whose flags are set to
+// its front, returns how many they are
+template<typename T, typename FlagView>
+int compact_in_place(const hc::array_view<T>& first_, const FlagView& flags, int N) {
+    scratch_buffer<int> posBuffer(N);
+    hc::array_view<int> pos = posBuffer.view();
+    int count = compact_scan(flags, N, pos);
+    if (count == 0 || count == N)
+        return count;
+
+    // elements are scattered to a temporary, as they'd overwrite others
+    // before they're read
+    scratch_buffer<T> tmpBuffer(count);
+    hc::array_view<T> tmp = tmpBuffer.view();
+    compact_scatter(first_, flags, pos, N, tmp);
+    kernel_launch(count, [ first_, tmp ](hc::index<1> idx) [[hc]] {
+        first_[idx] = tmp[idx];
+    });
+    return count;
+}
+
+// iterator category of the copies of an input to OutputIts, that of the
+// input if the outputs are random access, or else the one of the forwarders
+template<typename InputIt, typename OutputIt1, typename OutputIt2 = OutputIt1>
+using compact_category =
+    typename std::conditional<utils::isRandomAccessIt<OutputIt1>::value &&
+                              utils::isRandomAccessIt<OutputIt2>::value,
+                              typename std::iterator_traits<InputIt>::iterator_category,
+                              std::input_iterator_tag>::type;
+
+// copy_if forwarder
+template<class InputIt, class OutputIt, class UnaryPredicate>
+OutputIt copy_if_impl(InputIt first, InputIt last,
+                      OutputIt d_first, UnaryPredicate pred, bool keep,
+                      std::input_iterator_tag) {
+    for (; first != last; ++first) {
+        if (static_cast<bool>(pred(*first)) == keep) {
+            *d_first = *first;
+            ++d_first;
+        }
+    }
+    return d_first;
+}
+
+// parallel::copy_if, and remove_copy_if with keep false
+template<class InputIt, class OutputIt, class UnaryPredicate>
+OutputIt copy_if_impl(InputIt first, InputIt last,
+                      OutputIt d_first, UnaryPredicate pred, bool keep,
+                      std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<InputIt>::value_type _Ti;
+    details::backend_choice backend("copy_if", typeid(_Ti), N);
+    if (backend.host()) {
+        return copy_if_impl(first, last, d_first, pred, keep,
+                            std::input_iterator_tag{});
+    }
+
+    auto first_ = utils::make_view<const _Ti>(first, N);
+    return compact_copy(first_, make_predicate_flags(first_, pred, keep), N, d_first);
+}
+
+// remove_if forwarder
+template<class ForwardIt, class UnaryPredicate>
+ForwardIt remove_if_impl(ForwardIt first, ForwardIt last,
+                         UnaryPredicate p,
+                         std::input_iterator_tag) {
+    return std::remove_if(first, last, p);
+}
+
+// parallel::remove_if
+template<class ForwardIt, class UnaryPredicate>
+ForwardIt remove_if_impl(ForwardIt first, ForwardIt last,
+                         UnaryPredicate p,
+                         std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<ForwardIt>::value_type _Ty;
+    details::backend_choice backend("remove_if", typeid(_Ty), N);
+    if (backend.host()) {
+        return remove_if_impl(first, last, p, std::input_iterator_tag{});
+    }
+
+    hc::array_view<_Ty> first_ = utils::make_view<_Ty>(first, N);
+    return first + compact_in_place(first_, make_predicate_flags(first_, p, false), N);
+}
+
+// unique forwarder
+template<class ForwardIt, class BinaryPredicate>
+ForwardIt unique_impl(ForwardIt first, ForwardIt last,
+                      BinaryPredicate p,
+                      std::input_iterator_tag) {
+    return std::unique(first, last, p);
+}
+
+// parallel::unique
+template<class ForwardIt, class BinaryPredicate>
+ForwardIt unique_impl(ForwardIt first, ForwardIt last,
+                      BinaryPredicate p,
+                      std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<ForwardIt>::value_type _Ty;
+    details::backend_choice backend("unique", typeid(_Ty), N);
+    if (backend.host()) {
+        return unique_impl(first, last, p, std::input_iterator_tag{});
+    }
+
+    hc::array_view<_Ty> first_ = utils::make_view<_Ty>(first, N);
+    return first + compact_in_place(first_, make_unique_flags(first_, p), N);
+}
+
+// unique_copy forwarder
+template<class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt unique_copy_impl(InputIt first, InputIt last,
+                          OutputIt d_first, BinaryPredicate p,
+                          std::input_iterator_tag) {
+    return std::unique_copy(first, last, d_first, p);
+}
+
+// parallel::unique_copy
+template<class InputIt, class OutputIt, class BinaryPredicate>
+OutputIt unique_copy_impl(InputIt first, InputIt last,
+                          OutputIt d_first, BinaryPredicate p,
+                          std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<InputIt>::value_type _Ti;
+    details::backend_choice backend("unique_copy", typeid(_Ti), N);
+    if (backend.host()) {
+        return unique_copy_impl(first, last, d_first, p, std::input_iterator_tag{});
+    }
+
+    auto first_ = utils::make_view<const _Ti>(first, N);
+    return compact_copy(first_, make_unique_flags(first_, p), N, d_first);
+}
+
+// partition_copy forwarder
+template<class InputIt, class OutputIt1, class OutputIt2, class UnaryPredicate>
+std::pair<OutputIt1, OutputIt2>
+partition_copy_impl(InputIt first, InputIt last,
+                    OutputIt1 d_first_true, OutputIt2 d_first_false,
+                    UnaryPredicate p,
+                    std::input_iterator_tag) {
+    return std::partition_copy(first, last, d_first_true, d_first_false, p);
+}
+
+// parallel::partition_copy
+template<class InputIt, class OutputIt1, class OutputIt2, class UnaryPredicate>
+std::pair<OutputIt1, OutputIt2>
+partition_copy_impl(InputIt first, InputIt last,
+                    OutputIt1 d_first_true, OutputIt2 d_first_false,
+                    UnaryPredicate p,
+                    std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<InputIt>::value_type _Ti;
+    details::backend_choice backend("partition_copy", typeid(_Ti), N);
+    if (backend.host()) {
+        return partition_copy_impl(first, last, d_first_true, d_first_false, p,
+                                   std::input_iterator_tag{});
+    }
+
+    auto first_ = utils::make_view<const _Ti>(first, N);
+    auto flags = make_predicate_flags(first_, p, true);
+    scratch_buffer<int> posBuffer(N);
+    hc::array_view<int> pos = posBuffer.view();
+    int count = compact_scan(flags, N, pos);
+    if (count == 0)
+        return { d_first_true, copy_if_impl(first, last, d_first_false, p, false,
+                                            std::random_access_iterator_tag{}) };
+    if (count == N)
+        return { copy_if_impl(first, last, d_first_true, p, true,
+                              std::random_access_iterator_tag{}), d_first_false };
+
+    typedef typename std::iterator_traits<OutputIt1>::value_type _To1;
+    typedef typename std::iterator_traits<OutputIt2>::value_type _To2;
+    hc::array_view<_To1> true_ = utils::make_view<_To1>(d_first_true, count);
+    hc::array_view<_To2> false_ = utils::make_view<_To2>(d_first_false, N - count);
+    if (!utils::isDeviceIt<OutputIt1>::value)
+        true_.discard_data();
+    if (!utils::isDeviceIt<OutputIt2>::value)
+        false_.discard_data();
+    partition_scatter(first_, flags, pos, N, true_, false_);
+    return { d_first_true + count, d_first_false + (N - count) };
+}
+
+// stable_partition forwarder
+template<class BidirIt, class UnaryPredicate>
+BidirIt stable_partition_impl(BidirIt first, BidirIt last,
+                              UnaryPredicate p,
+                              std::input_iterator_tag) {
+    return std::stable_partition(first, last, p);
+}
+
+// parallel::stable_partition
+template<class BidirIt, class UnaryPredicate>
+BidirIt stable_partition_impl(BidirIt first, BidirIt last,
+                              UnaryPredicate p,
+                              std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<BidirIt>::value_type _Ty;
+    details::backend_choice backend("stable_partition", typeid(_Ty), N);
+    if (backend.host()) {
+        return stable_partition_impl(first, last, p, std::input_iterator_tag{});
+    }
+
+    hc::array_view<_Ty> first_ = utils::make_view<_Ty>(first, N);
+    auto flags = make_predicate_flags(first_, p, true);
+    scratch_buffer<int> posBuffer(N);
+    hc::array_view<int> pos = posBuffer.view();
+    int count = compact_scan(flags, N, pos);
+    if (count == 0 || count == N)
+        return first + count;
+
+    scratch_buffer<_Ty> tmpBuffer(N);
+    hc::array_view<_Ty> tmp = tmpBuffer.view();
+    partition_scatter(first_, flags, pos, N,
+                      tmp.section(0, count), tmp.section(count, N - count));
+    kernel_launch(N, [ first_, tmp ](hc::index<1> idx) [[hc]] {
+        first_[idx] = tmp[idx];
+    });
+    return first + count;
+}
+
+// partition forwarder
+template<class ForwardIt, class UnaryPredicate>
+ForwardIt partition_impl(ForwardIt first, ForwardIt last,
+                         UnaryPredicate p,
+                         std::input_iterator_tag) {
+    return std::partition(first, last, p);
+}
+
+// parallel::partition, which the stable partition is as fast as
+template<class ForwardIt, class UnaryPredicate>
+ForwardIt partition_impl(ForwardIt first, ForwardIt last,
+                         UnaryPredicate p,
+                         std::random_access_iterator_tag) {
+    return stable_partition_impl(first, last, p, std::random_access_iterator_tag{});
+}
+
+} // namespace details
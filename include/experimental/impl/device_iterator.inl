@@ -0,0 +1,103 @@
+#pragma once
+
+/**
+ * A random access iterator over the elements of an hc::array_view<T, 1>.
+ *
+ * Algorithms given device_iterators run on the array_view itself instead of
+ * wrapping host memory, so the data of a chain of algorithms stays on the
+ * accelerator between them, and is only copied back when dereferenced on the
+ * host or synchronized. When the input and output of transform are both
+ * device_iterators, it doesn't wait for its kernel either.
+ */
+template<typename T>
+class device_iterator {
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename std::remove_const<T>::type value_type;
+  typedef ptrdiff_t difference_type;
+  typedef T* pointer;
+  typedef T& reference;
+
+  device_iterator(const hc::array_view<T, 1>& av, difference_type pos = 0)
+    : view_(av), pos_(pos) {}
+
+  // elements are accessed on the host, which synchronizes the array_view
+  reference operator*() const { return view_[static_cast<int>(pos_)]; }
+  pointer operator->() const { return &(**this); }
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  device_iterator& operator++() { ++pos_; return *this; }
+  device_iterator& operator--() { --pos_; return *this; }
+  device_iterator operator++(int) { device_iterator it(*this); ++pos_; return it; }
+  device_iterator operator--(int) { device_iterator it(*this); --pos_; return it; }
+  device_iterator& operator+=(difference_type n) { pos_ += n; return *this; }
+  device_iterator& operator-=(difference_type n) { pos_ -= n; return *this; }
+  device_iterator operator+(difference_type n) const { return device_iterator(view_, pos_ + n); }
+  device_iterator operator-(difference_type n) const { return device_iterator(view_, pos_ - n); }
+  friend device_iterator operator+(difference_type n, const device_iterator& it) { return it + n; }
+  difference_type operator-(const device_iterator& other) const { return pos_ - other.pos_; }
+
+  bool operator==(const device_iterator& other) const { return pos_ == other.pos_; }
+  bool operator!=(const device_iterator& other) const { return pos_ != other.pos_; }
+  bool operator<(const device_iterator& other) const { return pos_ < other.pos_; }
+  bool operator>(const device_iterator& other) const { return pos_ > other.pos_; }
+  bool operator<=(const device_iterator& other) const { return pos_ <= other.pos_; }
+  bool operator>=(const device_iterator& other) const { return pos_ >= other.pos_; }
+
+  /// the array_view of the n elements from the iterator, which kernels use
+  hc::array_view<T, 1> view(size_t n) const {
+    return view_.section(static_cast<int>(pos_), static_cast<int>(n));
+  }
+
+private:
+  hc::array_view<T, 1> view_;
+  difference_type pos_;
+};
+
+/**
+ * Iterators over the whole of an array_view or array, to be passed to the
+ * parallel algorithms.
+ * @{
+ */
+template<typename T>
+inline device_iterator<T> device_begin(const hc::array_view<T, 1>& av) {
+  return device_iterator<T>(av);
+}
+
+template<typename T>
+inline device_iterator<T> device_end(const hc::array_view<T, 1>& av) {
+  return device_iterator<T>(av, av.get_extent()[0]);
+}
+
+template<typename T>
+inline device_iterator<T> device_begin(hc::array<T, 1>& a) {
+  return device_begin(hc::array_view<T, 1>(a));
+}
+
+template<typename T>
+inline device_iterator<T> device_end(hc::array<T, 1>& a) {
+  return device_end(hc::array_view<T, 1>(a));
+}
+/**@}*/
+
+namespace utils {
+
+template<class It>
+struct isDeviceIt : std::false_type {};
+
+template<typename T>
+struct isDeviceIt<device_iterator<T>> : std::true_type {};
+
+// array_view of the N elements from an iterator, the host memory they are in
+// is wrapped, or the array_view of a device_iterator is used as is
+template<typename T, typename It>
+inline hc::array_view<T> make_view(It it, size_t N) {
+  return hc::array_view<T>(hc::extent<1>(N), get_pointer(it));
+}
+
+template<typename T, typename U>
+inline hc::array_view<T> make_view(device_iterator<U> it, size_t N) {
+  return hc::array_view<T>(it.view(N));
+}
+
+} // namespace utils
@@ -27,7 +27,8 @@ exclusive_scan_impl(RandomAccessIterator first, RandomAccessIterator last,
                std::random_access_iterator_tag) {
   // call to std::partial_sum when small data size
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("exclusive_scan", typeid(typename std::iterator_traits<RandomAccessIterator>::value_type), N);
+  if (backend.host()) {
     return exclusive_scan_impl(first, last, result, init, binary_op,
              std::input_iterator_tag{});
   }
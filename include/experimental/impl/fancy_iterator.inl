@@ -0,0 +1,297 @@
+#pragma once
+
+/**
+ * Iterators whose elements are computed as they are read:
+ *
+ * - counting_iterator, over consecutive values,
+ * - transform_iterator, over a function applied to the elements of an
+ *   iterator,
+ * - zip_iterator, over std::tuples of the elements of iterators.
+ *
+ * They nest, and are read-only inputs of the algorithms. The kernels of
+ * algorithms given them read them through views which compute each element
+ * where it's used, so a transform feeding a reduce or a scan is fused into
+ * its kernel, with no kernel or temporary buffer of its own.
+ */
+template<typename T>
+class counting_iterator {
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef T value_type;
+  typedef ptrdiff_t difference_type;
+  typedef const T* pointer;
+  typedef T reference;
+
+  counting_iterator() : value_() {}
+  explicit counting_iterator(T value) : value_(value) {}
+
+  reference operator*() const { return value_; }
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  counting_iterator& operator++() { ++value_; return *this; }
+  counting_iterator& operator--() { --value_; return *this; }
+  counting_iterator operator++(int) { counting_iterator it(*this); ++value_; return it; }
+  counting_iterator operator--(int) { counting_iterator it(*this); --value_; return it; }
+  counting_iterator& operator+=(difference_type n) { value_ += static_cast<T>(n); return *this; }
+  counting_iterator& operator-=(difference_type n) { value_ -= static_cast<T>(n); return *this; }
+  counting_iterator operator+(difference_type n) const { return counting_iterator(value_ + static_cast<T>(n)); }
+  counting_iterator operator-(difference_type n) const { return counting_iterator(value_ - static_cast<T>(n)); }
+  friend counting_iterator operator+(difference_type n, const counting_iterator& it) { return it + n; }
+  difference_type operator-(const counting_iterator& other) const {
+    return static_cast<difference_type>(value_ - other.value_);
+  }
+
+  bool operator==(const counting_iterator& other) const { return value_ == other.value_; }
+  bool operator!=(const counting_iterator& other) const { return value_ != other.value_; }
+  bool operator<(const counting_iterator& other) const { return value_ < other.value_; }
+  bool operator>(const counting_iterator& other) const { return value_ > other.value_; }
+  bool operator<=(const counting_iterator& other) const { return value_ <= other.value_; }
+  bool operator>=(const counting_iterator& other) const { return value_ >= other.value_; }
+
+private:
+  T value_;
+};
+
+template<typename It, typename F>
+class transform_iterator {
+public:
+  typedef typename std::iterator_traits<It>::iterator_category iterator_category;
+  typedef typename std::decay<
+            typename std::result_of<const F&(typename std::iterator_traits<It>::reference)>::type
+          >::type value_type;
+  typedef typename std::iterator_traits<It>::difference_type difference_type;
+  typedef const value_type* pointer;
+  typedef value_type reference;
+
+  transform_iterator(It it, F f) : it_(it), f_(f) {}
+
+  reference operator*() const { return f_(*it_); }
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  transform_iterator& operator++() { ++it_; return *this; }
+  transform_iterator& operator--() { --it_; return *this; }
+  transform_iterator operator++(int) { transform_iterator it(*this); ++it_; return it; }
+  transform_iterator operator--(int) { transform_iterator it(*this); --it_; return it; }
+  transform_iterator& operator+=(difference_type n) { it_ += n; return *this; }
+  transform_iterator& operator-=(difference_type n) { it_ -= n; return *this; }
+  transform_iterator operator+(difference_type n) const { return transform_iterator(it_ + n, f_); }
+  transform_iterator operator-(difference_type n) const { return transform_iterator(it_ - n, f_); }
+  friend transform_iterator operator+(difference_type n, const transform_iterator& it) { return it + n; }
+  difference_type operator-(const transform_iterator& other) const { return it_ - other.it_; }
+
+  bool operator==(const transform_iterator& other) const { return it_ == other.it_; }
+  bool operator!=(const transform_iterator& other) const { return it_ != other.it_; }
+  bool operator<(const transform_iterator& other) const { return it_ < other.it_; }
+  bool operator>(const transform_iterator& other) const { return it_ > other.it_; }
+  bool operator<=(const transform_iterator& other) const { return it_ <= other.it_; }
+  bool operator>=(const transform_iterator& other) const { return it_ >= other.it_; }
+
+  /// the iterator the elements are computed from, and the function applied
+  It base() const { return it_; }
+  const F& functor() const { return f_; }
+
+private:
+  It it_;
+  F f_;
+};
+
+namespace details {
+
+// the iterators of a zip_iterator
+template<typename... Its>
+struct zip_tuple;
+
+template<>
+struct zip_tuple<> {
+  typedef std::tuple<> value_type;
+  value_type get() const { return value_type(); }
+  void advance(ptrdiff_t) {}
+};
+
+template<typename It, typename... Its>
+struct zip_tuple<It, Its...> {
+  typedef std::tuple<typename std::iterator_traits<It>::value_type,
+                     typename std::iterator_traits<Its>::value_type...> value_type;
+
+  It first;
+  zip_tuple<Its...> rest;
+
+  zip_tuple(It it, Its... its) : first(it), rest(its...) {}
+
+  value_type get() const { return std::tuple_cat(std::make_tuple(*first), rest.get()); }
+  void advance(ptrdiff_t n) { first += n; rest.advance(n); }
+};
+
+} // namespace details
+
+template<typename It, typename... Its>
+class zip_iterator {
+public:
+  typedef std::random_access_iterator_tag iterator_category;
+  typedef typename details::zip_tuple<It, Its...>::value_type value_type;
+  typedef ptrdiff_t difference_type;
+  typedef const value_type* pointer;
+  typedef value_type reference;
+
+  explicit zip_iterator(It it, Its... its) : its_(it, its...) {}
+
+  reference operator*() const { return its_.get(); }
+  reference operator[](difference_type n) const { return *(*this + n); }
+
+  zip_iterator& operator++() { its_.advance(1); return *this; }
+  zip_iterator& operator--() { its_.advance(-1); return *this; }
+  zip_iterator operator++(int) { zip_iterator it(*this); its_.advance(1); return it; }
+  zip_iterator operator--(int) { zip_iterator it(*this); its_.advance(-1); return it; }
+  zip_iterator& operator+=(difference_type n) { its_.advance(n); return *this; }
+  zip_iterator& operator-=(difference_type n) { its_.advance(-n); return *this; }
+  zip_iterator operator+(difference_type n) const { zip_iterator it(*this); return it += n; }
+  zip_iterator operator-(difference_type n) const { zip_iterator it(*this); return it -= n; }
+  friend zip_iterator operator+(difference_type n, const zip_iterator& it) { return it + n; }
+
+  // the first iterators tell where zip_iterators are
+  difference_type operator-(const zip_iterator& other) const { return its_.first - other.its_.first; }
+  bool operator==(const zip_iterator& other) const { return its_.first == other.its_.first; }
+  bool operator!=(const zip_iterator& other) const { return its_.first != other.its_.first; }
+  bool operator<(const zip_iterator& other) const { return its_.first < other.its_.first; }
+  bool operator>(const zip_iterator& other) const { return its_.first > other.its_.first; }
+  bool operator<=(const zip_iterator& other) const { return its_.first <= other.its_.first; }
+  bool operator>=(const zip_iterator& other) const { return its_.first >= other.its_.first; }
+
+  /// the iterators zipped
+  const details::zip_tuple<It, Its...>& bases() const { return its_; }
+
+private:
+  details::zip_tuple<It, Its...> its_;
+};
+
+/**
+ * Fancy iterators of values, functions and iterators.
+ * @{
+ */
+template<typename T>
+inline counting_iterator<T> make_counting_iterator(T value) {
+  return counting_iterator<T>(value);
+}
+
+template<typename It, typename F>
+inline transform_iterator<It, F> make_transform_iterator(It it, F f) {
+  return transform_iterator<It, F>(it, f);
+}
+
+template<typename It, typename... Its>
+inline zip_iterator<It, Its...> make_zip_iterator(It it, Its... its) {
+  return zip_iterator<It, Its...>(it, its...);
+}
+/**@}*/
+
+namespace details {
+
+// views kernels read the elements of fancy iterators from
+template<typename T>
+struct counting_view {
+  typedef T value_type;
+  T first;
+  T operator[](int i) const __CPU__ __HC__ { return first + static_cast<T>(i); }
+};
+
+template<typename View, typename F, typename R>
+struct transform_view {
+  typedef R value_type;
+  View base;
+  F f;
+  R operator[](int i) const __CPU__ __HC__ { return f(base[i]); }
+};
+
+template<typename... Views>
+struct zip_view;
+
+template<>
+struct zip_view<> {
+  typedef std::tuple<> value_type;
+  value_type operator[](int) const __CPU__ __HC__ { return value_type(); }
+};
+
+template<typename View, typename... Views>
+struct zip_view<View, Views...> {
+  typedef std::tuple<typename std::remove_const<typename View::value_type>::type,
+                     typename std::remove_const<typename Views::value_type>::type...> value_type;
+  View first;
+  zip_view<Views...> rest;
+  value_type operator[](int i) const __CPU__ __HC__ {
+    return std::tuple_cat(std::make_tuple(first[i]), rest[i]);
+  }
+};
+
+} // namespace details
+
+namespace utils {
+
+// the view of the N elements from an iterator, which kernels read
+template<typename It, typename Enable = void>
+struct view_traits {
+  typedef typename std::iterator_traits<It>::value_type value_type;
+  typedef hc::array_view<value_type> type;
+  static type make(It it, size_t N) { return make_view<value_type>(it, N); }
+};
+
+template<typename T>
+struct view_traits<counting_iterator<T>> {
+  typedef details::counting_view<T> type;
+  static type make(counting_iterator<T> it, size_t) { return type{ *it }; }
+};
+
+template<typename It, typename F>
+struct view_traits<transform_iterator<It, F>> {
+  typedef details::transform_view<typename view_traits<It>::type, F,
+                                  typename transform_iterator<It, F>::value_type> type;
+  static type make(const transform_iterator<It, F>& it, size_t N) {
+    return type{ view_traits<It>::make(it.base(), N), it.functor() };
+  }
+};
+
+template<typename... Its>
+struct zip_views;
+
+template<>
+struct zip_views<> {
+  typedef details::zip_view<> type;
+  static type make(const details::zip_tuple<>&, size_t) { return type(); }
+};
+
+template<typename It, typename... Its>
+struct zip_views<It, Its...> {
+  typedef details::zip_view<typename view_traits<It>::type,
+                            typename view_traits<Its>::type...> type;
+  static type make(const details::zip_tuple<It, Its...>& its, size_t N) {
+    return type{ view_traits<It>::make(its.first, N), zip_views<Its...>::make(its.rest, N) };
+  }
+};
+
+template<typename It, typename... Its>
+struct view_traits<zip_iterator<It, Its...>> {
+  typedef typename zip_views<It, Its...>::type type;
+  static type make(const zip_iterator<It, Its...>& it, size_t N) {
+    return zip_views<It, Its...>::make(it.bases(), N);
+  }
+};
+
+// the views of fancy iterators, whatever the element type asked for
+template<typename T, typename U>
+inline typename view_traits<counting_iterator<U>>::type
+make_view(counting_iterator<U> it, size_t N) {
+  return view_traits<counting_iterator<U>>::make(it, N);
+}
+
+template<typename T, typename It, typename F>
+inline typename view_traits<transform_iterator<It, F>>::type
+make_view(const transform_iterator<It, F>& it, size_t N) {
+  return view_traits<transform_iterator<It, F>>::make(it, N);
+}
+
+template<typename T, typename It, typename... Its>
+inline typename view_traits<zip_iterator<It, Its...>>::type
+make_view(const zip_iterator<It, Its...>& it, size_t N) {
+  return view_traits<zip_iterator<It, Its...>>::make(it, N);
+}
+
+} // namespace utils
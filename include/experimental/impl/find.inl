@@ -0,0 +1,193 @@
+#pragma once
+
+namespace details {
+
+// work-items of a tile of the search
+#define FIND_WGSIZE 256
+// tiles of the search launched on each compute unit
+#define FIND_TILES_PER_CU 8
+
+// find_if forwarder
+template<class InputIt, class UnaryPredicate>
+InputIt find_if_impl(InputIt first, InputIt last,
+                     UnaryPredicate p,
+                     std::input_iterator_tag) {
+    return std::find_if(first, last, p);
+}
+
+/**
+ * parallel::find_if
+ *
+ * A search with an early exit: tiles check chunks of FIND_WGSIZE elements
+ * in order, grid-strided, and lower the index of the first element found
+ * with an atomic. Before each chunk a tile reads it back, and stops once an
+ * element is found before the chunk, so the tiles stop soon after the first
+ * element, and the elements after it are mostly not read.
+ */
+template<class InputIt, class UnaryPredicate>
+InputIt find_if_impl(InputIt first, InputIt last,
+                     UnaryPredicate p,
+                     std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<InputIt>::value_type _Ty;
+    details::backend_choice backend("find_if", typeid(_Ty), N);
+    if (backend.host()) {
+        return find_if_impl(first, last, p, std::input_iterator_tag{});
+    }
+
+    auto first_ = utils::make_view<const _Ty>(first, N);
+    std::vector<int> r(1, N);
+    hc::array_view<int> found(hc::extent<1>(1), r);
+    int numTiles = (N + FIND_WGSIZE - 1) / FIND_WGSIZE;
+    numTiles = std::min(numTiles, compute_units() * FIND_TILES_PER_CU);
+    int length = numTiles * FIND_WGSIZE;
+    kernel_launch(length,
+                  [ first_, found, N, length, p ]
+                  ( hc::tiled_index<1> t_idx ) [[hc]]
+                  {
+                  tile_static int earliest;
+                  int locId = t_idx.local[0];
+                  for (int base = t_idx.tile[0] * FIND_WGSIZE; base < N; base += length) {
+                      if (locId == 0)
+                          earliest = hc::atomic_fetch_add(&found[0], 0);
+                      t_idx.barrier.wait();
+                      // the whole tile stops at once
+                      if (earliest < base)
+                          return;
+                      int i = base + locId;
+                      if (i < N && p(first_[i]))
+                          hc::atomic_fetch_min(&found[0], i);
+                      t_idx.barrier.wait();
+                  }
+                  }, FIND_WGSIZE);
+    found.synchronize();
+    return first + r[0];
+}
+
+// the index of the first smallest of two elements
+template<typename View, typename Compare>
+struct min_index {
+    View first_;
+    Compare comp;
+    int operator()(int i, int j) const __CPU__ __HC__ {
+        if (comp(first_[j], first_[i]))
+            return j;
+        if (comp(first_[i], first_[j]))
+            return i;
+        return i < j ? i : j;
+    }
+};
+
+// the index of the first largest of two elements
+template<typename View, typename Compare>
+struct max_index {
+    View first_;
+    Compare comp;
+    int operator()(int i, int j) const __CPU__ __HC__ {
+        if (comp(first_[i], first_[j]))
+            return j;
+        if (comp(first_[j], first_[i]))
+            return i;
+        return i < j ? i : j;
+    }
+};
+
+// the indices of the first smallest and the last largest of two pairs of
+// elements, packed as the index of the smallest in the lower half of a word
+// and the index of the largest in its upper half
+template<typename View, typename Compare>
+struct minmax_index {
+    View first_;
+    Compare comp;
+    uint64_t operator()(uint64_t a, uint64_t b) const __CPU__ __HC__ {
+        int i = static_cast<int>(a & 0xFFFFFFFFu), j = static_cast<int>(b & 0xFFFFFFFFu);
+        int m = comp(first_[j], first_[i]) ? j :
+                comp(first_[i], first_[j]) ? i : (i < j ? i : j);
+        i = static_cast<int>(a >> 32);
+        j = static_cast<int>(b >> 32);
+        int M = comp(first_[i], first_[j]) ? j :
+                comp(first_[j], first_[i]) ? i : (i > j ? i : j);
+        return (static_cast<uint64_t>(M) << 32) | static_cast<uint64_t>(m);
+    }
+};
+
+// an index as both the smallest and the largest of a pair of minmax_index
+struct minmax_load {
+    uint64_t operator()(int i) const __CPU__ __HC__ {
+        return (static_cast<uint64_t>(i) << 32) | static_cast<uint64_t>(i);
+    }
+};
+
+// reduce of the indices [0, N) with binary_op, with the wavefront reduce
+template<typename T, typename Load, typename BinaryOperation>
+T reduce_indices(int N, const Load& load, const BinaryOperation& binary_op) {
+    std::vector<uint64_t> p(reduce_wave_tiles(N) + 1, 0);
+    hc::array_view<uint64_t> partials(hc::extent<1>(p.size()), p);
+    hc::array_view<T> out((hc::extent<1>(1)));
+    // index 0 is an identity of binary_op, as it's one of the indices
+    reduce_wave_kernel(counting_view<int>{ 0 }, N, load, load(0), binary_op,
+                       partials, out, true, std::true_type());
+    partials.discard_data();
+    return out[0];
+}
+
+// min_element and max_element forwarder
+template<class ForwardIt, class Compare>
+ForwardIt min_element_impl(ForwardIt first, ForwardIt last,
+                           Compare comp, bool largest,
+                           std::input_iterator_tag) {
+    return largest ? std::max_element(first, last, comp) :
+                     std::min_element(first, last, comp);
+}
+
+// parallel::min_element, and max_element with largest, a reduce of indices
+// which compares the elements they are those of
+template<class ForwardIt, class Compare>
+ForwardIt min_element_impl(ForwardIt first, ForwardIt last,
+                           Compare comp, bool largest,
+                           std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<ForwardIt>::value_type _Ty;
+    details::backend_choice backend(largest ? "max_element" : "min_element", typeid(_Ty), N);
+    if (N == 0 || backend.host()) {
+        return min_element_impl(first, last, comp, largest, std::input_iterator_tag{});
+    }
+
+    typedef decltype(utils::make_view<const _Ty>(first, N)) View;
+    View first_ = utils::make_view<const _Ty>(first, N);
+    int i = largest ?
+        reduce_indices<int>(N, identity_load<int>(), max_index<View, Compare>{ first_, comp }) :
+        reduce_indices<int>(N, identity_load<int>(), min_index<View, Compare>{ first_, comp });
+    return first + i;
+}
+
+// minmax_element forwarder
+template<class ForwardIt, class Compare>
+std::pair<ForwardIt, ForwardIt>
+minmax_element_impl(ForwardIt first, ForwardIt last,
+                    Compare comp,
+                    std::input_iterator_tag) {
+    return std::minmax_element(first, last, comp);
+}
+
+// parallel::minmax_element, both in a single reduce
+template<class ForwardIt, class Compare>
+std::pair<ForwardIt, ForwardIt>
+minmax_element_impl(ForwardIt first, ForwardIt last,
+                    Compare comp,
+                    std::random_access_iterator_tag) {
+    const int N = static_cast<int>(std::distance(first, last));
+    typedef typename std::iterator_traits<ForwardIt>::value_type _Ty;
+    details::backend_choice backend("minmax_element", typeid(_Ty), N);
+    if (N == 0 || backend.host()) {
+        return minmax_element_impl(first, last, comp, std::input_iterator_tag{});
+    }
+
+    typedef decltype(utils::make_view<const _Ty>(first, N)) View;
+    View first_ = utils::make_view<const _Ty>(first, N);
+    uint64_t r = reduce_indices<uint64_t>(N, minmax_load(),
+                                          minmax_index<View, Compare>{ first_, comp });
+    return { first + static_cast<int>(r & 0xFFFFFFFFu), first + static_cast<int>(r >> 32) };
+}
+
+} // namespace details
@@ -23,7 +23,8 @@ inclusive_scan_impl(RandomAccessIterator first, RandomAccessIterator last,
 
   // call to std::partial_sum when small data size
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("inclusive_scan", typeid(typename std::iterator_traits<RandomAccessIterator>::value_type), N);
+  if (backend.host()) {
     return inclusive_scan_impl(first, last, result, binary_op, init,
              std::input_iterator_tag{});
   }
@@ -2,14 +2,73 @@
 
 namespace details {
 
+// compute units assumed when the accelerator doesn't report them
+#define DEFAULT_COMPUTE_UNITS 32
+
 // hc kernel invocation
+// kernels whose views all outlive them may be launched without waiting
 template<typename Kernel>
-inline void kernel_launch(int N, Kernel k, int tile = 0) {
+inline hc::completion_future kernel_launch(int N, Kernel k, int tile = 0, bool wait = true) {
+    hc::completion_future fut;
     if (tile != 0) {
-        hc::parallel_for_each(hc::extent<1>(N).tile(tile), k).wait();
+        fut = hc::parallel_for_each(hc::extent<1>(N).tile(tile), k);
     } else {
-        hc::parallel_for_each(hc::extent<1>(N), k).wait();
+        fut = hc::parallel_for_each(hc::extent<1>(N), k);
+    }
+    if (wait) {
+        fut.wait();
     }
+    return fut;
+}
+
+// compute units of the default accelerator, which kernels looping over
+// their input size their grid from
+inline int compute_units() {
+    static const int cu = [] {
+        int n = static_cast<int>(hc::accelerator().get_cu_count());
+        return n > 0 ? n : DEFAULT_COMPUTE_UNITS;
+    }();
+    return cu;
+}
+
+// element of an input as is, for the algorithms which don't transform it
+template<typename T>
+struct identity_load {
+    T operator()(const T& v) const __CPU__ __HC__ { return v; }
+};
+
+// state of an algorithm run with par_async: its kernel, and what has to
+// outlive the kernel, the views it uses and the work left on the host.
+// The kernel is waited for before they are released, even if the future of
+// the algorithm is never waited for.
+struct async_state {
+    hc::completion_future kernel;
+    std::function<void()> done;
+
+    async_state(const hc::completion_future& kernel, const std::function<void()>& done)
+        : kernel(kernel), done(done) {}
+    ~async_state() { kernel.wait(); }
+
+    void wait() {
+        kernel.wait();
+        done();
+    }
+};
+
+// completion_future of an algorithm run with par_async, done is called once
+// the kernel is done, and keeps the views it captures alive until then
+inline hc::completion_future
+async_result(const hc::completion_future& kernel, const std::function<void()>& done) {
+    auto state = std::make_shared<async_state>(kernel, done);
+    return hc::deferred_completion_future(
+             std::async(std::launch::deferred, [state] { state->wait(); }).share());
+}
+
+// completion_future of an algorithm run with par_async, which is done
+inline hc::completion_future async_ready() {
+    std::promise<void> p;
+    p.set_value();
+    return hc::deferred_completion_future(p.get_future().share());
 }
 
 } // namespace details
@@ -0,0 +1,137 @@
+#pragma once
+
+namespace details {
+
+// work-items of a tile of the merge kernel
+#define MERGE_WGSIZE 128
+// elements of the output each work-item of the merge kernel merges
+#define MERGE_ITEMS 4
+#define MERGE_TILE (MERGE_WGSIZE * MERGE_ITEMS)
+
+// Merge path: the number of elements of a[aOff, aOff + aLen) among the first
+// diag elements of the stable merge of it with b[bOff, bOff + bLen), where
+// elements of a go before the elements of b they are equivalent to.
+template<typename A, typename B, typename Compare>
+inline int merge_path(const A& a, int aOff, int aLen, const B& b, int bOff, int bLen,
+                      int diag, const Compare& comp) __CPU__ __HC__ {
+    int lo = diag > bLen ? diag - bLen : 0;
+    int hi = diag < aLen ? diag : aLen;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (comp(b[bOff + diag - 1 - mid], a[aOff + mid]))
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+    return lo;
+}
+
+/**
+ * Stable merges of sorted runs with merge path partitioning: each tile
+ * merges an equal share of MERGE_TILE elements of the output, whatever the
+ * data. The tile finds where its share starts and ends in the two runs
+ * with two merge path searches, loads them in tile_static memory, where
+ * each work-item finds its own share of MERGE_ITEMS elements the same way
+ * and merges them sequentially.
+ *
+ * With width 0 the output is the merge of a[0, aLen) and b[0, bLen).
+ * Otherwise a and b are the same N elements, in sorted runs of width ones,
+ * and each pair of runs is merged to the same place of the output.
+ */
+template<typename AView, typename BView, typename OutView, typename Compare>
+void merge_kernel(const AView& a, int aLen, const BView& b, int bLen,
+                  const OutView& out, int width, const Compare& comp) {
+    typedef typename std::remove_const<typename AView::value_type>::type T;
+    int N = (width == 0) ? aLen + bLen : aLen;
+    int numTiles = (N + MERGE_TILE - 1) / MERGE_TILE;
+    kernel_launch(numTiles * MERGE_WGSIZE,
+                  [ a, aLen, b, bLen, out, width, N, comp ]
+                  ( hc::tiled_index<1> t_idx ) [[hc]]
+                  {
+                  tile_static T ldsIn[MERGE_TILE];
+                  tile_static T ldsOut[MERGE_TILE];
+                  tile_static int ldsSplit[2];
+                  int locId = t_idx.local[0];
+                  int outStart = t_idx.tile[0] * MERGE_TILE;
+
+                  // the pair of runs the share of the tile is in
+                  int aOff = 0, bOff = 0, runA = aLen, runB = bLen, pairStart = 0;
+                  if (width != 0) {
+                      pairStart = outStart - outStart % (2 * width);
+                      aOff = pairStart;
+                      runA = (N - pairStart < width) ? N - pairStart : width;
+                      bOff = pairStart + width;
+                      runB = (N - bOff < width) ? N - bOff : width;
+                      runB = (runB < 0) ? 0 : runB;
+                  }
+                  int diag0 = outStart - pairStart;
+                  int diag1 = (diag0 + MERGE_TILE < runA + runB) ? diag0 + MERGE_TILE : runA + runB;
+
+                  if (locId < 2)
+                      ldsSplit[locId] = merge_path(a, aOff, runA, b, bOff, runB,
+                                                   locId ? diag1 : diag0, comp);
+                  t_idx.barrier.wait();
+                  int a0 = ldsSplit[0];
+                  int b0 = diag0 - a0;
+                  int na = ldsSplit[1] - a0;
+                  int count = diag1 - diag0;
+                  int nb = count - na;
+
+                  for (int i = locId; i < count; i += MERGE_WGSIZE)
+                      ldsIn[i] = (i < na) ? a[aOff + a0 + i] : b[bOff + b0 + i - na];
+                  t_idx.barrier.wait();
+
+                  int d = locId * MERGE_ITEMS;
+                  d = (d < count) ? d : count;
+                  int ai = merge_path(ldsIn, 0, na, ldsIn, na, nb, d, comp);
+                  int bi = d - ai;
+                  for (int k = 0; k < MERGE_ITEMS && d + k < count; ++k) {
+                      if (bi >= nb || (ai < na && !comp(ldsIn[na + bi], ldsIn[ai]))) {
+                          ldsOut[d + k] = ldsIn[ai++];
+                      } else {
+                          ldsOut[d + k] = ldsIn[na + bi++];
+                      }
+                  }
+                  t_idx.barrier.wait();
+
+                  for (int i = locId; i < count; i += MERGE_WGSIZE)
+                      out[outStart + i] = ldsOut[i];
+                  }, MERGE_WGSIZE);
+}
+
+// std::merge forwarder
+template<class InputIt1, class InputIt2, class OutputIt, class Compare>
+OutputIt merge_impl(InputIt1 first1, InputIt1 last1,
+                    InputIt2 first2, InputIt2 last2,
+                    OutputIt d_first, Compare comp,
+                    std::input_iterator_tag) {
+    return std::merge(first1, last1, first2, last2, d_first, comp);
+}
+
+// parallel::merge
+template<class InputIt1, class InputIt2, class OutputIt, class Compare>
+OutputIt merge_impl(InputIt1 first1, InputIt1 last1,
+                    InputIt2 first2, InputIt2 last2,
+                    OutputIt d_first, Compare comp,
+                    std::random_access_iterator_tag) {
+    const int N1 = static_cast<int>(std::distance(first1, last1));
+    const int N2 = static_cast<int>(std::distance(first2, last2));
+    typedef typename std::iterator_traits<InputIt1>::value_type _Ti;
+    details::backend_choice backend("merge", typeid(_Ti), N1 + N2);
+    if (!utils::isRandomAccessIt<InputIt2>::value ||
+        !utils::isRandomAccessIt<OutputIt>::value ||
+        backend.host()) {
+        return merge_impl(first1, last1, first2, last2, d_first, comp,
+                          std::input_iterator_tag{});
+    }
+
+    typedef typename std::iterator_traits<InputIt2>::value_type _Tj;
+    typedef typename std::iterator_traits<OutputIt>::value_type _To;
+    auto first1_ = utils::make_view<const _Ti>(first1, N1);
+    auto first2_ = utils::make_view<const _Tj>(first2, N2);
+    hc::array_view<_To> d_first_ = utils::make_view<_To>(d_first, N1 + N2);
+    merge_kernel(first1_, N1, first2_, N2, d_first_, 0, comp);
+    return d_first + N1 + N2;
+}
+
+} // namespace details
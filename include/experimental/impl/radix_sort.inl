@@ -0,0 +1,386 @@
+#pragma once
+
+namespace details {
+
+// bits of the digit each pass of the radix sort sorts by
+#define RADIX_SORT_BITS 8
+#define RADIX_SORT_BUCKETS (1 << RADIX_SORT_BITS)
+// work-items of a tile of the radix sort, one per bucket
+#define RADIX_SORT_WGSIZE RADIX_SORT_BUCKETS
+// keys each work-item of a pass of the radix sort works on
+#define RADIX_SORT_ITEMS 8
+#define RADIX_SORT_TILE (RADIX_SORT_WGSIZE * RADIX_SORT_ITEMS)
+// tiles of the histogram of the radix sort launched on each compute unit
+#define RADIX_SORT_TILES_PER_CU 8
+// states of the count of a bucket of a tile, in the upper 2 bits of its
+// status word, the lower bits hold the count of the keys of the tile in the
+// bucket, or its inclusive prefix which is the count of all the tiles up to it
+#define RADIX_SORT_FLAG_AGGREGATE 1u
+#define RADIX_SORT_FLAG_PREFIX 2u
+#define RADIX_SORT_COUNT_BITS 30
+#define RADIX_SORT_COUNT_MASK ((1u << RADIX_SORT_COUNT_BITS) - 1)
+
+// keys the radix sort sorts, as unsigned integers of the same size whose
+// order is the order of the keys, and back
+template<typename T, typename Enable = void>
+struct radix_traits {
+    static const bool value = false;
+};
+
+template<typename T>
+struct radix_traits<T, typename std::enable_if<
+                         std::is_integral<T>::value && !std::is_same<T, bool>::value &&
+                         (sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t))>::type> {
+    static const bool value = true;
+    typedef typename std::conditional<sizeof(T) == sizeof(uint32_t),
+                                      uint32_t, uint64_t>::type key_type;
+    // signed keys have their sign bit flipped
+    static const key_type sign = std::is_signed<T>::value ?
+                                 (key_type(1) << (sizeof(T) * 8 - 1)) : 0;
+
+    static key_type encode(T v) __CPU__ __HC__ { return static_cast<key_type>(v) ^ sign; }
+    static T decode(key_type k) __CPU__ __HC__ { return static_cast<T>(k ^ sign); }
+};
+
+template<typename T>
+struct radix_traits<T, typename std::enable_if<
+                         std::is_floating_point<T>::value &&
+                         (sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t))>::type> {
+    static const bool value = true;
+    typedef typename std::conditional<sizeof(T) == sizeof(uint32_t),
+                                      uint32_t, uint64_t>::type key_type;
+    static const key_type sign = key_type(1) << (sizeof(T) * 8 - 1);
+
+    // negative keys have all their bits flipped, the others their sign bit
+    static key_type encode(T v) __CPU__ __HC__ {
+        union { T v; key_type k; } bits;
+        bits.v = v;
+        return bits.k ^ ((bits.k & sign) ? ~key_type(0) : sign);
+    }
+    static T decode(key_type k) __CPU__ __HC__ {
+        union { T v; key_type k; } bits;
+        bits.k = k ^ ((k & sign) ? sign : ~key_type(0));
+        return bits.v;
+    }
+};
+
+// whether sort with comp may use the radix sort for keys of type T, with
+// std::less and std::greater, which sort them in the order of their encoding
+template<typename T, typename Compare>
+using isRadixSortable =
+    std::integral_constant<bool, radix_traits<T>::value &&
+                                 (std::is_same<Compare, std::less<T>>::value ||
+                                  std::is_same<Compare, std::greater<T>>::value)>;
+
+// encoding of keys sorted with comp, flipped for descending orders
+template<typename T, typename Compare>
+struct radix_encode {
+    typedef typename radix_traits<T>::key_type key_type;
+    static const bool descending = std::is_same<Compare, std::greater<T>>::value;
+
+    key_type operator()(const T& v) const __CPU__ __HC__ {
+        key_type k = radix_traits<T>::encode(v);
+        return descending ? ~k : k;
+    }
+};
+
+template<typename T, typename Compare>
+struct radix_decode {
+    typedef typename radix_traits<T>::key_type key_type;
+    static const bool descending = std::is_same<Compare, std::greater<T>>::value;
+
+    T operator()(const key_type& k) const __CPU__ __HC__ {
+        return radix_traits<T>::decode(descending ? ~k : k);
+    }
+};
+
+// exclusive prefix sum of v across the work-items of a tile, total gets the
+// sum of all of them. lds holds RADIX_SORT_WGSIZE words.
+inline unsigned int radix_tile_scan(unsigned int v, unsigned int& total,
+                                    unsigned int* lds, hc::tiled_index<1>& t_idx) __HC__ {
+    int locId = t_idx.local[0];
+    lds[locId] = v;
+    t_idx.barrier.wait();
+    for (int offset = 1; offset < RADIX_SORT_WGSIZE; offset *= 2) {
+        unsigned int other = (locId >= offset) ? lds[locId - offset] : 0;
+        t_idx.barrier.wait();
+        lds[locId] += other;
+        t_idx.barrier.wait();
+    }
+    unsigned int inclusive = lds[locId];
+    total = lds[RADIX_SORT_WGSIZE - 1];
+    t_idx.barrier.wait();
+    return inclusive - v;
+}
+
+// Encode the keys into keysOut, copy the values into valuesOut, and count
+// the keys of each bucket of every pass into hist, passes rows of
+// RADIX_SORT_BUCKETS counts which are 0.
+template<bool HasValues, typename T, typename V, typename Encode>
+void radix_histogram(const hc::array_view<T>& keys_, const hc::array_view<V>& values_,
+                     const hc::array_view<typename Encode::key_type>& keysOut,
+                     const hc::array_view<V>& valuesOut,
+                     const hc::array_view<unsigned int>& hist,
+                     int N, Encode encode) {
+    typedef typename Encode::key_type Key;
+    const int passes = sizeof(Key) * 8 / RADIX_SORT_BITS;
+    int numTiles = (N + RADIX_SORT_WGSIZE - 1) / RADIX_SORT_WGSIZE;
+    numTiles = std::min(numTiles, compute_units() * RADIX_SORT_TILES_PER_CU);
+    int length = numTiles * RADIX_SORT_WGSIZE;
+    kernel_launch(length,
+                  [ keys_, values_, keysOut, valuesOut, hist, N, length, encode ]
+                  ( hc::tiled_index<1> t_idx ) [[hc]]
+                  {
+                  tile_static unsigned int lds[passes * RADIX_SORT_BUCKETS];
+                  int locId = t_idx.local[0];
+                  for (int i = locId; i < passes * RADIX_SORT_BUCKETS; i += RADIX_SORT_WGSIZE)
+                      lds[i] = 0;
+                  t_idx.barrier.wait();
+
+                  for (int gx = t_idx.global[0]; gx < N; gx += length) {
+                      Key k = encode(keys_[gx]);
+                      keysOut[gx] = k;
+                      if (HasValues)
+                          valuesOut[gx] = values_[gx];
+                      for (int p = 0; p < passes; ++p) {
+                          unsigned int digit = static_cast<unsigned int>(
+                                                 (k >> (p * RADIX_SORT_BITS)) & (RADIX_SORT_BUCKETS - 1));
+                          hc::atomic_fetch_add(&lds[p * RADIX_SORT_BUCKETS + digit], 1u);
+                      }
+                  }
+                  t_idx.barrier.wait();
+
+                  for (int i = locId; i < passes * RADIX_SORT_BUCKETS; i += RADIX_SORT_WGSIZE) {
+                      if (lds[i] != 0)
+                          hc::atomic_fetch_add(&hist[i], lds[i]);
+                  }
+                  }, RADIX_SORT_WGSIZE);
+}
+
+// One pass of the radix sort, in the manner of Onesweep: keys are sorted
+// by the digit at shift with a single kernel, whose tiles get their id in
+// the order they start, and sort their keys by the digit in tile_static
+// memory with stable 1-bit splits. The work-item of each bucket then
+// publishes the count of the tile in its status word, and walks back the
+// status words of the bucket of the tiles before it until one has its
+// inclusive prefix, so each key goes to the offset of its bucket in
+// offsets, plus the keys of the bucket in the tiles before, plus its rank
+// in the tile. status holds numTiles rows of RADIX_SORT_BUCKETS words which
+// are 0, then the counter of tile ids, which is 0 as well.
+template<bool HasValues, typename Key, typename OutKey, typename V, typename Store>
+void radix_pass(const hc::array_view<Key>& keysIn, const hc::array_view<V>& valuesIn,
+                const hc::array_view<OutKey>& keysOut, const hc::array_view<V>& valuesOut,
+                const hc::array_view<unsigned int>& offsets,
+                const hc::array_view<unsigned int>& status,
+                int N, int shift, Store store) {
+    int numTiles = (N + RADIX_SORT_TILE - 1) / RADIX_SORT_TILE;
+    kernel_launch(numTiles * RADIX_SORT_WGSIZE,
+                  [ keysIn, valuesIn, keysOut, valuesOut, offsets, status, N, numTiles, shift, store ]
+                  ( hc::tiled_index<1> t_idx ) [[hc]]
+                  {
+                  tile_static Key ldsKeys[RADIX_SORT_TILE];
+                  tile_static V ldsValues[HasValues ? RADIX_SORT_TILE : 1];
+                  tile_static unsigned int ldsScan[RADIX_SORT_WGSIZE];
+                  tile_static unsigned int ldsCount[RADIX_SORT_BUCKETS];
+                  tile_static unsigned int ldsOffset[RADIX_SORT_BUCKETS];
+                  tile_static int ldsTileId;
+                  int locId = t_idx.local[0];
+
+                  if (locId == 0)
+                      ldsTileId = static_cast<int>(hc::atomic_fetch_add(&status[numTiles * RADIX_SORT_BUCKETS], 1u));
+                  ldsCount[locId] = 0;
+                  t_idx.barrier.wait();
+                  int tileId = ldsTileId;
+                  int base = tileId * RADIX_SORT_TILE;
+                  int valid = (N - base < RADIX_SORT_TILE) ? N - base : RADIX_SORT_TILE;
+
+                  // keys past the end sort after all the others, and aren't stored
+                  for (int k = 0; k < RADIX_SORT_ITEMS; ++k) {
+                      int i = k * RADIX_SORT_WGSIZE + locId;
+                      ldsKeys[i] = (i < valid) ? keysIn[base + i] : ~Key(0);
+                      if (HasValues && i < valid)
+                          ldsValues[i] = valuesIn[base + i];
+                  }
+                  t_idx.barrier.wait();
+
+                  Key keys[RADIX_SORT_ITEMS];
+                  V values[HasValues ? RADIX_SORT_ITEMS : 1];
+                  for (int k = 0; k < RADIX_SORT_ITEMS; ++k) {
+                      int i = locId * RADIX_SORT_ITEMS + k;
+                      keys[k] = ldsKeys[i];
+                      if (HasValues)
+                          values[k] = ldsValues[i];
+                      if (i < valid) {
+                          unsigned int digit = static_cast<unsigned int>(
+                                                 (keys[k] >> shift) & (RADIX_SORT_BUCKETS - 1));
+                          hc::atomic_fetch_add(&ldsCount[digit], 1u);
+                      }
+                  }
+
+                  for (int bit = shift; bit < shift + RADIX_SORT_BITS; ++bit) {
+                      unsigned int zeros = 0;
+                      for (int k = 0; k < RADIX_SORT_ITEMS; ++k)
+                          zeros += ((keys[k] >> bit) & 1) ? 0 : 1;
+                      unsigned int totalZeros;
+                      unsigned int zerosBefore = radix_tile_scan(zeros, totalZeros, ldsScan, t_idx);
+                      for (int k = 0; k < RADIX_SORT_ITEMS; ++k) {
+                          unsigned int i = locId * RADIX_SORT_ITEMS + k;
+                          unsigned int pos;
+                          if ((keys[k] >> bit) & 1) {
+                              pos = totalZeros + (i - zerosBefore);
+                          } else {
+                              pos = zerosBefore++;
+                          }
+                          ldsKeys[pos] = keys[k];
+                          if (HasValues)
+                              ldsValues[pos] = values[k];
+                      }
+                      t_idx.barrier.wait();
+                      for (int k = 0; k < RADIX_SORT_ITEMS; ++k) {
+                          int i = locId * RADIX_SORT_ITEMS + k;
+                          keys[k] = ldsKeys[i];
+                          if (HasValues)
+                              values[k] = ldsValues[i];
+                      }
+                  }
+
+                  // decoupled look-back of the bucket of the work-item
+                  unsigned int count = ldsCount[locId];
+                  unsigned int total;
+                  unsigned int localStart = radix_tile_scan(count, total, ldsScan, t_idx);
+                  unsigned int index = tileId * RADIX_SORT_BUCKETS + locId;
+                  unsigned int exclusive = 0;
+                  if (tileId == 0) {
+                      hc::atomic_exchange(&status[ index ], (RADIX_SORT_FLAG_PREFIX << RADIX_SORT_COUNT_BITS) | count);
+                  } else {
+                      hc::atomic_exchange(&status[ index ], (RADIX_SORT_FLAG_AGGREGATE << RADIX_SORT_COUNT_BITS) | count);
+                      int j = tileId - 1;
+                      while (true) {
+                          unsigned int word = hc::atomic_fetch_add(&status[ j * RADIX_SORT_BUCKETS + locId ], 0u);
+                          unsigned int state = word >> RADIX_SORT_COUNT_BITS;
+                          if (state == 0)
+                              continue;
+                          exclusive += word & RADIX_SORT_COUNT_MASK;
+                          if (state == RADIX_SORT_FLAG_PREFIX)
+                              break;
+                          --j;
+                      }
+                      hc::atomic_exchange(&status[ index ], (RADIX_SORT_FLAG_PREFIX << RADIX_SORT_COUNT_BITS) | (exclusive + count));
+                  }
+                  ldsOffset[locId] = offsets[locId] + exclusive - localStart;
+                  t_idx.barrier.wait();
+
+                  for (int k = 0; k < RADIX_SORT_ITEMS; ++k) {
+                      int i = k * RADIX_SORT_WGSIZE + locId;
+                      if (i < valid) {
+                          Key key = ldsKeys[i];
+                          unsigned int digit = static_cast<unsigned int>(
+                                                 (key >> shift) & (RADIX_SORT_BUCKETS - 1));
+                          unsigned int dst = ldsOffset[digit] + i;
+                          keysOut[dst] = store(key);
+                          if (HasValues)
+                              valuesOut[dst] = ldsValues[i];
+                      }
+                  }
+                  }, RADIX_SORT_WGSIZE);
+}
+
+/**
+ * LSD radix sort of the N keys of keys_, and of the values of values_ along
+ * with them when HasValues, in the order of comp. Keys are sorted by 8-bit
+ * digits, the passes of the digits which all the keys share are skipped.
+ * The sort is stable. N must be less than 2^30.
+ */
+template<bool HasValues, typename T, typename V, typename Compare>
+void radix_sort(const hc::array_view<T>& keys_, const hc::array_view<V>& values_,
+                int N, Compare) {
+    typedef radix_encode<T, Compare> Encode;
+    typedef typename Encode::key_type Key;
+    const int passes = sizeof(Key) * 8 / RADIX_SORT_BITS;
+
+    scratch_buffer<Key> keysBufferA(N), keysBufferB(N);
+    scratch_buffer<V> valuesBufferA(HasValues ? N : 1), valuesBufferB(HasValues ? N : 1);
+    hc::array_view<Key> keysA = keysBufferA.view();
+    hc::array_view<Key> keysB = keysBufferB.view();
+    hc::array_view<V> valuesA = valuesBufferA.view();
+    hc::array_view<V> valuesB = valuesBufferB.view();
+
+    std::vector<unsigned int> h(passes * RADIX_SORT_BUCKETS, 0);
+    hc::array_view<unsigned int> hist(hc::extent<1>(h.size()), h);
+    radix_histogram<HasValues>(keys_, values_, keysA, valuesA, hist, N, Encode());
+    hist.synchronize();
+
+    // offsets of the buckets of the passes which reorder the keys
+    std::vector<int> shifts;
+    std::vector<unsigned int> o;
+    for (int p = 0; p < passes; ++p) {
+        const unsigned int* count = h.data() + p * RADIX_SORT_BUCKETS;
+        if (std::find(count, count + RADIX_SORT_BUCKETS, static_cast<unsigned int>(N)) !=
+            count + RADIX_SORT_BUCKETS)
+            continue;
+        shifts.push_back(p * RADIX_SORT_BITS);
+        unsigned int sum = 0;
+        for (int b = 0; b < RADIX_SORT_BUCKETS; ++b) {
+            o.push_back(sum);
+            sum += count[b];
+        }
+    }
+    if (shifts.empty())
+        return;
+
+    int numTiles = (N + RADIX_SORT_TILE - 1) / RADIX_SORT_TILE;
+    scratch_buffer<unsigned int> statusBuffer(numTiles * RADIX_SORT_BUCKETS + 1);
+    hc::array_view<unsigned int> status = statusBuffer.view();
+    hc::array_view<unsigned int> offsets(hc::extent<1>(o.size()), o);
+    for (size_t p = 0; p < shifts.size(); ++p) {
+        kernel_launch(status.get_extent()[0], [status](hc::index<1> i) [[hc]] {
+            status[i] = 0;
+        });
+        hc::array_view<unsigned int> passOffsets =
+            offsets.section(p * RADIX_SORT_BUCKETS, RADIX_SORT_BUCKETS);
+        if (p + 1 < shifts.size()) {
+            radix_pass<HasValues>(keysA, valuesA, keysB, valuesB, passOffsets, status,
+                                  N, shifts[p], identity_load<Key>());
+            std::swap(keysA, keysB);
+            std::swap(valuesA, valuesB);
+        } else {
+            radix_pass<HasValues>(keysA, valuesA, keys_, values_, passOffsets, status,
+                                  N, shifts[p], radix_decode<T, Compare>());
+        }
+    }
+    keysA.discard_data();
+    keysB.discard_data();
+    valuesA.discard_data();
+    valuesB.discard_data();
+    status.discard_data();
+}
+
+template<typename KeyIt, typename Compare>
+void radix_sort_keys(KeyIt, int, Compare, std::false_type) {}
+
+// radix sort of the N keys from first, for the keys and comparisons
+// isRadixSortable allows
+template<typename KeyIt, typename Compare>
+void radix_sort_keys(KeyIt first, int N, Compare comp, std::true_type) {
+    typedef typename std::iterator_traits<KeyIt>::value_type T;
+    hc::array_view<T> keys_ = utils::make_view<T>(first, N);
+    hc::array_view<int> none((hc::extent<1>(1)));
+    radix_sort<false>(keys_, none, N, comp);
+}
+
+template<typename KeyIt, typename ValueIt, typename Compare>
+void radix_sort_pairs(KeyIt, ValueIt, int, Compare, std::false_type) {}
+
+// radix sort of the N keys from first, and of the values from values_first
+// along with them
+template<typename KeyIt, typename ValueIt, typename Compare>
+void radix_sort_pairs(KeyIt first, ValueIt values_first, int N, Compare comp,
+                      std::true_type) {
+    typedef typename std::iterator_traits<KeyIt>::value_type T;
+    typedef typename std::iterator_traits<ValueIt>::value_type V;
+    hc::array_view<T> keys_ = utils::make_view<T>(first, N);
+    hc::array_view<V> values_ = utils::make_view<V>(values_first, N);
+    radix_sort<true>(keys_, values_, N, comp);
+}
+
+} // namespace details
@@ -27,7 +27,8 @@ int reduce_lexi(std::vector<int>& v) {
     const int N = static_cast<int>(v.size());
     auto binary_op = [](const int& a, const int& b) { return a == 1 ? b : a; };
     // call to std::accumulate when small data size
-    if (N <= details::PARALLELIZE_THRESHOLD) {
+    details::backend_choice backend("reduce", typeid(int), N);
+    if (backend.host()) {
         return reduce_impl(std::begin(v), std::end(v), 1, binary_op, std::input_iterator_tag{});
     }
 
@@ -105,34 +106,28 @@ int reduce_lexi(std::vector<int>& v) {
     return ans;
 }
 
-template<class RandomAccessIterator, class T, class BinaryOperation>
-T reduce_impl(RandomAccessIterator first, RandomAccessIterator last,
-              T init,
-              BinaryOperation binary_op,
-              std::random_access_iterator_tag) {
-
-    const int N = static_cast<int>(std::distance(first, last));
-    // call to std::accumulate when small data size
-    if (N <= details::PARALLELIZE_THRESHOLD) {
-        return reduce_impl(first, last, init, binary_op, std::input_iterator_tag{});
-    }
-
+// number of tiles of the reduce kernel of N elements, and the number of
+// work-items it's launched with
+inline int reduce_tiles(int N, int& length) {
     int max_ComputeUnits = 32;
     int numTiles = max_ComputeUnits*32;
-    int length = (REDUCE_WAVEFRONT_SIZE*numTiles);
+    length = (REDUCE_WAVEFRONT_SIZE*numTiles);
     length = N < length ? N : length;
     unsigned int residual = length % REDUCE_WAVEFRONT_SIZE;
     length = residual ? (length + REDUCE_WAVEFRONT_SIZE - residual): length ;
     numTiles = static_cast< int >((N/REDUCE_WAVEFRONT_SIZE)>= numTiles?(numTiles):
                                   (std::ceil( static_cast< float >( N ) / REDUCE_WAVEFRONT_SIZE) ));
+    return numTiles;
+}
 
-    auto f_ = utils::get_pointer(first);
-    using _Ty = typename std::iterator_traits<RandomAccessIterator>::value_type;
-    std::vector<T> r(numTiles);
-    hc::array_view<T> result(hc::extent<1>(numTiles), r);
-    hc::array_view<const _Ty> first_(hc::extent<1>(N), f_);
-    result.discard_data();
-    kernel_launch(length,
+// launch the reduce kernel, which writes the reduction of the elements of
+// each tile to result
+template<class InView, class T, class BinaryOperation>
+hc::completion_future
+reduce_kernel(const InView& first_, int N, int length,
+              const hc::array_view<T>& result, BinaryOperation binary_op,
+              bool wait = true) {
+    return kernel_launch(length,
                   [ first_, N, length, result, binary_op ]
                   ( hc::tiled_index<1> t_idx ) [[hc]]
                   {
@@ -185,12 +180,262 @@ T reduce_impl(RandomAccessIterator first, RandomAccessIterator last,
                       result[t_idx.tile[ 0 ]] = scratch[0];
                   }
 
-                  }, REDUCE_WAVEFRONT_SIZE);
+                  }, REDUCE_WAVEFRONT_SIZE, wait);
+}
+
+// work-items of a tile of the wavefront reduce
+#define REDUCE_TILE_SIZE 256
+// tiles of the wavefront reduce launched on each compute unit
+#define REDUCE_TILES_PER_CU 8
+
+// types the wavefront reduce shuffles across lanes, and publishes to the
+// final pass in 64-bit words: arithmetic types and packed halves
+template<typename T>
+using isWaveReduceType =
+    std::integral_constant<bool, (std::is_arithmetic<T>::value ||
+                                  std::is_same<T, hc::short_vector::half_2>::value) &&
+                                 (sizeof(T) == sizeof(uint32_t) ||
+                                  sizeof(T) == sizeof(uint64_t))>;
+
+// v of the lane delta lanes up the wavefront of WaveSize lanes, a word at
+// a time
+template<unsigned int WaveSize, typename T>
+inline T reduce_shfl_down(T v, unsigned int delta) __HC__ {
+    union { T v; int i[sizeof(T) / sizeof(int)]; } bits;
+    bits.v = v;
+    for (int k = 0; k < static_cast<int>(sizeof(T) / sizeof(int)); ++k)
+        bits.i[k] = hc::__shfl_down(bits.i[k], delta, WaveSize);
+    return bits.v;
+}
+
+// reduction of v across the first valid work-items of a tile, which work-item
+// 0 gets. Lanes reduce within their wavefront of WaveSize lanes with shuffles,
+// and only the result of each wavefront goes through waves, in tile_static
+// memory. All the work-items of the tile call it.
+template<unsigned int WaveSize, typename T, typename BinaryOperation>
+inline T reduce_tile(T v, int valid, T* waves, hc::tiled_index<1>& t_idx,
+                     const BinaryOperation& binary_op) __HC__ {
+    const int waveSize = WaveSize;
+    int locId = t_idx.local[0];
+    int wave = locId / waveSize;
+    int lane = locId % waveSize;
+    int waveValid = valid - wave * waveSize;
+    for (int delta = waveSize / 2; delta > 0; delta /= 2) {
+        T other = reduce_shfl_down<WaveSize>(v, delta);
+        if (lane + delta < waveValid)
+            v = binary_op(v, other);
+    }
+    if (lane == 0 && waveValid > 0)
+        waves[wave] = v;
+    t_idx.barrier.wait();
+
+    int numWaves = (valid + waveSize - 1) / waveSize;
+    if (locId < numWaves)
+        v = waves[locId];
+    if (wave == 0) {
+        for (int delta = waveSize / 2; delta > 0; delta /= 2) {
+            T other = reduce_shfl_down<WaveSize>(v, delta);
+            if (lane + delta < numWaves)
+                v = binary_op(v, other);
+        }
+    }
+    return v;
+}
+
+// number of tiles of the wavefront reduce of N elements, as many as keep
+// all the compute units of the default accelerator busy
+inline int reduce_wave_tiles(int N) {
+    int numTiles = (N + REDUCE_TILE_SIZE - 1) / REDUCE_TILE_SIZE;
+    return std::min(numTiles, compute_units() * REDUCE_TILES_PER_CU);
+}
+
+template<class InView, class T, class Load, class BinaryOperation>
+hc::completion_future
+reduce_wave_kernel(const InView&, int, const Load&, T,
+                   const BinaryOperation&, const hc::array_view<uint64_t>&,
+                   const hc::array_view<T>&, bool, std::false_type) {
+    return hc::completion_future();
+}
+
+// the wavefront reduce for agents of WaveSize lanes, see reduce_wave_kernel
+template<unsigned int WaveSize, class InView, class T, class Load, class BinaryOperation>
+hc::completion_future
+reduce_wave_variant(const InView& first_, int N,
+                    const Load& load, T init, const BinaryOperation& binary_op,
+                    const hc::array_view<uint64_t>& partials,
+                    const hc::array_view<T>& out, bool wait) {
+    int numTiles = partials.get_extent()[0] - 1;
+    int length = numTiles * REDUCE_TILE_SIZE;
+    return kernel_launch(length,
+                  [ first_, N, length, numTiles, partials, out, load, init, binary_op ]
+                  ( hc::tiled_index<1> t_idx ) [[hc]]
+                  {
+                  tile_static T waves[REDUCE_TILE_SIZE / WaveSize];
+                  tile_static int last;
+                  int gx = t_idx.global[0];
+                  int locId = t_idx.local[0];
+                  int tileId = t_idx.tile[0];
+
+                  // the work-items with elements are a prefix of the grid
+                  T accumulator;
+                  if (gx < N) {
+                      accumulator = load(first_[gx]);
+                      for (gx += length; gx < N; gx += length)
+                          accumulator = binary_op(accumulator, load(first_[gx]));
+                  }
+                  int valid = N - tileId * REDUCE_TILE_SIZE;
+                  valid = valid < REDUCE_TILE_SIZE ? valid : REDUCE_TILE_SIZE;
+                  accumulator = reduce_tile<WaveSize>(accumulator, valid, waves, t_idx, binary_op);
+
+                  if (locId == 0) {
+                      union { T v; uint64_t u; } bits;
+                      bits.u = 0;
+                      bits.v = accumulator;
+                      hc::atomic_exchange(&partials[ tileId ], bits.u);
+                      last = (hc::atomic_fetch_add(&partials[ numTiles ], (uint64_t)1) ==
+                              static_cast<uint64_t>(numTiles - 1));
+                  }
+                  t_idx.barrier.wait();
+                  if (!last)
+                      return;
+
+                  // final pass, all the partial results are published
+                  for (int i = locId; i < numTiles; i += REDUCE_TILE_SIZE) {
+                      union { T v; uint64_t u; } bits;
+                      bits.u = hc::atomic_fetch_add(&partials[ i ], (uint64_t)0);
+                      accumulator = (i == locId) ? bits.v : binary_op(accumulator, bits.v);
+                  }
+                  valid = numTiles < REDUCE_TILE_SIZE ? numTiles : REDUCE_TILE_SIZE;
+                  t_idx.barrier.wait();
+                  accumulator = reduce_tile<WaveSize>(accumulator, valid, waves, t_idx, binary_op);
+                  if (locId == 0)
+                      out[0] = binary_op(init, accumulator);
+                  }, REDUCE_TILE_SIZE, wait);
+}
+
+// launches the variant of the wavefront reduce for the wavefront size
+// hc::dispatch_wavefront_size() selects
+template<class InView, class T, class Load, class BinaryOperation>
+struct reduce_wave_launch {
+    const InView& first_;
+    int N;
+    const Load& load;
+    T init;
+    const BinaryOperation& binary_op;
+    const hc::array_view<uint64_t>& partials;
+    const hc::array_view<T>& out;
+    bool wait;
+
+    template<unsigned int WaveSize>
+    hc::completion_future operator()(hc::wavefront_size_t<WaveSize>) const {
+        return reduce_wave_variant<WaveSize>(first_, N, load, init, binary_op,
+                                             partials, out, wait);
+    }
+};
+
+// launch the wavefront reduce, which writes
+// GENERALIZED_SUM(binary_op, init, load(first_[0]), ..., load(first_[N - 1]))
+// to out[0]. partials holds reduce_wave_tiles(N) + 1 words which are 0, the
+// partial result of each tile and the count of tiles done after them.
+// Each tile reduces a grid-strided share of the elements, then
+// publishes its partial result with an atomic, and the last tile to finish
+// reduces the partial results of all of them as the final pass, so none of
+// them goes back to the host. The kernel is built for wave32 and wave64
+// agents, and the variant of the default accelerator is launched.
+template<class InView, class T, class Load, class BinaryOperation>
+hc::completion_future
+reduce_wave_kernel(const InView& first_, int N,
+                   const Load& load, T init, const BinaryOperation& binary_op,
+                   const hc::array_view<uint64_t>& partials,
+                   const hc::array_view<T>& out, bool wait, std::true_type) {
+    reduce_wave_launch<InView, T, Load, BinaryOperation> launch =
+        { first_, N, load, init, binary_op, partials, out, wait };
+    return hc::dispatch_wavefront_size(hc::accelerator().get_default_view(), launch);
+}
+
+template<class RandomAccessIterator, class T, class BinaryOperation>
+T reduce_impl(RandomAccessIterator first, RandomAccessIterator last,
+              T init,
+              BinaryOperation binary_op,
+              std::random_access_iterator_tag) {
+
+    const int N = static_cast<int>(std::distance(first, last));
+    // call to std::accumulate when small data size
+    details::backend_choice backend("reduce", typeid(typename std::iterator_traits<RandomAccessIterator>::value_type), N);
+    if (backend.host()) {
+        return reduce_impl(first, last, init, binary_op, std::input_iterator_tag{});
+    }
+
+    using _Ty = typename std::iterator_traits<RandomAccessIterator>::value_type;
+    auto first_ = utils::make_view<const _Ty>(first, N);
+    if (isWaveReduceType<T>::value) {
+        std::vector<uint64_t> p(reduce_wave_tiles(N) + 1, 0);
+        hc::array_view<uint64_t> partials(hc::extent<1>(p.size()), p);
+        hc::array_view<T> out((hc::extent<1>(1)));
+        reduce_wave_kernel(first_, N, identity_load<_Ty>(), init, binary_op,
+                           partials, out, true, isWaveReduceType<T>());
+        partials.discard_data();
+        return out[0];
+    }
+
+    int length;
+    int numTiles = reduce_tiles(N, length);
+
+    std::vector<T> r(numTiles);
+    hc::array_view<T> result(hc::extent<1>(numTiles), r);
+    result.discard_data();
+    reduce_kernel(first_, N, length, result, binary_op);
 
     result.synchronize();
     auto ans = std::accumulate(std::begin(r), std::end(r), init, binary_op);
     return ans;
 }
+
+// parallel::reduce with par_async
+template<class InputIterator, class T, class BinaryOperation>
+std::future<T> reduce_async_impl(InputIterator first, InputIterator last,
+                                 T init,
+                                 BinaryOperation binary_op) {
+    const int N = static_cast<int>(std::distance(first, last));
+    // kernels run asynchronously are not timed
+    details::backend_choice backend("reduce", typeid(typename std::iterator_traits<InputIterator>::value_type), N, false);
+    if (!utils::isRandomAccessIt<InputIterator>::value ||
+        backend.host()) {
+        std::promise<T> p;
+        p.set_value(reduce_impl(first, last, init, binary_op, std::input_iterator_tag{}));
+        return p.get_future();
+    }
+
+    using _Ty = typename std::iterator_traits<InputIterator>::value_type;
+    auto first_ = utils::make_view<const _Ty>(first, N);
+    if (isWaveReduceType<T>::value) {
+        // the result stays in a view of its own, read back on get()
+        auto p = std::make_shared<std::vector<uint64_t>>(reduce_wave_tiles(N) + 1, 0);
+        hc::array_view<uint64_t> partials(hc::extent<1>(p->size()), *p);
+        hc::array_view<T> out((hc::extent<1>(1)));
+        auto state = std::make_shared<async_state>(
+                       reduce_wave_kernel(first_, N, identity_load<_Ty>(), init, binary_op,
+                                          partials, out, false, isWaveReduceType<T>()),
+                       [first_, partials, p, out] {});
+        return std::async(std::launch::deferred, [state, out] {
+            state->wait();
+            return *out.data();
+        });
+    }
+
+    int length;
+    int numTiles = reduce_tiles(N, length);
+
+    // the partial results stay in a view of their own, read back on get()
+    hc::array_view<T> result((hc::extent<1>(numTiles)));
+    auto state = std::make_shared<async_state>(
+                   reduce_kernel(first_, N, length, result, binary_op, false),
+                   [first_, result] {});
+    return std::async(std::launch::deferred, [state, result, numTiles, init, binary_op] {
+        state->wait();
+        return std::accumulate(result.data(), result.data() + numTiles, init, binary_op);
+    });
+}
 } // namespace details
 
 
@@ -218,7 +463,7 @@ T reduce(InputIterator first, InputIterator last,
 }
 
 template<class ExecutionPolicy, class InputIterator, class T, class BinaryOperation,
-         utils::EnableIf<utils::isExecutionPolicy<ExecutionPolicy>> = nullptr,
+         utils::EnableIf<utils::isSyncPolicy<ExecutionPolicy>> = nullptr,
          utils::EnableIf<utils::isInputIt<InputIterator>> = nullptr>
 T
 reduce(ExecutionPolicy&& exec,
@@ -231,6 +476,15 @@ reduce(ExecutionPolicy&& exec,
              std::input_iterator_tag{});
   }
 }
+
+template<class InputIterator, class T, class BinaryOperation,
+         utils::EnableIf<utils::isInputIt<InputIterator>> = nullptr>
+std::future<T>
+reduce(const parallel_async_execution_policy& exec,
+       InputIterator first, InputIterator last, T init,
+       BinaryOperation binary_op) {
+  return details::reduce_async_impl(first, last, init, binary_op);
+}
 /**@}*/
 
 /**
@@ -246,7 +500,7 @@ T reduce(InputIterator first, InputIterator last, T init) {
 
 template<typename ExecutionPolicy,
          typename InputIterator, typename T,
-         utils::EnableIf<utils::isExecutionPolicy<ExecutionPolicy>> = nullptr,
+         utils::EnableIf<utils::isSyncPolicy<ExecutionPolicy>> = nullptr,
          utils::EnableIf<utils::isInputIt<InputIterator>> = nullptr>
 T
 reduce(ExecutionPolicy&& exec,
@@ -254,6 +508,15 @@ reduce(ExecutionPolicy&& exec,
   typedef typename std::iterator_traits<InputIterator>::value_type Type;
   return reduce(exec, first, last, init, std::plus<Type>());
 }
+
+template<typename InputIterator, typename T,
+         utils::EnableIf<utils::isInputIt<InputIterator>> = nullptr>
+std::future<T>
+reduce(const parallel_async_execution_policy& exec,
+       InputIterator first, InputIterator last, T init) {
+  typedef typename std::iterator_traits<InputIterator>::value_type Type;
+  return reduce(exec, first, last, init, std::plus<Type>());
+}
 /**@}*/
 
 /**
@@ -270,7 +533,7 @@ reduce(InputIterator first, InputIterator last) {
 
 template<typename ExecutionPolicy,
          typename InputIterator,
-         utils::EnableIf<utils::isExecutionPolicy<ExecutionPolicy>> = nullptr,
+         utils::EnableIf<utils::isSyncPolicy<ExecutionPolicy>> = nullptr,
          utils::EnableIf<utils::isInputIt<InputIterator>> = nullptr>
 typename std::iterator_traits<InputIterator>::value_type
 reduce(ExecutionPolicy&& exec,
@@ -278,5 +541,14 @@ reduce(ExecutionPolicy&& exec,
   typedef typename std::iterator_traits<InputIterator>::value_type Type;
   return reduce(exec, first, last, Type{}, std::plus<Type>());
 }
+
+template<typename InputIterator,
+         utils::EnableIf<utils::isInputIt<InputIterator>> = nullptr>
+std::future<typename std::iterator_traits<InputIterator>::value_type>
+reduce(const parallel_async_execution_policy& exec,
+       InputIterator first, InputIterator last) {
+  typedef typename std::iterator_traits<InputIterator>::value_type Type;
+  return reduce(exec, first, last, Type{}, std::plus<Type>());
+}
 /**@}*/
 
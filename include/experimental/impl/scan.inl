@@ -13,6 +13,195 @@ namespace details {
 #define SCAN_WAVESIZE 128
 #define SCAN_TILE_MAX 65535
 
+// elements each work-item of the single-pass scan works on
+#define SCAN_CHAINED_ITEMS 4
+// states of a tile of the single-pass scan, in the upper half of its status
+// word, the lower half holds the aggregate of the tile, or its inclusive
+// prefix which is the aggregate of all the tiles up to it
+#define SCAN_FLAG_AGGREGATE 1
+#define SCAN_FLAG_PREFIX 2
+
+// types the single-pass scan packs in a status word with the state of a tile
+template<typename T>
+using isChainedScanType =
+    std::integral_constant<bool, std::is_arithmetic<T>::value &&
+                                 sizeof(T) == sizeof(uint32_t)>;
+
+template<typename vType, typename InView, typename OutView,
+         typename Load, typename BinaryFunction>
+bool chained_scan_impl(const InView&, const OutView&, int,
+                       const Load&, const vType&, const BinaryFunction&,
+                       bool, std::false_type)
+{
+    return false;
+}
+
+// Single-pass scan with decoupled look-back. Tiles get their id in the order
+// they start, scan their elements, and publish their aggregate in their
+// status word. The first work-item of each tile then walks back the status
+// words of the tiles before it, combining their aggregates until it reaches
+// a tile which published its inclusive prefix, and publishes its own. Tiles
+// only wait for tiles which started before them, and the input is read and
+// the output written once, instead of the input twice in the three kernels
+// of the scan over the sums of the tiles.
+//
+// Elements are load(first_[i]), where the first one of an exclusive scan is
+// combined with init, as in the scan over the sums of the tiles.
+template<typename vType, typename InView, typename OutView,
+         typename Load, typename BinaryFunction>
+bool chained_scan_impl(const InView& first_, const OutView& re, int numElements,
+                       const Load& load, const vType& init,
+                       const BinaryFunction& binary_op,
+                       bool inclusive, std::true_type)
+{
+    typedef typename OutView::value_type oType;
+
+    const int wgSize = SCAN_WAVESIZE*SCAN_KERNELWAVES;
+    const int tileSize = wgSize*SCAN_CHAINED_ITEMS;
+    const unsigned int numTiles = (numElements + tileSize - 1) / tileSize;
+    int exclusive = inclusive ? 0 : 1;
+
+    // status words of the tiles, followed by the counter of tile ids
+    scratch_buffer<uint64_t> statusBuffer(numTiles + 1);
+    hc::array_view<uint64_t> status = statusBuffer.view();
+    kernel_launch(numTiles + 1, [ status ](hc::index<1> i) [[hc]] {
+        status[i] = 0;
+    });
+
+    for (unsigned int launched = 0; launched < numTiles; launched += SCAN_TILE_MAX)
+    {
+        unsigned int tiles = numTiles - launched;
+        tiles = (tiles > SCAN_TILE_MAX) ? SCAN_TILE_MAX : tiles;
+
+        auto kernel =
+            [ first_, re, status, numElements, numTiles, load, init, binary_op,
+            exclusive, wgSize, tileSize ]
+                ( hc::tiled_index< 1 > t_idx ) [[hc]]
+                {
+                    tile_static vType lds[ SCAN_WAVESIZE*SCAN_KERNELWAVES*SCAN_CHAINED_ITEMS ];
+                    tile_static vType sums[ SCAN_WAVESIZE*SCAN_KERNELWAVES ];
+                    tile_static int tileId;
+                    tile_static vType tilePrefix;
+                    int locId = t_idx.local[ 0 ];
+
+                    if (locId == 0)
+                        tileId = static_cast<int>(hc::atomic_fetch_add(&status[numTiles], (uint64_t)1));
+                    t_idx.barrier.wait();
+
+                    int base = tileId * tileSize;
+                    int valid = numElements - base;
+                    valid = (valid > tileSize) ? tileSize : valid;
+
+                    // load the tile, work-items load consecutive elements
+                    for (int i = 0; i < SCAN_CHAINED_ITEMS; ++i)
+                    {
+                        int k = i * wgSize + locId;
+                        if (k < valid)
+                        {
+                            vType val = load(first_[ base + k ]);
+                            if (exclusive && base + k == 0)
+                                val = binary_op(init, val);
+                            lds[ k ] = val;
+                        }
+                    }
+                    t_idx.barrier.wait();
+
+                    // each work-item scans its elements serially
+                    int firstItem = locId * SCAN_CHAINED_ITEMS;
+                    int items = valid - firstItem;
+                    items = (items > SCAN_CHAINED_ITEMS) ? SCAN_CHAINED_ITEMS : items;
+                    if (items > 0)
+                    {
+                        vType sum = lds[ firstItem ];
+                        for (int i = 1; i < items; ++i)
+                        {
+                            sum = binary_op(sum, lds[ firstItem + i ]);
+                            lds[ firstItem + i ] = sum;
+                        }
+                        sums[ locId ] = sum;
+                    }
+
+                    // then the sums of the work-items are scanned
+                    int threads = (valid + SCAN_CHAINED_ITEMS - 1) / SCAN_CHAINED_ITEMS;
+                    for (int offset = 1; offset < wgSize; offset *= 2)
+                    {
+                        t_idx.barrier.wait();
+                        bool combine = (locId >= offset && locId < threads);
+                        vType y;
+                        if (combine)
+                            y = sums[ locId - offset ];
+                        t_idx.barrier.wait();
+                        if (combine)
+                            sums[ locId ] = binary_op(y, sums[ locId ]);
+                    }
+                    t_idx.barrier.wait();
+
+                    // look-back
+                    if (locId == 0)
+                    {
+                        union { vType v; uint32_t u; } bits;
+                        bits.v = sums[ threads - 1 ];
+                        uint64_t flag = (tileId == 0) ? SCAN_FLAG_PREFIX : SCAN_FLAG_AGGREGATE;
+                        hc::atomic_exchange(&status[ tileId ], (flag << 32) | bits.u);
+
+                        if (tileId > 0)
+                        {
+                            vType aggregate = bits.v;
+                            vType prefix;
+                            bool found = false;
+                            int j = tileId - 1;
+                            for (;;)
+                            {
+                                uint64_t word = hc::atomic_fetch_add(&status[ j ], (uint64_t)0);
+                                uint64_t state = word >> 32;
+                                if (state == 0)
+                                    continue;
+                                bits.u = static_cast<uint32_t>(word);
+                                prefix = found ? binary_op(bits.v, prefix) : bits.v;
+                                found = true;
+                                if (state == SCAN_FLAG_PREFIX)
+                                    break;
+                                --j;
+                            }
+                            tilePrefix = prefix;
+                            bits.v = binary_op(prefix, aggregate);
+                            hc::atomic_exchange(&status[ tileId ], ((uint64_t)SCAN_FLAG_PREFIX << 32) | bits.u);
+                        }
+                    }
+                    t_idx.barrier.wait();
+
+                    // write the tile, element k is the scan of the elements
+                    // up to k, or up to the one before it if exclusive
+                    for (int i = 0; i < SCAN_CHAINED_ITEMS; ++i)
+                    {
+                        int k = i * wgSize + locId;
+                        if (k >= valid)
+                            break;
+                        int m = k - exclusive;
+                        vType val;
+                        if (m < 0)
+                        {
+                            val = (tileId > 0) ? tilePrefix : init;
+                        }
+                        else
+                        {
+                            int owner = m / SCAN_CHAINED_ITEMS;
+                            val = lds[ m ];
+                            if (owner > 0)
+                                val = binary_op(sums[ owner - 1 ], val);
+                            if (tileId > 0)
+                                val = binary_op(tilePrefix, val);
+                        }
+                        re[ base + k ] = static_cast<oType>(val);
+                    }
+                };
+
+        details::kernel_launch(tiles * wgSize, kernel, wgSize);
+    }
+
+    return true;
+}
+
 template<
     typename InputIterator,
     typename OutputIterator,
@@ -35,6 +224,20 @@ void scan_impl(
     int exclusive = inclusive ? 0 : 1;
 
     int numElements = static_cast< int >( std::distance( first, last ) );
+
+    // scans of 4 byte types run in a single pass
+    if (isChainedScanType<iType>::value)
+    {
+        auto in_ = utils::make_view<iType>(first, numElements);
+        hc::array_view<oType> out_ = utils::make_view<oType>(result, numElements);
+        // scans in place read the output
+        if (!utils::isDeviceIt<OutputIterator>::value)
+            out_.discard_data();
+        chained_scan_impl(in_, out_, numElements, identity_load<iType>(),
+                          static_cast<iType>(init), binary_op, inclusive,
+                          isChainedScanType<iType>());
+        return;
+    }
     const unsigned int kernel0_WgSize = SCAN_WAVESIZE*SCAN_KERNELWAVES;
     const unsigned int kernel1_WgSize = SCAN_WAVESIZE*SCAN_KERNELWAVES ;
     const unsigned int kernel2_WgSize = SCAN_WAVESIZE*SCAN_KERNELWAVES;
@@ -58,7 +261,8 @@ void scan_impl(
         sizeScanBuff += (kernel0_WgSize);
     }
 
-    hc::array_view<iType> preSumArray((hc::extent<1>(sizeScanBuff)));
+    scratch_buffer<iType> preSumBuffer(sizeScanBuff);
+    hc::array_view<iType> preSumArray = preSumBuffer.view();
 
     /**********************************************************************************
      *  Kernel 0
@@ -71,8 +275,7 @@ void scan_impl(
 	unsigned int	   tempBuffsize = (sizeInputBuff); 
 	unsigned int	   iteration = (tempBuffsize-1)/max_ext; 
 
-    auto f_ = utils::get_pointer(first);
-    hc::array_view<iType> first_(hc::extent<1>(numElements), f_);
+    auto first_ = utils::make_view<iType>(first, numElements);
     for(unsigned int i=0; i<=iteration; i++)
 	{
 	    unsigned int extent_sz =  (tempBuffsize > max_ext) ? max_ext : tempBuffsize; 
@@ -225,8 +428,7 @@ void scan_impl(
      *********************************************************************************/
 	tempBuffsize = (sizeInputBuff); 
 	iteration = (tempBuffsize-1)/max_ext; 
-    auto re_ = utils::get_pointer(result);
-    hc::array_view<oType> re(hc::extent<1>(numElements), re_);
+    hc::array_view<oType> re = utils::make_view<oType>(result, numElements);
     re.discard_data();
 
     for(unsigned int a=0; a<=iteration ; a++)
@@ -0,0 +1,220 @@
+#pragma once
+
+// bytes of free scratch memory kept for the parallel algorithms on each
+// accelerator, environment variable HCC_PSTL_SCRATCH_LIMIT overrides it, in MB
+// default set as 64MB
+#define SCRATCH_LIMIT (64 * 1024 * 1024)
+// size of the smallest block of scratch memory, blocks are powers of 2
+#define SCRATCH_MIN_BLOCK 4096
+
+namespace details {
+
+/**
+ * Scratch memory of the parallel algorithms on an accelerator: the
+ * temporary device buffers of an algorithm are blocks drawn from the pool
+ * and given back once it's done, and kept free for the next algorithms
+ * instead of being allocated and freed by each call. Blocks are rounded up
+ * to powers of 2, at most SCRATCH_LIMIT bytes are kept free, and the blocks
+ * over the limit are freed to the device allocator, or its memory cache when
+ * HCC_HSA_MEMORY_CACHE is on.
+ */
+class scratch_pool {
+public:
+  typedef hc::array<uint32_t, 1> block_type;
+
+  // pool of an accelerator, which lives as long as the program
+  static scratch_pool& get(const hc::accelerator& acc = hc::accelerator()) {
+    static std::mutex lock;
+    // never destroyed, as the runtime may be gone at exit
+    static std::map<std::wstring, scratch_pool*>* pools =
+      new std::map<std::wstring, scratch_pool*>();
+    std::lock_guard<std::mutex> l(lock);
+    scratch_pool*& pool = (*pools)[acc.get_device_path()];
+    if (pool == nullptr)
+      pool = new scratch_pool(acc);
+    return *pool;
+  }
+
+  // a block of at least bytes
+  std::shared_ptr<block_type> acquire(size_t bytes) {
+    size_t size = block_size(bytes);
+    {
+      std::lock_guard<std::mutex> l(lock);
+      auto it = blocks.find(size);
+      if (it != blocks.end() && !it->second.empty()) {
+        std::shared_ptr<block_type> block = it->second.back();
+        it->second.pop_back();
+        cached -= size;
+        return block;
+      }
+    }
+    return std::make_shared<block_type>(hc::extent<1>(static_cast<int>(size / sizeof(uint32_t))),
+                                        acc.get_default_view());
+  }
+
+  // give back a block to the pool, or free it when the pool is full
+  void release(const std::shared_ptr<block_type>& block) {
+    size_t size = block->get_extent().size() * sizeof(uint32_t);
+    std::lock_guard<std::mutex> l(lock);
+    if (cached + size > limit)
+      return;
+    blocks[size].push_back(block);
+    cached += size;
+  }
+
+  // allocate free blocks ahead of the algorithms, so bytes of scratch memory
+  // are there at once, returns the number of bytes kept free
+  size_t reserve(size_t bytes) {
+    size_t size = block_size(bytes);
+    std::lock_guard<std::mutex> l(lock);
+    if (limit < size)
+      limit = size;
+    if (blocks[size].empty() && cached + size <= limit) {
+      blocks[size].push_back(std::make_shared<block_type>(
+        hc::extent<1>(static_cast<int>(size / sizeof(uint32_t))), acc.get_default_view()));
+      cached += size;
+    }
+    return cached;
+  }
+
+  // free the blocks kept, returns the number of bytes freed
+  size_t trim() {
+    std::lock_guard<std::mutex> l(lock);
+    size_t freed = cached;
+    blocks.clear();
+    cached = 0;
+    return freed;
+  }
+
+  // bound the free memory kept, freeing the blocks over it
+  void set_limit(size_t bytes) {
+    std::lock_guard<std::mutex> l(lock);
+    limit = bytes;
+    for (auto it = blocks.rbegin(); it != blocks.rend() && cached > limit; ++it) {
+      while (!it->second.empty() && cached > limit) {
+        it->second.pop_back();
+        cached -= it->first;
+      }
+    }
+  }
+
+  size_t size() {
+    std::lock_guard<std::mutex> l(lock);
+    return cached;
+  }
+
+private:
+  hc::accelerator acc;
+  std::mutex lock;
+  // free blocks of each size
+  std::map<size_t, std::vector<std::shared_ptr<block_type>>> blocks;
+  size_t cached;
+  size_t limit;
+
+  explicit scratch_pool(const hc::accelerator& acc)
+    : acc(acc), cached(0), limit(SCRATCH_LIMIT) {
+    const char* limit_env = getenv("HCC_PSTL_SCRATCH_LIMIT");
+    if (limit_env != nullptr) {
+      int mb = atoi(limit_env);
+      if (mb >= 0)
+        limit = static_cast<size_t>(mb) * 1024 * 1024;
+    }
+  }
+
+  static size_t block_size(size_t bytes) {
+    size_t size = SCRATCH_MIN_BLOCK;
+    while (size < bytes)
+      size *= 2;
+    return size;
+  }
+};
+
+// types whose scratch buffers are views of blocks of the pool
+template<typename T>
+using isScratchType =
+    std::integral_constant<bool, std::is_trivially_copyable<T>::value &&
+                                 sizeof(T) % sizeof(uint32_t) == 0 &&
+                                 SCRATCH_MIN_BLOCK % sizeof(T) == 0>;
+
+/**
+ * Temporary device buffer of N elements of an algorithm, a view of a block
+ * of the scratch pool of the default accelerator, which it gives back when
+ * it's destroyed. Kernels using it have to be done by then. Other types
+ * have buffers of their own.
+ */
+template<typename T, bool Pooled = isScratchType<T>::value>
+class scratch_buffer {
+public:
+  explicit scratch_buffer(int N)
+    : block(scratch_pool::get().acquire(N * sizeof(T))),
+      view_(block->reinterpret_as<T>().section(0, N)) {}
+  ~scratch_buffer() { scratch_pool::get().release(block); }
+
+  const hc::array_view<T>& view() const { return view_; }
+
+private:
+  std::shared_ptr<scratch_pool::block_type> block;
+  hc::array_view<T> view_;
+
+  scratch_buffer(const scratch_buffer&) = delete;
+  scratch_buffer& operator=(const scratch_buffer&) = delete;
+};
+
+template<typename T>
+class scratch_buffer<T, false> {
+public:
+  explicit scratch_buffer(int N) : view_((hc::extent<1>(N))) {}
+
+  const hc::array_view<T>& view() const { return view_; }
+
+private:
+  hc::array_view<T> view_;
+};
+
+} // namespace details
+
+/**
+ * Scratch memory of the parallel algorithms: their temporary device buffers
+ * are drawn from a pool of device memory on each accelerator, and kept in it
+ * for the next algorithms. The free memory it keeps is bounded, by 64MB
+ * unless the environment variable HCC_PSTL_SCRATCH_LIMIT gives another bound
+ * in MB.
+ * @{
+ */
+
+/**
+ * Allocates scratch memory of at least bytes on an accelerator ahead of the
+ * algorithms, raising the bound of the free memory kept to it if needed.
+ *
+ * @return The number of bytes of free scratch memory kept.
+ */
+inline size_t reserve_scratch(size_t bytes,
+                              const hc::accelerator& acc = hc::accelerator()) {
+  return details::scratch_pool::get(acc).reserve(bytes);
+}
+
+/**
+ * Bounds the free scratch memory kept on an accelerator, in bytes, the
+ * memory over it is freed.
+ */
+inline void set_scratch_limit(size_t bytes,
+                              const hc::accelerator& acc = hc::accelerator()) {
+  details::scratch_pool::get(acc).set_limit(bytes);
+}
+
+/**
+ * Frees the free scratch memory kept on an accelerator.
+ *
+ * @return The number of bytes freed.
+ */
+inline size_t trim_scratch(const hc::accelerator& acc = hc::accelerator()) {
+  return details::scratch_pool::get(acc).trim();
+}
+
+/**
+ * @return The number of bytes of free scratch memory kept on an accelerator.
+ */
+inline size_t get_scratch_size(const hc::accelerator& acc = hc::accelerator()) {
+  return details::scratch_pool::get(acc).size();
+}
+/**@}*/
@@ -312,8 +312,10 @@ void sort_enqueue_int_uint(InputIt &first, InputIt &last, Compare comp, bool int
     }
 	unsigned int numGroups = (szElements/localSize)>= 32?(32*8):(szElements/localSize);
 
-    hc::array_view<Values> dvSwapInputValues((hc::extent<1>(orig_szElements)));
-    hc::array_view<int> dvHistogramBins(hc::extent<1>(numGroups * RADICES));
+    scratch_buffer<Values> swapBuffer(orig_szElements);
+    scratch_buffer<int> histogramBuffer(numGroups * RADICES);
+    hc::array_view<Values> dvSwapInputValues = swapBuffer.view();
+    hc::array_view<int> dvHistogramBins = histogramBuffer.view();
 
 	bool Asc_sort = 0;
 	if(comp(2,3))
@@ -882,11 +884,57 @@ void sort_impl(InputIt first, InputIt last, Compare comp,
       return;
 
   // call to std::sort when small data size
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("sort", typeid(typename std::iterator_traits<InputIt>::value_type), N);
+  if (backend.host()) {
       std::sort(first, last, comp);
+      return;
+  }
+  typedef typename std::iterator_traits<InputIt>::value_type T;
+  if (isRadixSortable<T, Compare>::value && N <= RADIX_SORT_COUNT_MASK) {
+      radix_sort_keys(first, N, comp, isRadixSortable<T, Compare>());
+      return;
   }
   sort_dispatch(first, last, comp);
 }
 
+// sort_by_key on the host, equal keys keep the order of their values
+template<class KeyIt, class ValueIt, class Compare>
+void sort_by_key_impl(KeyIt keys_first, KeyIt keys_last, ValueIt values_first,
+                      Compare comp, std::input_iterator_tag) {
+  typedef typename std::iterator_traits<KeyIt>::value_type K;
+  typedef typename std::iterator_traits<ValueIt>::value_type V;
+  std::vector<std::pair<K, V>> pairs;
+  ValueIt v = values_first;
+  for (KeyIt k = keys_first; k != keys_last; ++k, ++v)
+      pairs.emplace_back(*k, *v);
+  std::stable_sort(std::begin(pairs), std::end(pairs),
+                   [&comp](const std::pair<K, V>& a, const std::pair<K, V>& b) {
+                     return comp(a.first, b.first);
+                   });
+  v = values_first;
+  KeyIt k = keys_first;
+  for (auto& p : pairs) {
+      *k++ = p.first;
+      *v++ = p.second;
+  }
+}
+
+template<class KeyIt, class ValueIt, class Compare>
+void sort_by_key_impl(KeyIt keys_first, KeyIt keys_last, ValueIt values_first,
+                      Compare comp, std::random_access_iterator_tag) {
+  unsigned N = std::distance(keys_first, keys_last);
+  if (N == 0)
+      return;
+
+  // the radix sort only handles some keys and comparisons
+  typedef typename std::iterator_traits<KeyIt>::value_type K;
+  details::backend_choice backend("sort_by_key", typeid(K), N);
+  if (backend.host() || !isRadixSortable<K, Compare>::value ||
+      N > RADIX_SORT_COUNT_MASK) {
+      sort_by_key_impl(keys_first, keys_last, values_first, comp, std::input_iterator_tag{});
+      return;
+  }
+  radix_sort_pairs(keys_first, values_first, N, comp, isRadixSortable<K, Compare>());
+}
 
 } // namespace details
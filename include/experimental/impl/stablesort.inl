@@ -203,105 +203,26 @@ stablesort_dispatch(const InputIt& first, const InputIt& last, const Compare& co
 
 		tempBuffsize = tempBuffsize - max_ext;
 	}
-    unsigned int numMerges = 0;
-
-    unsigned int log2BlockSize = vecSize >> 9;
-    for( ; log2BlockSize > 1; log2BlockSize >>= 1 )
-    {
-        ++numMerges;
-    }
-
-    unsigned int vecPow2 = (vecSize & (vecSize-1));
-    numMerges += vecPow2? 1: 0;
-
-    std::vector<iType> tmp(vecSize);
-    hc::array_view<iType> tmpBuffer(hc::extent<1>(vecSize), tmp);
-    tmpBuffer.discard_data();
-
-
-    hc::extent< 1 > globalSizeK1( globalRange );
-    for( unsigned int pass = 1; pass <= numMerges; ++pass )
-    {
-
-        //  For each pass, the merge window doubles
-        int srcLogicalBlockSize = static_cast< int >( localRange << (pass-1) );
-
-        kernel_launch( globalRange,
-        [
-            first_,
-            tmpBuffer,
-            vecSize,
-            comp,
-            localRange,
-            srcLogicalBlockSize,
-			pass
-        ] ( hc::index<1> idx ) [[hc]]
-   {
-
-    int gloID = idx[ 0 ];
-
-    if( gloID >= vecSize )
-        return;
-
-    unsigned int srcBlockNum = gloID / srcLogicalBlockSize;
-    unsigned int srcBlockIndex = gloID % srcLogicalBlockSize;
-    
-    unsigned int dstLogicalBlockSize = srcLogicalBlockSize<<1;
-    int leftBlockIndex = gloID & ~(dstLogicalBlockSize - 1 );
-    leftBlockIndex += (srcBlockNum & 0x1) ? 0 : srcLogicalBlockSize;
-    leftBlockIndex = _min( leftBlockIndex, vecSize );
-    int rightBlockIndex = _min( leftBlockIndex + srcLogicalBlockSize, vecSize );
-    
-    unsigned int insertionIndex = 0;
-
-	if( pass & 0x1 )
-	{
-      if( (srcBlockNum & 0x1) == 0 )
-      {
-        insertionIndex = sort_lowerBoundBinary( first_, leftBlockIndex, rightBlockIndex, first_[ gloID ], comp ) - leftBlockIndex;
-      }
-      else
-      {
-        insertionIndex = sort_upperBoundBinary( first_, leftBlockIndex, rightBlockIndex, first_[ gloID ], comp ) - leftBlockIndex;
-      }
-    
-      //  The index of an element in the result sequence is the summation of it's indixes in the two input 
-      //  sequences
-      unsigned int dstBlockIndex = srcBlockIndex + insertionIndex;
-      unsigned int dstBlockNum = srcBlockNum/2;
-    
-      tmpBuffer[ (dstBlockNum*dstLogicalBlockSize)+dstBlockIndex ] = first_[ gloID ];
-	}
-
-	else
-	{
-    
-	  if( (srcBlockNum & 0x1) == 0 )
-      {
-        insertionIndex = sort_lowerBoundBinary( tmpBuffer, leftBlockIndex, rightBlockIndex, tmpBuffer[ gloID ], comp ) - leftBlockIndex;
-      }
-      else
-      {
-        insertionIndex = sort_upperBoundBinary( tmpBuffer, leftBlockIndex, rightBlockIndex, tmpBuffer[ gloID ], comp ) - leftBlockIndex;
-      }
-    
-      //  The index of an element in the result sequence is the summation of it's indixes in the two input 
-      //  sequences
-      unsigned int dstBlockIndex = srcBlockIndex + insertionIndex;
-      unsigned int dstBlockNum = srcBlockNum/2;
-    
-      first_[ (dstBlockNum*dstLogicalBlockSize)+dstBlockIndex ] = tmpBuffer[ gloID ];
-
-	}
-
-    } );
-
+    // merge the sorted blocks, in runs doubling in width each pass
+    static_assert(STABLESORT_BUFFER_SIZE % MERGE_TILE == 0,
+                  "runs are merged by whole tiles");
+    scratch_buffer<iType> tmp(vecSize);
+    hc::array_view<iType> tmpBuffer = tmp.view();
+    bool inTmp = false;
+    for (int width = STABLESORT_BUFFER_SIZE; width < vecSize; width *= 2) {
+        if (inTmp) {
+            merge_kernel(tmpBuffer, vecSize, tmpBuffer, vecSize, first_, width, comp);
+        } else {
+            merge_kernel(first_, vecSize, first_, vecSize, tmpBuffer, width, comp);
+        }
+        inTmp = !inTmp;
     }
-    if( numMerges & 1 )
-    {
-       tmpBuffer.synchronize();
-       std::copy(std::begin(tmp), std::end(tmp), first);
+    if (inTmp) {
+        kernel_launch(vecSize, [first_, tmpBuffer](hc::index<1> idx) [[hc]] {
+            first_[idx] = tmpBuffer[idx];
+        });
     }
+    tmpBuffer.discard_data();
 
     return;
 }
@@ -321,8 +242,18 @@ void stablesort_impl(InputIt first, InputIt last, Compare comp,
       return;
 
   // call to std::sort when small data size
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("stable_sort", typeid(typename std::iterator_traits<InputIt>::value_type), N);
+  if (backend.host()) {
       std::stable_sort(first, last, comp);
+      return;
+  }
+  // the radix sort is stable, but orders -0.0 before 0.0
+  typedef typename std::iterator_traits<InputIt>::value_type T;
+  typedef std::integral_constant<bool, isRadixSortable<T, Compare>::value &&
+                                       std::is_integral<T>::value> isStableRadix;
+  if (isStableRadix::value && N <= RADIX_SORT_COUNT_MASK) {
+      radix_sort_keys(first, N, comp, isStableRadix());
+      return;
   }
   stablesort_dispatch(first, last, comp);
 }
@@ -0,0 +1,186 @@
+#pragma once
+
+namespace details {
+
+/**
+ * Calibrated thresholds of switching back to the STL implementation.
+ *
+ * Each algorithm and element type has a threshold of its own on each
+ * accelerator, including the CPU path: inputs of at most that many elements
+ * run on the host. Thresholds are read from a file, which is
+ * $HCC_PSTL_THRESHOLDS, or pstl_thresholds in $XDG_CACHE_HOME/hcc or
+ * $HOME/.cache/hcc, and are PARALLELIZE_THRESHOLD if it has none.
+ *
+ * With HCC_PSTL_CALIBRATE=1 calls are timed instead: the inputs of each
+ * algorithm and type are grouped by their size rounded down to a power of 2,
+ * and each group runs on both sides a few times, then on the faster one.
+ * The crossover points found are written to the file at exit, for later runs.
+ * Calls with par_async aren't timed, and use the thresholds of the file.
+ */
+class threshold_table {
+public:
+  // timed calls of each side a size group runs before the faster one is used
+  static const int CALIBRATION_SAMPLES = 3;
+
+  static threshold_table& get() {
+    static threshold_table table;
+    return table;
+  }
+
+  bool calibrating() const { return calibrate; }
+
+  // whether an input of N elements runs on the host, calls which are timed
+  // pick the side to calibrate when calibrating
+  bool host(const std::string& key, size_t N, bool timed) {
+    std::lock_guard<std::mutex> l(lock);
+    if (!timed) {
+      auto it = thresholds.find(key);
+      return N <= (it != thresholds.end() ? it->second : PARALLELIZE_THRESHOLD);
+    }
+    group& g = samples[key][bucket(N)];
+    if (g.count[0] < CALIBRATION_SAMPLES)
+      return true;
+    if (g.count[1] < CALIBRATION_SAMPLES)
+      return false;
+    return g.rate(0) <= g.rate(1);
+  }
+
+  // record a call of N elements, which took ns nanoseconds on a side
+  void record(const std::string& key, size_t N, bool onHost, double ns) {
+    std::lock_guard<std::mutex> l(lock);
+    group& g = samples[key][bucket(N)];
+    g.count[onHost ? 0 : 1]++;
+    g.time[onHost ? 0 : 1] += ns / N;
+  }
+
+  // key of an algorithm and element type on the default accelerator
+  std::string key(const char* algorithm, const std::type_info& type) const {
+    return accelerator + "\t" + algorithm + "\t" + type.name();
+  }
+
+  ~threshold_table() {
+    if (calibrate)
+      save();
+  }
+
+private:
+  // calls of a size group, on the host and on the accelerator
+  struct group {
+    int count[2];
+    double time[2];
+    group() : count{0, 0}, time{0.0, 0.0} {}
+    double rate(int side) const { return time[side] / count[side]; }
+  };
+
+  std::mutex lock;
+  std::map<std::string, size_t> thresholds;
+  std::map<std::string, std::map<int, group>> samples;
+  std::string accelerator;
+  std::string file;
+  bool calibrate;
+
+  threshold_table() : calibrate(false) {
+    std::wstring path = hc::accelerator().get_device_path();
+    accelerator.assign(path.begin(), path.end());
+
+    const char* file_env = getenv("HCC_PSTL_THRESHOLDS");
+    const char* xdg_env = getenv("XDG_CACHE_HOME");
+    const char* home_env = getenv("HOME");
+    if (file_env != nullptr && file_env[0] != '\0')
+      file = file_env;
+    else if (xdg_env != nullptr && xdg_env[0] != '\0')
+      file = std::string(xdg_env) + "/hcc/pstl_thresholds";
+    else if (home_env != nullptr && home_env[0] != '\0')
+      file = std::string(home_env) + "/.cache/hcc/pstl_thresholds";
+
+    const char* calibrate_env = getenv("HCC_PSTL_CALIBRATE");
+    calibrate = (calibrate_env != nullptr) && (atoi(calibrate_env) != 0);
+
+    load();
+  }
+
+  static int bucket(size_t N) {
+    int b = 0;
+    while (N >>= 1)
+      ++b;
+    return b;
+  }
+
+  // lines of the file are the key of a threshold and the threshold
+  void load() {
+    std::ifstream in(file);
+    std::string line;
+    while (std::getline(in, line)) {
+      size_t pos = line.rfind('\t');
+      if (pos == std::string::npos)
+        continue;
+      thresholds[line.substr(0, pos)] = strtoull(line.c_str() + pos + 1, nullptr, 10);
+    }
+  }
+
+  // the threshold of a key is below the smallest size group from which on
+  // the accelerator is faster in all the groups timed
+  void save() {
+    for (auto& s : samples) {
+      size_t threshold = PARALLELIZE_THRESHOLD;
+      bool timed = false;
+      for (auto it = s.second.rbegin(); it != s.second.rend(); ++it) {
+        const group& g = it->second;
+        if (g.count[0] == 0 || g.count[1] == 0)
+          continue;
+        timed = true;
+        if (g.rate(0) <= g.rate(1)) {
+          threshold = (size_t(2) << it->first) - 1;
+          break;
+        }
+        threshold = (size_t(1) << it->first) - 1;
+      }
+      if (timed)
+        thresholds[s.first] = threshold;
+    }
+    if (file.empty())
+      return;
+    // create the directories of the file
+    for (size_t pos = file.find('/', 1); pos != std::string::npos; pos = file.find('/', pos + 1))
+      mkdir(file.substr(0, pos).c_str(), 0755);
+    std::ofstream out(file, std::ios::trunc);
+    for (auto& t : thresholds)
+      out << t.first << "\t" << t.second << "\n";
+  }
+};
+
+/**
+ * The side an algorithm of N elements of a type runs on, timed while it's
+ * in scope when calibrating.
+ */
+class backend_choice {
+public:
+  backend_choice(const char* algorithm, const std::type_info& type, size_t N,
+                 bool measure = true)
+    : table(threshold_table::get()), key(table.key(algorithm, type)), N(N),
+      timed(measure && table.calibrating() && N > 0),
+      onHost(table.host(key, N, timed)), start(std::chrono::steady_clock::now()) {}
+
+  backend_choice(const backend_choice&) = delete;
+  backend_choice& operator=(const backend_choice&) = delete;
+
+  ~backend_choice() {
+    if (timed) {
+      std::chrono::duration<double, std::nano> elapsed =
+        std::chrono::steady_clock::now() - start;
+      table.record(key, N, onHost, elapsed.count());
+    }
+  }
+
+  bool host() const { return onHost; }
+
+private:
+  threshold_table& table;
+  std::string key;
+  size_t N;
+  bool timed;
+  bool onHost;
+  std::chrono::steady_clock::time_point start;
+};
+
+} // namespace details
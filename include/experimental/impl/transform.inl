@@ -36,22 +36,24 @@ OutputIterator transform_impl(RandomAccessIterator first,
                               UnaryOperation unary_op,
                               std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("transform", typeid(typename std::iterator_traits<RandomAccessIterator>::value_type), N);
+  if (backend.host()) {
     return transform_impl(first, last, d_first, unary_op,
              std::input_iterator_tag{});
   }
 
   using _Ti = typename std::iterator_traits<RandomAccessIterator>::value_type;
   using _To = typename std::iterator_traits<RandomAccessIterator>::value_type;
-  auto f_ = utils::get_pointer(first);
-  auto d_ = utils::get_pointer(d_first);
-  hc::array_view<_Ti> first_(hc::extent<1>(N), f_);
-  hc::array_view<_To> d_first_(hc::extent<1>(N), d_);
+  auto first_ = utils::make_view<_Ti>(first, N);
+  hc::array_view<_To> d_first_ = utils::make_view<_To>(d_first, N);
   d_first_.discard_data();
 
+  // views of device_iterators outlive the kernel, which then isn't waited for
+  const bool onDevice = utils::isDeviceIt<RandomAccessIterator>::value &&
+                        utils::isDeviceIt<OutputIterator>::value;
   kernel_launch(N, [d_first_, first_, unary_op](hc::index<1> idx) [[hc]] {
     d_first_[idx[0]] = unary_op(first_[idx[0]]);
-  });
+  }, 0, !onDevice);
 
   return d_first + N;
 }
@@ -66,26 +68,97 @@ OutputIterator transform_impl(RandomAccessIterator first1,
                               BinaryOperation binary_op,
                               std::random_access_iterator_tag) {
   const size_t N = static_cast<size_t>(std::distance(first1, last1));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("transform", typeid(typename std::iterator_traits<RandomAccessIterator>::value_type), N);
+  if (backend.host()) {
     return transform_impl(first1, last1, first2, d_first, binary_op,
              std::input_iterator_tag{});
   }
 
   using _Ti = typename std::iterator_traits<RandomAccessIterator>::value_type;
   using _To = typename std::iterator_traits<RandomAccessIterator>::value_type;
-  auto f1 = utils::get_pointer(first1);
-  auto f2 = utils::get_pointer(first2);
-  auto d_ = utils::get_pointer(d_first);
-  hc::array_view<_Ti> first1_(hc::extent<1>(N), f1);
-  hc::array_view<_Ti> first2_(hc::extent<1>(N), f2);
-  hc::array_view<_To> d_first_(hc::extent<1>(N), d_);
+  auto first1_ = utils::make_view<_Ti>(first1, N);
+  auto first2_ = utils::make_view<_Ti>(first2, N);
+  hc::array_view<_To> d_first_ = utils::make_view<_To>(d_first, N);
   d_first_.discard_data();
 
+  const bool onDevice = utils::isDeviceIt<RandomAccessIterator>::value &&
+                        utils::isDeviceIt<OutputIterator>::value;
   kernel_launch(N, [d_first_, first1_, first2_, binary_op](hc::index<1> idx) [[hc]] {
     d_first_[idx[0]] = binary_op(first1_[idx[0]], first2_[idx[0]]);
-  });
+  }, 0, !onDevice);
 
   return d_first + N;
 }
 
+// parallel::transform with par_async
+// transform (unary version)
+template <class InputIterator, class OutputIterator,
+          class UnaryOperation>
+hc::completion_future transform_async_impl(InputIterator first,
+                                           InputIterator last,
+                                           OutputIterator d_first,
+                                           UnaryOperation unary_op) {
+  const size_t N = static_cast<size_t>(std::distance(first, last));
+  // kernels run asynchronously are not timed
+  details::backend_choice backend("transform", typeid(typename std::iterator_traits<InputIterator>::value_type), N, false);
+  if (!utils::isRandomAccessIt<InputIterator>::value ||
+      backend.host()) {
+    transform_impl(first, last, d_first, unary_op, std::input_iterator_tag{});
+    return async_ready();
+  }
+
+  using _Ti = typename std::iterator_traits<InputIterator>::value_type;
+  using _To = typename std::iterator_traits<InputIterator>::value_type;
+  auto first_ = utils::make_view<_Ti>(first, N);
+  hc::array_view<_To> d_first_ = utils::make_view<_To>(d_first, N);
+  d_first_.discard_data();
+
+  auto kernel = kernel_launch(N, [d_first_, first_, unary_op](hc::index<1> idx) [[hc]] {
+    d_first_[idx[0]] = unary_op(first_[idx[0]]);
+  }, 0, false);
+
+  // the views of device_iterators are kept by their owner
+  if (utils::isDeviceIt<InputIterator>::value &&
+      utils::isDeviceIt<OutputIterator>::value) {
+    return kernel;
+  }
+  return async_result(kernel, [first_, d_first_] { d_first_.synchronize(); });
+}
+
+// transform (binary version)
+template <class InputIterator, class OutputIterator,
+          class BinaryOperation>
+hc::completion_future transform_async_impl(InputIterator first1,
+                                           InputIterator last1,
+                                           InputIterator first2,
+                                           OutputIterator d_first,
+                                           BinaryOperation binary_op) {
+  const size_t N = static_cast<size_t>(std::distance(first1, last1));
+  // kernels run asynchronously are not timed
+  details::backend_choice backend("transform", typeid(typename std::iterator_traits<InputIterator>::value_type), N, false);
+  if (!utils::isRandomAccessIt<InputIterator>::value ||
+      backend.host()) {
+    transform_impl(first1, last1, first2, d_first, binary_op,
+                   std::input_iterator_tag{});
+    return async_ready();
+  }
+
+  using _Ti = typename std::iterator_traits<InputIterator>::value_type;
+  using _To = typename std::iterator_traits<InputIterator>::value_type;
+  auto first1_ = utils::make_view<_Ti>(first1, N);
+  auto first2_ = utils::make_view<_Ti>(first2, N);
+  hc::array_view<_To> d_first_ = utils::make_view<_To>(d_first, N);
+  d_first_.discard_data();
+
+  auto kernel = kernel_launch(N, [d_first_, first1_, first2_, binary_op](hc::index<1> idx) [[hc]] {
+    d_first_[idx[0]] = binary_op(first1_[idx[0]], first2_[idx[0]]);
+  }, 0, false);
+
+  if (utils::isDeviceIt<InputIterator>::value &&
+      utils::isDeviceIt<OutputIterator>::value) {
+    return kernel;
+  }
+  return async_result(kernel, [first1_, first2_, d_first_] { d_first_.synchronize(); });
+}
+
 } // namespace details
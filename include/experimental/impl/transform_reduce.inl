@@ -34,13 +34,25 @@ T transform_reduce(InputIterator first, InputIterator last,
                    T init, BinaryOperation binary_op) {
   typedef typename std::iterator_traits<InputIterator>::value_type _Tp;
   const size_t N = static_cast<size_t>(std::distance(first, last));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("transform_reduce", typeid(typename std::iterator_traits<InputIterator>::value_type), N);
+  if (backend.host()) {
     auto new_op = [&](const T& a, const _Tp& b) {
       return binary_op(a, unary_op(b));
     };
     return std::accumulate(first, last, init, new_op);
   }
 
+  if (details::isWaveReduceType<T>::value) {
+    std::vector<uint64_t> p(details::reduce_wave_tiles(N) + 1, 0);
+    hc::array_view<uint64_t> partials(hc::extent<1>(p.size()), p);
+    hc::array_view<T> out((hc::extent<1>(1)));
+    auto in_ = utils::make_view<const _Tp>(first, N);
+    details::reduce_wave_kernel(in_, N, unary_op, init, binary_op, partials, out,
+                                true, details::isWaveReduceType<T>());
+    partials.discard_data();
+    return out[0];
+  }
+
   int max_ComputeUnits = 32;
   int numTiles = max_ComputeUnits*32;
   int length = (_T_REDUCE_WAVEFRONT_SIZE * numTiles);
@@ -51,9 +63,8 @@ T transform_reduce(InputIterator first, InputIterator last,
                                 (std::ceil( static_cast< float >( N ) / _T_REDUCE_WAVEFRONT_SIZE) ));
 
   std::unique_ptr<T[]> r(new T[numTiles]);
-  auto f_ = utils::get_pointer(first);
   hc::array_view<T> result(hc::extent<1>(numTiles), r.get());
-  hc::array_view<_Tp> first_(hc::extent<1>(N), f_);
+  auto first_ = utils::make_view<_Tp>(first, N);
   result.discard_data();
   auto transform_op = unary_op;
   details::kernel_launch(length, [first_, N, length, transform_op, result, binary_op] (hc::tiled_index<1> t_idx) [[hc]]
@@ -135,6 +146,38 @@ transform_reduce(ExecutionPolicy&& exec,
 /**@}*/
 
 
+namespace details {
+
+// inner_product forwarder
+template<typename InputIt1, typename InputIt2, typename T,
+         typename BinaryOperation1, typename BinaryOperation2>
+T inner_product_impl(InputIt1 first1, InputIt1 last1, InputIt2 first2, T value,
+                     BinaryOperation1 op1, BinaryOperation2 op2,
+                     std::input_iterator_tag) {
+  return std::inner_product(first1, last1, first2, value, op1, op2);
+}
+
+// parallel::inner_product, a transform_reduce of the pairs of elements, which
+// computes op2 of each pair as the reduce reads it, with no buffer between them
+template<typename InputIt1, typename InputIt2, typename T,
+         typename BinaryOperation1, typename BinaryOperation2>
+T inner_product_impl(InputIt1 first1, InputIt1 last1, InputIt2 first2, T value,
+                     BinaryOperation1 op1, BinaryOperation2 op2,
+                     std::random_access_iterator_tag) {
+  typedef typename std::iterator_traits<InputIt1>::value_type _Tp1;
+  typedef typename std::iterator_traits<InputIt2>::value_type _Tp2;
+  typedef typename std::result_of<BinaryOperation2(const _Tp1&, const _Tp2&)>::type _Tr;
+  auto product = [op2](const std::tuple<_Tp1, _Tp2>& t) -> _Tr {
+    return op2(std::get<0>(t), std::get<1>(t));
+  };
+  // zip_iterators are compared by their first iterators
+  return transform_reduce(make_zip_iterator(first1, first2),
+                          make_zip_iterator(last1, first2),
+                          product, value, op1);
+}
+
+} // namespace details
+
 // inner_product is basically a transform_reduce (two vectors version)
 // make an alias (perfect forwarding) for that
 template <typename... Args>
@@ -156,7 +199,7 @@ T inner_product(ExecutionPolicy&& exec,
               InputIt2 first2,
               T value) {
   typedef typename std::iterator_traits<InputIt1>::value_type _Tp;
-  return inner_product(first1, last1, first2, value,
+  return inner_product(exec, first1, last1, first2, value,
                        std::plus<_Tp>(), std::multiplies<_Tp>());
 }
 
@@ -173,16 +216,15 @@ T inner_product(ExecutionPolicy&& exec,
               BinaryOperation1 op1,
               BinaryOperation2 op2) {
   const size_t N = static_cast<size_t>(std::distance(first1, last1));
-  if (N <= details::PARALLELIZE_THRESHOLD) {
+  details::backend_choice backend("inner_product", typeid(typename std::iterator_traits<InputIt1>::value_type), N);
+  if (!utils::isParallel(exec) || backend.host()) {
     return std::inner_product(first1, last1, first2, value, op1, op2);
   }
 
-  /// OPTIMIZE: remove the unnecessary buffer on cpu
-  typedef typename std::iterator_traits<InputIt1>::value_type _Tp;
-  std::vector<_Tp> dist(N, _Tp());
-
-  // implement inner_product by transform & reduce
-  transform(exec, first1, last1, first2, std::begin(dist), op2);
-  return reduce(exec, std::begin(dist), std::end(dist), value, op1);
+  typedef typename std::conditional<utils::isRandomAccessIt<InputIt1>::value &&
+                                    utils::isRandomAccessIt<InputIt2>::value,
+                                    std::random_access_iterator_tag,
+                                    std::input_iterator_tag>::type category;
+  return details::inner_product_impl(first1, last1, first2, value, op1, op2, category());
 }
 /**@}*/
@@ -33,6 +33,20 @@ transform_scan_impl(
 	int exclusive = inclusive ? 0 : 1;
 
     int numElements = static_cast< int >( std::distance( first, last ) );
+
+    // scans of 4 byte types run in a single pass, see scan_impl
+    if (isChainedScanType<oType>::value)
+    {
+        auto in_ = utils::make_view<iType>(first, numElements);
+        hc::array_view<oType> out_ = utils::make_view<oType>(result, numElements);
+        if (!utils::isDeviceIt<OutputIterator>::value)
+            out_.discard_data();
+        chained_scan_impl(in_, out_, numElements, unary_op,
+                          static_cast<oType>(init_T), binary_op, inclusive,
+                          isChainedScanType<oType>());
+        return;
+    }
+
     const unsigned int kernel0_WgSize = TRANSFORMSCAN_WAVESIZE*TRANSFORMSCAN_KERNELWAVES;
     const unsigned int kernel1_WgSize = TRANSFORMSCAN_WAVESIZE*TRANSFORMSCAN_KERNELWAVES ;
     const unsigned int kernel2_WgSize = TRANSFORMSCAN_WAVESIZE*TRANSFORMSCAN_KERNELWAVES;
@@ -66,8 +80,7 @@ transform_scan_impl(
 	const unsigned int max_ext = (tile_limit*kernel0_WgSize);
 	unsigned int	   tempBuffsize = (sizeInputBuff/2); 
 	unsigned int	   iteration = (tempBuffsize-1)/max_ext; 
-    auto f_ = utils::get_pointer(first);
-    hc::array_view<iType> first_(hc::extent<1>(numElements), f_);
+    auto first_ = utils::make_view<iType>(first, numElements);
  
 
     for(unsigned int i=0; i<=iteration; i++)
@@ -235,8 +248,7 @@ transform_scan_impl(
 	tempBuffsize = (sizeInputBuff); 
 	iteration = (tempBuffsize-1)/max_ext; 
 
-    auto r_ = utils::get_pointer(result);
-    hc::array_view<oType> re(hc::extent<1>(numElements), r_);
+    hc::array_view<oType> re = utils::make_view<oType>(result, numElements);
     re.discard_data();
     for(unsigned int a=0; a<=iteration ; a++)
 	{
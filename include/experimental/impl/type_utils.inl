@@ -23,16 +23,39 @@ template<class ExecutionPolicy>
 using isExecutionPolicy =
         is_execution_policy<typename std::decay<ExecutionPolicy>::type>;
 
+template<class ExecutionPolicy>
+using isAsyncPolicy =
+        std::is_same<typename std::decay<ExecutionPolicy>::type,
+                     parallel_async_execution_policy>;
+
+// execution policies of algorithms which wait for their kernels
+template<class ExecutionPolicy>
+using isSyncPolicy =
+        std::integral_constant<bool, isExecutionPolicy<ExecutionPolicy>::value &&
+                                     !isAsyncPolicy<ExecutionPolicy>::value>;
+
 template<class ExecutionPolicy>
 inline bool isParallel(ExecutionPolicy &&exec) {
   typedef typename std::decay<decltype(exec)>::type Tp;
   if (std::is_base_of<parallel_execution_policy, Tp>::value ||
-      std::is_base_of<parallel_vector_execution_policy, Tp>::value) {
+      std::is_base_of<parallel_vector_execution_policy, Tp>::value ||
+      std::is_base_of<parallel_async_execution_policy, Tp>::value) {
     return true;
   }
   return false;
 }
 
+// the policy algorithms built on other algorithms pass to them, which run
+// with par under par_async as their results are used right away
+template<class ExecutionPolicy,
+         EnableIf<isSyncPolicy<ExecutionPolicy>> = nullptr>
+inline ExecutionPolicy&& syncPolicy(ExecutionPolicy &&exec) {
+  return std::forward<ExecutionPolicy>(exec);
+}
+
+inline const parallel_execution_policy&
+syncPolicy(const parallel_async_execution_policy&) { return par; }
+
 // get raw pointer from an iterator
 template<typename T>
 inline typename std::iterator_traits<T>::pointer
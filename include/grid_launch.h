@@ -20,6 +20,11 @@ typedef struct gl_dim3
   gl_dim3(uint32_t _x=1, uint32_t _y=1, uint32_t _z=1) : x(_x), y(_y), z(_z) {};
 } gl_dim3;
 
+// Barrier bit of the packet of a launch.
+// barrier_bit_queue_default: set as the execute order of the view requires.
+// barrier_bit_none: not set, the kernel may overlap the previous commands of
+//                   an in-order view, except the ones using the same buffers.
+// barrier_bit_wait: set, the kernel waits for the previous commands of the view.
 typedef enum gl_barrier_bit {
     barrier_bit_queue_default,
     barrier_bit_none,
@@ -42,7 +47,6 @@ typedef struct grid_launch_parm
 
   //! Control setting of barrier bit on per-packet basis:
   //! See gl_barrier_bit description.  
-  //! Placeholder, is not used to control packet dispatch yet
   enum gl_barrier_bit barrier_bit;
 
   //! Value of packet fences to apply to launch.
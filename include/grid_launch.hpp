@@ -3,6 +3,9 @@
 #include "grid_launch.h"
 #include "hc.hpp"
 
+#include <memory>
+#include <mutex>
+
 class grid_launch_parm_cxx : public grid_launch_parm
 {
 public:
@@ -31,6 +34,69 @@ public:
   }
 };
 
+// The launches of one hc_grid_launch function, kept by its generated wrapper
+// as a static object.
+//
+// The launch of the last accelerator_view and tiled extent the function was
+// launched with is captured as a launch_template, so a later launch of the
+// same shape only patches the kernel arguments in the prepared dispatch and
+// writes its AQL packet into the queue, without looking up the kernel or
+// laying out the dispatch again. A launch of another shape captures a new
+// template. Accelerators without launch templates go through
+// parallel_for_each.
+//
+// The barrier bit of the packet is chosen per launch by the barrier_bit of
+// grid_launch_parm, so independent kernels on an in-order view may overlap.
+class grid_launch_cache
+{
+public:
+  grid_launch_cache() = default;
+  grid_launch_cache(const grid_launch_cache&) = delete;
+  grid_launch_cache& operator=(const grid_launch_cache&) = delete;
+
+  template <typename Kernel>
+  hc::completion_future launch(const hc::accelerator_view& av,
+                               const hc::tiled_extent<3>& ext, const Kernel& f,
+                               gl_barrier_bit barrier = barrier_bit_queue_default) {
+    if (av.get_accelerator().get_device_path() == L"cpu")
+      return hc::parallel_for_each(av, ext, f);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tmpl.valid() && matches(av, ext)) {
+      tmpl.set_args(f);
+    } else {
+      tmpl = hc::create_launch_template(av, ext, f);
+      if (!tmpl.valid())
+        return hc::parallel_for_each(av, ext, f);
+      bound_av.reset(new hc::accelerator_view(av));
+      bound_ext = ext;
+    }
+    return tmpl.launch(barrier_mode(barrier));
+  }
+
+private:
+  static hc::hcBarrierMode barrier_mode(gl_barrier_bit barrier) {
+    switch (barrier) {
+      case barrier_bit_none: return hc::hcBarrierNone;
+      case barrier_bit_wait: return hc::hcBarrierWait;
+      default:               return hc::hcBarrierDefault;
+    }
+  }
+
+  bool matches(const hc::accelerator_view& av, const hc::tiled_extent<3>& ext) const {
+    return *bound_av == av && bound_ext == ext &&
+           bound_ext.tile_dim[0] == ext.tile_dim[0] &&
+           bound_ext.tile_dim[1] == ext.tile_dim[1] &&
+           bound_ext.tile_dim[2] == ext.tile_dim[2] &&
+           bound_ext.get_dynamic_group_segment_size() == ext.get_dynamic_group_segment_size();
+  }
+
+  std::mutex mutex;
+  hc::launch_template tmpl;
+  std::unique_ptr<hc::accelerator_view> bound_av;
+  hc::tiled_extent<3> bound_ext;
+};
+
 
 extern inline void grid_launch_init(grid_launch_parm *lp) {
   lp->grid_dim.x = lp->grid_dim.y = lp->grid_dim.z = 1;
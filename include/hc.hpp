@@ -45,10 +45,24 @@ using namespace Kalmar::CLAMP;
 class accelerator;
 class accelerator_view;
 class completion_future;
+class launch_template;
+struct device_kernel;
+struct device_queue;
+template <int N> class indirect_extent;
+class command_graph;
+class split_policy;
 template <int N> class extent;
 template <int N> class tiled_extent;
+template <typename T> class dynamic_tile_static;
 template <typename T, int N> class array_view;
 template <typename T, int N> class array;
+namespace short_vector {
+template <typename scalar_type, int size> struct short_vector;
+class half_2;
+}
+
+/// resources of a kernel on an accelerator, see accelerator_view::get_kernel_resources
+typedef Kalmar::KalmarKernelResources kernel_resources;
 
 // namespace alias
 // namespace hc::fast_math is an alias of namespace Kalmar::fast_math
@@ -92,6 +106,112 @@ inline uint64_t get_tick_frequency() {
     return Kalmar::getContext()->getSystemTickFrequency();
 }
 
+/**
+ * Get the number of completion signals which were served from the signal
+ * pool of the runtime, without creating a new signal.
+ *
+ * @return Number of signal pool hits. 0 if the runtime has no signal pool.
+ */
+inline uint64_t get_signal_pool_hits() {
+    return Kalmar::getContext()->getSignalPoolHits();
+}
+
+/**
+ * Get the number of times the signal pool of the runtime had to grow to
+ * serve a completion signal. Used to size the pool.
+ *
+ * @return Number of signal pool misses. 0 if the runtime has no signal pool.
+ */
+inline uint64_t get_signal_pool_misses() {
+    return Kalmar::getContext()->getSignalPoolMisses();
+}
+
+/**
+ * Get the number of waits on asynchronous operations which completed while
+ * the host thread was spinning on the completion signal.
+ *
+ * @return Number of waits completed while spinning.
+ */
+inline uint64_t get_wait_spin_count() {
+    return Kalmar::getContext()->getWaitSpinCount();
+}
+
+/**
+ * Get the number of hcWaitModeAdaptive waits on asynchronous operations which
+ * completed while the host thread was yielding.
+ *
+ * @return Number of waits completed while yielding.
+ */
+inline uint64_t get_wait_yield_count() {
+    return Kalmar::getContext()->getWaitYieldCount();
+}
+
+/**
+ * Get the number of waits on asynchronous operations which completed after
+ * the host thread blocked on the completion signal.
+ *
+ * @return Number of waits completed while blocked.
+ */
+inline uint64_t get_wait_block_count() {
+    return Kalmar::getContext()->getWaitBlockCount();
+}
+
+/**
+ * Get the number of threads the kernels run on the CPU accelerator are
+ * spread over. Bolt's btbb backend runs TBB on as many threads.
+ *
+ * The thread pool has HCC_CPU_THREADS threads, else as many as the
+ * OMP_NUM_THREADS and OMP_THREAD_LIMIT of OpenMP let it have, else one per
+ * core the process may run on. Its threads are pinned to cores if
+ * HCC_CPU_AFFINITY=1, or if OMP_PROC_BIND binds OpenMP threads. A kernel
+ * launched from a parallel region of OpenMP runs on the calling thread alone.
+ *
+ * @return The number of threads of the CPU kernels.
+ */
+inline unsigned int get_cpu_thread_count() {
+    return Kalmar::CLAMP::GetCPUThreadCount();
+}
+
+/**
+ * Limit the threads the kernels run on the CPU accelerator are spread over,
+ * for example to what's left by the other runtimes of the process.
+ *
+ * @param[in] count The number of threads, at most the threads of the thread
+ *                  pool, 0 for all of them.
+ */
+inline void set_cpu_thread_count(unsigned int count) {
+    Kalmar::CLAMP::SetCPUThreadCount(count);
+}
+
+/**
+ * Accounts the memory the arrays and array_views allocate on accelerators
+ * to a memory tag while it's in scope, in the calling thread. The memory
+ * held per accelerator and tag is given by hc_get_memory_stats() and
+ * hc_print_memory_stats() in hc_stats.h.
+ *
+ * @code
+ * {
+ *   hc::memory_tag tag("solver");
+ *   hc::array<float, 1> a(n);   // accounted to "solver"
+ * }
+ * @endcode
+ */
+class memory_tag {
+public:
+    /**
+     * @param[in] tag The tag, which must outlive the memory_tag.
+     */
+    explicit memory_tag(const char* tag) : previous(hc_set_memory_tag(tag)) {}
+
+    ~memory_tag() { hc_set_memory_tag(previous); }
+
+    memory_tag(const memory_tag&) = delete;
+    memory_tag& operator=(const memory_tag&) = delete;
+
+private:
+    const char* previous;
+};
+
 #define GET_SYMBOL_ADDRESS(acc, symbol) \
     acc.get_symbol_address( #symbol );
 
@@ -184,16 +304,46 @@ public:
     // FIXME: dummy implementation now
     bool get_is_debug() const { return 0; } 
 
+    /**
+     * Performs a blocking wait for completion of all commands submitted to the
+     * accelerator view prior to calling wait(), using the wait mode of the
+     * accelerator view.
+     */
+    void wait() { pQueue->wait(pQueue->get_wait_mode()); }
+
     /**
      * Performs a blocking wait for completion of all commands submitted to the
      * accelerator view prior to calling wait().
      *
-     * @param waitMode[in] An optional parameter to specify the wait mode. By
-     *                     default it would be hcWaitModeBlocked.
-     *                     hcWaitModeActive would be used to reduce latency with
-     *                     the expense of using one CPU core for active waiting.
+     * @param waitMode[in] The wait mode. hcWaitModeActive would be used to
+     *                     reduce latency with the expense of using one CPU
+     *                     core for active waiting. hcWaitModeAdaptive spins
+     *                     for a short while, then yields, then blocks.
+     */
+    void wait(hcWaitMode waitMode) { pQueue->wait(waitMode); }
+
+    /**
+     * Sets the wait mode used by waits on this accelerator view, and on the
+     * completion_future objects of commands submitted to it afterwards. By
+     * default it would be hcWaitModeBlocked.
+     */
+    void set_wait_mode(hcWaitMode waitMode) { pQueue->set_wait_mode(waitMode); }
+
+    /**
+     * Returns the wait mode of this accelerator view.
+     */
+    hcWaitMode get_wait_mode() const { return pQueue->get_wait_mode(); }
+
+    /**
+     * Returns a snapshot of the counters of the commands submitted to this
+     * accelerator view, which the runtime always keeps. See hc_stats.h for
+     * the counters, and hc_get_queue_stats() for a C API.
      */
-    void wait(hcWaitMode waitMode = hcWaitModeBlocked) { pQueue->wait(waitMode); }
+    hc_queue_stats get_stats() const {
+        hc_queue_stats stats;
+        pQueue->getStats(&stats);
+        return stats;
+    }
 
     /**
      * Sends the queued up commands in the accelerator_view to the device for
@@ -237,6 +387,117 @@ public:
      */
     completion_future create_marker();
 
+    /**
+     * This command inserts a marker event into the accelerator_view's command
+     * queue, which waits for the commands submitted prior to it and for the
+     * operations of @p dependencies, which may be on other accelerator_views
+     * and accelerators. The accelerator waits for them, with barrier-AND
+     * packets on their completion signals, so commands submitted after the
+     * marker are ordered after them without the host waiting. Dependencies
+     * without a completion signal, as the ones of the CPU path, are waited
+     * for on the host.
+     *
+     * @param[in] dependencies The futures the marker waits for.
+     * @return A future which is ready once the marker is done.
+     */
+    completion_future create_marker(const std::vector<completion_future>& dependencies);
+
+    /**
+     * Copies @p size_bytes bytes from @p src to @p dst asynchronously, in the
+     * order of this accelerator_view: the copy starts after the commands
+     * submitted so far have completed, and commands submitted afterwards
+     * start after the copy has completed.
+     *
+     * @p kind tells which of @p src and @p dst are host memory. Host memory
+     * not allocated by HSA is locked for the duration of the copy.
+     *
+     * If the accelerator_view can't copy asynchronously, it waits for the
+     * commands submitted so far and copies before returning, and the returned
+     * future is not valid.
+     *
+     * @return A future which is ready once the copy has completed.
+     */
+    completion_future copy_async(const void* src, void* dst, size_t size_bytes, hcMemcpyKind kind);
+
+    /**
+     * Copies @p count bytes between @p hostptr and the global variable of
+     * the kernels at @p symbolAddr asynchronously, in the order of this
+     * accelerator_view as copy_async() does, so variables updated between
+     * launches need no synchronization with the host.
+     *
+     * As with accelerator::memcpy_symbol(), @p offset is added to @p hostptr
+     * when copying to the variable, and to the variable when copying from it.
+     *
+     * @return A future which is ready once the copy has completed.
+     */
+    completion_future memcpy_symbol_async(void* symbolAddr, void* hostptr, size_t count, size_t offset = 0, hcMemcpyKind kind = hcMemcpyHostToDevice);
+
+    /**
+     * Copies @p count bytes between @p hostptr and the global variable of
+     * the kernels named @p symbolName asynchronously, as the above does.
+     * The address of the variable is looked up once and kept by the
+     * accelerator.
+     *
+     * @return A future which is ready once the copy has completed, not valid
+     *         if there's no such variable.
+     */
+    completion_future memcpy_symbol_async(const char* symbolName, void* hostptr, size_t count, size_t offset = 0, hcMemcpyKind kind = hcMemcpyHostToDevice);
+
+    /**
+     * Starts a batch of asynchronous kernel launches on this accelerator_view.
+     *
+     * Kernels launched asynchronously after begin_batch() are written into
+     * the command queue back to back without individual completion signals,
+     * and are only submitted to the device when end_batch() is called.
+     * This reduces the host overhead of launching many small kernels in a
+     * row. The completion_future objects returned by launches within a batch
+     * become ready along with the whole batch, so they must not be waited on
+     * before end_batch().
+     *
+     * Synchronous launches, copies and markers are not part of the batch.
+     * Calling begin_batch() while a batch is already open has no effect.
+     *
+     * The kernels of a batch make their memory accesses visible to each
+     * other at agent scope, without writing the caches of the device back
+     * after each kernel; the end of the batch makes them visible to the
+     * host. Kernels using host memory, and all kernels if environment
+     * variable HCC_SYSTEM_FENCES is 1, keep system scope.
+     */
+    void begin_batch() { pQueue->beginBatch(); }
+
+    /**
+     * Ends the current batch of asynchronous kernel launches and submits it
+     * to the device, ringing the doorbell of the command queue only once.
+     *
+     * @return A future which becomes ready when all kernels launched within
+     *         the batch have completed. An empty future is returned if there
+     *         is no open batch.
+     */
+    completion_future end_batch();
+
+    /**
+     * Starts recording a command graph on this accelerator_view.
+     *
+     * Kernel launches and markers issued on this accelerator_view after
+     * begin_capture() are recorded instead of being submitted, until
+     * end_capture() is called. The completion_future objects returned while
+     * recording are empty. Dependencies between recorded kernels are
+     * resolved at recording time, so replaying the graph doesn't have to
+     * track them again.
+     *
+     * Copies and synchronous waits are not recorded. Calling begin_capture()
+     * while already recording has no effect.
+     */
+    void begin_capture() { pQueue->beginCapture(); }
+
+    /**
+     * Ends recording and returns the recorded command graph.
+     *
+     * @return A command_graph which could be replayed many times. An empty
+     *         command_graph is returned if begin_capture() wasn't called.
+     */
+    command_graph end_capture();
+
     /**
      * Compares "this" accelerator_view with the passed accelerator_view object
      * to determine if they represent the same underlying object.
@@ -267,6 +528,14 @@ public:
         return pQueue.get()->getDev()->GetMaxTileStaticSize();
     }
 
+    /**
+     * Returns the number of work-items in a wavefront of the accelerator
+     * of this accelerator view, or 0 if it doesn't run wavefronts.
+     */
+    unsigned int get_wavefront_size() const {
+        return pQueue.get()->getDev()->get_wavefront_size();
+    }
+
     /**
      * Returns the number of pending asynchronous operations on this
      * accelerator view.
@@ -288,6 +557,15 @@ public:
         return pQueue->getHSAQueue();
     }
 
+    /**
+     * Returns the queue kernels enqueue the kernels of launch templates to
+     * this accelerator view through, see device_queue.
+     *
+     * @return A device_queue, which is not valid if kernels can't enqueue
+     *         kernels to this accelerator view.
+     */
+    device_queue get_device_queue() const;
+
     /**
      * Returns an opaque handle which points to the underlying HSA agent.
      *
@@ -363,6 +641,74 @@ public:
         return false;
      }
 
+    /**
+     * Returns the scheduling priority of the command queue of the
+     * accelerator view.
+     */
+    hcQueuePriority get_queue_priority() const {
+        return pQueue->get_priority();
+    }
+
+    /**
+     * Releases the scratch memory the command queue of the accelerator view
+     * grew beyond the sizes it was created with, for kernels using more
+     * private segment. The accelerator view waits for its commands to
+     * complete, and its command queue is replaced by a new one; it must not
+     * be used by other threads meanwhile.
+     *
+     * @return true if the scratch memory is released, false if it's not
+     *         supported or a batch or a capture is open.
+     */
+    bool release_scratch() {
+        return pQueue->releaseScratch();
+    }
+
+    /**
+     * Sets which kernel dispatches of the accelerator view are profiled,
+     * i.e. have the ticks completion_future::get_begin_tick() and
+     * completion_future::get_end_tick() return. By default none of them are,
+     * unless environment variable HCC_PROFILE sets another period.
+     *
+     * @param[in] period 0 to profile no dispatch, 1 to profile all of them,
+     *                   N to profile one in N of them, which keeps timing
+     *                   available at a fraction of the cost.
+     */
+    void set_profiling_period(unsigned int period) {
+        pQueue->setProfilingPeriod(period);
+    }
+
+    /**
+     * Returns which kernel dispatches of the accelerator view are profiled,
+     * see set_profiling_period().
+     */
+    unsigned int get_profiling_period() const {
+        return pQueue->getProfilingPeriod();
+    }
+
+    /**
+     * Profiles the next kernel dispatch of the accelerator view, whatever
+     * its profiling period.
+     */
+    void profile_next_dispatch() const {
+        pQueue->profileNextDispatch();
+    }
+
+    /**
+     * Gets the resources the kernel of a functor launched by
+     * parallel_for_each takes on the accelerator, from its code object: its
+     * registers, its group and private segments, and the wavefronts a SIMD
+     * can hold with its registers. A private segment of more than 0 bytes
+     * usually means registers spill to memory.
+     *
+     * @param[in] f The functor, of the type of a launched kernel.
+     * @param[out] resources The resources of the kernel.
+     * @return true if the accelerator reports the resources of its kernels.
+     */
+    template <typename Kernel>
+    bool get_kernel_resources(const Kernel& f, kernel_resources& resources) {
+        return GetKernelResources(Kalmar::get_kernel_handle(f), pQueue.get(), resources);
+    }
+
 private:
     accelerator_view(std::shared_ptr<Kalmar::KalmarQueue> pQueue) : pQueue(pQueue) {}
     std::shared_ptr<Kalmar::KalmarQueue> pQueue;
@@ -391,6 +737,10 @@ private:
     // generic version
     template <int N, typename Kernel> friend
         completion_future parallel_for_each(const accelerator_view&, const extent<N>&, const Kernel&);
+
+    // extent read from device memory
+    template <int N, typename Kernel> friend
+        completion_future parallel_for_each(const accelerator_view&, const indirect_extent<N>&, const Kernel&);
   
     // 1D specialization
     template <typename Kernel> friend
@@ -416,6 +766,20 @@ private:
     template <typename Kernel> friend
         completion_future parallel_for_each(const accelerator_view&, const tiled_extent<1>&, const Kernel&);
 
+    // launch templates
+    template <int N, typename Kernel> friend
+        launch_template create_launch_template(const accelerator_view&, const extent<N>&, const Kernel&);
+    template <int N, typename Kernel> friend
+        launch_template create_launch_template(const accelerator_view&, const tiled_extent<N>&, const Kernel&);
+
+    // parallel_for_each split with the CPU
+    template <int N, typename Kernel> friend
+        completion_future parallel_for_each(const accelerator_view&, const split_policy&, const extent<N>&, const Kernel&);
+
+    // parallel_for_each sharded over several accelerator_views
+    template <int N, typename Kernel> friend
+        completion_future parallel_for_each(const std::vector<accelerator_view>&, const extent<N>&, const Kernel&);
+
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
 public:
 #endif
@@ -551,6 +915,21 @@ public:
      */
     accelerator_view get_default_view() const { return pDev->get_default_queue(); }
 
+    /**
+     * Starts building the kernels embedded in the program for this
+     * accelerator on a background thread, so the first kernel launched on it
+     * doesn't wait for them to be finalized, loaded and looked up. Kernels
+     * are built once for each accelerator, later calls return the same
+     * build. Launches made before it's done wait for it.
+     *
+     * Environment variable HCC_WARMUP=ON does the same for the default
+     * accelerator when the program starts.
+     *
+     * @return A completion_future object, which is ready once the kernels
+     *         are built.
+     */
+    completion_future warm_up_async() const;
+
     /**
      * Creates and returns a new accelerator view on the accelerator with the
      * supplied queuing mode.
@@ -564,6 +943,68 @@ public:
         pQueue->set_mode(mode);
         return pQueue;
     }
+
+    /**
+     * Creates and returns a new accelerator view on the accelerator with a
+     * dedicated command queue of the given scheduling priority, which only
+     * uses the compute units enabled in cu_mask from the start.
+     *
+     * @param[in] priority The scheduling priority of the command queue
+     *                     relative to other command queues on the device.
+     * @param[in] cu_mask The CUs the command queue uses, in the format of
+     *                    accelerator_view::set_cu_mask(). An empty mask uses
+     *                    all CUs. See partition_cu() for disjoint masks.
+     * @param[in] order The execute order of the accelerator_view.
+     * @param[in] mode The queuing mode of the accelerator_view.
+     */
+    accelerator_view create_view(hcQueuePriority priority, const std::vector<bool>& cu_mask = std::vector<bool>(),
+                                 execute_order order = execute_in_order, queuing_mode mode = queuing_mode_automatic) {
+        auto pQueue = pDev->createQueue(order, priority, cu_mask);
+        pQueue->set_mode(mode);
+        return pQueue;
+    }
+
+    /**
+     * Creates and returns a new accelerator view on the accelerator whose
+     * command queue is sized for kernels using up to the given private
+     * (scratch) and group segments. The scratch memory is allocated along
+     * with the command queue, so a kernel spilling registers doesn't stall
+     * the queue while it grows. A kernel using more private segment still
+     * grows it, see accelerator_view::release_scratch().
+     *
+     * @param[in] private_segment_size Bytes of private segment per work-item,
+     *                                 get_max_private_segment_size() for the
+     *                                 kernels created so far.
+     * @param[in] group_segment_size Bytes of group segment per work-group,
+     *                               get_max_group_segment_size() for the
+     *                               kernels created so far.
+     * @param[in] order The execute order of the accelerator_view.
+     * @param[in] mode The queuing mode of the accelerator_view.
+     */
+    accelerator_view create_view(unsigned int private_segment_size, unsigned int group_segment_size,
+                                 execute_order order = execute_in_order, queuing_mode mode = queuing_mode_automatic) {
+        auto pQueue = pDev->createQueue(order, private_segment_size, group_segment_size);
+        pQueue->set_mode(mode);
+        return pQueue;
+    }
+
+    /**
+     * Returns the largest private segment size, in bytes per work-item, of
+     * the kernels created on this accelerator so far; 0 if it's not reported.
+     * Kernels are created upon their first launch, or by warm_up_async().
+     */
+    unsigned int get_max_private_segment_size() const {
+        return pDev->GetMaxPrivateSegmentSize();
+    }
+
+    /**
+     * Returns the largest static group segment size, in bytes per
+     * work-group, of the kernels created on this accelerator so far; 0 if
+     * it's not reported.
+     */
+    unsigned int get_max_group_segment_size() const {
+        return pDev->GetMaxGroupSegmentSize();
+    }
   
     /**
      * Compares "this" accelerator with the passed accelerator object to
@@ -788,6 +1229,19 @@ public:
     bool get_is_peer(const accelerator& other) const {
         return pDev->is_peer(other.pDev);
     }
+
+    /**
+     * Return the distance of the links @p other accesses this accelerator's
+     * device memory through: the sum of their NUMA distances, or their number
+     * if the distances are not reported. Peers closer to each other move
+     * data between their memories faster.
+     *
+     * @return 0 for the accelerator itself, UINT32_MAX if @p other is not a
+     *         peer.
+     */
+    uint32_t get_peer_distance(const accelerator& other) const {
+        return pDev->get_peer_distance(other.pDev);
+    }
       
     /**
      * Return a std::vector of this accelerator's peers. peer is other accelerator which can access this 
@@ -815,6 +1269,126 @@ public:
         return pDev->get_compute_unit_count();
     }
 
+    /**
+     * Return the number of work-items in a wavefront of the accelerator, or
+     * 0 if it doesn't run wavefronts, as the CPU accelerator.
+     */
+    unsigned int get_wavefront_size() const {
+        return pDev->get_wavefront_size();
+    }
+
+    /**
+     * Splits the compute units of the accelerator into disjoint partitions
+     * of consecutive CUs, one CU mask per partition, to be used with
+     * create_view() or accelerator_view::set_cu_mask().
+     *
+     * @param[in] cu_counts The number of CUs in each partition.
+     * @return The CU masks of the partitions, or an empty vector if the
+     *         accelerator has fewer CUs than requested in total.
+     */
+    std::vector< std::vector<bool> > partition_cu(const std::vector<unsigned int>& cu_counts) const {
+        unsigned int cu_count = get_cu_count();
+        std::vector< std::vector<bool> > masks;
+        unsigned int first = 0;
+        for (unsigned int count : cu_counts) {
+            if (cu_count - first < count) {
+                return std::vector< std::vector<bool> >();
+            }
+            std::vector<bool> mask(cu_count, false);
+            std::fill(mask.begin() + first, mask.begin() + first + count, true);
+            masks.push_back(mask);
+            first += count;
+        }
+        return masks;
+    }
+
+    /**
+     * Splits the compute units of the accelerator into the given number of
+     * disjoint partitions of nearly equal size.
+     *
+     * @param[in] partition_count The number of partitions. It's capped to the
+     *                            number of CUs.
+     * @return The CU masks of the partitions.
+     */
+    std::vector< std::vector<bool> > partition_cu(unsigned int partition_count) const {
+        unsigned int cu_count = get_cu_count();
+        partition_count = std::min(partition_count, cu_count);
+        std::vector<unsigned int> cu_counts;
+        for (unsigned int i = 0; i < partition_count; ++i) {
+            cu_counts.push_back((i + 1) * cu_count / partition_count - i * cu_count / partition_count);
+        }
+        return partition_cu(cu_counts);
+    }
+
+    /**
+     * Returns the bandwidth achieved so far by copies between pageable host
+     * memory and the accelerator. Such copies are split into chunks which are
+     * streamed through pinned staging buffers. The chunk size and the number
+     * of staging buffers can be set with the HCC_STAGING_BUFFER_SIZE (in KB)
+     * and HCC_STAGING_BUFFER_COUNT environment variables.
+     *
+     * @return The bandwidth in bytes per second, or 0 if no such copy has
+     *         been made.
+     */
+    double get_host_to_device_bandwidth() const {
+        return pDev->getTransferBandwidth(Kalmar::hcMemcpyHostToDevice);
+    }
+
+    /**
+     * Returns the bandwidth achieved so far by copies from the accelerator to
+     * pageable host memory. See get_host_to_device_bandwidth().
+     *
+     * @return The bandwidth in bytes per second, or 0 if no such copy has
+     *         been made.
+     */
+    double get_device_to_host_bandwidth() const {
+        return pDev->getTransferBandwidth(Kalmar::hcMemcpyDeviceToHost);
+    }
+
+    /**
+     * Gives the free device memory kept by the memory cache of the
+     * accelerator back to the platform. The memory cache keeps the memory of
+     * destroyed arrays for later arrays, it's enabled by setting the
+     * HCC_HSA_MEMORY_CACHE environment variable to ON, and bounded by
+     * HCC_HSA_MEMORY_CACHE_LIMIT (in MB).
+     *
+     * @return The number of bytes released.
+     */
+    size_t trim_memory_cache() const {
+        return pDev->trimMemoryCache();
+    }
+
+    /**
+     * Returns the number of device memory allocations served from the memory
+     * cache of the accelerator. See trim_memory_cache().
+     *
+     * @return Number of memory cache hits. 0 if the memory cache is disabled.
+     */
+    uint64_t get_memory_cache_hits() const {
+        return pDev->getMemoryCacheHits();
+    }
+
+    /**
+     * Returns the number of device memory allocations the memory cache of
+     * the accelerator couldn't serve. See trim_memory_cache().
+     *
+     * @return Number of memory cache misses. 0 if the memory cache is
+     *         disabled.
+     */
+    uint64_t get_memory_cache_misses() const {
+        return pDev->getMemoryCacheMisses();
+    }
+
+    /**
+     * Returns the size of the free device memory kept by the memory cache of
+     * the accelerator. See trim_memory_cache().
+     *
+     * @return The size in bytes.
+     */
+    size_t get_memory_cache_size() const {
+        return pDev->getMemoryCacheSize();
+    }
+
 private:
     accelerator(Kalmar::KalmarDevice* pDev) : pDev(pDev) {}
     friend class accelerator_view;
@@ -841,7 +1415,7 @@ public:
      * object which does not refer to any asynchronous operation. Default
      * constructed completion_future objects have valid() == false
      */
-    completion_future() : __amp_future(), __thread_then(nullptr), __asyncOp(nullptr) {};
+    completion_future() : __amp_future(), __asyncOp(nullptr) {};
 
     /**
      * Copy constructor. Constructs a new completion_future object that referes
@@ -851,7 +1425,7 @@ public:
      *                  initialize this.
      */
     completion_future(const completion_future& other)
-        : __amp_future(other.__amp_future), __thread_then(other.__thread_then), __asyncOp(other.__asyncOp) {}
+        : __amp_future(other.__amp_future), __asyncOp(other.__asyncOp) {}
 
     /**
      * Move constructor. Move constructs a new completion_future object that
@@ -863,7 +1437,7 @@ public:
      *                  completion_future
      */
     completion_future(completion_future&& other)
-        : __amp_future(std::move(other.__amp_future)), __thread_then(other.__thread_then), __asyncOp(other.__asyncOp) {}
+        : __amp_future(std::move(other.__amp_future)), __asyncOp(std::move(other.__asyncOp)) {}
 
     /**
      * Copy assignment. Copy assigns the contents of other to this. This method
@@ -876,7 +1450,6 @@ public:
     completion_future& operator=(const completion_future& _Other) {
         if (this != &_Other) {
            __amp_future = _Other.__amp_future;
-           __thread_then = _Other.__thread_then;
            __asyncOp = _Other.__asyncOp;
         }
         return (*this);
@@ -894,8 +1467,7 @@ public:
     completion_future& operator=(completion_future&& _Other) {
         if (this != &_Other) {
             __amp_future = std::move(_Other.__amp_future);
-            __thread_then = _Other.__thread_then;
-           __asyncOp = _Other.__asyncOp;
+            __asyncOp = std::move(_Other.__asyncOp);
         }
         return (*this);
     }
@@ -908,7 +1480,11 @@ public:
      * operation, this method throws that stored exception.
      */
     void get() const {
-        __amp_future.get();
+        if (__asyncOp != nullptr) {
+            __asyncOp->blockingWait();
+        } else {
+            __amp_future.get();
+        }
     }
 
     /**
@@ -917,7 +1493,7 @@ public:
      * completion_future is associated with an asynchronous operation.
      */
     bool valid() const {
-        return __amp_future.valid();
+        return (__asyncOp != nullptr) || __amp_future.valid();
     }
 
     /** @{ */
@@ -933,27 +1509,54 @@ public:
      * The other variants are functionally identical to the
      * std::shared_future<void> member methods with same names.
      *
-     * @param waitMode[in] An optional parameter to specify the wait mode. By
-     *                     default it would be hcWaitModeBlocked.
-     *                     hcWaitModeActive would be used to reduce latency with
-     *                     the expense of using one CPU core for active waiting.
+     * The wait mode is the one of the accelerator_view the operation was
+     * submitted to.
      */
-    void wait(hcWaitMode mode = hcWaitModeBlocked) const {
-        if (this->valid()) {
-            if (__asyncOp != nullptr) {
-                __asyncOp->setWaitMode(mode);
-            }   
+    void wait() const {
+        if (__asyncOp != nullptr) {
+            __asyncOp->blockingWait();
+        } else if (__amp_future.valid()) {
+            __amp_future.wait();
+        }
+    }
+
+    /**
+     * Blocks until the associated asynchronous operation completes.
+     *
+     * @param mode[in] The wait mode. hcWaitModeActive would be used to reduce
+     *                 latency with the expense of using one CPU core for
+     *                 active waiting. hcWaitModeAdaptive spins for a short
+     *                 while, then yields, then blocks.
+     */
+    void wait(hcWaitMode mode) const {
+        if (__asyncOp != nullptr) {
+            __asyncOp->setWaitMode(mode);
+            __asyncOp->blockingWait();
+        } else if (__amp_future.valid()) {
             __amp_future.wait();
         }
     }
 
     template <class _Rep, class _Period>
     std::future_status wait_for(const std::chrono::duration<_Rep, _Period>& _Rel_time) const {
+        if (__asyncOp != nullptr) {
+            return wait_until(std::chrono::steady_clock::now() + _Rel_time);
+        }
         return __amp_future.wait_for(_Rel_time);
     }
 
     template <class _Clock, class _Duration>
     std::future_status wait_until(const std::chrono::time_point<_Clock, _Duration>& _Abs_time) const {
+        if (__asyncOp != nullptr) {
+            // poll the completion signal until the deadline
+            while (!__asyncOp->isReady()) {
+                if (_Clock::now() >= _Abs_time) {
+                    return std::future_status::timeout;
+                }
+                std::this_thread::yield();
+            }
+            return std::future_status::ready;
+        }
         return __amp_future.wait_until(_Abs_time);
     }
 
@@ -965,6 +1568,13 @@ public:
      * object and refers to the same asynchronous operation.
      */
     operator std::shared_future<void>() const {
+        if (__asyncOp != nullptr) {
+            // only materialize a std::shared_future when it's asked for
+            std::shared_ptr<Kalmar::KalmarAsyncOp> asyncOp = __asyncOp;
+            return std::async(std::launch::deferred, [asyncOp] {
+                asyncOp->blockingWait();
+            }).share();
+        }
         return __amp_future;
     }
 
@@ -973,23 +1583,44 @@ public:
      * executed upon completion of the asynchronous operation associated with
      * this completion_future object. The completion callback func should have
      * an operator() that is valid when invoked with non arguments, i.e., "func()".
+     *
+     * The callback is copied, and run by a small pool of threads of the runtime
+     * once the operation completes: kernel dispatches, barriers and copies
+     * notify the runtime on the completion of their signals, without any
+     * thread waiting for them. Several callbacks may be set.
+     *
+     * @return A completion_future which is ready once the callback returns,
+     *         with the exception it throws if any. If the callback returns a
+     *         completion_future itself, it's ready once that one is ready too,
+     *         so continuations may be chained.
      */
-    // FIXME: notice we removed const from the signature here
-    //        the original signature in the specification should be
-    //        template<typename functor>
-    //        void then(const functor& func) const;
     template<typename functor>
-    void then(const functor & func) {
+    completion_future then(const functor& func) const {
 #if __KALMAR_ACCELERATOR__ != 1
-      // could only assign once
-      if (__thread_then == nullptr) {
-        // spawn a new thread to wait on the future and then execute the callback functor
-        __thread_then = new std::thread([&]() __CPU__ {
-          this->wait();
-          if(this->valid())
-            func();
+      if (!valid()) {
+        return completion_future();
+      }
+      std::shared_ptr< std::promise<void> > done = std::make_shared< std::promise<void> >();
+      completion_future next(done->get_future().share());
+      std::function<void()> callback = [func, done] {
+        run_then(func, done, std::is_same<decltype(func()), completion_future>());
+      };
+      if (__asyncOp != nullptr) {
+        Kalmar::CLAMP::RunWhenReady(__asyncOp, std::move(callback));
+      } else {
+        // deferred futures aren't ready until they are waited for, which the
+        // pool does at once
+        std::shared_future<void> future = __amp_future;
+        Kalmar::CLAMP::RunWhen([future] {
+          return future.wait_for(std::chrono::seconds(0)) != std::future_status::timeout;
+        }, [future, callback] {
+          future.wait();
+          callback();
         });
       }
+      return next;
+#else
+      return completion_future();
 #endif
     }
 
@@ -1010,7 +1641,9 @@ public:
      * Get the tick number when the underlying asynchronous operation begins.
      *
      * @return An implementation-defined tick number in case the instance is
-     *         created by a kernel dispatch or a barrier packet. 0 otherwise.
+     *         created by a profiled kernel dispatch or barrier packet, or
+     *         an asynchronous copy. 0 otherwise. See
+     *         accelerator_view::set_profiling_period().
      */
     uint64_t get_begin_tick() {
       if (__asyncOp != nullptr) {
@@ -1024,7 +1657,9 @@ public:
      * Get the tick number when the underlying asynchronous operation ends.
      *
      * @return An implementation-defined tick number in case the instance is
-     *         created by a kernel dispatch or a barrier packet. 0 otherwise.
+     *         created by a profiled kernel dispatch or barrier packet, or
+     *         an asynchronous copy. 0 otherwise. See
+     *         accelerator_view::set_profiling_period().
      */
     uint64_t get_end_tick() {
       if (__asyncOp != nullptr) {
@@ -1038,7 +1673,8 @@ public:
      * Get the frequency of ticks per second for the underlying asynchrnous operation.
      *
      * @return An implementation-defined frequency in Hz in case the instance is
-     *         created by a kernel dispatch or a barrier packet. 0 otherwise.
+     *         created by a kernel dispatch, a barrier packet or an asynchronous
+     *         copy. 0 otherwise.
      */
     uint64_t get_tick_frequency() {
       if (__asyncOp != nullptr) {
@@ -1062,12 +1698,6 @@ public:
     }
 
     ~completion_future() {
-      if (__thread_then != nullptr) {
-        __thread_then->join();
-      }
-      delete __thread_then;
-      __thread_then = nullptr;
-      
       if (__asyncOp != nullptr) {
         __asyncOp = nullptr;
       }
@@ -1075,19 +1705,80 @@ public:
 
 private:
     std::shared_future<void> __amp_future;
-    std::thread* __thread_then = nullptr;
     std::shared_ptr<Kalmar::KalmarAsyncOp> __asyncOp;
 
-    completion_future(std::shared_ptr<Kalmar::KalmarAsyncOp> event) : __amp_future(*(event->getFuture())), __asyncOp(event) {}
+    // run the callback of then(), and complete "done" once it returns
+    template <typename functor>
+    static void run_then(const functor& func, const std::shared_ptr< std::promise<void> >& done, std::false_type) {
+      try {
+        func();
+        done->set_value();
+      } catch (...) {
+        done->set_exception(std::current_exception());
+      }
+    }
 
-    completion_future(const std::shared_future<void> &__future)
-        : __amp_future(__future), __thread_then(nullptr), __asyncOp(nullptr) {}
+    // or once the completion_future it returns is ready
+    template <typename functor>
+    static void run_then(const functor& func, const std::shared_ptr< std::promise<void> >& done, std::true_type) {
+      try {
+        completion_future inner = func();
+        if (!inner.valid()) {
+          done->set_value();
+          return;
+        }
+        inner.then([inner, done] {
+          try {
+            inner.get();
+            done->set_value();
+          } catch (...) {
+            done->set_exception(std::current_exception());
+          }
+        });
+      } catch (...) {
+        done->set_exception(std::current_exception());
+      }
+    }
+
+    // completion of kernel dispatches and barriers is tracked by the async
+    // operation itself, no std::shared_future is allocated for them
+    completion_future(std::shared_ptr<Kalmar::KalmarAsyncOp> event) : __amp_future(), __asyncOp(event) {}
+
+    completion_future(const std::shared_future<void> &__future)
+        : __amp_future(__future), __asyncOp(nullptr) {}
+
+    // building kernels in the background
+    friend class accelerator;
+
+    // parallel_for_each split with the CPU
+    template <int N, typename Kernel> friend
+        completion_future parallel_for_each(const accelerator_view&, const split_policy&, const extent<N>&, const Kernel&);
+
+    // parallel_for_each sharded over several accelerator_views
+    template <int N, typename Kernel> friend
+        completion_future parallel_for_each(const std::vector<accelerator_view>&, const extent<N>&, const Kernel&);
+
+#if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
+    // kernel launches of the CPU path
+    template <typename Kernel, int N> friend
+        completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>&, Kernel const&, extent<N> const&);
+    template <typename Kernel> friend
+        completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>&, Kernel const&, tiled_extent<1> const&);
+    template <typename Kernel> friend
+        completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>&, Kernel const&, tiled_extent<2> const&);
+    template <typename Kernel> friend
+        completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>&, Kernel const&, tiled_extent<3> const&);
+#endif
 
     // non-tiled parallel_for_each
     // generic version
     template <int N, typename Kernel> friend
         completion_future parallel_for_each(const accelerator_view&, const extent<N>&, const Kernel&);
 
+    // extent read from device memory
+    template <int N, typename Kernel> friend
+        completion_future parallel_for_each(const accelerator_view&, const indirect_extent<N>&, const Kernel&);
+
     // 1D specialization
     template <typename Kernel> friend
         completion_future parallel_for_each(const accelerator_view&, const extent<1>&, const Kernel&);
@@ -1113,6 +1804,12 @@ private:
         completion_future parallel_for_each(const accelerator_view&, const tiled_extent<1>&, const Kernel&);
 
     // copy_async
+    template <typename SrcBuffer, typename DstBuffer> friend
+        completion_future copy_async_flat(const SrcBuffer&, const DstBuffer&, int, int, int);
+    template <typename T, typename InputIter, typename DstBuffer> friend
+        completion_future copy_async_staged(InputIter, int, const DstBuffer&, int);
+    template <typename Func> friend
+        completion_future copy_async_thread(Func);
     template <typename T, int N> friend
         completion_future copy_async(const array_view<const T, N>& src, const array_view<T, N>& dest);
     template <typename T, int N> friend
@@ -1142,6 +1839,313 @@ private:
 
     // accelerator_view
     friend class accelerator_view;
+
+    // launch_template
+    friend class launch_template;
+
+    // command_graph
+    friend class command_graph;
+
+    // asynchronous algorithms of the parallel STL
+    friend completion_future deferred_completion_future(const std::shared_future<void>&);
+};
+
+/** \cond HIDDEN_SYMBOLS */
+// completion_future of an operation run once it's waited for, used by the
+// asynchronous algorithms of the parallel STL to finish their work on the host
+inline completion_future deferred_completion_future(const std::shared_future<void>& fut) {
+    return completion_future(fut);
+}
+/** \endcond */
+
+// ------------------------------------------------------------------------
+// device-side enqueue
+// ------------------------------------------------------------------------
+
+/**
+ * A kernel launch kernels could enqueue, exported on the host by
+ * launch_template::get_device_kernel(): the AQL packet of the launch, whose
+ * kernel arguments are kept by the launch_template. Kernels enqueue it with
+ * the grid size of their choice, so a table of them prepared on the host,
+ * as an array of device_kernel objects, lets kernels launch the follow-up
+ * work sized by their own results.
+ */
+struct device_kernel {
+    uint32_t packet[16];
+
+    /// whether the launch could be enqueued by kernels
+    bool valid() const __CPU__ __HC__ { return packet[8] != 0 || packet[9] != 0; }
+};
+
+/**
+ * The command queue of an accelerator_view as kernels see it, returned by
+ * accelerator_view::get_device_queue() and captured by kernels to enqueue
+ * device_kernel objects to it.
+ *
+ * Kernels write the AQL packets into the queue as the host does, without a
+ * round trip to the host. The kernels they enqueue start after the commands
+ * before them in the queue, and aren't tracked by the runtime: the host waits
+ * for them with a marker created on the accelerator_view once the kernels
+ * which enqueued them are done. A kernel shouldn't wait for the kernels it
+ * enqueues to the accelerator_view it runs on, which start after it.
+ *
+ * It's only supported on HSA accelerators with 64-bit doorbells.
+ */
+struct device_queue {
+    void* base;
+    uint32_t size;
+    uint64_t* write_index;
+    const uint64_t* read_index;
+    uint64_t* doorbell;
+
+    /// whether kernels could enqueue kernels to the queue
+    bool valid() const __CPU__ __HC__ { return base != nullptr; }
+
+    /**
+     * Enqueues the launch of "kernel" over a grid of "grid_x" x "grid_y" x
+     * "grid_z" work-items, in the order of its dimensions, x being the last
+     * dimension of the extent it was created with. A zero grid size launches
+     * nothing. The caller spins while the queue is full.
+     */
+    void enqueue(const device_kernel& kernel, uint32_t grid_x, uint32_t grid_y = 1,
+                 uint32_t grid_z = 1) const __HC__ {
+        if (grid_x == 0 || grid_y == 0 || grid_z == 0)
+            return;
+        uint64_t index = __atomic_fetch_add(write_index, 1, __ATOMIC_RELAXED);
+        while (index - __atomic_load_n(read_index, __ATOMIC_RELAXED) >= size) {}
+
+        // the header is written last, once the rest of the packet is visible
+        uint32_t* slot = static_cast<uint32_t*>(base) + (index & (size - 1)) * 16;
+        for (int i = 1; i < 16; ++i)
+            slot[i] = kernel.packet[i];
+        slot[3] = grid_x;
+        slot[4] = grid_y;
+        slot[5] = grid_z;
+        __atomic_store_n(slot, kernel.packet[0], __ATOMIC_RELEASE);
+        __atomic_store_n(doorbell, index, __ATOMIC_RELEASE);
+    }
+
+    /**
+     * Enqueues the launch of "kernel" over a grid whose sizes are read from
+     * "grid", as three consecutive 32-bit integers x, y and z written by
+     * earlier kernels.
+     */
+    void enqueue_indirect(const device_kernel& kernel, const uint32_t* grid) const __HC__ {
+        enqueue(kernel, grid[0], grid[1], grid[2]);
+    }
+};
+
+inline device_queue accelerator_view::get_device_queue() const {
+    device_queue queue = { nullptr, 0, nullptr, nullptr, nullptr };
+    Kalmar::KalmarDeviceQueue deviceQueue;
+    if (pQueue->getDeviceQueue(deviceQueue)) {
+        queue.base = deviceQueue.base;
+        queue.size = deviceQueue.size;
+        queue.write_index = deviceQueue.writeIndex;
+        queue.read_index = deviceQueue.readIndex;
+        queue.doorbell = deviceQueue.doorbell;
+    }
+    return queue;
+}
+
+// ------------------------------------------------------------------------
+// launch_template
+// ------------------------------------------------------------------------
+
+/**
+ * This class represents a kernel launch captured once by
+ * create_launch_template(): the kernel object, the grid and workgroup sizes,
+ * and the serialized kernel arguments. The launch could then be submitted
+ * many times through launch(), without looking up the kernel or serializing
+ * the kernel functor again.
+ *
+ * Kernel arguments are serialized from the captured variables of the kernel
+ * functor in the order they are declared, each of which aligned to its size.
+ * They can be patched in between launches with set_arg() or set_arg_bytes().
+ *
+ * Data captured by array or array_view is not synchronized to the device
+ * by launch(). A launch only waits for previous kernels on the same
+ * accelerator_view which use the same buffers.
+ *
+ * A launch_template object is not thread-safe.
+ */
+class launch_template {
+public:
+    /**
+     * Default constructor. Constructs an empty launch_template object which
+     * does not refer to any kernel launch. valid() == false
+     */
+    launch_template() : __pQueue(nullptr), __launchTemplate(nullptr) {}
+
+    /**
+     * Returns true if this launch_template refers to a captured kernel launch.
+     */
+    bool valid() const { return __launchTemplate != nullptr; }
+
+    /**
+     * Submits the captured kernel launch asynchronously.
+     *
+     * @param[in] barrier Whether the kernel waits for the previous commands
+     *                    of the accelerator_view. hcBarrierNone lets it
+     *                    overlap them on an in-order accelerator_view, except
+     *                    the ones using the same buffers. By default it waits
+     *                    as the execute order of the accelerator_view
+     *                    requires.
+     * @return A completion_future for the submitted kernel launch. An empty
+     *         completion_future if valid() == false.
+     */
+    completion_future launch(hcBarrierMode barrier = hcBarrierDefault) const {
+        if (__launchTemplate == nullptr) {
+            return completion_future();
+        }
+        return completion_future(__launchTemplate->launch(barrier));
+    }
+
+    /**
+     * Get the size of the serialized kernel arguments in bytes.
+     */
+    size_t get_arg_size() const {
+        return (__launchTemplate != nullptr) ? __launchTemplate->getArgSize() : 0;
+    }
+
+    /**
+     * Overwrites the serialized kernel arguments for later launches. Launches
+     * already submitted are not affected.
+     *
+     * @param[in] offset Offset in bytes in the serialized kernel arguments.
+     * @param[in] src Pointer to the new bytes.
+     * @param[in] size Number of bytes to overwrite.
+     */
+    void set_arg_bytes(size_t offset, const void* src, size_t size) {
+        if (__launchTemplate != nullptr) {
+            __launchTemplate->patchArgs(offset, src, size);
+        }
+    }
+
+    /**
+     * Overwrites one kernel argument of type T for later launches.
+     *
+     * @param[in] offset Offset in bytes in the serialized kernel arguments.
+     * @param[in] value The new value of the argument.
+     */
+    template <typename T>
+    void set_arg(size_t offset, const T& value) {
+        set_arg_bytes(offset, &value, sizeof(T));
+    }
+
+    /**
+     * Overwrites all the kernel arguments for later launches with the ones
+     * serialized from a kernel functor of the same type as the captured one.
+     * The functor must not capture any array or array_view.
+     *
+     * @param[in] f The kernel functor whose captured variables are the new
+     *              kernel arguments.
+     */
+    template <typename Kernel>
+    void set_args(const Kernel& f) {
+        if (__launchTemplate != nullptr) {
+            Kalmar::KernelArgPatcher patcher;
+            Kalmar::Serialize s(&patcher);
+            f.__cxxamp_serialize(s);
+            __launchTemplate->patchArgs(0, patcher.data(), patcher.size());
+        }
+    }
+
+    /**
+     * Exports the captured kernel launch for kernels to enqueue it through a
+     * device_queue, with a copy of the current kernel arguments which stays
+     * valid as long as this launch_template. The device_kernel objects
+     * exported by a launch_template share the copy: exporting it again after
+     * set_arg() changes the arguments of all of them.
+     *
+     * @return A device_kernel, which is not valid if kernels can't enqueue
+     *         the launch, or if valid() == false.
+     */
+    device_kernel get_device_kernel() const {
+        device_kernel kernel = {};
+        if (__launchTemplate != nullptr) {
+            __launchTemplate->exportPacket(kernel.packet);
+        }
+        return kernel;
+    }
+
+private:
+    // keeps the accelerator_view alive as long as the template
+    std::shared_ptr<Kalmar::KalmarQueue> __pQueue;
+    std::shared_ptr<Kalmar::KalmarLaunchTemplate> __launchTemplate;
+
+    launch_template(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue,
+                    const std::shared_ptr<Kalmar::KalmarLaunchTemplate>& launchTemplate)
+        : __pQueue(pQueue), __launchTemplate(launchTemplate) {}
+
+    template <int N, typename Kernel> friend
+        launch_template create_launch_template(const accelerator_view&, const extent<N>&, const Kernel&);
+    template <int N, typename Kernel> friend
+        launch_template create_launch_template(const accelerator_view&, const tiled_extent<N>&, const Kernel&);
+};
+
+// ------------------------------------------------------------------------
+// command_graph
+// ------------------------------------------------------------------------
+
+/**
+ * This class represents a sequence of kernel launches and markers recorded
+ * on an accelerator_view between begin_capture() and end_capture(). The
+ * sequence could be replayed many times through launch(), which writes all
+ * recorded commands into the command queue at once and rings its doorbell
+ * only once.
+ *
+ * Kernel arguments are the ones at the time of recording. Data captured by
+ * array or array_view is not synchronized to the device by launch().
+ */
+class command_graph {
+public:
+    /**
+     * Default constructor. Constructs an empty command_graph object.
+     * valid() == false
+     */
+    command_graph() : __pQueue(nullptr), __graph(nullptr) {}
+
+    /**
+     * Returns true if this command_graph refers to a recorded sequence.
+     */
+    bool valid() const { return __graph != nullptr; }
+
+    /**
+     * Replays the recorded sequence asynchronously.
+     *
+     * @return A completion_future which becomes ready when all recorded
+     *         commands of this replay have completed. An empty
+     *         completion_future if valid() == false or nothing was recorded.
+     */
+    completion_future launch() const {
+        if (__graph == nullptr) {
+            return completion_future();
+        }
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = __graph->launch();
+        if (op == nullptr) {
+            return completion_future();
+        }
+        return completion_future(op);
+    }
+
+    /**
+     * Get the number of recorded kernel launches and markers.
+     */
+    size_t get_node_count() const {
+        return (__graph != nullptr) ? __graph->getNodeCount() : 0;
+    }
+
+private:
+    // keeps the accelerator_view alive as long as the graph
+    std::shared_ptr<Kalmar::KalmarQueue> __pQueue;
+    std::shared_ptr<Kalmar::KalmarGraph> __graph;
+
+    command_graph(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue,
+                  const std::shared_ptr<Kalmar::KalmarGraph>& graph)
+        : __pQueue(pQueue), __graph(graph) {}
+
+    friend class accelerator_view;
 };
 
 // ------------------------------------------------------------------------
@@ -1150,10 +2154,68 @@ private:
 
 inline accelerator accelerator_view::get_accelerator() const { return pQueue->getDev(); }
 
+inline completion_future accelerator::warm_up_async() const {
+    return completion_future(Kalmar::CLAMP::BuildProgramAsync(pDev->get_default_queue()));
+}
+
 inline completion_future accelerator_view::create_marker() {
     return completion_future(pQueue->EnqueueMarker());
 }
 
+inline completion_future accelerator_view::create_marker(const std::vector<completion_future>& dependencies) {
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > asyncOps;
+    for (const completion_future& dependency : dependencies) {
+        if (dependency.__asyncOp != nullptr) {
+            asyncOps.push_back(dependency.__asyncOp);
+        } else {
+            dependency.wait();
+        }
+    }
+    return completion_future(pQueue->EnqueueMarkerWithDependencies(asyncOps));
+}
+
+inline completion_future accelerator_view::copy_async(const void* src, void* dst, size_t size_bytes, hcMemcpyKind kind) {
+    std::shared_ptr<Kalmar::KalmarAsyncOp> op = pQueue->EnqueueOrderedCopy(src, dst, size_bytes, kind);
+    if (op == nullptr) {
+        pQueue->wait();
+        pQueue->copy(const_cast<void*>(src), dst, size_bytes, 0, 0, true);
+        return completion_future();
+    }
+    return completion_future(op);
+}
+
+inline completion_future accelerator_view::memcpy_symbol_async(void* symbolAddr, void* hostptr, size_t count, size_t offset, hcMemcpyKind kind) {
+    if (kind == hcMemcpyHostToDevice) {
+        return copy_async(static_cast<char*>(hostptr) + offset, symbolAddr, count, kind);
+    } else {
+        return copy_async(static_cast<char*>(symbolAddr) + offset, hostptr, count, kind);
+    }
+}
+
+inline completion_future accelerator_view::memcpy_symbol_async(const char* symbolName, void* hostptr, size_t count, size_t offset, hcMemcpyKind kind) {
+    void* symbolAddr = pQueue->getDev()->getSymbolAddress(symbolName);
+    if (symbolAddr == nullptr) {
+        return completion_future();
+    }
+    return memcpy_symbol_async(symbolAddr, hostptr, count, offset, kind);
+}
+
+inline completion_future accelerator_view::end_batch() {
+    std::shared_ptr<Kalmar::KalmarAsyncOp> batch = pQueue->endBatch();
+    if (batch == nullptr) {
+        return completion_future();
+    }
+    return completion_future(batch);
+}
+
+inline command_graph accelerator_view::end_capture() {
+    std::shared_ptr<Kalmar::KalmarGraph> graph = pQueue->endCapture();
+    if (graph == nullptr) {
+        return command_graph();
+    }
+    return command_graph(pQueue, graph);
+}
+
 inline unsigned int accelerator_view::get_version() const { return get_accelerator().get_version(); }
 
 // ------------------------------------------------------------------------
@@ -1704,6 +2766,18 @@ public:
     unsigned int get_dynamic_group_segment_size() const __CPU__ {
         return dynamic_group_segment_size;
     }
+
+    /**
+     * Reserves the elements of "buf" in the dynamic group segment, after
+     * those reserved before. The function should be called in host code,
+     * prior to a kernel is dispatched.
+     *
+     * @param[in,out] buf The buffer to place in the dynamic group segment.
+     */
+    template <typename T>
+    void reserve(dynamic_tile_static<T>& buf) __CPU__ {
+        dynamic_group_segment_size = buf.place(dynamic_group_segment_size);
+    }
 };
 
 /**
@@ -1800,6 +2874,18 @@ public:
     unsigned int get_dynamic_group_segment_size() const __CPU__ {
         return dynamic_group_segment_size;
     }
+
+    /**
+     * Reserves the elements of "buf" in the dynamic group segment, after
+     * those reserved before. The function should be called in host code,
+     * prior to a kernel is dispatched.
+     *
+     * @param[in,out] buf The buffer to place in the dynamic group segment.
+     */
+    template <typename T>
+    void reserve(dynamic_tile_static<T>& buf) __CPU__ {
+        dynamic_group_segment_size = buf.place(dynamic_group_segment_size);
+    }
 };
 
 /**
@@ -1902,6 +2988,18 @@ public:
     unsigned int get_dynamic_group_segment_size() const __CPU__ {
         return dynamic_group_segment_size;
     }
+
+    /**
+     * Reserves the elements of "buf" in the dynamic group segment, after
+     * those reserved before. The function should be called in host code,
+     * prior to a kernel is dispatched.
+     *
+     * @param[in,out] buf The buffer to place in the dynamic group segment.
+     */
+    template <typename T>
+    void reserve(dynamic_tile_static<T>& buf) __CPU__ {
+        dynamic_group_segment_size = buf.place(dynamic_group_segment_size);
+    }
 };
 
 // ------------------------------------------------------------------------
@@ -1962,8 +3060,15 @@ tiled_extent<3> extent<N>::tile_with_dynamic(int t0, int t1, int t2, int dynamic
  * Fetch the size of a wavefront
  *
  * @return The size of a wavefront.
+ *
+ * It's the size of the wavefronts the device code is compiled for, 64 unless
+ * it's defined on the command line, as -D__HSA_WAVEFRONT_SIZE__=32 for ISAs
+ * running wave32. Code that has to run on agents of either sizes takes the
+ * size as a template parameter instead, see hc::dispatch_wavefront_size().
  */
+#ifndef __HSA_WAVEFRONT_SIZE__
 #define __HSA_WAVEFRONT_SIZE__ (64)
+#endif
 extern "C" unsigned int __wavesize() __HC__; 
 
 
@@ -1973,6 +3078,40 @@ extern "C" inline unsigned int __wavesize() __HC__ {
 }
 #endif
 
+/**
+ * The size of a wavefront as a type, which selects the variant of a kernel
+ * or a device function for agents of that size.
+ */
+template <unsigned int WaveSize>
+using wavefront_size_t = std::integral_constant<unsigned int, WaveSize>;
+
+/**
+ * Calls f with the wavefront_size_t of the agent of av, wavefront_size_t<32>
+ * or wavefront_size_t<64>, so that the kernels f launches are instantiated
+ * for both sizes and the ones of the agent are selected when they're
+ * launched. Agents which don't report a size, as the CPU accelerator, get
+ * the variant of __HSA_WAVEFRONT_SIZE__.
+ *
+ * The shuffles of a variant take its size as their width, so the wave32
+ * variant still computes the right result on a wave64 agent; only the
+ * variant of the agent makes the most of its wavefronts.
+ *
+ * @param[in] av The accelerator_view the kernels are launched on.
+ * @param[in] f A callable taking a wavefront_size_t; both calls must have
+ *              the same return type.
+ * @return What f returns.
+ */
+template <typename Functor>
+inline auto dispatch_wavefront_size(const accelerator_view& av, Functor&& f)
+    -> decltype(f(wavefront_size_t<__HSA_WAVEFRONT_SIZE__>())) {
+  unsigned int size = av.get_wavefront_size();
+  if (size == 0)
+    size = __HSA_WAVEFRONT_SIZE__;
+  if (size == 32)
+    return f(wavefront_size_t<32>());
+  return f(wavefront_size_t<64>());
+}
+
 /**
  * Count number of 1 bits in the input
  *
@@ -2410,6 +3549,31 @@ union __u {
     float f;
 };
 
+// utility union type of 64-bit values, shuffled as two 32-bit words
+union __u64 {
+    int i[2];
+    int64_t l;
+    uint64_t u;
+    double d;
+};
+
+#define __HC_SHFL_64(NAME, T, M, ARG) \
+inline T NAME(T var, ARG, const int width=__HSA_WAVEFRONT_SIZE__) __HC__ { \
+    __u64 tmp; tmp.M = var; \
+    tmp.i[0] = NAME(tmp.i[0], lane, width); \
+    tmp.i[1] = NAME(tmp.i[1], lane, width); \
+    return tmp.M; \
+}
+
+// unsigned int, 64-bit integer and double variants of a shuffle
+#define __HC_SHFL_VARIANTS(NAME, ARG) \
+inline unsigned int NAME(unsigned int var, ARG, const int width=__HSA_WAVEFRONT_SIZE__) __HC__ { \
+    return static_cast<unsigned int>(NAME(static_cast<int>(var), lane, width)); \
+} \
+__HC_SHFL_64(NAME, int64_t, l, ARG) \
+__HC_SHFL_64(NAME, uint64_t, u, ARG) \
+__HC_SHFL_64(NAME, double, d, ARG)
+
 /** @{ */
 /**
  * Direct copy from indexed active work-item within a wavefront.
@@ -2450,7 +3614,7 @@ inline int __wavefront_shift_right(int var) __HC__ {
 }
 inline int __wavefront_shift_left(int var) __HC__ {
     return  __hsail_activelanepermute_b32(var, __lane_id()+1
-                                        , var, __lane_id()==63);
+                                        , var, __lane_id()==__HSA_WAVEFRONT_SIZE__-1);
 }
 #endif
 
@@ -2493,6 +3657,8 @@ inline float __shfl(float var, int srcLane, int width=__HSA_WAVEFRONT_SIZE__) __
     return tmp.f;
 }
 
+__HC_SHFL_VARIANTS(__shfl, int lane)
+
 // FIXME: support half type
 /** @} */
 
@@ -2548,6 +3714,8 @@ inline float __shfl_up(float var, const unsigned int delta, const int width=__HS
     return tmp.f;
 }
 
+__HC_SHFL_VARIANTS(__shfl_up, const unsigned int lane)
+
 // FIXME: support half type
 /** @} */
 
@@ -2606,6 +3774,8 @@ inline float __shfl_down(float var, const unsigned int delta, const int width=__
     return tmp.f;
 }
 
+__HC_SHFL_VARIANTS(__shfl_down, const unsigned int lane)
+
 
 // FIXME: support half type
 /** @} */
@@ -2660,6 +3830,11 @@ inline float __shfl_xor(float var, int laneMask, int width=__HSA_WAVEFRONT_SIZE_
     return tmp.f;
 }
 
+__HC_SHFL_VARIANTS(__shfl_xor, int lane)
+
+#undef __HC_SHFL_VARIANTS
+#undef __HC_SHFL_64
+
 
 // ------------------------------------------------------------------------
 // group segment
@@ -2691,6 +3866,72 @@ extern "C" __attribute__((address_space(3))) void* get_group_segment_base_pointe
  */
 extern "C" __attribute__((address_space(3))) void* get_dynamic_group_segment_base_pointer() __HC__;
 
+/**
+ * A buffer of elements of type T in the dynamic group segment, tile_static
+ * memory whose size is chosen at runtime. The buffer is reserved in a
+ * tiled_extent on the host, which places it after the buffers reserved
+ * before, and captured by the kernel to access it. The runtime throws if the
+ * static and dynamic group segments of a kernel exceed
+ * accelerator::get_max_tile_static_size().
+ *
+ * @code{.cpp}
+ * hc::dynamic_tile_static<float> cache(tile_size);
+ * hc::tiled_extent<1> ext = hc::extent<1>(n).tile(tile_size);
+ * ext.reserve(cache);
+ * hc::parallel_for_each(ext, [=](hc::tiled_index<1> tidx) [[hc]] {
+ *     cache[tidx.local[0]] = ...;
+ * });
+ * @endcode
+ */
+template <typename T>
+class dynamic_tile_static {
+public:
+    /**
+     * Constructs a buffer of "count" elements, aligned to "alignment" bytes,
+     * a power of 2.
+     */
+    explicit dynamic_tile_static(unsigned int count, unsigned int alignment = alignof(T)) __CPU__
+        : count(count), alignment(alignment), offset(0) {}
+
+    /// the number of elements of this buffer
+    unsigned int size() const __CPU__ __HC__ { return count; }
+
+    /// the alignment of this buffer in bytes
+    unsigned int get_alignment() const __CPU__ __HC__ { return alignment; }
+
+    /**
+     * Returns the address of the first element of this buffer in the group
+     * segment.
+     */
+    __attribute__((address_space(3))) T* data() const __HC__ {
+        typedef __attribute__((address_space(3))) char group_char;
+        group_char* ptr = static_cast<group_char*>(get_dynamic_group_segment_base_pointer()) + offset;
+        // the dynamic group segment starts at the end of the static one,
+        // which is only aligned to the variables in it
+        ptr += (alignment - reinterpret_cast<uintptr_t>(ptr) % alignment) % alignment;
+        return reinterpret_cast<__attribute__((address_space(3))) T*>(ptr);
+    }
+
+    /// the element "i" of this buffer
+    __attribute__((address_space(3))) T& operator[](unsigned int i) const __HC__ { return data()[i]; }
+
+private:
+    template <int N> friend class tiled_extent;
+
+    // places this buffer at the byte "size" of the dynamic group segment,
+    // returns the size of the segment with the buffer
+    unsigned int place(unsigned int size) __CPU__ {
+        offset = size;
+        return size + (alignment - 1) + count * sizeof(T);
+    }
+
+    unsigned int count;
+    unsigned int alignment;
+    // the first byte of this buffer in the dynamic group segment, before
+    // aligning it
+    unsigned int offset;
+};
+
 // ------------------------------------------------------------------------
 // utility class for tiled_barrier
 // ------------------------------------------------------------------------
@@ -2707,6 +3948,8 @@ struct barrier_t {
     int idx;
     barrier_t (int a) :
         ctx(new ucontext_t[a + 1]) {}
+    // barrier of tiles run as plain loops, which can't be waited on
+    barrier_t () : idx(0) {}
     template <typename Ti, typename Ker>
     void setctx(int x, char *stack, Ker& f, Ti* tidx, int S) {
         getcontext(&ctx[x]);
@@ -2719,10 +3962,124 @@ struct barrier_t {
         swapcontext(&ctx[a], &ctx[b]);
     }
     void wait() __HC__ {
+        if (!ctx)
+            throw Kalmar::runtime_exception("tile_barrier::wait() in a kernel declared barrier_free", 0);
         --idx;
         swapcontext(&ctx[idx + 1], &ctx[idx]);
     }
 };
+
+/// whether the stacks of the work-items of tiles run on the CPU are each
+/// preceded by an inaccessible guard page, catching work-items overflowing
+/// their stack. Set when NDEBUG isn't
+#ifndef TILE_STACK_GUARD
+#ifdef NDEBUG
+#define TILE_STACK_GUARD (0)
+#else
+#define TILE_STACK_GUARD (1)
+#endif
+#endif
+
+/// Stacks, tiled indices and barrier of the work-items of the tiles run by
+/// a CPU thread, kept between launches so that tiled launches only allocate
+/// when a larger tile than before is run on the thread
+struct tile_arena {
+    /// size of the guard pages, the stacks being page-aligned
+    static const size_t GUARD_SIZE = 0x1000;
+
+    char* stacks;
+    size_t stackCount;
+    size_t stackMapSize;
+    std::unique_ptr<char[]> indices;
+    size_t indexBytes;
+    std::shared_ptr<barrier_t> barrier;
+    int barrierSize;
+    std::shared_ptr<barrier_t> loopBarrier;
+
+    tile_arena() : stacks(nullptr), stackCount(0), stackMapSize(0),
+                   indexBytes(0), barrierSize(-1) {}
+
+    ~tile_arena() {
+        release_stacks();
+    }
+
+    /// distance between the stacks of consecutive work-items
+    static size_t stack_stride(size_t size) {
+#if TILE_STACK_GUARD
+        return GUARD_SIZE + ((size + GUARD_SIZE - 1) & ~(GUARD_SIZE - 1));
+#else
+        return size;
+#endif
+    }
+
+    /// get the stacks of count work-items, each of size bytes and
+    /// stack_stride(size) apart
+    char* get_stacks(size_t count, size_t size) {
+        if (count > stackCount) {
+            release_stacks();
+#if TILE_STACK_GUARD
+            size_t stride = stack_stride(size);
+            stackMapSize = count * stride;
+            void* p = mmap(nullptr, stackMapSize, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED)
+                throw Kalmar::runtime_exception("unable to map tile stacks", 0);
+            stacks = static_cast<char*>(p);
+            for (size_t i = 0; i < count; ++i)
+                mprotect(stacks + i * stride, GUARD_SIZE, PROT_NONE);
+            stacks += GUARD_SIZE;
+#else
+            stacks = new char[count * size];
+#endif
+            stackCount = count;
+        }
+        return stacks;
+    }
+
+    /// get uninitialized storage for count tiled indices
+    template <typename T>
+    T* get_indices(size_t count) {
+        if (count * sizeof(T) > indexBytes) {
+            indexBytes = count * sizeof(T);
+            indices.reset(new char[indexBytes]);
+        }
+        return reinterpret_cast<T*>(indices.get());
+    }
+
+    /// get the barrier of tiles run as plain loops, which can't be waited on
+    std::shared_ptr<barrier_t> get_loop_barrier() {
+        if (!loopBarrier)
+            loopBarrier = std::make_shared<barrier_t>();
+        return loopBarrier;
+    }
+
+    /// get the barrier of tiles of count work-items
+    std::shared_ptr<barrier_t> get_barrier(int count) {
+        if (count != barrierSize) {
+            barrier = std::make_shared<barrier_t>(count);
+            barrierSize = count;
+        }
+        return barrier;
+    }
+
+    static tile_arena& get() {
+        static thread_local tile_arena arena;
+        return arena;
+    }
+
+private:
+    void release_stacks() {
+        if (stacks == nullptr)
+            return;
+#if TILE_STACK_GUARD
+        munmap(stacks - GUARD_SIZE, stackMapSize);
+#else
+        delete [] stacks;
+#endif
+        stacks = nullptr;
+        stackCount = 0;
+    }
+};
 #endif
 
 
@@ -2731,10 +4088,25 @@ struct barrier_t {
 // ------------------------------------------------------------------------
 
 /**
- * The tile_barrier class is a capability class that is only creatable by the
- * system, and passed to a tiled parallel_for_each function object as part of
- * the tiled_index parameter. It provides member functions, such as wait, whose
- * purpose is to synchronize execution of threads running within the thread
+ * Tells whether a tiled kernel never calls tile_barrier::wait or any of its
+ * variants. On the CPU path, the tiles of such kernels are run as plain loops
+ * over their work-items, instead of switching between a stack per work-item.
+ * Kernel classes may declare a member type named barrier_free, or the trait
+ * may be specialized for them. Kernels the device compiler found no barriers
+ * in are run the same way.
+ */
+template <typename Kernel, typename = void>
+struct is_barrier_free : std::false_type {};
+
+template <typename Kernel>
+struct is_barrier_free<Kernel, typename std::conditional<true, void, typename Kernel::barrier_free>::type>
+    : std::true_type {};
+
+/**
+ * The tile_barrier class is a capability class that is only creatable by the
+ * system, and passed to a tiled parallel_for_each function object as part of
+ * the tiled_index parameter. It provides member functions, such as wait, whose
+ * purpose is to synchronize execution of threads running within the thread
  * tile.
  */
 class tile_barrier {
@@ -2974,7 +4346,8 @@ private:
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
     template<typename K> friend
-        void partitioned_task_tile_3D(K const&, tiled_extent<3> const&, int);
+        void partitioned_task_tile_3D(K const&, tiled_extent<3> const&, int, int);
+    template<typename K, int M> friend struct cpu_tile_loop;
 #endif
 };
 
@@ -3073,7 +4446,8 @@ private:
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
     template<typename K> friend
-        void partitioned_task_tile_1D(K const&, tiled_extent<1> const&, int);
+        void partitioned_task_tile_1D(K const&, tiled_extent<1> const&, int, int);
+    template<typename K, int M> friend struct cpu_tile_loop;
 #endif
 };
 
@@ -3172,7 +4546,8 @@ private:
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
     template<typename K> friend
-        void partitioned_task_tile_2D(K const&, tiled_extent<2> const&, int);
+        void partitioned_task_tile_2D(K const&, tiled_extent<2> const&, int, int);
+    template<typename K, int M> friend struct cpu_tile_loop;
 #endif
 };
 
@@ -3198,27 +4573,129 @@ struct cpu_helper<K, Kernel, K>
 };
 
 template <typename Kernel, int N>
-void partitioned_task(const Kernel& ker, const extent<N>& ext, int part) {
-    index<N> idx;
-    int start = ext[0] * part / Kalmar::NTHREAD;
-    int end = ext[0] * (part + 1) / Kalmar::NTHREAD;
-    for (int i = start; i < end; i++) {
-        idx[0] = i;
-        cpu_helper<1, Kernel, N>::call(ker, idx, ext);
+struct cpu_extent_task
+{
+    static inline __attribute__((always_inline))
+    void run(const Kernel& ker, const extent<N>& ext, int start, int end) {
+        // tasks are the indices of ext in row-major order, so that a range of
+        // tasks walks along the innermost dimension. Each run along it is a loop
+        // whose iterations don't depend on each other, which the host compiler
+        // may vectorize across work-items
+        index<N> idx;
+        int rest = start;
+        for (int d = N - 1; d >= 0; --d) {
+            idx[d] = rest % ext[d];
+            rest /= ext[d];
+        }
+        for (int i = start; i < end; ) {
+            int first = idx[N - 1];
+            int last = std::min(first + (end - i), ext[N - 1]);
+#pragma clang loop vectorize(enable) interleave(enable)
+            for (int x = first; x < last; x++) {
+                index<N> item(idx);
+                item[N - 1] = x;
+                cpu_helper<N, Kernel, N>::call(ker, item, ext);
+            }
+            i += last - first;
+            idx[N - 1] = 0;
+            for (int d = N - 2; d >= 0 && ++idx[d] == ext[d]; --d) {
+                idx[d] = 0;
+            }
+        }
     }
+};
+
+/// the tasks run with the loops compiled for the instruction set of the
+/// host, see Kalmar::run_cpu_task_isa
+template <typename Kernel, int N>
+void partitioned_task(const Kernel& ker, const extent<N>& ext, int start, int end) {
+    Kalmar::run_cpu_task_isa<cpu_extent_task<Kernel, N> >(ker, ext, start, end);
 }
 
+/// the tiles [start, end) of a kernel free of tile barriers, run as plain
+/// loops over their work-items, the innermost along the last dimension of
+/// the tiles so that it walks memory contiguously and vectorizes
+template <typename Kernel, int N> struct cpu_tile_loop;
+
+template <typename Kernel>
+struct cpu_tile_loop<Kernel, 1>
+{
+    static inline __attribute__((always_inline))
+    void run(const Kernel& f, const tiled_extent<1>& ext, int start, int end, tile_barrier& tbar) {
+        int D0 = ext.tile_dim[0];
+        for (int tx = start; tx < end; tx++)
+#pragma clang loop vectorize(enable) interleave(enable)
+            for (int x = 0; x < D0; x++) {
+                tiled_index<1> tidx(tx * D0 + x, x, tx, tbar, D0);
+                f(tidx);
+            }
+    }
+};
+
+template <typename Kernel>
+struct cpu_tile_loop<Kernel, 2>
+{
+    static inline __attribute__((always_inline))
+    void run(const Kernel& f, const tiled_extent<2>& ext, int start, int end, tile_barrier& tbar) {
+        int D0 = ext.tile_dim[0];
+        int D1 = ext.tile_dim[1];
+        const Kalmar::fast_divisor tiles1(ext[1] / D1);
+        for (int t = start; t < end; t++) {
+            int ty = tiles1.div(t);
+            int tx = t - ty * tiles1.get();
+            for (int y = 0; y < D0; y++)
+#pragma clang loop vectorize(enable) interleave(enable)
+                for (int x = 0; x < D1; x++) {
+                    tiled_index<2> tidx(D1 * tx + x, D0 * ty + y, x, y, tx, ty, tbar, D0, D1);
+                    f(tidx);
+                }
+        }
+    }
+};
+
 template <typename Kernel>
-void partitioned_task_tile_1D(Kernel const& f, tiled_extent<1> const& ext, int part) {
+struct cpu_tile_loop<Kernel, 3>
+{
+    static inline __attribute__((always_inline))
+    void run(const Kernel& f, const tiled_extent<3>& ext, int start, int end, tile_barrier& tbar) {
+        int D0 = ext.tile_dim[0];
+        int D1 = ext.tile_dim[1];
+        int D2 = ext.tile_dim[2];
+        const Kalmar::fast_divisor tiles1(ext[1] / D1);
+        const Kalmar::fast_divisor tiles2(ext[2] / D2);
+        for (int t = start; t < end; t++) {
+            int rows = tiles2.div(t);
+            int i = t - rows * tiles2.get();
+            int k = tiles1.div(rows);
+            int j = rows - k * tiles1.get();
+            for (int z = 0; z < D0; z++)
+                for (int y = 0; y < D1; y++)
+#pragma clang loop vectorize(enable) interleave(enable)
+                    for (int x = 0; x < D2; x++) {
+                        tiled_index<3> tidx(D2 * i + x, D1 * j + y, D0 * k + z,
+                                            x, y, z, i, j, k, tbar, D0, D1, D2);
+                        f(tidx);
+                    }
+        }
+    }
+};
+
+template <typename Kernel>
+void partitioned_task_tile_1D(Kernel const& f, tiled_extent<1> const& ext, int start, int end) {
     int D0 = ext.tile_dim[0];
-    int start = (ext[0] / D0) * part / Kalmar::NTHREAD;
-    int end = (ext[0] / D0) * (part + 1) / Kalmar::NTHREAD;
     int stride = end - start;
     if (stride == 0)
         return;
-    char *stk = new char[D0 * SSIZE];
-    tiled_index<1> *tidx = new tiled_index<1>[D0];
-    tile_barrier::pb_t hc_bar = std::make_shared<barrier_t>(D0);
+    if (is_barrier_free<Kernel>::value || Kalmar::is_compiled_barrier_free(f)) {
+        tile_barrier tbar(tile_arena::get().get_loop_barrier());
+        Kalmar::run_cpu_task_isa<cpu_tile_loop<Kernel, 1> >(f, ext, start, end, tbar);
+        return;
+    }
+    tile_arena& arena = tile_arena::get();
+    size_t stackStride = tile_arena::stack_stride(SSIZE);
+    char *stk = arena.get_stacks(D0, SSIZE);
+    tiled_index<1> *tidx = arena.get_indices<tiled_index<1> >(D0);
+    tile_barrier::pb_t hc_bar = arena.get_barrier(D0);
     tile_barrier tbar(hc_bar);
     for (int tx = start; tx < end; tx++) {
         int id = 0;
@@ -3227,7 +4704,7 @@ void partitioned_task_tile_1D(Kernel const& f, tiled_extent<1> const& ext, int p
         for (int x = 0; x < D0; x++) {
             new (tip) tiled_index<1>(tx * D0 + x, x, tx, tbar, D0);
             hc_bar->setctx(++id, sp, f, tip, SSIZE);
-            sp += SSIZE;
+            sp += stackStride;
             ++tip;
         }
         hc_bar->idx = 0;
@@ -3236,133 +4713,149 @@ void partitioned_task_tile_1D(Kernel const& f, tiled_extent<1> const& ext, int p
             hc_bar->swap(0, id);
         }
     }
-    delete [] stk;
-    delete [] tidx;
 }
 
 template <typename Kernel>
-void partitioned_task_tile_2D(Kernel const& f, tiled_extent<2> const& ext, int part) {
+void partitioned_task_tile_2D(Kernel const& f, tiled_extent<2> const& ext, int start, int end) {
     int D0 = ext.tile_dim[0];
     int D1 = ext.tile_dim[1];
-    int start = (ext[0] / D0) * part / Kalmar::NTHREAD;
-    int end = (ext[0] / D0) * (part + 1) / Kalmar::NTHREAD;
     int stride = end - start;
     if (stride == 0)
         return;
-    char *stk = new char[D1 * D0 * SSIZE];
-    tiled_index<2> *tidx = new tiled_index<2>[D0 * D1];
-    tile_barrier::pb_t hc_bar = std::make_shared<barrier_t>(D0 * D1);
+    // tasks are the tiles in row-major order
+    if (is_barrier_free<Kernel>::value || Kalmar::is_compiled_barrier_free(f)) {
+        tile_barrier tbar(tile_arena::get().get_loop_barrier());
+        Kalmar::run_cpu_task_isa<cpu_tile_loop<Kernel, 2> >(f, ext, start, end, tbar);
+        return;
+    }
+    const Kalmar::fast_divisor tiles1(ext[1] / D1);
+
+    tile_arena& arena = tile_arena::get();
+    size_t stackStride = tile_arena::stack_stride(SSIZE);
+    char *stk = arena.get_stacks(D0 * D1, SSIZE);
+    tiled_index<2> *tidx = arena.get_indices<tiled_index<2> >(D0 * D1);
+    tile_barrier::pb_t hc_bar = arena.get_barrier(D0 * D1);
     tile_barrier tbar(hc_bar);
 
-    for (int tx = 0; tx < ext[1] / D1; tx++)
-        for (int ty = start; ty < end; ty++) {
-            int id = 0;
-            char *sp = stk;
-            tiled_index<2> *tip = tidx;
-            for (int x = 0; x < D1; x++)
-                for (int y = 0; y < D0; y++) {
-                    new (tip) tiled_index<2>(D1 * tx + x, D0 * ty + y, x, y, tx, ty, tbar, D0, D1);
-                    hc_bar->setctx(++id, sp, f, tip, SSIZE);
-                    ++tip;
-                    sp += SSIZE;
-                }
-            hc_bar->idx = 0;
-            while (hc_bar->idx == 0) {
-                hc_bar->idx = id;
-                hc_bar->swap(0, id);
+    for (int t = start; t < end; t++) {
+        int ty = tiles1.div(t);
+        int tx = t - ty * tiles1.get();
+        int id = 0;
+        char *sp = stk;
+        tiled_index<2> *tip = tidx;
+        for (int x = 0; x < D1; x++)
+            for (int y = 0; y < D0; y++) {
+                new (tip) tiled_index<2>(D1 * tx + x, D0 * ty + y, x, y, tx, ty, tbar, D0, D1);
+                hc_bar->setctx(++id, sp, f, tip, SSIZE);
+                ++tip;
+                sp += stackStride;
             }
+        hc_bar->idx = 0;
+        while (hc_bar->idx == 0) {
+            hc_bar->idx = id;
+            hc_bar->swap(0, id);
         }
-    delete [] stk;
-    delete [] tidx;
+    }
 }
 
 template <typename Kernel>
-void partitioned_task_tile_3D(Kernel const& f, tiled_extent<3> const& ext, int part) {
+void partitioned_task_tile_3D(Kernel const& f, tiled_extent<3> const& ext, int start, int end) {
     int D0 = ext.tile_dim[0];
     int D1 = ext.tile_dim[1];
     int D2 = ext.tile_dim[2];
-    int start = (ext[0] / D0) * part / Kalmar::NTHREAD;
-    int end = (ext[0] / D0) * (part + 1) / Kalmar::NTHREAD;
     int stride = end - start;
     if (stride == 0)
         return;
-    char *stk = new char[D2 * D1 * D0 * SSIZE];
-    tiled_index<3> *tidx = new tiled_index<3>[D0 * D1 * D2];
-    tile_barrier::pb_t hc_bar = std::make_shared<barrier_t>(D0 * D1 * D2);
+    // tasks are the tiles in row-major order
+    if (is_barrier_free<Kernel>::value || Kalmar::is_compiled_barrier_free(f)) {
+        tile_barrier tbar(tile_arena::get().get_loop_barrier());
+        Kalmar::run_cpu_task_isa<cpu_tile_loop<Kernel, 3> >(f, ext, start, end, tbar);
+        return;
+    }
+    const Kalmar::fast_divisor tiles1(ext[1] / D1);
+    const Kalmar::fast_divisor tiles2(ext[2] / D2);
+
+    tile_arena& arena = tile_arena::get();
+    size_t stackStride = tile_arena::stack_stride(SSIZE);
+    char *stk = arena.get_stacks(D0 * D1 * D2, SSIZE);
+    tiled_index<3> *tidx = arena.get_indices<tiled_index<3> >(D0 * D1 * D2);
+    tile_barrier::pb_t hc_bar = arena.get_barrier(D0 * D1 * D2);
     tile_barrier tbar(hc_bar);
 
-    for (int i = 0; i < ext[2] / D2; i++)
-        for (int j = 0; j < ext[1] / D1; j++)
-            for(int k = start; k < end; k++) {
-                int id = 0;
-                char *sp = stk;
-                tiled_index<3> *tip = tidx;
-                for (int x = 0; x < D2; x++)
-                    for (int y = 0; y < D1; y++)
-                        for (int z = 0; z < D0; z++) {
-                            new (tip) tiled_index<3>(D2 * i + x,
-                                                              D1 * j + y,
-                                                              D0 * k + z,
-                                                              x, y, z, i, j, k, tbar, D0, D1, D2);
-                            hc_bar->setctx(++id, sp, f, tip, SSIZE);
-                            ++tip;
-                            sp += SSIZE;
-                        }
-                hc_bar->idx = 0;
-                while (hc_bar->idx == 0) {
-                    hc_bar->idx = id;
-                    hc_bar->swap(0, id);
+    for (int t = start; t < end; t++) {
+        int rows = tiles2.div(t);
+        int i = t - rows * tiles2.get();
+        int k = tiles1.div(rows);
+        int j = rows - k * tiles1.get();
+        int id = 0;
+        char *sp = stk;
+        tiled_index<3> *tip = tidx;
+        for (int x = 0; x < D2; x++)
+            for (int y = 0; y < D1; y++)
+                for (int z = 0; z < D0; z++) {
+                    new (tip) tiled_index<3>(D2 * i + x,
+                                                      D1 * j + y,
+                                                      D0 * k + z,
+                                                      x, y, z, i, j, k, tbar, D0, D1, D2);
+                    hc_bar->setctx(++id, sp, f, tip, SSIZE);
+                    ++tip;
+                    sp += stackStride;
                 }
-            }
-    delete [] stk;
-    delete [] tidx;
+        hc_bar->idx = 0;
+        while (hc_bar->idx == 0) {
+            hc_bar->idx = id;
+            hc_bar->swap(0, id);
+        }
+    }
 }
 
 template <typename Kernel, int N>
 completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      extent<N> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task<Kernel, N>, std::cref(f), std::cref(compute_domain), i);
-    // FIXME wrap the above operation into the completion_future object
-    return completion_future();
+    return completion_future(Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain](const Kernel& k) {
+        Kalmar::run_cpu_tasks(compute_domain.size(), [&](size_t start, size_t end) {
+            partitioned_task<Kernel, N>(k, compute_domain, start, end);
+        });
+    }));
 }
 
 template <typename Kernel>
 completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      tiled_extent<1> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task_tile_1D<Kernel>,
-                             std::cref(f), std::cref(compute_domain), i);
-    // FIXME wrap the above operation into the completion_future object
-    return completion_future();
+    return completion_future(Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain](const Kernel& k) {
+        Kalmar::run_cpu_tasks(compute_domain[0] / compute_domain.tile_dim[0], [&](size_t start, size_t end) {
+            partitioned_task_tile_1D<Kernel>(k, compute_domain, start, end);
+        });
+    }));
 }
 
 template <typename Kernel>
 completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      tiled_extent<2> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task_tile_2D<Kernel>,
-                             std::cref(f), std::cref(compute_domain), i);
-    // FIXME wrap the above operation into the completion_future object
-    return completion_future();
+    int tiles = (compute_domain[0] / compute_domain.tile_dim[0]) *
+                (compute_domain[1] / compute_domain.tile_dim[1]);
+    return completion_future(Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain, tiles](const Kernel& k) {
+        Kalmar::run_cpu_tasks(tiles, [&](size_t start, size_t end) {
+            partitioned_task_tile_2D<Kernel>(k, compute_domain, start, end);
+        });
+    }));
 }
 
 template <typename Kernel>
 completion_future launch_cpu_task_async(const std::shared_ptr<Kalmar::KalmarQueue>& pQueue, Kernel const& f,
                      tiled_extent<3> const& compute_domain)
 {
-    Kalmar::CPUKernelRAII<Kernel> obj(pQueue, f);
-    for (int i = 0; i < Kalmar::NTHREAD; ++i)
-        obj[i] = std::thread(partitioned_task_tile_3D<Kernel>,
-                             std::cref(f), std::cref(compute_domain), i);
-    // FIXME wrap the above operation into the completion_future object
-    return completion_future();
+    int tiles = (compute_domain[0] / compute_domain.tile_dim[0]) *
+                (compute_domain[1] / compute_domain.tile_dim[1]) *
+                (compute_domain[2] / compute_domain.tile_dim[2]);
+    return completion_future(Kalmar::enqueue_cpu_kernel(pQueue, f, [compute_domain, tiles](const Kernel& k) {
+        Kalmar::run_cpu_tasks(tiles, [&](size_t start, size_t end) {
+            partitioned_task_tile_3D<Kernel>(k, compute_domain, start, end);
+        });
+    }));
 }
 
 #endif
@@ -3416,14 +4909,14 @@ struct projection_helper<T, 1>
     typedef T& result_type;
     static result_type project(array_view<T, 1>& now, int i) __CPU__ __HC__ {
 #if __KALMAR_ACCELERATOR__ != 1
-        now.cache.get_cpu_access(true);
+        now.cache.get_cpu_access(true, i + now.offset + now.index_base[0], 1);
 #endif
         T *ptr = reinterpret_cast<T *>(now.cache.get() + i + now.offset + now.index_base[0]);
         return *ptr;
     }
     static result_type project(const array_view<T, 1>& now, int i) __CPU__ __HC__ {
 #if __KALMAR_ACCELERATOR__ != 1
-        now.cache.get_cpu_access(true);
+        now.cache.get_cpu_access(true, i + now.offset + now.index_base[0], 1);
 #endif
         T *ptr = reinterpret_cast<T *>(now.cache.get() + i + now.offset + now.index_base[0]);
         return *ptr;
@@ -3543,24 +5036,30 @@ struct array_projection_helper
         if( stride < 0)
           throw runtime_exception("errorMsg_throw", 0);
 #endif
-        int comp[N - 1], i;
-        for (i = N - 1; i > 0; --i)
+        int comp[N - 1], base[N - 1], i;
+        for (i = N - 1; i > 0; --i) {
             comp[i - 1] = now.extent[i];
+            base[i - 1] = now.storage[i];
+        }
         extent<N - 1> ext(comp);
-        int offset = ext.size() * stride;
+        extent<N - 1> ext_b(base);
+        int offset = ext_b.size() * stride;
 #if __KALMAR_ACCELERATOR__ != 1
-        if( offset >= now.extent.size())
+        if( offset >= now.storage.size())
           throw runtime_exception("errorMsg_throw", 0);
 #endif
-        return result_type(now.m_device, ext, ext, index<N - 1>(), offset);
+        return result_type(now.m_device, ext, ext_b, index<N - 1>(), offset);
     }
     static const_result_type project(const array<T, N>& now, int stride) __CPU__ __HC__ {
-        int comp[N - 1], i;
-        for (i = N - 1; i > 0; --i)
+        int comp[N - 1], base[N - 1], i;
+        for (i = N - 1; i > 0; --i) {
             comp[i - 1] = now.extent[i];
+            base[i - 1] = now.storage[i];
+        }
         extent<N - 1> ext(comp);
-        int offset = ext.size() * stride;
-        return const_result_type(now.m_device, ext, ext, index<N - 1>(), offset);
+        extent<N - 1> ext_b(base);
+        int offset = ext_b.size() * stride;
+        return const_result_type(now.m_device, ext, ext_b, index<N - 1>(), offset);
     }
 };
 
@@ -3645,6 +5144,21 @@ void copy(const array<T, N> &src, OutputIter destBegin);
 // array
 // ------------------------------------------------------------------------
 
+/**
+ * Requests the pitched layout of a multidimensional array, as in
+ * cudaMallocPitch: each row of the array, along its last dimension, is
+ * padded to a multiple of "alignment" bytes, so every row starts on the same
+ * boundary. Tiles of columns then don't straddle cache lines or memory
+ * channels unevenly, and tile_static copies of rows keep their alignment.
+ */
+struct pitched_layout {
+    explicit pitched_layout(size_t alignment = 256) : alignment(alignment) {}
+
+    /// alignment of the rows in bytes, a multiple of the size of the
+    /// elements, such as 128 or 256
+    size_t alignment;
+};
+
 /**
  * Represents an N-dimensional region of memory (with type T) located on an
  * accelerator.
@@ -3686,7 +5200,7 @@ public:
      *                  this new array.
      */
     array(const array& other)
-        : array(other.get_extent(), other.get_accelerator_view())
+        : array(other.get_extent(), other.get_accelerator_view(), other.storage)
     { copy(other, *this); }
 
     /**
@@ -3697,8 +5211,7 @@ public:
      *                  this new array.
      */
     array(array&& other)
-        : m_device(other.m_device), extent(other.extent)
-    { other.m_device.reset(); }
+        : m_device(std::move(other.m_device)), extent(other.extent), storage(other.storage) {}
 
     /**
      * Constructs a new array with the supplied extent, located on the default
@@ -3819,11 +5332,29 @@ public:
      */
     array(const extent<N>& ext, accelerator_view av, access_type cpu_access_type = access_type_auto)
 #if __KALMAR_ACCELERATOR__ == 1
-        : m_device(ext.size()), extent(ext) {}
+        : m_device(ext.size()), extent(ext), storage(ext) {}
 #else
-        : m_device(av.pQueue, av.pQueue, check(ext).size(), cpu_access_type), extent(ext) {}
+        : m_device(av.pQueue, av.pQueue, check(ext).size(), cpu_access_type), extent(ext), storage(ext) {}
 #endif
 
+    /**
+     * Constructs a new array with the supplied extent, located on the
+     * accelerator_view "av", whose rows are padded to the alignment of
+     * "layout". Kernels, array_views and copies index it as any array, only
+     * the memory behind data() and accelerator_pointer(), which reinterpret_as
+     * and view_as see as well, has get_pitch() bytes between the rows. Only
+     * available on arrays of rank 2 or higher.
+     *
+     * @param[in] ext The extent in each dimension of this array.
+     * @param[in] av An accelerator_view object which specifies the location of
+     *               this array.
+     * @param[in] layout The alignment of the rows of this array.
+     */
+    array(const extent<N>& ext, accelerator_view av, const pitched_layout& layout)
+        : array(ext, av, pitched(ext, layout)) {
+        static_assert(N > 1, "pitched arrays must have a rank of 2 or higher");
+    }
+
     /** @{ */
     /**
      * Constructs an array instance based on the given pointer on the device memory.
@@ -3850,9 +5381,9 @@ public:
      */
     explicit array(const extent<N>& ext, accelerator_view av, void* accelerator_pointer, access_type cpu_access_type = access_type_auto)
 #if __KALMAR_ACCELERATOR__ == 1
-        : m_device(ext.size(), accelerator_pointer), extent(ext) {}
+        : m_device(ext.size(), accelerator_pointer), extent(ext), storage(ext) {}
 #else
-        : m_device(av.pQueue, av.pQueue, check(ext).size(), accelerator_pointer, cpu_access_type), extent(ext) {}
+        : m_device(av.pQueue, av.pQueue, check(ext).size(), accelerator_pointer, cpu_access_type), extent(ext), storage(ext) {}
 #endif
 
     /** @{ */
@@ -3994,9 +5525,9 @@ public:
      */
     array(const extent<N>& ext, accelerator_view av, accelerator_view associated_av)
 #if __KALMAR_ACCELERATOR__ == 1
-        : m_device(ext.size()), extent(ext) {}
+        : m_device(ext.size()), extent(ext), storage(ext) {}
 #else
-        : m_device(av.pQueue, associated_av.pQueue, check(ext).size(), access_type_auto), extent(ext) {}
+        : m_device(av.pQueue, associated_av.pQueue, check(ext).size(), access_type_auto), extent(ext), storage(ext) {}
 #endif
 
     /** @{ */
@@ -4124,7 +5655,38 @@ public:
      * This property returns the CPU "access_type" allowed for this array.
      */
     access_type get_cpu_access_type() const { return m_device.get_access(); }
-  
+
+    /**
+     * Chooses the memory the data of this array is kept in on its
+     * accelerator, moving it there with its contents. This overrides, for
+     * this array, the choice made for the accelerator as a whole.
+     *
+     * hcMemoryPlacementHost: fine-grained host memory, which the host
+     * accesses directly.
+     *
+     * hcMemoryPlacementDevice: coarse-grained device memory, the fastest for
+     * kernels. The host may no longer access the array directly if the
+     * accelerator doesn't share this memory with it.
+     *
+     * hcMemoryPlacementAuto: on accelerators sharing both with the host, as
+     * APUs, the data starts in host memory and moves to whichever memory
+     * served most of its recent accesses. Elsewhere it stays where the
+     * accelerator places it.
+     *
+     * @param[in] placement The memory to keep the data in.
+     */
+    void set_placement(hcMemoryPlacement placement) {
+#if __KALMAR_ACCELERATOR__ != 1
+        m_device.set_placement(placement);
+#endif
+    }
+
+    /**
+     * Returns the placement given through set_placement(),
+     * hcMemoryPlacementDefault if there was none.
+     */
+    hcMemoryPlacement get_placement() const { return m_device.get_placement(); }
+
     /**
      * Assigns the contents of the array "other" to this array, using a deep
      * copy.
@@ -4151,8 +5713,8 @@ public:
     array& operator=(array&& other) {
         if (this != &other) {
             extent = other.extent;
-            m_device = other.m_device;
-            other.m_device.reset();
+            storage = other.storage;
+            m_device = std::move(other.m_device);
         }
         return *this;
     }
@@ -4199,7 +5761,8 @@ public:
     void copy_to(const array_view<T,N>& dest) const { copy(*this, dest); }
 
     /**
-     * Returns a pointer to the raw data underlying this array.
+     * Returns a pointer to the raw data underlying this array. The rows of a
+     * pitched array are get_pitch() bytes apart.
      *
      * @return A (const) pointer to the first element in the linearized array.
      */
@@ -4253,7 +5816,7 @@ public:
         m_device.synchronize(true);
 #endif
         T *ptr = reinterpret_cast<T*>(m_device.get());
-        return ptr[Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx, extent)];
+        return ptr[Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx, storage)];
     }
     T& operator()(const index<N>& idx) __CPU__ __HC__ {
         return (*this)[idx];
@@ -4279,7 +5842,7 @@ public:
         m_device.synchronize();
 #endif
         T *ptr = reinterpret_cast<T*>(m_device.get());
-        return ptr[Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx, extent)];
+        return ptr[Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx, storage)];
     }
     const T& operator()(const index<N>& idx) const __CPU__ __HC__ {
         return (*this)[idx];
@@ -4485,12 +6048,12 @@ public:
 #if __KALMAR_ACCELERATOR__ != 1
             static_assert( ! (std::is_pointer<ElementType>::value ),"can't use pointer in the kernel");
             static_assert( ! (std::is_same<ElementType,short>::value ),"can't use short in the kernel");
-            if( (extent.size() * sizeof(T)) % sizeof(ElementType))
+            if( (storage.size() * sizeof(T)) % sizeof(ElementType))
                 throw runtime_exception("errorMsg_throw", 0);
 #endif
-            int size = extent.size() * sizeof(T) / sizeof(ElementType);
+            int size = storage.size() * sizeof(T) / sizeof(ElementType);
             using buffer_type = typename array_view<ElementType, 1>::acc_buffer_t;
-            array_view<ElementType, 1> av(buffer_type(m_device), extent<1>(size), 0);
+            array_view<ElementType, 1> av(buffer_type(m_device), hc::extent<1>(size), 0);
             return av;
         }
     template <typename ElementType>
@@ -4499,9 +6062,9 @@ public:
             static_assert( ! (std::is_pointer<ElementType>::value ),"can't use pointer in the kernel");
             static_assert( ! (std::is_same<ElementType,short>::value ),"can't use short in the kernel");
 #endif
-            int size = extent.size() * sizeof(T) / sizeof(ElementType);
+            int size = storage.size() * sizeof(T) / sizeof(ElementType);
             using buffer_type = typename array_view<ElementType, 1>::acc_buffer_t;
-            array_view<const ElementType, 1> av(buffer_type(m_device), extent<1>(size), 0);
+            array_view<const ElementType, 1> av(buffer_type(m_device), hc::extent<1>(size), 0);
             return av;
         }
 
@@ -4523,7 +6086,7 @@ public:
     template <int K> array_view<T, K>
         view_as(const extent<K>& viewExtent) __CPU__ __HC__ {
 #if __KALMAR_ACCELERATOR__ != 1
-            if( viewExtent.size() > extent.size())
+            if( viewExtent.size() > storage.size())
                 throw runtime_exception("errorMsg_throw", 0);
 #endif
             array_view<T, K> av(m_device, viewExtent, 0);
@@ -4532,7 +6095,7 @@ public:
     template <int K> array_view<const T, K>
         view_as(const extent<K>& viewExtent) const __CPU__ __HC__ {
 #if __KALMAR_ACCELERATOR__ != 1
-            if( viewExtent.size() > extent.size())
+            if( viewExtent.size() > storage.size())
                 throw runtime_exception("errorMsg_throw", 0);
 #endif
             const array_view<T, K> av(m_device, viewExtent, 0);
@@ -4543,8 +6106,22 @@ public:
 
     ~array() {}
 
+    /**
+     * Returns the number of bytes between the rows of this array, along its
+     * last dimension, which rows are padded to if it's pitched.
+     */
+    size_t get_pitch() const __CPU__ __HC__ { return storage[N - 1] * sizeof(T); }
+
+    /**
+     * Returns whether the rows of this array are padded, see pitched_layout.
+     */
+    bool is_pitched() const __CPU__ __HC__ { return storage[N - 1] != extent[N - 1]; }
+
     // FIXME: functions below may be considered to move to private
     const acc_buffer_t& internal() const __CPU__ __HC__ { return m_device; }
+    /// the extent of the buffer of this array, which is padded along the
+    /// last dimension if the array is pitched
+    hc::extent<N> get_storage_extent() const __CPU__ __HC__ { return storage; }
     int get_offset() const __CPU__ __HC__ { return 0; }
     index<N> get_index_base() const __CPU__ __HC__ { return index<N>(); }
 private:
@@ -4552,6 +6129,28 @@ private:
     template <typename K, int Q> friend struct array_projection_helper;
     acc_buffer_t m_device;
     extent<N> extent;
+    /// the extent of the buffer, extent padded along its last dimension if
+    /// the array is pitched
+    hc::extent<N> storage;
+
+    // the extent of the buffer of a pitched array
+    static hc::extent<N> pitched(const hc::extent<N>& ext, const pitched_layout& layout) {
+        hc::extent<N> padded(ext);
+        size_t row = ext[N - 1] * sizeof(T);
+        size_t alignment = layout.alignment < sizeof(T) ? sizeof(T) : layout.alignment;
+        row = (row + alignment - 1) / alignment * alignment;
+        padded[N - 1] = (row + sizeof(T) - 1) / sizeof(T);
+        return padded;
+    }
+
+    // constructs an array whose buffer has the extent "store"
+    array(const hc::extent<N>& ext, accelerator_view av, const hc::extent<N>& store)
+#if __KALMAR_ACCELERATOR__ == 1
+        : m_device(store.size()), extent(ext), storage(store) {}
+#else
+        : m_device(av.pQueue, av.pQueue, check(store).size(), access_type_auto), extent(check(ext)),
+          storage(store) {}
+#endif
 
     template <typename Q, int K> friend
         void copy(const array<Q, K>&, const array_view<Q, K>&);
@@ -4559,10 +6158,156 @@ private:
         void copy(const array_view<const Q, K>&, array<Q, K>&);
 };
 
+// ------------------------------------------------------------------------
+// host_accessor
+// ------------------------------------------------------------------------
+
+/// whether a host_accessor checks on each access that the data of its
+/// array_view wasn't used on an accelerator since it was created. Set when
+/// NDEBUG isn't
+#ifndef HOST_ACCESSOR_CHECK
+#ifdef NDEBUG
+#define HOST_ACCESSOR_CHECK (0)
+#else
+#define HOST_ACCESSOR_CHECK (1)
+#endif
+#endif
+
+/**
+ * An accessor to the elements of an array_view on the host, returned by
+ * array_view::get_host_accessor(). The data of the view is synchronized to
+ * the host once, when the accessor is created, so that indexing the accessor
+ * costs no more than indexing a pointer, where each access through the
+ * array_view synchronizes it.
+ *
+ * Like the pointer returned by array_view::data(), the accessor is
+ * invalidated once the data of the view is accessed on an accelerator_view
+ * through a parallel_for_each or a copy operation. Unless
+ * HOST_ACCESSOR_CHECK is 0, using it then throws a runtime_exception.
+ */
+template <typename T, int N>
+class host_accessor
+{
+public:
+    typedef typename array_view<T, N>::acc_buffer_t acc_buffer_t;
+
+    /**
+     * The rank of the accessor.
+     */
+    static const int rank = N;
+
+    /**
+     * Returns a reference to the element at the location in N-dimensional
+     * space specified by "idx".
+     */
+    T& operator[] (const index<N>& idx) const {
+        check();
+        return ptr[Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx + index_base, extent_base)];
+    }
+
+    T& operator()(const index<N>& idx) const { return (*this)[idx]; }
+
+    /**
+     * Returns a reference to the element at index i, only available on
+     * accessors of rank 1.
+     */
+    T& operator[] (int i) const {
+        static_assert(N == 1, "operator[](int) is only permissible on host accessors of rank 1");
+        check();
+        return ptr[i + index_base[0]];
+    }
+
+    /**
+     * Returns a pointer to the first element, only available on accessors of
+     * rank 1. The pointer is invalidated along with the accessor.
+     */
+    T* data() const {
+        static_assert(N == 1, "data() is only permissible on host accessors of rank 1");
+        check();
+        return ptr + index_base[0];
+    }
+
+    /**
+     * Returns the extent of the array_view of the accessor.
+     */
+    hc::extent<N> get_extent() const { return extent; }
+
+private:
+    template <typename Q, int K> friend class array_view;
+
+    host_accessor(const acc_buffer_t& cache, const hc::extent<N>& ext, const hc::extent<N>& ext_b,
+                  const index<N>& idx_b, int offset, access_type type)
+        : cache(cache), extent(ext), extent_base(ext_b), index_base(idx_b), ptr(nullptr), queue(nullptr) {
+#if __KALMAR_ACCELERATOR__ != 1
+        // the previous content of a view spanning all the data isn't needed
+        // if it's only going to be written
+        if (type == access_type_write && ext.size() * sizeof(T) == cache.size())
+            cache.discard();
+        cache.get_cpu_access(!std::is_const<T>::value && type != access_type_read);
+        ptr = reinterpret_cast<T*>(cache.get() + offset);
+        queue = cache.get_curr();
+#endif
+    }
+
+    void check() const {
+#if HOST_ACCESSOR_CHECK && __KALMAR_ACCELERATOR__ != 1
+        if (cache.get_curr() != queue)
+            throw runtime_exception("host_accessor used after its array_view was accessed on an accelerator", 0);
+#endif
+    }
+
+    acc_buffer_t cache;
+    hc::extent<N> extent;
+    hc::extent<N> extent_base;
+    index<N> index_base;
+    T* ptr;
+    Kalmar::KalmarQueue* queue;
+};
+
 // ------------------------------------------------------------------------
 // array_view
 // ------------------------------------------------------------------------
 
+/**
+ * Tag of the array_view constructors which map the host memory to the
+ * accelerators instead of copying it: the memory is pinned once, and kernels
+ * access it in place over the bus. This suits data streamed through once by
+ * kernels, such as large memory-mapped files, which would otherwise be copied
+ * into device memory on each access across the host and accelerators.
+ */
+struct zero_copy_t {};
+static const zero_copy_t zero_copy = zero_copy_t();
+
+// Notes the elements of the buffer "cache" a section of extent "ext" at
+// "idx" in a view of extent "base", "offset" elements into the buffer, uses:
+// the rows along the first dimension, which are contiguous unless the
+// section is narrower than the view in the other dimensions. Kernels using
+// the section only synchronize those.
+template <typename Cache, int N>
+inline void set_section_range(Cache& cache, const extent<N>& ext, const extent<N>& base,
+                              const index<N>& idx, int offset) {
+    size_t strides[N];
+    strides[N - 1] = 1;
+    for (int i = N - 1; i > 0; --i)
+        strides[i - 1] = strides[i] * base[i];
+    size_t first = offset;
+    bool contiguous = true;
+    for (int i = 0; i < N; ++i) {
+        first += idx[i] * strides[i];
+        contiguous &= (i == 0 || ext[i] == base[i]);
+    }
+    if (ext.size() == 0 || (first == 0 && ext.size() * sizeof(*cache.get()) >= cache.size())) {
+        cache.set_range(0, 0, 0, 0);
+    } else if (contiguous) {
+        cache.set_range(first, ext.size(), ext.size(), 1);
+    } else {
+        size_t row = 1;
+        for (int i = 1; i < N; ++i)
+            row += (ext[i] - 1) * strides[i];
+        cache.set_range(first, row, strides[0], ext[0]);
+    }
+}
+
 /**
  * The array_view<T,N> type represents a possibly cached view into the data
  * held in an array<T,N>, or a section thereof. It also provides such views
@@ -4604,7 +6349,8 @@ public:
      *                bound to.
      */
     array_view(array<T, N>& src) __CPU__ __HC__
-        : cache(src.internal()), extent(src.get_extent()), extent_base(extent), index_base(), offset(0) {}
+        : cache(src.internal()), extent(src.get_extent()), extent_base(src.get_storage_extent()), index_base(),
+          offset(0) {}
 
     // FIXME: following interfaces were not implemented yet
     // template <typename Container>
@@ -4644,6 +6390,23 @@ public:
         : cache(ext.size(), (T *)(src)), extent(ext), extent_base(ext), offset(0) {}
 #endif
 
+    /**
+     * Constructs an array_view which is bound to the host memory "src", that
+     * accelerators access in place rather than through copies, see
+     * hc::zero_copy_t. Where the memory can't be mapped to an accelerator,
+     * it's copied as for the other constructors.
+     *
+     * @param[in] ext The extent of this array_view.
+     * @param[in] src A pointer to the host memory this array_view will bind
+     *                to, which has at least the size of extent elements.
+     */
+    array_view(const extent<N>& ext, value_type* src, zero_copy_t) __CPU__ __HC__
+#if __KALMAR_ACCELERATOR__ == 1
+        : cache((T *)(src)), extent(ext), extent_base(ext), offset(0) {}
+#else
+        : cache(ext.size(), (T *)(src), true), extent(ext), extent_base(ext), offset(0) {}
+#endif
+
     /**
      * Constructs an array_view which is not bound to a data source. The extent
      * of the array_view is that given by the "extent" argument, and the origin
@@ -4718,6 +6481,16 @@ public:
     array_view(const array_view& other) __CPU__ __HC__
         : cache(other.cache), extent(other.extent), extent_base(other.extent_base), index_base(other.index_base), offset(other.offset) {}
 
+    /**
+     * Move constructor. Constructs an array_view from the supplied argument
+     * other, which no longer refers to the data afterwards.
+     *
+     * @param[in] other An object of type array_view<T,N> from which to
+     *                  initialize this new array_view.
+     */
+    array_view(array_view&& other) __CPU__ __HC__
+        : cache(std::move(other.cache)), extent(other.extent), extent_base(other.extent_base), index_base(other.index_base), offset(other.offset) {}
+
     /**
      * Access the extent that defines the shape of this array_view.
      */
@@ -4753,6 +6526,25 @@ public:
         return *this;
     }
 
+    /**
+     * Moves the array_view "other" to this array_view. "other" no longer
+     * refers to the data afterwards.
+     *
+     * @param[in] other An object of type array_view<T,N> from which to move
+     *                  into this array.
+     * @return Returns *this.
+     */
+    array_view& operator=(array_view&& other) __CPU__ __HC__ {
+        if (this != &other) {
+            cache = std::move(other.cache);
+            extent = other.extent;
+            index_base = other.index_base;
+            extent_base = other.extent_base;
+            offset = other.offset;
+        }
+        return *this;
+    }
+
     /**
      * Copies the data referred to by this array_view to the array given by
      * "dest", as if by calling "copy(*this, dest)"
@@ -4804,6 +6596,20 @@ public:
         return reinterpret_cast<T*>(cache.get() + offset + index_base[0]);
     }
 
+    /**
+     * Returns an accessor to the elements of this array_view on the host,
+     * synchronizing its data to the host once for all the accesses through
+     * the accessor, see host_accessor.
+     *
+     * @param[in] type access_type_read if the elements are only going to be
+     *                 read, access_type_write if they're only going to be
+     *                 written, so their previous content needn't be copied to
+     *                 the host, or access_type_read_write.
+     */
+    host_accessor<T, N> get_host_accessor(access_type type = access_type_read_write) const {
+        return host_accessor<T, N>(cache, extent, extent_base, index_base, offset, type);
+    }
+
     /**
      * Returns a pointer to the device memory underlying this array_view.
      *
@@ -4854,23 +6660,42 @@ public:
      *                 type of access on the data source that the array_view is
      *                 synchronized for.
      */
-    // FIXME: type parameter is not implemented
-    void synchronize() const { cache.get_cpu_access(); }
+    void synchronize(access_type type = access_type_read) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        discard_write_only(type);
+        cache.get_cpu_access((type & access_type_write) != 0);
+#endif
+    }
 
     /**
      * An asynchronous version of synchronize, which returns a completion
      * future object. When the future is ready, the synchronization operation
      * is complete.
      *
+     * Copies from an accelerator to the host are done by a DMA engine, after
+     * the kernels using the data on the accelerator, so they can overlap
+     * with kernels launched afterwards. Accesses to the data on the host wait
+     * for the copy.
+     *
+     * @param[in] type An argument of type "access_type" which specifies the
+     *                 type of access on the data source that the array_view is
+     *                 synchronized for.
      * @return An object of type completion_future that can be used to
      *         determine the status of the asynchronous operation or can be
      *         used to chain other operations to be executed after the
      *         completion of the asynchronous operation.
      */
-    // FIXME: type parameter is not implemented
-    completion_future synchronize_async() const {
-        std::future<void> fut = std::async([&]() mutable { synchronize(); });
-        return completion_future(fut.share());
+    completion_future synchronize_async(access_type type = access_type_read) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        discard_write_only(type);
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = cache.get_cpu_access_async((type & access_type_write) != 0);
+        if (op != nullptr) {
+            return completion_future(op);
+        }
+#endif
+        std::promise<void> done;
+        done.set_value();
+        return completion_future(done.get_future().share());
     }
 
     /**
@@ -4906,10 +6731,10 @@ public:
      *                 type of access on the data source that the array_view is
      *                 synchronized for.
      */
-    // FIXME: type parameter is not implemented
-    void synchronize_to(const accelerator_view& av) const {
+    void synchronize_to(const accelerator_view& av, access_type type = access_type_read) const {
 #if __KALMAR_ACCELERATOR__ != 1
-        cache.sync_to(av.pQueue);
+        discard_write_only(type);
+        cache.sync_to(av.pQueue, (type & access_type_write) != 0);
 #endif
     }
 
@@ -4928,8 +6753,88 @@ public:
      *         used to chain other operations to be executed after the
      *         completion of the asynchronous operation.
      */
-    // FIXME: this method is not implemented yet
-    completion_future synchronize_to_async(const accelerator_view& av) const;
+    completion_future synchronize_to_async(const accelerator_view& av,
+                                           access_type type = access_type_read) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        discard_write_only(type);
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = cache.prefetch(av.pQueue, (type & access_type_write) != 0);
+        if (op != nullptr) {
+            return completion_future(op);
+        }
+#endif
+        std::promise<void> done;
+        done.set_value();
+        return completion_future(done.get_future().share());
+    }
+
+    /**
+     * Starts copying the data underlying this array_view to the specified
+     * accelerator_view "av" for reading, so a later kernel on "av" doesn't
+     * wait for the copy when it's launched. Copies between the host and an
+     * accelerator are done by a DMA engine, others synchronously.
+     *
+     * @param[in] av The target accelerator_view.
+     * @return An object of type completion_future which is ready once the
+     *         data is on "av". Kernels launched on "av" after this call wait
+     *         for the copy on the accelerator.
+     */
+    completion_future prefetch_async(const accelerator_view& av) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = cache.prefetch(av.pQueue);
+        if (op != nullptr) {
+            return completion_future(op);
+        }
+#endif
+        std::promise<void> done;
+        done.set_value();
+        return completion_future(done.get_future().share());
+    }
+
+    /**
+     * Gives the runtime a hint about how the data underlying this array_view
+     * is used. It doesn't change the contents of the data.
+     *
+     * hcMemoryAdviseReadMostly: the data is mostly read, kernels reading it
+     * on an accelerator the data isn't on copy it there asynchronously, as
+     * if by prefetch_async().
+     *
+     * hcMemoryAdvisePreferredLocation: if the data is first used on the host,
+     * it's allocated on "av" rather than on the default accelerator.
+     *
+     * @param[in] advice The hint.
+     * @param[in] av The preferred accelerator_view, for
+     *               hcMemoryAdvisePreferredLocation.
+     */
+    void advise(hcMemoryAdvice advice, const accelerator_view& av) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        cache.advise(advice, av.pQueue);
+#endif
+    }
+
+    void advise(hcMemoryAdvice advice) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        cache.advise(advice, nullptr);
+#endif
+    }
+
+    /**
+     * Copies the data underlying this array_view to all the specified
+     * accelerator_views for reading, directly between accelerators which are
+     * peers where possible. The copies stay valid on all of them, so kernels
+     * reading the data on any of them need no further copy until the data is
+     * modified. It implies the hcMemoryAdviseReadMostly hint.
+     *
+     * @param[in] views The accelerator_views to replicate the data on.
+     */
+    void replicate(const std::vector<accelerator_view>& views) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        std::vector< std::shared_ptr<Kalmar::KalmarQueue> > queues;
+        for (auto& av : views) {
+            queues.push_back(av.pQueue);
+        }
+        cache.replicate(queues);
+#endif
+    }
 
     /**
      * Indicates to the runtime that it may discard the current logical
@@ -4953,17 +6858,71 @@ public:
      *                the element.
      */
     T& operator[] (const index<N>& idx) const __CPU__ __HC__ {
+        int i = Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx + index_base, extent_base);
 #if __KALMAR_ACCELERATOR__ != 1
-        cache.get_cpu_access(true);
+        // only the element may be modified, other copies of the data stay
+        // valid elsewhere
+        cache.get_cpu_access(true, offset + i, 1);
 #endif
         T *ptr = reinterpret_cast<T*>(cache.get() + offset);
-        return ptr[Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx + index_base, extent_base)];
+        return ptr[i];
     }
 
     T& operator()(const index<N>& idx) const __CPU__ __HC__ {
         return (*this)[idx];
     }
 
+    /** @{ */
+    /**
+     * Loads the K elements of this array_view from "idx" on, along the last
+     * dimension, as a short vector (such as float_4), with a single load of
+     * the whole vector. The short vector types are defined in
+     * hc_short_vector.hpp.
+     *
+     * The elements must be aligned to the size of the short vector, and lie
+     * within the row of "idx", otherwise a runtime_exception is thrown on the
+     * host, and the behavior is undefined on the accelerator.
+     *
+     * @param[in] idx An object of type index<N> that specifies the location of
+     *                the first element.
+     */
+    template <int K>
+    typename short_vector::short_vector<T, K>::type
+        load_vec(const index<N>& idx) const __CPU__ __HC__ {
+        typedef typename short_vector::short_vector<T, K>::type vec_type;
+        int i = Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx + index_base, extent_base);
+#if __KALMAR_ACCELERATOR__ != 1
+        check_vec(idx, offset + i, K, sizeof(vec_type));
+        cache.get_cpu_access(false, offset + i, K);
+#endif
+        const T *ptr = reinterpret_cast<T*>(cache.get() + offset) + i;
+        return *static_cast<const vec_type*>(__builtin_assume_aligned(ptr, sizeof(vec_type)));
+    }
+
+    /**
+     * Stores the short vector "vec" to the K elements of this array_view from
+     * "idx" on, along the last dimension, with a single store of the whole
+     * vector. The same requirements as for load_vec apply.
+     *
+     * @param[in] idx An object of type index<N> that specifies the location of
+     *                the first element.
+     * @param[in] vec The short vector of the elements to store.
+     */
+    template <int K>
+    void store_vec(const index<N>& idx,
+                   const typename short_vector::short_vector<T, K>::type& vec) const __CPU__ __HC__ {
+        typedef typename short_vector::short_vector<T, K>::type vec_type;
+        int i = Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx + index_base, extent_base);
+#if __KALMAR_ACCELERATOR__ != 1
+        check_vec(idx, offset + i, K, sizeof(vec_type));
+        cache.get_cpu_access(true, offset + i, K);
+#endif
+        T *ptr = reinterpret_cast<T*>(cache.get() + offset) + i;
+        *static_cast<vec_type*>(__builtin_assume_aligned(ptr, sizeof(vec_type))) = vec;
+    }
+
+    /** @} */
+
     /** @} */
 
     /**
@@ -5118,11 +7077,13 @@ public:
             static_assert( ! (std::is_same<ElementType,short>::value ),"can't use short in the kernel");
             if ( (extent.size() * sizeof(T)) % sizeof(ElementType))
                 throw runtime_exception("errorMsg_throw", 0);
+            if ( ((offset + index_base[0]) * sizeof(T)) % sizeof(ElementType))
+                throw runtime_exception("reinterpret_as of an unaligned array_view", 0);
 #endif
             int size = extent.size() * sizeof(T) / sizeof(ElementType);
             using buffer_type = typename array_view<ElementType, 1>::acc_buffer_t;
             array_view<ElementType, 1> av(buffer_type(cache),
-                                          extent<1>(size),
+                                          hc::extent<1>(size),
                                           (offset + index_base[0])* sizeof(T) / sizeof(ElementType));
             return av;
         }
@@ -5174,17 +7135,43 @@ private:
     template <typename Q, int K> friend
         void copy(const array_view<const Q, K>& src, const array_view<Q, K>& dest);
   
+    // the previous content of the data isn't needed if it's only going to be
+    // written, and the view spans all of it
+    void discard_write_only(access_type type) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        if (type == access_type_write && extent.size() * sizeof(T) == cache.size())
+            cache.discard();
+#endif
+    }
+
+    // the K elements from "idx" on, element "i" of the buffer, must be
+    // within the row of "idx", and aligned to the short vector of them
+    void check_vec(const index<N>& idx, int i, int K, size_t size) const {
+        if (idx[N - 1] < 0 || idx[N - 1] + K > extent[N - 1])
+            throw runtime_exception("short vector out of the row of the array_view", 0);
+        if ((reinterpret_cast<uintptr_t>(cache.get()) + i * sizeof(T)) % size)
+            throw runtime_exception("short vector not aligned", 0);
+    }
+
     // used by view_as and reinterpret_as
     array_view(const acc_buffer_t& cache, const hc::extent<N>& ext,
                int offset) __CPU__ __HC__
-        : cache(cache), extent(ext), extent_base(ext), offset(offset) {}
+        : cache(cache), extent(ext), extent_base(ext), offset(offset) {
+#if __KALMAR_ACCELERATOR__ != 1
+        set_section_range(this->cache, ext, ext, index<N>(), offset);
+#endif
+    }
 
     // used by section and projection
     array_view(const acc_buffer_t& cache, const hc::extent<N>& ext_now,
                const hc::extent<N>& ext_b,
                const index<N>& idx_b, int off) __CPU__ __HC__
         : cache(cache), extent(ext_now), extent_base(ext_b), index_base(idx_b),
-        offset(off) {}
+        offset(off) {
+#if __KALMAR_ACCELERATOR__ != 1
+        set_section_range(this->cache, ext_now, ext_b, idx_b, off);
+#endif
+    }
   
     acc_buffer_t cache;
     hc::extent<N> extent;
@@ -5240,7 +7227,8 @@ public:
      *                bound to.
      */
     array_view(const array<T,N>& src) __CPU__ __HC__
-        : cache(src.internal()), extent(src.get_extent()), extent_base(extent), index_base(), offset(0) {}
+        : cache(src.internal()), extent(src.get_extent()), extent_base(src.get_storage_extent()), index_base(),
+          offset(0) {}
 
     // FIXME: following interfaces were not implemented yet
     // template <typename Container>
@@ -5280,6 +7268,22 @@ public:
         : cache(ext.size(), src), extent(ext), extent_base(ext), offset(0) {}
 #endif
 
+    /**
+     * Constructs an array_view which is bound to the host memory "src", that
+     * accelerators read in place rather than through copies, see
+     * hc::zero_copy_t.
+     *
+     * @param[in] ext The extent of this array_view.
+     * @param[in] src A pointer to the host memory this array_view will bind
+     *                to, which has at least the size of extent elements.
+     */
+    array_view(const extent<N>& ext, const value_type* src, zero_copy_t) __CPU__ __HC__
+#if __KALMAR_ACCELERATOR__ == 1
+        : cache((nc_T*)(src)), extent(ext), extent_base(ext), offset(0) {}
+#else
+        : cache(ext.size(), src, true), extent(ext), extent_base(ext), offset(0) {}
+#endif
+
     /**
      * Equivalent to construction using
      * "array_view(extent<N>(e0 [, e1 [, e2 ]]), src)".
@@ -5337,6 +7341,16 @@ public:
     array_view(const array_view& other) __CPU__ __HC__
         : cache(other.cache), extent(other.extent), extent_base(other.extent_base), index_base(other.index_base), offset(other.offset) {}
 
+    /**
+     * Move constructor. Constructs an array_view from the supplied argument
+     * other, which no longer refers to the data afterwards.
+     *
+     * @param[in] other An object of type array_view<T,N> from which to
+     *                  initialize this new array_view.
+     */
+    array_view(array_view&& other) __CPU__ __HC__
+        : cache(std::move(other.cache)), extent(other.extent), extent_base(other.extent_base), index_base(other.index_base), offset(other.offset) {}
+
     /**
      * Access the extent that defines the shape of this array_view.
      */
@@ -5382,6 +7396,25 @@ public:
         return *this;
     }
 
+    /**
+     * Moves the array_view "other" to this array_view. "other" no longer
+     * refers to the data afterwards.
+     *
+     * @param[in] other An object of type array_view<T,N> from which to move
+     *                  into this array.
+     * @return Returns *this.
+     */
+    array_view& operator=(array_view&& other) __CPU__ __HC__ {
+        if (this != &other) {
+            cache = std::move(other.cache);
+            extent = other.extent;
+            index_base = other.index_base;
+            extent_base = other.extent_base;
+            offset = other.offset;
+        }
+        return *this;
+    }
+
     /** @} */
 
     /**
@@ -5425,6 +7458,15 @@ public:
         return reinterpret_cast<const T*>(cache.get() + offset + index_base[0]);
     }
 
+    /**
+     * Returns an accessor to the elements of this array_view on the host,
+     * synchronizing its data to the host once for all the reads through the
+     * accessor, see host_accessor.
+     */
+    host_accessor<const T, N> get_host_accessor() const {
+        return host_accessor<const T, N>(cache, extent, extent_base, index_base, offset, access_type_read);
+    }
+
     /**
      * Returns a pointer to the device memory underlying this array_view.
      *
@@ -5484,8 +7526,15 @@ public:
      *         completion of the asynchronous operation.
      */
     completion_future synchronize_async() const {
-        std::future<void> fut = std::async([&]() mutable { synchronize(); });
-        return completion_future(fut.share());
+#if __KALMAR_ACCELERATOR__ != 1
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = cache.get_cpu_access_async();
+        if (op != nullptr) {
+            return completion_future(op);
+        }
+#endif
+        std::promise<void> done;
+        done.set_value();
+        return completion_future(done.get_future().share());
     }
 
     /**
@@ -5501,27 +7550,97 @@ public:
      */
     void synchronize_to(const accelerator_view& av) const {
 #if __KALMAR_ACCELERATOR__ != 1
-        cache.sync_to(av.pQueue);
+        cache.sync_to(av.pQueue);
+#endif
+    }
+
+    /**
+     * An asynchronous version of synchronize_to, which returns a completion
+     * future object. When the future is ready, the synchronization operation
+     * is complete.
+     *
+     * @param[in] av The target accelerator_view that "this" array_view is
+     *               synchronized for access on.
+     * @param[in] type An argument of type "access_type" which specifies the
+     *                 type of access on the data source that the array_view is
+     *                 synchronized for.
+     * @return An object of type completion_future that can be used to
+     *         determine the status of the asynchronous operation or can be
+     *         used to chain other operations to be executed after the
+     *         completion of the asynchronous operation.
+     */
+    completion_future synchronize_to_async(const accelerator_view& av) const {
+        return prefetch_async(av);
+    }
+
+    /**
+     * Starts copying the data underlying this array_view to the specified
+     * accelerator_view "av" for reading, so a later kernel on "av" doesn't
+     * wait for the copy when it's launched. Copies between the host and an
+     * accelerator are done by a DMA engine, others synchronously.
+     *
+     * @param[in] av The target accelerator_view.
+     * @return An object of type completion_future which is ready once the
+     *         data is on "av". Kernels launched on "av" after this call wait
+     *         for the copy on the accelerator.
+     */
+    completion_future prefetch_async(const accelerator_view& av) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = cache.prefetch(av.pQueue);
+        if (op != nullptr) {
+            return completion_future(op);
+        }
+#endif
+        std::promise<void> done;
+        done.set_value();
+        return completion_future(done.get_future().share());
+    }
+
+    /**
+     * Gives the runtime a hint about how the data underlying this array_view
+     * is used. It doesn't change the contents of the data.
+     *
+     * hcMemoryAdviseReadMostly: the data is mostly read, kernels reading it
+     * on an accelerator the data isn't on copy it there asynchronously, as
+     * if by prefetch_async().
+     *
+     * hcMemoryAdvisePreferredLocation: if the data is first used on the host,
+     * it's allocated on "av" rather than on the default accelerator.
+     *
+     * @param[in] advice The hint.
+     * @param[in] av The preferred accelerator_view, for
+     *               hcMemoryAdvisePreferredLocation.
+     */
+    void advise(hcMemoryAdvice advice, const accelerator_view& av) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        cache.advise(advice, av.pQueue);
+#endif
+    }
+
+    void advise(hcMemoryAdvice advice) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        cache.advise(advice, nullptr);
 #endif
     }
 
     /**
-     * An asynchronous version of synchronize_to, which returns a completion
-     * future object. When the future is ready, the synchronization operation
-     * is complete.
+     * Copies the data underlying this array_view to all the specified
+     * accelerator_views for reading, directly between accelerators which are
+     * peers where possible. The copies stay valid on all of them, so kernels
+     * reading the data on any of them need no further copy until the data is
+     * modified. It implies the hcMemoryAdviseReadMostly hint.
      *
-     * @param[in] av The target accelerator_view that "this" array_view is
-     *               synchronized for access on.
-     * @param[in] type An argument of type "access_type" which specifies the
-     *                 type of access on the data source that the array_view is
-     *                 synchronized for.
-     * @return An object of type completion_future that can be used to
-     *         determine the status of the asynchronous operation or can be
-     *         used to chain other operations to be executed after the
-     *         completion of the asynchronous operation.
+     * @param[in] views The accelerator_views to replicate the data on.
      */
-    // FIXME: this method is not implemented yet
-    completion_future synchronize_to_async(const accelerator_view& av) const;
+    void replicate(const std::vector<accelerator_view>& views) const {
+#if __KALMAR_ACCELERATOR__ != 1
+        std::vector< std::shared_ptr<Kalmar::KalmarQueue> > queues;
+        for (auto& av : views) {
+            queues.push_back(av.pQueue);
+        }
+        cache.replicate(queues);
+#endif
+    }
 
     /** @{ */
     /**
@@ -5542,6 +7661,26 @@ public:
         return (*this)[idx];
     }
 
+    /**
+     * Loads the K elements of this array_view from "idx" on, along the last
+     * dimension, as a short vector, see array_view<T,N>::load_vec.
+     *
+     * @param[in] idx An object of type index<N> that specifies the location of
+     *                the first element.
+     */
+    template <int K>
+    typename short_vector::short_vector<T, K>::type
+        load_vec(const index<N>& idx) const __CPU__ __HC__ {
+        typedef typename short_vector::short_vector<T, K>::type vec_type;
+        int i = Kalmar::amp_helper<N, index<N>, hc::extent<N>>::flatten(idx + index_base, extent_base);
+#if __KALMAR_ACCELERATOR__ != 1
+        check_vec(idx, offset + i, K, sizeof(vec_type));
+        cache.get_cpu_access();
+#endif
+        const T *ptr = reinterpret_cast<const T*>(cache.get() + offset) + i;
+        return *static_cast<const vec_type*>(__builtin_assume_aligned(ptr, sizeof(vec_type)));
+    }
+
     /** @} */
 
     /**
@@ -5697,11 +7836,13 @@ public:
 #if __KALMAR_ACCELERATOR__ != 1
             static_assert( ! (std::is_pointer<ElementType>::value ),"can't use pointer in the kernel");
             static_assert( ! (std::is_same<ElementType,short>::value ),"can't use short in the kernel");
+            if ( ((offset + index_base[0]) * sizeof(T)) % sizeof(ElementType))
+                throw runtime_exception("reinterpret_as of an unaligned array_view", 0);
 #endif
             int size = extent.size() * sizeof(T) / sizeof(ElementType);
             using buffer_type = typename array_view<ElementType, 1>::acc_buffer_t;
             array_view<const ElementType, 1> av(buffer_type(cache),
-                                                extent<1>(size),
+                                                hc::extent<1>(size),
                                                 (offset + index_base[0])* sizeof(T) / sizeof(ElementType));
             return av;
         }
@@ -5753,17 +7894,34 @@ private:
     template <typename Q, int K> friend
         void copy(const array_view<const Q, K>& src, const array_view<Q, K>& dest);
   
+    // the K elements from "idx" on, element "i" of the buffer, must be
+    // within the row of "idx", and aligned to the short vector of them
+    void check_vec(const index<N>& idx, int i, int K, size_t size) const {
+        if (idx[N - 1] < 0 || idx[N - 1] + K > extent[N - 1])
+            throw runtime_exception("short vector out of the row of the array_view", 0);
+        if ((reinterpret_cast<uintptr_t>(cache.get()) + i * sizeof(T)) % size)
+            throw runtime_exception("short vector not aligned", 0);
+    }
+
     // used by view_as and reinterpret_as
     array_view(const acc_buffer_t& cache, const hc::extent<N>& ext,
                int offset) __CPU__ __HC__
-        : cache(cache), extent(ext), extent_base(ext), offset(offset) {}
+        : cache(cache), extent(ext), extent_base(ext), offset(offset) {
+#if __KALMAR_ACCELERATOR__ != 1
+        set_section_range(this->cache, ext, ext, index<N>(), offset);
+#endif
+    }
   
     // used by section and projection
     array_view(const acc_buffer_t& cache, const hc::extent<N>& ext_now,
                const extent<N>& ext_b,
                const index<N>& idx_b, int off) __CPU__ __HC__
         : cache(cache), extent(ext_now), extent_base(ext_b), index_base(idx_b),
-        offset(off) {}
+        offset(off) {
+#if __KALMAR_ACCELERATOR__ != 1
+        set_section_range(this->cache, ext_now, ext_b, idx_b, off);
+#endif
+    }
   
     acc_buffer_t cache;
     hc::extent<N> extent;
@@ -5880,6 +8038,20 @@ struct copy_bidir<T, N, N>
     }
 };
 
+// whether the range of a copy has size elements, so the copy overwrites all
+// of its destination; the range of input iterators can't be measured
+// without consuming it
+template <typename Iter>
+bool copy_covers(Iter srcBegin, Iter srcEnd, size_t size, std::input_iterator_tag) { return false; }
+template <typename Iter>
+bool copy_covers(Iter srcBegin, Iter srcEnd, size_t size, std::forward_iterator_tag) {
+    return std::distance(srcBegin, srcEnd) == static_cast<typename std::iterator_traits<Iter>::difference_type>(size);
+}
+template <typename Iter>
+bool copy_covers(Iter srcBegin, Iter srcEnd, size_t size) {
+    return copy_covers(srcBegin, srcEnd, size, typename std::iterator_traits<Iter>::iterator_category());
+}
+
 template <typename Iter, typename T, int N>
 struct do_copy
 {
@@ -5888,10 +8060,11 @@ struct do_copy
         size_t size = dest.get_extent().size();
         size_t offset = dest.get_offset();
         bool modify = true;
+        bool overwrite = copy_covers(srcBegin, srcEnd, size);
 
-        T* ptr = dest.internal().map_ptr(modify, size, offset);
+        T* ptr = dest.internal().map_ptr(modify, size, offset, overwrite);
          std::copy(srcBegin, srcEnd, ptr);
-        dest.internal().unmap_ptr(ptr, modify, size, offset);
+        dest.internal().unmap_ptr(ptr, modify, size, offset, overwrite);
     }
     template<template <typename, int> class _amp_container>
     void operator()(const _amp_container<T, N> &src, Iter destBegin) {
@@ -5913,10 +8086,11 @@ struct do_copy<Iter, T, 1>
         size_t size = dest.get_extent().size();
         size_t offset = dest.get_offset() + dest.get_index_base()[0];
         bool modify = true;
+        bool overwrite = copy_covers(srcBegin, srcEnd, size);
 
-        T* ptr = dest.internal().map_ptr(modify, size, offset);
+        T* ptr = dest.internal().map_ptr(modify, size, offset, overwrite);
          std::copy(srcBegin, srcEnd, ptr);
-        dest.internal().unmap_ptr(ptr, modify, size, offset);
+        dest.internal().unmap_ptr(ptr, modify, size, offset, overwrite);
     }
     template<template <typename, int> class _amp_container>
     void operator()(const _amp_container<T, 1> &src, Iter destBegin) {
@@ -5972,6 +8146,11 @@ struct do_copy<T*, T, 1>
  */
 template <typename T, int N>
 void copy(const array<T, N>& src, array<T, N>& dest) {
+    if (src.get_storage_extent() != dest.get_storage_extent()) {
+        // the rows of one array are padded differently from the other
+        copy(array_view<const T, N>(src), array_view<T, N>(dest));
+        return;
+    }
     src.internal().copy(dest.internal(), 0, 0, 0);
 }
 
@@ -5985,7 +8164,9 @@ void copy(const array<T, N>& src, array<T, N>& dest) {
  */
 template <typename T, int N>
 void copy(const array<T, N>& src, const array_view<T, N>& dest) {
-    if (is_flat(dest))
+    if (src.is_pitched())
+        copy(array_view<const T, N>(src), dest);
+    else if (is_flat(dest))
         src.internal().copy(dest.internal(), src.get_offset(),
                             dest.get_offset(), dest.get_extent().size());
     else {
@@ -6027,7 +8208,9 @@ void copy(const array<T, 1>& src, const array_view<T, 1>& dest) {
  */
 template <typename T, int N>
 void copy(const array_view<const T, N>& src, array<T, N>& dest) {
-    if (is_flat(src)) {
+    if (dest.is_pitched()) {
+        copy(src, array_view<T, N>(dest));
+    } else if (is_flat(src)) {
         src.internal().copy(dest.internal(), src.get_offset(),
                             dest.get_offset(), dest.get_extent().size());
     } else {
@@ -6166,6 +8349,19 @@ void copy(InputIter srcBegin, InputIter srcEnd, array<T, N>& dest) {
     if( ( std::distance(srcBegin,srcEnd) <=0 )||( std::distance(srcBegin,srcEnd) < dest.get_extent().size() ))
       throw runtime_exception("errorMsg_throw ,copy between different types", 0);
 #endif
+    if (dest.is_pitched()) {
+        size_t size = dest.get_storage_extent().size();
+        size_t offset = 0;
+        bool modify = true;
+        // all the elements are written, and the padding of the rows holds
+        // nothing
+        bool overwrite = true;
+
+        T* ptr = dest.internal().map_ptr(modify, size, offset, overwrite);
+        copy_input<InputIter, T, N, 1>()(srcBegin, ptr, dest.get_extent(), dest.get_storage_extent(), index<N>());
+        dest.internal().unmap_ptr(ptr, modify, size, offset, overwrite);
+        return;
+    }
     do_copy<InputIter, T, N>()(srcBegin, srcEnd, dest);
 }
 
@@ -6228,6 +8424,16 @@ void copy(InputIter srcBegin, const array_view<T, N>& dest) {
  */
 template <typename OutputIter, typename T, int N>
 void copy(const array<T, N> &src, OutputIter destBegin) {
+    if (src.is_pitched()) {
+        size_t size = src.get_storage_extent().size();
+        size_t offset = 0;
+        bool modify = false;
+
+        const T* ptr = src.internal().map_ptr(modify, size, offset);
+        copy_output<OutputIter, T, N, 1>()(ptr, destBegin, src.get_extent(), src.get_storage_extent(), index<N>());
+        src.internal().unmap_ptr(ptr, modify, size, offset);
+        return;
+    }
     do_copy<OutputIter, T, N>()(src, destBegin);
 }
 
@@ -6260,6 +8466,54 @@ void copy(const array_view<T, N> &src, OutputIter destBegin) {
 // utility function for copy_async
 // ------------------------------------------------------------------------
 
+// copy between the buffers of flat containers with an asynchronous copy of
+// the runtime, the returned future is ready if the runtime copied the data
+// synchronously
+template <typename SrcBuffer, typename DstBuffer>
+completion_future copy_async_flat(const SrcBuffer& src, const DstBuffer& dest,
+                                  int src_offset, int dst_offset, int size) {
+    std::shared_ptr<Kalmar::KalmarAsyncOp> op = src.copy_async(dest, src_offset, dst_offset, size);
+    if (op != nullptr) {
+        return completion_future(op);
+    }
+    std::promise<void> done;
+    done.set_value();
+    return completion_future(done.get_future().share());
+}
+
+template <typename T, int N>
+static inline int copy_async_offset(const array_view<T, N>& av) { return av.get_offset(); }
+
+template <typename T>
+static inline int copy_async_offset(const array_view<T, 1>& av) { return av.get_offset() + av.get_index_base()[0]; }
+
+// copy "size" elements from "srcBegin" into the buffer of a flat container:
+// they are gathered into a staging buffer at once, which an asynchronous
+// copy of the runtime writes to the accelerator and holds until it completes
+template <typename T, typename InputIter, typename DstBuffer>
+completion_future copy_async_staged(InputIter srcBegin, int size, const DstBuffer& dest, int dst_offset) {
+    std::shared_ptr<std::vector<T> > stage = std::make_shared<std::vector<T> >();
+    stage->reserve(size);
+    std::copy_n(srcBegin, size, std::back_inserter(*stage));
+    std::shared_ptr<Kalmar::KalmarAsyncOp> op =
+        dest.write_async(std::shared_ptr<const void>(stage, stage->data()), size, dst_offset);
+    if (op != nullptr) {
+        return completion_future(op);
+    }
+    std::promise<void> done;
+    done.set_value();
+    return completion_future(done.get_future().share());
+}
+
+// run a copy the runtime can't do asynchronously on a thread of its own, so
+// it starts at once rather than at the first wait on the future; the future
+// blocks until the copy is done when it's the last one to be destroyed
+template <typename Func>
+completion_future copy_async_thread(Func copy) {
+    std::future<void> fut = std::async(std::launch::async, std::move(copy));
+    return completion_future(fut.share());
+}
+
 
 // ------------------------------------------------------------------------
 // copy_async
@@ -6275,8 +8529,12 @@ void copy(const array_view<T, N> &src, OutputIter destBegin) {
  */
 template <typename T, int N>
 completion_future copy_async(const array<T, N>& src, array<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&]() mutable { copy(src, dest); });
-    return completion_future(fut.share());
+    if (src.get_storage_extent() != dest.get_storage_extent()) {
+        const array<T, N>* from = &src;
+        array<T, N>* to = &dest;
+        return copy_async_thread([from, to] { copy(*from, *to); });
+    }
+    return copy_async_flat(src.internal(), dest.internal(), 0, 0, 0);
 }
 
 /**
@@ -6288,8 +8546,12 @@ completion_future copy_async(const array<T, N>& src, array<T, N>& dest) {
  */
 template <typename T, int N>
 completion_future copy_async(const array<T, N>& src, const array_view<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&]() mutable { copy(src, dest); });
-    return completion_future(fut.share());
+    if (is_flat(dest) && !src.is_pitched()) {
+        return copy_async_flat(src.internal(), dest.internal(), src.get_offset(),
+                               copy_async_offset(dest), dest.get_extent().size());
+    }
+    const array<T, N>* from = &src;
+    return copy_async_thread([from, dest] { copy(*from, dest); });
 }
 
 /** @{ */
@@ -6303,14 +8565,18 @@ completion_future copy_async(const array<T, N>& src, const array_view<T, N>& des
  */
 template <typename T, int N>
 completion_future copy_async(const array_view<const T, N>& src, array<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&]() mutable { copy(src, dest); });
-    return completion_future(fut.share());
+    if (is_flat(src) && !dest.is_pitched()) {
+        return copy_async_flat(src.internal(), dest.internal(), copy_async_offset(src),
+                               dest.get_offset(), dest.get_extent().size());
+    }
+    array<T, N>* to = &dest;
+    return copy_async_thread([src, to] { copy(src, *to); });
 }
 
 template <typename T, int N>
 completion_future copy_async(const array_view<T, N>& src, array<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&]() mutable { copy(src, dest); });
-    return completion_future(fut.share());
+    const array_view<const T, N> buf(src);
+    return copy_async(buf, dest);
 }
 
 /** @} */
@@ -6326,14 +8592,17 @@ completion_future copy_async(const array_view<T, N>& src, array<T, N>& dest) {
  */
 template <typename T, int N>
 completion_future copy_async(const array_view<const T, N>& src, const array_view<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&]() mutable { copy(src, dest); });
-    return completion_future(fut.share());
+    if (is_flat(src) && is_flat(dest)) {
+        return copy_async_flat(src.internal(), dest.internal(), copy_async_offset(src),
+                               copy_async_offset(dest), dest.get_extent().size());
+    }
+    return copy_async_thread([src, dest] { copy(src, dest); });
 }
 
 template <typename T, int N>
 completion_future copy_async(const array_view<T, N>& src, const array_view<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&]() mutable { copy(src, dest); });
-    return completion_future(fut.share());
+    const array_view<const T, N> buf(src);
+    return copy_async(buf, dest);
 }
 
 /** @} */
@@ -6354,14 +8623,18 @@ completion_future copy_async(const array_view<T, N>& src, const array_view<T, N>
  */
 template <typename InputIter, typename T, int N>
 completion_future copy_async(InputIter srcBegin, InputIter srcEnd, array<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&, srcBegin, srcEnd]() mutable { copy(srcBegin, srcEnd, dest); });
-    return completion_future(fut.share());
+    if (std::distance(srcBegin, srcEnd) < static_cast<ptrdiff_t>(dest.get_extent().size()))
+        throw runtime_exception("errorMsg_throw ,copy between different types", 0);
+    return copy_async(srcBegin, dest);
 }
 
 template <typename InputIter, typename T, int N>
 completion_future copy_async(InputIter srcBegin, array<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&, srcBegin]() mutable { copy(srcBegin, dest); });
-    return completion_future(fut.share());
+    if (dest.is_pitched()) {
+        array<T, N>* to = &dest;
+        return copy_async_thread([srcBegin, to] { copy(srcBegin, *to); });
+    }
+    return copy_async_staged<T>(srcBegin, dest.get_extent().size(), dest.internal(), dest.get_offset());
 }
 
 /** @} */
@@ -6382,14 +8655,18 @@ completion_future copy_async(InputIter srcBegin, array<T, N>& dest) {
  */
 template <typename InputIter, typename T, int N>
 completion_future copy_async(InputIter srcBegin, InputIter srcEnd, const array_view<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&, srcBegin, srcEnd]() mutable { copy(srcBegin, srcEnd, dest); });
-    return completion_future(fut.share());
+    if (is_flat(dest)) {
+        return copy_async_staged<T>(srcBegin, dest.get_extent().size(), dest.internal(), copy_async_offset(dest));
+    }
+    return copy_async_thread([srcBegin, srcEnd, dest] { copy(srcBegin, srcEnd, dest); });
 }
 
 template <typename InputIter, typename T, int N>
 completion_future copy_async(InputIter srcBegin, const array_view<T, N>& dest) {
-    std::future<void> fut = std::async(std::launch::deferred, [&, srcBegin]() mutable { copy(srcBegin, dest); });
-    return completion_future(fut.share());
+    if (is_flat(dest)) {
+        return copy_async_staged<T>(srcBegin, dest.get_extent().size(), dest.internal(), copy_async_offset(dest));
+    }
+    return copy_async_thread([srcBegin, dest] { copy(srcBegin, dest); });
 }
 
 /** @} */
@@ -6406,8 +8683,8 @@ completion_future copy_async(InputIter srcBegin, const array_view<T, N>& dest) {
  */
 template <typename OutputIter, typename T, int N>
 completion_future copy_async(const array<T, N>& src, OutputIter destBegin) {
-    std::future<void> fut = std::async(std::launch::deferred, [&, destBegin]() mutable { copy(src, destBegin); });
-    return completion_future(fut.share());
+    const array<T, N>* from = &src;
+    return copy_async_thread([from, destBegin] { copy(*from, destBegin); });
 }
 
 /**
@@ -6422,8 +8699,7 @@ completion_future copy_async(const array<T, N>& src, OutputIter destBegin) {
  */
 template <typename OutputIter, typename T, int N>
 completion_future copy_async(const array_view<T, N>& src, OutputIter destBegin) {
-    std::future<void> fut = std::async(std::launch::deferred, [&, destBegin]() mutable { copy(src, destBegin); });
-    return completion_future(fut.share());
+    return copy_async_thread([src, destBegin] { copy(src, destBegin); });
 }
 
 
@@ -7036,7 +9312,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
         return launch_cpu_task_async(av.pQueue, f, compute_domain);
     }
 #endif
-    if (av.get_accelerator().get_device_path() == L"cpu") {
+    if (av.pQueue->getDev()->is_cpu()) {
       throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
     }
     const pfe_wrapper<N, Kernel> _pf(compute_domain, f);
@@ -7074,7 +9350,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
     }
 #endif
   size_t ext = compute_domain[0];
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   return completion_future(Kalmar::mcw_cxxamp_launch_kernel_async<Kernel, 1>(av.pQueue, &ext, NULL, f));
@@ -7112,7 +9388,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
 #endif
   size_t ext[2] = {static_cast<size_t>(compute_domain[1]),
                    static_cast<size_t>(compute_domain[0])};
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   return completion_future(Kalmar::mcw_cxxamp_launch_kernel_async<Kernel, 2>(av.pQueue, ext, NULL, f));
@@ -7153,7 +9429,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
   size_t ext[3] = {static_cast<size_t>(compute_domain[2]),
                    static_cast<size_t>(compute_domain[1]),
                    static_cast<size_t>(compute_domain[0])};
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   return completion_future(Kalmar::mcw_cxxamp_launch_kernel_async<Kernel, 3>(av.pQueue, ext, NULL, f));
@@ -7189,7 +9465,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
       return launch_cpu_task_async(av.pQueue, f, compute_domain);
   } else
 #endif
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   void *kernel = Kalmar::mcw_cxxamp_get_kernel<Kernel>(av.pQueue, f);
@@ -7231,7 +9507,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
       return launch_cpu_task_async(av.pQueue, f, compute_domain);
   } else
 #endif
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   void *kernel = Kalmar::mcw_cxxamp_get_kernel<Kernel>(av.pQueue, f);
@@ -7277,7 +9553,7 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
       return launch_cpu_task_async(av.pQueue, f, compute_domain);
   } else
 #endif
-  if (av.get_accelerator().get_device_path() == L"cpu") {
+  if (av.pQueue->getDev()->is_cpu()) {
     throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
   }
   void *kernel = Kalmar::mcw_cxxamp_get_kernel<Kernel>(av.pQueue, f);
@@ -7292,4 +9568,443 @@ __attribute__((noinline,used)) completion_future parallel_for_each(
 }
 #pragma clang diagnostic pop
 
+// ------------------------------------------------------------------------
+// create_launch_template
+// ------------------------------------------------------------------------
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wreturn-type"
+#pragma clang diagnostic ignored "-Wunused-variable"
+/**
+ * Captures a kernel launch of the kernel functor over the compute domain on
+ * the given accelerator_view, without submitting it. See launch_template.
+ *
+ * @param[in] av The accelerator_view the kernel would be launched on.
+ * @param[in] compute_domain A 1D, 2D or 3D extent of the launch.
+ * @param[in] f The kernel functor, whose captured variables are serialized
+ *              as the kernel arguments.
+ * @return A launch_template object. An empty object if any dimension of the
+ *         extent is 0, or if the accelerator_view does not support launch
+ *         templates.
+ */
+template <int N, typename Kernel>
+__attribute__((noinline,used)) launch_template create_launch_template(
+    const accelerator_view& av, const extent<N>& compute_domain, const Kernel& f) __CPU__ __HC__ {
+  static_assert(N > 0 && N <= 3, "launch templates are only supported for 1D, 2D and 3D extents");
+#if __KALMAR_ACCELERATOR__ != 1
+  size_t ext[3];
+  for (int i = 0; i < N; ++i) {
+    // silently return in case the any dimension of the extent is 0
+    if (compute_domain[i] == 0)
+      return launch_template();
+    if (compute_domain[i] < 0) {
+      throw invalid_compute_domain("Extent is less than 0.");
+    }
+    if (static_cast<size_t>(compute_domain[i]) > 4294967295L)
+      throw invalid_compute_domain("Extent size too large.");
+    ext[N - 1 - i] = static_cast<size_t>(compute_domain[i]);
+  }
+  if (av.pQueue->getDev()->is_cpu()) {
+    throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
+  }
+  return launch_template(av.pQueue, Kalmar::mcw_cxxamp_create_launch_template<Kernel, N>(av.pQueue, ext, NULL, f, 0));
+#else //if __KALMAR_ACCELERATOR__ != 1
+  //to ensure functor has right operator() defined
+  //this triggers the trampoline code being emitted
+  auto foo = &Kernel::__cxxamp_trampoline;
+  auto bar = &Kernel::operator();
+#endif
+}
+#pragma clang diagnostic pop
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wreturn-type"
+#pragma clang diagnostic ignored "-Wunused-variable"
+/**
+ * Captures a tiled kernel launch of the kernel functor over the compute
+ * domain on the given accelerator_view, without submitting it. See
+ * launch_template.
+ *
+ * @param[in] av The accelerator_view the kernel would be launched on.
+ * @param[in] compute_domain A 1D, 2D or 3D tiled_extent of the launch.
+ * @param[in] f The kernel functor, whose captured variables are serialized
+ *              as the kernel arguments.
+ * @return A launch_template object. An empty object if any dimension of the
+ *         extent is 0, or if the accelerator_view does not support launch
+ *         templates.
+ */
+template <int N, typename Kernel>
+__attribute__((noinline,used)) launch_template create_launch_template(
+    const accelerator_view& av, const tiled_extent<N>& compute_domain, const Kernel& f) __CPU__ __HC__ {
+  static_assert(N > 0 && N <= 3, "launch templates are only supported for 1D, 2D and 3D extents");
+#if __KALMAR_ACCELERATOR__ != 1
+  size_t ext[3];
+  size_t tile[3];
+  for (int i = 0; i < N; ++i) {
+    // silently return in case the any dimension of the extent is 0
+    if (compute_domain[i] == 0)
+      return launch_template();
+    if (compute_domain[i] < 0) {
+      throw invalid_compute_domain("Extent is less than 0.");
+    }
+    if (static_cast<size_t>(compute_domain[i]) > 4294967295L)
+      throw invalid_compute_domain("Extent size too large.");
+    ext[N - 1 - i] = static_cast<size_t>(compute_domain[i]);
+    tile[N - 1 - i] = static_cast<size_t>(compute_domain.tile_dim[i]);
+  }
+  if (av.pQueue->getDev()->is_cpu()) {
+    throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
+  }
+  return launch_template(av.pQueue, Kalmar::mcw_cxxamp_create_launch_template<Kernel, N>(av.pQueue, ext, tile, f, compute_domain.get_dynamic_group_segment_size()));
+#else //if __KALMAR_ACCELERATOR__ != 1
+  tiled_index<N> this_is_used_to_instantiate_the_right_index;
+  //to ensure functor has right operator() defined
+  //this triggers the trampoline code being emitted
+  auto foo = &Kernel::__cxxamp_trampoline;
+  auto bar = &Kernel::operator();
+#endif
+}
+#pragma clang diagnostic pop
+
+// ------------------------------------------------------------------------
+// indirect parallel_for_each
+// ------------------------------------------------------------------------
+
+/**
+ * The extent of a parallel_for_each read from device memory when the kernel
+ * starts instead of being given by the host, as the sizes of N dimensions
+ * stored in an array on the accelerator by earlier kernels. A kernel which
+ * compacts data could then size the kernel processing it without the host
+ * reading the count back.
+ *
+ * @tparam N The dimension of the extent.
+ */
+template <int N>
+class indirect_extent {
+    static_assert(N > 0 && N <= 3, "indirect extents have 1, 2 or 3 dimensions");
+public:
+    /**
+     * Constructs an indirect extent of the first N elements of "sizes", in
+     * the order of the dimensions of an extent. The array must stay alive
+     * until the kernels using the extent start.
+     */
+    explicit indirect_extent(const array<unsigned int, 1>& sizes) : sizes(&sizes) {}
+
+    const array<unsigned int, 1>& get_sizes() const { return *sizes; }
+
+private:
+    const array<unsigned int, 1>* sizes;
+};
+
+/** \cond HIDDEN_SYMBOLS */
+// writes the grid size into the AQL packet of the kernel right after it,
+// the packet is the first argument, patched by the runtime
+template <int N>
+class indirect_launcher
+{
+public:
+    explicit indirect_launcher(const unsigned int* sizes) __CPU__ __HC__
+        : packet(nullptr), sizes(sizes) {}
+    void operator() (index<1> idx) const __CPU__ __HC__ {
+        // the kernel runs one work-item at least, an empty grid is clamped
+        // by indirect_wrapper
+        for (int i = 0; i < N; ++i) {
+            unsigned int size = sizes[N - 1 - i];
+            packet[3 + i] = size ? size : 1;
+        }
+    }
+private:
+    uint32_t* packet;
+    const unsigned int* sizes;
+};
+
+// runs the kernel over the work-items within the extent read from the
+// device, the grid of the kernel being rounded up to whole workgroups
+template <int N, typename Kernel>
+class indirect_wrapper
+{
+public:
+    explicit indirect_wrapper(const unsigned int* sizes, const Kernel& f) __CPU__ __HC__
+        : sizes(sizes), k(f) {}
+    void operator() (index<N> idx) const __CPU__ __HC__ {
+        for (int i = 0; i < N; ++i) {
+            if (static_cast<unsigned int>(idx[i]) >= sizes[i])
+                return;
+        }
+        k(idx);
+    }
+private:
+    const unsigned int* sizes;
+    const Kernel k;
+};
+
+// the workgroups of indirect launches, in the order of the AQL packet
+#define HC_INDIRECT_TILE_1D { 256, 1, 1 }
+#define HC_INDIRECT_TILE_2D { 16, 16, 1 }
+#define HC_INDIRECT_TILE_3D { 8, 8, 4 }
+/** \endcond */
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wreturn-type"
+#pragma clang diagnostic ignored "-Wunused-variable"
+/**
+ * Launches the kernel functor over an extent read from device memory by the
+ * accelerator, see indirect_extent. On HSA accelerators a launcher kernel
+ * writes the sizes into the AQL packet of the kernel, which the packet
+ * processor only reads once the launcher is done. Elsewhere the host reads
+ * the sizes, and waits for the kernels writing them.
+ *
+ * The sizes must have been written by commands of "av" submitted before, or
+ * be waited for: they aren't tracked as a buffer the kernel uses.
+ *
+ * @param[in] av The accelerator_view the kernel is launched on.
+ * @param[in] compute_domain The extent, read from device memory.
+ * @param[in] f The kernel functor, called with an index<N>.
+ * @return A completion_future for the launch.
+ */
+template <int N, typename Kernel>
+__attribute__((noinline,used)) completion_future parallel_for_each(
+    const accelerator_view& av,
+    const indirect_extent<N>& compute_domain, const Kernel& f) __CPU__ __HC__ {
+#if __KALMAR_ACCELERATOR__ != 1
+    if (av.pQueue->getDev()->is_cpu()) {
+      throw runtime_exception(Kalmar::__errorMsg_UnsupportedAccelerator, E_FAIL);
+    }
+    const array<unsigned int, 1>& sizes = compute_domain.get_sizes();
+    const indirect_launcher<N> launcher(sizes.accelerator_pointer());
+    const indirect_wrapper<N, Kernel> kernel(sizes.accelerator_pointer(), f);
+    size_t launcherExt[3] = { 1, 1, 1 };
+    size_t tiles[3][3] = { HC_INDIRECT_TILE_1D, HC_INDIRECT_TILE_2D, HC_INDIRECT_TILE_3D };
+    std::shared_ptr<Kalmar::KalmarLaunchTemplate> launch =
+        Kalmar::mcw_cxxamp_create_launch_template<indirect_launcher<N>, 1>(av.pQueue, launcherExt, launcherExt, launcher, 0);
+    std::shared_ptr<Kalmar::KalmarLaunchTemplate> dispatch =
+        Kalmar::mcw_cxxamp_create_launch_template<indirect_wrapper<N, Kernel>, N>(av.pQueue, tiles[N - 1], tiles[N - 1], kernel, 0);
+    if (launch != nullptr && dispatch != nullptr) {
+        std::shared_ptr<Kalmar::KalmarAsyncOp> op = av.pQueue->LaunchIndirect(launch.get(), dispatch.get());
+        if (op != nullptr) {
+            return completion_future(op);
+        }
+    }
+
+    // the host reads the sizes instead
+    std::vector<unsigned int> hostSizes = sizes;
+    extent<N> ext;
+    for (int i = 0; i < N; ++i)
+        ext[i] = hostSizes[i];
+    return parallel_for_each(av, ext, f);
+#else
+    auto foo = &indirect_launcher<N>::__cxxamp_trampoline;
+    auto bar = &indirect_launcher<N>::operator();
+    auto baz = &indirect_wrapper<N, Kernel>::__cxxamp_trampoline;
+    auto qux = &indirect_wrapper<N, Kernel>::operator();
+    auto qq = &index<N>::__cxxamp_opencl_index;
+#endif
+}
+#pragma clang diagnostic pop
+
+/**
+ * Launches the kernel functor over an extent read from device memory, on the
+ * accelerator_view selected automatically.
+ */
+template <int N, typename Kernel>
+completion_future parallel_for_each(const indirect_extent<N>& compute_domain, const Kernel& f) {
+    return parallel_for_each(accelerator::get_auto_selection_view(), compute_domain, f);
+}
+
+// ------------------------------------------------------------------------
+// split_policy
+// ------------------------------------------------------------------------
+
+/**
+ * Represents how a parallel_for_each is split between an accelerator_view
+ * and the CPU. The first rows of the extent, along its most significant
+ * dimension, are computed by the accelerator_view and the rest by the CPU
+ * thread pool at the same time.
+ *
+ * The parts write their results straight to memory shared by the host and
+ * the accelerator, so the launch is only split on accelerators which
+ * support CPU shared memory, for kernels which don't capture any array or
+ * array_view, and in programs built with the CPU path. The whole launch is
+ * run on the accelerator_view otherwise.
+ */
+class split_policy {
+public:
+    /**
+     * Constructs a policy whose share of the accelerator is learned from the
+     * rates the parts of earlier launches of the same kernel ran at.
+     */
+    split_policy() : share(-1.0) {}
+
+    /**
+     * Constructs a policy with a fixed share of the accelerator.
+     *
+     * @param[in] accelerator_share The part of the rows computed by the
+     *                              accelerator_view, from 0.0 to 1.0.
+     */
+    explicit split_policy(double accelerator_share)
+        : share(std::min(std::max(accelerator_share, 0.0), 1.0)) {}
+
+    /**
+     * Returns true if the share of the accelerator is learned.
+     */
+    bool is_adaptive() const { return share < 0.0; }
+
+    /**
+     * Returns the fixed share of the accelerator, or a negative value if it
+     * is learned.
+     */
+    double get_accelerator_share() const { return share; }
+
+private:
+    double share;
+};
+
+template <int N, typename Kernel>
+class split_wrapper
+{
+public:
+    explicit split_wrapper(const Kernel& f, int offset) __CPU__ __HC__
+        : k(f), offset(offset) {}
+    void operator() (index<N> idx) const __CPU__ __HC__ {
+        idx[0] += offset;
+        k(idx);
+    }
+private:
+    const Kernel k;
+    const int offset;
+};
+
+/**
+ * Launches the kernel functor over the compute domain split between the
+ * given accelerator_view and the CPU, as set by the split_policy.
+ *
+ * @param[in] av The accelerator_view computing its share of the rows.
+ * @param[in] policy The split_policy of the launch.
+ * @param[in] compute_domain A 1D, 2D or 3D extent of the launch.
+ * @param[in] f The kernel functor.
+ * @return A completion_future object which is ready once both parts of the
+ *         launch are done.
+ */
+template <int N, typename Kernel>
+__attribute__((noinline,used)) completion_future parallel_for_each(
+    const accelerator_view& av, const split_policy& policy,
+    const extent<N>& compute_domain, const Kernel& f) __CPU__ __HC__ {
+#if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
+    int rows = compute_domain[0];
+    if (is_cpu() || rows <= 0 || !av.get_accelerator().get_supports_cpu_shared_memory() ||
+        av.pQueue->getDev()->is_cpu() || Kalmar::uses_buffers(f)) {
+        return parallel_for_each(av, compute_domain, split_wrapper<N, Kernel>(f, 0));
+    }
+
+    // the share of each kernel is learned separately
+    static Kalmar::KalmarSplitStats stats;
+    double share = policy.is_adaptive() ? stats.next_share() : policy.get_accelerator_share();
+    int accRows = std::min(static_cast<int>(rows * share + 0.5), rows);
+    size_t rowSize = compute_domain.size() / rows;
+
+    std::shared_ptr<Kalmar::KalmarAsyncOp> accOp;
+    std::shared_ptr<Kalmar::KalmarAsyncOp> cpuOp;
+    if (accRows > 0) {
+        extent<N> part(compute_domain);
+        part[0] = accRows;
+        // the share is learned from the ticks of the part
+        if (policy.is_adaptive())
+            av.profile_next_dispatch();
+        accOp = parallel_for_each(av, part, split_wrapper<N, Kernel>(f, 0)).__asyncOp;
+    }
+    if (accRows < rows) {
+        extent<N> part(compute_domain);
+        part[0] = rows - accRows;
+        cpuOp = launch_cpu_task_async(Kalmar::get_cpu_queue(), split_wrapper<N, Kernel>(f, accRows), part).__asyncOp;
+    }
+    if (policy.is_adaptive()) {
+        stats.record(accOp, accRows * rowSize, cpuOp, (rows - accRows) * rowSize);
+    }
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > parts = { accOp, cpuOp };
+    return completion_future(std::make_shared<Kalmar::KalmarSplitOp>(parts));
+#else
+    // the kernel can't be run on the CPU, launch it on av as a whole
+    return parallel_for_each(av, compute_domain, split_wrapper<N, Kernel>(f, 0));
+#endif
+}
+
+/**
+ * Launches the kernel functor over the compute domain sharded over several
+ * accelerator_views. The rows of the extent, along its most significant
+ * dimension, are divided evenly between them, and the kernels of the shards
+ * run at the same time.
+ *
+ * The data of the arrays and array_views the kernel uses is made valid on
+ * each accelerator before the launch. The kernel of each shard may only
+ * write the elements of an array_view at its own rows, with the rows of the
+ * array_view laid out as the rows of the extent. The rows written on each
+ * accelerator are gathered to the first accelerator_view when the data is
+ * used next, so only the rows written elsewhere are copied to an accelerator
+ * by the next launch. Launches whose kernel writes an array_view whose size
+ * isn't a multiple of the rows of the extent are run as a whole on the first
+ * accelerator_view.
+ *
+ * @param[in] views The accelerator_views of the shards, which may not be
+ *                  empty.
+ * @param[in] compute_domain A 1D, 2D or 3D extent of the launch.
+ * @param[in] f The kernel functor.
+ * @return A completion_future object which is ready once the kernels of all
+ *         shards are done.
+ */
+template <int N, typename Kernel>
+__attribute__((noinline,used)) completion_future parallel_for_each(
+    const std::vector<accelerator_view>& views,
+    const extent<N>& compute_domain, const Kernel& f) __CPU__ __HC__ {
+    if (views.empty())
+        throw runtime_exception("parallel_for_each needs at least one accelerator_view.", E_FAIL);
+#if __KALMAR_ACCELERATOR__ != 1
+    int rows = compute_domain[0];
+    int count = std::min(static_cast<int>(views.size()), rows);
+#if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
+    if (is_cpu())
+        count = 1;
+#endif
+    Kalmar::BufferSearcher searcher;
+    Kalmar::Serialize s(&searcher);
+    f.__cxxamp_serialize(s);
+    for (auto& buf : searcher.bufs) {
+        if (count > 1 && buf.second && buf.first->count % rows != 0)
+            count = 1;
+    }
+    if (count <= 1)
+        return parallel_for_each(views[0], compute_domain, split_wrapper<N, Kernel>(f, 0));
+
+    std::vector< std::shared_ptr<Kalmar::KalmarQueue> > queues;
+    std::vector<int> starts;
+    for (int i = 0; i <= count; ++i) {
+        if (i < count)
+            queues.push_back(views[i].pQueue);
+        starts.push_back(static_cast<int>(static_cast<int64_t>(rows) * i / count));
+    }
+    for (auto& buf : searcher.bufs) {
+        buf.first->begin_shards(queues);
+    }
+
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > parts;
+    for (int i = 0; i < count; ++i) {
+        extent<N> part(compute_domain);
+        part[0] = starts[i + 1] - starts[i];
+        parts.push_back(parallel_for_each(views[i], part, split_wrapper<N, Kernel>(f, starts[i])).__asyncOp);
+    }
+
+    for (auto& buf : searcher.bufs) {
+        std::vector<size_t> bounds;
+        if (buf.second) {
+            size_t rowSize = buf.first->count / rows;
+            for (int start : starts)
+                bounds.push_back(rowSize * start);
+        }
+        buf.first->end_shards(queues, bounds);
+    }
+    return completion_future(std::make_shared<Kalmar::KalmarSplitOp>(parts));
+#else
+    return parallel_for_each(views[0], compute_domain, split_wrapper<N, Kernel>(f, 0));
+#endif
+}
+
 } // namespace hc
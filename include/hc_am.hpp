@@ -1,6 +1,7 @@
 #pragma once
 
 #include "hc.hpp"
+#include <cstdint>
 #include <initializer_list>
 
 typedef int am_status_t;
@@ -8,8 +9,17 @@ typedef int am_status_t;
 // TODO - provide better mapping of HSA error conditions to HC error codes.
 #define AM_ERROR_MISC                       -1 /** Misellaneous error */
 
+/// Number of 32-bit words each work-item of the am_memset_async kernel writes.
+/// Consecutive work-items write consecutive words, so the stores of a wavefront are coalesced.
+#ifndef AM_FILL_WORDS_PER_ITEM
+#define AM_FILL_WORDS_PER_ITEM (4)
+#endif
+
 // Flags for am_alloc API:
 #define amHostPinned 0x1
+#define amPooled     0x2 /** Serve the allocation from slabs cached by AM */
+#define amMapToPeers 0x4 /** Make the allocation accessible to the peers set with am_set_alloc_peers */
+#define amPeerDirect 0x8 /** Device memory which RDMA NICs may register for peer-direct access, see am_rdma_get_range */
 
 
 namespace hc {
@@ -22,6 +32,7 @@ struct AmPointerInfo {
     hc::accelerator _acc;       ///< Device / Accelerator to use.
     bool        _isInDeviceMem;    ///< Memory is physically resident on a device (if false, memory is located on host)
     bool        _isAmManaged;   ///< Memory was allocated by AM and should be freed when am_reset is called.
+    bool        _isPeerDirect;  ///< Memory was allocated with amPeerDirect, for NICs to register.
 
     int         _appId;              ///< App-specific storage.  (Used by HIP to store deviceID.)
     unsigned    _appAllocationFlags; ///< App-specific allocation flags.  (Used by HIP to store allocation flags.)
@@ -34,12 +45,37 @@ struct AmPointerInfo {
         _acc(acc),
         _isInDeviceMem(isInDeviceMem),
         _isAmManaged(isAmManaged),
+        _isPeerDirect(false),
         _appId(-1),
         _appAllocationFlags(0)  {};
 
     AmPointerInfo & operator= (const AmPointerInfo &other);
 
 };
+
+/// Handle of device memory shared with other processes, see am_ipc_get_handle.
+/// It's plain data, which may be passed to other processes as is, through a pipe or shared memory.
+struct AmIpcMemoryHandle {
+    uint32_t    _ipcHandle[8];  ///< HSA IPC handle of the allocation holding the memory.
+    uint64_t    _offset;        ///< Offset of the memory in the allocation.
+    uint64_t    _sizeBytes;     ///< Size of the allocation.
+};
+
+/// Range of device memory allocated with amPeerDirect, see am_rdma_get_range.
+/// It's the range a NIC registers, with ibv_reg_mr for instance, to read and write the memory directly.
+struct AmRdmaRange {
+    void *      _basePointer;   ///< Start of the allocation holding the memory, aligned to pages of the device.
+    uint64_t    _offset;        ///< Offset of the memory in the allocation.
+    uint64_t    _sizeBytes;     ///< Size of the allocation, a whole number of pages of the device.
+};
+
+/// Handle of a signal shared with other processes, see am_ipc_signal_create.
+struct AmIpcSignalHandle {
+    uint32_t    _ipcHandle[8];  ///< HSA IPC handle of the signal.
+};
+
+/// Signal shared with other processes, the handle of an HSA signal.
+typedef uint64_t am_ipc_signal_t;
 }
 
 
@@ -56,7 +92,17 @@ namespace hc {
  *
  * If @p size == 0, 0 is returned.
  *
- * Flags must be 0.
+ * @p flags is 0 or a combination of:
+ * - amHostPinned: allocate pinned host memory accessible from @p acc instead of device memory.
+ * - amPooled: slice the allocation from a larger slab cached by AM, which avoids a driver call for
+ *   small frequent allocations.  The memory tracker registers the whole slab, so am_memtracker_getinfo
+ *   reports the slab for such pointers.  A freed pooled block is kept for later pooled allocations
+ *   until am_memtracker_reset is called for @p acc.
+ * - amMapToPeers: make the allocation accessible to the peers set for @p acc with am_set_alloc_peers, when
+ *   it's allocated.  With amPooled, the slabs are mapped to the peers when they are allocated.
+ * - amPeerDirect: allocate device memory RDMA NICs may register, see am_rdma_get_range.  The size is
+ *   rounded up to the allocation granule of the device, and amPooled is ignored.  0 is returned with
+ *   amHostPinned: NICs register pinned host memory as any host memory.
  *
  * @return : On success, pointer to the newly allocated memory is returned.
  * The pointer is typecast to the desired return type.
@@ -75,6 +121,17 @@ auto_voidp am_alloc(size_t size, hc::accelerator &acc, unsigned flags);
  */
 am_status_t am_free(void*  ptr);
 
+/**
+ * Free a block of memory previously allocated with am_alloc, once the work already enqueued on @p av
+ * is finished.
+ *
+ * Returns immediately.  Blocks allocated with amPooled return to the pool when a marker enqueued on
+ * @p av is ready, and may then be handed out again.  Other blocks are freed with am_free at that point.
+ *
+ * @see am_alloc, am_free
+ */
+void am_free_async(void* ptr, hc::accelerator_view &av);
+
 
 /**
  * Copy @p size bytes of memory from @p src to @ dst.  The memory areas (src+size and dst+size) must not overlap.
@@ -84,6 +141,91 @@ am_status_t am_free(void*  ptr);
  */
 am_status_t am_copy(void*  dst, const void*  src, size_t size);
 
+/**
+ * Copy @p size bytes of memory from @p src to @p dst asynchronously, in the order of @p av.
+ *
+ * The copy starts after the work already enqueued on @p av is finished, and the work enqueued on @p av
+ * afterwards waits for it.  The memory areas must not overlap.
+ *
+ * The pointers are looked up in the memory tracker.  Tracked memory, on a device or pinned on the host,
+ * is copied by the DMA engine as it is - device memory of a peer must have been mapped with am_map_to_peers.
+ * Untracked memory is pageable host memory, which is locked for the duration of the copy.  If both
+ * pointers are untracked, the copy is done on the host after @p av has finished its work.
+ *
+ * @return A future which is ready once the copy is finished, or which is not valid if the copy was done
+ * before returning.
+ * @see am_copy, am_map_to_peers
+ */
+completion_future am_copy_async(void* dst, const void* src, size_t size, hc::accelerator_view &av);
+
+
+/**
+ * Fill @p count elements of @p patternSize bytes at @p ptr with the low @p patternSize bytes of @p value.
+ *
+ * @p patternSize is 1, 2 or 4, and @p ptr must be aligned on it.  Memory tracked by AM is filled with
+ * hsa_amd_memory_fill, apart from the unaligned bytes at its ends.  Untracked memory is filled by the host.
+ * The fill doesn't wait for any accelerator_view, see am_memset_async for a fill ordered with other work.
+ *
+ * @return AM_SUCCESS if filled successfully.
+ * @return AM_ERROR_MISC if @p patternSize is not supported or the fill failed.
+ * @see am_memset_async
+ */
+am_status_t am_memset(void* ptr, uint32_t value, size_t count, size_t patternSize = 1);
+
+
+/**
+ * Fill @p count elements at @p ptr with @p value asynchronously, in the order of @p av.
+ *
+ * T is an 8, 16 or 32-bit type.  The fill is a kernel dispatched on @p av, which stores whole 32-bit
+ * words holding the pattern, and single elements at the unaligned ends only.  @p ptr must be accessible
+ * from kernels on @p av: device memory, or host memory allocated with amHostPinned.
+ *
+ * @return A future which is ready once the fill is finished, or which is not valid if @p count is 0.
+ * @see am_memset
+ */
+template <typename T>
+completion_future am_memset_async(T* ptr, T value, size_t count, hc::accelerator_view &av)
+{
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4, "am_memset_async only fills 8, 16 or 32-bit patterns");
+
+    if (count == 0) {
+        return completion_future();
+    }
+
+    // ptr is aligned on T, so every aligned word in the range holds the same repeated pattern.
+    uintptr_t begin = reinterpret_cast<uintptr_t>(ptr);
+    uintptr_t end = begin + count * sizeof(T);
+    uintptr_t wordBegin = (begin + 3) & ~uintptr_t(3);
+    uintptr_t wordEnd = end & ~uintptr_t(3);
+    size_t words = (wordBegin < wordEnd) ? (wordEnd - wordBegin) / 4 : 0;
+    size_t head = words ? (wordBegin - begin) / sizeof(T) : count;
+    size_t tail = words ? (end - wordEnd) / sizeof(T) : 0;
+
+    uint64_t mask = (uint64_t(1) << (8 * sizeof(T))) - 1;
+    uint32_t word = uint32_t((uint64_t(value) & mask) * (uint64_t(0xFFFFFFFF) / mask));
+
+    size_t items = (words + AM_FILL_WORDS_PER_ITEM - 1) / AM_FILL_WORDS_PER_ITEM;
+    items = std::max(items, std::max(head, tail));
+
+    uint32_t* wordPtr = reinterpret_cast<uint32_t*>(wordBegin);
+    T* tailPtr = reinterpret_cast<T*>(wordEnd);
+    return hc::parallel_for_each(av, hc::extent<1>(items), [=](hc::index<1> idx) __HC__ {
+        size_t i = idx[0];
+        for (int k = 0; k < AM_FILL_WORDS_PER_ITEM; ++k) {
+            size_t w = i + k * items;
+            if (w < words) {
+                wordPtr[w] = word;
+            }
+        }
+        if (i < head) {
+            ptr[i] = value;
+        }
+        if (i < tail) {
+            tailPtr[i] = value;
+        }
+    });
+}
+
 
 
 /**
@@ -110,6 +252,18 @@ am_status_t am_memtracker_getinfo(hc::AmPointerInfo *info, const void *ptr);
 am_status_t am_memtracker_add(void* ptr, size_t sizeBytes, hc::accelerator &acc, bool isDeviceMem=false);
 
 
+/**
+ * Add @p count pointers to the memory tracker at once.
+ *
+ * Equivalent to calling am_memtracker_add for each of @p ptrs with the matching entry of @p sizeBytes,
+ * but the tracker is only updated once.  Pointers that are already tracked are skipped.
+ *
+ * @return AM_SUCCESS
+ * @see am_memtracker_add, am_memtracker_remove_batch
+ */
+am_status_t am_memtracker_add_batch(size_t count, void* const* ptrs, const size_t* sizeBytes, hc::accelerator &acc, bool isDeviceMem=false);
+
+
 /*
  * Update info for an existing pointer in the memory tracker.
  *
@@ -133,6 +287,18 @@ am_status_t am_memtracker_update(const void* ptr, int appId, unsigned allocation
  */
 am_status_t am_memtracker_remove(void* ptr);
 
+/**
+ * Remove @p count pointers from the tracker structure at once.
+ *
+ * Each of @p ptrs may be anywhere in a tracked memory range.
+ *
+ * @returns AM_ERROR_MISC if any of the pointers is not found in tracker, the others are still removed.
+ * @returns AM_SUCCESS if all pointers are found and removed.
+ *
+ * @see am_memtracker_remove, am_memtracker_add_batch
+ */
+am_status_t am_memtracker_remove_batch(size_t count, void* const* ptrs);
+
 /**
  * Remove all memory allocations associated with specified accelerator from the memory tracker.
  *
@@ -174,6 +340,34 @@ void am_memtracker_update_peers(const hc::accelerator &acc, int peerCnt, hsa_age
  */
 am_status_t am_map_to_peers(void* ptr, size_t num_peer, const hc::accelerator* peers); 
 
+/*
+ * Map the memory pointed to by each of @p ptrs to the peers, like am_map_to_peers.
+ *
+ * The pointers are looked up in the pointer tracker in a single pass, and each tracked range is mapped
+ * once even if several pointers fall in it.  Pointers which can't be mapped don't stop the others from
+ * being mapped.
+ *
+ * @p count number of pointers in @p ptrs
+ * @return AM_SUCCESS if all pointers are mapped successfully.
+ * @return AM_ERROR_MISC if @p ptrs is nullptr or @p num_peer is 0 or @p peers is nullptr.
+ * @return AM_ERROR_MISC if any pointer can't be mapped, for the reasons am_map_to_peers gives.
+ * @see am_map_to_peers
+ */
+am_status_t am_map_to_peers_batch(size_t count, void* const* ptrs, size_t num_peer, const hc::accelerator* peers);
+
+/*
+ * Set the peers which memory allocated on @p acc with amMapToPeers is made accessible to.
+ *
+ * The peers are checked once here, instead of for each allocation.  Memory allocated earlier, and slabs
+ * already cached by AM for amPooled, keep the peers they were mapped to.  Setting no peers stops mapping.
+ *
+ * @p num_peer number of peers in @p peers
+ * @return AM_SUCCESS if the peers are set.
+ * @return AM_ERROR_MISC if a peer may never access memory of @p acc.
+ * @see am_alloc, am_map_to_peers
+ */
+am_status_t am_set_alloc_peers(hc::accelerator &acc, size_t num_peer, const hc::accelerator* peers);
+
 /*
  * Locks a host pointer to a vector of agents
  * 
@@ -197,6 +391,95 @@ am_status_t am_memory_host_lock(hc::accelerator &ac, void *hostPtr, size_t size,
  */
 am_status_t am_memory_host_unlock(hc::accelerator &ac, void *hostPtr);
 
+/**
+ * Get a handle of the device memory at @p ptr, which other processes open with am_ipc_open_handle to
+ * access the same memory, on the same device or on its peers.
+ *
+ * @p ptr must be tracked device memory allocated with am_alloc, or memory opened with am_ipc_open_handle.
+ * It may be inside an allocation: the whole allocation is shared, and the handle records the offset of
+ * @p ptr in it.  Blocks allocated with amPooled share the slab holding them.
+ *
+ * The memory must not be freed while other processes have it open.
+ *
+ * @return AM_SUCCESS if @p handle is set.
+ * @return AM_ERROR_MISC if @p ptr is not tracked device memory, or can't be shared.
+ * @see am_ipc_open_handle, am_ipc_close_handle
+ */
+am_status_t am_ipc_get_handle(const void* ptr, hc::AmIpcMemoryHandle* handle);
+
+/**
+ * Open device memory shared by another process with am_ipc_get_handle, and map it for @p acc.
+ *
+ * The memory is added to the memory tracker as device memory of @p acc which is not managed by AM:
+ * am_memtracker_reset doesn't free it.
+ *
+ * @return AM_SUCCESS and the pointer to the memory in @p ptr if it's opened.
+ * @return AM_ERROR_MISC if the memory can't be opened.
+ * @see am_ipc_get_handle, am_ipc_close_handle
+ */
+am_status_t am_ipc_open_handle(const hc::AmIpcMemoryHandle& handle, hc::accelerator &acc, void** ptr);
+
+/**
+ * Close memory opened with am_ipc_open_handle, and remove it from the tracker.  The memory is still
+ * allocated in the process which shared it.
+ *
+ * @return AM_SUCCESS if the memory is closed.
+ * @return AM_ERROR_MISC if @p ptr wasn't opened with am_ipc_open_handle.
+ */
+am_status_t am_ipc_close_handle(void* ptr);
+
+/**
+ * Get the range of the allocation holding @p ptr, allocated with amPeerDirect, for a NIC to register.
+ *
+ * RDMA NICs with peer-direct support, through the amdkfd RDMA interface, then read and write the device
+ * memory directly, without copies to host memory for inter-node transfers.  The allocation is one HSA
+ * allocation of whole pages, never a block of a slab of amPooled, so the pages a NIC keeps registered only
+ * ever hold that allocation.  The NIC must deregister the range before the memory is freed.
+ *
+ * @return AM_SUCCESS if @p range is set.
+ * @return AM_ERROR_MISC if @p ptr is not tracked device memory allocated with amPeerDirect.
+ * @see am_alloc
+ */
+am_status_t am_rdma_get_range(const void* ptr, hc::AmRdmaRange* range);
+
+/**
+ * Create a signal of initial value @p value which may be shared with other processes, to wait for one
+ * another: a loader process signals workers once weights are in shared memory for instance.  Other
+ * processes open it with am_ipc_signal_open and the @p handle set here.
+ *
+ * @return AM_SUCCESS if the signal is created.
+ * @see am_ipc_signal_open, am_ipc_signal_store, am_ipc_signal_wait, am_ipc_signal_destroy
+ */
+am_status_t am_ipc_signal_create(int64_t value, hc::am_ipc_signal_t* signal, hc::AmIpcSignalHandle* handle);
+
+/**
+ * Open a signal created by another process with am_ipc_signal_create.
+ *
+ * @return AM_SUCCESS if the signal is opened.
+ */
+am_status_t am_ipc_signal_open(const hc::AmIpcSignalHandle& handle, hc::am_ipc_signal_t* signal);
+
+/**
+ * Set the value of a shared signal, with release semantics: the writes to shared memory made before
+ * are visible to the processes which see the value.
+ */
+void am_ipc_signal_store(hc::am_ipc_signal_t signal, int64_t value);
+
+/**
+ * Block until a shared signal has the value @p value, with acquire semantics.
+ *
+ * @return the value of the signal.
+ */
+int64_t am_ipc_signal_wait(hc::am_ipc_signal_t signal, int64_t value);
+
+/**
+ * Destroy a shared signal created with am_ipc_signal_create, or close one opened with
+ * am_ipc_signal_open.
+ *
+ * @return AM_SUCCESS if the signal is destroyed.
+ */
+am_status_t am_ipc_signal_destroy(hc::am_ipc_signal_t signal);
+
 
 }; // namespace hc
 
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+
+#include "hc.hpp"
+
+namespace hc {
+
+/**
+ * The work-items an atomic operation is ordered with.
+ *
+ * A narrower scope lets an operation skip the caches and fences the others
+ * would need. An object accessed at a scope must only be accessed at that
+ * scope or a wider one while the operations are in flight.
+ *
+ * The backends have no scoped atomic instructions yet, so the operations of
+ * every scope are lowered as those of memory_scope_accelerator, which is
+ * coherent with the host for fine-grained memory. Code stating its scope
+ * gets the cheaper instructions once they are.
+ */
+enum memory_scope {
+  // the work-items of the wavefront of the caller
+  memory_scope_wavefront,
+  // the work-items of the tile of the caller, as for tile_static objects
+  memory_scope_work_group,
+  // all the work-items of the accelerator
+  memory_scope_accelerator,
+  // the work-items of all the accelerators and the host threads, as for
+  // objects in fine-grained or pinned host memory
+  memory_scope_system
+};
+
+/**
+ * A reference to an object of type T accessed atomically, at the scope
+ * Scope, with the memory order each operation is given.
+ *
+ * Unlike the atomic_fetch_* functions, which are sequentially consistent,
+ * a relaxed operation is an atomic instruction without any fence, and an
+ * acquire or a release one only orders the accesses in one direction, so
+ * counters, histograms and queues only pay for the ordering they need.
+ *
+ * T is a 32-bit or 64-bit integer or floating-point type. The arithmetic
+ * operations of floating-point types are done with compare-and-swap loops.
+ *
+ * The operations are supported on the accelerator and on the host.
+ */
+template <typename T, memory_scope Scope = memory_scope_accelerator>
+class atomic_ref {
+  static_assert(std::is_integral<T>::value || std::is_floating_point<T>::value,
+                "atomic_ref is only defined for integer and floating-point types");
+  static_assert(sizeof(T) == sizeof(uint32_t) || sizeof(T) == sizeof(uint64_t),
+                "atomic_ref is only defined for 32-bit and 64-bit types");
+
+public:
+  // the scope of the operations
+  static const memory_scope scope = Scope;
+
+  explicit atomic_ref(T& obj) __CPU__ __HC__ : ptr(&obj) {}
+
+  T load(std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    T ret;
+    __atomic_load(ptr, &ret, order);
+    return ret;
+  }
+
+  void store(T desired, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    __atomic_store(ptr, &desired, order);
+  }
+
+  T exchange(T desired, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    T ret;
+    __atomic_exchange(ptr, &desired, &ret, order);
+    return ret;
+  }
+
+  /**
+   * Replaces the object with desired if it's equal to expected, otherwise
+   * loads it into expected.
+   *
+   * @return Whether the object was replaced.
+   */
+  bool compare_exchange_strong(T& expected, T desired,
+                               std::memory_order success,
+                               std::memory_order failure) const __CPU__ __HC__ {
+    return __atomic_compare_exchange(ptr, &expected, &desired, false, success, failure);
+  }
+
+  bool compare_exchange_strong(T& expected, T desired,
+                               std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    return compare_exchange_strong(expected, desired, order, failure_order(order));
+  }
+
+  /**
+   * As compare_exchange_strong(), but may fail even if the object is equal
+   * to expected, which is cheaper in a loop.
+   */
+  bool compare_exchange_weak(T& expected, T desired,
+                             std::memory_order success,
+                             std::memory_order failure) const __CPU__ __HC__ {
+    return __atomic_compare_exchange(ptr, &expected, &desired, true, success, failure);
+  }
+
+  bool compare_exchange_weak(T& expected, T desired,
+                             std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    return compare_exchange_weak(expected, desired, order, failure_order(order));
+  }
+
+  T fetch_add(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    return fetch_add(val, order, std::is_integral<T>());
+  }
+
+  T fetch_sub(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    return fetch_add(-val, order, std::is_integral<T>());
+  }
+
+  T fetch_and(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    static_assert(std::is_integral<T>::value, "fetch_and is only defined for integer types");
+    return __atomic_fetch_and(ptr, val, order);
+  }
+
+  T fetch_or(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    static_assert(std::is_integral<T>::value, "fetch_or is only defined for integer types");
+    return __atomic_fetch_or(ptr, val, order);
+  }
+
+  T fetch_xor(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    static_assert(std::is_integral<T>::value, "fetch_xor is only defined for integer types");
+    return __atomic_fetch_xor(ptr, val, order);
+  }
+
+  T fetch_min(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    T old = load(std::memory_order_relaxed);
+    while (val < old && !compare_exchange_weak(old, val, order, std::memory_order_relaxed));
+    return old;
+  }
+
+  T fetch_max(T val, std::memory_order order = std::memory_order_seq_cst) const __CPU__ __HC__ {
+    T old = load(std::memory_order_relaxed);
+    while (old < val && !compare_exchange_weak(old, val, order, std::memory_order_relaxed));
+    return old;
+  }
+
+  T operator++() const __CPU__ __HC__ { return fetch_add(1) + 1; }
+  T operator++(int) const __CPU__ __HC__ { return fetch_add(1); }
+  T operator--() const __CPU__ __HC__ { return fetch_sub(1) - 1; }
+  T operator--(int) const __CPU__ __HC__ { return fetch_sub(1); }
+  T operator+=(T val) const __CPU__ __HC__ { return fetch_add(val) + val; }
+  T operator-=(T val) const __CPU__ __HC__ { return fetch_sub(val) - val; }
+
+  operator T() const __CPU__ __HC__ { return load(); }
+
+private:
+  // the strongest order a failed compare-and-swap may have with order
+  static std::memory_order failure_order(std::memory_order order) __CPU__ __HC__ {
+    return order == std::memory_order_acq_rel ? std::memory_order_acquire :
+           order == std::memory_order_release ? std::memory_order_relaxed : order;
+  }
+
+  T fetch_add(T val, std::memory_order order, std::true_type) const __CPU__ __HC__ {
+    return __atomic_fetch_add(ptr, val, order);
+  }
+
+  T fetch_add(T val, std::memory_order order, std::false_type) const __CPU__ __HC__ {
+    T old = load(std::memory_order_relaxed);
+    while (!compare_exchange_weak(old, old + val, order, std::memory_order_relaxed));
+    return old;
+  }
+
+  T* ptr;
+};
+
+} // namespace hc
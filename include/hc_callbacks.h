@@ -0,0 +1,98 @@
+#pragma once
+
+// Callbacks external profilers register to be told about the kernel
+// dispatches and the copies of the runtime, instead of intercepting the HSA
+// runtime. This header is usable from C, so tools written in C can use it.
+//
+// No callback is called unless one is registered, the runtime checks a
+// single pointer on each dispatch and copy otherwise.
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * A kernel dispatch, as it's submitted to a queue.
+ */
+typedef struct hc_dispatch_record {
+  // index of the accelerator, in the order of hc::accelerator::get_all()
+  uint32_t device;
+  // id of the HSA queue the dispatch is submitted to
+  uint64_t queue;
+  // name of the kernel, valid during the callback
+  const char* kernel_name;
+
+  // number of work-items and of work-items of a workgroup in each dimension
+  uint32_t grid[3];
+  uint32_t workgroup[3];
+
+  // bytes of group and private memory the kernel uses
+  uint32_t group_segment_size;
+  uint32_t private_segment_size;
+
+  // handle of the HSA signal completing the dispatch, 0 for a dispatch of a
+  // batch, whose completion is signaled by the barrier closing the batch
+  uint64_t signal;
+
+  // the same in the callbacks before and after the submission, unique among
+  // the dispatches and the copies
+  uint64_t correlation_id;
+} hc_dispatch_record;
+
+/**
+ * A copy between host and device memory or between device memories.
+ */
+typedef struct hc_copy_record {
+  // index of the accelerator, in the order of hc::accelerator::get_all()
+  uint32_t device;
+  const void* src;
+  void* dst;
+  size_t size;
+  // direction of the copy, a hc::hcMemcpyKind
+  int kind;
+  // 1 if the copy is asynchronous, 0 if it's done on return
+  int async;
+
+  // handle of the HSA signal completing an asynchronous copy, 0 otherwise
+  uint64_t signal;
+
+  // the same in the callbacks before and after the copy, unique among the
+  // dispatches and the copies
+  uint64_t correlation_id;
+} hc_copy_record;
+
+typedef void (*hc_dispatch_callback_t)(const hc_dispatch_record* record, void* user_data);
+typedef void (*hc_copy_callback_t)(const hc_copy_record* record, void* user_data);
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Register the callbacks called on each kernel dispatch, replacing the ones
+ * registered before. They're called by the thread dispatching the kernel,
+ * @p begin before the dispatch packet is written, and @p end once the
+ * doorbell of the queue is rung, the completion signal of the record can be
+ * waited for then.
+ *
+ * @param[in] begin Called before a dispatch, or NULL.
+ * @param[in] end Called after a dispatch is submitted, or NULL.
+ * @param[in] user_data Given to the callbacks.
+ */
+void hc_register_dispatch_callbacks(hc_dispatch_callback_t begin, hc_dispatch_callback_t end,
+                                    void* user_data);
+
+/**
+ * Register the callbacks called on each copy, replacing the ones registered
+ * before. They're called by the thread copying, @p begin before the copy,
+ * and @p end once a synchronous copy is done or an asynchronous one is
+ * submitted.
+ *
+ * @param[in] begin Called before a copy, or NULL.
+ * @param[in] end Called after a copy, or NULL.
+ * @param[in] user_data Given to the callbacks.
+ */
+void hc_register_copy_callbacks(hc_copy_callback_t begin, hc_copy_callback_t end, void* user_data);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,327 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <type_traits>
+
+#include "hc.hpp"
+
+/**
+ * Collectives of the lanes of a wavefront, or of a partition of it, and of
+ * the work-items of a tile: reductions, inclusive scans, broadcasts, votes
+ * and matches, over arithmetic types and other trivially copyable types.
+ *
+ * The wavefront collectives exchange values with the shuffles of hc.hpp, a
+ * 32-bit word at a time, over partitions of Width lanes, a power of 2 up to
+ * __HSA_WAVEFRONT_SIZE__, or the size a dispatch_wavefront_size() variant
+ * was instantiated for. All the lanes of a partition must be active and
+ * call them. The tile collectives reduce each wavefront with shuffles, and
+ * combine the wavefronts in tile_static memory; all the work-items of the
+ * tile must call them, and the tile may end with a partial wavefront.
+ */
+
+namespace Kalmar {
+
+// the 32-bit words a value is shuffled by
+template <typename T>
+union collective_words {
+    static_assert(std::is_trivially_copyable<T>::value, "collectives need trivially copyable types");
+    T value;
+    int words[(sizeof(T) + sizeof(int) - 1) / sizeof(int)];
+};
+
+template <typename T>
+inline T collective_shfl(T v, int srcLane, int width) __HC__ {
+    collective_words<T> bits;
+    bits.value = v;
+    for (int k = 0; k < static_cast<int>(sizeof(bits.words) / sizeof(int)); ++k)
+        bits.words[k] = hc::__shfl(bits.words[k], srcLane, width);
+    return bits.value;
+}
+
+template <typename T>
+inline T collective_shfl_up(T v, unsigned int delta, int width) __HC__ {
+    collective_words<T> bits;
+    bits.value = v;
+    for (int k = 0; k < static_cast<int>(sizeof(bits.words) / sizeof(int)); ++k)
+        bits.words[k] = hc::__shfl_up(bits.words[k], delta, width);
+    return bits.value;
+}
+
+template <typename T>
+inline T collective_shfl_down(T v, unsigned int delta, int width) __HC__ {
+    collective_words<T> bits;
+    bits.value = v;
+    for (int k = 0; k < static_cast<int>(sizeof(bits.words) / sizeof(int)); ++k)
+        bits.words[k] = hc::__shfl_down(bits.words[k], delta, width);
+    return bits.value;
+}
+
+template <typename T>
+inline T collective_shfl_xor(T v, int laneMask, int width) __HC__ {
+    collective_words<T> bits;
+    bits.value = v;
+    for (int k = 0; k < static_cast<int>(sizeof(bits.words) / sizeof(int)); ++k)
+        bits.words[k] = hc::__shfl_xor(bits.words[k], laneMask, width);
+    return bits.value;
+}
+
+// the operations of the votes of tiles
+struct collective_max {
+    int operator()(int a, int b) const __CPU__ __HC__ { return a > b ? a : b; }
+};
+
+struct collective_min {
+    int operator()(int a, int b) const __CPU__ __HC__ { return a < b ? a : b; }
+};
+
+// the position of a work-item in its tile, and the size of the tile
+template <int N>
+inline int collective_local_id(const hc::tiled_index<N>& tidx) __HC__ {
+    int id = 0;
+    for (int i = 0; i < N; ++i)
+        id = id * tidx.tile_dim[i] + tidx.local[i];
+    return id;
+}
+
+template <int N>
+inline int collective_tile_size(const hc::tiled_index<N>& tidx) __HC__ {
+    int size = 1;
+    for (int i = 0; i < N; ++i)
+        size *= tidx.tile_dim[i];
+    return size;
+}
+
+} // namespace Kalmar
+
+namespace hc {
+
+// ------------------------------------------------------------------------
+// wavefront collectives
+// ------------------------------------------------------------------------
+
+/**
+ * Returns the value "v" of the lane "lane" of the partition.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__, typename T>
+inline T wavefront_broadcast(T v, int lane) __HC__ {
+    return Kalmar::collective_shfl(v, lane, Width);
+}
+
+/** @{ */
+/**
+ * Returns op(v of lane 0, ..., v of the last lane) to all the lanes of the
+ * partition, in some order, op being associative and commutative; the sum
+ * of the values if no op is given.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__, typename T, typename BinaryOperation>
+inline T wavefront_reduce(T v, const BinaryOperation& op) __HC__ {
+    for (int mask = Width / 2; mask > 0; mask /= 2)
+        v = op(v, Kalmar::collective_shfl_xor(v, mask, Width));
+    return v;
+}
+
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__, typename T>
+inline T wavefront_reduce(T v) __HC__ {
+    return wavefront_reduce<Width>(v, std::plus<T>());
+}
+/** @} */
+
+/** @{ */
+/**
+ * Returns op(v of lane 0, ..., v of this lane) to each lane of the
+ * partition, op being associative; the sum of the values if no op is given.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__, typename T, typename BinaryOperation>
+inline T wavefront_inclusive_scan(T v, const BinaryOperation& op) __HC__ {
+    int lane = __lane_id() % Width;
+    for (unsigned int delta = 1; delta < Width; delta *= 2) {
+        T other = Kalmar::collective_shfl_up(v, delta, Width);
+        if (lane >= static_cast<int>(delta))
+            v = op(other, v);
+    }
+    return v;
+}
+
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__, typename T>
+inline T wavefront_inclusive_scan(T v) __HC__ {
+    return wavefront_inclusive_scan<Width>(v, std::plus<T>());
+}
+/** @} */
+
+/**
+ * Returns the mask of the lanes of the partition whose predicate is true,
+ * bit i for lane i of the partition.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__>
+inline uint64_t wavefront_ballot(bool predicate) __HC__ {
+    uint64_t mask = __ballot(predicate);
+    if (Width >= 64)
+        return mask;
+    int first = __lane_id() & ~(Width - 1);
+    return (mask >> first) & ((1ULL << Width) - 1);
+}
+
+/**
+ * Returns whether the predicate of any lane of the partition is true.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__>
+inline bool wavefront_any(bool predicate) __HC__ {
+    return wavefront_ballot<Width>(predicate) != 0;
+}
+
+/**
+ * Returns whether the predicates of all the lanes of the partition are true.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__>
+inline bool wavefront_all(bool predicate) __HC__ {
+    uint64_t all = Width >= 64 ? ~0ULL : (1ULL << Width) - 1;
+    return wavefront_ballot<Width>(predicate) == all;
+}
+
+/**
+ * Returns the mask of the lanes of the partition whose value "v" equals the
+ * one of this lane, bit i for lane i of the partition.
+ */
+template <unsigned int Width = __HSA_WAVEFRONT_SIZE__, typename T>
+inline uint64_t wavefront_match(T v) __HC__ {
+    uint64_t mask = 0;
+    for (unsigned int lane = 0; lane < Width; ++lane) {
+        if (Kalmar::collective_shfl(v, lane, Width) == v)
+            mask |= 1ULL << lane;
+    }
+    return mask;
+}
+
+// ------------------------------------------------------------------------
+// tile collectives
+// ------------------------------------------------------------------------
+
+/** @{ */
+/**
+ * Returns op(v of work-item 0, ..., v of the last work-item) to all the
+ * work-items of the tile, in some order, op being associative and
+ * commutative; the sum of the values if no op is given.
+ */
+template <unsigned int WaveSize = __HSA_WAVEFRONT_SIZE__, int N, typename T, typename BinaryOperation>
+inline T tile_reduce(const tiled_index<N>& tidx, T v, const BinaryOperation& op) __HC__ {
+    static_assert(WaveSize <= __HSA_WAVEFRONT_SIZE__, "the waves of a tile are at most a wavefront");
+    // the result of each wavefront of a tile of up to 1024 work-items
+    tile_static T waves[1024 / WaveSize];
+    tile_static T result;
+
+    int id = Kalmar::collective_local_id(tidx);
+    int size = Kalmar::collective_tile_size(tidx);
+    int wave = id / WaveSize;
+    int lane = id % WaveSize;
+    int waveValid = size - wave * WaveSize;
+    for (unsigned int delta = WaveSize / 2; delta > 0; delta /= 2) {
+        T other = Kalmar::collective_shfl_down(v, delta, WaveSize);
+        if (lane + static_cast<int>(delta) < waveValid)
+            v = op(v, other);
+    }
+    if (lane == 0)
+        waves[wave] = v;
+    tidx.barrier.wait();
+
+    // the first wavefront reduces the results of the wavefronts, the
+    // results are read before any of them is written again in the next call
+    int numWaves = (size + WaveSize - 1) / WaveSize;
+    if (wave == 0) {
+        if (lane < numWaves)
+            v = waves[lane];
+        for (unsigned int delta = WaveSize / 2; delta > 0; delta /= 2) {
+            T other = Kalmar::collective_shfl_down(v, delta, WaveSize);
+            if (lane + static_cast<int>(delta) < numWaves)
+                v = op(v, other);
+        }
+        if (lane == 0)
+            result = v;
+    }
+    tidx.barrier.wait();
+    return result;
+}
+
+template <unsigned int WaveSize = __HSA_WAVEFRONT_SIZE__, int N, typename T>
+inline T tile_reduce(const tiled_index<N>& tidx, T v) __HC__ {
+    return tile_reduce<WaveSize>(tidx, v, std::plus<T>());
+}
+/** @} */
+
+/** @{ */
+/**
+ * Returns op(v of work-item 0, ..., v of this work-item) to each work-item
+ * of the tile, in the order of their flattened local indices, op being
+ * associative; the sum of the values if no op is given.
+ */
+template <unsigned int WaveSize = __HSA_WAVEFRONT_SIZE__, int N, typename T, typename BinaryOperation>
+inline T tile_inclusive_scan(const tiled_index<N>& tidx, T v, const BinaryOperation& op) __HC__ {
+    static_assert(WaveSize <= __HSA_WAVEFRONT_SIZE__, "the waves of a tile are at most a wavefront");
+    // the result of each wavefront of a tile of up to 1024 work-items
+    tile_static T waves[1024 / WaveSize];
+    tile_static T prefixes[1024 / WaveSize];
+
+    int id = Kalmar::collective_local_id(tidx);
+    int size = Kalmar::collective_tile_size(tidx);
+    int wave = id / WaveSize;
+    int lane = id % WaveSize;
+    // the lanes past the end of a partial wavefront don't exist, and lower
+    // lanes never read them
+    v = wavefront_inclusive_scan<WaveSize>(v, op);
+    if (lane == WaveSize - 1 || id == size - 1)
+        waves[wave] = v;
+    tidx.barrier.wait();
+
+    int numWaves = (size + WaveSize - 1) / WaveSize;
+    if (wave == 0 && lane < numWaves) {
+        T total = waves[lane];
+        for (unsigned int delta = 1; delta < WaveSize; delta *= 2) {
+            T other = Kalmar::collective_shfl_up(total, delta, WaveSize);
+            if (lane >= static_cast<int>(delta))
+                total = op(other, total);
+        }
+        prefixes[lane] = total;
+    }
+    tidx.barrier.wait();
+    return wave == 0 ? v : op(prefixes[wave - 1], v);
+}
+
+template <unsigned int WaveSize = __HSA_WAVEFRONT_SIZE__, int N, typename T>
+inline T tile_inclusive_scan(const tiled_index<N>& tidx, T v) __HC__ {
+    return tile_inclusive_scan<WaveSize>(tidx, v, std::plus<T>());
+}
+/** @} */
+
+/**
+ * Returns the value "v" of the work-item of the tile whose flattened local
+ * index is "src" to all the work-items of the tile.
+ */
+template <int N, typename T>
+inline T tile_broadcast(const tiled_index<N>& tidx, T v, int src) __HC__ {
+    tile_static T value;
+    // the value of the previous call is read by all the work-items before
+    // it's overwritten
+    tidx.barrier.wait();
+    if (Kalmar::collective_local_id(tidx) == src)
+        value = v;
+    tidx.barrier.wait();
+    return value;
+}
+
+/**
+ * Returns whether the predicate of any work-item of the tile is true.
+ */
+template <unsigned int WaveSize = __HSA_WAVEFRONT_SIZE__, int N>
+inline bool tile_any(const tiled_index<N>& tidx, bool predicate) __HC__ {
+    return tile_reduce<WaveSize>(tidx, predicate ? 1 : 0, Kalmar::collective_max()) != 0;
+}
+
+/**
+ * Returns whether the predicates of all the work-items of the tile are true.
+ */
+template <unsigned int WaveSize = __HSA_WAVEFRONT_SIZE__, int N>
+inline bool tile_all(const tiled_index<N>& tidx, bool predicate) __HC__ {
+    return tile_reduce<WaveSize>(tidx, predicate ? 1 : 0, Kalmar::collective_min()) != 0;
+}
+
+} // namespace hc
@@ -2,12 +2,16 @@
 
 // C++ headers
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
 #include <cstdlib>
 #include <cstring>
 #include <exception>
+#include <functional>
 #include <future>
+#include <iterator>
+#include <list>
 #include <map>
 #include <memory>
 #include <set>
@@ -51,6 +55,16 @@ extern "C" __attribute__((const,amp)) int64_t amp_get_group_id(unsigned int n);
 #define tile_static static __attribute__((section("clamp_opencl_local")))
 #endif
 
+/// launch bounds of a kernel, put on the call operator of its functor or
+/// lambda, or on a grid_launch function:
+///   [=](hc::tiled_index<1> idx) hc_max_workgroup_dim(256,1,1) [[hc]] { ... }
+/// hc_max_workgroup_dim(x,y,z) is the largest extent of a workgroup in each
+/// dimension of the dispatch, tiled launches beyond it are rejected;
+/// hc_waves_per_eu(n) asks the register allocation to let n wavefronts run
+/// at once on an execution unit
+#define hc_max_workgroup_dim(x, y, z) __attribute__((annotate("hc_max_workgroup_dim(" #x "," #y "," #z ")")))
+#define hc_waves_per_eu(n) __attribute__((annotate("hc_waves_per_eu(" #n ")")))
+
 extern "C" __attribute__((noduplicate,hc)) void hc_barrier(unsigned int n);
 
 extern "C" __attribute__((noduplicate,amp)) void amp_barrier(unsigned int n) ;
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "hc.hpp"
+
+/// Default size in bytes of the chunks a mapped_array is paged to the
+/// accelerators in
+#ifndef HC_MAPPED_ARRAY_CHUNK_SIZE
+#define HC_MAPPED_ARRAY_CHUNK_SIZE (64 * 1024 * 1024)
+#endif
+
+namespace hc {
+
+/**
+ * An array of elements of type T backed by a file, for datasets larger than
+ * the memory of the accelerators, or of the host.
+ *
+ * The file is mapped into the address space of the process, and the host
+ * pages it in from the file as it's accessed. Accelerators access it in
+ * chunks of a fixed number of elements: each chunk is viewed by an
+ * array_view bound to the mapping, which is copied to an accelerator when a
+ * kernel first uses it there, and written back to the mapping, then to the
+ * file, if kernels modify it. Only the chunks in use take device memory.
+ *
+ * for_each_chunk() streams the array through an accelerator: the load of a
+ * chunk overlaps the kernels processing the chunk before it, and the write
+ * back of the chunk before that.
+ *
+ * A mapped_array of const elements is read-only, its file isn't modified and
+ * its chunks aren't written back.
+ */
+template <typename T>
+class mapped_array {
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "the elements of a mapped_array must be trivially copyable");
+    typedef typename std::remove_const<T>::type value_type;
+    static const bool writable = !std::is_const<T>::value;
+
+public:
+    /**
+     * Maps the file "path" of elements of type T. Writable arrays create the
+     * file if it doesn't exist, and extend it to "count" elements if it's
+     * smaller; a count of 0 maps the whole file.
+     *
+     * @param[in] path The file backing the array.
+     * @param[in] count The number of elements of the array, or 0.
+     * @param[in] chunk_size The number of elements of the chunks the
+     *                       array is paged to accelerators in.
+     */
+    explicit mapped_array(const std::string& path, size_t count = 0,
+                          size_t chunk_size = HC_MAPPED_ARRAY_CHUNK_SIZE / sizeof(T))
+        : m_fd(-1), m_data(nullptr), m_count(count), m_chunk(std::max<size_t>(chunk_size, 1)) {
+        m_fd = open(path.c_str(), writable ? O_RDWR | O_CREAT : O_RDONLY, 0644);
+        if (m_fd < 0)
+            throw Kalmar::runtime_exception("unable to open the file of mapped_array", 0);
+        struct stat st;
+        if (fstat(m_fd, &st) != 0) {
+            close(m_fd);
+            throw Kalmar::runtime_exception("unable to open the file of mapped_array", 0);
+        }
+        size_t fileCount = st.st_size / sizeof(T);
+        if (m_count == 0)
+            m_count = fileCount;
+        if (m_count > fileCount && (!writable || ftruncate(m_fd, m_count * sizeof(T)) != 0)) {
+            close(m_fd);
+            throw Kalmar::runtime_exception("the file of mapped_array is too small", 0);
+        }
+        if (m_count == 0)
+            return;
+        void* ptr = mmap(nullptr, m_count * sizeof(T), writable ? PROT_READ | PROT_WRITE : PROT_READ,
+                         MAP_SHARED, m_fd, 0);
+        if (ptr == MAP_FAILED) {
+            close(m_fd);
+            throw Kalmar::runtime_exception("unable to map the file of mapped_array", 0);
+        }
+        m_data = static_cast<value_type*>(ptr);
+    }
+
+    mapped_array(const mapped_array&) = delete;
+    mapped_array& operator=(const mapped_array&) = delete;
+
+    /// unmaps the file, the views of its chunks must be destroyed first
+    ~mapped_array() {
+        if (m_data)
+            munmap(m_data, m_count * sizeof(T));
+        if (m_fd >= 0)
+            close(m_fd);
+    }
+
+    /// the number of elements of the array
+    size_t size() const { return m_count; }
+
+    /// the number of elements of each chunk, the last one may be smaller
+    size_t chunk_size() const { return m_chunk; }
+
+    /// the number of chunks of the array
+    size_t chunk_count() const { return (m_count + m_chunk - 1) / m_chunk; }
+
+    /// the elements of the array on the host, as mapped from the file
+    T* data() const { return m_data; }
+
+    /**
+     * Returns a view of the chunk "i", bound to the mapping. The chunk is
+     * copied to an accelerator when a kernel first uses it there, and its
+     * modifications are written back when it's synchronized or the last view
+     * of it is destroyed.
+     */
+    array_view<T, 1> chunk(size_t i) const {
+        size_t first = i * m_chunk;
+        size_t count = std::min(m_chunk, m_count - first);
+        return array_view<T, 1>(extent<1>(count), m_data + first);
+    }
+
+    /**
+     * Calls "f" for each chunk in order, with the view of the chunk and the
+     * index of its first element in the array, to launch kernels processing
+     * it on "av". The next chunk is copied to "av" while those kernels run,
+     * and the chunk is written back while the next ones run: "f" shouldn't
+     * wait for its kernels. At most three chunks are on the accelerator at
+     * once. Returns once all of the chunks are processed and written back.
+     */
+    template <typename Func>
+    void for_each_chunk(accelerator_view av, Func f) const {
+        size_t chunks = chunk_count();
+        if (chunks == 0)
+            return;
+        array_view<T, 1> current = chunk(0);
+        current.prefetch_async(av);
+        array_view<T, 1> written = current;
+        completion_future writeback;
+        for (size_t i = 0; i < chunks; ++i) {
+            array_view<T, 1> next = current;
+            if (i + 1 < chunks) {
+                next = chunk(i + 1);
+                next.prefetch_async(av);
+            }
+            f(current, i * m_chunk);
+            // the chunk before is dropped once it's back on the host, or
+            // once its kernels are done if it's read-only
+            if (writeback.valid())
+                writeback.wait();
+            written = current;
+            writeback = writable ? written.synchronize_async() : av.create_marker();
+            current = next;
+        }
+        writeback.wait();
+    }
+
+    /// writes the modified elements of the mapping to the file
+    void flush() const {
+        if (m_data)
+            msync(m_data, m_count * sizeof(T), MS_SYNC);
+    }
+
+private:
+    int m_fd;
+    value_type* m_data;
+    size_t m_count;
+    size_t m_chunk;
+};
+
+} // namespace hc
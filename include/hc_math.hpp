@@ -7,6 +7,16 @@
 // this floating point type.
 #define HC_IMPLICIT_FLOAT_CONV double
 
+// HC_FAST_MATH makes the float math functions of a translation unit the ones
+// of hc::fast_math, as -ffast-math does unless HC_FAST_MATH is defined to 0
+#ifndef HC_FAST_MATH
+#ifdef __FAST_MATH__
+#define HC_FAST_MATH (1)
+#else
+#define HC_FAST_MATH (0)
+#endif
+#endif
+
 #ifdef __KALMAR_ACCELERATOR__
 
 #define HC_MATH_WRAPPER_1(function, arg1) \
@@ -103,6 +113,50 @@ inline void function(T arg1, Q arg2, Q arg3) __attribute__((hc,cpu)) { \
   hc::precise_math::function(arg1, arg2, arg3); \
 }
 
+#if HC_FAST_MATH
+
+// float arguments are taken by the function of fast_math
+#define HC_MATH_FAST_WRAPPER_1(function, arg1) \
+template<typename T> \
+inline \
+typename std::enable_if<std::is_same<T,float>::value,T>::type \
+ function(T arg1) __attribute__((hc,cpu)) { \
+  return hc::fast_math::function(arg1); \
+} \
+template<typename T> \
+inline \
+typename std::enable_if<!std::is_same<T,float>::value,T>::type \
+ function(T arg1) __attribute__((hc,cpu)) { \
+  return hc::precise_math::function(arg1); \
+}
+
+#define HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(function, arg1) \
+template<typename T> \
+inline \
+typename std::enable_if<std::is_integral<T>::value,HC_IMPLICIT_FLOAT_CONV>::type \
+ function(T arg1) __attribute__((hc,cpu)) { \
+  return hc::precise_math::function(static_cast<HC_IMPLICIT_FLOAT_CONV>(arg1)); \
+} \
+template<typename T> \
+inline \
+typename std::enable_if<std::is_same<T,float>::value,T>::type \
+ function(T arg1) __attribute__((hc,cpu)) { \
+  return hc::fast_math::function(arg1); \
+} \
+template<typename T> \
+inline \
+typename std::enable_if<std::is_floating_point<T>::value&&!std::is_same<T,float>::value,T>::type \
+ function(T arg1) __attribute__((hc,cpu)) { \
+  return hc::precise_math::function(arg1); \
+}
+
+#else
+
+#define HC_MATH_FAST_WRAPPER_1(function, arg1) HC_MATH_WRAPPER_1(function, arg1)
+#define HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(function, arg1) HC_MATH_WRAPPER_FP_OVERLOAD_1(function, arg1)
+
+#endif
+
 #else
 
 #define HC_MATH_WRAPPER_1(function, arg1) \
@@ -215,6 +269,9 @@ inline void function(T arg1, Q arg2, Q arg3) __attribute__((hc,cpu)) { \
   ::function(arg1, arg2, arg3); \
 }
 
+#define HC_MATH_FAST_WRAPPER_1(function, arg1) HC_MATH_WRAPPER_1(function, arg1)
+#define HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(function, arg1) HC_MATH_WRAPPER_FP_OVERLOAD_1(function, arg1)
+
 #endif
 
 
@@ -293,10 +350,10 @@ HC_MATH_WRAPPER_1(erff, x)
 HC_MATH_WRAPPER_FP_OVERLOAD_1(erf, x)
 HC_MATH_WRAPPER_1(erfcf, x)
 HC_MATH_WRAPPER_FP_OVERLOAD_1(erfc, x)
-HC_MATH_WRAPPER_1(expf, x)
-HC_MATH_WRAPPER_FP_OVERLOAD_1(exp, x)
-HC_MATH_WRAPPER_1(exp2f, x)
-HC_MATH_WRAPPER_FP_OVERLOAD_1(exp2, x)
+HC_MATH_FAST_WRAPPER_1(expf, x)
+HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(exp, x)
+HC_MATH_FAST_WRAPPER_1(exp2f, x)
+HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(exp2, x)
 HC_MATH_WRAPPER_1(exp10f, x)
 HC_MATH_WRAPPER_FP_OVERLOAD_1(exp10, x)
 HC_MATH_WRAPPER_1(expm1f, x)
@@ -317,12 +374,12 @@ HC_MATH_WRAPPER_2(fmodf, x, y)
 HC_MATH_WRAPPER_2(fmod, x, y)
 HC_MATH_WRAPPER_2(hypotf, x, y)
 HC_MATH_WRAPPER_2(hypot, x, y)
-HC_MATH_WRAPPER_1(logf, x)
-HC_MATH_WRAPPER_FP_OVERLOAD_1(log, x)
-HC_MATH_WRAPPER_1(log10f, x)
-HC_MATH_WRAPPER_FP_OVERLOAD_1(log10, x)
-HC_MATH_WRAPPER_1(log2f, x)
-HC_MATH_WRAPPER_FP_OVERLOAD_1(log2, x)
+HC_MATH_FAST_WRAPPER_1(logf, x)
+HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(log, x)
+HC_MATH_FAST_WRAPPER_1(log10f, x)
+HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(log10, x)
+HC_MATH_FAST_WRAPPER_1(log2f, x)
+HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(log2, x)
 HC_MATH_WRAPPER_1(log1pf, x)
 HC_MATH_WRAPPER_FP_OVERLOAD_1(log1p, x)
 HC_MATH_WRAPPER_1(logbf, x)
@@ -349,8 +406,8 @@ HC_MATH_WRAPPER_1(sinhf, x)
 HC_MATH_WRAPPER_FP_OVERLOAD_1(sinh, x)
 KALMAR_MATH_WRAPPER_1(sinpif, x)
 KALMAR_MATH_WRAPPER_FP_OVERLOAD_1(sinpi, x)
-HC_MATH_WRAPPER_1(sqrtf, x)
-HC_MATH_WRAPPER_FP_OVERLOAD_1(sqrt, x)
+HC_MATH_FAST_WRAPPER_1(sqrtf, x)
+HC_MATH_FAST_WRAPPER_FP_OVERLOAD_1(sqrt, x)
 HC_MATH_WRAPPER_1(tgammaf, x)
 HC_MATH_WRAPPER_FP_OVERLOAD_1(tgamma, x)
 HC_MATH_WRAPPER_1(tanf, x)
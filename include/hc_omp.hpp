@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+#include "hc.hpp"
+
+/// Number of work-items of the teams of a target loop
+#ifndef HC_OMP_TEAM_SIZE
+#define HC_OMP_TEAM_SIZE (256)
+#endif
+
+/// Maximum number of teams of a target reduction, each team reduces a
+/// strided part of the iterations and the host combines the teams
+#ifndef HC_OMP_MAX_TEAMS
+#define HC_OMP_MAX_TEAMS (1024)
+#endif
+
+namespace hc {
+
+/**
+ * Offload of OpenMP style loops to an accelerator.
+ *
+ * The functions of this namespace are what the "target" constructs of OpenMP
+ * 4 do for a loop, for code written for OpenMP host threads:
+ *
+ * @code
+ * #pragma omp target teams distribute parallel for map(to: a[0:n]) map(from: b[0:n])
+ * for (int i = 0; i < n; ++i)
+ *   b[i] = 2 * a[i];
+ * @endcode
+ *
+ * becomes
+ *
+ * @code
+ * hc::array_view<const int, 1> av_a = hc::omp::map_to(a, n);
+ * hc::array_view<int, 1> av_b = hc::omp::map_from(b, n);
+ * hc::omp::parallel_for(0, n, [=](int i) [[hc]] { av_b[i] = 2 * av_a[i]; });
+ * @endcode
+ *
+ * The body of the loop is compiled for the accelerator by the hc device
+ * pipeline like any other kernel, and launched through the queue of the
+ * accelerator_view. The map functions give the data environment of the
+ * region: their views copy the host data to the accelerator when the region
+ * first uses it there, and back to the host when the views are synchronized
+ * or destroyed.
+ *
+ * The compiler doesn't lower "#pragma omp target" itself, the loops have to
+ * be written as lambdas as above.
+ */
+namespace omp {
+
+/// the data of "map(to: ptr[0:count])", read by the accelerator and not
+/// copied back
+template <typename T>
+array_view<const T, 1> map_to(const T* ptr, size_t count) {
+    return array_view<const T, 1>(extent<1>(count), ptr);
+}
+
+/// the data of "map(from: ptr[0:count])", written by the accelerator and not
+/// copied to it
+template <typename T>
+array_view<T, 1> map_from(T* ptr, size_t count) {
+    array_view<T, 1> view(extent<1>(count), ptr);
+    view.discard_data();
+    return view;
+}
+
+/// the data of "map(tofrom: ptr[0:count])"
+template <typename T>
+array_view<T, 1> map_tofrom(T* ptr, size_t count) {
+    return array_view<T, 1>(extent<1>(count), ptr);
+}
+
+/**
+ * Launches body(i) for each i of [first, last) on "av" and returns without
+ * waiting for it, as "#pragma omp target ... nowait" does.
+ */
+template <typename Body>
+completion_future parallel_for_async(const accelerator_view& av, int first, int last, const Body& body) {
+    if (last <= first)
+        return completion_future();
+    return parallel_for_each(av, extent<1>(last - first), [=](index<1> idx) [[hc]] {
+        body(first + idx[0]);
+    });
+}
+
+/**
+ * Runs body(i) for each i of [first, last) on "av", and waits for it as the
+ * end of a target region does.
+ */
+template <typename Body>
+void parallel_for(const accelerator_view& av, int first, int last, const Body& body) {
+    completion_future done = parallel_for_async(av, first, last, body);
+    if (done.valid())
+        done.wait();
+}
+
+/// runs the loop on the default accelerator_view, as the default device
+template <typename Body>
+void parallel_for(int first, int last, const Body& body) {
+    parallel_for(accelerator().get_default_view(), first, last, body);
+}
+
+/**
+ * Runs the loop of "#pragma omp target ... reduction(op: var)" on "av":
+ * returns init combined by "op", an associative function, with body(i) for
+ * each i of [first, last), in no particular order.
+ */
+template <typename T, typename BinaryOp, typename Body>
+T parallel_for_reduce(const accelerator_view& av, int first, int last, T init,
+                      const BinaryOp& op, const Body& body) {
+    if (last <= first)
+        return init;
+    const int count = last - first;
+    int teams = (count + HC_OMP_TEAM_SIZE - 1) / HC_OMP_TEAM_SIZE;
+    if (teams > HC_OMP_MAX_TEAMS)
+        teams = HC_OMP_MAX_TEAMS;
+    const int stride = teams * HC_OMP_TEAM_SIZE;
+    array<T, 1> partial(extent<1>(teams), av);
+
+    // every team has at least an iteration, the first of its first work-item
+    parallel_for_each(av, extent<1>(stride).tile(HC_OMP_TEAM_SIZE), [=, &partial](tiled_index<1> tidx) [[hc]] {
+        tile_static T values[HC_OMP_TEAM_SIZE];
+        tile_static int valid[HC_OMP_TEAM_SIZE];
+        const int local = tidx.local[0];
+        int i = tidx.global[0];
+        T value;
+        int has = 0;
+        for (; i < count; i += stride) {
+            T v = body(first + i);
+            value = has ? op(value, v) : v;
+            has = 1;
+        }
+        if (has)
+            values[local] = value;
+        valid[local] = has;
+        tidx.barrier.wait();
+        for (int s = HC_OMP_TEAM_SIZE / 2; s > 0; s >>= 1) {
+            if (local < s && valid[local + s]) {
+                values[local] = valid[local] ? op(values[local], values[local + s]) : values[local + s];
+                valid[local] = 1;
+            }
+            tidx.barrier.wait();
+        }
+        if (local == 0)
+            partial[tidx.tile[0]] = values[0];
+    }).wait();
+
+    std::vector<T> teamValues(teams);
+    copy(partial, teamValues.begin());
+    for (int t = 0; t < teams; ++t)
+        init = op(init, teamValues[t]);
+    return init;
+}
+
+/// runs the reduction on the default accelerator_view, as the default device
+template <typename T, typename BinaryOp, typename Body>
+T parallel_for_reduce(int first, int last, T init, const BinaryOp& op, const Body& body) {
+    return parallel_for_reduce(accelerator().get_default_view(), first, last, init, op, body);
+}
+
+} // namespace omp
+
+} // namespace hc
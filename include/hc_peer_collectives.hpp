@@ -0,0 +1,391 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <vector>
+
+#include "hc.hpp"
+#include "hc_am.hpp"
+
+/**
+ * Collectives across the accelerators of a node: all-reduce, broadcast and
+ * all-gather of buffers allocated with am_alloc, one per accelerator_view.
+ *
+ * The views are arranged in a ring, picked from the peer links of their
+ * accelerators, and the data moves along the ring a chunk at a time: each
+ * view copies the chunks it receives from the device memory of the view
+ * before it, mapped to it with am_map_to_peers, and reduces them with a
+ * kernel of its own. When two neighbours of the ring aren't peers, the
+ * chunks go through pinned host memory instead.
+ *
+ * The host doesn't wait for any of it. The commands of each step are
+ * ordered after the step of the neighbour they read with markers of
+ * create_marker(), which the accelerators wait for with barrier-AND packets
+ * across their queues, and the collectives return a completion_future per
+ * view, so the views can go on with other commands and overlap them with
+ * the collective. Commands submitted to a view afterwards, on an in-order
+ * queue, are ordered after the collective there.
+ */
+
+namespace hc {
+
+namespace collectives {
+
+class communicator {
+public:
+    /**
+     * Creates a communicator of @p views, rank i being views[i]. The ring
+     * starts at rank 0 and goes, step by step, to the rank closest to the
+     * last one by get_peer_distance(), peers before the ranks they can't
+     * access.
+     */
+    explicit communicator(const std::vector<accelerator_view>& views) : views(views) {
+        const int n = static_cast<int>(views.size());
+        if (n == 0)
+            throw std::invalid_argument("hc::collectives::communicator needs at least one accelerator_view");
+
+        std::vector<bool> placed(n, false);
+        ring.push_back(0);
+        placed[0] = true;
+        for (int p = 1; p < n; ++p) {
+            const accelerator last = views[ring.back()].get_accelerator();
+            int next = -1;
+            uint64_t nextDistance = UINT64_MAX;
+            for (int r = 0; r < n; ++r) {
+                if (placed[r])
+                    continue;
+                const accelerator acc = views[r].get_accelerator();
+                uint64_t distance = static_cast<uint64_t>(last.get_peer_distance(acc)) +
+                                    acc.get_peer_distance(last);
+                if (next < 0 || distance < nextDistance) {
+                    next = r;
+                    nextDistance = distance;
+                }
+            }
+            ring.push_back(next);
+            placed[next] = true;
+        }
+
+        position.resize(n);
+        for (int p = 0; p < n; ++p)
+            position[ring[p]] = p;
+    }
+
+    /// the number of ranks
+    int size() const { return static_cast<int>(views.size()); }
+
+    /// the accelerator_view of @p rank
+    const accelerator_view& get_view(int rank) const { return views[rank]; }
+
+    /// the ranks in the order of the ring, each receiving from the one before
+    const std::vector<int>& get_ring() const { return ring; }
+
+    /// true if every rank of the ring can access the device memory of the
+    /// rank before it, so no chunk goes through host memory
+    bool is_peer_ring() const {
+        for (int p = 0; p < size(); ++p)
+            if (!reads_peer(p))
+                return false;
+        return true;
+    }
+
+    /**
+     * Replaces buffers[r][0, count) of every rank r by op over the ranks of
+     * buffers[r][i], for each i; the sum if no op is given. op must be
+     * associative and commutative, and callable in kernels.
+     *
+     * Ring all-reduce: the buffers are cut in size() chunks, each rank adds
+     * a chunk of the rank before it to its own in size() - 1 steps, after
+     * which each has one chunk reduced over all the ranks, and passes the
+     * reduced chunks on in size() - 1 more steps.
+     *
+     * @return a future per rank, ready once the buffer of the rank holds
+     *         the result.
+     */
+    template <typename T, typename BinaryOp>
+    std::vector<completion_future> all_reduce(const std::vector<T*>& buffers, size_t count, const BinaryOp& op) {
+        check_buffers(buffers);
+        const int n = size();
+        std::vector<completion_future> last(n);
+        if (n == 1 || count == 0)
+            return markers(last);
+
+        map_to_neighbours(buffers, count * sizeof(T));
+        const size_t chunkCount = (count + n - 1) / n;
+        std::vector<T*> scratch(n);
+        for (int r = 0; r < n; ++r) {
+            accelerator acc = views[r].get_accelerator();
+            scratch[r] = static_cast<T*>(am_alloc(chunkCount * sizeof(T), acc, amPooled));
+            if (scratch[r] == nullptr)
+                throw std::runtime_error("hc::collectives::all_reduce can't allocate its scratch memory");
+        }
+        std::vector<void*> staging = alloc_staging(chunkCount * sizeof(T));
+
+        // reduce-scatter: at step s, the rank at position p reduces the chunk
+        // (p - 1 - s) mod n, which the rank before it has reduced over s + 1
+        // ranks, into its own
+        for (int s = 0; s < n - 1; ++s) {
+            for (int p = 0; p < n; ++p) {
+                const int c = (p - 1 - s + 2 * n) % n;
+                const size_t first = chunk_first(c, chunkCount, count);
+                const size_t length = chunk_first(c + 1, chunkCount, count) - first;
+                if (length == 0)
+                    continue;
+                const int r = ring[p];
+                const int q = ring[(p + n - 1) % n];
+                transfer(p, buffers[q] + first, scratch[r], length * sizeof(T), staging, last);
+                T* dst = buffers[r] + first;
+                const T* src = scratch[r];
+                last[r] = parallel_for_each(views[r], extent<1>(static_cast<int>(length)), [=](index<1> idx) [[hc]] {
+                    dst[idx[0]] = op(dst[idx[0]], src[idx[0]]);
+                });
+            }
+        }
+
+        // the rank at position p now has the chunk (p + 1) mod n reduced over
+        // all the ranks; no rank writes a chunk a neighbour still reads
+        // before every rank is done reducing
+        barrier(last);
+
+        // all-gather: at step s, the rank at position p copies the chunk
+        // (p - s) mod n from the rank before it
+        for (int s = 0; s < n - 1; ++s) {
+            for (int p = 0; p < n; ++p) {
+                const int c = (p - s + n) % n;
+                const size_t first = chunk_first(c, chunkCount, count);
+                const size_t length = chunk_first(c + 1, chunkCount, count) - first;
+                if (length == 0)
+                    continue;
+                const int q = ring[(p + n - 1) % n];
+                transfer(p, buffers[q] + first, buffers[ring[p]] + first, length * sizeof(T), staging, last);
+            }
+        }
+
+        for (int r = 0; r < n; ++r)
+            am_free_async(scratch[r], views[r]);
+        free_staging(staging);
+        return markers(last);
+    }
+
+    template <typename T>
+    std::vector<completion_future> all_reduce(const std::vector<T*>& buffers, size_t count) {
+        return all_reduce(buffers, count, std::plus<T>());
+    }
+
+    /**
+     * Copies buffers[root][0, count) to the buffers of all the other ranks.
+     *
+     * The data goes around the ring from the root a chunk at a time, so every
+     * link of the ring moves a chunk at once.
+     *
+     * @return a future per rank, ready once the buffer of the rank holds the
+     *         data of the root.
+     */
+    template <typename T>
+    std::vector<completion_future> broadcast(const std::vector<T*>& buffers, size_t count, int root) {
+        check_buffers(buffers);
+        if (root < 0 || root >= size())
+            throw std::invalid_argument("hc::collectives::broadcast of a rank out of the communicator");
+        const int n = size();
+        std::vector<completion_future> last(n);
+        if (n == 1 || count == 0)
+            return markers(last);
+
+        map_to_neighbours(buffers, count * sizeof(T));
+        const size_t chunkCount = (count + n - 1) / n;
+        std::vector<void*> staging = alloc_staging(chunkCount * sizeof(T));
+        const int rootPosition = position[root];
+        for (int c = 0; c < n; ++c) {
+            const size_t first = chunk_first(c, chunkCount, count);
+            const size_t length = chunk_first(c + 1, chunkCount, count) - first;
+            if (length == 0)
+                continue;
+            for (int h = 1; h < n; ++h) {
+                const int p = (rootPosition + h) % n;
+                const int q = ring[(p + n - 1) % n];
+                transfer(p, buffers[q] + first, buffers[ring[p]] + first, length * sizeof(T), staging, last);
+            }
+        }
+        free_staging(staging);
+        return markers(last);
+    }
+
+    /**
+     * Copies send[r][0, count) of every rank r to recv[k][r * count,
+     * (r + 1) * count) of every rank k.
+     *
+     * Each rank copies its own data, then passes the data of the other
+     * ranks on along the ring in size() - 1 steps.
+     *
+     * @return a future per rank, ready once the recv buffer of the rank
+     *         holds the data of all the ranks.
+     */
+    template <typename T>
+    std::vector<completion_future> all_gather(const std::vector<const T*>& send, const std::vector<T*>& recv,
+                                              size_t count) {
+        check_buffers(send);
+        check_buffers(recv);
+        const int n = size();
+        std::vector<completion_future> last(n);
+        if (count == 0)
+            return markers(last);
+
+        for (int r = 0; r < n; ++r)
+            last[r] = ordered(views[r], am_copy_async(recv[r] + r * count, send[r], count * sizeof(T), views[r]));
+        if (n == 1)
+            return last;
+
+        map_to_neighbours(recv, n * count * sizeof(T));
+        std::vector<void*> staging = alloc_staging(count * sizeof(T));
+        for (int s = 0; s < n - 1; ++s) {
+            for (int p = 0; p < n; ++p) {
+                const int origin = ring[(p - 1 - s + 2 * n) % n];
+                const int q = ring[(p + n - 1) % n];
+                transfer(p, recv[q] + origin * count, recv[ring[p]] + origin * count, count * sizeof(T),
+                         staging, last);
+            }
+        }
+        free_staging(staging);
+        return markers(last);
+    }
+
+private:
+    std::vector<accelerator_view> views;
+
+    // the ranks in the order of the ring, and the position of each rank in it
+    std::vector<int> ring;
+    std::vector<int> position;
+
+    // the first element of chunk c of a buffer of count elements
+    static size_t chunk_first(int c, size_t chunkCount, size_t count) {
+        const size_t first = c * chunkCount;
+        return first < count ? first : count;
+    }
+
+    template <typename Buffer>
+    void check_buffers(const std::vector<Buffer>& buffers) const {
+        if (buffers.size() != views.size())
+            throw std::invalid_argument("hc::collectives needs a buffer per rank of the communicator");
+    }
+
+    // whether the rank at position p can read the device memory of the rank
+    // before it
+    bool reads_peer(int p) const {
+        const int n = size();
+        const accelerator acc = views[ring[p]].get_accelerator();
+        const accelerator prev = views[ring[(p + n - 1) % n]].get_accelerator();
+        return prev.get_is_peer(acc);
+    }
+
+    // maps the buffer of each rank to the rank after it in the ring which
+    // reads it
+    template <typename Buffer>
+    void map_to_neighbours(const std::vector<Buffer>& buffers, size_t bytes) {
+        const int n = size();
+        for (int p = 0; p < n; ++p) {
+            if (!reads_peer(p))
+                continue;
+            const accelerator acc = views[ring[p]].get_accelerator();
+            void* ptr = const_cast<void*>(static_cast<const void*>(buffers[ring[(p + n - 1) % n]]));
+            if (am_map_to_peers(ptr, 1, &acc) != AM_SUCCESS)
+                throw std::runtime_error("hc::collectives can't map a buffer to the next rank of the ring");
+        }
+    }
+
+    // pinned host memory for the chunks received by each position whose
+    // rank can't read the memory of the rank before it, mapped to both
+    std::vector<void*> alloc_staging(size_t bytes) {
+        const int n = size();
+        std::vector<void*> staging(n, nullptr);
+        for (int p = 0; p < n; ++p) {
+            if (reads_peer(p))
+                continue;
+            accelerator acc = views[ring[p]].get_accelerator();
+            const accelerator prev = views[ring[(p + n - 1) % n]].get_accelerator();
+            staging[p] = am_alloc(bytes, acc, amHostPinned);
+            if (staging[p] == nullptr || am_map_to_peers(staging[p], 1, &prev) != AM_SUCCESS)
+                throw std::runtime_error("hc::collectives can't allocate its host memory");
+        }
+        stagingReader.assign(n, completion_future());
+        return staging;
+    }
+
+    // the staging memory is freed once the rank reading it is done, which is
+    // after the rank writing it is
+    void free_staging(const std::vector<void*>& staging) {
+        for (int p = 0; p < size(); ++p)
+            if (staging[p] != nullptr)
+                am_free_async(staging[p], views[ring[p]]);
+    }
+
+    // the last copy out of the staging memory of each position, which the
+    // next copy into it waits for
+    std::vector<completion_future> stagingReader;
+
+    /**
+     * Copies bytes from src, in the memory of the rank before position p, to
+     * dst, in the memory of the rank at position p, after the commands of
+     * "last" of the rank before. Updates "last" of the ranks with the
+     * commands enqueued.
+     */
+    void transfer(int p, const void* src, void* dst, size_t bytes, const std::vector<void*>& staging,
+                  std::vector<completion_future>& last) {
+        const int n = size();
+        const int r = ring[p];
+        const int q = ring[(p + n - 1) % n];
+        accelerator_view& view = views[r];
+        if (staging[p] == nullptr) {
+            // peer DMA, after the rank before has written the chunk
+            wait_for(view, last[q], last[r]);
+            last[r] = ordered(view, am_copy_async(dst, src, bytes, view));
+            return;
+        }
+
+        // through host memory: the rank before copies the chunk out, once
+        // the last chunk staged has been copied in here
+        accelerator_view& prevView = views[q];
+        wait_for(prevView, stagingReader[p], last[q]);
+        completion_future out = ordered(prevView, am_copy_async(staging[p], src, bytes, prevView));
+        last[q] = out;
+        wait_for(view, out, last[r]);
+        last[r] = ordered(view, am_copy_async(dst, staging[p], bytes, view));
+        stagingReader[p] = last[r];
+    }
+
+    // orders the commands submitted to av next after "dependency", and
+    // records the marker in "last" of the rank of av
+    static void wait_for(accelerator_view& av, const completion_future& dependency, completion_future& last) {
+        if (dependency.valid())
+            last = av.create_marker(std::vector<completion_future>(1, dependency));
+    }
+
+    // the future of a copy, or a marker after it if it was done on the host
+    static completion_future ordered(accelerator_view& av, const completion_future& done) {
+        return done.valid() ? done : av.create_marker();
+    }
+
+    // orders the commands submitted next to every rank after the commands
+    // of "last" of all the ranks
+    void barrier(std::vector<completion_future>& last) {
+        std::vector<completion_future> all;
+        for (auto& f : last)
+            if (f.valid())
+                all.push_back(f);
+        for (int r = 0; r < size(); ++r)
+            last[r] = views[r].create_marker(all);
+    }
+
+    // a future per rank, ready once the commands of "last" of the rank are
+    std::vector<completion_future> markers(std::vector<completion_future>& last) {
+        for (int r = 0; r < size(); ++r)
+            if (!last[r].valid())
+                last[r] = views[r].create_marker();
+        return last;
+    }
+};
+
+} // namespace collectives
+
+} // namespace hc
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <thread>
+#include <type_traits>
+
+#include "hc_am.hpp"
+
+/// Number of times the host spins on the work queue of a persistent_kernel
+/// before it yields, while waiting for free slots or for descriptors to be done
+#ifndef HC_PERSISTENT_SPIN_COUNT
+#define HC_PERSISTENT_SPIN_COUNT (1024)
+#endif
+
+namespace hc {
+
+/**
+ * A kernel which keeps running on an accelerator, and runs a function for
+ * each work descriptor the host enqueues to it.
+ *
+ * Each work-item of one long-running grid claims descriptors of a work queue
+ * kept in pinned host memory, which the device accesses directly, and runs
+ * the function on them. The host writes descriptors to the queue and bumps
+ * a published count instead of writing an AQL packet per launch, so tiny
+ * kernels launched at a high rate don't pay for a dispatch each. Descriptors
+ * are run by any work-item and in any order, the host waits for each of them
+ * with the ticket enqueue() returns. Descriptors are enqueued by one host
+ * thread at a time.
+ *
+ * The grid runs on an accelerator_view of its own, created on the
+ * accelerator of the view given, until stop() is called or the
+ * persistent_kernel is destroyed. Its work-items spin while the queue is
+ * empty, so the grid should be much smaller than the accelerator. It's only
+ * supported on HSA accelerators.
+ *
+ * @tparam Descriptor A trivially copyable type of the work descriptors.
+ */
+template <typename Descriptor>
+class persistent_kernel {
+    static_assert(std::is_trivially_copyable<Descriptor>::value,
+                  "descriptors of a persistent_kernel must be trivially copyable");
+
+    // a descriptor, and the ticket of the last descriptor done in the slot
+    // plus one, 0 if none was done yet
+    struct slot {
+        Descriptor desc;
+        uint64_t done;
+    };
+
+    // counters shared by the host and the work-items
+    struct header {
+        // descriptors written by the host
+        uint64_t published;
+        // descriptors claimed by work-items
+        uint64_t claimed;
+        // set by the host to stop the work-items once published ones are done
+        uint64_t stop;
+    };
+
+    accelerator_view view;
+    header* head;
+    slot* slots;
+    uint64_t capacity;
+    uint64_t next;
+    completion_future grid;
+
+    static uint64_t load(const uint64_t* p) {
+        return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+    }
+
+    static void store(uint64_t* p, uint64_t val) {
+        __atomic_store_n(p, val, __ATOMIC_RELEASE);
+    }
+
+    static void backoff(int& spins) {
+        if (++spins >= HC_PERSISTENT_SPIN_COUNT) {
+            spins = 0;
+            std::this_thread::yield();
+        }
+    }
+
+public:
+    /**
+     * Launch the persistent grid.
+     *
+     * @param[in] av The accelerator_view whose accelerator runs the grid.
+     * @param[in] workers The number of work-items of the grid.
+     * @param[in] capacity The number of descriptors the work queue holds.
+     * @param[in] kernel A function called as kernel(desc) on the device, for
+     *                   each descriptor enqueued.
+     */
+    template <typename Kernel>
+    persistent_kernel(const accelerator_view& av, unsigned int workers, unsigned int capacity, const Kernel& kernel)
+        : view(av.get_accelerator().create_view()),
+          head(nullptr), slots(nullptr), capacity(capacity), next(0), grid() {
+        if (!av.get_accelerator().is_hsa_accelerator() || workers == 0 || capacity == 0) {
+            throw Kalmar::runtime_exception("persistent_kernel requires an HSA accelerator, workers and capacity", 0);
+        }
+        accelerator acc = view.get_accelerator();
+        head = static_cast<header*>(am_alloc(sizeof(header), acc, amHostPinned));
+        slots = static_cast<slot*>(am_alloc(sizeof(slot) * capacity, acc, amHostPinned));
+        if (head == nullptr || slots == nullptr) {
+            am_free(head);
+            am_free(slots);
+            throw Kalmar::runtime_exception("unable to allocate the work queue of persistent_kernel", 0);
+        }
+        memset(head, 0, sizeof(header));
+        memset(slots, 0, sizeof(slot) * capacity);
+
+        header* h = head;
+        slot* s = slots;
+        uint64_t n = this->capacity;
+        grid = parallel_for_each(view, extent<1>(workers), [=](index<1>) __HC__ {
+            // a single loop, rather than one polling for each ticket, lets
+            // work-items of a wavefront waiting for different tickets run
+            // the descriptors published for them while the others wait
+            uint64_t ticket = atomic_fetch_add(&h->claimed, (uint64_t)1);
+            for (;;) {
+                // descriptors published before stop are done first
+                if (atomic_fetch_add(&h->published, (uint64_t)0) > ticket) {
+                    slot& work = s[ticket % n];
+                    kernel(work.desc);
+                    atomic_exchange(&work.done, ticket + 1);
+                    ticket = atomic_fetch_add(&h->claimed, (uint64_t)1);
+                } else if (atomic_fetch_add(&h->stop, (uint64_t)0) != 0) {
+                    return;
+                }
+            }
+        });
+    }
+
+    persistent_kernel(const persistent_kernel&) = delete;
+    persistent_kernel& operator=(const persistent_kernel&) = delete;
+
+    ~persistent_kernel() {
+        stop();
+        am_free(head);
+        am_free(slots);
+    }
+
+    /**
+     * Enqueue a descriptor, waiting for a slot of the work queue to be free.
+     *
+     * @return The ticket of the descriptor, to be waited for with wait().
+     */
+    uint64_t enqueue(const Descriptor& desc) {
+        uint64_t ticket = next++;
+        slot& work = slots[ticket % capacity];
+        // the slot is free once the descriptor capacity tickets earlier is done
+        int spins = 0;
+        while (ticket >= capacity && load(&work.done) < ticket - capacity + 1) {
+            backoff(spins);
+        }
+        work.desc = desc;
+        // the doorbell: work-items see the descriptor once it's published
+        store(&head->published, ticket + 1);
+        return ticket;
+    }
+
+    /**
+     * Check if the descriptor of ticket is done.
+     */
+    bool is_done(uint64_t ticket) const {
+        return load(&slots[ticket % capacity].done) >= ticket + 1;
+    }
+
+    /**
+     * Wait for the descriptor of ticket to be done.
+     */
+    void wait(uint64_t ticket) const {
+        int spins = 0;
+        while (!is_done(ticket)) {
+            backoff(spins);
+        }
+    }
+
+    /**
+     * Wait for all the descriptors enqueued to be done.
+     */
+    void wait_all() const {
+        for (uint64_t ticket = (next > capacity) ? next - capacity : 0; ticket < next; ++ticket) {
+            wait(ticket);
+        }
+    }
+
+    /**
+     * Stop the grid once all the descriptors enqueued are done, and wait for
+     * it to finish. No descriptor may be enqueued afterwards.
+     */
+    void stop() {
+        if (grid.valid()) {
+            store(&head->stop, 1);
+            grid.wait();
+            grid = completion_future();
+        }
+    }
+};
+
+} // namespace hc
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "hc.hpp"
+#include "hc_am.hpp"
+#include "hc_stats.h"
+
+namespace hc {
+
+/**
+ * Streams chunks of data through an accelerator, overlapping the copies of
+ * the chunks to and from it with the kernels processing them.
+ *
+ * The pipeline keeps a ring of "depth" slots, each with a device array for
+ * the input of a chunk, one for its output, and buffers of pinned host memory
+ * they're copied from and to. The chunks are copied in on an
+ * accelerator_view, processed on another one, and copied out on a third one:
+ * each stage waits for the stage before on the accelerator, through a marker
+ * with the dependencies of another view, so the copies of a chunk run while
+ * the kernels of the chunks around it do. The host fills and drains the
+ * buffers of a slot while the other slots are in flight. A depth of 2 is
+ * double buffering, 3 lets both copies overlap the kernels.
+ *
+ * It needs the hc_am library.
+ *
+ * @tparam In The type of the elements copied to the accelerator.
+ * @tparam Out The type of the elements copied back from it.
+ */
+template <typename In, typename Out = In>
+class pipeline {
+    struct slot {
+        slot(size_t capacity, accelerator& acc, accelerator_view& av)
+            : in(extent<1>(capacity), av), out(extent<1>(capacity), av),
+            hostIn(static_cast<In*>(am_alloc(capacity * sizeof(In), acc, amHostPinned))),
+            hostOut(static_cast<Out*>(am_alloc(capacity * sizeof(Out), acc, amHostPinned))),
+            count(0), busy(false) {}
+
+        ~slot() {
+            am_free(hostIn);
+            am_free(hostOut);
+        }
+
+        array<In, 1> in;
+        array<Out, 1> out;
+        In* hostIn;
+        Out* hostOut;
+        size_t count;
+        bool busy;
+        completion_future upload;
+        completion_future started;
+        completion_future computed;
+        completion_future download;
+    };
+
+public:
+    /**
+     * Creates a pipeline of chunks of at most "capacity" elements, with
+     * "depth" slots on the accelerator "acc", which gets three new
+     * accelerator_views.
+     */
+    explicit pipeline(size_t capacity, unsigned int depth = 3, accelerator acc = accelerator())
+        : m_capacity(capacity), m_acc(acc),
+        m_upload(acc.create_view()), m_compute(acc.create_view()), m_download(acc.create_view()),
+        m_slots(), m_stats(), m_elapsed(0), m_first(0), m_last(0) {
+        if (capacity == 0 || depth == 0)
+            throw Kalmar::runtime_exception("pipeline requires a capacity and a depth", 0);
+        // the markers around the kernels are timed for get_stats()
+        m_compute.set_profiling_period(1);
+        for (unsigned int i = 0; i < depth; ++i) {
+            m_slots.emplace_back(new slot(capacity, m_acc, m_compute));
+            if (m_slots.back()->hostIn == nullptr || m_slots.back()->hostOut == nullptr)
+                throw Kalmar::runtime_exception("unable to allocate the host buffers of pipeline", 0);
+        }
+    }
+
+    pipeline(const pipeline&) = delete;
+    pipeline& operator=(const pipeline&) = delete;
+
+    /// the accelerator_view the kernels are run on
+    accelerator_view get_compute_view() const { return m_compute; }
+
+    /**
+     * Runs chunks through the pipeline until the producer has no more.
+     *
+     * @param[in] produce Called as produce(In* buffer, size_t capacity) to
+     *                    fill the buffer of the next chunk on the host, and
+     *                    returns its number of elements, 0 at the end.
+     * @param[in] kernel Called as kernel(accelerator_view& av,
+     *                   const array_view<const In, 1>& in,
+     *                   const array_view<Out, 1>& out) to launch the kernels
+     *                   of a chunk on "av" without waiting for them, the
+     *                   views have the extent of the chunk.
+     * @param[in] consume Called as consume(const Out* buffer, size_t count)
+     *                    with the output of each chunk, in order, once it's
+     *                    back on the host.
+     * @return The number of chunks run.
+     */
+    template <typename Producer, typename Kernel, typename Consumer>
+    size_t run(Producer produce, Kernel kernel, Consumer consume) {
+        m_first = m_last = 0;
+        size_t chunks = 0;
+        for (;; ++chunks) {
+            slot& s = *m_slots[chunks % m_slots.size()];
+            if (s.busy)
+                drain(s, consume);
+            s.count = produce(s.hostIn, m_capacity);
+            if (s.count == 0)
+                break;
+            if (s.count > m_capacity)
+                s.count = m_capacity;
+
+            s.upload = m_upload.copy_async(s.hostIn, s.in.accelerator_pointer(),
+                                           s.count * sizeof(In), hcMemcpyHostToDevice);
+            s.started = m_compute.create_marker(std::vector<completion_future>(1, s.upload));
+            array_view<const In, 1> in = array_view<const In, 1>(s.in).section(0, s.count);
+            array_view<Out, 1> out = array_view<Out, 1>(s.out).section(0, s.count);
+            kernel(m_compute, in, out);
+            s.computed = m_compute.create_marker();
+            m_download.create_marker(std::vector<completion_future>(1, s.computed));
+            s.download = m_download.copy_async(s.out.accelerator_pointer(), s.hostOut,
+                                               s.count * sizeof(Out), hcMemcpyDeviceToHost);
+            s.busy = true;
+        }
+        // the chunks in flight, oldest first
+        for (size_t i = 0; i < m_slots.size(); ++i) {
+            slot& s = *m_slots[(chunks + i) % m_slots.size()];
+            if (s.busy)
+                drain(s, consume);
+        }
+        if (m_last > m_first)
+            m_elapsed += m_last - m_first;
+        return chunks;
+    }
+
+    /**
+     * Returns the activity of the chunks run so far, and how much of the
+     * copies and kernels overlapped.
+     */
+    hc_pipeline_stats get_stats() const {
+        hc_pipeline_stats stats = m_stats;
+        stats.upload_ns = to_ns(m_stats.upload_ns);
+        stats.kernel_ns = to_ns(m_stats.kernel_ns);
+        stats.download_ns = to_ns(m_stats.download_ns);
+        stats.elapsed_ns = to_ns(m_elapsed);
+        uint64_t busy = stats.upload_ns + stats.kernel_ns + stats.download_ns;
+        stats.overlap_ns = busy > stats.elapsed_ns ? busy - stats.elapsed_ns : 0;
+        return stats;
+    }
+
+private:
+    // waits for the chunk of "s" to be back on the host, hands it to the
+    // consumer and accounts for it, in ticks until get_stats()
+    template <typename Consumer>
+    void drain(slot& s, Consumer& consume) {
+        s.download.wait();
+        consume(const_cast<const Out*>(s.hostOut), s.count);
+        s.busy = false;
+
+        m_stats.chunks++;
+        m_stats.bytes_in += s.count * sizeof(In);
+        m_stats.bytes_out += s.count * sizeof(Out);
+        m_stats.upload_ns += span(s.upload.get_begin_tick(), s.upload.get_end_tick());
+        m_stats.kernel_ns += span(s.started.get_end_tick(), s.computed.get_end_tick());
+        m_stats.download_ns += span(s.download.get_begin_tick(), s.download.get_end_tick());
+        uint64_t begin = s.upload.get_begin_tick();
+        uint64_t end = s.download.get_end_tick();
+        if (begin && (m_first == 0 || begin < m_first))
+            m_first = begin;
+        if (end > m_last)
+            m_last = end;
+    }
+
+    static uint64_t span(uint64_t begin, uint64_t end) {
+        return (begin && end > begin) ? end - begin : 0;
+    }
+
+    static uint64_t to_ns(uint64_t ticks) {
+        uint64_t frequency = get_tick_frequency();
+        return frequency ? static_cast<uint64_t>(ticks * (1e9 / frequency)) : 0;
+    }
+
+    size_t m_capacity;
+    accelerator m_acc;
+    accelerator_view m_upload;
+    accelerator_view m_compute;
+    accelerator_view m_download;
+    std::vector<std::unique_ptr<slot> > m_slots;
+    // durations in ticks
+    hc_pipeline_stats m_stats;
+    uint64_t m_elapsed;
+    // ticks of the first copy in and the last copy out of the current run
+    uint64_t m_first;
+    uint64_t m_last;
+};
+
+} // namespace hc
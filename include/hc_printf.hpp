@@ -8,12 +8,23 @@
 #include <regex>
 #include <iostream>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
 
 #include "hc_am.hpp"
 #include "hsa_atomic.h"
 
 #define HC_PRINTF_DEBUG  (0)
 
+// fewest packets a sub-buffer of a printf buffer split per CU holds
+#define HC_PRINTF_MIN_SUB_BUFFER_SIZE  (256)
+
 namespace hc {
 
 union PrintfPacketData {
@@ -34,6 +45,8 @@ enum PrintfPacketDataType {
   ,PRINTF_CONST_VOID_PTR
   ,PRINTF_BUFFER_CURSOR
   ,PRINTF_BUFFER_SIZE
+  ,PRINTF_SUB_BUFFERS
+  ,PRINTF_RING
 };
 
 class PrintfPacket {
@@ -53,18 +66,36 @@ enum PrintfError {
   ,PRINTF_BUFFER_OVERFLOW = 1
 };
 
+// A printf buffer starts with the number of its sub-buffers, which follow
+// it. Each sub-buffer starts with its size and its cursor, and the workgroups
+// print to them in turn, so that they don't all contend on one cursor. The
+// buffer is split into a sub-buffer per CU of the accelerator when each still
+// holds HC_PRINTF_MIN_SUB_BUFFER_SIZE packets.
+
 static inline PrintfPacket* createPrintfBuffer(hc::accelerator& a, const unsigned int numElements) {
   PrintfPacket* printfBuffer = NULL;
   if (numElements > 3) {
     printfBuffer = hc::am_alloc(sizeof(PrintfPacket) * numElements, a, 0);
 
-    // initialize the printf buffer header
+    unsigned int numSubBuffers = a.get_cu_count();
+    if (numSubBuffers == 0 || (numElements - 1) / numSubBuffers < HC_PRINTF_MIN_SUB_BUFFER_SIZE)
+      numSubBuffers = 1;
+    unsigned int subBufferSize = (numElements - 1) / numSubBuffers;
+
+    PrintfPacket count;
+    count.type = PRINTF_SUB_BUFFERS;
+    count.data.ui = numSubBuffers;
+    hc::am_copy(printfBuffer,&count,sizeof(PrintfPacket));
+
+    // initialize the header of every sub-buffer
     PrintfPacket header[2];
     header[0].type = PRINTF_BUFFER_SIZE;
-    header[0].data.ui = numElements;
+    header[0].data.ui = subBufferSize;
     header[1].type = PRINTF_BUFFER_CURSOR;
     header[1].data.ui = 2;
-    hc::am_copy(printfBuffer,header,sizeof(PrintfPacket) * 2);
+    for (unsigned int i = 0; i < numSubBuffers; ++i) {
+      hc::am_copy(printfBuffer + 1 + i * subBufferSize,header,sizeof(PrintfPacket) * 2);
+    }
   }
   return printfBuffer;
 }
@@ -93,12 +124,84 @@ static inline void set_batch(PrintfPacket* queue, int offset, const T t, Rest...
   set_batch(queue, offset + 1, rest...);
 }
 
+// the sub-buffer the workgroup of the caller prints to
+static inline PrintfPacket* getPrintfSubBuffer(PrintfPacket* buffer) [[hc,cpu]] {
+  unsigned int numSubBuffers = buffer[0].data.ui;
+  unsigned int subBufferSize = buffer[1].data.ui;
+  unsigned int subBuffer = 0;
+#if __KALMAR_ACCELERATOR__ == 1
+  if (numSubBuffers > 1) {
+    int64_t group = hc_get_group_id(0)
+                  + hc_get_num_groups(0) * (hc_get_group_id(1) + hc_get_num_groups(1) * hc_get_group_id(2));
+    subBuffer = group % numSubBuffers;
+  }
+#endif
+  return buffer + 1 + subBuffer * subBufferSize;
+}
+
+// reserves numPackets packets of queue, and returns the offset of the first.
+// The active work-items of a wavefront print the same number of packets to
+// the same sub-buffer, so they reserve them all with one atomic.
+static inline unsigned int reservePrintfPackets(PrintfPacket* queue, unsigned int numPackets) [[hc,cpu]] {
+#if __KALMAR_ACCELERATOR__ == 1
+  uint64_t lanes = hc::__ballot(1);
+  unsigned int leader = hc::__lastbit_u32_u64(lanes);
+  unsigned int lane = hc::__lane_id();
+  unsigned int rank = hc::__popcount_u32_b64(lanes & ((1ull << lane) - 1));
+  unsigned int first = 0;
+  if (lane == leader) {
+    first = __hsail_atomic_fetch_add_unsigned(&(queue[1].data.ui), numPackets * hc::__popcount_u32_b64(lanes));
+  }
+  first = hc::__shfl((int)first, leader);
+  return first + rank * numPackets;
+#else
+  return __hsail_atomic_fetch_add_unsigned(&(queue[1].data.ui), numPackets);
+#endif
+}
+
+// the packets of a printf stream are at offsets modulo its capacity
+template <typename T>
+static inline void set_ring_batch(PrintfPacket* packets, unsigned int mask, unsigned int offset, const T t) [[hc,cpu]] {
+  packets[offset & mask].set(t);
+}
+template <typename T, typename... Rest>
+static inline void set_ring_batch(PrintfPacket* packets, unsigned int mask, unsigned int offset, const T t, Rest... rest) [[hc,cpu]] {
+  packets[offset & mask].set(t);
+  set_ring_batch(packets, mask, offset + 1, rest...);
+}
+
+// A printf stream is a ring of packets, which a host thread prints while the
+// kernels run. Its header holds the capacity of the ring, a power of 2, the
+// cursor the kernels reserve packets at, and the cursor of the host thread.
+// A call waits for the host thread to free packets when the ring is full,
+// instead of dropping its message, so long-running kernels may print as
+// much as they want. The argument count of a call is set last, once the
+// other packets are, and the host thread takes the call once it's set.
+template <typename... All>
+static inline PrintfError printfStream(PrintfPacket* stream, unsigned int count, All... all) [[hc,cpu]] {
+  unsigned int capacity = stream[0].data.ui;
+  if (count + 1 > capacity)
+    return PRINTF_BUFFER_OVERFLOW;
+
+  unsigned int offset = reservePrintfPackets(stream, count + 1);
+  while (offset + count + 1 - __hsail_atomic_fetch_add_unsigned(&(stream[2].data.ui), 0) > capacity);
+
+  PrintfPacket* packets = stream + 3;
+  set_ring_batch(packets, capacity - 1, offset + 1, all...);
+  __hsail_atomic_exchange_unsigned(&(packets[offset & (capacity - 1)].data.ui), count);
+  return PRINTF_SUCCESS;
+}
+
 template <typename... All>
-static inline PrintfError printf(PrintfPacket* queue, All... all) [[hc,cpu]] {
+static inline PrintfError printf(PrintfPacket* buffer, All... all) [[hc,cpu]] {
   unsigned int count = 0;      
   countArg(count, all...);
 
+  if (buffer[0].type == PRINTF_RING)
+    return printfStream(buffer, count, all...);
+
   PrintfError error = PRINTF_SUCCESS;
+  PrintfPacket* queue = getPrintfSubBuffer(buffer);
 
   if (count + 1 + queue[1].data.ui > queue[0].data.ui) {
     error = PRINTF_BUFFER_OVERFLOW;
@@ -108,7 +211,7 @@ static inline PrintfError printf(PrintfPacket* queue, All... all) [[hc,cpu]] {
     /*** FIXME: hcc didn't promote the address of the atomic type into global address space ***/
     unsigned int offset = queue[1].data.ai.fetch_add(count + 1);
 #endif
-    unsigned int offset = __hsail_atomic_fetch_add_unsigned(&(queue[1].data.ui),count + 1);
+    unsigned int offset = reservePrintfPackets(queue, count + 1);
     if (offset + count + 1 < queue[0].data.ui) { 
       set_batch(queue, offset, count, all...);
     }
@@ -128,89 +231,236 @@ static std::regex floatPattern("(%){1}[-+#0]*[0-9]*((.)[0-9]+){0,1}([fFeEgGaA]){
 static std::regex pointerPattern("(%){1}[ps]");
 static std::regex doubleAmpersandPattern("(%){2}");
 
+// format string of a printf call site, parsed once
+struct PrintfFormat {
+  std::string format;
+  // each specifier, the text before it with the double ampersands cleaned up,
+  // and the type of argument it prints
+  std::vector<std::string> prefixes;
+  std::vector<std::string> specifiers;
+  std::vector<PrintfPacketDataType> types;
+  // the text after the first k specifiers, printed once k arguments are
+  std::vector<std::string> suffixes;
+};
+
+static inline void parsePrintfFormat(PrintfFormat& parsed, const char* format) {
+  parsed.format = format;
+  std::string formatString = parsed.format;
+  std::smatch specifierMatches;
+  parsed.suffixes.push_back(std::regex_replace(formatString,doubleAmpersandPattern,"%"));
+  while (std::regex_search(formatString, specifierMatches, specifierPattern)) {
+    std::string specifier = specifierMatches.str();
+#if HC_PRINTF_DEBUG
+    std::cout << " (specifier found: " << specifier << ") ";
+#endif
+    std::string prefix = specifierMatches.prefix();
+    parsed.prefixes.push_back(std::regex_replace(prefix,doubleAmpersandPattern,"%"));
+    parsed.specifiers.push_back(specifier);
+
+    std::smatch specifierTypeMatch;
+    if (std::regex_search(specifier, specifierTypeMatch, unsignedIntegerPattern)) {
+      parsed.types.push_back(PRINTF_UNSIGNED_INT);
+    } else if (std::regex_search(specifier, specifierTypeMatch, signedIntegerPattern)) {
+      parsed.types.push_back(PRINTF_SIGNED_INT);
+    } else if (std::regex_search(specifier, specifierTypeMatch, floatPattern)) {
+      parsed.types.push_back(PRINTF_FLOAT);
+    } else if (std::regex_search(specifier, specifierTypeMatch, pointerPattern)) {
+      parsed.types.push_back(PRINTF_CONST_VOID_PTR);
+    }
+    else {
+      assert(false);
+      parsed.types.push_back(PRINTF_UNUSED);
+    }
+    formatString = specifierMatches.suffix();
+    parsed.suffixes.push_back(std::regex_replace(formatString,doubleAmpersandPattern,"%"));
+  }
+}
+
+// the parsed format string of a call site, by the address of its format
+static inline const PrintfFormat& getPrintfFormat(const char* format) {
+  static std::mutex formatsMutex;
+  static std::unordered_map<const char*, PrintfFormat> formats;
+  std::lock_guard<std::mutex> lock(formatsMutex);
+  PrintfFormat& parsed = formats[format];
+  // a format rewritten at the same address is parsed again
+  if (parsed.format != format) {
+    parsed = PrintfFormat();
+    parsePrintfFormat(parsed, format);
+  }
+  return parsed;
+}
+
 static inline void processPrintfPackets(PrintfPacket* packets, const unsigned int numPackets) {
 
   for (unsigned int i = 0; i < numPackets; ) {
 
-    unsigned int numPrintfArgs = packets[i++].data.ui;
-    if (numPrintfArgs == 0)
+    unsigned int numPrintfArgs = packets[i].data.ui;
+    if (numPrintfArgs == 0) {
+      ++i;
       continue;
+    }
+    // the packets of the next printf call
+    unsigned int next = i + numPrintfArgs + 1;
+    ++i;
 
     // get the format
     unsigned int formatStringIndex = i++;
     assert(packets[formatStringIndex].type == PRINTF_VOID_PTR
            || packets[formatStringIndex].type == PRINTF_CONST_VOID_PTR);
-    std::string formatString((const char*)packets[formatStringIndex].data.cptr);
-
-    unsigned int formatStringCursor = 0;
-    std::smatch specifierMatches;
-
-#if HC_PRINTF_DEBUG
-    std::printf("%s:%d \t number of matches = %d\n", __FUNCTION__, __LINE__, (int)specifierMatches.size());
-#endif
-    
-    for (unsigned int j = 1; j < numPrintfArgs; ++j, ++i) {
-
-      if (!std::regex_search(formatString, specifierMatches, specifierPattern)) {
-        // More printf argument than format specifier??
-        // Just skip to the next printf request
-        break;
-      }
+    const PrintfFormat& format = getPrintfFormat((const char*)packets[formatStringIndex].data.cptr);
 
-      std::string specifier = specifierMatches.str();
 #if HC_PRINTF_DEBUG
-      std::cout << " (specifier found: " << specifier << ") ";
+    std::printf("%s:%d \t number of matches = %d\n", __FUNCTION__, __LINE__, (int)format.specifiers.size());
 #endif
 
+    // More printf argument than format specifier??
+    // Just skip to the next printf request
+    unsigned int numSpecifiers = std::min<unsigned int>(numPrintfArgs - 1, format.specifiers.size());
+    for (unsigned int j = 0; j < numSpecifiers && i < numPackets; ++j, ++i) {
       // print the substring before the specifier
-      // clean up all the double ampersands
-      std::string prefix = specifierMatches.prefix();
-      prefix = std::regex_replace(prefix,doubleAmpersandPattern,"%");
-      std::printf("%s",prefix.c_str());
-      
-      std::smatch specifierTypeMatch;
-      if (std::regex_search(specifier, specifierTypeMatch, unsignedIntegerPattern)) {
-        std::printf(specifier.c_str(), packets[i].data.ui);
-      } else if (std::regex_search(specifier, specifierTypeMatch, signedIntegerPattern)) {
-        std::printf(specifier.c_str(), packets[i].data.i);
-      } else if (std::regex_search(specifier, specifierTypeMatch, floatPattern)) {
-        std::printf(specifier.c_str(), packets[i].data.f);
-      } else if (std::regex_search(specifier, specifierTypeMatch, pointerPattern)) {
-        std::printf(specifier.c_str(), packets[i].data.cptr);
+      std::printf("%s",format.prefixes[j].c_str());
+
+      const char* specifier = format.specifiers[j].c_str();
+      switch (format.types[j]) {
+        case PRINTF_UNSIGNED_INT:
+          std::printf(specifier, packets[i].data.ui);
+          break;
+        case PRINTF_SIGNED_INT:
+          std::printf(specifier, packets[i].data.i);
+          break;
+        case PRINTF_FLOAT:
+          std::printf(specifier, packets[i].data.f);
+          break;
+        case PRINTF_CONST_VOID_PTR:
+          std::printf(specifier, packets[i].data.cptr);
+          break;
+        default:
+          break;
       }
-      else {
-        assert(false);
-      }
-      formatString = specifierMatches.suffix();
     }
     // print the substring after the last specifier
-    // clean up all the double ampersands before printing
-    formatString = std::regex_replace(formatString,doubleAmpersandPattern,"%");
-    std::printf("%s",formatString.c_str());
+    std::printf("%s",format.suffixes[numSpecifiers].c_str());
+    i = next;
   }
 }
 
+// prints the packets of every sub-buffer, one sub-buffer after the other
 static inline void processPrintfBuffer(PrintfPacket* gpuBuffer) {
 
   if (gpuBuffer == NULL) return;
 
-  PrintfPacket header[2];
-  hc::am_copy(header, gpuBuffer, sizeof(PrintfPacket)*2);
-  unsigned int bufferSize = header[0].data.ui;
-  unsigned int cursor = header[1].data.ui;
-  unsigned int numPackets = ((bufferSize<cursor)?bufferSize:cursor) - 2;
-  if (numPackets > 0) {
-    PrintfPacket* hostBuffer = (PrintfPacket*)malloc(sizeof(PrintfPacket) * numPackets);
-    if (hostBuffer) {
-      hc::am_copy(hostBuffer, gpuBuffer+2, sizeof(PrintfPacket) * numPackets);
-      processPrintfPackets(hostBuffer, numPackets);
-      free(hostBuffer);
+  PrintfPacket header[3];
+  hc::am_copy(header, gpuBuffer, sizeof(PrintfPacket)*3);
+  unsigned int numSubBuffers = header[0].data.ui;
+  unsigned int subBufferSize = header[1].data.ui;
+  unsigned int bufferSize = 1 + numSubBuffers * subBufferSize;
+  PrintfPacket* hostBuffer = (PrintfPacket*)malloc(sizeof(PrintfPacket) * bufferSize);
+  if (hostBuffer) {
+    hc::am_copy(hostBuffer, gpuBuffer, sizeof(PrintfPacket) * bufferSize);
+    for (unsigned int i = 0; i < numSubBuffers; ++i) {
+      PrintfPacket* subBuffer = hostBuffer + 1 + i * subBufferSize;
+      unsigned int cursor = subBuffer[1].data.ui;
+      unsigned int numPackets = ((subBufferSize<cursor)?subBufferSize:cursor) - 2;
+      if (numPackets > 0) {
+        processPrintfPackets(subBuffer + 2, numPackets);
+      }
     }
+    free(hostBuffer);
   }
   // reset the printf buffer
-  header[1].data.ui = 2;
-  hc::am_copy(gpuBuffer,header,sizeof(PrintfPacket) * 2);
+  header[2].data.ui = 2;
+  for (unsigned int i = 0; i < numSubBuffers; ++i) {
+    hc::am_copy(gpuBuffer + 1 + i * subBufferSize + 1, &header[2], sizeof(PrintfPacket));
+  }
 }
 
 
+// the host thread printing the calls of a printf stream
+class PrintfStreamThread {
+public:
+  explicit PrintfStreamThread(PrintfPacket* stream)
+    : stream(stream), stop(false), thread(&PrintfStreamThread::run, this) {}
+
+  // prints the calls made so far before it returns
+  ~PrintfStreamThread() {
+    stop.store(true);
+    thread.join();
+  }
+
+private:
+  void run() {
+    unsigned int capacity = stream[0].data.ui;
+    PrintfPacket* packets = stream + 3;
+    std::unique_ptr<PrintfPacket[]> call(new PrintfPacket[capacity]);
+    while (true) {
+      unsigned int read = stream[2].data.ui;
+      PrintfPacket* first = &packets[read & (capacity - 1)];
+      unsigned int count = __sync_fetch_and_add(&(first->data.ui), 0);
+      if (count == 0) {
+        // every call reserved before the stream was deleted is printed
+        if (stop.load() && __sync_fetch_and_add(&(stream[1].data.ui), 0) == read)
+          break;
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+        continue;
+      }
+      for (unsigned int i = 0; i <= count; ++i) {
+        std::memcpy(&call[i], &packets[(read + i) & (capacity - 1)], sizeof(PrintfPacket));
+      }
+      // frees the packets of the call for the kernels
+      __sync_lock_test_and_set(&(first->data.ui), 0);
+      __sync_fetch_and_add(&(stream[2].data.ui), count + 1);
+
+      processPrintfPackets(call.get(), count + 1);
+      std::fflush(stdout);
+    }
+  }
+
+  PrintfPacket* stream;
+  std::atomic<bool> stop;
+  std::thread thread;
+};
+
+static inline std::mutex& printfStreamsMutex() {
+  static std::mutex m;
+  return m;
+}
+
+static inline std::map<PrintfPacket*, std::unique_ptr<PrintfStreamThread> >& printfStreams() {
+  static std::map<PrintfPacket*, std::unique_ptr<PrintfStreamThread> > streams;
+  return streams;
+}
+
+// Creates a printf stream of at least numElements packets in host memory
+// accessible from a, and starts the host thread printing its calls. It's
+// passed to hc::printf as a printf buffer is, but needs no
+// processPrintfBuffer().
+static inline PrintfPacket* createPrintfStream(hc::accelerator& a, const unsigned int numElements) {
+  unsigned int capacity = 1;
+  while (capacity < numElements)
+    capacity <<= 1;
+  PrintfPacket* stream = hc::am_alloc(sizeof(PrintfPacket) * (capacity + 3), a, amHostPinned);
+  if (stream == NULL)
+    return NULL;
+  std::memset(stream, 0, sizeof(PrintfPacket) * (capacity + 3));
+  stream[0].type = PRINTF_RING;
+  stream[0].data.ui = capacity;
+  stream[1].type = PRINTF_BUFFER_CURSOR;
+  stream[2].type = PRINTF_BUFFER_CURSOR;
+
+  std::lock_guard<std::mutex> lock(printfStreamsMutex());
+  printfStreams()[stream].reset(new PrintfStreamThread(stream));
+  return stream;
+}
+
+// Prints the calls made to stream so far, and frees it. The kernels
+// printing to it must be done.
+static inline void deletePrintfStream(PrintfPacket* stream) {
+  if (stream == NULL) return;
+  {
+    std::lock_guard<std::mutex> lock(printfStreamsMutex());
+    printfStreams().erase(stream);
+  }
+  hc::am_free(stream);
+}
+
 } // namespace hc
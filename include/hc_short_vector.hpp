@@ -1,26 +1,189 @@
-#pragma once
-
-#ifndef _HC_SHORT_VECTORS_HPP
-#define _HC_SHORT_VECTORS_HPP
-
-namespace hc
-{
-
-namespace short_vector
-{
-
-#ifdef __HCC__
-#define __CPU_GPU__ [[cpu]] [[hc]]
-#else
-#define __CPU_GPU__
-#endif
-
-#include "kalmar_short_vectors.inl"
-
-#undef __CPU_GPU__
-
-} // namespace short_vector
-
-} // namespace hc
-
-#endif // _HC_SHORT_VECTORS_H
+#pragma once
+
+#ifndef _HC_SHORT_VECTORS_HPP
+#define _HC_SHORT_VECTORS_HPP
+
+#include <cstring>
+
+#include "hc_defines.h"
+
+namespace hc
+{
+
+namespace short_vector
+{
+
+#ifdef __HCC__
+#define __CPU_GPU__ [[cpu]] [[hc]]
+#else
+#define __CPU_GPU__
+#endif
+
+#include "kalmar_short_vectors.inl"
+
+// packed half-precision arithmetic of hsail-amdgpu-wrapper.ll, over the two
+// halves of a 32-bit word
+#if __KALMAR_ACCELERATOR__ == 1 && defined(__hcc_backend__) && __hcc_backend__ == HCC_BACKEND_AMDGPU
+#define __HC_PACKED_HALF__ 1
+extern "C" unsigned int __hc_pk_add_f16(unsigned int a, unsigned int b) [[hc]];
+extern "C" unsigned int __hc_pk_sub_f16(unsigned int a, unsigned int b) [[hc]];
+extern "C" unsigned int __hc_pk_mul_f16(unsigned int a, unsigned int b) [[hc]];
+extern "C" unsigned int __hc_pk_fma_f16(unsigned int a, unsigned int b, unsigned int c) [[hc]];
+extern "C" unsigned int __hc_pk_min_f16(unsigned int a, unsigned int b) [[hc]];
+extern "C" unsigned int __hc_pk_max_f16(unsigned int a, unsigned int b) [[hc]];
+extern "C" unsigned int __hc_cvt_pk_f16_f32(float lo, float hi) [[hc]];
+extern "C" float __hc_cvt_f32_f16_lo(unsigned int v) [[hc]];
+extern "C" float __hc_cvt_f32_f16_hi(unsigned int v) [[hc]];
+#endif
+
+/**
+ * Two half-precision floats packed in a 32-bit word, x in the lower half.
+ * Arithmetic on the accelerator uses packed instructions, both halves at
+ * once; the host computes in single precision and rounds back. The default
+ * constructor leaves the value undefined, so the type stays trivially
+ * copyable and can go through shuffles and atomics as a word.
+ */
+class half_2
+{
+public:
+  typedef hc::half value_type;
+  static const int size = 2;
+
+  half_2() = default;
+
+  explicit half_2(float value) __CPU_GPU__ : bits(pack(value, value)) {}
+
+  half_2(float v1, float v2) __CPU_GPU__ : bits(pack(v1, v2)) {}
+
+  explicit half_2(const float_2& other) __CPU_GPU__ : bits(pack(other.x, other.y)) {}
+
+  /// the packed value of the bits of a 32-bit word
+  static half_2 from_bits(unsigned int bits) __CPU_GPU__ {
+    half_2 ret;
+    ret.bits = bits;
+    return ret;
+  }
+
+  unsigned int get_bits() const __CPU_GPU__ { return bits; }
+
+  float get_x() const __CPU_GPU__ { return unpack(bits, 0); }
+  float get_y() const __CPU_GPU__ { return unpack(bits, 1); }
+
+  void set_x(float value) __CPU_GPU__ { bits = pack(value, get_y()); }
+  void set_y(float value) __CPU_GPU__ { bits = pack(get_x(), value); }
+
+  explicit operator float_2() const __CPU_GPU__ { return float_2(get_x(), get_y()); }
+
+  half_2 operator-() const __CPU_GPU__ { return from_bits(bits ^ 0x80008000u); }
+
+  half_2& operator+=(const half_2& rhs) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    bits = __hc_pk_add_f16(bits, rhs.bits);
+#else
+    bits = pack(get_x() + rhs.get_x(), get_y() + rhs.get_y());
+#endif
+    return *this;
+  }
+
+  half_2& operator-=(const half_2& rhs) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    bits = __hc_pk_sub_f16(bits, rhs.bits);
+#else
+    bits = pack(get_x() - rhs.get_x(), get_y() - rhs.get_y());
+#endif
+    return *this;
+  }
+
+  half_2& operator*=(const half_2& rhs) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    bits = __hc_pk_mul_f16(bits, rhs.bits);
+#else
+    bits = pack(get_x() * rhs.get_x(), get_y() * rhs.get_y());
+#endif
+    return *this;
+  }
+
+  friend half_2 fma(const half_2& a, const half_2& b, const half_2& c) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    return from_bits(__hc_pk_fma_f16(a.bits, b.bits, c.bits));
+#else
+    return half_2(a.get_x() * b.get_x() + c.get_x(), a.get_y() * b.get_y() + c.get_y());
+#endif
+  }
+
+  friend half_2 min(const half_2& a, const half_2& b) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    return from_bits(__hc_pk_min_f16(a.bits, b.bits));
+#else
+    return half_2(a.get_x() < b.get_x() ? a.get_x() : b.get_x(),
+                  a.get_y() < b.get_y() ? a.get_y() : b.get_y());
+#endif
+  }
+
+  friend half_2 max(const half_2& a, const half_2& b) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    return from_bits(__hc_pk_max_f16(a.bits, b.bits));
+#else
+    return half_2(a.get_x() > b.get_x() ? a.get_x() : b.get_x(),
+                  a.get_y() > b.get_y() ? a.get_y() : b.get_y());
+#endif
+  }
+
+private:
+  static unsigned int pack(float lo, float hi) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    return __hc_cvt_pk_f16_f32(lo, hi);
+#else
+    hc::half h[2] = { static_cast<hc::half>(lo), static_cast<hc::half>(hi) };
+    unsigned int ret;
+    memcpy(&ret, h, sizeof(ret));
+    return ret;
+#endif
+  }
+
+  static float unpack(unsigned int bits, int i) __CPU_GPU__ {
+#if __HC_PACKED_HALF__
+    return i == 0 ? __hc_cvt_f32_f16_lo(bits) : __hc_cvt_f32_f16_hi(bits);
+#else
+    hc::half h[2];
+    memcpy(h, &bits, sizeof(bits));
+    return static_cast<float>(h[i]);
+#endif
+  }
+
+  unsigned int bits;
+};
+
+inline half_2 operator+(const half_2& lhs, const half_2& rhs) __CPU_GPU__ {
+  half_2 ret(lhs);
+  return ret += rhs;
+}
+
+inline half_2 operator-(const half_2& lhs, const half_2& rhs) __CPU_GPU__ {
+  half_2 ret(lhs);
+  return ret -= rhs;
+}
+
+inline half_2 operator*(const half_2& lhs, const half_2& rhs) __CPU_GPU__ {
+  half_2 ret(lhs);
+  return ret *= rhs;
+}
+
+inline bool operator==(const half_2& lhs, const half_2& rhs) __CPU_GPU__ {
+  return lhs.get_x() == rhs.get_x() && lhs.get_y() == rhs.get_y();
+}
+
+inline bool operator!=(const half_2& lhs, const half_2& rhs) __CPU_GPU__ {
+  return !(lhs == rhs);
+}
+
+typedef half_2 half2;
+
+#undef __HC_PACKED_HALF__
+#undef __CPU_GPU__
+
+} // namespace short_vector
+
+} // namespace hc
+
+#endif // _HC_SHORT_VECTORS_H
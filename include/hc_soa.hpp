@@ -0,0 +1,422 @@
+#pragma once
+
+#include <iterator>
+#include <tuple>
+#include <type_traits>
+
+#include "hc.hpp"
+
+/**
+ * Containers keeping each field of their elements in a buffer of its own, a
+ * structure of arrays, so that the work-items of a wavefront accessing the
+ * same field of consecutive elements access consecutive memory, where an
+ * array of structures makes them stride over the other fields.
+ */
+
+namespace Kalmar {
+
+/// the fields of a soa_array, an array over each of them
+template <typename... Fields>
+struct soa_array_fields;
+
+template <typename Head>
+struct soa_array_fields<Head> {
+    hc::array<Head, 1> head;
+
+    soa_array_fields(int count, const hc::accelerator_view& av) : head(count, av) {}
+};
+
+template <typename Head, typename... Tail>
+struct soa_array_fields<Head, Tail...> {
+    hc::array<Head, 1> head;
+    soa_array_fields<Tail...> tail;
+
+    soa_array_fields(int count, const hc::accelerator_view& av) : head(count, av), tail(count, av) {}
+};
+
+/// the fields of a soa_array_view, an array_view over each of them
+template <typename... Fields>
+struct soa_view_fields;
+
+template <typename Head>
+struct soa_view_fields<Head> {
+    hc::array_view<Head, 1> head;
+
+    explicit soa_view_fields(int count) : head(count) {}
+    explicit soa_view_fields(soa_array_fields<Head>& arrays) : head(arrays.head) {}
+};
+
+template <typename Head, typename... Tail>
+struct soa_view_fields<Head, Tail...> {
+    hc::array_view<Head, 1> head;
+    soa_view_fields<Tail...> tail;
+
+    explicit soa_view_fields(int count) : head(count), tail(count) {}
+    explicit soa_view_fields(soa_array_fields<Head, Tail...>& arrays)
+        : head(arrays.head), tail(arrays.tail) {}
+};
+
+/// field I of a soa_view_fields
+template <int I, typename... Fields>
+struct soa_field;
+
+template <typename Head, typename... Tail>
+struct soa_field<0, Head, Tail...> {
+    typedef Head type;
+
+    static const hc::array_view<Head, 1>& get(const soa_view_fields<Head, Tail...>& fields) __CPU__ __HC__ {
+        return fields.head;
+    }
+};
+
+template <int I, typename Head, typename... Tail>
+struct soa_field<I, Head, Tail...> {
+    typedef typename soa_field<I - 1, Tail...>::type type;
+
+    static const hc::array_view<type, 1>& get(const soa_view_fields<Head, Tail...>& fields) __CPU__ __HC__ {
+        return soa_field<I - 1, Tail...>::get(fields.tail);
+    }
+};
+
+/// accesses field I of the elements of an array of structures: element I
+/// of a tuple, or a data member
+template <int I>
+struct soa_tuple_field {
+    template <typename Element>
+    static auto get(const Element& element) -> decltype(std::get<I>(element)) {
+        return std::get<I>(element);
+    }
+
+    template <typename Element, typename Value>
+    static void set(Element& element, const Value& value) {
+        std::get<I>(element) = value;
+    }
+};
+
+template <typename Member>
+struct soa_member_field {
+    Member member;
+
+    template <typename Element>
+    auto get(const Element& element) const -> decltype(element.*member) {
+        return element.*member;
+    }
+
+    template <typename Element, typename Value>
+    void set(Element& element, const Value& value) const {
+        element.*member = value;
+    }
+};
+
+} // namespace Kalmar
+
+namespace hc {
+
+template <typename... Fields>
+class soa_array;
+
+/**
+ * A reference to an element of a soa_array_view, which loads and stores each
+ * field of the element on its own. It stays valid as long as the view it
+ * was returned by.
+ */
+template <typename... Fields>
+class soa_reference {
+public:
+    typedef std::tuple<Fields...> value_type;
+
+    /**
+     * Returns a reference to field I of the element.
+     */
+    template <int I>
+    typename Kalmar::soa_field<I, Fields...>::type& get() const __CPU__ __HC__ {
+        return Kalmar::soa_field<I, Fields...>::get(fields)[idx];
+    }
+
+    /**
+     * Stores each field of the element.
+     */
+    const soa_reference& operator=(const value_type& value) const __CPU__ __HC__ {
+        store<0>(value);
+        return *this;
+    }
+
+    const soa_reference& operator=(const soa_reference& other) const __CPU__ __HC__ {
+        return *this = static_cast<value_type>(other);
+    }
+
+    /**
+     * Loads each field of the element.
+     */
+    operator value_type() const __CPU__ __HC__ {
+        value_type value;
+        load<0>(value);
+        return value;
+    }
+
+private:
+    template <typename... F> friend class soa_array_view;
+
+    soa_reference(const Kalmar::soa_view_fields<Fields...>& fields, int idx) __CPU__ __HC__
+        : fields(fields), idx(idx) {}
+
+    template <int I>
+    typename std::enable_if<(I < sizeof...(Fields))>::type store(const value_type& value) const __CPU__ __HC__ {
+        get<I>() = std::get<I>(value);
+        store<I + 1>(value);
+    }
+
+    template <int I>
+    typename std::enable_if<(I == sizeof...(Fields))>::type store(const value_type&) const __CPU__ __HC__ {}
+
+    template <int I>
+    typename std::enable_if<(I < sizeof...(Fields))>::type load(value_type& value) const __CPU__ __HC__ {
+        std::get<I>(value) = get<I>();
+        load<I + 1>(value);
+    }
+
+    template <int I>
+    typename std::enable_if<(I == sizeof...(Fields))>::type load(value_type&) const __CPU__ __HC__ {}
+
+    const Kalmar::soa_view_fields<Fields...>& fields;
+    int idx;
+};
+
+/**
+ * A view over elements made of several fields, each field kept in a buffer
+ * of its own. It may be captured by value in kernels, like array_view, where
+ * indexing it returns a soa_reference to an element, and get<I>() returns
+ * the array_view of field I, which kernels using only some of the fields
+ * should index instead.
+ *
+ * The elements are copied from and to arrays of structures on the host with
+ * hc::copy(), which gathers and scatters each field at once.
+ *
+ * @tparam Fields The types of the fields of the elements.
+ */
+template <typename... Fields>
+class soa_array_view {
+    static_assert(sizeof...(Fields) > 0, "soa_array_view needs at least one field");
+public:
+    typedef std::tuple<Fields...> value_type;
+
+    /**
+     * The number of fields of the elements.
+     */
+    static const int field_count = sizeof...(Fields);
+
+    /**
+     * Constructs a view over count elements, whose fields are kept in
+     * buffers the runtime manages, like an array_view without a data source.
+     */
+    explicit soa_array_view(int count) : fields(count), count(count) {}
+
+    /**
+     * Constructs a view over the elements of a soa_array.
+     */
+    soa_array_view(soa_array<Fields...>& src) : fields(src.arrays), count(src.size()) {}
+
+    /**
+     * Returns the number of elements of the view.
+     */
+    int size() const __CPU__ __HC__ { return count; }
+
+    hc::extent<1> get_extent() const __CPU__ __HC__ { return hc::extent<1>(count); }
+
+    /**
+     * Returns the array_view of field I.
+     */
+    template <int I>
+    const array_view<typename Kalmar::soa_field<I, Fields...>::type, 1>& get() const __CPU__ __HC__ {
+        return Kalmar::soa_field<I, Fields...>::get(fields);
+    }
+
+    /** @{ */
+    /**
+     * Returns a reference to the element at index i. On the host, each field
+     * accessed through it is synchronized like the element of an array_view.
+     */
+    soa_reference<Fields...> operator[](int i) const __CPU__ __HC__ {
+        return soa_reference<Fields...>(fields, i);
+    }
+
+    soa_reference<Fields...> operator[](const index<1>& idx) const __CPU__ __HC__ {
+        return (*this)[idx[0]];
+    }
+    /** @} */
+
+    /**
+     * Synchronizes all the fields to the host.
+     */
+    void synchronize() const { synchronize<0>(); }
+
+    /**
+     * Discards the contents of all the fields.
+     */
+    void discard_data() const { discard<0>(); }
+
+    /**
+     * Writes the fields of the elements of [first, last), at most size() of
+     * them, to the first elements of the view, each field at once. Field I
+     * is read from the element with fields[I].get().
+     */
+    template <int I, typename InputIter, typename Field, typename... Rest>
+    void scatter(InputIter first, InputIter last, const Field& field, const Rest&... rest) const {
+        typedef typename Kalmar::soa_field<I, Fields...>::type T;
+        host_accessor<T, 1> acc = get<I>().get_host_accessor(
+            std::distance(first, last) == count ? access_type_write : access_type_read_write);
+        T* ptr = acc.data();
+        for (InputIter it = first; it != last; ++it)
+            *ptr++ = field.get(*it);
+        scatter<I + 1>(first, last, rest...);
+    }
+
+    template <int I, typename InputIter>
+    void scatter(InputIter, InputIter) const {}
+
+    /**
+     * Reads the fields of the elements of the view to [dest, dest + size()),
+     * each field at once. Field I is written to the element with
+     * fields[I].set().
+     */
+    template <int I, typename OutputIter, typename Field, typename... Rest>
+    void gather(OutputIter dest, const Field& field, const Rest&... rest) const {
+        typedef typename Kalmar::soa_field<I, Fields...>::type T;
+        host_accessor<T, 1> acc = get<I>().get_host_accessor(access_type_read);
+        const T* ptr = acc.data();
+        OutputIter it = dest;
+        for (int i = 0; i < count; ++i, ++it)
+            field.set(*it, ptr[i]);
+        gather<I + 1>(dest, rest...);
+    }
+
+    template <int I, typename OutputIter>
+    void gather(OutputIter) const {}
+
+    /**
+     * Like scatter() and gather(), with the fields of tuples.
+     */
+    template <int I, typename InputIter>
+    typename std::enable_if<(I < sizeof...(Fields))>::type scatter_tuples(InputIter first, InputIter last) const {
+        scatter<I>(first, last, Kalmar::soa_tuple_field<I>());
+        scatter_tuples<I + 1>(first, last);
+    }
+
+    template <int I, typename InputIter>
+    typename std::enable_if<(I == sizeof...(Fields))>::type scatter_tuples(InputIter, InputIter) const {}
+
+    template <int I, typename OutputIter>
+    typename std::enable_if<(I < sizeof...(Fields))>::type gather_tuples(OutputIter dest) const {
+        gather<I>(dest, Kalmar::soa_tuple_field<I>());
+        gather_tuples<I + 1>(dest);
+    }
+
+    template <int I, typename OutputIter>
+    typename std::enable_if<(I == sizeof...(Fields))>::type gather_tuples(OutputIter) const {}
+
+private:
+    template <int I>
+    typename std::enable_if<(I < sizeof...(Fields))>::type synchronize() const {
+        get<I>().synchronize();
+        synchronize<I + 1>();
+    }
+
+    template <int I>
+    typename std::enable_if<(I == sizeof...(Fields))>::type synchronize() const {}
+
+    template <int I>
+    typename std::enable_if<(I < sizeof...(Fields))>::type discard() const {
+        get<I>().discard_data();
+        discard<I + 1>();
+    }
+
+    template <int I>
+    typename std::enable_if<(I == sizeof...(Fields))>::type discard() const {}
+
+    Kalmar::soa_view_fields<Fields...> fields;
+    int count;
+};
+
+/**
+ * An array of elements made of several fields, each field kept in an array
+ * of its own on an accelerator_view. Kernels access it through a
+ * soa_array_view over it, captured by value.
+ *
+ * @tparam Fields The types of the fields of the elements.
+ */
+template <typename... Fields>
+class soa_array {
+    static_assert(sizeof...(Fields) > 0, "soa_array needs at least one field");
+public:
+    typedef std::tuple<Fields...> value_type;
+
+    /**
+     * Constructs an array of count elements on the accelerator_view av.
+     */
+    explicit soa_array(int count, const accelerator_view& av = accelerator().get_default_view())
+        : arrays(count, av), count(count) {}
+
+    soa_array(const soa_array&) = delete;
+    soa_array& operator=(const soa_array&) = delete;
+
+    /**
+     * Returns the number of elements of the array.
+     */
+    int size() const { return count; }
+
+    hc::extent<1> get_extent() const { return hc::extent<1>(count); }
+
+    /**
+     * Returns a view over the elements of the array.
+     */
+    soa_array_view<Fields...> get_view() { return soa_array_view<Fields...>(*this); }
+
+private:
+    friend class soa_array_view<Fields...>;
+
+    Kalmar::soa_array_fields<Fields...> arrays;
+    int count;
+};
+
+/** @{ */
+/**
+ * Copies the fields of a range of structures to the first elements of a
+ * soa_array_view, each field from the data member given in the order of the
+ * fields, e.g. copy(v.begin(), v.end(), view, &Particle::pos, &Particle::id).
+ * Without members, the structures are tuples of the fields.
+ */
+template <typename InputIter, typename... Fields, typename... Members>
+void copy(InputIter first, InputIter last, const soa_array_view<Fields...>& dest, Members... members) {
+    static_assert(sizeof...(Members) == sizeof...(Fields), "copy needs a data member per field");
+    if (std::distance(first, last) > dest.size())
+        throw runtime_exception("errorMsg_throw", 0);
+    dest.template scatter<0>(first, last, Kalmar::soa_member_field<Members>{members}...);
+}
+
+template <typename InputIter, typename... Fields>
+void copy(InputIter first, InputIter last, const soa_array_view<Fields...>& dest) {
+    if (std::distance(first, last) > dest.size())
+        throw runtime_exception("errorMsg_throw", 0);
+    dest.template scatter_tuples<0>(first, last);
+}
+/** @} */
+
+/** @{ */
+/**
+ * Copies the elements of a soa_array_view to a range of structures, each
+ * field to the data member given in the order of the fields. Without
+ * members, the structures are tuples of the fields.
+ */
+template <typename OutputIter, typename... Fields, typename... Members>
+void copy(const soa_array_view<Fields...>& src, OutputIter dest, Members... members) {
+    static_assert(sizeof...(Members) == sizeof...(Fields), "copy needs a data member per field");
+    src.template gather<0>(dest, Kalmar::soa_member_field<Members>{members}...);
+}
+
+template <typename OutputIter, typename... Fields>
+void copy(const soa_array_view<Fields...>& src, OutputIter dest) {
+    src.template gather_tuples<0>(dest);
+}
+/** @} */
+
+} // namespace hc
@@ -0,0 +1,168 @@
+#pragma once
+
+// Counters of the commands submitted to the accelerator views, and of the
+// memory held by the accelerators, always kept by the runtime. This header is
+// usable from C, so the counters can be scraped by monitoring agents without
+// the C++ API.
+
+#include <stddef.h>
+#include <stdint.h>
+
+// buckets of the histograms of dispatch latency, the last one counts the
+// dispatches of 2^31 ns or more
+#define HC_DISPATCH_LATENCY_BUCKETS (32)
+
+/**
+ * A snapshot of the counters of an accelerator view.
+ */
+typedef struct hc_queue_stats {
+  // index of the accelerator of the view, in the order of
+  // hc::accelerator::get_all()
+  uint32_t device;
+  // index of the view among the views of its accelerator, in the order of
+  // hc::accelerator::get_all_views(), only set by hc_get_queue_stats()
+  uint32_t view;
+
+  // kernels dispatched
+  uint64_t dispatches;
+
+  // bytes copied from host to device, device to host, and within or
+  // between devices
+  uint64_t bytes_host_to_device;
+  uint64_t bytes_device_to_host;
+  uint64_t bytes_device_to_device;
+
+  // kernel dispatches whose arguments didn't fit in the kernarg ring of the
+  // view, and were allocated from the kernarg pool of the accelerator
+  uint64_t kernarg_pool_misses;
+
+  // completion signals which the signal pool had to grow for
+  uint64_t signal_pool_misses;
+
+  // nanoseconds host threads blocked on commands a command of the view
+  // depends on, which can't be waited for on the device
+  uint64_t dependency_wait_ns;
+
+  // copies synchronizing the data of arrays and array_views to or from the
+  // accelerator of the view
+  uint64_t sync_copies;
+
+  // code objects built for the accelerator of the view
+  uint64_t code_object_builds;
+
+  // histogram of the host latency of dispatching kernels to the view,
+  // bucket i counts the dispatches which took [2^i, 2^(i+1)) ns. Only
+  // recorded with the environment variable HCC_DISPATCH_LATENCY=1, see
+  // hc_get_dispatch_latency()
+  uint64_t dispatch_latency[HC_DISPATCH_LATENCY_BUCKETS];
+} hc_queue_stats;
+
+/**
+ * A snapshot of the memory an accelerator holds for the arrays and
+ * array_views of a memory tag, see hc_set_memory_tag().
+ */
+typedef struct hc_memory_stats {
+  // index of the accelerator, in the order of hc::accelerator::get_all()
+  uint32_t device;
+  // the memory tag, NULL for the total of all the tags of the accelerator,
+  // the string stays valid until the program exits
+  const char* tag;
+
+  // bytes held now, and at most since the program started
+  uint64_t bytes;
+  uint64_t peak_bytes;
+
+  // buffers allocated and released
+  uint64_t allocations;
+  uint64_t releases;
+
+  // bytes of free memory kept by the memory cache of the accelerator, only
+  // set for the total
+  uint64_t cached_bytes;
+} hc_memory_stats;
+
+/**
+ * The activity of an hc::pipeline, see hc::pipeline::get_stats(). The times
+ * are measured on the accelerator, from the ticks of the copies and of the
+ * markers around the kernels of each chunk.
+ */
+typedef struct hc_pipeline_stats {
+  // chunks run through the pipeline, and their bytes copied to and from the
+  // accelerator
+  uint64_t chunks;
+  uint64_t bytes_in;
+  uint64_t bytes_out;
+
+  // nanoseconds spent copying the chunks in, running their kernels, and
+  // copying them out
+  uint64_t upload_ns;
+  uint64_t kernel_ns;
+  uint64_t download_ns;
+
+  // nanoseconds from the start of the first copy in to the end of the last
+  // copy out
+  uint64_t elapsed_ns;
+
+  // nanoseconds of the stages which ran at the same time as another: the
+  // sum of the stages less the elapsed time, 0 if nothing overlapped
+  uint64_t overlap_ns;
+} hc_pipeline_stats;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Take a snapshot of the counters of at most count accelerator views alive.
+ *
+ * @param[out] stats The snapshots, one per view.
+ * @param[in] count Number of snapshots stats has room for.
+ * @return Number of accelerator views alive, which may be more than count.
+ */
+size_t hc_get_queue_stats(hc_queue_stats* stats, size_t count);
+
+/**
+ * Estimate a percentile of the dispatch latency of a snapshot from its
+ * histogram, as the upper bound of the bucket the percentile falls in.
+ *
+ * @param[in] stats The snapshot.
+ * @param[in] percentile The percentile, in [0, 100].
+ * @return The latency in ns, 0 if no dispatch latency was recorded.
+ */
+uint64_t hc_get_dispatch_latency(const hc_queue_stats* stats, double percentile);
+
+/**
+ * Set the memory tag the buffers the calling thread allocates for arrays and
+ * array_views are accounted to. Without a tag they're accounted to "array",
+ * "staging" for the copies of an array on another accelerator, or
+ * "array_view".
+ *
+ * @param[in] tag The tag, which must stay valid while it's set, or NULL to
+ *                clear it.
+ * @return The previous tag of the calling thread.
+ */
+const char* hc_set_memory_tag(const char* tag);
+
+/**
+ * @return The memory tag of the calling thread, NULL if it has none.
+ */
+const char* hc_get_memory_tag(void);
+
+/**
+ * Take a snapshot of the memory held per accelerator and memory tag, one
+ * total per accelerator followed by its tags.
+ *
+ * @param[out] stats The snapshots.
+ * @param[in] count Number of snapshots stats has room for.
+ * @return Number of snapshots available, which may be more than count.
+ */
+size_t hc_get_memory_stats(hc_memory_stats* stats, size_t count);
+
+/**
+ * Print the memory held per accelerator and memory tag to stderr.
+ */
+void hc_print_memory_stats(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,228 @@
+#pragma once
+
+#include <iterator>
+
+#include "hc.hpp"
+
+/**
+ * Read-only textures of 1, 2 or 3 dimensions, whose texels are fetched by
+ * index or sampled at normalized coordinates, with point or linear filtering
+ * and an address mode for the coordinates out of the texture.
+ *
+ * The texels are kept in an hc::array and read through a view of constant
+ * elements, the filtering and addressing are done by the kernel: image
+ * objects of the HSA image extension can't be bound to kernels, as the
+ * compiler has no image intrinsics to read them with.
+ */
+
+namespace hc {
+
+/// how a texture is sampled between texels
+enum filter_mode {
+    /// the nearest texel
+    filter_point = 0,
+    /// the texels around the coordinates, weighted by their distance
+    filter_linear = 1
+};
+
+/// how the coordinates of samples out of a texture are mapped to texels
+enum address_mode {
+    /// the coordinates are clamped to the texels on the edges
+    address_clamp = 0,
+    /// the texture repeats itself
+    address_wrap = 1,
+    /// the texels out of the texture are the border value, T()
+    address_border = 2
+};
+
+/**
+ * The state which a texture is sampled with.
+ */
+struct sampler {
+    explicit sampler(filter_mode filter = filter_linear, address_mode address = address_clamp) __CPU__ __HC__
+        : filter(filter), address(address) {}
+
+    filter_mode filter;
+    address_mode address;
+};
+
+template <typename T, int N> class texture_view;
+
+/**
+ * A read-only texture of elements of type T in N dimensions, located on an
+ * accelerator, and read by kernels through a texture_view.
+ */
+template <typename T, int N = 2>
+class texture {
+    static_assert(N >= 1 && N <= 3, "textures have 1, 2 or 3 dimensions");
+public:
+    /**
+     * Constructs a texture of extent "ext" on the accelerator_view "av",
+     * whose texels are undefined until copied into it.
+     */
+    explicit texture(const extent<N>& ext, accelerator_view av = accelerator().get_default_view())
+        : m_data(ext, av) {}
+
+    /**
+     * Constructs a texture of extent "ext" on the accelerator_view "av", with
+     * the texels of the range [first, last), in the order of the elements of
+     * an array.
+     */
+    template <typename InputIter>
+    texture(const extent<N>& ext, InputIter first, InputIter last,
+            accelerator_view av = accelerator().get_default_view())
+        : m_data(ext, first, last, av) {}
+
+    texture(const texture&) = delete;
+    texture& operator=(const texture&) = delete;
+
+    extent<N> get_extent() const { return m_data.get_extent(); }
+    accelerator_view get_accelerator_view() const { return m_data.get_accelerator_view(); }
+
+private:
+    friend class texture_view<T, N>;
+    template <typename InputIter, typename Q, int K> friend
+        void copy(InputIter, InputIter, texture<Q, K>&);
+    template <typename OutputIter, typename Q, int K> friend
+        void copy(const texture<Q, K>&, OutputIter);
+
+    array<T, N> m_data;
+};
+
+/**
+ * A view of a texture which kernels capture to read it. The texels are
+ * fetched by index, or sampled at normalized coordinates, where x is along
+ * the last dimension, y along the one before it, and z along the first
+ * dimension of 3D textures, as for images.
+ */
+template <typename T, int N = 2>
+class texture_view {
+public:
+    /// constructs a view of the texels of "tex"
+    texture_view(const texture<T, N>& tex) __CPU__ : m_data(tex.m_data) {}
+
+    extent<N> get_extent() const __CPU__ __HC__ { return m_data.get_extent(); }
+
+    /**
+     * Returns the texel at "idx", which must be within the texture.
+     */
+    T operator[](const index<N>& idx) const __CPU__ __HC__ { return m_data[idx]; }
+    T get(const index<N>& idx) const __CPU__ __HC__ { return m_data[idx]; }
+
+    /** @{ */
+    /**
+     * Samples the texture at the normalized coordinates (x, y, z), with the
+     * filter and address modes of "s". The texel of index i along some
+     * dimension of extent e is centered on (i + 0.5) / e. Linear filtering
+     * needs T to be a floating-point type or short vector.
+     */
+    T sample(const sampler& s, float x) const __CPU__ __HC__ {
+        static_assert(N == 1, "sample(sampler, x) is only permissible on textures of rank 1");
+        float coords[1] = { x };
+        return sample_at(s, coords);
+    }
+    T sample(const sampler& s, float x, float y) const __CPU__ __HC__ {
+        static_assert(N == 2, "sample(sampler, x, y) is only permissible on textures of rank 2");
+        float coords[2] = { y, x };
+        return sample_at(s, coords);
+    }
+    T sample(const sampler& s, float x, float y, float z) const __CPU__ __HC__ {
+        static_assert(N == 3, "sample(sampler, x, y, z) is only permissible on textures of rank 3");
+        float coords[3] = { z, y, x };
+        return sample_at(s, coords);
+    }
+    /** @} */
+
+private:
+    // maps the texel "i" along "dim" into the texture, returns false if it's
+    // on the border
+    bool address(address_mode mode, int dim, int& i) const __CPU__ __HC__ {
+        int e = m_data.get_extent()[dim];
+        if (i >= 0 && i < e)
+            return true;
+        switch (mode) {
+        case address_wrap:
+            i %= e;
+            if (i < 0)
+                i += e;
+            return true;
+        case address_border:
+            return false;
+        default:
+            i = i < 0 ? 0 : e - 1;
+            return true;
+        }
+    }
+
+    // the texel at "idx" after addressing it
+    T fetch(address_mode mode, index<N> idx) const __CPU__ __HC__ {
+        for (int dim = 0; dim < N; ++dim) {
+            if (!address(mode, dim, idx[dim]))
+                return T();
+        }
+        return m_data[idx];
+    }
+
+    // samples at the normalized coordinates, in the order of the dimensions
+    T sample_at(const sampler& s, const float* coords) const __CPU__ __HC__ {
+        index<N> base;
+        float frac[N];
+        for (int dim = 0; dim < N; ++dim) {
+            float t = coords[dim] * m_data.get_extent()[dim];
+            if (s.filter == filter_point) {
+                base[dim] = floor(t);
+                continue;
+            }
+            t -= 0.5f;
+            base[dim] = floor(t);
+            frac[dim] = t - base[dim];
+        }
+        if (s.filter == filter_point)
+            return fetch(s.address, base);
+
+        // the corners around the coordinates, one bit of "corner" per
+        // dimension, weighted by their distance
+        T result = T();
+        for (int corner = 0; corner < (1 << N); ++corner) {
+            index<N> idx = base;
+            float weight = 1.0f;
+            for (int dim = 0; dim < N; ++dim) {
+                if (corner & (1 << dim)) {
+                    idx[dim] += 1;
+                    weight *= frac[dim];
+                } else {
+                    weight *= 1.0f - frac[dim];
+                }
+            }
+            result += fetch(s.address, idx) * weight;
+        }
+        return result;
+    }
+
+    static int floor(float t) __CPU__ __HC__ {
+        int i = static_cast<int>(t);
+        return t < i ? i - 1 : i;
+    }
+
+    array_view<const T, N> m_data;
+};
+
+/**
+ * Copies the texels of the range [first, last) into "dest", in the order of
+ * the elements of an array.
+ */
+template <typename InputIter, typename T, int N>
+void copy(InputIter first, InputIter last, texture<T, N>& dest) {
+    copy(first, last, dest.m_data);
+}
+
+/**
+ * Copies the texels of "src" to "dest", in the order of the elements of an
+ * array.
+ */
+template <typename OutputIter, typename T, int N>
+void copy(const texture<T, N>& src, OutputIter dest) {
+    copy(src.m_data, dest);
+}
+
+} // namespace hc
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "hc.hpp"
+
+/// Default number of accelerator_views of a view_pool, the environment
+/// variable HCC_VIEW_POOL_SIZE overrides it
+#ifndef HC_VIEW_POOL_SIZE
+#define HC_VIEW_POOL_SIZE (4)
+#endif
+
+namespace hc {
+
+/**
+ * A fixed set of accelerator_views shared by the threads of a process, for
+ * servers whose threads would otherwise each create views of their own.
+ *
+ * Creating an accelerator_view creates HSA command queues, which is
+ * expensive, and the hardware only has so many queues. The pool creates its
+ * views once, and hands them out to threads as leases: a thread gets the
+ * view it used last if no other thread holds it, else the view held by the
+ * fewest threads. When there are more threads than views, views are shared by
+ * several leases at once, so the threads are multiplexed onto the queues of
+ * the pool. The lease gives the view back to the pool when it's destroyed,
+ * without waiting for the commands enqueued to it.
+ */
+class view_pool {
+public:
+    /// a view of the pool held by a thread until it's destroyed
+    class lease {
+    public:
+        lease(lease&& other) : m_pool(other.m_pool), m_slot(other.m_slot) {
+            other.m_pool = nullptr;
+        }
+        lease(const lease&) = delete;
+        lease& operator=(const lease&) = delete;
+        lease& operator=(lease&&) = delete;
+
+        ~lease() {
+            if (m_pool)
+                m_pool->release(m_slot);
+        }
+
+        /// the accelerator_view leased
+        accelerator_view& get_view() const { return m_pool->m_views[m_slot]; }
+        accelerator_view& operator*() const { return get_view(); }
+        accelerator_view* operator->() const { return &get_view(); }
+
+        /// the index of the view in the pool
+        unsigned int get_index() const { return m_slot; }
+
+    private:
+        friend class view_pool;
+        lease(view_pool* pool, unsigned int slot) : m_pool(pool), m_slot(slot) {}
+
+        view_pool* m_pool;
+        unsigned int m_slot;
+    };
+
+    /**
+     * Creates "size" accelerator_views on the accelerator "acc", or
+     * HC_VIEW_POOL_SIZE of them if size is 0.
+     */
+    explicit view_pool(accelerator acc = accelerator(), unsigned int size = 0,
+                       execute_order order = execute_in_order)
+        : m_id(next_id()), m_mutex(), m_views(), m_users(), m_next(0) {
+        if (size == 0) {
+            char* env = getenv("HCC_VIEW_POOL_SIZE");
+            size = env ? atoi(env) : 0;
+        }
+        if (size == 0)
+            size = HC_VIEW_POOL_SIZE;
+        m_views.reserve(size);
+        for (unsigned int i = 0; i < size; ++i)
+            m_views.push_back(acc.create_view(order));
+        m_users.assign(size, 0);
+    }
+
+    view_pool(const view_pool&) = delete;
+    view_pool& operator=(const view_pool&) = delete;
+
+    /// the leases must be destroyed before the pool
+    ~view_pool() {
+        affinity().erase(m_id);
+    }
+
+    /// the number of views of the pool
+    unsigned int size() const { return m_views.size(); }
+
+    /// the view "i" of the pool, without leasing it
+    accelerator_view& get_view(unsigned int i) { return m_views[i]; }
+
+    /// leases a view to the calling thread, see view_pool
+    lease acquire() {
+        std::unordered_map<uint64_t, unsigned int>& bound = affinity();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = bound.find(m_id);
+        unsigned int slot;
+        if (it != bound.end()) {
+            slot = it->second;
+        } else {
+            // threads new to the pool are spread over the views
+            slot = m_next++ % m_views.size();
+            bound[m_id] = slot;
+        }
+        if (m_users[slot] != 0) {
+            for (unsigned int i = 0; i < m_users.size(); ++i) {
+                if (m_users[i] < m_users[slot])
+                    slot = i;
+            }
+            bound[m_id] = slot;
+        }
+        m_users[slot]++;
+        return lease(this, slot);
+    }
+
+    /// the number of leases held on each view
+    std::vector<unsigned int> get_users() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_users;
+    }
+
+    /// waits for the commands enqueued to all of the views
+    void wait() {
+        for (accelerator_view& view : m_views)
+            view.wait();
+    }
+
+private:
+    void release(unsigned int slot) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_users[slot]--;
+    }
+
+    // the view each pool was last leased to the calling thread from, by id
+    // of the pool since their addresses may be reused
+    static std::unordered_map<uint64_t, unsigned int>& affinity() {
+        static thread_local std::unordered_map<uint64_t, unsigned int> bound;
+        return bound;
+    }
+
+    static uint64_t next_id() {
+        static std::atomic<uint64_t> id(0);
+        return ++id;
+    }
+
+    uint64_t m_id;
+    mutable std::mutex m_mutex;
+    std::vector<accelerator_view> m_views;
+    std::vector<unsigned int> m_users;
+    unsigned int m_next;
+};
+
+} // namespace hc
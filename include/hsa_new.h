@@ -4,19 +4,25 @@
 #include <iostream>
 #include <iomanip>
 #include <atomic>
+#include <cstdlib>
 #include <thread>
 
 // Use HSA's API
 #include <hsa/hsa.h>
 
-#define DEBUG 1
+#include <hc.hpp>
+
+// logs every call the service threads serve, when defined to 1
+#ifndef HSA_NEW_DEBUG
+#define HSA_NEW_DEBUG 0
+#endif
 #define USE_SIGNAL 1
 
 #define check(msg, status) \
 if (status != HSA_STATUS_SUCCESS) { \
     printf("%s failed with error %x.\n", #msg, status); \
     exit(1); \
-} else { \
+} else if (HSA_NEW_DEBUG) { \
    printf("%s succeeded.\n", #msg); \
 }
 
@@ -36,6 +42,242 @@ void put_ptr_x(void* addr) restrict(amp);
 void put_ptr_y(void* addr) restrict(amp);
 void put_ptr_z(void* addr) restrict(amp);
 
+/// Device-resident heap
+///
+/// Kernels allocate from slabs the host reserves up front, without a round
+/// trip to the host threads of NewInit. Blocks of up to max_block_size bytes
+/// are rounded up to a power of two, and freed blocks go to a lock-free free
+/// list of their size so that later allocations reuse them; larger blocks are
+/// never reused. Blocks the free lists don't serve are bumped off the slabs,
+/// with one atomic for the work-items of a wavefront asking for the same
+/// size. The host only gets involved when the slabs run out: a work-item asks
+/// for another slab, which NewInit's heap thread reserves.
+///
+/// The size of a slab is HCC_DEVICE_HEAP_MB megabytes, 64 by default.
+class DeviceHeap {
+public:
+  /// Constants
+  static const uint64_t min_block_size = 32;
+  static const uint64_t max_block_size = 16384;
+  static const int size_classes = 10; // 32 B .. 16 KB
+  static const int max_slabs = 64;
+
+  explicit DeviceHeap(uint64_t slab_size);
+  ~DeviceHeap();
+
+  /// Returns a block of at least size bytes aligned to 16 bytes, or NULL if
+  /// the heap is exhausted.
+  void* allocate(uint64_t size) __HC__;
+
+  /// Gives p, a block returned by allocate(), back to the heap. NULL is
+  /// ignored.
+  void deallocate(void* p) __HC__;
+
+  /// Host side: reserves the slab the kernels asked for, if any. Returns
+  /// false once they can't be served anymore.
+  bool grow();
+
+  uint64_t get_slab_count() { return hc::atomic_fetch_add(&slab_count, (uint64_t)0); }
+  uint64_t get_slab_size() const { return slab_size; }
+
+private:
+  // precedes every block and keeps it 16-byte aligned; next links free blocks
+  struct Header {
+    uint64_t size_class;
+    uint64_t next;
+  };
+  static const uint64_t large_class = ~(uint64_t)0;
+
+  // the head of a free list packs the block address, which is 16-byte
+  // aligned and within 48 bits, with a tag bumped on every pop against ABA
+  static const int tag_shift = 44;
+  static uint64_t head_block(uint64_t head) __HC__ { return (head & ((1ull << tag_shift) - 1)) << 4; }
+  static uint64_t head_tag(uint64_t head) __HC__ { return head >> tag_shift; }
+  static uint64_t make_head(uint64_t block, uint64_t tag) __HC__ { return (tag << tag_shift) | (block >> 4); }
+
+  Header* pop(int size_class) __HC__;
+  void push(int size_class, Header* block) __HC__;
+  uint64_t bump(uint64_t bytes) __HC__;
+  uint64_t slab_address(uint64_t offset) __HC__;
+
+  uint64_t slab_size;
+  // base address of each slab reserved so far
+  uint64_t slabs[max_slabs];
+  uint64_t slab_count;
+  // bytes bumped off the slabs, as an offset into their concatenation
+  uint64_t top;
+  // slabs the kernels need, and whether the host failed to reserve them
+  uint64_t slabs_requested;
+  uint64_t exhausted;
+  uint64_t free_lists[size_classes];
+};
+
+DeviceHeap::DeviceHeap(uint64_t size)
+  : slab_size((size + 4095) & ~4095ull), slab_count(0), top(0),
+    slabs_requested(1), exhausted(0) {
+  for (int i = 0; i < max_slabs; ++i)
+    slabs[i] = 0;
+  for (int i = 0; i < size_classes; ++i)
+    free_lists[i] = 0;
+  grow();
+}
+
+DeviceHeap::~DeviceHeap() {
+  for (uint64_t i = 0; i < slab_count; ++i) {
+    hsa_memory_deregister((void *)slabs[i], slab_size);
+    free((void *)slabs[i]);
+  }
+}
+
+bool DeviceHeap::grow() {
+  uint64_t requested = hc::atomic_fetch_add(&slabs_requested, (uint64_t)0);
+  while (slab_count < requested) {
+    void* slab = nullptr;
+    if (slab_count == max_slabs || posix_memalign(&slab, 4096, slab_size) != 0) {
+      hc::atomic_exchange(&exhausted, (uint64_t)1);
+      return false;
+    }
+    hsa_memory_register(slab, slab_size);
+    slabs[slab_count] = (uint64_t)slab;
+    // publishes the slab after its address
+    hc::atomic_fetch_add(&slab_count, (uint64_t)1);
+  }
+  return true;
+}
+
+uint64_t DeviceHeap::slab_address(uint64_t offset) __HC__ {
+  uint64_t slab = offset / slab_size;
+  if (slab >= max_slabs)
+    return 0;
+  if (slab >= hc::atomic_fetch_add(&slab_count, (uint64_t)0)) {
+    // the host reserves the slab, see NewInit::heapThread
+    hc::atomic_fetch_max(&slabs_requested, slab + 1);
+    while (slab >= hc::atomic_fetch_add(&slab_count, (uint64_t)0)) {
+      if (hc::atomic_fetch_add(&exhausted, (uint64_t)0))
+        return 0;
+    }
+  }
+  return slabs[slab] + offset % slab_size;
+}
+
+// offset of bytes bumped off the slabs, for the lanes of the wavefront
+// asking for the same number of bytes at once
+uint64_t DeviceHeap::bump(uint64_t bytes) __HC__ {
+  unsigned int lane = hc::__lane_id();
+  uint64_t offset = 0;
+  bool done = false;
+  while (!done) {
+    uint64_t active = hc::__ballot(1);
+    unsigned int leader = hc::__lastbit_u32_u64(active);
+    uint64_t leaderBytes = ((uint64_t)(unsigned int)hc::__shfl((int)(bytes >> 32), leader) << 32) |
+                           (unsigned int)hc::__shfl((int)bytes, leader);
+    if (bytes == leaderBytes) {
+      uint64_t same = hc::__ballot(1);
+      uint64_t first = 0;
+      if (lane == leader)
+        first = hc::atomic_fetch_add(&top, bytes * hc::__popcount_u32_b64(same));
+      first = ((uint64_t)(unsigned int)hc::__shfl((int)(first >> 32), leader) << 32) |
+              (unsigned int)hc::__shfl((int)first, leader);
+      offset = first + bytes * hc::__popcount_u32_b64(same & ((1ull << lane) - 1));
+      done = true;
+    }
+  }
+  return offset;
+}
+
+DeviceHeap::Header* DeviceHeap::pop(int size_class) __HC__ {
+  uint64_t* list = &free_lists[size_class];
+  uint64_t head = hc::atomic_fetch_add(list, (uint64_t)0);
+  while (head_block(head)) {
+    Header* block = (Header *)head_block(head);
+    // a block popped and reused meanwhile bumped the tag, the exchange fails
+    uint64_t next = make_head(block->next, head_tag(head) + 1);
+    if (hc::atomic_compare_exchange(list, &head, next))
+      return block;
+  }
+  return nullptr;
+}
+
+void DeviceHeap::push(int size_class, Header* block) __HC__ {
+  uint64_t* list = &free_lists[size_class];
+  uint64_t head = hc::atomic_fetch_add(list, (uint64_t)0);
+  do {
+    block->next = head_block(head);
+  } while (!hc::atomic_compare_exchange(list, &head, make_head((uint64_t)block, head_tag(head))));
+}
+
+void* DeviceHeap::allocate(uint64_t size) __HC__ {
+  uint64_t bytes = (size + sizeof(Header) + 15) & ~15ull;
+  uint64_t size_class = large_class;
+  if (bytes <= max_block_size) {
+    size_class = 0;
+    while ((min_block_size << size_class) < bytes)
+      ++size_class;
+    bytes = min_block_size << size_class;
+    if (Header* block = pop(size_class))
+      return block + 1;
+  }
+  if (bytes > slab_size)
+    return nullptr;
+
+  // a block straddling two slabs is dropped, and bumped again
+  uint64_t offset;
+  do {
+    offset = bump(bytes);
+  } while (offset / slab_size != (offset + bytes - 1) / slab_size);
+  Header* block = (Header *)slab_address(offset);
+  if (!block)
+    return nullptr;
+  block->size_class = size_class;
+  return block + 1;
+}
+
+void DeviceHeap::deallocate(void* p) __HC__ {
+  if (!p)
+    return;
+  Header* block = (Header *)p - 1;
+  if (block->size_class != large_class)
+    push(block->size_class, block);
+}
+
+/// Ring of the indices of the pending entries of a syscall table.
+///
+/// A work-item pushes the index of its entry once it has filled the entry
+/// in, so the service thread only visits the pending entries instead of
+/// scanning the whole table. Each entry has at most one request in flight,
+/// so a ring as large as the table never fills up.
+struct RequestRing {
+  static const uint64_t capacity = 1 << 19;
+
+  RequestRing() : head(0), tail(0) {
+    for (uint64_t i = 0; i < capacity; ++i)
+      slots[i] = 0;
+  }
+
+  /// Device side: publishes the request of the entry index.
+  void push(int index) __HC__ {
+    uint64_t slot = hc::atomic_fetch_add(&tail, (uint64_t)1);
+    hc::atomic_exchange(&slots[slot & (capacity - 1)], (unsigned int)index + 1);
+  }
+
+  /// Host side, by the single consumer: takes the index of the next
+  /// pending entry, false if there's none yet.
+  bool pop(int& index) {
+    unsigned int value = hc::atomic_exchange(&slots[head & (capacity - 1)], 0u);
+    if (!value)
+      return false;
+    ++head;
+    index = value - 1;
+    return true;
+  }
+
+private:
+  uint64_t head;
+  uint64_t tail;
+  // index + 1 of the entry of each slot, 0 until it's pushed
+  unsigned int slots[capacity];
+};
+
 class NewInit {
 public:
   /// Constants
@@ -44,6 +286,8 @@ public:
   static const int max_vec_size = 409600;
   static const int max_tile_size = 256;
   static const int max_tile_count = max_vec_size;
+  static_assert(RequestRing::capacity >= max_vec_size,
+                "a request ring holds a request of every table entry");
 
   static const hsa_signal_value_t Halt = 0;
   static const hsa_signal_value_t Exit = -1;
@@ -64,6 +308,14 @@ public:
   std::atomic_long *ptr_c;
   std::atomic_long *ptr_z;
 
+  // pointer to the rings of pending entries of the Xmalloc table and of the
+  // malloc/free/Xfree table, which the device pushes the entries it fills to
+  RequestRing *ptr_Xring;
+  RequestRing *ptr_ring;
+
+  // heap kernels allocate from on their own
+  DeviceHeap *heap;
+
   NewInit ();
   ~NewInit ();
 
@@ -84,9 +336,15 @@ private:
   std::atomic_long table_c[max_vec_size]; // Xmalloc thread
   std::atomic_long table_z[max_vec_size]; // malloc/free/Xfree thread
 
+  // pending entries
+  RequestRing Xring; // Xmalloc thread
+  RequestRing ring; // malloc/free/Xfree thread
+
   // Thread entities
   std::thread Xmalloc_thread;
   std::thread malloc_thread;
+  std::thread heap_thread;
+  std::atomic_bool heap_exit;
 
   int Xmalloc_count;
   int malloc_count;
@@ -94,6 +352,7 @@ private:
 
   void XmallocThread();
   void mallocThread();
+  void heapThread();
 };
 
 NewInit newInit;
@@ -133,6 +392,17 @@ NewInit::NewInit() {
   ptr_x = &table_x[0];
   ptr_y = &table_y[0];
   ptr_z = &table_z[0];
+  ptr_Xring = &Xring;
+  ptr_ring = &ring;
+
+  uint64_t heap_mb = 64;
+  if (const char* env = getenv("HCC_DEVICE_HEAP_MB")) {
+    if (atoi(env) > 0)
+      heap_mb = atoi(env);
+  }
+  heap = new DeviceHeap(heap_mb << 20);
+  heap_exit.store(false);
+  heap_thread = std::thread(&NewInit::heapThread, this);
 
   // fire CPU thread
   Xmalloc_thread = std::thread(&NewInit::XmallocThread, this);
@@ -154,14 +424,31 @@ NewInit::~NewInit() {
   malloc_thread.join();
 #endif
 
+  heap_exit.store(true);
+  heap_thread.join();
+  delete heap;
+
   hsa_signal_destroy(XmallocFlag);
   hsa_signal_destroy(mallocFlag);
 
   hsa_shut_down();
 }
 
+// Reserves the slabs device heap allocations run out of. The kernels don't
+// raise a signal, so the slabs they ask for are polled.
+void NewInit::heapThread() {
+  std::chrono::milliseconds dura(1);
+  while (!heap_exit.load()) {
+    if (!heap->grow())
+      break;
+    std::this_thread::sleep_for(dura);
+  }
+}
+
 void NewInit::XmallocThread() {
+#if HSA_NEW_DEBUG
   std::cout << "Enter Xmalloc syscall service thread..." << std::endl;
+#endif
 
   std::chrono::milliseconds dura(cpuSleepMsec);
   int syscall;
@@ -178,11 +465,11 @@ void NewInit::XmallocThread() {
       break;
 #endif
 
-#if DEBUG
+#if HSA_NEW_DEBUG
     std::cout << "Xmalloc Thread iterates ... " << std::dec << ++XmallocIterates << std::endl;
 #endif
 
-    for (int i = 0; i < max_tile_count; ++i) {
+    for (int i; Xring.pop(i); ) {
       syscall = (ptr_a + i)->load(std::memory_order_acquire);
 
       if (syscall) {
@@ -195,7 +482,7 @@ void NewInit::XmallocThread() {
         switch (syscall) {
           case 1: { // malloc
             result = (long)malloc(param);
-#if DEBUG
+#if HSA_NEW_DEBUG
             std::cout << std::dec << "malloc(" << param << "), "
               << "ret: " << "0x" << std::setfill('0') << std::setw(2) << std::hex << result << "\n";
 #endif
@@ -214,11 +501,15 @@ void NewInit::XmallocThread() {
     std::this_thread::sleep_for(dura);
   }
 
+#if HSA_NEW_DEBUG
   std::cout << "Leave Xmalloc syscall service thread." << std::endl;
+#endif
 }
 
 void NewInit::mallocThread() {
+#if HSA_NEW_DEBUG
   std::cout << "Enter malloc/free/Xfree service thread..." << std::endl;
+#endif
 
   std::chrono::milliseconds dura(cpuSleepMsec);
   int syscall;
@@ -235,11 +526,11 @@ void NewInit::mallocThread() {
       break;
 #endif
 
-#if DEBUG
+#if HSA_NEW_DEBUG
     std::cout << "malloc Thread iterates ... " << std::dec << ++mallocIterates << std::endl;
 #endif
 
-    for (int i = 0; i < max_vec_size; ++i) {
+    for (int i; ring.pop(i); ) {
       syscall = (ptr_x + i)->load(std::memory_order_acquire);
 
       if (syscall) {
@@ -252,7 +543,7 @@ void NewInit::mallocThread() {
           case 1: { // malloc
             malloc_count++;
             result = (long)malloc(param);
-#if DEBUG
+#if HSA_NEW_DEBUG
             std::cout << std::dec << "malloc(" << param << "), "
               << "ret: " << "0x" << std::setfill('0') << std::setw(2) << std::hex << result << "\n";
 #endif
@@ -266,7 +557,7 @@ void NewInit::mallocThread() {
             int *p_counter = (int *)((char *)p_header - header_offset);
 
             *p_counter -= 1;
-#if DEBUG
+#if HSA_NEW_DEBUG
             std::cout << "param(alloc): " << std::hex << (void *)param << ", "
               << "value in *alloc: " << std::dec << *((int *)alloc) << ", "
               << "p_header: " << std::hex << p_header << ", "
@@ -277,7 +568,7 @@ void NewInit::mallocThread() {
             if (*p_counter == 0) {
               Xfree_count++;
               free ((void *)p_counter);
-#if DEBUG
+#if HSA_NEW_DEBUG
               std::cout << "free: " << std::hex << (void *)p_counter << "\n";
 #endif
               break;
@@ -297,9 +588,9 @@ void NewInit::mallocThread() {
     std::this_thread::sleep_for(dura);
   }
 
+#if HSA_NEW_DEBUG
   std::cout << "Leave malloc/free/Xfree syscall service thread." << std::endl;
+#endif
 }
 
-#undef DEBUG
-
 #endif
@@ -7,8 +7,40 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
 
+#if __KALMAR_ACCELERATOR__ != 1
+#include <mutex>
+#include <vector>
+#include <sys/mman.h>
+#endif
+
+/// Host buffers of at most this size are served from page-aligned size
+/// classes (powers of two from one page up), cached per thread
+#ifndef KALMAR_HOST_POOL_MAX
+#define KALMAR_HOST_POOL_MAX (2 * 1024 * 1024)
+#endif
+
+/// Number of blocks of each size class a thread keeps for itself before
+/// handing them back to the process-wide free lists
+#ifndef KALMAR_HOST_POOL_THREAD_BLOCKS
+#define KALMAR_HOST_POOL_THREAD_BLOCKS (8)
+#endif
+
+/// Upper bound, in bytes, on the blocks of each size class kept in the
+/// process-wide free lists; blocks beyond that go back to the system
+#ifndef KALMAR_HOST_POOL_GLOBAL_LIMIT
+#define KALMAR_HOST_POOL_GLOBAL_LIMIT (32 * 1024 * 1024)
+#endif
+
+/// Host buffers above KALMAR_HOST_POOL_MAX are mapped directly and rounded
+/// up to huge pages. Transparent huge pages are requested by default; set
+/// HCC_HOST_HUGETLB=ON to map them from the hugetlbfs pool first
+#define KALMAR_HOST_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
 /** \cond HIDDEN_SYMBOLS */
 namespace Kalmar {
 
@@ -42,5 +74,166 @@ inline void kalmar_aligned_free(void* ptr) noexcept {
     }
 }
 
+#if __KALMAR_ACCELERATOR__ != 1
+
+constexpr inline int kalmar_host_class_count(std::size_t size) noexcept {
+    return size <= 0x1000 ? 1 : 1 + kalmar_host_class_count(size >> 1);
+}
+
+/// Process-wide free lists of the host memory pool, one per size class
+class KalmarHostPool {
+public:
+    static const std::size_t MIN_BLOCK = 0x1000;
+
+    static int getClass(std::size_t size) noexcept {
+        int c = 0;
+        std::size_t blockSize = MIN_BLOCK;
+        while (blockSize < size) {
+            blockSize <<= 1;
+            ++c;
+        }
+        return c;
+    }
+
+    static std::size_t getClassSize(int c) noexcept { return MIN_BLOCK << c; }
+
+    static const int CLASS_COUNT = kalmar_host_class_count(KALMAR_HOST_POOL_MAX);
+
+    static KalmarHostPool& get() {
+        static KalmarHostPool pool;
+        return pool;
+    }
+
+    void* pop(int c) {
+        std::lock_guard<std::mutex> l(mutex);
+        if (blocks[c].empty())
+            return nullptr;
+        void* p = blocks[c].back();
+        blocks[c].pop_back();
+        return p;
+    }
+
+    void push(int c, void* p) {
+        {
+            std::lock_guard<std::mutex> l(mutex);
+            if ((blocks[c].size() + 1) * getClassSize(c) <= KALMAR_HOST_POOL_GLOBAL_LIMIT) {
+                blocks[c].push_back(p);
+                return;
+            }
+        }
+        std::free(p);
+    }
+
+    bool useHugeTLB() const { return hugeTLB; }
+
+    ~KalmarHostPool() {
+        for (int c = 0; c < CLASS_COUNT; ++c)
+            for (void* p : blocks[c])
+                std::free(p);
+    }
+
+private:
+    KalmarHostPool() : hugeTLB(false) {
+        char* value = std::getenv("HCC_HOST_HUGETLB");
+        if (value && (std::strcmp(value, "ON") == 0 || std::strcmp(value, "1") == 0))
+            hugeTLB = true;
+    }
+
+    std::mutex mutex;
+    std::vector<void*> blocks[CLASS_COUNT];
+    bool hugeTLB;
+};
+
+/// Blocks of each size class cached by the calling thread. They are handed
+/// back to the process-wide free lists when the thread exits
+struct KalmarHostThreadCache {
+    void* blocks[KalmarHostPool::CLASS_COUNT][KALMAR_HOST_POOL_THREAD_BLOCKS];
+    int counts[KalmarHostPool::CLASS_COUNT];
+
+    KalmarHostThreadCache() {
+        std::memset(counts, 0, sizeof(counts));
+        /// construct the free lists first so they outlive the cache
+        KalmarHostPool::get();
+    }
+
+    ~KalmarHostThreadCache() {
+        KalmarHostPool& pool = KalmarHostPool::get();
+        for (int c = 0; c < KalmarHostPool::CLASS_COUNT; ++c)
+            while (counts[c] > 0)
+                pool.push(c, blocks[c][--counts[c]]);
+    }
+
+    static KalmarHostThreadCache& get() {
+        static thread_local KalmarHostThreadCache cache;
+        return cache;
+    }
+};
+
+inline std::size_t kalmar_host_huge_size(std::size_t size) noexcept {
+    return (size + KALMAR_HOST_HUGE_PAGE_SIZE - 1) & ~(std::size_t(KALMAR_HOST_HUGE_PAGE_SIZE) - 1);
+}
+
+#endif // __KALMAR_ACCELERATOR__ != 1
+
+/// Allocate a page-aligned host buffer of size bytes. Small buffers come
+/// from the calling thread's cache of the matching size class, large ones
+/// are mapped on huge pages. The buffer must be released with
+/// kalmar_host_free() and the same size
+inline void* kalmar_host_alloc(std::size_t size) noexcept {
+#if __KALMAR_ACCELERATOR__ != 1
+    if (size <= KALMAR_HOST_POOL_MAX) {
+        int c = KalmarHostPool::getClass(size);
+        KalmarHostThreadCache& cache = KalmarHostThreadCache::get();
+        if (cache.counts[c] > 0)
+            return cache.blocks[c][--cache.counts[c]];
+        void* p = KalmarHostPool::get().pop(c);
+        if (p)
+            return p;
+        if (posix_memalign(&p, KalmarHostPool::MIN_BLOCK, KalmarHostPool::getClassSize(c)) != 0)
+            return nullptr;
+        return p;
+    }
+
+    std::size_t n = kalmar_host_huge_size(size);
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (KalmarHostPool::get().useHugeTLB())
+        p = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+#endif
+    if (p == MAP_FAILED) {
+        p = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED)
+            return nullptr;
+#ifdef MADV_HUGEPAGE
+        madvise(p, n, MADV_HUGEPAGE);
+#endif
+    }
+    return p;
+#else
+    return kalmar_aligned_alloc(0x1000, size);
+#endif
+}
+
+/// Release a buffer from kalmar_host_alloc() of size bytes
+inline void kalmar_host_free(void* ptr, std::size_t size) noexcept {
+    if (!ptr)
+        return;
+#if __KALMAR_ACCELERATOR__ != 1
+    if (size <= KALMAR_HOST_POOL_MAX) {
+        int c = KalmarHostPool::getClass(size);
+        KalmarHostThreadCache& cache = KalmarHostThreadCache::get();
+        if (cache.counts[c] < KALMAR_HOST_POOL_THREAD_BLOCKS) {
+            cache.blocks[c][cache.counts[c]++] = ptr;
+            return;
+        }
+        KalmarHostPool::get().push(c, ptr);
+        return;
+    }
+    munmap(ptr, kalmar_host_huge_size(size));
+#else
+    kalmar_aligned_free(ptr);
+#endif
+}
+
 } // namespace Kalmar
 /** \endcond */
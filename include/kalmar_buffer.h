@@ -10,9 +10,65 @@
 #include "kalmar_runtime.h"
 #include "kalmar_serialize.h"
 
+/// rw_info is held through an intrusively reference counted handle rather
+/// than std::shared_ptr if set, so neither a control block nor its weak
+/// count is involved in copying views
+#ifndef KALMAR_INTRUSIVE_RW_INFO
+#define KALMAR_INTRUSIVE_RW_INFO (0)
+#endif
+
 /** \cond HIDDEN_SYMBOLS */
 namespace Kalmar {
 
+/// Handle of a rw_info counting its references in rw_info::refCount
+/// Moves transfer the reference without touching the count
+class rw_info_handle {
+    rw_info* p_;
+public:
+    rw_info_handle() noexcept : p_(nullptr) {}
+    explicit rw_info_handle(rw_info* p) noexcept : p_(p) {
+        if (p_)
+            p_->refCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    rw_info_handle(const rw_info_handle& other) noexcept : rw_info_handle(other.p_) {}
+    rw_info_handle(rw_info_handle&& other) noexcept : p_(other.p_) { other.p_ = nullptr; }
+    ~rw_info_handle() { reset(); }
+
+    rw_info_handle& operator=(const rw_info_handle& other) noexcept {
+        rw_info_handle(other).swap(*this);
+        return *this;
+    }
+    rw_info_handle& operator=(rw_info_handle&& other) noexcept {
+        rw_info_handle(std::move(other)).swap(*this);
+        return *this;
+    }
+
+    void swap(rw_info_handle& other) noexcept { std::swap(p_, other.p_); }
+    void reset() noexcept {
+        if (p_ && p_->refCount.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            delete p_;
+        p_ = nullptr;
+    }
+
+    rw_info* get() const noexcept { return p_; }
+    rw_info* operator->() const noexcept { return p_; }
+    explicit operator bool() const noexcept { return p_ != nullptr; }
+};
+
+#if KALMAR_INTRUSIVE_RW_INFO
+typedef rw_info_handle rw_info_ptr;
+template <typename... Args>
+inline rw_info_ptr make_rw_info(Args&&... args) {
+    return rw_info_ptr(new rw_info(std::forward<Args>(args)...));
+}
+#else
+typedef std::shared_ptr<rw_info> rw_info_ptr;
+template <typename... Args>
+inline rw_info_ptr make_rw_info(Args&&... args) {
+    return std::make_shared<rw_info>(std::forward<Args>(args)...);
+}
+#endif
+
 // Dummy interface that looks somewhat like std::shared_ptr<T>
 template <typename T>
 class _data {
@@ -33,13 +89,23 @@ public:
     std::shared_ptr<KalmarQueue> get_av() const { return nullptr; }
     void reset() const {}
 
-    T* map_ptr(bool modify, size_t count, size_t offset) const { return nullptr; }
-    void unmap_ptr(const void* addr, bool modify, size_t count, size_t offset) const {}
+    T* map_ptr(bool modify, size_t count, size_t offset, bool overwrite = false) const { return nullptr; }
+    void unmap_ptr(const void* addr, bool modify, size_t count, size_t offset, bool overwrite = false) const {}
     void synchronize(bool modify = false) const {}
     void get_cpu_access(bool modify = false) const {}
+    void get_cpu_access(bool modify, size_t offset, size_t count) const {}
     void copy(_data<T> other, int, int, int) const {}
+    std::shared_ptr<KalmarAsyncOp> copy_async(_data<T> other, int, int, int) const { return nullptr; }
+    std::shared_ptr<KalmarAsyncOp> prefetch(std::shared_ptr<KalmarQueue> pQueue, bool modify = false) const { return nullptr; }
+    std::shared_ptr<KalmarAsyncOp> get_cpu_access_async(bool modify = false) const { return nullptr; }
+    void advise(hcMemoryAdvice advice, std::shared_ptr<KalmarQueue> pQueue) const {}
+    void replicate(const std::vector< std::shared_ptr<KalmarQueue> >& queues) const {}
+    void set_placement(hcMemoryPlacement placement) const {}
+    hcMemoryPlacement get_placement() const { return hcMemoryPlacementDefault; }
     void write(const T*, int , int offset = 0, bool blocking = false) const {}
+    std::shared_ptr<KalmarAsyncOp> write_async(std::shared_ptr<const void>, int, int offset = 0) const { return nullptr; }
     void read(T*, int , int offset = 0) const {}
+    void set_range(size_t, size_t, size_t, size_t) {}
     void refresh() const {}
     void set_const() const {}
     access_type get_access() const { return access_type_auto; }
@@ -51,26 +117,63 @@ private:
 
 template <typename T>
 class _data_host {
-    mutable std::shared_ptr<rw_info> mm;
+    mutable rw_info_ptr mm;
     bool isArray;
+    /// the section of the data used by the view holding this reference,
+    /// kernels only synchronize that section, or all of the data if it has
+    /// no blocks
+    rw_range range;
     template <typename U> friend class _data_host;
 public:
     _data_host(size_t count, const void* src = nullptr)
-        : mm(std::make_shared<rw_info>(count*sizeof(T), const_cast<void*>(src))),
-        isArray(false) {}
+        : mm(make_rw_info(count*sizeof(T), const_cast<void*>(src))),
+        isArray(false), range() {}
+
+    /// binds host memory which is mapped to the devices instead of copied
+    _data_host(size_t count, const void* src, bool zeroCopy)
+        : mm(make_rw_info(count*sizeof(T), const_cast<void*>(src), zeroCopy)),
+        isArray(false), range() {}
 
     _data_host(std::shared_ptr<KalmarQueue> av, std::shared_ptr<KalmarQueue> stage, int count,
                access_type mode)
-        : mm(std::make_shared<rw_info>(av, stage, count*sizeof(T), mode)), isArray(true) {}
+        : mm(make_rw_info(av, stage, count*sizeof(T), mode)), isArray(true), range() {}
 
     _data_host(std::shared_ptr<KalmarQueue> av, std::shared_ptr<KalmarQueue> stage, int count,
                void* device_pointer, access_type mode)
-        : mm(std::make_shared<rw_info>(av, stage, count*sizeof(T), device_pointer, mode)), isArray(true) {}
+        : mm(make_rw_info(av, stage, count*sizeof(T), device_pointer, mode)), isArray(true), range() {}
+
+    _data_host(const _data_host& other) : mm(other.mm), isArray(false), range(other.range) {}
 
-    _data_host(const _data_host& other) : mm(other.mm), isArray(false) {}
+    /// moving keeps the reference, and whether it's the one of an array
+    _data_host(_data_host&& other) noexcept
+        : mm(std::move(other.mm)), isArray(other.isArray), range(other.range) {}
 
     template <typename U>
-        _data_host(const _data_host<U>& other) : mm(other.mm), isArray(false) {}
+        _data_host(const _data_host<U>& other) : mm(other.mm), isArray(false), range(other.range) {}
+
+    template <typename U>
+        _data_host(_data_host<U>&& other) noexcept
+        : mm(std::move(other.mm)), isArray(false), range(other.range) {}
+
+    _data_host& operator=(const _data_host& other) {
+        mm = other.mm;
+        isArray = other.isArray;
+        range = other.range;
+        return *this;
+    }
+
+    _data_host& operator=(_data_host&& other) noexcept {
+        mm = std::move(other.mm);
+        isArray = other.isArray;
+        range = other.range;
+        return *this;
+    }
+
+    /// only @blocks blocks of @size elements, @stride elements apart from
+    /// @offset, are used, or all of the data if @blocks is 0
+    void set_range(size_t offset, size_t size, size_t stride, size_t blocks) {
+        range = {offset * sizeof(T), size * sizeof(T), stride * sizeof(T), blocks};
+    }
 
     T *get() const { return static_cast<T*>(mm->data); }
     T* get_device_pointer() const { return static_cast<T*>(mm->get_device_pointer()); }
@@ -80,27 +183,53 @@ public:
     size_t size() const { return mm->count; }
     void reset() const { mm.reset(); }
     void get_cpu_access(bool modify = false) const { mm->get_cpu_access(modify); }
+    void get_cpu_access(bool modify, size_t offset, size_t count) const {
+        mm->get_cpu_access(modify, offset * sizeof(T), count * sizeof(T));
+    }
     std::shared_ptr<KalmarQueue> get_av() const { return mm->master; }
+    /// the queue the data was last synchronized to
+    KalmarQueue* get_curr() const { return mm->curr.get(); }
     std::shared_ptr<KalmarQueue> get_stage() const { return mm->stage; }
     access_type get_access() const { return mm->mode; }
     void copy(_data_host<T> other, int src_offset, int dst_offset, int size) const {
         mm->copy(other.mm.get(), src_offset * sizeof(T), dst_offset * sizeof(T), size * sizeof(T));
     }
+    std::shared_ptr<KalmarAsyncOp> copy_async(_data_host<T> other, int src_offset, int dst_offset, int size) const {
+        return mm->copy_async(other.mm.get(), src_offset * sizeof(T), dst_offset * sizeof(T), size * sizeof(T));
+    }
     void write(const T* src, int size, int offset = 0, bool blocking = false) const {
         mm->write(src, size * sizeof(T), offset * sizeof(T), blocking);
     }
+    std::shared_ptr<KalmarAsyncOp> write_async(std::shared_ptr<const void> src, int size, int offset = 0) const {
+        return mm->write_async(std::move(src), size * sizeof(T), offset * sizeof(T));
+    }
     void read(T* dst, int size, int offset = 0) const {
         mm->read(dst, size * sizeof(T), offset * sizeof(T));
     }
-    T* map_ptr(bool modify, size_t count, size_t offset) const {
-        return (T*)mm->map(count * sizeof(T), offset * sizeof(T), modify);
+    T* map_ptr(bool modify, size_t count, size_t offset, bool overwrite = false) const {
+        return (T*)mm->map(count * sizeof(T), offset * sizeof(T), modify, overwrite);
+    }
+    void unmap_ptr(const void* addr, bool modify, size_t count, size_t offset, bool overwrite = false) const {
+        return mm->unmap(const_cast<void*>(addr), count * sizeof(T), offset * sizeof(T), modify, overwrite);
+    }
+    void sync_to(std::shared_ptr<KalmarQueue> pQueue, bool modify = false) const { mm->sync(pQueue, modify); }
+    std::shared_ptr<KalmarAsyncOp> prefetch(std::shared_ptr<KalmarQueue> pQueue, bool modify = false) const {
+        return mm->prefetch(pQueue, modify);
+    }
+    std::shared_ptr<KalmarAsyncOp> get_cpu_access_async(bool modify = false) const {
+        return mm->get_cpu_access_async(modify);
     }
-    void unmap_ptr(const void* addr, bool modify, size_t count, size_t offset) const { return mm->unmap(const_cast<void*>(addr), count * sizeof(T), offset * sizeof(T), modify); }
-    void sync_to(std::shared_ptr<KalmarQueue> pQueue) const { mm->sync(pQueue, false); }
+    void advise(hcMemoryAdvice advice, std::shared_ptr<KalmarQueue> pQueue) const { mm->advise(advice, pQueue); }
+    void replicate(const std::vector< std::shared_ptr<KalmarQueue> >& queues) const { mm->replicate(queues); }
+    void set_placement(hcMemoryPlacement placement) const { mm->set_placement(placement); }
+    hcMemoryPlacement get_placement() const { return mm->placement; }
 
     __attribute__((annotate("serialize")))
         void __cxxamp_serialize(Serialize& s) const {
-            s.visit_buffer(mm.get(), !std::is_const<T>::value, isArray);
+            if (range.blocks)
+                s.visit_buffer_range(mm.get(), !std::is_const<T>::value, isArray, range);
+            else
+                s.visit_buffer(mm.get(), !std::is_const<T>::value, isArray);
         }
     __attribute__((annotate("user_deserialize")))
         explicit _data_host(typename std::remove_const<T>::type* t) {}
@@ -7,6 +7,9 @@
 
 #pragma once
 
+#include <cstdlib>
+#include <cstring>
+
 #include "hc_defines.h"
 #include "kalmar_runtime.h"
 #include "kalmar_serialize.h"
@@ -15,27 +18,42 @@ namespace Kalmar {
 template <int D0, int D1=0, int D2=0> class tiled_extent;
 
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
-static const unsigned int NTHREAD = std::thread::hardware_concurrency();
+/// Synchronize the data of a kernel to the queue it is launched on, and note
+/// the task of the kernel as the latest operation on the data. The kernel
+/// swaps the host pointer of the data while it runs, so any use of the data,
+/// the next kernel using it included, waits for the task
+class CPUTaskVisitor : public CPUVisitor
+{
+    std::shared_ptr<CPUAsyncOp> op;
+    std::set<struct rw_info*> bufs;
+public:
+    CPUTaskVisitor(std::shared_ptr<KalmarQueue> pQueue, std::shared_ptr<CPUAsyncOp> op)
+        : CPUVisitor(pQueue), op(op) {}
+    void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override {
+        bool first = bufs.insert(rw).second;
+        if (first)
+            for (auto& it : rw->devs)
+                rw->wait_async_ops(it.second, true);
+        CPUVisitor::visit_buffer(rw, modify, isArray);
+        if (first)
+            for (auto& it : rw->devs)
+                it.second.writer = op;
+    }
+};
 
+/// Run by the task of a kernel around the kernel itself, which swaps the
+/// host pointers of its data back when the kernel is done
 template <typename Kernel>
 class CPUKernelRAII
 {
     const std::shared_ptr<Kalmar::KalmarQueue> pQueue;
     const Kernel& f;
-    std::vector<std::thread> th;
 public:
     CPUKernelRAII(const std::shared_ptr<Kalmar::KalmarQueue> pQueue, const Kernel& f)
-        : pQueue(pQueue), f(f), th(NTHREAD) {
-        CPUVisitor vis(pQueue);
-        Serialize s(&vis);
-        f.__cxxamp_serialize(s);
+        : pQueue(pQueue), f(f) {
         CLAMP::enter_kernel();
     }
-    std::thread& operator[](int i) { return th[i]; }
     ~CPUKernelRAII() {
-        for (auto& t : th)
-            if (t.joinable())
-                t.join();
         CPUVisitor vis(pQueue);
         Serialize ss(&vis);
         f.__cxxamp_serialize(ss);
@@ -43,6 +61,130 @@ public:
     }
 };
 
+/// launch kernel f asynchronously on pQueue, run(f) runs it on the CPU
+/// thread pool. The kernel is run at once if the queue can't run tasks
+template <typename Kernel, typename Run>
+static inline std::shared_ptr<KalmarAsyncOp>
+enqueue_cpu_kernel(const std::shared_ptr<KalmarQueue>& pQueue, const Kernel& f, const Run& run)
+{
+    std::shared_ptr<KalmarQueue> queue = pQueue;
+    /// the task keeps a copy of the kernel, and the data it uses, alive
+    auto op = std::make_shared<CPUAsyncOp>(pQueue.get(), [queue, f, run] {
+        CPUKernelRAII<Kernel> obj(queue, f);
+        run(f);
+    });
+    CPUTaskVisitor vis(pQueue, op);
+    Serialize s(&vis);
+    f.__cxxamp_serialize(s);
+    if (!pQueue->EnqueueTask(op))
+        op->run();
+    return op;
+}
+
+/// Count the buffers a kernel uses
+class CPUBufferCounter : public FunctorBufferWalker
+{
+public:
+    size_t count = 0;
+    void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override { ++count; }
+};
+
+/// check if kernel f uses any array or array_view, whose data is kept on
+/// one device at a time, so it can't be split between devices
+template <typename Kernel>
+static inline bool uses_buffers(const Kernel& f)
+{
+    CPUBufferCounter vis;
+    Serialize s(&vis);
+    f.__cxxamp_serialize(s);
+    return vis.count != 0;
+}
+
+/// instruction sets the loops of CPU kernels are compiled for, the best one
+/// the host supports is picked at run time
+enum cpu_isa {
+    cpu_isa_generic = 0,
+    cpu_isa_avx2 = 1,
+    cpu_isa_avx512 = 2
+};
+
+/// the best instruction set of the host by cpuid, lowered to what
+/// HCC_CPU_ISA (generic, avx2 or avx512) names if it's set
+static inline cpu_isa detect_cpu_isa()
+{
+    int isa = cpu_isa_generic;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        isa = cpu_isa_avx512;
+    else if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        isa = cpu_isa_avx2;
+#endif
+    const char* env = getenv("HCC_CPU_ISA");
+    if (env != nullptr) {
+        int cap = strcmp(env, "avx512") == 0 ? cpu_isa_avx512 :
+                  strcmp(env, "avx2") == 0 ? cpu_isa_avx2 : cpu_isa_generic;
+        if (cap < isa)
+            isa = cap;
+    }
+    return static_cast<cpu_isa>(isa);
+}
+
+/// the instruction set the CPU kernels are run with, detected once
+static inline cpu_isa get_cpu_isa()
+{
+    static const cpu_isa isa = detect_cpu_isa();
+    return isa;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+/// Task::run is always inlined into these, so the loops of the task and the
+/// kernel inlined in them are compiled, and vectorized, for the instruction
+/// set of each
+template <typename Task, typename... Args>
+__attribute__((target("avx2,fma")))
+void run_cpu_task_avx2(Args&... args)
+{
+    Task::run(args...);
+}
+
+template <typename Task, typename... Args>
+__attribute__((target("avx512f,avx512cd,avx512bw,avx512dq,avx512vl,avx2,fma")))
+void run_cpu_task_avx512(Args&... args)
+{
+    Task::run(args...);
+}
+#endif
+
+/// run Task::run(args...), a loop over the work-items of a CPU kernel, in
+/// the version compiled for the instruction set of the host
+template <typename Task, typename... Args>
+static inline void run_cpu_task_isa(Args&... args)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    switch (get_cpu_isa()) {
+    case cpu_isa_avx512:
+        run_cpu_task_avx512<Task>(args...);
+        return;
+    case cpu_isa_avx2:
+        run_cpu_task_avx2<Task>(args...);
+        return;
+    default:
+        break;
+    }
+#endif
+    Task::run(args...);
+}
+
+/// run task(begin, end) over ranges of [0, count) on the CPU thread pool
+template <typename Task>
+static inline void run_cpu_tasks(size_t count, const Task& task)
+{
+    CLAMP::RunCPUTasks(count, [](void* data, size_t begin, size_t end) {
+        (*static_cast<const Task*>(data))(begin, end);
+    }, const_cast<Task*>(&task));
+}
+
 #endif
 
 }
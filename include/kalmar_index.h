@@ -213,6 +213,46 @@ struct amp_helper<1, _Tp1, _Tp2>
         ext.base_ -= idx.base_;
     }
 };
+
+/**
+ * Division of non-negative ints by a positive divisor known when a launch is
+ * set up, with a multiplication and a shift instead of a division, which
+ * takes tens of instructions on GCN and tens of cycles on hosts.
+ *
+ * For a divisor d and l = ceil(log2(d)), magic = ceil(2^(31 + l) / d) is
+ * less than 2^32 + 1, and n * magic >> (31 + l) is n / d for all n below
+ * 2^31 without overflowing 64 bits.
+ */
+class fast_divisor {
+    unsigned long long magic;
+    int shift;
+    int divisor;
+public:
+    fast_divisor() restrict(amp,cpu) : magic(1ULL << 31), shift(31), divisor(1) {}
+
+    explicit fast_divisor(int d) restrict(amp,cpu) : divisor(d) {
+        // an empty extent has no index to divide, 0 isn't used as a divisor
+        if (d < 1)
+            d = 1;
+        int l = 0;
+        while ((1LL << l) < d)
+            ++l;
+        magic = ((1ULL << (31 + l)) + d - 1) / d;
+        shift = 31 + l;
+    }
+
+    int get() const restrict(amp,cpu) { return divisor; }
+
+    /// n / d, for n >= 0
+    int div(int n) const restrict(amp,cpu) {
+        return static_cast<int>((static_cast<unsigned long long>(n) * magic) >> shift);
+    }
+
+    /// n % d, for n >= 0
+    int mod(int n) const restrict(amp,cpu) {
+        return n - div(n) * divisor;
+    }
+};
 /** \endcond */
 
 /**
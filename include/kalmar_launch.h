@@ -30,12 +30,43 @@ static inline std::string mcw_cxxamp_fixnames(char *f) restrict(cpu) {
     return out;
 }
 
+/// get the kernel handle of a launch site, its name is fixed once on the
+/// first launch of the kernel
+template <typename Kernel>
+static inline KalmarKernelHandle& get_kernel_handle(const Kernel& f) restrict(cpu) {
+    static KalmarKernelHandle handle(mcw_cxxamp_fixnames(f.__cxxamp_trampoline_name()));
+    return handle;
+}
+
+/// whether the device compiler found a kernel free of tile barriers, looked
+/// up once per launch site in the properties embedded next to the kernels
+template <typename Kernel>
+static inline bool is_compiled_barrier_free(const Kernel& f) restrict(cpu) {
+    static const bool barrier_free = [&f] {
+        CLAMP::KernelProperties props = CLAMP::GetKernelProperties(get_kernel_handle(f).name);
+        return props.known && !props.hasBarriers;
+    }();
+    return barrier_free;
+}
+
+/// the arguments of the kernel of a launch site the device compiler found
+/// only read through, looked up once in the embedded properties
+template <typename Kernel>
+static inline uint64_t compiled_read_only_args(const Kernel& f) restrict(cpu) {
+    static const uint64_t read_only = [&f] {
+        CLAMP::KernelProperties props = CLAMP::GetKernelProperties(get_kernel_handle(f).name);
+        return props.known ? props.readOnlyArgs : 0;
+    }();
+    return read_only;
+}
+
 template <typename Kernel>
 static void append_kernel(const std::shared_ptr<KalmarQueue>& pQueue, const Kernel& f, void* kernel)
 {
-  Kalmar::BufferArgumentsAppender vis(pQueue, kernel);
+  Kalmar::BufferArgumentsAppender vis(pQueue, kernel, compiled_read_only_args(f));
   Kalmar::Serialize s(&vis);
   f.__cxxamp_serialize(s);
+  vis.flush();
 }
 
 template <typename Kernel>
@@ -63,12 +94,7 @@ mcw_cxxamp_launch_kernel_async(const std::shared_ptr<KalmarQueue>& pQueue, size_
   //this triggers the trampoline code being emitted
   // FIXME: implicitly casting to avoid pointer to int error
   int* foo = reinterpret_cast<int*>(&Kernel::__cxxamp_trampoline);
-  void *kernel = NULL;
-  {
-      std::string transformed_kernel_name =
-          mcw_cxxamp_fixnames(f.__cxxamp_trampoline_name());
-      kernel = CLAMP::CreateKernel(transformed_kernel_name, pQueue.get());
-  }
+  void *kernel = CLAMP::CreateKernel(get_kernel_handle(f), pQueue.get());
   append_kernel(pQueue, f, kernel);
   return pQueue->LaunchKernelAsync(kernel, dim_ext, ext, local_size);
 #endif
@@ -87,12 +113,7 @@ void mcw_cxxamp_launch_kernel(const std::shared_ptr<KalmarQueue>& pQueue, size_t
   //this triggers the trampoline code being emitted
   // FIXME: implicitly casting to avoid pointer to int error
   int* foo = reinterpret_cast<int*>(&Kernel::__cxxamp_trampoline);
-  void *kernel = NULL;
-  {
-      std::string transformed_kernel_name =
-          mcw_cxxamp_fixnames(f.__cxxamp_trampoline_name());
-      kernel = CLAMP::CreateKernel(transformed_kernel_name, pQueue.get());
-  }
+  void *kernel = CLAMP::CreateKernel(get_kernel_handle(f), pQueue.get());
   append_kernel(pQueue, f, kernel);
   pQueue->LaunchKernel(kernel, dim_ext, ext, local_size);
 #endif // __KALMAR_ACCELERATOR__
@@ -109,10 +130,7 @@ inline void* mcw_cxxamp_get_kernel(const std::shared_ptr<KalmarQueue>& pQueue, c
   //this triggers the trampoline code being emitted
   // FIXME: implicitly casting to avoid pointer to int error
   int* foo = reinterpret_cast<int*>(&Kernel::__cxxamp_trampoline);
-  void *kernel = NULL;
-  std::string transformed_kernel_name =
-      mcw_cxxamp_fixnames(f.__cxxamp_trampoline_name());
-  kernel = CLAMP::CreateKernel(transformed_kernel_name, pQueue.get());
+  void *kernel = CLAMP::CreateKernel(get_kernel_handle(f), pQueue.get());
   return kernel;
 #else
   return NULL;
@@ -120,6 +138,18 @@ inline void* mcw_cxxamp_get_kernel(const std::shared_ptr<KalmarQueue>& pQueue, c
 }
 #pragma clang diagnostic pop
 
+template<typename Kernel, int dim_ext>
+inline std::shared_ptr<KalmarLaunchTemplate>
+mcw_cxxamp_create_launch_template(
+  const std::shared_ptr<KalmarQueue>& pQueue, size_t *ext, size_t *local_size,
+  const Kernel& f, size_t dynamic_group_memory_size) restrict(cpu,amp) {
+#if __KALMAR_ACCELERATOR__ != 1
+  void *kernel = mcw_cxxamp_get_kernel<Kernel>(pQueue, f);
+  append_kernel(pQueue, f, kernel);
+  return pQueue->CreateLaunchTemplate(kernel, dim_ext, ext, local_size, dynamic_group_memory_size);
+#endif // __KALMAR_ACCELERATOR__
+}
+
 template<typename Kernel, int dim_ext>
 inline
 void mcw_cxxamp_execute_kernel_with_dynamic_group_memory(
@@ -135,10 +165,11 @@ template<typename Kernel, int dim_ext>
 inline std::shared_ptr<KalmarAsyncOp>
 mcw_cxxamp_execute_kernel_with_dynamic_group_memory_async(
   const std::shared_ptr<KalmarQueue>& pQueue, size_t *ext, size_t *local_size,
-  const Kernel& f, void *kernel, size_t dynamic_group_memory_size) restrict(cpu,amp) {
+  const Kernel& f, void *kernel, size_t dynamic_group_memory_size,
+  hcBarrierMode barrier = hcBarrierDefault) restrict(cpu,amp) {
 #if __KALMAR_ACCELERATOR__ != 1
   append_kernel(pQueue, f, kernel);
-  return pQueue->LaunchKernelWithDynamicGroupMemoryAsync(kernel, dim_ext, ext, local_size, dynamic_group_memory_size);
+  return pQueue->LaunchKernelWithDynamicGroupMemoryAsync(kernel, dim_ext, ext, local_size, dynamic_group_memory_size, barrier);
 #endif // __KALMAR_ACCELERATOR__
 }
 
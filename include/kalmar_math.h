@@ -7,6 +7,7 @@
 
 #pragma once
   #include <cmath>
+  #include "hc_defines.h"
 #if __KALMAR_ACCELERATOR__ == 1
   extern "C" float opencl_acos(float x) restrict(amp);
   extern "C" double opencl_acos_double(double x) restrict(amp);
@@ -204,6 +205,34 @@
   extern "C" float opencl_trunc(float x) restrict(amp);
   extern "C" double opencl_trunc_double(double x) restrict(amp);
 
+  /* The native instructions of the HSA backends, which fast_math is built on:
+     approximations with denormals flushed, and none of the range reduction of
+     the precise builtins. A backend without them falls back to the builtins. */
+#if defined(__hcc_backend__) && (__hcc_backend__ == HCC_BACKEND_AMDGPU || __hcc_backend__ == HCC_BACKEND_HSAIL)
+  extern "C" float __hsail_nrcp_f32(float x) restrict(amp);
+  extern "C" float __hsail_nrsqrt_f32(float x) restrict(amp);
+  extern "C" float __hsail_nsqrt_f32(float x) restrict(amp);
+  extern "C" float __hsail_nexp2_f32(float x) restrict(amp);
+  extern "C" float __hsail_nlog2_f32(float x) restrict(amp);
+
+  inline float kalmar_native_rcp(float x) restrict(amp) { return __hsail_nrcp_f32(x); }
+  inline float kalmar_native_rsqrt(float x) restrict(amp) { return __hsail_nrsqrt_f32(x); }
+  inline float kalmar_native_sqrt(float x) restrict(amp) { return __hsail_nsqrt_f32(x); }
+  inline float kalmar_native_exp2(float x) restrict(amp) { return __hsail_nexp2_f32(x); }
+  inline float kalmar_native_log2(float x) restrict(amp) { return __hsail_nlog2_f32(x); }
+#else
+  inline float kalmar_native_rcp(float x) restrict(amp) { return 1.0f / x; }
+  inline float kalmar_native_rsqrt(float x) restrict(amp) { return opencl_rsqrt(x); }
+  inline float kalmar_native_sqrt(float x) restrict(amp) { return opencl_sqrt(x); }
+  inline float kalmar_native_exp2(float x) restrict(amp) { return opencl_exp2(x); }
+  inline float kalmar_native_log2(float x) restrict(amp) { return opencl_log2(x); }
+#endif
+
+  /* log2(e), ln(2) and log10(2), exp and log are derived from exp2 and log2 */
+  #define KALMAR_LOG2E_F  (1.44269504f)
+  #define KALMAR_LN2_F    (0.693147181f)
+  #define KALMAR_LOG102_F (0.301029996f)
+
 
 #endif
 
@@ -339,7 +368,7 @@ namespace fast_math {
   inline float host_expf(float x) restrict(cpu) { return ::expf(x); }
   inline float expf(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_exp(x);
+      return kalmar_native_exp2(x * KALMAR_LOG2E_F);
     #else
       return host_expf(x);
     #endif
@@ -348,7 +377,7 @@ namespace fast_math {
   inline float host_exp(float x) restrict(cpu) { return ::expf(x); }
   inline float exp(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_exp(x);
+      return kalmar_native_exp2(x * KALMAR_LOG2E_F);
     #else
       return host_exp(x);
     #endif
@@ -357,7 +386,7 @@ namespace fast_math {
   inline float host_exp2f(float x) restrict(cpu) { return ::exp2f(x); }
   inline float exp2f(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_exp2(x);
+      return kalmar_native_exp2(x);
     #else
       return host_exp2f(x);
     #endif
@@ -366,7 +395,7 @@ namespace fast_math {
   inline float host_exp2(float x) restrict(cpu) { return ::exp2f(x); }
   inline float exp2(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_exp2(x);
+      return kalmar_native_exp2(x);
     #else
       return host_exp2(x);
     #endif
@@ -552,7 +581,7 @@ namespace fast_math {
   inline float host_logf(float x) restrict(cpu) { return ::logf(x); }
   inline float logf(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_log(x);
+      return kalmar_native_log2(x) * KALMAR_LN2_F;
     #else
       return host_logf(x);
     #endif
@@ -561,7 +590,7 @@ namespace fast_math {
   inline float host_log(float x) restrict(cpu) { return ::logf(x); }
   inline float log(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_log(x);
+      return kalmar_native_log2(x) * KALMAR_LN2_F;
     #else
       return host_log(x);
     #endif
@@ -570,7 +599,7 @@ namespace fast_math {
   inline float host_log10f(float x) restrict(cpu) { return ::log10f(x); }
   inline float log10f(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_log10(x);
+      return kalmar_native_log2(x) * KALMAR_LOG102_F;
     #else
       return host_log10f(x);
     #endif
@@ -579,7 +608,7 @@ namespace fast_math {
   inline float host_log10(float x) restrict(cpu) { return ::log10f(x); }
   inline float log10(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_log10(x);
+      return kalmar_native_log2(x) * KALMAR_LOG102_F;
     #else
       return host_log10(x);
     #endif
@@ -588,7 +617,7 @@ namespace fast_math {
   inline float host_log2f(float x) restrict(cpu) { return ::log2f(x); }
   inline float log2f(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_log2(x);
+      return kalmar_native_log2(x);
     #else
       return host_log2f(x);
     #endif
@@ -597,7 +626,7 @@ namespace fast_math {
   inline float host_log2(float x) restrict(cpu) { return ::log2f(x); }
   inline float log2(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_log2(x);
+      return kalmar_native_log2(x);
     #else
       return host_log2(x);
     #endif
@@ -660,7 +689,7 @@ namespace fast_math {
   inline float  host_rsqrtf(float x) restrict(cpu) { return 1.0f / (::sqrtf(x)); }
   inline float  rsqrtf(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_rsqrt(x);
+      return kalmar_native_rsqrt(x);
     #else
       return host_rsqrtf(x);
     #endif
@@ -669,12 +698,30 @@ namespace fast_math {
   inline float  host_rsqrt(float x) restrict(cpu) { return 1.0f / (::sqrtf(x)); }
   inline float  rsqrt(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_rsqrt(x);
+      return kalmar_native_rsqrt(x);
     #else
       return host_rsqrt(x);
     #endif
   }
 
+  inline float  host_rcpf(float x) restrict(cpu) { return 1.0f / x; }
+  inline float  rcpf(float x) restrict(amp, cpu) {
+    #if __KALMAR_ACCELERATOR__ == 1
+      return kalmar_native_rcp(x);
+    #else
+      return host_rcpf(x);
+    #endif
+  }
+
+  inline float  host_rcp(float x) restrict(cpu) { return 1.0f / x; }
+  inline float  rcp(float x) restrict(amp, cpu) {
+    #if __KALMAR_ACCELERATOR__ == 1
+      return kalmar_native_rcp(x);
+    #else
+      return host_rcp(x);
+    #endif
+  }
+
   inline int host_signbitf(float x) restrict(cpu) { return ::signbit(x); }
   inline int signbitf(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
@@ -750,7 +797,7 @@ namespace fast_math {
   inline float host_sqrtf(float x) restrict(cpu) { return ::sqrtf(x); }
   inline float sqrtf(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_sqrt(x);
+      return kalmar_native_sqrt(x);
     #else
       return host_sqrtf(x);
     #endif
@@ -759,7 +806,7 @@ namespace fast_math {
   inline float host_sqrt(float x) restrict(cpu) { return ::sqrtf(x); }
   inline float sqrt(float x) restrict(amp, cpu) {
     #if __KALMAR_ACCELERATOR__ == 1
-      return opencl_sqrt(x);
+      return kalmar_native_sqrt(x);
     #else
       return host_sqrt(x);
     #endif
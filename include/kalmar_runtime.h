@@ -1,8 +1,56 @@
 #pragma once
 
 #include "hc_defines.h"
+#include "hc_callbacks.h"
+#include "hc_stats.h"
 #include "kalmar_aligned_alloc.h"
 
+/// granularity, in bytes, of the tracking of out of date data in rw_info
+/// only the out of date chunks are copied when the data is synchronized
+#ifndef RW_INFO_CHUNK_SIZE
+#define RW_INFO_CHUNK_SIZE (64 * 1024)
+#endif
+
+/// number of devices whose data of a rw_info is kept inline in it, indexed
+/// by the ordinal of the device
+#ifndef RW_INFO_INLINE_DEVICES
+#define RW_INFO_INLINE_DEVICES (4)
+#endif
+
+/// number of accesses to a rw_info placed with hcMemoryPlacementAuto after
+/// which its data is moved to the memory of whoever made at least 3/4 of
+/// them, the host or the device
+#ifndef RW_INFO_MIGRATE_WINDOW
+#define RW_INFO_MIGRATE_WINDOW (16)
+#endif
+
+/// time, in milliseconds, after which the staging copy of an array on its
+/// associated accelerator is released if it hasn't been used, the data
+/// being valid on the host. Environment variable HCC_STAGE_IDLE_MS may be
+/// used to change it, 0 keeps staging copies
+#ifndef RW_INFO_STAGE_IDLE_MS
+#define RW_INFO_STAGE_IDLE_MS (1000)
+#endif
+
+/// number of devices whose kernels are kept in a KalmarKernelHandle, indexed
+/// by the ordinal of the device. Kernels of the other devices are looked up
+/// by name at each launch
+#ifndef KALMAR_KERNEL_HANDLE_DEVICES
+#define KALMAR_KERNEL_HANDLE_DEVICES (8)
+#endif
+
+/// share of a kernel split between a device and the CPU given to the device
+/// before the rates of the two are learned from earlier launches
+#ifndef KALMAR_SPLIT_INITIAL_SHARE
+#define KALMAR_SPLIT_INITIAL_SHARE (0.5)
+#endif
+
+/// smallest learned share of either the device or the CPU, so the rates of
+/// both keep being measured as they change
+#ifndef KALMAR_SPLIT_MIN_SHARE
+#define KALMAR_SPLIT_MIN_SHARE (0.02)
+#endif
+
 namespace Kalmar {
 namespace enums {
 
@@ -32,12 +80,50 @@ enum execute_order
 
 enum hcMemcpyKind {
     hcMemcpyHostToDevice = 0,
-    hcMemcpyDeviceToHost = 1
+    hcMemcpyDeviceToHost = 1,
+    hcMemcpyDeviceToDevice = 2
 };
 
 enum hcWaitMode {
     hcWaitModeBlocked = 0,
-    hcWaitModeActive = 1
+    hcWaitModeActive = 1,
+    // spin for a short while, then yield, then block
+    hcWaitModeAdaptive = 2
+};
+
+/// the barrier bit of the packet of a kernel launch
+/// hcBarrierDefault: set as the execute order of the queue requires
+/// hcBarrierNone: not set, the kernel may overlap the previous commands of an
+///                in-order queue, except the ones using the same buffers
+/// hcBarrierWait: set, the kernel waits for the previous commands of the queue
+enum hcBarrierMode {
+    hcBarrierDefault = 0,
+    hcBarrierNone = 1,
+    hcBarrierWait = 2
+};
+
+enum hcQueuePriority {
+    hcQueuePriorityLow = 0,
+    hcQueuePriorityNormal = 1,
+    hcQueuePriorityHigh = 2
+};
+
+enum hcMemoryAdvice {
+    hcMemoryAdviseReadMostly = 0,
+    hcMemoryAdvisePreferredLocation = 1
+};
+
+/// memory the device data of an array is allocated in
+/// hcMemoryPlacementDefault: as chosen for the device as a whole
+/// hcMemoryPlacementHost: fine-grained host memory, accessible to the host
+/// hcMemoryPlacementDevice: coarse-grained device memory
+/// hcMemoryPlacementAuto: moved between both according to the accesses made
+///                        to it, on devices whose memory the host can access
+enum hcMemoryPlacement {
+    hcMemoryPlacementDefault = 0,
+    hcMemoryPlacementHost = 1,
+    hcMemoryPlacementDevice = 2,
+    hcMemoryPlacementAuto = 3
 };
 
 enum hcAgentProfile {
@@ -57,7 +143,9 @@ using namespace Kalmar::enums;
 
 /// forward declaration
 class KalmarDevice;
+class KalmarQueue;
 struct rw_info;
+struct dev_info;
 
 /// KalmarAsyncOp
 ///
@@ -96,12 +184,401 @@ public:
    */
   virtual bool isReady() { return false; }
 
+  /**
+   * Get the queue the async operation is submitted to.
+   *
+   * @return The queue, or nullptr if the async operation is not submitted to
+   *         a queue.
+   */
+  virtual KalmarQueue* getQueue() { return nullptr; }
+
   /**
    * Set the wait mode of the async operation.
    *
    * @param mode[in] wait mode, must be one of the value in hcWaitMode enum.
    */
   virtual void setWaitMode(hcWaitMode mode) {}
+
+  /**
+   * Ask for a callback once the async operation completes. It's called on a
+   * thread of the runtime, which it must not block.
+   *
+   * @param callback[in] the callback, called once
+   * @return False if the async operation can't notify its completion, the
+   *         callback is not called in this case.
+   */
+  virtual bool notifyWhenReady(std::function<void()> callback) { return false; }
+
+  /**
+   * Block until the async operation has been completed, in the wait mode
+   * set by setWaitMode(). May be called more than once and from multiple
+   * threads.
+   */
+  virtual void blockingWait() {
+    std::shared_future<void>* future = getFuture();
+    if (future != nullptr && future->valid()) {
+      future->wait();
+    }
+  }
+};
+
+/// CPUAsyncOp
+///
+/// This is a kernel launch or a marker enqueued on a CPU queue, run
+/// asynchronously as a task on the CPU
+class CPUAsyncOp final : public KalmarAsyncOp {
+public:
+  CPUAsyncOp(KalmarQueue* queue, std::function<void()> func)
+      : queue(queue), task([this, func] {
+          begin = now();
+          func();
+          end = now();
+        }), future(task.get_future().share()), begin(0), end(0) {}
+
+  /// run the task on the calling thread, it's done when this returns
+  void run() { task(); }
+
+  std::shared_future<void>* getFuture() override { return &future; }
+
+  /// timestamps are in nanoseconds of the steady clock of the host
+  uint64_t getBeginTimestamp() override { return begin; }
+  uint64_t getEndTimestamp() override { return end; }
+  uint64_t getTimestampFrequency() override { return 1000000000L; }
+
+  bool isReady() override {
+    return future.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+  }
+
+  KalmarQueue* getQueue() override { return queue; }
+
+private:
+  static uint64_t now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+  KalmarQueue* queue;
+  std::packaged_task<void()> task;
+  std::shared_future<void> future;
+  uint64_t begin;
+  uint64_t end;
+};
+
+/// KalmarSplitOp
+///
+/// This is a kernel launch split between devices, which completes when the
+/// parts of it on all of them complete
+class KalmarSplitOp final : public KalmarAsyncOp {
+public:
+  explicit KalmarSplitOp(std::vector< std::shared_ptr<KalmarAsyncOp> > ops) : parts() {
+    for (auto& op : ops)
+      if (op)
+        parts.push_back(op);
+  }
+
+  bool isReady() override {
+    for (auto& part : parts)
+      if (!part->isReady())
+        return false;
+    return true;
+  }
+
+  KalmarQueue* getQueue() override { return parts.empty() ? nullptr : parts[0]->getQueue(); }
+
+  void setWaitMode(hcWaitMode mode) override {
+    for (auto& part : parts)
+      part->setWaitMode(mode);
+  }
+
+  void blockingWait() override {
+    for (auto& part : parts)
+      part->blockingWait();
+  }
+
+private:
+  std::vector< std::shared_ptr<KalmarAsyncOp> > parts;
+};
+
+/// KalmarSplitStats
+///
+/// This is the share of a kernel split between a device and the CPU given to
+/// the device, learned from the rates the parts of earlier launches of the
+/// kernel ran at on either side. It's kept as a static object per kernel
+class KalmarSplitStats {
+public:
+  KalmarSplitStats() : mutex(), share(KALMAR_SPLIT_INITIAL_SHARE), device(), deviceItems(0), cpu(), cpuItems(0) {}
+
+  /// get the share of the device for the next launch, learned from the last
+  /// launch if both of its parts are done
+  double next_share() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (device && cpu && device->isReady() && cpu->isReady()) {
+      double deviceRate = rate(device, deviceItems);
+      double cpuRate = rate(cpu, cpuItems);
+      if (deviceRate > 0.0 && cpuRate > 0.0) {
+        /// give each side the share it ran at, smoothed over launches
+        share = (share + deviceRate / (deviceRate + cpuRate)) / 2.0;
+        share = std::min(std::max(share, KALMAR_SPLIT_MIN_SHARE), 1.0 - KALMAR_SPLIT_MIN_SHARE);
+      }
+      device.reset();
+      cpu.reset();
+    }
+    return share;
+  }
+
+  /// note the parts of a launch, and the number of work-items of each
+  void record(std::shared_ptr<KalmarAsyncOp> deviceOp, size_t deviceCount,
+              std::shared_ptr<KalmarAsyncOp> cpuOp, size_t cpuCount) {
+    std::lock_guard<std::mutex> lock(mutex);
+    device = deviceOp;
+    deviceItems = deviceCount;
+    cpu = cpuOp;
+    cpuItems = cpuCount;
+  }
+
+private:
+  /// work-items per second of a part, 0 if it isn't known
+  static double rate(const std::shared_ptr<KalmarAsyncOp>& op, size_t items) {
+    uint64_t begin = op->getBeginTimestamp();
+    uint64_t end = op->getEndTimestamp();
+    uint64_t frequency = op->getTimestampFrequency();
+    if (items == 0 || frequency == 0 || end <= begin)
+      return 0.0;
+    return static_cast<double>(items) * frequency / (end - begin);
+  }
+
+  std::mutex mutex;
+  double share;
+  std::shared_ptr<KalmarAsyncOp> device;
+  size_t deviceItems;
+  std::shared_ptr<KalmarAsyncOp> cpu;
+  size_t cpuItems;
+};
+
+/// KalmarLaunchTemplate
+///
+/// This is an abstraction of a kernel launch captured once, which could be
+/// submitted many times with only the changed kernel arguments patched
+class KalmarLaunchTemplate {
+public:
+  virtual ~KalmarLaunchTemplate() {}
+
+  /// submit the captured kernel launch asynchronously, with the barrier bit
+  /// chosen by the barrier mode
+  virtual std::shared_ptr<KalmarAsyncOp> launch(hcBarrierMode barrier) { return nullptr; }
+
+  /// get the size of serialized kernel arguments in bytes
+  virtual size_t getArgSize() { return 0; }
+
+  /// overwrite serialized kernel arguments used by later launches
+  virtual void patchArgs(size_t offset, const void* src, size_t size) {}
+
+  /// write the AQL packet of the launch to the 64 bytes at @packet, for
+  /// kernels to enqueue it, with a copy of the current kernel arguments kept
+  /// in device-accessible memory as long as the template
+  /// returns false if kernels can't enqueue it
+  virtual bool exportPacket(void* packet) { return false; }
+};
+
+/// KalmarDeviceQueue
+///
+/// The memory of a command queue kernels write AQL packets into: the ring of
+/// packets, the indices of the packets written and read, and the doorbell
+/// which the packet processor is notified through
+struct KalmarDeviceQueue {
+  void* base;
+  uint32_t size;
+  uint64_t* writeIndex;
+  const uint64_t* readIndex;
+  uint64_t* doorbell;
+};
+
+/// KalmarGraph
+///
+/// This is an abstraction of a sequence of kernel launches and markers
+/// recorded on a KalmarQueue, which could be replayed many times
+class KalmarGraph {
+public:
+  virtual ~KalmarGraph() {}
+
+  /// replay the recorded sequence asynchronously
+  /// returns an async operation which completes when the whole sequence
+  /// completes, or nullptr if the graph is empty
+  virtual std::shared_ptr<KalmarAsyncOp> launch() { return nullptr; }
+
+  /// get number of recorded kernel launches and markers
+  virtual size_t getNodeCount() { return 0; }
+};
+
+/// KalmarKernelHandle
+///
+/// This is the kernel of a launch site, created once per kernel as a static
+/// object the first time the kernel is launched. It keeps the kernel of each
+/// device once resolved, so later launches don't look it up by name
+struct KalmarKernelHandle {
+  explicit KalmarKernelHandle(std::string name) : name(std::move(name)) {
+    for (auto& kernel : kernels) {
+      kernel.store(nullptr, std::memory_order_relaxed);
+    }
+  }
+
+  KalmarKernelHandle(const KalmarKernelHandle&) = delete;
+  KalmarKernelHandle& operator=(const KalmarKernelHandle&) = delete;
+
+  /// get the slot of the kernel of a device, nullptr if it isn't kept
+  std::atomic<void*>* get_slot(unsigned int ordinal) {
+    return ordinal < KALMAR_KERNEL_HANDLE_DEVICES ? &kernels[ordinal] : nullptr;
+  }
+
+  /// fixed name of the kernel
+  const std::string name;
+
+  /// kernel resolved by each device, indexed by the ordinal of the device
+  std::atomic<void*> kernels[KALMAR_KERNEL_HANDLE_DEVICES];
+};
+
+/// KalmarKernelResources
+///
+/// This is what a kernel takes on its device, as its code object reports it.
+/// Counts a device does not report are 0
+struct KalmarKernelResources {
+  /// bytes of the group segment of a workgroup, without the dynamic part
+  uint32_t groupSegmentSize;
+  /// bytes of the private segment of a work-item, which is where registers
+  /// spill to
+  uint32_t privateSegmentSize;
+  /// vector registers of a work-item and scalar registers of a wavefront
+  uint32_t vgprCount;
+  uint32_t sgprCount;
+  /// wavefronts a SIMD can hold with these registers
+  uint32_t wavesPerSIMD;
+};
+
+/// KalmarLaunchBounds
+///
+/// This is what the kernel was annotated with by hc_max_workgroup_dim and
+/// hc_waves_per_eu. Bounds a kernel is not annotated with are 0
+struct KalmarLaunchBounds {
+  /// largest extent of a workgroup in each dimension
+  uint32_t maxWorkgroupDim[3];
+  /// wavefronts an execution unit is to hold at least
+  uint32_t wavesPerEU;
+};
+
+/// KalmarQueueCounters
+///
+/// Counters of the commands of a queue, updated by the runtimes as they are
+/// submitted. They are relaxed atomics, cheap enough to be always kept
+struct KalmarQueueCounters {
+  std::atomic<uint64_t> dispatches;
+  std::atomic<uint64_t> bytesHostToDevice;
+  std::atomic<uint64_t> bytesDeviceToHost;
+  std::atomic<uint64_t> bytesDeviceToDevice;
+  std::atomic<uint64_t> kernargPoolMisses;
+  std::atomic<uint64_t> signalPoolMisses;
+  std::atomic<uint64_t> dependencyWaitNs;
+  std::atomic<uint64_t> syncCopies;
+  /// histogram of the host latency of kernel dispatches, bucket i counts
+  /// the dispatches of [2^i, 2^(i+1)) ns
+  std::atomic<uint64_t> dispatchLatency[HC_DISPATCH_LATENCY_BUCKETS];
+
+  KalmarQueueCounters()
+      : dispatches(0), bytesHostToDevice(0), bytesDeviceToHost(0), bytesDeviceToDevice(0),
+        kernargPoolMisses(0), signalPoolMisses(0), dependencyWaitNs(0), syncCopies(0) {
+    for (auto& bucket : dispatchLatency)
+      bucket.store(0, std::memory_order_relaxed);
+  }
+
+  static void add(std::atomic<uint64_t>& counter, uint64_t n = 1) {
+    counter.fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /// count the bytes of a copy of kind
+  void addCopy(hcMemcpyKind kind, uint64_t bytes) {
+    if (kind == hcMemcpyHostToDevice)
+      add(bytesHostToDevice, bytes);
+    else if (kind == hcMemcpyDeviceToHost)
+      add(bytesDeviceToHost, bytes);
+    else
+      add(bytesDeviceToDevice, bytes);
+  }
+
+  /// count a kernel dispatch which took ns on the host
+  void addDispatchLatency(uint64_t ns) {
+    int bucket = (ns > 1) ? 63 - __builtin_clzll(ns) : 0;
+    add(dispatchLatency[std::min(bucket, HC_DISPATCH_LATENCY_BUCKETS - 1)]);
+  }
+
+  /// add all the counters of @p other
+  void addAll(const KalmarQueueCounters& other) {
+    add(dispatches, other.dispatches.load(std::memory_order_relaxed));
+    add(bytesHostToDevice, other.bytesHostToDevice.load(std::memory_order_relaxed));
+    add(bytesDeviceToHost, other.bytesDeviceToHost.load(std::memory_order_relaxed));
+    add(bytesDeviceToDevice, other.bytesDeviceToDevice.load(std::memory_order_relaxed));
+    add(kernargPoolMisses, other.kernargPoolMisses.load(std::memory_order_relaxed));
+    add(signalPoolMisses, other.signalPoolMisses.load(std::memory_order_relaxed));
+    add(dependencyWaitNs, other.dependencyWaitNs.load(std::memory_order_relaxed));
+    add(syncCopies, other.syncCopies.load(std::memory_order_relaxed));
+    for (int i = 0; i < HC_DISPATCH_LATENCY_BUCKETS; ++i)
+      add(dispatchLatency[i], other.dispatchLatency[i].load(std::memory_order_relaxed));
+  }
+};
+
+/// KalmarMemoryTracker
+///
+/// Footprint of the buffers of a device created for arrays and array_views,
+/// per memory tag (see hc_set_memory_tag()), with the high watermark of each
+/// tag and of the device
+struct KalmarMemoryTracker {
+  struct usage {
+    uint64_t bytes;
+    uint64_t peakBytes;
+    uint64_t allocations;
+    uint64_t releases;
+  };
+
+  std::mutex mutex;
+  /// usage of each tag, the nodes of the map stay where they are, so the
+  /// tag strings and the usages can be pointed to
+  std::map<std::string, usage> tags;
+  usage total;
+  /// live buffers, with their size and the usage they are accounted to
+  std::map<void*, std::pair<usage*, size_t> > buffers;
+
+  KalmarMemoryTracker() : mutex(), tags(), total(), buffers() {}
+
+  static void grow(usage& u, size_t bytes) {
+    u.bytes += bytes;
+    u.peakBytes = std::max(u.peakBytes, u.bytes);
+    ++u.allocations;
+  }
+
+  static void shrink(usage& u, size_t bytes) {
+    u.bytes -= bytes;
+    ++u.releases;
+  }
+
+  void add(void* ptr, size_t bytes, const char* tag) {
+    if (ptr == nullptr)
+      return;
+    std::lock_guard<std::mutex> lock(mutex);
+    usage& u = tags[tag];
+    grow(u, bytes);
+    grow(total, bytes);
+    buffers[ptr] = std::make_pair(&u, bytes);
+  }
+
+  /// buffers which weren't added, such as the ones given by users, are
+  /// ignored
+  void remove(void* ptr) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = buffers.find(ptr);
+    if (it == buffers.end())
+      return;
+    shrink(*it->second.first, it->second.second);
+    shrink(total, it->second.second);
+    buffers.erase(it);
+  }
 };
 
 /// KalmarQueue
@@ -112,9 +589,11 @@ class KalmarQueue
 public:
 
   KalmarQueue(KalmarDevice* pDev, queuing_mode mode = queuing_mode_automatic, execute_order order = execute_in_order)
-      : pDev(pDev), mode(mode), order(order) {}
+      : pDev(pDev), mode(mode), order(order), waitMode(hcWaitModeBlocked) {}
 
-  virtual ~KalmarQueue() {}
+  /// the counters of the queue are added to the ones of the queues of its
+  /// device which were destroyed
+  virtual ~KalmarQueue();
 
   virtual void flush() {}
   virtual void wait(hcWaitMode mode = hcWaitModeBlocked) {}
@@ -123,13 +602,24 @@ public:
   virtual void LaunchKernelWithDynamicGroupMemory(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size, size_t dynamic_group_size) {}
 
   // async kernel launch with dynamic group memory
-  virtual std::shared_ptr<KalmarAsyncOp> LaunchKernelWithDynamicGroupMemoryAsync(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size, size_t dynamic_group_size) { return nullptr; }
+  // the barrier mode chooses whether the kernel waits for previous commands
+  virtual std::shared_ptr<KalmarAsyncOp> LaunchKernelWithDynamicGroupMemoryAsync(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size, size_t dynamic_group_size, hcBarrierMode barrier) { return nullptr; }
+
+  // capture a kernel launch into a launch template
+  // the template takes the ownership of the kernel object
+  virtual std::shared_ptr<KalmarLaunchTemplate> CreateLaunchTemplate(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size, size_t dynamic_group_size) { return nullptr; }
+
+  /// launch @kernel with the grid size which a launch of @launcher right
+  /// before it writes into its AQL packet, the first argument of @launcher,
+  /// a pointer, being set to the packet
+  /// returns nullptr if the queue can't, the caller launches it itself
+  virtual std::shared_ptr<KalmarAsyncOp> LaunchIndirect(KalmarLaunchTemplate* launcher, KalmarLaunchTemplate* kernel) { return nullptr; }
 
   // sync kernel launch
   virtual void LaunchKernel(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size) {}
 
   // async kernel launch
-  virtual std::shared_ptr<KalmarAsyncOp> LaunchKernelAsync(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size) { return LaunchKernelWithDynamicGroupMemoryAsync(kernel, dim_ext, ext, local_size, 0); }
+  virtual std::shared_ptr<KalmarAsyncOp> LaunchKernelAsync(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size) { return LaunchKernelWithDynamicGroupMemoryAsync(kernel, dim_ext, ext, local_size, 0, hcBarrierDefault); }
 
   /// read data from device to host
   virtual void read(void* device, void* dst, size_t count, size_t offset) = 0;
@@ -140,14 +630,53 @@ public:
   /// copy data between two device pointers
   virtual void copy(void* src, void* dst, size_t count, size_t src_offset, size_t dst_offset, bool blocking) = 0;
 
+  /// copy data from a device pointer of another device @p srcDev to a device
+  /// pointer of this queue's device
+  virtual void copy_peer(void* src, KalmarDevice* srcDev, void* dst, size_t count,
+                         size_t src_offset, size_t dst_offset, bool blocking) {
+      copy(src, dst, count, src_offset, dst_offset, blocking);
+  }
+
+  /// copy data asynchronously, after previous asynchronous operations on the
+  /// source and destination buffers, whose dependency slots are srcDev and
+  /// dstDev (either may be null)
+  /// returns nullptr if the queue can't copy asynchronously, nothing is
+  /// copied in this case
+  virtual std::shared_ptr<KalmarAsyncOp> EnqueueAsyncCopy(const void* src, void* dst, size_t count, hcMemcpyKind kind,
+                                                          struct dev_info* srcDev, struct dev_info* dstDev) { return nullptr; }
+
+  /// copy data asynchronously in the order of this queue: after the async
+  /// operations enqueued so far, and before the ones enqueued later
+  /// returns nullptr if the queue can't copy asynchronously, nothing is
+  /// copied in this case
+  virtual std::shared_ptr<KalmarAsyncOp> EnqueueOrderedCopy(const void* src, void* dst, size_t count, hcMemcpyKind kind) { return nullptr; }
+
+  /// write the host buffer @src to the device pointer @dst asynchronously,
+  /// after previous asynchronous operations on the destination buffer, whose
+  /// dependency slot is dstDev; the copy holds @src until it completes, so
+  /// the caller may drop it at once
+  /// returns nullptr if the queue can't copy asynchronously, nothing is
+  /// copied in this case
+  virtual std::shared_ptr<KalmarAsyncOp> EnqueueAsyncWrite(std::shared_ptr<const void> src, void* dst, size_t count,
+                                                           struct dev_info* dstDev) { return nullptr; }
+
   /// map host accessible pointer from device
   virtual void* map(void* device, size_t count, size_t offset, bool modify) = 0;
 
   /// unmap host accessible pointer
   virtual void unmap(void* device, void* addr, size_t count, size_t offset, bool modify) = 0;
 
+  /// map host accessible pointer from device, for the host to overwrite all
+  /// of it without reading it, so its current content isn't needed
+  virtual void* map_for_write(void* device, size_t count, size_t offset) { return map(device, count, offset, true); }
+
+  /// unmap host accessible pointer mapped by map_for_write
+  virtual void unmap_for_write(void* device, void* addr, size_t count, size_t offset) { unmap(device, addr, count, offset, true); }
+
   /// push device pointer to kernel argument list
-  virtual void Push(void *kernel, int idx, void* device, bool modify) = 0;
+  /// @dev: the data on the device of this queue, which holds the dependency
+  /// slots of the buffer
+  virtual void Push(void *kernel, int idx, void* device, bool modify, struct dev_info* dev) = 0;
 
   virtual uint32_t GetGroupSegmentSize(void *kernel) { return 0; }
 
@@ -157,12 +686,21 @@ public:
 
   execute_order get_execute_order() const { return order; }
 
+  /// wait mode of async operations submitted to this queue, unless set
+  /// otherwise for an individual async operation
+  hcWaitMode get_wait_mode() const { return waitMode; }
+  void set_wait_mode(hcWaitMode mode) { waitMode = mode; }
+
   /// get number of pending async operations in the queue
   virtual int getPendingAsyncOps() { return 0; }
 
   /// get underlying native queue handle
   virtual void* getHSAQueue() { return nullptr; }
 
+  /// get the memory kernels enqueue packets into this queue through
+  /// returns false if kernels can't enqueue packets into it
+  virtual bool getDeviceQueue(KalmarDeviceQueue& deviceQueue) { return false; }
+
   /// get underlying native agent handle
   virtual void* getHSAAgent() { return nullptr; }
 
@@ -180,6 +718,39 @@ public:
   /// enqueue marker
   virtual std::shared_ptr<KalmarAsyncOp> EnqueueMarker() { return nullptr; }
 
+  /// enqueue a marker which completes once the async operations enqueued so
+  /// far and @dependencies, which may be on other queues, are complete
+  /// the queue waits for the dependencies on the host if it can't on the
+  /// device
+  virtual std::shared_ptr<KalmarAsyncOp> EnqueueMarkerWithDependencies(const std::vector< std::shared_ptr<KalmarAsyncOp> >& dependencies) {
+    for (auto& dependency : dependencies)
+      dependency->blockingWait();
+    return EnqueueMarker();
+  }
+
+  /// enqueue a task of the CPU path, run asynchronously after the tasks
+  /// enqueued before it
+  /// returns false if the queue can't run tasks, nothing is enqueued in
+  /// this case
+  virtual bool EnqueueTask(const std::shared_ptr<CPUAsyncOp>& op) { return false; }
+
+  /// begin a batch of asynchronous kernel launches
+  /// launches in the batch are submitted to the device at endBatch()
+  virtual void beginBatch() {}
+
+  /// end a batch of asynchronous kernel launches
+  /// returns an async operation which completes when all launches in the
+  /// batch complete, or nullptr if there is no open batch
+  virtual std::shared_ptr<KalmarAsyncOp> endBatch() { return nullptr; }
+
+  /// begin recording kernel launches and markers into a graph
+  /// they are recorded instead of being submitted until endCapture()
+  virtual void beginCapture() {}
+
+  /// end recording and return the recorded graph, or nullptr if the queue
+  /// is not recording
+  virtual std::shared_ptr<KalmarGraph> endCapture() { return nullptr; }
+
   /// cleanup internal resource
   /// this function is usually called by dtor of the implementation classes
   /// in rare occasions it may be called by other functions to ensure proper
@@ -191,10 +762,43 @@ public:
   /// is called.
   virtual bool set_cu_mask(const std::vector<bool>& cu_mask) { return false; };
 
+  /// get the scheduling priority of this queue
+  virtual hcQueuePriority get_priority() { return hcQueuePriorityNormal; }
+
+  /// release the scratch memory the command queues grew for kernels using
+  /// more private segment than the queue was sized for, by recreating them
+  /// once the queue is idle; returns false if it's not supported, or a
+  /// batch or a capture is open
+  virtual bool releaseScratch() { return false; }
+
+  /// profile the kernel dispatches of this queue: none of them if period is
+  /// 0, all of them if it's 1, one in period of them otherwise
+  virtual void setProfilingPeriod(uint32_t period) {}
+  virtual uint32_t getProfilingPeriod() { return 0; }
+
+  /// profile the next kernel dispatch of this queue, whatever the period
+  virtual void profileNextDispatch() {}
+
+  /// counters of the commands of this queue
+  KalmarQueueCounters& getCounters() { return counters; }
+
+  /// take a snapshot of the counters of this queue, and of its device
+  void getStats(hc_queue_stats* stats);
+
 private:
   KalmarDevice* pDev;
   queuing_mode mode;
   execute_order order;
+  hcWaitMode waitMode;
+  KalmarQueueCounters counters;
+};
+
+/// kind of a KalmarDevice, kept by the device so the runtime tells the host
+/// apart from the accelerators without comparing their paths
+enum KalmarDeviceKind
+{
+    KalmarDeviceCPU,
+    KalmarDeviceAccelerator
 };
 
 /// KalmarDevice
@@ -205,6 +809,11 @@ class KalmarDevice
 private:
     access_type cpu_type;
 
+    KalmarDeviceKind kind;
+
+    /// index of the device in its KalmarContext
+    unsigned int ordinal;
+
 #if !TLS_QUEUE
     /// default KalmarQueue
     std::shared_ptr<KalmarQueue> def;
@@ -217,9 +826,15 @@ private:
     std::mutex tlsDefaultQueueMap_mutex;
 #endif
 
+    /// footprint of the buffers allocated with allocate()
+    KalmarMemoryTracker memoryTracker;
+
+    /// sum of the counters of the queues of the device which were destroyed
+    KalmarQueueCounters retiredCounters;
+
 protected:
-    KalmarDevice(access_type type = access_type_read_write)
-        : cpu_type(type),
+    KalmarDevice(access_type type = access_type_read_write, KalmarDeviceKind kind = KalmarDeviceAccelerator)
+        : cpu_type(type), kind(kind), ordinal(-1),
 #if !TLS_QUEUE
           def(), flag()
 #else
@@ -230,6 +845,12 @@ public:
     access_type get_access() const { return cpu_type; }
     void set_access(access_type type) { cpu_type = type; }
 
+    KalmarDeviceKind get_kind() const { return kind; }
+    bool is_cpu() const { return kind == KalmarDeviceCPU; }
+
+    unsigned int get_ordinal() const { return ordinal; }
+    void set_ordinal(unsigned int index) { ordinal = index; }
+
     virtual std::wstring get_path() const = 0;
     virtual std::wstring get_description() const = 0;
     virtual size_t get_mem() const = 0;
@@ -248,12 +869,60 @@ public:
     /// @key: used to avoid duplicate release
     virtual void release(void* ptr, struct rw_info* key) = 0;
 
+    /// create buffer for @key, accounted to the memory tag of the calling
+    /// thread, or by default to "array" if @key is an array of the device,
+    /// "staging" if it's an array of another device, and "array_view"
+    /// otherwise
+    inline void* allocate(size_t count, struct rw_info* key);
+
+    /// release buffer created by allocate()
+    void deallocate(void* ptr, struct rw_info* key) {
+        memoryTracker.remove(ptr);
+        release(ptr, key);
+    }
+
+    KalmarMemoryTracker& getMemoryTracker() { return memoryTracker; }
+
+    const KalmarQueueCounters& getRetiredCounters() const { return retiredCounters; }
+    void retireCounters(const KalmarQueueCounters& counters) { retiredCounters.addAll(counters); }
+
+    /// whether the host can access a buffer created on the device directly
+    virtual bool is_host_accessible(void* ptr) const { return is_unified(); }
+
+    /// makes the host memory @ptr of @count bytes accessible to kernels in
+    /// place, returns the address they access it at, or nullptr if the device
+    /// can only copy it
+    virtual void* map_host(void* ptr, size_t count) { return is_unified() ? ptr : nullptr; }
+
+    /// releases the host memory mapped by map_host()
+    virtual void unmap_host(void* ptr) {}
+
+    /// whether buffers can be moved between host and device memory by
+    /// hcMemoryPlacementAuto, both being accessible to the host
+    virtual bool supports_migration() const { return false; }
+
     /// build program
     virtual void BuildProgram(void* size, void* source, bool needsCompilation = true) {}
 
     /// create kernel
     virtual void* CreateKernel(const char* fun, void* size, void* source, bool needsCompilation = true) { return nullptr; }
 
+    /// resolve a kernel once, returns the object kept by a KalmarKernelHandle
+    /// and passed to CreateDispatch at each launch, which lives as long as the
+    /// device. Returns nullptr if kernels are only created with CreateKernel
+    virtual void* ResolveKernel(const char* fun, void* size, void* source, bool needsCompilation = true) { return nullptr; }
+
+    /// create the kernel of a launch from a kernel returned by ResolveKernel
+    virtual void* CreateDispatch(void* kernel) { return nullptr; }
+
+    /// get the resources of a kernel returned by ResolveKernel, returns false
+    /// if the device does not report them
+    virtual bool GetKernelResources(void* kernel, KalmarKernelResources& resources) { return false; }
+
+    /// set the launch bounds of a kernel returned by ResolveKernel, which
+    /// launches of it are checked against; only the first bounds set are kept
+    virtual void SetKernelLaunchBounds(void* kernel, const KalmarLaunchBounds& bounds) {}
+
     /// check if a given kernel is compatible with the device
     virtual bool IsCompatibleKernel(void* size, void* source) { return true; }
 
@@ -262,6 +931,35 @@ public:
 
     /// create KalmarQueue from current device
     virtual std::shared_ptr<KalmarQueue> createQueue(execute_order order = execute_in_order) = 0;
+
+    /// create KalmarQueue from current device with a scheduling priority and
+    /// a CU mask set before any command is submitted to it
+    /// an empty cu_mask leaves all CUs in use
+    virtual std::shared_ptr<KalmarQueue> createQueue(execute_order order, hcQueuePriority priority,
+                                                     const std::vector<bool>& cu_mask) {
+        std::shared_ptr<KalmarQueue> q = createQueue(order);
+        if (!cu_mask.empty()) {
+            q->set_cu_mask(cu_mask);
+        }
+        return q;
+    }
+
+    /// create KalmarQueue from current device, whose command queues are sized
+    /// for kernels using up to privateSegmentSize bytes of private segment per
+    /// work-item and groupSegmentSize bytes of group segment per work-group,
+    /// so their scratch memory is allocated along with them
+    /// UINT32_MAX leaves the size to the runtime, which grows the scratch
+    /// memory of the command queues on demand
+    virtual std::shared_ptr<KalmarQueue> createQueue(execute_order order, uint32_t privateSegmentSize,
+                                                     uint32_t groupSegmentSize) {
+        return createQueue(order);
+    }
+
+    /// get the largest private and group segment sizes of the kernels
+    /// created on the device so far, 0 if the device does not report them
+    virtual uint32_t GetMaxPrivateSegmentSize() { return 0; }
+    virtual uint32_t GetMaxGroupSegmentSize() { return 0; }
+
     virtual ~KalmarDevice() {}
 
     std::shared_ptr<KalmarQueue> get_default_queue() {
@@ -303,16 +1001,89 @@ public:
     /// check if @p other can access to this device's device memory, return true if so, false otherwise
     virtual bool is_peer(const KalmarDevice* other) {return false;}
 
+    /// get the distance of the links @p other accesses this device's device
+    /// memory through, UINT32_MAX if it can't access it
+    virtual uint32_t get_peer_distance(const KalmarDevice* other) { return UINT32_MAX; }
+
     /// get device's compute unit count
     virtual unsigned int get_compute_unit_count() {return 0;}
 
+    /// get the number of work-items in a wavefront of the device, 0 if it
+    /// doesn't run wavefronts
+    virtual unsigned int get_wavefront_size() {return 0;}
+
+    /// get bandwidth achieved by pageable host memory transfers streamed
+    /// through staging buffers in direction @p kind, in bytes per second
+    virtual double getTransferBandwidth(hcMemcpyKind kind) { return 0.0; }
+
+    /// give free memory kept by the device memory cache back to the
+    /// platform, return the number of bytes released
+    virtual size_t trimMemoryCache() { return 0; }
+
+    /// get number of allocations served from the device memory cache, and
+    /// number of allocations made by the platform allocator while it's used
+    virtual uint64_t getMemoryCacheHits() { return 0L; }
+    virtual uint64_t getMemoryCacheMisses() { return 0L; }
+
+    /// get number of bytes of free memory kept by the device memory cache
+    virtual size_t getMemoryCacheSize() { return 0; }
+
+    /// get number of code objects built for the device
+    virtual uint64_t getCodeObjectBuilds() { return 0L; }
+
 };
 
-class CPUQueue final : public KalmarQueue
+inline KalmarQueue::~KalmarQueue() {
+  if (pDev)
+    pDev->retireCounters(counters);
+}
+
+inline void KalmarQueue::getStats(hc_queue_stats* stats) {
+  memset(stats, 0, sizeof(hc_queue_stats));
+  stats->device = pDev->get_ordinal();
+  stats->dispatches = counters.dispatches.load(std::memory_order_relaxed);
+  stats->bytes_host_to_device = counters.bytesHostToDevice.load(std::memory_order_relaxed);
+  stats->bytes_device_to_host = counters.bytesDeviceToHost.load(std::memory_order_relaxed);
+  stats->bytes_device_to_device = counters.bytesDeviceToDevice.load(std::memory_order_relaxed);
+  stats->kernarg_pool_misses = counters.kernargPoolMisses.load(std::memory_order_relaxed);
+  stats->signal_pool_misses = counters.signalPoolMisses.load(std::memory_order_relaxed);
+  stats->dependency_wait_ns = counters.dependencyWaitNs.load(std::memory_order_relaxed);
+  stats->sync_copies = counters.syncCopies.load(std::memory_order_relaxed);
+  stats->code_object_builds = pDev->getCodeObjectBuilds();
+  for (int i = 0; i < HC_DISPATCH_LATENCY_BUCKETS; ++i)
+    stats->dispatch_latency[i] = counters.dispatchLatency[i].load(std::memory_order_relaxed);
+}
+
+/// CPUTaskQueue
+/// This is the base of the queues of CPU devices, which run kernels and
+/// markers asynchronously as tasks. The tasks of all of them run one at a
+/// time in the order they are enqueued, so a queue executing in order and
+/// one executing in any order alike see the tasks before them done
+class CPUTaskQueue : public KalmarQueue
+{
+public:
+
+  CPUTaskQueue(KalmarDevice* pDev, execute_order order)
+      : KalmarQueue(pDev, queuing_mode_automatic, order), mutex(), last(nullptr) {}
+
+  void wait(hcWaitMode mode = hcWaitModeBlocked) override;
+
+  bool EnqueueTask(const std::shared_ptr<CPUAsyncOp>& op) override;
+
+  std::shared_ptr<KalmarAsyncOp> EnqueueMarker() override;
+
+private:
+  /// guards last
+  std::mutex mutex;
+  /// the task enqueued last
+  std::shared_ptr<CPUAsyncOp> last;
+};
+
+class CPUQueue final : public CPUTaskQueue
 {
 public:
 
-  CPUQueue(KalmarDevice* pDev) : KalmarQueue(pDev) {}
+  CPUQueue(KalmarDevice* pDev, execute_order order = execute_in_order) : CPUTaskQueue(pDev, order) {}
 
   void read(void* device, void* dst, size_t count, size_t offset) override {
       if (dst != device)
@@ -335,13 +1106,15 @@ public:
 
   void unmap(void* device, void* addr, size_t count, size_t offset, bool modify) override {}
 
-  void Push(void *kernel, int idx, void* device, bool modify) override {}
+  void Push(void *kernel, int idx, void* device, bool modify, struct dev_info* dev) override {}
 };
 
 /// cpu accelerator
 class CPUDevice final : public KalmarDevice
 {
 public:
+    CPUDevice() : KalmarDevice(access_type_read_write, KalmarDeviceCPU) {}
+
     std::wstring get_path() const override { return L"cpu"; }
     std::wstring get_description() const override { return L"CPU Device"; }
     size_t get_mem() const override { return 0; }
@@ -351,12 +1124,23 @@ public:
     bool is_emulated() const override { return true; }
     uint32_t get_version() const override { return 0; }
 
-    std::shared_ptr<KalmarQueue> createQueue(execute_order order = execute_in_order) override { return std::shared_ptr<KalmarQueue>(new CPUQueue(this)); }
-    void* create(size_t count, struct rw_info* /* not used */ ) override { return kalmar_aligned_alloc(0x1000, count); }
-    void release(void* ptr, struct rw_info* /* nout used */) override { kalmar_aligned_free(ptr); }
+    std::shared_ptr<KalmarQueue> createQueue(execute_order order = execute_in_order) override { return std::shared_ptr<KalmarQueue>(new CPUQueue(this, order)); }
+    void* create(size_t count, struct rw_info* /* not used */ ) override { return kalmar_host_alloc(count); }
+    void release(void* ptr, struct rw_info* key) override;
     void* CreateKernel(const char* fun, void* size, void* source, bool needsCompilation = true) { return nullptr; }
 };
 
+/// callbacks of an external profiler, see hc_callbacks.h
+struct KalmarCallbacks
+{
+    hc_dispatch_callback_t dispatchBegin;
+    hc_dispatch_callback_t dispatchEnd;
+    void* dispatchData;
+    hc_copy_callback_t copyBegin;
+    hc_copy_callback_t copyEnd;
+    void* copyData;
+};
+
 /// KalmarContext
 /// This is responsible for managing all devices
 /// User will need to add their customize devices
@@ -367,6 +1151,7 @@ private:
     //We might be able to assume that only the first device is CPU, or we only mimic one cpu
     //device when constructing KalmarContext.
     KalmarDevice* get_default_dev() {
+        discover_devices();
         if (!def) {
             if (Devices.size() <= 1) {
                 fprintf(stderr, "There is no device can be used to do the computation\n");
@@ -380,14 +1165,40 @@ protected:
     /// default device
     KalmarDevice* def;
     std::vector<KalmarDevice*> Devices;
-    KalmarContext() : def(nullptr), Devices() { Devices.push_back(new CPUDevice); }
+    /// guards the discovery of devices
+    std::once_flag devicesFlag;
+    /// callbacks registered by an external profiler, null if there is none
+    /// so dispatches and copies only test a pointer
+    std::atomic<const KalmarCallbacks*> callbacks;
+    std::mutex callbacksMutex;
+    std::atomic<uint64_t> correlationId;
+    KalmarContext() : def(nullptr), Devices(), devicesFlag(), callbacks(nullptr),
+                      callbacksMutex(), correlationId(0) { add_device(new CPUDevice); }
+
+    /// add a device, its ordinal is its index in Devices
+    void add_device(KalmarDevice* dev) {
+        dev->set_ordinal(Devices.size());
+        Devices.push_back(dev);
+    }
+
+    /// add the devices of the platform to Devices, called on first use of
+    /// any device so processes which never use one don't pay for it
+    virtual void init_devices() {}
+
+    void discover_devices() {
+        std::call_once(devicesFlag, [this] { init_devices(); });
+    }
 public:
     virtual ~KalmarContext() {}
 
-    std::vector<KalmarDevice*> getDevices() { return Devices; }
+    std::vector<KalmarDevice*> getDevices() {
+        discover_devices();
+        return Devices;
+    }
 
     /// set default device by path
     bool set_default(const std::wstring& path) {
+        discover_devices();
         auto result = std::find_if(std::begin(Devices), std::end(Devices),
                                    [&] (const KalmarDevice* pDev)
                                    { return pDev->get_path() == path; });
@@ -408,6 +1219,7 @@ public:
     KalmarDevice* getDevice(std::wstring path = L"") {
         if (path == L"default" || path == L"")
             return get_default_dev();
+        discover_devices();
         auto result = std::find_if(std::begin(Devices), std::end(Devices),
                                    [&] (const KalmarDevice* dev)
                                    { return dev->get_path() == path; });
@@ -422,6 +1234,60 @@ public:
 
     /// get tick frequency
     virtual uint64_t getSystemTickFrequency() { return 0L; };
+
+    /// get number of completion signals served from the signal pool
+    virtual uint64_t getSignalPoolHits() { return 0L; };
+
+    /// get number of times the signal pool had to grow
+    virtual uint64_t getSignalPoolMisses() { return 0L; };
+
+    /// get number of waits on async operations which completed while
+    /// spinning, while yielding, and while blocked
+    virtual uint64_t getWaitSpinCount() { return 0L; };
+    virtual uint64_t getWaitYieldCount() { return 0L; };
+    virtual uint64_t getWaitBlockCount() { return 0L; };
+
+    /// get the callbacks of an external profiler, or null
+    const KalmarCallbacks* getCallbacks() const {
+        return callbacks.load(std::memory_order_acquire);
+    }
+
+    /// register the dispatch or the copy callbacks, keeping the others. The
+    /// callbacks are replaced, not modified, and the ones replaced are
+    /// leaked as a thread dispatching may still be calling them
+    void setDispatchCallbacks(hc_dispatch_callback_t begin, hc_dispatch_callback_t end, void* data) {
+        std::lock_guard<std::mutex> lock(callbacksMutex);
+        KalmarCallbacks next = current_callbacks();
+        next.dispatchBegin = begin;
+        next.dispatchEnd = end;
+        next.dispatchData = data;
+        publish_callbacks(next);
+    }
+
+    void setCopyCallbacks(hc_copy_callback_t begin, hc_copy_callback_t end, void* data) {
+        std::lock_guard<std::mutex> lock(callbacksMutex);
+        KalmarCallbacks next = current_callbacks();
+        next.copyBegin = begin;
+        next.copyEnd = end;
+        next.copyData = data;
+        publish_callbacks(next);
+    }
+
+    /// get the id correlating the callbacks of a dispatch or copy
+    uint64_t nextCorrelationId() {
+        return correlationId.fetch_add(1, std::memory_order_relaxed) + 1;
+    }
+
+private:
+    KalmarCallbacks current_callbacks() const {
+        const KalmarCallbacks* cb = getCallbacks();
+        return cb ? *cb : KalmarCallbacks{nullptr, nullptr, nullptr, nullptr, nullptr, nullptr};
+    }
+
+    void publish_callbacks(const KalmarCallbacks& next) {
+        bool none = !next.dispatchBegin && !next.dispatchEnd && !next.copyBegin && !next.copyEnd;
+        callbacks.store(none ? nullptr : new KalmarCallbacks(next), std::memory_order_release);
+    }
 };
 
 KalmarContext *getContext();
@@ -433,13 +1299,70 @@ extern bool is_cpu();
 extern bool in_cpu_kernel();
 extern void enter_kernel();
 extern void leave_kernel();
+
+/// run tasks [0, count) of a CPU kernel on the persistent CPU thread pool,
+/// task is called with data and ranges of the tasks, and all of them are
+/// done when it returns
+extern void RunCPUTasks(size_t count, void (*task)(void*, size_t, size_t), void* data);
 #endif
 
+/// the number of threads the tasks of a CPU kernel are run on
+extern unsigned int GetCPUThreadCount();
+
+/// limit the threads the tasks of CPU kernels are run on to @count, at most
+/// the threads of the CPU thread pool, 0 for all of them
+extern void SetCPUThreadCount(unsigned int count);
+
+/// enqueue a task of a CPU queue, tasks of all CPU queues are run one at a
+/// time in the order they are enqueued
+extern void EnqueueCPUTask(const std::shared_ptr<CPUAsyncOp>& op);
+
+/// run @func on the pool of threads running completion callbacks once @op
+/// completes, see hc::completion_future::then
+extern void RunWhenReady(const std::shared_ptr<KalmarAsyncOp>& op, std::function<void()> func);
+
+/// run @func on the pool of threads running completion callbacks once
+/// @ready returns true, it's polled by a monitor thread
+extern void RunWhen(std::function<bool()> ready, std::function<void()> func);
+
 extern void *CreateKernel(std::string, KalmarQueue*);
+extern void *CreateKernel(KalmarKernelHandle&, KalmarQueue*);
+
+/// properties of a kernel the device compiler embeds next to the kernels
+struct KernelProperties {
+  /// whether the kernel was found in the embedded properties; if not, it is
+  /// taken to have barriers and to use the group segment
+  bool known;
+  /// whether the kernel calls tile barriers, all of them tile uniform
+  bool hasBarriers;
+  /// whether the kernel uses tile_static variables or the group segment
+  bool usesGroupSegment;
+  /// the launch bounds of the kernel
+  KalmarLaunchBounds launchBounds;
+  /// bit i is set if the kernel only reads memory through its argument i,
+  /// for the first 64 arguments
+  uint64_t readOnlyArgs;
+};
+
+/// get the embedded properties of the kernel of a fixed name
+extern KernelProperties GetKernelProperties(const std::string& name);
+
+/// get the resources the kernel of a handle takes on the device of pQueue,
+/// resolving the kernel if it isn't yet. Returns false if they are unknown
+extern bool GetKernelResources(KalmarKernelHandle&, KalmarQueue*, KalmarKernelResources&);
+
+/// build the programs of the embedded kernels for the device of pQueue on a
+/// background thread, once for each device, later calls share the build
+extern std::shared_future<void> BuildProgramAsync(const std::shared_ptr<KalmarQueue>& pQueue);
 
 extern void PushArg(void *, int, size_t, const void *);
 extern void PushArgPtr(void *, int, size_t, const void *);
 
+/// whether the runtime takes many kernel arguments at once
+extern bool HasPushArgs();
+/// push size bytes of kernel arguments staged by KernelArgStaging
+extern void PushArgs(void *, size_t, const void *);
+
 } // namespace CLAMP
 
 static inline const std::shared_ptr<KalmarQueue> get_cpu_queue() {
@@ -448,7 +1371,7 @@ static inline const std::shared_ptr<KalmarQueue> get_cpu_queue() {
 }
 
 static inline bool is_cpu_queue(const std::shared_ptr<KalmarQueue>& Queue) {
-    return Queue->getDev()->get_path() == L"cpu";
+    return Queue->getDev()->is_cpu();
 }
 
 static inline void copy_helper(std::shared_ptr<KalmarQueue>& srcQueue, void* src,
@@ -466,6 +1389,10 @@ static inline void copy_helper(std::shared_ptr<KalmarQueue>& srcQueue, void* src
         dstQueue->write(dst, (char*)src + src_offset, cnt, dst_offset, block);
     else if (is_cpu_queue(dstQueue))
         srcQueue->read(src, (char*)dst + dst_offset, cnt, src_offset);
+    /// Between two devices, let the destination queue pick between a direct
+    /// peer copy and a copy staged through host memory
+    else if (srcQueue->getDev() != dstQueue->getDev())
+        dstQueue->copy_peer(src, srcQueue->getDev(), dst, cnt, src_offset, dst_offset, block);
     else
         dstQueue->copy(src, dst, cnt, src_offset, dst_offset, block);
 }
@@ -489,10 +1416,119 @@ enum states
 /// that device.
 /// @data: device data pointer
 /// @state: used to implement MSI protocol
+/// @writer, @readers: dependency slots of the data on current device
+/// @stale: if the state is invalid, the chunks of the data which are out of
+///         date, the others are valid, or empty if all of the data is
 struct dev_info
 {
     void* data; /// pointer to device data
     states state; /// state of the data on current device
+    /// the last asynchronous operation which modifies the data
+    std::weak_ptr<KalmarAsyncOp> writer;
+    /// asynchronous operations which read the data since the last write
+    std::vector< std::weak_ptr<KalmarAsyncOp> > readers;
+    /// out of date chunks of RW_INFO_CHUNK_SIZE bytes
+    std::vector<bool> stale;
+};
+
+/// A section of the data of a rw_info used by a kernel: @blocks contiguous
+/// blocks of @size bytes each, @stride bytes apart, the first one @offset
+/// bytes into the data
+struct rw_range
+{
+    size_t offset;
+    size_t size;
+    size_t stride;
+    size_t blocks;
+};
+
+/// dev_info of each device the data of a rw_info is used on
+/// The first RW_INFO_INLINE_DEVICES devices are looked up by their ordinal
+/// in an inline table, so the launch path doesn't walk a tree or allocate.
+/// Other devices are kept in a list.
+class dev_table
+{
+public:
+    typedef std::pair<KalmarDevice*, dev_info> value_type;
+
+    class iterator
+    {
+        dev_table* table;
+        /// slot in the inline table, or RW_INFO_INLINE_DEVICES in the list
+        int index;
+        std::list<value_type>::iterator node;
+
+        void skip() {
+            while (index < RW_INFO_INLINE_DEVICES && table->entries[index].first == nullptr)
+                ++index;
+        }
+    public:
+        iterator(dev_table* table, int index, std::list<value_type>::iterator node)
+            : table(table), index(index), node(node) { skip(); }
+
+        value_type& operator*() const { return index < RW_INFO_INLINE_DEVICES ? table->entries[index] : *node; }
+        value_type* operator->() const { return &**this; }
+
+        iterator& operator++() {
+            if (index < RW_INFO_INLINE_DEVICES) {
+                ++index;
+                skip();
+            } else
+                ++node;
+            return *this;
+        }
+
+        bool operator==(const iterator& other) const { return index == other.index && node == other.node; }
+        bool operator!=(const iterator& other) const { return !(*this == other); }
+    };
+
+private:
+    value_type entries[RW_INFO_INLINE_DEVICES];
+    std::list<value_type> others;
+
+    value_type* lookup(KalmarDevice* dev) {
+        unsigned int index = dev->get_ordinal();
+        if (index < RW_INFO_INLINE_DEVICES)
+            return entries[index].first == dev ? &entries[index] : nullptr;
+        for (auto& entry : others)
+            if (entry.first == dev)
+                return &entry;
+        return nullptr;
+    }
+
+public:
+    dev_table() : others() {
+        for (auto& entry : entries)
+            entry.first = nullptr;
+    }
+
+    /// get the dev_info of a device, adding it if there's none
+    dev_info& operator[](KalmarDevice* dev) {
+        if (value_type* entry = lookup(dev))
+            return entry->second;
+        unsigned int index = dev->get_ordinal();
+        if (index < RW_INFO_INLINE_DEVICES) {
+            entries[index].first = dev;
+            return entries[index].second;
+        }
+        others.push_back(value_type(dev, dev_info()));
+        return others.back().second;
+    }
+
+    bool contains(KalmarDevice* dev) { return lookup(dev) != nullptr; }
+
+    void erase(KalmarDevice* dev) {
+        unsigned int index = dev->get_ordinal();
+        if (index < RW_INFO_INLINE_DEVICES) {
+            if (entries[index].first == dev)
+                entries[index] = value_type(nullptr, dev_info());
+            return;
+        }
+        others.remove_if([dev] (const value_type& entry) { return entry.first == dev; });
+    }
+
+    iterator begin() { return iterator(this, 0, others.begin()); }
+    iterator end() { return iterator(this, RW_INFO_INLINE_DEVICES, others.end()); }
 };
 
 /// rw_info is modeled as multiprocessor without shared cache
@@ -522,7 +1558,7 @@ struct rw_info
     /// This is used as cache for device buffer
     /// When this rw_info is going to be used(computed) on device,
     /// rw_info will allocate buffer for the device
-    std::map<KalmarDevice*, dev_info> devs;
+    dev_table devs;
     access_type mode;
     /// This will be set if this rw_info is constructed with host pointer
     /// because rw_info cannot free host pointer
@@ -533,20 +1569,65 @@ struct rw_info
     /// constructed with a given device pointer.
     bool toReleaseDevPointer;
 
+    /// hints given through advise()
+    /// @preferred: the queue the data is first allocated on if it's first
+    ///             used on the host
+    /// @readMostly: the data is copied asynchronously to the devices kernels
+    ///              read it on
+    std::shared_ptr<KalmarQueue> preferred;
+    bool readMostly;
+
+    /// placement given through set_placement()
+    /// @resident: the memory device buffers are currently created in
+    /// @hostAccesses, @deviceAccesses: counted for hcMemoryPlacementAuto
+    hcMemoryPlacement placement;
+    hcMemoryPlacement resident;
+    unsigned int hostAccesses;
+    unsigned int deviceAccesses;
+
+    /// references of rw_info_handle
+    std::atomic<unsigned int> refCount;
+
+    /// when the staging copy on the device of stage was last used
+    std::chrono::steady_clock::time_point stageUsed;
+
+    /// set while the kernels of a launch sharded over several queues are
+    /// launched, the data is valid on all of them then
+    bool sharding;
+
+    /// ranges of the data written by the kernels of the last sharded launch,
+    /// which haven't been gathered to the device of the first one yet
+    struct shard {
+        std::shared_ptr<KalmarQueue> queue;
+        size_t offset;
+        size_t size;
+    };
+    std::vector<shard> shards;
+
+    /// set if the host memory is mapped to the devices instead of being
+    /// copied, kernels access it in place
+    /// @hostMapped: the devices it's mapped to, their data isn't released
+    bool zeroCopy;
+    std::vector<KalmarDevice*> hostMapped;
+
 
     /// consruct array_view
     /// According to standard, array_view will be constructed by size, or size with
     /// host pointer.
     /// If it is constructed with host pointer, treat it is constructed on cpu
     /// device, set the HostPtr flag to prevent destructor to release it
-    rw_info(const size_t count, void* ptr)
+    rw_info(const size_t count, void* ptr, bool zeroCopy = false)
         : data(ptr), count(count), curr(nullptr), master(nullptr), stage(nullptr),
-        devs(), mode(access_type_none), HostPtr(ptr != nullptr), toReleaseDevPointer(true) {
+        devs(), mode(access_type_none), HostPtr(ptr != nullptr), toReleaseDevPointer(true),
+        preferred(nullptr), readMostly(false),
+        placement(hcMemoryPlacementDefault), resident(hcMemoryPlacementDefault),
+        hostAccesses(0), deviceAccesses(0), refCount(0), sharding(false), shards(),
+        zeroCopy(zeroCopy && ptr != nullptr), hostMapped() {
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
             /// if array_view is constructed in cpu path kernel
             /// allocate memory for it and do nothing
             if (CLAMP::in_cpu_kernel() && ptr == nullptr) {
-                data = kalmar_aligned_alloc(0x1000, count);
+                data = kalmar_host_alloc(count);
                 return;
             }
 #endif
@@ -554,6 +1635,8 @@ struct rw_info
                 mode = access_type_read_write;
                 curr = master = get_cpu_queue();
                 devs[curr->getDev()] = {ptr, modified};
+                if (zeroCopy)
+                    hostMapped.push_back(curr->getDev());
             }
         }
 
@@ -565,24 +1648,30 @@ struct rw_info
     ///    If it is not, ignore the stage one, fallback to case 1.
     rw_info(const std::shared_ptr<KalmarQueue>& Queue, const std::shared_ptr<KalmarQueue>& Stage,
             const size_t count, access_type mode_) : data(nullptr), count(count),
-    curr(Queue), master(Queue), stage(nullptr), devs(), mode(mode_), HostPtr(false), toReleaseDevPointer(true) {
+    curr(Queue), master(Queue), stage(nullptr), devs(), mode(mode_), HostPtr(false), toReleaseDevPointer(true),
+    preferred(nullptr), readMostly(false),
+    placement(hcMemoryPlacementDefault), resident(hcMemoryPlacementDefault),
+    hostAccesses(0), deviceAccesses(0), refCount(0), sharding(false), shards(),
+    zeroCopy(false), hostMapped() {
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
         if (CLAMP::in_cpu_kernel() && data == nullptr) {
-            data = kalmar_aligned_alloc(0x1000, count);
+            data = kalmar_host_alloc(count);
             return;
         }
 #endif
         if (mode == access_type_auto)
             mode = curr->getDev()->get_access();
-        devs[curr->getDev()] = {curr->getDev()->create(count, this), modified};
 
-        /// set data pointer, if it is accessible from cpu
-        if (is_cpu_queue(curr) || (curr->getDev()->is_unified() && mode != access_type_none))
+        /// set data pointer, if it is accessible from cpu, otherwise the
+        /// buffer is allocated when the data is first used
+        if (is_cpu_queue(curr) || (curr->getDev()->is_unified() && mode != access_type_none)) {
+            devs[curr->getDev()] = {curr->getDev()->allocate(count, this), modified};
             data = devs[curr->getDev()].data;
+        }
+        /// the staging copy is allocated when the data is first used on the
+        /// device of stage
         if (is_cpu_queue(curr)) {
             stage = Stage;
-            if (Stage != curr)
-                devs[stage->getDev()] = {stage->getDev()->create(count, this), invalid};
         } else
             /// if curr is not cpu, ignore the stage one
             stage = curr;
@@ -596,7 +1685,11 @@ struct rw_info
     rw_info(const std::shared_ptr<KalmarQueue>& Queue, const std::shared_ptr<KalmarQueue>& Stage,
             const size_t count,
             void* device_pointer,
-            access_type mode_) : data(nullptr), count(count), curr(Queue), master(Queue), stage(nullptr), devs(), mode(mode_), HostPtr(false), toReleaseDevPointer(false) {
+            access_type mode_) : data(nullptr), count(count), curr(Queue), master(Queue), stage(nullptr), devs(), mode(mode_), HostPtr(false), toReleaseDevPointer(false),
+            preferred(nullptr), readMostly(false),
+            placement(hcMemoryPlacementDefault), resident(hcMemoryPlacementDefault),
+            hostAccesses(0), deviceAccesses(0), refCount(0), sharding(false), shards(),
+            zeroCopy(false), hostMapped() {
          if (mode == access_type_auto)
              mode = curr->getDev()->get_access();
          devs[curr->getDev()] = { device_pointer, modified };
@@ -606,27 +1699,127 @@ struct rw_info
              data = devs[curr->getDev()].data;
          if (is_cpu_queue(curr)) {
              stage = Stage;
-             if (Stage != curr)
-                 devs[stage->getDev()] = {stage->getDev()->create(count, this), invalid};
          } else
              /// if curr is not cpu, ignore the stage one
              stage = curr;
     }
 
+    /// wait for asynchronous operations using the data on a device
+    /// @dev: data on the device
+    /// @modify: the data is going to be modified, so wait for the operations
+    ///          reading it as well
+    void wait_async_ops(dev_info& dev, bool modify) {
+        if (auto op = dev.writer.lock())
+            op->blockingWait();
+        dev.writer.reset();
+        if (modify) {
+            for (auto& reader : dev.readers)
+                if (auto op = reader.lock())
+                    op->blockingWait();
+            dev.readers.clear();
+        }
+    }
+
+    /// the data on the device of curr, allocated there on first use
+    dev_info& curr_info() {
+        KalmarDevice* pDev = curr->getDev();
+        if (!devs.contains(pDev))
+            devs[pDev] = {pDev->allocate(count, this), modified};
+        return devs[pDev];
+    }
+
+    /// note the use of the staging copy if @pQueue is on the device of
+    /// stage, or see if it can be released if the host uses the data
+    void use_stage(const std::shared_ptr<KalmarQueue>& pQueue) {
+        if (!stage || stage == master)
+            return;
+        if (pQueue->getDev() == stage->getDev())
+            stageUsed = std::chrono::steady_clock::now();
+        else if (is_cpu_queue(pQueue))
+            release_idle_stage();
+    }
+
+    /// release the staging copy of the data if it's been idle for
+    /// RW_INFO_STAGE_IDLE_MS and the data is valid elsewhere
+    void release_idle_stage() {
+        static const long idle = getenv("HCC_STAGE_IDLE_MS") ?
+                                 atol(getenv("HCC_STAGE_IDLE_MS")) : RW_INFO_STAGE_IDLE_MS;
+        if (idle <= 0 || !stage || !toReleaseDevPointer || is_cpu_queue(stage))
+            return;
+        KalmarDevice* pDev = stage->getDev();
+        if (!devs.contains(pDev) || (curr && curr->getDev() == pDev))
+            return;
+        dev_info& dev = devs[pDev];
+        if (dev.state == modified ||
+            std::chrono::steady_clock::now() - stageUsed < std::chrono::milliseconds(idle))
+            return;
+        wait_async_ops(dev, true);
+        pDev->deallocate(dev.data, this);
+        devs.erase(pDev);
+    }
+
     void* get_device_pointer() {
-        return devs[curr->getDev()].data;
+        return curr_info().data;
     }
 
     void construct(std::shared_ptr<KalmarQueue> pQueue) {
         curr = pQueue;
-        devs[pQueue->getDev()] = {pQueue->getDev()->create(count, this), invalid};
+        devs[pQueue->getDev()] = {pQueue->getDev()->allocate(count, this), invalid};
         if (is_cpu_queue(pQueue))
             data = devs[pQueue->getDev()].data;
     }
 
     void disc() {
-        for (auto& it : devs)
+        for (auto& it : devs) {
             it.second.state = invalid;
+            it.second.stale.clear();
+        }
+    }
+
+    /// invalidate a range of the data on all devices but @keep
+    /// the rest of the data stays valid on devices where all of it was
+    void disc(KalmarDevice* keep, size_t offset, size_t size) {
+        size_t chunks = (count + RW_INFO_CHUNK_SIZE - 1) / RW_INFO_CHUNK_SIZE;
+        for (auto& it : devs) {
+            dev_info& dev = it.second;
+            if (it.first == keep)
+                continue;
+            if (dev.state != invalid) {
+                dev.state = invalid;
+                dev.stale.assign(chunks, false);
+            } else if (dev.stale.empty()) {
+                continue;
+            }
+            for (size_t i = offset / RW_INFO_CHUNK_SIZE; i * RW_INFO_CHUNK_SIZE < offset + size; ++i)
+                dev.stale[i] = true;
+        }
+    }
+
+    /// copy the data to @dst, only the out of date chunks if it's partially
+    /// valid there
+    void copy_stale(dev_info& src, std::shared_ptr<KalmarQueue>& pQueue, dev_info& dst, bool block) {
+        /// counted on the queue of the accelerator the data moves to or from
+        KalmarQueue* counted = is_cpu_queue(pQueue) ? curr.get() : pQueue.get();
+        KalmarQueueCounters::add(counted->getCounters().syncCopies);
+        if (dst.stale.empty()) {
+            copy_helper(curr, src.data, pQueue, dst.data, count, block);
+            return;
+        }
+        size_t i = 0;
+        while (i < dst.stale.size()) {
+            if (!dst.stale[i]) {
+                ++i;
+                continue;
+            }
+            /// copy each run of out of date chunks at once
+            size_t first = i;
+            while (i < dst.stale.size() && dst.stale[i])
+                ++i;
+            size_t offset = first * RW_INFO_CHUNK_SIZE;
+            size_t size = std::min(i * RW_INFO_CHUNK_SIZE, count) - offset;
+            copy_helper(curr, src.data, pQueue, dst.data, size, block, offset, offset);
+        }
+        dst.stale.clear();
     }
 
     /// optimization: Before performing copy, if the state of cpu accelerator is
@@ -639,7 +1832,7 @@ struct rw_info
         if (is_cpu_queue(curr))
             return;
         auto cpu_queue = get_cpu_queue();
-        if (devs.find(cpu_queue->getDev()) != std::end(devs))
+        if (devs.contains(cpu_queue->getDev()))
             if (devs[cpu_queue->getDev()].state == shared)
                 curr = cpu_queue;
     }
@@ -654,10 +1847,25 @@ struct rw_info
         if (CLAMP::in_cpu_kernel())
             return;
 #endif
+        /// the data is valid on each queue of a sharded launch, the kernels
+        /// write their own ranges of it
+        if (sharding) {
+            curr = pQueue;
+            curr_info();
+            return;
+        }
+        gather();
+
+        /// kernels using the data don't block
+        if (placement == hcMemoryPlacementAuto && !block && !is_cpu_queue(pQueue))
+            count_access(pQueue, false);
+
+        use_stage(pQueue);
+
         if (!curr) {
             /// This can only happen if array_view is constructed with size and
             /// is not accessed before
-            dev_info dev = {pQueue->getDev()->create(count, this),
+            dev_info dev = {pQueue->getDev()->allocate(count, this),
                 modify ? modified : shared};
             devs[pQueue->getDev()] = dev;
             if (is_cpu_queue(pQueue))
@@ -666,23 +1874,60 @@ struct rw_info
             return;
         }
 
-        if (curr == pQueue)
+        if (curr == pQueue) {
+            /// the host is going to access the data, wait for a copy into it
+            if (is_cpu_queue(pQueue))
+                wait_async_ops(devs[pQueue->getDev()], modify);
+            curr_info();
             return;
+        }
 
         /// If both queues are from the same device, upadte state only
         if (curr->getDev() == pQueue->getDev()) {
             // curr->wait();
             curr = pQueue;
+            dev_info& dev = curr_info();
             if (modify) {
                 disc();
-                devs[curr->getDev()].state = modified;
+                dev.state = modified;
             }
             return;
         }
 
+        /// Host memory mapped to the device is accessed in place, wait for
+        /// the operations on it elsewhere only
+        if (zeroCopy && map_host(pQueue->getDev())) {
+            for (auto& it : devs) {
+                wait_async_ops(it.second, modify);
+                it.second.state = shared;
+                it.second.stale.clear();
+            }
+            curr = pQueue;
+            if (modify)
+                curr_info().state = modified;
+            return;
+        }
+
+        /// If the data is valid on the device already, as when it's
+        /// replicated, switch to it without any copy
+        if (!modify && devs.contains(pQueue->getDev()) && devs[pQueue->getDev()].state != invalid) {
+            if (is_cpu_queue(pQueue))
+                wait_async_ops(devs[pQueue->getDev()], false);
+            curr = pQueue;
+            return;
+        }
+
+        /// data read by kernels is prefetched asynchronously if it's read
+        /// mostly, the kernels wait for the copy on the device
+        if (readMostly && !modify && !block && prefetch(pQueue))
+            return;
+
+        /// The data leaves the device, wait for operations on it over there
+        wait_async_ops(curr_info(), modify);
+
         /// If the buffer on device is not allocated, allocate space for it
-        if (devs.find(pQueue->getDev()) == std::end(devs)) {
-            dev_info dev = {pQueue->getDev()->create(count, this), invalid};
+        if (!devs.contains(pQueue->getDev())) {
+            dev_info dev = {pQueue->getDev()->allocate(count, this), invalid};
             devs[pQueue->getDev()] = dev;
             if (is_cpu_queue(pQueue))
                 data = dev.data;
@@ -691,8 +1936,10 @@ struct rw_info
         try_switch_to_cpu();
         dev_info& dst = devs[pQueue->getDev()];
         dev_info& src = devs[curr->getDev()];
-        if (dst.state == invalid && src.state != invalid)
-            copy_helper(curr, src.data, pQueue, dst.data, count, block);
+        if (dst.state == invalid && src.state != invalid) {
+            wait_async_ops(dst, true);
+            copy_stale(src, pQueue, dst, block);
+        }
         /// if the data on current device is going to be modified
         /// changed the state of current device as modified
         curr = pQueue;
@@ -706,60 +1953,478 @@ struct rw_info
         }
     }
 
+    /// the chunks of the data covered by @range
+    std::vector<bool> range_chunks(const rw_range& range) const {
+        size_t chunks = (count + RW_INFO_CHUNK_SIZE - 1) / RW_INFO_CHUNK_SIZE;
+        std::vector<bool> covered(chunks, false);
+        for (size_t b = 0; b < range.blocks; ++b) {
+            size_t begin = range.offset + b * range.stride;
+            size_t end = std::min(begin + range.size, count);
+            for (size_t i = begin / RW_INFO_CHUNK_SIZE; i * RW_INFO_CHUNK_SIZE < end; ++i)
+                covered[i] = true;
+        }
+        return covered;
+    }
+
+    /// synchronize only the section @range of the data to the device pQueue
+    /// belongs to, for a kernel which only accesses that section there
+    /// The chunks of the section which are out of date on the device are
+    /// copied from curr, and the device stays partially valid. If the kernel
+    /// modifies the section, it's out of date on the other devices, and it's
+    /// gathered back to curr like the ranges of a sharded launch, the rest of
+    /// the data stays valid wherever it was.
+    /// Falls back to sync() when the data moves as a whole anyway.
+    void sync(std::shared_ptr<KalmarQueue> pQueue, bool modify, bool block, const rw_range& range) {
+#if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
+        if (CLAMP::in_cpu_kernel())
+            return;
+#endif
+        std::vector<bool> covered = range_chunks(range);
+        bool whole = std::find(covered.begin(), covered.end(), false) == covered.end();
+        /// the sections written on other devices are put together first
+        for (auto& shard : shards) {
+            if (shard.queue->getDev() != pQueue->getDev()) {
+                gather();
+                break;
+            }
+        }
+        if (whole || sharding || !curr || curr->getDev() == pQueue->getDev() || is_cpu_queue(pQueue) ||
+            zeroCopy || readMostly || placement == hcMemoryPlacementAuto) {
+            sync(pQueue, modify, block);
+            return;
+        }
+        use_stage(pQueue);
+
+        /// If the buffer on device is not allocated, allocate space for it
+        if (!devs.contains(pQueue->getDev())) {
+            dev_info dev = {pQueue->getDev()->allocate(count, this), invalid};
+            devs[pQueue->getDev()] = dev;
+        }
+        dev_info& dst = devs[pQueue->getDev()];
+        if (dst.state != invalid && !modify) {
+            sync(pQueue, modify, block);
+            return;
+        }
+
+        /// copy the runs of chunks of the section out of date on the device
+        if (dst.state == invalid) {
+            wait_async_ops(curr_info(), false);
+            try_switch_to_cpu();
+            dev_info& src = curr_info();
+            wait_async_ops(dst, true);
+            if (dst.stale.empty())
+                dst.stale.assign(covered.size(), true);
+            KalmarQueueCounters::add(pQueue->getCounters().syncCopies);
+            size_t i = 0;
+            while (i < covered.size()) {
+                if (!covered[i] || !dst.stale[i]) {
+                    ++i;
+                    continue;
+                }
+                size_t first = i;
+                while (i < covered.size() && covered[i] && dst.stale[i])
+                    dst.stale[i++] = false;
+                size_t offset = first * RW_INFO_CHUNK_SIZE;
+                size_t size = std::min(i * RW_INFO_CHUNK_SIZE, count) - offset;
+                copy_helper(curr, src.data, pQueue, dst.data, size, block, offset, offset);
+            }
+            if (std::find(dst.stale.begin(), dst.stale.end(), true) == dst.stale.end()) {
+                dst.state = shared;
+                dst.stale.clear();
+            }
+        }
+        if (!modify)
+            return;
+
+        /// the kernel writes the chunks of the section on the device
+        wait_async_ops(dst, true);
+        size_t i = 0;
+        while (i < covered.size()) {
+            if (!covered[i]) {
+                ++i;
+                continue;
+            }
+            size_t first = i;
+            while (i < covered.size() && covered[i])
+                ++i;
+            size_t offset = first * RW_INFO_CHUNK_SIZE;
+            size_t size = std::min(i * RW_INFO_CHUNK_SIZE, count) - offset;
+            disc(pQueue->getDev(), offset, size);
+            shards.push_back({pQueue, offset, size});
+        }
+        if (dst.state != invalid)
+            dst.state = modified;
+    }
+
     /// return a host accessible pointer from device
     /// @cnt: size to map
     /// @offset: offset to map
     /// @modify: change state if it is going to be modified
-    void* map(size_t cnt, size_t offset, bool modify) {
+    /// @overwrite: all of the mapped range is going to be written, and none
+    /// of it read, by the host
+    void* map(size_t cnt, size_t offset, bool modify, bool overwrite = false) {
         if (cnt == 0)
             cnt = count;
+        modify = modify || overwrite;
+        gather();
         /// This can only happen if this rw_info is constructed only with size
         /// and not accessed on any device
         if (!curr) {
-            curr = getContext()->auto_select();
-            devs[curr->getDev()] = {curr->getDev()->create(count, this), modify ? modified : shared};
-            return curr->map(data, cnt, offset, modify);
+            curr = preferred ? preferred : getContext()->auto_select();
+            devs[curr->getDev()] = {curr->getDev()->allocate(count, this), modify ? modified : shared};
+            return overwrite ? curr->map_for_write(data, cnt, offset) : curr->map(data, cnt, offset, modify);
         }
+        wait_async_ops(curr_info(), modify);
         try_switch_to_cpu();
         dev_info& info = devs[curr->getDev()];
         if (info.state == shared && modify) {
             disc();
             info.state = modified;
         }
-        return curr->map(info.data, cnt, offset, modify);
+        return overwrite ? curr->map_for_write(info.data, cnt, offset) : curr->map(info.data, cnt, offset, modify);
     }
 
-    void unmap(void* addr, size_t cnt, size_t offset, bool modify) { curr->unmap(devs[curr->getDev()].data, addr, cnt, offset, modify); }
+    void unmap(void* addr, size_t cnt, size_t offset, bool modify, bool overwrite = false) {
+        if (overwrite)
+            curr->unmap_for_write(curr_info().data, addr, cnt, offset);
+        else
+            curr->unmap(curr_info().data, addr, cnt, offset, modify);
+    }
 
     /// synchronize data to master accelerator
     /// used in array
     /// master is not necessary to be cpu device
-    void synchronize(bool modify) { sync(master, modify); }
+    void synchronize(bool modify) {
+        if (placement == hcMemoryPlacementAuto && master && !is_cpu_queue(master))
+            count_access(master, true);
+        sync(master, modify);
+    }
 
     /// synchronize data to cpu accelerator
     /// used in array_view
     void get_cpu_access(bool modify) { sync(get_cpu_queue(), modify); }
 
+    /// synchronize data to cpu accelerator, only @size bytes at @offset are
+    /// going to be modified, so the data stays valid elsewhere except there
+    /// used in array_view
+    void get_cpu_access(bool modify, size_t offset, size_t size) {
+        auto cpu_queue = get_cpu_queue();
+        sync(cpu_queue, false);
+        if (!modify)
+            return;
+        dev_info& dev = devs[cpu_queue->getDev()];
+        if (curr != cpu_queue || dev.state == invalid) {
+            sync(cpu_queue, true);
+            return;
+        }
+        wait_async_ops(dev, true);
+        dev.state = modified;
+        disc(cpu_queue->getDev(), offset, size);
+    }
+
     /// Write data from host source pointer to device
     /// Change state to modified, because the device has exclusive copy of data
+    /// the written range is out of date on other devices
     void write(const void* src, int cnt, int offset, bool blocking) {
-        curr->write(devs[curr->getDev()].data, src, cnt, offset, blocking);
-        dev_info& dev = devs[curr->getDev()];
-        if (dev.state != modified) {
+        gather();
+        dev_info& dev = curr_info();
+        wait_async_ops(dev, true);
+        curr->write(dev.data, src, cnt, offset, blocking);
+        if (dev.state == invalid) {
             disc();
-            dev.state = modified;
+        } else {
+            disc(curr->getDev(), offset, cnt);
         }
+        dev.state = modified;
+    }
+
+    /// Write data from the host buffer @src to device asynchronously, see
+    /// write(), the copy holds @src until it completes
+    /// @return: the asynchronous operation of the copy, or nullptr if the
+    ///          data is written already
+    std::shared_ptr<KalmarAsyncOp> write_async(std::shared_ptr<const void> src, int cnt, int offset) {
+        gather();
+        dev_info& dev = curr_info();
+        std::shared_ptr<KalmarAsyncOp> op;
+        if (!is_cpu_queue(curr))
+            op = curr->EnqueueAsyncWrite(src, (char*)dev.data + offset, cnt, &dev);
+        if (!op) {
+            write(src.get(), cnt, offset, true);
+            return nullptr;
+        }
+        if (dev.state == invalid) {
+            disc();
+        } else {
+            disc(curr->getDev(), offset, cnt);
+        }
+        dev.state = modified;
+        return op;
     }
 
     /// Read data to host pointer from device
     void read(void* dst, int cnt, int offset) {
-        curr->read(devs[curr->getDev()].data, dst, cnt, offset);
+        gather();
+        dev_info& dev = curr_info();
+        wait_async_ops(dev, false);
+        curr->read(dev.data, dst, cnt, offset);
+    }
+
+    /// start copying the data to the device pQueue belongs to for reading,
+    /// or for modifying it too if @modify, only copies between the host and
+    /// a device are asynchronous, others are done synchronously
+    /// @return: the asynchronous operation of the copy, or nullptr if the
+    ///          data is synchronized already
+    std::shared_ptr<KalmarAsyncOp> prefetch(std::shared_ptr<KalmarQueue> pQueue, bool modify = false) {
+#if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
+        if (CLAMP::in_cpu_kernel())
+            return nullptr;
+#endif
+        gather();
+        if (!curr || curr->getDev() == pQueue->getDev()) {
+            sync(pQueue, modify);
+            return nullptr;
+        }
+        use_stage(pQueue);
+
+        /// If the buffer on device is not allocated, allocate space for it
+        if (!devs.contains(pQueue->getDev())) {
+            dev_info dev = {pQueue->getDev()->allocate(count, this), invalid};
+            devs[pQueue->getDev()] = dev;
+            if (is_cpu_queue(pQueue))
+                data = dev.data;
+        }
+
+        try_switch_to_cpu();
+        dev_info& dst = devs[pQueue->getDev()];
+        dev_info& src = curr_info();
+        std::shared_ptr<KalmarAsyncOp> op;
+        if (dst.state == invalid && src.state != invalid && dst.stale.empty()) {
+            if (is_cpu_queue(curr) && !is_cpu_queue(pQueue))
+                op = pQueue->EnqueueAsyncCopy(src.data, dst.data, count, hcMemcpyHostToDevice, &src, &dst);
+            else if (!is_cpu_queue(curr) && is_cpu_queue(pQueue))
+                op = curr->EnqueueAsyncCopy(src.data, dst.data, count, hcMemcpyDeviceToHost, &src, &dst);
+        }
+        if (!op) {
+            sync(pQueue, modify);
+            return nullptr;
+        }
+        curr = pQueue;
+        /// accesses to the data on the device wait for the copy, so it's
+        /// the only valid copy from now on if it's going to be modified
+        if (modify) {
+            disc();
+            dst.state = modified;
+        } else {
+            dst.state = shared;
+            if (src.state == modified)
+                src.state = shared;
+        }
+        return op;
+    }
+
+    /// start copying the data to the host, see prefetch()
+    std::shared_ptr<KalmarAsyncOp> get_cpu_access_async(bool modify) {
+        return prefetch(get_cpu_queue(), modify);
+    }
+
+    /// move the buffer on the device of @pQueue into the memory @target
+    /// selects, keeping its content. Later buffers are created there too
+    void migrate(std::shared_ptr<KalmarQueue> pQueue, hcMemoryPlacement target) {
+        if (target == resident)
+            return;
+        resident = target;
+        KalmarDevice* pDev = pQueue->getDev();
+        if (is_cpu_queue(pQueue) || !devs.contains(pDev) || !toReleaseDevPointer)
+            return;
+
+        dev_info& dev = devs[pDev];
+        wait_async_ops(dev, true);
+        void* old = dev.data;
+        void* ptr = pDev->allocate(count, this);
+        bool oldHost = pDev->is_host_accessible(old);
+        bool newHost = pDev->is_host_accessible(ptr);
+        if (dev.state != invalid) {
+            if (oldHost && newHost)
+                memcpy(ptr, old, count);
+            else if (oldHost)
+                pQueue->write(ptr, old, count, 0, true);
+            else if (newHost)
+                pQueue->read(old, ptr, count, 0);
+            else
+                pQueue->copy(old, ptr, count, 0, 0, true);
+        }
+        dev.data = ptr;
+
+        /// an array is accessed on the host through its device buffer if the
+        /// host can access it
+        if (data == old || (data == nullptr && master && master->getDev() == pDev))
+            data = (newHost && mode != access_type_none) ? ptr : nullptr;
+        pDev->deallocate(old, this);
+    }
+
+    /// count an access for hcMemoryPlacementAuto made by the host or by a
+    /// kernel, to the buffer on the device of @pQueue. At the end of each
+    /// window of accesses the buffer moves to host memory if the host made
+    /// most of them, or to device memory if kernels did
+    void count_access(std::shared_ptr<KalmarQueue> pQueue, bool host) {
+        if (host)
+            ++hostAccesses;
+        else
+            ++deviceAccesses;
+        if (hostAccesses + deviceAccesses < RW_INFO_MIGRATE_WINDOW)
+            return;
+
+        if (pQueue->getDev()->supports_migration()) {
+            if (deviceAccesses * 4 >= RW_INFO_MIGRATE_WINDOW * 3)
+                migrate(pQueue, hcMemoryPlacementDevice);
+            else if (hostAccesses * 4 >= RW_INFO_MIGRATE_WINDOW * 3)
+                migrate(pQueue, hcMemoryPlacementHost);
+        }
+        hostAccesses = 0;
+        deviceAccesses = 0;
+    }
+
+    /// choose the memory the device buffers are created in, the one
+    /// already created on the device of master (or curr) is moved there
+    /// hcMemoryPlacementAuto starts from host memory where it's supported
+    void set_placement(hcMemoryPlacement p) {
+#if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
+        if (CLAMP::in_cpu_kernel())
+            return;
+#endif
+        placement = p;
+        hostAccesses = 0;
+        deviceAccesses = 0;
+        std::shared_ptr<KalmarQueue> pQueue = master ? master : curr;
+        hcMemoryPlacement target = p;
+        if (p == hcMemoryPlacementAuto) {
+            target = (pQueue && pQueue->getDev()->supports_migration()) ?
+                     hcMemoryPlacementHost : hcMemoryPlacementDefault;
+        }
+        if (pQueue)
+            migrate(pQueue, target);
+        else
+            resident = target;
+    }
+
+    /// copy the data to the devices of all @queues for reading, it stays
+    /// shared on all of them until it's modified
+    /// each copy is made from a device holding the data which the target
+    /// device can access directly if there's one, otherwise from the host if
+    /// the data is valid there
+    void replicate(const std::vector< std::shared_ptr<KalmarQueue> >& queues) {
+        readMostly = true;
+        if (queues.empty())
+            return;
+        gather();
+        sync(queues[0], false);
+        if (curr_info().state == modified)
+            devs[curr->getDev()].state = shared;
+
+        std::vector< std::shared_ptr<KalmarQueue> > holders(1, curr);
+        auto cpu_queue = get_cpu_queue();
+        for (auto pQueue : queues) {
+            KalmarDevice* pDev = pQueue->getDev();
+            use_stage(pQueue);
+            if (devs.contains(pDev) && devs[pDev].state != invalid)
+                continue;
+            if (!devs.contains(pDev)) {
+                dev_info dev = {pDev->allocate(count, this), invalid};
+                devs[pDev] = dev;
+                if (is_cpu_queue(pQueue))
+                    data = dev.data;
+            }
+
+            std::shared_ptr<KalmarQueue> from = holders[0];
+            bool peer = false;
+            for (auto& holder : holders) {
+                if (!is_cpu_queue(holder) && holder->getDev()->is_peer(pDev)) {
+                    from = holder;
+                    peer = true;
+                    break;
+                }
+            }
+            if (!peer && devs.contains(cpu_queue->getDev()) && devs[cpu_queue->getDev()].state == shared)
+                from = cpu_queue;
+
+            dev_info& dst = devs[pDev];
+            wait_async_ops(dst, true);
+            copy_helper(from, devs[from->getDev()].data, pQueue, dst.data, count, true);
+            dst.state = shared;
+            dst.stale.clear();
+            holders.push_back(pQueue);
+        }
+    }
+
+    /// make the data valid on the devices of all @queues, before the kernels
+    /// of a launch sharded over them are launched
+    void begin_shards(const std::vector< std::shared_ptr<KalmarQueue> >& queues) {
+        for (auto& pQueue : queues)
+            sync(pQueue, false);
+        sharding = true;
+    }
+
+    /// end the launch of the kernels of a sharded launch
+    /// @bounds: if the data is written, offsets of the ranges the kernel on
+    ///          each queue writes, followed by the end of the last range
+    void end_shards(const std::vector< std::shared_ptr<KalmarQueue> >& queues,
+                    const std::vector<size_t>& bounds) {
+        sharding = false;
+        if (bounds.empty())
+            return;
+        for (size_t i = 0; i < queues.size(); ++i) {
+            size_t size = bounds[i + 1] - bounds[i];
+            disc(queues[i]->getDev(), bounds[i], size);
+            shards.push_back({queues[i], bounds[i], size});
+        }
+        curr = queues[0];
+    }
+
+    /// copy the ranges written by the kernels of the last sharded launch to
+    /// the device of the first one, after the kernels are done. The others
+    /// stay valid in their own ranges
+    void gather() {
+        if (shards.empty())
+            return;
+        /// the first queue of a sharded launch, or the device partial
+        /// sections were synchronized from
+        std::shared_ptr<KalmarQueue> home = curr;
+        dev_info& dst = devs[home->getDev()];
+        wait_async_ops(dst, true);
+        for (auto& shard : shards) {
+            if (shard.queue->getDev() == home->getDev())
+                continue;
+            dev_info& src = devs[shard.queue->getDev()];
+            wait_async_ops(src, false);
+            copy_helper(shard.queue, src.data, home, dst.data, shard.size, true, shard.offset, shard.offset);
+            if (src.state == modified)
+                src.state = shared;
+        }
+        shards.clear();
+        curr = home;
+        dst.state = modified;
+        dst.stale.clear();
+    }
+
+    /// give a hint about the use of the data
+    /// @pQueue: the preferred queue, for hcMemoryAdvisePreferredLocation
+    void advise(hcMemoryAdvice advice, std::shared_ptr<KalmarQueue> pQueue) {
+        switch (advice) {
+        case hcMemoryAdviseReadMostly:
+            readMostly = true;
+            break;
+        case hcMemoryAdvisePreferredLocation:
+            preferred = pQueue;
+            break;
+        }
     }
 
     /// copy data from "this" to other
     void copy(rw_info* other, int src_offset, int dst_offset, int cnt) {
         if (cnt == 0)
             cnt = count;
+        gather();
+        other->gather();
         if (!curr) {
             if (!other->curr)
                 return;
@@ -769,18 +2434,20 @@ struct rw_info
             if (!other->curr)
                 other->construct(curr);
         }
-        dev_info& dst = other->devs[other->curr->getDev()];
-        dev_info& src = devs[curr->getDev()];
+        dev_info& dst = other->curr_info();
+        dev_info& src = curr_info();
+        wait_async_ops(src, false);
+        wait_async_ops(dst, true);
         /// If src.state is invalid, zero the data on it
         if (src.state == invalid) {
             src.state = shared;
             if (is_cpu_queue(curr))
                 memset((char*)src.data + src_offset, 0, cnt);
             else {
-                void *ptr = kalmar_aligned_alloc(0x1000, cnt);
+                void *ptr = kalmar_host_alloc(cnt);
                 memset(ptr, 0, cnt);
                 curr->write(src.data, ptr, cnt, src_offset, true);
-                kalmar_aligned_free(ptr);
+                kalmar_host_free(ptr, cnt);
             }
         }
         copy_helper(curr, src.data, other->curr, dst.data, cnt, true, src_offset, dst_offset);
@@ -788,11 +2455,68 @@ struct rw_info
         dst.state = modified;
     }
 
+    /// copy data from "this" to other asynchronously
+    /// only copies between the host and a device, or within a device, are
+    /// asynchronous, others are done synchronously
+    /// @return: the asynchronous operation of the copy, or nullptr if the
+    ///          data is copied already
+    std::shared_ptr<KalmarAsyncOp> copy_async(rw_info* other, int src_offset, int dst_offset, int cnt) {
+        if (cnt == 0)
+            cnt = count;
+        gather();
+        other->gather();
+        if (!curr || !other->curr || curr_info().state == invalid) {
+            copy(other, src_offset, dst_offset, cnt);
+            return nullptr;
+        }
+        hcMemcpyKind kind;
+        std::shared_ptr<KalmarQueue> queue;
+        if (is_cpu_queue(curr) && !is_cpu_queue(other->curr)) {
+            kind = hcMemcpyHostToDevice;
+            queue = other->curr;
+        } else if (!is_cpu_queue(curr) && is_cpu_queue(other->curr)) {
+            kind = hcMemcpyDeviceToHost;
+            queue = curr;
+        } else if (!is_cpu_queue(curr) && curr->getDev() == other->curr->getDev()) {
+            kind = hcMemcpyDeviceToDevice;
+            queue = other->curr;
+        } else {
+            copy(other, src_offset, dst_offset, cnt);
+            return nullptr;
+        }
+        dev_info& dst = other->curr_info();
+        dev_info& src = curr_info();
+        std::shared_ptr<KalmarAsyncOp> op =
+            queue->EnqueueAsyncCopy((char*)src.data + src_offset, (char*)dst.data + dst_offset, cnt, kind, &src, &dst);
+        if (!op) {
+            copy(other, src_offset, dst_offset, cnt);
+            return nullptr;
+        }
+        other->disc();
+        dst.state = modified;
+        return op;
+    }
+
+    /// maps the host memory to @pDev if it isn't yet, returns false if it
+    /// can't be, it's then copied as usual
+    bool map_host(KalmarDevice* pDev) {
+        if (std::find(hostMapped.begin(), hostMapped.end(), pDev) != hostMapped.end())
+            return true;
+        void* va = pDev->map_host(data, count);
+        if (!va) {
+            zeroCopy = false;
+            return false;
+        }
+        devs[pDev] = {va, shared};
+        hostMapped.push_back(pDev);
+        return true;
+    }
+
     ~rw_info() {
 #if __KALMAR_ACCELERATOR__ == 2 || __KALMAR_CPU__ == 2
         if (CLAMP::in_cpu_kernel()) {
             if (data && !HostPtr)
-                kalmar_aligned_free(data);
+                kalmar_host_free(data, count);
             return;
         }
 #endif
@@ -802,21 +2526,64 @@ struct rw_info
         if (HostPtr)
             synchronize(false);
         auto cpu_dev = get_cpu_queue()->getDev();
-        if (devs.find(cpu_dev) != std::end(devs)) {
+        if (devs.contains(cpu_dev)) {
             if (!HostPtr)
-                cpu_dev->release(devs[cpu_dev].data, this);
+                cpu_dev->deallocate(devs[cpu_dev].data, this);
             devs.erase(cpu_dev);
         }
-        KalmarDevice* pDev;
-        dev_info info;
-        for (const auto it : devs) {
-            std::tie(pDev, info) = it;
+        for (auto pDev : hostMapped) {
+            if (pDev != cpu_dev && devs.contains(pDev)) {
+                pDev->unmap_host(data);
+                devs.erase(pDev);
+            }
+        }
+        for (auto& it : devs) {
             if (toReleaseDevPointer)
-                pDev->release(info.data, this);
+                it.first->deallocate(it.second.data, this);
         }
     }
 };
 
+inline void* KalmarDevice::allocate(size_t count, struct rw_info* key) {
+    void* ptr = create(count, key);
+    const char* tag = hc_get_memory_tag();
+    if (tag == nullptr) {
+        if (key && key->master)
+            tag = (key->master->getDev() == this) ? "array" : "staging";
+        else
+            tag = "array_view";
+    }
+    memoryTracker.add(ptr, count, tag);
+    return ptr;
+}
+
+/// host buffers are returned to the pool by the size they were created with
+inline void CPUDevice::release(void* ptr, struct rw_info* key) { kalmar_host_free(ptr, key->count); }
+
+inline void CPUTaskQueue::wait(hcWaitMode mode) {
+    std::shared_ptr<CPUAsyncOp> op;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        op = last;
+    }
+    if (op)
+        op->blockingWait();
+}
+
+inline bool CPUTaskQueue::EnqueueTask(const std::shared_ptr<CPUAsyncOp>& op) {
+    std::lock_guard<std::mutex> lock(mutex);
+    CLAMP::EnqueueCPUTask(op);
+    last = op;
+    return true;
+}
+
+inline std::shared_ptr<KalmarAsyncOp> CPUTaskQueue::EnqueueMarker() {
+    /// the marker is done when the tasks enqueued before it are
+    auto op = std::make_shared<CPUAsyncOp>(this, [] {});
+    EnqueueTask(op);
+    return op;
+}
+
 } // namespace Kalmar
 
 /** \endcond */
@@ -6,23 +6,85 @@
 namespace Kalmar
 {
 
+/// size of the buffer kernel arguments are staged in before they are pushed
+/// to the kernel at once
+#define KERNEL_ARG_STAGING_SIZE (256)
+
+/// kernel arguments staged on the host, as records of the size of each
+/// argument in one byte followed by its bytes, pushed to the kernel with one
+/// call to the runtime once a buffer argument or the end of the arguments is
+/// reached, or the staging buffer is full
+class KernelArgStaging {
+    void* k_;
+    size_t size;
+    unsigned char data[KERNEL_ARG_STAGING_SIZE];
+public:
+    KernelArgStaging(void* k) : k_(k), size(0) {}
+
+    void append(size_t sz, const void* s) {
+        if (size + 1 + sz > KERNEL_ARG_STAGING_SIZE)
+            flush();
+        data[size] = static_cast<unsigned char>(sz);
+        memcpy(data + size + 1, s, sz);
+        size += 1 + sz;
+    }
+
+    void flush() {
+        if (size > 0)
+            CLAMP::PushArgs(k_, size, data);
+        size = 0;
+    }
+};
+
 /// traverse all the buffers that are going to be used in kernel
 class FunctorBufferWalker {
 public:
+    /// if set, plain kernel arguments are staged here instead of being
+    /// passed to Append, only buffers are visited
+    KernelArgStaging* staging;
+
+    /// index of the kernel argument appended or visited next, counted by
+    /// Serialize over all of them
+    int argIndex;
+
+    FunctorBufferWalker() : staging(nullptr), argIndex(0) {}
     virtual void Append(size_t sz, const void* s) {}
     virtual void AppendPtr(size_t sz, const void* s) {}
     virtual void visit_buffer(struct rw_info* rw, bool modify, bool isArray) = 0;
+    /// a buffer of which the kernel only uses the section @range
+    virtual void visit_buffer_range(struct rw_info* rw, bool modify, bool isArray, const rw_range& range) {
+        visit_buffer(rw, modify, isArray);
+    }
 };
 
 /// This is used to avoid incorrect compiler error
 class Serialize {
     FunctorBufferWalker* vis;
+    KernelArgStaging* staging;
 public:
-    Serialize(FunctorBufferWalker* vis) : vis(vis) {}
-    void Append(size_t sz, const void* s) { vis->Append(sz, s); }
-    void AppendPtr(size_t sz, const void* s) { vis->AppendPtr(sz, s); }
+    Serialize(FunctorBufferWalker* vis) : vis(vis), staging(vis->staging) {}
+    void Append(size_t sz, const void* s) {
+        if (staging)
+            staging->append(sz, s);
+        else
+            vis->Append(sz, s);
+        ++vis->argIndex;
+    }
+    void AppendPtr(size_t sz, const void* s) {
+        // the argument is the pointer itself
+        if (staging)
+            staging->append(sizeof(void*), &s);
+        else
+            vis->AppendPtr(sz, s);
+        ++vis->argIndex;
+    }
     void visit_buffer(struct rw_info* rw, bool modify, bool isArray) {
         vis->visit_buffer(rw, modify, isArray);
+        ++vis->argIndex;
+    }
+    void visit_buffer_range(struct rw_info* rw, bool modify, bool isArray, const rw_range& range) {
+        vis->visit_buffer_range(rw, modify, isArray, range);
+        ++vis->argIndex;
     }
 };
 
@@ -36,13 +98,9 @@ public:
     CPUVisitor(std::shared_ptr<KalmarQueue> pQueue) : pQueue(pQueue) {}
     void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override {
         if (isArray) {
-            auto curr = pQueue->getDev()->get_path();
-            auto path = rw->master->getDev()->get_path();
-            if (path == L"cpu") {
-                auto asoc = rw->stage->getDev()->get_path();
-                if (asoc == L"cpu" || path != curr)
-                    throw runtime_exception(__errorMsg_UnsupportedAccelerator, E_FAIL);
-            }
+            KalmarDevice* master = rw->master->getDev();
+            if (master->is_cpu() && (rw->stage->getDev()->is_cpu() || master != pQueue->getDev()))
+                throw runtime_exception(__errorMsg_UnsupportedAccelerator, E_FAIL);
         }
         rw->sync(pQueue, modify, false);
         if (bufs.find(rw) == std::end(bufs)) {
@@ -55,32 +113,60 @@ public:
 };
 
 /// Append kernel argument to kernel
+/// Runtimes which take many arguments at once get the plain arguments staged,
+/// the others get each of them pushed by index
+/// Buffers the device compiler found the kernel only reads through are not
+/// marked modified, even if they are not const
 class BufferArgumentsAppender : public FunctorBufferWalker
 {
     std::shared_ptr<KalmarQueue> pQueue;
     void* k_;
     int current_idx_;
+    KernelArgStaging args;
+    uint64_t readOnlyArgs;
+
+    bool modifies(bool modify) const {
+        return modify && !(argIndex < 64 && (readOnlyArgs >> argIndex) & 1);
+    }
 public:
-    BufferArgumentsAppender(std::shared_ptr<KalmarQueue> pQueue, void* k)
-        : pQueue(pQueue), k_(k), current_idx_(0) {}
+    BufferArgumentsAppender(std::shared_ptr<KalmarQueue> pQueue, void* k, uint64_t readOnlyArgs = 0)
+        : pQueue(pQueue), k_(k), current_idx_(0), args(k), readOnlyArgs(readOnlyArgs) {
+        if (CLAMP::HasPushArgs())
+            staging = &args;
+    }
     void Append(size_t sz, const void *s) override {
         CLAMP::PushArg(k_, current_idx_++, sz, s);
     }
     void AppendPtr(size_t sz, const void *s) override {
         CLAMP::PushArgPtr(k_, current_idx_++, sz, s);
     }
+    /// push the arguments staged so far, once all of them are appended
+    void flush() { args.flush(); }
     void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override {
+        // buffers follow the arguments staged before them
+        args.flush();
         if (isArray) {
-            auto curr = pQueue->getDev()->get_path();
-            auto path = rw->master->getDev()->get_path();
-            if (path == L"cpu") {
-                auto asoc = rw->stage->getDev()->get_path();
-                if (asoc == L"cpu" || path != curr)
-                    throw runtime_exception(__errorMsg_UnsupportedAccelerator, E_FAIL);
-            }
+            KalmarDevice* master = rw->master->getDev();
+            if (master->is_cpu() && (rw->stage->getDev()->is_cpu() || master != pQueue->getDev()))
+                throw runtime_exception(__errorMsg_UnsupportedAccelerator, E_FAIL);
         }
+        modify = modifies(modify);
         rw->sync(pQueue, modify, false);
-        pQueue->Push(k_, current_idx_++, rw->devs[pQueue->getDev()].data, modify);
+        dev_info& dev = rw->devs[pQueue->getDev()];
+        pQueue->Push(k_, current_idx_++, dev.data, modify, &dev);
+    }
+    /// only the section is copied to the device, and marked out of date
+    /// elsewhere if it's modified
+    void visit_buffer_range(struct rw_info* rw, bool modify, bool isArray, const rw_range& range) override {
+        if (isArray) {
+            visit_buffer(rw, modify, isArray);
+            return;
+        }
+        args.flush();
+        modify = modifies(modify);
+        rw->sync(pQueue, modify, false, range);
+        dev_info& dev = rw->devs[pQueue->getDev()];
+        pQueue->Push(k_, current_idx_++, dev.data, modify, &dev);
     }
 };
 
@@ -97,14 +183,48 @@ public:
     QueueSearcher() = default;
     void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override {
         if (isArray && !pQueue) {
-            if (rw->master->getDev()->get_path() != L"cpu")
+            if (!rw->master->getDev()->is_cpu())
                 pQueue = rw->master;
-            else if (rw->stage->getDev()->get_path() != L"cpu")
+            else if (!rw->stage->getDev()->is_cpu())
                 pQueue = rw->stage;
         }
     }
     std::shared_ptr<KalmarQueue> get_que() const { return pQueue; }
 };
 
+/// Lay out the plain kernel arguments of a functor as a kernel dispatch does,
+/// each aligned to its size, so they could overwrite the arguments of a
+/// captured kernel launch at once. Buffers can't be rebound this way
+class KernelArgPatcher : public FunctorBufferWalker
+{
+    std::vector<unsigned char> args;
+
+    void append(size_t sz, const void* s) {
+        size_t offset = args.size();
+        size_t padding_size = (offset % sz) ? (sz - (offset % sz)) : 0;
+        args.resize(offset + padding_size + sz, 0);
+        memcpy(args.data() + offset + padding_size, s, sz);
+    }
+public:
+    KernelArgPatcher() = default;
+    void Append(size_t sz, const void *s) override { append(sz, s); }
+    void AppendPtr(size_t sz, const void *s) override { append(sizeof(void*), &s); }
+    void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override {
+        throw runtime_exception("the arguments of a kernel capturing a buffer can't be patched", E_FAIL);
+    }
+    const void* data() const { return args.data(); }
+    size_t size() const { return args.size(); }
+};
+
+/// Find the buffers used by a kernel, and if it modifies each of them
+class BufferSearcher : public FunctorBufferWalker
+{
+public:
+    std::map<struct rw_info*, bool> bufs;
+    void visit_buffer(struct rw_info* rw, bool modify, bool isArray) override {
+        bufs[rw] = bufs[rw] || modify;
+    }
+};
+
 } // namespace Kalmar
 /** \endcond */
@@ -23,16 +23,58 @@
 #include "llvm/Support/FileSystem.h"
 #include "llvm/Support/raw_ostream.h"
 #include "ParallelRewriter.h"
+#include <algorithm>
 using namespace clang;
 
 #define LLVM_OVERRIDE override
 
 raw_ostream & parallel::RewriteBuffer::write(raw_ostream &os) const {
-  // FIXME: eliminate the copy by writing out each chunk at a time
-  os << std::string(begin(), end());
+  // Stream the rope out a chunk at a time, instead of copying all of it into
+  // a string first.
+  char Chunk[4096];
+  unsigned Size = 0;
+  for (iterator I = begin(), E = end(); I != E; ++I) {
+    Chunk[Size++] = *I;
+    if (Size == sizeof(Chunk)) {
+      os.write(Chunk, Size);
+      Size = 0;
+    }
+  }
+  os.write(Chunk, Size);
   return os;
 }
 
+bool parallel::RewriteBuffer::isEdited(unsigned OrigBegin, unsigned OrigEnd) const {
+  if (OrigBegin >= OrigEnd)
+    return false;
+  // The ranges are disjoint, so only the last one starting before OrigEnd
+  // may overlap.
+  std::map<unsigned, unsigned>::const_iterator I = Edited.lower_bound(OrigEnd);
+  if (I == Edited.begin())
+    return false;
+  --I;
+  return I->second > OrigBegin;
+}
+
+void parallel::RewriteBuffer::MarkEdited(unsigned OrigBegin, unsigned OrigEnd) {
+  if (OrigEnd <= OrigBegin)
+    OrigEnd = OrigBegin + 1;
+  // Merge the ranges overlapping or adjacent to the new one into it.
+  std::map<unsigned, unsigned>::iterator I = Edited.upper_bound(OrigBegin);
+  if (I != Edited.begin()) {
+    std::map<unsigned, unsigned>::iterator Prev = I;
+    --Prev;
+    if (Prev->second >= OrigBegin)
+      I = Prev;
+  }
+  while (I != Edited.end() && I->first <= OrigEnd) {
+    OrigBegin = std::min(OrigBegin, I->first);
+    OrigEnd = std::max(OrigEnd, I->second);
+    Edited.erase(I++);
+  }
+  Edited[OrigBegin] = OrigEnd;
+}
+
 /// \brief Return true if this character is non-new-line whitespace:
 /// ' ', '\\t', '\\f', '\\v', '\\r'.
 static inline bool isWhitespace(unsigned char c) {
@@ -61,6 +103,7 @@ void parallel::RewriteBuffer::RemoveText(unsigned OrigOffset, unsigned Size,
 
   // Add a delta so that future changes are offset correctly.
   AddReplaceDelta(OrigOffset, -Size);
+  MarkEdited(OrigOffset, OrigOffset + Size);
 
   if (removeLineIfEmpty) {
     // Find the line that the remove occurred and if it is completely empty
@@ -87,6 +130,9 @@ void parallel::RewriteBuffer::RemoveText(unsigned OrigOffset, unsigned Size,
     if (posI != end() && *posI == '\n') {
       Buffer.erase(curLineStartOffs, lineSize + 1/* + '\n'*/);
       AddReplaceDelta(curLineStartOffs, -(lineSize + 1/* + '\n'*/));
+      // The line is found in the rewritten buffer, so no original range is
+      // known to be unedited anymore.
+      MarkEdited(0, ~0U);
     }
   }
 }
@@ -102,6 +148,7 @@ void parallel::RewriteBuffer::InsertText(unsigned OrigOffset, StringRef Str,
 
   // Add a delta so that future changes are offset correctly.
   AddInsertDelta(OrigOffset, Str.size());
+  MarkEdited(OrigOffset, OrigOffset);
 }
 
 /// ReplaceText - This method replaces a range of characters in the input
@@ -114,6 +161,7 @@ void parallel::RewriteBuffer::ReplaceText(unsigned OrigOffset, unsigned OrigLeng
   Buffer.insert(RealOffset, NewStr.begin(), NewStr.end());
   if (OrigLength != NewStr.size())
     AddReplaceDelta(OrigOffset, NewStr.size() - OrigLength);
+  MarkEdited(OrigOffset, OrigOffset + OrigLength);
 }
 
 
@@ -184,7 +232,10 @@ std::string parallel::Rewriter::getRewrittenText(SourceRange Range) const {
   // have changed.
   std::map<FileID, RewriteBuffer>::const_iterator I =
     RewriteBuffers.find(StartFileID);
-  if (I == RewriteBuffers.end()) {
+  // The range is unedited if no change was made in it, up to the end of its
+  // last token.
+  if (I == RewriteBuffers.end() ||
+      !I->second.isEdited(StartOff, EndOff + Lexer::MeasureTokenLength(Range.getEnd(), *SourceMgr, *LangOpts))) {
     // If the buffer hasn't been rewritten, just return the text from the input.
     const char *Ptr = SourceMgr->getCharacterData(Range.getBegin());
 
@@ -47,6 +47,12 @@ class RewriteBuffer {
   /// instead.
   typedef RewriteRope BufferTy;
   BufferTy Buffer;
+
+  /// Edited - The ranges of the original buffer which text is inserted into,
+  /// removed from or replaced in, merged into disjoint ranges keyed by their
+  /// start offset, so the text of unedited ranges is taken from the original
+  /// buffer instead of walking the rope.
+  std::map<unsigned, unsigned> Edited;
 public:
   typedef BufferTy::const_iterator iterator;
   iterator begin() const { return Buffer.begin(); }
@@ -59,6 +65,10 @@ public:
   /// The original buffer is not actually changed.
   raw_ostream &write(raw_ostream &Stream) const;
 
+  /// isEdited - Return true if any change was made in the range
+  /// [OrigBegin, OrigEnd) of the original buffer.
+  bool isEdited(unsigned OrigBegin, unsigned OrigEnd) const;
+
   /// RemoveText - Remove the specified text.
   void RemoveText(unsigned OrigOffset, unsigned Size,
                   bool removeLineIfEmpty = false);
@@ -121,6 +131,10 @@ private:  // Methods only usable by Rewriter.
   void AddReplaceDelta(unsigned OrigOffset, int Change) {
     return Deltas.AddDelta(2*OrigOffset+1, Change);
   }
+
+  /// MarkEdited - Record that the range [OrigBegin, OrigEnd) of the original
+  /// buffer is changed. An insertion marks the character it's inserted at.
+  void MarkEdited(unsigned OrigBegin, unsigned OrigEnd);
 };
 
 
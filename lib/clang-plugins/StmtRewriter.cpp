@@ -34,6 +34,7 @@
 #include "clang/Frontend/CompilerInstance.h"
 #include "clang/Frontend/FrontendPluginRegistry.h"
 #include "clang/Lex/HeaderSearch.h"
+#include "clang/Lex/Lexer.h"
 #include "clang/Lex/Preprocessor.h"
 #include "llvm/Support/Host.h"
 #include "llvm/Support/raw_ostream.h"
@@ -50,9 +51,69 @@ using namespace clang;
 #define RW_EXPAND_ARG_MACROS (1<<11)
 // For extensions
 #define RW_BOLT_CL_BACKEND        (1<<12) // N.A. for now
+// Keep the container of consecutive Bolt calls in one device_vector
+#define RW_DEVICE_VECTOR_CHAINS   (1<<13)
 // For debug purpose
 #define RW_BOLT_2_STL_CALL           (1<<20)
 
+// Calls on fewer elements than this, if known at compile time, are left as
+// STL calls, since the transfers and the launch would cost more than the call
+#define RW_MIN_DEVICE_ELEMENTS    (1<<12)
+
+// Eligible calls which don't write into the ranges they are given
+static const char* ReadOnlyCalls[] = {
+  "binary_search", "count", "count_if", "inner_product", "max_element",
+  "min_element", "reduce", "transform_reduce"
+};
+
+// Strip the implicit nodes around the expression of a statement
+static Expr* StripImplicit(Expr* E) {
+  while (true) {
+    if (ExprWithCleanups* EWC = dyn_cast<ExprWithCleanups>(E))
+      E = EWC->getSubExpr();
+    else if (ImplicitCastExpr* ICE = dyn_cast<ImplicitCastExpr>(E))
+      E = ICE->getSubExpr();
+    else if (MaterializeTemporaryExpr* MTE = dyn_cast<MaterializeTemporaryExpr>(E))
+      E = MTE->GetTemporaryExpr();
+    else if (CXXBindTemporaryExpr* BTE = dyn_cast<CXXBindTemporaryExpr>(E))
+      E = BTE->getSubExpr();
+    else
+      return E;
+  }
+}
+
+// Find the std::vector variables the arguments of a call refer to, and the
+// begin() and end() calls on them
+class ContainerUses : public RecursiveASTVisitor<ContainerUses> {
+  bool (*IsContainer)(QualType);
+public:
+  std::map<const VarDecl*, unsigned> Refs;
+  std::map<const VarDecl*, std::vector<DeclRefExpr*> > IteratorObjects;
+
+  explicit ContainerUses(bool (*IsContainer)(QualType)) : IsContainer(IsContainer) {}
+
+  bool VisitDeclRefExpr(DeclRefExpr* E) {
+    if (VarDecl* VD = dyn_cast<VarDecl>(E->getDecl()))
+      if (IsContainer(VD->getType()))
+        Refs[VD]++;
+    return true;
+  }
+
+  bool VisitCXXMemberCallExpr(CXXMemberCallExpr* E) {
+    CXXMethodDecl* MD = E->getMethodDecl();
+    if (!MD || !MD->getIdentifier())
+      return true;
+    StringRef Name = MD->getName();
+    if (Name != "begin" && Name != "end" && Name != "cbegin" && Name != "cend")
+      return true;
+    if (DeclRefExpr* DRE = dyn_cast<DeclRefExpr>(E->getImplicitObjectArgument()->IgnoreParenImpCasts()))
+      if (VarDecl* VD = dyn_cast<VarDecl>(DRE->getDecl()))
+        if (IsContainer(VD->getType()))
+          IteratorObjects[VD].push_back(DRE);
+    return true;
+  }
+};
+
 class CallsVisitor: public RecursiveASTVisitor<CallsVisitor> {
   // This maps an original source AST to it's rewritten form. This allows
   // us to avoid rewriting the same node twice (which is very uncommon).
@@ -65,6 +126,19 @@ class CallsVisitor: public RecursiveASTVisitor<CallsVisitor> {
   CompilerInstance& Compiler;
   StringRef SourceFile;
   unsigned RWOpts;
+  unsigned ChainCount;            // device_vectors declared so far
+
+  // the transfers of the device_vector of a chain of calls
+  struct ChainTransfer {
+    SourceLocation Begin;
+    std::string Upload;
+    SourceLocation End;
+    std::string Download;
+    ChainTransfer(SourceLocation Begin, const std::string& Upload,
+                  SourceLocation End, const std::string& Download)
+      : Begin(Begin), Upload(Upload), End(End), Download(Download) {}
+  };
+  std::vector<ChainTransfer> ChainTransfers;
   std::string BoltBKN;            // backend name as: "amp"
   std::string BoltNS;               // namespace as: "bolt::amp::"
   std::string BoltDirname;  // dirname with trailing '/' as: "bolt/amp/"
@@ -77,7 +151,7 @@ class CallsVisitor: public RecursiveASTVisitor<CallsVisitor> {
 
 public:
   CallsVisitor(CompilerInstance& CI, StringRef InFile, unsigned Options) 
-    : Compiler(CI), SourceFile(InFile), RWOpts(Options), BoltBKN("amp") {
+    : Compiler(CI), SourceFile(InFile), RWOpts(Options), ChainCount(0), BoltBKN("amp") {
     Context = &CI.getASTContext();
     Rw.setSourceMgr(Context->getSourceManager(),Context->getLangOpts());
     if (RWOpts & RW_BOLT_CL_BACKEND)
@@ -137,6 +211,8 @@ public:
   }
 
   int SaveRewrittenFiles() {
+    InsertChainTransfers();
+
     for (parallel::Rewriter::buffer_iterator I = Rw.buffer_begin(),
                                  E = Rw.buffer_end(); I != E; ++I) {
       const FileEntry *Entry = Rw.getSourceMgr().getFileEntryForID(I->first);
@@ -192,8 +268,8 @@ public:
 
   // FIXME: getQualifiedNameAsString does not work even by giving PringtingPolicy 
   // Borrow implementation of getQualifiedNameAsString from class NameDecl in here
-  StringRef getFirstNamespace(FunctionDecl* FD) const {
-    const DeclContext *Ctx = FD->getDeclContext();
+  static StringRef getFirstNamespace(const Decl* D) {
+    const DeclContext *Ctx = D->getDeclContext();
     if (Ctx->isFunctionOrMethod()) {
       return StringRef();
     }
@@ -221,6 +297,178 @@ public:
     return StringRef();
   }
 
+  static bool IsStdVector(QualType T) {
+    const CXXRecordDecl* RD = T.getNonReferenceType()->getAsCXXRecordDecl();
+    return RD && RD->getIdentifier() && RD->getName() == "vector" &&
+           getFirstNamespace(RD) == StringRef("std");
+  }
+
+  // The eligible STL call of a statement of a chain, as the whole expression
+  // of a statement, or the initializer of a scalar variable, null otherwise
+  CallExpr* getChainCall(Stmt* S) const {
+    Expr* E = dyn_cast<Expr>(S);
+    if (DeclStmt* DS = dyn_cast<DeclStmt>(S)) {
+      VarDecl* VD = DS->isSingleDecl() ? dyn_cast<VarDecl>(DS->getSingleDecl()) : 0;
+      // an iterator returned into the device_vector would outlive it
+      if (!VD || !VD->getInit() || !VD->getType()->isArithmeticType())
+        return 0;
+      E = VD->getInit();
+    }
+    CallExpr* CE = E ? dyn_cast<CallExpr>(StripImplicit(E)) : 0;
+    FunctionDecl* FD = CE ? CE->getDirectCallee() : 0;
+    if (!FD || !FD->getIdentifier() || !IsEligibleSTLCall(FD->getName()) ||
+        getFirstNamespace(FD) != StringRef("std"))
+      return 0;
+    return CE;
+  }
+
+  // The only container the iterators given to the call point into, as
+  // begin() and end() of a std::vector variable, null for other arguments
+  const VarDecl* getContainer(CallExpr* E, std::vector<DeclRefExpr*>* Objects = 0) const {
+    ContainerUses Uses(&IsStdVector);
+    for (unsigned i = 0, e = E->getNumArgs(); i != e; ++i) {
+      // raw pointers may point anywhere in host memory
+      if (E->getArg(i)->getType()->isPointerType())
+        return 0;
+      Uses.TraverseStmt(E->getArg(i));
+    }
+    if (Uses.Refs.size() != 1 || Uses.IteratorObjects.size() != 1)
+      return 0;
+    const VarDecl* VD = Uses.Refs.begin()->first;
+    const std::vector<DeclRefExpr*>& Iterators = Uses.IteratorObjects[VD];
+    // the container is only used through its iterators
+    if (Iterators.size() != Uses.Refs[VD])
+      return 0;
+    for (unsigned i = 0, e = Iterators.size(); i != e; ++i)
+      if (!parallel::Rewriter::isRewritable(Iterators[i]->getLocStart()))
+        return 0;
+    if (Objects)
+      *Objects = Iterators;
+    return VD;
+  }
+
+  // The number of elements of a container constructed with a constant size,
+  // -1 if unknown
+  int64_t getKnownSize(const VarDecl* VD) const {
+    const Expr* Init = VD->getInit();
+    const CXXConstructExpr* CE = Init ? dyn_cast<CXXConstructExpr>(StripImplicit(const_cast<Expr*>(Init))) : 0;
+    llvm::APSInt Size;
+    if (!CE || CE->getNumArgs() == 0 || isa<CXXDefaultArgExpr>(CE->getArg(0)) ||
+        !CE->getArg(0)->getType()->isIntegerType() ||
+        !CE->getArg(0)->EvaluateAsInt(Size, *Context))
+      return -1;
+    return Size.getSExtValue();
+  }
+
+  // Whether the call is known to work on too few elements to profit from
+  // the device, from the count of a _n call or the size of its container
+  bool IsTooSmall(CallExpr* E) const {
+    const FunctionDecl* FD = E->getDirectCallee();
+    llvm::APSInt Count;
+    if (FD->getName().endswith("_n") && E->getNumArgs() > 1 &&
+        E->getArg(1)->EvaluateAsInt(Count, *Context))
+      return Count.getSExtValue() < RW_MIN_DEVICE_ELEMENTS;
+    const VarDecl* VD = getContainer(E);
+    int64_t Size = VD ? getKnownSize(VD) : -1;
+    return Size >= 0 && Size < RW_MIN_DEVICE_ELEMENTS;
+  }
+
+  static bool WritesRanges(StringRef CallName) {
+    for (unsigned i = 0; i < sizeof(ReadOnlyCalls) / sizeof(ReadOnlyCalls[0]); ++i)
+      if (CallName == ReadOnlyCalls[i])
+        return false;
+    return true;
+  }
+
+  // The location just past a statement of a chain, after its semicolon
+  SourceLocation getLocAfterStmt(Stmt* S) const {
+    const SourceManager& SM = Context->getSourceManager();
+    const LangOptions& LO = Context->getLangOpts();
+    if (isa<DeclStmt>(S))
+      return Lexer::getLocForEndOfToken(S->getLocEnd(), 0, SM, LO);
+    return Lexer::findLocationAfterToken(S->getLocEnd(), tok::semi, SM, LO, false);
+  }
+
+  // Rewrite a chain of calls on one container to work on a device_vector
+  // uploaded once before the first call, and downloaded once after the last
+  // one if any of them writes into it. The transfers are inserted once the
+  // calls are rewritten, see InsertChainTransfers()
+  void RewriteChain(const VarDecl* VD, const std::vector<Stmt*>& Stmts,
+                    const std::vector<DeclRefExpr*>& Objects, bool Writes) {
+    SourceLocation Begin = Stmts.front()->getLocStart();
+    SourceLocation End = getLocAfterStmt(Stmts.back());
+    if (!parallel::Rewriter::isRewritable(Begin) || End.isInvalid() ||
+        !parallel::Rewriter::isRewritable(End))
+      return;
+
+    std::string Name = VD->getName();
+    std::string DeviceName = "bolt_dv_" + Name + "_" + std::to_string(ChainCount++);
+
+    std::string Upload;
+    Upload += BoltNS + "device_vector<std::remove_reference<decltype(" + Name + ")>::type::value_type> ";
+    Upload += DeviceName + "(" + Name + ".begin(), " + Name + ".end());\n";
+    HeadersToAdd[Name2HeaderMap["device_vector"]] = true;
+
+    for (unsigned i = 0, e = Objects.size(); i != e; ++i)
+      Rw.ReplaceText(Objects[i]->getSourceRange(), DeviceName);
+
+    std::string Download;
+    if (Writes) {
+      Download += "\n" + BoltNS + "copy(" + DeviceName + ".begin(), " + DeviceName + ".end(), ";
+      Download += Name + ".begin());";
+      HeadersToAdd[Name2HeaderMap["copy"]] = true;
+    }
+    ChainTransfers.push_back(ChainTransfer(Begin, Upload, End, Download));
+  }
+
+  // Insert the transfers of the chains, after the calls are rewritten, which
+  // would replace text inserted at their beginning otherwise
+  void InsertChainTransfers() {
+    for (unsigned i = 0, e = ChainTransfers.size(); i != e; ++i) {
+      const ChainTransfer& T = ChainTransfers[i];
+      Rw.InsertText(T.Begin, T.Upload, /*InsertAfter*/false, /*indentNewLines*/true);
+      if (!T.Download.empty())
+        Rw.InsertText(T.End, T.Download, /*InsertAfter*/true, /*indentNewLines*/true);
+    }
+    ChainTransfers.clear();
+  }
+
+  // Find chains of consecutive eligible calls on the same container in a
+  // block, which would transfer the container on each call otherwise
+  bool VisitCompoundStmt(CompoundStmt* CS) {
+    // the expanded calls are printed from the AST, without the device_vector
+    if (!(RWOpts & RW_STL_2_BOLT_CALL) || !(RWOpts & RW_DEVICE_VECTOR_CHAINS) ||
+        (RWOpts & RW_EXPAND_ARG_MACROS))
+      return true;
+
+    const VarDecl* Container = 0;
+    std::vector<Stmt*> Stmts;
+    std::vector<DeclRefExpr*> Objects;
+    bool Writes = false;
+    for (CompoundStmt::body_iterator I = CS->body_begin(), E = CS->body_end(); ; ++I) {
+      CallExpr* Call = (I != E) ? getChainCall(*I) : 0;
+      std::vector<DeclRefExpr*> CallObjects;
+      const VarDecl* VD = (Call && !IsTooSmall(Call)) ? getContainer(Call, &CallObjects) : 0;
+      if (!VD || VD != Container) {
+        // a single call transfers the container once anyway
+        if (Stmts.size() > 1)
+          RewriteChain(Container, Stmts, Objects, Writes);
+        Container = VD;
+        Stmts.clear();
+        Objects.clear();
+        Writes = false;
+      }
+      if (I == E)
+        break;
+      if (!VD)
+        continue;
+      Stmts.push_back(*I);
+      Objects.insert(Objects.end(), CallObjects.begin(), CallObjects.end());
+      Writes |= WritesRanges(Call->getDirectCallee()->getName());
+    }
+    return true;
+  }
+
   // FIXME: Since poisoned libstdc++ linked in libLLVM*, we can't use 
   // Rewriter::ReplaceStmt and other std::string, raw_os_stream related 
   // in our applications with libc++ linked
@@ -306,7 +554,7 @@ public:
       if (FunctionDecl* FD = E->getDirectCallee()) {
         StringRef FuncName = FD->getName();
         if ((RWOpts & RW_STL_2_BOLT_CALL) && IsEligibleSTLCall(FuncName) &&
-          getFirstNamespace(FD) == StringRef("std")) {
+          getFirstNamespace(FD) == StringRef("std") && !IsTooSmall(E)) {
          
           // Indicate that we need to include this function's header
           HeadersToAdd[Name2HeaderMap[FuncName]] = true;
@@ -423,6 +671,7 @@ public:
   bool ParseArgs(const CompilerInstance &CI, const std::vector<std::string>& args) {
     // Enable to rewrite STL calls with Bolt amp calls by default
     RWOpts |= RW_STL_2_BOLT_CALL;
+    RWOpts |= RW_DEVICE_VECTOR_CHAINS;
     
     // TODO: Due to poisonous libstdc++ from cfe, args are not meaningful for now
     #if 0
@@ -18,11 +18,11 @@ extern "C" void PushArgImpl(void *ker, int idx, size_t sz, const void *v) {}
 
 namespace Kalmar {
 
-class CPUFallbackQueue final : public KalmarQueue
+class CPUFallbackQueue final : public CPUTaskQueue
 {
 public:
 
-  CPUFallbackQueue(KalmarDevice* pDev) : KalmarQueue(pDev) {}
+  CPUFallbackQueue(KalmarDevice* pDev, execute_order order) : CPUTaskQueue(pDev, order) {}
 
   void read(void* device, void* dst, size_t count, size_t offset) override {
       if (dst != device)
@@ -45,7 +45,7 @@ public:
 
   void unmap(void* device, void* addr, size_t count, size_t offset, bool modify) override {}
 
-  void Push(void *kernel, int idx, void* device, bool isConst) override {}
+  void Push(void *kernel, int idx, void* device, bool isConst, struct dev_info* dev) override {}
 };
 
 class CPUFallbackDevice final : public KalmarDevice
@@ -63,13 +63,13 @@ public:
     uint32_t get_version() const override { return 0; }
 
     void* create(size_t count, struct rw_info* /* not used */) override {
-        return kalmar_aligned_alloc(0x1000, count);
+        return kalmar_host_alloc(count);
     }
-    void release(void *device, struct rw_info* /* not used */ ) override { 
-        kalmar_aligned_free(device);
+    void release(void *device, struct rw_info* key) override { 
+        kalmar_host_free(device, key->count);
     }
     std::shared_ptr<KalmarQueue> createQueue(execute_order order = execute_in_order) override {
-        return std::shared_ptr<KalmarQueue>(new CPUFallbackQueue(this));
+        return std::shared_ptr<KalmarQueue>(new CPUFallbackQueue(this, order));
     }
 };
 
@@ -78,7 +78,7 @@ template <typename T> inline void deleter(T* ptr) { delete ptr; }
 class CPUContext final : public KalmarContext
 {
 public:
-    CPUContext() { Devices.push_back(new CPUFallbackDevice); }
+    CPUContext() { add_device(new CPUFallbackDevice); }
     ~CPUContext() { std::for_each(std::begin(Devices), std::end(Devices), deleter<KalmarDevice>); }
 };
 
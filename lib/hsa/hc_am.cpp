@@ -15,8 +15,15 @@
 //=========================================================================================================
 // Pointer Tracker Structures:
 //=========================================================================================================
-#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <iostream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace hc {
 AmPointerInfo & AmPointerInfo::operator= (const AmPointerInfo &other) 
@@ -27,6 +34,7 @@ AmPointerInfo & AmPointerInfo::operator= (const AmPointerInfo &other)
     _acc = other._acc;
     _isInDeviceMem = other._isInDeviceMem;
     _isAmManaged = other._isAmManaged;
+    _isPeerDirect = other._isPeerDirect;
     _appId = other._appId;
     _appAllocationFlags = other._appAllocationFlags;
 
@@ -43,21 +51,11 @@ struct AmMemoryRange {
         _basePointer(basePointer), _endPointer((const unsigned char*)basePointer + sizeBytes - 1) {};
 };
 
-// Functor to compare ranges:
-struct AmMemoryRangeCompare {
-    // Return true is LHS range is less than RHS - used to order the 
-    bool operator()(const AmMemoryRange &lhs, const AmMemoryRange &rhs) const
-    {
-        return lhs._endPointer < rhs._basePointer;
-    }
-
-};
-
-
 std::ostream &operator<<(std::ostream &os, const hc::AmPointerInfo &ap)
 {
     os << "hostPointer:" << ap._hostPointer << " devicePointer:"<< ap._devicePointer << " sizeBytes:" << ap._sizeBytes
        << " isInDeviceMem:" << ap._isInDeviceMem  << " isAmManaged:" << ap._isAmManaged 
+       << " isPeerDirect:" << ap._isPeerDirect
        << " appId:" << ap._appId << " appAllocFlags:" << ap._appAllocationFlags;
     return os;
 }
@@ -67,39 +65,129 @@ std::ostream &operator<<(std::ostream &os, const hc::AmPointerInfo &ap)
 // This structure tracks information for each pointer.
 // Uses memory-range-based lookups - so pointers that exist anywhere in the range of hostPtr + size 
 // will find the associated AmPointerInfo.
-// The insertions and lookups use a self-balancing binary tree and should support O(logN) lookup speed.
-// The structure is thread-safe - writers obtain a mutex before modifying the tree.  Multiple simulatenous readers are supported.
+// The ranges are kept in an immutable table sorted by base pointer, so lookups are binary searches.
+// The structure is thread-safe, in the manner of RCU:
+//  - Readers never block: they pin the current table by bumping one of two reader counters, read it,
+//    and unpin it.  No mutex is involved.
+//  - Writers obtain a mutex, build a new table from the current one, publish it, and free the previous
+//    table once the readers which could have pinned it are gone.
+// Batches of insertions or removals build a single new table.
 class AmPointerTracker {
-typedef std::map<AmMemoryRange, hc::AmPointerInfo, AmMemoryRangeCompare> MapTrackerType;
 public:
+    typedef std::pair<AmMemoryRange, hc::AmPointerInfo> EntryType;
+    typedef std::vector<EntryType> TableType;
+
+    AmPointerTracker() : _table(new TableType()), _epoch(0) {
+        _readers[0].store(0);
+        _readers[1].store(0);
+    }
+
+    ~AmPointerTracker() { delete _table.load(); }
 
     void insert(void *pointer, const hc::AmPointerInfo &p);
+    void insert(size_t count, void * const *pointers, const hc::AmPointerInfo *p);
     int remove(void *pointer);
+    size_t remove(size_t count, void * const *pointers);
 
-    MapTrackerType::iterator find(const void *hostPtr) ;
-    
-    MapTrackerType::iterator readerLockBegin() { _mutex.lock(); return _tracker.begin(); } ;
-    MapTrackerType::iterator end() { return _tracker.end(); } ;
-    void readerUnlock() { _mutex.unlock(); };
+    // Copy info of the range holding pointer, return false if there's none.
+    bool find(const void *pointer, hc::AmPointerInfo *info);
+    // Append to entries the ranges holding the pointers, each range once, in a single pass over the table.
+    // Returns count of pointers found.
+    size_t find(size_t count, void * const *pointers, TableType *entries);
+    bool update(const void *pointer, int appId, unsigned allocationFlags);
 
+    // Pin the current table for reading, which must be followed by readerUnlock(epoch).
+    const TableType *readerLock(int *epoch);
+    void readerUnlock(int epoch) { _readers[epoch].fetch_sub(1, std::memory_order_release); }
 
     size_t reset (const hc::accelerator &acc);
     void update_peers (const hc::accelerator &acc, int peerCnt, hsa_agent_t *peerAgents) ;
 
 private:
-    MapTrackerType  _tracker;
-    std::mutex      _mutex;
-    //std::shared_timed_mutex _mut;
+    // Index of the entry of the range holding pointer in table, or table.size() if there's none.
+    static size_t lookup(const TableType &table, const void *pointer);
+
+    // Publish table in place of the current one, and free the current one once no reader uses it.
+    // Called with _mutex held.
+    void publish(TableType *table);
+
+    std::atomic<TableType*> _table;
+    std::atomic<int>        _epoch;
+    std::atomic<long>       _readers[2];
+    std::mutex              _mutex;  // Serializes writers.
 };
 
 
+//---
+size_t AmPointerTracker::lookup(const TableType &table, const void *pointer)
+{
+    // First range whose base is above pointer; the one before it is the only candidate.
+    auto iter = std::upper_bound(table.begin(), table.end(), pointer,
+                                 [](const void *p, const EntryType &e) { return p < e.first._basePointer; });
+    if (iter == table.begin()) {
+        return table.size();
+    }
+    --iter;
+    return (pointer <= iter->first._endPointer) ? (iter - table.begin()) : table.size();
+}
+
+
+//---
+const AmPointerTracker::TableType *AmPointerTracker::readerLock(int *epoch)
+{
+    *epoch = _epoch.load(std::memory_order_seq_cst);
+    _readers[*epoch].fetch_add(1, std::memory_order_seq_cst);
+    return _table.load(std::memory_order_seq_cst);
+}
+
+
+//---
+void AmPointerTracker::publish(TableType *table)
+{
+    TableType *old = _table.exchange(table, std::memory_order_seq_cst);
+
+    // Readers which may still use the old table are counted on either side of the epoch: flip the epoch
+    // twice, waiting each time for the readers of the previous side to leave.
+    for (int i = 0; i < 2; ++i) {
+        int epoch = _epoch.load(std::memory_order_relaxed);
+        _epoch.store(1 - epoch, std::memory_order_seq_cst);
+        while (_readers[epoch].load(std::memory_order_seq_cst) != 0) {
+            std::this_thread::yield();
+        }
+    }
+    delete old;
+}
+
+
 //---
 void AmPointerTracker::insert (void *pointer, const hc::AmPointerInfo &p)
+{
+    insert(1, &pointer, &p);
+}
+
+
+//---
+void AmPointerTracker::insert (size_t count, void * const *pointers, const hc::AmPointerInfo *p)
 {
     std::lock_guard<std::mutex> l (_mutex);
 
-    mprintf ("insert: %p + %zu\n", pointer, p._sizeBytes);
-    _tracker.insert(std::make_pair(AmMemoryRange(pointer, p._sizeBytes), p));
+    const TableType &current = *_table.load(std::memory_order_relaxed);
+    TableType added;
+    added.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        mprintf ("insert: %p + %zu\n", pointers[i], p[i]._sizeBytes);
+        // A range already tracked is left as it is.
+        if (lookup(current, pointers[i]) == current.size()) {
+            added.push_back(std::make_pair(AmMemoryRange(pointers[i], p[i]._sizeBytes), p[i]));
+        }
+    }
+    auto lessBase = [](const EntryType &a, const EntryType &b) { return a.first._basePointer < b.first._basePointer; };
+    std::sort(added.begin(), added.end(), lessBase);
+
+    TableType *table = new TableType();
+    table->reserve(current.size() + added.size());
+    std::merge(current.begin(), current.end(), added.begin(), added.end(), std::back_inserter(*table), lessBase);
+    publish(table);
 }
 
 
@@ -107,19 +195,98 @@ void AmPointerTracker::insert (void *pointer, const hc::AmPointerInfo &p)
 // Return 1 if removed or 0 if not found.
 int AmPointerTracker::remove (void *pointer)
 {
-    std::lock_guard<std::mutex> l (_mutex);
-    mprintf ("remove: %p\n", pointer);
-    return _tracker.erase(AmMemoryRange(pointer,1));
+    return remove(1, &pointer);
 }
 
 
 //---
-AmPointerTracker::MapTrackerType::iterator  AmPointerTracker::find (const void *pointer)
+// Return the number of ranges removed.
+size_t AmPointerTracker::remove (size_t count, void * const *pointers)
 {
     std::lock_guard<std::mutex> l (_mutex);
-    auto iter = _tracker.find(AmMemoryRange(pointer,1));
+
+    const TableType &current = *_table.load(std::memory_order_relaxed);
+    std::vector<bool> removed(current.size(), false);
+    size_t numRemoved = 0;
+    for (size_t i = 0; i < count; i++) {
+        mprintf ("remove: %p\n", pointers[i]);
+        size_t index = lookup(current, pointers[i]);
+        if (index != current.size() && !removed[index]) {
+            removed[index] = true;
+            numRemoved++;
+        }
+    }
+    if (numRemoved == 0) {
+        return 0;
+    }
+
+    TableType *table = new TableType();
+    table->reserve(current.size() - numRemoved);
+    for (size_t i = 0; i < current.size(); i++) {
+        if (!removed[i]) {
+            table->push_back(current[i]);
+        }
+    }
+    publish(table);
+    return numRemoved;
+}
+
+
+//---
+bool AmPointerTracker::find (const void *pointer, hc::AmPointerInfo *info)
+{
+    int epoch;
+    const TableType *table = readerLock(&epoch);
+    size_t index = lookup(*table, pointer);
+    bool found = (index != table->size());
+    if (found) {
+        *info = (*table)[index].second;
+    }
+    readerUnlock(epoch);
     mprintf ("find: %p\n", pointer);
-    return iter;
+    return found;
+}
+
+
+//---
+size_t AmPointerTracker::find (size_t count, void * const *pointers, TableType *entries)
+{
+    int epoch;
+    const TableType *table = readerLock(&epoch);
+    std::vector<size_t> indices;
+    indices.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        size_t index = lookup(*table, pointers[i]);
+        if (index != table->size()) {
+            indices.push_back(index);
+        }
+    }
+    size_t found = indices.size();
+    std::sort(indices.begin(), indices.end());
+    indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+    for (auto index : indices) {
+        entries->push_back((*table)[index]);
+    }
+    readerUnlock(epoch);
+    return found;
+}
+
+
+//---
+bool AmPointerTracker::update (const void *pointer, int appId, unsigned allocationFlags)
+{
+    std::lock_guard<std::mutex> l (_mutex);
+
+    const TableType &current = *_table.load(std::memory_order_relaxed);
+    size_t index = lookup(current, pointer);
+    if (index == current.size()) {
+        return false;
+    }
+    TableType *table = new TableType(current);
+    (*table)[index].second._appId              = appId;
+    (*table)[index].second._appAllocationFlags = allocationFlags;
+    publish(table);
+    return true;
 }
 
 
@@ -131,42 +298,42 @@ size_t AmPointerTracker::reset (const hc::accelerator &acc)
     std::lock_guard<std::mutex> l (_mutex);
     mprintf ("reset: \n");
 
+    const TableType &current = *_table.load(std::memory_order_relaxed);
+    TableType *table = new TableType();
     size_t count = 0;
-    // relies on C++11 (erase returns iterator)
-    for (auto iter = _tracker.begin() ; iter != _tracker.end(); ) {
+    for (auto iter = current.begin() ; iter != current.end(); iter++) {
         if (iter->second._acc == acc) {
             if (iter->second._isAmManaged) {
                 hsa_amd_memory_pool_free(const_cast<void*> (iter->first._basePointer));
             }
             count++;
-
-            iter = _tracker.erase(iter);
         } else {
-            iter++;
+            table->push_back(*iter);
         }
     }
+    publish(table);
 
     return count;
 }
 
 
 //---
-// Remove all tracked locations, and free the associated memory (if the range was originally allocated by AM).
-// Returns count of ranges removed.
+// Allow the peers to access the device memory tracked for acc.
 void AmPointerTracker::update_peers (const hc::accelerator &acc, int peerCnt, hsa_agent_t *peerAgents) 
 {
-    std::lock_guard<std::mutex> l (_mutex);
+    int epoch;
+    const TableType *table = readerLock(&epoch);
 
-    // relies on C++11 (erase returns iterator)
-    for (auto iter = _tracker.begin() ; iter != _tracker.end(); ) {
+    for (auto iter = table->begin() ; iter != table->end(); iter++) {
         if (iter->second._acc == acc) {
             if (iter->second._isInDeviceMem) {
                 printf ("update peers\n");
                 hsa_amd_agents_allow_access(peerCnt, peerAgents, NULL, const_cast<void*> (iter->first._basePointer));
             }
         } 
-        iter++;
     }
+
+    readerUnlock(epoch);
 }
 
 
@@ -176,6 +343,372 @@ void AmPointerTracker::update_peers (const hc::accelerator &acc, int peerCnt, hs
 AmPointerTracker g_amPointerTracker;  // Track all am pointer allocations.
 
 
+//=========================================================================================================
+// Suballocator Structures:
+//=========================================================================================================
+
+/// Size of the slabs which the suballocator obtains from HSA memory pools.
+#ifndef AM_POOL_SLAB_SIZE
+#define AM_POOL_SLAB_SIZE (4 * 1024 * 1024)
+#endif
+
+/// Smallest block handed out by the suballocator, also the alignment of every block.
+#ifndef AM_POOL_MIN_BLOCK
+#define AM_POOL_MIN_BLOCK (256)
+#endif
+
+/// Largest block handed out by the suballocator.  Pooled allocations above this size are allocated
+/// from HSA directly, like allocations without amPooled.
+#ifndef AM_POOL_MAX_BLOCK
+#define AM_POOL_MAX_BLOCK (1024 * 1024)
+#endif
+
+//-------------------------------------------------------------------------------------------------
+// Hands out power-of-two blocks sliced from large slabs, for am_alloc with amPooled.
+// Only the slabs are allocated from HSA and registered in g_amPointerTracker, so an
+// allocation served from a free block costs neither a driver call nor a tracker update.
+// Freed blocks are kept per size class for reuse, and are given back to HSA with their slab
+// only on reset.  Blocks freed with am_free_async are held until a marker enqueued on the
+// view at that point is ready.
+// The structure is thread-safe - all accesses are serialized with a mutex.
+class AmSuballocator {
+public:
+    // Slabs are also made accessible to peers, if not empty.
+    void *allocate(size_t sizeBytes, hc::accelerator &acc, hsa_amd_memory_pool_t region, hsa_agent_t *agent, bool hostPinned,
+                   const std::vector<hsa_agent_t> &peers);
+
+    // Return true if ptr is a block of the suballocator, which is then freed.
+    bool free(void *ptr);
+
+    // Free ptr once the work enqueued so far on av is finished.
+    // Pointers which are not blocks of the suballocator are freed with am_free.
+    void free_async(void *ptr, hc::accelerator_view &av);
+
+    // Give back the slabs allocated for acc to HSA.
+    // Returns count of slabs freed.
+    size_t reset(const hc::accelerator &acc);
+
+private:
+    static const int CLASS_COUNT = 32;
+
+    struct Pool {
+        Pool(hc::accelerator &acc, hsa_amd_memory_pool_t region, bool peerMapped) : _acc(acc), _region(region), _peerMapped(peerMapped) {};
+
+        hc::accelerator         _acc;
+        hsa_amd_memory_pool_t   _region;
+        bool                    _peerMapped;
+        std::vector<void*>      _slabs;
+        std::vector<void*>      _freeBlocks[CLASS_COUNT];
+    };
+
+    struct Block {
+        Pool *  _pool;
+        int     _class;
+    };
+
+    static int getClass(size_t sizeBytes) {
+        int c = 0;
+        while ((size_t(AM_POOL_MIN_BLOCK) << c) < sizeBytes) {
+            c++;
+        }
+        return c;
+    }
+
+    // Cut a new slab of pool in blocks of class c.  Called with _mutex held.
+    bool grow(Pool *pool, int c, hsa_agent_t *agent, bool hostPinned, const std::vector<hsa_agent_t> &peers);
+
+    // Move the blocks whose async free is complete back to their free lists, and collect the
+    // other pointers to be freed with am_free once _mutex is released.  Called with _mutex held.
+    void reclaim(std::vector<void*> *others);
+
+    std::vector<Pool*>                                      _pools;
+    std::map<void*, Block>                                  _blocks;
+    std::vector<std::pair<void*, hc::completion_future>>    _pending;
+    std::mutex                                              _mutex;
+};
+
+
+//---
+bool AmSuballocator::grow(Pool *pool, int c, hsa_agent_t *agent, bool hostPinned, const std::vector<hsa_agent_t> &peers)
+{
+    void *slab = NULL;
+    hsa_status_t s1 = hsa_amd_memory_pool_allocate(pool->_region, AM_POOL_SLAB_SIZE, 0, &slab);
+    if (s1 != HSA_STATUS_SUCCESS) {
+        return false;
+    }
+    if (hostPinned) {
+        s1 = hsa_amd_agents_allow_access(1, agent, NULL, slab);
+        if (s1 != HSA_STATUS_SUCCESS) {
+            hsa_amd_memory_pool_free(slab);
+            return false;
+        }
+    }
+    if (!peers.empty()) {
+        s1 = hsa_amd_agents_allow_access(peers.size(), peers.data(), NULL, slab);
+        if (s1 != HSA_STATUS_SUCCESS) {
+            hsa_amd_memory_pool_free(slab);
+            return false;
+        }
+    }
+    g_amPointerTracker.insert(slab,
+        hc::AmPointerInfo(hostPinned ? slab : NULL/*hostPointer*/, slab /*devicePointer*/, AM_POOL_SLAB_SIZE, pool->_acc, !hostPinned/*isDevice*/, true /*isAMManaged*/));
+    pool->_slabs.push_back(slab);
+
+    size_t blockSize = size_t(AM_POOL_MIN_BLOCK) << c;
+    for (size_t offset = AM_POOL_SLAB_SIZE; offset >= blockSize; offset -= blockSize) {
+        void *block = static_cast<char*>(slab) + offset - blockSize;
+        _blocks[block] = Block{pool, c};
+        pool->_freeBlocks[c].push_back(block);
+    }
+    mprintf ("grow: %p class %d\n", slab, c);
+    return true;
+}
+
+
+//---
+void AmSuballocator::reclaim(std::vector<void*> *others)
+{
+    auto ready = std::partition(_pending.begin(), _pending.end(),
+                                [](std::pair<void*, hc::completion_future> &p) {
+                                    // views without markers have nothing outstanding
+                                    return p.second.valid() && !p.second.is_ready();
+                                });
+    for (auto iter = ready; iter != _pending.end(); iter++) {
+        auto block = _blocks.find(iter->first);
+        if (block != _blocks.end()) {
+            block->second._pool->_freeBlocks[block->second._class].push_back(iter->first);
+        } else {
+            others->push_back(iter->first);
+        }
+    }
+    _pending.erase(ready, _pending.end());
+}
+
+
+//---
+void *AmSuballocator::allocate(size_t sizeBytes, hc::accelerator &acc, hsa_amd_memory_pool_t region, hsa_agent_t *agent, bool hostPinned,
+                               const std::vector<hsa_agent_t> &peers)
+{
+    std::vector<void*> others;
+    void *ptr = NULL;
+    {
+        std::lock_guard<std::mutex> l (_mutex);
+
+        reclaim(&others);
+
+        auto iter = std::find_if(_pools.begin(), _pools.end(),
+                                 [&](Pool *p) { return p->_acc == acc && p->_region.handle == region.handle &&
+                                                       p->_peerMapped == !peers.empty(); });
+        Pool *pool;
+        if (iter != _pools.end()) {
+            pool = *iter;
+        } else {
+            pool = new Pool(acc, region, !peers.empty());
+            _pools.push_back(pool);
+        }
+
+        int c = getClass(sizeBytes);
+        if (!pool->_freeBlocks[c].empty() || grow(pool, c, agent, hostPinned, peers)) {
+            ptr = pool->_freeBlocks[c].back();
+            pool->_freeBlocks[c].pop_back();
+        }
+    }
+
+    for (auto p : others) {
+        hc::am_free(p);
+    }
+    return ptr;
+}
+
+
+//---
+bool AmSuballocator::free(void *ptr)
+{
+    std::lock_guard<std::mutex> l (_mutex);
+
+    auto block = _blocks.find(ptr);
+    if (block == _blocks.end()) {
+        return false;
+    }
+    block->second._pool->_freeBlocks[block->second._class].push_back(ptr);
+    return true;
+}
+
+
+//---
+void AmSuballocator::free_async(void *ptr, hc::accelerator_view &av)
+{
+    hc::completion_future marker = av.create_marker();
+
+    std::vector<void*> others;
+    {
+        std::lock_guard<std::mutex> l (_mutex);
+
+        _pending.push_back(std::make_pair(ptr, marker));
+        reclaim(&others);
+    }
+
+    for (auto p : others) {
+        hc::am_free(p);
+    }
+}
+
+
+//---
+size_t AmSuballocator::reset(const hc::accelerator &acc)
+{
+    std::lock_guard<std::mutex> l (_mutex);
+
+    size_t count = 0;
+    for (auto iter = _pools.begin(); iter != _pools.end(); ) {
+        Pool *pool = *iter;
+        if (pool->_acc == acc) {
+            for (auto block = _blocks.begin(); block != _blocks.end(); ) {
+                if (block->second._pool == pool) {
+                    block = _blocks.erase(block);
+                } else {
+                    block++;
+                }
+            }
+            for (auto slab : pool->_slabs) {
+                g_amPointerTracker.remove(slab);
+                hsa_amd_memory_pool_free(slab);
+            }
+            count += pool->_slabs.size();
+            delete pool;
+            iter = _pools.erase(iter);
+        } else {
+            iter++;
+        }
+    }
+
+    return count;
+}
+
+
+AmSuballocator g_amSuballocator;  // Serve am_alloc with amPooled.
+
+
+//=========================================================================================================
+// Peer Mapping Structures:
+//=========================================================================================================
+
+//---
+// Collect in agents the agents of peers which may access the memory described by info, apart from the
+// accelerator owning device memory.
+// Returns AM_ERROR_MISC if the memory is not allocated by AM, or if a peer may never access it.
+static am_status_t get_peer_agents(const hc::AmPointerInfo &info, size_t num_peer, const hc::accelerator* peers,
+                                   std::vector<hsa_agent_t> *agents)
+{
+    hsa_amd_memory_pool_t* pool = nullptr;
+    if (info._isInDeviceMem) {
+        // get pool of device memory
+        pool = static_cast<hsa_amd_memory_pool_t*>(info._acc.get_hsa_am_region());
+    } else if (info._isAmManaged) {
+        //TODO: the memory is host memory, it might be allocated through am_alloc, 
+        // or allocated by others, but add it to the tracker.
+        // right now, only support host memory which is allocated through am_alloc.
+        // here, accelerator is the device, but used to query system memory pool
+        pool = static_cast<hsa_amd_memory_pool_t*>(info._acc.get_hsa_am_system_region());
+    } else {
+        return AM_ERROR_MISC;
+    }
+
+    for (size_t i = 0; i < num_peer; i++) {
+        // if memory is device memory, and the accelerator itself is included in the list, ignore it
+        const hc::accelerator &a = peers[i];
+        if (info._isInDeviceMem && a == info._acc) {
+            continue;
+        }
+
+        hsa_agent_t* agent = static_cast<hsa_agent_t*>(a.get_hsa_agent());
+
+        hsa_amd_memory_pool_access_t access;
+        hsa_status_t status = hsa_amd_agent_memory_pool_get_info(*agent, *pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_ACCESS, &access);
+        if (HSA_STATUS_SUCCESS != status) {
+            return AM_ERROR_MISC;
+        }
+
+        // check access
+        if (HSA_AMD_MEMORY_POOL_ACCESS_NEVER_ALLOWED == access) {
+            return AM_ERROR_MISC;
+        }
+
+        if (std::find_if(agents->begin(), agents->end(),
+                         [&](const hsa_agent_t &b) { return b.handle == agent->handle; }) == agents->end()) {
+            agents->push_back(*agent);
+        }
+    }
+
+    return AM_SUCCESS;
+}
+
+
+//-------------------------------------------------------------------------------------------------
+// Peers which memory allocated with amMapToPeers is made accessible to, for each accelerator.
+// The agents are resolved once, when the peers are set, for device memory and for pinned host memory.
+// The structure is thread-safe - all accesses are serialized with a mutex.
+class AmPeerTable {
+public:
+    am_status_t set(hc::accelerator &acc, size_t num_peer, const hc::accelerator* peers);
+
+    // Copy to agents the peer agents for memory of acc, device memory or pinned host memory.
+    void get(const hc::accelerator &acc, bool hostPinned, std::vector<hsa_agent_t> *agents);
+
+private:
+    struct Entry {
+        hc::accelerator             _acc;
+        std::vector<hsa_agent_t>    _deviceAgents;
+        std::vector<hsa_agent_t>    _hostAgents;
+    };
+
+    std::vector<Entry>  _entries;
+    std::mutex          _mutex;
+};
+
+
+//---
+am_status_t AmPeerTable::set(hc::accelerator &acc, size_t num_peer, const hc::accelerator* peers)
+{
+    Entry entry = { acc, std::vector<hsa_agent_t>(), std::vector<hsa_agent_t>() };
+    am_status_t status = AM_SUCCESS;
+    if (num_peer != 0) {
+        status = get_peer_agents(hc::AmPointerInfo(NULL, NULL, 0, acc, true/*isDevice*/, true/*isAMManaged*/),
+                                 num_peer, peers, &entry._deviceAgents);
+        if (status == AM_SUCCESS) {
+            status = get_peer_agents(hc::AmPointerInfo(NULL, NULL, 0, acc, false/*isDevice*/, true/*isAMManaged*/),
+                                     num_peer, peers, &entry._hostAgents);
+        }
+        if (status != AM_SUCCESS) {
+            return status;
+        }
+    }
+
+    std::lock_guard<std::mutex> l (_mutex);
+    auto iter = std::find_if(_entries.begin(), _entries.end(), [&](const Entry &e) { return e._acc == acc; });
+    if (iter != _entries.end()) {
+        *iter = entry;
+    } else {
+        _entries.push_back(entry);
+    }
+    return AM_SUCCESS;
+}
+
+
+//---
+void AmPeerTable::get(const hc::accelerator &acc, bool hostPinned, std::vector<hsa_agent_t> *agents)
+{
+    std::lock_guard<std::mutex> l (_mutex);
+    auto iter = std::find_if(_entries.begin(), _entries.end(), [&](const Entry &e) { return e._acc == acc; });
+    if (iter != _entries.end()) {
+        *agents = hostPinned ? iter->_hostAgents : iter->_deviceAgents;
+    }
+}
+
+
+AmPeerTable g_amPeerTable;  // Peers of am_alloc with amMapToPeers.
+
+
 //=========================================================================================================
 // API Definitions.
 //=========================================================================================================
@@ -185,6 +718,38 @@ AmPointerTracker g_amPointerTracker;  // Track all am pointer allocations.
 namespace hc {
 
 // Allocate accelerator memory, return NULL if memory could not be allocated:
+// Device memory for amPeerDirect: an allocation of its own, of whole allocation granules of the pool, so
+// NICs registering its pages don't pin or reach memory of other allocations.
+static void* alloc_peer_direct(size_t sizeBytes, hc::accelerator &acc, hsa_amd_memory_pool_t pool,
+                               const std::vector<hsa_agent_t> &peers)
+{
+    size_t granule = 0;
+    hsa_status_t s1 = hsa_amd_memory_pool_get_info(pool, HSA_AMD_MEMORY_POOL_INFO_RUNTIME_ALLOC_GRANULE, &granule);
+    if (s1 != HSA_STATUS_SUCCESS || granule == 0) {
+        granule = 4096;
+    }
+    sizeBytes = (sizeBytes + granule - 1) / granule * granule;
+
+    void *ptr = NULL;
+    s1 = hsa_amd_memory_pool_allocate(pool, sizeBytes, 0, &ptr);
+    if (s1 != HSA_STATUS_SUCCESS) {
+        return NULL;
+    }
+    if (!peers.empty()) {
+        s1 = hsa_amd_agents_allow_access(peers.size(), peers.data(), NULL, ptr);
+        if (s1 != HSA_STATUS_SUCCESS) {
+            hsa_amd_memory_pool_free(ptr);
+            return NULL;
+        }
+    }
+
+    hc::AmPointerInfo info(NULL/*hostPointer*/, ptr /*devicePointer*/, sizeBytes, acc, true/*isDevice*/, true /*isAMManaged*/);
+    info._isPeerDirect = true;
+    g_amPointerTracker.insert(ptr, info);
+    return ptr;
+}
+
+
 auto_voidp am_alloc(size_t sizeBytes, hc::accelerator &acc, unsigned flags) 
 {
 
@@ -194,13 +759,25 @@ auto_voidp am_alloc(size_t sizeBytes, hc::accelerator &acc, unsigned flags)
         if (acc.is_hsa_accelerator()) {
             hsa_agent_t *hsa_agent = static_cast<hsa_agent_t*> (acc.get_default_view().get_hsa_agent());
             hsa_amd_memory_pool_t *alloc_region;
+            std::vector<hsa_agent_t> peers;
+            if (flags & amMapToPeers) {
+                g_amPeerTable.get(acc, flags & amHostPinned, &peers);
+            }
             if (flags & amHostPinned) {
                alloc_region = static_cast<hsa_amd_memory_pool_t*>(acc.get_hsa_am_system_region());
             } else {
                alloc_region = static_cast<hsa_amd_memory_pool_t*>(acc.get_hsa_am_region());
             }
 
-            if (alloc_region->handle != -1) {
+            if (alloc_region->handle == -1) {
+                // No memory pool to allocate from.
+            } else if (flags & amPeerDirect) {
+                if (!(flags & amHostPinned)) {
+                    ptr = alloc_peer_direct(sizeBytes, acc, *alloc_region, peers);
+                }
+            } else if ((flags & amPooled) && (sizeBytes <= AM_POOL_MAX_BLOCK)) {
+                ptr = g_amSuballocator.allocate(sizeBytes, acc, *alloc_region, hsa_agent, flags & amHostPinned, peers);
+            } else {
 
                 hsa_status_t s1 = hsa_amd_memory_pool_allocate(*alloc_region, sizeBytes, 0, &ptr);
 
@@ -222,6 +799,13 @@ auto_voidp am_alloc(size_t sizeBytes, hc::accelerator &acc, unsigned flags)
                       g_amPointerTracker.insert(ptr,
                         hc::AmPointerInfo(NULL/*hostPointer*/, ptr /*devicePointer*/, sizeBytes, acc, true/*isDevice*/, true /*isAMManaged*/));
                     }
+                    if (ptr != NULL && !peers.empty()) {
+                      s1 = hsa_amd_agents_allow_access(peers.size(), peers.data(), NULL, ptr);
+                      if (s1 != HSA_STATUS_SUCCESS) {
+                        am_free(ptr);
+                        ptr = NULL;
+                      }
+                    }
                 }
             }
         }
@@ -235,7 +819,7 @@ am_status_t am_free(void* ptr)
 {
     am_status_t status = AM_SUCCESS;
 
-    if (ptr != NULL) {
+    if (ptr != NULL && !g_amSuballocator.free(ptr)) {
         // See also tracker::reset which can free memory.
         hsa_amd_memory_pool_free(ptr);
 
@@ -249,6 +833,15 @@ am_status_t am_free(void* ptr)
 
 
 
+void am_free_async(void* ptr, hc::accelerator_view &av)
+{
+    if (ptr != NULL) {
+        g_amSuballocator.free_async(ptr, av);
+    }
+}
+
+
+
 am_status_t am_copy(void*  dst, const void*  src, size_t sizeBytes)
 {
     am_status_t am_status = AM_ERROR_MISC;
@@ -264,11 +857,81 @@ am_status_t am_copy(void*  dst, const void*  src, size_t sizeBytes)
 }
 
 
+completion_future am_copy_async(void* dst, const void* src, size_t sizeBytes, hc::accelerator_view &av)
+{
+    // Memory tracked by AM, on a device or pinned on the host, is reached by the DMA engine as it is.
+    // Other memory is pageable host memory, which is locked for the duration of the copy.
+    hc::accelerator acc = av.get_accelerator();
+    hc::AmPointerInfo srcInfo(NULL, NULL, 0, acc, false, false);
+    hc::AmPointerInfo dstInfo(NULL, NULL, 0, acc, false, false);
+    bool srcPageable = !g_amPointerTracker.find(src, &srcInfo);
+    bool dstPageable = !g_amPointerTracker.find(dst, &dstInfo);
+
+    if (srcPageable && dstPageable) {
+        // Nothing for the DMA engine to do.
+        av.wait();
+        memcpy(dst, src, sizeBytes);
+        return completion_future();
+    }
+
+    hcMemcpyKind kind = srcPageable ? hcMemcpyHostToDevice :
+                        dstPageable ? hcMemcpyDeviceToHost : hcMemcpyDeviceToDevice;
+    return av.copy_async(src, dst, sizeBytes, kind);
+}
+
+
+am_status_t am_memset(void* ptr, uint32_t value, size_t count, size_t patternSize)
+{
+    if (patternSize != 1 && patternSize != 2 && patternSize != 4) {
+        return AM_ERROR_MISC;
+    }
+    if (ptr == NULL || count == 0) {
+        return AM_SUCCESS;
+    }
+
+    // The pattern repeated over 32 bits.  ptr is aligned on the pattern, so every aligned word
+    // in the range holds word as it is, and each end starts with the first byte of word.
+    uint64_t mask = (uint64_t(1) << (8 * patternSize)) - 1;
+    uint32_t word = uint32_t((value & mask) * (uint64_t(0xFFFFFFFF) / mask));
+    const char *bytes = reinterpret_cast<const char*>(&word);
+
+    char *begin = static_cast<char*>(ptr);
+    char *end = begin + count * patternSize;
+
+    hc::accelerator acc;
+    hc::AmPointerInfo info(NULL, NULL, 0, acc, false, false);
+    if (!g_amPointerTracker.find(ptr, &info)) {
+        // Pageable host memory.
+        for (char *p = begin; p != end; p++) {
+            *p = bytes[(p - begin) % patternSize];
+        }
+        return AM_SUCCESS;
+    }
+
+    char *wordBegin = reinterpret_cast<char*>((reinterpret_cast<uintptr_t>(begin) + 3) & ~uintptr_t(3));
+    char *wordEnd = reinterpret_cast<char*>(reinterpret_cast<uintptr_t>(end) & ~uintptr_t(3));
+    char *headEnd = std::min(wordBegin, end);
+    char *tailBegin = std::max(wordEnd, headEnd);
+
+    hsa_status_t err = HSA_STATUS_SUCCESS;
+    if (wordBegin < wordEnd) {
+        err = hsa_amd_memory_fill(wordBegin, word, (wordEnd - wordBegin) / 4);
+    }
+    // At most 3 bytes at each end.
+    if (err == HSA_STATUS_SUCCESS && begin != headEnd) {
+        err = hsa_memory_copy(begin, bytes, headEnd - begin);
+    }
+    if (err == HSA_STATUS_SUCCESS && tailBegin != end) {
+        err = hsa_memory_copy(tailBegin, bytes, end - tailBegin);
+    }
+
+    return (err == HSA_STATUS_SUCCESS) ? AM_SUCCESS : AM_ERROR_MISC;
+}
+
+
 am_status_t am_memtracker_getinfo(hc::AmPointerInfo *info, const void *ptr)
 {
-    auto infoI = g_amPointerTracker.find(ptr);
-    if (infoI != g_amPointerTracker.end()) {
-        *info = infoI->second;
+    if (g_amPointerTracker.find(ptr, info)) {
         return AM_SUCCESS;
     } else {
         return AM_ERROR_MISC;
@@ -287,12 +950,22 @@ am_status_t am_memtracker_add(void* ptr, size_t sizeBytes, hc::accelerator &acc,
 }
 
 
+am_status_t am_memtracker_add_batch(size_t count, void* const* ptrs, const size_t* sizeBytes, hc::accelerator &acc, bool isDeviceMem)
+{
+    std::vector<hc::AmPointerInfo> infos;
+    infos.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+        infos.push_back(hc::AmPointerInfo(isDeviceMem ? ptrs[i] : NULL/*hostPointer*/, ptrs[i] /*devicePointer*/, sizeBytes[i], acc, isDeviceMem, false /*isAMManaged*/));
+    }
+    g_amPointerTracker.insert(count, ptrs, infos.data());
+
+    return AM_SUCCESS;
+}
+
+
 am_status_t am_memtracker_update(const void* ptr, int appId, unsigned allocationFlags)
 {
-    auto iter = g_amPointerTracker.find(ptr);
-    if (iter != g_amPointerTracker.end()) {
-        iter->second._appId              = appId;
-        iter->second._appAllocationFlags = allocationFlags;
+    if (g_amPointerTracker.update(ptr, appId, allocationFlags)) {
         return AM_SUCCESS;
     } else {
         return AM_ERROR_MISC;
@@ -312,18 +985,27 @@ am_status_t am_memtracker_remove(void* ptr)
     return status;
 }
 
+am_status_t am_memtracker_remove_batch(size_t count, void* const* ptrs)
+{
+    size_t numRemoved = g_amPointerTracker.remove(count, ptrs);
+
+    return (numRemoved == count) ? AM_SUCCESS : AM_ERROR_MISC;
+}
+
 //---
 void am_memtracker_print()
 {
     std::ostream &os = std::cerr;
 
     //g_amPointerTracker.print(std::cerr);
-    for (auto iter = g_amPointerTracker.readerLockBegin() ; iter != g_amPointerTracker.end(); iter++) {
+    int epoch;
+    auto table = g_amPointerTracker.readerLock(&epoch);
+    for (auto iter = table->begin() ; iter != table->end(); iter++) {
         os << "  " << iter->first._basePointer << "..." << iter->first._endPointer << "::  ";
         os << iter->second << std::endl;
     }
 
-    g_amPointerTracker.readerUnlock();
+    g_amPointerTracker.readerUnlock(epoch);
 }
 
 
@@ -331,7 +1013,9 @@ void am_memtracker_print()
 void am_memtracker_sizeinfo(const hc::accelerator &acc, size_t *deviceMemSize, size_t *hostMemSize, size_t *userMemSize)
 {
     *deviceMemSize = *hostMemSize = *userMemSize = 0;
-    for (auto iter = g_amPointerTracker.readerLockBegin() ; iter != g_amPointerTracker.end(); iter++) {
+    int epoch;
+    auto table = g_amPointerTracker.readerLock(&epoch);
+    for (auto iter = table->begin() ; iter != table->end(); iter++) {
         if (iter->second._acc == acc) {
             size_t sizeBytes = iter->second._sizeBytes;
             if (iter->second._isAmManaged) {
@@ -346,14 +1030,16 @@ void am_memtracker_sizeinfo(const hc::accelerator &acc, size_t *deviceMemSize, s
         }
     }
 
-    g_amPointerTracker.readerUnlock();
+    g_amPointerTracker.readerUnlock(epoch);
 }
 
 
 //---
 size_t am_memtracker_reset(const hc::accelerator &acc)
 {
-    return g_amPointerTracker.reset(acc);
+    // Slabs of the suballocator are given back first, so the tracker doesn't free them under it.
+    size_t count = g_amSuballocator.reset(acc);
+    return count + g_amPointerTracker.reset(acc);
 }
 
 void am_memtracker_update_peers (const hc::accelerator &acc, int peerCnt, hsa_agent_t *peerAgents) 
@@ -362,88 +1048,65 @@ void am_memtracker_update_peers (const hc::accelerator &acc, int peerCnt, hsa_ag
 }
 
 am_status_t am_map_to_peers(void* ptr, size_t num_peer, const hc::accelerator* peers) 
+{
+    return am_map_to_peers_batch(1, &ptr, num_peer, peers);
+}
+
+
+am_status_t am_map_to_peers_batch(size_t count, void* const* ptrs, size_t num_peer, const hc::accelerator* peers)
 {
     // check input
-    if(nullptr == ptr || 0 == num_peer || nullptr == peers)
+    if(nullptr == ptrs || 0 == num_peer || nullptr == peers)
         return AM_ERROR_MISC;
 
-    hc::accelerator acc;
-    AmPointerInfo info(nullptr, nullptr, 0, acc, false, false);
-    auto status = am_memtracker_getinfo(&info, ptr);
-    if(AM_SUCCESS != status)
-        return status;
-
-        hsa_amd_memory_pool_t* pool = nullptr;
-    if(info._isInDeviceMem)
-    {
-        // get accelerator and pool of device memory
-        acc = info._acc;
-        pool = static_cast<hsa_amd_memory_pool_t*>(acc.get_hsa_am_region());
-    }
-    else
-    {
-        //TODO: the ptr is host pointer, it might be allocated through am_alloc, 
-        // or allocated by others, but add it to the tracker.
-        // right now, only support host pointer which is allocated through am_alloc.
-        if(info._isAmManaged)
-        {
-            // here, accelerator is the device, but used to query system memory pool
-            acc = info._acc;
-            pool = static_cast<hsa_amd_memory_pool_t*>(acc.get_hsa_am_system_region()); 
+    AmPointerTracker::TableType entries;
+    size_t found = g_amPointerTracker.find(count, ptrs, &entries);
+    am_status_t status = (found == count) ? AM_SUCCESS : AM_ERROR_MISC;
+
+    // The peer agents only depend on the accelerator and the memory pool of the range, resolve them once
+    // for each.
+    struct PeerAgents {
+        hc::accelerator             _acc;
+        bool                        _isInDeviceMem;
+        am_status_t                 _status;
+        std::vector<hsa_agent_t>    _agents;
+    };
+    std::vector<PeerAgents> cache;
+
+    for (auto &entry : entries) {
+        const hc::AmPointerInfo &info = entry.second;
+        auto iter = std::find_if(cache.begin(), cache.end(), [&](const PeerAgents &p) {
+                                     return p._acc == info._acc && p._isInDeviceMem == info._isInDeviceMem; });
+        if (iter == cache.end()) {
+            PeerAgents p = { info._acc, info._isInDeviceMem, AM_SUCCESS, std::vector<hsa_agent_t>() };
+            p._status = get_peer_agents(info, num_peer, peers, &p._agents);
+            iter = cache.insert(cache.end(), p);
         }
-        else
-            return AM_ERROR_MISC;
-    }
-
-    const size_t max_agent = hc::accelerator::get_all().size();
-    hsa_agent_t agents[max_agent];
-  
-    int peer_count = 0;
-
-    for(auto i = 0; i < num_peer; i++)
-    {
-        // if pointer is device pointer, and the accelerator itself is included in the list, ignore it
-        auto& a = peers[i];
-        if(info._isInDeviceMem)
-        {
-            if(a == acc)
-                continue;
+        if (iter->_status != AM_SUCCESS) {
+            status = iter->_status;
+            continue;
         }
 
-        hsa_agent_t* agent = static_cast<hsa_agent_t*>(acc.get_hsa_agent());
-
-        hsa_amd_memory_pool_access_t access;
-        hsa_status_t  status = hsa_amd_agent_memory_pool_get_info(*agent, *pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_ACCESS, &access);
-        if(HSA_STATUS_SUCCESS != status)
-            return AM_ERROR_MISC;
-
-        // check access
-        if(HSA_AMD_MEMORY_POOL_ACCESS_NEVER_ALLOWED == access)
-            return AM_ERROR_MISC;
+        // allow access to the agents
+        if (!iter->_agents.empty()) {
+            hsa_status_t s1 = hsa_amd_agents_allow_access(iter->_agents.size(), iter->_agents.data(), NULL,
+                                                          entry.first._basePointer);
+            if (s1 != HSA_STATUS_SUCCESS) {
+                status = AM_ERROR_MISC;
+            }
+        }
+    }
 
-        bool add_agent = true;
+    return status;
+}
 
-        for(int ii = 0; ii < peer_count; ii++)
-        {
-            if(agent->handle == agents[ii].handle)
-                add_agent = false;
-        } 
 
-        if(add_agent)
-        {
-             agents[peer_count] = *agent;
-             peer_count++;
-        }    
-    }
+am_status_t am_set_alloc_peers(hc::accelerator &acc, size_t num_peer, const hc::accelerator* peers)
+{
+    if (num_peer != 0 && peers == nullptr)
+        return AM_ERROR_MISC;
 
-    // allow access to the agents
-    if(peer_count)
-    {
-        hsa_status_t status = hsa_amd_agents_allow_access(peer_count, agents, NULL, ptr);
-        return status == HSA_STATUS_SUCCESS ? AM_SUCCESS : AM_ERROR_MISC;
-    }
-   
-    return AM_SUCCESS;
+    return g_amPeerTable.set(acc, num_peer, peers);
 }
 
 am_status_t am_memory_host_lock(hc::accelerator &ac, void *hostPtr, size_t size, hc::accelerator *visible_ac, size_t num_visible_ac)
@@ -476,4 +1139,129 @@ am_status_t am_memory_host_unlock(hc::accelerator &ac, void *hostPtr)
     return am_status;
 }
 
+am_status_t am_ipc_get_handle(const void* ptr, hc::AmIpcMemoryHandle* handle)
+{
+    static_assert(sizeof(handle->_ipcHandle) == sizeof(hsa_amd_ipc_memory_t), "IPC handles don't match");
+
+    hc::accelerator acc;
+    hc::AmPointerInfo info(NULL, NULL, 0, acc, 0, 0);
+    if (handle == NULL || !g_amPointerTracker.find(ptr, &info) || !info._isInDeviceMem) {
+        return AM_ERROR_MISC;
+    }
+
+    hsa_amd_ipc_memory_t ipc;
+    hsa_status_t s1 = hsa_amd_ipc_memory_create(info._devicePointer, info._sizeBytes, &ipc);
+    if (s1 != HSA_STATUS_SUCCESS) {
+        return AM_ERROR_MISC;
+    }
+    memcpy(handle->_ipcHandle, &ipc, sizeof(ipc));
+    handle->_offset = static_cast<const char*>(ptr) - static_cast<const char*>(info._devicePointer);
+    handle->_sizeBytes = info._sizeBytes;
+
+    return AM_SUCCESS;
+}
+
+am_status_t am_rdma_get_range(const void* ptr, hc::AmRdmaRange* range)
+{
+    hc::accelerator acc;
+    hc::AmPointerInfo info(NULL, NULL, 0, acc, 0, 0);
+    if (range == NULL || !g_amPointerTracker.find(ptr, &info) || !info._isInDeviceMem || !info._isPeerDirect) {
+        return AM_ERROR_MISC;
+    }
+
+    range->_basePointer = info._devicePointer;
+    range->_offset = static_cast<const char*>(ptr) - static_cast<const char*>(info._devicePointer);
+    range->_sizeBytes = info._sizeBytes;
+
+    return AM_SUCCESS;
+}
+
+am_status_t am_ipc_open_handle(const hc::AmIpcMemoryHandle& handle, hc::accelerator &acc, void** ptr)
+{
+    if (ptr == NULL || !acc.is_hsa_accelerator()) {
+        return AM_ERROR_MISC;
+    }
+
+    hsa_amd_ipc_memory_t ipc;
+    memcpy(&ipc, handle._ipcHandle, sizeof(ipc));
+    hsa_agent_t *hsa_agent = static_cast<hsa_agent_t*> (acc.get_default_view().get_hsa_agent());
+    void *base = NULL;
+    hsa_status_t s1 = hsa_amd_ipc_memory_attach(&ipc, handle._sizeBytes, 1, hsa_agent, &base);
+    if (s1 != HSA_STATUS_SUCCESS) {
+        return AM_ERROR_MISC;
+    }
+
+    // opened memory is freed by the process which shared it, not by am_memtracker_reset
+    g_amPointerTracker.insert(base,
+        hc::AmPointerInfo(NULL/*hostPointer*/, base /*devicePointer*/, handle._sizeBytes, acc, true/*isDevice*/, false /*isAMManaged*/));
+    *ptr = static_cast<char*>(base) + handle._offset;
+
+    return AM_SUCCESS;
+}
+
+am_status_t am_ipc_close_handle(void* ptr)
+{
+    hc::accelerator acc;
+    hc::AmPointerInfo info(NULL, NULL, 0, acc, 0, 0);
+    if (!g_amPointerTracker.find(ptr, &info) || info._isAmManaged) {
+        return AM_ERROR_MISC;
+    }
+    if (hsa_amd_ipc_memory_detach(info._devicePointer) != HSA_STATUS_SUCCESS) {
+        return AM_ERROR_MISC;
+    }
+    g_amPointerTracker.remove(info._devicePointer);
+
+    return AM_SUCCESS;
+}
+
+am_status_t am_ipc_signal_create(int64_t value, hc::am_ipc_signal_t* signal, hc::AmIpcSignalHandle* handle)
+{
+    static_assert(sizeof(handle->_ipcHandle) == sizeof(hsa_amd_ipc_signal_t), "IPC handles don't match");
+
+    hsa_signal_t s;
+    if (hsa_amd_signal_create(value, 0, NULL, HSA_AMD_SIGNAL_IPC, &s) != HSA_STATUS_SUCCESS) {
+        return AM_ERROR_MISC;
+    }
+    hsa_amd_ipc_signal_t ipc;
+    if (hsa_amd_ipc_signal_create(s, &ipc) != HSA_STATUS_SUCCESS) {
+        hsa_signal_destroy(s);
+        return AM_ERROR_MISC;
+    }
+    memcpy(handle->_ipcHandle, &ipc, sizeof(ipc));
+    *signal = s.handle;
+
+    return AM_SUCCESS;
+}
+
+am_status_t am_ipc_signal_open(const hc::AmIpcSignalHandle& handle, hc::am_ipc_signal_t* signal)
+{
+    hsa_amd_ipc_signal_t ipc;
+    memcpy(&ipc, handle._ipcHandle, sizeof(ipc));
+    hsa_signal_t s;
+    if (hsa_amd_ipc_signal_attach(&ipc, &s) != HSA_STATUS_SUCCESS) {
+        return AM_ERROR_MISC;
+    }
+    *signal = s.handle;
+
+    return AM_SUCCESS;
+}
+
+void am_ipc_signal_store(hc::am_ipc_signal_t signal, int64_t value)
+{
+    hsa_signal_t s = { signal };
+    hsa_signal_store_screlease(s, value);
+}
+
+int64_t am_ipc_signal_wait(hc::am_ipc_signal_t signal, int64_t value)
+{
+    hsa_signal_t s = { signal };
+    return hsa_signal_wait_scacquire(s, HSA_SIGNAL_CONDITION_EQ, value, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
+}
+
+am_status_t am_ipc_signal_destroy(hc::am_ipc_signal_t signal)
+{
+    hsa_signal_t s = { signal };
+    return (hsa_signal_destroy(s) == HSA_STATUS_SUCCESS) ? AM_SUCCESS : AM_ERROR_MISC;
+}
+
 } // end namespace hc.
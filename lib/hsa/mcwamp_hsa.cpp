@@ -8,15 +8,20 @@
 
 // Kalmar Runtime implementation (HSA version)
 
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <fstream>
 #include <future>
 #include <iostream>
+#include <iterator>
+#include <list>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <sstream>
 #include <string>
@@ -28,13 +33,29 @@
 #include <hsa/hsa.h>
 #include <hsa/hsa_ext_finalize.h>
 #include <hsa/hsa_ext_amd.h>
+#if defined(__has_include)
+#if __has_include(<hsa/amd_hsa_kernel_code.h>)
+#include <hsa/amd_hsa_kernel_code.h>
+#define HAS_AMD_KERNEL_CODE (1)
+#endif
+#if __has_include(<hsa/amd_hsa_queue.h>)
+#include <hsa/amd_hsa_queue.h>
+#include <hsa/amd_hsa_signal.h>
+#define HAS_AMD_QUEUE (1)
+#endif
+#endif
 
 #include <hcc/md5.h>
+#include <hcc/kalmar_exception.h>
 #include <hcc/kalmar_runtime.h>
 #include <hcc/kalmar_aligned_alloc.h>
 
+#include "../kernel_cache.hpp"
+
 #include <time.h>
 #include <iomanip>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #define KALMAR_DEBUG (0)
 
@@ -51,9 +72,54 @@
 #define KERNARG_POOL_SIZE (64)
 
 // number of pre-allocated HSA signals in HSAContext
+// the pool grows on demand by chunks of the same size
 // default set as 64 (pre-allocating 64 HSA signals)
 #define SIGNAL_POOL_SIZE (64)
 
+// maximum number of chunks the signal pool could grow to
+// signals are created and destroyed on the fly beyond that
+// default set as 1024 (at most 65536 pooled HSA signals)
+#define SIGNAL_POOL_MAX_CHUNKS (1024)
+
+// number of free signals cached by each thread
+// default set as 16
+#define SIGNAL_CACHE_SIZE (16)
+
+// time an hcWaitModeAdaptive wait spins on a completion signal, then yields
+// the thread, before blocking on the signal, in microseconds
+// environment variables HCC_WAIT_SPIN_US and HCC_WAIT_YIELD_US override them
+// default set as 50 and 200
+#define WAIT_SPIN_TIME_US (50)
+#define WAIT_YIELD_TIME_US (200)
+
+// whether the runtime only drains in-flight work and destroys the HSA queues,
+// in parallel, at process exit, and leaves the rest for the OS to reclaim
+// environment variable HCC_FAST_EXIT overrides it
+// default set as 0
+#define FAST_EXIT (0)
+
+// whether to print the resources of each kernel as it is created
+// default set as 0 (environment variable HCC_KERNEL_RESOURCES=1 prints them)
+#define KERNEL_RESOURCES_REPORT (0)
+
+// registers of a SIMD of GCN, vector registers per lane and scalar registers,
+// and the granules they are allocated in, which bound the wavefronts of a SIMD
+#define GCN_SIMD_VGPRS (256)
+#define GCN_SIMD_SGPRS (800)
+#define GCN_VGPR_GRANULE (4)
+#define GCN_SGPR_GRANULE (16)
+#define GCN_SIMD_MAX_WAVES (10)
+
+// size of the kernarg ring buffer of each HSAQueue, in bytes
+// kernel arguments are carved from the ring before falling back to the
+// kernarg pool in HSADevice
+// default set as 256KB
+#define KERNARG_RING_SIZE (256 * 1024)
+
+// alignment of kernel arguments allocated from the kernarg ring buffer
+// default set as 64 (size of a cache line)
+#define KERNARG_RING_ALIGNMENT (64)
+
 // whether to use kernarg region found on the HSA agent
 // default set as 1 (use karnarg region)
 #define USE_KERNARG_REGION (1)
@@ -63,23 +129,161 @@
 // default set as 0 (NOT use hsa_memory_copy)
 #define USE_HSA_MEMORY_COPY_FOR_KERNARG (0)
 
-// whether to print out kernel dispatch time
-// default set as 0 (NOT print out kernel dispatch time)
-#define KALMAR_DISPATCH_TIME_PRINTOUT (0)
+// capacity of the ring of in-flight async operations in HSAQueue
+// must be a power of 2, default set as 4096
+#define ASYNCOPS_RING_SIZE (4096)
+
+// size of each pinned staging buffer used to stream pageable host memory to
+// and from a device, transfers are split into chunks of this size
+// environment variable HCC_STAGING_BUFFER_SIZE overrides it, in KB
+// default set as 4MB
+#define STAGING_BUFFER_SIZE (4 * 1024 * 1024)
+
+// number of staging buffers of each device, the host fills one while the
+// DMA engines drain the others, at least 2
+// environment variable HCC_STAGING_BUFFER_COUNT overrides it
+// default set as 2
+#define STAGING_BUFFER_COUNT (2)
+
+// maximum number of locked host memory ranges kept by the pinned cache of
+// each device, host memory must not be freed while it's cached
+// environment variable HCC_PINNED_CACHE_SIZE overrides it
+// default set as 0 (pinned cache disabled)
+#define PINNED_CACHE_SIZE (0)
+
+// map() of device memory which the host can access, such as device memory
+// exposed through a large BAR, returns a direct pointer without copying
+// environment variable HCC_MAP_ZERO_COPY=0 disables it
+// default set as 1
+#define MAP_ZERO_COPY (1)
+
+// maximum number of unused host buffers of map() kept by each device for
+// later map() of device memory which the host can't access
+// default set as 4
+#define MAP_BUFFER_COUNT (4)
+
+// granularity of the tracking of modified host memory of map(), only the
+// modified pages are copied back to the device in unmap()
+// default set as 4KB
+#define MAP_PAGE_SIZE (4096)
+
+// map() for the host to overwrite device memory uses host buffers of the
+// uncached, write-combined kernarg pool, as nothing is read back from them
+// environment variable HCC_MAP_WRITE_COMBINED=0 disables it
+// default set as 1
+#define MAP_WRITE_COMBINED (1)
+
+// size of the smallest and the largest power-of-two size class of the
+// device memory cache, larger blocks are kept in a single free list
+// default set as 4KB and 64MB
+#define MEMORY_CACHE_MIN_BLOCK (4096)
+#define MEMORY_CACHE_MAX_BLOCK (64 * 1024 * 1024)
+
+// maximum number of bytes of free device memory kept by the device memory
+// cache of each device, the cache is enabled with HCC_HSA_MEMORY_CACHE=ON
+// environment variable HCC_HSA_MEMORY_CACHE_LIMIT overrides it, in MB
+// default set as 256MB
+#define MEMORY_CACHE_LIMIT (256 * 1024 * 1024)
+
+// number of HSA command queues backing an accelerator_view which executes
+// in any order, dispatches are distributed round-robin over them
+// environment variable HCC_QUEUES_PER_VIEW overrides it, up to the number
+// of queues the agent supports
+// default set as 1
+#define QUEUES_PER_VIEW (1)
+
+// whether the workgroup shape of kernels launched without one is autotuned:
+// the first launches of each kernel and class of extents try several shapes,
+// timed with the profiling timestamps of the dispatches, and the fastest one
+// is used for later launches
+// environment variable HCC_AUTOTUNE may be used to enable it, and
+// HCC_AUTOTUNE_FILE to name a file the chosen shapes are kept in across runs
+#ifndef AUTOTUNE
+#define AUTOTUNE (0)
+#endif
+
+// number of timed launches of each candidate workgroup shape while autotuning
+// default set as 2
+#define AUTOTUNE_TRIALS (2)
+
+// number of events each thread may have recorded and not yet written out
+// while tracing, events recorded beyond that are dropped
+// environment variable HCC_TRACE names the file the trace is written to, in
+// the Chrome trace format read by chrome://tracing and Perfetto
+// must be a power of 2, default set as 4096
+#define TRACE_RING_SIZE (4096)
 
-// threshold to clean up finished kernel in HSAQueue.asyncOps
-// default set as 1024
-#define ASYNCOPS_VECTOR_GC_SIZE (1024)
+// interval at which the background thread writes out the events recorded
+// default set as 10ms
+#define TRACE_FLUSH_INTERVAL_MS (10)
 
 
+// alignment the embedded kernel blobs need to be used in place, the ELF
+// headers of BRIG and code objects hold 64-bit fields
+#define KERNEL_BLOB_ALIGNMENT (8)
+
 // whether to use MD5 as kernel indexing hash function
-// default set as 0 (use faster FNV-1a hash instead)
+// default set as 0 (use faster 128-bit hash of the whole kernel instead)
 #define USE_MD5_HASH (0)
 
-// cutoff size used in FNV-1a hash function
-// default set as 768, this is a heuristic value
-// which is larger than HSA BrigModuleHeader and AMD GCN ISA header (Elf64_Ehdr)
-#define FNV1A_CUTOFF_SIZE (768)
+// when kernels in HSAIL/BRIG are finalized
+// FINALIZE_EAGER: when the program is built, before the first launch
+// FINALIZE_LAZY: on the first launch of one of its kernels, a program never
+// launched isn't finalized
+// FINALIZE_PARALLEL: on a background thread started when the program is
+// built, the first launch waiting only for what remains to be finalized
+// environment variable HCC_FINALIZE_MODE may be used to choose it
+#define FINALIZE_EAGER (0)
+#define FINALIZE_LAZY (1)
+#define FINALIZE_PARALLEL (2)
+#ifndef FINALIZE_MODE
+#define FINALIZE_MODE FINALIZE_EAGER
+#endif
+
+// 128-bit hash of a kernel blob, following xxHash64: four 64-bit lanes each
+// take a word of every 32-byte stripe, which compilers turn into vector
+// code, then two differently mixed folds of the lanes give the two halves
+static void kernelHash128(const void* source, size_t size, uint64_t hash[2]) {
+    const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+    const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+    const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+    const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+    auto rotl = [] (uint64_t x, int r) { return (x << r) | (x >> (64 - r)); };
+    auto round = [&] (uint64_t acc, uint64_t input) { return rotl(acc + input * PRIME64_2, 31) * PRIME64_1; };
+    auto avalanche = [] (uint64_t h) {
+        h ^= h >> 33;
+        h *= PRIME64_2;
+        h ^= h >> 29;
+        h *= PRIME64_3;
+        h ^= h >> 32;
+        return h;
+    };
+
+    uint64_t lanes[4] = { PRIME64_1 + PRIME64_2, PRIME64_2, 0, 0 - PRIME64_1 };
+    const unsigned char* p = static_cast<const unsigned char*>(source);
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        uint64_t words[4];
+        memcpy(words, p + i, 32);
+        for (int l = 0; l < 4; ++l) {
+            lanes[l] = round(lanes[l], words[l]);
+        }
+    }
+
+    // the last partial stripe is zero-padded, the size tells it apart
+    uint64_t words[4] = { 0, 0, 0, 0 };
+    memcpy(words, p + i, size - i);
+    for (int l = 0; l < 4; ++l) {
+        lanes[l] = round(lanes[l], words[l]);
+    }
+
+    hash[0] = avalanche(rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18) +
+                        size * PRIME64_5);
+    hash[1] = avalanche((lanes[0] ^ rotl(lanes[3], 27)) * PRIME64_4 + (lanes[1] ^ rotl(lanes[2], 31)) * PRIME64_3 +
+                        size * PRIME64_1);
+}
 
 static const char* getHSAErrorString(hsa_status_t s) {
 
@@ -173,10 +377,80 @@ inline static void checkHCCRuntimeStatus(const HCCRuntimeStatus status, const un
 
 } // namespace Kalmar
 
+///
+/// AQL packet submission
+///
+/// An HSAQueue may be shared by several host threads, so packets are
+/// submitted with the multi-producer protocol: a slot is reserved by
+/// atomically bumping the write index, the packet body is written while the
+/// header in the slot still reads INVALID, and the header is published last
+/// with a release store so the packet processor never sees a partial packet.
+///
+
+// reserve count consecutive packet slots on the queue, count must not
+// exceed the size of the queue
+// a reserved slot can't be given back, so in case the queue is full we wait
+// for the packet processor to consume older packets instead of failing
+static inline uint64_t reserveAQLPacketSlot(hsa_queue_t* queue, uint64_t count = 1) {
+    uint64_t index = hsa_queue_add_write_index_acq_rel(queue, count);
+    while (index + count - hsa_queue_load_read_index_acquire(queue) > queue->size) {
+        std::this_thread::yield();
+    }
+    return index;
+}
+
+// write a fully prepared AQL packet into a reserved slot
+// all AQL packet types start with a 32-bit word holding the header, which
+// is stored atomically after the rest of the packet is in place
+template <typename T>
+static inline void writeAQLPacket(hsa_queue_t* queue, uint64_t index, const T& packet) {
+    static_assert(sizeof(T) == 64, "AQL packets are 64 bytes");
+    const uint32_t queueMask = queue->size - 1;
+    T* slot = &(((T*)(queue->base_address))[index & queueMask]);
+
+    memcpy(reinterpret_cast<char*>(slot) + sizeof(uint32_t),
+           reinterpret_cast<const char*>(&packet) + sizeof(uint32_t),
+           sizeof(T) - sizeof(uint32_t));
+
+    uint32_t header;
+    memcpy(&header, &packet, sizeof(uint32_t));
+    __atomic_store_n(reinterpret_cast<uint32_t*>(slot), header, __ATOMIC_RELEASE);
+}
+
+// number of dependent signals carried by a barrier-AND packet
+#define BARRIER_AND_DEP_SIGNAL_COUNT (5)
+
+// write barrier-AND packets which hold back the packets written after them
+// until all the signals are 0, chaining one packet per 5 signals
+// the packets have no completion signals, and the doorbell is left to the
+// packets following them
+static inline void writeBarrierAndPackets(hsa_queue_t* queue, const std::vector<hsa_signal_t>& signals) {
+    size_t packetCount = (signals.size() + BARRIER_AND_DEP_SIGNAL_COUNT - 1) / BARRIER_AND_DEP_SIGNAL_COUNT;
+    if (packetCount == 0) {
+        return;
+    }
+
+    uint64_t index = reserveAQLPacketSlot(queue, packetCount);
+    for (size_t i = 0; i < packetCount; ++i) {
+        hsa_barrier_and_packet_t barrier;
+        memset(&barrier, 0, sizeof(hsa_barrier_and_packet_t));
+        barrier.header = (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE) |
+                         (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
+                         (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE);
+        for (size_t j = 0; j < BARRIER_AND_DEP_SIGNAL_COUNT; ++j) {
+            size_t k = i * BARRIER_AND_DEP_SIGNAL_COUNT + j;
+            if (k < signals.size()) {
+                barrier.dep_signal[j] = signals[k];
+            }
+        }
+        writeAQLPacket(queue, index + i, barrier);
+    }
+}
 
 
 extern "C" void PushArgImpl(void *ker, int idx, size_t sz, const void *v);
 extern "C" void PushArgPtrImpl(void *ker, int idx, size_t sz, const void *v);
+extern "C" void PushArgsImpl(void *ker, size_t sz, const void *v);
 
 // forward declaration
 namespace Kalmar {
@@ -244,15 +518,124 @@ private:
     HSAExecutable* executable;
     uint64_t kernelCodeHandle;
     hsa_executable_symbol_t hsaExecutableSymbol;
+
+    // properties of the kernel object, which never change after it's
+    // created, so they are queried only once instead of upon every dispatch
+    uint32_t kernargSegmentSize;
+    uint32_t kernargSegmentAlignment;
+    uint32_t groupSegmentSize;
+    uint32_t privateSegmentSize;
+    // registers of the kernel, 0 if the code object isn't readable
+    uint32_t vgprCount;
+    uint32_t sgprCount;
+
+    // launch bounds of the kernel, set once by HSADevice::SetKernelLaunchBounds
+    bool hasLaunchBounds;
+    Kalmar::KalmarLaunchBounds launchBounds;
+
+    // name of the kernel symbol, classifying launches to autotune
+    std::string name;
+
     friend class HSADispatch;
 
 public:
     HSAKernel(HSAExecutable* _executable,
               hsa_executable_symbol_t _hsaExecutableSymbol,
-              uint64_t _kernelCodeHandle) :
+              uint64_t _kernelCodeHandle,
+              const char* _name) :
       executable(_executable),
       hsaExecutableSymbol(_hsaExecutableSymbol),
-      kernelCodeHandle(_kernelCodeHandle) {}
+      kernelCodeHandle(_kernelCodeHandle),
+      kernargSegmentSize(0),
+      kernargSegmentAlignment(0),
+      groupSegmentSize(0),
+      privateSegmentSize(0),
+      vgprCount(0),
+      sgprCount(0),
+      hasLaunchBounds(false),
+      name(_name) {
+        memset(&launchBounds, 0, sizeof(launchBounds));
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        status = hsa_executable_symbol_get_info(hsaExecutableSymbol,
+                                                HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_KERNARG_SEGMENT_SIZE,
+                                                &kernargSegmentSize);
+        STATUS_CHECK(status, __LINE__);
+        status = hsa_executable_symbol_get_info(hsaExecutableSymbol,
+                                                HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_KERNARG_SEGMENT_ALIGNMENT,
+                                                &kernargSegmentAlignment);
+        STATUS_CHECK(status, __LINE__);
+        status = hsa_executable_symbol_get_info(hsaExecutableSymbol,
+                                                HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_GROUP_SEGMENT_SIZE,
+                                                &groupSegmentSize);
+        STATUS_CHECK(status, __LINE__);
+        status = hsa_executable_symbol_get_info(hsaExecutableSymbol,
+                                                HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_PRIVATE_SEGMENT_SIZE,
+                                                &privateSegmentSize);
+        STATUS_CHECK(status, __LINE__);
+
+#if HAS_AMD_KERNEL_CODE
+        // the kernel object is the amd_kernel_code_t header of the finalized
+        // code, which the loader keeps in memory the host can read
+        const amd_kernel_code_t* code = reinterpret_cast<const amd_kernel_code_t*>(kernelCodeHandle);
+        if (code && code->amd_kernel_code_version_major == AMD_KERNEL_CODE_VERSION_MAJOR) {
+            vgprCount = code->workitem_vgpr_count;
+            sgprCount = code->wavefront_sgpr_count;
+        }
+#endif
+
+        /// environment variable HCC_KERNEL_RESOURCES=1 may be used to print
+        /// the resources of each kernel, and warn of spilled registers
+        static const bool report = [] {
+            char* report_env = getenv("HCC_KERNEL_RESOURCES");
+            return (report_env != nullptr) ? (atoi(report_env) != 0) : (KERNEL_RESOURCES_REPORT != 0);
+        }();
+        if (report) {
+            Kalmar::KalmarKernelResources resources = getResources();
+            std::cerr << "kernel " << name << ": " << resources.vgprCount << " VGPRs, "
+                      << resources.sgprCount << " SGPRs, "
+                      << resources.groupSegmentSize << " bytes group segment, "
+                      << resources.privateSegmentSize << " bytes private segment";
+            if (resources.wavesPerSIMD) {
+                std::cerr << ", " << resources.wavesPerSIMD << " waves per SIMD";
+            }
+            std::cerr << "\n";
+            if (resources.privateSegmentSize > 0) {
+                std::cerr << "warning: kernel " << name << " uses " << resources.privateSegmentSize
+                          << " bytes of private segment per work-item, registers may spill\n";
+            }
+        }
+    }
+
+    // keep the first launch bounds set, the caller holds the lock of the device
+    void setLaunchBounds(const Kalmar::KalmarLaunchBounds& bounds) {
+        if (!hasLaunchBounds) {
+            launchBounds = bounds;
+            hasLaunchBounds = true;
+        }
+    }
+
+    // the wavefronts a SIMD holds are bound by the registers each takes
+    Kalmar::KalmarKernelResources getResources() const {
+        Kalmar::KalmarKernelResources resources;
+        resources.groupSegmentSize = groupSegmentSize;
+        resources.privateSegmentSize = privateSegmentSize;
+        resources.vgprCount = vgprCount;
+        resources.sgprCount = sgprCount;
+        resources.wavesPerSIMD = 0;
+        if (vgprCount || sgprCount) {
+            uint32_t waves = GCN_SIMD_MAX_WAVES;
+            if (vgprCount) {
+                uint32_t vgprs = (vgprCount + GCN_VGPR_GRANULE - 1) / GCN_VGPR_GRANULE * GCN_VGPR_GRANULE;
+                waves = std::min(waves, GCN_SIMD_VGPRS / vgprs);
+            }
+            if (sgprCount) {
+                uint32_t sgprs = (sgprCount + GCN_SGPR_GRANULE - 1) / GCN_SGPR_GRANULE * GCN_SGPR_GRANULE;
+                waves = std::min(waves, GCN_SIMD_SGPRS / sgprs);
+            }
+            resources.wavesPerSIMD = waves;
+        }
+        return resources;
+    }
 
     ~HSAKernel() {
 #if KALMAR_DEBUG
@@ -261,193 +644,1817 @@ public:
     }
 }; // end of HSAKernel
 
-class HSABarrier : public Kalmar::KalmarAsyncOp {
+// A bump-pointer ring buffer of kernel arguments owned by each HSAQueue.
+//
+// Allocations are identified by their virtual offset, which only grows, and
+// are recorded at the granule they start in.  The space is reclaimed in
+// allocation order, once an allocation has been released by its dispatch or
+// its completion signal has been observed to be 0.  When the ring is full
+// allocate() returns nullptr and the caller falls back to the kernarg pool,
+// so it never blocks.
+class HSAKernargRing {
 private:
-    hsa_signal_t signal;
-    int signalIndex;
-    bool isDispatched;
-    hsa_wait_state_t waitMode;
-
-    std::shared_future<void>* future;
+    struct Record {
+        // virtual offset of the allocation, bit 0 set once released
+        std::atomic<uint64_t> state;
+        // length of the allocation, including the padding skipped at the
+        // end of the ring
+        std::atomic<uint64_t> length;
+        // handle of the completion signal of the dispatch
+        std::atomic<uint64_t> signal;
+    };
 
-    Kalmar::HSAQueue* hsaQueue;
+    static const uint64_t RECORD_RELEASED = 1;
+    static const uint64_t RECORD_COUNT = KERNARG_RING_SIZE / KERNARG_RING_ALIGNMENT;
 
-public:
-    std::shared_future<void>* getFuture() override { return future; }
+    char* base;
+    Record* records;
+    std::atomic<uint64_t> head;
+    std::atomic<uint64_t> tail;
 
-    void* getNativeHandle() override { return &signal; }
+    Record& getRecord(uint64_t offset) {
+        return records[(offset % KERNARG_RING_SIZE) / KERNARG_RING_ALIGNMENT];
+    }
 
-    void setWaitMode(Kalmar::hcWaitMode mode) override {
-        switch (mode) {
-            case Kalmar::hcWaitModeBlocked:
-                waitMode = HSA_WAIT_STATE_BLOCKED;
-            break;
-            case Kalmar::hcWaitModeActive:
-                waitMode = HSA_WAIT_STATE_ACTIVE;
-            break;
+    // advance tail past all completed allocations at the front of the ring
+    void reclaim() {
+        uint64_t t = tail.load(std::memory_order_acquire);
+        while (t != head.load(std::memory_order_acquire)) {
+            Record& record = getRecord(t);
+            uint64_t state = record.state.load(std::memory_order_acquire);
+            if ((state & ~RECORD_RELEASED) != t) {
+                // claimed but not recorded yet
+                break;
+            }
+            if (!(state & RECORD_RELEASED)) {
+                hsa_signal_t signal;
+                signal.handle = record.signal.load(std::memory_order_relaxed);
+                if (hsa_signal_load_acquire(signal) != 0) {
+                    break;
+                }
+            }
+            uint64_t length = record.length.load(std::memory_order_relaxed);
+            // on failure t is reloaded and the scan continues from there
+            if (tail.compare_exchange_strong(t, t + length,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_acquire)) {
+                t += length;
+            }
         }
     }
 
-    bool isReady() override {
-        return (hsa_signal_load_acquire(signal) == 0);
-    }
+public:
+    HSAKernargRing() : base(nullptr), records(nullptr), head(0), tail(0) {}
 
-    HSABarrier() : isDispatched(false), future(nullptr), hsaQueue(nullptr), waitMode(HSA_WAIT_STATE_BLOCKED) {}
+    ~HSAKernargRing() {
+        if (base != nullptr) {
+            hsa_amd_memory_pool_free(base);
+            base = nullptr;
+        }
+        delete [] records;
+        records = nullptr;
+    }
 
-    ~HSABarrier() {
-#if KALMAR_DEBUG
-        std::cerr << "HSABarrier::~HSABarrier()\n";
-#endif
-        if (isDispatched) {
-            hsa_status_t status = HSA_STATUS_SUCCESS;
-            status = waitComplete();
-            STATUS_CHECK(status, __LINE__);
+    // carve the ring buffer from the given kernarg region
+    hsa_status_t init(hsa_amd_memory_pool_t region, hsa_agent_t agent) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        void* memory = nullptr;
+        status = hsa_amd_memory_pool_allocate(region, KERNARG_RING_SIZE, 0, &memory);
+        if (status != HSA_STATUS_SUCCESS) {
+            return status;
         }
-        dispose();
+        status = hsa_amd_agents_allow_access(1, &agent, NULL, memory);
+        if (status != HSA_STATUS_SUCCESS) {
+            hsa_amd_memory_pool_free(memory);
+            return status;
+        }
+        records = new Record[RECORD_COUNT];
+        for (uint64_t i = 0; i < RECORD_COUNT; ++i) {
+            records[i].state.store(~RECORD_RELEASED, std::memory_order_relaxed);
+        }
+        base = static_cast<char*>(memory);
+        return status;
     }
 
-    hsa_status_t enqueueBarrier(hsa_queue_t* queue);
+    // allocate kernel arguments of a dispatch signaled by the given signal
+    // returns nullptr if the ring is not available or full
+    void* allocate(size_t size, hsa_signal_t signal, uint64_t* offset) {
+        if (base == nullptr) {
+            return nullptr;
+        }
+        size = (size + KERNARG_RING_ALIGNMENT - 1) & ~(uint64_t)(KERNARG_RING_ALIGNMENT - 1);
+        if (size > KERNARG_RING_SIZE) {
+            return nullptr;
+        }
 
-    hsa_status_t enqueueAsync(Kalmar::HSAQueue*);
+        uint64_t old = head.load(std::memory_order_relaxed);
+        uint64_t start, next;
+        do {
+            // kernel arguments are contiguous, skip the end of the ring if
+            // they don't fit there
+            start = old;
+            uint64_t physical = old % KERNARG_RING_SIZE;
+            if (physical + size > KERNARG_RING_SIZE) {
+                start += KERNARG_RING_SIZE - physical;
+            }
+            next = start + size;
+            if (next - tail.load(std::memory_order_acquire) > KERNARG_RING_SIZE) {
+                reclaim();
+                if (next - tail.load(std::memory_order_acquire) > KERNARG_RING_SIZE) {
+                    return nullptr;
+                }
+            }
+        } while (!head.compare_exchange_weak(old, next,
+                                             std::memory_order_acq_rel,
+                                             std::memory_order_relaxed));
 
-    // wait for the barrier to complete
-    hsa_status_t waitComplete();
+        Record& record = getRecord(old);
+        record.length.store(next - old, std::memory_order_relaxed);
+        record.signal.store(signal.handle, std::memory_order_relaxed);
+        record.state.store(old, std::memory_order_release);
 
-    void dispose();
+        *offset = old;
+        return base + (start % KERNARG_RING_SIZE);
+    }
 
-    uint64_t getTimestampFrequency() override {
-        // get system tick frequency
-        uint64_t timestamp_frequency_hz = 0L;
-        hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_frequency_hz);
-        return timestamp_frequency_hz;
+    // release kernel arguments allocated at the given offset
+    void release(uint64_t offset) {
+        // the allocation may already be reclaimed once its signal reached 0,
+        // in which case the record belongs to a newer allocation
+        uint64_t expected = offset;
+        getRecord(offset).state.compare_exchange_strong(expected, offset | RECORD_RELEASED,
+                                                        std::memory_order_acq_rel);
+        reclaim();
     }
+}; // end of HSAKernargRing
+
+// kernarg memory allocated from either the kernarg ring of a queue or the
+// kernarg pool of a device
+// LRU cache of locked host memory ranges, keyed by address and size
+// Repeated transfers between the same pageable host buffers and a device
+// don't lock and unlock them every time.  A cached range stays locked until
+// it's evicted, so the host memory must stay allocated while it's cached.
+// Ranges in use by a transfer are never evicted.
+class HSAPinnedCache {
+private:
+    struct Entry {
+        void* ptr;
+        size_t size;
+        // device accessible address of the range
+        void* va;
+        // number of transfers using the range
+        int users;
+    };
 
-    uint64_t getBeginTimestamp() override;
+    // most recently used range first
+    std::list<Entry> entries;
+    size_t capacity;
+    hsa_agent_t agent;
+    std::mutex mutex;
+
+    // unlock least recently used ranges no transfer uses beyond capacity
+    void evict() {
+        auto iter = entries.end();
+        while (entries.size() > capacity && iter != entries.begin()) {
+            --iter;
+            if (iter->users == 0) {
+                hsa_amd_memory_unlock(iter->ptr);
+                iter = entries.erase(iter);
+            }
+        }
+    }
 
-    uint64_t getEndTimestamp() override;
+public:
+    HSAPinnedCache() : entries(), capacity(0), agent(), mutex() {}
 
-}; // end of HSABarrier
+    ~HSAPinnedCache() {
+        for (Entry& entry : entries) {
+            hsa_amd_memory_unlock(entry.ptr);
+        }
+        entries.clear();
+    }
 
-class HSADispatch : public Kalmar::KalmarAsyncOp {
-private:
-    Kalmar::HSADevice* device;
-    hsa_agent_t agent;
-    HSAKernel* kernel;
+    void init(size_t capacity, hsa_agent_t agent) {
+        this->capacity = capacity;
+        this->agent = agent;
+    }
 
-    std::vector<uint8_t> arg_vec;
-    uint32_t arg_count;
-    size_t prevArgVecCapacity;
-    void* kernargMemory;
-    int kernargMemoryIndex;
+    bool isEnabled() const { return capacity > 0; }
 
-    int launchDimensions;
-    uint32_t workgroup_size[3];
-    uint32_t global_size[3];
+    // get the device accessible address of a host memory range, locking it
+    // if it's not cached yet, and mark the range in use
+    // returns nullptr if the cache is disabled or the range can't be locked
+    void* acquire(void* ptr, size_t size) {
+        if (capacity == 0) {
+            return nullptr;
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto iter = entries.begin(); iter != entries.end(); ++iter) {
+            if (iter->ptr == ptr && iter->size >= size) {
+                entries.splice(entries.begin(), entries, iter);
+                entries.front().users++;
+                return entries.front().va;
+            }
+        }
 
-    hsa_signal_t signal;
-    int signalIndex;
-    hsa_kernel_dispatch_packet_t aql;
-    bool isDispatched;
-    hsa_wait_state_t waitMode;
+        void* va = nullptr;
+        hsa_status_t status = hsa_amd_memory_lock(ptr, size, &agent, 1, &va);
+        if (va == nullptr || status != HSA_STATUS_SUCCESS) {
+            return nullptr;
+        }
+        entries.push_front({ ptr, size, va, 1 });
+        evict();
+        return va;
+    }
 
-    size_t dynamicGroupSize;
+    // mark the most recently acquired range of ptr no longer in use
+    void release(void* ptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (Entry& entry : entries) {
+            if (entry.ptr == ptr && entry.users > 0) {
+                entry.users--;
+                break;
+            }
+        }
+        evict();
+    }
+};
 
-    std::shared_future<void>* future;
+// caching allocator of device memory
+// Freed blocks are kept for later allocations instead of being given back
+// to the HSA runtime.  Blocks up to MEMORY_CACHE_MAX_BLOCK are rounded up to
+// a power of two and kept in one free list per size class, larger blocks are
+// kept in a single free list and reused for requests at most a quarter
+// smaller.  At most MEMORY_CACHE_LIMIT bytes are kept free.
+class HSAMemoryCache {
+private:
+    static const int CLASS_COUNT = 32;
+
+    std::vector<void*> bins[CLASS_COUNT];
+    std::multimap<size_t, void*> largeBlocks;
+    // size of each block handed out by the cache
+    std::map<void*, size_t> blockSizes;
+    size_t cachedBytes;
+    size_t limit;
+    bool enabled;
+    hsa_amd_memory_pool_t pool;
+    std::vector<hsa_agent_t> agents;
+    std::mutex mutex;
+
+    uint64_t hits;
+    uint64_t misses;
+
+    static int sizeClass(size_t size) {
+        int k = 0;
+        while (((size_t)MEMORY_CACHE_MIN_BLOCK << k) < size) {
+            ++k;
+        }
+        return k;
+    }
 
-    Kalmar::HSAQueue* hsaQueue;
+    void* allocateBlock(size_t size) {
+        void* data = nullptr;
+        hsa_status_t status = hsa_amd_memory_pool_allocate(pool, size, 0, &data);
+        if (status != HSA_STATUS_SUCCESS || data == nullptr) {
+            // give cached blocks back to the HSA runtime and try again
+            trimLocked();
+            status = hsa_amd_memory_pool_allocate(pool, size, 0, &data);
+            STATUS_CHECK(status, __LINE__);
+        }
+        status = hsa_amd_agents_allow_access(agents.size(), agents.data(), NULL, data);
+        STATUS_CHECK(status, __LINE__);
+        return data;
+    }
 
-public:
-    std::shared_future<void>* getFuture() override { return future; }
+    size_t trimLocked() {
+        size_t released = cachedBytes;
+        for (int k = 0; k < CLASS_COUNT; ++k) {
+            for (void* block : bins[k]) {
+                hsa_amd_memory_pool_free(block);
+                blockSizes.erase(block);
+            }
+            bins[k].clear();
+        }
+        for (auto& block : largeBlocks) {
+            hsa_amd_memory_pool_free(block.second);
+            blockSizes.erase(block.second);
+        }
+        largeBlocks.clear();
+        cachedBytes = 0;
+        return released;
+    }
 
-    void* getNativeHandle() override { return &signal; }
+public:
+    HSAMemoryCache() : largeBlocks(), blockSizes(), cachedBytes(0), limit(MEMORY_CACHE_LIMIT), enabled(false),
+                       pool(), agents(), mutex(), hits(0), misses(0) {}
 
-    void setWaitMode(Kalmar::hcWaitMode mode) override {
-        switch (mode) {
-            case Kalmar::hcWaitModeBlocked:
-                waitMode = HSA_WAIT_STATE_BLOCKED;
-            break;
-            case Kalmar::hcWaitModeActive:
-                waitMode = HSA_WAIT_STATE_ACTIVE;
-            break;
-        }
+    ~HSAMemoryCache() {
+        trimLocked();
     }
 
-    bool isReady() override {
-        return (hsa_signal_load_acquire(signal) == 0);
+    void init(bool enabled, size_t limit, hsa_amd_memory_pool_t pool, const std::vector<hsa_agent_t>& agents) {
+        this->enabled = enabled;
+        this->limit = limit;
+        this->pool = pool;
+        this->agents = agents;
     }
 
-    ~HSADispatch() {
-#if KALMAR_DEBUG
-        std::cerr << "HSADispatch::~HSADispatch()\n";
-#endif
+    bool isEnabled() const { return enabled; }
+
+    // allocate a block of at least size bytes accessible by the agents
+    void* allocate(size_t size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        void* data = nullptr;
+        size_t blockSize = size;
+        if (size <= MEMORY_CACHE_MAX_BLOCK) {
+            int k = sizeClass(size);
+            blockSize = (size_t)MEMORY_CACHE_MIN_BLOCK << k;
+            if (!bins[k].empty()) {
+                data = bins[k].back();
+                bins[k].pop_back();
+            }
+        } else {
+            auto it = largeBlocks.lower_bound(size);
+            if (it != largeBlocks.end() && it->first - size <= size / 4) {
+                blockSize = it->first;
+                data = it->second;
+                largeBlocks.erase(it);
+            }
+        }
 
-        if (isDispatched) {
-            hsa_status_t status = HSA_STATUS_SUCCESS;
-            status = waitComplete();
-            STATUS_CHECK(status, __LINE__);
+        if (data != nullptr) {
+            ++hits;
+            cachedBytes -= blockSize;
+            return data;
         }
-        dispose();
+        ++misses;
+        data = allocateBlock(blockSize);
+        blockSizes[data] = blockSize;
+        return data;
     }
 
-    hsa_status_t setDynamicGroupSegment(size_t dynamicGroupSize) {
-        this->dynamicGroupSize = dynamicGroupSize;
-        return HSA_STATUS_SUCCESS;
+    // keep the block for later allocations, returns false if the block
+    // doesn't come from the cache
+    bool release(void* ptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = blockSizes.find(ptr);
+        if (it == blockSizes.end()) {
+            return false;
+        }
+        size_t blockSize = it->second;
+        if (cachedBytes + blockSize > limit) {
+            hsa_amd_memory_pool_free(ptr);
+            blockSizes.erase(it);
+            return true;
+        }
+        if (blockSize <= MEMORY_CACHE_MAX_BLOCK) {
+            bins[sizeClass(blockSize)].push_back(ptr);
+        } else {
+            largeBlocks.insert(std::make_pair(blockSize, ptr));
+        }
+        cachedBytes += blockSize;
+        return true;
     }
 
-    HSADispatch(Kalmar::HSADevice* _device, HSAKernel* _kernel);
-
-    hsa_status_t pushFloatArg(float f) { return pushArgPrivate(f); }
-    hsa_status_t pushIntArg(int i) { return pushArgPrivate(i); }
-    hsa_status_t pushBooleanArg(unsigned char z) { return pushArgPrivate(z); }
-    hsa_status_t pushByteArg(char b) { return pushArgPrivate(b); }
-    hsa_status_t pushLongArg(long j) { return pushArgPrivate(j); }
-    hsa_status_t pushDoubleArg(double d) { return pushArgPrivate(d); }
-    hsa_status_t pushPointerArg(void *addr) { return pushArgPrivate(addr); }
+    // give all free blocks back to the HSA runtime, returns the number of
+    // bytes released
+    size_t trim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return trimLocked();
+    }
 
-    hsa_status_t clearArgs() {
-        arg_count = 0;
-        arg_vec.clear();
-        return HSA_STATUS_SUCCESS;
+    uint64_t getHits() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return hits;
     }
 
-    hsa_status_t setLaunchAttributes(int dims, size_t *globalDims, size_t *localDims);
+    uint64_t getMisses() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return misses;
+    }
 
-    hsa_status_t dispatchKernelWaitComplete(Kalmar::HSAQueue*);
+    size_t getCachedBytes() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return cachedBytes;
+    }
+};
 
-    hsa_status_t dispatchKernelAsync(Kalmar::HSAQueue*);
+// pinned host buffers to stream pageable host memory to and from a device
+// A transfer is split into chunks of the size of a staging buffer.  The host
+// copies a chunk between pageable memory and a staging buffer while the DMA
+// engines move the previous chunks between other staging buffers and the
+// device, so with more than two buffers several DMA copies are in flight.
+// The buffers are shared by all queues of the device, transfers through
+// them are serialized.
+class HSAStagingBuffers {
+private:
+    std::vector<char*> buffers;
+    std::vector<hsa_signal_t> signals;
+    size_t bufferSize;
+    bool ready;
+    hsa_agent_t agent;
+    hsa_agent_t hostAgent;
+    std::mutex mutex;
+
+    // bytes moved and time spent, in nanoseconds, by transfers to and from
+    // the device
+    std::atomic<uint64_t> writeBytes;
+    std::atomic<uint64_t> writeTime;
+    std::atomic<uint64_t> readBytes;
+    std::atomic<uint64_t> readTime;
+
+    void waitBuffer(size_t i) {
+        hsa_signal_wait_acquire(signals[i], HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX, HSA_WAIT_STATE_ACTIVE);
+    }
 
-    uint32_t getGroupSegmentSize() {
-        hsa_status_t status = HSA_STATUS_SUCCESS;
-        uint32_t group_segment_size = 0;
-        status = hsa_executable_symbol_get_info(kernel->hsaExecutableSymbol,
-                                                HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_GROUP_SEGMENT_SIZE,
-                                                &group_segment_size);
-        STATUS_CHECK(status, __LINE__);
-        return group_segment_size;
+    void waitAll() {
+        for (size_t i = 0; i < buffers.size(); ++i) {
+            waitBuffer(i);
+        }
     }
 
-    // dispatch a kernel asynchronously
-    hsa_status_t dispatchKernel(hsa_queue_t* commandQueue);
+    static uint64_t elapsed(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
 
-    // wait for the kernel to finish execution
-    hsa_status_t waitComplete();
+public:
+    HSAStagingBuffers() : buffers(), signals(), bufferSize(0), ready(false), agent(), hostAgent(), mutex(),
+                          writeBytes(0), writeTime(0), readBytes(0), readTime(0) {}
 
-    void dispose();
+    ~HSAStagingBuffers() {
+        for (char* buffer : buffers) {
+            hsa_amd_memory_pool_free(buffer);
+        }
+        buffers.clear();
+        for (hsa_signal_t signal : signals) {
+            hsa_signal_destroy(signal);
+        }
+        signals.clear();
+    }
 
-    uint64_t getTimestampFrequency() override {
-        // get system tick frequency
-        uint64_t timestamp_frequency_hz = 0L;
-        hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_frequency_hz);
-        return timestamp_frequency_hz;
+    // allocate count staging buffers of size bytes from the given host
+    // memory pool
+    hsa_status_t init(hsa_amd_memory_pool_t pool, hsa_agent_t agent, hsa_agent_t hostAgent,
+                      size_t size, size_t count) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        this->agent = agent;
+        this->hostAgent = hostAgent;
+        bufferSize = size;
+        for (size_t i = 0; i < count; ++i) {
+            void* memory = nullptr;
+            status = hsa_amd_memory_pool_allocate(pool, size, 0, &memory);
+            if (status != HSA_STATUS_SUCCESS) {
+                return status;
+            }
+            buffers.push_back(static_cast<char*>(memory));
+            status = hsa_amd_agents_allow_access(1, &agent, NULL, memory);
+            if (status != HSA_STATUS_SUCCESS) {
+                return status;
+            }
+            hsa_signal_t signal;
+            status = hsa_signal_create(0, 0, NULL, &signal);
+            if (status != HSA_STATUS_SUCCESS) {
+                return status;
+            }
+            signals.push_back(signal);
+        }
+        ready = (count >= 2 && size > 0);
+        return status;
     }
 
-    uint64_t getBeginTimestamp() override;
+    bool isReady() const { return ready; }
 
-    uint64_t getEndTimestamp() override;
+    // copy count bytes from pageable host memory to device memory
+    hsa_status_t write(void* dst, const void* src, size_t count) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto start = std::chrono::steady_clock::now();
+        size_t chunk = 0;
+        for (size_t done = 0; done < count; done += bufferSize, ++chunk) {
+            size_t i = chunk % buffers.size();
+            size_t size = std::min<size_t>(bufferSize, count - done);
+            // wait for the DMA engine to drain the staging buffer
+            waitBuffer(i);
+            memcpy(buffers[i], (const char*)src + done, size);
+            hsa_signal_store_relaxed(signals[i], 1);
+            status = hsa_amd_memory_async_copy((char*)dst + done, agent, buffers[i], hostAgent, size, 0, NULL, signals[i]);
+            if (status != HSA_STATUS_SUCCESS) {
+                hsa_signal_store_relaxed(signals[i], 0);
+                break;
+            }
+        }
+        waitAll();
+        if (status == HSA_STATUS_SUCCESS) {
+            writeBytes.fetch_add(count, std::memory_order_relaxed);
+            writeTime.fetch_add(elapsed(start), std::memory_order_relaxed);
+        }
+        return status;
+    }
 
-private:
-    template <typename T>
-    hsa_status_t pushArgPrivate(T val) {
+    // copy count bytes from device memory to pageable host memory
+    hsa_status_t read(void* dst, const void* src, size_t count) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        std::lock_guard<std::mutex> lock(mutex);
+        auto start = std::chrono::steady_clock::now();
+        size_t chunks = (count + bufferSize - 1) / bufferSize;
+        size_t ahead = buffers.size() - 1;
+
+        // start moving a chunk from the device into its staging buffer
+        auto fill = [&] (size_t chunk) {
+            size_t i = chunk % buffers.size();
+            size_t done = chunk * bufferSize;
+            size_t size = std::min<size_t>(bufferSize, count - done);
+            hsa_signal_store_relaxed(signals[i], 1);
+            hsa_status_t ret = hsa_amd_memory_async_copy(buffers[i], hostAgent, (const char*)src + done, agent, size, 0, NULL, signals[i]);
+            if (ret != HSA_STATUS_SUCCESS) {
+                hsa_signal_store_relaxed(signals[i], 0);
+            }
+            return ret;
+        };
+
+        // keep all but one staging buffer filling while the host drains one
+        for (size_t chunk = 0; chunk < chunks && chunk < ahead && status == HSA_STATUS_SUCCESS; ++chunk) {
+            status = fill(chunk);
+        }
+        for (size_t chunk = 0; chunk < chunks && status == HSA_STATUS_SUCCESS; ++chunk) {
+            if (chunk + ahead < chunks) {
+                status = fill(chunk + ahead);
+                if (status != HSA_STATUS_SUCCESS) {
+                    break;
+                }
+            }
+            size_t i = chunk % buffers.size();
+            size_t done = chunk * bufferSize;
+            waitBuffer(i);
+            memcpy((char*)dst + done, buffers[i], std::min<size_t>(bufferSize, count - done));
+        }
+        waitAll();
+        if (status == HSA_STATUS_SUCCESS) {
+            readBytes.fetch_add(count, std::memory_order_relaxed);
+            readTime.fetch_add(elapsed(start), std::memory_order_relaxed);
+        }
+        return status;
+    }
+
+    // copy count bytes from device memory of another agent to device memory
+    // the DMA engines move each chunk into a staging buffer and then out of
+    // it, the copy out of a staging buffer waits for the copy into it on the
+    // device so the host only waits before reusing a staging buffer
+    hsa_status_t transfer(void* dst, const void* src, hsa_agent_t srcAgent, size_t count) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        std::lock_guard<std::mutex> lock(mutex);
+
+        std::vector<hsa_signal_t> inSignals(buffers.size());
+        for (size_t i = 0; i < buffers.size() && status == HSA_STATUS_SUCCESS; ++i) {
+            status = hsa_amd_agents_allow_access(1, &srcAgent, NULL, buffers[i]);
+            if (status == HSA_STATUS_SUCCESS) {
+                status = hsa_signal_create(0, 0, NULL, &inSignals[i]);
+                if (status != HSA_STATUS_SUCCESS) {
+                    inSignals.resize(i);
+                }
+            } else {
+                inSignals.resize(i);
+            }
+        }
+
+        size_t chunk = 0;
+        for (size_t done = 0; done < count && status == HSA_STATUS_SUCCESS; done += bufferSize, ++chunk) {
+            size_t i = chunk % buffers.size();
+            size_t size = std::min<size_t>(bufferSize, count - done);
+            // wait for the DMA engine to drain the staging buffer
+            waitBuffer(i);
+            hsa_signal_store_relaxed(inSignals[i], 1);
+            status = hsa_amd_memory_async_copy(buffers[i], hostAgent, (const char*)src + done, srcAgent, size, 0, NULL, inSignals[i]);
+            if (status != HSA_STATUS_SUCCESS) {
+                hsa_signal_store_relaxed(inSignals[i], 0);
+                break;
+            }
+            hsa_signal_store_relaxed(signals[i], 1);
+            status = hsa_amd_memory_async_copy((char*)dst + done, agent, buffers[i], hostAgent, size, 1, &inSignals[i], signals[i]);
+            if (status != HSA_STATUS_SUCCESS) {
+                hsa_signal_wait_acquire(inSignals[i], HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX, HSA_WAIT_STATE_ACTIVE);
+                hsa_signal_store_relaxed(signals[i], 0);
+            }
+        }
+        waitAll();
+
+        for (hsa_signal_t signal : inSignals) {
+            hsa_signal_destroy(signal);
+        }
+        return status;
+    }
+
+    // bandwidth achieved by transfers in one direction, in bytes per second
+    double getBandwidth(bool toDevice) const {
+        uint64_t bytes = toDevice ? writeBytes.load(std::memory_order_relaxed) : readBytes.load(std::memory_order_relaxed);
+        uint64_t time = toDevice ? writeTime.load(std::memory_order_relaxed) : readTime.load(std::memory_order_relaxed);
+        return (time > 0) ? (double)bytes * 1e9 / time : 0.0;
+    }
+};
+
+// host buffers of map() of device memory which the host can't access
+// A mapped range is copied into a host buffer.  If it's mapped to be
+// modified, a snapshot of the host buffer is kept, and only the pages which
+// differ from it are copied back in unmap().  A range mapped to be
+// overwritten is neither copied in nor compared, all of it is copied back.
+// Buffers are kept after unmap() for reuse by later map() calls.
+class HSAMapBuffers {
+private:
+    struct Buffer {
+        size_t capacity;
+        bool mapped;
+        std::vector<char> snapshot;
+    };
+
+    std::map<char*, Buffer> buffers;
+    size_t unusedCount;
+    hsa_amd_memory_pool_t pool;
+    hsa_agent_t agent;
+    std::mutex mutex;
+
+    // returns the smallest unused buffer of at least count bytes, or
+    // allocates one
+    char* getBuffer(size_t count) {
+        char* found = nullptr;
+        for (auto& buffer : buffers) {
+            if (!buffer.second.mapped && buffer.second.capacity >= count &&
+                (found == nullptr || buffer.second.capacity < buffers[found].capacity)) {
+                found = buffer.first;
+            }
+        }
+        if (found != nullptr) {
+            --unusedCount;
+            return found;
+        }
+
+        void* data = nullptr;
+        hsa_status_t status = hsa_amd_memory_pool_allocate(pool, count, 0, &data);
+        if (status != HSA_STATUS_SUCCESS || data == nullptr) {
+            return nullptr;
+        }
+        status = hsa_amd_agents_allow_access(1, &agent, NULL, data);
+        STATUS_CHECK(status, __LINE__);
+        buffers[static_cast<char*>(data)] = { count, false, std::vector<char>() };
+        return static_cast<char*>(data);
+    }
+
+public:
+    HSAMapBuffers() : buffers(), unusedCount(0), pool(), agent(), mutex() {}
+
+    ~HSAMapBuffers() {
+        for (auto& buffer : buffers) {
+            hsa_amd_memory_pool_free(buffer.first);
+        }
+        buffers.clear();
+    }
+
+    void init(hsa_amd_memory_pool_t pool, hsa_agent_t agent) {
+        this->pool = pool;
+        this->agent = agent;
+    }
+
+    // copy count bytes of device memory into a host buffer, unless they are
+    // all going to be overwritten, returns nullptr if no host buffer can be
+    // allocated
+    void* map(const void* device, size_t count, bool modify, bool overwrite = false) {
+        std::lock_guard<std::mutex> lock(mutex);
+        char* data = getBuffer(count);
+        if (data == nullptr) {
+            return nullptr;
+        }
+        if (!overwrite) {
+            hsa_status_t status = hsa_memory_copy(data, device, count);
+            STATUS_CHECK(status, __LINE__);
+        }
+
+        Buffer& buffer = buffers[data];
+        buffer.mapped = true;
+        if (modify && !overwrite) {
+            buffer.snapshot.assign(data, data + count);
+        } else {
+            buffer.snapshot.clear();
+        }
+        return data;
+    }
+
+    // copy the pages of the host buffer modified since map() back to device
+    // memory, and keep the host buffer for reuse
+    void unmap(void* device, void* addr, size_t count, bool modify) {
+        std::lock_guard<std::mutex> lock(mutex);
+        char* data = static_cast<char*>(addr);
+        auto it = buffers.find(data);
+        assert(it != buffers.end());
+        Buffer& buffer = it->second;
+
+        if (modify) {
+            const char* snapshot = buffer.snapshot.data();
+            bool tracked = (buffer.snapshot.size() == count);
+            // copy each run of consecutive modified pages at once
+            size_t first = 0;
+            size_t offset = 0;
+            while (offset < count) {
+                size_t size = std::min<size_t>(MAP_PAGE_SIZE, count - offset);
+                bool dirty = !tracked || memcmp(data + offset, snapshot + offset, size) != 0;
+                offset += size;
+                if (!dirty || offset == count) {
+                    size_t end = dirty ? offset : offset - size;
+                    if (end > first) {
+                        hsa_status_t status = hsa_memory_copy((char*)device + first, data + first, end - first);
+                        STATUS_CHECK(status, __LINE__);
+                    }
+                    first = offset;
+                }
+            }
+        }
+        buffer.mapped = false;
+        buffer.snapshot.clear();
+
+        if (unusedCount < MAP_BUFFER_COUNT) {
+            ++unusedCount;
+        } else {
+            hsa_amd_memory_pool_free(data);
+            buffers.erase(it);
+        }
+    }
+};
+
+// autotuner of the workgroup shape of kernels launched without one
+// Launches are classified by kernel name, number of dimensions and the power
+// of two each global dimension rounds up to.  The first launches of a class
+// try its candidate shapes in turn, AUTOTUNE_TRIALS times each, and the shape
+// taking the least time per work-item is used for all later launches of the
+// class.  Chosen shapes are appended to the autotune file, if there is one,
+// and loaded from it on later runs.
+class HSAWorkgroupTuner {
+private:
+    struct Candidate {
+        uint32_t shape[3];
+        // least time per work-item seen, in nanoseconds
+        double best;
+        int samples;
+    };
+
+    struct Entry {
+        std::vector<Candidate> candidates;
+        // launches issued while tuning, candidates are tried round-robin
+        size_t issued;
+        bool done;
+        uint32_t winner[3];
+    };
+
+    std::map<std::string, Entry> entries;
+    bool enabled;
+    std::string path;
+    std::mutex mutex;
+
+    // candidate shapes of a launch of dims dimensions, within the limits of
+    // the device and not larger than the grid
+    static std::vector<Candidate> candidatesOf(int dims, const size_t* globalDims,
+                                               uint32_t maxSize, const uint16_t* maxDim) {
+        static const uint32_t shapes1[][3] = {
+            {64, 1, 1}, {128, 1, 1}, {256, 1, 1}, {512, 1, 1}, {1024, 1, 1}
+        };
+        static const uint32_t shapes2[][3] = {
+            {64, 1, 1}, {16, 4, 1}, {8, 8, 1}, {256, 1, 1},
+            {64, 4, 1}, {32, 8, 1}, {16, 16, 1}, {128, 2, 1}
+        };
+        static const uint32_t shapes3[][3] = {
+            {64, 1, 1}, {16, 4, 1}, {8, 8, 1}, {4, 4, 4},
+            {256, 1, 1}, {64, 4, 1}, {16, 16, 1}, {8, 8, 4}
+        };
+        const uint32_t (*shapes)[3] = (dims == 1) ? shapes1 : (dims == 2) ? shapes2 : shapes3;
+        size_t count = (dims == 1) ? sizeof(shapes1) / sizeof(shapes1[0]) :
+                       (dims == 2) ? sizeof(shapes2) / sizeof(shapes2[0]) :
+                                     sizeof(shapes3) / sizeof(shapes3[0]);
+
+        std::vector<Candidate> ret;
+        for (size_t n = 0; n < count; ++n) {
+            Candidate c = { { 1, 1, 1 }, 0, 0 };
+            for (int i = 0; i < dims; ++i) {
+                c.shape[i] = std::min<size_t>(std::min<size_t>(shapes[n][i], maxDim[i]), globalDims[i]);
+            }
+            if (c.shape[0] * c.shape[1] * c.shape[2] > maxSize) {
+                continue;
+            }
+            bool found = false;
+            for (const Candidate& other : ret) {
+                found |= (memcmp(other.shape, c.shape, sizeof(c.shape)) == 0);
+            }
+            if (!found) {
+                ret.push_back(c);
+            }
+        }
+        return ret;
+    }
+
+    void finish(const std::string& key, Entry& entry, const uint32_t shape[3]) {
+        entry.done = true;
+        memcpy(entry.winner, shape, sizeof(entry.winner));
+        std::vector<Candidate>().swap(entry.candidates);
+        if (!path.empty()) {
+            std::ofstream file(path, std::ios::app);
+            file << key << " " << shape[0] << " " << shape[1] << " " << shape[2] << "\n";
+        }
+    }
+
+public:
+    HSAWorkgroupTuner() : entries(), enabled(false), path(), mutex() {}
+
+    void init(bool enabled, const std::string& path) {
+        this->enabled = enabled;
+        this->path = path;
+        if (!enabled || path.empty()) {
+            return;
+        }
+        std::ifstream file(path);
+        std::string key;
+        Entry entry = { std::vector<Candidate>(), 0, true, { 1, 1, 1 } };
+        while (file >> key >> entry.winner[0] >> entry.winner[1] >> entry.winner[2]) {
+            entries[key] = entry;
+        }
+    }
+
+    bool isEnabled() const { return enabled; }
+
+    // the class of a launch of kernel name
+    static std::string classOf(const std::string& name, int dims, const size_t* globalDims) {
+        std::ostringstream key;
+        key << name << ":" << dims;
+        for (int i = 0; i < dims; ++i) {
+            int bucket = 0;
+            while (((size_t)1 << bucket) < globalDims[i]) {
+                ++bucket;
+            }
+            key << ":" << bucket;
+        }
+        return key.str();
+    }
+
+    // choose the workgroup shape of a launch of class key
+    // candidate is set to the index of the candidate tried, whose time is to
+    // be recorded, or to -1 if the class is tuned already
+    // returns false if no candidate fits, the default shape is used then
+    bool choose(const std::string& key, int dims, const size_t* globalDims,
+                uint32_t maxSize, const uint16_t* maxDim,
+                uint32_t shape[3], int& candidate) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = entries.find(key);
+        if (iter == entries.end()) {
+            Entry entry = { candidatesOf(dims, globalDims, maxSize, maxDim), 0, false, { 1, 1, 1 } };
+            iter = entries.insert(std::make_pair(key, entry)).first;
+            if (iter->second.candidates.empty()) {
+                return false;
+            }
+            if (iter->second.candidates.size() == 1) {
+                finish(key, iter->second, iter->second.candidates[0].shape);
+            }
+        }
+        Entry& entry = iter->second;
+        if (entry.done) {
+            memcpy(shape, entry.winner, sizeof(entry.winner));
+            candidate = -1;
+            return true;
+        }
+        if (entry.candidates.empty()) {
+            return false;
+        }
+        candidate = entry.issued++ % entry.candidates.size();
+        memcpy(shape, entry.candidates[candidate].shape, sizeof(entry.winner));
+        return true;
+    }
+
+    // record the time per work-item of a launch of class key which tried
+    // a candidate, and choose the winner once all candidates are timed
+    void record(const std::string& key, int candidate, double time) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto iter = entries.find(key);
+        if (iter == entries.end() || iter->second.done ||
+            candidate >= iter->second.candidates.size()) {
+            return;
+        }
+        Entry& entry = iter->second;
+        Candidate& c = entry.candidates[candidate];
+        if (c.samples == 0 || time < c.best) {
+            c.best = time;
+        }
+        c.samples++;
+
+        size_t best = 0;
+        for (size_t n = 0; n < entry.candidates.size(); ++n) {
+            if (entry.candidates[n].samples < AUTOTUNE_TRIALS) {
+                return;
+            }
+            if (entry.candidates[n].best < entry.candidates[best].best) {
+                best = n;
+            }
+        }
+        uint32_t winner[3];
+        memcpy(winner, entry.candidates[best].shape, sizeof(winner));
+        finish(key, entry, winner);
+    }
+};
+
+struct HSAKernargAllocation {
+    void* memory;
+    int poolIndex;
+    HSAKernargRing* ring;
+    uint64_t ringOffset;
+};
+
+// a buffer used by a kernel, and whether the kernel may modify it
+// dev points to the data of the buffer on the device, which holds the
+// dependency slots of the buffer
+struct HSABufferUse {
+    Kalmar::dev_info* dev;
+    bool modify;
+};
+
+// an event recorded while tracing, a span of host time of the thread which
+// recorded it, or of device time on a track of the agents
+struct HSATraceEvent {
+    char name[64];
+    const char* category;
+    // nanoseconds of the host steady clock
+    uint64_t begin;
+    uint64_t end;
+    // bytes of copies and maps, 0 for the other events
+    uint64_t size;
+    // id of the HSA queue of device events, 0 for host events
+    uint32_t track;
+    bool device;
+};
+
+// a tracer of the runtime, enabled by environment variable HCC_TRACE
+// each thread records its events in a ring of its own, without any lock,
+// and a background thread writes them out to the trace file periodically
+// timestamps of the agents are converted to the host clock with the offset
+// between both sampled once the HSA runtime is initialized
+class HSATracer {
+    // a ring of events with a single producer, the thread recording them,
+    // and a single consumer, the thread writing them out
+    struct Ring {
+        std::atomic<uint64_t> head;
+        std::atomic<uint64_t> tail;
+        std::atomic<uint64_t> dropped;
+        uint32_t tid;
+        HSATraceEvent events[TRACE_RING_SIZE];
+
+        Ring(uint32_t tid) : head(0), tail(0), dropped(0), tid(tid) {}
+    };
+
+    std::atomic<bool> active;
+    FILE* file;
+    bool firstEvent;
+
+    // rings of the threads which recorded events, never released while
+    // tracing as the threads may exit before their events are written out
+    std::mutex ringsMutex;
+    std::vector<std::unique_ptr<Ring>> rings;
+
+    std::thread flusher;
+    std::mutex flushMutex;
+    std::condition_variable flushCond;
+    bool stopping;
+
+    // the host time the trace starts at, and the offset of system ticks
+    uint64_t origin;
+    std::atomic<bool> calibrated;
+    uint64_t tickBase;
+    uint64_t hostBase;
+    double nsPerTick;
+
+    // tracks named in the trace so far
+    std::vector<uint32_t> namedTracks;
+
+    Ring* getRing() {
+        static thread_local Ring* ring = nullptr;
+        if (ring == nullptr) {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            rings.emplace_back(new Ring(rings.size() + 1));
+            ring = rings.back().get();
+        }
+        return ring;
+    }
+
+    void push(const char* name, const char* category, uint64_t begin, uint64_t end,
+              uint64_t size, uint32_t track, bool device) {
+        Ring* ring = getRing();
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        if (head - ring->tail.load(std::memory_order_acquire) >= TRACE_RING_SIZE) {
+            ring->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        HSATraceEvent& e = ring->events[head & (TRACE_RING_SIZE - 1)];
+        strncpy(e.name, name, sizeof(e.name) - 1);
+        e.name[sizeof(e.name) - 1] = '\0';
+        e.category = category;
+        e.begin = begin;
+        e.end = end;
+        e.size = size;
+        e.track = track;
+        e.device = device;
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    void writeSeparator() {
+        fputs(firstEvent ? "\n" : ",\n", file);
+        firstEvent = false;
+    }
+
+    void writeString(const char* s) {
+        fputc('"', file);
+        for (; *s; ++s) {
+            if (*s == '"' || *s == '\\')
+                fputc('\\', file);
+            if ((unsigned char)*s >= 0x20)
+                fputc(*s, file);
+        }
+        fputc('"', file);
+    }
+
+    void writeTrackName(int pid, uint32_t tid, const char* name) {
+        writeSeparator();
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":\"", pid, tid);
+        if (tid == copyTrack)
+            fprintf(file, "%s\"}}", name);
+        else
+            fprintf(file, "%s %u\"}}", name, tid);
+    }
+
+    void writeEvent(const Ring& ring, const HSATraceEvent& e) {
+        int pid = e.device ? 2 : 1;
+        uint32_t tid = e.device ? e.track : ring.tid;
+        if (e.device && std::find(namedTracks.begin(), namedTracks.end(), e.track) == namedTracks.end()) {
+            namedTracks.push_back(e.track);
+            writeTrackName(pid, tid, e.track == copyTrack ? "copies" : "queue");
+        }
+        uint64_t begin = e.begin > origin ? e.begin - origin : 0;
+        uint64_t end = e.end > e.begin ? e.end - e.begin : 0;
+        writeSeparator();
+        fputs("{\"name\":", file);
+        writeString(e.name);
+        fprintf(file, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%u",
+                e.category, begin / 1000.0, end / 1000.0, pid, tid);
+        if (e.size > 0)
+            fprintf(file, ",\"args\":{\"bytes\":%llu}", (unsigned long long)e.size);
+        fputc('}', file);
+    }
+
+    // write out the events recorded so far by all the threads
+    void drain() {
+        std::vector<Ring*> current;
+        {
+            std::lock_guard<std::mutex> lock(ringsMutex);
+            for (auto& ring : rings)
+                current.push_back(ring.get());
+        }
+        for (Ring* ring : current) {
+            uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            if (tail == 0 && head > 0)
+                writeTrackName(1, ring->tid, "thread");
+            for (; tail != head; ++tail)
+                writeEvent(*ring, ring->events[tail & (TRACE_RING_SIZE - 1)]);
+            ring->tail.store(tail, std::memory_order_release);
+        }
+        fflush(file);
+    }
+
+    void flushLoop() {
+        std::unique_lock<std::mutex> lock(flushMutex);
+        while (!stopping) {
+            flushCond.wait_for(lock, std::chrono::milliseconds(TRACE_FLUSH_INTERVAL_MS));
+            drain();
+        }
+    }
+
+public:
+    // track of the copies carried out by the DMA engines, which aren't
+    // submitted to HSA queues
+    static const uint32_t copyTrack = UINT32_MAX;
+
+    HSATracer() : active(false), file(nullptr), firstEvent(true), stopping(false), origin(0),
+                  calibrated(false), tickBase(0), hostBase(0), nsPerTick(0.0) {}
+
+    ~HSATracer() { stop(); }
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // start tracing to the file at path
+    void start(const char* path) {
+        file = fopen(path, "w");
+        if (file == nullptr) {
+            std::cerr << "HCC_TRACE: can't open " << path << "\n";
+            return;
+        }
+        fputs("{\"traceEvents\":[", file);
+        writeSeparator();
+        fputs("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"host\"}},\n"
+              "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":2,\"args\":{\"name\":\"HSA agents\"}}", file);
+        origin = now();
+        active.store(true, std::memory_order_relaxed);
+        flusher = std::thread(&HSATracer::flushLoop, this);
+    }
+
+    // sample the offset of the system ticks of the agents to the host clock,
+    // once the HSA runtime is initialized
+    void calibrate() {
+        if (!enabled())
+            return;
+        uint64_t frequency = 0;
+        if (hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &frequency) != HSA_STATUS_SUCCESS ||
+            frequency == 0)
+            return;
+        uint64_t before = now();
+        if (hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP, &tickBase) != HSA_STATUS_SUCCESS)
+            return;
+        hostBase = before + (now() - before) / 2;
+        nsPerTick = 1e9 / frequency;
+        calibrated.store(true, std::memory_order_release);
+    }
+
+    // record a span of host time of the calling thread
+    void record(const char* name, const char* category, uint64_t begin, uint64_t end, uint64_t size = 0) {
+        push(name, category, begin, end, size, 0, false);
+    }
+
+    // record a span of system ticks on the HSA queue track
+    void recordDevice(const char* name, const char* category, uint32_t track,
+                      uint64_t beginTicks, uint64_t endTicks, uint64_t size = 0) {
+        if (!calibrated.load(std::memory_order_acquire) || endTicks <= beginTicks)
+            return;
+        uint64_t begin = hostBase + (uint64_t)((double)((int64_t)(beginTicks - tickBase)) * nsPerTick);
+        uint64_t end = begin + (uint64_t)((endTicks - beginTicks) * nsPerTick);
+        push(name, category, begin, end, size, track, true);
+    }
+
+    // write out the remaining events and close the trace file
+    void stop() {
+        if (!enabled())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(flushMutex);
+            stopping = true;
+        }
+        flushCond.notify_one();
+        flusher.join();
+        active.store(false, std::memory_order_relaxed);
+        drain();
+
+        uint64_t dropped = 0;
+        for (auto& ring : rings)
+            dropped += ring->dropped.load(std::memory_order_relaxed);
+        fputs("\n]}\n", file);
+        fclose(file);
+        file = nullptr;
+        if (dropped > 0)
+            std::cerr << "HCC_TRACE: " << dropped << " events dropped, the rings of "
+                      << TRACE_RING_SIZE << " events were full\n";
+    }
+};
+
+// the tracer, destroyed after the HSA context so the events recorded while
+// the context shuts down are written out
+static HSATracer tracer;
+
+// the profile of the kernels of a run, enabled by environment variable
+// HCC_KERNEL_PROFILE, for the device compiler to optimize the kernels which
+// take the most time: -kernel-attributes reads it with -kernel-profile
+// each line holds a kernel symbol, the number of dispatches timed, their
+// total time in ns and the largest workgroup dimensions they had
+// the dispatches are timed as for tracing, and the profile is merged into
+// the file at exit, so several runs accumulate in it
+class HSAKernelProfile {
+    struct Entry {
+        uint64_t dispatches;
+        uint64_t time;
+        uint32_t workgroup[3];
+    };
+
+    std::atomic<bool> active;
+    std::string path;
+    std::mutex mutex;
+    std::map<std::string, Entry> entries;
+
+    void merge(const std::string& name, const Entry& e) {
+        auto iter = entries.find(name);
+        if (iter == entries.end()) {
+            entries[name] = e;
+            return;
+        }
+        iter->second.dispatches += e.dispatches;
+        iter->second.time += e.time;
+        for (int i = 0; i < 3; ++i)
+            iter->second.workgroup[i] = std::max(iter->second.workgroup[i], e.workgroup[i]);
+    }
+
+public:
+    HSAKernelProfile() : active(false) {}
+
+    ~HSAKernelProfile() { stop(); }
+
+    bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+    void start(const char* file) {
+        path = file;
+        active.store(true, std::memory_order_relaxed);
+    }
+
+    // record a dispatch of the kernel symbol named name, which took time ns
+    void record(const std::string& name, uint64_t time, uint32_t x, uint32_t y, uint32_t z) {
+        if (!enabled())
+            return;
+        Entry e = { 1, time, { x, y, z } };
+        std::lock_guard<std::mutex> lock(mutex);
+        // HSAIL symbols are prefixed with '&', the functions of the module aren't
+        merge(name.compare(0, 1, "&") == 0 ? name.substr(1) : name, e);
+    }
+
+    // merge the profile into the file, adding to the profiles of earlier runs
+    void stop() {
+        if (!active.exchange(false))
+            return;
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string name;
+            Entry e;
+            char comma;
+            if (fields >> name >> e.dispatches >> e.time >> e.workgroup[0] >> comma >> e.workgroup[1]
+                       >> comma >> e.workgroup[2])
+                merge(name, e);
+        }
+        in.close();
+
+        std::ofstream out(path, std::ios::trunc);
+        if (!out) {
+            std::cerr << "HCC_KERNEL_PROFILE: can't write " << path << "\n";
+            return;
+        }
+        for (auto& entry : entries) {
+            const Entry& e = entry.second;
+            out << entry.first << " " << e.dispatches << " " << e.time << " "
+                << e.workgroup[0] << "," << e.workgroup[1] << "," << e.workgroup[2] << "\n";
+        }
+    }
+};
+
+// profile of the kernels, written out at exit after the HSA context shuts
+// down as the tracer is
+static HSAKernelProfile kernelProfile;
+
+// a span of host time recorded from the construction of the scope to its
+// destruction, if tracing is enabled
+class HSATraceScope {
+    const char* name;
+    const char* category;
+    uint64_t size;
+    uint64_t begin;
+public:
+    HSATraceScope(const char* name, const char* category, uint64_t size = 0)
+        : name(name), category(category), size(size), begin(tracer.enabled() ? HSATracer::now() : 0) {}
+
+    ~HSATraceScope() {
+        if (begin != 0)
+            tracer.record(name, category, begin, HSATracer::now(), size);
+    }
+};
+
+// callbacks registered by an external profiler, or null, and the id
+// correlating the callbacks of an operation, defined along with the context
+static inline const Kalmar::KalmarCallbacks* getCallbacks();
+static inline uint64_t nextCorrelationId();
+
+// calls the copy callbacks of an external profiler, if any, around a copy:
+// when the scope begins and when it ends, the copy being done or submitted
+class HSACopyCallbackScope {
+    const Kalmar::KalmarCallbacks* callbacks;
+    hc_copy_record record;
+public:
+    HSACopyCallbackScope(unsigned int device, const void* src, void* dst, size_t size,
+                         Kalmar::hcMemcpyKind kind, bool async = false)
+        : callbacks(getCallbacks()) {
+        if (__builtin_expect(callbacks != nullptr, 0)) {
+            record.device = device;
+            record.src = src;
+            record.dst = dst;
+            record.size = size;
+            record.kind = kind;
+            record.async = async;
+            record.signal = 0;
+            record.correlation_id = nextCorrelationId();
+            if (callbacks->copyBegin)
+                callbacks->copyBegin(&record, callbacks->copyData);
+        }
+    }
+
+    // the signal completing an asynchronous copy
+    void setSignal(hsa_signal_t signal) {
+        record.signal = signal.handle;
+    }
+
+    ~HSACopyCallbackScope() {
+        if (__builtin_expect(callbacks != nullptr, 0) && callbacks->copyEnd)
+            callbacks->copyEnd(&record, callbacks->copyData);
+    }
+};
+
+// call "callback" on the thread of the HSA runtime handling signals once
+// "signal" completes, see KalmarAsyncOp::notifyWhenReady()
+static bool notifySignal(hsa_signal_t signal, std::function<void()> callback) {
+    std::function<void()>* arg = new std::function<void()>(std::move(callback));
+    hsa_status_t status = hsa_amd_signal_async_handler(signal, HSA_SIGNAL_CONDITION_LT, 1,
+        [](hsa_signal_value_t, void* arg) -> bool {
+            std::unique_ptr< std::function<void()> > callback(static_cast<std::function<void()>*>(arg));
+            (*callback)();
+            // the handler is called once
+            return false;
+        }, arg);
+    if (status != HSA_STATUS_SUCCESS) {
+        delete arg;
+        return false;
+    }
+    return true;
+}
+
+class HSABarrier : public Kalmar::KalmarAsyncOp {
+private:
+    hsa_signal_t signal;
+    int signalIndex;
+    bool hasSignal;
+    bool isDispatched;
+    Kalmar::hcWaitMode waitMode;
+
+    // kernarg memory of the packets completing along with the barrier
+    std::vector<HSAKernargAllocation> kernargs;
+
+    // async operations on other queues the packets completing along with the
+    // barrier wait for, kept alive until the barrier completes
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > dependentAsyncOps;
+
+    // ensures waitComplete() is carried out only once by blockingWait()
+    std::once_flag completeFlag;
+
+    Kalmar::HSAQueue* hsaQueue;
+
+    // id of the HSA command queue the barrier was written to, the track of
+    // its execution in the trace
+    uint32_t traceTrack;
+
+    // whether the timestamps of the barrier are collected, see
+    // HSAQueue::acquireProfiling()
+    bool profiled;
+
+    // whether a dispatch of the batch closed by the barrier was written
+    std::atomic<bool> hasBatchedDispatch;
+
+public:
+    void* getNativeHandle() override { return &signal; }
+
+    void setWaitMode(Kalmar::hcWaitMode mode) override {
+        waitMode = mode;
+    }
+
+    bool isReady() override {
+        return (hsa_signal_load_acquire(signal) == 0);
+    }
+
+    bool notifyWhenReady(std::function<void()> callback) override {
+        return hasSignal && notifySignal(signal, std::move(callback));
+    }
+
+    // record a dispatch of the batch closed by the barrier, false if it's
+    // the first one
+    bool addBatchedDispatch() {
+        return hasBatchedDispatch.exchange(true, std::memory_order_relaxed);
+    }
+
+    void blockingWait() override {
+        std::call_once(completeFlag, [this] { waitComplete(); });
+    }
+
+    Kalmar::KalmarQueue* getQueue() override;
+
+    HSABarrier() : hasSignal(false), isDispatched(false), hsaQueue(nullptr), waitMode(Kalmar::hcWaitModeBlocked),
+                   traceTrack(0), profiled(false), hasBatchedDispatch(false) {}
+
+    ~HSABarrier() {
+#if KALMAR_DEBUG
+        std::cerr << "HSABarrier::~HSABarrier()\n";
+#endif
+        if (isDispatched) {
+            hsa_status_t status = HSA_STATUS_SUCCESS;
+            status = waitComplete();
+            STATUS_CHECK(status, __LINE__);
+        }
+        dispose();
+    }
+
+    hsa_status_t enqueueBarrier(hsa_queue_t* queue);
+
+    // enqueue the barrier on an HSA command queue of the HSAQueue, the first
+    // one by default
+    hsa_status_t enqueueAsync(Kalmar::HSAQueue*, hsa_queue_t* queue = nullptr);
+
+    // get the completion signal of the barrier, acquire one if necessary
+    // used by batched dispatches which complete along with the barrier
+    hsa_signal_t getSignal();
+
+    // wait for the barrier to complete
+    hsa_status_t waitComplete();
+
+    // allocate kernarg memory for a packet which completes along with the
+    // barrier, it's released once the barrier completes
+    void* allocKernarg(Kalmar::HSAQueue* hsaQueue, size_t size);
+
+    void releaseKernargs();
+
+    void setDependentAsyncOps(std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> >&& asyncOps) {
+        dependentAsyncOps = std::move(asyncOps);
+    }
+
+    void dispose();
+
+    uint64_t getTimestampFrequency() override {
+        // get system tick frequency
+        uint64_t timestamp_frequency_hz = 0L;
+        hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_frequency_hz);
+        return timestamp_frequency_hz;
+    }
+
+    uint64_t getBeginTimestamp() override;
+
+    uint64_t getEndTimestamp() override;
+
+}; // end of HSABarrier
+
+// an asynchronous copy carried out by a DMA engine of the agent
+// the copy is not submitted to an AQL queue, async operations depending on it
+// always wait for its completion signal
+class HSACopy : public Kalmar::KalmarAsyncOp {
+private:
+    hsa_signal_t signal;
+    int signalIndex;
+    bool hasSignal;
+    bool isDispatched;
+    Kalmar::hcWaitMode waitMode;
+
+    // host memory locked for the copy, unlocked once the copy completes
+    // or released to the pinned cache if it's locked by the cache
+    void* lockedHostPtr;
+    bool cachedHostPtr;
+
+    void unlockHostPtr();
+
+    // host buffer owned by the copy, released once the copy completes
+    std::shared_ptr<const void> heldHostBuffer;
+
+    // bytes copied, traced along with the copy
+    size_t copySize;
+
+    // async operations the copy waits for, kept alive until it completes
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > dependentAsyncOps;
+
+    // ensures waitComplete() is carried out only once by blockingWait()
+    std::once_flag completeFlag;
+
+    Kalmar::HSAQueue* hsaQueue;
+
+public:
+    void* getNativeHandle() override { return &signal; }
+
+    void setWaitMode(Kalmar::hcWaitMode mode) override {
+        waitMode = mode;
+    }
+
+    bool isReady() override {
+        return (hsa_signal_load_acquire(signal) == 0);
+    }
+
+    bool notifyWhenReady(std::function<void()> callback) override {
+        return hasSignal && notifySignal(signal, std::move(callback));
+    }
+
+    void blockingWait() override {
+        std::call_once(completeFlag, [this] { waitComplete(); });
+    }
+
+    // the copy is not ordered by the packet processor of the queue
+    Kalmar::KalmarQueue* getQueue() override { return nullptr; }
+
+    HSACopy() : hasSignal(false), isDispatched(false), waitMode(Kalmar::hcWaitModeBlocked),
+                lockedHostPtr(nullptr), cachedHostPtr(false), copySize(0), hsaQueue(nullptr) {}
+
+    ~HSACopy() {
+#if KALMAR_DEBUG
+        std::cerr << "HSACopy::~HSACopy()\n";
+#endif
+        if (isDispatched) {
+            hsa_status_t status = HSA_STATUS_SUCCESS;
+            status = waitComplete();
+            STATUS_CHECK(status, __LINE__);
+        }
+        dispose();
+    }
+
+    // start copying count bytes from src to dst once the dependent async
+    // operations complete
+    hsa_status_t enqueueAsync(Kalmar::HSAQueue*, const void* src, void* dst, size_t count, Kalmar::hcMemcpyKind kind,
+                              std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> >&& asyncOps);
+
+    // wait for the copy to complete
+    hsa_status_t waitComplete();
+
+    void dispose();
+
+    // keep the host buffer of the copy until it completes
+    void holdHostBuffer(std::shared_ptr<const void> buffer) {
+        heldHostBuffer = std::move(buffer);
+    }
+
+    uint64_t getTimestampFrequency() override {
+        // get system tick frequency
+        uint64_t timestamp_frequency_hz = 0L;
+        hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_frequency_hz);
+        return timestamp_frequency_hz;
+    }
+
+    uint64_t getBeginTimestamp() override;
+
+    uint64_t getEndTimestamp() override;
+
+}; // end of HSACopy
+
+class HSADispatch : public Kalmar::KalmarAsyncOp {
+private:
+    Kalmar::HSADevice* device;
+    hsa_agent_t agent;
+    HSAKernel* kernel;
+
+    std::vector<uint8_t> arg_vec;
+    uint32_t arg_count;
+    size_t prevArgVecCapacity;
+    void* kernargMemory;
+    int kernargMemoryIndex;
+    // set if kernargMemory is carved from the kernarg ring of the queue
+    HSAKernargRing* kernargRing;
+    uint64_t kernargRingOffset;
+
+    int launchDimensions;
+    uint32_t workgroup_size[3];
+    uint32_t global_size[3];
+
+    // class of the launch and candidate workgroup shape it tries while the
+    // workgroup shape is autotuned, -1 if the launch isn't timed
+    std::string autotuneClass;
+    int autotuneCandidate;
+
+    hsa_signal_t signal;
+    int signalIndex;
+    hsa_kernel_dispatch_packet_t aql;
+    // set once the launch dependent fields of aql are filled in
+    bool aqlPrepared;
+    bool isDispatched;
+    Kalmar::hcWaitMode waitMode;
+    Kalmar::hcBarrierMode barrierMode;
+
+    size_t dynamicGroupSize;
+
+    // ensures waitComplete() is carried out only once by blockingWait()
+    std::once_flag completeFlag;
+
+    Kalmar::HSAQueue* hsaQueue;
+
+    // the HSA command queue of hsaQueue the dispatch is written to
+    // null if it's not chosen yet, the first command queue is used then
+    hsa_queue_t* commandQueue;
+
+    // id of the HSA command queue the dispatch was written to, the track of
+    // its execution in the trace
+    uint32_t traceTrack;
+
+    // whether the timestamps of the dispatch are collected, see
+    // HSAQueue::acquireProfiling()
+    bool profiled;
+
+    // the barrier closing the batch this dispatch belongs to
+    // a batched dispatch has no completion signal of its own, it shares the
+    // signal of the barrier and completes along with it
+    std::shared_ptr<HSABarrier> batchBarrier;
+
+    // buffers used by the kernel, registered in HSAQueue::Push()
+    std::vector<HSABufferUse> buffers;
+
+    // whether one of the buffers is host visible, kept once they are taken
+    bool hostVisible;
+
+    // async operations on other queues the dispatch waits for on the device
+    // they are kept alive until the dispatch completes, so their completion
+    // signals are not reused by then
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > dependentAsyncOps;
+
+public:
+    void* getNativeHandle() override { return &signal; }
+
+    void setWaitMode(Kalmar::hcWaitMode mode) override {
+        waitMode = mode;
+    }
+
+    bool isReady() override {
+        return (hsa_signal_load_acquire(signal) == 0);
+    }
+
+    bool notifyWhenReady(std::function<void()> callback) override {
+        return isDispatched && notifySignal(signal, std::move(callback));
+    }
+
+    void blockingWait() override {
+        std::call_once(completeFlag, [this] { waitComplete(); });
+    }
+
+    Kalmar::KalmarQueue* getQueue() override;
+
+    void setBatchBarrier(const std::shared_ptr<HSABarrier>& barrier) {
+        batchBarrier = barrier;
+    }
+
+    ~HSADispatch() {
+#if KALMAR_DEBUG
+        std::cerr << "HSADispatch::~HSADispatch()\n";
+#endif
+
+        if (isDispatched) {
+            hsa_status_t status = HSA_STATUS_SUCCESS;
+            status = waitComplete();
+            STATUS_CHECK(status, __LINE__);
+        }
+        dispose();
+    }
+
+    // fails if the static and dynamic group segments exceed the group
+    // memory of the agent, "maxGroupSize" bytes
+    hsa_status_t setDynamicGroupSegment(size_t dynamicGroupSize, size_t maxGroupSize) {
+        if (maxGroupSize != 0 && kernel->groupSegmentSize + dynamicGroupSize > maxGroupSize)
+            return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+        this->dynamicGroupSize = dynamicGroupSize;
+        return HSA_STATUS_SUCCESS;
+    }
+
+    HSADispatch(Kalmar::HSADevice* _device, HSAKernel* _kernel);
+
+    // create a dispatch out of the prototype held by a launch template
+    // the kernel arguments and the prepared AQL packet are copied over
+    explicit HSADispatch(const HSADispatch* prototype);
+
+    hsa_status_t pushFloatArg(float f) { return pushArgPrivate(f); }
+    hsa_status_t pushIntArg(int i) { return pushArgPrivate(i); }
+    hsa_status_t pushBooleanArg(unsigned char z) { return pushArgPrivate(z); }
+    hsa_status_t pushByteArg(char b) { return pushArgPrivate(b); }
+    hsa_status_t pushLongArg(long j) { return pushArgPrivate(j); }
+    hsa_status_t pushDoubleArg(double d) { return pushArgPrivate(d); }
+    hsa_status_t pushPointerArg(void *addr) { return pushArgPrivate(addr); }
+
+    // append kernel arguments staged on the host, records of the size of
+    // each argument in one byte followed by its bytes, each aligned to its
+    // size as pushArgPrivate does
+    hsa_status_t pushArgs(const uint8_t* records, size_t size) {
+        size_t pos = 0;
+        while (pos < size) {
+            size_t sz = records[pos++];
+            assert((sz == sizeof(double) || sz == sizeof(int) || sz == sizeof(unsigned char)) &&
+                   "Unsupported kernel argument size");
+            size_t offset = arg_vec.size();
+            size_t padding_size = (offset % sz) ? (sz - (offset % sz)) : 0;
+            arg_vec.resize(offset + padding_size + sz, 0);
+            memcpy(arg_vec.data() + offset + padding_size, records + pos, sz);
+            pos += sz;
+            arg_count++;
+        }
+        return HSA_STATUS_SUCCESS;
+    }
+
+    hsa_status_t clearArgs() {
+        arg_count = 0;
+        arg_vec.clear();
+        return HSA_STATUS_SUCCESS;
+    }
+
+    hsa_status_t setLaunchAttributes(int dims, size_t *globalDims, size_t *localDims);
+
+    // fill in the launch dependent fields of the AQL packet
+    void prepareAQLPacket();
+
+    size_t getArgSize() const { return arg_vec.size(); }
+
+    // overwrite serialized kernel arguments
+    hsa_status_t patchArgs(size_t offset, const void* src, size_t size) {
+        if (offset + size > arg_vec.size()) {
+            return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+        }
+        memcpy(arg_vec.data() + offset, src, size);
+        return HSA_STATUS_SUCCESS;
+    }
+
+    // record HSAQueue association
+    void setQueue(Kalmar::HSAQueue* hsaQueue) { this->hsaQueue = hsaQueue; }
+
+    void setCommandQueue(hsa_queue_t* queue) { commandQueue = queue; }
+
+    hsa_queue_t* getCommandQueue() const { return commandQueue; }
+
+    // whether the AQL packet waits for all previous packets on a queue of
+    // the execute order, as the barrier mode chooses
+    bool waitsForPreviousPackets(Kalmar::execute_order order) const {
+        return barrierMode == Kalmar::hcBarrierWait ||
+               (barrierMode == Kalmar::hcBarrierDefault && order == Kalmar::execute_in_order);
+    }
+
+    // choose the barrier bit of the AQL packet, before the dependencies of
+    // the dispatch are resolved
+    void setBarrierMode(Kalmar::hcBarrierMode mode);
+
+    // whether the kernel uses a buffer the host may access meanwhile, see
+    // HSADevice::isHostVisible()
+    bool usesHostVisibleMemory() const { return hostVisible; }
+
+    // set the acquire and release fence scopes of the AQL packet "header" of
+    // the kernel: agent scope where the packets next to it are on the same
+    // agent, see the definition
+    void setFenceScopes(uint16_t& header, bool agentAcquire, bool agentRelease) const;
+
+    // make the AQL packet wait for all previous packets
+    void setBarrierBit() {
+        if (!aqlPrepared) {
+            prepareAQLPacket();
+        }
+        aql.header |= (1 << HSA_PACKET_HEADER_BARRIER);
+    }
+
+    // register a buffer used by the kernel
+    void addBuffer(Kalmar::dev_info* dev, bool modify);
+
+    void setDependentAsyncOps(std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> >&& asyncOps) {
+        dependentAsyncOps = std::move(asyncOps);
+    }
+
+    // detach the buffers registered with the kernel
+    std::vector<HSABufferUse> takeBuffers() {
+        std::vector<HSABufferUse> ret;
+        ret.swap(buffers);
+        return ret;
+    }
+
+    const hsa_kernel_dispatch_packet_t& getAQLPacket() const { return aql; }
+
+    const std::vector<uint8_t>& getArgs() const { return arg_vec; }
+
+    // size of the kernarg memory needed by the dispatch
+    size_t getKernargSize() const {
+        // the kernarg segment of the kernel object may be larger than
+        // the arguments pushed, i.e., with hidden arguments
+        return std::max(arg_vec.size(), (size_t)kernel->kernargSegmentSize);
+    }
+
+    hsa_status_t dispatchKernelWaitComplete(Kalmar::HSAQueue*);
+
+    // give kernarg memory back to the kernarg ring or the kernarg pool
+    void releaseKernargMemory();
+
+    hsa_status_t dispatchKernelAsync(Kalmar::HSAQueue*);
+
+    uint32_t getGroupSegmentSize() {
+        return kernel->groupSegmentSize;
+    }
+
+    // dispatch a kernel asynchronously
+    hsa_status_t dispatchKernel(hsa_queue_t* commandQueue);
+
+    // wait for the kernel to finish execution
+    hsa_status_t waitComplete();
+
+    void dispose();
+
+    uint64_t getTimestampFrequency() override {
+        // get system tick frequency
+        uint64_t timestamp_frequency_hz = 0L;
+        hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_frequency_hz);
+        return timestamp_frequency_hz;
+    }
+
+    uint64_t getBeginTimestamp() override;
+
+    uint64_t getEndTimestamp() override;
+
+private:
+    template <typename T>
+    hsa_status_t pushArgPrivate(T val) {
         /* add padding if necessary */
         int padding_size = (arg_vec.size() % sizeof(T)) ? (sizeof(T) - (arg_vec.size() % sizeof(T))) : 0;
 #if KALMAR_DEBUG
@@ -487,6 +2494,92 @@ private:
 
 }; // end of HSADispatch
 
+// A kernel launch captured once, which could be submitted many times.
+//
+// The template keeps a prototype HSADispatch with serialized kernel arguments
+// and a prepared AQL packet, and the buffers used by the kernel.  Each launch
+// copies the prototype into a new HSADispatch, which only needs a completion
+// signal and kernarg memory before being written into the queue.
+class HSALaunchTemplate : public Kalmar::KalmarLaunchTemplate {
+private:
+    Kalmar::HSAQueue* hsaQueue;
+    HSADispatch* prototype;
+    std::vector<HSABufferUse> buffers;
+
+public:
+    HSALaunchTemplate(Kalmar::HSAQueue* _hsaQueue, HSADispatch* _prototype, std::vector<HSABufferUse>&& _buffers) :
+        hsaQueue(_hsaQueue), prototype(_prototype), buffers(std::move(_buffers)), exportedKernarg(nullptr) {}
+
+    ~HSALaunchTemplate() {
+        if (exportedKernarg != nullptr) {
+            hsa_amd_memory_pool_free(exportedKernarg);
+        }
+        delete prototype;
+    }
+
+    std::shared_ptr<Kalmar::KalmarAsyncOp> launch(Kalmar::hcBarrierMode barrier) override;
+
+    size_t getArgSize() override { return prototype->getArgSize(); }
+
+    void patchArgs(size_t offset, const void* src, size_t size) override {
+        hsa_status_t status = prototype->patchArgs(offset, src, size);
+        STATUS_CHECK(status, __LINE__);
+    }
+
+    bool exportPacket(void* packet) override;
+
+    HSADispatch* getPrototype() { return prototype; }
+
+    const std::vector<HSABufferUse>& getBuffers() const { return buffers; }
+
+private:
+    // the kernel arguments of the exported packet, in the kernarg region
+    void* exportedKernarg;
+}; // end of HSALaunchTemplate
+
+// A sequence of kernel launches and markers recorded on an HSAQueue, which
+// could be replayed many times.
+//
+// Kernel launches are recorded as launch templates.  Dependencies between
+// them are resolved at capture time: on a queue executing in order every
+// packet has the barrier bit on already, otherwise the barrier bit is set on
+// a kernel which uses a buffer used by an earlier kernel after the last
+// marker.  A replay writes all packets back to back, without completion
+// signals, and closes them with a barrier packet carrying the only signal
+// and ringing the doorbell once.
+class HSAGraph : public Kalmar::KalmarGraph {
+private:
+    struct Node {
+        // nullptr for markers
+        std::shared_ptr<HSALaunchTemplate> kernel;
+    };
+
+    Kalmar::HSAQueue* hsaQueue;
+    std::vector<Node> nodes;
+
+    // all buffers used by the graph
+    std::vector<HSABufferUse> buffers;
+
+    // buffers used since the last marker, only tracked while capturing
+    std::vector<Kalmar::dev_info*> pendingBuffers;
+
+public:
+    HSAGraph(Kalmar::HSAQueue* _hsaQueue) : hsaQueue(_hsaQueue) {}
+
+    // record a kernel launch
+    void addKernel(const std::shared_ptr<HSALaunchTemplate>& kernel, bool inOrder);
+
+    // record a marker, which waits for all previous nodes
+    void addMarker() {
+        nodes.push_back(Node());
+        pendingBuffers.clear();
+    }
+
+    std::shared_ptr<Kalmar::KalmarAsyncOp> launch() override;
+
+    size_t getNodeCount() override { return nodes.size(); }
+}; // end of HSAGraph
+
 //-----
 //Structure used to extract information from memory pool
 struct pool_iterator
@@ -539,49 +2632,157 @@ private:
     // HSA commmand queue associated with this HSAQueue instance
     hsa_queue_t* commandQueue;
 
+    // all HSA command queues of this HSAQueue instance, commandQueue first
+    // an HSAQueue executing in any order may be backed by more than one,
+    // dispatches are distributed round-robin over them.  Batched kernel
+    // dispatches, markers and graphs always go to commandQueue.
+    std::vector<hsa_queue_t*> commandQueues;
+    std::atomic<uint32_t> nextCommandQueue;
+
+    // scheduling priority of the command queues
+    hcQueuePriority priority;
+
+    // private and group segment sizes the command queues are created for,
+    // UINT32_MAX if the runtime chooses
+    uint32_t privateSegmentSize;
+    uint32_t groupSegmentSize;
+
+    // CU mask set on the command queues, empty if all CUs are used
+    std::vector<uint32_t> cuMask;
+
+    // agent the command queues are created on
+    hsa_agent_t agent;
+
     //
     // kernel dispatches and barriers associated with this HSAQueue instance
     //
     // When a kernel k is dispatched, we'll get a KalmarAsyncOp f.
-    // This vector would hold f.  acccelerator_view::wait() would trigger
-    // HSAQueue::wait(), and all future objects in the KalmarAsyncOp objects
-    // will be waited on.
+    // This ring would hold f.  acccelerator_view::wait() would trigger
+    // HSAQueue::wait(), and all the KalmarAsyncOp objects will be waited on.
+    //
+    // The ring has a fixed capacity of ASYNCOPS_RING_SIZE.  Entries between
+    // asyncOpsHead and asyncOpsTail are in flight.  They are retired from the
+    // head as their signals complete, whenever an entry is added or the
+    // number of pending entries is queried.  If the ring is full, the host
+    // waits for the oldest entry.  Dispatches within a batch are not held in
+    // the ring, the barrier closing the batch stands for them.
     //
     std::vector< std::shared_ptr<KalmarAsyncOp> > asyncOps;
+    uint64_t asyncOpsHead;
+    uint64_t asyncOpsTail;
 
     //
-    // kernelBufferMap and bufferKernelMap forms the dependency graph of
-    // kernel / kernel dispatches / buffers
+    // dependencies between kernel dispatches are tracked in the dependency
+    // slots of the buffers they use, held inline in dev_info
+    //
+    // For a particular kernel k, the buffers used by k are registered with
+    // its HSADispatch at HSAQueue::Push(), when kernel arguments are prepared.
+    //
+    // When k is to be dispatched, it depends on the last writer of each
+    // buffer it uses, and also on the readers since then if k may modify the
+    // buffer.  Dependencies on this queue are resolved by the packet
+    // processor: every packet has the barrier bit on if the queue executes in
+    // order, otherwise the barrier bit is set on the packet of k.
+    // Dependencies on other queues, or on this queue if it has more than one
+    // HSA command queue, are resolved with barrier-AND packets written ahead
+    // of the packet of k, which carry the completion signals of the async
+    // operations k depends on.  The host never blocks on them.
     //
-    // For a particular kernel k, kernelBufferMap[k] holds a vector of 
-    // host buffers used by k. The vector is filled at HSAQueue::Push(),
-    // when kernel arguments are prepared.
+    // After k is dispatched, we'll get a KalmarAsyncOp f, which becomes the
+    // writer of the buffers k may modify, and a reader of the others.
     //
-    // When a kenrel k is to be dispatched, kernelBufferMap[k] will be traversed
-    // to figure out if there is any previous kernel dispatch associated for
-    // each buffer b used by k.  This is done by checking bufferKernelMap[b].
-    // If there are previous kernel dispatches which use b, then we wait on
-    // them before dispatch kernel k. bufferKernelMap[b] will be cleared then.
+
+    // the AQL queue itself is multi-producer, this mutex protects
+    // asyncOps and the dependency slots of buffers used on this queue
+    // when the HSAQueue is shared by multiple host threads
+    std::mutex qmutex;
+
     //
-    // After kernel k is dispatched, we'll get a KalmarAsync object f, we then
-    // walk through each buffer b used by k and mark the association as:
-    // bufferKernelMap[b] = f
+    // batched kernel dispatches
     //
-    // Finally kernelBufferMap[k] will be cleared.
+    // Between beginBatch() and endBatch(), asynchronous kernel dispatches
+    // are written into the AQL queue back to back without completion signals
+    // and without ringing the doorbell.  endBatch() closes the batch with
+    // a single barrier packet, which carries the only completion signal of
+    // the batch, and rings the doorbell once.
     //
+    // batchBarrier is non-null while a batch is open.
+    //
+    std::shared_ptr<HSABarrier> batchBarrier;
+
+    // kernel arguments of dispatches on this queue
+    HSAKernargRing kernargRing;
 
-    // association between buffers and kernel dispatches
-    // key: buffer address
-    // value: a vector of kernel dispatches
-    std::map<void*, std::vector< std::weak_ptr<KalmarAsyncOp> > > bufferKernelMap;
+    // graph being recorded, non-null between beginCapture() and endCapture()
+    // kernel launches and markers are recorded instead of being submitted
+    std::shared_ptr<HSAGraph> captureGraph;
 
-    // association between a kernel and buffers used by it
-    // key: kernel
-    // value: a vector of buffers used by the kernel
-    std::map<void*, std::vector<void*> > kernelBufferMap;
+    // last copy enqueued with EnqueueOrderedCopy(), the async operations
+    // enqueued afterwards wait for it with barrier-AND packets since the DMA
+    // engine doesn't go through the command queues
+    std::weak_ptr<KalmarAsyncOp> lastOrderedCopy;
+
+    //
+    // profiling of the packets on the command queues
+    //
+    // The packet processor only writes the timestamps of the packets if the
+    // profiler of their command queue is enabled, which costs every packet.
+    // profilingPeriod is 0 if no kernel dispatch is profiled, 1 if all of
+    // them are, N if one in N of them is.  The profiler is enabled as long
+    // as a profiled packet is in flight, and disabled on a later packet once
+    // they all completed.
+    //
+    std::mutex profilingMutex;
+    uint32_t profilingPeriod;
+    uint64_t profilingCount;
+    uint32_t profilingForced;
+    uint32_t profiledInFlight;
+    bool profilerEnabled;
+
+    // must be called with profilingMutex held
+    void setProfilerEnabled(bool enable) {
+        if (enable == profilerEnabled) {
+            return;
+        }
+        for (hsa_queue_t* queue : commandQueues) {
+            hsa_amd_profiling_set_profiler_enabled(queue, enable ? 1 : 0);
+        }
+        profilerEnabled = enable;
+    }
 
 public:
-    HSAQueue(KalmarDevice* pDev, hsa_agent_t agent, execute_order order) : KalmarQueue(pDev, queuing_mode_automatic, order), commandQueue(nullptr), asyncOps(), bufferKernelMap(), kernelBufferMap() {
+    HSAQueue(KalmarDevice* pDev, hsa_agent_t agent, execute_order order, uint32_t queueCount = 1,
+             hcQueuePriority priority = hcQueuePriorityNormal, uint32_t privateSegmentSize = UINT32_MAX,
+             uint32_t groupSegmentSize = UINT32_MAX) : KalmarQueue(pDev, queuing_mode_automatic, order), commandQueue(nullptr), commandQueues(), nextCommandQueue(0), priority(priority), privateSegmentSize(privateSegmentSize), groupSegmentSize(groupSegmentSize), agent(agent), asyncOps(ASYNCOPS_RING_SIZE), asyncOpsHead(0), asyncOpsTail(0), qmutex(), batchBarrier(nullptr), captureGraph(nullptr), profilingMutex(), profilingPeriod(0), profilingCount(0), profilingForced(0), profiledInFlight(0), profilerEnabled(false) {
+        hsa_status_t status;
+
+        // environment variable HCC_PROFILE may be used to set the profiling
+        // period of queues
+        char* profile_env = getenv("HCC_PROFILE");
+        if (profile_env != nullptr) {
+            profilingPeriod = atoi(profile_env);
+        }
+
+        /// Only a queue executing in any order is backed by more than one
+        /// HSA command queue.
+        if (order == execute_in_order || queueCount == 0) {
+            queueCount = 1;
+        }
+
+        for (uint32_t i = 0; i < queueCount; ++i) {
+            commandQueues.push_back(createCommandQueue());
+        }
+        commandQueue = commandQueues[0];
+
+        if (profilingPeriod == 1) {
+            std::lock_guard<std::mutex> lock(profilingMutex);
+            setProfilerEnabled(true);
+        }
+    }
+
+    // create an HSA command queue of the maximum size, with the segment sizes
+    // and the priority of this queue
+    hsa_queue_t* createCommandQueue() {
         hsa_status_t status;
 
         /// Query the maximum size of the queue.
@@ -589,16 +2790,68 @@ public:
         status = hsa_agent_get_info(agent, HSA_AGENT_INFO_QUEUE_MAX_SIZE, &queue_size);
         STATUS_CHECK(status, __LINE__);
 
-        /// Create a queue using the maximum size.
-        status = hsa_queue_create(agent, queue_size, HSA_QUEUE_TYPE_SINGLE, NULL, NULL, 
-                                  UINT32_MAX, UINT32_MAX, &commandQueue);
+        /// The queue is created as a multi-producer queue so it could be
+        /// safely fed from multiple host threads.  The runtime allocates the
+        /// scratch memory of the private segment size along with the queue,
+        /// and grows it on demand beyond.
+        hsa_queue_t* queue = nullptr;
+        status = hsa_queue_create(agent, queue_size, HSA_QUEUE_TYPE_MULTI, NULL, NULL,
+                                  privateSegmentSize, groupSegmentSize, &queue);
+#if KALMAR_DEBUG
+        std::cerr << "HSAQueue::HSAQueue(): created an HSA command queue: " << queue << "\n";
+#endif
+        STATUS_CHECK_Q(status, queue, __LINE__);
+
+        /// Set the scheduling priority of the queue, it's only a hint
+        /// so the queue is kept at the default priority if it fails.
+        if (priority != hcQueuePriorityNormal) {
+            status = hsa_amd_queue_set_priority(queue, static_cast<hsa_amd_queue_priority_t>(priority));
 #if KALMAR_DEBUG
-        std::cerr << "HSAQueue::HSAQueue(): created an HSA command queue: " << commandQueue << "\n";
+            if (status != HSA_STATUS_SUCCESS) {
+                std::cerr << "HSAQueue::HSAQueue(): failed to set queue priority " << priority << "\n";
+            }
 #endif
-        STATUS_CHECK_Q(status, commandQueue, __LINE__);
+        }
+        return queue;
+    }
+
+    // The runtime only frees the scratch memory of an HSA command queue along
+    // with it, so the command queues are replaced by new ones of the sizes
+    // this queue was created with.  The queue must not be used by other
+    // threads meanwhile, and the device queues of getDeviceQueue() are no
+    // longer valid.
+    bool releaseScratch() override {
+        wait();
+
+        std::lock_guard<std::mutex> lock(qmutex);
+        if (batchBarrier != nullptr || captureGraph != nullptr) {
+            return false;
+        }
+
+        std::vector<hsa_queue_t*> queues;
+        for (size_t i = 0; i < commandQueues.size(); ++i) {
+            hsa_queue_t* queue = createCommandQueue();
+            if (!cuMask.empty()) {
+                hsa_amd_queue_cu_set_mask(queue, cuMask.size(), cuMask.data());
+            }
+            queues.push_back(queue);
+        }
+        {
+            std::lock_guard<std::mutex> profilingLock(profilingMutex);
+            if (profilerEnabled) {
+                for (hsa_queue_t* queue : queues) {
+                    hsa_amd_profiling_set_profiler_enabled(queue, 1);
+                }
+            }
+        }
 
-        /// Enable profiling support for the queue.
-        status = hsa_amd_profiling_set_profiler_enabled(commandQueue, 1);
+        for (hsa_queue_t* queue : commandQueues) {
+            hsa_status_t status = hsa_queue_destroy(queue);
+            STATUS_CHECK(status, __LINE__);
+        }
+        commandQueues.swap(queues);
+        commandQueue = commandQueues[0];
+        return true;
     }
 
     void dispose() override {
@@ -611,23 +2864,14 @@ public:
         // wait on all existing kernel dispatches and barriers to complete
         wait();
 
-        // clear bufferKernelMap
-        for (auto iter = bufferKernelMap.begin(); iter != bufferKernelMap.end(); ++iter) {
-           iter->second.clear();
-        }
-        bufferKernelMap.clear();
-
-        // clear kernelBufferMap
-        for (auto iter = kernelBufferMap.begin(); iter != kernelBufferMap.end(); ++iter) {
-           iter->second.clear();
-        }
-        kernelBufferMap.clear();
-
+        for (hsa_queue_t* queue : commandQueues) {
 #if KALMAR_DEBUG
-        std::cerr << "HSAQueue::dispose(): destroy an HSA command queue: " << commandQueue << "\n";
+            std::cerr << "HSAQueue::dispose(): destroy an HSA command queue: " << queue << "\n";
 #endif
-        status = hsa_queue_destroy(commandQueue);
-        STATUS_CHECK(status, __LINE__);
+            status = hsa_queue_destroy(queue);
+            STATUS_CHECK(status, __LINE__);
+        }
+        commandQueues.clear();
         commandQueue = nullptr;
 
 #if KALMAR_DEBUG
@@ -649,32 +2893,58 @@ public:
 #endif
     }
 
-    // FIXME: implement flush
+    HSAKernargRing* getKernargRing() { return &kernargRing; }
 
-    int getPendingAsyncOps() override {
-        int count = 0;
-        for (int i = 0; i < asyncOps.size(); ++i) {
-            if (asyncOps[i] != nullptr) {
-                ++count;
+    // choose the HSA command queue of the next kernel dispatch
+    // dispatches are distributed round-robin over the command queues, but
+    // those joining an open batch have to go to the first one
+    hsa_queue_t* selectCommandQueue() {
+        if (commandQueues.size() == 1) {
+            return commandQueue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            if (batchBarrier != nullptr || captureGraph != nullptr) {
+                return commandQueue;
             }
         }
-        return count;
+        return commandQueues[nextCommandQueue.fetch_add(1, std::memory_order_relaxed) % commandQueues.size()];
+    }
+
+    // FIXME: implement flush
+
+    // async operations completed out of order are counted until the ones
+    // before them complete
+    int getPendingAsyncOps() override {
+        std::vector< std::shared_ptr<KalmarAsyncOp> > retiredAsyncOps;
+        std::lock_guard<std::mutex> lock(qmutex);
+        retireAsyncOps(retiredAsyncOps);
+        return asyncOpsTail - asyncOpsHead;
     }
 
     void wait(hcWaitMode mode = hcWaitModeBlocked) override {
+      // dispatches in an open batch would never complete without the
+      // barrier closing the batch, so submit it first
+      endBatch();
+
+      // take a snapshot of async operations and empty the ring, the lock
+      // isn't held while waiting so other threads could keep submitting
+      std::vector< std::shared_ptr<KalmarAsyncOp> > pendingOps;
+      {
+        std::lock_guard<std::mutex> lock(qmutex);
+        pendingOps.reserve(asyncOpsTail - asyncOpsHead);
+        for (; asyncOpsHead != asyncOpsTail; ++asyncOpsHead) {
+            pendingOps.push_back(std::move(asyncOps[asyncOpsHead & (ASYNCOPS_RING_SIZE - 1)]));
+        }
+      }
+
       // wait on all previous async operations to complete
-      for (int i = 0; i < asyncOps.size(); ++i) {
-        if (asyncOps[i] != nullptr) {
-            auto asyncOp = asyncOps[i];
-            // wait on valid futures only
-            std::shared_future<void>* future = asyncOp->getFuture();
-            if (future->valid()) {
-                future->wait();
-            }
+      for (int i = 0; i < pendingOps.size(); ++i) {
+        if (pendingOps[i] != nullptr) {
+            pendingOps[i]->setWaitMode(mode);
+            pendingOps[i]->blockingWait();
         }
       }
-      // clear async operations table
-      asyncOps.clear();
     }
 
     void LaunchKernel(void *ker, size_t nr_dim, size_t *global, size_t *local) override {
@@ -687,47 +2957,171 @@ public:
         size_t tmp_local[] = {0, 0, 0};
         if (!local)
             local = tmp_local;
-        dispatch->setLaunchAttributes(nr_dim, global, local);
-        dispatch->setDynamicGroupSegment(dynamic_group_size);
+        if (dispatch->setLaunchAttributes(nr_dim, global, local) != HSA_STATUS_SUCCESS) {
+            delete(dispatch);
+            throw Kalmar::invalid_compute_domain("the tile extent exceeds the hc_max_workgroup_dim of the kernel");
+        }
+        if (dispatch->setDynamicGroupSegment(dynamic_group_size, getDev()->GetMaxTileStaticSize()) != HSA_STATUS_SUCCESS) {
+            delete(dispatch);
+            throw Kalmar::runtime_exception("the group segment of the kernel exceeds the tile static memory of the accelerator", 0);
+        }
+
+        if (recordKernel(ker, nr_dim, global, local, dynamic_group_size)) {
+            return;
+        }
 
-        // wait for previous kernel dispatches be completed
-        std::for_each(std::begin(kernelBufferMap[ker]), std::end(kernelBufferMap[ker]),
-                      [&] (void* buffer) {
-                        waitForDependentAsyncOps(buffer);
-                      });
+        // order the dispatch after previous async operations on the buffers
+        std::vector<HSABufferUse> buffers = dispatch->takeBuffers();
+        dispatch->setCommandQueue(selectCommandQueue());
+        resolveDependentAsyncOps(dispatch, buffers);
 
         // dispatch the kernel
         // and wait for its completion
         dispatch->dispatchKernelWaitComplete(this);
 
-        // clear data in kernelBufferMap
-        kernelBufferMap[ker].clear();
-        kernelBufferMap.erase(ker);
-
         delete(dispatch);
     }
 
     std::shared_ptr<KalmarAsyncOp> LaunchKernelAsync(void *ker, size_t nr_dim, size_t *global, size_t *local) override {
-        return LaunchKernelWithDynamicGroupMemoryAsync(ker, nr_dim, global, local, 0);
+        return LaunchKernelWithDynamicGroupMemoryAsync(ker, nr_dim, global, local, 0, hcBarrierDefault);
     }
 
-    std::shared_ptr<KalmarAsyncOp> LaunchKernelWithDynamicGroupMemoryAsync(void *ker, size_t nr_dim, size_t *global, size_t *local, size_t dynamic_group_size) override {
-        hsa_status_t status = HSA_STATUS_SUCCESS;      
-
+    std::shared_ptr<KalmarAsyncOp> LaunchKernelWithDynamicGroupMemoryAsync(void *ker, size_t nr_dim, size_t *global, size_t *local, size_t dynamic_group_size, hcBarrierMode barrier) override {
         HSADispatch *dispatch =
             reinterpret_cast<HSADispatch*>(ker);
 
         size_t tmp_local[] = {0, 0, 0};
         if (!local)
             local = tmp_local;
-        dispatch->setLaunchAttributes(nr_dim, global, local);
-        dispatch->setDynamicGroupSegment(dynamic_group_size);
+        if (dispatch->setLaunchAttributes(nr_dim, global, local) != HSA_STATUS_SUCCESS) {
+            delete(dispatch);
+            throw Kalmar::invalid_compute_domain("the tile extent exceeds the hc_max_workgroup_dim of the kernel");
+        }
+        if (dispatch->setDynamicGroupSegment(dynamic_group_size, getDev()->GetMaxTileStaticSize()) != HSA_STATUS_SUCCESS) {
+            delete(dispatch);
+            throw Kalmar::runtime_exception("the group segment of the kernel exceeds the tile static memory of the accelerator", 0);
+        }
+
+        if (recordKernel(ker, nr_dim, global, local, dynamic_group_size)) {
+            return nullptr;
+        }
+
+        // order the dispatch after previous async operations on the buffers
+        std::vector<HSABufferUse> buffers = dispatch->takeBuffers();
+        dispatch->setCommandQueue(selectCommandQueue());
+        dispatch->setBarrierMode(barrier);
+        resolveDependentAsyncOps(dispatch, buffers);
+
+        return dispatchAsync(dispatch, buffers);
+    }
+
+    // record a kernel launch into the graph being captured, if any
+    // returns false if the queue is not capturing
+    bool recordKernel(void *ker, size_t nr_dim, size_t *global, size_t *local, size_t dynamic_group_size) {
+        std::shared_ptr<HSAGraph> graph;
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            graph = captureGraph;
+        }
+        if (graph == nullptr) {
+            return false;
+        }
+        std::shared_ptr<KalmarLaunchTemplate> launchTemplate =
+            CreateLaunchTemplate(ker, nr_dim, global, local, dynamic_group_size);
+        std::lock_guard<std::mutex> lock(qmutex);
+        graph->addKernel(std::static_pointer_cast<HSALaunchTemplate>(launchTemplate),
+                         get_execute_order() == execute_in_order);
+        return true;
+    }
+
+    // retire completed async operations from the head of the ring
+    // qmutex must be held, the retired operations are moved to
+    // retiredAsyncOps so they are destroyed after qmutex is released
+    void retireAsyncOps(std::vector< std::shared_ptr<KalmarAsyncOp> >& retiredAsyncOps) {
+        while (asyncOpsHead != asyncOpsTail) {
+            std::shared_ptr<KalmarAsyncOp>& asyncOp = asyncOps[asyncOpsHead & (ASYNCOPS_RING_SIZE - 1)];
+            if (asyncOp != nullptr && !asyncOp->isReady()) {
+                break;
+            }
+            retiredAsyncOps.push_back(std::move(asyncOp));
+            ++asyncOpsHead;
+        }
+    }
+
+    // add an async operation to the tail of the ring
+    // qmutex must be held through lock, it's released while waiting for the
+    // oldest async operation if the ring is full
+    void pushAsyncOp(std::unique_lock<std::mutex>& lock, const std::shared_ptr<KalmarAsyncOp>& asyncOp,
+                     std::vector< std::shared_ptr<KalmarAsyncOp> >& retiredAsyncOps) {
+        retireAsyncOps(retiredAsyncOps);
+        while (asyncOpsTail - asyncOpsHead == ASYNCOPS_RING_SIZE) {
+            std::shared_ptr<KalmarAsyncOp> oldest = asyncOps[asyncOpsHead & (ASYNCOPS_RING_SIZE - 1)];
+            lock.unlock();
+            oldest->blockingWait();
+            lock.lock();
+            retireAsyncOps(retiredAsyncOps);
+        }
+        asyncOps[asyncOpsTail & (ASYNCOPS_RING_SIZE - 1)] = asyncOp;
+        ++asyncOpsTail;
+    }
+
+    // associate an async operation with this queue, and record it in the
+    // dependency slots of the buffers it uses
+    // a batched dispatch is not held by this queue, but by its batch barrier
+    void associateAsyncOp(const std::shared_ptr<KalmarAsyncOp>& asyncOp, const std::vector<HSABufferUse>& buffers,
+                          bool batched = false) {
+        std::vector< std::shared_ptr<KalmarAsyncOp> > retiredAsyncOps;
+        std::unique_lock<std::mutex> lock(qmutex);
+
+        if (!batched) {
+            pushAsyncOp(lock, asyncOp, retiredAsyncOps);
+        }
+
+        for (const HSABufferUse& buffer : buffers) {
+            if (buffer.modify) {
+                buffer.dev->writer = asyncOp;
+                buffer.dev->readers.clear();
+            } else {
+                // drop readers which are gone already
+                std::vector< std::weak_ptr<KalmarAsyncOp> >& readers = buffer.dev->readers;
+                readers.erase(std::remove_if(std::begin(readers), std::end(readers),
+                                             [] (const std::weak_ptr<KalmarAsyncOp>& reader) {
+                                               return reader.expired();
+                                             }),
+                              std::end(readers));
+                readers.push_back(asyncOp);
+            }
+        }
+    }
+
+    void beginCapture() override {
+        std::lock_guard<std::mutex> lock(qmutex);
+        if (captureGraph == nullptr) {
+            captureGraph = std::make_shared<HSAGraph>(this);
+        }
+    }
+
+    std::shared_ptr<KalmarGraph> endCapture() override {
+        std::shared_ptr<HSAGraph> graph;
+        std::lock_guard<std::mutex> lock(qmutex);
+        graph.swap(captureGraph);
+        return graph;
+    }
+
+    // submit an asynchronous kernel dispatch and associate it with the
+    // buffers it uses, the caller orders it after previous async operations
+    // on the buffers beforehand
+    std::shared_ptr<KalmarAsyncOp> dispatchAsync(HSADispatch* dispatch, const std::vector<HSABufferUse>& buffers) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
 
-        // wait for previous kernel dispatches be completed
-        std::for_each(std::begin(kernelBufferMap[ker]), std::end(kernelBufferMap[ker]),
-                      [&] (void* buffer) {
-                        waitForDependentAsyncOps(buffer);
-                      });
+        // join the open batch, if any, unless the dispatch goes to another
+        // command queue than the one closed by the batch barrier
+        bool batched = false;
+        if (dispatch->getCommandQueue() == nullptr || dispatch->getCommandQueue() == commandQueue) {
+            std::lock_guard<std::mutex> lock(qmutex);
+            dispatch->setBatchBarrier(batchBarrier);
+            batched = (batchBarrier != nullptr);
+        }
 
         // dispatch the kernel
         status = dispatch->dispatchKernelAsync(this);
@@ -736,20 +3130,104 @@ public:
         // create a shared_ptr instance
         std::shared_ptr<KalmarAsyncOp> sp_dispatch(dispatch);
 
-        // associate the kernel dispatch with this queue
-        asyncOps.push_back(sp_dispatch);
+        // associate the kernel dispatch with this queue, and all buffers used
+        // by the kernel with the kernel dispatch instance
+        associateAsyncOp(sp_dispatch, buffers, batched);
 
-        // associate all buffers used by the kernel with the kernel dispatch instance
-        std::for_each(std::begin(kernelBufferMap[ker]), std::end(kernelBufferMap[ker]),
-                      [&] (void* buffer) {
-                        bufferKernelMap[buffer].push_back(sp_dispatch);
-                      });
+        return sp_dispatch;
+    }
 
-        // clear data in kernelBufferMap
-        kernelBufferMap[ker].clear();
-        kernelBufferMap.erase(ker);
+    std::shared_ptr<KalmarLaunchTemplate> CreateLaunchTemplate(void *ker, size_t nr_dim, size_t *global, size_t *local, size_t dynamic_group_size) override {
+        HSADispatch *dispatch =
+            reinterpret_cast<HSADispatch*>(ker);
 
-        return sp_dispatch;
+        size_t tmp_local[] = {0, 0, 0};
+        if (!local)
+            local = tmp_local;
+        if (dispatch->setLaunchAttributes(nr_dim, global, local) != HSA_STATUS_SUCCESS) {
+            delete(dispatch);
+            throw Kalmar::invalid_compute_domain("the tile extent exceeds the hc_max_workgroup_dim of the kernel");
+        }
+        if (dispatch->setDynamicGroupSegment(dynamic_group_size, getDev()->GetMaxTileStaticSize()) != HSA_STATUS_SUCCESS) {
+            delete(dispatch);
+            throw Kalmar::runtime_exception("the group segment of the kernel exceeds the tile static memory of the accelerator", 0);
+        }
+
+        // the AQL packet depends on the execute order of this queue
+        dispatch->setQueue(this);
+        dispatch->prepareAQLPacket();
+
+        // the template owns the dispatch and the buffers pushed to it
+        return std::make_shared<HSALaunchTemplate>(this, dispatch, dispatch->takeBuffers());
+    }
+
+    // the launcher and the kernel are written in consecutive slots, the
+    // kernel has the barrier bit so the packet processor only reads its grid
+    // size once the launcher has patched it
+    std::shared_ptr<KalmarAsyncOp> LaunchIndirect(KalmarLaunchTemplate* launcher, KalmarLaunchTemplate* kernel) override {
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            if (batchBarrier != nullptr || captureGraph != nullptr) {
+                return nullptr;
+            }
+        }
+        HSADispatch* launch = static_cast<HSALaunchTemplate*>(launcher)->getPrototype();
+        HSADispatch* dispatch = static_cast<HSALaunchTemplate*>(kernel)->getPrototype();
+        if (launch->getArgs().size() < sizeof(void*)) {
+            return nullptr;
+        }
+
+        std::vector<HSABufferUse> buffers = static_cast<HSALaunchTemplate*>(kernel)->getBuffers();
+        const std::vector<HSABufferUse>& launchBuffers = static_cast<HSALaunchTemplate*>(launcher)->getBuffers();
+        buffers.insert(buffers.end(), launchBuffers.begin(), launchBuffers.end());
+
+        // async operations of other queues are waited for by a marker before
+        // the launcher
+        std::vector< std::shared_ptr<KalmarAsyncOp> > dependentAsyncOps;
+        bool dependent = resolveDependentAsyncOps(buffers, dependentAsyncOps) &&
+                         (get_execute_order() != execute_in_order);
+        if (!dependentAsyncOps.empty()) {
+            EnqueueMarkerWithDependencies(dependentAsyncOps);
+            dependent = true;
+        }
+
+        // the barrier after the kernel carries the only completion signal,
+        // and holds the kernel arguments of both launches
+        std::shared_ptr<HSABarrier> barrier = std::make_shared<HSABarrier>();
+        barrier->getSignal();
+        void* launchKernarg = barrier->allocKernarg(this, launch->getKernargSize());
+        void* kernelKernarg = barrier->allocKernarg(this, dispatch->getKernargSize());
+        if (launchKernarg == nullptr || (kernelKernarg == nullptr && dispatch->getArgs().size() > 0)) {
+            return nullptr;
+        }
+
+        uint64_t index = reserveAQLPacketSlot(commandQueue, 2);
+        hsa_kernel_dispatch_packet_t* kernelSlot =
+            static_cast<hsa_kernel_dispatch_packet_t*>(commandQueue->base_address) + ((index + 1) & (commandQueue->size - 1));
+
+        hsa_kernel_dispatch_packet_t aql = launch->getAQLPacket();
+        aql.completion_signal.handle = 0;
+        if (dependent) {
+            aql.header |= (1 << HSA_PACKET_HEADER_BARRIER);
+        }
+        aql.kernarg_address = launchKernarg;
+        memcpy(launchKernarg, launch->getArgs().data(), launch->getArgs().size());
+        memcpy(launchKernarg, &kernelSlot, sizeof(void*));
+        writeAQLPacket(commandQueue, index, aql);
+
+        aql = dispatch->getAQLPacket();
+        aql.completion_signal.handle = 0;
+        aql.header |= (1 << HSA_PACKET_HEADER_BARRIER);
+        aql.kernarg_address = kernelKernarg;
+        if (kernelKernarg != nullptr) {
+            memcpy(kernelKernarg, dispatch->getArgs().data(), dispatch->getArgs().size());
+        }
+        writeAQLPacket(commandQueue, index + 1, aql);
+
+        hsa_status_t status = barrier->enqueueAsync(this);
+        STATUS_CHECK(status, __LINE__);
+        associateAsyncOp(barrier, buffers);
+        return barrier;
     }
 
     uint32_t GetGroupSegmentSize(void *ker) override {
@@ -757,32 +3235,108 @@ public:
         return dispatch->getGroupSegmentSize();
     }
 
-    // wait for dependent async operations to complete
-    void waitForDependentAsyncOps(void* buffer) {
-        auto&& dependentAsyncOpVector = bufferKernelMap[buffer];
-        for (int i = 0; i < dependentAsyncOpVector.size(); ++i) {
-          auto dependentAsyncOp = dependentAsyncOpVector[i];
-          if (!dependentAsyncOp.expired()) {
-            auto dependentAsyncOpPointer = dependentAsyncOp.lock();
-            // wait on valid futures only
-            std::shared_future<void>* future = dependentAsyncOpPointer->getFuture();
-            if (future->valid()) {
-              future->wait();
+    // collect the pending async operations an async operation using the
+    // buffers depends on, async operations without a completion signal are
+    // waited for by the host instead
+    void findDependentAsyncOps(const std::vector<HSABufferUse>& buffers,
+                               std::vector< std::shared_ptr<KalmarAsyncOp> >& dependentAsyncOps) {
+        std::vector< std::shared_ptr<KalmarAsyncOp> > hostAsyncOps;
+
+        auto addDependency = [&] (const std::weak_ptr<KalmarAsyncOp>& dependency) {
+            std::shared_ptr<KalmarAsyncOp> asyncOp = dependency.lock();
+            if (asyncOp == nullptr || asyncOp->isReady()) {
+                return;
             }
-          }
+            std::vector< std::shared_ptr<KalmarAsyncOp> >& asyncOps =
+                (asyncOp->getNativeHandle() != nullptr) ? dependentAsyncOps : hostAsyncOps;
+            if (std::find(std::begin(asyncOps), std::end(asyncOps), asyncOp) == std::end(asyncOps)) {
+                asyncOps.push_back(asyncOp);
+            }
+        };
+
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            // everything enqueued on this queue later than an ordered copy
+            // waits for it
+            addDependency(lastOrderedCopy);
+            for (const HSABufferUse& buffer : buffers) {
+                addDependency(buffer.dev->writer);
+                if (buffer.modify) {
+                    std::for_each(std::begin(buffer.dev->readers), std::end(buffer.dev->readers), addDependency);
+                }
+            }
+        }
+
+        if (!hostAsyncOps.empty()) {
+            auto begin = std::chrono::steady_clock::now();
+            for (auto& asyncOp : hostAsyncOps) {
+                asyncOp->blockingWait();
+            }
+            KalmarQueueCounters::add(getCounters().dependencyWaitNs,
+                std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
         }
-        dependentAsyncOpVector.clear();
     }
 
-    void read(void* device, void* dst, size_t count, size_t offset) override {
-        waitForDependentAsyncOps(device);
+    // resolve the dependencies of an async operation on the buffers it uses
+    // barrier-AND packets are written to the command queue of the async
+    // operation for pending async operations on other queues, or on any
+    // command queue of this queue if there are several, which are returned
+    // to be kept alive by the caller
+    // returns true if there are pending dependencies on this queue, which
+    // the packet of the async operation has to wait for with its barrier bit
+    bool resolveDependentAsyncOps(const std::vector<HSABufferUse>& buffers,
+                                  std::vector< std::shared_ptr<KalmarAsyncOp> >& dependentAsyncOps,
+                                  hsa_queue_t* queue = nullptr) {
+        findDependentAsyncOps(buffers, dependentAsyncOps);
+
+        bool dependsOnThisQueue = false;
+        if (commandQueues.size() == 1) {
+            auto iter = std::remove_if(std::begin(dependentAsyncOps), std::end(dependentAsyncOps),
+                                       [this] (const std::shared_ptr<KalmarAsyncOp>& asyncOp) {
+                                         return asyncOp->getQueue() == this;
+                                       });
+            dependsOnThisQueue = (iter != std::end(dependentAsyncOps));
+            dependentAsyncOps.erase(iter, std::end(dependentAsyncOps));
+        }
+
+        if (!dependentAsyncOps.empty()) {
+            std::vector<hsa_signal_t> signals;
+            for (auto& asyncOp : dependentAsyncOps) {
+                signals.push_back(*static_cast<hsa_signal_t*>(asyncOp->getNativeHandle()));
+            }
+            writeBarrierAndPackets((queue != nullptr) ? queue : commandQueue, signals);
+        }
+        return dependsOnThisQueue;
+    }
+
+    // order a kernel dispatch after previous async operations on the buffers
+    // it uses
+    void resolveDependentAsyncOps(HSADispatch* dispatch, const std::vector<HSABufferUse>& buffers) {
+        std::vector< std::shared_ptr<KalmarAsyncOp> > dependentAsyncOps;
+        if (resolveDependentAsyncOps(buffers, dependentAsyncOps, dispatch->getCommandQueue()) &&
+            !dispatch->waitsForPreviousPackets(get_execute_order())) {
+            dispatch->setQueue(this);
+            dispatch->setBarrierBit();
+        }
+        dispatch->setDependentAsyncOps(std::move(dependentAsyncOps));
+    }
 
+    void read(void* device, void* dst, size_t count, size_t offset) override {
+        HSATraceScope trace("read", "copy", count);
+        HSACopyCallbackScope callbacks(getDev()->get_ordinal(), (char*)device + offset, dst, count, hcMemcpyDeviceToHost);
         // do read
         if (dst != device) {
-            if (!getDev()->is_unified()) {
+            getCounters().addCopy(hcMemcpyDeviceToHost, count);
+            if (!getDev()->is_host_accessible(device)) {
 #if KALMAR_DEBUG
                 std::cerr << "read(" << device << "," << dst << "," << count << "," << offset << "): use HSA memory copy\n";
 #endif
+                // pageable host memory is copied through the pinned cache or
+                // the staging buffers of the device when possible
+                if (copyHostMemory(dst, (char*)device + offset, count, hcMemcpyDeviceToHost)) {
+                    return;
+                }
+
                 hsa_status_t status = HSA_STATUS_SUCCESS;
                 // Make sure host memory is accessible to gpu
                 // FIXME: host memory is allocated through OS allocator, if not, correct it.
@@ -815,14 +3369,21 @@ public:
     }
 
     void write(void* device, const void* src, size_t count, size_t offset, bool blocking) override {
-        waitForDependentAsyncOps(device);
-
+        HSATraceScope trace("write", "copy", count);
+        HSACopyCallbackScope callbacks(getDev()->get_ordinal(), src, (char*)device + offset, count, hcMemcpyHostToDevice);
         // do write
         if (src != device) {
-            if (!getDev()->is_unified()) {
+            getCounters().addCopy(hcMemcpyHostToDevice, count);
+            if (!getDev()->is_host_accessible(device)) {
 #if KALMAR_DEBUG
                 std::cerr << "write(" << device << "," << src << "," << count << "," << offset << "," << blocking << "): use HSA memory copy\n";
 #endif
+                // pageable host memory is copied through the pinned cache or
+                // the staging buffers of the device when possible
+                if (copyHostMemory((char*)device + offset, src, count, hcMemcpyHostToDevice)) {
+                    return;
+                }
+
                 hsa_status_t status = HSA_STATUS_SUCCESS;
                 // Make sure host memory is accessible to gpu
                 // FIXME: host memory is allocated through OS allocator, if not, correct it.
@@ -853,12 +3414,12 @@ public:
     }
 
     void copy(void* src, void* dst, size_t count, size_t src_offset, size_t dst_offset, bool blocking) override {
-        waitForDependentAsyncOps(dst);
-        waitForDependentAsyncOps(src);
-
+        HSATraceScope trace("copy", "copy", count);
+        HSACopyCallbackScope callbacks(getDev()->get_ordinal(), (char*)src + src_offset, (char*)dst + dst_offset, count, hcMemcpyDeviceToDevice);
         // do copy
         if (src != dst) {
-            if (!getDev()->is_unified()) {
+            getCounters().addCopy(hcMemcpyDeviceToDevice, count);
+            if (!getDev()->is_host_accessible(src) || !getDev()->is_host_accessible(dst)) {
 #if KALMAR_DEBUG
                 std::cerr << "copy(" << src << "," << dst << "," << count << "," << src_offset << "," << dst_offset << "," << blocking << "): use HSA memory copy\n";
 #endif
@@ -878,93 +3439,121 @@ public:
         }
     }
 
-    void* map(void* device, size_t count, size_t offset, bool modify) override {
-        waitForDependentAsyncOps(device);
+    std::shared_ptr<KalmarAsyncOp> EnqueueAsyncCopy(const void* src, void* dst, size_t count, hcMemcpyKind kind,
+                                                    struct dev_info* srcDev, struct dev_info* dstDev) override {
+        // the host copies faster than a DMA engine on unified memory
+        void* device = (kind == hcMemcpyDeviceToHost) ? const_cast<void*>(src) : dst;
+        if (getDev()->is_host_accessible(device)) {
+            return nullptr;
+        }
 
-        // do map
+        std::vector<HSABufferUse> buffers;
+        if (srcDev != nullptr) {
+            buffers.push_back({ srcDev, false });
+        }
+        if (dstDev != nullptr) {
+            buffers.push_back({ dstDev, true });
+        }
 
-        // as HSA runtime doesn't have map/unmap facility at this moment,
-        // we explicitly allocate a host memory buffer in this case 
-        if (!getDev()->is_unified()) {
-#if KALMAR_DEBUG
-            std::cerr << "map(" << device << "," << count << "," << offset << "," << modify << "): use HSA memory map\n";
-#endif
-            hsa_status_t status = HSA_STATUS_SUCCESS;
-            // allocate a host buffer
-            // TODO: for safety, we copy to host, but we can map device memory to host through hsa_amd_agents_allow_access
-            // withouth copying data.
-            void* data = nullptr;
-            hsa_amd_memory_pool_t* am_host_region = static_cast<hsa_amd_memory_pool_t*>(getHSAAMHostRegion());
-            status = hsa_amd_memory_pool_allocate(*am_host_region, count, 0, &data);
-            STATUS_CHECK(status, __LINE__);
-            if (data != nullptr) {
-              // copy data from device buffer to host buffer
-              hsa_agent_t* agent = static_cast<hsa_agent_t*>(getHSAAgent()); 
-              status = hsa_amd_agents_allow_access(1, agent, NULL, data);
-              STATUS_CHECK(status, __LINE__);
-              status = hsa_memory_copy(data, (char*)device + offset, count);
-              STATUS_CHECK(status, __LINE__);
-            } else {
-#if KALMAR_DEBUG
-              std::cerr << "host buffer allocation failed!\n";
-#endif
-              abort();
-            }
-#if KALMAR_DEBUG
-            std::cerr << "map(): " << data << "\n";
-#endif
+        // the DMA engine waits for every pending async operation on the
+        // buffers, including the ones on this queue
+        std::vector< std::shared_ptr<KalmarAsyncOp> > dependentAsyncOps;
+        findDependentAsyncOps(buffers, dependentAsyncOps);
 
-            return data;
-            
-        } else {
-#if KALMAR_DEBUG
-            std::cerr << "map(" << device << "," << count << "," << offset << "," << modify << "): use host memory map\n";
-#endif
-            // for host memory we simply return the pointer plus offset
+        std::shared_ptr<HSACopy> copy = std::make_shared<HSACopy>();
+        hsa_status_t status = copy->enqueueAsync(this, src, dst, count, kind, std::move(dependentAsyncOps));
+        if (status != HSA_STATUS_SUCCESS) {
 #if KALMAR_DEBUG
-            std::cerr << "map(): " << ((char*)device+offset) << "\n";
+            std::cerr << "EnqueueAsyncCopy(): fall back to synchronous copy, status: " << status << "\n";
 #endif
-            return (char*)device + offset;
+            return nullptr;
         }
+
+        // associate the copy with this queue and the buffers it uses
+        associateAsyncOp(copy, buffers);
+
+        return copy;
     }
 
-    void unmap(void* device, void* addr, size_t count, size_t offset, bool modify) override {
-        // do unmap
+    std::shared_ptr<KalmarAsyncOp> EnqueueAsyncWrite(std::shared_ptr<const void> src, void* dst, size_t count,
+                                                     struct dev_info* dstDev) override {
+        // the host copies faster than a DMA engine on unified memory
+        if (getDev()->is_host_accessible(dst)) {
+            return nullptr;
+        }
 
-        // as HSA runtime doesn't have map/unmap facility at this moment,
-        // we free the host memory buffer allocated in map()
-        if (!getDev()->is_unified()) {
-#if KALMAR_DEBUG
-            std::cerr << "unmap(" << device << "," << addr << "," << count << "," << offset << "," << modify << "): use HSA memory unmap\n";
-#endif
-            if (modify) {
+        std::vector<HSABufferUse> buffers;
+        buffers.push_back({ dstDev, true });
+
+        std::vector< std::shared_ptr<KalmarAsyncOp> > dependentAsyncOps;
+        findDependentAsyncOps(buffers, dependentAsyncOps);
+
+        std::shared_ptr<HSACopy> copy = std::make_shared<HSACopy>();
+        hsa_status_t status = copy->enqueueAsync(this, src.get(), dst, count, hcMemcpyHostToDevice,
+                                                 std::move(dependentAsyncOps));
+        if (status != HSA_STATUS_SUCCESS) {
 #if KALMAR_DEBUG
-                std::cerr << "copy host buffer to device buffer\n";
+            std::cerr << "EnqueueAsyncWrite(): fall back to synchronous copy, status: " << status << "\n";
 #endif
-                // copy data from host buffer to device buffer
-                hsa_status_t status = HSA_STATUS_SUCCESS;
-                status = hsa_memory_copy((char*)device + offset, addr, count);
-                STATUS_CHECK(status, __LINE__);
+            return nullptr;
+        }
+        copy->holdHostBuffer(std::move(src));
+
+        // the queue keeps the copy, and so the buffer, until it completes
+        associateAsyncOp(copy, buffers);
+
+        return copy;
+    }
+
+    std::shared_ptr<KalmarAsyncOp> EnqueueOrderedCopy(const void* src, void* dst, size_t count, hcMemcpyKind kind) override {
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            if (captureGraph != nullptr) {
+                return nullptr;
             }
+        }
 
-            // deallocate the host buffer
-            hsa_amd_memory_pool_free(addr);
-        } else {
+        // the DMA engine waits for the work enqueued so far through a marker,
+        // which itself waits for the previous ordered copy
+        std::vector< std::shared_ptr<KalmarAsyncOp> > dependentAsyncOps;
+        if (getPendingAsyncOps() > 0) {
+            dependentAsyncOps.push_back(EnqueueMarker());
+        }
+
+        std::shared_ptr<HSACopy> copy = std::make_shared<HSACopy>();
+        hsa_status_t status = copy->enqueueAsync(this, src, dst, count, kind, std::move(dependentAsyncOps));
+        if (status != HSA_STATUS_SUCCESS) {
 #if KALMAR_DEBUG
-            std::cerr << "unmap(" << device << "," << addr << "," << count << "," << offset << "," << modify << "): use host memory unmap\n";
+            std::cerr << "EnqueueOrderedCopy(): fall back to synchronous copy, status: " << status << "\n";
 #endif
-            // for host memory there's nothing to be done
+            return nullptr;
+        }
+
+        // later async operations on this queue wait for the copy
+        associateAsyncOp(copy, std::vector<HSABufferUse>());
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            lastOrderedCopy = copy;
         }
+
+        return copy;
     }
 
-    void Push(void *kernel, int idx, void *device, bool modify) override {
+    void* map(void* device, size_t count, size_t offset, bool modify) override;
+
+    void unmap(void* device, void* addr, size_t count, size_t offset, bool modify) override;
+
+    void* map_for_write(void* device, size_t count, size_t offset) override;
+
+    void unmap_for_write(void* device, void* addr, size_t count, size_t offset) override;
+
+    void Push(void *kernel, int idx, void *device, bool modify, struct dev_info* dev) override {
         PushArgImpl(kernel, idx, sizeof(void*), &device);
 
-        // register the buffer with the kernel
-        // when the buffer may be read/written by the kernel
-        // the buffer is not registered if it's only read by the kernel
-        if (modify) {
-          kernelBufferMap[kernel].push_back(device);
+        // register the buffer with the kernel, the dispatch is not visible to
+        // other threads yet
+        if (dev != nullptr) {
+            reinterpret_cast<HSADispatch*>(kernel)->addBuffer(dev, modify);
         }
     }
 
@@ -972,6 +3561,30 @@ public:
         return static_cast<void*>(commandQueue);
     }
 
+    // the packet processor reads the dispatch ids of the amd_queue_t and is
+    // rung through the 64-bit doorbell of its signal, so kernels enqueue
+    // packets as the host does, on queues of a single HSA queue only
+    bool getDeviceQueue(KalmarDeviceQueue& deviceQueue) override {
+#if HAS_AMD_QUEUE
+        if (commandQueues.size() != 1) {
+            return false;
+        }
+        amd_queue_t* amdQueue = reinterpret_cast<amd_queue_t*>(commandQueue);
+        amd_signal_t* doorbell = reinterpret_cast<amd_signal_t*>(commandQueue->doorbell_signal.handle);
+        if (doorbell->kind != AMD_SIGNAL_KIND_DOORBELL) {
+            return false;
+        }
+        deviceQueue.base = commandQueue->base_address;
+        deviceQueue.size = commandQueue->size;
+        deviceQueue.writeIndex = const_cast<uint64_t*>(&amdQueue->write_dispatch_id);
+        deviceQueue.readIndex = const_cast<const uint64_t*>(&amdQueue->read_dispatch_id);
+        deviceQueue.doorbell = const_cast<uint64_t*>(doorbell->hardware_doorbell_ptr);
+        return true;
+#else
+        return false;
+#endif
+    }
+
     void* getHSAAgent() override;
 
     void* getHSAAMRegion() override;
@@ -980,10 +3593,70 @@ public:
 
     void* getHSAKernargRegion() override;
 
+    // copy between host and device memory through the pinned cache or the
+    // staging buffers of the device, returns false if neither could be used
+    bool copyHostMemory(void* dst, const void* src, size_t count, hcMemcpyKind kind);
+
+    void copy_peer(void* src, KalmarDevice* srcDev, void* dst, size_t count,
+                   size_t src_offset, size_t dst_offset, bool blocking) override;
+
     bool hasHSAInterOp() override {
         return true;
     }
 
+    hcQueuePriority get_priority() override {
+        return priority;
+    }
+
+    void setProfilingPeriod(uint32_t period) override {
+        std::lock_guard<std::mutex> lock(profilingMutex);
+        profilingPeriod = period;
+        profilingCount = 0;
+        if (period == 1) {
+            setProfilerEnabled(true);
+        }
+    }
+
+    uint32_t getProfilingPeriod() override {
+        std::lock_guard<std::mutex> lock(profilingMutex);
+        return profilingPeriod;
+    }
+
+    void profileNextDispatch() override {
+        std::lock_guard<std::mutex> lock(profilingMutex);
+        ++profilingForced;
+    }
+
+    // choose whether the next packet written to the command queues is
+    // profiled, it is if required by the runtime; kernel dispatches are
+    // sampled by the profiling period, barriers are profiled only if all the
+    // dispatches are
+    // a profiled packet is released with releaseProfiling() once it completes
+    bool acquireProfiling(bool required, bool dispatch) {
+        std::lock_guard<std::mutex> lock(profilingMutex);
+        bool profiled = required || tracer.enabled() || kernelProfile.enabled() || profilingPeriod == 1;
+        if (dispatch && !profiled) {
+            if (profilingForced > 0) {
+                --profilingForced;
+                profiled = true;
+            } else if (profilingPeriod > 1) {
+                profiled = (++profilingCount % profilingPeriod == 0);
+            }
+        }
+        if (profiled) {
+            ++profiledInFlight;
+            setProfilerEnabled(true);
+        } else if (profiledInFlight == 0) {
+            setProfilerEnabled(false);
+        }
+        return profiled;
+    }
+
+    void releaseProfiling() {
+        std::lock_guard<std::mutex> lock(profilingMutex);
+        --profiledInFlight;
+    }
+
     bool set_cu_mask(const std::vector<bool>& cu_mask) override {
         // get device's total compute unit count
         auto device = getDev();
@@ -1011,44 +3684,124 @@ public:
             cu_arrays.push_back(temp);
         }
 
-        // call hsa ext api to set cu mask
-        hsa_status_t status = hsa_amd_queue_cu_set_mask(commandQueue, cu_arrays.size(), cu_arrays.data());
-        if(HSA_STATUS_SUCCESS == status)
-            return true;
-        else
-            return false;
+        // call hsa ext api to set cu mask on every command queue
+        for (hsa_queue_t* queue : commandQueues) {
+            hsa_status_t status = hsa_amd_queue_cu_set_mask(queue, cu_arrays.size(), cu_arrays.data());
+            if (HSA_STATUS_SUCCESS != status) {
+                return false;
+            }
+        }
+        cuMask.swap(cu_arrays);
+        return true;
     }
 
     // enqueue a barrier packet
     std::shared_ptr<KalmarAsyncOp> EnqueueMarker() {
+        return EnqueueMarkerWithDependencies(std::vector< std::shared_ptr<KalmarAsyncOp> >());
+    }
+
+    // enqueue a barrier packet, after barrier-AND packets waiting for the
+    // completion signals of the dependencies, on any queue and any device
+    std::shared_ptr<KalmarAsyncOp> EnqueueMarkerWithDependencies(const std::vector< std::shared_ptr<KalmarAsyncOp> >& dependencies) override {
         hsa_status_t status = HSA_STATUS_SUCCESS;
 
+        // async operations without a signal, such as the ones of the CPU
+        // path, are waited for on the host
+        std::vector< std::shared_ptr<KalmarAsyncOp> > dependentAsyncOps;
+        std::vector<hsa_signal_t> signals;
+        for (auto& dependency : dependencies) {
+            if (dependency == nullptr || dependency->isReady()) {
+                continue;
+            }
+            if (dependency->getNativeHandle() == nullptr) {
+                dependency->blockingWait();
+                continue;
+            }
+            signals.push_back(*static_cast<hsa_signal_t*>(dependency->getNativeHandle()));
+            dependentAsyncOps.push_back(dependency);
+        }
+
+        // record the marker into the graph being captured, if any
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            if (captureGraph != nullptr) {
+                for (auto& dependency : dependentAsyncOps) {
+                    dependency->blockingWait();
+                }
+                captureGraph->addMarker();
+                return nullptr;
+            }
+        }
+
         // create shared_ptr instance
         std::shared_ptr<HSABarrier> barrier = std::make_shared<HSABarrier>();
 
+        // the marker waits for the other command queues of this queue with
+        // a barrier on each of them, carried by barrier-AND packets
+        if (commandQueues.size() > 1) {
+            for (size_t i = 1; i < commandQueues.size(); ++i) {
+                std::shared_ptr<HSABarrier> queueBarrier = std::make_shared<HSABarrier>();
+                status = queueBarrier->enqueueAsync(this, commandQueues[i]);
+                STATUS_CHECK(status, __LINE__);
+                signals.push_back(*static_cast<hsa_signal_t*>(queueBarrier->getNativeHandle()));
+                dependentAsyncOps.push_back(queueBarrier);
+            }
+        }
+
+        // and for the last ordered copy, which is not in any command queue
+        std::shared_ptr<KalmarAsyncOp> copy;
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            copy = lastOrderedCopy.lock();
+        }
+        if (copy != nullptr && !copy->isReady()) {
+            signals.push_back(*static_cast<hsa_signal_t*>(copy->getNativeHandle()));
+            dependentAsyncOps.push_back(copy);
+        }
+
+        if (!signals.empty()) {
+            writeBarrierAndPackets(commandQueue, signals);
+            barrier->setDependentAsyncOps(std::move(dependentAsyncOps));
+        }
+
         // enqueue the barrier
         status = barrier.get()->enqueueAsync(this);
         STATUS_CHECK(status, __LINE__);
 
         // associate the barrier with this queue
-        asyncOps.push_back(barrier);
+        associateAsyncOp(barrier, std::vector<HSABufferUse>());
 
         return barrier;
     }
 
-    // remove finished async operation from waiting list
-    void removeAsyncOp(KalmarAsyncOp* asyncOp) {
-        for (int i = 0; i < asyncOps.size(); ++i) {
-            if (asyncOps[i].get() == asyncOp) {
-                asyncOps[i] = nullptr;
-            }
+    void beginBatch() override {
+        std::lock_guard<std::mutex> lock(qmutex);
+        if (batchBarrier == nullptr) {
+            batchBarrier = std::make_shared<HSABarrier>();
         }
+    }
 
-        // GC for finished kernels
-        if (asyncOps.size() > ASYNCOPS_VECTOR_GC_SIZE) {
-          asyncOps.erase(std::remove(asyncOps.begin(), asyncOps.end(), nullptr),
-                         asyncOps.end());
+    std::shared_ptr<KalmarAsyncOp> endBatch() override {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+
+        std::shared_ptr<HSABarrier> barrier;
+        {
+            std::lock_guard<std::mutex> lock(qmutex);
+            barrier.swap(batchBarrier);
+        }
+        if (barrier == nullptr) {
+            return nullptr;
         }
+
+        // the barrier bit in the closing barrier packet makes it wait for
+        // all dispatches in the batch regardless of execute order
+        status = barrier->enqueueAsync(this);
+        STATUS_CHECK(status, __LINE__);
+
+        // associate the barrier with this queue
+        associateAsyncOp(barrier, std::vector<HSABufferUse>());
+
+        return barrier;
     }
 };
 
@@ -1062,10 +3815,18 @@ private:
     std::mutex kernargPoolMutex;
 
 
+    // kernels by name and executables by checksum, created under programsMutex
+    // as kernels may be launched for the first time concurrently
     std::map<std::string, HSAKernel *> programs;
+    std::mutex programsMutex;
     hsa_agent_t agent;
     size_t max_tile_static_size;
 
+    // largest segment sizes of the kernels created so far, to size the
+    // command queues of the views running them
+    std::atomic<uint32_t> maxPrivateSegmentSize;
+    std::atomic<uint32_t> maxGroupSegmentSize;
+
     std::mutex queues_mutex;
     std::vector< std::weak_ptr<KalmarQueue> > queues;
 
@@ -1075,23 +3836,74 @@ private:
 
     uint32_t workgroup_max_size;
     uint16_t workgroup_max_dim[3];
+    uint32_t wavefront_size;
 
     std::map<std::string, HSAExecutable*> executables;
 
+    // executables being finalized, or to be finalized when first needed,
+    // by checksum, moved to executables once finished
+    std::map<std::string, std::future<HSAExecutable*> > pendingExecutables;
+
+    // addresses of the global variables of the executables found so far, by
+    // name, so memcpySymbol doesn't look them up again
+    std::map<std::string, void*> symbolAddresses;
+
+    // when kernels in HSAIL/BRIG are finalized, one of the FINALIZE_* modes
+    int finalizeMode;
+
+    // checksums of the kernel blobs, with their size, by address
+    std::map<const void*, std::pair<size_t, std::string> > checksums;
+    std::mutex checksumMutex;
+
     hsa_isa_t agentISA;
 
+    // name of agentISA, part of the key of code objects cached on disk,
+    // empty if the cache is disabled
+    std::string agentISAName;
+
     hcAgentProfile profile;
 
-    /*TODO: This is the first CPU which will provide system memory pool
-    We might need to modify again in multiple CPU socket scenario. Because
-    we must make sure there is pyshycial link between device and host. Currently,
-    agent iterate function will push back all of the dGPU on the system, which might
-    not be linked directly to the first cpu node, host */
+    /* This is the CPU which provides the system memory pools of the
+    device: the one whose memory is closest to the device, so pinned,
+    staging and mapped host memory live on the NUMA node the device is
+    attached to. */
     hsa_agent_t host_;
 
     uint16_t versionMajor;
     uint16_t versionMinor;
 
+    // number of HSA command queues backing a queue executing in any order
+    uint32_t queuesPerView;
+
+    // locked host memory ranges and staging buffers for transfers of
+    // pageable host memory, the staging buffers are allocated on first use
+    HSAPinnedCache pinnedCache;
+    HSAStagingBuffers stagingBuffers;
+    std::once_flag stagingFlag;
+
+    // whether map() returns direct pointers to device memory, otherwise
+    // host buffers of map() are used
+    bool mapZeroCopy;
+    HSAMapBuffers mapBuffers;
+
+    // host buffers of map() of device memory to be overwritten by the host
+    HSAMapBuffers writeMapBuffers;
+
+    // free device memory kept for later allocations
+    HSAMemoryCache memoryCache;
+
+    // workgroup shapes of kernels launched without one, if autotuned
+    HSAWorkgroupTuner workgroupTuner;
+
+    // buffers of arrays placed in the memory the device doesn't use by
+    // default, whether they are in host memory
+    std::map<void*, bool> placedBuffers;
+    std::atomic<size_t> placedCount;
+    mutable std::mutex placedMutex;
+
+    // number of code objects loaded into executables for the device
+    std::atomic<uint64_t> codeObjectBuilds;
+
 public:
  
     uint32_t getWorkgroupMaxSize() {
@@ -1102,6 +3914,10 @@ public:
         return &workgroup_max_dim[0];
     }
 
+    HSAWorkgroupTuner& getWorkgroupTuner() {
+        return workgroupTuner;
+    }
+
     // Callback for hsa_amd_agent_iterate_memory_pools.
     // data is of type pool_iterator,
     // we save the pools we care about into this structure.
@@ -1204,8 +4020,81 @@ public:
         return agent;
     }
 
+    hsa_agent_t& getHostAgent() {
+        return host_;
+    }
+
+    HSAPinnedCache& getPinnedCache() {
+        return pinnedCache;
+    }
+
+    bool isMapZeroCopy() const {
+        return mapZeroCopy;
+    }
+
+    HSAMapBuffers& getMapBuffers() {
+        return mapBuffers;
+    }
+
+    HSAMapBuffers& getWriteMapBuffers() {
+        return writeMapBuffers;
+    }
+
+    // returns nullptr if the staging buffers can't be allocated
+    HSAStagingBuffers* getStagingBuffers() {
+        std::call_once(stagingFlag, [this] {
+            // environment variables HCC_STAGING_BUFFER_SIZE (in KB) and
+            // HCC_STAGING_BUFFER_COUNT may be used to tune the chunks
+            size_t size = STAGING_BUFFER_SIZE;
+            size_t count = STAGING_BUFFER_COUNT;
+            char* size_env = getenv("HCC_STAGING_BUFFER_SIZE");
+            if (size_env != nullptr && atoi(size_env) > 0) {
+                size = (size_t)atoi(size_env) * 1024;
+            }
+            char* count_env = getenv("HCC_STAGING_BUFFER_COUNT");
+            if (count_env != nullptr && atoi(count_env) >= 2) {
+                count = atoi(count_env);
+            }
+            hsa_status_t status = stagingBuffers.init(getHSAAMHostRegion(), agent, host_, size, count);
+#if KALMAR_DEBUG
+            if (status != HSA_STATUS_SUCCESS) {
+                std::cerr << "HSADevice: staging buffers not available, status: " << status << "\n";
+            }
+#endif
+        });
+        return stagingBuffers.isReady() ? &stagingBuffers : nullptr;
+    }
+
+    size_t trimMemoryCache() override {
+        return memoryCache.trim();
+    }
+
+    uint64_t getMemoryCacheHits() override {
+        return memoryCache.getHits();
+    }
+
+    uint64_t getMemoryCacheMisses() override {
+        return memoryCache.getMisses();
+    }
+
+    size_t getMemoryCacheSize() override {
+        return memoryCache.getCachedBytes();
+    }
+
+    uint64_t getCodeObjectBuilds() override {
+        return codeObjectBuilds.load(std::memory_order_relaxed);
+    }
+
+    double getTransferBandwidth(hcMemcpyKind kind) override {
+        if (!stagingBuffers.isReady()) {
+            return 0.0;
+        }
+        return stagingBuffers.getBandwidth(kind == hcMemcpyHostToDevice);
+    }
+
     HSADevice(hsa_agent_t a, hsa_agent_t host) : KalmarDevice(access_type_read_write),
                                agent(a), programs(), max_tile_static_size(0),
+                               maxPrivateSegmentSize(0), maxGroupSegmentSize(0),
                                queues(), queues_mutex(),
                                ri(),
                                useCoarseGrainedRegion(false),
@@ -1213,7 +4102,8 @@ public:
                                executables(),
                                profile(hcAgentProfileNone),
                                path(), description(), host_(host),
-                               versionMajor(0), versionMinor(0) {
+                               versionMajor(0), versionMinor(0),
+                               queuesPerView(QUEUES_PER_VIEW), placedCount(0), codeObjectBuilds(0) {
 #if KALMAR_DEBUG
         std::cerr << "HSADevice::HSADevice()\n";
 #endif
@@ -1263,6 +4153,15 @@ public:
         status = hsa_amd_agent_iterate_memory_pools(host_, HSADevice::get_host_pools, &ri);
         STATUS_CHECK(status, __LINE__);
 
+        // Setup AM pool.
+        ri._am_memory_pool = (ri._found_local_memory_pool)
+                                 ? ri._local_memory_pool
+                                 : ri._finegrained_system_memory_pool;
+
+        ri._am_host_memory_pool = (ri._found_coarsegrained_system_memory_pool)
+                                      ? ri._coarsegrained_system_memory_pool
+                                      : ri._finegrained_system_memory_pool;
+
         /// after iterating memory regions, set if we can use coarse grained regions
         bool result = false;
         if (hasHSACoarsegrainedRegion()) {
@@ -1278,6 +4177,92 @@ public:
         }
         useCoarseGrainedRegion = result; 
 
+        /// environment variable HCC_QUEUES_PER_VIEW may be used to back
+        /// queues executing in any order by more HSA command queues, up to
+        /// the number of queues the agent supports
+        char* queues_env = getenv("HCC_QUEUES_PER_VIEW");
+        if (queues_env != nullptr && atoi(queues_env) > 0) {
+            queuesPerView = atoi(queues_env);
+        }
+        /// environment variable HCC_FINALIZE_MODE may be used to finalize
+        /// kernels eagerly (0), lazily (1) or in the background (2)
+        finalizeMode = FINALIZE_MODE;
+        char* finalize_mode_env = getenv("HCC_FINALIZE_MODE");
+        if (finalize_mode_env != nullptr && atoi(finalize_mode_env) >= FINALIZE_EAGER &&
+            atoi(finalize_mode_env) <= FINALIZE_PARALLEL) {
+            finalizeMode = atoi(finalize_mode_env);
+        }
+        /// environment variable HCC_PINNED_CACHE_SIZE may be used to keep
+        /// pageable host memory ranges locked across transfers
+        size_t pinned_cache_size = PINNED_CACHE_SIZE;
+        char* pinned_cache_env = getenv("HCC_PINNED_CACHE_SIZE");
+        if (pinned_cache_env != nullptr && atoi(pinned_cache_env) >= 0) {
+            pinned_cache_size = atoi(pinned_cache_env);
+        }
+        pinnedCache.init(pinned_cache_size, agent);
+
+        /// environment variable HCC_AUTOTUNE may be used to autotune the
+        /// workgroup shape of kernels launched without one, and
+        /// HCC_AUTOTUNE_FILE to keep the chosen shapes across runs
+        bool autotune = AUTOTUNE;
+        char* autotune_env = getenv("HCC_AUTOTUNE");
+        if (autotune_env != nullptr) {
+            autotune = (atoi(autotune_env) != 0);
+        }
+        char* autotune_file_env = getenv("HCC_AUTOTUNE_FILE");
+        workgroupTuner.init(autotune, (autotune_file_env != nullptr) ? autotune_file_env : "");
+
+        /// map() of device memory returns direct pointers if the host can
+        /// access the device memory pool, environment variable
+        /// HCC_MAP_ZERO_COPY=0 may be used to disable it
+        mapZeroCopy = false;
+        char* map_zero_copy_env = getenv("HCC_MAP_ZERO_COPY");
+        bool map_zero_copy = (map_zero_copy_env != nullptr) ? (atoi(map_zero_copy_env) != 0) : MAP_ZERO_COPY;
+        if (map_zero_copy && hasHSACoarsegrainedRegion()) {
+            hsa_amd_memory_pool_access_t access = HSA_AMD_MEMORY_POOL_ACCESS_NEVER_ALLOWED;
+            status = hsa_amd_agent_memory_pool_get_info(host_, getHSAAMRegion(), HSA_AMD_AGENT_MEMORY_POOL_INFO_ACCESS, &access);
+            mapZeroCopy = (status == HSA_STATUS_SUCCESS && access != HSA_AMD_MEMORY_POOL_ACCESS_NEVER_ALLOWED);
+        }
+        mapBuffers.init(getHSAAMHostRegion(), agent);
+
+        /// host buffers of map() to overwrite device memory are write-combined
+        /// if the host has a kernarg pool, environment variable
+        /// HCC_MAP_WRITE_COMBINED=0 may be used to disable it
+        char* map_write_combined_env = getenv("HCC_MAP_WRITE_COMBINED");
+        bool map_write_combined = (map_write_combined_env != nullptr) ? (atoi(map_write_combined_env) != 0) : MAP_WRITE_COMBINED;
+        if (map_write_combined && hasHSAKernargRegion()) {
+            writeMapBuffers.init(getHSAKernargRegion(), agent);
+        } else {
+            writeMapBuffers.init(getHSAAMHostRegion(), agent);
+        }
+
+        /// environment variable HCC_HSA_MEMORY_CACHE may be used to keep
+        /// freed device memory for later allocations, and
+        /// HCC_HSA_MEMORY_CACHE_LIMIT (in MB) to bound the memory kept
+        bool memory_cache = false;
+        char* memory_cache_env = getenv("HCC_HSA_MEMORY_CACHE");
+        if (memory_cache_env != nullptr) {
+            if (std::string("ON") == memory_cache_env) {
+                memory_cache = true;
+            }
+        }
+        size_t memory_cache_limit = MEMORY_CACHE_LIMIT;
+        char* memory_cache_limit_env = getenv("HCC_HSA_MEMORY_CACHE_LIMIT");
+        if (memory_cache_limit_env != nullptr && atoi(memory_cache_limit_env) >= 0) {
+            memory_cache_limit = (size_t)atoi(memory_cache_limit_env) * 1024 * 1024;
+        }
+        std::vector<hsa_agent_t> memory_cache_agents(1, agent);
+        if (mapZeroCopy) {
+            memory_cache_agents.push_back(host_);
+        }
+        memoryCache.init(memory_cache, memory_cache_limit, getHSAAMRegion(), memory_cache_agents);
+
+        uint32_t queues_max = 0;
+        status = hsa_agent_get_info(agent, HSA_AGENT_INFO_QUEUES_MAX, &queues_max);
+        if (status == HSA_STATUS_SUCCESS && queues_max > 0) {
+            queuesPerView = std::min(queuesPerView, queues_max);
+        }
+
         /// pre-allocate a pool of kernarg buffers in case:
         /// - kernarg region is available
         /// - compile-time macro USE_KERNARG_REGION is set
@@ -1302,14 +4287,6 @@ public:
 #endif
         }
 
-        // Setup AM pool.
-        ri._am_memory_pool = (ri._found_local_memory_pool)
-                                 ? ri._local_memory_pool
-                                 : ri._finegrained_system_memory_pool;
-
-        ri._am_host_memory_pool = (ri._found_coarsegrained_system_memory_pool)
-                                      ? ri._coarsegrained_system_memory_pool
-                                      : ri._finegrained_system_memory_pool;
         
         /// Query the maximum number of work-items in a workgroup
         status = hsa_agent_get_info(agent, HSA_AGENT_INFO_WORKGROUP_MAX_SIZE, &workgroup_max_size);
@@ -1320,10 +4297,18 @@ public:
 
         STATUS_CHECK(status, __LINE__);
 
+        /// Query the number of work-items in a wavefront
+        status = hsa_agent_get_info(agent, HSA_AGENT_INFO_WAVEFRONT_SIZE, &wavefront_size);
+        STATUS_CHECK(status, __LINE__);
+
         /// Get ISA associated with the agent
         status = hsa_agent_get_info(agent, HSA_AGENT_INFO_ISA, &agentISA);
         STATUS_CHECK(status, __LINE__);
 
+        /// the finalized code objects cached on disk are only valid for the
+        /// ISA they were finalized for
+        initKernelCache();
+
         /// Get the profile of the agent
         hsa_profile_t agentProfile;
         status = hsa_agent_get_info(agent, HSA_AGENT_INFO_PROFILE, &agentProfile);
@@ -1371,6 +4356,15 @@ public:
 #endif
         }
 
+        // wait for executables still being finalized in the background, the
+        // ones deferred until first needed are never finalized
+        for (auto& pending : pendingExecutables) {
+            if (pending.second.wait_for(std::chrono::seconds(0)) != std::future_status::deferred) {
+                delete pending.second.get();
+            }
+        }
+        pendingExecutables.clear();
+
         // release all data in programs
         for (auto kernel_iterator : programs) {
             delete kernel_iterator.second;
@@ -1388,6 +4382,17 @@ public:
 #endif
     }
 
+    // wait for executables still being finalized in the background, so
+    // nothing uses the HSA runtime at exit if the device isn't destroyed
+    void drainFinalization() {
+        std::lock_guard<std::mutex> lock(programsMutex);
+        for (auto& pending : pendingExecutables) {
+            if (pending.second.wait_for(std::chrono::seconds(0)) != std::future_status::deferred) {
+                pending.second.wait();
+            }
+        }
+    }
+
     std::wstring path;
     std::wstring description;
 
@@ -1402,27 +4407,113 @@ public:
     bool is_emulated() const override { return false; }
     uint32_t get_version() const { return ((static_cast<unsigned int>(versionMajor) << 16) | versionMinor); }
 
+    bool is_host_accessible(void* ptr) const override {
+        if (placedCount.load(std::memory_order_acquire) == 0)
+            return is_unified();
+        std::lock_guard<std::mutex> l(placedMutex);
+        auto it = placedBuffers.find(ptr);
+        if (it == placedBuffers.end())
+            return is_unified();
+        // device memory is accessed directly by the host where map() is
+        return it->second || mapZeroCopy;
+    }
+
+    // both memories are accessible to the host, as on APUs
+    bool supports_migration() const override {
+        return mapZeroCopy && hasHSAFinegrainedRegion();
+    }
+
+    // allocate a buffer of an array placed in fine-grained host memory, or
+    // coarse-grained device memory, where the device doesn't by default
+    void* createPlaced(size_t count, bool host) {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        void* data = nullptr;
+        if (host) {
+            status = hsa_amd_memory_pool_allocate(ri._finegrained_system_memory_pool, count, 0, &data);
+            STATUS_CHECK(status, __LINE__);
+            status = hsa_amd_agents_allow_access(1, &agent, NULL, data);
+            STATUS_CHECK(status, __LINE__);
+        } else {
+            status = hsa_amd_memory_pool_allocate(getHSAAMRegion(), count, 0, &data);
+            STATUS_CHECK(status, __LINE__);
+            hsa_agent_t agents[2] = { agent, host_ };
+            status = hsa_amd_agents_allow_access(mapZeroCopy ? 2 : 1, agents, NULL, data);
+            STATUS_CHECK(status, __LINE__);
+        }
+#if KALMAR_DEBUG
+        std::cerr << "createPlaced(" << count << "," << host << "): " << data << "\n";
+#endif
+        std::lock_guard<std::mutex> l(placedMutex);
+        placedBuffers[data] = host;
+        placedCount.store(placedBuffers.size(), std::memory_order_release);
+        return data;
+    }
+
+    // whether the host may access the memory of a buffer while kernels use
+    // it: fine-grained host memory of createPlaced(), or any memory of an APU
+    // kernels using it have to make their accesses visible at system scope
+    bool isHostVisible(void* ptr) const {
+        if (is_unified())
+            return true;
+        if (placedCount.load(std::memory_order_acquire) == 0)
+            return false;
+        std::lock_guard<std::mutex> l(placedMutex);
+        auto it = placedBuffers.find(ptr);
+        return it != placedBuffers.end() && it->second;
+    }
+
+    // release a buffer from createPlaced(), false if ptr isn't one
+    bool releasePlaced(void* ptr) {
+        if (placedCount.load(std::memory_order_acquire) == 0)
+            return false;
+        {
+            std::lock_guard<std::mutex> l(placedMutex);
+            if (placedBuffers.erase(ptr) == 0)
+                return false;
+            placedCount.store(placedBuffers.size(), std::memory_order_release);
+        }
+        hsa_status_t status = hsa_amd_memory_pool_free(ptr);
+        STATUS_CHECK(status, __LINE__);
+        return true;
+    }
+
     void* create(size_t count, struct rw_info* key) override {
         void *data = nullptr;
 
+        // arrays placed in the memory the device doesn't use by default
+        hcMemoryPlacement placement = key ? key->resident : hcMemoryPlacementDefault;
+        if (placement == hcMemoryPlacementHost && !is_unified() && hasHSAFinegrainedRegion())
+            return createPlaced(count, true);
+        if (placement == hcMemoryPlacementDevice && is_unified() && hasHSACoarsegrainedRegion())
+            return createPlaced(count, false);
+
         if (!is_unified()) {
 #if KALMAR_DEBUG
             std::cerr << "create(" << count << "," << key << "): use HSA memory allocator\n";
 #endif
+            if (memoryCache.isEnabled()) {
+                data = memoryCache.allocate(count);
+#if KALMAR_DEBUG
+                std::cerr << "create(): " << data << " from memory cache\n";
+#endif
+                return data;
+            }
+
             hsa_status_t status = HSA_STATUS_SUCCESS;
             auto am_region = getHSAAMRegion();
     
             status = hsa_amd_memory_pool_allocate(am_region, count, 0, &data);
             STATUS_CHECK(status, __LINE__);
 
-            hsa_agent_t* agent = static_cast<hsa_agent_t*>(getHSAAgent());
-            status = hsa_amd_agents_allow_access(1, agent, NULL, data);
+            // the host accesses device memory directly in map()
+            hsa_agent_t agents[2] = { agent, host_ };
+            status = hsa_amd_agents_allow_access(mapZeroCopy ? 2 : 1, agents, NULL, data);
             STATUS_CHECK(status, __LINE__); 
         } else {
 #if KALMAR_DEBUG
             std::cerr << "create(" << count << "," << key << "): use host memory allocator\n";
 #endif
-            data = kalmar_aligned_alloc(0x1000, count);
+            data = kalmar_host_alloc(count);
         }
 
 #if KALMAR_DEBUG
@@ -1434,22 +4525,57 @@ public:
     
     void release(void *ptr, struct rw_info* key ) override {
         hsa_status_t status = HSA_STATUS_SUCCESS;
+        if (releasePlaced(ptr)) {
+            return;
+        }
         if (!is_unified()) {
 #if KALMAR_DEBUG
             std::cerr << "release(" << ptr << "," << key << "): use HSA memory deallocator\n";
 #endif
+            if (memoryCache.isEnabled() && memoryCache.release(ptr)) {
+                return;
+            }
             status = hsa_amd_memory_pool_free(ptr);
             STATUS_CHECK(status, __LINE__);
         } else {
 #if KALMAR_DEBUG
             std::cerr << "release(" << ptr << "," << key << "): use host memory deallocator\n";
 #endif
-            kalmar_aligned_free(ptr);
+            kalmar_host_free(ptr, key->count);
         }
     }
 
-    // calculate MD5 checksum
+    // pin the host memory for the agent, which then accesses it in place
+    // over the bus
+    void* map_host(void* ptr, size_t count) override {
+        void* va = nullptr;
+        hsa_status_t status = hsa_amd_memory_lock(ptr, count, &agent, 1, &va);
+        if (va == nullptr || status != HSA_STATUS_SUCCESS) {
+            return nullptr;
+        }
+        return va;
+    }
+
+    void unmap_host(void* ptr) override {
+        hsa_status_t status = hsa_amd_memory_unlock(ptr);
+        STATUS_CHECK(status, __LINE__);
+    }
+
+    // calculate the checksum of a kernel blob, which indexes executables
+    // the blobs are sections embedded in the process, so the checksum of
+    // each is memoized by address
     std::string kernel_checksum(size_t size, void* source) {
+        std::lock_guard<std::mutex> lock(checksumMutex);
+        auto iter = checksums.find(source);
+        if (iter != checksums.end() && iter->second.first == size) {
+            return iter->second.second;
+        }
+        std::string checksum = kernel_checksum_impl(size, source);
+        checksums[source] = std::make_pair(size, checksum);
+        return checksum;
+    }
+
+    std::string kernel_checksum_impl(size_t size, void* source) {
 #if USE_MD5_HASH
         unsigned char md5_hash[16];
         memset(md5_hash, 0, sizeof(unsigned char) * 16);
@@ -1466,54 +4592,52 @@ public:
 
         return checksum.str();
 #else
-        // FNV-1a hashing, 64-bit version
-        const uint64_t FNV_prime = 0x100000001b3;
-        const uint64_t FNV_basis = 0xcbf29ce484222325;
-        uint64_t hash = FNV_basis;
-
-        const char *str = static_cast<const char *>(source);
+        uint64_t hash[2];
+        kernelHash128(source, size, hash);
 
-        size = size > FNV1A_CUTOFF_SIZE ? FNV1A_CUTOFF_SIZE : size;
-        for (auto i = 0; i < size; ++i) {
-            hash ^= *str++;
-            hash *= FNV_prime;
-        }
-        return std::to_string(hash);
+        std::stringstream checksum;
+        checksum << std::setbase(16) << std::setfill('0') << std::setw(16) << hash[1] << std::setw(16) << hash[0];
+        return checksum.str();
 #endif
     }
 
     void BuildProgram(void* size, void* source, bool needsCompilation = true) override {
-        if (executables.find(kernel_checksum((size_t)size, source)) == executables.end()) {
+        std::string index = kernel_checksum((size_t)size, source);
+        std::lock_guard<std::mutex> lock(programsMutex);
+        if (executables.find(index) == executables.end()) {
             bool use_amdgpu = false;
 #ifdef HSA_USE_AMDGPU_BACKEND
             const char *km_use_amdgpu = getenv("KM_USE_AMDGPU");
             use_amdgpu = !km_use_amdgpu || km_use_amdgpu[0] != '0';
 #endif
-            size_t kernel_size = (size_t)((void *)size);
-            char *kernel_source = (char*)malloc(kernel_size+1);
-            memcpy(kernel_source, source, kernel_size);
-            kernel_source[kernel_size] = '\0';
+            if (needsCompilation && !use_amdgpu && finalizeMode != FINALIZE_EAGER) {
+              if (pendingExecutables.find(index) == pendingExecutables.end()) {
+                pendingExecutables[index] = std::async(
+                    finalizeMode == FINALIZE_LAZY ? std::launch::deferred : std::launch::async,
+                    [this, size, source, index]() {
+                        KernelBlob kernel(size, source);
+                        return FinalizeProgramImpl(kernel.data, kernel.size, index);
+                    });
+              }
+              return;
+            }
+            KernelBlob kernel(size, source);
             if (needsCompilation && !use_amdgpu) {
-              BuildProgramImpl(kernel_source, kernel_size);
+              BuildProgramImpl(kernel.data, kernel.size, index);
             } else {
-              BuildOfflineFinalizedProgramImpl(kernel_source, kernel_size);
+              BuildOfflineFinalizedProgramImpl(kernel.data, kernel.size, index);
             }
-            free(kernel_source);
         }
     }
 
     bool IsCompatibleKernel(void* size, void* source) override {
         hsa_status_t status;
 
-        // Allocate memory for kernel source
-        size_t kernel_size = (size_t)((void *)size);
-        char *kernel_source = (char*)malloc(kernel_size+1);
-        memcpy(kernel_source, source, kernel_size);
-        kernel_source[kernel_size] = '\0';
+        KernelBlob kernel(size, source);
 
         // Deserialize code object.
         hsa_code_object_t code_object = {0};
-        status = hsa_code_object_deserialize(kernel_source, kernel_size, NULL, &code_object);
+        status = hsa_code_object_deserialize(kernel.data, kernel.size, NULL, &code_object);
         STATUS_CHECK(status, __LINE__);
         assert(0 != code_object.handle);
 
@@ -1531,25 +4655,21 @@ public:
         status = hsa_code_object_destroy(code_object);
         STATUS_CHECK(status, __LINE__);
 
-        // release allocated memory
-        free(kernel_source);
-
         return isCompatible;
     }
 
-    void* CreateKernel(const char* fun, void* size, void* source, bool needsCompilation = true) override {
+    void* ResolveKernel(const char* fun, void* size, void* source, bool needsCompilation = true) override {
         std::string str(fun);
-        HSAKernel *kernel = programs[str];
+        std::lock_guard<std::mutex> lock(programsMutex);
+        HSAKernel *&kernel = programs[str];
         if (!kernel) {
             bool use_amdgpu = false;
 #ifdef HSA_USE_AMDGPU_BACKEND
             const char *km_use_amdgpu = getenv("KM_USE_AMDGPU");
             use_amdgpu = !km_use_amdgpu || km_use_amdgpu[0] != '0';
 #endif
-            size_t kernel_size = (size_t)((void *)size);
-            char *kernel_source = (char*)malloc(kernel_size+1);
-            memcpy(kernel_source, source, kernel_size);
-            kernel_source[kernel_size] = '\0';
+            std::string index = kernel_checksum((size_t)size, source);
+            KernelBlob blob(size, source);
             std::string kname;
             if (use_amdgpu) {
               kname = fun;
@@ -1558,19 +4678,37 @@ public:
             }
             //std::cerr << "HSADevice::CreateKernel(): Creating kernel: " << kname << "\n";
             if (needsCompilation && !use_amdgpu) {
-              kernel = CreateKernelImpl(kernel_source, kernel_size, kname.c_str());
+              kernel = CreateKernelImpl(blob.data, blob.size, index, kname.c_str());
             } else {
-              kernel = CreateOfflineFinalizedKernelImpl(kernel_source, kernel_size, kname.c_str());
+              kernel = CreateOfflineFinalizedKernelImpl(blob.data, blob.size, index, kname.c_str());
             }
-            free(kernel_source);
             if (!kernel) {
                 std::cerr << "HSADevice::CreateKernel(): Unable to create kernel\n";
                 abort();
             } else {
                 //std::cerr << "HSADevice::CreateKernel(): Created kernel\n";
             }
-            programs[str] = kernel;
         }
+        return kernel;
+    }
+
+    void* CreateKernel(const char* fun, void* size, void* source, bool needsCompilation = true) override {
+        return CreateDispatch(ResolveKernel(fun, size, source, needsCompilation));
+    }
+
+    bool GetKernelResources(void* resolved, KalmarKernelResources& resources) override {
+        resources = static_cast<HSAKernel*>(resolved)->getResources();
+        return true;
+    }
+
+    void SetKernelLaunchBounds(void* resolved, const KalmarLaunchBounds& bounds) override {
+        HSAKernel *kernel = static_cast<HSAKernel*>(resolved);
+        std::lock_guard<std::mutex> lock(programsMutex);
+        kernel->setLaunchBounds(bounds);
+    }
+
+    void* CreateDispatch(void* resolved) override {
+        HSAKernel *kernel = static_cast<HSAKernel*>(resolved);
 
         // HSADispatch instance will be deleted in:
         // HSAQueue::LaunchKernel()
@@ -1591,23 +4729,81 @@ public:
     }
 
     std::shared_ptr<KalmarQueue> createQueue(execute_order order = execute_in_order) override {
-        std::shared_ptr<KalmarQueue> q =  std::shared_ptr<KalmarQueue>(new HSAQueue(this, agent, order));
+        return createQueue(order, hcQueuePriorityNormal, std::vector<bool>());
+    }
+
+    std::shared_ptr<KalmarQueue> createQueue(execute_order order, hcQueuePriority priority,
+                                             const std::vector<bool>& cu_mask) override {
+        return createQueue(order, priority, cu_mask, UINT32_MAX, UINT32_MAX);
+    }
+
+    std::shared_ptr<KalmarQueue> createQueue(execute_order order, uint32_t privateSegmentSize,
+                                             uint32_t groupSegmentSize) override {
+        return createQueue(order, hcQueuePriorityNormal, std::vector<bool>(), privateSegmentSize, groupSegmentSize);
+    }
+
+    std::shared_ptr<KalmarQueue> createQueue(execute_order order, hcQueuePriority priority,
+                                             const std::vector<bool>& cu_mask,
+                                             uint32_t privateSegmentSize, uint32_t groupSegmentSize) {
+        HSAQueue* hsaQueue = new HSAQueue(this, agent, order, queuesPerView, priority,
+                                          privateSegmentSize, groupSegmentSize);
+        if (hasHSAKernargRegion() && USE_KERNARG_REGION) {
+            // the queue works without its kernarg ring, using the kernarg pool
+            hsaQueue->getKernargRing()->init(getHSAKernargRegion(), agent);
+        }
+        // the CU mask is set before the queue is visible to anyone
+        if (!cu_mask.empty()) {
+            hsaQueue->set_cu_mask(cu_mask);
+        }
+        std::shared_ptr<KalmarQueue> q =  std::shared_ptr<KalmarQueue>(hsaQueue);
         queues_mutex.lock();
+        pruneQueues();
         queues.push_back(q);
         queues_mutex.unlock();
         return q;
     }
 
+    // drop the queues destroyed since, with queues_mutex held, so the list
+    // doesn't grow with the views created and destroyed over time
+    void pruneQueues() {
+        queues.erase(std::remove_if(queues.begin(), queues.end(),
+                                    [](const std::weak_ptr<KalmarQueue>& queue) { return queue.expired(); }),
+                     queues.end());
+    }
+
     size_t GetMaxTileStaticSize() override {
         return max_tile_static_size;
     }
 
+    uint32_t GetMaxPrivateSegmentSize() override {
+        return maxPrivateSegmentSize.load(std::memory_order_relaxed);
+    }
+
+    uint32_t GetMaxGroupSegmentSize() override {
+        return maxGroupSegmentSize.load(std::memory_order_relaxed);
+    }
+
+    // record the segment sizes of a kernel created on the device
+    HSAKernel* addKernel(HSAKernel* kernel) {
+        Kalmar::KalmarKernelResources resources = kernel->getResources();
+        uint32_t size = maxPrivateSegmentSize.load(std::memory_order_relaxed);
+        while (resources.privateSegmentSize > size &&
+               !maxPrivateSegmentSize.compare_exchange_weak(size, resources.privateSegmentSize)) {}
+        size = maxGroupSegmentSize.load(std::memory_order_relaxed);
+        while (resources.groupSegmentSize > size &&
+               !maxGroupSegmentSize.compare_exchange_weak(size, resources.groupSegmentSize)) {}
+        return kernel;
+    }
+
     std::vector< std::shared_ptr<KalmarQueue> > get_all_queues() override {
         std::vector< std::shared_ptr<KalmarQueue> > result;
         queues_mutex.lock();
-        for (auto queue : queues) {
-            if (!queue.expired()) {
-                result.push_back(queue.lock());
+        pruneQueues();
+        result.reserve(queues.size());
+        for (auto& queue : queues) {
+            // a queue may still expire after pruning
+            if (auto q = queue.lock()) {
+                result.push_back(q);
             }
         }
         queues_mutex.unlock();
@@ -1662,6 +4858,33 @@ public:
       return false;
     }
 
+    // the sum of the NUMA distances of the links from the agent of @p other
+    // to the device memory of this device, or the number of links if the
+    // distances are not reported, as for the host memory of the context
+    uint32_t get_peer_distance(const Kalmar::KalmarDevice* other) override {
+        if (other == this)
+            return 0;
+        if (!is_peer(other))
+            return UINT32_MAX;
+
+        auto self_pool = getHSAAMRegion();
+        hsa_agent_t* agent = static_cast<hsa_agent_t*>(const_cast<KalmarDevice *>(other)->getHSAAgent());
+        uint32_t hops = 0;
+        hsa_status_t status = hsa_amd_agent_memory_pool_get_info(*agent, self_pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_NUM_LINK_HOPS, &hops);
+        if (status != HSA_STATUS_SUCCESS || hops == 0)
+            return 1;
+
+        std::vector<hsa_amd_memory_pool_link_info_t> links(hops);
+        status = hsa_amd_agent_memory_pool_get_info(*agent, self_pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_LINK_INFO, links.data());
+        if (status != HSA_STATUS_SUCCESS)
+            return hops;
+
+        uint32_t distance = 0;
+        for (auto& link : links)
+            distance += link.numa_distance;
+        return distance > 0 ? distance : hops;
+    }
+
     unsigned int get_compute_unit_count() override {
         hsa_agent_t agent = getAgent();
 
@@ -1673,6 +4896,10 @@ public:
             return 0; 
     }
 
+    unsigned int get_wavefront_size() override {
+        return wavefront_size;
+    }
+
     void releaseKernargBuffer(void* kernargBuffer, int kernargBufferIndex) {
         if (hasHSAKernargRegion() && USE_KERNARG_REGION) {
             if ( (KERNARG_POOL_SIZE > 0) && (kernargBufferIndex >= 0) ) {
@@ -1818,6 +5045,18 @@ public:
         hsa_status_t status;
 
         unsigned long* symbol_ptr = nullptr;
+        std::lock_guard<std::mutex> lock(programsMutex);
+        // executables are never unloaded, so addresses found stay valid
+        auto cached = symbolAddresses.find(symbolName);
+        if (cached != symbolAddresses.end()) {
+            return cached->second;
+        }
+        // symbols may be in programs not finalized yet
+        while (!pendingExecutables.empty()) {
+            auto pending = pendingExecutables.begin();
+            executables[pending->first] = pending->second.get();
+            pendingExecutables.erase(pending);
+        }
         if (executables.size() != 0) {
             // fix symbol name to match HSA rule
             std::string symbolString("&");
@@ -1839,6 +5078,7 @@ public:
                     STATUS_CHECK(status, __LINE__);
         
                     symbol_ptr = (unsigned long*)symbol_address;
+                    symbolAddresses[symbolName] = symbol_ptr;
                     break;
                 }
             }
@@ -1894,10 +5134,36 @@ public:
 
 private:
 
-    void BuildOfflineFinalizedProgramImpl(void* kernelBuffer, int kernelSize) {
-        hsa_status_t status;
+    // a kernel blob, BRIG or a code object in an ELF container, which is
+    // used in place: the blobs are sections embedded in the process, which
+    // the HSA runtime doesn't need to be terminated
+    // only a blob which is not aligned enough for the ELF headers is copied
+    struct KernelBlob {
+        char* data;
+        int size;
+        char* copy;
+
+        KernelBlob(void* kernelSize, void* source)
+            : data(static_cast<char*>(source)), size((int)(size_t)kernelSize), copy(nullptr) {
+            if (reinterpret_cast<uintptr_t>(source) % KERNEL_BLOB_ALIGNMENT != 0) {
+                copy = static_cast<char*>(kalmar_aligned_alloc(KERNEL_BLOB_ALIGNMENT, size));
+                memcpy(copy, source, size);
+                data = copy;
+            }
+        }
+
+        ~KernelBlob() {
+            if (copy != nullptr) {
+                kalmar_aligned_free(copy);
+            }
+        }
 
-        std::string index = kernel_checksum((size_t)kernelSize, kernelBuffer);
+        KernelBlob(const KernelBlob&) = delete;
+        KernelBlob& operator=(const KernelBlob&) = delete;
+    };
+
+    void BuildOfflineFinalizedProgramImpl(void* kernelBuffer, int kernelSize, const std::string& index) {
+        hsa_status_t status;
 
         // load HSA program if we haven't done so
         if (executables.find(index) == executables.end()) {
@@ -1923,17 +5189,16 @@ private:
 
             // save everything as an HSAExecutable instance
             executables[index] = new HSAExecutable(hsaExecutable, code_object);
+            codeObjectBuilds.fetch_add(1, std::memory_order_relaxed);
         }
     }
 
-    HSAKernel* CreateOfflineFinalizedKernelImpl(void *kernelBuffer, int kernelSize, const char *entryName) {
+    HSAKernel* CreateOfflineFinalizedKernelImpl(void *kernelBuffer, int kernelSize, const std::string& index, const char *entryName) {
         hsa_status_t status;
 
-        std::string index = kernel_checksum((size_t)kernelSize, kernelBuffer);
-
         // load HSA program if we haven't done so
         if (executables.find(index) == executables.end()) {
-            BuildOfflineFinalizedProgramImpl(kernelBuffer, kernelSize);
+            BuildOfflineFinalizedProgramImpl(kernelBuffer, kernelSize, index);
         }
 
         // fetch HSAExecutable*
@@ -1949,16 +5214,86 @@ private:
         status = hsa_executable_symbol_get_info(kernelSymbol, HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_OBJECT, &kernelCodeHandle);
         STATUS_CHECK(status, __LINE__);
 
-        return new HSAKernel(executable, kernelSymbol, kernelCodeHandle);
+        return addKernel(new HSAKernel(executable, kernelSymbol, kernelCodeHandle, entryName));
+    }
+
+    void initKernelCache() {
+        if (!Kalmar::KernelCache::get().enabled()) {
+            return;
+        }
+
+        uint32_t length = 0;
+        hsa_status_t status = hsa_isa_get_info(agentISA, HSA_ISA_INFO_NAME_LENGTH, 0, &length);
+        if (status != HSA_STATUS_SUCCESS || length == 0) {
+            return;
+        }
+        std::vector<char> name(length + 1, '\0');
+        status = hsa_isa_get_info(agentISA, HSA_ISA_INFO_NAME, 0, name.data());
+        if (status != HSA_STATUS_SUCCESS) {
+            return;
+        }
+        agentISAName = name.data();
+    }
+
+    // key of the code object finalized from the program in the cache on
+    // disk, or an empty string if the cache is disabled
+    // it holds the checksum of the program, the ISA and the finalizer options
+    std::string kernelCacheKey(const std::string& index, size_t hsailSize, const char* finalizerOpt) {
+        if (agentISAName.empty()) {
+            return std::string();
+        }
+
+        std::stringstream key;
+        key << "HCC kernel cache 2\n" << hsailSize << " " << index << "\n"
+            << agentISAName << "\n" << (finalizerOpt ? finalizerOpt : "") << "\n";
+        return key.str();
+    }
+
+    // load a code object cached on disk, returns false if there's none
+    bool loadCachedCodeObject(const std::string& index, const std::string& key, hsa_code_object_t* codeObject) {
+        Kalmar::KernelCache::Blob blob;
+        if (!Kalmar::KernelCache::get().load(index, key, blob)) {
+            return false;
+        }
+
+        hsa_status_t status = hsa_code_object_deserialize(const_cast<char*>(blob.data()), blob.size(),
+                                                          NULL, codeObject);
+#if KALMAR_DEBUG
+        std::cerr << "loadCachedCodeObject(" << index << "): " << status << "\n";
+#endif
+        return (status == HSA_STATUS_SUCCESS);
+    }
+
+    static hsa_status_t allocateSerializedCodeObject(size_t size, hsa_callback_data_t data, void** address) {
+        *address = malloc(size);
+        return (*address != nullptr) ? HSA_STATUS_SUCCESS : HSA_STATUS_ERROR_OUT_OF_RESOURCES;
+    }
+
+    // store a finalized code object on disk, failures only mean the code
+    // object is finalized again on the next run
+    void storeCachedCodeObject(const std::string& index, const std::string& key, hsa_code_object_t codeObject) {
+        void* serialized = nullptr;
+        size_t serializedSize = 0;
+        hsa_callback_data_t data = {0};
+        hsa_status_t status = hsa_code_object_serialize(codeObject, allocateSerializedCodeObject, data, NULL,
+                                                        &serialized, &serializedSize);
+        if (status != HSA_STATUS_SUCCESS) {
+            return;
+        }
+        Kalmar::KernelCache::get().store(index, key, serialized, serializedSize);
+        free(serialized);
     }
 
-    void BuildProgramImpl(const char* hsailBuffer, int hsailSize) {
+    // finalize an HSA program into an executable, touching none of the maps
+    // of the device so that it may run on a background thread
+    HSAExecutable* FinalizeProgramImpl(const char* hsailBuffer, int hsailSize, const std::string& index) {
         hsa_status_t status;
 
-        std::string index = kernel_checksum((size_t)hsailSize, (void*)hsailBuffer);
+        const char* extra_finalizer_opt = getenv("HCC_FINALIZE_OPT");
+        std::string cacheKey = kernelCacheKey(index, (size_t)hsailSize, extra_finalizer_opt);
 
-        // finalize HSA program if we haven't done so
-        if (executables.find(index) == executables.end()) {
+        hsa_code_object_t hsaCodeObject = {0};
+        if (cacheKey.empty() || !loadCachedCodeObject(index, cacheKey, &hsaCodeObject)) {
             /*
              * Load BRIG, encapsulated in an ELF container, into a BRIG module.
              */
@@ -1989,8 +5324,6 @@ private:
             hsa_ext_control_directives_t control_directives;
             memset(&control_directives, 0, sizeof(hsa_ext_control_directives_t));
 
-            const char* extra_finalizer_opt = getenv("HCC_FINALIZE_OPT");
-            hsa_code_object_t hsaCodeObject = {0};
             status = hsa_ext_program_finalize(hsaProgram, isa, 0, control_directives,
                                               extra_finalizer_opt, HSA_CODE_OBJECT_TYPE_PROGRAM, &hsaCodeObject);
             STATUS_CHECK(status, __LINE__);
@@ -2000,33 +5333,50 @@ private:
                 STATUS_CHECK(status, __LINE__);
             }
 
-            // Create the executable.
-            hsa_executable_t hsaExecutable;
-            status = hsa_executable_create(HSA_PROFILE_FULL, HSA_EXECUTABLE_STATE_UNFROZEN,
-                                           NULL, &hsaExecutable);
-            STATUS_CHECK(status, __LINE__);
+            if (!cacheKey.empty()) {
+                storeCachedCodeObject(index, cacheKey, hsaCodeObject);
+            }
+        }
 
-            // Load the code object.
-            status = hsa_executable_load_code_object(hsaExecutable, agent, hsaCodeObject, NULL);
-            STATUS_CHECK(status, __LINE__);
+        // Create the executable.
+        hsa_executable_t hsaExecutable;
+        status = hsa_executable_create(HSA_PROFILE_FULL, HSA_EXECUTABLE_STATE_UNFROZEN,
+                                       NULL, &hsaExecutable);
+        STATUS_CHECK(status, __LINE__);
 
-            // Freeze the executable.
-            status = hsa_executable_freeze(hsaExecutable, NULL);
-            STATUS_CHECK(status, __LINE__);
+        // Load the code object.
+        status = hsa_executable_load_code_object(hsaExecutable, agent, hsaCodeObject, NULL);
+        STATUS_CHECK(status, __LINE__);
 
-            // save everything as an HSAExecutable instance
-            executables[index] = new HSAExecutable(hsaExecutable, hsaCodeObject);
+        // Freeze the executable.
+        status = hsa_executable_freeze(hsaExecutable, NULL);
+        STATUS_CHECK(status, __LINE__);
+
+        // save everything as an HSAExecutable instance
+        codeObjectBuilds.fetch_add(1, std::memory_order_relaxed);
+        return new HSAExecutable(hsaExecutable, hsaCodeObject);
+    }
+
+    void BuildProgramImpl(const char* hsailBuffer, int hsailSize, const std::string& index) {
+        // finalize HSA program if we haven't done so, or wait for it to be
+        // finalized if it was started or deferred when built
+        if (executables.find(index) == executables.end()) {
+            auto pending = pendingExecutables.find(index);
+            if (pending != pendingExecutables.end()) {
+                executables[index] = pending->second.get();
+                pendingExecutables.erase(pending);
+            } else {
+                executables[index] = FinalizeProgramImpl(hsailBuffer, hsailSize, index);
+            }
         }
     }
 
-    HSAKernel* CreateKernelImpl(const char *hsailBuffer, int hsailSize, const char *entryName) {
+    HSAKernel* CreateKernelImpl(const char *hsailBuffer, int hsailSize, const std::string& index, const char *entryName) {
         hsa_status_t status;
-  
-        std::string index = kernel_checksum((size_t)hsailSize, (void*)hsailBuffer);
 
         // finalize HSA program if we haven't done so
         if (executables.find(index) == executables.end()) {
-            BuildProgramImpl(hsailBuffer, hsailSize);
+            BuildProgramImpl(hsailBuffer, hsailSize, index);
         }
   
         // fetch HSAExecutable*
@@ -2042,7 +5392,7 @@ private:
         status = hsa_executable_symbol_get_info(kernelSymbol, HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_OBJECT, &kernelCodeHandle);
         STATUS_CHECK(status, __LINE__);
   
-        return new HSAKernel(executable, kernelSymbol, kernelCodeHandle);
+        return addKernel(new HSAKernel(executable, kernelSymbol, kernelCodeHandle, entryName));
     }
 
 };
@@ -2050,18 +5400,164 @@ private:
 class HSAContext final : public KalmarContext
 {
     /// memory pool for signals
-    std::vector<hsa_signal_t> signalPool;
-    std::vector<bool> signalPoolFlag;
-    int signalCursor;
+    ///
+    /// signals are allocated in chunks of SIGNAL_POOL_SIZE which are never
+    /// freed until the context is destroyed, and are identified by their
+    /// index in the pool. free signals are kept in a lock-free stack, whose
+    /// head packs a tag in the upper 32 bits to avoid ABA, and in a small
+    /// per-thread cache in front of it.
+    struct SignalPoolEntry {
+        hsa_signal_t signal;
+        std::atomic<uint32_t> next;
+    };
+    static const uint32_t SIGNAL_INDEX_NONE = 0xFFFFFFFF;
+    std::atomic<SignalPoolEntry*> signalChunks[SIGNAL_POOL_MAX_CHUNKS];
+    std::atomic<int> signalChunkCount;
+    std::atomic<uint64_t> signalFreeHead;
+    // only taken when the pool grows
     std::mutex signalPoolMutex;
-    /* TODO: Modify properly when supporing multi-gpu.
-    When using memory pool api, each agent will only report memory pool
+
+    /// number of signals served from the pool, and number of times the pool
+    /// had to grow, or to create a signal beyond SIGNAL_POOL_MAX_CHUNKS
+    std::atomic<uint64_t> signalPoolHits;
+    std::atomic<uint64_t> signalPoolMisses;
+
+    /// windows of hcWaitModeAdaptive, and number of waits which completed
+    /// while spinning, while yielding, and while blocked
+    std::chrono::microseconds waitSpinTime;
+    std::chrono::microseconds waitYieldTime;
+    std::atomic<uint64_t> waitSpinCount;
+    std::atomic<uint64_t> waitYieldCount;
+    std::atomic<uint64_t> waitBlockCount;
+
+    /// whether the host latency of kernel dispatches is recorded in the
+    /// histograms of the queues
+    bool dispatchLatency;
+
+    /// whether kernels followed by other packets of their batch or graph
+    /// release and acquire memory at agent scope, see
+    /// HSADispatch::setFenceScopes()
+    bool agentFences;
+
+    /// whether only in-flight work is drained, and the HSA queues destroyed,
+    /// at exit, see fastShutDown()
+    bool fastExit;
+
+    /// whether the HSA runtime has been initialized by init_devices()
+    bool initialized;
+
+    /// per-thread cache of free signals
+    /// signals still cached by a thread are given back when it exits
+    struct SignalCache {
+        HSAContext* owner;
+        int count;
+        uint32_t indices[SIGNAL_CACHE_SIZE];
+        // hits not yet accounted in signalPoolHits
+        uint64_t hits;
+
+        SignalCache() : owner(nullptr), count(0), hits(0) {}
+
+        void flushHits() {
+            if (owner != nullptr && hits > 0) {
+                owner->signalPoolHits.fetch_add(hits, std::memory_order_relaxed);
+                hits = 0;
+            }
+        }
+
+        ~SignalCache() {
+            if (owner != nullptr) {
+                while (count > 0) {
+                    owner->pushFreeSignal(indices[--count]);
+                }
+                flushHits();
+            }
+        }
+    };
+
+    SignalCache& getSignalCache() {
+        static thread_local SignalCache cache;
+        if (cache.owner == nullptr) {
+            cache.owner = this;
+        }
+        return cache;
+    }
+
+    SignalPoolEntry& getSignalEntry(uint32_t index) {
+        SignalPoolEntry* chunk = signalChunks[index / SIGNAL_POOL_SIZE].load(std::memory_order_acquire);
+        return chunk[index % SIGNAL_POOL_SIZE];
+    }
+
+    void pushFreeSignal(uint32_t index) {
+        uint64_t head = signalFreeHead.load(std::memory_order_relaxed);
+        uint64_t newHead;
+        do {
+            getSignalEntry(index).next.store(static_cast<uint32_t>(head), std::memory_order_relaxed);
+            newHead = (((head >> 32) + 1) << 32) | index;
+        } while (!signalFreeHead.compare_exchange_weak(head, newHead,
+                                                       std::memory_order_release,
+                                                       std::memory_order_relaxed));
+    }
+
+    uint32_t popFreeSignal() {
+        uint64_t head = signalFreeHead.load(std::memory_order_acquire);
+        uint64_t newHead;
+        uint32_t index;
+        do {
+            index = static_cast<uint32_t>(head);
+            if (index == SIGNAL_INDEX_NONE) {
+                return SIGNAL_INDEX_NONE;
+            }
+            // entries are never freed, so reading a stale next is harmless,
+            // the tag makes the exchange fail in that case
+            uint32_t next = getSignalEntry(index).next.load(std::memory_order_relaxed);
+            newHead = (((head >> 32) + 1) << 32) | next;
+        } while (!signalFreeHead.compare_exchange_weak(head, newHead,
+                                                       std::memory_order_acquire,
+                                                       std::memory_order_acquire));
+        return index;
+    }
+
+    /// add a chunk of SIGNAL_POOL_SIZE signals to the pool
+    /// returns the index of one signal of the new chunk, which is already
+    /// taken by the caller, or SIGNAL_INDEX_NONE if the pool is full
+    uint32_t growSignalPool() {
+        hsa_status_t status = HSA_STATUS_SUCCESS;
+        std::lock_guard<std::mutex> lock(signalPoolMutex);
+
+        // another thread may have grown the pool in the meantime
+        uint32_t index = popFreeSignal();
+        if (index != SIGNAL_INDEX_NONE) {
+            return index;
+        }
+
+        int chunkIndex = signalChunkCount.load(std::memory_order_relaxed);
+        if (chunkIndex == SIGNAL_POOL_MAX_CHUNKS) {
+            return SIGNAL_INDEX_NONE;
+        }
+
+        SignalPoolEntry* chunk = new SignalPoolEntry[SIGNAL_POOL_SIZE];
+        for (int i = 0; i < SIGNAL_POOL_SIZE; ++i) {
+            status = hsa_signal_create(1, 0, NULL, &chunk[i].signal);
+            STATUS_CHECK(status, __LINE__);
+        }
+        signalChunks[chunkIndex].store(chunk, std::memory_order_release);
+        signalChunkCount.store(chunkIndex + 1, std::memory_order_release);
+
+        // keep the first signal, make the rest available
+        uint32_t base = chunkIndex * SIGNAL_POOL_SIZE;
+        for (int i = SIGNAL_POOL_SIZE - 1; i > 0; --i) {
+            pushFreeSignal(base + i);
+        }
+        return base;
+    }
+    /* When using memory pool api, each agent will only report memory pool
     which is attached with the agent itself physically, eg, GPU won't
-    report system memory pool anymore. In order to change as little
-    as possbile, will choose the first CPU as default host and hack the 
-    HSADevice class to assign it the host memory pool to GPU agent. 
+    report system memory pool anymore. Each HSADevice is therefore assigned
+    the system memory pools of the CPU closest to it, see find_nearest_host.
+    host is the first CPU, used when no distance can be told apart.
     */
     hsa_agent_t host;
+    std::vector<hsa_agent_t> hosts;
     
     /// Determines if the given agent is of type HSA_DEVICE_TYPE_GPU
     /// If so, cache to input data
@@ -2106,6 +5602,8 @@ class HSAContext final : public KalmarContext
         return HSA_STATUS_SUCCESS;
     }
 
+    /// Determines if the given agent is of type HSA_DEVICE_TYPE_CPU
+    /// If so, cache to input data
     static hsa_status_t find_host(hsa_agent_t agent, void* data) {
         hsa_status_t status;
         hsa_device_type_t device_type;
@@ -2115,167 +5613,318 @@ class HSAContext final : public KalmarContext
         STATUS_CHECK(status, __LINE__);
 
         if(HSA_DEVICE_TYPE_CPU == device_type) {
-            *(hsa_agent_t*)data = agent;
+            static_cast<std::vector<hsa_agent_t>*>(data)->push_back(agent);
+        }
+        return HSA_STATUS_SUCCESS;
+    }
+
+    /// Finds the first global memory pool of a CPU agent
+    static hsa_status_t find_host_global_pool(hsa_amd_memory_pool_t pool, void* data) {
+        hsa_status_t status;
+        hsa_amd_segment_t segment;
+        status = hsa_amd_memory_pool_get_info(pool, HSA_AMD_MEMORY_POOL_INFO_SEGMENT, &segment);
+        STATUS_CHECK(status, __LINE__);
+
+        if (segment == HSA_AMD_SEGMENT_GLOBAL) {
+            *static_cast<hsa_amd_memory_pool_t*>(data) = pool;
             return HSA_STATUS_INFO_BREAK;
         }
         return HSA_STATUS_SUCCESS;
     }
 
+    /// Distance from a GPU agent to the system memory of a CPU agent, the
+    /// sum of the NUMA distances of the links in between, or the number of
+    /// links if the distances are not reported. UINT32_MAX if the GPU can
+    /// not access that memory
+    static uint32_t get_host_distance(hsa_agent_t agent, hsa_agent_t host) {
+        hsa_status_t status;
+        hsa_amd_memory_pool_t pool;
+        pool.handle = (uint64_t)-1;
+        status = hsa_amd_agent_iterate_memory_pools(host, &HSAContext::find_host_global_pool, &pool);
+        if ((status != HSA_STATUS_SUCCESS && status != HSA_STATUS_INFO_BREAK) || pool.handle == (uint64_t)-1)
+            return UINT32_MAX;
+
+        hsa_amd_memory_pool_access_t access = HSA_AMD_MEMORY_POOL_ACCESS_NEVER_ALLOWED;
+        status = hsa_amd_agent_memory_pool_get_info(agent, pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_ACCESS, &access);
+        if (status != HSA_STATUS_SUCCESS || access == HSA_AMD_MEMORY_POOL_ACCESS_NEVER_ALLOWED)
+            return UINT32_MAX;
+
+        uint32_t hops = 0;
+        status = hsa_amd_agent_memory_pool_get_info(agent, pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_NUM_LINK_HOPS, &hops);
+        if (status != HSA_STATUS_SUCCESS || hops == 0)
+            return 0;
+
+        std::vector<hsa_amd_memory_pool_link_info_t> links(hops);
+        status = hsa_amd_agent_memory_pool_get_info(agent, pool, HSA_AMD_AGENT_MEMORY_POOL_INFO_LINK_INFO, links.data());
+        if (status != HSA_STATUS_SUCCESS)
+            return hops;
+
+        uint32_t distance = 0;
+        for (auto& link : links)
+            distance += link.numa_distance;
+        return distance > 0 ? distance : hops;
+    }
+
+    /// Picks the CPU agent, among hosts, whose system memory is closest to
+    /// the given GPU agent. Ties go to the CPU found first
+    hsa_agent_t find_nearest_host(hsa_agent_t agent) const {
+        hsa_agent_t nearest = host;
+        uint32_t nearestDistance = UINT32_MAX;
+        for (auto& h : hosts) {
+            uint32_t distance = get_host_distance(agent, h);
+            if (distance < nearestDistance) {
+                nearest = h;
+                nearestDistance = distance;
+            }
+        }
+#if KALMAR_DEBUG
+        std::cerr << "find_nearest_host(" << agent.handle << "): " << nearest.handle
+                  << ", distance " << nearestDistance << "\n";
+#endif
+        return nearest;
+    }
+
 
 public:
-    HSAContext() : KalmarContext(), signalPool(), signalPoolFlag(), signalCursor(0), signalPoolMutex() {
+    HSAContext() : KalmarContext(), signalChunkCount(0), signalFreeHead(SIGNAL_INDEX_NONE), signalPoolMutex(),
+                   signalPoolHits(0), signalPoolMisses(0),
+                   waitSpinTime(WAIT_SPIN_TIME_US), waitYieldTime(WAIT_YIELD_TIME_US),
+                   waitSpinCount(0), waitYieldCount(0), waitBlockCount(0), dispatchLatency(false),
+                   agentFences(true), fastExit(FAST_EXIT), initialized(false) {
+        for (int i = 0; i < SIGNAL_POOL_MAX_CHUNKS; ++i) {
+            signalChunks[i].store(nullptr, std::memory_order_relaxed);
+        }
+
+        // environment variables HCC_WAIT_SPIN_US and HCC_WAIT_YIELD_US may be
+        // used to change the windows of hcWaitModeAdaptive
+        char* wait_spin_env = getenv("HCC_WAIT_SPIN_US");
+        if (wait_spin_env != nullptr) {
+            waitSpinTime = std::chrono::microseconds(atoi(wait_spin_env));
+        }
+        char* wait_yield_env = getenv("HCC_WAIT_YIELD_US");
+        if (wait_yield_env != nullptr) {
+            waitYieldTime = std::chrono::microseconds(atoi(wait_yield_env));
+        }
+
+        // environment variable HCC_DISPATCH_LATENCY may be used to record the
+        // host latency of kernel dispatches
+        char* dispatch_latency_env = getenv("HCC_DISPATCH_LATENCY");
+        if (dispatch_latency_env != nullptr) {
+            dispatchLatency = (atoi(dispatch_latency_env) != 0);
+        }
+
+        // environment variable HCC_SYSTEM_FENCES may be set to 1 so that all
+        // kernels release and acquire memory at system scope
+        char* system_fences_env = getenv("HCC_SYSTEM_FENCES");
+        if (system_fences_env != nullptr) {
+            agentFences = (atoi(system_fences_env) == 0);
+        }
+
+        // environment variable HCC_FAST_EXIT may be set to 1 so that the
+        // runtime is torn down quickly at exit
+        char* fast_exit_env = getenv("HCC_FAST_EXIT");
+        if (fast_exit_env != nullptr) {
+            fastExit = (atoi(fast_exit_env) != 0);
+        }
+
+        // environment variable HCC_TRACE may be used to trace the runtime to
+        // the file it names
+        char* trace_env = getenv("HCC_TRACE");
+        if (trace_env != nullptr && trace_env[0] != '\0') {
+            tracer.start(trace_env);
+        }
+
+        // environment variable HCC_KERNEL_PROFILE may be used to profile the
+        // kernels into the file it names, for the device compiler
+        char* kernel_profile_env = getenv("HCC_KERNEL_PROFILE");
+        if (kernel_profile_env != nullptr && kernel_profile_env[0] != '\0') {
+            kernelProfile.start(kernel_profile_env);
+        }
+
         host.handle = (uint64_t)-1;
-        // initialize HSA runtime
+
+        // the HSA runtime is initialized in init_devices() on first use of
+        // a device
+    }
+
+    // initialize HSA runtime and find out all HSA agents
+    void init_devices() override {
 #if KALMAR_DEBUG
-        std::cerr << "HSAContext::HSAContext(): init HSA runtime\n";
+        std::cerr << "HSAContext::init_devices(): init HSA runtime\n";
 #endif
         hsa_status_t status;
         status = hsa_init();
         STATUS_CHECK(status, __LINE__);
+        initialized = true;
+
+        // collect timestamps of asynchronous copies as well as dispatches
+        // failure only leaves the timestamps of copies unavailable
+        hsa_amd_profiling_async_copy_enable(true);
+        tracer.calibrate();
 
         // Iterate over the agents to find out gpu device
         std::vector<hsa_agent_t> agents;
         status = hsa_iterate_agents(&HSAContext::find_gpu, &agents);
         STATUS_CHECK(status, __LINE__);
 
-        // Iterate over agents to find out the first cpu device as host
-        status = hsa_iterate_agents(&HSAContext::find_host, &host);
+        // Iterate over agents to find out the cpu devices, the first one
+        // being the default host
+        status = hsa_iterate_agents(&HSAContext::find_host, &hosts);
         STATUS_CHECK(status, __LINE__);
+        if (!hosts.empty())
+            host = hosts[0];
 
         for (int i = 0; i < agents.size(); ++i) {
             hsa_agent_t agent = agents[i];
-            auto Dev = new HSADevice(agent, host);
+            // system memory of each GPU comes from the CPU nearest to it
+            auto Dev = new HSADevice(agent, find_nearest_host(agent));
             // choose the first GPU device as the default device
             if (i == 0)
                 def = Dev;
-            Devices.push_back(Dev);
+            add_device(Dev);
         }
 
         
 #if SIGNAL_POOL_SIZE > 0
-        signalPoolMutex.lock();
-
-        // pre-allocate signals
-        for (int i = 0; i < SIGNAL_POOL_SIZE; ++i) {
-          hsa_signal_t signal;
-          status = hsa_signal_create(1, 0, NULL, &signal);
-          STATUS_CHECK(status, __LINE__);
-          signalPool.push_back(signal);
-          signalPoolFlag.push_back(false);
-        }
-
-        signalPoolMutex.unlock();
+        // pre-allocate the first chunk of signals
+        pushFreeSignal(growSignalPool());
 #endif
     }
 
     void releaseSignal(hsa_signal_t signal, int signalIndex) {
         hsa_status_t status = HSA_STATUS_SUCCESS;
 #if SIGNAL_POOL_SIZE > 0
-        signalPoolMutex.lock();
+        if (signalIndex < 0) {
+            // the signal was created beyond the capacity of the pool
+            status = hsa_signal_destroy(signal);
+            STATUS_CHECK(status, __LINE__);
+            return;
+        }
 
         // restore signal to the initial value 1
         hsa_signal_store_release(signal, 1);
 
-        // mark the signal pointed by signalIndex as available
-        signalPoolFlag[signalIndex] = false;
-
-        signalPoolMutex.unlock();
+        // keep the signal in the cache of this thread if there is room
+        SignalCache& cache = getSignalCache();
+        if (cache.count < SIGNAL_CACHE_SIZE) {
+            cache.indices[cache.count++] = signalIndex;
+        } else {
+            pushFreeSignal(signalIndex);
+        }
 #else
         status = hsa_signal_destroy(signal);
         STATUS_CHECK(status, __LINE__);
 #endif
     }
 
-    std::pair<hsa_signal_t, int> getSignal() {
+    // misses, if set, counts the misses of the signal pool for the queue the
+    // signal is acquired for
+    std::pair<hsa_signal_t, int> getSignal(std::atomic<uint64_t>* misses = nullptr) {
         hsa_signal_t ret;
 
 #if SIGNAL_POOL_SIZE > 0
-        signalPoolMutex.lock();
-        int cursor = signalCursor;
-
-        if (signalPoolFlag[cursor] == false) {
-            // the cursor is valid, use it
-            ret = signalPool[cursor];
-
-            // set the signal as used
-            signalPoolFlag[cursor] = true;
+        SignalCache& cache = getSignalCache();
+        uint32_t index;
+        if (cache.count > 0) {
+            index = cache.indices[--cache.count];
+        } else {
+            index = popFreeSignal();
+        }
 
-            // simply move the cursor to the next index
-            ++signalCursor;
-            if (signalCursor == signalPool.size()) signalCursor = 0;
+        if (index != SIGNAL_INDEX_NONE) {
+            if (++cache.hits == SIGNAL_CACHE_SIZE) {
+                cache.flushHits();
+            }
         } else {
-            // the cursor is not valid, sequentially find the next available slot
-            bool found = false;
-            int startingCursor = cursor;
-            do {
-                ++cursor;
-                if (cursor == signalPool.size()) cursor = 0;
+            signalPoolMisses.fetch_add(1, std::memory_order_relaxed);
+            if (misses != nullptr) {
+                misses->fetch_add(1, std::memory_order_relaxed);
+            }
 
-                if (signalPoolFlag[cursor] == false) {
-                    // the cursor is valid, use it
-                    ret = signalPool[cursor];
+            // increase signal pool on demand by SIGNAL_POOL_SIZE
+            index = growSignalPool();
+            if (index == SIGNAL_INDEX_NONE) {
+                // the pool is at its maximum size
+                hsa_status_t status = hsa_signal_create(1, 0, NULL, &ret);
+                STATUS_CHECK(status, __LINE__);
+                return std::make_pair(ret, -1);
+            }
+        }
 
-                    // set the signal as used
-                    signalPoolFlag[cursor] = true;
+        ret = getSignalEntry(index).signal;
+        int cursor = static_cast<int>(index);
+#else
+        hsa_signal_create(1, 0, NULL, &ret);
+        int cursor = 0;
+#endif
+        return std::make_pair(ret, cursor);
+    }
 
-                    // simply move the cursor to the next index
-                    signalCursor = cursor + 1;
-                    if (signalCursor == signalPool.size()) signalCursor = 0;
+    uint64_t getSignalPoolHits() override {
+        getSignalCache().flushHits();
+        return signalPoolHits.load(std::memory_order_relaxed);
+    }
 
-                    // break from the loop
-                    found = true;
-                    break;
-                }
-            } while(cursor != startingCursor); // ensure we at most scan the vector once
+    uint64_t getSignalPoolMisses() override {
+        return signalPoolMisses.load(std::memory_order_relaxed);
+    }
 
-            if (found == false) {
-                hsa_status_t status = HSA_STATUS_SUCCESS;
+    // wait for a completion signal to drop to 0, returns the signal value
+    // hcWaitModeAdaptive spins on the signal for waitSpinTime, then yields
+    // the thread for waitYieldTime, and then blocks on the signal
+    hsa_signal_value_t waitSignal(hsa_signal_t signal, hcWaitMode mode) {
+        hsa_signal_value_t value = hsa_signal_load_acquire(signal);
+        if (value == 0) {
+            waitSpinCount.fetch_add(1, std::memory_order_relaxed);
+            return value;
+        }
 
-                // increase signal pool on demand by SIGNAL_POOL_SIZE
+        HSATraceScope trace("wait", "signal");
 
-                // keep track of the size of signal pool before increasing it
-                int oldSignalPoolSize = signalPool.size();
-                int oldSignalPoolFlagSize = signalPoolFlag.size();
-                assert(oldSignalPoolSize == oldSignalPoolFlagSize);
+        if (mode == hcWaitModeActive) {
+            value = hsa_signal_wait_acquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX, HSA_WAIT_STATE_ACTIVE);
+            waitSpinCount.fetch_add(1, std::memory_order_relaxed);
+            return value;
+        }
 
-                // increase signal pool on demand for another SIGNAL_POOL_SIZE
-                for (int i = 0; i < SIGNAL_POOL_SIZE; ++i) {
-                    hsa_signal_t signal;
-                    status = hsa_signal_create(1, 0, NULL, &signal);
-                    STATUS_CHECK(status, __LINE__);
-                    signalPool.push_back(signal);
-                    signalPoolFlag.push_back(false);
+        if (mode == hcWaitModeAdaptive) {
+            auto spinEnd = std::chrono::steady_clock::now() + waitSpinTime;
+            auto yieldEnd = spinEnd + waitYieldTime;
+            do {
+                if (hsa_signal_load_acquire(signal) == 0) {
+                    waitSpinCount.fetch_add(1, std::memory_order_relaxed);
+                    return 0;
                 }
+            } while (std::chrono::steady_clock::now() < spinEnd);
+            do {
+                std::this_thread::yield();
+                if (hsa_signal_load_acquire(signal) == 0) {
+                    waitYieldCount.fetch_add(1, std::memory_order_relaxed);
+                    return 0;
+                }
+            } while (std::chrono::steady_clock::now() < yieldEnd);
+        }
 
-                assert(signalPool.size() == oldSignalPoolSize + SIGNAL_POOL_SIZE);
-                assert(signalPoolFlag.size() == oldSignalPoolFlagSize + SIGNAL_POOL_SIZE);
-
-                // set return values, after the pool has been increased
-
-                // use the first item in the newly allocated pool
-                cursor = oldSignalPoolSize;
+        value = hsa_signal_wait_acquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
+        waitBlockCount.fetch_add(1, std::memory_order_relaxed);
+        return value;
+    }
 
-                // access the new item through the newly assigned cursor
-                ret = signalPool[cursor];
+    uint64_t getWaitSpinCount() override {
+        return waitSpinCount.load(std::memory_order_relaxed);
+    }
 
-                // mark the item as used
-                signalPoolFlag[cursor] = true;
+    uint64_t getWaitYieldCount() override {
+        return waitYieldCount.load(std::memory_order_relaxed);
+    }
 
-                // simply move the cursor to the next index
-                signalCursor = cursor + 1;
-                if (signalCursor == signalPool.size()) signalCursor = 0;
+    uint64_t getWaitBlockCount() override {
+        return waitBlockCount.load(std::memory_order_relaxed);
+    }
 
-                found = true;
-            } 
-        }
+    bool isDispatchLatencyEnabled() const { return dispatchLatency; }
 
-        signalPoolMutex.unlock();
-#else
-        hsa_signal_create(1, 0, NULL, &ret);
-        int cursor = 0;
-#endif
-        return std::make_pair(ret, cursor);
-    }
+    bool isAgentFenceEnabled() const { return agentFences; }
 
     ~HSAContext() {
         hsa_status_t status = HSA_STATUS_SUCCESS;
@@ -2283,6 +5932,22 @@ public:
         std::cerr << "HSAContext::~HSAContext() in\n";
 #endif
 
+        // nothing but the CPU device if no device has been used
+        if (!initialized) {
+            for (auto dev : Devices)
+                delete dev;
+            Devices.clear();
+            return;
+        }
+
+        if (fastExit) {
+            fastShutDown();
+#if KALMAR_DEBUG
+            std::cerr << "HSAContext::~HSAContext() out\n";
+#endif
+            return;
+        }
+
         // destroy all KalmarDevices associated with this context
         for (auto dev : Devices)
             delete dev;
@@ -2292,15 +5957,24 @@ public:
 #if SIGNAL_POOL_SIZE > 0
         signalPoolMutex.lock();
 
+#if KALMAR_DEBUG
+        std::cerr << "HSAContext::~HSAContext(): signal pool hits: " << getSignalPoolHits()
+                  << ", misses: " << getSignalPoolMisses() << "\n";
+#endif
+
         // deallocate signals in the pool
-        for (int i = 0; i < signalPool.size(); ++i) {
-            hsa_signal_t signal;
-            status = hsa_signal_destroy(signalPool[i]);
-            STATUS_CHECK(status, __LINE__);
+        int chunkCount = signalChunkCount.load(std::memory_order_acquire);
+        for (int i = 0; i < chunkCount; ++i) {
+            SignalPoolEntry* chunk = signalChunks[i].load(std::memory_order_acquire);
+            for (int j = 0; j < SIGNAL_POOL_SIZE; ++j) {
+                status = hsa_signal_destroy(chunk[j].signal);
+                STATUS_CHECK(status, __LINE__);
+            }
+            delete [] chunk;
+            signalChunks[i].store(nullptr, std::memory_order_relaxed);
         }
-
-        signalPool.clear();
-        signalPoolFlag.clear();
+        signalChunkCount.store(0, std::memory_order_relaxed);
+        signalFreeHead.store(SIGNAL_INDEX_NONE, std::memory_order_relaxed);
 
         signalPoolMutex.unlock();
 #endif
@@ -2317,7 +5991,42 @@ public:
 #endif
     }
 
+    // tear down at exit with HCC_FAST_EXIT: in-flight work of all queues is
+    // drained and their HSA queues destroyed by several threads at once, so
+    // queues of different devices don't wait on each other.  Devices, pools
+    // of signals and memory, and executables are neither freed nor is the
+    // HSA runtime shut down, the OS reclaims them with the process
+    void fastShutDown() {
+        std::vector< std::shared_ptr<KalmarQueue> > queues;
+        // the first device is the CPU device
+        for (size_t i = 1; i < Devices.size(); ++i) {
+            std::vector< std::shared_ptr<KalmarQueue> > devQueues = Devices[i]->get_all_queues();
+            queues.insert(queues.end(), devQueues.begin(), devQueues.end());
+        }
+
+        std::atomic<size_t> next(0);
+        auto drain = [&]() {
+            for (size_t i = next++; i < queues.size(); i = next++) {
+                queues[i]->dispose();
+            }
+        };
+        size_t threadCount = std::min<size_t>(queues.size(), std::max(1u, std::thread::hardware_concurrency()));
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < threadCount; ++i) {
+            threads.push_back(std::thread(drain));
+        }
+        drain();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (size_t i = 1; i < Devices.size(); ++i) {
+            static_cast<HSADevice*>(Devices[i])->drainFinalization();
+        }
+    }
+
     uint64_t getSystemTicks() override {
+        discover_devices();
         // get system tick
         uint64_t timestamp = 0L;
         hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP, &timestamp);
@@ -2325,6 +6034,7 @@ public:
     }
 
     uint64_t getSystemTickFrequency() override {
+        discover_devices();
         // get system tick frequency
         uint64_t timestamp_frequency_hz = 0L;
         hsa_system_get_info(HSA_SYSTEM_INFO_TIMESTAMP_FREQUENCY, &timestamp_frequency_hz);
@@ -2336,6 +6046,14 @@ static HSAContext ctx;
 
 } // namespace Kalmar
 
+static inline const Kalmar::KalmarCallbacks* getCallbacks() {
+    return Kalmar::ctx.getCallbacks();
+}
+
+static inline uint64_t nextCorrelationId() {
+    return Kalmar::ctx.nextCorrelationId();
+}
+
 // ----------------------------------------------------------------------
 // member function implementation of HSADevice
 // ----------------------------------------------------------------------
@@ -2358,23 +6076,359 @@ HSAQueue::getHSAAgent() override {
     return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getAgent()));
 }
 
-inline void*
-HSAQueue::getHSAAMRegion() override {
-    return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getHSAAMRegion()));
-}
+inline void*
+HSAQueue::getHSAAMRegion() override {
+    return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getHSAAMRegion()));
+}
+
+inline void*
+HSAQueue::getHSAAMHostRegion() override {
+    return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getHSAAMHostRegion()));
+}
+
+
+inline void*
+HSAQueue::getHSAKernargRegion() override {
+    return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getHSAKernargRegion()));
+}
+
+inline bool
+HSAQueue::copyHostMemory(void* dst, const void* src, size_t count, hcMemcpyKind kind) {
+    HSADevice* device = static_cast<HSADevice*>(getDev());
+    void* hostPtr = (kind == hcMemcpyHostToDevice) ? const_cast<void*>(src) : dst;
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+
+    // host memory ranges cached locked are copied directly
+    HSAPinnedCache& cache = device->getPinnedCache();
+    void* va = cache.acquire(hostPtr, count);
+    if (va != nullptr) {
+        if (kind == hcMemcpyHostToDevice) {
+            status = hsa_memory_copy(dst, va, count);
+        } else {
+            status = hsa_memory_copy(va, src, count);
+        }
+        cache.release(hostPtr);
+        return (status == HSA_STATUS_SUCCESS);
+    }
+
+    HSAStagingBuffers* staging = device->getStagingBuffers();
+    if (staging != nullptr) {
+        if (kind == hcMemcpyHostToDevice) {
+            status = staging->write(dst, src, count);
+        } else {
+            status = staging->read(dst, src, count);
+        }
+        return (status == HSA_STATUS_SUCCESS);
+    }
+
+    return false;
+}
+
+inline void
+HSAQueue::copy_peer(void* src, KalmarDevice* srcDev, void* dst, size_t count,
+                    size_t src_offset, size_t dst_offset, bool blocking) override {
+    HSACopyCallbackScope callbacks(getDev()->get_ordinal(), (char*)src + src_offset, (char*)dst + dst_offset,
+                                   count, hcMemcpyDeviceToDevice);
+    HSADevice* device = static_cast<HSADevice*>(getDev());
+    HSADevice* srcDevice = static_cast<HSADevice*>(srcDev);
+    hsa_agent_t dstAgent = device->getAgent();
+    hsa_agent_t srcAgent = srcDevice->getAgent();
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+
+    // copy directly between the devices if this device can access the
+    // memory of the source device
+    if (srcDevice->is_peer(device)) {
+#if KALMAR_DEBUG
+        std::cerr << "copy_peer(" << src << "," << dst << "," << count << "): use peer copy\n";
+#endif
+        status = hsa_amd_agents_allow_access(1, &dstAgent, NULL, src);
+        if (status == HSA_STATUS_SUCCESS) {
+            hsa_signal_t signal;
+            status = hsa_signal_create(1, 0, NULL, &signal);
+            STATUS_CHECK(status, __LINE__);
+            status = hsa_amd_memory_async_copy((char*)dst + dst_offset, dstAgent, (char*)src + src_offset, srcAgent,
+                                               count, 0, NULL, signal);
+            if (status == HSA_STATUS_SUCCESS) {
+                hsa_signal_wait_acquire(signal, HSA_SIGNAL_CONDITION_LT, 1, UINT64_MAX, HSA_WAIT_STATE_BLOCKED);
+            }
+            hsa_signal_destroy(signal);
+            if (status == HSA_STATUS_SUCCESS) {
+                getCounters().addCopy(hcMemcpyDeviceToDevice, count);
+                return;
+            }
+        }
+    }
+
+    // otherwise stream the data through the staging buffers in host memory
+    HSAStagingBuffers* staging = device->getStagingBuffers();
+    if (staging != nullptr) {
+#if KALMAR_DEBUG
+        std::cerr << "copy_peer(" << src << "," << dst << "," << count << "): use staged copy\n";
+#endif
+        status = staging->transfer((char*)dst + dst_offset, (char*)src + src_offset, srcAgent, count);
+        if (status == HSA_STATUS_SUCCESS) {
+            return;
+        }
+    }
+
+    copy(src, dst, count, src_offset, dst_offset, blocking);
+}
+
+inline void*
+HSAQueue::map(void* device, size_t count, size_t offset, bool modify) override {
+    HSATraceScope trace("map", "map", count);
+    // do map
+
+    // as HSA runtime doesn't have map/unmap facility at this moment,
+    // we return a direct pointer to device memory the host can access, or
+    // explicitly copy it into a host buffer
+    HSADevice* dev = static_cast<HSADevice*>(getDev());
+    if (!dev->is_host_accessible(device) && !dev->isMapZeroCopy()) {
+#if KALMAR_DEBUG
+        std::cerr << "map(" << device << "," << count << "," << offset << "," << modify << "): use HSA memory map\n";
+#endif
+        void* data = dev->getMapBuffers().map((char*)device + offset, count, modify);
+        if (data == nullptr) {
+#if KALMAR_DEBUG
+            std::cerr << "host buffer allocation failed!\n";
+#endif
+            abort();
+        }
+#if KALMAR_DEBUG
+        std::cerr << "map(): " << data << "\n";
+#endif
+        return data;
+    } else {
+#if KALMAR_DEBUG
+        std::cerr << "map(" << device << "," << count << "," << offset << "," << modify << "): use direct memory map\n";
+#endif
+        // for host memory, and device memory the host can access, we simply
+        // return the pointer plus offset
+#if KALMAR_DEBUG
+        std::cerr << "map(): " << ((char*)device+offset) << "\n";
+#endif
+        return (char*)device + offset;
+    }
+}
+
+inline void
+HSAQueue::unmap(void* device, void* addr, size_t count, size_t offset, bool modify) override {
+    HSATraceScope trace("unmap", "map", count);
+    // do unmap
+
+    // copy the modified pages of the host buffer allocated in map() back to
+    // device memory
+    HSADevice* dev = static_cast<HSADevice*>(getDev());
+    if (!dev->is_host_accessible(device) && !dev->isMapZeroCopy()) {
+#if KALMAR_DEBUG
+        std::cerr << "unmap(" << device << "," << addr << "," << count << "," << offset << "," << modify << "): use HSA memory unmap\n";
+#endif
+        dev->getMapBuffers().unmap((char*)device + offset, addr, count, modify);
+    } else {
+#if KALMAR_DEBUG
+        std::cerr << "unmap(" << device << "," << addr << "," << count << "," << offset << "," << modify << "): use direct memory unmap\n";
+#endif
+        // for directly mapped memory there's nothing to be done
+    }
+}
+
+inline void*
+HSAQueue::map_for_write(void* device, size_t count, size_t offset) override {
+    HSATraceScope trace("map", "map", count);
+
+    // the host doesn't read the host buffer, so it needn't be cached or
+    // filled with the current content of device memory
+    HSADevice* dev = static_cast<HSADevice*>(getDev());
+    if (!dev->is_host_accessible(device) && !dev->isMapZeroCopy()) {
+        void* data = dev->getWriteMapBuffers().map((char*)device + offset, count, true, true);
+        if (data == nullptr) {
+#if KALMAR_DEBUG
+            std::cerr << "host buffer allocation failed!\n";
+#endif
+            abort();
+        }
+        return data;
+    }
+    return (char*)device + offset;
+}
+
+inline void
+HSAQueue::unmap_for_write(void* device, void* addr, size_t count, size_t offset) override {
+    HSATraceScope trace("unmap", "map", count);
+
+    HSADevice* dev = static_cast<HSADevice*>(getDev());
+    if (!dev->is_host_accessible(device) && !dev->isMapZeroCopy()) {
+        dev->getWriteMapBuffers().unmap((char*)device + offset, addr, count, true);
+    }
+}
+
+} // namespace Kalmar
+
+inline Kalmar::KalmarQueue*
+HSABarrier::getQueue() override {
+    return hsaQueue;
+}
+
+inline Kalmar::KalmarQueue*
+HSADispatch::getQueue() override {
+    return hsaQueue;
+}
+
+// ----------------------------------------------------------------------
+// member function implementation of HSALaunchTemplate
+// ----------------------------------------------------------------------
+
+std::shared_ptr<Kalmar::KalmarAsyncOp>
+HSALaunchTemplate::launch(Kalmar::hcBarrierMode barrier) override {
+    HSADispatch* dispatch = new HSADispatch(prototype);
+
+    // order the launch after previous async operations on the buffers
+    dispatch->setCommandQueue(hsaQueue->selectCommandQueue());
+    dispatch->setBarrierMode(barrier);
+    hsaQueue->resolveDependentAsyncOps(dispatch, buffers);
+
+    return hsaQueue->dispatchAsync(dispatch, buffers);
+}
+
+bool
+HSALaunchTemplate::exportPacket(void* packet) override {
+    Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
+    const std::vector<uint8_t>& args = prototype->getArgs();
+    if (!device->hasHSAKernargRegion()) {
+        return false;
+    }
+
+    // the arguments are copied once, kernels enqueue the packet many times
+    if (exportedKernarg == nullptr) {
+        size_t kernargSize = std::max<size_t>(prototype->getKernargSize(), 1);
+        hsa_status_t status = hsa_amd_memory_pool_allocate(device->getHSAKernargRegion(), kernargSize, 0, &exportedKernarg);
+        if (status != HSA_STATUS_SUCCESS) {
+            exportedKernarg = nullptr;
+            return false;
+        }
+        hsa_agent_t agent = device->getAgent();
+        status = hsa_amd_agents_allow_access(1, &agent, NULL, exportedKernarg);
+        STATUS_CHECK(status, __LINE__);
+    }
+    memcpy(exportedKernarg, args.data(), args.size());
+
+    hsa_kernel_dispatch_packet_t aql = prototype->getAQLPacket();
+    aql.kernarg_address = exportedKernarg;
+    aql.completion_signal.handle = 0;
+    memcpy(packet, &aql, sizeof(aql));
+    return true;
+}
+
+// ----------------------------------------------------------------------
+// member function implementation of HSAGraph
+// ----------------------------------------------------------------------
+
+void
+HSAGraph::addKernel(const std::shared_ptr<HSALaunchTemplate>& kernel, bool inOrder) {
+    const std::vector<HSABufferUse>& kernelBuffers = kernel->getBuffers();
+
+    // a kernel using a buffer used by an earlier kernel after the last marker
+    // waits for all previous packets, unless they are executed in order
+    if (!inOrder) {
+        bool dependent = std::any_of(std::begin(kernelBuffers), std::end(kernelBuffers),
+                                     [&] (const HSABufferUse& buffer) {
+                                       return std::find(std::begin(pendingBuffers), std::end(pendingBuffers), buffer.dev) != std::end(pendingBuffers);
+                                     });
+        if (dependent) {
+            kernel->getPrototype()->setBarrierBit();
+            pendingBuffers.clear();
+        }
+    }
+
+    for (const HSABufferUse& buffer : kernelBuffers) {
+        if (std::find(std::begin(pendingBuffers), std::end(pendingBuffers), buffer.dev) == std::end(pendingBuffers)) {
+            pendingBuffers.push_back(buffer.dev);
+        }
+        auto iter = std::find_if(std::begin(buffers), std::end(buffers),
+                                 [&] (const HSABufferUse& use) { return use.dev == buffer.dev; });
+        if (iter == std::end(buffers)) {
+            buffers.push_back(buffer);
+        } else {
+            iter->modify |= buffer.modify;
+        }
+    }
+
+    Node node;
+    node.kernel = kernel;
+    nodes.push_back(node);
+}
+
+std::shared_ptr<Kalmar::KalmarAsyncOp>
+HSAGraph::launch() override {
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+
+    if (nodes.empty()) {
+        return nullptr;
+    }
+
+    // the barrier closing the graph carries its only completion signal
+    std::shared_ptr<HSABarrier> barrier = std::make_shared<HSABarrier>();
+    barrier->getSignal();
+
+    // order the graph after previous async operations on its buffers, the
+    // first packet waits for previous ones on this queue if necessary
+    std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> > dependentAsyncOps;
+    bool dependent = hsaQueue->resolveDependentAsyncOps(buffers, dependentAsyncOps) &&
+                     (hsaQueue->get_execute_order() != Kalmar::execute_in_order);
+    barrier->setDependentAsyncOps(std::move(dependentAsyncOps));
+
+    hsa_queue_t* queue = static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
+
+    // write packets back to back, as many as the queue could hold at a time
+    size_t i = 0;
+    while (i < nodes.size()) {
+        uint64_t count = std::min<uint64_t>(nodes.size() - i, queue->size);
+        uint64_t index = reserveAQLPacketSlot(queue, count);
+        for (uint64_t j = 0; j < count; ++j, ++i) {
+            if (nodes[i].kernel != nullptr) {
+                HSADispatch* prototype = nodes[i].kernel->getPrototype();
+                hsa_kernel_dispatch_packet_t aql = prototype->getAQLPacket();
+                aql.completion_signal.handle = 0;
+                // the barrier closing the graph releases at system scope
+                prototype->setFenceScopes(aql.header, i > 0, true);
+                if (i == 0 && dependent) {
+                    aql.header |= (1 << HSA_PACKET_HEADER_BARRIER);
+                }
+
+                const std::vector<uint8_t>& args = prototype->getArgs();
+                aql.kernarg_address = barrier->allocKernarg(hsaQueue, prototype->getKernargSize());
+                if (aql.kernarg_address != nullptr) {
+                    memcpy(aql.kernarg_address, args.data(), args.size());
+                } else if (args.size() > 0) {
+                    // kernarg region is not used
+                    aql.kernarg_address = const_cast<uint8_t*>(args.data());
+                }
+                writeAQLPacket(queue, index + j, aql);
+            } else {
+                hsa_barrier_and_packet_t marker;
+                memset(&marker, 0, sizeof(hsa_barrier_and_packet_t));
+                marker.header = (HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE) |
+                                (1 << HSA_PACKET_HEADER_BARRIER) |
+                                (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
+                                (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE);
+                writeAQLPacket(queue, index + j, marker);
+            }
+        }
 
-inline void*
-HSAQueue::getHSAAMHostRegion() override {
-    return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getHSAAMHostRegion()));
-}
+        // let the packet processor drain the queue if more packets follow
+        if (i < nodes.size()) {
+            hsa_signal_store_relaxed(queue->doorbell_signal, index + count - 1);
+        }
+    }
 
+    // close the graph and ring the doorbell once
+    status = barrier->enqueueAsync(hsaQueue);
+    STATUS_CHECK(status, __LINE__);
 
-inline void*
-HSAQueue::getHSAKernargRegion() override {
-    return static_cast<void*>(&(static_cast<HSADevice*>(getDev())->getHSAKernargRegion()));
-}
+    hsaQueue->associateAsyncOp(barrier, buffers);
 
-} // namespace Kalmar
+    return barrier;
+}
 
 // ----------------------------------------------------------------------
 // member function implementation of HSADispatch
@@ -2384,36 +6438,85 @@ HSADispatch::HSADispatch(Kalmar::HSADevice* _device, HSAKernel* _kernel) :
     device(_device),
     agent(_device->getAgent()),
     kernel(_kernel),
+    aqlPrepared(false),
     isDispatched(false),
-    waitMode(HSA_WAIT_STATE_BLOCKED),
+    waitMode(Kalmar::hcWaitModeBlocked),
+    barrierMode(Kalmar::hcBarrierDefault),
     dynamicGroupSize(0),
-    future(nullptr),
     hsaQueue(nullptr),
-    kernargMemory(nullptr) {
+    commandQueue(nullptr),
+    traceTrack(0),
+    profiled(false),
+    batchBarrier(nullptr),
+    hostVisible(false),
+    kernargMemory(nullptr),
+    kernargRing(nullptr),
+    autotuneCandidate(-1) {
 
     clearArgs();
 }
 
+HSADispatch::HSADispatch(const HSADispatch* prototype) :
+    device(prototype->device),
+    agent(prototype->agent),
+    kernel(prototype->kernel),
+    arg_vec(prototype->arg_vec),
+    arg_count(prototype->arg_count),
+    prevArgVecCapacity(0),
+    launchDimensions(prototype->launchDimensions),
+    aql(prototype->aql),
+    aqlPrepared(prototype->aqlPrepared),
+    isDispatched(false),
+    waitMode(Kalmar::hcWaitModeBlocked),
+    barrierMode(prototype->barrierMode),
+    dynamicGroupSize(prototype->dynamicGroupSize),
+    hsaQueue(prototype->hsaQueue),
+    commandQueue(nullptr),
+    traceTrack(0),
+    profiled(false),
+    batchBarrier(nullptr),
+    hostVisible(prototype->hostVisible),
+    kernargMemory(nullptr),
+    kernargRing(nullptr),
+    autotuneCandidate(-1) {
+
+    memcpy(workgroup_size, prototype->workgroup_size, sizeof(workgroup_size));
+    memcpy(global_size, prototype->global_size, sizeof(global_size));
+}
 
-// dispatch a kernel asynchronously
-hsa_status_t 
-HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
-    struct timespec begin;
-    struct timespec end;
-    clock_gettime(CLOCK_REALTIME, &begin);
 
-    hsa_status_t status = HSA_STATUS_SUCCESS;
-    if (isDispatched) {
-        return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+void
+HSADispatch::addBuffer(Kalmar::dev_info* dev, bool modify) {
+    buffers.push_back({dev, modify});
+    if (!hostVisible && device->isHostVisible(dev->data)) {
+        hostVisible = true;
     }
-  
-    /*
-     * Create a signal to wait for the dispatch to finish.
-     */
-    std::pair<hsa_signal_t, int> ret = Kalmar::ctx.getSignal();
-    signal = ret.first;
-    signalIndex = ret.second;
-  
+}
+
+// A system scope release writes the caches of the agent back to memory
+// coherent with the host after the kernel, and a system scope acquire
+// invalidates them before; agent scope only makes the accesses visible to
+// the other packets of the agent. It's enough for a kernel followed by
+// other kernels of its batch or graph: the barrier packet closing them
+// releases at system scope before the host, or other agents, see them
+// complete. A kernel using fine-grained buffers, which the host may read
+// while the batch runs, keeps system scope.
+void
+HSADispatch::setFenceScopes(uint16_t& header, bool agentAcquire, bool agentRelease) const {
+    bool agent = Kalmar::ctx.isAgentFenceEnabled() && !hostVisible;
+    const uint16_t scopeMask = (1 << HSA_PACKET_HEADER_WIDTH_ACQUIRE_FENCE_SCOPE) - 1;
+    header &= ~((scopeMask << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
+                (scopeMask << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE));
+    header |= ((agent && agentAcquire) ? HSA_FENCE_SCOPE_AGENT : HSA_FENCE_SCOPE_SYSTEM)
+              << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE;
+    header |= ((agent && agentRelease) ? HSA_FENCE_SCOPE_AGENT : HSA_FENCE_SCOPE_SYSTEM)
+              << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE;
+}
+
+// fill in the fields of the AQL packet which only depend on the kernel
+// object, launch attributes and the queue
+void
+HSADispatch::prepareAQLPacket() {
     /*
      * Initialize the dispatch packet.
      */
@@ -2422,7 +6525,6 @@ HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
     /*
      * Setup the dispatch information.
      */
-    aql.completion_signal = signal;
     aql.setup = launchDimensions << HSA_KERNEL_DISPATCH_PACKET_SETUP_DIMENSIONS;
     aql.workgroup_size_x = workgroup_size[0];
     aql.workgroup_size_y = workgroup_size[1];
@@ -2433,9 +6535,10 @@ HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
   
 
     // set dispatch fences
-    if (hsaQueue->get_execute_order() == Kalmar::execute_in_order) {
+    if (waitsForPreviousPackets(hsaQueue->get_execute_order())) {
         //std::cout << "barrier bit on\n";
-        // set AQL header with barrier bit on if execute in order
+        // set AQL header with barrier bit on if execute in order, unless the
+        // barrier mode chooses otherwise
         aql.header = (HSA_PACKET_TYPE_KERNEL_DISPATCH << HSA_PACKET_HEADER_TYPE) |
                      (1 << HSA_PACKET_HEADER_BARRIER) |
                      (HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE) |
@@ -2451,6 +6554,88 @@ HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
     // bind kernel code
     aql.kernel_object = kernel->kernelCodeHandle;
   
+    // Initialize memory resources needed to execute
+    uint32_t group_segment_size = kernel->groupSegmentSize;
+
+#if KALMAR_DEBUG 
+    std::cerr << "static group segment size: " << group_segment_size << "\n";
+    std::cerr << "dynamic group segment size: " << this->dynamicGroupSize << "\n";
+#endif
+
+    // add dynamic group segment size
+    group_segment_size += this->dynamicGroupSize;
+    aql.group_segment_size = group_segment_size;
+
+    aql.private_segment_size = kernel->privateSegmentSize;
+
+    aqlPrepared = true;
+}
+
+void
+HSADispatch::setBarrierMode(Kalmar::hcBarrierMode mode) {
+    barrierMode = mode;
+    // the packet of a launch template is prepared already
+    if (aqlPrepared) {
+        if (waitsForPreviousPackets(hsaQueue->get_execute_order())) {
+            aql.header |= (1 << HSA_PACKET_HEADER_BARRIER);
+        } else {
+            aql.header &= ~(1 << HSA_PACKET_HEADER_BARRIER);
+        }
+    }
+}
+
+// dispatch a kernel asynchronously
+hsa_status_t 
+HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
+    bool timed = Kalmar::ctx.isDispatchLatencyEnabled() && hsaQueue != nullptr;
+    std::chrono::steady_clock::time_point begin;
+    if (timed) {
+        begin = std::chrono::steady_clock::now();
+    }
+    HSATraceScope trace(kernel->name.c_str(), "dispatch");
+
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+    if (isDispatched) {
+        return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+  
+    /*
+     * Create a signal to wait for the dispatch to finish.
+     * A batched dispatch uses the signal of the barrier closing the batch
+     * and does not signal completion by itself.
+     */
+    if (batchBarrier == nullptr) {
+        std::pair<hsa_signal_t, int> ret =
+            Kalmar::ctx.getSignal(hsaQueue ? &hsaQueue->getCounters().signalPoolMisses : nullptr);
+        signal = ret.first;
+        signalIndex = ret.second;
+    } else {
+        signal = batchBarrier->getSignal();
+        signalIndex = -1;
+    }
+  
+    /*
+     * Initialize the dispatch packet, unless it's prepared by a launch
+     * template already.
+     */
+    if (!aqlPrepared) {
+        prepareAQLPacket();
+    }
+
+    // a batched kernel follows another kernel of the batch, unless it's the
+    // first one
+    bool batched = (batchBarrier != nullptr);
+    setFenceScopes(aql.header, batched && !batchBarrier->addBatchedDispatch(), batched);
+
+    /*
+     * Setup the completion signal.
+     */
+    if (batchBarrier == nullptr) {
+        aql.completion_signal = signal;
+    } else {
+        aql.completion_signal.handle = 0;
+    }
+
     // bind kernel arguments
     //printf("arg_vec size: %d in bytes: %d\n", arg_vec.size(), arg_vec.size());
 
@@ -2458,9 +6643,25 @@ HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
         hsa_amd_memory_pool_t kernarg_region = device->getHSAKernargRegion();
 
         if (arg_vec.size() > 0) {
-            std::pair<void*, int> ret = device->getKernargBuffer(arg_vec.size());
-            kernargMemory = ret.first;
-            kernargMemoryIndex = ret.second;
+            size_t kernargSize = getKernargSize();
+            assert(kernel->kernargSegmentAlignment <= KERNARG_RING_ALIGNMENT);
+
+            // carve kernel arguments from the kernarg ring of the queue,
+            // fall back to the kernarg pool if the ring is full
+            // signals created beyond the signal pool are destroyed upon
+            // release, so the ring can't track them
+            HSAKernargRing* ring = hsaQueue->getKernargRing();
+            if (signalIndex >= 0 || batchBarrier != nullptr) {
+                kernargMemory = ring->allocate(kernargSize, signal, &kernargRingOffset);
+            }
+            if (kernargMemory != nullptr) {
+                kernargRing = ring;
+            } else {
+                Kalmar::KalmarQueueCounters::add(hsaQueue->getCounters().kernargPoolMisses);
+                std::pair<void*, int> ret = device->getKernargBuffer(kernargSize);
+                kernargMemory = ret.first;
+                kernargMemoryIndex = ret.second;
+            }
 
 #if USE_HSA_MEMORY_COPY_FOR_KERNARG
             // use hsa_memory_copy to copy kernel arguments from host to kernarg region
@@ -2481,59 +6682,58 @@ HSADispatch::dispatchKernel(hsa_queue_t* commandQueue) {
     }
 
 
-    //for (size_t i = 0; i < arg_vec.size(); ++i) {
-    //  printf("%02X ", *(((uint8_t*)aql.kernarg_address)+i));
-    //}
-    //printf("\n");
- 
-    // Initialize memory resources needed to execute
-    uint32_t group_segment_size;
-    status = hsa_executable_symbol_get_info(kernel->hsaExecutableSymbol,
-                                            HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_GROUP_SEGMENT_SIZE,
-                                            &group_segment_size);
-    STATUS_CHECK_Q(status, commandQueue, __LINE__);
-
-#if KALMAR_DEBUG 
-    std::cerr << "static group segment size: " << group_segment_size << "\n";
-    std::cerr << "dynamic group segment size: " << this->dynamicGroupSize << "\n";
-#endif
-
-    // add dynamic group segment size
-    group_segment_size += this->dynamicGroupSize;
-    aql.group_segment_size = group_segment_size;
-
-    uint32_t private_segment_size;
-    status = hsa_executable_symbol_get_info(kernel->hsaExecutableSymbol,
-                                            HSA_EXECUTABLE_SYMBOL_INFO_KERNEL_PRIVATE_SEGMENT_SIZE,
-                                            &private_segment_size);
-    STATUS_CHECK_Q(status, commandQueue, __LINE__);
-    aql.private_segment_size = private_segment_size;
+    // the signal of a batched dispatch belongs to the barrier so it doesn't
+    // time the dispatch
+    profiled = (batchBarrier == nullptr) && hsaQueue->acquireProfiling(autotuneCandidate >= 0, true);
+
+    // tell an external profiler, if any, about the dispatch
+    const Kalmar::KalmarCallbacks* callbacks = getCallbacks();
+    hc_dispatch_record record;
+    if (__builtin_expect(callbacks != nullptr, 0)) {
+        record.device = device->get_ordinal();
+        record.queue = commandQueue->id;
+        record.kernel_name = kernel->name.c_str();
+        record.grid[0] = aql.grid_size_x;
+        record.grid[1] = aql.grid_size_y;
+        record.grid[2] = aql.grid_size_z;
+        record.workgroup[0] = aql.workgroup_size_x;
+        record.workgroup[1] = aql.workgroup_size_y;
+        record.workgroup[2] = aql.workgroup_size_z;
+        record.group_segment_size = aql.group_segment_size;
+        record.private_segment_size = aql.private_segment_size;
+        record.signal = aql.completion_signal.handle;
+        record.correlation_id = nextCorrelationId();
+        if (callbacks->dispatchBegin)
+            callbacks->dispatchBegin(&record, callbacks->dispatchData);
+    }
 
     // write packet
-    uint32_t queueMask = commandQueue->size - 1;
-    // TODO: Need to check if package write is correct.
-    uint64_t index = hsa_queue_load_write_index_relaxed(commandQueue);
-    uint64_t nextIndex = index + 1;
-    if (nextIndex - hsa_queue_load_read_index_acquire(commandQueue) >= commandQueue->size) {
-      checkHCCRuntimeStatus(Kalmar::HCCRuntimeStatus::HCCRT_STATUS_ERROR_COMMAND_QUEUE_OVERFLOW, __LINE__, commandQueue);
-    }
-    ((hsa_kernel_dispatch_packet_t*)(commandQueue->base_address))[index & queueMask] = aql;
-    hsa_queue_store_write_index_relaxed(commandQueue, nextIndex);
+    uint64_t index = reserveAQLPacketSlot(commandQueue);
+    writeAQLPacket(commandQueue, index, aql);
   
+    // Ring door bell, unless the packet is part of a batch
+    // in which case the doorbell is rung once when the batch is closed
+    if (batchBarrier == nullptr) {
 #if KALMAR_DEBUG
-    std::cerr << "ring door bell to dispatch kernel\n";
+        std::cerr << "ring door bell to dispatch kernel\n";
 #endif
-  
-    // Ring door bell
-    hsa_signal_store_relaxed(commandQueue->doorbell_signal, index);
+        hsa_signal_store_relaxed(commandQueue->doorbell_signal, index);
+    }
   
     isDispatched = true;
+    traceTrack = commandQueue->id;
+    if (hsaQueue != nullptr) {
+        Kalmar::KalmarQueueCounters::add(hsaQueue->getCounters().dispatches);
+    }
 
-    clock_gettime(CLOCK_REALTIME, &end);
+    if (__builtin_expect(callbacks != nullptr, 0) && callbacks->dispatchEnd) {
+        callbacks->dispatchEnd(&record, callbacks->dispatchData);
+    }
 
-#if KALMAR_DISPATCH_TIME_PRINTOUT
-    std::cerr << std::setprecision(6) << ((float)(end.tv_sec - begin.tv_sec) * 1000 * 1000 + (float)(end.tv_nsec - begin.tv_nsec) / 1000) << "\n";
-#endif
+    if (timed) {
+        hsaQueue->getCounters().addDispatchLatency(std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - begin).count());
+    }
 
     return status;
 }
@@ -2553,7 +6753,7 @@ HSADispatch::waitComplete() {
 #endif
 
     // wait for completion
-    if (hsa_signal_wait_acquire(signal, HSA_SIGNAL_CONDITION_LT, 1, uint64_t(-1), waitMode)!=0) {
+    if (Kalmar::ctx.waitSignal(signal, waitMode) != 0) {
         printf("Signal wait returned unexpected value\n");
         exit(0);
     }
@@ -2562,15 +6762,29 @@ HSADispatch::waitComplete() {
     std::cerr << "complete!\n";
 #endif
 
-    if (kernargMemory != nullptr) {
-      device->releaseKernargBuffer(kernargMemory, kernargMemoryIndex);
-      kernargMemory = nullptr;
+    // time the candidate workgroup shape tried, and trace the execution of
+    // the kernel
+    if (profiled) {
+        hsaQueue->releaseProfiling();
+        hsa_amd_profiling_dispatch_time_t time;
+        if (hsa_amd_profiling_get_dispatch_time(agent, signal, &time) == HSA_STATUS_SUCCESS &&
+            time.end > time.start) {
+            if (autotuneCandidate >= 0) {
+                double items = (double)global_size[0] * global_size[1] * global_size[2];
+                double ns = (double)(time.end - time.start) * 1e9 / getTimestampFrequency();
+                device->getWorkgroupTuner().record(autotuneClass, autotuneCandidate, ns / items);
+            }
+            tracer.recordDevice(kernel->name.c_str(), "kernel", traceTrack, time.start, time.end);
+            if (kernelProfile.enabled()) {
+                kernelProfile.record(kernel->name, (uint64_t)((time.end - time.start) * 1e9 / getTimestampFrequency()),
+                                     aql.workgroup_size_x, aql.workgroup_size_y, aql.workgroup_size_z);
+            }
+        }
+        autotuneCandidate = -1;
     }
 
-    // unregister this async operation from HSAQueue
-    if (this->hsaQueue != nullptr) {
-        this->hsaQueue->removeAsyncOp(this);
-    }
+    releaseKernargMemory();
+    dependentAsyncOps.clear();
 
     isDispatched = false;
     return status;
@@ -2586,8 +6800,10 @@ HSADispatch::dispatchKernelWaitComplete(Kalmar::HSAQueue* hsaQueue) {
 
     // record HSAQueue association
     this->hsaQueue = hsaQueue;
-    // extract hsa_queue_t from HSAQueue
-    hsa_queue_t* queue = static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
+    waitMode = hsaQueue->get_wait_mode();
+    // extract hsa_queue_t from HSAQueue, unless one is chosen already
+    hsa_queue_t* queue = (commandQueue != nullptr) ? commandQueue :
+                         static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
 
     // dispatch kernel
     status = dispatchKernel(queue);
@@ -2600,48 +6816,58 @@ HSADispatch::dispatchKernelWaitComplete(Kalmar::HSAQueue* hsaQueue) {
     return status;
 } 
 
+inline void
+HSADispatch::releaseKernargMemory() {
+    if (kernargMemory != nullptr) {
+      if (kernargRing != nullptr) {
+        kernargRing->release(kernargRingOffset);
+        kernargRing = nullptr;
+      } else {
+        device->releaseKernargBuffer(kernargMemory, kernargMemoryIndex);
+      }
+      kernargMemory = nullptr;
+    }
+}
+
 inline hsa_status_t
 HSADispatch::dispatchKernelAsync(Kalmar::HSAQueue* hsaQueue) {
     hsa_status_t status = HSA_STATUS_SUCCESS;
 
     // record HSAQueue association
     this->hsaQueue = hsaQueue;
-    // extract hsa_queue_t from HSAQueue
-    hsa_queue_t* queue = static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
+    waitMode = hsaQueue->get_wait_mode();
+    // extract hsa_queue_t from HSAQueue, unless one is chosen already
+    hsa_queue_t* queue = (commandQueue != nullptr) ? commandQueue :
+                         static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
 
     // dispatch kernel
     status = dispatchKernel(queue);
     STATUS_CHECK_Q(status, queue, __LINE__);
 
-    // dynamically allocate a std::shared_future<void> object
-    future = new std::shared_future<void>(std::async(std::launch::deferred, [&] {
-        waitComplete();
-    }).share());
-
     return status;
 }
 
 inline void
 HSADispatch::dispose() {
     hsa_status_t status;
-    if (kernargMemory != nullptr) {
-      device->releaseKernargBuffer(kernargMemory, kernargMemoryIndex);
-      kernargMemory = nullptr;
-    }
+    releaseKernargMemory();
+    dependentAsyncOps.clear();
 
     clearArgs();
     std::vector<uint8_t>().swap(arg_vec);
 
-    Kalmar::ctx.releaseSignal(signal, signalIndex);
-
-    if (future != nullptr) {
-      delete future;
-      future = nullptr;
+    // signal of a batched dispatch is owned by the batch barrier
+    if (batchBarrier == nullptr) {
+        Kalmar::ctx.releaseSignal(signal, signalIndex);
     }
+    batchBarrier = nullptr;
 }
 
 inline uint64_t
 HSADispatch::getBeginTimestamp() override {
+    if (!profiled) {
+        return 0L;
+    }
     Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
     hsa_amd_profiling_dispatch_time_t time;
     hsa_amd_profiling_get_dispatch_time(device->getAgent(), signal, &time);
@@ -2650,6 +6876,9 @@ HSADispatch::getBeginTimestamp() override {
 
 inline uint64_t
 HSADispatch::getEndTimestamp() override {
+    if (!profiled) {
+        return 0L;
+    }
     Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
     hsa_amd_profiling_dispatch_time_t time;
     hsa_amd_profiling_get_dispatch_time(device->getAgent(), signal, &time);
@@ -2665,14 +6894,44 @@ HSADispatch::setLaunchAttributes(int dims, size_t *globalDims, size_t *localDims
     workgroup_size[0] = workgroup_size[1] = workgroup_size[2] = 1;
     global_size[0] = global_size[1] = global_size[2] = 1;
 
+    // the launch bounds of the kernel narrow the limits of the device; a tiled
+    // launch beyond them is rejected, since the kernel was compiled for them
+    uint16_t workgroup_max_dim[3];
+    memcpy(workgroup_max_dim, device->getWorkgroupMaxDim(), sizeof(workgroup_max_dim));
+    uint32_t workgroup_max_size = device->getWorkgroupMaxSize();
+    bool tiled = false;
+    for (int i = 0; i < dims; ++i) {
+        tiled |= (localDims[i] != 0);
+    }
+    if (kernel->hasLaunchBounds && kernel->launchBounds.maxWorkgroupDim[0]) {
+        const uint32_t* bound = kernel->launchBounds.maxWorkgroupDim;
+        for (int i = 0; i < dims; ++i) {
+            if (localDims[i] > bound[i]) {
+                return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+            }
+            workgroup_max_dim[i] = std::min<uint32_t>(workgroup_max_dim[i], bound[i]);
+        }
+        workgroup_max_size = std::min(workgroup_max_size, bound[0] * bound[1] * bound[2]);
+    }
+
     // for each workgroup dimension, make sure it does not exceed the maximum allowable limit
-    const uint16_t* workgroup_max_dim = device->getWorkgroupMaxDim();
     for (int i = 0; i < dims; ++i) {
         computeLaunchAttr(i, globalDims[i], localDims[i], workgroup_max_dim[i]);
     }
 
+    // let the autotuner choose the shape of kernels launched without one
+    HSAWorkgroupTuner& tuner = device->getWorkgroupTuner();
+    autotuneCandidate = -1;
+    if (tuner.isEnabled() && !tiled) {
+        autotuneClass = HSAWorkgroupTuner::classOf(kernel->name, dims, globalDims);
+        uint32_t shape[3];
+        if (tuner.choose(autotuneClass, dims, globalDims, workgroup_max_size, workgroup_max_dim,
+                         shape, autotuneCandidate)) {
+            memcpy(workgroup_size, shape, sizeof(workgroup_size));
+        }
+    }
+
     // reduce each dimension in case the overall workgroup limit is exceeded
-    uint32_t workgroup_max_size = device->getWorkgroupMaxSize();
     int dim_iterator = 2;
     size_t workgroup_total_size = workgroup_size[0] * workgroup_size[1] * workgroup_size[2];
     while(workgroup_total_size > workgroup_max_size) {
@@ -2707,101 +6966,166 @@ HSABarrier::waitComplete() {
 #endif
 
     // Wait on completion signal until the barrier is finished
-    hsa_signal_wait_acquire(signal, HSA_SIGNAL_CONDITION_EQ, 0, UINT64_MAX, waitMode);
+    Kalmar::ctx.waitSignal(signal, waitMode);
 
 #if KALMAR_DEBUG
     std::cerr << "complete!\n";
 #endif
 
-    // unregister this async operation from HSAQueue
-    if (this->hsaQueue != nullptr) {
-        this->hsaQueue->removeAsyncOp(this);
+    if (profiled) {
+        hsaQueue->releaseProfiling();
+        if (tracer.enabled()) {
+            Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
+            hsa_amd_profiling_dispatch_time_t time;
+            if (hsa_amd_profiling_get_dispatch_time(device->getAgent(), signal, &time) == HSA_STATUS_SUCCESS) {
+                tracer.recordDevice("barrier", "barrier", traceTrack, time.start, time.end);
+            }
+        }
     }
 
+    releaseKernargs();
+    dependentAsyncOps.clear();
+
     isDispatched = false;
 
     return status;
 }
 
+inline void*
+HSABarrier::allocKernarg(Kalmar::HSAQueue* hsaQueue, size_t size) {
+    Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
+    if (size == 0 || !(device->hasHSAKernargRegion() && USE_KERNARG_REGION)) {
+        return nullptr;
+    }
+
+    HSAKernargAllocation alloc;
+    alloc.memory = nullptr;
+    alloc.poolIndex = -1;
+    alloc.ring = nullptr;
+    alloc.ringOffset = 0;
+
+    // signals created beyond the signal pool can't be tracked by the ring
+    hsa_signal_t completionSignal = getSignal();
+    if (signalIndex >= 0) {
+        alloc.memory = hsaQueue->getKernargRing()->allocate(size, completionSignal, &alloc.ringOffset);
+    }
+    if (alloc.memory != nullptr) {
+        alloc.ring = hsaQueue->getKernargRing();
+    } else {
+        std::pair<void*, int> ret = device->getKernargBuffer(size);
+        alloc.memory = ret.first;
+        alloc.poolIndex = ret.second;
+    }
+    kernargs.push_back(alloc);
+    return alloc.memory;
+}
+
+inline void
+HSABarrier::releaseKernargs() {
+    if (kernargs.empty()) {
+        return;
+    }
+    Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
+    for (auto& alloc : kernargs) {
+        if (alloc.ring != nullptr) {
+            alloc.ring->release(alloc.ringOffset);
+        } else {
+            device->releaseKernargBuffer(alloc.memory, alloc.poolIndex);
+        }
+    }
+    kernargs.clear();
+}
+
 inline hsa_status_t
-HSABarrier::enqueueAsync(Kalmar::HSAQueue* hsaQueue) {
+HSABarrier::enqueueAsync(Kalmar::HSAQueue* hsaQueue, hsa_queue_t* queue) {
     hsa_status_t status = HSA_STATUS_SUCCESS;
 
     // record HSAQueue association
     this->hsaQueue = hsaQueue;
+    waitMode = hsaQueue->get_wait_mode();
     // extract hsa_queue_t from HSAQueue
-    hsa_queue_t* queue = static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
+    if (queue == nullptr) {
+        queue = static_cast<hsa_queue_t*>(hsaQueue->getHSAQueue());
+    }
 
     // enqueue barrier packet
     status = enqueueBarrier(queue);
     STATUS_CHECK_Q(status, queue, __LINE__);
 
-    // dynamically allocate a std::shared_future<void> object
-    future = new std::shared_future<void>(std::async(std::launch::deferred, [&] {
-        waitComplete();
-    }).share());
-
     return status;
 }
 
 inline hsa_status_t
 HSABarrier::enqueueBarrier(hsa_queue_t* queue) {
     hsa_status_t status = HSA_STATUS_SUCCESS;
+    HSATraceScope trace("barrier", "barrier");
     if (isDispatched) {
         return HSA_STATUS_ERROR_INVALID_ARGUMENT;
     }
 
     // Create a signal to wait for the barrier to finish.
-    std::pair<hsa_signal_t, int> ret = Kalmar::ctx.getSignal();
-    signal = ret.first;
-    signalIndex = ret.second;
-
-    // Obtain the write index for the command queue
-    uint64_t index = hsa_queue_load_write_index_relaxed(queue);
-    const uint32_t queueMask = queue->size - 1;
-    uint64_t nextIndex = index + 1;
-    if (nextIndex - hsa_queue_load_read_index_acquire(queue) >= queue->size) {
-      checkHCCRuntimeStatus(Kalmar::HCCRuntimeStatus::HCCRT_STATUS_ERROR_COMMAND_QUEUE_OVERFLOW, __LINE__, queue);
-    }
+    getSignal();
 
-    // Define the barrier packet to be at the calculated queue index address
-    hsa_barrier_and_packet_t* barrier = &(((hsa_barrier_and_packet_t*)(queue->base_address))[index&queueMask]);
-    memset(barrier, 0, sizeof(hsa_barrier_and_packet_t));
+    // Prepare the barrier packet
+    hsa_barrier_and_packet_t barrier;
+    memset(&barrier, 0, sizeof(hsa_barrier_and_packet_t));
 
     // setup header
     uint16_t header = HSA_PACKET_TYPE_BARRIER_AND << HSA_PACKET_HEADER_TYPE;
     header |= 1 << HSA_PACKET_HEADER_BARRIER;
     header |= HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_ACQUIRE_FENCE_SCOPE;
     header |= HSA_FENCE_SCOPE_SYSTEM << HSA_PACKET_HEADER_RELEASE_FENCE_SCOPE;
-    barrier->header = header;
+    barrier.header = header;
 
-    barrier->completion_signal = signal;
+    barrier.completion_signal = signal;
+
+    profiled = (hsaQueue != nullptr) && hsaQueue->acquireProfiling(false, false);
+
+    // Reserve a slot on the command queue and write the packet into it
+    uint64_t index = reserveAQLPacketSlot(queue);
+    writeAQLPacket(queue, index, barrier);
 
 #if KALMAR_DEBUG
     std::cerr << "ring door bell to dispatch barrier\n";
 #endif
 
-    // Increment write index and ring doorbell to dispatch the kernel
-    hsa_queue_store_write_index_relaxed(queue, nextIndex);
+    // Ring doorbell to dispatch the barrier
     hsa_signal_store_relaxed(queue->doorbell_signal, index);
 
     isDispatched = true;
+    traceTrack = queue->id;
 
     return status;
 }
 
+inline hsa_signal_t
+HSABarrier::getSignal() {
+    if (!hasSignal) {
+        std::pair<hsa_signal_t, int> ret =
+            Kalmar::ctx.getSignal(hsaQueue ? &hsaQueue->getCounters().signalPoolMisses : nullptr);
+        signal = ret.first;
+        signalIndex = ret.second;
+        hasSignal = true;
+    }
+    return signal;
+}
+
 inline void
 HSABarrier::dispose() {
-    Kalmar::ctx.releaseSignal(signal, signalIndex);
+    releaseKernargs();
+    dependentAsyncOps.clear();
 
-    if (future != nullptr) {
-      delete future;
-      future = nullptr;
+    if (hasSignal) {
+        Kalmar::ctx.releaseSignal(signal, signalIndex);
+        hasSignal = false;
     }
 }
 
 inline uint64_t
 HSABarrier::getBeginTimestamp() override {
+    if (!profiled) {
+        return 0L;
+    }
     Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
     hsa_amd_profiling_dispatch_time_t time;
     hsa_amd_profiling_get_dispatch_time(device->getAgent(), signal, &time);
@@ -2810,12 +7134,173 @@ HSABarrier::getBeginTimestamp() override {
 
 inline uint64_t
 HSABarrier::getEndTimestamp() override {
+    if (!profiled) {
+        return 0L;
+    }
     Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
     hsa_amd_profiling_dispatch_time_t time;
     hsa_amd_profiling_get_dispatch_time(device->getAgent(), signal, &time);
     return time.end;
 }
 
+// ----------------------------------------------------------------------
+// member function implementation of HSACopy
+// ----------------------------------------------------------------------
+
+inline hsa_status_t
+HSACopy::enqueueAsync(Kalmar::HSAQueue* hsaQueue, const void* src, void* dst, size_t count, Kalmar::hcMemcpyKind kind,
+                      std::vector< std::shared_ptr<Kalmar::KalmarAsyncOp> >&& asyncOps) {
+    HSATraceScope trace("copy", "copy", count);
+    HSACopyCallbackScope callbacks(hsaQueue->getDev()->get_ordinal(), src, dst, count, kind, true);
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+    if (isDispatched) {
+        return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+    // record HSAQueue association
+    this->hsaQueue = hsaQueue;
+    waitMode = hsaQueue->get_wait_mode();
+    copySize = count;
+
+    Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
+    hsa_agent_t agent = device->getAgent();
+    hsa_agent_t srcAgent = agent;
+    hsa_agent_t dstAgent = agent;
+
+    // host memory has to be locked to be reached by the DMA engine
+    void* hostPtr = nullptr;
+    if (kind == Kalmar::hcMemcpyHostToDevice) {
+        hostPtr = const_cast<void*>(src);
+        srcAgent = device->getHostAgent();
+    } else if (kind == Kalmar::hcMemcpyDeviceToHost) {
+        hostPtr = dst;
+        dstAgent = device->getHostAgent();
+    }
+    if (hostPtr != nullptr) {
+        // ranges locked by the pinned cache are released to it afterwards
+        void* va = device->getPinnedCache().acquire(hostPtr, count);
+        cachedHostPtr = (va != nullptr);
+        if (!cachedHostPtr) {
+            status = hsa_amd_memory_lock(hostPtr, count, &agent, 1, &va);
+        }
+        if (cachedHostPtr || (va != nullptr && status == HSA_STATUS_SUCCESS)) {
+            lockedHostPtr = hostPtr;
+        } else {
+            // host memory not allocated by the OS allocator can't be locked,
+            // but could be made accessible as is
+            status = hsa_amd_agents_allow_access(1, &agent, NULL, hostPtr);
+            if (status != HSA_STATUS_SUCCESS) {
+                return status;
+            }
+            va = hostPtr;
+        }
+        if (kind == Kalmar::hcMemcpyHostToDevice) {
+            src = va;
+        } else {
+            dst = va;
+        }
+    }
+
+    // Create a signal to wait for the copy to finish.
+    std::pair<hsa_signal_t, int> ret = Kalmar::ctx.getSignal(&hsaQueue->getCounters().signalPoolMisses);
+    signal = ret.first;
+    signalIndex = ret.second;
+    hasSignal = true;
+    callbacks.setSignal(signal);
+
+    std::vector<hsa_signal_t> depSignals;
+    for (auto& asyncOp : asyncOps) {
+        depSignals.push_back(*static_cast<hsa_signal_t*>(asyncOp->getNativeHandle()));
+    }
+
+    status = hsa_amd_memory_async_copy(dst, dstAgent, src, srcAgent, count,
+                                       depSignals.size(), depSignals.empty() ? NULL : depSignals.data(),
+                                       signal);
+    if (status != HSA_STATUS_SUCCESS) {
+        return status;
+    }
+
+    dependentAsyncOps = std::move(asyncOps);
+    isDispatched = true;
+    hsaQueue->getCounters().addCopy(kind, count);
+
+    return status;
+}
+
+inline hsa_status_t
+HSACopy::waitComplete() {
+    hsa_status_t status = HSA_STATUS_SUCCESS;
+    if (!isDispatched)  {
+        return HSA_STATUS_ERROR_INVALID_ARGUMENT;
+    }
+
+#if KALMAR_DEBUG
+    std::cerr << "wait for copy completion with wait flag: " << waitMode << "\n";
+#endif
+
+    // Wait on completion signal until the copy is finished
+    Kalmar::ctx.waitSignal(signal, waitMode);
+
+    if (tracer.enabled()) {
+        hsa_amd_profiling_async_copy_time_t time;
+        if (hsa_amd_profiling_get_async_copy_time(signal, &time) == HSA_STATUS_SUCCESS) {
+            tracer.recordDevice("copy", "copy", HSATracer::copyTrack, time.start, time.end, copySize);
+        }
+    }
+
+    unlockHostPtr();
+    heldHostBuffer.reset();
+    dependentAsyncOps.clear();
+
+    isDispatched = false;
+
+    return status;
+}
+
+inline void
+HSACopy::unlockHostPtr() {
+    if (lockedHostPtr != nullptr) {
+        if (cachedHostPtr) {
+            Kalmar::HSADevice* device = static_cast<Kalmar::HSADevice*>(hsaQueue->getDev());
+            device->getPinnedCache().release(lockedHostPtr);
+        } else {
+            hsa_amd_memory_unlock(lockedHostPtr);
+        }
+        lockedHostPtr = nullptr;
+        cachedHostPtr = false;
+    }
+}
+
+inline uint64_t
+HSACopy::getBeginTimestamp() {
+    hsa_amd_profiling_async_copy_time_t time;
+    if (hsa_amd_profiling_get_async_copy_time(signal, &time) != HSA_STATUS_SUCCESS) {
+        return 0L;
+    }
+    return time.start;
+}
+
+inline uint64_t
+HSACopy::getEndTimestamp() {
+    hsa_amd_profiling_async_copy_time_t time;
+    if (hsa_amd_profiling_get_async_copy_time(signal, &time) != HSA_STATUS_SUCCESS) {
+        return 0L;
+    }
+    return time.end;
+}
+
+inline void
+HSACopy::dispose() {
+    unlockHostPtr();
+    heldHostBuffer.reset();
+    dependentAsyncOps.clear();
+
+    if (hasSignal) {
+        Kalmar::ctx.releaseSignal(signal, signalIndex);
+        hasSignal = false;
+    }
+}
+
 // ----------------------------------------------------------------------
 // extern "C" functions
 // ----------------------------------------------------------------------
@@ -2852,3 +7337,9 @@ extern "C" void PushArgPtrImpl(void *ker, int idx, size_t sz, const void *v) {
   void *val = const_cast<void*>(v);
   dispatch->pushPointerArg(val);
 }
+
+extern "C" void PushArgsImpl(void *ker, size_t sz, const void *v) {
+  HSADispatch *dispatch =
+      reinterpret_cast<HSADispatch*>(ker);
+  dispatch->pushArgs(static_cast<const uint8_t*>(v), sz);
+}
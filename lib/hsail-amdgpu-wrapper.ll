@@ -246,6 +246,24 @@ define linkonce_odr spir_func float @__hsail_nsqrt_f32(float) #2 {
 ; Function Attrs: nounwind readnone
 declare float @llvm.sqrt.f32(float) #1
 
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func float @__hsail_nexp2_f32(float) #2 {
+  %2 = call float @llvm.exp2.f32(float %0)
+  ret float %2
+}
+
+; Function Attrs: nounwind readnone
+declare float @llvm.exp2.f32(float) #1
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func float @__hsail_nlog2_f32(float) #2 {
+  %2 = call float @llvm.log2.f32(float %0)
+  ret float %2
+}
+
+; Function Attrs: nounwind readnone
+declare float @llvm.log2.f32(float) #1
+
 ; Function Attrs: alwaysinline nounwind
 define linkonce_odr spir_func float @__hsail_round_f32(float) #5 {
   %2 = call float @llvm.round.f32(float %0)
@@ -750,6 +768,96 @@ define linkonce_odr spir_func i8 addrspace(3)* @get_dynamic_group_segment_base_p
   ret i8 addrspace(3)* %4
 }
 
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_pk_add_f16(i32 %a, i32 %b) #2 {
+  %va = bitcast i32 %a to <2 x half>
+  %vb = bitcast i32 %b to <2 x half>
+  %r = fadd <2 x half> %va, %vb
+  %ret = bitcast <2 x half> %r to i32
+  ret i32 %ret
+}
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_pk_sub_f16(i32 %a, i32 %b) #2 {
+  %va = bitcast i32 %a to <2 x half>
+  %vb = bitcast i32 %b to <2 x half>
+  %r = fsub <2 x half> %va, %vb
+  %ret = bitcast <2 x half> %r to i32
+  ret i32 %ret
+}
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_pk_mul_f16(i32 %a, i32 %b) #2 {
+  %va = bitcast i32 %a to <2 x half>
+  %vb = bitcast i32 %b to <2 x half>
+  %r = fmul <2 x half> %va, %vb
+  %ret = bitcast <2 x half> %r to i32
+  ret i32 %ret
+}
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_pk_fma_f16(i32 %a, i32 %b, i32 %c) #2 {
+  %va = bitcast i32 %a to <2 x half>
+  %vb = bitcast i32 %b to <2 x half>
+  %vc = bitcast i32 %c to <2 x half>
+  %r = call <2 x half> @llvm.fma.v2f16(<2 x half> %va, <2 x half> %vb, <2 x half> %vc)
+  %ret = bitcast <2 x half> %r to i32
+  ret i32 %ret
+}
+
+; Function Attrs: nounwind readnone
+declare <2 x half> @llvm.fma.v2f16(<2 x half>, <2 x half>, <2 x half>) #1
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_pk_min_f16(i32 %a, i32 %b) #2 {
+  %va = bitcast i32 %a to <2 x half>
+  %vb = bitcast i32 %b to <2 x half>
+  %r = call <2 x half> @llvm.minnum.v2f16(<2 x half> %va, <2 x half> %vb)
+  %ret = bitcast <2 x half> %r to i32
+  ret i32 %ret
+}
+
+; Function Attrs: nounwind readnone
+declare <2 x half> @llvm.minnum.v2f16(<2 x half>, <2 x half>) #1
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_pk_max_f16(i32 %a, i32 %b) #2 {
+  %va = bitcast i32 %a to <2 x half>
+  %vb = bitcast i32 %b to <2 x half>
+  %r = call <2 x half> @llvm.maxnum.v2f16(<2 x half> %va, <2 x half> %vb)
+  %ret = bitcast <2 x half> %r to i32
+  ret i32 %ret
+}
+
+; Function Attrs: nounwind readnone
+declare <2 x half> @llvm.maxnum.v2f16(<2 x half>, <2 x half>) #1
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func i32 @__hc_cvt_pk_f16_f32(float %lo, float %hi) #2 {
+  %l = fptrunc float %lo to half
+  %h = fptrunc float %hi to half
+  %v0 = insertelement <2 x half> undef, half %l, i32 0
+  %v1 = insertelement <2 x half> %v0, half %h, i32 1
+  %ret = bitcast <2 x half> %v1 to i32
+  ret i32 %ret
+}
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func float @__hc_cvt_f32_f16_lo(i32 %v) #2 {
+  %vv = bitcast i32 %v to <2 x half>
+  %h = extractelement <2 x half> %vv, i32 0
+  %ret = fpext half %h to float
+  ret float %ret
+}
+
+; Function Attrs: alwaysinline nounwind readnone
+define linkonce_odr spir_func float @__hc_cvt_f32_f16_hi(i32 %v) #2 {
+  %vv = bitcast i32 %v to <2 x half>
+  %h = extractelement <2 x half> %vv, i32 1
+  %ret = fpext half %h to float
+  ret float %ret
+}
+
 ; Function Attrs: alwaysinline nounwind readonly
 declare i32 @llvm.amdgcn.s.getreg(i32) #0
 
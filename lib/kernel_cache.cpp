@@ -0,0 +1,180 @@
+//===----------------------------------------------------------------------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+#include "kernel_cache.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <md5.h>
+
+namespace Kalmar {
+
+// suffix of the files of the cache, only these are ever evicted
+static const char* const kCacheSuffix = ".kc";
+
+void KernelCache::Blob::reset() {
+    if (map != nullptr)
+        munmap(map, mapSize);
+    map = nullptr;
+    mapSize = 0;
+    offset = 0;
+}
+
+KernelCache& KernelCache::get() {
+    static KernelCache cache;
+    return cache;
+}
+
+KernelCache::KernelCache() : dir(), limit(KERNEL_CACHE_LIMIT) {
+    const char* cache_env = getenv("HCC_KERNEL_CACHE");
+    bool cache = (cache_env != nullptr) ? (atoi(cache_env) != 0) : KERNEL_CACHE;
+    if (!cache)
+        return;
+
+    const char* dir_env = getenv("HCC_KERNEL_CACHE_DIR");
+    const char* xdg_env = getenv("XDG_CACHE_HOME");
+    const char* home_env = getenv("HOME");
+    if (dir_env != nullptr && dir_env[0] != '\0')
+        dir = dir_env;
+    else if (xdg_env != nullptr && xdg_env[0] != '\0')
+        dir = std::string(xdg_env) + "/hcc";
+    else if (home_env != nullptr && home_env[0] != '\0')
+        dir = std::string(home_env) + "/.cache/hcc";
+
+    const char* limit_env = getenv("HCC_KERNEL_CACHE_LIMIT");
+    if (limit_env != nullptr && atoi(limit_env) > 0)
+        limit = (size_t)atoi(limit_env) * 1024 * 1024;
+}
+
+std::string KernelCache::path(const std::string& prefix, const std::string& key) const {
+    unsigned char hash[16];
+    MD5_CTX md5ctx;
+    MD5_Init(&md5ctx);
+    MD5_Update(&md5ctx, key.data(), key.size());
+    MD5_Final(hash, &md5ctx);
+
+    std::stringstream name;
+    name << dir << "/" << prefix << "-" << std::setbase(16) << std::setfill('0');
+    for (int i = 0; i < 16; ++i)
+        name << std::setw(2) << static_cast<unsigned int>(hash[i]);
+    name << kCacheSuffix;
+    return name.str();
+}
+
+bool KernelCache::load(const std::string& prefix, const std::string& key, Blob& blob) {
+    blob.reset();
+    if (!enabled())
+        return false;
+
+    std::string file = path(prefix, key);
+    int fd = open(file.c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size <= key.size()) {
+        close(fd);
+        return false;
+    }
+    void* map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED)
+        return false;
+    if (memcmp(map, key.data(), key.size()) != 0) {
+        munmap(map, st.st_size);
+        return false;
+    }
+    blob.map = map;
+    blob.mapSize = st.st_size;
+    blob.offset = key.size();
+
+    // the modification time orders the files for eviction
+    utimensat(AT_FDCWD, file.c_str(), nullptr, 0);
+    return true;
+}
+
+void KernelCache::store(const std::string& prefix, const std::string& key, const void* data, size_t size) {
+    if (!enabled())
+        return;
+
+    // create the directories of the cache
+    for (size_t pos = dir.find('/', 1); ; pos = dir.find('/', pos + 1)) {
+        mkdir(dir.substr(0, pos).c_str(), 0755);
+        if (pos == std::string::npos)
+            break;
+    }
+
+    // other processes either see the whole file or none
+    std::string file = path(prefix, key);
+    std::string tmp = file + "." + std::to_string(getpid()) + ".tmp";
+    FILE* out = fopen(tmp.c_str(), "wb");
+    if (out == nullptr)
+        return;
+    bool ok = fwrite(key.data(), 1, key.size(), out) == key.size() &&
+              fwrite(data, 1, size, out) == size;
+    ok = (fclose(out) == 0) && ok;
+    if (!ok || rename(tmp.c_str(), file.c_str()) != 0) {
+        unlink(tmp.c_str());
+        return;
+    }
+    evict();
+}
+
+void KernelCache::evict() {
+    DIR* d = opendir(dir.c_str());
+    if (d == nullptr)
+        return;
+
+    struct entry {
+        std::string path;
+        size_t size;
+        struct timespec mtime;
+    };
+    std::vector<entry> entries;
+    size_t total = 0;
+    size_t suffix = strlen(kCacheSuffix);
+    while (struct dirent* de = readdir(d)) {
+        size_t len = strlen(de->d_name);
+        if (len <= suffix || strcmp(de->d_name + len - suffix, kCacheSuffix) != 0)
+            continue;
+        std::string file = dir + "/" + de->d_name;
+        struct stat st;
+        if (stat(file.c_str(), &st) != 0 || !S_ISREG(st.st_mode))
+            continue;
+        entries.push_back({file, (size_t)st.st_size, st.st_mtim});
+        total += st.st_size;
+    }
+    closedir(d);
+    if (total <= limit)
+        return;
+
+    // least recently used first
+    std::sort(entries.begin(), entries.end(), [](const entry& a, const entry& b) {
+        return a.mtime.tv_sec != b.mtime.tv_sec ? a.mtime.tv_sec < b.mtime.tv_sec
+                                                : a.mtime.tv_nsec < b.mtime.tv_nsec;
+    });
+    for (const entry& e : entries) {
+        if (total <= limit)
+            break;
+        // a file another process removed first is fine
+        unlink(e.path.c_str());
+        total -= e.size;
+    }
+}
+
+} // namespace Kalmar
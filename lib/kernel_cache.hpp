@@ -0,0 +1,91 @@
+//===----------------------------------------------------------------------===//
+//
+// This file is distributed under the University of Illinois Open Source
+// License. See LICENSE.TXT for details.
+//
+//===----------------------------------------------------------------------===//
+
+// Cache of compiled kernels on disk, shared by the runtimes
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+// whether compiled kernels are kept in a cache on disk and loaded from it on
+// later runs instead of being compiled again
+// environment variable HCC_KERNEL_CACHE=0 may be used to disable it, and
+// HCC_KERNEL_CACHE_DIR to choose its directory, which is $XDG_CACHE_HOME/hcc
+// or $HOME/.cache/hcc by default
+#ifndef KERNEL_CACHE
+#define KERNEL_CACHE (1)
+#endif
+
+// maximum number of bytes of the files in the cache directory, the least
+// recently used ones are removed once a new file makes them exceed it
+// environment variable HCC_KERNEL_CACHE_LIMIT overrides it, in MB
+// default set as 512MB
+#define KERNEL_CACHE_LIMIT (512 * 1024 * 1024)
+
+namespace Kalmar {
+
+/// A directory of compiled kernels, each in a file named by a hash of its
+/// key. The key describes everything the compiled kernel depends on: the
+/// kernel itself, the target, the compiler or driver version and the build
+/// options. It's stored at the head of the file and checked on load, so
+/// hash collisions and files of other versions are never used.
+///
+/// Files are written to a temporary file renamed into place, so concurrent
+/// processes either see the whole file or none, and are mapped when loaded.
+/// Loading a file marks it used, the least recently used files are removed
+/// once the cache is over its size limit.
+class KernelCache
+{
+public:
+    /// contents of a file of the cache past its key, mapped in memory until
+    /// the blob is destroyed
+    class Blob
+    {
+        void* map;
+        size_t mapSize;
+        size_t offset;
+    public:
+        Blob() : map(nullptr), mapSize(0), offset(0) {}
+        ~Blob() { reset(); }
+        Blob(const Blob&) = delete;
+        Blob& operator=(const Blob&) = delete;
+
+        const char* data() const { return static_cast<const char*>(map) + offset; }
+        size_t size() const { return mapSize - offset; }
+        bool empty() const { return map == nullptr; }
+        void reset();
+
+        friend class KernelCache;
+    };
+
+    /// the cache of the process, configured by the environment on first use
+    static KernelCache& get();
+
+    bool enabled() const { return !dir.empty(); }
+
+    /// load the file of key, whose name starts with prefix
+    /// returns false if the cache is disabled, or has no file of key
+    bool load(const std::string& prefix, const std::string& key, Blob& blob);
+
+    /// store size bytes of data as the file of key, whose name starts with
+    /// prefix, failures only mean the kernel is compiled again next time
+    void store(const std::string& prefix, const std::string& key, const void* data, size_t size);
+
+private:
+    KernelCache();
+
+    std::string path(const std::string& prefix, const std::string& key) const;
+
+    /// remove the least recently used files while the cache exceeds limit
+    void evict();
+
+    std::string dir;
+    size_t limit;
+};
+
+} // namespace Kalmar
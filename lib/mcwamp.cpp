@@ -5,10 +5,22 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <sstream>
 #include <tuple>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <future>
+#include <thread>
 
 #include <amp.h>
 #include <mutex>
@@ -16,6 +28,16 @@
 #include "mcwamp_impl.hpp"
 
 #include <dlfcn.h>
+#include <pthread.h>
+#include <sched.h>
+#include <strings.h>
+#include <unistd.h>
+
+/// number of chunks each thread of the CPU task pool is given by a launch,
+/// threads done with their own chunks steal the chunks of the others
+#ifndef CPU_TASK_CHUNKS_PER_THREAD
+#define CPU_TASK_CHUNKS_PER_THREAD (8)
+#endif
 
 namespace Concurrency {
 
@@ -44,6 +66,10 @@ extern "C" char * hsa_kernel_end[] asm ("_binary_kernel_brig_end") __attribute__
 extern "C" char * hsa_offline_finalized_kernel_source[] asm ("_binary_kernel_isa_start") __attribute__((weak));
 extern "C" char * hsa_offline_finalized_kernel_end[] asm ("_binary_kernel_isa_end") __attribute__((weak));
 
+// properties of the HSA kernels, written by the tile uniform check
+extern "C" char * kernel_props_source[] asm ("_binary_kernel_props_start") __attribute__((weak));
+extern "C" char * kernel_props_end[] asm ("_binary_kernel_props_end") __attribute__((weak));
+
 // interface of C++AMP runtime implementation
 struct RuntimeImpl {
   RuntimeImpl(const char* libraryName) :
@@ -51,6 +77,7 @@ struct RuntimeImpl {
     m_RuntimeHandle(nullptr),
     m_PushArgImpl(nullptr),
     m_PushArgPtrImpl(nullptr),
+    m_PushArgsImpl(nullptr),
     m_GetContextImpl(nullptr),
     isCPU(false) {
     //std::cout << "dlopen(" << libraryName << ")\n";
@@ -72,6 +99,8 @@ struct RuntimeImpl {
   void LoadSymbols() {
     m_PushArgImpl = (PushArgImpl_t) dlsym(m_RuntimeHandle, "PushArgImpl");
     m_PushArgPtrImpl = (PushArgPtrImpl_t) dlsym(m_RuntimeHandle, "PushArgPtrImpl");
+    // optional, runtimes without it are given each argument by index
+    m_PushArgsImpl = (PushArgsImpl_t) dlsym(m_RuntimeHandle, "PushArgsImpl");
     m_GetContextImpl= (GetContextImpl_t) dlsym(m_RuntimeHandle, "GetContextImpl");
   }
 
@@ -82,6 +111,7 @@ struct RuntimeImpl {
   void* m_RuntimeHandle;
   PushArgImpl_t m_PushArgImpl;
   PushArgPtrImpl_t m_PushArgPtrImpl;
+  PushArgsImpl_t m_PushArgsImpl;
   GetContextImpl_t m_GetContextImpl;
   bool isCPU;
 };
@@ -94,6 +124,9 @@ namespace CLAMP {
 ////////////////////////////////////////////////////////////
 /**
  * \brief Base class of platform detection
+ *
+ * The platform is probed once, by the first thread to ask, and the result is
+ * kept for later ones
  */
 class PlatformDetect {
 public:
@@ -102,12 +135,24 @@ public:
                  void* const kernel_source)
     : m_name(name),
       m_ampRuntimeLibrary(ampRuntimeLibrary),
-      m_kernel_source(kernel_source) {}
+      m_kernel_source(kernel_source),
+      m_probed(),
+      m_available(false) {}
+
+  // check if kernels of the platform are linked into the process, which
+  // needs no runtime to be loaded
+  bool hasKernels() const { return m_kernel_source != nullptr; }
+
+  bool detect() {
+    std::call_once(m_probed, [this] { m_available = probe(); });
+    return m_available;
+  }
 
-  virtual bool detect() {
+private:
+  bool probe() {
     //std::cout << "Detecting " << m_name << "...";
     // detect if kernel is available
-    if (!m_kernel_source) {
+    if (!hasKernels()) {
       //std::cout << " kernel not found" << std::endl;
       return false;
     }
@@ -131,18 +176,26 @@ public:
     return true;
   }
 
-private:
   std::string m_ampRuntimeLibrary;
   std::string m_name;
   void* m_kernel_source;
+  std::once_flag m_probed;
+  bool m_available;
 };
 
 class OpenCLPlatformDetect : public PlatformDetect {
 public:
     OpenCLPlatformDetect()
-      : PlatformDetect("OpenCL", "libmcwamp_opencl.so",  cl_kernel_source) {}
+      : PlatformDetect("OpenCL", "libmcwamp_opencl.so",  cl_kernel_source),
+        m_spirProbed(), m_hasSPIR(false) {}
 
   bool hasSPIR() {
+    std::call_once(m_spirProbed, [this] { m_hasSPIR = probeSPIR(); });
+    return m_hasSPIR;
+  }
+
+private:
+  static bool probeSPIR() {
     void* ocl_version_test_handle = nullptr;
     typedef int (*spir_test_t) ();
     spir_test_t test_func = nullptr;
@@ -163,6 +216,9 @@ public:
       dlclose(ocl_version_test_handle);
     return result;
   }
+
+  std::once_flag m_spirProbed;
+  bool m_hasSPIR;
 };
 
 /**
@@ -173,136 +229,668 @@ public:
   HSAPlatformDetect() : PlatformDetect("HSA", "libmcwamp_hsa.so",  hsa_kernel_source) {}
 };
 
+// the platforms of the process, each probed at most once
+static HSAPlatformDetect& HSAPlatform() {
+  static HSAPlatformDetect platform;
+  return platform;
+}
+
+static OpenCLPlatformDetect& OpenCLPlatform() {
+  static OpenCLPlatformDetect platform;
+  return platform;
+}
+
 
 /**
  * \brief Flag to turn on/off platform-dependent runtime messages
  */
 static bool mcwamp_verbose = false;
 
-static RuntimeImpl* LoadOpenCLRuntime() {
+// load a C++AMP runtime, which exits the process if it's required and can't
+// be loaded, otherwise nullptr is returned
+static RuntimeImpl* LoadRuntime(const char* name, const char* libraryName, bool required = true) {
   RuntimeImpl* runtimeImpl = nullptr;
-  // load OpenCL C++AMP runtime
   if (mcwamp_verbose)
-    std::cout << "Use OpenCL runtime" << std::endl;
-  runtimeImpl = new RuntimeImpl("libmcwamp_opencl.so");
+    std::cout << "Use " << name << " runtime" << std::endl;
+  runtimeImpl = new RuntimeImpl(libraryName);
   if (!runtimeImpl->m_RuntimeHandle) {
-    std::cerr << "Can't load OpenCL runtime!" << std::endl;
     delete runtimeImpl;
-    exit(-1);
-  } else {
-    //std::cout << "OpenCL C++AMP runtime loaded" << std::endl;
+    if (required) {
+      std::cerr << "Can't load " << name << " runtime!" << std::endl;
+      exit(-1);
+    }
+    return nullptr;
   }
   return runtimeImpl;
 }
 
-static RuntimeImpl* LoadHSARuntime() {
-  RuntimeImpl* runtimeImpl = nullptr;
+static RuntimeImpl* LoadOpenCLRuntime(bool required = true) {
+  // load OpenCL C++AMP runtime
+  return LoadRuntime("OpenCL", "libmcwamp_opencl.so", required);
+}
+
+static RuntimeImpl* LoadHSARuntime(bool required = true) {
   // load HSA C++AMP runtime
-  if (mcwamp_verbose)
-    std::cout << "Use HSA runtime" << std::endl;
-  runtimeImpl = new RuntimeImpl("libmcwamp_hsa.so");
-  if (!runtimeImpl->m_RuntimeHandle) {
-    std::cerr << "Can't load HSA runtime!" << std::endl;
-    delete runtimeImpl;
-    exit(-1);
-  } else {
-    //std::cout << "HSA C++AMP runtime loaded" << std::endl;
-  }
-  return runtimeImpl;
+  return LoadRuntime("HSA", "libmcwamp_hsa.so", required);
 }
 
-static RuntimeImpl* LoadCPURuntime() {
-  RuntimeImpl* runtimeImpl = nullptr;
+static RuntimeImpl* LoadCPURuntime(bool required = true) {
   // load CPU runtime
-  if (mcwamp_verbose)
-    std::cout << "Use CPU runtime" << std::endl;
-  runtimeImpl = new RuntimeImpl("libmcwamp_cpu.so");
-  if (!runtimeImpl->m_RuntimeHandle) {
-    std::cerr << "Can't load CPU runtime!" << std::endl;
-    delete runtimeImpl;
-    exit(-1);
-  }
+  RuntimeImpl* runtimeImpl = LoadRuntime("CPU", "libmcwamp_cpu.so", required);
+  if (runtimeImpl)
+    runtimeImpl->set_cpu();
   return runtimeImpl;
 }
 
-RuntimeImpl* GetOrInitRuntime() {
-  static RuntimeImpl* runtimeImpl = nullptr;
-  if (runtimeImpl == nullptr) {
-    HSAPlatformDetect hsa_rt;
-    OpenCLPlatformDetect opencl_rt;
+// file the counters of the runtime are written to when the program exits,
+// set by HCC_STATS_DUMP environment variable
+static std::string stats_dump_path;
+static std::chrono::steady_clock::time_point stats_dump_start;
 
-    char* verbose_env = getenv("HCC_VERBOSE");
-    if (verbose_env != nullptr) {
-      if (std::string("ON") == verbose_env) {
-        mcwamp_verbose = true;
-      }
+static void DumpStats();
+
+static RuntimeImpl* InitRuntime() {
+  RuntimeImpl* runtimeImpl = nullptr;
+
+  char* verbose_env = getenv("HCC_VERBOSE");
+  if (verbose_env != nullptr) {
+    if (std::string("ON") == verbose_env) {
+      mcwamp_verbose = true;
     }
+  }
 
-    // force use certain C++AMP runtime from HCC_RUNTIME environment variable
-    char* runtime_env = getenv("HCC_RUNTIME");
-    if (runtime_env != nullptr) {
-      if (std::string("HSA") == runtime_env) {
-        if (hsa_rt.detect()) {
-          runtimeImpl = LoadHSARuntime();
-        } else {
-          std::cerr << "Ignore unsupported HCC_RUNTIME environment variable: " << runtime_env << std::endl;
-        }
-      } else if (runtime_env[0] == 'C' && runtime_env[1] == 'L') {
-          if (opencl_rt.detect()) {
-              runtimeImpl = LoadOpenCLRuntime();
-          } else {
-              std::cerr << "Ignore unsupported HCC_RUNTIME environment variable: " << runtime_env << std::endl;
-          }
-      } else if(std::string("CPU") == runtime_env) {
-          // CPU runtime should be available
-          runtimeImpl = LoadCPURuntime();
-          runtimeImpl->set_cpu();
-      } else {
-        std::cerr << "Ignore unknown HCC_RUNTIME environment variable:" << runtime_env << std::endl;
-      }
+  // force use certain C++AMP runtime from HCC_RUNTIME environment variable,
+  // hsa, opencl or cpu, case-insensitive. The runtime chosen is loaded
+  // directly, the others are neither probed nor loaded
+  char* runtime_env = getenv("HCC_RUNTIME");
+  if (runtime_env != nullptr) {
+    std::string runtime(runtime_env);
+    std::transform(runtime.begin(), runtime.end(), runtime.begin(), ::tolower);
+    if (runtime == "hsa") {
+      if (HSAPlatform().hasKernels())
+        runtimeImpl = LoadHSARuntime(false);
+    } else if (runtime == "opencl" || runtime.compare(0, 2, "cl") == 0) {
+      if (OpenCLPlatform().hasKernels())
+        runtimeImpl = LoadOpenCLRuntime(false);
+    } else if (runtime == "cpu") {
+      // CPU runtime should be available
+      runtimeImpl = LoadCPURuntime();
+    } else {
+      std::cerr << "Ignore unknown HCC_RUNTIME environment variable:" << runtime_env << std::endl;
+      runtime.clear();
     }
+    if (runtimeImpl == nullptr && !runtime.empty()) {
+      std::cerr << "Ignore unsupported HCC_RUNTIME environment variable: " << runtime_env << std::endl;
+    }
+  }
 
-    // If can't determined by environment variable, try detect what can be used
-    if (runtimeImpl == nullptr) {
-      if (hsa_rt.detect()) {
-        runtimeImpl = LoadHSARuntime();
-      } else if (opencl_rt.detect()) {
-        runtimeImpl = LoadOpenCLRuntime();
+  // If can't determined by environment variable, try detect what can be used
+  if (runtimeImpl == nullptr) {
+    if (HSAPlatform().detect()) {
+      runtimeImpl = LoadHSARuntime();
+    } else if (OpenCLPlatform().detect()) {
+      runtimeImpl = LoadOpenCLRuntime();
+    } else {
+      runtimeImpl = LoadCPURuntime();
+      std::cerr << "No suitable runtime detected. Fall back to CPU!" << std::endl;
+    }
+  }
+
+  // write the counters of the runtime to a file when the program exits,
+  // ON for the path of the executable followed by .stats. The runtime is
+  // loaded by now, so they're written before it's torn down
+  char* stats_env = getenv("HCC_STATS_DUMP");
+  if (stats_env != nullptr && stats_env[0] != '\0') {
+    stats_dump_path = stats_env;
+    if (stats_dump_path == "ON") {
+      char exe[4096];
+      ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+      if (len > 0) {
+        exe[len] = '\0';
+        stats_dump_path = std::string(exe) + ".stats";
       } else {
-          runtimeImpl = LoadCPURuntime();
-          runtimeImpl->set_cpu();
-          std::cerr << "No suitable runtime detected. Fall back to CPU!" << std::endl;
+        stats_dump_path.clear();
       }
     }
+    if (!stats_dump_path.empty()) {
+      stats_dump_start = std::chrono::steady_clock::now();
+      atexit(DumpStats);
+    }
   }
   return runtimeImpl;
 }
 
+RuntimeImpl* GetOrInitRuntime() {
+  // initialized by the first thread to get here, the others wait for it
+  static RuntimeImpl* runtimeImpl = InitRuntime();
+  return runtimeImpl;
+}
+
 bool is_cpu()
 {
     return GetOrInitRuntime()->is_cpu();
 }
 
-static bool in_kernel = false;
+// set on the threads running a CPU kernel, which may run asynchronously to
+// the host code on other threads
+static thread_local bool in_kernel = false;
 bool in_cpu_kernel() { return in_kernel; }
 void enter_kernel() { in_kernel = true; }
 void leave_kernel() { in_kernel = false; }
 
+// OpenMP runtime the process may be linked with, see cpu_in_openmp_region()
+extern "C" int omp_in_parallel(void) __attribute__((weak));
+
+// the first number of a list of numbers, as in OMP_NUM_THREADS, 0 if none
+static unsigned int env_thread_count(const char* name) {
+  char* env = getenv(name);
+  int n = env ? atoi(env) : 0;
+  return n > 0 ? n : 0;
+}
+
+// number of threads of the CPU task pool: HCC_CPU_THREADS if set, else the
+// limits OpenMP is given, so the pool and OpenMP don't both take every core,
+// else the cores the process may run on
+static unsigned int cpu_thread_count() {
+  unsigned int count = env_thread_count("HCC_CPU_THREADS");
+  if (count == 0)
+    count = env_thread_count("OMP_NUM_THREADS");
+  unsigned int limit = env_thread_count("OMP_THREAD_LIMIT");
+  if (count == 0) {
+    cpu_set_t set;
+    count = sched_getaffinity(0, sizeof(set), &set) == 0 ? CPU_COUNT(&set)
+                                                         : std::thread::hardware_concurrency();
+  }
+  if (limit != 0 && count > limit)
+    count = limit;
+  return std::max(count, 1u);
+}
+
+// whether the threads of the pool are pinned to cores: HCC_CPU_AFFINITY=1,
+// or OMP_PROC_BIND asks OpenMP threads to be bound
+static bool cpu_thread_affinity() {
+  char* env = getenv("HCC_CPU_AFFINITY");
+  if (env != nullptr)
+    return atoi(env) != 0;
+  env = getenv("OMP_PROC_BIND");
+  return env != nullptr && (strcasecmp(env, "true") == 0 || strcasecmp(env, "close") == 0 ||
+                            strcasecmp(env, "spread") == 0 || strcasecmp(env, "master") == 0);
+}
+
+// whether the calling thread is in a parallel region of OpenMP, whose threads
+// already take the cores
+static bool cpu_in_openmp_region() {
+  return omp_in_parallel != nullptr && omp_in_parallel();
+}
+
+// set on the threads while they run tasks of the pool, a launch nested in a
+// task is run by the thread itself
+static thread_local bool in_pool_task = false;
+
+// persistent pool of threads running the tasks of CPU kernels, the thread
+// launching the kernel being one of them. Each thread is given an equal share
+// of the tasks, which it takes in chunks, then steals the chunks left in the
+// shares of the others. The pool is shared by the runtime and Bolt's btbb
+// backend, which sizes TBB to it, see hcc_cpu_thread_count()
+class CPUTaskPool {
+public:
+  CPUTaskPool() : count(cpu_thread_count()), limit(count),
+                  shares(new Share[count]), task(nullptr), data(nullptr),
+                  generation(0), active(0), stop(false) {
+    std::vector<int> cpus;
+    if (cpu_thread_affinity()) {
+      cpu_set_t set;
+      if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+          if (CPU_ISSET(cpu, &set))
+            cpus.push_back(cpu);
+      }
+    }
+    for (unsigned int i = 1; i < count; ++i) {
+      threads.push_back(std::thread(&CPUTaskPool::worker, this, i));
+      // the launching thread keeps the first core, worker i takes the next ones
+      if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpus[i % cpus.size()], &set);
+        pthread_setaffinity_np(threads.back().native_handle(), sizeof(set), &set);
+      }
+    }
+  }
+
+  ~CPUTaskPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+
+  /// the number of threads a launch runs on
+  unsigned int size() const { return limit.load(std::memory_order_relaxed); }
+
+  /// limits the threads of the launches to n, at most the threads of the
+  /// pool, 0 for all of them
+  void resize(unsigned int n) {
+    limit.store(n == 0 || n > count ? count : n, std::memory_order_relaxed);
+  }
+
+  void run(size_t size, void (*func)(void*, size_t, size_t), void* arg) {
+    // a launch from a task, or from a thread of OpenMP, would oversubscribe
+    // the cores, the tasks are run by the calling thread
+    unsigned int fanout = limit.load(std::memory_order_relaxed);
+    if (in_pool_task || fanout == 1 || cpu_in_openmp_region()) {
+      if (size != 0)
+        func(arg, 0, size);
+      return;
+    }
+
+    // one launch at a time runs on the pool
+    std::lock_guard<std::mutex> launch(launchMutex);
+
+    size_t chunk = std::max<size_t>(size / (fanout * CPU_TASK_CHUNKS_PER_THREAD), 1);
+    for (unsigned int i = 0; i < count; ++i) {
+      shares[i].next.store(i < fanout ? size * i / fanout : 0, std::memory_order_relaxed);
+      shares[i].end = i < fanout ? size * (i + 1) / fanout : 0;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      task = func;
+      data = arg;
+      grain = chunk;
+      participants = fanout;
+      active = count - 1;
+      ++generation;
+    }
+    wake.notify_all();
+
+    in_pool_task = true;
+    work(0);
+    in_pool_task = false;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return active == 0; });
+  }
+
+private:
+  struct Share {
+    std::atomic<size_t> next;
+    size_t end;
+    // keep the shares of different threads in different cache lines
+    char padding[64 - sizeof(std::atomic<size_t>) - sizeof(size_t)];
+  };
+
+  void work(unsigned int self) {
+    if (self >= participants)
+      return;
+    for (unsigned int i = 0; i < participants; ++i) {
+      Share& share = shares[(self + i) % participants];
+      for (;;) {
+        size_t begin = share.next.fetch_add(grain, std::memory_order_relaxed);
+        if (begin >= share.end)
+          break;
+        task(data, begin, std::min(begin + grain, share.end));
+      }
+    }
+  }
+
+  void worker(unsigned int self) {
+    // the thread only ever runs tasks of CPU kernels
+    in_kernel = true;
+    in_pool_task = true;
+    unsigned long seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [&] { return stop || generation != seen; });
+        if (stop)
+          return;
+        seen = generation;
+      }
+      work(self);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--active == 0)
+          done.notify_one();
+      }
+    }
+  }
+
+  const unsigned int count;
+  std::atomic<unsigned int> limit;
+  std::unique_ptr<Share[]> shares;
+  std::vector<std::thread> threads;
+
+  // the launch being run, set under mutex before waking the threads
+  void (*task)(void*, size_t, size_t);
+  void* data;
+  size_t grain;
+  unsigned int participants;
+  unsigned long generation;
+  unsigned int active;
+  bool stop;
+
+  std::mutex launchMutex;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+};
+
+static CPUTaskPool& getCPUTaskPool() {
+  static CPUTaskPool pool;
+  return pool;
+}
+
+void RunCPUTasks(size_t count, void (*task)(void*, size_t, size_t), void* data) {
+  getCPUTaskPool().run(count, task, data);
+}
+
+unsigned int GetCPUThreadCount() {
+  return getCPUTaskPool().size();
+}
+
+void SetCPUThreadCount(unsigned int count) {
+  getCPUTaskPool().resize(count);
+}
+
+// thread running the tasks enqueued on CPU queues one at a time, in the
+// order they are enqueued, each kernel on the CPU thread pool. Tasks left
+// when the process exits are run before the thread is joined
+class CPUTaskDispatcher {
+public:
+  CPUTaskDispatcher() : tasks(), stop(false) {
+    // the tasks use the pool, make sure it outlives the dispatcher
+    getCPUTaskPool();
+    thread = std::thread(&CPUTaskDispatcher::dispatch, this);
+  }
+
+  ~CPUTaskDispatcher() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake.notify_one();
+    thread.join();
+  }
+
+  void enqueue(const std::shared_ptr<CPUAsyncOp>& op) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      tasks.push_back(op);
+    }
+    wake.notify_one();
+  }
+
+private:
+  void dispatch() {
+    for (;;) {
+      std::shared_ptr<CPUAsyncOp> op;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stop || !tasks.empty(); });
+        if (tasks.empty())
+          return;
+        op = std::move(tasks.front());
+        tasks.pop_front();
+      }
+      op->run();
+    }
+  }
+
+  std::deque<std::shared_ptr<CPUAsyncOp>> tasks;
+  bool stop;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::thread thread;
+};
+
+void EnqueueCPUTask(const std::shared_ptr<CPUAsyncOp>& op) {
+  static CPUTaskDispatcher dispatcher;
+  dispatcher.enqueue(op);
+}
+
+// small pool of threads running the completion callbacks of async
+// operations. The operations which notify their completion, on completion
+// signals or events, hand their callbacks over to the pool from the thread of
+// the runtime handling them, a single monitor thread polls the others.
+// HCC_CALLBACK_THREADS sets the number of threads of the pool, 2 by default
+class CallbackExecutor {
+public:
+  CallbackExecutor() : callbacks(), watched(), stop(false) {
+    unsigned int count = 2;
+    char* threads_env = getenv("HCC_CALLBACK_THREADS");
+    if (threads_env != nullptr && atoi(threads_env) > 0)
+      count = atoi(threads_env);
+    for (unsigned int i = 0; i < count; ++i) {
+      workers.push_back(std::thread(&CallbackExecutor::work, this));
+    }
+    monitor = std::thread(&CallbackExecutor::poll, this);
+  }
+
+  ~CallbackExecutor() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    wake.notify_all();
+    watch.notify_one();
+    monitor.join();
+    for (auto& worker : workers) {
+      worker.join();
+    }
+  }
+
+  void post(std::function<void()> func) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      callbacks.push_back(std::move(func));
+    }
+    wake.notify_one();
+  }
+
+  void post_when(std::function<bool()> ready, std::function<void()> func) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      watched.push_back(std::make_pair(std::move(ready), std::move(func)));
+    }
+    watch.notify_one();
+  }
+
+private:
+  // callbacks left when the process exits are run before the threads are
+  // joined
+  void work() {
+    for (;;) {
+      std::function<void()> func;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        wake.wait(lock, [this] { return stop || !callbacks.empty(); });
+        if (callbacks.empty())
+          return;
+        func = std::move(callbacks.front());
+        callbacks.pop_front();
+      }
+      try {
+        func();
+      } catch (...) {
+        // the callback reports its errors through its own future
+      }
+    }
+  }
+
+  // poll the operations which can't notify their completion, backing off
+  // from 20us up to 1ms while none of them completes
+  void poll() {
+    std::chrono::microseconds interval(20);
+    for (;;) {
+      std::list< std::pair<std::function<bool()>, std::function<void()> > > pending;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        watch.wait(lock, [this] { return stop || !watched.empty(); });
+        if (stop)
+          return;
+        pending.swap(watched);
+      }
+      bool progress = false;
+      for (auto it = pending.begin(); it != pending.end();) {
+        if (it->first()) {
+          post(std::move(it->second));
+          it = pending.erase(it);
+          progress = true;
+        } else {
+          ++it;
+        }
+      }
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        watched.splice(watched.begin(), pending);
+      }
+      if (progress) {
+        interval = std::chrono::microseconds(20);
+      } else {
+        std::this_thread::sleep_for(interval);
+        interval = std::min(interval * 2, std::chrono::microseconds(std::chrono::milliseconds(1)));
+      }
+    }
+  }
+
+  std::deque< std::function<void()> > callbacks;
+  std::list< std::pair<std::function<bool()>, std::function<void()> > > watched;
+  bool stop;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable watch;
+  std::vector<std::thread> workers;
+  std::thread monitor;
+};
+
+static CallbackExecutor& getCallbackExecutor() {
+  static CallbackExecutor executor;
+  return executor;
+}
+
+void RunWhenReady(const std::shared_ptr<KalmarAsyncOp>& op, std::function<void()> func) {
+  CallbackExecutor& executor = getCallbackExecutor();
+  if (op->isReady()) {
+    executor.post(std::move(func));
+    return;
+  }
+  if (op->notifyWhenReady([&executor, func] { executor.post(func); }))
+    return;
+  std::shared_ptr<KalmarAsyncOp> watched = op;
+  executor.post_when([watched] { return watched->isReady(); }, std::move(func));
+}
+
+void RunWhen(std::function<bool()> ready, std::function<void()> func) {
+  getCallbackExecutor().post_when(std::move(ready), std::move(func));
+}
+
+// offline finalized kernels may be embedded as a fat binary of code objects
+// for several ISAs, so one binary avoids the online finalizer on each of
+// them, while other devices use the BRIG kernel. It starts with the line
+// kFatBinaryMagic, then a line "<ISA name> <offset> <size>" for each code
+// object and an empty line, followed by the code objects at their offsets
+// from the end of the empty line
+static const char kFatBinaryMagic[] = "HCC fat binary 1\n";
+
+struct FatBinaryEntry {
+  std::string isa;
+  char* data;
+  size_t size;
+};
+
+// the code objects of kernel_source, a fat binary or a single code object
+static std::vector<FatBinaryEntry> ParseFinalizedKernels(char* kernel_source, size_t kernel_size) {
+  std::vector<FatBinaryEntry> entries;
+  size_t magic = sizeof(kFatBinaryMagic) - 1;
+  if (kernel_size < magic || memcmp(kernel_source, kFatBinaryMagic, magic) != 0) {
+    entries.push_back({std::string(), kernel_source, kernel_size});
+    return entries;
+  }
+
+  // find the end of the header
+  size_t pos = magic;
+  std::vector<std::string> lines;
+  while (pos < kernel_size && kernel_source[pos] != '\n') {
+    char* end = static_cast<char*>(memchr(kernel_source + pos, '\n', kernel_size - pos));
+    if (end == nullptr)
+      return entries;
+    lines.push_back(std::string(kernel_source + pos, end));
+    pos = end - kernel_source + 1;
+  }
+  if (pos >= kernel_size)
+    return entries;
+  char* payload = kernel_source + pos + 1;
+  size_t payload_size = kernel_size - pos - 1;
+
+  for (const std::string& line : lines) {
+    std::istringstream fields(line);
+    FatBinaryEntry entry;
+    size_t offset = 0;
+    if (!(fields >> entry.isa >> offset >> entry.size) ||
+        offset > payload_size || entry.size > payload_size - offset)
+      continue;
+    entry.data = payload + offset;
+    entries.push_back(entry);
+  }
+  return entries;
+}
+
+// the offline finalized code object compatible with the ISA of a device,
+// chosen once for each device, or nullptr if it uses the BRIG kernel
+static std::pair<void*, size_t> FindFinalizedKernel(KalmarDevice* pDev) {
+  static std::mutex mutex;
+  static std::map<KalmarDevice*, std::pair<void*, size_t> > chosen;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto it = chosen.find(pDev);
+  if (it != std::end(chosen))
+    return it->second;
+
+  std::pair<void*, size_t> result(nullptr, 0);
+  // force use HSA BRIG kernel from HCC_NOISA environment variable
+  char* kernel_env = getenv("HCC_NOISA");
+  if (kernel_env == nullptr) {
+    // check if offline finalized kernels are available
+    size_t kernel_finalized_size = 
+      (ptrdiff_t)((void *)hsa_offline_finalized_kernel_end) -
+      (ptrdiff_t)((void *)hsa_offline_finalized_kernel_source);
+    if (kernel_finalized_size > 0) {
+      // check if an offline finalized kernel is compatible with ISA of the HSA agent
+      for (const FatBinaryEntry& entry :
+           ParseFinalizedKernels((char*)hsa_offline_finalized_kernel_source, kernel_finalized_size)) {
+        if (pDev->IsCompatibleKernel((void*)entry.size, entry.data)) {
+          if (mcwamp_verbose)
+            std::cout << "Use offline finalized HSA kernels " << entry.isa << "\n";
+          result = std::make_pair((void*)entry.data, entry.size);
+          break;
+        }
+      }
+    }
+  }
+  if (result.first == nullptr && mcwamp_verbose)
+    std::cout << "Use HSA BRIG kernel\n";
+
+  chosen[pDev] = result;
+  return result;
+}
+
 void DetermineAndGetProgram(KalmarQueue* pQueue, size_t* kernel_size, void** kernel_source, bool* needs_compilation) {
-  static bool firstTime = true;
+  // the kind of OpenCL kernels used is chosen once, by the first thread to
+  // get here
+  static std::once_flag chosen;
   static bool hasSPIR = false;
-  static bool hasFinalized = false;
-
-  char* kernel_env = nullptr;
 
   // FIXME need a more elegant way
   if (GetOrInitRuntime()->m_ImplName.find("libmcwamp_opencl") != std::string::npos) {
-    if (firstTime) {
+    std::call_once(chosen, [] {
       // force use OpenCL C kernel from HCC_NOSPIR environment variable
-      kernel_env = getenv("HCC_NOSPIR");
+      char* kernel_env = getenv("HCC_NOSPIR");
       if (kernel_env == nullptr) {
-          OpenCLPlatformDetect opencl_rt;
-        if (opencl_rt.hasSPIR()) {
+        if (OpenCLPlatform().hasSPIR()) {
           if (mcwamp_verbose)
             std::cout << "Use OpenCL SPIR kernel\n";
           hasSPIR = true;
@@ -314,8 +902,7 @@ void DetermineAndGetProgram(KalmarQueue* pQueue, size_t* kernel_size, void** ker
         if (mcwamp_verbose)
           std::cout << "Use OpenCL C kernel\n";
       }
-      firstTime = false;
-    }
+    });
     if (hasSPIR) {
       // SPIR path
       *kernel_size =
@@ -333,37 +920,10 @@ void DetermineAndGetProgram(KalmarQueue* pQueue, size_t* kernel_size, void** ker
     }
   } else {
     // HSA path
-
-    if (firstTime) {
-      // force use HSA BRIG kernel from HCC_NOISA environment variable
-      kernel_env = getenv("HCC_NOISA");
-      if (kernel_env == nullptr) {
-        // check if offline finalized kernels are available
-        size_t kernel_finalized_size = 
-          (ptrdiff_t)((void *)hsa_offline_finalized_kernel_end) -
-          (ptrdiff_t)((void *)hsa_offline_finalized_kernel_source);
-        // check if offline finalized kernel is compatible with ISA of the HSA agent
-        if ((kernel_finalized_size > 0) &&
-            (pQueue->getDev()->IsCompatibleKernel((void*)kernel_finalized_size, hsa_offline_finalized_kernel_source))) {
-          if (mcwamp_verbose)
-            std::cout << "Use offline finalized HSA kernels\n";
-          hasFinalized = true;
-        } else {
-          if (mcwamp_verbose)
-            std::cout << "Use HSA BRIG kernel\n";
-        }
-      } else {
-        // force use BRIG kernel
-        if (mcwamp_verbose)
-          std::cout << "Use HSA BRIG kernel\n";
-      }
-      firstTime = false;
-    }
-    if (hasFinalized) {
-      *kernel_size =
-        (ptrdiff_t)((void *)hsa_offline_finalized_kernel_end) -
-        (ptrdiff_t)((void *)hsa_offline_finalized_kernel_source);
-      *kernel_source = hsa_offline_finalized_kernel_source;
+    std::pair<void*, size_t> finalized = FindFinalizedKernel(pQueue->getDev());
+    if (finalized.first != nullptr) {
+      *kernel_size = finalized.second;
+      *kernel_source = finalized.first;
       *needs_compilation = false;
     } else {
       *kernel_size = 
@@ -384,6 +944,19 @@ void BuildProgram(KalmarQueue* pQueue) {
   pQueue->getDev()->BuildProgram((void*)kernel_size, kernel_source, needs_compilation);
 }
 
+std::shared_future<void> BuildProgramAsync(const std::shared_ptr<KalmarQueue>& pQueue) {
+  static std::mutex mutex;
+  static std::map<KalmarDevice*, std::shared_future<void> > builds;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::shared_future<void>& build = builds[pQueue->getDev()];
+  if (!build.valid()) {
+    std::shared_ptr<KalmarQueue> queue = pQueue;
+    build = std::async(std::launch::async, [queue]() { BuildProgram(queue.get()); }).share();
+  }
+  return build;
+}
+
 // used in parallel_for_each.h
 void *CreateKernel(std::string s, KalmarQueue* pQueue) {
   size_t kernel_size = 0;
@@ -395,12 +968,126 @@ void *CreateKernel(std::string s, KalmarQueue* pQueue) {
   return pQueue->getDev()->CreateKernel(s.c_str(), (void *)kernel_size, kernel_source, needs_compilation);
 }
 
+// used in parallel_for_each.h
+// the kernel is resolved once per device and kept in the handle, later
+// launches only load it
+void *CreateKernel(KalmarKernelHandle& handle, KalmarQueue* pQueue) {
+  KalmarDevice* pDev = pQueue->getDev();
+  std::atomic<void*>* slot = handle.get_slot(pDev->get_ordinal());
+  void* kernel = slot ? slot->load(std::memory_order_acquire) : nullptr;
+
+  if (kernel == nullptr) {
+    size_t kernel_size = 0;
+    void* kernel_source = nullptr;
+    bool needs_compilation = true;
+
+    DetermineAndGetProgram(pQueue, &kernel_size, &kernel_source, &needs_compilation);
+
+    // concurrent first launches resolve the same kernel, the device creates
+    // it only once
+    kernel = pDev->ResolveKernel(handle.name.c_str(), (void *)kernel_size, kernel_source, needs_compilation);
+    if (kernel == nullptr)
+      return pDev->CreateKernel(handle.name.c_str(), (void *)kernel_size, kernel_source, needs_compilation);
+    // the bounds are set before the kernel is published in the slot
+    pDev->SetKernelLaunchBounds(kernel, GetKernelProperties(handle.name).launchBounds);
+    if (slot)
+      slot->store(kernel, std::memory_order_release);
+  }
+
+  return pDev->CreateDispatch(kernel);
+}
+
+// the embedded kernel properties are lines "<kernel> barriers=<none|uniform>
+// group_segment=<0|1>" after a "HCC kernel properties 1" header, followed by
+// "max_workgroup_dim=<x>,<y>,<z>" and "waves_per_eu=<n>" for launch bounds,
+// and "readonly_args=<i>,<j>,..." for the arguments only read through
+static std::map<std::string, KernelProperties> ParseKernelProperties() {
+  std::map<std::string, KernelProperties> props;
+  if (kernel_props_source == nullptr)
+    return props;
+  size_t size = (ptrdiff_t)((void *)kernel_props_end) - (ptrdiff_t)((void *)kernel_props_source);
+  std::istringstream in(std::string((char*)kernel_props_source, size));
+  std::string line;
+  if (!std::getline(in, line) || line != "HCC kernel properties 1")
+    return props;
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string name, barriers, group;
+    if (!(fields >> name >> barriers >> group))
+      continue;
+    KernelProperties p;
+    p.known = true;
+    p.hasBarriers = (barriers != "barriers=none");
+    p.usesGroupSegment = (group != "group_segment=0");
+    memset(&p.launchBounds, 0, sizeof(p.launchBounds));
+    p.readOnlyArgs = 0;
+    std::string bound;
+    while (fields >> bound) {
+      unsigned x = 0, y = 0, z = 0, n = 0;
+      if (sscanf(bound.c_str(), "max_workgroup_dim=%u,%u,%u", &x, &y, &z) == 3) {
+        p.launchBounds.maxWorkgroupDim[0] = x;
+        p.launchBounds.maxWorkgroupDim[1] = y;
+        p.launchBounds.maxWorkgroupDim[2] = z;
+      } else if (sscanf(bound.c_str(), "waves_per_eu=%u", &n) == 1) {
+        p.launchBounds.wavesPerEU = n;
+      } else if (bound.compare(0, 14, "readonly_args=") == 0) {
+        std::istringstream indices(bound.substr(14));
+        unsigned index = 0;
+        char comma;
+        while (indices >> index) {
+          if (index < 64)
+            p.readOnlyArgs |= (uint64_t)1 << index;
+          indices >> comma;
+        }
+      }
+    }
+    props[name] = p;
+  }
+  return props;
+}
+
+KernelProperties GetKernelProperties(const std::string& name) {
+  static const std::map<std::string, KernelProperties> props = ParseKernelProperties();
+  auto it = props.find(name);
+  if (it != props.end())
+    return it->second;
+  KernelProperties unknown = { false, true, true, { { 0, 0, 0 }, 0 }, 0 };
+  return unknown;
+}
+
+bool GetKernelResources(KalmarKernelHandle& handle, KalmarQueue* pQueue, KalmarKernelResources& resources) {
+  KalmarDevice* pDev = pQueue->getDev();
+  std::atomic<void*>* slot = handle.get_slot(pDev->get_ordinal());
+  void* kernel = slot ? slot->load(std::memory_order_acquire) : nullptr;
+
+  if (kernel == nullptr) {
+    size_t kernel_size = 0;
+    void* kernel_source = nullptr;
+    bool needs_compilation = true;
+
+    DetermineAndGetProgram(pQueue, &kernel_size, &kernel_source, &needs_compilation);
+    kernel = pDev->ResolveKernel(handle.name.c_str(), (void *)kernel_size, kernel_source, needs_compilation);
+    if (kernel == nullptr)
+      return false;
+    if (slot)
+      slot->store(kernel, std::memory_order_release);
+  }
+
+  return pDev->GetKernelResources(kernel, resources);
+}
+
 void PushArg(void *k_, int idx, size_t sz, const void *s) {
   GetOrInitRuntime()->m_PushArgImpl(k_, idx, sz, s);
 }
 void PushArgPtr(void *k_, int idx, size_t sz, const void *s) {
   GetOrInitRuntime()->m_PushArgPtrImpl(k_, idx, sz, s);
 }
+bool HasPushArgs() {
+  return GetOrInitRuntime()->m_PushArgsImpl != nullptr;
+}
+void PushArgs(void *k_, size_t sz, const void *s) {
+  GetOrInitRuntime()->m_PushArgsImpl(k_, sz, s);
+}
 
 } // namespace CLAMP
 
@@ -412,6 +1099,14 @@ KalmarContext *getContext() {
 class KalmarBootstrap {
 private:
   RuntimeImpl* runtime;
+
+  // check if any kind of kernel is linked into the process
+  static bool HasKernels() {
+    return ((ptrdiff_t)((void *)hsa_kernel_end) - (ptrdiff_t)((void *)hsa_kernel_source) > 0) ||
+           ((ptrdiff_t)((void *)hsa_offline_finalized_kernel_end) - (ptrdiff_t)((void *)hsa_offline_finalized_kernel_source) > 0) ||
+           ((ptrdiff_t)((void *)cl_kernel_end) - (ptrdiff_t)((void *)cl_kernel_source) > 0) ||
+           ((ptrdiff_t)((void *)spir_kernel_end) - (ptrdiff_t)((void *)spir_kernel_source) > 0);
+  }
 public:
   KalmarBootstrap() : runtime(nullptr) {
     bool to_init = true;
@@ -422,6 +1117,22 @@ public:
       }
     }
 
+    // kernels are built on a background thread while the process starts,
+    // first launches wait for the build if it isn't done yet
+    bool warm_up = false;
+    char* warmup_env = getenv("HCC_WARMUP");
+    if (warmup_env != nullptr) {
+      if (std::string("ON") == warmup_env) {
+        warm_up = true;
+      }
+    }
+
+    // processes without kernels, such as tools which never use a device,
+    // don't initialize the runtime and its devices when they start
+    if (!HasKernels()) {
+      to_init = false;
+    }
+
     if (to_init) {
       // initialize runtime
       runtime = CLAMP::GetOrInitRuntime();
@@ -433,7 +1144,10 @@ public:
       std::shared_ptr<KalmarQueue> queue = context->auto_select();
   
       // build kernels on the default queue on the default device
-      CLAMP::BuildProgram(queue.get());
+      if (warm_up)
+        CLAMP::BuildProgramAsync(queue);
+      else
+        CLAMP::BuildProgram(queue.get());
     }
   }
 };
@@ -447,3 +1161,186 @@ extern "C" void __attribute__((constructor)) __hcc_shared_library_init() {
 
 extern "C" void __attribute__((destructor)) __hcc_shared_library_fini() {
 }
+
+extern "C" size_t hc_get_queue_stats(hc_queue_stats* stats, size_t count) {
+  size_t total = 0;
+  std::vector<Kalmar::KalmarDevice*> devices = Kalmar::getContext()->getDevices();
+  for (Kalmar::KalmarDevice* device : devices) {
+    std::vector< std::shared_ptr<Kalmar::KalmarQueue> > queues = device->get_all_queues();
+    for (size_t i = 0; i < queues.size(); ++i, ++total) {
+      if (total < count) {
+        queues[i]->getStats(&stats[total]);
+        stats[total].view = i;
+      }
+    }
+  }
+  return total;
+}
+
+extern "C" uint64_t hc_get_dispatch_latency(const hc_queue_stats* stats, double percentile) {
+  uint64_t samples = 0;
+  for (int i = 0; i < HC_DISPATCH_LATENCY_BUCKETS; ++i)
+    samples += stats->dispatch_latency[i];
+  if (samples == 0)
+    return 0;
+
+  // the sample of the percentile, counted from 1
+  double position = std::min(std::max(percentile, 0.0), 100.0) / 100.0 * samples;
+  uint64_t rank = std::max<uint64_t>((uint64_t)position + ((uint64_t)position < position), 1);
+  uint64_t seen = 0;
+  int bucket = 0;
+  for (; bucket < HC_DISPATCH_LATENCY_BUCKETS - 1; ++bucket) {
+    seen += stats->dispatch_latency[bucket];
+    if (seen >= rank)
+      break;
+  }
+  return (2ULL << bucket) - 1;
+}
+
+// memory tag of each thread, see hc_set_memory_tag()
+static thread_local const char* memoryTag = nullptr;
+
+extern "C" const char* hc_set_memory_tag(const char* tag) {
+  const char* previous = memoryTag;
+  memoryTag = tag;
+  return previous;
+}
+
+extern "C" const char* hc_get_memory_tag() {
+  return memoryTag;
+}
+
+extern "C" size_t hc_get_memory_stats(hc_memory_stats* stats, size_t count) {
+  size_t total = 0;
+  std::vector<Kalmar::KalmarDevice*> devices = Kalmar::getContext()->getDevices();
+  for (Kalmar::KalmarDevice* device : devices) {
+    Kalmar::KalmarMemoryTracker& tracker = device->getMemoryTracker();
+    uint64_t cachedBytes = device->getMemoryCacheSize();
+    std::lock_guard<std::mutex> lock(tracker.mutex);
+    auto fill = [&](const char* tag, const Kalmar::KalmarMemoryTracker::usage& u) {
+      if (total < count) {
+        hc_memory_stats& s = stats[total];
+        s.device = device->get_ordinal();
+        s.tag = tag;
+        s.bytes = u.bytes;
+        s.peak_bytes = u.peakBytes;
+        s.allocations = u.allocations;
+        s.releases = u.releases;
+        s.cached_bytes = tag ? 0 : cachedBytes;
+      }
+      ++total;
+    };
+    fill(nullptr, tracker.total);
+    for (auto& tag : tracker.tags)
+      fill(tag.first.c_str(), tag.second);
+  }
+  return total;
+}
+
+extern "C" void hc_print_memory_stats() {
+  size_t count = hc_get_memory_stats(nullptr, 0);
+  std::vector<hc_memory_stats> stats(count);
+  count = std::min(count, hc_get_memory_stats(stats.data(), count));
+  for (size_t i = 0; i < count; ++i) {
+    const hc_memory_stats& s = stats[i];
+    if (s.tag == nullptr) {
+      fprintf(stderr, "device %u: %llu bytes, peak %llu bytes, %llu bytes cached\n", s.device,
+              (unsigned long long)s.bytes, (unsigned long long)s.peak_bytes,
+              (unsigned long long)s.cached_bytes);
+    } else {
+      fprintf(stderr, "  %-24s %llu bytes, peak %llu bytes, %llu allocations, %llu releases\n", s.tag,
+              (unsigned long long)s.bytes, (unsigned long long)s.peak_bytes,
+              (unsigned long long)s.allocations, (unsigned long long)s.releases);
+    }
+  }
+}
+
+extern "C" void hc_register_dispatch_callbacks(hc_dispatch_callback_t begin, hc_dispatch_callback_t end,
+                                               void* user_data) {
+  Kalmar::getContext()->setDispatchCallbacks(begin, end, user_data);
+}
+
+extern "C" void hc_register_copy_callbacks(hc_copy_callback_t begin, hc_copy_callback_t end,
+                                           void* user_data) {
+  Kalmar::getContext()->setCopyCallbacks(begin, end, user_data);
+}
+
+namespace Kalmar {
+namespace CLAMP {
+
+// write the counters of all the queues, alive or destroyed, and the memory
+// high watermark of all the devices, one "name value" pair per line
+static void DumpStats() {
+  FILE* file = fopen(stats_dump_path.c_str(), "w");
+  if (file == nullptr) {
+    std::cerr << "HCC_STATS_DUMP: can't write " << stats_dump_path << std::endl;
+    return;
+  }
+
+  hc_queue_stats sum;
+  memset(&sum, 0, sizeof(sum));
+  uint64_t peak_bytes = 0;
+  std::vector<Kalmar::KalmarDevice*> devices = Kalmar::getContext()->getDevices();
+  for (Kalmar::KalmarDevice* device : devices) {
+    std::vector<hc_queue_stats> stats;
+    for (auto& queue : device->get_all_queues()) {
+      stats.push_back(hc_queue_stats());
+      queue->getStats(&stats.back());
+    }
+    const Kalmar::KalmarQueueCounters& retired = device->getRetiredCounters();
+    sum.dispatches += retired.dispatches.load();
+    sum.bytes_host_to_device += retired.bytesHostToDevice.load();
+    sum.bytes_device_to_host += retired.bytesDeviceToHost.load();
+    sum.bytes_device_to_device += retired.bytesDeviceToDevice.load();
+    sum.kernarg_pool_misses += retired.kernargPoolMisses.load();
+    sum.signal_pool_misses += retired.signalPoolMisses.load();
+    sum.dependency_wait_ns += retired.dependencyWaitNs.load();
+    sum.sync_copies += retired.syncCopies.load();
+    for (int i = 0; i < HC_DISPATCH_LATENCY_BUCKETS; ++i)
+      sum.dispatch_latency[i] += retired.dispatchLatency[i].load();
+    for (const hc_queue_stats& s : stats) {
+      sum.dispatches += s.dispatches;
+      sum.bytes_host_to_device += s.bytes_host_to_device;
+      sum.bytes_device_to_host += s.bytes_device_to_host;
+      sum.bytes_device_to_device += s.bytes_device_to_device;
+      sum.kernarg_pool_misses += s.kernarg_pool_misses;
+      sum.signal_pool_misses += s.signal_pool_misses;
+      sum.dependency_wait_ns += s.dependency_wait_ns;
+      sum.sync_copies += s.sync_copies;
+      for (int i = 0; i < HC_DISPATCH_LATENCY_BUCKETS; ++i)
+        sum.dispatch_latency[i] += s.dispatch_latency[i];
+    }
+    sum.code_object_builds += device->getCodeObjectBuilds();
+
+    Kalmar::KalmarMemoryTracker& tracker = device->getMemoryTracker();
+    std::lock_guard<std::mutex> lock(tracker.mutex);
+    peak_bytes += tracker.total.peakBytes;
+  }
+
+  uint64_t elapsed_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now() - stats_dump_start).count();
+
+  fprintf(file, "dispatches %llu\n", (unsigned long long)sum.dispatches);
+  fprintf(file, "bytes_host_to_device %llu\n", (unsigned long long)sum.bytes_host_to_device);
+  fprintf(file, "bytes_device_to_host %llu\n", (unsigned long long)sum.bytes_device_to_host);
+  fprintf(file, "bytes_device_to_device %llu\n", (unsigned long long)sum.bytes_device_to_device);
+  fprintf(file, "kernarg_pool_misses %llu\n", (unsigned long long)sum.kernarg_pool_misses);
+  fprintf(file, "signal_pool_misses %llu\n", (unsigned long long)sum.signal_pool_misses);
+  fprintf(file, "dependency_wait_ns %llu\n", (unsigned long long)sum.dependency_wait_ns);
+  fprintf(file, "sync_copies %llu\n", (unsigned long long)sum.sync_copies);
+  fprintf(file, "code_object_builds %llu\n", (unsigned long long)sum.code_object_builds);
+  fprintf(file, "memory_peak_bytes %llu\n", (unsigned long long)peak_bytes);
+  fprintf(file, "dispatch_latency_p50_ns %llu\n", (unsigned long long)hc_get_dispatch_latency(&sum, 50));
+  fprintf(file, "dispatch_latency_p99_ns %llu\n", (unsigned long long)hc_get_dispatch_latency(&sum, 99));
+  fprintf(file, "elapsed_ns %llu\n", (unsigned long long)elapsed_ns);
+  fclose(file);
+}
+
+} // namespace CLAMP
+} // namespace Kalmar
+
+// the number of threads of the CPU task pool, looked up by Bolt's btbb
+// backend through a weak symbol to size TBB to it
+extern "C" unsigned int hcc_cpu_thread_count() {
+  return Kalmar::CLAMP::GetCPUThreadCount();
+}
@@ -10,10 +10,13 @@
 #include <iostream>
 #include <vector>
 #include <map>
-#include <set>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <algorithm>
 #include <cassert>
 #include <sstream>
-#include <fstream>
 #include <iomanip>
 
 #include <CL/opencl.h>
@@ -22,6 +25,8 @@
 #include <kalmar_runtime.h>
 #include <kalmar_aligned_alloc.h>
 
+#include "../kernel_cache.hpp"
+
 extern "C" void PushArgImpl(void *k_, int idx, size_t sz, const void *s);
 extern "C" void PushArgPtrImpl(void *k_, int idx, size_t sz, const void *s);
 
@@ -38,34 +43,318 @@ struct DimMaxSize {
   size_t* maxSizes;
 };
 
-static cl_context context;
-// store the latest event the current memory buffer should wait;
-static std::map<cl_mem, cl_event> events;
+// number of OpenCL command queues backing each queue, commands are spread
+// round-robin over them, and wait for the commands of the other queues
+// using their buffers through events
+// environment variable HCC_OPENCL_QUEUES overrides it
+// default set as 2, so transfers and kernels not depending on each other
+// may overlap
+#ifndef OPENCL_QUEUE_COUNT
+#define OPENCL_QUEUE_COUNT (2)
+#endif
+
+// size and number of the pinned staging buffers of each device, which
+// transfers of pageable host memory to and from discrete devices go through
+// default set as 4MB and 4
+#define OPENCL_STAGING_BUFFER_SIZE (4 * 1024 * 1024)
+#define OPENCL_STAGING_BUFFER_COUNT (4)
 
-static inline void callback_release_kernel(cl_event event, cl_int event_command_exec_status, void *user_data) {
-    if (user_data)
-        clReleaseKernel(static_cast<cl_kernel>(user_data));
-}
+static cl_context context;
 
 static inline void free_memory(cl_event event, cl_int event_command_exec_status, void *user_data) {
     if (user_data)
         kalmar_aligned_free(user_data);
 }
 
-struct cl_info
+/// an OpenCL memory object, and the events of the commands using it later
+/// commands wait for: the last command writing it, and the commands only
+/// reading it since then, so commands only reading it don't wait for each
+/// other. The device pointers of OpenCL devices point to cl_buffer, each
+/// buffer has a lock of its own so queues used from different threads don't
+/// share any state
+struct cl_buffer
 {
     cl_mem dm;
+    std::mutex mutex;
+    cl_event writer;
+    std::vector<cl_event> readers;
+
+    explicit cl_buffer(cl_mem dm) : dm(dm), mutex(), writer(nullptr), readers() {}
+
+    ~cl_buffer() {
+        if (writer)
+            clReleaseEvent(writer);
+        for (cl_event evt : readers)
+            clReleaseEvent(evt);
+    }
+};
+
+/// append the events a command using buf waits for to list, retained: the
+/// last writer, and the readers since then if the command may modify buf
+static inline void append_dependencies(cl_buffer* buf, bool modify, std::vector<cl_event>& list) {
+    auto append = [&list](cl_event evt) {
+        if (std::find(std::begin(list), std::end(list), evt) == std::end(list)) {
+            clRetainEvent(evt);
+            list.push_back(evt);
+        }
+    };
+    std::lock_guard<std::mutex> lock(buf->mutex);
+    if (buf->writer)
+        append(buf->writer);
+    if (modify)
+        for (cl_event evt : buf->readers)
+            append(evt);
+}
+
+static inline void release_dependencies(std::vector<cl_event>& list) {
+    for (cl_event evt : list)
+        clReleaseEvent(evt);
+    list.clear();
+}
+
+/// note evt as the latest command using buf, readers already complete are
+/// dropped while adding a reader
+static inline void retire(cl_buffer* buf, cl_event evt, bool modify) {
+    clRetainEvent(evt);
+    std::lock_guard<std::mutex> lock(buf->mutex);
+    if (modify) {
+        if (buf->writer)
+            clReleaseEvent(buf->writer);
+        for (cl_event reader : buf->readers)
+            clReleaseEvent(reader);
+        buf->readers.clear();
+        buf->writer = evt;
+    } else {
+        auto done = [](cl_event reader) {
+            cl_int status = CL_QUEUED;
+            clGetEventInfo(reader, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+            if (status != CL_COMPLETE)
+                return false;
+            clReleaseEvent(reader);
+            return true;
+        };
+        buf->readers.erase(std::remove_if(std::begin(buf->readers), std::end(buf->readers), done),
+                           std::end(buf->readers));
+        buf->readers.push_back(evt);
+    }
+}
+
+/// get the last writer of buf, retained, or nullptr if there's none
+static inline cl_event last_writer(cl_buffer* buf) {
+    std::lock_guard<std::mutex> lock(buf->mutex);
+    if (buf->writer)
+        clRetainEvent(buf->writer);
+    return buf->writer;
+}
+
+struct cl_info
+{
+    cl_buffer* buf;
     bool modify;
 };
 
+/// pinned host memory of CL_MEM_ALLOC_HOST_PTR memory objects, mapped once
+/// for the host, which transfers of pageable host memory are staged through
+/// so the DMA engine reads and writes pinned memory. The buffers are created
+/// on first use
+class CLStagingPool
+{
+    struct stage {
+        cl_mem dm;
+        void* ptr;
+        /// the last transfer using the buffer, nullptr if none
+        cl_event busy;
+        bool inUse;
+    };
+
+    std::vector<stage> stages;
+    cl_device_id device;
+    cl_command_queue queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    void create() {
+        cl_int err;
+        queue = clCreateCommandQueue(context, device, 0, &err);
+        assert(err == CL_SUCCESS);
+        stages.resize(OPENCL_STAGING_BUFFER_COUNT);
+        for (stage& st : stages) {
+            st.dm = clCreateBuffer(context, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR, OPENCL_STAGING_BUFFER_SIZE, nullptr, &err);
+            assert(err == CL_SUCCESS);
+            st.ptr = clEnqueueMapBuffer(queue, st.dm, CL_TRUE, CL_MAP_READ | CL_MAP_WRITE, 0, OPENCL_STAGING_BUFFER_SIZE,
+                                        0, NULL, NULL, &err);
+            assert(err == CL_SUCCESS);
+            st.busy = nullptr;
+            st.inUse = false;
+        }
+    }
+
+public:
+    CLStagingPool() : stages(), device(nullptr), queue(nullptr), mutex(), cv() {}
+
+    void init(cl_device_id device) { this->device = device; }
+
+    size_t size() const { return OPENCL_STAGING_BUFFER_SIZE; }
+
+    /// get a staging buffer once the last transfer using it is done
+    /// @wait: whether to wait for a buffer in use, otherwise nullptr is
+    ///        returned if all of them are in use
+    void* acquire(int& index, bool wait = true) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (stages.empty())
+            create();
+        for (;;) {
+            for (int i = 0; i < stages.size(); ++i) {
+                stage& st = stages[i];
+                if (st.inUse)
+                    continue;
+                st.inUse = true;
+                if (st.busy) {
+                    clWaitForEvents(1, &st.busy);
+                    clReleaseEvent(st.busy);
+                    st.busy = nullptr;
+                }
+                index = i;
+                return st.ptr;
+            }
+            if (!wait)
+                return nullptr;
+            cv.wait(lock);
+        }
+    }
+
+    /// give a staging buffer back, which is busy until evt completes
+    void release(int index, cl_event evt) {
+        clRetainEvent(evt);
+        std::lock_guard<std::mutex> lock(mutex);
+        stages[index].busy = evt;
+        stages[index].inUse = false;
+        cv.notify_one();
+    }
+
+    ~CLStagingPool() {
+        for (stage& st : stages) {
+            if (st.busy) {
+                clWaitForEvents(1, &st.busy);
+                clReleaseEvent(st.busy);
+            }
+            clEnqueueUnmapMemObject(queue, st.dm, st.ptr, 0, NULL, NULL);
+        }
+        if (queue) {
+            clFinish(queue);
+            for (stage& st : stages)
+                clReleaseMemObject(st.dm);
+            clReleaseCommandQueue(queue);
+        }
+    }
+};
+
+/// cl_kernel objects of the kernels of the programs of a device, kept for
+/// later launches instead of being created for each one. Each launch takes a
+/// kernel object of its own between setting its arguments and enqueuing it,
+/// so concurrent launches of one kernel are given clones of it, which are
+/// kept as well. Arguments are captured when a kernel is enqueued, so it's
+/// given back right afterwards
+class CLKernelPool
+{
+    /// kernel objects not taken by a launch, by program and kernel name
+    std::map<std::pair<cl_program, std::string>, std::vector<cl_kernel> > pools;
+    /// the pool each kernel object goes back to
+    std::map<cl_kernel, std::vector<cl_kernel>*> owners;
+    std::mutex mutex;
+
+public:
+    CLKernelPool() : pools(), owners(), mutex() {}
+
+    cl_kernel acquire(cl_program program, const char* name) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::vector<cl_kernel>& pool = pools[std::make_pair(program, std::string(name))];
+            if (!pool.empty()) {
+                cl_kernel kernel = pool.back();
+                pool.pop_back();
+                return kernel;
+            }
+        }
+        /// only the first launches of a kernel, or more of them at once than
+        /// before, create a kernel object
+        cl_int err;
+        cl_kernel kernel = clCreateKernel(program, name, &err);
+        assert(err == CL_SUCCESS);
+        std::lock_guard<std::mutex> lock(mutex);
+        owners[kernel] = &pools[std::make_pair(program, std::string(name))];
+        return kernel;
+    }
+
+    void release(cl_kernel kernel) {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = owners.find(kernel);
+        assert(it != std::end(owners));
+        it->second->push_back(kernel);
+    }
+
+    ~CLKernelPool() {
+        for (auto& it : owners)
+            clReleaseKernel(it.first);
+    }
+};
+
+/// an asynchronous transfer between the host and an OpenCL device, done once
+/// its event completes. It's waited for when destroyed, as the host memory
+/// it uses may be released afterwards
+class OpenCLAsyncOp final : public KalmarAsyncOp
+{
+    cl_event evt;
+    KalmarQueue* queue;
+public:
+    OpenCLAsyncOp(cl_event evt, KalmarQueue* queue) : evt(evt), queue(queue) {
+        clRetainEvent(evt);
+    }
+
+    ~OpenCLAsyncOp() {
+        clWaitForEvents(1, &evt);
+        clReleaseEvent(evt);
+    }
+
+    void* getNativeHandle() override { return &evt; }
+
+    bool isReady() override {
+        cl_int status = CL_QUEUED;
+        clGetEventInfo(evt, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(cl_int), &status, NULL);
+        return status == CL_COMPLETE;
+    }
+
+    KalmarQueue* getQueue() override { return queue; }
+
+    bool notifyWhenReady(std::function<void()> callback) override {
+        std::function<void()>* arg = new std::function<void()>(std::move(callback));
+        cl_int err = clSetEventCallback(evt, CL_COMPLETE, [](cl_event, cl_int, void* arg) {
+            std::unique_ptr< std::function<void()> > callback(static_cast<std::function<void()>*>(arg));
+            (*callback)();
+        }, arg);
+        if (err != CL_SUCCESS) {
+            delete arg;
+            return false;
+        }
+        return true;
+    }
+
+    void blockingWait() override {
+        cl_int err = clWaitForEvents(1, &evt);
+        assert(err == CL_SUCCESS);
+    }
+};
+
 class OpenCLQueue final : public KalmarQueue
 {
 public:
-    OpenCLQueue(KalmarDevice* pDev, cl_device_id dev, bool isAMD) : KalmarQueue(pDev), mems() {
+    OpenCLQueue(KalmarDevice* pDev, cl_device_id dev, bool isAMD, int queue_count,
+                bool hostUnified, CLStagingPool* staging, CLKernelPool* kernels)
+        : KalmarQueue(pDev), queues(queue_count), idx(0), mems(),
+          hostUnified(hostUnified), staging(staging), kernels(kernels) {
         cl_int err;
-        idx = 0;
-        for (int i = 0; i < queue_size; ++i) {
-            queues[i] = clCreateCommandQueue(context, dev, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &err);
+        for (auto& queue : queues) {
+            queue = clCreateCommandQueue(context, dev, CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE, &err);
             assert(err == CL_SUCCESS);
         }
 
@@ -128,188 +417,300 @@ public:
         }
     }
 
-    void Push(void *kernel, int idx, void* device, bool modify) override {
-        cl_mem dm = static_cast<cl_mem>(device);
-        PushArgImpl(kernel, idx, sizeof(cl_mem), &dm);
+    void Push(void *kernel, int idx, void* device, bool modify, struct dev_info* dev) override {
+        cl_buffer* buf = static_cast<cl_buffer*>(device);
+        PushArgImpl(kernel, idx, sizeof(cl_mem), &buf->dm);
         /// store const informantion for each opencl memory object
         /// after kernel launches, const data don't need to wait for kernel finish
-        mems.push_back({dm, modify});
+        for (cl_info& mm : mems) {
+            if (mm.buf == buf) {
+                mm.modify = mm.modify || modify;
+                return;
+            }
+        }
+        mems.push_back({buf, modify});
     }
 
     void write(void* device, const void *src, size_t count, size_t offset, bool blocking) override {
-        cl_mem dm = static_cast<cl_mem>(device);
+        cl_buffer* buf = static_cast<cl_buffer*>(device);
+        if (count == 0)
+            return;
+        std::vector<cl_event> list;
+        append_dependencies(buf, true, list);
+        cl_int err;
         cl_event ent;
-        cl_int err = clEnqueueWriteBuffer(getQueue(), dm, CL_FALSE, offset, count, src, 0, NULL, &ent);
-        assert(err == CL_SUCCESS);
-        if (blocking) {
-            err = clWaitForEvents(1, &ent);
+        cl_command_queue queue = getQueue();
+        if (hostUnified) {
+            /// the buffer is in host memory, the copy is done by the host
+            void* addr = clEnqueueMapBuffer(queue, buf->dm, CL_TRUE, CL_MAP_WRITE_INVALIDATE_REGION, offset, count,
+                                            list.size(), list.size()?list.data():NULL, NULL, &err);
             assert(err == CL_SUCCESS);
-            err = clReleaseEvent(ent);
+            memcpy(addr, src, count);
+            err = clEnqueueUnmapMemObject(queue, buf->dm, addr, 0, NULL, &ent);
             assert(err == CL_SUCCESS);
+            submitted(queue);
         } else {
-            if (events.find(dm) != std::end(events)) {
-                err = clReleaseEvent(events[dm]);
+            /// each chunk is copied to a staging buffer, then written from
+            /// there after the previous chunk, so src isn't used afterwards
+            cl_event prev = nullptr;
+            for (size_t done = 0; done < count; ) {
+                size_t n = std::min(count - done, staging->size());
+                int index;
+                void* stage = staging->acquire(index);
+                memcpy(stage, static_cast<const char*>(src) + done, n);
+                err = clEnqueueWriteBuffer(queue, buf->dm, CL_FALSE, offset + done, n, stage,
+                                           prev ? 1 : list.size(), prev ? &prev : (list.size()?list.data():NULL), &ent);
                 assert(err == CL_SUCCESS);
+                submitted(queue);
+                staging->release(index, ent);
+                if (prev)
+                    clReleaseEvent(prev);
+                prev = ent;
+                done += n;
             }
-            events[dm] = ent;
         }
+        release_dependencies(list);
+        retire(buf, ent, true);
+        if (blocking) {
+            err = clWaitForEvents(1, &ent);
+            assert(err == CL_SUCCESS);
+        }
+        err = clReleaseEvent(ent);
+        assert(err == CL_SUCCESS);
     }
 
     void read(void* device, void* dst, size_t count, size_t offset) override {
-        cl_mem dm = static_cast<cl_mem>(device);
+        cl_buffer* buf = static_cast<cl_buffer*>(device);
+        if (count == 0)
+            return;
+        std::vector<cl_event> list;
+        append_dependencies(buf, false, list);
         cl_int err;
-        if (events.find(dm) != std::end(events)) {
-            cl_event ent = events[dm];
-            err = clEnqueueReadBuffer(getQueue(), dm, CL_TRUE, offset, count, dst, 1, &ent, NULL);
+        cl_command_queue queue = getQueue();
+        if (hostUnified) {
+            void* addr = clEnqueueMapBuffer(queue, buf->dm, CL_TRUE, CL_MAP_READ, offset, count,
+                                            list.size(), list.size()?list.data():NULL, NULL, &err);
             assert(err == CL_SUCCESS);
-            err = clReleaseEvent(ent);
+            memcpy(dst, addr, count);
+            cl_event evt;
+            err = clEnqueueUnmapMemObject(queue, buf->dm, addr, 0, NULL, &evt);
             assert(err == CL_SUCCESS);
-            events.erase(dm);
-        } else {
-            err = clEnqueueReadBuffer(getQueue(), dm, CL_TRUE, offset, count, dst, 0, NULL, NULL);
+            submitted(queue);
+            retire(buf, evt, false);
+            clReleaseEvent(evt);
+            release_dependencies(list);
+            return;
+        }
+
+        /// chunks are read into staging buffers, the next chunk is read
+        /// while the host copies the current one out if a buffer is free
+        struct chunk {
+            void* stage;
+            int index;
+            size_t done;
+            size_t n;
+            cl_event evt;
+        };
+        auto issue = [&](size_t done, bool wait) {
+            chunk c = { nullptr, 0, done, std::min(count - done, staging->size()), nullptr };
+            c.stage = staging->acquire(c.index, wait);
+            if (c.stage) {
+                err = clEnqueueReadBuffer(queue, buf->dm, CL_FALSE, offset + done, c.n, c.stage,
+                                          list.size(), list.size()?list.data():NULL, &c.evt);
+                assert(err == CL_SUCCESS);
+                clFlush(queue);
+            }
+            return c;
+        };
+        chunk curr = issue(0, true);
+        for (;;) {
+            size_t next = curr.done + curr.n;
+            chunk ahead = { nullptr, 0, next, 0, nullptr };
+            if (next < count)
+                ahead = issue(next, false);
+            err = clWaitForEvents(1, &curr.evt);
             assert(err == CL_SUCCESS);
+            memcpy(static_cast<char*>(dst) + curr.done, curr.stage, curr.n);
+            staging->release(curr.index, curr.evt);
+            clReleaseEvent(curr.evt);
+            if (next >= count)
+                break;
+            curr = ahead.stage ? ahead : issue(next, true);
         }
+        release_dependencies(list);
     }
 
     void copy(void* src, void* dst, size_t count, size_t src_offset, size_t dst_offset, bool blocking) override {
-        cl_mem sdm = static_cast<cl_mem>(src);
-        cl_mem ddm = static_cast<cl_mem>(dst);
+        cl_buffer* sbuf = static_cast<cl_buffer*>(src);
+        cl_buffer* dbuf = static_cast<cl_buffer*>(dst);
         cl_int err;
         cl_event ent;
-        if (events.find(sdm) == std::end(events)) {
-            err = clEnqueueCopyBuffer(getQueue(), sdm, ddm, src_offset, dst_offset, count, 0, NULL, &ent);
+        std::vector<cl_event> list;
+        append_dependencies(sbuf, false, list);
+        append_dependencies(dbuf, true, list);
+
+        /// In OpenCL, the buffer write to different device cannot be copied
+        /// simply by EnqueuCopyBuffer. CopyBuffer can only work when the device
+        /// of the queue used to write data is the same as the device of the
+        /// queue used to copy data
+        cl_command_queue target = getQueue();
+        cl_command_queue queue = target;
+        cl_event writer = last_writer(sbuf);
+        if (writer)
+            clGetEventInfo(writer, CL_EVENT_COMMAND_QUEUE, sizeof(cl_command_queue), &queue, NULL);
+        cl_device_id dev1, dev2;
+        clGetCommandQueueInfo(target, CL_QUEUE_DEVICE, sizeof(cl_device_id), &dev1, NULL);
+        clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &dev2, NULL);
+
+        if (dev1 == dev2) {
+            err = clEnqueueCopyBuffer(target, sbuf->dm, dbuf->dm, src_offset, dst_offset, count,
+                                      list.size(), list.size()?list.data():NULL, &ent);
             assert(err == CL_SUCCESS);
         } else {
-            std::vector<cl_event> list;
-            if (events.find(sdm) != std::end(events))
-              list.push_back(events[sdm]);
-            if (events.find(ddm) != std::end(events))
-              list.push_back(events[ddm]);
-            std::sort(std::begin(list), std::end(list));
-            list.erase(std::unique(std::begin(list), std::end(list)), std::end(list));
-            cl_command_queue queue;
-            clGetEventInfo(events[sdm], CL_EVENT_COMMAND_QUEUE, sizeof(cl_command_queue), &queue, NULL);
-
-            cl_device_id dev1, dev2;
-            clGetCommandQueueInfo(getQueue(), CL_QUEUE_DEVICE, sizeof(cl_device_id), &dev1, NULL);
-            clGetCommandQueueInfo(queue, CL_QUEUE_DEVICE, sizeof(cl_device_id), &dev2, NULL);
-
-            /// In OpenCL, the buffer write to different device cannot be copied
-            /// simply by EnqueuCopyBuffer. CopyBuffer can only work when the device
-            /// of the queue used to write data is the same as the device of the
-            /// queue used to copy data
-            if (dev1 == dev2) {
-                err = clEnqueueCopyBuffer(getQueue(), sdm, ddm, src_offset, dst_offset, count, list.size(), list.size()?list.data():NULL, &ent);
-                assert(err == CL_SUCCESS);
+            /// copies fitting a pinned staging buffer go through one
+            int index = -1;
+            void* stage = (count <= staging->size()) ? staging->acquire(index) : kalmar_aligned_alloc(0x1000, count);
+            cl_event stage_evt;
+            err = clEnqueueReadBuffer(queue, sbuf->dm, CL_FALSE, src_offset, count, stage,
+                                      list.size(), list.size()?list.data():NULL, &stage_evt);
+            assert(err == CL_SUCCESS);
+            clFlush(queue);
+            err = clEnqueueWriteBuffer(target, dbuf->dm, CL_FALSE, dst_offset, count, stage, 1, &stage_evt, &ent);
+            assert(err == CL_SUCCESS);
+            if (index >= 0) {
+                staging->release(index, ent);
             } else {
-                void* stage = kalmar_aligned_alloc(0x1000, count);
-                cl_event stage_evt;
-                err = clEnqueueReadBuffer(queue, sdm, CL_FALSE, src_offset, count, stage, list.size(), list.size()?list.data():NULL, &stage_evt);
-                assert(err == CL_SUCCESS);
-                err = clEnqueueWriteBuffer(getQueue(), ddm, CL_FALSE, dst_offset, count, stage, 1, &stage_evt, &ent);
-                assert(err == CL_SUCCESS);
                 err = clSetEventCallback(ent, CL_COMPLETE, &free_memory, stage);
                 assert(err == CL_SUCCESS);
             }
-            if(events[sdm]) {
-              err = clReleaseEvent(events[sdm]);
-              assert(err == CL_SUCCESS);
-              events.erase(sdm);
-            }
+            clReleaseEvent(stage_evt);
         }
+        submitted(target);
+        if (writer)
+            clReleaseEvent(writer);
+        release_dependencies(list);
+
+        retire(sbuf, ent, false);
+        retire(dbuf, ent, true);
         if (blocking) {
             err = clWaitForEvents(1, &ent);
             assert(err == CL_SUCCESS);
-            err = clReleaseEvent(ent);
-            assert(err == CL_SUCCESS);
-            if(events[ddm]) {
-              err = clReleaseEvent(events[sdm]);
-              assert(err == CL_SUCCESS);
-              events.erase(ddm);
-            }
-        } else {
-            if (events.find(ddm) != std::end(events)) {
-                err = clReleaseEvent(events[ddm]);
-                assert(err == CL_SUCCESS);
-            }
-            events[ddm] = ent;
         }
+        err = clReleaseEvent(ent);
+        assert(err == CL_SUCCESS);
+    }
+
+    std::shared_ptr<KalmarAsyncOp> EnqueueAsyncCopy(const void* src, void* dst, size_t count, hcMemcpyKind kind,
+                                                    struct dev_info* srcDev, struct dev_info* dstDev) override {
+        /// on devices sharing memory with the host, transfers are done by the
+        /// host through maps, and only copies between the host and a device
+        /// are asynchronous
+        if (hostUnified || srcDev == nullptr || dstDev == nullptr ||
+            (kind != hcMemcpyHostToDevice && kind != hcMemcpyDeviceToHost))
+            return nullptr;
+
+        /// the buffer is found from the dev_info of the device, whose data is
+        /// the start of the cl_buffer, src or dst may be offset from it
+        bool toDevice = (kind == hcMemcpyHostToDevice);
+        dev_info* device = toDevice ? dstDev : srcDev;
+        dev_info* host = toDevice ? srcDev : dstDev;
+        cl_buffer* buf = static_cast<cl_buffer*>(device->data);
+        size_t offset = toDevice ? static_cast<char*>(dst) - static_cast<char*>(device->data)
+                                 : static_cast<const char*>(src) - static_cast<char*>(device->data);
+
+        /// the host memory is read or written by the DMA engine once async
+        /// operations on it, i.e. CPU kernels, are done
+        if (auto op = host->writer.lock())
+            op->blockingWait();
+        host->writer.reset();
+        if (!toDevice) {
+            for (auto& reader : host->readers)
+                if (auto op = reader.lock())
+                    op->blockingWait();
+            host->readers.clear();
+        }
+
+        std::vector<cl_event> list;
+        append_dependencies(buf, toDevice, list);
+        cl_command_queue queue = getQueue();
+        cl_event evt;
+        cl_int err;
+        if (toDevice)
+            err = clEnqueueWriteBuffer(queue, buf->dm, CL_FALSE, offset, count, src,
+                                       list.size(), list.size()?list.data():NULL, &evt);
+        else
+            err = clEnqueueReadBuffer(queue, buf->dm, CL_FALSE, offset, count, dst,
+                                      list.size(), list.size()?list.data():NULL, &evt);
+        assert(err == CL_SUCCESS);
+        clFlush(queue);
+        release_dependencies(list);
+        retire(buf, evt, toDevice);
+
+        /// later uses of the host memory wait for the transfer
+        std::shared_ptr<KalmarAsyncOp> op = std::make_shared<OpenCLAsyncOp>(evt, this);
+        clReleaseEvent(evt);
+        if (toDevice)
+            host->readers.push_back(op);
+        else
+            host->writer = op;
+        return op;
     }
 
     void* map(void* device, size_t count, size_t offset, bool Write) override {
-        cl_mem dm = static_cast<cl_mem>(device);
+        cl_buffer* buf = static_cast<cl_buffer*>(device);
         cl_int err;
         cl_map_flags flags;
         if (Write)
             flags = CL_MAP_WRITE_INVALIDATE_REGION;
         else
             flags = CL_MAP_READ;
-        void* addr = nullptr;
-        if (events.find(dm) == std::end(events)) {
-            addr = clEnqueueMapBuffer(getQueue(), dm, CL_TRUE, flags, offset, count, 0, NULL, NULL, &err);
-            assert(err == CL_SUCCESS);
-        } else {
-            cl_event evt = events[dm];
-            addr = clEnqueueMapBuffer(getQueue(), dm, CL_TRUE, flags, offset, count, 1, &evt, NULL, &err);
-            assert(err == CL_SUCCESS);
-            err = clReleaseEvent(evt);
-            assert(err == CL_SUCCESS);
-            events.erase(dm);
-        }
+        std::vector<cl_event> list;
+        append_dependencies(buf, Write, list);
+        void* addr = clEnqueueMapBuffer(getQueue(), buf->dm, CL_TRUE, flags, offset, count,
+                                        list.size(), list.size()?list.data():NULL, NULL, &err);
+        assert(err == CL_SUCCESS);
+        release_dependencies(list);
         return addr;
     }
 
     void unmap(void* device, void* addr, size_t count, size_t offset, bool modify) override {
-        cl_mem dm = static_cast<cl_mem>(device);
+        cl_buffer* buf = static_cast<cl_buffer*>(device);
+        std::vector<cl_event> list;
+        append_dependencies(buf, true, list);
         cl_event evt;
-        cl_int err;
-        if (events.find(dm) != std::end(events)) {
-          err = clEnqueueUnmapMemObject(getQueue(), dm, addr, 1, &events[dm], &evt);
-          assert(err == CL_SUCCESS);
-        } else {
-          err = clEnqueueUnmapMemObject(getQueue(), dm, addr, 0, NULL, &evt);
-          assert(err == CL_SUCCESS);
-        }
-        if (events.find(dm) != std::end(events)) {
-            err = clReleaseEvent(events[dm]);
-            assert(err == CL_SUCCESS);
-        }
-        events[dm] = evt;
+        cl_command_queue queue = getQueue();
+        cl_int err = clEnqueueUnmapMemObject(queue, buf->dm, addr,
+                                             list.size(), list.size()?list.data():NULL, &evt);
+        assert(err == CL_SUCCESS);
+        submitted(queue);
+        release_dependencies(list);
+        retire(buf, evt, true);
+        err = clReleaseEvent(evt);
+        assert(err == CL_SUCCESS);
     }
 
     void LaunchKernel(void *kernel, size_t dim_ext, size_t *ext, size_t *local_size) override {
         cl_int err;
         if(!getDev()->check(local_size, dim_ext))
             local_size = NULL;
+        /// kernels only reading a buffer wait for its last writer, kernels
+        /// which may modify it wait for the readers since then as well
         std::vector<cl_event> eve;
-        std::for_each(std::begin(mems), std::end(mems),
-                      [&] (const cl_info& mm) {
-                        if (events.find(mm.dm) != std::end(events))
-                            eve.push_back(events[mm.dm]);
-                      });
-        std::sort(std::begin(eve), std::end(eve));
-        eve.erase(std::unique(std::begin(eve), std::end(eve)), std::end(eve));
+        for (const cl_info& mm : mems)
+            append_dependencies(mm.buf, mm.modify, eve);
         cl_event evt;
-        err = clEnqueueNDRangeKernel(getQueue(), (cl_kernel)kernel, dim_ext, NULL, ext, local_size,
-                                     eve.size(), eve.data(), &evt);
-        assert(err == CL_SUCCESS);
-        err = clSetEventCallback(evt, CL_COMPLETE, &callback_release_kernel, kernel);
+        cl_command_queue queue = getQueue();
+        err = clEnqueueNDRangeKernel(queue, (cl_kernel)kernel, dim_ext, NULL, ext, local_size,
+                                     eve.size(), eve.size()?eve.data():NULL, &evt);
         assert(err == CL_SUCCESS);
-
-        /// update latest event for non const buffer
-        std::set<cl_mem> mms;
-        std::for_each(std::begin(mems), std::end(mems),
-                      [&](const cl_info& mm) {
-                        if (mm.modify)
-                            mms.insert(mm.dm);
-                      });
-        std::for_each(std::begin(mms), std::end(mms),
-                      [&](const cl_mem& dm) {
-                        if (events.find(dm) != std::end(events))
-                            clReleaseEvent(events[dm]);
-                        clRetainEvent(evt);
-                        events[dm] = evt;
-                      });
+        submitted(queue);
+        kernels->release(static_cast<cl_kernel>(kernel));
+        release_dependencies(eve);
+
+        /// update the latest events of the buffers, each buffer is in mems
+        /// once, as modified if any of its uses may modify it
+        for (const cl_info& mm : mems)
+            retire(mm.buf, evt, mm.modify);
         clReleaseEvent(evt);
         mems.clear();
     }
@@ -319,20 +720,39 @@ public:
             clReleaseCommandQueue(queue);
     }
 private:
-    enum { queue_size = 1 };
-    cl_command_queue queues[queue_size];
-    int idx;
+    std::vector<cl_command_queue> queues;
+    std::atomic<unsigned> idx;
     std::vector<cl_info> mems;
-    cl_command_queue getQueue() { return queues[(idx++) % queue_size]; }
+    /// whether the device shares memory with the host, where transfers map
+    /// the buffers, otherwise they are staged through pinned host memory
+    bool hostUnified;
+    CLStagingPool* staging;
+    CLKernelPool* kernels;
+    cl_command_queue getQueue() { return queues[(idx++) % queues.size()]; }
+
+    /// commands of other command queues may wait for the command just
+    /// enqueued to queue, which is only sure to start once queue is flushed
+    void submitted(cl_command_queue queue) {
+        if (queues.size() > 1)
+            clFlush(queue);
+    }
 };
 
 class OpenCLDevice final : public KalmarDevice
 {
 public:
     OpenCLDevice(const cl_device_id device, const std::wstring& path)
-        : KalmarDevice(access_type_none), programs(), device(device), path(path), isAMD(false) {
+        : KalmarDevice(access_type_none), programs(), programsMutex(), device(device), path(path), isAMD(false),
+          queueCount(OPENCL_QUEUE_COUNT), hostUnified(false), staging(), kernels() {
         cl_int err;
 
+        /// environment variable HCC_OPENCL_QUEUES may be used to change the
+        /// number of command queues backing each queue
+        char* queues_env = getenv("HCC_OPENCL_QUEUES");
+        if (queues_env != nullptr && atoi(queues_env) > 0) {
+            queueCount = atoi(queues_env);
+        }
+
         cl_ulong memAllocSize;
         err = clGetDeviceInfo(device, CL_DEVICE_MAX_MEM_ALLOC_SIZE, sizeof(cl_ulong), &memAllocSize, NULL);
         assert(err == CL_SUCCESS);
@@ -358,6 +778,11 @@ public:
         assert(err == CL_SUCCESS);
         d.dimensions = dimensions;
         d.maxSizes = maxSizes;
+
+        cl_bool unified = CL_FALSE;
+        err = clGetDeviceInfo(device, CL_DEVICE_HOST_UNIFIED_MEMORY, sizeof(cl_bool), &unified, NULL);
+        hostUnified = (err == CL_SUCCESS && unified == CL_TRUE);
+        staging.init(device);
     }
 
     std::wstring get_path() const override { return path; }
@@ -370,18 +795,22 @@ public:
     uint32_t get_version() const override { return 0; }
 
     void BuildProgram(void* size, void* source, bool needsCompilation = true) override {
+        std::lock_guard<std::mutex> lock(programsMutex);
         if (programs.find(source) == std::end(programs))
             programs[source] = Kalmar::CLAMP::CLCompileKernels(device, size, source);
     }
 
     void* CreateKernel(const char* fun, void* size, void* source, bool needsCompilation = true) override {
-        cl_int err;
-        if (programs.find(source) == std::end(programs))
-            programs[source] = Kalmar::CLAMP::CLCompileKernels(device, size, source);
-        cl_program program = programs[source];
-        cl_kernel kernel = clCreateKernel(program, fun, &err);
-        assert(err == CL_SUCCESS);
-        return kernel;
+        cl_program program;
+        {
+            /// programs may be built on a background thread while kernels
+            /// are created, which wait for them
+            std::lock_guard<std::mutex> lock(programsMutex);
+            if (programs.find(source) == std::end(programs))
+                programs[source] = Kalmar::CLAMP::CLCompileKernels(device, size, source);
+            program = programs[source];
+        }
+        return kernels.acquire(program, fun);
     }
 
     bool check(size_t* local_size, size_t dim_ext) override {
@@ -406,22 +835,22 @@ public:
 
     void* create(size_t count, struct rw_info* /* not used */ ) override {
         cl_int err;
-        cl_mem dm = clCreateBuffer(context, CL_MEM_READ_WRITE, count, nullptr, &err);
+        /// buffers of devices sharing memory with the host are allocated in
+        /// host memory, so maps don't copy
+        cl_mem_flags flags = CL_MEM_READ_WRITE | (hostUnified ? CL_MEM_ALLOC_HOST_PTR : 0);
+        cl_mem dm = clCreateBuffer(context, flags, count, nullptr, &err);
         assert(err == CL_SUCCESS);
-        return dm;
+        return new cl_buffer(dm);
     }
 
     void release(void *device, struct rw_info* /* not used */ ) override {
-        cl_mem dm = static_cast<cl_mem>(device);
-        if (events.find(dm) != std::end(events)) {
-            clReleaseEvent(events[dm]);
-            events.erase(dm);
-        }
-        clReleaseMemObject(dm);
+        cl_buffer* buf = static_cast<cl_buffer*>(device);
+        clReleaseMemObject(buf->dm);
+        delete buf;
     }
 
     std::shared_ptr<KalmarQueue> createQueue(execute_order order = execute_in_order) override {
-        return std::shared_ptr<KalmarQueue>(new OpenCLQueue(this, device, isAMD));
+        return std::shared_ptr<KalmarQueue>(new OpenCLQueue(this, device, isAMD, queueCount, hostUnified, &staging, &kernels));
     }
 
     ~OpenCLDevice() {
@@ -434,12 +863,21 @@ private:
     /// important map, more than one kernel will be created on this device
     /// cache each program for them
     std::map<void*, cl_program> programs;
+    std::mutex programsMutex;
     struct DimMaxSize d;
     cl_device_id     device;
     std::wstring path;
     std::wstring description;
     size_t mem;
     bool isAMD;
+    // number of command queues backing each queue
+    int queueCount;
+    // whether the device shares memory with the host
+    bool hostUnified;
+    // pinned host memory transfers of discrete devices are staged through
+    CLStagingPool staging;
+    // kernel objects reused by later launches
+    CLKernelPool kernels;
 };
 
 struct CLFlag
@@ -494,7 +932,7 @@ public:
             auto Dev = new OpenCLDevice(devs[i], path[i]);
             if (i == 0)
                 def = Dev;
-            Devices.push_back(Dev);
+            add_device(Dev);
         }
     }
     ~OpenCLContext() {
@@ -514,6 +952,31 @@ static OpenCLContext ctx;
 namespace Kalmar {
 namespace CLAMP {
 
+// name or version string of the device, as returned by clGetDeviceInfo
+static std::string CLDeviceString(cl_device_id device, cl_device_info param)
+{
+    size_t len = 0;
+    cl_int err = clGetDeviceInfo(device, param, 0, NULL, &len);
+    assert(err == CL_SUCCESS);
+    std::vector<char> str(len + 1, '\0');
+    err = clGetDeviceInfo(device, param, len, str.data(), NULL);
+    assert(err == CL_SUCCESS);
+    return std::string(str.data());
+}
+
+static void CLPrintBuildLog(cl_program program, cl_device_id device)
+{
+    size_t len;
+    cl_int err = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &len);
+    assert(err == CL_SUCCESS);
+    char *msg = new char[len + 1];
+    err = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, len, msg, NULL);
+    assert(err == CL_SUCCESS);
+    msg[len] = '\0';
+    std::cerr << msg;
+    delete [] msg;
+}
+
 cl_program CLCompileKernels(cl_device_id& device, void* kernel_size_, void* kernel_source_)
 {
     cl_int err;
@@ -528,9 +991,12 @@ cl_program CLCompileKernels(cl_device_id& device, void* kernel_size_, void* kern
       build_options = "-cl-fp32-correctly-rounded-divide-sqrt";
     }
 
-    char name[64];
-    err = clGetDeviceInfo(device, CL_DEVICE_NAME, sizeof(name), name, NULL);
-    assert(err == CL_SUCCESS);
+    // Bitcode magic number. Assuming it's in SPIR, otherwise in OpenCL-C
+    bool spir = (source[0] == 'B' && source[1] == 'C');
+    std::string compile_options = build_options;
+    if (!spir) {
+        compile_options += " -D__ATTRIBUTE_WEAK__=";
+    }
 
     // calculate MD5 checksum
     unsigned char md5_hash[16];
@@ -538,125 +1004,95 @@ cl_program CLCompileKernels(cl_device_id& device, void* kernel_size_, void* kern
     MD5_CTX md5ctx;
     MD5_Init(&md5ctx);
     MD5_Update(&md5ctx, source, size);
-    // hash device name, prevent storing the same kernel for different device
-    MD5_Update(&md5ctx, name, strlen(name));
     MD5_Final(md5_hash, &md5ctx);
 
-    // compute compiled kernel file name
-    std::stringstream compiled_kernel_name;
-    compiled_kernel_name << "/tmp/";
-    compiled_kernel_name << std::setbase(16);
+    // the key of the kernel binary in the cache on disk: the binary depends
+    // on the kernel, the device, its driver and the build options
+    std::stringstream cache_key;
+    cache_key << "HCC OpenCL kernel cache 1\n" << size << " " << std::setbase(16) << std::setfill('0');
     for (int i = 0; i < 16; ++i) {
-        compiled_kernel_name << static_cast<unsigned int>(md5_hash[i]);
+        cache_key << std::setw(2) << static_cast<unsigned int>(md5_hash[i]);
     }
-    compiled_kernel_name << ".bin";
-
-    //std::cout << "Try load precompiled kernel: " << compiled_kernel_name.str() << std::endl;
+    cache_key << std::setbase(10) << "\n" << CLDeviceString(device, CL_DEVICE_NAME)
+              << "\n" << CLDeviceString(device, CL_DRIVER_VERSION)
+              << "\n" << compile_options << "\n";
 
     // check if pre-compiled kernel binary exist
-    std::ifstream precompiled_kernel(compiled_kernel_name.str(), std::ifstream::binary);
-    if (precompiled_kernel) {
+    Kalmar::KernelCache& cache = Kalmar::KernelCache::get();
+    Kalmar::KernelCache::Blob blob;
+    if (cache.load("cl", cache_key.str(), blob)) {
         // use pre-compiled kernel binary
-        precompiled_kernel.seekg(0, std::ios_base::end);
-        size_t len = precompiled_kernel.tellg();
-        precompiled_kernel.seekg(0, std::ios_base::beg);
-        //std::cout << "Length of precompiled kernel: " << len << std::endl;
-        unsigned char* compiled_kernel = new unsigned char[len];
-        precompiled_kernel.read(reinterpret_cast<char*>(compiled_kernel), len);
-        precompiled_kernel.close();
-
-        const unsigned char *ks = (const unsigned char *)compiled_kernel;
+        size_t len = blob.size();
+        const unsigned char *ks = reinterpret_cast<const unsigned char *>(blob.data());
         program = clCreateProgramWithBinary(Kalmar::context, 1, &device, &len, &ks, NULL, &err);
         if (err == CL_SUCCESS)
             err = clBuildProgram(program, 1, &device, build_options.c_str(), NULL, NULL);
-        if (err != CL_SUCCESS) {
-            size_t len;
-            err = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &len);
-            assert(err == CL_SUCCESS);
-            char *msg = new char[len + 1];
-            err = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, len, msg, NULL);
-            assert(err == CL_SUCCESS);
-            msg[len] = '\0';
-            std::cerr << msg;
-            delete [] msg;
-            exit(1);
-        }
-        delete [] compiled_kernel;
-    } else {
-        // pre-compiled kernel binary doesn't exist
-        // call CL compiler
-
-        if (source[0] == 'B' && source[1] == 'C') {
-            // Bitcode magic number. Assuming it's in SPIR
-            auto str = (const unsigned char*)source;
-            program = clCreateProgramWithBinary(Kalmar::context, 1, &device, &size, &str, NULL, &err);
-            if (err == CL_SUCCESS)
-                err = clBuildProgram(program, 1, &device, build_options.c_str(), NULL, NULL);
-        } else {
-            // in OpenCL-C
-            auto str = source;
-            program = clCreateProgramWithSource(Kalmar::context, 1, &str, &size, &err);
-            if (err == CL_SUCCESS) {
-                build_options += " -D__ATTRIBUTE_WEAK__=";
-                err = clBuildProgram(program, 1, &device, build_options.c_str(), NULL, NULL);
-            }
-        }
-        if (err != CL_SUCCESS) {
-            size_t len;
-            err = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, 0, NULL, &len);
-            assert(err == CL_SUCCESS);
-            char *msg = new char[len + 1];
-            err = clGetProgramBuildInfo(program, device, CL_PROGRAM_BUILD_LOG, len, msg, NULL);
-            assert(err == CL_SUCCESS);
-            msg[len] = '\0';
-            std::cerr << msg;
-            delete [] msg;
-            exit(1);
+        if (err == CL_SUCCESS)
+            return program;
+
+        // a binary the driver no longer accepts is compiled again
+        if (program != nullptr) {
+            clReleaseProgram(program);
+            program = nullptr;
         }
+    }
+    blob.reset();
 
-        //Get the number of devices attached with program object
-        cl_uint nDevices = 0;
-        err = clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint),&nDevices, NULL);
-        assert(nDevices == 1);
-        assert(err == CL_SUCCESS);
+    // pre-compiled kernel binary doesn't exist
+    // call CL compiler
+    if (spir) {
+        auto str = (const unsigned char*)source;
+        program = clCreateProgramWithBinary(Kalmar::context, 1, &device, &size, &str, NULL, &err);
+        if (err == CL_SUCCESS)
+            err = clBuildProgram(program, 1, &device, compile_options.c_str(), NULL, NULL);
+    } else {
+        auto str = source;
+        program = clCreateProgramWithSource(Kalmar::context, 1, &str, &size, &err);
+        if (err == CL_SUCCESS)
+            err = clBuildProgram(program, 1, &device, compile_options.c_str(), NULL, NULL);
+    }
+    if (err != CL_SUCCESS) {
+        CLPrintBuildLog(program, device);
+        exit(1);
+    }
 
-        //Get the Id of all the attached devices
-        cl_device_id *devices = new cl_device_id[nDevices];
-        err = clGetProgramInfo(program, CL_PROGRAM_DEVICES, sizeof(cl_device_id) * nDevices, devices, NULL);
-        assert(err == CL_SUCCESS);
+    if (!cache.enabled())
+        return program;
 
-        // Get the sizes of all the binary objects
-        size_t *pgBinarySizes = new size_t[nDevices];
-        err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * nDevices, pgBinarySizes, NULL);
-        assert(err == CL_SUCCESS);
+    //Get the number of devices attached with program object
+    cl_uint nDevices = 0;
+    err = clGetProgramInfo(program, CL_PROGRAM_NUM_DEVICES, sizeof(cl_uint),&nDevices, NULL);
+    assert(nDevices == 1);
+    assert(err == CL_SUCCESS);
 
-        // Allocate storage for each binary objects
-        unsigned char **pgBinaries = new unsigned char*[nDevices];
-        for (cl_uint i = 0; i < nDevices; i++)
-        {
-            pgBinaries[i] = new unsigned char[pgBinarySizes[i]];
-        }
+    // Get the sizes of all the binary objects
+    size_t *pgBinarySizes = new size_t[nDevices];
+    err = clGetProgramInfo(program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t) * nDevices, pgBinarySizes, NULL);
+    assert(err == CL_SUCCESS);
 
-        // Get all the binary objects
-        err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*) * nDevices, pgBinaries, NULL);
-        assert(err == CL_SUCCESS);
+    // Allocate storage for each binary objects
+    unsigned char **pgBinaries = new unsigned char*[nDevices];
+    for (cl_uint i = 0; i < nDevices; i++)
+    {
+        pgBinaries[i] = new unsigned char[pgBinarySizes[i]];
+    }
 
-        // save compiled kernel binary
-        std::ofstream compiled_kernel(compiled_kernel_name.str(), std::ostream::binary);
-        compiled_kernel.write(reinterpret_cast<const char*>(pgBinaries[0]), pgBinarySizes[0]);
-        compiled_kernel.close();
+    // Get all the binary objects
+    err = clGetProgramInfo(program, CL_PROGRAM_BINARIES, sizeof(unsigned char*) * nDevices, pgBinaries, NULL);
+    assert(err == CL_SUCCESS);
 
-        //std::cout << "Kernel written to: " << compiled_kernel_name.str() << std::endl;
+    // save compiled kernel binary
+    if (pgBinarySizes[0] > 0) {
+        cache.store("cl", cache_key.str(), pgBinaries[0], pgBinarySizes[0]);
+    }
 
-        // release memory
-        for (cl_uint i = 0; i < nDevices; ++i) {
-            delete [] pgBinaries[i];
-        }
-        delete [] pgBinaries;
-        delete [] pgBinarySizes;
-        delete [] devices;
+    // release memory
+    for (cl_uint i = 0; i < nDevices; ++i) {
+        delete [] pgBinaries[i];
+    }
+    delete [] pgBinaries;
+    delete [] pgBinarySizes;
 
-    } // if (precompiled_kernel)
     return program;
 }
 
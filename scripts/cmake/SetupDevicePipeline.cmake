@@ -0,0 +1,11 @@
+macro(setup_DevicePipeline dest_dir name)
+
+if(EXISTS "${dest_dir}/${name}" AND IS_SYMLINK "${dest_dir}/${name}")
+MESSAGE("Device pipeline tool seems to present.")
+else(EXISTS "${dest_dir}/${name}" AND IS_SYMLINK "${dest_dir}/${name}")
+MESSAGE("Setting up device pipeline tool.")
+execute_process( COMMAND ln -s ${PROJECT_SOURCE_DIR}/${name} ${dest_dir}/${name} )
+execute_process( COMMAND sh ${PROJECT_SOURCE_DIR}/${name}/DevicePipeline.patch
+                 WORKING_DIRECTORY ${PROJECT_SOURCE_DIR})
+endif()
+endmacro()
@@ -83,9 +83,10 @@ bool test1D() {
   std::cout << "after pfe3\n";
 #endif
 
-  // now there must be 1 pending async operations for the accelerator_view
-  // pfe1 and pfe2 must be completed by now
-  ret &= (hc::accelerator().get_default_view().get_pending_async_ops() == 1);
+  // now there must be at most 3 pending async operations for the
+  // accelerator_view, pfe2 and pfe3 wait for the previous ones on the device
+  // so the host is not blocked
+  ret &= (hc::accelerator().get_default_view().get_pending_async_ops() <= 3);
 
   // for this test case we deliberately NOT wait on kernels
   // we want to check when array_view instances go to destruction
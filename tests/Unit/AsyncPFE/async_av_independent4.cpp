@@ -91,8 +91,9 @@ bool test1D() {
   std::cout << "after pfe3\n";
 #endif
 
-  // now there must be 3 pending async operations for the accelerator_view
-  ret &= (hc::accelerator().get_default_view().get_pending_async_ops() == 3);
+  // now there must be at most 3 pending async operations for the
+  // accelerator_view, async operations retire as they complete
+  ret &= (hc::accelerator().get_default_view().get_pending_async_ops() <= 3);
 
   // for this test case we deliberately NOT wait on kernels
   // we want to check when array_view instances go to destruction
@@ -0,0 +1,65 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test typed buffers in the dynamic group segment, two of them are reserved
+// in a tiled_extent and reversed within each tile, and a dynamic group
+// segment larger than the tile static memory of the accelerator throws
+
+#define SIZE (4096)
+#define TILE (256)
+
+int main() {
+  bool ret = true;
+
+  using namespace hc;
+
+  std::vector<int> host(SIZE);
+  for (int i = 0; i < SIZE; ++i)
+    host[i] = i;
+  array_view<int, 1> av(SIZE, host);
+
+  dynamic_tile_static<char> flags(TILE);
+  dynamic_tile_static<int> values(TILE, 16);
+  tiled_extent<1> te = extent<1>(SIZE).tile(TILE);
+  te.reserve(flags);
+  te.reserve(values);
+  ret &= (te.get_dynamic_group_segment_size() >= TILE * (sizeof(char) + sizeof(int)));
+  ret &= (values.size() == TILE);
+  ret &= (values.get_alignment() == 16);
+
+  parallel_for_each(te, [=](tiled_index<1>& tidx) [[hc]] {
+    int tid = tidx.local[0];
+    flags[tid] = 1;
+    values[tid] = av[tidx.global];
+    tidx.barrier.wait();
+    if (flags[TILE - 1 - tid] == 1)
+      av[tidx.global] = values[TILE - 1 - tid];
+  }).wait();
+  av.synchronize();
+
+  for (int i = 0; i < SIZE; ++i)
+    ret &= (host[i] == (i / TILE) * TILE + (TILE - 1 - i % TILE));
+
+  // more than the tile static memory
+  size_t max = accelerator().get_max_tile_static_size();
+  if (max != 0) {
+    dynamic_tile_static<char> huge(max + 1);
+    tiled_extent<1> too_large = extent<1>(SIZE).tile(TILE);
+    too_large.reserve(huge);
+    bool thrown = false;
+    try {
+      parallel_for_each(too_large, [=](tiled_index<1>& tidx) [[hc]] {
+        huge[tidx.local[0]] = 0;
+      }).wait();
+    } catch (runtime_exception&) {
+      thrown = true;
+    }
+    ret &= thrown;
+  }
+
+  return !(ret == true);
+}
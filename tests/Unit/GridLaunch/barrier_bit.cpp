@@ -0,0 +1,71 @@
+// XFAIL: Linux
+// RUN: %hc -lhc_am %s -o %t.out && %t.out
+
+#include "grid_launch.hpp"
+#include "hc_am.hpp"
+#include <iostream>
+
+#define GRID_SIZE 256
+#define TILE_SIZE 16
+
+const int SIZE = GRID_SIZE*TILE_SIZE;
+
+__attribute__((hc_grid_launch)) void fill(grid_launch_parm lp, int *x, int value) {
+  int i = hc_get_workitem_id(0) + hc_get_group_id(0)*lp.group_dim.x;
+
+  x[i] = value + i;
+}
+
+__attribute__((hc_grid_launch)) void add(grid_launch_parm lp, int *x, const int *y, const int *z) {
+  int i = hc_get_workitem_id(0) + hc_get_group_id(0)*lp.group_dim.x;
+
+  x[i] = y[i] + z[i];
+}
+
+int main(void) {
+
+  int *data = (int *)malloc(SIZE*sizeof(int));
+
+  auto acc = hc::accelerator();
+  int* data1_d = (int*)hc::am_alloc(SIZE*sizeof(int), acc, 0);
+  int* data2_d = (int*)hc::am_alloc(SIZE*sizeof(int), acc, 0);
+  int* data3_d = (int*)hc::am_alloc(SIZE*sizeof(int), acc, 0);
+
+  grid_launch_parm lp;
+  grid_launch_init(&lp);
+
+  lp.grid_dim.x = GRID_SIZE;
+  lp.group_dim.x = TILE_SIZE;
+
+  hc::completion_future cf;
+  lp.cf = &cf;
+
+  bool ret = 0;
+  for(int iter = 0; iter < 4 && !ret; ++iter) {
+    // the two fills are independent and may overlap
+    lp.barrier_bit = barrier_bit_none;
+    fill(lp, data1_d, iter);
+    fill(lp, data2_d, 2 * iter);
+
+    // the sum waits for both of them
+    lp.barrier_bit = barrier_bit_wait;
+    add(lp, data3_d, data1_d, data2_d);
+    lp.cf->wait();
+
+    hc::am_copy(data, data3_d, SIZE*sizeof(int));
+
+    for(int i = 0; i < SIZE; ++i) {
+      if(data[i] != 3 * iter + 2 * i) {
+        ret = 1;
+        break;
+      }
+    }
+  }
+
+  hc::am_free(data1_d);
+  hc::am_free(data2_d);
+  hc::am_free(data3_d);
+  free(data);
+
+  return ret;
+}
@@ -0,0 +1,62 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+
+// test waiting on short kernels with hcWaitModeAdaptive, both explicitly and
+// as the wait mode of an accelerator_view. the waits are counted in the
+// spin, yield or block statistics of the runtime
+
+#define VEC_SIZE (64)
+#define ITERATION (128)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().create_view();
+  ret &= (av.get_wait_mode() == hcWaitModeBlocked);
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) table[i] = 0;
+
+  uint64_t before = hc::get_wait_spin_count() + hc::get_wait_yield_count() + hc::get_wait_block_count();
+
+  // explicit wait mode on each completion_future
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::completion_future fut = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    });
+    fut.wait(hcWaitModeAdaptive);
+  }
+
+  // wait mode inherited from the accelerator_view
+  av.set_wait_mode(hcWaitModeAdaptive);
+  ret &= (av.get_wait_mode() == hcWaitModeAdaptive);
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::completion_future fut = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    });
+    fut.wait();
+  }
+  av.wait();
+
+  uint64_t after = hc::get_wait_spin_count() + hc::get_wait_yield_count() + hc::get_wait_block_count();
+
+#if TEST_DEBUG
+  std::cout << "spin: " << hc::get_wait_spin_count()
+            << ", yield: " << hc::get_wait_yield_count()
+            << ", block: " << hc::get_wait_block_count() << "\n";
+#endif
+
+  // every wait on a pending kernel lands in one of the phases
+  ret &= (after - before >= 2 * ITERATION);
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == 2 * ITERATION);
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,94 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test pooled allocations with am_alloc: small blocks are sliced from slabs
+// registered in the memory tracker, freed blocks are handed out again, and
+// blocks freed asynchronously stay usable by the kernels enqueued before
+
+#define VEC_SIZE (1024)
+#define ALLOC_COUNT (64)
+
+#define TEST_DEBUG (0)
+
+bool test_reuse(hc::accelerator& acc, unsigned flags) {
+  bool ret = true;
+
+  std::vector<void*> ptrs;
+  for (int i = 0; i < ALLOC_COUNT; ++i) {
+    void* ptr = hc::am_alloc(VEC_SIZE * sizeof(int), acc, flags | amPooled);
+    ret &= (ptr != nullptr);
+    ptrs.push_back(ptr);
+  }
+
+  // every block is tracked through its slab
+  hc::AmPointerInfo info(NULL, NULL, 0, acc, false, false);
+  for (auto ptr : ptrs) {
+    ret &= (hc::am_memtracker_getinfo(&info, ptr) == AM_SUCCESS);
+    ret &= (info._sizeBytes >= VEC_SIZE * sizeof(int));
+  }
+
+  // a freed block is handed out again
+  void* last = ptrs.back();
+  ptrs.pop_back();
+  ret &= (hc::am_free(last) == AM_SUCCESS);
+  void* again = hc::am_alloc(VEC_SIZE * sizeof(int), acc, flags | amPooled);
+  ret &= (again == last);
+  ptrs.push_back(again);
+
+  for (auto ptr : ptrs) {
+    ret &= (hc::am_free(ptr) == AM_SUCCESS);
+  }
+
+#if TEST_DEBUG
+  std::cout << "reuse " << flags << ": " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+bool test_free_async(hc::accelerator& acc) {
+  bool ret = true;
+
+  hc::accelerator_view av = acc.get_default_view();
+  int* scratch = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, amPooled));
+  int* result = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, amHostPinned));
+  if (scratch == nullptr || result == nullptr)
+    return false;
+
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    scratch[idx[0]] = idx[0];
+  });
+  hc::completion_future done = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    result[idx[0]] = scratch[idx[0]] * 2;
+  });
+  hc::am_free_async(scratch, av);
+  done.wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == i * 2);
+  }
+
+#if TEST_DEBUG
+  std::cout << "free_async: " << ret << "\n";
+#endif
+
+  hc::am_free(result);
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+
+  ret &= test_reuse(acc, 0);
+  ret &= test_reuse(acc, amHostPinned);
+  ret &= test_free_async(acc);
+
+  return !(ret == true);
+}
@@ -0,0 +1,66 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test asynchronous copies with am_copy_async in the order of an
+// accelerator_view: host to device, a kernel using the copy, and device
+// back to pageable or pinned host memory, without waiting in between
+
+#define VEC_SIZE (1024 * 1024)
+#define ITERATION (8)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator& acc, bool pinned) {
+  bool ret = true;
+
+  hc::accelerator_view av = acc.get_default_view();
+  std::vector<int> pageable(VEC_SIZE);
+  int* host = pinned ? static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, amHostPinned))
+                     : pageable.data();
+  int* device = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, 0));
+  if (host == nullptr || device == nullptr)
+    return false;
+
+  for (int i = 0; i < VEC_SIZE; ++i) host[i] = i;
+
+  hc::completion_future done;
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::am_copy_async(device, host, VEC_SIZE * sizeof(int), av);
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      device[idx[0]] += 1;
+    });
+    done = hc::am_copy_async(host, device, VEC_SIZE * sizeof(int), av);
+  }
+  done.wait();
+  av.wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == i + ITERATION);
+  }
+
+#if TEST_DEBUG
+  std::cout << "pinned " << pinned << ": " << ret << "\n";
+#endif
+
+  hc::am_free(device);
+  if (pinned) {
+    hc::am_free(host);
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+
+  ret &= test(acc, false);
+  ret &= test(acc, true);
+
+  return !(ret == true);
+}
@@ -0,0 +1,114 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// test device memory and signals shared between processes: this process
+// shares an allocation and a signal, and runs itself as a child process
+// which opens them, checks the memory, updates it in a kernel, then signals
+// this process, which sees the update in the same memory
+
+#define VEC_SIZE (1024 * 1024)
+
+template <typename T>
+static std::string encode(const T& value) {
+  std::string hex;
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&value);
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    char digits[3];
+    snprintf(digits, sizeof(digits), "%02x", bytes[i]);
+    hex += digits;
+  }
+  return hex;
+}
+
+template <typename T>
+static bool decode(const char* hex, T* value) {
+  if (strlen(hex) != 2 * sizeof(T))
+    return false;
+  unsigned char* bytes = reinterpret_cast<unsigned char*>(value);
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    unsigned int byte = 0;
+    if (sscanf(hex + 2 * i, "%2x", &byte) != 1)
+      return false;
+    bytes[i] = byte;
+  }
+  return true;
+}
+
+static int child(const char* memory, const char* signal) {
+  hc::AmIpcMemoryHandle memoryHandle;
+  hc::AmIpcSignalHandle signalHandle;
+  if (!decode(memory, &memoryHandle) || !decode(signal, &signalHandle))
+    return 1;
+
+  hc::accelerator acc;
+  void* ptr = nullptr;
+  hc::am_ipc_signal_t done;
+  if (hc::am_ipc_open_handle(memoryHandle, acc, &ptr) != AM_SUCCESS ||
+      hc::am_ipc_signal_open(signalHandle, &done) != AM_SUCCESS)
+    return 1;
+
+  bool ret = true;
+  int* shared = static_cast<int*>(ptr);
+  std::vector<int> host(VEC_SIZE);
+  hc::am_copy(host.data(), shared, VEC_SIZE * sizeof(int));
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == i);
+  }
+
+  hc::parallel_for_each(acc.get_default_view(), hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+    shared[idx[0]] *= 2;
+  }).wait();
+
+  hc::am_ipc_signal_store(done, 0);
+  hc::am_ipc_signal_destroy(done);
+  ret &= (hc::am_ipc_close_handle(ptr) == AM_SUCCESS);
+  return !(ret == true);
+}
+
+int main(int argc, char* argv[]) {
+  if (argc == 3)
+    return child(argv[1], argv[2]);
+
+  bool ret = true;
+
+  hc::accelerator acc;
+  int* device = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, 0));
+  if (device == nullptr)
+    return 1;
+  std::vector<int> host(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) host[i] = i;
+  hc::am_copy(device, host.data(), VEC_SIZE * sizeof(int));
+
+  hc::AmIpcMemoryHandle memoryHandle;
+  hc::AmIpcSignalHandle signalHandle;
+  hc::am_ipc_signal_t done;
+  ret &= (hc::am_ipc_get_handle(device, &memoryHandle) == AM_SUCCESS);
+  ret &= (memoryHandle._offset == 0);
+  ret &= (hc::am_ipc_signal_create(1, &done, &signalHandle) == AM_SUCCESS);
+
+  // pointers which aren't tracked device memory can't be shared
+  hc::AmIpcMemoryHandle untracked;
+  ret &= (hc::am_ipc_get_handle(host.data(), &untracked) != AM_SUCCESS);
+
+  std::string command = std::string(argv[0]) + " " + encode(memoryHandle) + " " + encode(signalHandle);
+  ret &= (std::system(command.c_str()) == 0);
+  ret &= (hc::am_ipc_signal_wait(done, 0) == 0);
+
+  hc::am_copy(host.data(), device, VEC_SIZE * sizeof(int));
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == i * 2);
+  }
+
+  hc::am_ipc_signal_destroy(done);
+  hc::am_free(device);
+
+  return !(ret == true);
+}
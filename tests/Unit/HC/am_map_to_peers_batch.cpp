@@ -0,0 +1,97 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test mapping many allocations to the peers of an accelerator at once with
+// am_map_to_peers_batch, and mapping allocations to a fixed set of peers as
+// they are allocated with amMapToPeers. kernels on each peer read the memory
+// of the first GPU accelerator
+
+#define VEC_SIZE (1024)
+#define ALLOC_COUNT (256)
+
+#define TEST_DEBUG (0)
+
+bool check(std::vector<hc::accelerator>& peers, int* ptr, int value) {
+  bool ret = true;
+
+  for (auto& peer : peers) {
+    int* result = static_cast<int*>(hc::am_alloc(sizeof(int), peer, amHostPinned));
+    if (result == nullptr)
+      return false;
+    *result = 0;
+    hc::parallel_for_each(peer.get_default_view(), hc::extent<1>(1), [=](hc::index<1> idx) __HC__ {
+      *result = ptr[VEC_SIZE - 1];
+    }).wait();
+    ret &= (*result == value);
+    hc::am_free(result);
+  }
+  return ret;
+}
+
+bool test(hc::accelerator& acc, std::vector<hc::accelerator>& peers, unsigned flags, bool batch) {
+  bool ret = true;
+
+  std::vector<void*> ptrs;
+  for (int i = 0; i < ALLOC_COUNT; ++i) {
+    void* ptr = hc::am_alloc(VEC_SIZE * sizeof(int), acc, flags);
+    ret &= (ptr != nullptr);
+    ptrs.push_back(ptr);
+  }
+  if (!ret)
+    return false;
+
+  if (batch) {
+    ret &= (hc::am_map_to_peers_batch(ptrs.size(), ptrs.data(), peers.size(), peers.data()) == AM_SUCCESS);
+  }
+
+  for (int i = 0; i < ALLOC_COUNT; i += ALLOC_COUNT / 4) {
+    std::vector<int> init(VEC_SIZE, i);
+    hc::am_copy(ptrs[i], init.data(), VEC_SIZE * sizeof(int));
+    ret &= check(peers, static_cast<int*>(ptrs[i]), i);
+  }
+
+#if TEST_DEBUG
+  std::cout << "flags " << flags << " batch " << batch << ": " << ret << "\n";
+#endif
+
+  for (auto ptr : ptrs) {
+    hc::am_free(ptr);
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  std::vector<hc::accelerator> gpus;
+  for (auto& acc : hc::accelerator::get_all()) {
+    if (acc.is_hsa_accelerator()) {
+      gpus.push_back(acc);
+    }
+  }
+  if (gpus.empty())
+    return 0;
+
+  hc::accelerator acc = gpus[0];
+  std::vector<hc::accelerator> peers;
+  for (auto& gpu : gpus) {
+    if (gpu == acc || acc.get_is_peer(gpu)) {
+      peers.push_back(gpu);
+    }
+  }
+
+  ret &= test(acc, peers, 0, true);
+  ret &= test(acc, peers, amPooled, true);
+
+  ret &= (hc::am_set_alloc_peers(acc, peers.size(), peers.data()) == AM_SUCCESS);
+  ret &= test(acc, peers, amMapToPeers, false);
+  ret &= test(acc, peers, amMapToPeers | amPooled, false);
+  ret &= (hc::am_set_alloc_peers(acc, 0, nullptr) == AM_SUCCESS);
+
+  return !(ret == true);
+}
@@ -0,0 +1,70 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+
+// test filling device memory with 8, 16 and 32-bit patterns, with am_memset
+// and with am_memset_async ordered on an accelerator_view, including ranges
+// which don't start or end on a 32-bit boundary
+
+#define VEC_SIZE (4099)
+
+#define TEST_DEBUG (0)
+
+template <typename T>
+bool check(hc::accelerator& acc, const T* device, size_t offset, size_t count, T value) {
+  bool ret = true;
+
+  std::vector<T> result(VEC_SIZE);
+  hc::am_copy(result.data(), device, VEC_SIZE * sizeof(T));
+  for (size_t i = 0; i < VEC_SIZE; ++i) {
+    T expected = (i >= offset && i < offset + count) ? value : T(0);
+    ret &= (result[i] == expected);
+  }
+  return ret;
+}
+
+template <typename T>
+bool test(hc::accelerator& acc, T value) {
+  bool ret = true;
+
+  hc::accelerator_view av = acc.get_default_view();
+  T* device = static_cast<T*>(hc::am_alloc(VEC_SIZE * sizeof(T), acc, 0));
+  if (device == nullptr)
+    return false;
+
+  for (size_t offset = 0; offset < 4; ++offset) {
+    size_t count = VEC_SIZE - offset - 3;
+
+    ret &= (hc::am_memset(device, 0, VEC_SIZE, sizeof(T)) == AM_SUCCESS);
+    ret &= (hc::am_memset(device + offset, value, count, sizeof(T)) == AM_SUCCESS);
+    ret &= check(acc, device, offset, count, value);
+
+    ret &= (hc::am_memset(device, 0, VEC_SIZE, sizeof(T)) == AM_SUCCESS);
+    hc::am_memset_async(device + offset, value, count, av).wait();
+    ret &= check(acc, device, offset, count, value);
+  }
+
+#if TEST_DEBUG
+  std::cout << sizeof(T) * 8 << "-bit: " << ret << "\n";
+#endif
+
+  hc::am_free(device);
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+
+  ret &= test<uint8_t>(acc, 0xa5);
+  ret &= test<uint16_t>(acc, 0xa55a);
+  ret &= test<uint32_t>(acc, 0xdeadbeef);
+
+  return !(ret == true);
+}
@@ -0,0 +1,57 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// test device memory allocated with amPeerDirect for NICs to register: its
+// range is a whole allocation of its own, even with amPooled, the tracker
+// reports it, and kernels and copies use it as any device memory. other
+// memory has no range
+
+#define VEC_SIZE (1000)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  if (!acc.is_hsa_accelerator())
+    return 0;
+
+  int* ptr = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, amPeerDirect | amPooled));
+  ret &= (ptr != nullptr);
+  if (!ret)
+    return 1;
+
+  hc::AmRdmaRange range;
+  ret &= (hc::am_rdma_get_range(ptr + 10, &range) == AM_SUCCESS);
+  ret &= (range._basePointer == ptr);
+  ret &= (range._offset == 10 * sizeof(int));
+  ret &= (range._sizeBytes >= VEC_SIZE * sizeof(int));
+  ret &= (range._sizeBytes % 4096 == 0);
+  ret &= (reinterpret_cast<uintptr_t>(range._basePointer) % 4096 == 0);
+
+  hc::AmPointerInfo info(nullptr, nullptr, 0, acc, false, false);
+  ret &= (hc::am_memtracker_getinfo(&info, ptr) == AM_SUCCESS);
+  ret &= info._isPeerDirect;
+  ret &= info._isInDeviceMem;
+
+  hc::parallel_for_each(acc.get_default_view(), hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    ptr[idx[0]] = idx[0];
+  }).wait();
+  std::vector<int> result(VEC_SIZE);
+  ret &= (hc::am_copy(result.data(), ptr, VEC_SIZE * sizeof(int)) == AM_SUCCESS);
+  for (int i = 0; i < VEC_SIZE; ++i)
+    ret &= (result[i] == i);
+  ret &= (hc::am_free(ptr) == AM_SUCCESS);
+
+  // pooled and pinned host memory can't be registered through a range
+  void* pooled = hc::am_alloc(VEC_SIZE, acc, amPooled);
+  ret &= (hc::am_rdma_get_range(pooled, &range) == AM_ERROR_MISC);
+  hc::am_free(pooled);
+  ret &= (hc::am_alloc(VEC_SIZE, acc, amPeerDirect | amHostPinned) == nullptr);
+
+  return !(ret == true);
+}
@@ -0,0 +1,79 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <utility>
+#include <vector>
+
+// test moving arrays and array_views: the moved-to object refers to the
+// same data, and a moved array is still used as an array by kernels
+
+#define VEC_SIZE (1024)
+
+#define TEST_DEBUG (0)
+
+bool test_array() {
+  bool ret = true;
+
+  std::vector<int> init(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) init[i] = i;
+
+  hc::array<int, 1> a(hc::extent<1>(VEC_SIZE), init.begin(), init.end());
+  hc::array<int, 1> b(std::move(a));
+
+  hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [&b](hc::index<1> idx) __HC__ {
+    b[idx] += 1;
+  }).wait();
+
+  hc::array<int, 1> c(hc::extent<1>(VEC_SIZE));
+  c = std::move(b);
+
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(c, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == i + 1);
+  }
+
+#if TEST_DEBUG
+  std::cout << "array: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+bool test_array_view() {
+  bool ret = true;
+
+  hc::array_view<int, 1> av(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) av[i] = i;
+
+  std::vector< hc::array_view<int, 1> > views;
+  views.push_back(std::move(av));
+  hc::array_view<int, 1> moved = std::move(views[0]);
+
+  hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    moved[idx] *= 2;
+  });
+
+  hc::array_view<const int, 1> cav(moved);
+  hc::array_view<const int, 1> cmoved(std::move(cav));
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (cmoved[i] == i * 2);
+  }
+
+#if TEST_DEBUG
+  std::cout << "array_view: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test_array();
+  ret &= test_array_view();
+
+  return !(ret == true);
+}
@@ -0,0 +1,68 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test placing the data of arrays in host or device memory, or letting it
+// move between them: the contents are kept across each move, and kernels
+// and the host see the same data whichever memory it's in
+
+#define VEC_SIZE (4096)
+#define ITERATION (64)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator_view av, hc::hcMemoryPlacement placement) {
+  bool ret = true;
+
+  std::vector<int> init(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) init[i] = i;
+
+  hc::array<int, 1> table(hc::extent<1>(VEC_SIZE), init.begin(), init.end(), av);
+  table.set_placement(placement);
+  ret &= (table.get_placement() == placement);
+
+  // mostly used by kernels
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&table](hc::index<1> idx) __HC__ {
+      table[idx] += 1;
+    }).wait();
+  }
+
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(table, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == i + ITERATION);
+  }
+
+  // mostly used on the host, where it's accessible
+  if (table.get_cpu_access_type() != hc::access_type_none && table.data() != nullptr) {
+    for (int n = 0; n < ITERATION; ++n) {
+      table[n] = -n;
+    }
+    for (int n = 0; n < ITERATION; ++n) {
+      ret &= (table[n] == -n);
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << "placement " << placement << ": " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  ret &= test(av, hc::hcMemoryPlacementDefault);
+  ret &= test(av, hc::hcMemoryPlacementHost);
+  ret &= test(av, hc::hcMemoryPlacementDevice);
+  ret &= test(av, hc::hcMemoryPlacementAuto);
+
+  return !(ret == true);
+}
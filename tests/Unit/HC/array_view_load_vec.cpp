@@ -0,0 +1,74 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_short_vector.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test the loads and stores of short vectors through array_views, and of
+// array_views reinterpreted as short vectors, unaligned or out of bounds
+// short vectors throw on the host
+
+#define SIZE (1024)
+
+using namespace hc::short_vector;
+
+int main() {
+  bool ret = true;
+
+  std::vector<float> host(SIZE);
+  for (int i = 0; i < SIZE; ++i)
+    host[i] = i;
+  hc::array_view<float, 1> av(SIZE, host);
+  hc::array_view<const float, 1> cav(av);
+
+  hc::parallel_for_each(hc::extent<1>(SIZE / 4), [=](hc::index<1> idx) [[hc]] {
+    float_4 v = cav.load_vec<4>(idx * 4);
+    av.store_vec<4>(idx * 4, v * 2.0f);
+  });
+  av.synchronize();
+  for (int i = 0; i < SIZE; ++i)
+    ret &= (host[i] == 2.0f * i);
+
+  // the view of short vectors
+  hc::array_view<float_4, 1> vav = av.reinterpret_as<float_4>();
+  ret &= (vav.get_extent()[0] == SIZE / 4);
+  hc::parallel_for_each(vav.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    vav[idx] += float_4(1.0f);
+  });
+  float_4 last = av.load_vec<4>(hc::index<1>(SIZE - 4));
+  ret &= (last.get_w() == 2.0f * (SIZE - 1) + 1.0f);
+
+  // rows of 2D views
+  av.synchronize();
+  hc::array_view<float, 2> av2(SIZE / 16, 16, host);
+  float_2 pair = av2.load_vec<2>(hc::index<2>(1, 2));
+  ret &= (pair.get_x() == 2.0f * 18 + 1.0f);
+
+  bool thrown = false;
+  try {
+    av.load_vec<4>(hc::index<1>(1));
+  } catch (hc::runtime_exception&) {
+    thrown = true;
+  }
+  ret &= thrown;
+
+  thrown = false;
+  try {
+    av2.store_vec<4>(hc::index<2>(0, 14), float_4(0.0f));
+  } catch (hc::runtime_exception&) {
+    thrown = true;
+  }
+  ret &= thrown;
+
+  thrown = false;
+  try {
+    av.section(1, 8).reinterpret_as<float_4>();
+  } catch (hc::runtime_exception&) {
+    thrown = true;
+  }
+  ret &= thrown;
+
+  return !(ret == true);
+}
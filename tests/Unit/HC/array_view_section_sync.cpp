@@ -0,0 +1,66 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_stats.h>
+
+#include <vector>
+
+// Test kernels using sections of an array_view of a large matrix on the
+// host, only the rows of the column block of the section are copied to the
+// accelerator and back, and the rest of the matrix stays valid on the host
+
+#define ROWS (64)
+#define COLS (65536)
+#define BLOCK (1024)
+
+int main() {
+  bool ret = true;
+
+  std::vector<int> matrix(ROWS * COLS);
+  for (int i = 0; i < ROWS * COLS; ++i)
+    matrix[i] = i;
+  const size_t bytes = matrix.size() * sizeof(int);
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::array_view<int, 2> full(ROWS, COLS, matrix);
+
+  // a column block is written on the accelerator
+  hc_queue_stats before = av.get_stats();
+  hc::array_view<int, 2> block = full.section(hc::index<2>(0, COLS / 2), hc::extent<2>(ROWS, BLOCK));
+  hc::parallel_for_each(av, block.get_extent(), [=](hc::index<2> idx) [[hc]] {
+    block[idx] *= 2;
+  });
+  block.synchronize();
+  hc_queue_stats after = av.get_stats();
+  ret &= (after.bytes_host_to_device - before.bytes_host_to_device < bytes / 2);
+  ret &= (after.bytes_device_to_host - before.bytes_device_to_host < bytes / 2);
+
+  for (int i = 0; i < ROWS; ++i) {
+    for (int j = 0; j < COLS; ++j) {
+      int value = i * COLS + j;
+      bool inBlock = (j >= COLS / 2 && j < COLS / 2 + BLOCK);
+      ret &= (matrix[i * COLS + j] == (inBlock ? 2 * value : value));
+    }
+  }
+
+  // a read-only section of another block, then the whole matrix
+  hc::array_view<const int, 2> column = full.section(hc::index<2>(0, 0), hc::extent<2>(ROWS, 1));
+  hc::array_view<int, 1> firsts(ROWS);
+  hc::parallel_for_each(av, firsts.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    firsts[idx] = column(idx[0], 0);
+  });
+  hc::parallel_for_each(av, full.get_extent(), [=](hc::index<2> idx) [[hc]] {
+    full[idx] += 1;
+  });
+  for (int i = 0; i < ROWS; ++i)
+    ret &= (firsts[i] == i * COLS);
+  for (int i = 0; i < ROWS; ++i) {
+    for (int j = 0; j < COLS; ++j) {
+      int value = i * COLS + j;
+      bool inBlock = (j >= COLS / 2 && j < COLS / 2 + BLOCK);
+      ret &= (full(i, j) == (inBlock ? 2 * value : value) + 1);
+    }
+  }
+
+  return !(ret == true);
+}
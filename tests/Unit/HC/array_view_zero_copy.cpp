@@ -0,0 +1,54 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <sys/mman.h>
+#include <vector>
+
+// Test array_views of host memory mapped to the accelerator instead of
+// copied, kernels read and write an anonymous mapping in place, and the host
+// sees their results without any copy back
+
+#define SIZE (1024 * 1024)
+
+int main() {
+  bool ret = true;
+
+  size_t bytes = SIZE * sizeof(int);
+  void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (mapping == MAP_FAILED)
+    return 1;
+  int* table = static_cast<int*>(mapping);
+  for (int i = 0; i < SIZE; ++i)
+    table[i] = i;
+
+  {
+    hc::array_view<int, 1> av(hc::extent<1>(SIZE), table, hc::zero_copy);
+    hc::parallel_for_each(hc::extent<1>(SIZE), [=](hc::index<1> idx) [[hc]] {
+      av[idx] *= 2;
+    });
+    for (int i = 0; i < SIZE; ++i)
+      ret &= (av[i] == 2 * i);
+
+    // the host writes are seen by the next kernel
+    for (int i = 0; i < SIZE; ++i)
+      av[i] = i + 1;
+
+    // read-only views stream the memory through
+    std::vector<int> input(SIZE, 3);
+    hc::array_view<const int, 1> in(hc::extent<1>(SIZE), input.data(), hc::zero_copy);
+    hc::array_view<int, 1> out(SIZE);
+    hc::parallel_for_each(hc::extent<1>(SIZE), [=](hc::index<1> idx) [[hc]] {
+      out[idx] = in[idx] + av[idx];
+    });
+    for (int i = 0; i < SIZE; ++i)
+      ret &= (out[i] == i + 4);
+  }
+
+  // the memory isn't owned by the views
+  for (int i = 0; i < SIZE; ++i)
+    ret &= (table[i] == i + 1);
+  munmap(mapping, bytes);
+
+  return !(ret == true);
+}
@@ -0,0 +1,49 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+
+// test a long stream of asynchronous kernel launches which are never waited
+// on individually. the number of pending async operations of the
+// accelerator_view stays bounded, and drops to 0 once they complete
+
+#define DISPATCH_COUNT (20000)
+#define VEC_SIZE (64)
+
+// capacity of the ring of in-flight async operations in the runtime
+#define ASYNCOPS_RING_SIZE (4096)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) table[i] = 0;
+
+  int maxPending = 0;
+  for (int n = 0; n < DISPATCH_COUNT; ++n) {
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    });
+    maxPending = std::max(maxPending, av.get_pending_async_ops());
+  }
+
+#if TEST_DEBUG
+  std::cout << "max pending async ops: " << maxPending << "\n";
+#endif
+  ret &= (maxPending <= ASYNCOPS_RING_SIZE);
+
+  // waiting on the last one retires all of them on an in-order queue
+  av.create_marker().wait();
+  ret &= (av.get_pending_async_ops() == 0);
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == DISPATCH_COUNT);
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,72 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_atomic.hpp>
+
+#include <vector>
+
+// Test hc::atomic_ref: a histogram counted with relaxed increments, per tile
+// in tile_static memory then in global memory, and a maximum found with a
+// floating-point compare-and-swap loop
+
+#define BINS (16)
+#define TILE (256)
+
+bool test() {
+  const int vecSize = 4096;
+
+  std::vector<int> input(vecSize);
+  for (int i = 0; i < vecSize; ++i) {
+    input[i] = (i * 7) % BINS;
+  }
+  std::vector<int> bins(BINS, 0);
+  std::vector<float> maximum(1, 0.0f);
+
+  hc::array_view<const int, 1> in(vecSize, input);
+  hc::array_view<int, 1> histogram(BINS, bins);
+  hc::array_view<float, 1> max_value(1, maximum);
+  hc::parallel_for_each(hc::extent<1>(vecSize).tile(TILE), [=](hc::tiled_index<1> tidx) [[hc]] {
+    tile_static int local[BINS];
+    if (tidx.local[0] < BINS) {
+      local[tidx.local[0]] = 0;
+    }
+    tidx.barrier.wait();
+
+    hc::atomic_ref<int, hc::memory_scope_work_group> bin(local[in[tidx.global]]);
+    bin.fetch_add(1, std::memory_order_relaxed);
+    hc::atomic_ref<float>(max_value[0]).fetch_max(float(tidx.global[0]), std::memory_order_relaxed);
+    tidx.barrier.wait();
+
+    if (tidx.local[0] < BINS) {
+      hc::atomic_ref<int>(histogram[tidx.local[0]]).fetch_add(local[tidx.local[0]], std::memory_order_relaxed);
+    }
+  }).wait();
+  histogram.synchronize();
+  max_value.synchronize();
+
+  bool ret = true;
+  for (int i = 0; i < BINS; ++i) {
+    ret &= (bins[i] == vecSize / BINS);
+  }
+  ret &= (maximum[0] == float(vecSize - 1));
+
+  // the same operations on the host
+  int counter = 0;
+  hc::atomic_ref<int, hc::memory_scope_system> host_counter(counter);
+  host_counter.fetch_add(3, std::memory_order_relaxed);
+  int expected = 3;
+  ret &= host_counter.compare_exchange_strong(expected, 5, std::memory_order_acq_rel);
+  ret &= (host_counter.exchange(7) == 5);
+  ret &= (host_counter.fetch_min(2) == 7);
+  ret &= (host_counter.load(std::memory_order_acquire) == 2);
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
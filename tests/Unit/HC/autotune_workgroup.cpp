@@ -0,0 +1,59 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_AUTOTUNE=1 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+
+// test kernels launched without a tile size while their workgroup shape is
+// autotuned, whose first launches try several workgroup shapes, which all
+// compute the whole extent, before the fastest one is used for later launches
+
+#define ROWS (100)
+#define COLS (300)
+#define DEPTH (7)
+#define ITERATION (64)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator_view av) {
+  bool ret = true;
+
+  hc::array_view<int, 1> table1(ROWS * COLS);
+  hc::array_view<int, 2> table2(ROWS, COLS);
+  hc::array_view<int, 3> table3(DEPTH, ROWS, COLS);
+
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::parallel_for_each(av, table1.get_extent(), [=](hc::index<1> idx) __HC__ {
+      table1[idx] = idx[0] + n;
+    });
+    hc::parallel_for_each(av, table2.get_extent(), [=](hc::index<2> idx) __HC__ {
+      table2[idx] = idx[0] * COLS + idx[1] + n;
+    });
+    hc::parallel_for_each(av, table3.get_extent(), [=](hc::index<3> idx) __HC__ {
+      table3[idx] = (idx[0] * ROWS + idx[1]) * COLS + idx[2] + n;
+    });
+
+    for (int i = 0; i < ROWS * COLS; ++i) {
+      ret &= (table1[i] == i + n);
+      ret &= (table2(i / COLS, i % COLS) == i + n);
+    }
+    for (int i = 0; i < DEPTH * ROWS * COLS; ++i) {
+      ret &= (table3(i / (ROWS * COLS), (i / COLS) % ROWS, i % COLS) == i + n);
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  ret &= test(acc.get_default_view());
+
+  return !(ret == true);
+}
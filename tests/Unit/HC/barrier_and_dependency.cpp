@@ -0,0 +1,77 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test a kernel depending on kernels launched on other accelerator_views.
+// the dependencies are resolved on the device with barrier-AND packets,
+// more than a barrier-AND packet could hold, so they are chained
+
+#define VIEW_COUNT (7)
+#define VEC_SIZE (1024)
+#define ITERATION (16)
+
+#define TEST_DEBUG (0)
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  std::vector<hc::accelerator_view> views;
+  for (int i = 0; i < VIEW_COUNT; ++i) {
+    views.push_back(acc.create_view(hc::execute_any_order));
+  }
+  hc::accelerator_view av = acc.create_view(hc::execute_any_order);
+
+  std::vector< hc::array_view<int, 1> > inputs;
+  for (int i = 0; i < VIEW_COUNT; ++i) {
+    hc::array_view<int, 1> input(VEC_SIZE);
+    for (int j = 0; j < VEC_SIZE; ++j) input[j] = 0;
+    inputs.push_back(input);
+  }
+  hc::array_view<int, 1> sum(VEC_SIZE);
+  for (int j = 0; j < VEC_SIZE; ++j) sum[j] = 0;
+
+  for (int n = 0; n < ITERATION; ++n) {
+    // each input is written on its own accelerator_view
+    for (int i = 0; i < VIEW_COUNT; ++i) {
+      hc::array_view<int, 1> input = inputs[i];
+      hc::parallel_for_each(views[i], hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+        input(idx) += i + 1;
+      });
+    }
+
+    // which are all read by a kernel on another accelerator_view
+    hc::array_view<int, 1> in0 = inputs[0], in1 = inputs[1], in2 = inputs[2], in3 = inputs[3];
+    hc::array_view<int, 1> in4 = inputs[4], in5 = inputs[5], in6 = inputs[6];
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      sum(idx) += in0(idx) + in1(idx) + in2(idx) + in3(idx) + in4(idx) + in5(idx) + in6(idx);
+    });
+  }
+  av.wait();
+
+  // after n iterations input i holds (i + 1) * n
+  int expected = 0;
+  for (int n = 1; n <= ITERATION; ++n) {
+    expected += n * VIEW_COUNT * (VIEW_COUNT + 1) / 2;
+  }
+  for (int j = 0; j < VEC_SIZE; ++j) {
+    ret &= (sum[j] == expected);
+  }
+
+#if TEST_DEBUG
+  std::cout << "sum[0] = " << sum[0] << ", expected " << expected << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
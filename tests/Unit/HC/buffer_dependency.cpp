@@ -0,0 +1,72 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test dependencies between asynchronous kernels tracked through the buffers
+// they use, on an accelerator_view executing in any order and across two
+// accelerator_views: read after write, write after read and write after
+// write on the same array_view must be kept in order
+
+#define VEC_SIZE (1024)
+#define ITERATION (64)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator_view av1, hc::accelerator_view av2) {
+  bool ret = true;
+
+  hc::array_view<int, 1> a(VEC_SIZE);
+  hc::array_view<int, 1> b(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    a[i] = i;
+    b[i] = 0;
+  }
+
+  hc::array_view<const int, 1> ca(a);
+
+  std::vector<hc::completion_future> futures;
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::accelerator_view& av = (n % 2) ? av2 : av1;
+
+    // write a
+    futures.push_back(hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      a(idx) += 1;
+    }));
+
+    // read a, write b
+    futures.push_back(hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      b(idx) += ca(idx);
+    }));
+  }
+  for (auto& f : futures) {
+    f.wait();
+  }
+
+  // b accumulates a after each increment
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (a[i] == i + ITERATION);
+    ret &= (b[i] == i * ITERATION + ITERATION * (ITERATION + 1) / 2);
+  }
+
+#if TEST_DEBUG
+  std::cout << "a[1] = " << a[1] << ", b[1] = " << b[1] << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::accelerator_view av1 = acc.create_view(hc::execute_any_order);
+  hc::accelerator_view av2 = acc.create_view(hc::execute_any_order);
+
+  ret &= test(av1, av1);
+  ret &= test(av1, av2);
+
+  return !(ret == true);
+}
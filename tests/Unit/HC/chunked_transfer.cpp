@@ -0,0 +1,50 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_STAGING_BUFFER_SIZE=1024 HCC_STAGING_BUFFER_COUNT=4 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test a large transfer of pageable host memory split into 1MB chunks which
+// are pipelined through 4 staging buffers, the achieved bandwidth reported
+// by the accelerator, and the ticks of an asynchronous copy
+
+#define VEC_SIZE (16 * 1024 * 1024 + 5)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::accelerator_view av = acc.get_default_view();
+
+  std::vector<int> host_in(VEC_SIZE);
+  std::vector<int> host_out(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) host_in[i] = i;
+
+  hc::array<int, 1> a(VEC_SIZE, av);
+  hc::array<int, 1> b(VEC_SIZE, av);
+
+  hc::copy(host_in.begin(), host_in.end(), a);
+
+  hc::completion_future f = hc::copy_async(a, b);
+  f.wait();
+  ret &= (f.get_end_tick() >= f.get_begin_tick());
+
+  hc::copy(b, host_out.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host_out[i] == i);
+  }
+
+  ret &= (acc.get_host_to_device_bandwidth() > 0.0);
+  ret &= (acc.get_device_to_host_bandwidth() > 0.0);
+
+#if TEST_DEBUG
+  std::cout << "host to device: " << acc.get_host_to_device_bandwidth() / 1e9 << " GB/s\n";
+  std::cout << "device to host: " << acc.get_device_to_host_bandwidth() / 1e9 << " GB/s\n";
+  std::cout << "copy ticks: " << f.get_end_tick() - f.get_begin_tick() << "\n";
+#endif
+
+  return !(ret == true);
+}
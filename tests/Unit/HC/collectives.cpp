@@ -0,0 +1,77 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_collectives.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test the wavefront and tile collectives, reductions, scans, broadcasts,
+// votes and matches over ints and doubles, in partitions of wavefronts and
+// in tiles ending with a partial wavefront
+
+#define TILE (200)
+#define TILES (4)
+#define SIZE (TILE * TILES)
+#define WAVE (__HSA_WAVEFRONT_SIZE__)
+
+struct maximum {
+  double operator()(double a, double b) const [[cpu, hc]] { return a > b ? a : b; }
+};
+
+int main() {
+  bool ret = true;
+
+  // the wavefront collectives, in partitions of 16 lanes
+  std::vector<int> host(WAVE * 6);
+  hc::array_view<int, 1> wav(WAVE * 6, host);
+  hc::parallel_for_each(hc::extent<1>(WAVE).tile(WAVE), [=](hc::tiled_index<1> tidx) [[hc]] {
+    int i = tidx.global[0];
+    int lane = i % 16;
+    wav[i] = hc::wavefront_reduce<16>(lane);
+    wav[WAVE + i] = hc::wavefront_inclusive_scan<16>(1);
+    wav[2 * WAVE + i] = hc::wavefront_broadcast<16>(i, 3);
+    wav[3 * WAVE + i] = static_cast<int>(hc::wavefront_ballot<16>(lane % 2 == 0));
+    wav[4 * WAVE + i] = hc::wavefront_any<16>(lane == 5) + 2 * hc::wavefront_all<16>(lane < 8);
+    wav[5 * WAVE + i] = static_cast<int>(hc::wavefront_match<16>(lane / 4));
+  });
+  wav.synchronize();
+  for (int i = 0; i < WAVE; ++i) {
+    int lane = i % 16;
+    ret &= (host[i] == 120);
+    ret &= (host[WAVE + i] == lane + 1);
+    ret &= (host[2 * WAVE + i] == i - lane + 3);
+    ret &= (host[3 * WAVE + i] == 0x5555);
+    ret &= (host[4 * WAVE + i] == 1);
+    ret &= (host[5 * WAVE + i] == (0xf << (lane / 4 * 4)));
+  }
+
+  // the tile collectives
+  std::vector<double> sums(SIZE), scans(SIZE), maxima(SIZE);
+  std::vector<int> votes(SIZE);
+  hc::array_view<double, 1> sav(SIZE, sums), cav(SIZE, scans), mav(SIZE, maxima);
+  hc::array_view<int, 1> vav(SIZE, votes);
+  hc::parallel_for_each(hc::extent<1>(SIZE).tile(TILE), [=](hc::tiled_index<1> tidx) [[hc]] {
+    int i = tidx.global[0];
+    double v = tidx.local[0] + 1;
+    sav[i] = hc::tile_reduce(tidx, v);
+    cav[i] = hc::tile_inclusive_scan(tidx, v);
+    mav[i] = hc::tile_reduce(tidx, v * (tidx.tile[0] + 1), maximum());
+    vav[i] = hc::tile_broadcast(tidx, i, TILE - 1) + SIZE * hc::tile_any(tidx, i == 7) +
+             2 * SIZE * hc::tile_all(tidx, i >= 0);
+  });
+  sav.synchronize();
+  cav.synchronize();
+  mav.synchronize();
+  vav.synchronize();
+  for (int i = 0; i < SIZE; ++i) {
+    int tile = i / TILE;
+    int local = i % TILE;
+    ret &= (sums[i] == TILE * (TILE + 1) / 2);
+    ret &= (scans[i] == (local + 1) * (local + 2) / 2);
+    ret &= (maxima[i] == TILE * (tile + 1));
+    ret &= (votes[i] == tile * TILE + TILE - 1 + (tile == 0 ? SIZE : 0) + 2 * SIZE);
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,95 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// test recording a sequence of dependent kernel launches and a marker with
+// begin_capture() / end_capture(), and replaying the recorded graph many
+// times
+
+#define VEC_SIZE (256)
+#define REPLAY_COUNT (256)
+
+#define TEST_DEBUG (0)
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  hc::array_view<int, 1> a(VEC_SIZE);
+  hc::array_view<int, 1> b(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    a[i] = i;
+    b[i] = 0;
+  }
+  a.synchronize_to(av);
+  b.synchronize_to(av);
+
+  av.begin_capture();
+
+  // nothing is submitted while recording
+  hc::completion_future f1 = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    a(idx) += 1;
+  });
+  ret &= (f1.valid() == false);
+
+  // depends on the previous kernel through a
+  hc::completion_future f2 = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    b(idx) += a(idx);
+  });
+  ret &= (f2.valid() == false);
+
+  hc::completion_future m = av.create_marker();
+  ret &= (m.valid() == false);
+
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    a(idx) -= 1;
+  });
+
+  hc::command_graph graph = av.end_capture();
+  ret &= graph.valid();
+  ret &= (graph.get_node_count() == 4);
+
+  // a is unchanged after every replay, b accumulates it
+  std::vector<hc::completion_future> futures;
+  for (int i = 0; i < REPLAY_COUNT; ++i) {
+    futures.push_back(graph.launch());
+  }
+  for (auto& f : futures) {
+    ret &= f.valid();
+  }
+  futures.back().wait();
+  av.wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (a[i] == i);
+    ret &= (b[i] == (i + 1) * REPLAY_COUNT);
+  }
+
+  // ending without capturing gives an empty graph
+  hc::command_graph empty = av.end_capture();
+  ret &= (empty.valid() == false);
+  ret &= (empty.launch().valid() == false);
+
+  // kernels are submitted again after end_capture()
+  hc::completion_future f3 = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    a(idx) += 1;
+  });
+  ret &= f3.valid();
+  f3.wait();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (a[i] == i + 1);
+  }
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,68 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <chrono>
+#include <future>
+#include <iostream>
+
+#define TEST_DEBUG (0)
+
+// Test completion_future objects created by kernel dispatches, which are
+// backed by the completion signal of the dispatch instead of std::future
+bool test() {
+  bool ret = true;
+
+  const int vecSize = 1024;
+
+  hc::array_view<int, 1> table(vecSize);
+  for (int i = 0; i < vecSize; ++i) {
+    table[i] = i;
+  }
+
+  hc::extent<1> e(vecSize);
+  hc::completion_future fut = hc::parallel_for_each(
+    e,
+    [=](hc::index<1> idx) __HC__ {
+      table(idx) *= 2;
+  });
+  ret &= fut.valid();
+
+  // move leaves the source invalid
+  hc::completion_future fut2 = std::move(fut);
+  ret &= (fut.valid() == false);
+  ret &= fut2.valid();
+
+  // wait_for polls the signal until the dispatch completes
+  while (fut2.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready);
+  ret &= fut2.is_ready();
+
+  // waiting more than once is fine
+  fut2.wait();
+  fut2.get();
+
+  // conversion to std::shared_future<void> refers to the same operation
+  std::shared_future<void> sf = fut2;
+  ret &= sf.valid();
+  sf.wait();
+
+  int error = 0;
+  for (int i = 0; i < vecSize; ++i) {
+    error += (table[i] != i * 2);
+  }
+#if TEST_DEBUG
+  std::cout << "errors: " << error << "\n";
+#endif
+  ret &= (error == 0);
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,62 @@
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+// test the callbacks of completion_future::then(), run by the pool of the
+// runtime for many operations in flight at once, and continuations chained
+// by callbacks returning completion_futures
+
+#define VEC_SIZE (1024)
+#define LAUNCHES (1024)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::array_view<int, 1> table(VEC_SIZE);
+
+  // a callback for each of many kernels in flight
+  std::atomic<int> callbacks(0);
+  std::vector<hc::completion_future> called;
+  for (int n = 0; n < LAUNCHES; ++n) {
+    hc::completion_future fut = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+      table[idx] = n;
+    });
+    called.push_back(fut.then([&callbacks] { ++callbacks; }));
+  }
+  for (auto& fut : called) {
+    fut.wait();
+  }
+  ret &= (callbacks == LAUNCHES);
+
+  // a continuation launching another kernel, the future of then() is ready
+  // once that kernel is done
+  hc::completion_future first = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+    table[idx] = idx[0];
+  });
+  hc::completion_future chained = first.then([=]() {
+    return hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+      table[idx] *= 2;
+    });
+  }).then([&callbacks] { callbacks = 0; });
+  chained.wait();
+  ret &= (callbacks == 0);
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i * 2);
+  }
+
+  // exceptions thrown by callbacks are stored in the future of then()
+  hc::completion_future failed = av.create_marker().then([] { throw std::runtime_error("callback"); });
+  bool thrown = false;
+  try {
+    failed.get();
+  } catch (const std::runtime_error&) {
+    thrown = true;
+  }
+  ret &= thrown;
+
+  return !(ret == true);
+}
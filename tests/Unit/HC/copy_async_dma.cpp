@@ -0,0 +1,68 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test copy_async between host and device while kernels keep running. the
+// copies are ordered after kernels using the same buffers, and kernels using
+// the copied buffers wait for the copies
+
+#define VEC_SIZE (1024 * 1024)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  std::vector<int> host_in(VEC_SIZE);
+  std::vector<int> host_out(VEC_SIZE, 0);
+  for (int i = 0; i < VEC_SIZE; ++i) host_in[i] = i;
+
+  hc::array_view<int, 1> in(VEC_SIZE, host_in);
+  hc::array_view<int, 1> out(VEC_SIZE, host_out);
+  hc::array<int, 1> a(VEC_SIZE, av);
+  hc::array<int, 1> b(VEC_SIZE, av);
+  hc::array<int, 1> busy(VEC_SIZE, av);
+
+  // a kernel unrelated to the copies
+  hc::completion_future k0 = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&busy](hc::index<1> idx) __HC__ {
+    busy(idx) = idx[0];
+  });
+
+  // host to device, then a kernel reading a, then device to host
+  hc::completion_future c0 = hc::copy_async(in, a);
+  ret &= c0.valid();
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&a, &b](hc::index<1> idx) __HC__ {
+    b(idx) = a(idx) * 2;
+  });
+  hc::completion_future c1 = hc::copy_async(b, out);
+  ret &= c1.valid();
+
+  // device to device, ordered after the kernel writing b
+  hc::array<int, 1> c(VEC_SIZE, av);
+  hc::completion_future c2 = hc::copy_async(b, c);
+
+  c1.wait();
+  c2.wait();
+  k0.wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (out[i] == i * 2);
+  }
+
+  std::vector<int> host_c(VEC_SIZE, 0);
+  hc::copy(c, host_c.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host_c[i] == i * 2);
+  }
+
+#if TEST_DEBUG
+  std::cout << "out[1] = " << out[1] << ", c[1] = " << host_c[1] << "\n";
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,64 @@
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <list>
+#include <vector>
+
+// test copy_async between iterators and containers. the copies start when
+// copy_async returns: the source range may be changed or dropped at once
+// when it's copied to a container, and the copies are done in order with
+// the kernels using the containers
+
+#define VEC_SIZE (1024 * 1024)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::array<int, 1> a(VEC_SIZE, av);
+
+  // the source is staged at once, so it may be overwritten right away
+  std::vector<int> host(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) host[i] = i;
+  hc::completion_future c0 = hc::copy_async(host.begin(), host.end(), a);
+  ret &= c0.valid();
+  std::fill(host.begin(), host.end(), -1);
+
+  // a kernel using a runs after the copy
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&a](hc::index<1> idx) __HC__ {
+    a(idx) *= 2;
+  });
+
+  // device to host, after the kernel
+  hc::completion_future c1 = hc::copy_async(a, host.begin());
+  c1.wait();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == i * 2);
+  }
+
+  // input iterators which aren't contiguous, into a section of a view
+  std::list<int> values;
+  for (int i = 0; i < 256; ++i) values.push_back(i + 1);
+  hc::array_view<int, 1> view(a);
+  hc::copy_async(values.begin(), values.end(), view.section(hc::index<1>(16), hc::extent<1>(256))).wait();
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(a, result.begin());
+  ret &= (result[15] == 30);
+  ret &= (result[16] == 1);
+  ret &= (result[271] == 256);
+  ret &= (result[272] == 544);
+
+  // sections of 2D views aren't flat
+  hc::array<int, 2> b(64, 64, av);
+  std::vector<int> zeros(64 * 64, 0);
+  hc::copy(zeros.begin(), b);
+  hc::array_view<int, 2> tile = hc::array_view<int, 2>(b).section(hc::index<2>(8, 8), hc::extent<2>(4, 4));
+  hc::copy_async(values.begin(), tile).wait();
+  std::vector<int> result2(64 * 64);
+  hc::copy_async(b, result2.begin()).wait();
+  ret &= (result2[8 * 64 + 8] == 1);
+  ret &= (result2[11 * 64 + 11] == 16);
+  ret &= (result2[8 * 64 + 12] == 0);
+
+  return !(ret == true);
+}
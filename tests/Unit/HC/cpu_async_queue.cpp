@@ -0,0 +1,70 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_RUNTIME=CPU %t.out
+#include <hc.hpp>
+
+#include <atomic>
+#include <iostream>
+
+// test kernels on the CPU path return completion_futures of launches run
+// asynchronously, whose callbacks set by then() are called once they are
+// done, on queues executing in order and in any order. kernels using the
+// results of earlier ones, markers, and host accesses see the earlier
+// kernels done
+
+#define VEC_SIZE (1024 * 1024)
+#define ITERATION (8)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator_view av) {
+  bool ret = true;
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  std::atomic<int> callbacks(0);
+  auto callback = [&callbacks] { ++callbacks; };
+
+  {
+    hc::completion_future fut = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table[idx] = idx[0];
+    });
+    ret &= fut.valid();
+    hc::completion_future called = fut.then(callback);
+
+    for (int n = 0; n < ITERATION; ++n) {
+      hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+        table[idx] += 1;
+      });
+    }
+
+    hc::completion_future marker = av.create_marker();
+    marker.wait();
+    ret &= marker.is_ready();
+    ret &= fut.is_ready();
+
+    for (int i = 0; i < VEC_SIZE; ++i) {
+      ret &= (table[i] == i + ITERATION);
+    }
+    av.wait();
+    // the callback has returned once the future of then() is ready
+    called.wait();
+  }
+  ret &= (callbacks == 1);
+
+#if TEST_DEBUG
+  std::cout << "execute order " << av.get_execute_order() << ": " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+
+  ret &= test(acc.get_default_view());
+  ret &= test(acc.create_view(hc::execute_in_order));
+  ret &= test(acc.create_view(hc::execute_any_order));
+
+  return !(ret == true);
+}
@@ -0,0 +1,40 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_RUNTIME=CPU %t.out && HCC_RUNTIME=CPU HCC_CPU_ISA=generic %t.out && HCC_RUNTIME=CPU HCC_CPU_ISA=avx2 %t.out
+#include <hc.hpp>
+
+// test the loops of CPU kernels give the same results in the versions for
+// each instruction set: kernels over extents of 1 and 2 dimensions, whose
+// innermost runs aren't a multiple of the vector width, and a tiled kernel
+// without barriers
+
+#define ROWS (37)
+#define COLS (1021)
+
+int main() {
+  bool ret = true;
+
+  hc::array_view<int, 1> a(ROWS * COLS);
+  hc::parallel_for_each(hc::extent<1>(ROWS * COLS), [=](hc::index<1> idx) [[hc]] {
+    a[idx] = idx[0] * 3 + 1;
+  });
+  for (int i = 0; i < ROWS * COLS; ++i)
+    ret &= (a[i] == i * 3 + 1);
+
+  hc::array_view<int, 2> b(ROWS, COLS);
+  hc::parallel_for_each(hc::extent<2>(ROWS, COLS), [=](hc::index<2> idx) [[hc]] {
+    b[idx] = idx[0] * COLS - idx[1];
+  });
+  for (int i = 0; i < ROWS; ++i)
+    for (int j = 0; j < COLS; ++j)
+      ret &= (b(i, j) == i * COLS - j);
+
+  hc::array_view<int, 2> c(64, 96);
+  hc::parallel_for_each(hc::extent<2>(64, 96).tile(8, 32), [=](hc::tiled_index<2> tidx) [[hc]] {
+    c[tidx.global] = tidx.tile[0] * 1000 + tidx.tile[1] * 100 + tidx.local[0] * 32 + tidx.local[1];
+  });
+  for (int i = 0; i < 64; ++i)
+    for (int j = 0; j < 96; ++j)
+      ret &= (c(i, j) == (i / 8) * 1000 + (j / 32) * 100 + (i % 8) * 32 + (j % 32));
+
+  return !(ret == true);
+}
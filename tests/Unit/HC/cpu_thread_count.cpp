@@ -0,0 +1,44 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_RUNTIME=CPU HCC_CPU_THREADS=3 HCC_CPU_AFFINITY=1 %t.out
+#include <hc.hpp>
+
+// test the thread pool of CPU kernels is sized by HCC_CPU_THREADS, that
+// set_cpu_thread_count() limits it and its kernels give the same results on
+// any number of threads, and that 0 gives it all of its threads back
+
+#define VEC_SIZE (1024 * 1024)
+
+bool run(hc::accelerator_view av) {
+  hc::array_view<int, 1> table(VEC_SIZE);
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    table[idx] = idx[0] * 2;
+  });
+  bool ret = true;
+  for (int i = 0; i < VEC_SIZE; ++i)
+    ret &= (table[i] == i * 2);
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  ret &= (hc::get_cpu_thread_count() == 3);
+  ret &= run(av);
+
+  hc::set_cpu_thread_count(1);
+  ret &= (hc::get_cpu_thread_count() == 1);
+  ret &= run(av);
+
+  // at most the threads of the pool
+  hc::set_cpu_thread_count(64);
+  ret &= (hc::get_cpu_thread_count() == 3);
+
+  hc::set_cpu_thread_count(2);
+  ret &= run(av);
+  hc::set_cpu_thread_count(0);
+  ret &= (hc::get_cpu_thread_count() == 3);
+  ret &= run(av);
+
+  return !(ret == true);
+}
@@ -0,0 +1,55 @@
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// test markers depending on the commands of other accelerator_views: the
+// kernels submitted after the marker see the results of the ones it waits
+// for, which the host doesn't wait for
+
+#define VEC_SIZE (1024 * 1024)
+#define ITERATION (16)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::accelerator_view producer = acc.create_view();
+  hc::accelerator_view consumer = acc.create_view();
+
+  hc::array<int, 1> a(VEC_SIZE, producer);
+  hc::array<int, 1> b(VEC_SIZE, consumer);
+  int* pa = a.accelerator_pointer();
+  int* pb = b.accelerator_pointer();
+
+  // the kernels use raw pointers, so only the marker orders them
+  hc::completion_future produced;
+  for (int n = 0; n < ITERATION; ++n) {
+    produced = hc::parallel_for_each(producer, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+      pa[idx[0]] = (n == 0) ? idx[0] : pa[idx[0]] + 1;
+    });
+  }
+
+  std::vector<hc::completion_future> dependencies(1, produced);
+  hc::completion_future marker = consumer.create_marker(dependencies);
+  ret &= marker.valid();
+  hc::completion_future consumed = hc::parallel_for_each(consumer, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+    pb[idx[0]] = pa[idx[0]] * 2;
+  });
+  consumed.wait();
+  ret &= marker.is_ready();
+  ret &= produced.is_ready();
+
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(b, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == (i + ITERATION - 1) * 2);
+  }
+
+  // a marker without dependencies waits for its own accelerator_view only
+  hc::completion_future empty = producer.create_marker(std::vector<hc::completion_future>());
+  empty.wait();
+  ret &= empty.is_ready();
+
+  return !(ret == true);
+}
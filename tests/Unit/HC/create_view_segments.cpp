@@ -0,0 +1,63 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// test accelerator::create_view() with the private and group segment sizes
+// of the kernels created so far, and accelerator_view::release_scratch()
+
+#define VEC_SIZE (1024)
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator acc;
+
+  // a kernel using a private array, which may be placed in scratch memory
+  std::vector<int> host(VEC_SIZE);
+  hc::array_view<int, 1> av(VEC_SIZE, host);
+  auto kernel = [=](hc::index<1> idx) __HC__ {
+    int values[64];
+    for (int i = 0; i < 64; ++i)
+      values[i] = idx[0] + i;
+    int sum = 0;
+    for (int i = 0; i < 64; ++i)
+      sum += values[(idx[0] + i) % 64];
+    av[idx] = sum;
+  };
+  hc::parallel_for_each(acc.get_default_view(), av.get_extent(), kernel).wait();
+
+  hc::accelerator_view view = acc.create_view(acc.get_max_private_segment_size(),
+                                              acc.get_max_group_segment_size());
+  hc::parallel_for_each(view, av.get_extent(), kernel).wait();
+  av.synchronize();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == 64 * i + 63 * 64 / 2);
+  }
+
+  // the view works on as before once its scratch memory is released
+  ret &= view.release_scratch();
+  hc::parallel_for_each(view, av.get_extent(), [=](hc::index<1> idx) __HC__ {
+    av[idx] = idx[0];
+  }).wait();
+  av.synchronize();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == i);
+  }
+
+  // no scratch memory is released while a batch is open
+  view.begin_batch();
+  ret &= (view.release_scratch() == false);
+  view.end_batch().wait();
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,60 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test splitting the CUs of an accelerator into disjoint partitions, and
+// creating accelerator_views with a queue priority on each partition
+
+#define VEC_SIZE (1024)
+
+#define TEST_DEBUG (0)
+
+bool run(hc::accelerator_view av, int value) {
+  bool ret = true;
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    table(idx) = idx[0] + value;
+  }).wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i + value);
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  unsigned int cu_count = acc.get_cu_count();
+
+  // two partitions covering every CU exactly once
+  std::vector< std::vector<bool> > masks = acc.partition_cu(2);
+  ret &= (masks.size() == 2);
+  for (unsigned int i = 0; i < cu_count; ++i) {
+    ret &= (masks[0][i] != masks[1][i]);
+  }
+
+  // asking for more CUs than the accelerator has gives no partition
+  ret &= acc.partition_cu(std::vector<unsigned int>{ cu_count, 1 }).empty();
+
+  // a latency critical view next to a batch view
+  hc::accelerator_view high = acc.create_view(hcQueuePriorityHigh, masks[0]);
+  hc::accelerator_view low = acc.create_view(hcQueuePriorityLow, masks[1], hc::execute_any_order);
+  ret &= (high.get_queue_priority() == hcQueuePriorityHigh);
+  ret &= (low.get_queue_priority() == hcQueuePriorityLow);
+  ret &= (acc.create_view().get_queue_priority() == hcQueuePriorityNormal);
+
+  ret &= run(high, 1);
+  ret &= run(low, 2);
+
+#if TEST_DEBUG
+  std::cout << "cu count: " << cu_count << "\n";
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,64 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <cstdint>
+
+// Test the kernels enqueued by kernels: a kernel counts the elements to
+// process, writes the grid size of the follow-up kernel to device memory,
+// and enqueues it directly and indirectly, with no round trip to the host
+
+#define SIZE (4096)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::accelerator_view parent = acc.create_view();
+  hc::accelerator_view children = acc.create_view();
+  hc::device_queue queue = children.get_device_queue();
+  if (!queue.valid())
+    return 0;
+
+  hc::array_view<int, 1> data(SIZE);
+  hc::array_view<int, 1> doubled(SIZE);
+  hc::array_view<int, 1> squared(SIZE);
+  for (int i = 0; i < SIZE; ++i) {
+    data[i] = i;
+    doubled[i] = -1;
+    squared[i] = -1;
+  }
+
+  // the follow-up kernels, prepared on the host
+  hc::launch_template doubling = hc::create_launch_template(children, hc::extent<1>(SIZE),
+    [=](hc::index<1> idx) [[hc]] {
+      doubled[idx] = 2 * data[idx];
+    });
+  hc::launch_template squaring = hc::create_launch_template(children, hc::extent<1>(SIZE),
+    [=](hc::index<1> idx) [[hc]] {
+      squared[idx] = data[idx] * data[idx];
+    });
+  hc::device_kernel doubling_kernel = doubling.get_device_kernel();
+  hc::device_kernel squaring_kernel = squaring.get_device_kernel();
+  if (!doubling_kernel.valid() || !squaring_kernel.valid())
+    return 0;
+
+  hc::array_view<uint32_t, 1> grid(3);
+  grid[0] = 0;
+  grid[1] = 1;
+  grid[2] = 1;
+  hc::parallel_for_each(parent, hc::extent<1>(1), [=](hc::index<1> idx) [[hc]] {
+    // only the first half is processed
+    grid[0] = SIZE / 2;
+    queue.enqueue(doubling_kernel, SIZE / 2);
+    queue.enqueue_indirect(squaring_kernel, grid.accelerator_pointer());
+  }).wait();
+  children.create_marker().wait();
+
+  for (int i = 0; i < SIZE; ++i) {
+    ret &= (doubled[i] == (i < SIZE / 2 ? 2 * i : -1));
+    ret &= (squared[i] == (i < SIZE / 2 ? i * i : -1));
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,62 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test accelerator_view::begin_batch() / end_batch()
+// kernels launched within a batch are submitted with one doorbell ring and
+// complete along with the future returned by end_batch()
+
+#define DISPATCH_COUNT (128)
+#define VEC_SIZE (64)
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().create_view();
+
+  hc::array<int, 1> table(VEC_SIZE, av);
+  hc::parallel_for_each(av, table.get_extent(), [&](hc::index<1> idx) __HC__ {
+    table(idx) = 0;
+  });
+
+  std::vector<hc::completion_future> futures;
+
+  av.begin_batch();
+  for (int i = 0; i < DISPATCH_COUNT; ++i) {
+    futures.push_back(hc::parallel_for_each(av, table.get_extent(), [&](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    }));
+  }
+  hc::completion_future batch = av.end_batch();
+
+  ret &= batch.valid();
+  batch.wait();
+
+  // all kernels in the batch shall be completed along with the batch
+  for (auto& f : futures) {
+    ret &= f.is_ready();
+  }
+
+  // no batch is open now
+  ret &= (av.end_batch().valid() == false);
+
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(table, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == DISPATCH_COUNT);
+  }
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
+
@@ -0,0 +1,63 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// test kernels of a batch which read what the previous kernels of the batch
+// wrote: they release and acquire memory at agent scope, and the host sees
+// the results of all of them once the batch completes
+
+#define STEP_COUNT (64)
+#define VEC_SIZE (4096)
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().create_view();
+
+  hc::array<int, 1> a(VEC_SIZE, av);
+  hc::array<int, 1> b(VEC_SIZE, av);
+  std::vector<int> host(VEC_SIZE, 0);
+  hc::array_view<int, 1> c(VEC_SIZE, host);
+
+  av.begin_batch();
+  hc::parallel_for_each(av, a.get_extent(), [&](hc::index<1> idx) __HC__ {
+    a(idx) = idx[0];
+  });
+  for (int i = 0; i < STEP_COUNT; ++i) {
+    // every kernel reads the array the previous one wrote
+    hc::parallel_for_each(av, a.get_extent(), [&](hc::index<1> idx) __HC__ {
+      b(idx) = a(idx) + 1;
+    });
+    hc::parallel_for_each(av, a.get_extent(), [&](hc::index<1> idx) __HC__ {
+      a(idx) = b(idx) + 1;
+    });
+  }
+  hc::parallel_for_each(av, a.get_extent(), [&, c](hc::index<1> idx) __HC__ {
+    c[idx] = a(idx) - b(idx);
+  });
+  hc::completion_future batch = av.end_batch();
+  batch.wait();
+
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(a, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == i + 2 * STEP_COUNT);
+  }
+
+  c.synchronize();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (host[i] == 1);
+  }
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
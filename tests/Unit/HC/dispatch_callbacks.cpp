@@ -0,0 +1,93 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_callbacks.h>
+
+#include <atomic>
+#include <iostream>
+#include <vector>
+
+// Test the callbacks of an external profiler, each dispatch and copy calls
+// the callbacks registered before and after it with the same record, and
+// none is called once they're unregistered
+
+#define SIZE (1024)
+#define DISPATCHES (8)
+
+struct counts {
+  std::atomic<int> begins;
+  std::atomic<int> ends;
+  std::atomic<int> mismatches;
+  uint64_t last_id;
+};
+
+counts dispatches;
+counts copies;
+
+void dispatch_begin(const hc_dispatch_record* record, void* data) {
+  counts* c = static_cast<counts*>(data);
+  c->begins++;
+  c->last_id = record->correlation_id;
+  if (record->kernel_name == nullptr || record->grid[0] != SIZE || record->workgroup[0] == 0)
+    c->mismatches++;
+}
+
+void dispatch_end(const hc_dispatch_record* record, void* data) {
+  counts* c = static_cast<counts*>(data);
+  c->ends++;
+  if (record->correlation_id != c->last_id)
+    c->mismatches++;
+}
+
+void copy_begin(const hc_copy_record* record, void* data) {
+  counts* c = static_cast<counts*>(data);
+  c->begins++;
+  c->last_id = record->correlation_id;
+  if (record->size != SIZE * sizeof(int))
+    c->mismatches++;
+}
+
+void copy_end(const hc_copy_record* record, void* data) {
+  counts* c = static_cast<counts*>(data);
+  c->ends++;
+  if (record->correlation_id != c->last_id)
+    c->mismatches++;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::array<int, 1> table(SIZE, av);
+  std::vector<int> host(SIZE, 1);
+
+  hc_register_dispatch_callbacks(dispatch_begin, dispatch_end, &dispatches);
+  hc_register_copy_callbacks(copy_begin, copy_end, &copies);
+
+  hc::copy(host.begin(), host.end(), table);
+  for (int i = 0; i < DISPATCHES; ++i) {
+    hc::parallel_for_each(av, table.get_extent(), [&table](hc::index<1> idx) [[hc]] {
+      table[idx] += 1;
+    });
+  }
+  av.wait();
+  hc::copy(table, host.begin());
+
+  ret &= (dispatches.begins == DISPATCHES);
+  ret &= (dispatches.ends == DISPATCHES);
+  ret &= (dispatches.mismatches == 0);
+  ret &= (copies.begins >= 2);
+  ret &= (copies.ends == copies.begins);
+  ret &= (copies.mismatches == 0);
+  ret &= (host[0] == 1 + DISPATCHES);
+
+  hc_register_dispatch_callbacks(nullptr, nullptr, nullptr);
+  hc_register_copy_callbacks(nullptr, nullptr, nullptr);
+
+  hc::parallel_for_each(av, table.get_extent(), [&table](hc::index<1> idx) [[hc]] {
+    table[idx] += 1;
+  }).wait();
+  ret &= (dispatches.begins == DISPATCHES);
+
+  return !(ret == true);
+}
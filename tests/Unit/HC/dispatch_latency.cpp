@@ -0,0 +1,43 @@
+// RUN: %hc %s -o %t.out && HCC_DISPATCH_LATENCY=1 %t.out
+
+#include <hc.hpp>
+#include <hc_stats.h>
+
+#include <iostream>
+
+// Test the histogram of the dispatch latency of an accelerator view, each
+// dispatch is counted in a bucket, and the percentiles estimated from it are
+// ordered
+
+#define DISPATCHES (64)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().create_view();
+  hc::array<int, 1> table(1024, av);
+
+  hc_queue_stats stats = av.get_stats();
+  ret &= (hc_get_dispatch_latency(&stats, 50) == 0);
+
+  for (int i = 0; i < DISPATCHES; ++i) {
+    hc::parallel_for_each(av, table.get_extent(), [&table](hc::index<1> idx) [[hc]] {
+      table[idx] += 1;
+    });
+  }
+  av.wait();
+
+  stats = av.get_stats();
+  uint64_t samples = 0;
+  for (int i = 0; i < HC_DISPATCH_LATENCY_BUCKETS; ++i)
+    samples += stats.dispatch_latency[i];
+  ret &= (samples == DISPATCHES);
+
+  uint64_t p50 = hc_get_dispatch_latency(&stats, 50);
+  uint64_t p99 = hc_get_dispatch_latency(&stats, 99);
+  std::cout << "p50 " << p50 << " ns, p99 " << p99 << " ns\n";
+  ret &= (p50 > 0);
+  ret &= (p50 <= p99);
+
+  return !(ret == true);
+}
@@ -0,0 +1,77 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <vector>
+
+// test the multiply-shift division of Kalmar::fast_divisor against / and %,
+// on the host and in a kernel, and the tiles of 2D and 3D tiled launches on
+// extents whose tile counts aren't powers of 2
+
+#define SAMPLES (1024)
+
+bool test_host() {
+  bool ret = true;
+  const int divisors[] = { 1, 2, 3, 5, 7, 10, 64, 100, 641, 65535, 65536, 1000003, 0x7fffffff };
+  const int numerators[] = { 0, 1, 2, 3, 63, 64, 65, 99999, 1 << 30, 0x7ffffffe, 0x7fffffff };
+  for (int d : divisors) {
+    Kalmar::fast_divisor fd(d);
+    for (int n : numerators) {
+      ret &= (fd.div(n) == n / d);
+      ret &= (fd.mod(n) == n % d);
+    }
+    for (int n = 0; n < SAMPLES; ++n) {
+      ret &= (fd.div(n) == n / d);
+      ret &= (fd.mod(n) == n % d);
+    }
+  }
+  return ret;
+}
+
+bool test_kernel() {
+  const int d = 37;
+  std::vector<int> q(SAMPLES), r(SAMPLES);
+  hc::array_view<int, 1> av_q(SAMPLES, q), av_r(SAMPLES, r);
+  Kalmar::fast_divisor fd(d);
+  hc::parallel_for_each(hc::extent<1>(SAMPLES), [=](hc::index<1> idx) [[hc]] {
+    int n = idx[0] * 2097151;
+    av_q[idx] = fd.div(n);
+    av_r[idx] = fd.mod(n);
+  });
+  av_q.synchronize();
+  av_r.synchronize();
+  bool ret = true;
+  for (int i = 0; i < SAMPLES; ++i) {
+    ret &= (q[i] == i * 2097151 / d);
+    ret &= (r[i] == i * 2097151 % d);
+  }
+  return ret;
+}
+
+template <int N>
+bool test_tiled(const hc::tiled_extent<N>& ext) {
+  const int size = ext.size();
+  std::vector<int> v(size, -1);
+  hc::array_view<int, N> av(ext, v);
+  const hc::extent<N>& e = ext;
+  hc::parallel_for_each(ext, [=](hc::tiled_index<N> tidx) [[hc]] {
+    av[tidx.global] = Kalmar::amp_helper<N, hc::index<N>, hc::extent<N> >::flatten(tidx.global, e);
+  });
+  av.synchronize();
+  bool ret = true;
+  for (int i = 0; i < size; ++i)
+    ret &= (v[i] == i);
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test_host();
+  ret &= test_kernel();
+  ret &= test_tiled(hc::extent<2>(12, 14 * 4).tile(4, 4));
+  ret &= test_tiled(hc::extent<3>(6, 5 * 2, 7 * 2).tile(2, 2, 2));
+
+  return !(ret == true);
+}
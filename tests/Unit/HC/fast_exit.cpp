@@ -0,0 +1,47 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_FAST_EXIT=1 %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// test the process exits cleanly with many queues, some of them with kernels
+// still in flight, whether the runtime is torn down fully or quickly with
+// HCC_FAST_EXIT=1
+
+#define VIEW_COUNT (16)
+#define VEC_SIZE (4096)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  std::vector<hc::accelerator_view> views;
+  std::vector<hc::array<int, 1>*> tables;
+  for (int i = 0; i < VIEW_COUNT; ++i) {
+    views.push_back(acc.create_view());
+    tables.push_back(new hc::array<int, 1>(VEC_SIZE, views[i]));
+  }
+
+  for (int i = 0; i < VIEW_COUNT; ++i) {
+    hc::array<int, 1>& table = *tables[i];
+    hc::parallel_for_each(views[i], hc::extent<1>(VEC_SIZE), [&table, i](hc::index<1> idx) [[hc]] {
+      table[idx] = idx[0] + i;
+    });
+  }
+
+  // the first half is checked, the other half still runs at exit
+  for (int i = 0; i < VIEW_COUNT / 2; ++i) {
+    std::vector<int> result(VEC_SIZE);
+    hc::copy(*tables[i], result.begin());
+    for (int j = 0; j < VEC_SIZE; ++j)
+      ret &= (result[j] == j + i);
+  }
+  for (int i = VIEW_COUNT / 2; i < VIEW_COUNT; ++i) {
+    hc::array<int, 1>& table = *tables[i];
+    hc::parallel_for_each(views[i], hc::extent<1>(VEC_SIZE), [&table](hc::index<1> idx) [[hc]] {
+      table[idx] *= 2;
+    });
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,54 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+// HC_FAST_MATH is on for the math functions of this translation unit
+#define HC_FAST_MATH (1)
+
+#include <hc.hpp>
+#include <hc_math.hpp>
+
+#include <cmath>
+#include <vector>
+
+// Test the fast math mode: the float math functions are computed with the
+// native instructions, within a relative error of the precise results
+
+#define TOLERANCE (1e-3f)
+
+bool close(float actual, float expected) {
+  return std::fabs(actual - expected) <= TOLERANCE * std::fmax(1.0f, std::fabs(expected));
+}
+
+bool test() {
+  const int vecSize = 1024;
+
+  std::vector<float> input(vecSize);
+  for (int i = 0; i < vecSize; ++i) {
+    input[i] = 0.5f + i / 64.0f;
+  }
+
+  hc::array_view<const float, 1> in(vecSize, input);
+  hc::array_view<float, 1> out_exp(vecSize), out_log2(vecSize), out_sqrt(vecSize);
+  hc::parallel_for_each(hc::extent<1>(vecSize), [=](hc::index<1> idx) [[hc]] {
+    float x = in[idx];
+    out_exp[idx] = exp(x / 4.0f);
+    out_log2[idx] = log2(x);
+    out_sqrt[idx] = sqrt(x);
+  }).wait();
+
+  bool ret = true;
+  for (int i = 0; i < vecSize; ++i) {
+    ret &= close(out_exp[i], std::exp(input[i] / 4.0f));
+    ret &= close(out_log2[i], std::log2(input[i]));
+    ret &= close(out_sqrt[i], std::sqrt(input[i]));
+  }
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,60 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_KERNEL_CACHE=0 HCC_FINALIZE_MODE=0 %t.out && HCC_KERNEL_CACHE=0 HCC_FINALIZE_MODE=1 %t.out && HCC_KERNEL_CACHE=0 HCC_FINALIZE_MODE=2 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// test kernels run the same whether they are finalized eagerly, lazily on
+// their first launch, or in the background, with first launches of several
+// kernels made concurrently from different threads
+
+#define VEC_SIZE (4096)
+#define THREAD_COUNT (4)
+
+#define TEST_DEBUG (0)
+
+bool test(int t) {
+  bool ret = true;
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  if (t % 2) {
+    hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table[idx] = idx[0] * t;
+    });
+  } else {
+    hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table[idx] = t * idx[0];
+    });
+  }
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i * t);
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  std::vector<char> results(THREAD_COUNT, false);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREAD_COUNT; ++t) {
+    threads.push_back(std::thread([&results, t]() {
+      results[t] = test(t);
+    }));
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (auto result : results) {
+    ret &= (result != 0);
+  }
+
+#if TEST_DEBUG
+  std::cout << "finalize mode: " << ret << "\n";
+#endif
+
+  return !(ret == true);
+}
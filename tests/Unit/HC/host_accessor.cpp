@@ -0,0 +1,65 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test the host accessors of array_views, which read and write the data of
+// the views on the host, of sections too, see the results of kernels once
+// created again, and throw once used after a kernel accessed the data
+
+#define SIZE (1024)
+
+int main() {
+  bool ret = true;
+
+  std::vector<int> host(SIZE, 0);
+  hc::array_view<int, 1> av(SIZE, host);
+
+  // write the view on the host
+  {
+    hc::host_accessor<int, 1> acc = av.get_host_accessor(hc::access_type_write);
+    for (int i = 0; i < SIZE; ++i)
+      acc[i] = i;
+  }
+
+  hc::parallel_for_each(av.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    av[idx] *= 2;
+  });
+
+  // read the results of the kernel
+  hc::array_view<const int, 1> cav(av);
+  hc::host_accessor<const int, 1> racc = cav.get_host_accessor();
+  for (int i = 0; i < SIZE; ++i)
+    ret &= (racc[i] == 2 * i);
+
+  // a section sees the elements of the section only
+  hc::array_view<int, 1> sec = av.section(hc::index<1>(SIZE / 2), hc::extent<1>(SIZE / 4));
+  hc::host_accessor<int, 1> sacc = sec.get_host_accessor();
+  ret &= (sacc.get_extent()[0] == SIZE / 4);
+  ret &= (sacc[0] == SIZE);
+  ret &= (sacc.data()[1] == SIZE + 2);
+
+  // 2D views are indexed like the views
+  hc::array_view<int, 2> av2(16, SIZE / 16, host);
+  hc::host_accessor<int, 2> acc2 = av2.get_host_accessor(hc::access_type_read);
+  ret &= (acc2[hc::index<2>(1, 0)] == 2 * (SIZE / 16));
+
+#ifndef NDEBUG
+  // an accessor used after a kernel accessed its data throws
+  hc::host_accessor<int, 1> stale = av.get_host_accessor();
+  hc::parallel_for_each(av.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    av[idx] += 1;
+  });
+  bool thrown = false;
+  try {
+    stale[0] = 0;
+  } catch (hc::runtime_exception&) {
+    thrown = true;
+  }
+  ret &= thrown;
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,106 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <cstdint>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// test the host memory pool behind the CPU device: page-aligned buffers of
+// every size class are recycled by the thread which released them, buffers
+// above 2 MB are mapped on huge pages, and array_views created on the host
+// allocate from it from several threads at once
+
+#define THREAD_COUNT (4)
+#define ITERATION (256)
+#define LARGE_SIZE (5 * 1024 * 1024 + 123)
+
+#define TEST_DEBUG (0)
+
+bool is_page_aligned(void* p) {
+  return (reinterpret_cast<std::uintptr_t>(p) & 0xfff) == 0;
+}
+
+bool test_size_classes() {
+  bool ret = true;
+
+  for (size_t size = 1; size <= 2 * 1024 * 1024; size = size * 3 + 1) {
+    char* p = static_cast<char*>(Kalmar::kalmar_host_alloc(size));
+    ret &= (p != nullptr) && is_page_aligned(p);
+    p[0] = 1;
+    p[size - 1] = 1;
+    Kalmar::kalmar_host_free(p, size);
+
+    // the block just released is handed out again to the same thread
+    void* q = Kalmar::kalmar_host_alloc(size);
+    ret &= (q == p);
+    Kalmar::kalmar_host_free(q, size);
+  }
+
+#if TEST_DEBUG
+  std::cout << "size classes: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+bool test_large() {
+  bool ret = true;
+
+  char* p = static_cast<char*>(Kalmar::kalmar_host_alloc(LARGE_SIZE));
+  ret &= (p != nullptr) && is_page_aligned(p);
+  for (size_t i = 0; i < LARGE_SIZE; i += 4096) {
+    p[i] = static_cast<char>(i);
+  }
+  p[LARGE_SIZE - 1] = 1;
+  Kalmar::kalmar_host_free(p, LARGE_SIZE);
+
+#if TEST_DEBUG
+  std::cout << "large: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+bool test_threads() {
+  std::vector<std::thread> threads;
+  std::vector<int> results(THREAD_COUNT, 1);
+
+  for (int t = 0; t < THREAD_COUNT; ++t) {
+    threads.push_back(std::thread([&results, t]() {
+      for (int n = 0; n < ITERATION; ++n) {
+        int size = 64 + n * 16;
+        hc::array_view<int, 1> av(size);
+        for (int i = 0; i < size; ++i) av[i] = i + t;
+        for (int i = 0; i < size; ++i) {
+          if (av[i] != i + t) results[t] = 0;
+        }
+      }
+    }));
+  }
+  for (auto& th : threads) {
+    th.join();
+  }
+
+  bool ret = true;
+  for (int t = 0; t < THREAD_COUNT; ++t) {
+    ret &= (results[t] == 1);
+  }
+
+#if TEST_DEBUG
+  std::cout << "threads: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test_size_classes();
+  ret &= test_large();
+  ret &= test_threads();
+
+  return !(ret == true);
+}
@@ -0,0 +1,55 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// a test which dispatches kernels with by-value captures larger than the
+// buffers in the kernarg pool, in a number which wraps around the kernarg
+// ring of the queue several times, with and without waiting in between
+
+#define CAPTURE_SIZE (64)
+#define VEC_SIZE (64)
+
+bool test(int N, bool waitEach) {
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  hc::array_view<int, 1> a(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) a[i] = 0;
+
+  // 256 bytes of captured data
+  struct Capture {
+    int data[CAPTURE_SIZE];
+  } capture;
+  for (int i = 0; i < CAPTURE_SIZE; ++i) capture.data[i] = i;
+
+  std::vector<hc::completion_future> futures;
+  for (int n = 0; n < N; ++n) {
+    hc::completion_future fut = hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE),
+                                                      [=](hc::index<1> idx) __attribute((hc)) {
+      a(idx) += capture.data[idx[0] % CAPTURE_SIZE];
+    });
+    if (waitEach) {
+      fut.wait();
+    } else {
+      futures.push_back(fut);
+    }
+  }
+  av.wait();
+
+  bool ret = true;
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (a[i] == N * (i % CAPTURE_SIZE));
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test(64, true);
+  ret &= test(4096, false);
+  ret &= test(4096, true);
+
+  return !(ret == true);
+}
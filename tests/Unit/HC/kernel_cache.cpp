@@ -0,0 +1,36 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && rm -rf %t.cache && HCC_KERNEL_CACHE_DIR=%t.cache %t.out && HCC_KERNEL_CACHE_DIR=%t.cache %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test kernels run the same whether their code object is finalized, on the
+// first run with an empty cache directory, or loaded from the code objects
+// cached on disk, on the second run
+
+#define VEC_SIZE (4096)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    table[idx] = idx[0] * idx[0];
+  });
+  hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    table[idx] -= idx[0];
+  });
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i * i - i);
+  }
+
+#if TEST_DEBUG
+  std::cout << "kernel cache: " << ret << "\n";
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,53 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+
+// Test accelerator_view::get_kernel_resources, the registers and segments
+// of a launched kernel as its code object reports them
+
+#define GROUP_SIZE (256)
+
+bool test() {
+  const int vecSize = 2048;
+
+  hc::array<int, 1> table(vecSize);
+  auto kernel = [&table](hc::tiled_index<1> tidx) [[hc]] {
+    tile_static int group[GROUP_SIZE];
+    group[tidx.local[0]] = tidx.global[0];
+    tidx.barrier.wait();
+    table[tidx.global[0]] = group[GROUP_SIZE - 1 - tidx.local[0]];
+  };
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::parallel_for_each(av, hc::extent<1>(vecSize).tile(GROUP_SIZE), kernel).wait();
+
+  hc::kernel_resources resources;
+  if (!av.get_kernel_resources(kernel, resources)) {
+    // the accelerator doesn't report the resources of its kernels
+    return true;
+  }
+
+  bool ret = true;
+  // the tile_static array is in the group segment
+  ret &= (resources.groupSegmentSize >= sizeof(int) * GROUP_SIZE);
+  if (resources.vgprCount || resources.sgprCount) {
+    ret &= (resources.wavesPerSIMD >= 1) && (resources.wavesPerSIMD <= 10);
+  }
+
+  std::vector<int> result = table;
+  for (int i = 0; i < vecSize; ++i) {
+    int tile = i / GROUP_SIZE;
+    ret &= (result[i] == tile * GROUP_SIZE + (GROUP_SIZE - 1 - i % GROUP_SIZE));
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
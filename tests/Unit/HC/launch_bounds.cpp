@@ -0,0 +1,45 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <vector>
+
+// Test hc_max_workgroup_dim: a kernel is launched with tiles up to its launch
+// bounds, a tile beyond them is rejected
+
+#define BOUND (64)
+
+bool test() {
+  const int vecSize = 1024;
+
+  hc::array<int, 1> table(vecSize);
+  auto kernel = [&table](hc::tiled_index<1> tidx) hc_max_workgroup_dim(64,1,1) hc_waves_per_eu(4) [[hc]] {
+    table[tidx.global[0]] = tidx.local[0];
+  };
+
+  bool ret = true;
+
+  hc::parallel_for_each(hc::extent<1>(vecSize).tile(BOUND), kernel).wait();
+  std::vector<int> result = table;
+  for (int i = 0; i < vecSize; ++i) {
+    ret &= (result[i] == i % BOUND);
+  }
+
+  bool rejected = false;
+  try {
+    hc::parallel_for_each(hc::extent<1>(vecSize).tile(BOUND * 2), kernel).wait();
+  } catch (hc::invalid_compute_domain&) {
+    rejected = true;
+  }
+  ret &= rejected;
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,74 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <vector>
+
+// test capturing a kernel launch once with hc::create_launch_template(),
+// launching it many times, and patching a kernel argument in between
+
+#define VEC_SIZE (256)
+#define LAUNCH_COUNT (1024)
+
+#define TEST_DEBUG (0)
+
+// the increment is the first captured variable, so it's serialized at
+// offset 0 of the kernel arguments
+class increment {
+public:
+  int inc;
+  hc::array_view<int, 1> table;
+
+  increment(int inc, const hc::array_view<int, 1>& table) : inc(inc), table(table) {}
+
+  void operator() (hc::index<1>& idx) const __HC__ {
+    table[idx] += inc;
+  }
+};
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) table[i] = i;
+  table.synchronize_to(av);
+
+  hc::launch_template lt = hc::create_launch_template(av, hc::extent<1>(VEC_SIZE), increment(1, table));
+  ret &= lt.valid();
+  ret &= (lt.get_arg_size() > sizeof(int));
+
+  // launches share the captured arguments
+  std::vector<hc::completion_future> futures;
+  for (int i = 0; i < LAUNCH_COUNT; ++i) {
+    futures.push_back(lt.launch());
+  }
+
+  // later launches pick up patched arguments
+  lt.set_arg(0, 2);
+  for (int i = 0; i < LAUNCH_COUNT; ++i) {
+    futures.push_back(lt.launch());
+  }
+  futures.back().wait();
+  av.wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i + LAUNCH_COUNT * 3);
+  }
+
+  // an empty extent gives an empty template
+  hc::launch_template empty = hc::create_launch_template(av, hc::extent<1>(0), increment(1, table));
+  ret &= (empty.valid() == false);
+  ret &= (empty.launch().valid() == false);
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,81 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_STAGE_IDLE_MS=1 %t.out
+#include <hc.hpp>
+
+#include <chrono>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// test arrays whose buffers are allocated on first use: scratch arrays only
+// used by kernels, and staging arrays whose copy on the associated
+// accelerator is released after being idle and allocated again when the
+// data goes back there
+
+#define VEC_SIZE (4096)
+#define ITERATION (4)
+
+#define TEST_DEBUG (0)
+
+bool test_scratch() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::array<int, 1> scratch(VEC_SIZE, av);
+  hc::array_view<int, 1> result(VEC_SIZE);
+
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&scratch](hc::index<1> idx) __HC__ {
+    scratch[idx] = idx[0] * 3;
+  });
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&scratch, result](hc::index<1> idx) __HC__ {
+    result[idx] = scratch[idx] + 1;
+  });
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (result[i] == i * 3 + 1);
+  }
+
+#if TEST_DEBUG
+  std::cout << "scratch: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+bool test_staging() {
+  bool ret = true;
+
+  hc::accelerator_view cpu_av = hc::accelerator(L"cpu").get_default_view();
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  std::vector<int> init(VEC_SIZE, 0);
+  hc::array<int, 1> staged(hc::extent<1>(VEC_SIZE), init.begin(), init.end(), cpu_av, av);
+
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&staged](hc::index<1> idx) __HC__ {
+      staged[idx] += 1;
+    }).wait();
+
+    // read on the host, then leave the copy on the accelerator idle
+    for (int i = 0; i < VEC_SIZE; ++i) {
+      ret &= (staged[i] == n + 1);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ret &= (staged[0] == n + 1);
+  }
+
+#if TEST_DEBUG
+  std::cout << "staging: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test_scratch();
+  ret &= test_staging();
+
+  return !(ret == true);
+}
@@ -0,0 +1,38 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test the devices are discovered on first use. the tick frequency is
+// queried before any accelerator is used, then all accelerators are listed
+// and a kernel is launched on the default one
+
+#define VEC_SIZE (256)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  ret &= (hc::get_tick_frequency() > 0);
+
+  // the CPU accelerator and at least one GPU
+  std::vector<hc::accelerator> accs = hc::accelerator::get_all();
+  ret &= (accs.size() >= 2);
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    table(idx) = idx[0];
+  }).wait();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i);
+  }
+
+#if TEST_DEBUG
+  std::cout << "accelerators: " << accs.size() << "\n";
+#endif
+
+  return !(ret == true);
+}
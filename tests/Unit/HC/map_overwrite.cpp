@@ -0,0 +1,55 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out && HCC_MAP_ZERO_COPY=0 %t.out && HCC_MAP_ZERO_COPY=0 HCC_MAP_WRITE_COMBINED=0 %t.out
+#include <hc.hpp>
+
+#include <list>
+#include <vector>
+
+// test copies from iterators which overwrite all of an array, or of a view
+// of it, through host buffers without the current content, and copies which
+// only write part of a view still keep the rest of it
+
+#define VEC_SIZE (1024)
+
+int main() {
+  bool ret = true;
+
+  std::vector<int> init(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i)
+    init[i] = i;
+
+  hc::array<int, 1> table(VEC_SIZE);
+  hc::array_view<int, 1> av(table);
+  hc::parallel_for_each(hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) [[hc]] {
+    av[idx] = -1;
+  }).wait();
+
+  // all of the array
+  hc::copy(init.begin(), init.end(), table);
+  std::vector<int> result(VEC_SIZE);
+  hc::copy(table, result.begin());
+  ret &= (result == init);
+
+  // all of a section of it
+  std::vector<int> half(VEC_SIZE / 2, 7);
+  hc::copy(half.begin(), half.end(), av.section(hc::index<1>(VEC_SIZE / 2), hc::extent<1>(VEC_SIZE / 2)));
+  hc::copy(table, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i)
+    ret &= (result[i] == (i < VEC_SIZE / 2 ? i : 7));
+
+  // part of a view, the rest is kept
+  std::vector<int> part(VEC_SIZE / 4, 3);
+  hc::copy(part.begin(), part.end(), av);
+  hc::copy(table, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i)
+    ret &= (result[i] == (i < VEC_SIZE / 4 ? 3 : i < VEC_SIZE / 2 ? i : 7));
+
+  // a range of non-contiguous iterators
+  std::list<int> list(init.rbegin(), init.rend());
+  hc::copy(list.begin(), list.end(), table);
+  hc::copy(table, result.begin());
+  for (int i = 0; i < VEC_SIZE; ++i)
+    ret &= (result[i] == VEC_SIZE - 1 - i);
+
+  return !(ret == true);
+}
@@ -0,0 +1,52 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out && HCC_MAP_ZERO_COPY=0 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <list>
+#include <vector>
+
+// test repeated copies between host containers and an array through map()
+// of device memory, which returns a direct pointer if the host can access
+// device memory, or copies through reused host buffers where only the
+// modified pages are copied back
+
+#define VEC_SIZE (1024 * 1024 + 3)
+#define FRAME_COUNT (4)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  std::vector<int> host_in(VEC_SIZE, 0);
+  std::list<int> host_out;
+  hc::array<int, 1> a(VEC_SIZE, av);
+
+  for (int frame = 0; frame < FRAME_COUNT; ++frame) {
+    // only a few pages differ from the previous frame
+    for (int i = 0; i < VEC_SIZE; i += VEC_SIZE / 7) host_in[i] = i + frame;
+
+    hc::copy(host_in.begin(), host_in.end(), a);
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&a](hc::index<1> idx) __HC__ {
+      a(idx) += 1;
+    }).wait();
+
+    host_out.assign(VEC_SIZE, 0);
+    hc::copy(a, host_out.begin());
+
+    int i = 0;
+    for (int value : host_out) {
+      ret &= (value == host_in[i] + 1);
+      ++i;
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << "host_out.front() = " << host_out.front() << "\n";
+#endif
+
+  return !(ret == true);
+}
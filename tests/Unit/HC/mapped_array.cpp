@@ -0,0 +1,63 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_mapped_array.hpp>
+
+#include <cstdio>
+#include <string>
+
+// Test the arrays backed by files, streamed through an accelerator in chunks
+// by for_each_chunk(), the modified chunks are written back to the file and
+// read again by a read-only array of it
+
+#define SIZE (1000 * 1000)
+#define CHUNK (64 * 1024)
+
+int main() {
+  bool ret = true;
+
+  char name[] = "/tmp/hcc_mapped_array_XXXXXX";
+  int fd = mkstemp(name);
+  if (fd < 0)
+    return 1;
+  close(fd);
+  std::string path(name);
+
+  {
+    hc::mapped_array<int> table(path, SIZE, CHUNK);
+    ret &= (table.size() == SIZE);
+    ret &= (table.chunk_count() == (SIZE + CHUNK - 1) / CHUNK);
+    for (int i = 0; i < SIZE; ++i)
+      table.data()[i] = i;
+
+    hc::accelerator_view av = hc::accelerator().get_default_view();
+    table.for_each_chunk(av, [&](const hc::array_view<int, 1>& chunk, size_t first) {
+      hc::parallel_for_each(av, chunk.get_extent(), [=](hc::index<1> idx) [[hc]] {
+        chunk[idx] = chunk[idx] * 2 + 1;
+      });
+    });
+    table.flush();
+  }
+
+  {
+    hc::mapped_array<const int> table(path, 0, CHUNK);
+    ret &= (table.size() == SIZE);
+    hc::array_view<int, 1> sums(table.chunk_count());
+    hc::accelerator_view av = hc::accelerator().get_default_view();
+    table.for_each_chunk(av, [&](const hc::array_view<const int, 1>& chunk, size_t first) {
+      int i = first / CHUNK;
+      int count = chunk.get_extent()[0];
+      hc::parallel_for_each(av, hc::extent<1>(1), [=](hc::index<1> idx) [[hc]] {
+        int sum = 0;
+        for (int j = 0; j < count; ++j)
+          sum += (chunk[j] == 2 * (int(first) + j) + 1) ? 1 : 0;
+        sums[i] = sum;
+      });
+    });
+    for (size_t i = 0; i < table.chunk_count(); ++i)
+      ret &= (sums[i] == table.chunk(i).get_extent()[0]);
+  }
+
+  std::remove(name);
+  return !(ret == true);
+}
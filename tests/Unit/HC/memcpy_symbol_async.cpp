@@ -0,0 +1,84 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+
+// test hc::accelerator_view::memcpy_symbol_async(), which updates a global
+// variable in the order of the kernels of the view, so each kernel sees the
+// value copied right before it was launched, without waiting on the host
+
+#define GRID_SIZE (16)
+#define FRAMES (8)
+
+#define __DEVICE __attribute__((address_space(1)))
+
+#define TEST_DEBUG (0)
+
+__DEVICE int frameGlobal[GRID_SIZE];
+
+using namespace hc;
+
+bool test() {
+  bool ret = true;
+
+  accelerator_view av = accelerator().get_default_view();
+  array_view<int, 2> output(FRAMES, GRID_SIZE);
+
+  // per-frame values, kept alive until the copies are done
+  int frames[FRAMES][GRID_SIZE];
+  for (int f = 0; f < FRAMES; ++f) {
+    for (int i = 0; i < GRID_SIZE; ++i) {
+      frames[f][i] = f * GRID_SIZE + i;
+    }
+  }
+
+  std::vector<completion_future> copies;
+  for (int f = 0; f < FRAMES; ++f) {
+    // by name for the first frame, by the address afterwards
+    if (f == 0) {
+      copies.push_back(av.memcpy_symbol_async("frameGlobal", frames[f], sizeof(int) * GRID_SIZE));
+    } else {
+      void* addr = GET_SYMBOL_ADDRESS(av.get_accelerator(), frameGlobal);
+      copies.push_back(av.memcpy_symbol_async(addr, frames[f], sizeof(int) * GRID_SIZE));
+    }
+    parallel_for_each(av, extent<1>(GRID_SIZE), [=](hc::index<1> idx) __attribute__((hc)) {
+      output(f, idx[0]) = frameGlobal[idx[0]];
+    });
+  }
+
+  // read back the last frame, ordered after the last kernel
+  int last[GRID_SIZE] { 0 };
+  completion_future readback = av.memcpy_symbol_async("frameGlobal", last, sizeof(int) * GRID_SIZE, 0, hcMemcpyDeviceToHost);
+  readback.wait();
+  for (auto& copy : copies) {
+    copy.wait();
+  }
+
+  for (int f = 0; f < FRAMES; ++f) {
+    for (int i = 0; i < GRID_SIZE; ++i) {
+      ret &= (output(f, i) == frames[f][i]);
+    }
+  }
+  for (int i = 0; i < GRID_SIZE; ++i) {
+    ret &= (last[i] == frames[FRAMES - 1][i]);
+  }
+
+  // unknown variables give a future which isn't valid
+  ret &= !av.memcpy_symbol_async("noSuchGlobal", last, sizeof(int)).valid();
+
+#if TEST_DEBUG
+  std::cout << "memcpy_symbol_async: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,48 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_HSA_MEMORY_CACHE=ON %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test temporary arrays created and destroyed repeatedly are served from
+// the device memory cache, and the free memory kept by it is released by
+// trim_memory_cache()
+
+#define VEC_SIZE (1000)
+#define ITERATION (256)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::accelerator_view av = acc.get_default_view();
+
+  for (int n = 0; n < ITERATION; ++n) {
+    // sizes of the same size class share blocks
+    hc::array<int, 1> a(VEC_SIZE + (n % 16), av);
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&a](hc::index<1> idx) __HC__ {
+      a(idx) = idx[0];
+    }).wait();
+    std::vector<int> host(VEC_SIZE + (n % 16));
+    hc::copy(a, host.data());
+    ret &= (host[VEC_SIZE - 1] == VEC_SIZE - 1);
+  }
+
+#if TEST_DEBUG
+  std::cout << "hits: " << acc.get_memory_cache_hits()
+            << ", misses: " << acc.get_memory_cache_misses()
+            << ", cached: " << acc.get_memory_cache_size() << "\n";
+#endif
+
+  ret &= (acc.get_memory_cache_hits() >= ITERATION - 1);
+  ret &= (acc.get_memory_cache_size() > 0);
+
+  size_t released = acc.trim_memory_cache();
+  ret &= (released > 0);
+  ret &= (acc.get_memory_cache_size() == 0);
+
+  return !(ret == true);
+}
@@ -0,0 +1,57 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_stats.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <vector>
+
+// Test the memory tags, the buffers of the arrays created while a tag is in
+// scope are accounted to it on their accelerator, and given back once the
+// arrays are destroyed, the high watermark of the tag staying
+
+#define SIZE (1024 * 1024)
+
+bool find(const char* tag, uint32_t device, hc_memory_stats& found) {
+  size_t count = hc_get_memory_stats(nullptr, 0);
+  std::vector<hc_memory_stats> stats(count);
+  count = std::min(count, hc_get_memory_stats(stats.data(), count));
+  for (size_t i = 0; i < count; ++i) {
+    if (stats[i].device == device && stats[i].tag && strcmp(stats[i].tag, tag) == 0) {
+      found = stats[i];
+      return true;
+    }
+  }
+  return false;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  uint32_t device = av.get_stats().device;
+
+  hc_memory_stats stats;
+  {
+    hc::memory_tag tag("memory_stats");
+    ret &= (strcmp(hc_get_memory_tag(), "memory_stats") == 0);
+
+    hc::array<int, 1> a(SIZE, av);
+    hc::array<int, 1> b(SIZE, av);
+    ret &= find("memory_stats", device, stats);
+    ret &= (stats.bytes >= 2 * SIZE * sizeof(int));
+    ret &= (stats.allocations >= 2);
+  }
+  ret &= (hc_get_memory_tag() == nullptr);
+
+  ret &= find("memory_stats", device, stats);
+  ret &= (stats.bytes == 0);
+  ret &= (stats.peak_bytes >= 2 * SIZE * sizeof(int));
+  ret &= (stats.releases == stats.allocations);
+
+  hc_print_memory_stats();
+
+  return !(ret == true);
+}
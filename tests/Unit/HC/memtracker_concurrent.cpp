@@ -0,0 +1,84 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// test looking up pointers in the memory tracker from several threads while
+// another thread adds and removes batches of ranges: the ranges tracked for
+// the whole test are always found, and batches are found once added and not
+// found once removed
+
+#define RANGE_SIZE (4096)
+#define RANGE_COUNT (64)
+#define BATCH_COUNT (256)
+#define THREAD_COUNT (4)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+
+  // ranges tracked throughout the test
+  std::vector<char> fixed(RANGE_SIZE * RANGE_COUNT);
+  std::vector<void*> fixedPtrs;
+  std::vector<size_t> sizes(RANGE_COUNT, RANGE_SIZE);
+  for (int i = 0; i < RANGE_COUNT; ++i) {
+    fixedPtrs.push_back(&fixed[i * RANGE_SIZE]);
+  }
+  ret &= (hc::am_memtracker_add_batch(RANGE_COUNT, fixedPtrs.data(), sizes.data(), acc) == AM_SUCCESS);
+
+  std::atomic<bool> done(false);
+  std::atomic<int> misses(0);
+  std::vector<std::thread> readers;
+  for (int t = 0; t < THREAD_COUNT; ++t) {
+    readers.push_back(std::thread([&, t]() {
+      hc::AmPointerInfo info(NULL, NULL, 0, acc, false, false);
+      int i = t;
+      while (!done.load()) {
+        void* ptr = &fixed[(i % RANGE_COUNT) * RANGE_SIZE + (i % RANGE_SIZE)];
+        if (hc::am_memtracker_getinfo(&info, ptr) != AM_SUCCESS ||
+            info._sizeBytes != RANGE_SIZE) {
+          misses++;
+        }
+        ++i;
+      }
+    }));
+  }
+
+  // ranges added and removed while the readers run
+  std::vector<char> moving(RANGE_SIZE * RANGE_COUNT);
+  std::vector<void*> movingPtrs;
+  for (int i = 0; i < RANGE_COUNT; ++i) {
+    movingPtrs.push_back(&moving[i * RANGE_SIZE]);
+  }
+  hc::AmPointerInfo info(NULL, NULL, 0, acc, false, false);
+  for (int n = 0; n < BATCH_COUNT; ++n) {
+    ret &= (hc::am_memtracker_add_batch(RANGE_COUNT, movingPtrs.data(), sizes.data(), acc) == AM_SUCCESS);
+    ret &= (hc::am_memtracker_getinfo(&info, movingPtrs[n % RANGE_COUNT]) == AM_SUCCESS);
+    ret &= (hc::am_memtracker_remove_batch(RANGE_COUNT, movingPtrs.data()) == AM_SUCCESS);
+    ret &= (hc::am_memtracker_getinfo(&info, movingPtrs[n % RANGE_COUNT]) != AM_SUCCESS);
+  }
+
+  done.store(true);
+  for (auto& reader : readers) {
+    reader.join();
+  }
+  ret &= (misses.load() == 0);
+
+  // removing untracked pointers is reported
+  ret &= (hc::am_memtracker_remove_batch(RANGE_COUNT, fixedPtrs.data()) == AM_SUCCESS);
+  ret &= (hc::am_memtracker_remove_batch(RANGE_COUNT, fixedPtrs.data()) != AM_SUCCESS);
+
+#if TEST_DEBUG
+  std::cout << "misses: " << misses.load() << "\n";
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,56 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && HCC_QUEUES_PER_VIEW=4 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test an accelerator_view executing in any order backed by several HSA
+// queues. independent kernels are distributed over the queues, dependent
+// ones are kept in order across them, and a marker waits for all of them
+
+#define KERNEL_COUNT (16)
+#define VEC_SIZE (256)
+#define ITERATION (8)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().create_view(hc::execute_any_order);
+
+  std::vector< hc::array_view<int, 1> > tables;
+  for (int k = 0; k < KERNEL_COUNT; ++k) {
+    hc::array_view<int, 1> table(VEC_SIZE);
+    for (int i = 0; i < VEC_SIZE; ++i) table[i] = 0;
+    tables.push_back(table);
+  }
+
+  // each table is incremented ITERATION times in a row, the increments of a
+  // table depend on each other but not on those of other tables
+  for (int n = 0; n < ITERATION; ++n) {
+    for (int k = 0; k < KERNEL_COUNT; ++k) {
+      hc::array_view<int, 1> table = tables[k];
+      hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+        table(idx) = table(idx) * 2 + 1;
+      });
+    }
+  }
+
+  // the marker completes only after every kernel before it
+  av.create_marker().wait();
+  ret &= (av.get_pending_async_ops() == 0);
+
+  for (int k = 0; k < KERNEL_COUNT; ++k) {
+    for (int i = 0; i < VEC_SIZE; ++i) {
+      ret &= (tables[k][i] == (1 << ITERATION) - 1);
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << "tables[0][0] = " << tables[0][0] << "\n";
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,58 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test pinned host memory and array_views on every GPU accelerator. the
+// system memory pools of each accelerator come from the CPU nearest to it,
+// which must be accessible from kernels running on that accelerator
+
+#define VEC_SIZE (4096)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator& acc) {
+  bool ret = true;
+
+  int* pinned = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, amHostPinned));
+  if (pinned == nullptr)
+    return false;
+  for (int i = 0; i < VEC_SIZE; ++i) pinned[i] = i;
+
+  // goes through the staging buffers of the accelerator
+  hc::array_view<int, 1> table(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) table[i] = 0;
+
+  hc::parallel_for_each(acc.get_default_view(), hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    table(idx) = pinned[idx[0]] * 2;
+    pinned[idx[0]] += 1;
+  }).wait();
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (pinned[i] == i + 1);
+    ret &= (table[i] == i * 2);
+  }
+
+#if TEST_DEBUG
+  std::wcout << acc.get_description() << L": " << ret << L"\n";
+#endif
+
+  hc::am_free(pinned);
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  std::vector<hc::accelerator> accs = hc::accelerator::get_all();
+  for (auto& acc : accs) {
+    if (acc.is_hsa_accelerator()) {
+      ret &= test(acc);
+    }
+  }
+
+  return !(ret == true);
+}
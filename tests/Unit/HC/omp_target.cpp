@@ -0,0 +1,60 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_omp.hpp>
+
+#include <vector>
+
+// Test the OpenMP style loops offloaded by hc::omp: a loop over mapped host
+// data, the loop of the omp_reduction sample, and a reduction with more
+// iterations than its teams have work-items
+
+#define SIZE (10000)
+
+int main() {
+  bool ret = true;
+
+  std::vector<int> a(SIZE), b(SIZE, -1), c(SIZE);
+  for (int i = 0; i < SIZE; ++i) {
+    a[i] = i;
+    c[i] = 1;
+  }
+  {
+    hc::array_view<const int, 1> av_a = hc::omp::map_to(a.data(), SIZE);
+    hc::array_view<int, 1> av_b = hc::omp::map_from(b.data(), SIZE);
+    hc::array_view<int, 1> av_c = hc::omp::map_tofrom(c.data(), SIZE);
+    hc::omp::parallel_for(0, SIZE, [=](int i) [[hc]] {
+      av_b[i] = 2 * av_a[i];
+      av_c[i] += av_a[i];
+    });
+  }
+  for (int i = 0; i < SIZE; ++i) {
+    ret &= (b[i] == 2 * i);
+    ret &= (c[i] == i + 1);
+  }
+
+  // #pragma omp parallel for reduction(+:sum)
+  float x[100], y[100];
+  for (int i = 0; i < 100; ++i)
+    x[i] = y[i] = i * 1.0f;
+  hc::array_view<const float, 1> av_x = hc::omp::map_to(x, 100);
+  hc::array_view<const float, 1> av_y = hc::omp::map_to(y, 100);
+  float sum = hc::omp::parallel_for_reduce(0, 100, 0.0f,
+    [](float l, float r) [[hc]] { return l + r; },
+    [=](int i) [[hc]] { return av_x[i] * av_y[i]; });
+  ret &= (sum == 328350.0f);
+
+  // more iterations than HC_OMP_MAX_TEAMS * HC_OMP_TEAM_SIZE, from an offset
+  const int first = 7;
+  const int last = HC_OMP_MAX_TEAMS * HC_OMP_TEAM_SIZE * 3 + 11;
+  long long total = hc::omp::parallel_for_reduce(first, last, 5LL,
+    [](long long l, long long r) [[hc]] { return l + r; },
+    [](int i) [[hc]] { return (long long)i; });
+  ret &= (total == 5LL + ((long long)last * (last - 1) - (long long)first * (first - 1)) / 2);
+
+  // an empty loop reduces to its initial value
+  ret &= (hc::omp::parallel_for_reduce(3, 3, 42, [](int l, int r) [[hc]] { return l + r; },
+                                       [](int i) [[hc]] { return i; }) == 42);
+
+  return !(ret == true);
+}
@@ -0,0 +1,46 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out && HCC_PINNED_CACHE_SIZE=4 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test repeated transfers of pageable host memory larger than a staging
+// buffer, and not a multiple of it, to and from the device. they are
+// streamed through the staging buffers, or copied through the pinned cache
+// if it's enabled
+
+#define VEC_SIZE (3 * 1024 * 1024 + 17)
+#define FRAME_COUNT (8)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  std::vector<int> host_in(VEC_SIZE);
+  std::vector<int> host_out(VEC_SIZE);
+  hc::array<int, 1> a(VEC_SIZE, av);
+
+  for (int frame = 0; frame < FRAME_COUNT; ++frame) {
+    for (int i = 0; i < VEC_SIZE; ++i) host_in[i] = i + frame;
+
+    hc::copy(host_in.begin(), host_in.end(), a);
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [&a](hc::index<1> idx) __HC__ {
+      a(idx) += 1;
+    }).wait();
+    hc::copy(a, host_out.begin());
+
+    for (int i = 0; i < VEC_SIZE; ++i) {
+      ret &= (host_out[i] == i + frame + 1);
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << "host_out[1] = " << host_out[1] << "\n";
+#endif
+
+  return !(ret == true);
+}
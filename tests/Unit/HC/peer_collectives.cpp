@@ -0,0 +1,111 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+#include <hc_peer_collectives.hpp>
+
+#include <vector>
+
+// test all-reduce, broadcast and all-gather of hc::collectives across the
+// GPU accelerators, with more views of the first one when there are fewer
+// than RANKS, and chunks of uneven sizes
+
+#define RANKS (3)
+#define VEC_SIZE (1000)
+
+bool check(const int* ptr, size_t count, const std::vector<int>& expected) {
+  std::vector<int> result(count);
+  hc::am_copy(result.data(), ptr, count * sizeof(int));
+  return result == expected;
+}
+
+bool test(std::vector<hc::accelerator_view>& views) {
+  bool ret = true;
+  hc::collectives::communicator comm(views);
+  const int n = comm.size();
+  ret &= (comm.get_ring().size() == views.size());
+  ret &= (comm.get_ring()[0] == 0);
+
+  std::vector<int*> buffers(n);
+  std::vector<int*> gathered(n);
+  for (int r = 0; r < n; ++r) {
+    hc::accelerator acc = views[r].get_accelerator();
+    buffers[r] = static_cast<int*>(hc::am_alloc(VEC_SIZE * sizeof(int), acc, 0));
+    gathered[r] = static_cast<int*>(hc::am_alloc(n * VEC_SIZE * sizeof(int), acc, 0));
+    if (buffers[r] == nullptr || gathered[r] == nullptr)
+      return false;
+    std::vector<int> init(VEC_SIZE);
+    for (int i = 0; i < VEC_SIZE; ++i)
+      init[i] = r * VEC_SIZE + i;
+    hc::am_copy(buffers[r], init.data(), VEC_SIZE * sizeof(int));
+  }
+
+  // all-gather first, while each rank still has its own data
+  std::vector<const int*> send(buffers.begin(), buffers.end());
+  for (auto& f : comm.all_gather(send, gathered, VEC_SIZE))
+    f.wait();
+  std::vector<int> all(n * VEC_SIZE);
+  for (int i = 0; i < n * VEC_SIZE; ++i)
+    all[i] = i;
+  for (int r = 0; r < n; ++r)
+    ret &= check(gathered[r], n * VEC_SIZE, all);
+
+  // all-reduce, by a sum and by a max
+  std::vector<int> sum(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i)
+    sum[i] = n * i + VEC_SIZE * (n * (n - 1) / 2);
+  for (auto& f : comm.all_reduce(buffers, VEC_SIZE))
+    f.wait();
+  for (int r = 0; r < n; ++r)
+    ret &= check(buffers[r], VEC_SIZE, sum);
+
+  for (int r = 0; r < n; ++r)
+    hc::am_copy(buffers[r], &all[r * VEC_SIZE], VEC_SIZE * sizeof(int));
+  for (auto& f : comm.all_reduce(buffers, VEC_SIZE, [](int a, int b) [[hc]] { return a > b ? a : b; }))
+    f.wait();
+  std::vector<int> max(all.end() - VEC_SIZE, all.end());
+  for (int r = 0; r < n; ++r)
+    ret &= check(buffers[r], VEC_SIZE, max);
+
+  // broadcast of the data of the last rank, and of a count smaller than the
+  // number of ranks
+  for (int r = 0; r < n; ++r)
+    hc::am_copy(buffers[r], &all[r * VEC_SIZE], VEC_SIZE * sizeof(int));
+  for (auto& f : comm.broadcast(buffers, VEC_SIZE, n - 1))
+    f.wait();
+  for (int r = 0; r < n; ++r)
+    ret &= check(buffers[r], VEC_SIZE, max);
+  for (auto& f : comm.broadcast(buffers, 1, 0))
+    f.wait();
+  for (int r = 0; r < n; ++r)
+    ret &= check(buffers[r], 1, std::vector<int>(1, max[0]));
+
+  for (int r = 0; r < n; ++r) {
+    hc::am_free(buffers[r]);
+    hc::am_free(gathered[r]);
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  std::vector<hc::accelerator_view> views;
+  for (auto& acc : hc::accelerator::get_all()) {
+    if (acc.is_hsa_accelerator()) {
+      views.push_back(acc.create_view());
+    }
+  }
+  if (views.empty())
+    return 0;
+  while (views.size() < RANKS)
+    views.push_back(views[0].get_accelerator().create_view());
+
+  ret &= test(views);
+
+  // a single rank has nothing to exchange
+  std::vector<hc::accelerator_view> one(1, views[0]);
+  ret &= test(one);
+
+  return !(ret == true);
+}
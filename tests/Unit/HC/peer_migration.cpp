@@ -0,0 +1,52 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out && HCC_STAGING_BUFFER_SIZE=256 %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test an array_view which migrates back and forth between two GPUs. the
+// data is copied directly between peers, or streamed through staging
+// buffers in host memory. the test passes trivially on a single GPU
+
+#define VEC_SIZE (1024 * 1024 + 9)
+#define ITERATION (8)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  std::vector<hc::accelerator> gpus;
+  for (auto& acc : hc::accelerator::get_all()) {
+    if (!acc.get_is_emulated()) {
+      gpus.push_back(acc);
+    }
+  }
+  if (gpus.size() < 2) {
+    return 0;
+  }
+
+  hc::accelerator_view av1 = gpus[0].get_default_view();
+  hc::accelerator_view av2 = gpus[1].get_default_view();
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) table[i] = i;
+
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::accelerator_view& av = (n % 2) ? av2 : av1;
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    }).wait();
+  }
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (table[i] == i + ITERATION);
+  }
+
+#if TEST_DEBUG
+  std::cout << "table[1] = " << table[1] << ", peers: " << gpus[0].get_is_peer(gpus[1]) << "\n";
+#endif
+
+  return !(ret == true);
+}
@@ -0,0 +1,65 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+#include <hc_persistent.hpp>
+
+#include <iostream>
+
+// test a persistent_kernel, whose long-running grid runs the descriptors the
+// host enqueues to its work queue, more of them than the queue holds, and
+// which are waited for one at a time and all at once
+
+#define WORKERS (64)
+#define CAPACITY (256)
+#define COUNT (10000)
+
+#define TEST_DEBUG (0)
+
+struct work {
+  int* table;
+  int index;
+  int value;
+};
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  if (!acc.is_hsa_accelerator())
+    return 0;
+
+  int* table = static_cast<int*>(hc::am_alloc(COUNT * sizeof(int), acc, amHostPinned));
+  if (table == nullptr)
+    return 1;
+  for (int i = 0; i < COUNT; ++i) table[i] = 0;
+
+  {
+    hc::persistent_kernel<work> kernel(acc.get_default_view(), WORKERS, CAPACITY, [](const work& w) __HC__ {
+      w.table[w.index] += w.value;
+    });
+
+    uint64_t ticket = kernel.enqueue(work{ table, 0, 1 });
+    kernel.wait(ticket);
+    ret &= kernel.is_done(ticket);
+    ret &= (table[0] == 1);
+
+    for (int i = 1; i < COUNT; ++i) {
+      kernel.enqueue(work{ table, i, i + 1 });
+    }
+    kernel.wait_all();
+    for (int i = 0; i < COUNT; ++i) {
+      ret &= (table[i] == i + 1);
+    }
+
+    // the grid is stopped as the kernel is destroyed
+  }
+
+#if TEST_DEBUG
+  std::cout << ret << "\n";
+#endif
+
+  hc::am_free(table);
+
+  return !(ret == true);
+}
@@ -0,0 +1,70 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <vector>
+
+// Test parallel_for_each over extents read from device memory: a kernel
+// compacts the odd elements and counts them, and the kernel processing the
+// compacted elements is sized by the count without it being read by the host
+
+#define SIZE (4096)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  std::vector<int> input(SIZE);
+  for (int i = 0; i < SIZE; ++i)
+    input[i] = i;
+  hc::array<int, 1> data(SIZE, input.begin(), input.end(), av);
+  hc::array<int, 1> compacted(SIZE, av);
+  hc::array<unsigned int, 1> count(3, av);
+  std::vector<unsigned int> zero(3, 0);
+  hc::copy(zero.begin(), zero.end(), count);
+
+  hc::parallel_for_each(av, hc::extent<1>(SIZE), [&](hc::index<1> idx) [[hc]] {
+    if (data[idx] % 2) {
+      unsigned int slot = hc::atomic_fetch_inc(&count[0]);
+      compacted[slot] = data[idx];
+    }
+  });
+
+  hc::parallel_for_each(av, hc::indirect_extent<1>(count), [&](hc::index<1> idx) [[hc]] {
+    compacted[idx] = -compacted[idx];
+  }).wait();
+
+  std::vector<int> result = compacted;
+  long sum = 0;
+  for (int i = 0; i < SIZE / 2; ++i) {
+    ret &= (result[i] < 0 && (-result[i]) % 2 == 1);
+    sum -= result[i];
+  }
+  ret &= (sum == long(SIZE / 2) * (SIZE / 2));
+
+  // 2D extents, and empty ones
+  hc::array<unsigned int, 1> sizes(2, av);
+  std::vector<unsigned int> dims = { 3, 5 };
+  hc::copy(dims.begin(), dims.end(), sizes);
+  hc::array<int, 2> grid(8, 8, av);
+  hc::parallel_for_each(av, grid.get_extent(), [&](hc::index<2> idx) [[hc]] {
+    grid[idx] = 0;
+  });
+  hc::parallel_for_each(av, hc::indirect_extent<2>(sizes), [&](hc::index<2> idx) [[hc]] {
+    grid[idx] = 1;
+  }).wait();
+  std::vector<int> cells = grid;
+  for (int i = 0; i < 8; ++i)
+    for (int j = 0; j < 8; ++j)
+      ret &= (cells[i * 8 + j] == (i < 3 && j < 5 ? 1 : 0));
+
+  hc::copy(zero.begin(), zero.begin() + 2, sizes);
+  hc::parallel_for_each(av, hc::indirect_extent<2>(sizes), [&](hc::index<2> idx) [[hc]] {
+    grid[idx] = 2;
+  }).wait();
+  cells = grid;
+  for (int i = 0; i < 64; ++i)
+    ret &= (cells[i] != 2);
+
+  return !(ret == true);
+}
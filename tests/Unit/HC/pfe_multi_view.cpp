@@ -0,0 +1,70 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test parallel_for_each sharded over several accelerator_views, on all GPU
+// accelerators or on several views of one if there is only one. Kernels read
+// an array_view made valid on all of them, and write the rows of their own
+// shard, which are gathered when used next, by the host or by later launches
+
+#define ROWS (1000)
+#define COLS (64)
+#define ITERATION (4)
+
+#define TEST_DEBUG (0)
+
+bool test(const std::vector<hc::accelerator_view>& views) {
+  bool ret = true;
+
+  std::vector<int> init(ROWS * COLS);
+  for (int i = 0; i < ROWS * COLS; ++i) init[i] = i;
+  hc::array_view<const int, 2> input(ROWS, COLS, init);
+  hc::array_view<int, 2> table(ROWS, COLS);
+
+  hc::parallel_for_each(views, table.get_extent(), [=](hc::index<2> idx) __HC__ {
+    table[idx] = input[idx];
+  }).wait();
+
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::parallel_for_each(views, table.get_extent(), [=](hc::index<2> idx) __HC__ {
+      table[idx] += input[ROWS - 1 - idx[0]][idx[1]];
+    });
+  }
+
+  for (int i = 0; i < ROWS; ++i) {
+    for (int j = 0; j < COLS; ++j) {
+      ret &= (table(i, j) == i * COLS + j + ITERATION * ((ROWS - 1 - i) * COLS + j));
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << views.size() << " views: " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  std::vector<hc::accelerator_view> views;
+  for (auto& acc : hc::accelerator::get_all()) {
+    if (acc.is_hsa_accelerator()) {
+      views.push_back(acc.get_default_view());
+    }
+  }
+  if (views.empty())
+    return 0;
+
+  ret &= test(std::vector<hc::accelerator_view>(1, views[0]));
+  if (views.size() == 1) {
+    views.push_back(views[0].get_accelerator().create_view());
+    views.push_back(views[0].get_accelerator().create_view());
+  }
+  ret &= test(views);
+
+  return !(ret == true);
+}
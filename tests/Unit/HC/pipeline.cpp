@@ -0,0 +1,53 @@
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_pipeline.hpp>
+
+#include <vector>
+
+// Test the streaming pipeline, chunks of a host array are produced, squared
+// by a kernel and consumed in order, and the pipeline accounts for them
+
+#define SIZE (1000 * 1000)
+#define CHUNK (64 * 1024)
+
+int main() {
+  bool ret = true;
+
+  std::vector<int> input(SIZE);
+  for (int i = 0; i < SIZE; ++i)
+    input[i] = i % 1000;
+  std::vector<long> output;
+  output.reserve(SIZE);
+
+  hc::pipeline<int, long> stream(CHUNK, 3);
+  size_t produced = 0;
+  size_t chunks = stream.run(
+    [&](int* buffer, size_t capacity) {
+      size_t count = std::min(capacity, input.size() - produced);
+      std::copy(input.begin() + produced, input.begin() + produced + count, buffer);
+      produced += count;
+      return count;
+    },
+    [](hc::accelerator_view& av, const hc::array_view<const int, 1>& in, const hc::array_view<long, 1>& out) {
+      hc::parallel_for_each(av, in.get_extent(), [=](hc::index<1> idx) [[hc]] {
+        out[idx] = long(in[idx]) * in[idx];
+      });
+    },
+    [&](const long* buffer, size_t count) {
+      output.insert(output.end(), buffer, buffer + count);
+    });
+
+  ret &= (chunks == (SIZE + CHUNK - 1) / CHUNK);
+  ret &= (output.size() == SIZE);
+  for (int i = 0; i < SIZE && ret; ++i)
+    ret &= (output[i] == long(i % 1000) * (i % 1000));
+
+  hc_pipeline_stats stats = stream.get_stats();
+  ret &= (stats.chunks == chunks);
+  ret &= (stats.bytes_in == SIZE * sizeof(int));
+  ret &= (stats.bytes_out == SIZE * sizeof(long));
+  ret &= (stats.overlap_ns <= stats.upload_ns + stats.kernel_ns + stats.download_ns);
+
+  return !(ret == true);
+}
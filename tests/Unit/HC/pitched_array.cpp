@@ -0,0 +1,76 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test the pitched layout of arrays, whose rows are padded to an alignment,
+// the elements are copied in and out of them, indexed by kernels and views
+// as those of dense arrays, and transposed through tile_static memory
+
+#define ROWS (64)
+#define COLS (100)
+#define TILE (16)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::extent<2> ext(ROWS, COLS);
+  hc::array<float, 2> table(ext, av, hc::pitched_layout(256));
+  ret &= table.is_pitched();
+  ret &= (table.get_pitch() % 256 == 0);
+  ret &= (table.get_pitch() >= COLS * sizeof(float));
+
+  std::vector<float> host(ROWS * COLS);
+  for (int i = 0; i < ROWS * COLS; ++i)
+    host[i] = i;
+  hc::copy(host.begin(), host.end(), table);
+
+  hc::parallel_for_each(av, table.get_extent(), [&table](hc::index<2> idx) [[hc]] {
+    table[idx] += 1.0f;
+  });
+
+  std::vector<float> result(ROWS * COLS);
+  hc::copy(table, result.begin());
+  for (int i = 0; i < ROWS * COLS; ++i)
+    ret &= (result[i] == i + 1.0f);
+
+  // views and projections see the elements, not the padding
+  hc::array_view<float, 2> view(table);
+  ret &= (view(1, 0) == COLS + 1.0f);
+  hc::array_view<float, 2> sec = view.section(hc::index<2>(2, 3), hc::extent<2>(4, 5));
+  ret &= (sec(1, 1) == 3 * COLS + 4 + 1.0f);
+  ret &= (table[3][4] == 3 * COLS + 4 + 1.0f);
+
+  // copies between arrays of different layouts
+  hc::array<float, 2> dense(ext, av);
+  hc::copy(table, dense);
+  std::vector<float> dense_result = dense;
+  ret &= (dense_result[COLS] == COLS + 1.0f);
+
+  // transpose through tile_static memory, the rows of both arrays are aligned
+  hc::array<float, 2> transposed(hc::extent<2>(COLS, ROWS), av, hc::pitched_layout(128));
+  ret &= (transposed.get_pitch() % 128 == 0);
+  hc::parallel_for_each(av, hc::extent<2>(ROWS, TILE * ((COLS + TILE - 1) / TILE)).tile(TILE, TILE),
+                        [&table, &transposed](hc::tiled_index<2> tidx) [[hc]] {
+    tile_static float tile[TILE][TILE + 1];
+    int row = tidx.global[0];
+    int col = tidx.global[1];
+    if (col < COLS)
+      tile[tidx.local[0]][tidx.local[1]] = table(row, col);
+    tidx.barrier.wait();
+    int trow = tidx.tile_origin[1] + tidx.local[0];
+    int tcol = tidx.tile_origin[0] + tidx.local[1];
+    if (trow < COLS)
+      transposed(trow, tcol) = tile[tidx.local[1]][tidx.local[0]];
+  });
+  std::vector<float> tresult(ROWS * COLS);
+  hc::copy(transposed, tresult.begin());
+  for (int r = 0; r < ROWS; ++r)
+    for (int c = 0; c < COLS; ++c)
+      ret &= (tresult[c * ROWS + r] == host[r * COLS + c] + 1.0f);
+
+  return !(ret == true);
+}
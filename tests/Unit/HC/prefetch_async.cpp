@@ -0,0 +1,59 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test prefetching array_views to an accelerator while a previous kernel
+// runs, back to the host, and kernels reading data advised as read mostly
+
+#define VEC_SIZE (4 * 1024 * 1024)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::accelerator_view cpu_av = hc::accelerator(L"cpu").get_default_view();
+
+  std::vector<int> a_host(VEC_SIZE), b_host(VEC_SIZE), c_host(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    a_host[i] = i;
+    b_host[i] = 2 * i;
+    c_host[i] = 3 * i;
+  }
+  hc::array_view<int, 1> a(VEC_SIZE, a_host);
+  hc::array_view<const int, 1> b(VEC_SIZE, b_host);
+  hc::array_view<const int, 1> c(VEC_SIZE, c_host);
+
+  // b migrates while the kernel on a runs
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    a(idx) += 1;
+  });
+  hc::completion_future p = b.prefetch_async(av);
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    a(idx) += b(idx);
+  });
+  p.wait();
+  ret &= p.is_ready();
+
+  // c is copied asynchronously when the kernel is launched
+  c.advise(hc::hcMemoryAdviseReadMostly);
+  hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+    a(idx) += c(idx);
+  });
+
+  // the results come back to the host ahead of the host access
+  a.prefetch_async(cpu_av).wait();
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    ret &= (a[i] == 6 * i + 1);
+  }
+
+#if TEST_DEBUG
+  std::cout << "a[1] = " << a[1] << "\n";
+#endif
+
+  return !(ret == true);
+}
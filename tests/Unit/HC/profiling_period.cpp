@@ -0,0 +1,54 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test the profiling period of an accelerator view: no kernel dispatch has
+// ticks by default, one in N of them has with a period of N, and the next
+// one has if it's profiled explicitly
+
+#define DISPATCHES (16)
+#define PERIOD (4)
+
+int profiled(hc::accelerator_view& av, hc::array<int, 1>& table) {
+  std::vector<hc::completion_future> futures;
+  for (int i = 0; i < DISPATCHES; ++i) {
+    futures.push_back(hc::parallel_for_each(av, table.get_extent(), [&table](hc::index<1> idx) [[hc]] {
+      table[idx] += 1;
+    }));
+  }
+
+  int count = 0;
+  for (auto& f : futures) {
+    f.wait();
+    if (f.get_end_tick() > f.get_begin_tick())
+      ++count;
+  }
+  return count;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().create_view();
+  hc::array<int, 1> table(1024, av);
+
+  av.set_profiling_period(0);
+  ret &= (av.get_profiling_period() == 0);
+  ret &= (profiled(av, table) == 0);
+
+  av.profile_next_dispatch();
+  ret &= (profiled(av, table) == 1);
+
+  av.set_profiling_period(PERIOD);
+  ret &= (av.get_profiling_period() == PERIOD);
+  ret &= (profiled(av, table) == DISPATCHES / PERIOD);
+
+  av.set_profiling_period(1);
+  ret &= (profiled(av, table) == DISPATCHES);
+
+  return !(ret == true);
+}
@@ -0,0 +1,58 @@
+// RUN: %hc %s -o %t.out && %t.out
+// PERF: dispatches <= 8
+
+#include <hc.hpp>
+#include <hc_stats.h>
+
+#include <iostream>
+#include <vector>
+
+// Test the counters of an accelerator view, which count the kernels
+// dispatched to it and the bytes copied to and from its accelerator, and
+// the C API taking a snapshot of the counters of all the views
+
+#define ITERATION (8)
+
+bool test() {
+  const int vecSize = 1024;
+
+  hc::accelerator_view av = hc::accelerator().create_view();
+  hc_queue_stats before = av.get_stats();
+
+  std::vector<int> init(vecSize, 1);
+  hc::array<int, 1> table(vecSize, init.begin(), init.end(), av);
+  for (int i = 0; i < ITERATION; ++i) {
+    hc::parallel_for_each(av, hc::extent<1>(vecSize), [&table](hc::index<1> idx) [[hc]] {
+      table[idx] += 1;
+    });
+  }
+  std::vector<int> result = table;
+
+  hc_queue_stats after = av.get_stats();
+
+  bool ret = true;
+  ret &= (after.dispatches - before.dispatches == ITERATION);
+  ret &= (after.bytes_host_to_device - before.bytes_host_to_device >= vecSize * sizeof(int));
+  ret &= (after.bytes_device_to_host - before.bytes_device_to_host >= vecSize * sizeof(int));
+  for (int i = 0; i < vecSize; ++i) {
+    ret &= (result[i] == 1 + ITERATION);
+  }
+
+  // the view is among the ones hc_get_queue_stats() reports
+  size_t count = hc_get_queue_stats(nullptr, 0);
+  std::vector<hc_queue_stats> stats(count);
+  ret &= (hc_get_queue_stats(stats.data(), count) == count);
+  bool found = false;
+  for (const hc_queue_stats& s : stats) {
+    found |= (s.dispatches >= after.dispatches && s.device == after.device);
+  }
+  ret &= found;
+
+  return ret;
+}
+
+int main() {
+  bool ret = test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,60 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// test a read-only array_view replicated on all GPUs, read by kernels on
+// each of them in turn, then modified on the host and replicated again
+
+#define VEC_SIZE (1024 * 1024)
+#define ITERATION (4)
+
+#define TEST_DEBUG (0)
+
+int main() {
+  bool ret = true;
+
+  std::vector<hc::accelerator_view> views;
+  for (auto& acc : hc::accelerator::get_all()) {
+    if (!acc.get_is_emulated()) {
+      views.push_back(acc.get_default_view());
+    }
+  }
+
+  std::vector<int> host(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) host[i] = i;
+  hc::array_view<int, 1> table(VEC_SIZE, host);
+  hc::array_view<const int, 1> input(table);
+
+  std::vector< hc::array_view<int, 1> > outputs;
+  for (size_t v = 0; v < views.size(); ++v) {
+    outputs.push_back(hc::array_view<int, 1>(VEC_SIZE));
+  }
+
+  for (int n = 0; n < ITERATION; ++n) {
+    input.replicate(views);
+    for (size_t v = 0; v < views.size(); ++v) {
+      hc::array_view<int, 1> output = outputs[v];
+      output.discard_data();
+      hc::parallel_for_each(views[v], hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+        output(idx) = input(idx) + 1;
+      });
+    }
+    for (size_t v = 0; v < views.size(); ++v) {
+      for (int i = 0; i < VEC_SIZE; i += 1021) {
+        ret &= (outputs[v][i] == i + n + 1);
+      }
+    }
+
+    // the host write invalidates the replicas
+    for (int i = 0; i < VEC_SIZE; ++i) table[i] += 1;
+  }
+
+#if TEST_DEBUG
+  std::cout << "views: " << views.size() << ", outputs[0][1] = " << outputs[0][1] << "\n";
+#endif
+
+  return !(ret == true);
+}
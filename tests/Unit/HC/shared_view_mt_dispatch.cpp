@@ -0,0 +1,55 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// test multiple host threads dispatching kernels into one accelerator_view
+// the underlying HSA queue is shared by all threads
+
+#define THREAD_COUNT (8)
+#define DISPATCH_COUNT (256)
+#define VEC_SIZE (64)
+
+void test(hc::accelerator_view av, hc::array_view<int, 1> table) {
+  for (int i = 0; i < DISPATCH_COUNT; ++i) {
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    });
+  }
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  std::vector< hc::array_view<int, 1> > tables;
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    hc::array_view<int, 1> table(VEC_SIZE);
+    for (int j = 0; j < VEC_SIZE; ++j) table[j] = j;
+    table.synchronize_to(av);
+    tables.push_back(table);
+  }
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    threads.push_back(std::thread(test, av, tables[i]));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  av.wait();
+
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    for (int j = 0; j < VEC_SIZE; ++j) {
+      ret &= (tables[i][j] == (j + DISPATCH_COUNT));
+    }
+  }
+
+  return !(ret == true);
+}
+
@@ -0,0 +1,66 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_short_vector.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// Test the shuffles of 64-bit values within a wavefront, and the packed
+// half-precision vectors, whose arithmetic is done on the host and in kernels
+
+#define WAVE_SIZE (64)
+#define SIZE (WAVE_SIZE * 16)
+
+using hc::short_vector::half2;
+
+int main() {
+  bool ret = true;
+
+  // 64-bit shuffles move both halves of the values
+  std::vector<double> dbl(SIZE);
+  std::vector<int64_t> lng(SIZE);
+  for (int i = 0; i < SIZE; ++i) {
+    dbl[i] = i + 0.25;
+    lng[i] = (int64_t(i) << 40) | i;
+  }
+  hc::array_view<double, 1> dv(SIZE, dbl);
+  hc::array_view<int64_t, 1> lv(SIZE, lng);
+  hc::parallel_for_each(hc::extent<1>(SIZE), [=](hc::index<1> idx) [[hc]] {
+    dv[idx] = hc::__shfl(dv[idx], 0);
+    lv[idx] = hc::__shfl_xor(lv[idx], 1);
+  });
+  for (int i = 0; i < SIZE; ++i) {
+    int base = i - i % WAVE_SIZE;
+    ret &= (dv[i] == base + 0.25);
+    ret &= (lv[i] == ((int64_t(i ^ 1) << 40) | (i ^ 1)));
+  }
+
+  // packed arithmetic on the host
+  half2 a(1.0f, 2.0f);
+  half2 b(0.5f, -4.0f);
+  half2 sum = a + b;
+  ret &= (sum.get_x() == 1.5f && sum.get_y() == -2.0f);
+  half2 prod = a * b;
+  ret &= (prod.get_x() == 0.5f && prod.get_y() == -8.0f);
+  half2 f = fma(a, b, half2(1.0f));
+  ret &= (f.get_x() == 1.5f && f.get_y() == -7.0f);
+  ret &= (max(a, b) == a);
+  ret &= ((-b).get_y() == 4.0f);
+
+  // and in a kernel
+  std::vector<half2> halves(SIZE);
+  for (int i = 0; i < SIZE; ++i)
+    halves[i] = half2(i % 256, 1.0f);
+  hc::array_view<half2, 1> hv(SIZE, halves);
+  hc::parallel_for_each(hc::extent<1>(SIZE), [=](hc::index<1> idx) [[hc]] {
+    half2 v = hv[idx];
+    hv[idx] = fma(v, half2(2.0f), half2(0.0f, 1.0f)) - half2(1.0f);
+  });
+  for (int i = 0; i < SIZE; ++i) {
+    ret &= (hv[i].get_x() == 2.0f * (i % 256) - 1.0f);
+    ret &= (hv[i].get_y() == 2.0f);
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,73 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// test multiple host threads each keeping a deep pipeline of asynchronous
+// dispatches, which needs more completion signals than the initial size of
+// the signal pool. the runtime is expected to grow the pool on demand
+
+#define THREAD_COUNT (8)
+#define DISPATCH_COUNT (512)
+#define VEC_SIZE (64)
+
+#define TEST_DEBUG (0)
+
+void test(hc::accelerator_view av, hc::array_view<int, 1> table) {
+  std::vector<hc::completion_future> futures;
+  for (int i = 0; i < DISPATCH_COUNT; ++i) {
+    futures.push_back(hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    }));
+  }
+  for (auto& f : futures) {
+    f.wait();
+  }
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  std::vector< hc::array_view<int, 1> > tables;
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    hc::array_view<int, 1> table(VEC_SIZE);
+    for (int j = 0; j < VEC_SIZE; ++j) table[j] = j;
+    table.synchronize_to(av);
+    tables.push_back(table);
+  }
+
+  uint64_t hits = hc::get_signal_pool_hits();
+  uint64_t misses = hc::get_signal_pool_misses();
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    threads.push_back(std::thread(test, av, tables[i]));
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+
+  av.wait();
+
+  for (int i = 0; i < THREAD_COUNT; ++i) {
+    for (int j = 0; j < VEC_SIZE; ++j) {
+      ret &= (tables[i][j] == (j + DISPATCH_COUNT));
+    }
+  }
+
+  // every signal is either served by the pool or makes it grow
+  hits = hc::get_signal_pool_hits() - hits;
+  misses = hc::get_signal_pool_misses() - misses;
+#if TEST_DEBUG
+  std::cout << "signal pool hits: " << hits << ", misses: " << misses << "\n";
+#endif
+  ret &= (misses > 0);
+  ret &= (hits > 0);
+
+  return !(ret == true);
+}
@@ -0,0 +1,64 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_soa.hpp>
+
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+// Test the structure of arrays containers, copying particles in and out of
+// them field by field, and updating them in a kernel through references to
+// elements and through the views of fields
+
+#define SIZE (4096)
+
+struct Particle {
+  float pos;
+  float vel;
+  int id;
+};
+
+int main() {
+  bool ret = true;
+
+  std::vector<Particle> particles(SIZE);
+  for (int i = 0; i < SIZE; ++i) {
+    particles[i].pos = i;
+    particles[i].vel = 1.0f;
+    particles[i].id = -1;
+  }
+
+  hc::soa_array<float, float, int> table(SIZE);
+  hc::soa_array_view<float, float, int> view(table);
+  hc::copy(particles.begin(), particles.end(), view, &Particle::pos, &Particle::vel, &Particle::id);
+
+  hc::parallel_for_each(view.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    view.get<0>()[idx] += view.get<1>()[idx];
+    view[idx].get<2>() = idx[0];
+  });
+
+  std::vector<Particle> result(SIZE);
+  hc::copy(view, result.begin(), &Particle::pos, &Particle::vel, &Particle::id);
+  for (int i = 0; i < SIZE; ++i) {
+    ret &= (result[i].pos == i + 1.0f);
+    ret &= (result[i].vel == 1.0f);
+    ret &= (result[i].id == i);
+  }
+
+  // tuples are copied without naming the fields
+  std::vector<std::tuple<float, float, int> > tuples(SIZE);
+  hc::copy(view, tuples.begin());
+  ret &= (std::get<0>(tuples[1]) == 2.0f);
+  ret &= (std::get<2>(tuples[SIZE - 1]) == SIZE - 1);
+
+  // elements are loaded and stored as tuples
+  hc::soa_array_view<float, int> pairs(SIZE);
+  pairs[0] = std::make_tuple(0.5f, 7);
+  pairs[1] = pairs[0];
+  std::tuple<float, int> second = pairs[1];
+  ret &= (std::get<0>(second) == 0.5f);
+  ret &= (std::get<1>(second) == 7);
+
+  return !(ret == true);
+}
@@ -0,0 +1,58 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+
+// test sparse updates of an array_view from the host between kernels. only
+// the chunks holding the updated elements are out of date on the device, so
+// they are the only ones copied back before the next kernel
+
+#define VEC_SIZE (4 * 1024 * 1024 + 11)
+#define STRIDE (100003)
+#define ITERATION (8)
+
+#define TEST_DEBUG (0)
+
+bool test() {
+  bool ret = true;
+
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+
+  hc::array_view<int, 1> table(VEC_SIZE);
+  for (int i = 0; i < VEC_SIZE; ++i) table[i] = 0;
+
+  for (int n = 0; n < ITERATION; ++n) {
+    hc::parallel_for_each(av, hc::extent<1>(VEC_SIZE), [=](hc::index<1> idx) __HC__ {
+      table(idx) += 1;
+    });
+
+    // a few elements set from the host, on a 1D and a 2D view of the data
+    for (int i = n; i < VEC_SIZE; i += STRIDE) table[i] += 100;
+    hc::array_view<int, 2> table2 = table.section(0, (VEC_SIZE / 1024) * 1024).view_as(hc::extent<2>(VEC_SIZE / 1024, 1024));
+    table2[hc::index<2>(n, 7)] += 1000;
+  }
+
+  for (int i = 0; i < VEC_SIZE; ++i) {
+    int expected = ITERATION;
+    for (int n = 0; n < ITERATION; ++n) {
+      if (i >= n && (i - n) % STRIDE == 0) expected += 100;
+      if (i == n * 1024 + 7) expected += 1000;
+    }
+    ret &= (table[i] == expected);
+  }
+
+#if TEST_DEBUG
+  std::cout << "table[7] = " << table[7] << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
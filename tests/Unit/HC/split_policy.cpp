@@ -0,0 +1,64 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+#include <hc.hpp>
+#include <hc_am.hpp>
+
+#include <iostream>
+
+// test kernels launched with a split_policy, whose rows are split between
+// the accelerator and the CPU on accelerators supporting CPU shared memory,
+// compute all of the extent once, with fixed shares of the accelerator and
+// with the share learned over several launches of the same kernel
+
+#define ROWS (1024)
+#define COLS (256)
+#define ITERATION (8)
+
+#define TEST_DEBUG (0)
+
+bool test(hc::accelerator_view av, int* table, const hc::split_policy& policy) {
+  bool ret = true;
+
+  for (int n = 0; n < ITERATION; ++n) {
+    for (int i = 0; i < ROWS * COLS; ++i) table[i] = 0;
+
+    hc::parallel_for_each(av, policy, hc::extent<1>(ROWS * COLS), [=](hc::index<1> idx) __HC__ {
+      table[idx[0]] += idx[0];
+    }).wait();
+    for (int i = 0; i < ROWS * COLS; ++i) {
+      ret &= (table[i] == i);
+    }
+
+    hc::parallel_for_each(av, policy, hc::extent<2>(ROWS, COLS), [=](hc::index<2> idx) __HC__ {
+      table[idx[0] * COLS + idx[1]] += 1;
+    }).wait();
+    for (int i = 0; i < ROWS * COLS; ++i) {
+      ret &= (table[i] == i + 1);
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << "share " << policy.get_accelerator_share() << ": " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::accelerator_view av = acc.get_default_view();
+  int* table = static_cast<int*>(hc::am_alloc(ROWS * COLS * sizeof(int), acc, amHostPinned));
+  if (table == nullptr)
+    return 1;
+
+  ret &= test(av, table, hc::split_policy(0.0));
+  ret &= test(av, table, hc::split_policy(0.3));
+  ret &= test(av, table, hc::split_policy(1.0));
+  ret &= test(av, table, hc::split_policy());
+
+  hc::am_free(table);
+
+  return !(ret == true);
+}
@@ -0,0 +1,30 @@
+// RUN: %hc %s -o %t.out && HCC_STATS_DUMP=%t.txt %t.out && grep -q '^dispatches 4$' %t.txt && grep -q '^elapsed_ns ' %t.txt
+// PERF: dispatches <= 4
+
+#include <hc.hpp>
+
+#include <vector>
+
+// Test the counters of the runtime written to the file of HCC_STATS_DUMP
+// when the program exits, which include the accelerator views destroyed
+// before then
+
+#define ITERATION (4)
+
+int main() {
+  bool ret = true;
+
+  std::vector<int> init(1024, 0);
+  hc::array_view<int, 1> table(1024, init);
+  for (int i = 0; i < ITERATION; ++i) {
+    hc::accelerator_view av = hc::accelerator().create_view();
+    hc::parallel_for_each(av, table.get_extent(), [=](hc::index<1> idx) [[hc]] {
+      table[idx] += 1;
+    }).wait();
+  }
+  for (int i = 0; i < 1024; ++i) {
+    ret &= (table[i] == ITERATION);
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,59 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test synchronize_async of array_views, the data written by a kernel is on
+// the host once the future is ready, while other kernels may run meanwhile,
+// and the host may write the data it synchronized for writing
+
+#define SIZE (1024 * 1024)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator_view acc_view = hc::accelerator().get_default_view();
+  std::vector<int> host(SIZE, 1);
+  hc::array_view<int, 1> av(SIZE, host);
+  hc::array<int, 1> other(SIZE, acc_view);
+
+  hc::parallel_for_each(acc_view, av.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    av[idx] += 1;
+  });
+
+  // read back the results while another kernel runs
+  hc::completion_future fut = av.synchronize_async();
+  hc::parallel_for_each(acc_view, other.get_extent(), [&other](hc::index<1> idx) [[hc]] {
+    other[idx] = idx[0];
+  });
+  fut.wait();
+  ret &= fut.is_ready();
+  for (int i = 0; i < SIZE; ++i)
+    ret &= (host[i] == 2);
+
+  // synchronize for writing, and write on the host
+  hc::parallel_for_each(acc_view, av.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    av[idx] += 1;
+  });
+  av.synchronize_async(hc::access_type_read_write).wait();
+  av[0] = 0;
+  ret &= (av[0] == 0);
+  ret &= (av[1] == 3);
+
+  // a view synchronized already is ready at once
+  hc::completion_future ready = av.synchronize_async();
+  ret &= ready.is_ready();
+
+  // synchronizing to an accelerator for writing
+  av.synchronize_to_async(acc_view, hc::access_type_read_write).wait();
+  hc::parallel_for_each(acc_view, av.get_extent(), [=](hc::index<1> idx) [[hc]] {
+    av[idx] += 1;
+  });
+  av.synchronize();
+  ret &= (host[0] == 1);
+  ret &= (host[1] == 4);
+
+  return !(ret == true);
+}
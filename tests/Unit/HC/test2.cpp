@@ -59,8 +59,9 @@ int main() {
 
   accelerator_view.create_marker();
 
-  // now there must be 6 pending async operations for the accelerator_view
-  ret &= (accelerator_view.get_pending_async_ops() == 6);
+  // now there must be at most 6 pending async operations for the
+  // accelerator_view, async operations retire as they complete
+  ret &= (accelerator_view.get_pending_async_ops() <= 6);
 
   // wait for async operations to complete
   hc::accelerator().get_default_view().wait();
@@ -0,0 +1,60 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_texture.hpp>
+
+#include <iostream>
+#include <vector>
+
+// Test the textures, texels are fetched by index and sampled with point and
+// linear filtering, at coordinates out of the texture with each address mode
+
+#define WIDTH (16)
+#define HEIGHT (8)
+
+int main() {
+  bool ret = true;
+
+  std::vector<float> texels(WIDTH * HEIGHT);
+  for (int i = 0; i < WIDTH * HEIGHT; ++i)
+    texels[i] = i;
+  hc::texture<float, 2> tex(hc::extent<2>(HEIGHT, WIDTH), texels.begin(), texels.end());
+  hc::texture_view<float, 2> view(tex);
+
+  std::vector<float> host(8);
+  hc::array_view<float, 1> results(8, host);
+  hc::parallel_for_each(hc::extent<1>(1), [=](hc::index<1>) [[hc]] {
+    hc::sampler point(hc::filter_point, hc::address_clamp);
+    hc::sampler linear(hc::filter_linear, hc::address_clamp);
+    hc::sampler wrap(hc::filter_point, hc::address_wrap);
+    hc::sampler border(hc::filter_point, hc::address_border);
+    // the center of the texel (1, 2)
+    results[0] = view.sample(point, 2.5f / WIDTH, 1.5f / HEIGHT);
+    // halfway between the texels (1, 2) and (1, 3)
+    results[1] = view.sample(linear, 3.0f / WIDTH, 1.5f / HEIGHT);
+    // halfway between the rows 1 and 2 too
+    results[2] = view.sample(linear, 3.0f / WIDTH, 2.0f / HEIGHT);
+    results[3] = view.sample(point, -1.0f, 0.5f / HEIGHT);
+    results[4] = view.sample(wrap, 1.0f + 0.5f / WIDTH, 0.5f / HEIGHT);
+    results[5] = view.sample(border, 2.0f, 0.5f);
+    results[6] = view[hc::index<2>(HEIGHT - 1, WIDTH - 1)];
+    results[7] = view.get_extent()[1];
+  });
+  results.synchronize();
+
+  ret &= (host[0] == WIDTH + 2);
+  ret &= (host[1] == WIDTH + 2.5f);
+  ret &= (host[2] == WIDTH + 2.5f + WIDTH / 2.0f);
+  ret &= (host[3] == 0.0f);
+  ret &= (host[4] == 0.0f);
+  ret &= (host[5] == 0.0f);
+  ret &= (host[6] == WIDTH * HEIGHT - 1);
+  ret &= (host[7] == WIDTH);
+
+  // the texels are copied back as from an array
+  std::vector<float> back(WIDTH * HEIGHT);
+  hc::copy(tex, back.begin());
+  ret &= (back == texels);
+
+  return !(ret == true);
+}
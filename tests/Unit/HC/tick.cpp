@@ -31,6 +31,10 @@ bool test() {
     table_b[i] = int_dist(rd);
   }
 
+  // the dispatches of the view are profiled
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  av.set_profiling_period(1);
+
   // launch kernel
   hc::extent<1> e(vecSize);
   hc::completion_future fut = hc::parallel_for_each(
@@ -42,7 +46,6 @@ bool test() {
   });
 
   // create a barrier packet
-  hc::accelerator_view av = hc::accelerator().get_default_view();
   hc::completion_future fut2 = av.create_marker();
 
   // fut and fut2 should have the same timestamp frequency
@@ -0,0 +1,62 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+
+#include <iostream>
+#include <type_traits>
+
+// test tiled kernels declared barrier_free, whose tiles may be run as plain
+// loops on the CPU path, compute the same as tiled kernels using barriers
+
+#define GRID_SIZE (64)
+#define TILE_SIZE (8)
+
+#define TEST_DEBUG (0)
+
+// kernel without barriers, declared barrier_free
+struct Scale {
+  typedef void barrier_free;
+
+  hc::array_view<int, 2> table;
+
+  void operator()(hc::tiled_index<2>& tidx) const __HC__ {
+    table[tidx.global] = tidx.global[0] * GRID_SIZE + tidx.global[1];
+  }
+};
+
+static_assert(hc::is_barrier_free<Scale>::value, "Scale is barrier free");
+static_assert(!hc::is_barrier_free<int>::value, "int is not barrier free");
+
+int main() {
+  bool ret = true;
+
+  hc::array_view<int, 2> table(GRID_SIZE, GRID_SIZE);
+  hc::array_view<int, 2> sums(GRID_SIZE, GRID_SIZE);
+
+  Scale scale = { table };
+  hc::parallel_for_each(hc::extent<2>(GRID_SIZE, GRID_SIZE).tile(TILE_SIZE, TILE_SIZE), scale);
+
+  // kernel with a barrier, run with a stack per work-item on the CPU path
+  hc::parallel_for_each(hc::extent<2>(GRID_SIZE, GRID_SIZE).tile(TILE_SIZE, TILE_SIZE),
+                        [=](hc::tiled_index<2>& tidx) __HC__ {
+    tile_static int tile[TILE_SIZE][TILE_SIZE];
+    tile[tidx.local[0]][tidx.local[1]] = table[tidx.global];
+    tidx.barrier.wait();
+    sums[tidx.global] = tile[TILE_SIZE - 1 - tidx.local[0]][TILE_SIZE - 1 - tidx.local[1]];
+  });
+
+  for (int i = 0; i < GRID_SIZE; ++i) {
+    for (int j = 0; j < GRID_SIZE; ++j) {
+      int ti = (i / TILE_SIZE) * TILE_SIZE + TILE_SIZE - 1 - i % TILE_SIZE;
+      int tj = (j / TILE_SIZE) * TILE_SIZE + TILE_SIZE - 1 - j % TILE_SIZE;
+      ret &= (table(i, j) == i * GRID_SIZE + j);
+      ret &= (sums(i, j) == ti * GRID_SIZE + tj);
+    }
+  }
+
+#if TEST_DEBUG
+  std::cout << "barrier free: " << ret << "\n";
+#endif
+
+  return !(ret == true);
+}
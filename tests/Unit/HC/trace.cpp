@@ -0,0 +1,37 @@
+// RUN: %hc %s -o %t.out && HCC_TRACE=%t.json %t.out && grep -q '"cat":"dispatch"' %t.json && grep -q '"cat":"copy"' %t.json
+
+#include <hc.hpp>
+
+#include <iostream>
+
+// Test the runtime tracer enabled by HCC_TRACE, the enqueue of the kernels
+// and the copies of the arrays are written out in the trace file once the
+// program exits
+
+#define ITERATION (16)
+
+bool test() {
+  const int vecSize = 1024;
+
+  std::vector<int> init(vecSize, 1);
+  hc::array<int, 1> table(vecSize, init.begin());
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  for (int i = 0; i < ITERATION; ++i) {
+    hc::parallel_for_each(av, hc::extent<1>(vecSize), [&table](hc::index<1> idx) [[hc]] {
+      table[idx] += idx[0];
+    });
+  }
+
+  bool ret = true;
+  std::vector<int> result = table;
+  for (int i = 0; i < vecSize; ++i) {
+    ret &= (result[i] == 1 + ITERATION * i);
+  }
+  return ret;
+}
+
+int main() {
+  bool ret = test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,64 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_view_pool.hpp>
+
+#include <thread>
+#include <vector>
+
+// Test a pool of accelerator_views leased by many threads, each thread runs
+// kernels on the view it's leased, the threads outnumber the views so they
+// share them, and all the leases are given back once the threads are done
+
+#define THREADS (16)
+#define VIEWS (4)
+#define SIZE (4096)
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  hc::view_pool pool(acc, VIEWS);
+  ret &= (pool.size() == VIEWS);
+
+  std::vector<int> results(THREADS, 0);
+  std::vector<std::thread> threads;
+  for (int t = 0; t < THREADS; ++t) {
+    threads.emplace_back([&, t]() {
+      for (int round = 0; round < 4; ++round) {
+        hc::view_pool::lease lease = pool.acquire();
+        hc::array_view<int, 1> data(SIZE);
+        hc::parallel_for_each(lease.get_view(), hc::extent<1>(SIZE), [=](hc::index<1> idx) [[hc]] {
+          data[idx] = idx[0] + t;
+        });
+        int sum = 0;
+        for (int i = 0; i < SIZE; ++i)
+          sum += (data[i] == i + t);
+        results[t] += sum;
+      }
+    });
+  }
+  for (auto& thread : threads)
+    thread.join();
+
+  for (int t = 0; t < THREADS; ++t)
+    ret &= (results[t] == 4 * SIZE);
+  for (unsigned int users : pool.get_users())
+    ret &= (users == 0);
+
+  // the same thread gets its view back
+  unsigned int first;
+  {
+    hc::view_pool::lease lease = pool.acquire();
+    first = lease.get_index();
+  }
+  {
+    hc::view_pool::lease lease = pool.acquire();
+    ret &= (lease.get_index() == first);
+    // while it's held another lease goes to another view
+    hc::view_pool::lease other = pool.acquire();
+    ret &= (other.get_index() != first);
+  }
+
+  return !(ret == true);
+}
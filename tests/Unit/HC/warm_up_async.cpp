@@ -0,0 +1,54 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out && HCC_WARMUP=ON %t.out
+#include <hc.hpp>
+
+#include <iostream>
+
+// test accelerator::warm_up_async(), which builds the kernels of the program
+// in the background. Launches made while it's running, and after it's done,
+// find their kernels built. With HCC_WARMUP=ON the kernels of the default
+// accelerator are being built as the program starts
+
+#define SIZE (1024)
+
+#define TEST_DEBUG (0)
+
+bool test(const hc::accelerator& acc, bool wait) {
+  bool ret = true;
+
+  hc::completion_future build = acc.warm_up_async();
+  if (wait) {
+    build.wait();
+    ret &= build.is_ready();
+  }
+
+  hc::array_view<int, 1> data(SIZE);
+  hc::parallel_for_each(acc.get_default_view(), data.get_extent(), [=](hc::index<1> idx) __HC__ {
+    data[idx] = idx[0] * 2;
+  });
+
+  for (int i = 0; i < SIZE; ++i) {
+    ret &= (data[i] == i * 2);
+  }
+
+  // the build is shared by later calls
+  hc::completion_future again = acc.warm_up_async();
+  again.wait();
+  ret &= again.is_ready();
+
+#if TEST_DEBUG
+  std::cout << "wait: " << wait << " " << ret << "\n";
+#endif
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  hc::accelerator acc;
+  ret &= test(acc, false);
+  ret &= test(acc, true);
+
+  return !(ret == true);
+}
@@ -0,0 +1,55 @@
+// RUN: %hc %s -o %t.out && %t.out
+
+#include <hc.hpp>
+
+#include <vector>
+
+// Test hc::dispatch_wavefront_size: the variant of the wavefront size of the
+// agent is launched, and its shuffles sum every wavefront of it
+
+#define GRID_SIZE (1024)
+
+struct wave_sum {
+  hc::accelerator_view av;
+
+  template <unsigned int WaveSize>
+  unsigned int operator()(hc::wavefront_size_t<WaveSize>) const {
+    hc::array_view<int, 1> table(GRID_SIZE);
+    hc::parallel_for_each(av, hc::extent<1>(GRID_SIZE), [=](hc::index<1> idx) [[hc]] {
+      int v = 1;
+      for (int delta = WaveSize / 2; delta > 0; delta /= 2) {
+        v += hc::__shfl_down(v, delta, WaveSize);
+      }
+      table[idx] = v;
+    }).wait();
+
+    bool ret = true;
+    for (int i = 0; i < GRID_SIZE; i += WaveSize) {
+      ret &= (table[i] == static_cast<int>(WaveSize));
+    }
+    return ret ? WaveSize : 0;
+  }
+};
+
+bool test() {
+  hc::accelerator acc;
+  hc::accelerator_view av = acc.get_default_view();
+  unsigned int size = acc.get_wavefront_size();
+
+  bool ret = true;
+  ret &= (size == 32 || size == 64);
+  ret &= (av.get_wavefront_size() == size);
+
+  wave_sum f = { av };
+  ret &= (hc::dispatch_wavefront_size(av, f) == size);
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
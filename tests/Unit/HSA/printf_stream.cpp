@@ -0,0 +1,40 @@
+// XFAIL: Linux
+// RUN: %hc %s -lhc_am -o %t.out && %t.out | %FileCheck %s
+
+#include <hc.hpp>
+#include <hc_printf.hpp>
+
+#include <iostream>
+
+#define SIZE (32)
+// a ring of far fewer packets than the kernel prints, which the host thread
+// frees while the kernel runs
+#define PRINTF_STREAM_SIZE (64)
+#define LINES (200)
+
+int main() {
+  using namespace hc;
+
+  accelerator acc = accelerator();
+  PrintfPacket* printf_stream = createPrintfStream(acc, PRINTF_STREAM_SIZE);
+
+  const char* str1 = "Line %d from %s %d\n";
+  const char* str2 = "thread";
+
+  parallel_for_each(extent<1>(SIZE), [=](index<1> idx) restrict(amp) {
+    if (idx[0] == 0) {
+      for (int i = 0; i < LINES; ++i) {
+        printf(printf_stream, str1, i, str2, idx[0]);
+      }
+    }
+  }).wait();
+
+  deletePrintfStream(printf_stream);
+
+  return 0;
+}
+
+// CHECK: Line 0 from thread 0
+// CHECK: Line 1 from thread 0
+// CHECK: Line 100 from thread 0
+// CHECK: Line 199 from thread 0
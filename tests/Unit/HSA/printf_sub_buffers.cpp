@@ -0,0 +1,60 @@
+// RUN: %hc %s -lhc_am -o %t.out && %t.out
+
+#include <hc.hpp>
+#include <hc_printf.hpp>
+
+#include <vector>
+
+// Test the printf buffer split into sub-buffers: every work-item of every
+// wavefront gets packets of its own, and the packets of all the sub-buffers
+// add up to the printf calls
+
+#define SIZE (4096)
+#define PRINTF_BUFFER_SIZE (SIZE * 8)
+
+int main() {
+  using namespace hc;
+
+  accelerator acc = accelerator();
+  PrintfPacket* printf_buf = createPrintfBuffer(acc, PRINTF_BUFFER_SIZE);
+
+  const char* str = "%d\n";
+  std::vector<int> errors(SIZE);
+  array_view<int, 1> error(SIZE, errors);
+  parallel_for_each(extent<1>(SIZE).tile(256), [=](tiled_index<1> idx) [[hc]] {
+    error[idx] = printf(printf_buf, str, idx.global[0]);
+  }).wait();
+  error.synchronize();
+
+  std::vector<PrintfPacket> buffer(PRINTF_BUFFER_SIZE);
+  am_copy(buffer.data(), printf_buf, sizeof(PrintfPacket) * PRINTF_BUFFER_SIZE);
+
+  bool ret = true;
+  unsigned int numSubBuffers = buffer[0].data.ui;
+  unsigned int subBufferSize = buffer[1].data.ui;
+  ret &= (numSubBuffers >= 1);
+
+  // a printf of the format and one argument takes 3 packets
+  unsigned int packets = 0;
+  std::vector<bool> printed(SIZE, false);
+  for (unsigned int i = 0; i < numSubBuffers; ++i) {
+    PrintfPacket* sub = &buffer[1 + i * subBufferSize];
+    unsigned int cursor = sub[1].data.ui;
+    packets += cursor - 2;
+    for (unsigned int j = 2; j + 2 < cursor; j += 3) {
+      ret &= (sub[j].data.ui == 2);
+      int id = sub[j + 2].data.i;
+      ret &= (id >= 0 && id < SIZE && !printed[id]);
+      if (id >= 0 && id < SIZE)
+        printed[id] = true;
+    }
+  }
+  ret &= (packets == SIZE * 3);
+  for (int i = 0; i < SIZE; ++i) {
+    ret &= (errors[i] == PRINTF_SUCCESS);
+  }
+
+  deletePrintfBuffer(printf_buf);
+
+  return !(ret == true);
+}
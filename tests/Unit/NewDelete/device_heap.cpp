@@ -0,0 +1,55 @@
+// RUN: %hc %s -o %t.out && %t.out
+#include <hc.hpp>
+#include "hsa_new.h"
+
+#include <set>
+#include <vector>
+
+// Test the device heap: kernels allocate blocks of their own, free them and
+// get them back from the free lists, without the host threads
+bool test() {
+  const int vecSize = 4096;
+  DeviceHeap *heap = newInit.heap;
+
+  std::vector<uint64_t> addresses(vecSize);
+  hc::array_view<uint64_t, 1> table(vecSize, addresses);
+  hc::parallel_for_each(hc::extent<1>(vecSize), [=](hc::index<1> idx) [[hc]] {
+    int *p = (int *)heap->allocate(sizeof(int) * (1 + idx[0] % 4));
+    if (p) {
+      *p = idx[0];
+    }
+    table[idx] = (uint64_t)p;
+  }).wait();
+  table.synchronize();
+
+  bool ret = true;
+  std::set<uint64_t> blocks;
+  for (int i = 0; i < vecSize; ++i) {
+    int *p = (int *)addresses[i];
+    ret &= (p != nullptr) && (*p == i) && (addresses[i] % 16 == 0);
+    blocks.insert(addresses[i]);
+  }
+  ret &= (blocks.size() == vecSize);
+
+  // the freed blocks are of one size class, and serve the next allocations
+  hc::parallel_for_each(hc::extent<1>(vecSize), [=](hc::index<1> idx) [[hc]] {
+    heap->deallocate((void *)table[idx]);
+  }).wait();
+  hc::parallel_for_each(hc::extent<1>(vecSize), [=](hc::index<1> idx) [[hc]] {
+    table[idx] = (uint64_t)heap->allocate(sizeof(int));
+  }).wait();
+  table.synchronize();
+  for (int i = 0; i < vecSize; ++i) {
+    ret &= (blocks.count(addresses[i]) == 1);
+  }
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test();
+
+  return !(ret == true);
+}
@@ -0,0 +1,113 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test the stream compactions, copy_if, remove_if, unique and the
+// partitions, and the searches and reduces of indices, find_if and
+// min_element, max_element and minmax_element, whose results are compared
+// as positions, so ties and the order of the elements kept are checked
+
+template<typename T>
+bool test(size_t n) {
+  using namespace std::experimental::parallel;
+
+  std::vector<T> input(n);
+  for (size_t i = 0; i < n; ++i) {
+    // runs of equal elements, and repeated smallest and largest ones
+    input[i] = static_cast<T>((i / 3) % 97);
+  }
+  auto pred = [](const T& v) { return static_cast<int>(v) % 3 == 0; };
+
+  bool ret = true;
+
+  // copy_if and remove_copy_if
+  std::vector<T> expected(n), output(n);
+  auto e = std::copy_if(std::begin(input), std::end(input), std::begin(expected), pred);
+  auto o = copy_if(par, std::begin(input), std::end(input), std::begin(output), pred);
+  ret &= (o - std::begin(output)) == (e - std::begin(expected));
+  ret &= std::equal(std::begin(expected), e, std::begin(output));
+
+  e = std::remove_copy_if(std::begin(input), std::end(input), std::begin(expected), pred);
+  o = remove_copy_if(par, std::begin(input), std::end(input), std::begin(output), pred);
+  ret &= (o - std::begin(output)) == (e - std::begin(expected));
+  ret &= std::equal(std::begin(expected), e, std::begin(output));
+
+  // remove_if and unique, in place
+  expected = input;
+  output = input;
+  e = std::remove_if(std::begin(expected), std::end(expected), pred);
+  o = remove_if(par, std::begin(output), std::end(output), pred);
+  ret &= (o - std::begin(output)) == (e - std::begin(expected));
+  ret &= std::equal(std::begin(expected), e, std::begin(output));
+
+  expected = input;
+  output = input;
+  e = std::unique(std::begin(expected), std::end(expected));
+  o = unique(par, std::begin(output), std::end(output));
+  ret &= (o - std::begin(output)) == (e - std::begin(expected));
+  ret &= std::equal(std::begin(expected), e, std::begin(output));
+
+  // partition_copy and stable_partition
+  std::vector<T> expected_false(n), output_false(n);
+  auto ep = std::partition_copy(std::begin(input), std::end(input),
+                                std::begin(expected), std::begin(expected_false), pred);
+  auto op = partition_copy(par, std::begin(input), std::end(input),
+                           std::begin(output), std::begin(output_false), pred);
+  ret &= (op.first - std::begin(output)) == (ep.first - std::begin(expected));
+  ret &= (op.second - std::begin(output_false)) == (ep.second - std::begin(expected_false));
+  ret &= std::equal(std::begin(expected), ep.first, std::begin(output));
+  ret &= std::equal(std::begin(expected_false), ep.second, std::begin(output_false));
+
+  expected = input;
+  output = input;
+  e = std::stable_partition(std::begin(expected), std::end(expected), pred);
+  o = stable_partition(par, std::begin(output), std::end(output), pred);
+  ret &= (o - std::begin(output)) == (e - std::begin(expected));
+  ret &= std::equal(std::begin(expected), std::end(expected), std::begin(output));
+
+  // find_if, the first of many elements found, and none found
+  auto large = [](const T& v) { return v > static_cast<T>(90); };
+  auto none = [](const T& v) { return v > static_cast<T>(1000); };
+  ret &= find_if(par, std::begin(input), std::end(input), large) ==
+         std::find_if(std::begin(input), std::end(input), large);
+  ret &= find_if(par, std::begin(input), std::end(input), none) == std::end(input);
+  ret &= find(par, std::begin(input), std::end(input), input[n - 1]) ==
+         std::find(std::begin(input), std::end(input), input[n - 1]);
+
+  // min_element, max_element and minmax_element
+  ret &= min_element(par, std::begin(input), std::end(input)) ==
+         std::min_element(std::begin(input), std::end(input));
+  ret &= max_element(par, std::begin(input), std::end(input)) ==
+         std::max_element(std::begin(input), std::end(input));
+  auto mm = minmax_element(par, std::begin(input), std::end(input));
+  auto emm = std::minmax_element(std::begin(input), std::end(input));
+  ret &= (mm.first == emm.first) && (mm.second == emm.second);
+
+  // inner_product, of integers as sums of floating point products depend on
+  // their order
+  if (std::is_integral<T>::value)
+    ret &= inner_product(par, std::begin(input), std::end(input), std::begin(input), T{}) ==
+           std::inner_product(std::begin(input), std::end(input), std::begin(input), T{});
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test<int>(10);
+  ret &= test<int>(TEST_SIZE);
+  ret &= test<unsigned>(100003);
+  ret &= test<float>(1 << 20);
+  ret &= test<double>(70001);
+
+  return !(ret == true);
+}
@@ -0,0 +1,61 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#include <hc.hpp>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test a chain of transform, inclusive_scan and reduce on device_iterators
+// of array_views, whose data stays on the accelerator between them
+
+template<typename T, size_t SIZE>
+bool test(void) {
+  using namespace std::experimental::parallel;
+
+  auto f = [](const T& v) { return v * 2; };
+  auto binary_op = std::plus<T>();
+
+  std::vector<T> input(SIZE);
+  std::iota(std::begin(input), std::end(input), 1);
+
+  // expected results on the host
+  std::vector<T> expected(SIZE);
+  std::transform(std::begin(input), std::end(input), std::begin(expected), f);
+  std::partial_sum(std::begin(expected), std::end(expected), std::begin(expected), binary_op);
+  T sum = std::accumulate(std::begin(expected), std::end(expected), T{}, binary_op);
+
+  hc::array<T, 1> in(SIZE, std::begin(input));
+  hc::array_view<T, 1> tmp((hc::extent<1>(SIZE)));
+  hc::array_view<T, 1> out((hc::extent<1>(SIZE)));
+
+  transform(par, device_begin(in), device_end(in), device_begin(tmp), f);
+  inclusive_scan(par, device_begin(tmp), device_end(tmp), device_begin(out), binary_op, T{});
+  T result = reduce(par, device_begin(out), device_end(out), T{}, binary_op);
+
+  bool ret = (result == sum);
+  for (size_t i = 0; i < SIZE; ++i) {
+    ret &= (out[static_cast<int>(i)] == expected[i]);
+  }
+
+  // algorithms also take a device_iterator to a part of an array_view
+  T half = reduce(par, device_begin(out) + SIZE / 2, device_end(out), T{}, binary_op);
+  ret &= (half == std::accumulate(std::begin(expected) + SIZE / 2, std::end(expected), T{}, binary_op));
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test<int, TEST_SIZE>();
+  ret &= test<unsigned, TEST_SIZE>();
+
+  return !(ret == true);
+}
@@ -0,0 +1,76 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test counting_iterator, transform_iterator and zip_iterator, nested, as
+// inputs of transform, reduce and the scans, on the host too when small
+
+template<typename T, size_t SIZE>
+bool test(void) {
+  using namespace std::experimental::parallel;
+
+  std::vector<T> a(SIZE), b(SIZE);
+  for (size_t i = 0; i < SIZE; ++i) {
+    a[i] = static_cast<T>(i % 17);
+    b[i] = static_cast<T>(i % 5);
+  }
+
+  auto square = [](const T& v) { return v * v; };
+  auto product = [](const std::tuple<T, T>& t) { return std::get<0>(t) * std::get<1>(t); };
+  auto binary_op = std::plus<T>();
+
+  bool ret = true;
+
+  // transform of a counting_iterator
+  std::vector<T> expected(SIZE), output(SIZE);
+  for (size_t i = 0; i < SIZE; ++i) {
+    expected[i] = square(static_cast<T>(i % 100));
+  }
+  auto mod = [](const T& v) { return static_cast<T>(static_cast<long>(v) % 100); };
+  auto counting = make_transform_iterator(make_counting_iterator<T>(0), mod);
+  transform(par, counting, counting + SIZE, std::begin(output), square);
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  // reduce of a transform_iterator, the sum of squares
+  T sum = std::accumulate(std::begin(a), std::end(a), T{},
+                          [&](const T& s, const T& v) { return s + square(v); });
+  auto squares = make_transform_iterator(std::begin(a), square);
+  ret &= (reduce(par, squares, squares + SIZE, T{}, binary_op) == sum);
+
+  // reduce of a zip_iterator through a transform_iterator, the dot product
+  T dot = std::inner_product(std::begin(a), std::end(a), std::begin(b), T{});
+  auto products = make_transform_iterator(make_zip_iterator(std::begin(a), std::begin(b)), product);
+  ret &= (reduce(par, products, products + SIZE, T{}, binary_op) == dot);
+  ret &= (transform_reduce(par, make_zip_iterator(std::begin(a), std::begin(b)),
+                           make_zip_iterator(std::end(a), std::end(b)),
+                           product, T{}, binary_op) == dot);
+
+  // inclusive scan of the products
+  std::vector<T> products_(SIZE);
+  std::transform(std::begin(a), std::end(a), std::begin(b), std::begin(products_),
+                 [](const T& x, const T& y) { return x * y; });
+  std::partial_sum(std::begin(products_), std::end(products_), std::begin(expected));
+  inclusive_scan(par, products, products + SIZE, std::begin(output), binary_op, T{});
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test<int, TEST_SIZE>();
+  ret &= test<unsigned, TEST_SIZE>();
+  ret &= test<int, 10>();
+  ret &= test<double, 100003>();
+
+  return !(ret == true);
+}
@@ -0,0 +1,66 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test merge of sorted inputs of uneven sizes, and stable_sort of inputs
+// spanning many merge passes, with comparisons which see many elements as
+// equivalent, so the order of equivalent elements is checked as well
+
+template<typename T>
+bool test(size_t n1, size_t n2) {
+  using namespace std::experimental::parallel;
+
+  // elements are equivalent when their integral parts are
+  auto comp = [](const T& a, const T& b) { return static_cast<int>(a) < static_cast<int>(b); };
+
+  std::vector<T> input1(n1), input2(n2);
+  for (size_t i = 0; i < n1; ++i) {
+    input1[i] = static_cast<T>((i * 7) % 101) + static_cast<T>(i) / (4 * (n1 + n2));
+  }
+  for (size_t i = 0; i < n2; ++i) {
+    input2[i] = static_cast<T>((i * 13) % 101) + static_cast<T>(n1 + i) / (4 * (n1 + n2));
+  }
+
+  bool ret = true;
+
+  // stable_sort
+  std::vector<T> expected1(input1), expected2(input2);
+  std::stable_sort(std::begin(expected1), std::end(expected1), comp);
+  std::stable_sort(std::begin(expected2), std::end(expected2), comp);
+  stable_sort(par, std::begin(input1), std::end(input1), comp);
+  stable_sort(par, std::begin(input2), std::end(input2), comp);
+  ret &= std::equal(std::begin(input1), std::end(input1), std::begin(expected1));
+  ret &= std::equal(std::begin(input2), std::end(input2), std::begin(expected2));
+
+  // merge
+  std::vector<T> expected(n1 + n2);
+  std::merge(std::begin(input1), std::end(input1), std::begin(input2), std::end(input2),
+             std::begin(expected), comp);
+  std::vector<T> output(n1 + n2);
+  auto end = merge(par, std::begin(input1), std::end(input1),
+                   std::begin(input2), std::end(input2), std::begin(output), comp);
+  ret &= (end == std::end(output));
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test<double>(1, 100000);
+  ret &= test<double>(4097, 511);
+  ret &= test<double>(100003, 70001);
+  ret &= test<double>((1 << 20) + 3, 1 << 18);
+  ret &= test<float>(10007, 20011);
+
+  return !(ret == true);
+}
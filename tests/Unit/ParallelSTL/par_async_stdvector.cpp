@@ -0,0 +1,66 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#include <hc.hpp>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test transform and reduce with par_async, on std::vector and on chained
+// device_iterators, which only wait for their results through the futures
+// they return
+
+template<typename T, size_t SIZE>
+bool test(void) {
+  using namespace std::experimental::parallel;
+
+  auto f = [](const T& v) { return v * 2; };
+  auto g = [](const T& a, const T& b) { return a + b; };
+  auto binary_op = std::plus<T>();
+
+  std::vector<T> input(SIZE);
+  std::iota(std::begin(input), std::end(input), 1);
+
+  std::vector<T> expected(SIZE);
+  std::transform(std::begin(input), std::end(input), std::begin(expected), f);
+  T sum = std::accumulate(std::begin(expected), std::end(expected), T{}, binary_op);
+
+  bool ret = true;
+
+  // std::vector, the output is written back once the future is waited for
+  std::vector<T> output(SIZE);
+  hc::completion_future fut = transform(par_async, std::begin(input), std::end(input),
+                                        std::begin(output), f);
+  fut.wait();
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  std::future<T> result = reduce(par_async, std::begin(output), std::end(output), T{}, binary_op);
+  ret &= (result.get() == sum);
+
+  // device_iterators, kernels run in order with no waits in between
+  hc::array_view<T, 1> in(SIZE, input);
+  hc::array_view<T, 1> tmp((hc::extent<1>(SIZE)));
+  hc::array_view<T, 1> out((hc::extent<1>(SIZE)));
+  transform(par_async, device_begin(in), device_end(in), device_begin(tmp), f);
+  transform(par_async, device_begin(tmp), device_end(tmp), device_begin(tmp),
+            device_begin(out), g);
+  result = reduce(par_async, device_begin(out), device_end(out));
+  ret &= (result.get() == sum * 2);
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test<int, TEST_SIZE>();
+  ret &= test<unsigned, TEST_SIZE>();
+
+  return !(ret == true);
+}
@@ -0,0 +1,67 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test sort, stable_sort and sort_by_key of keys the radix sort handles, in
+// ascending and descending orders, on inputs spanning many tiles whose sizes
+// aren't multiples of the tiles, negative keys included
+
+template<typename T, typename Compare>
+bool test(size_t n, Compare comp) {
+  using namespace std::experimental::parallel;
+
+  std::vector<T> input(n);
+  for (size_t i = 0; i < n; ++i) {
+    input[i] = static_cast<T>((static_cast<long long>(i) * 7919) % 1009) - static_cast<T>(300);
+  }
+
+  bool ret = true;
+
+  std::vector<T> expected(input);
+  std::stable_sort(std::begin(expected), std::end(expected), comp);
+
+  std::vector<T> output(input);
+  sort(par, std::begin(output), std::end(output), comp);
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  output = input;
+  stable_sort(par, std::begin(output), std::end(output), comp);
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  // values are the indices of the keys, which stay in order for equal keys
+  std::vector<int> values(n);
+  std::iota(std::begin(values), std::end(values), 0);
+  std::vector<int> indices(values);
+  std::stable_sort(std::begin(indices), std::end(indices),
+                   [&](int a, int b) { return comp(input[a], input[b]); });
+  output = input;
+  sort_by_key(par, std::begin(output), std::end(output), std::begin(values), comp);
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+  ret &= std::equal(std::begin(values), std::end(values), std::begin(indices));
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  size_t sizes[] = { 2047, 2049, 100003, (1 << 20) + 3 };
+  for (size_t n : sizes) {
+    ret &= test<int>(n, std::less<int>());
+    ret &= test<int>(n, std::greater<int>());
+    ret &= test<unsigned>(n, std::less<unsigned>());
+    ret &= test<float>(n, std::less<float>());
+    ret &= test<float>(n, std::greater<float>());
+    ret &= test<double>(n, std::less<double>());
+  }
+
+  return !(ret == true);
+}
@@ -0,0 +1,63 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test inclusive and exclusive scans of inputs spanning many tiles of the
+// single-pass scan, whose sizes aren't multiples of the tiles, and of the
+// three-kernel scan of types which aren't 4 bytes
+
+template<typename T, typename BinaryOperation>
+bool test(size_t n, BinaryOperation binary_op, T init) {
+  using namespace std::experimental::parallel;
+
+  std::vector<T> input(n);
+  for (size_t i = 0; i < n; ++i) {
+    input[i] = static_cast<T>((i * 7) % 13);
+  }
+
+  bool ret = true;
+
+  // inclusive
+  std::vector<T> expected(n);
+  std::partial_sum(std::begin(input), std::end(input), std::begin(expected), binary_op);
+  std::vector<T> output(n);
+  inclusive_scan(par, std::begin(input), std::end(input), std::begin(output), binary_op, init);
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  // exclusive
+  T sum = init;
+  for (size_t i = 0; i < n; ++i) {
+    expected[i] = sum;
+    sum = binary_op(sum, input[i]);
+  }
+  exclusive_scan(par, std::begin(input), std::end(input), std::begin(output), init, binary_op);
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  // in place
+  exclusive_scan(par, std::begin(input), std::end(input), std::begin(input), init, binary_op);
+  ret &= std::equal(std::begin(input), std::end(input), std::begin(expected));
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  size_t sizes[] = { 1023, 1025, 4096, 100003, (1 << 20) + 3 };
+  for (size_t n : sizes) {
+    ret &= test<int>(n, std::plus<int>(), 5);
+    ret &= test<unsigned>(n, std::plus<unsigned>(), 0);
+    ret &= test<float>(n, std::plus<float>(), 0);
+    ret &= test<double>(n, std::plus<double>(), 1);
+  }
+
+  return !(ret == true);
+}
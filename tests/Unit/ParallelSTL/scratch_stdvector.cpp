@@ -0,0 +1,65 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/numeric>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test algorithms whose temporary buffers are drawn from the scratch memory,
+// run again once it keeps them, and after it's bounded and trimmed
+
+template<typename T>
+bool run(size_t n) {
+  using namespace std::experimental::parallel;
+
+  std::vector<T> input(n);
+  for (size_t i = 0; i < n; ++i) {
+    input[i] = static_cast<T>((i * 7919) % 1009);
+  }
+
+  bool ret = true;
+
+  std::vector<T> expected(input), output(input);
+  std::sort(std::begin(expected), std::end(expected));
+  stable_sort(par, std::begin(output), std::end(output));
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  std::partial_sum(std::begin(input), std::end(input), std::begin(expected));
+  inclusive_scan(par, std::begin(input), std::end(input), std::begin(output));
+  ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+
+  return ret;
+}
+
+int main() {
+  using namespace std::experimental::parallel;
+
+  bool ret = true;
+
+  ret &= (reserve_scratch(1 << 20) >= (1 << 20));
+  ret &= run<int>(100003);
+
+  // the buffers of the first run are kept for the second one
+  size_t kept = get_scratch_size();
+  ret &= (kept >= (1 << 20));
+  ret &= run<int>(100003);
+  ret &= (get_scratch_size() == kept);
+
+  // algorithms still run when nothing is kept
+  set_scratch_limit(0);
+  ret &= (get_scratch_size() == 0);
+  ret &= run<unsigned>(70001);
+  ret &= (get_scratch_size() == 0);
+
+  set_scratch_limit(64 * 1024 * 1024);
+  ret &= run<float>(70001);
+  ret &= (trim_scratch() > 0);
+  ret &= (get_scratch_size() == 0);
+
+  return !(ret == true);
+}
@@ -0,0 +1,51 @@
+// XFAIL: Linux
+// RUN: %hc %s -o %t.out && rm -f %t.thresholds
+// RUN: HCC_PSTL_CALIBRATE=1 HCC_PSTL_THRESHOLDS=%t.thresholds %t.out
+// RUN: grep transform %t.thresholds && HCC_PSTL_THRESHOLDS=%t.thresholds %t.out
+
+// Parallel STL headers
+#include <coordinate>
+#include <experimental/algorithm>
+#include <experimental/execution_policy>
+
+#define _DEBUG (0)
+#include "test_base.h"
+
+// test transform on inputs of many sizes, which run on the host and on the
+// accelerator while the thresholds are calibrated, and on the side the
+// thresholds calibrated select afterwards
+
+#define MAX_SIZE (1 << 16)
+#define ITERATION (8)
+
+template<typename T>
+bool test(void) {
+  using std::experimental::parallel::par;
+
+  auto f = [](const T& v) { return v * 2 + 1; };
+
+  bool ret = true;
+  for (size_t n = 1; n <= MAX_SIZE; n *= 4) {
+    std::vector<T> input(n);
+    std::iota(std::begin(input), std::end(input), 0);
+    std::vector<T> expected(n);
+    std::transform(std::begin(input), std::end(input), std::begin(expected), f);
+    for (int i = 0; i < ITERATION; ++i) {
+      std::vector<T> output(n);
+      std::experimental::parallel::
+      transform(par, std::begin(input), std::end(input), std::begin(output), f);
+      ret &= std::equal(std::begin(output), std::end(output), std::begin(expected));
+    }
+  }
+
+  return ret;
+}
+
+int main() {
+  bool ret = true;
+
+  ret &= test<int>();
+  ret &= test<double>();
+
+  return !(ret == true);
+}
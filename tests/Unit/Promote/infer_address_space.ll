@@ -0,0 +1,39 @@
+; RUN: %opt -load %llvm_libs_dir/LLVMPromote.so -infer-address-spaces -S < %s | tee %t | %FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+declare i8 addrspace(3)* @get_dynamic_group_segment_base_pointer()
+
+; an argument is passed group segment pointers at all the call sites
+define internal i32 @load_at(i32* %p, i32 %i) {
+; CHECK-LABEL: define internal i32 @load_at
+; CHECK: [[P:%[a-z0-9.]+]] = addrspacecast i32* %p to i32 addrspace(3)*
+; CHECK: [[IDX:%[a-z0-9.]+]] = getelementptr inbounds i32 addrspace(3)* [[P]], i32 %i
+; CHECK: load i32 addrspace(3)* [[IDX]]
+entry:
+  %arrayidx = getelementptr inbounds i32* %p, i32 %i
+  %0 = load i32* %arrayidx, align 4
+  ret i32 %0
+}
+
+define void @kernel(i32 addrspace(1)* %out, i32** %ptrs, i32 %i, i1 %c) {
+; CHECK-LABEL: define void @kernel
+; CHECK: [[BASE:%[a-z0-9.]+]] = bitcast i8 addrspace(3)* %base to i32 addrspace(3)*
+; CHECK: [[GEP:%[a-z0-9.]+]] = getelementptr inbounds i32 addrspace(3)* [[BASE]], i32 16
+; CHECK: [[SEL:%[a-z0-9.]+]] = select i1 %c, i32 addrspace(3)* [[BASE]], i32 addrspace(3)* [[GEP]]
+; CHECK: store i32 0, i32 addrspace(3)* [[SEL]]
+; CHECK: store i32 1, i32* %mixed
+entry:
+  %base = call i8 addrspace(3)* @get_dynamic_group_segment_base_pointer()
+  %0 = addrspacecast i8 addrspace(3)* %base to i32*
+  %1 = getelementptr inbounds i32* %0, i32 16
+  %sel = select i1 %c, i32* %0, i32* %1
+  store i32 0, i32* %sel, align 4
+  %v = call i32 @load_at(i32* %sel, i32 %i)
+  store i32 %v, i32 addrspace(1)* %out, align 4
+  ; a pointer loaded from memory may point anywhere, so the select stays flat
+  %loaded = load i32** %ptrs, align 8
+  %mixed = select i1 %c, i32* %0, i32* %loaded
+  store i32 1, i32* %mixed, align 4
+  ret void
+}
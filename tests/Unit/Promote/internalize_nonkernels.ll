@@ -0,0 +1,41 @@
+; RUN: %opt -load %llvm_libs_dir/LLVMEraseNonkernel.so -internalize-nonkernels -globaldce -S < %s | %FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; variables are looked up by name by the runtime, they stay
+; CHECK: @table = global [4 x float] zeroinitializer
+@table = global [4 x float] zeroinitializer, align 4
+
+declare float @llvm.sqrt.f32(float)
+
+; a builtin of the math library a kernel calls is kept, internal
+; CHECK: define internal float @opencl_sqrt(float %x)
+define linkonce_odr float @opencl_sqrt(float %x) {
+entry:
+  %0 = call float @llvm.sqrt.f32(float %x)
+  ret float %0
+}
+
+; the builtins no kernel calls are dropped
+; CHECK-NOT: @opencl_cos
+define linkonce_odr float @opencl_cos(float %x) {
+entry:
+  ret float %x
+}
+
+; CHECK-NOT: @opencl_sin
+define float @opencl_sin(float %x) {
+entry:
+  ret float %x
+}
+
+; CHECK: define void @_ZN3Foo19__cxxamp_trampolineEf(float %x)
+define void @_ZN3Foo19__cxxamp_trampolineEf(float %x) {
+entry:
+  %0 = call float @opencl_sqrt(float %x)
+  store float %0, float* getelementptr inbounds ([4 x float]* @table, i32 0, i32 0), align 4
+  ret void
+}
+
+!opencl.kernels = !{!0}
+!0 = metadata !{void (float)* @_ZN3Foo19__cxxamp_trampolineEf}
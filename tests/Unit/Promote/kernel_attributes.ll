@@ -0,0 +1,35 @@
+; RUN: %opt -load %llvm_libs_dir/LLVMPromote.so -kernel-attributes -S < %s | %FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+%struct.Foo = type { i32 }
+
+@.str = private unnamed_addr constant [30 x i8] c"hc_max_workgroup_dim(256,1,1)\00", section "llvm.metadata"
+@.str1 = private unnamed_addr constant [19 x i8] c"hc_waves_per_eu(4)\00", section "llvm.metadata"
+@.str2 = private unnamed_addr constant [9 x i8] c"test.cpp\00", section "llvm.metadata"
+@llvm.global.annotations = appending global [2 x { i8*, i8*, i8*, i32 }] [{ i8*, i8*, i8*, i32 } { i8* bitcast (void (%struct.Foo*, i32)* @_ZNK3FooclEi to i8*), i8* getelementptr inbounds ([30 x i8]* @.str, i32 0, i32 0), i8* getelementptr inbounds ([9 x i8]* @.str2, i32 0, i32 0), i32 4 }, { i8*, i8*, i8*, i32 } { i8* bitcast (void (%struct.Foo*, i32)* @_ZNK3FooclEi to i8*), i8* getelementptr inbounds ([19 x i8]* @.str1, i32 0, i32 0), i8* getelementptr inbounds ([9 x i8]* @.str2, i32 0, i32 0), i32 4 }], section "llvm.metadata"
+
+; the call operator of Foo is annotated, its trampoline is the kernel
+define linkonce_odr void @_ZNK3FooclEi(%struct.Foo* %this, i32 %i) {
+entry:
+  ret void
+}
+
+; CHECK: define void @_ZN3Foo19__cxxamp_trampolineEi(i32 %i) #[[FOO:[0-9]+]]
+define void @_ZN3Foo19__cxxamp_trampolineEi(i32 %i) {
+entry:
+  ret void
+}
+
+; another functor is left alone
+; CHECK: define void @_ZN3Bar19__cxxamp_trampolineEi(i32 %i) {
+define void @_ZN3Bar19__cxxamp_trampolineEi(i32 %i) {
+entry:
+  ret void
+}
+
+!opencl.kernels = !{!0, !1}
+!0 = metadata !{void (i32)* @_ZN3Foo19__cxxamp_trampolineEi}
+!1 = metadata !{void (i32)* @_ZN3Bar19__cxxamp_trampolineEi}
+
+; CHECK: attributes #[[FOO]] = { {{.*}}"amdgpu-flat-work-group-size"="1,256" "amdgpu-waves-per-eu"="4" "hc-max-workgroup-dim"="256,1,1" "hc-waves-per-eu"="4"{{.*}} }
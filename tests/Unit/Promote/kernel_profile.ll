@@ -0,0 +1,59 @@
+; RUN: echo "_ZN3Foo19__cxxamp_trampolineEi 100 9000 64,2,1" > %t.prof
+; RUN: echo "_ZN3Bar19__cxxamp_trampolineEi 10 900 256,1,1" >> %t.prof
+; RUN: echo "_ZN3Baz19__cxxamp_trampolineEi 1000 100 128,1,1" >> %t.prof
+; RUN: %opt -load %llvm_libs_dir/LLVMPromote.so -kernel-attributes -kernel-profile=%t.prof -S < %s | %FileCheck %s
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; the hot kernel gets the largest workgroup of the profile as launch bounds,
+; and the functions it calls are inlined
+; CHECK: define void @_ZN3Foo19__cxxamp_trampolineEi(i32 %i) #[[FOO:[0-9]+]]
+define void @_ZN3Foo19__cxxamp_trampolineEi(i32 %i) {
+entry:
+  call void @helper(i32 %i)
+  call void @pinned(i32 %i)
+  ret void
+}
+
+; CHECK: define internal void @helper(i32 %i) #[[INLINE:[0-9]+]]
+define internal void @helper(i32 %i) {
+entry:
+  call void @leaf(i32 %i)
+  ret void
+}
+
+; CHECK: define internal void @leaf(i32 %i) #[[INLINE]]
+define internal void @leaf(i32 %i) {
+entry:
+  ret void
+}
+
+; noinline functions are left alone
+; CHECK: define internal void @pinned(i32 %i) #[[PINNED:[0-9]+]]
+define internal void @pinned(i32 %i) noinline {
+entry:
+  ret void
+}
+
+; a kernel with 9% of the time isn't hot
+; CHECK: define void @_ZN3Bar19__cxxamp_trampolineEi(i32 %i) {
+define void @_ZN3Bar19__cxxamp_trampolineEi(i32 %i) {
+entry:
+  ret void
+}
+
+; neither is a kernel dispatched often, for little time
+; CHECK: define void @_ZN3Baz19__cxxamp_trampolineEi(i32 %i) {
+define void @_ZN3Baz19__cxxamp_trampolineEi(i32 %i) {
+entry:
+  ret void
+}
+
+!opencl.kernels = !{!0, !1, !2}
+!0 = metadata !{void (i32)* @_ZN3Foo19__cxxamp_trampolineEi}
+!1 = metadata !{void (i32)* @_ZN3Bar19__cxxamp_trampolineEi}
+!2 = metadata !{void (i32)* @_ZN3Baz19__cxxamp_trampolineEi}
+
+; CHECK-DAG: attributes #[[FOO]] = { "amdgpu-flat-work-group-size"="1,128" "hc-max-workgroup-dim"="64,2,1" }
+; CHECK-DAG: attributes #[[INLINE]] = { alwaysinline }
+; CHECK-DAG: attributes #[[PINNED]] = { noinline }
@@ -0,0 +1,57 @@
+; RUN: %opt -load %llvm_libs_dir/LLVMPromote.so -tile-static-banks -disable-output < %s 2>&1 | %FileCheck -check-prefix=WARN %s
+; RUN: %opt -load %llvm_libs_dir/LLVMPromote.so -tile-static-banks -tile-static-pad -S < %s 2> %t.err | %FileCheck %s
+; RUN: %FileCheck -check-prefix=PAD %s < %t.err
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; a transpose reads a column of its tile, with a stride of 32 words
+; CHECK: @tile = internal addrspace(3) global [32 x [33 x float]] zeroinitializer, align 4
+@tile = internal addrspace(3) global [32 x [32 x float]] zeroinitializer, align 4
+; rows are accessed without conflicts
+; CHECK: @rows = internal addrspace(3) global [16 x [64 x float]] zeroinitializer, align 4
+@rows = internal addrspace(3) global [16 x [64 x float]] zeroinitializer, align 4
+; a strided array of a single dimension has no rows to pad
+; CHECK: @flat = internal addrspace(3) global [1024 x float] zeroinitializer, align 4
+@flat = internal addrspace(3) global [1024 x float] zeroinitializer, align 4
+; a row passed to a function relies on the layout
+; CHECK: @pinned = internal addrspace(3) global [32 x [32 x i32]] zeroinitializer, align 4
+@pinned = internal addrspace(3) global [32 x [32 x i32]] zeroinitializer, align 4
+
+; WARN-NOT: tile_static rows
+; WARN: warning: tile_static tile: 32-way LDS bank conflicts in transpose, lengthening its rows by 1 (-tile-static-pad) removes them
+; WARN: warning: tile_static flat: 32-way LDS bank conflicts in transpose, cannot pad: it has a single dimension
+; WARN: warning: tile_static pinned: 32-way LDS bank conflicts in transpose, cannot pad: its layout is relied upon by {{.*}}%prow
+
+; PAD-NOT: tile_static tile
+; PAD-NOT: tile_static rows
+; PAD: warning: tile_static flat: 32-way LDS bank conflicts in transpose, cannot pad
+; PAD: warning: tile_static pinned: 32-way LDS bank conflicts in transpose, cannot pad
+
+declare i64 @amp_get_local_id(i32)
+
+declare void @use_row([32 x i32] addrspace(3)*)
+
+define void @transpose(float addrspace(1)* %out, i64 %k) {
+; CHECK-LABEL: define void @transpose
+; CHECK: %row = getelementptr inbounds [32 x [33 x float]] addrspace(3)* @tile, i64 0, i64 %k, i64 %lid
+; CHECK: %col = getelementptr inbounds [32 x [33 x float]] addrspace(3)* @tile, i64 0, i64 %lid, i64 %k
+; CHECK: load float addrspace(3)* %col
+entry:
+  %lid = call i64 @amp_get_local_id(i32 0)
+  %row = getelementptr inbounds [32 x [32 x float]] addrspace(3)* @tile, i64 0, i64 %k, i64 %lid
+  store float 1.000000e+00, float addrspace(3)* %row, align 4
+  %col = getelementptr inbounds [32 x [32 x float]] addrspace(3)* @tile, i64 0, i64 %lid, i64 %k
+  %v = load float addrspace(3)* %col, align 4
+  %r = getelementptr inbounds [16 x [64 x float]] addrspace(3)* @rows, i64 0, i64 %k, i64 %lid
+  store float %v, float addrspace(3)* %r, align 4
+  %idx = mul i64 %lid, 32
+  %f = getelementptr inbounds [1024 x float] addrspace(3)* @flat, i64 0, i64 %idx
+  store float %v, float addrspace(3)* %f, align 4
+  %p = getelementptr inbounds [32 x [32 x i32]] addrspace(3)* @pinned, i64 0, i64 %lid, i64 0
+  store i32 0, i32 addrspace(3)* %p, align 4
+  %prow = getelementptr inbounds [32 x [32 x i32]] addrspace(3)* @pinned, i64 0, i64 %lid
+  call void @use_row([32 x i32] addrspace(3)* %prow)
+  %o = getelementptr inbounds float addrspace(1)* %out, i64 %lid
+  store float %v, float addrspace(1)* %o, align 4
+  ret void
+}
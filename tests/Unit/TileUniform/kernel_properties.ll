@@ -0,0 +1,48 @@
+; RUN: %opt -load %llvm_libs_dir/LLVMTileUniform.so -tile-uniform -kernel-properties=%t -disable-output < %s
+; RUN: %FileCheck %s < %t
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: HCC kernel properties 1
+; CHECK-DAG: plain barriers=none group_segment=0
+; CHECK-DAG: tiled barriers=uniform group_segment=1
+; CHECK-DAG: dynamic barriers=none group_segment=1
+
+@tiled.local = internal addrspace(3) global [64 x i32] undef, align 4
+
+declare void @amp_barrier(i32)
+declare i8 addrspace(3)* @get_dynamic_group_segment_base_pointer()
+
+define void @plain(i32 addrspace(1)* %out) {
+entry:
+  store i32 0, i32 addrspace(1)* %out, align 4
+  ret void
+}
+
+; the barrier and the tile_static variable are in a callee
+define internal void @tile_step(i32 %x) {
+entry:
+  %p = getelementptr inbounds [64 x i32] addrspace(3)* @tiled.local, i32 0, i32 0
+  store i32 %x, i32 addrspace(3)* %p, align 4
+  call void @amp_barrier(i32 0)
+  ret void
+}
+
+define void @tiled(i32 %x) {
+entry:
+  call void @tile_step(i32 %x)
+  ret void
+}
+
+define void @dynamic() {
+entry:
+  %base = call i8 addrspace(3)* @get_dynamic_group_segment_base_pointer()
+  store i8 0, i8 addrspace(3)* %base, align 1
+  ret void
+}
+
+!opencl.kernels = !{!0, !1, !2}
+
+!0 = metadata !{void (i32 addrspace(1)*)* @plain}
+!1 = metadata !{void (i32)* @tiled}
+!2 = metadata !{void ()* @dynamic}
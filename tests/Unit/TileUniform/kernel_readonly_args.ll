@@ -0,0 +1,55 @@
+; RUN: %opt -load %llvm_libs_dir/LLVMTileUniform.so -tile-uniform -kernel-properties=%t -disable-output < %s
+; RUN: %FileCheck %s < %t
+target datalayout = "e-m:e-i64:64-f80:128-n8:16:32:64-S128"
+target triple = "x86_64-unknown-linux-gnu"
+
+; CHECK: HCC kernel properties 1
+; CHECK-DAG: copy barriers=none group_segment=0 readonly_args=1{{$}}
+; CHECK-DAG: helper barriers=none group_segment=0 readonly_args=0{{$}}
+; CHECK-DAG: atomic barriers=none group_segment=0{{$}}
+
+; %in is only loaded from, %out is stored to
+define void @copy(i32 addrspace(1)* %out, i32 addrspace(1)* %in, i32 %i) {
+entry:
+  %src = getelementptr inbounds i32 addrspace(1)* %in, i32 %i
+  %v = load i32 addrspace(1)* %src, align 4
+  %dst = getelementptr inbounds i32 addrspace(1)* %out, i32 %i
+  store i32 %v, i32 addrspace(1)* %dst, align 4
+  ret void
+}
+
+; a callee only reading through its argument, and one writing through it
+define internal i32 @read(i32 addrspace(1)* %p) {
+entry:
+  %v = load i32 addrspace(1)* %p, align 4
+  ret i32 %v
+}
+
+define internal void @write(i32 addrspace(1)* %p, i32 %v) {
+entry:
+  store i32 %v, i32 addrspace(1)* %p, align 4
+  ret void
+}
+
+define void @helper(i32 addrspace(1)* %in, i32 addrspace(1)* %out) {
+entry:
+  %v = call i32 @read(i32 addrspace(1)* %in)
+  call void @write(i32 addrspace(1)* %out, i32 %v)
+  ret void
+}
+
+; atomics and calls of declarations count as writes
+declare i32 @__hsail_atomic_fetch_add_int(i32 addrspace(1)*, i32)
+
+define void @atomic(i32 addrspace(1)* %counter, i32 addrspace(1)* %opaque) {
+entry:
+  %old = atomicrmw add i32 addrspace(1)* %counter, i32 1 seq_cst
+  %r = call i32 @__hsail_atomic_fetch_add_int(i32 addrspace(1)* %opaque, i32 1)
+  ret void
+}
+
+!opencl.kernels = !{!0, !1, !2}
+
+!0 = metadata !{void (i32 addrspace(1)*, i32 addrspace(1)*, i32)* @copy}
+!1 = metadata !{void (i32 addrspace(1)*, i32 addrspace(1)*)* @helper}
+!2 = metadata !{void (i32 addrspace(1)*, i32 addrspace(1)*)* @atomic}
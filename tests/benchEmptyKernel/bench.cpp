@@ -2,6 +2,8 @@
 // RUN: %t.out 10000
 // RUN: test -e pfe.dat && mv pfe.dat %T/pfe.dat
 // RUN: test -e grid_launch.dat && mv grid_launch.dat %T/grid_launch.dat
+// RUN: test -e grid_launch_recapture.dat && mv grid_launch_recapture.dat %T/grid_launch_recapture.dat
+// RUN: test -e launch_template.dat && mv launch_template.dat %T/launch_template.dat
 
 // benchmark for empty PFE/grid_launch kernel
 //
@@ -104,11 +106,15 @@ int main(int argc, char* argv[]) {
   std::chrono::time_point<std::chrono::high_resolution_clock> start, end;
   std::vector<std::chrono::duration<double>> elapsed_pfe;
   std::vector<std::chrono::duration<double>> elapsed_grid_launch;
+  std::vector<std::chrono::duration<double>> elapsed_grid_launch_recapture;
+  std::vector<std::chrono::duration<double>> elapsed_launch_template;
   std::vector<std::chrono::duration<double>> elapsed_exception;
   std::chrono::duration<double> tol_hi(TOL_HI);
   std::vector<std::chrono::duration<double>> outliers_pfe;
   std::vector<std::chrono::duration<double>> outliers_gl;
   std::vector<std::chrono::duration<double>> outliers_gl_ex;
+  std::vector<std::chrono::duration<double>> outliers_gl_rc;
+  std::vector<std::chrono::duration<double>> outliers_lt;
 
   grid_launch_parm lp;
   grid_launch_init(&lp);
@@ -164,5 +170,41 @@ int main(int argc, char* argv[]) {
   plot("grid_launch", elapsed_grid_launch);
   std::cout << "grid_launch time (s):          " << average(elapsed_grid_launch) << "\n";
 
+  // Timing null grid_launch call alternating between two grid sizes,
+  // so every launch captures its dispatch again instead of reusing it
+  grid_launch_parm lp_other = lp;
+  lp_other.grid_dim = gl_dim3(GRID_SIZE * 2);
+  for(int i = 0; i < dispatch_count; ++i) {
+    start = std::chrono::high_resolution_clock::now();
+    kernel((i % 2) ? lp_other : lp);
+    lp.cf->wait();
+
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> dur = end - start;
+    elapsed_grid_launch_recapture.push_back(dur);
+  }
+  remove_outliers(elapsed_grid_launch_recapture, outliers_gl_rc);
+  plot("grid_launch_recapture", elapsed_grid_launch_recapture);
+  std::cout << "grid_launch recapture time (s):" << average(elapsed_grid_launch_recapture) << "\n";
+
+  // Timing null kernel launched from a launch_template, the lower bound of
+  // the grid_launch call
+  hc::launch_template lt = hc::create_launch_template(av, hc::extent<3>(lp.grid_dim.x*lp.group_dim.x,1,1).tile(lp.group_dim.x,1,1),
+  [=](hc::tiled_index<3>& idx) __HC__ {
+  });
+  for(int i = 0; i < dispatch_count && lt.valid(); ++i) {
+    start = std::chrono::high_resolution_clock::now();
+    lt.launch().wait();
+
+    end = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> dur = end - start;
+    elapsed_launch_template.push_back(dur);
+  }
+  if (lt.valid()) {
+    remove_outliers(elapsed_launch_template, outliers_lt);
+    plot("launch_template", elapsed_launch_template);
+    std::cout << "launch_template time (s):      " << average(elapsed_launch_template) << "\n";
+  }
+
   return 0;
 }
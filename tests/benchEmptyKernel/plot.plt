@@ -15,3 +15,13 @@ set output "grid_launch.svg"
 set title "Grid Launch plot"
 stats "./grid_launch.dat" using 2 prefix "A"
 plot "./grid_launch.dat" using 1:2 title "", A_mean title gprintf("Mean = %.5te%+03T s", A_mean)
+
+set output "grid_launch_recapture.svg"
+set title "Grid Launch Recapture plot"
+stats "./grid_launch_recapture.dat" using 2 prefix "A"
+plot "./grid_launch_recapture.dat" using 1:2 title "", A_mean title gprintf("Mean = %.5te%+03T s", A_mean)
+
+set output "launch_template.svg"
+set title "Launch Template plot"
+stats "./launch_template.dat" using 2 prefix "A"
+plot "./launch_template.dat" using 1:2 title "", A_mean title gprintf("Mean = %.5te%+03T s", A_mean)
@@ -0,0 +1,394 @@
+// RUN: %hc %s -lhc_am -o %t.out
+// RUN: %t.out --benchmark_min_time=0.01 --benchmark_out=%T/bench.json
+
+// microbenchmarks of the hot paths of the runtime
+//
+// Each benchmark runs a loop, whose iteration count grows until the loop
+// takes at least the minimum time, in the way of Google Benchmark, and its
+// results are written in the JSON format of Google Benchmark, so runs
+// can be compared by its tools to catch regressions.
+//
+// For best results set GPU performance level to high, where N in cardN is a number
+// echo high | sudo tee /sys/class/drm/cardX/device/power_dpm_force_performance_level
+
+// hcc `hcc-config --cxxflags --ldflags` -lhc_am -lpthread bench.cpp -o bench
+// ./bench --benchmark_out=bench.json
+//
+// options:
+//   --benchmark_filter=<substring>  only run the benchmarks whose name has it
+//   --benchmark_min_time=<seconds>  minimum time of each benchmark, 0.5s by default
+//   --benchmark_out=<file>          write the results in JSON to the file
+//   --benchmark_format=json         write the results in JSON to the console
+
+
+#include "hc.hpp"
+#include "hc_am.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define KB (1024)
+#define MB (1024 * 1024)
+
+#define MAX_ITERATIONS (1000000000)
+
+typedef std::chrono::steady_clock clock_type;
+
+// the state of a benchmark while it runs, one per host thread
+class State {
+public:
+  State(int64_t iterations, int64_t arg, int thread_index, int threads)
+      : arg(arg), thread_index(thread_index), threads(threads),
+        iterations(iterations), remaining(iterations), bytes(0), items(0),
+        started(false), skipped(clock_type::duration::zero()) {}
+
+  // true as long as the loop is to be run
+  bool KeepRunning() {
+    if (!started) {
+      started = true;
+      begin = clock_type::now();
+    }
+    if (remaining-- > 0)
+      return true;
+    end = clock_type::now();
+    return false;
+  }
+
+  // time between PauseTiming() and ResumeTiming() isn't counted
+  void PauseTiming() { pause = clock_type::now(); }
+  void ResumeTiming() { skipped += clock_type::now() - pause; }
+
+  int64_t range() const { return arg; }
+  void SetBytesProcessed(int64_t n) { bytes = n; }
+  void SetItemsProcessed(int64_t n) { items = n; }
+
+  int64_t bytes_processed() const { return bytes; }
+  int64_t items_processed() const { return items; }
+  clock_type::duration elapsed() const { return end - begin - skipped; }
+
+  const int64_t arg;
+  const int thread_index;
+  const int threads;
+  const int64_t iterations;
+
+private:
+  int64_t remaining;
+  int64_t bytes;
+  int64_t items;
+  bool started;
+  clock_type::time_point begin;
+  clock_type::time_point end;
+  clock_type::time_point pause;
+  clock_type::duration skipped;
+};
+
+struct Result {
+  std::string name;
+  int64_t iterations;
+  double real_time;     // ns per iteration
+  double cpu_time;      // ns per iteration
+  double bytes_per_second;
+  double items_per_second;
+};
+
+struct Benchmark {
+  std::string name;
+  std::function<void(State&)> func;
+  std::vector<int64_t> args;
+  std::vector<int> threads;
+  // run once, for costs which are only paid the first time
+  bool once;
+};
+
+static std::vector<Benchmark>& benchmarks() {
+  static std::vector<Benchmark> list;
+  return list;
+}
+
+static Benchmark& add(const std::string& name, std::function<void(State&)> func) {
+  Benchmark b = { name, func, {}, {}, false };
+  benchmarks().push_back(b);
+  return benchmarks().back();
+}
+
+// run a benchmark for a number of iterations on its threads
+static Result run(const Benchmark& b, int64_t arg, int threads, int64_t iterations) {
+  std::vector<State> states;
+  for (int t = 0; t < threads; ++t)
+    states.push_back(State(iterations, arg, t, threads));
+
+  std::clock_t cpu_begin = std::clock();
+  if (threads == 1) {
+    b.func(states[0]);
+  } else {
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+      workers.push_back(std::thread(b.func, std::ref(states[t])));
+    for (auto& w : workers)
+      w.join();
+  }
+  std::clock_t cpu_end = std::clock();
+
+  // the threads run at the same time, the slowest one is the time of all
+  clock_type::duration elapsed = clock_type::duration::zero();
+  int64_t bytes = 0;
+  int64_t items = 0;
+  for (auto& s : states) {
+    elapsed = std::max(elapsed, s.elapsed());
+    bytes += s.bytes_processed();
+    items += s.items_processed();
+  }
+
+  double seconds = std::chrono::duration<double>(elapsed).count();
+  Result r;
+  r.iterations = iterations;
+  r.real_time = seconds * 1e9 / iterations;
+  r.cpu_time = (double)(cpu_end - cpu_begin) / CLOCKS_PER_SEC * 1e9 / (iterations * threads);
+  r.bytes_per_second = seconds > 0 ? bytes / seconds : 0;
+  r.items_per_second = seconds > 0 ? items / seconds : 0;
+  return r;
+}
+
+// grow the iteration count until the benchmark runs for min_time
+static Result measure(const Benchmark& b, int64_t arg, int threads, double min_time) {
+  int64_t iterations = 1;
+  for (;;) {
+    Result r = run(b, arg, threads, iterations);
+    double seconds = r.real_time * iterations / 1e9;
+    if (b.once || seconds >= min_time || iterations >= MAX_ITERATIONS)
+      return r;
+    // aim a little beyond min_time, at most 10 times more iterations
+    double multiplier = seconds > 0 ? 1.4 * min_time / seconds : 10.0;
+    multiplier = std::min(std::max(multiplier, 2.0), 10.0);
+    iterations = std::min<int64_t>(iterations * multiplier, MAX_ITERATIONS);
+  }
+}
+
+static void write_json(std::ostream& os, const char* executable, const std::vector<Result>& results) {
+  char date[64];
+  std::time_t now = std::time(nullptr);
+  std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M:%S", std::localtime(&now));
+
+  os << "{\n";
+  os << "  \"context\": {\n";
+  os << "    \"date\": \"" << date << "\",\n";
+  os << "    \"executable\": \"" << executable << "\",\n";
+  os << "    \"num_cpus\": " << std::thread::hardware_concurrency() << ",\n";
+  os << "    \"library_build_type\": \"release\"\n";
+  os << "  },\n";
+  os << "  \"benchmarks\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& r = results[i];
+    os << (i ? ",\n" : "\n");
+    os << "    {\n";
+    os << "      \"name\": \"" << r.name << "\",\n";
+    os << "      \"iterations\": " << r.iterations << ",\n";
+    os << "      \"real_time\": " << r.real_time << ",\n";
+    os << "      \"cpu_time\": " << r.cpu_time << ",\n";
+    os << "      \"time_unit\": \"ns\"";
+    if (r.bytes_per_second > 0)
+      os << ",\n      \"bytes_per_second\": " << r.bytes_per_second;
+    if (r.items_per_second > 0)
+      os << ",\n      \"items_per_second\": " << r.items_per_second;
+    os << "\n    }";
+  }
+  os << "\n  ]\n}\n";
+}
+
+// ------------------------------------------------------------------------
+// benchmarks
+// ------------------------------------------------------------------------
+
+#define GRID_SIZE (64)
+
+static void empty_kernel(hc::index<1> idx) [[hc]] {}
+
+// time from launching the first kernel of the program to its completion,
+// which loads the code object, measured before any other launch
+static double first_launch_ns = 0;
+
+static void bench_first_launch(State& state) {
+  while (state.KeepRunning()) {
+    // the time is taken at startup
+  }
+}
+
+static void bench_dispatch_sync(State& state) {
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  while (state.KeepRunning()) {
+    hc::parallel_for_each(av, hc::extent<1>(GRID_SIZE), empty_kernel).wait();
+  }
+  state.SetItemsProcessed(state.iterations);
+}
+
+static void bench_dispatch_async(State& state) {
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  while (state.KeepRunning()) {
+    hc::parallel_for_each(av, hc::extent<1>(GRID_SIZE), empty_kernel);
+  }
+  state.PauseTiming();
+  av.wait();
+  state.ResumeTiming();
+  state.SetItemsProcessed(state.iterations);
+}
+
+// all the threads dispatch to the same view, completion included
+static void bench_dispatch_throughput(State& state) {
+  hc::accelerator_view av = hc::accelerator().get_default_view();
+  hc::completion_future last;
+  while (state.KeepRunning()) {
+    last = hc::parallel_for_each(av, hc::extent<1>(GRID_SIZE), empty_kernel);
+  }
+  last.wait();
+  state.SetItemsProcessed(state.iterations);
+}
+
+enum copy_kind { h2d, d2h, d2d };
+
+template <copy_kind kind>
+static void bench_copy(State& state) {
+  size_t size = state.range();
+  hc::accelerator acc;
+  std::vector<char> host(size, 1);
+  char* device = hc::am_alloc(size, acc, 0);
+  char* device2 = hc::am_alloc(size, acc, 0);
+  while (state.KeepRunning()) {
+    if (kind == h2d)
+      hc::am_copy(device, host.data(), size);
+    else if (kind == d2h)
+      hc::am_copy(host.data(), device, size);
+    else
+      hc::am_copy(device2, device, size);
+  }
+  hc::am_free(device);
+  hc::am_free(device2);
+  state.SetBytesProcessed(state.iterations * size);
+}
+
+// the host writes an array_view, a kernel updates it, and the host reads it
+static void bench_array_view_round_trip(State& state) {
+  size_t count = state.range() / sizeof(int);
+  std::vector<int> data(count, 0);
+  hc::array_view<int, 1> av(count, data);
+  while (state.KeepRunning()) {
+    av[0] = 1;
+    hc::parallel_for_each(av.get_extent(), [=](hc::index<1> idx) [[hc]] {
+      av[idx] += 1;
+    });
+    if (av[0] != 2)
+      std::cerr << "array_view round trip: wrong result\n";
+  }
+  state.SetBytesProcessed(state.iterations * count * sizeof(int));
+}
+
+static void bench_am_alloc(State& state) {
+  size_t size = state.range();
+  hc::accelerator acc;
+  while (state.KeepRunning()) {
+    void* p = hc::am_alloc(size, acc, 0);
+    hc::am_free(p);
+  }
+  state.SetItemsProcessed(state.iterations);
+}
+
+static void register_benchmarks() {
+  add("BM_FirstLaunch", bench_first_launch).once = true;
+  add("BM_DispatchSync", bench_dispatch_sync);
+  add("BM_DispatchAsync", bench_dispatch_async);
+  add("BM_DispatchThroughput", bench_dispatch_throughput).threads = { 1, 8, 64 };
+  const std::vector<int64_t> sizes = { 4 * KB, 64 * KB, 1 * MB, 16 * MB, 64 * MB };
+  add("BM_CopyH2D", bench_copy<h2d>).args = sizes;
+  add("BM_CopyD2H", bench_copy<d2h>).args = sizes;
+  add("BM_CopyD2D", bench_copy<d2d>).args = sizes;
+  add("BM_ArrayViewRoundTrip", bench_array_view_round_trip).args = { 4 * KB, 1 * MB, 16 * MB };
+  add("BM_AmAllocFree", bench_am_alloc).args = { 4 * KB, 1 * MB, 64 * MB };
+}
+
+int main(int argc, char* argv[]) {
+  // the first launch comes first, the code object isn't loaded yet
+  {
+    auto begin = clock_type::now();
+    hc::parallel_for_each(hc::extent<1>(GRID_SIZE), empty_kernel).wait();
+    first_launch_ns = std::chrono::duration<double, std::nano>(clock_type::now() - begin).count();
+  }
+
+  std::string filter;
+  double min_time = 0.5;
+  std::string out;
+  bool json = false;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    auto value = [&](const char* option) -> const char* {
+      size_t len = strlen(option);
+      return arg.compare(0, len, option) == 0 ? argv[i] + len : nullptr;
+    };
+    if (const char* v = value("--benchmark_filter="))
+      filter = v;
+    else if (const char* v = value("--benchmark_min_time="))
+      min_time = atof(v);
+    else if (const char* v = value("--benchmark_out="))
+      out = v;
+    else if (const char* v = value("--benchmark_format="))
+      json = (strcmp(v, "json") == 0);
+    else {
+      std::cerr << "unknown option " << arg << "\n";
+      return 1;
+    }
+  }
+
+  register_benchmarks();
+
+  std::vector<Result> results;
+  if (!json)
+    printf("%-36s %16s %16s %12s %16s\n", "Benchmark", "Time (ns)", "CPU (ns)", "Iterations", "Rate");
+  for (const Benchmark& b : benchmarks()) {
+    std::vector<int64_t> args = b.args.empty() ? std::vector<int64_t>{ 0 } : b.args;
+    std::vector<int> threads = b.threads.empty() ? std::vector<int>{ 1 } : b.threads;
+    for (int64_t arg : args) {
+      for (int t : threads) {
+        std::stringstream name;
+        name << b.name;
+        if (!b.args.empty())
+          name << "/" << arg;
+        if (!b.threads.empty())
+          name << "/threads:" << t;
+        if (name.str().find(filter) == std::string::npos)
+          continue;
+
+        Result r = measure(b, arg, t, min_time);
+        r.name = name.str();
+        if (b.once)
+          r.real_time = r.cpu_time = first_launch_ns;
+        results.push_back(r);
+
+        if (!json) {
+          std::stringstream rate;
+          if (r.bytes_per_second > 0)
+            rate << r.bytes_per_second / MB << " MB/s";
+          else if (r.items_per_second > 0)
+            rate << r.items_per_second << " /s";
+          printf("%-36s %16.0f %16.0f %12lld %16s\n", r.name.c_str(), r.real_time, r.cpu_time,
+                 (long long)r.iterations, rate.str().c_str());
+        }
+      }
+    }
+  }
+
+  if (json)
+    write_json(std::cout, argv[0], results);
+  if (!out.empty()) {
+    std::ofstream file(out, std::ios_base::out | std::ios_base::trunc);
+    write_json(file, argv[0], results);
+  }
+  return 0;
+}